@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace openkore_ai {
+
+// Kinds of actions the bot can execute. Services may answer with kinds the engine doesn't know, those
+// are OTHER and keep their name in the action.
+enum class ActionKind : uint8_t {
+    NONE,
+    ATTACK,
+    SKILL,
+    MOVE,
+    ITEM,
+    TALK,
+    SIT,
+    STAND,
+    COMMAND,
+    DROP,
+    JOB_CHANGE,
+    ADD_STAT,
+    ADD_SKILL,
+    NPC_TALK,
+    NPC_MENU,
+    NPC_BUY,
+    NPC_CLOSE,
+    OTHER
+};
+
+// Wire name of a kind, "" for OTHER
+std::string_view action_kind_name(ActionKind kind);
+
+// Kind with the wire name, OTHER if it is none of the known ones
+ActionKind action_kind_of(std::string_view name);
+
+// Interned name of an action parameter. The names coordinators use are constants below; names first seen
+// in service replies are interned when they arrive.
+using ParamKey = uint16_t;
+
+namespace params {
+inline constexpr ParamKey ITEM = 0;
+inline constexpr ParamKey SKILL = 1;
+inline constexpr ParamKey TARGET = 2;
+inline constexpr ParamKey TARGET_AREA = 3;
+inline constexpr ParamKey X = 4;
+inline constexpr ParamKey Y = 5;
+inline constexpr ParamKey DIRECTION = 6;
+inline constexpr ParamKey COMMAND = 7;
+inline constexpr ParamKey EMERGENCY = 8;
+inline constexpr ParamKey AMOUNT = 9;
+inline constexpr ParamKey TARGET_JOB = 10;
+inline constexpr ParamKey STAT = 11;
+inline constexpr ParamKey POINTS = 12;
+inline constexpr ParamKey ACTION = 13;
+inline constexpr ParamKey OPTION = 14;
+inline constexpr ParamKey ITEMS = 15;
+inline constexpr ParamKey BUILTIN_COUNT = 16;
+} // namespace params
+
+// Key of a parameter name, interning it if it is new. Throws std::length_error once too many names exist.
+ParamKey param_key(std::string_view name);
+std::string_view param_key_name(ParamKey key);
+
+// Parameters of an action, a few entries in a flat list
+class ActionParams {
+public:
+    using Entry = std::pair<ParamKey, std::string>;
+
+    void set(ParamKey key, std::string value);
+    const std::string* get(ParamKey key) const;
+
+    bool empty() const { return entries_.empty(); }
+    size_t size() const { return entries_.size(); }
+    std::vector<Entry>::const_iterator begin() const { return entries_.begin(); }
+    std::vector<Entry>::const_iterator end() const { return entries_.end(); }
+
+private:
+    std::vector<Entry> entries_;
+};
+
+// Action to execute
+struct Action {
+    ActionKind kind = ActionKind::NONE;
+    std::string other_kind;  // wire name of an OTHER kind
+    ActionParams parameters;
+    std::string reason;
+    float confidence = 0.0f;
+
+    std::string_view type_name() const {
+        return kind == ActionKind::OTHER ? std::string_view(other_kind) : action_kind_name(kind);
+    }
+
+    // Sets the kind from its wire name
+    void set_type(std::string_view name) {
+        kind = action_kind_of(name);
+        other_kind = kind == ActionKind::OTHER ? std::string(name) : std::string();
+    }
+};
+
+} // namespace openkore_ai
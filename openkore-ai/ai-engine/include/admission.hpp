@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace openkore_ai {
+
+// Admission control of the decide requests. By Little's law, a new request waits about as long as the
+// requests ahead of it, those in flight and the connections waiting for a worker, take per worker: their
+// number times the measured service time, over the workers. Past reflex_delay the engine only lets the reflex
+// tier decide, past reject_delay it turns non-critical requests away, so that an overload makes decisions
+// simpler and fewer instead of late for every bot at once. A delay of 0 turns its step off. Thread safe.
+class AdmissionControl {
+public:
+    enum class Verdict : uint8_t { ADMIT, REFLEX_ONLY, REJECT };
+
+    // Holds a request in flight until it is destroyed, and measures it if it was admitted
+    class Ticket {
+    public:
+        Ticket(AdmissionControl& control, Verdict verdict);
+        ~Ticket();
+        Ticket(const Ticket&) = delete;
+        Ticket& operator=(const Ticket&) = delete;
+
+        Verdict verdict() const { return verdict_; }
+
+    private:
+        AdmissionControl& control_;
+        Verdict verdict_;
+        std::chrono::steady_clock::time_point start_;
+    };
+
+    AdmissionControl(size_t workers, std::chrono::microseconds reflex_delay, std::chrono::microseconds reject_delay);
+
+    // Decides on a request about to be handled, 'waiting' more being queued for a worker. Critical requests
+    // are never rejected.
+    Ticket admit(bool critical, size_t waiting = 0);
+
+    // Seconds a rejected client should wait, the time the requests ahead take now, at least 1
+    int retry_after_s() const;
+
+    // Decisions in flight, and the moving average of the time admitted ones were handled in
+    size_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+    std::chrono::microseconds service_time() const;
+
+    // Requests only decided by reflex, and rejected, since the start
+    uint64_t reflex_only_count() const { return reflex_only_.load(std::memory_order_relaxed); }
+    uint64_t rejected_count() const { return rejected_.load(std::memory_order_relaxed); }
+
+private:
+    // Weight of a new measure in the moving average, as a shift: 1/8
+    static constexpr int SMOOTHING_SHIFT = 3;
+
+    void finish(Verdict verdict, std::chrono::steady_clock::duration elapsed);
+    // Expected wait of a new request, in microseconds
+    uint64_t expected_delay_us(size_t waiting) const;
+
+    size_t workers_;
+    uint64_t reflex_delay_us_;
+    uint64_t reject_delay_us_;
+    std::atomic<size_t> in_flight_{0};
+    std::atomic<size_t> waiting_{0};            // as of the last admission
+    std::atomic<uint64_t> service_time_us_{0};  // 0 until the first admitted request is done
+    std::atomic<uint64_t> reflex_only_{0};
+    std::atomic<uint64_t> rejected_{0};
+};
+
+} // namespace openkore_ai
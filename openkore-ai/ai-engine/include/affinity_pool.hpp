@@ -0,0 +1,55 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace openkore_ai {
+
+// Threads which each run the tasks of their own keys: the requests of a character always run on the same
+// thread, so the character's session, memo and coordinator state stay in that core's cache and their locks
+// are never contended. A key's thread is std::hash of it modulo the thread count.
+class AffinityPool {
+public:
+    // Threads are pinned to the CPUs round robin, if any are given
+    AffinityPool(size_t threads, const std::vector<int>& cpu_affinity);
+    ~AffinityPool();
+    AffinityPool(const AffinityPool&) = delete;
+    AffinityPool& operator=(const AffinityPool&) = delete;
+
+    // Runs the task on the thread of the key and waits for it to finish, rethrowing what it throws. Tasks of
+    // the same key run one after the other, in the order they came.
+    void run(std::string_view key, const std::function<void()>& task);
+
+    size_t size() const { return workers_.size(); }
+
+private:
+    // A task and whoever waits for it
+    struct Call {
+        const std::function<void()>* task;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+        bool done = false;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<Call*> calls;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    void worker_loop(Worker& worker);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+};
+
+} // namespace openkore_ai
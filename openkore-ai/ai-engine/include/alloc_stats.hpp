@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+
+namespace openkore_ai {
+namespace alloc_stats {
+
+// Whether the engine counts its heap allocations, with -DOPENKORE_AI_ALLOC_STATS=ON. The counting replaces the
+// global operator new and delete, so the other builds pay nothing for it.
+#ifdef OPENKORE_AI_WITH_ALLOC_STATS
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+// Allocations through operator new and their frees, without the over-aligned ones. All zero unless ENABLED.
+struct Counts {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t bytes = 0;   // requested by the allocations
+
+    Counts operator-(const Counts& before) const {
+        return {allocations - before.allocations, frees - before.frees, bytes - before.bytes};
+    }
+};
+
+// Of the calling thread since it started, for counting those of a scope: take the difference
+Counts thread_counts();
+// Of all threads since the process started
+Counts process_counts();
+
+// Memory of the process as the system and the allocator see it, zero where they don't tell
+struct Memory {
+    uint64_t rss_bytes = 0;
+    uint64_t peak_rss_bytes = 0;
+    bool heap_known = false;        // the heap fields are only filled in with glibc
+    uint64_t heap_arena_bytes = 0;  // taken from the system by the allocator, without its own mappings
+    uint64_t heap_mmap_bytes = 0;   // in the allocator's own mappings, for the large blocks
+    uint64_t heap_in_use_bytes = 0; // in allocated blocks, of both kinds
+    uint64_t heap_free_bytes = 0;   // free in the arenas, kept for later allocations
+};
+
+Memory memory();
+
+} // namespace alloc_stats
+} // namespace openkore_ai
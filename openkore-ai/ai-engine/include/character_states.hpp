@@ -0,0 +1,109 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace openkore_ai {
+
+// What the engine keeps about each character between decisions. The coordinators and tiers are shared by all
+// bots and the HTTP threads, so this is kept by character name, in mutex-protected shards like SessionStore's
+// sessions: decisions for different characters rarely wait on each other. Characters not seen for 'ttl' are
+// forgotten.
+template <typename State>
+class CharacterStates {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    explicit CharacterStates(std::chrono::seconds ttl = std::chrono::seconds(600), size_t max_characters = 4096)
+        : ttl_(ttl), max_entries_per_shard_(std::max<size_t>(1, max_characters / SHARD_COUNT)) {}
+
+    // Calls use(state) on the character's state, a new State for a new character, and returns what it returns.
+    // The shard is locked meanwhile, so 'use' must be short and not come back here.
+    template <typename Use>
+    auto with(const std::string& character, Use&& use) {
+        Shard& shard = shards_[std::hash<std::string>{}(character) % SHARD_COUNT];
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(character);
+        if (it == shard.entries.end()) {
+            // New characters are the only time a shard grows, so old ones are dropped here
+            trim(shard, now);
+            it = shard.entries.emplace(character, Entry()).first;
+        }
+        it->second.last_used = now;
+        return use(it->second.state);
+    }
+
+    // Calls visit(character, state, last_used) on the state of each character, locking a shard at a time;
+    // 'visit' mustn't come back here either
+    template <typename Visit>
+    void each(Visit&& visit) const {
+        for (const Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (const auto& [character, entry] : shard.entries) {
+                visit(character, entry.state, entry.last_used);
+            }
+        }
+    }
+
+    // Gives the character 'state', as if it was last seen at 'last_used', replacing what it has; for states
+    // restored from a snapshot. Returns false for characters not seen for the TTL, which are left out.
+    bool restore(const std::string& character, State state, std::chrono::steady_clock::time_point last_used) {
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_used > ttl_) {
+            return false;
+        }
+        Shard& shard = shards_[std::hash<std::string>{}(character) % SHARD_COUNT];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.entries.find(character);
+        if (it == shard.entries.end()) {
+            trim(shard, now);
+            it = shard.entries.emplace(character, Entry()).first;
+        }
+        it->second.state = std::move(state);
+        it->second.last_used = last_used;
+        return true;
+    }
+
+    size_t size() const {
+        size_t total = 0;
+        for (const Shard& shard : shards_) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.entries.size();
+        }
+        return total;
+    }
+
+private:
+    struct Entry {
+        State state{};
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    // Drops the characters not seen for the TTL, and the least recently seen ones past the shard's share
+    void trim(Shard& shard, std::chrono::steady_clock::time_point now) {
+        std::erase_if(shard.entries, [&](const auto& item) { return now - item.second.last_used > ttl_; });
+        while (shard.entries.size() >= max_entries_per_shard_) {
+            auto oldest = std::min_element(shard.entries.begin(), shard.entries.end(),
+                [](const auto& a, const auto& b) { return a.second.last_used < b.second.last_used; });
+            shard.entries.erase(oldest);
+        }
+    }
+
+    std::chrono::seconds ttl_;
+    size_t max_entries_per_shard_;
+    std::array<Shard, SHARD_COUNT> shards_;
+};
+
+} // namespace openkore_ai
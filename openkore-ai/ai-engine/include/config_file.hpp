@@ -0,0 +1,28 @@
+#pragma once
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+namespace config {
+
+// Reads the subset of YAML the engine's config files use: unindented "section:" lines, each followed by
+// indented "key: value" lines. Calls 'entry' for each key, with its value unquoted and without a trailing
+// "# comment".
+using Entry = std::function<void(const std::string& section, const std::string& key, const std::string& value,
+                                 int line_number)>;
+void read_entries(std::istream& in, const Entry& entry);
+
+std::string trim(const std::string& text);
+
+// Values of the keys; throw std::invalid_argument for invalid ones
+bool to_bool(const std::string& value);
+long long to_number(const std::string& value, long long min, long long max);
+double to_real(const std::string& value, double min, double max);
+
+// The items of a list such as "a, b" or "[a, b]", trimmed, without the empty ones
+std::vector<std::string> to_list(const std::string& value);
+
+} // namespace config
+} // namespace openkore_ai
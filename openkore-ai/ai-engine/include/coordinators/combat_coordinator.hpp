@@ -4,17 +4,16 @@
 namespace openkore_ai {
 namespace coordinators {
 
-class CombatCoordinator : public CoordinatorBase {
+class CombatCoordinator final : public CoordinatorBase {
 public:
     CombatCoordinator();
     
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
     
 private:
-    Monster select_target(const GameState& state) const;
-    std::string select_skill(const GameState& state, const Monster& target) const;
-    bool should_use_aoe(const GameState& state) const;
+    std::string select_skill(const StateSummary& summary) const;
+    bool should_use_aoe(const StateSummary& summary) const;
 };
 
 } // namespace coordinators
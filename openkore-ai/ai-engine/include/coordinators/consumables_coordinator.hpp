@@ -4,12 +4,12 @@
 namespace openkore_ai {
 namespace coordinators {
 
-class ConsumablesCoordinator : public CoordinatorBase {
+class ConsumablesCoordinator final : public CoordinatorBase {
 public:
     ConsumablesCoordinator();
     
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 
 private:
     // Thresholds for consumable usage
@@ -20,9 +20,9 @@ private:
     float weight_warning_threshold_;
     
     // Helper methods
-    std::string find_best_hp_item(const GameState& state, bool emergency) const;
-    std::string find_best_sp_item(const GameState& state, bool emergency) const;
-    std::string find_item_to_drop(const GameState& state) const;
+    std::string find_best_hp_item(const InventorySummary& inventory, bool emergency) const;
+    std::string find_best_sp_item(const InventorySummary& inventory, bool emergency) const;
+    std::string find_item_to_drop(const InventorySummary& inventory) const;
 };
 
 } // namespace coordinators
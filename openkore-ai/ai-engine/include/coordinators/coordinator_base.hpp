@@ -1,5 +1,7 @@
 #pragma once
 #include "../types.hpp"
+#include "../state_summary.hpp"
+#include "../session_snapshot.hpp"
 #include <string>
 #include <memory>
 
@@ -21,11 +23,22 @@ public:
     CoordinatorBase(const std::string& name, Priority default_priority);
     virtual ~CoordinatorBase() = default;
     
-    // Check if this coordinator should handle current state
-    virtual bool should_activate(const GameState& state) const = 0;
+    // Check if this coordinator should handle current state. 'summary' is the request's StateSummary of
+    // the state, shared by the coordinators.
+    virtual bool should_activate(const GameState& state, const StateSummary& summary) const = 0;
     
     // Make decision for this coordinator's domain
-    virtual Action decide(const GameState& state) = 0;
+    virtual Action decide(const GameState& state, const StateSummary& summary) = 0;
+    
+    // Whether decide() changes what the coordinator keeps about the character, so that it can't be asked ahead
+    // of the character's state, see CoordinatorManager::speculative_decision()
+    virtual bool keeps_state() const { return false; }
+    
+    // What a coordinator which keeps_state() keeps about the characters, for the engine's snapshot, see
+    // CoordinatorManager::save(). restore_state() adds what save_state() wrote, and throws std::runtime_error
+    // if it is invalid.
+    virtual void save_state(SnapshotWriter&) const {}
+    virtual void restore_state(SnapshotReader&) {}
     
     // Get coordinator name
     std::string get_name() const { return name_; }
@@ -38,7 +51,7 @@ protected:
     Priority priority_;
     
     // Helper to create action
-    Action create_action(const std::string& type, const std::string& reason, float confidence = 0.8f) const;
+    Action create_action(ActionKind kind, const std::string& reason, float confidence = 0.8f) const;
 };
 
 } // namespace coordinators
@@ -1,11 +1,71 @@
 #pragma once
 #include "coordinator_base.hpp"
+#include "combat_coordinator.hpp"
+#include "economy_coordinator.hpp"
+#include "navigation_coordinator.hpp"
+#include "social_coordinator.hpp"
+#include "consumables_coordinator.hpp"
+#include "progression_coordinator.hpp"
+#include "npc_coordinator.hpp"
+#include "planning_coordinator.hpp"
+#include "stub_coordinators.hpp"
+#include "../decision_settings.hpp"
+#include "../worker_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <tuple>
+#include <utility>
 #include <vector>
 #include <memory>
 
 namespace openkore_ai {
 namespace coordinators {
 
+// A copy of a request's state with its summary, owned by the parallel evaluations that use it
+struct SummarizedState {
+    SummarizedState(const GameState& original, const Trends& trends) : state(original), summary(state, trends) {}
+    
+    const GameState state;
+    const StateSummary summary;
+};
+
+// Which coordinators take part in decisions and how, compiled from DecisionSettings. Immutable, so that each
+// decision goes by one of them from start to end.
+struct CoordinatorSchedule {
+    std::vector<std::vector<size_t>> buckets;  // indices of the coordinators of each priority in use, highest first
+    std::chrono::microseconds deadline{0};
+    bool collect_all = false;
+};
+
+// The coordinators every manager has, in the order they're evaluated in. Their classes are final and their
+// calls dispatched by index at compile time, so should_activate() and decide() aren't virtual calls for them.
+struct BuiltinCoordinators {
+    CombatCoordinator combat;
+    EconomyCoordinator economy;
+    NavigationCoordinator navigation;
+    NPCCoordinator npc;
+    PlanningCoordinator planning;
+    SocialCoordinator social;
+    ConsumablesCoordinator consumables;
+    ProgressionCoordinator progression;
+    CompanionsCoordinator companions;
+    InstancesCoordinator instances;
+    CraftingCoordinator crafting;
+    EnvironmentCoordinator environment;
+    JobSpecificCoordinator job_specific;
+    PvPWoECoordinator pvp_woe;
+    
+    // All of them, in the order above
+    auto all() {
+        return std::tie(combat, economy, navigation, npc, planning, social, consumables, progression, companions,
+                        instances, crafting, environment, job_specific, pvp_woe);
+    }
+};
+
+inline constexpr size_t BUILTIN_COORDINATORS =
+    std::tuple_size_v<decltype(std::declval<BuiltinCoordinators&>().all())>;
+
 class CoordinatorManager {
 public:
     CoordinatorManager();
@@ -13,17 +73,80 @@ public:
     // Initialize all coordinators
     void initialize();
     
-    // Get recommendation from all active coordinators
+    // Adds a coordinator after the built-in ones, called through CoordinatorBase; before any decision is made
+    // and any schedule compiled, since schedules refer to the coordinators by index
+    void add_coordinator(std::unique_ptr<CoordinatorBase> coordinator);
+    
+    // The schedule of the settings; throws std::invalid_argument for disabled coordinators it doesn't have.
+    // With collect_all_coordinators, every coordinator is evaluated for each decision instead of stopping after
+    // the highest priority that recommends something: the decisions are the same, this is for debugging.
+    std::shared_ptr<const CoordinatorSchedule> compile(const DecisionSettings& settings) const;
+    
+    // Get recommendation from all active coordinators, by the schedule of the default settings or by 'schedule'.
+    // Coordinators not started by the decision's deadline are left out of it, like late ones. 'chosen' is set
+    // to the index of the coordinator whose action it is, if there is one.
     Action get_coordinator_decision(const GameState& state);
+    Action get_coordinator_decision(const GameState& state, const StateSummary& summary,
+                                    std::chrono::steady_clock::time_point deadline
+                                    = std::chrono::steady_clock::time_point::max(),
+                                    size_t* chosen = nullptr);
+    Action get_coordinator_decision(const GameState& state, const StateSummary& summary,
+                                    const CoordinatorSchedule& schedule,
+                                    std::chrono::steady_clock::time_point deadline
+                                    = std::chrono::steady_clock::time_point::max(),
+                                    size_t* chosen = nullptr);
+    
+    // The decision for a state the character may send next, by 'schedule' or the default one if null: nullopt
+    // if a coordinator which keeps_state() would activate, since deciding would change what it keeps. Not timed
+    // and not parallel, it's made on a thread of its own.
+    std::optional<Action> speculative_decision(const GameState& state, const StateSummary& summary,
+                                               const CoordinatorSchedule* schedule, size_t* chosen = nullptr);
+    
+    // Evaluates the coordinators in parallel on the pool from now on. Coordinators which haven't answered
+    // the schedule's deadline after the start of a decision are left out of it; 'pool' must outlive the manager.
+    void enable_parallel(WorkerPool& pool);
+    
+    // Coordinators left out of decisions for missing the deadline
+    uint64_t late_count() const { return late_count_.load(std::memory_order_relaxed); }
     
     // Get specific coordinator by name
     CoordinatorBase* get_coordinator(const std::string& name) const;
     
+    // Names of the coordinators, by the index the schedules use
+    std::vector<std::string> names() const;
+    
+    // Writes what the coordinators which keep_state() keep about the characters, each under its name.
+    // restore() gives it back to the coordinators of the same name, skipping those this manager doesn't have,
+    // and returns the number it restored; it throws std::runtime_error if the data is invalid.
+    void save(SnapshotWriter& out) const;
+    size_t restore(SnapshotReader& in);
+    
 private:
-    std::vector<std::unique_ptr<CoordinatorBase>> coordinators_;
+    std::unique_ptr<BuiltinCoordinators> builtin_;
+    std::vector<std::unique_ptr<CoordinatorBase>> added_;
+    // All of them, the built-in ones first, by the index the schedules use
+    std::vector<CoordinatorBase*> coordinators_;
+    // Stage of each coordinator in the engine's stage metrics
+    std::vector<size_t> stage_ids_;
+    std::shared_ptr<const CoordinatorSchedule> default_schedule_;
+    
+    WorkerPool* pool_ = nullptr;
+    std::atomic<uint64_t> late_count_{0};
+    
+    // The action of a coordinator, none if it doesn't activate
+    std::optional<Action> evaluate(size_t i, const GameState& state, const StateSummary& summary);
+    
+    // Adds the recommendations of the coordinators of a bucket, in coordinator order
+    void collect_sequential(const GameState& state, const StateSummary& summary, const std::vector<size_t>& bucket,
+                            std::chrono::steady_clock::time_point deadline,
+                            std::vector<std::pair<CoordinatorBase*, Action>>& recommendations);
+    void collect_parallel(const std::shared_ptr<const SummarizedState>& state, const std::vector<size_t>& bucket,
+                          std::chrono::steady_clock::time_point deadline,
+                          std::vector<std::pair<CoordinatorBase*, Action>>& recommendations);
     
     // Select best action from multiple coordinator recommendations
-    Action select_best_action(const std::vector<std::pair<CoordinatorBase*, Action>>& recommendations) const;
+    Action select_best_action(const std::vector<std::pair<CoordinatorBase*, Action>>& recommendations,
+                              size_t* chosen = nullptr) const;
 };
 
 } // namespace coordinators
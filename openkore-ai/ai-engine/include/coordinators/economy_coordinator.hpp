@@ -4,12 +4,12 @@
 namespace openkore_ai {
 namespace coordinators {
 
-class EconomyCoordinator : public CoordinatorBase {
+class EconomyCoordinator final : public CoordinatorBase {
 public:
     EconomyCoordinator();
     
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
     
 private:
     bool is_overweight(const GameState& state) const;
@@ -4,22 +4,19 @@
 namespace openkore_ai {
 namespace coordinators {
 
-class NavigationCoordinator : public CoordinatorBase {
+class NavigationCoordinator final : public CoordinatorBase {
 public:
     NavigationCoordinator();
     
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 
 private:
-    // Stuck detection
-    mutable int stuck_counter_;
-    int stuck_threshold_;
-    mutable int last_position_x_;
-    mutable int last_position_y_;
+    // Time in place after which a character with nothing around to fight or recover for is stuck
+    static constexpr int64_t STUCK_TIME_MS = 30000;
     
     // Helper methods
-    bool is_stuck(const GameState& state) const;
+    bool is_stuck(const StateSummary& summary) const;
     Action handle_stuck(const GameState& state);
     Action navigate_to_destination(const GameState& state) const;
     std::string find_nearest_portal(const GameState& state) const;
@@ -1,14 +1,18 @@
 #pragma once
 #include "coordinator_base.hpp"
+#include "../character_states.hpp"
 
 namespace openkore_ai {
 namespace coordinators {
 
-class NPCCoordinator : public CoordinatorBase {
+class NPCCoordinator final : public CoordinatorBase {
 public:
     NPCCoordinator();
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
+    bool keeps_state() const override { return true; }
+    void save_state(SnapshotWriter& out) const override;
+    void restore_state(SnapshotReader& in) override;
 
 private:
     enum class DialogueState {
@@ -19,17 +23,21 @@ private:
         SELLING
     };
     
-    // NPC interaction state
+    // NPC interaction state of a character
+    struct Dialogue {
+        std::string npc_id;
+        DialogueState state = DialogueState::IDLE;
+    };
+    
     int npc_interaction_range_;
-    mutable std::string current_npc_id_;
-    mutable DialogueState dialogue_state_;
+    mutable CharacterStates<Dialogue> dialogues_;
     
     // Helper methods
-    Action handle_active_dialogue(const GameState& state);
-    Action initiate_npc_talk(const std::string& npc_id, const std::string& reason);
+    Action handle_active_dialogue(Dialogue& dialogue);
+    Action initiate_npc_talk(Dialogue& dialogue, const std::string& npc_id, const std::string& reason);
     std::string find_quest_npc(const GameState& state) const;
     std::string find_shop_npc(const GameState& state, const std::string& shop_type) const;
-    bool check_need_potions(const GameState& state) const;
+    bool check_need_potions(const StateSummary& summary) const;
     bool has_nearby_shop_npc(const GameState& state) const;
     bool is_near_weight_limit(const GameState& state) const;
     int calculate_npc_distance(const GameState& state, const std::string& npc_id) const;
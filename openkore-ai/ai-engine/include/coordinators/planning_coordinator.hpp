@@ -1,25 +1,37 @@
 #pragma once
 #include "coordinator_base.hpp"
+#include "../character_states.hpp"
 
 namespace openkore_ai {
 namespace coordinators {
 
-class PlanningCoordinator : public CoordinatorBase {
+class PlanningCoordinator final : public CoordinatorBase {
 public:
     PlanningCoordinator();
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
+    bool keeps_state() const override { return true; }
+    void save_state(SnapshotWriter& out) const override;
+    void restore_state(SnapshotReader& in) override;
 
 private:
-    // Planning state
-    mutable std::vector<Action> active_plan_;
-    mutable int current_plan_step_;
-    mutable bool has_active_plan_;
+    // Planning state of a character
+    struct Plan {
+        std::vector<Action> steps;
+        size_t current_step = 0;
+        bool active = false;
+    };
+    
+    mutable CharacterStates<Plan> plans_;
+    
+    // Seconds left at the HP's rate of fall under which a fight against several monsters is lost
+    static constexpr float LOSING_SECONDS = 5.0f;
     
     // Helper methods
-    bool needs_complex_planning(const GameState& state) const;
-    void create_plan_for_current_situation(const GameState& state);
-    bool check_need_resupply(const GameState& state) const;
+    bool needs_complex_planning(const GameState& state, const StateSummary& summary) const;
+    bool is_losing_fight(const GameState& state, const StateSummary& summary) const;
+    void create_plan_for_current_situation(Plan& plan, const GameState& state, const StateSummary& summary) const;
+    bool check_need_resupply(const StateSummary& summary) const;
 };
 
 } // namespace coordinators
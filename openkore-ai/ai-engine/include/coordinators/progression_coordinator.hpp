@@ -4,12 +4,12 @@
 namespace openkore_ai {
 namespace coordinators {
 
-class ProgressionCoordinator : public CoordinatorBase {
+class ProgressionCoordinator final : public CoordinatorBase {
 public:
     ProgressionCoordinator();
     
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 
 private:
     // Tracking for stat/skill allocation
@@ -17,12 +17,8 @@ private:
     mutable int last_skill_point_check_;
     
     // Helper methods
-    Action allocate_stat_points(const GameState& state) const;
-    Action allocate_skill_points(const GameState& state) const;
-    std::string get_primary_stat_for_job(const std::string& job_class) const;
-    std::string get_secondary_stat_for_job(const std::string& job_class) const;
-    std::string get_recommended_skill_for_job(const std::string& job_class, int level) const;
-    bool is_first_job(const std::string& job_class) const;
+    Action allocate_stat_points(const StateSummary& summary) const;
+    Action allocate_skill_points(const StateSummary& summary) const;
 };
 
 } // namespace coordinators
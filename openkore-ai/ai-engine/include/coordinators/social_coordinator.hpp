@@ -4,12 +4,12 @@
 namespace openkore_ai {
 namespace coordinators {
 
-class SocialCoordinator : public CoordinatorBase {
+class SocialCoordinator final : public CoordinatorBase {
 public:
     SocialCoordinator();
     
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 };
 
 } // namespace coordinators
@@ -8,51 +8,51 @@ namespace openkore_ai {
 namespace coordinators {
 
 // Companions Coordinator - Homunculus, mercenary, pet management
-class CompanionsCoordinator : public CoordinatorBase {
+class CompanionsCoordinator final : public CoordinatorBase {
 public:
     CompanionsCoordinator();
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 };
 
 // Instances Coordinator - Dungeon runs, instance coordination
-class InstancesCoordinator : public CoordinatorBase {
+class InstancesCoordinator final : public CoordinatorBase {
 public:
     InstancesCoordinator();
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 };
 
 // Crafting Coordinator - Item crafting, refining, enchanting
-class CraftingCoordinator : public CoordinatorBase {
+class CraftingCoordinator final : public CoordinatorBase {
 public:
     CraftingCoordinator();
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 };
 
 // Environment Coordinator - Day/night cycles, weather, events
-class EnvironmentCoordinator : public CoordinatorBase {
+class EnvironmentCoordinator final : public CoordinatorBase {
 public:
     EnvironmentCoordinator();
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 };
 
 // Job-Specific Coordinator - Class-specific tactics and rotations
-class JobSpecificCoordinator : public CoordinatorBase {
+class JobSpecificCoordinator final : public CoordinatorBase {
 public:
     JobSpecificCoordinator();
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 };
 
 // PvP/WoE Coordinator - PvP combat, War of Emperium strategy
-class PvPWoECoordinator : public CoordinatorBase {
+class PvPWoECoordinator final : public CoordinatorBase {
 public:
     PvPWoECoordinator();
-    bool should_activate(const GameState& state) const override;
-    Action decide(const GameState& state) override;
+    bool should_activate(const GameState& state, const StateSummary& summary) const override;
+    Action decide(const GameState& state, const StateSummary& summary) override;
 };
 
 } // namespace coordinators
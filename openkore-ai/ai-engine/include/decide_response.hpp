@@ -0,0 +1,25 @@
+#pragma once
+#include "types.hpp"
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <string>
+
+namespace openkore_ai {
+
+// What a decided request is answered
+struct DecideAnswer {
+    DecisionResponse decision;
+    std::string session_id;     // empty without a session
+    uint64_t state_version = 0;
+};
+
+// The answer as a document: the action, tier_used, the latencies, request_id, the skipped components if any,
+// and session_id and state_version with a session
+nlohmann::json decide_response_json(const DecideAnswer& answer);
+
+// Writes the same document as decide_response_json(answer).dump() would, appended to 'out', in one pass over
+// the answer instead of building the document first. Returns false if a string of the answer isn't valid
+// UTF-8, which dump() throws on; 'out' then holds part of the document.
+bool write_decide_response(const DecideAnswer& answer, std::string& out);
+
+} // namespace openkore_ai
@@ -0,0 +1,48 @@
+#pragma once
+#include "../types.hpp"
+#include "../item_database.hpp"
+#include <array>
+#include <cstddef>
+#include <span>
+
+namespace openkore_ai {
+namespace decision {
+
+// Features of a state in a fixed layout of floats, written straight from the GameState for the ML model,
+// in-process or on the Python service. The row is aligned and padded to whole 8-float lanes so it can be
+// copied into batches and tensors as is.
+//
+// [0, 28)   the model's features, those of FeatureExtractor in ai-service/src/ml/data_collector.py
+// [28, 52)  the 8 nearest monsters, nearest first: distance / 30 capped at 1, HP ratio, aggressive;
+//           missing monsters have distance 1 and the rest 0
+// [52, 56)  amounts in the inventory of HP recovery, SP recovery, cure and loot items (ItemDatabase)
+// [56, 64)  padding, 0
+struct alignas(32) FeatureVector {
+    static constexpr size_t MODEL_FEATURES = 28;
+
+    static constexpr size_t NEAREST_MONSTERS = 8;
+    static constexpr size_t MONSTER_FIELDS = 3;
+    static constexpr size_t MONSTERS = MODEL_FEATURES;
+    static constexpr float MONSTER_RANGE = 30.0f;  // cells
+
+    static constexpr size_t ITEMS = MONSTERS + NEAREST_MONSTERS * MONSTER_FIELDS;
+    static constexpr size_t ITEM_FIELDS = ITEM_CATEGORIES - 1;  // all but OTHER, the last
+
+    static constexpr size_t SIZE = 64;
+    static_assert(ITEMS + ITEM_FIELDS <= SIZE && SIZE % 8 == 0);
+
+    std::array<float, SIZE> values{};
+
+    // The row the model takes
+    std::span<const float, MODEL_FEATURES> model_input() const {
+        return std::span<const float, MODEL_FEATURES>(values.data(), MODEL_FEATURES);
+    }
+
+    float items(ItemCategory category) const { return values[ITEMS + static_cast<size_t>(category)]; }
+};
+
+// Overwrites 'features' with those of 'state', without allocating
+void extract_features(const GameState& state, FeatureVector& features);
+
+} // namespace decision
+} // namespace openkore_ai
@@ -1,31 +1,73 @@
 #pragma once
 #include "../types.hpp"
+#include "../service_client.hpp"
+#include "../single_flight.hpp"
+#include "../worker_pool.hpp"
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <optional>
+#include <unordered_map>
 
 namespace openkore_ai {
 namespace decision {
 
+// Strategic advice from the LLM behind the Python service. Its answers take up to minutes, so queries run in
+// the background: deciding on a milestone sends the query and returns a NONE action right away, and the
+// answer is handed over with one of the character's next decisions.
 class LLMTier {
 public:
-    LLMTier(const std::string& python_service_url);
+    // Queries time out after 'timeout', LLM answers can take minutes
+    LLMTier(std::shared_ptr<ServiceClientPool> service, std::chrono::milliseconds timeout = std::chrono::minutes(5));
     
-    // Check if LLM tier should handle this (complex situations)
+    // True when an answer is waiting for the character, or it reached a milestone worth asking about
     bool should_handle(const GameState& state) const;
     
-    // Make LLM-based decision (30-300s)
+    // Hands over the character's waiting answer, or sends a query and returns a NONE action
     Action decide(const GameState& state);
     
 private:
-    std::string python_service_url_;
-    mutable long long last_query_time_ms_ = 0;
-    static constexpr long long MIN_QUERY_INTERVAL_MS = 60000;  // 1 minute between LLM queries
+    // Queries and answers of one character
+    struct CharacterQueries {
+        bool pending = false;
+        std::optional<Action> answer;
+        std::chrono::steady_clock::time_point last_query;
+        std::chrono::steady_clock::time_point answered;
+    };
     
-    // HTTP client for Python service
+    static constexpr std::chrono::seconds MIN_QUERY_INTERVAL{60};   // per character
+    static constexpr std::chrono::minutes ANSWER_TTL{10};           // answers not collected by then are dropped
+    static constexpr size_t MAX_PENDING_QUERIES = 16;
+    static constexpr size_t MAX_CHARACTERS = 4096;
+    static constexpr size_t QUERY_THREADS = 4;
+    
+    // Whether a query may be sent for the character, the mutex must be held
+    bool may_query(const GameState& state, const CharacterQueries* queries,
+                   std::chrono::steady_clock::time_point now) const;
+    // Forgets the characters with nothing pending or waiting, the mutex must be held
+    void trim(std::chrono::steady_clock::time_point now);
+    
+    // Query to the Python service, through the shared connections
     std::optional<Action> query_python_service(const GameState& state);
+    // Hash of what the strategy depends on, so party members at the same milestone share one query
+    static uint64_t strategy_fingerprint(const GameState& state);
     
     // Helper to convert game state to JSON
     std::string game_state_to_json(const GameState& state) const;
+    
+    std::shared_ptr<ServiceClientPool> service_;
+    std::chrono::milliseconds timeout_;
+    
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, CharacterQueries> characters_;
+    size_t pending_ = 0;
+    
+    // Answers kept for 5 minutes, by strategy_fingerprint
+    SingleFlight<Action> answers_{std::chrono::minutes(5), 1024};
+    
+    // Last member, so its threads are joined before the rest goes away
+    WorkerPool queries_;
 };
 
 } // namespace decision
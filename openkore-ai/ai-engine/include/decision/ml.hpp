@@ -1,13 +1,39 @@
 #pragma once
 #include "../types.hpp"
+#include "../service_client.hpp"
+#include "../single_flight.hpp"
+#include "../micro_batcher.hpp"
+#include "features.hpp"
+#include "onnx_model.hpp"
 #include <nlohmann/json.hpp>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
 
 namespace openkore_ai {
 namespace decision {
 
+// An int8-quantized variant of the ML tier's model, which is predicted with instead of the model once its
+// labels agree with the model's on enough recorded states
+struct QuantizedModel {
+    std::string path;               // none if empty
+    std::string check_states;       // the recorded states, see load_states
+    size_t check_limit = 2000;      // states compared at most
+    double min_agreement = 0.98;    // share of them whose label must be the model's
+};
+
 class MLTier {
 public:
-    MLTier();
+    // Predicts with the ONNX model at model_path when the engine is built with ONNX Runtime and the model
+    // is there, with the Python service otherwise. With a batch_size above 1, concurrent predictions are
+    // run together, in batches of up to batch_size rows waiting at most batch_delay for the batch to fill.
+    explicit MLTier(std::shared_ptr<ServiceClientPool> service,
+                    const std::string& model_path = "../models/decision_model.onnx", size_t batch_size = 1,
+                    std::chrono::microseconds batch_delay = std::chrono::microseconds(200),
+                    const QuantizedModel& quantized = {});
     
     // Check if ML tier is available and should handle this
     bool should_handle(const GameState& state) const;
@@ -16,16 +42,46 @@ public:
     // Phase 6: Full implementation with Python service integration
     Action decide(const GameState& state);
     
+    // The prediction kept for a state like this one, from the last 2 seconds, without querying the service
+    std::optional<Action> decide_cached(const GameState& state);
+    
+    // True when predictions run in-process
+    bool model_loaded() const { return model_ != nullptr; }
+    
+    // True when they run with the quantized model
+    bool quantized() const { return quantized_; }
+    
+    // Batches run since the start and the predictions in them, 0 without batching
+    size_t batches() const;
+    size_t batched_predictions() const;
+    
 private:
-    bool model_loaded_ = false;
+    std::shared_ptr<ServiceClientPool> service_;
+    std::unique_ptr<OnnxModel> model_;
+    bool quantized_ = false;
+    static constexpr std::chrono::milliseconds QUERY_TIMEOUT{5000};
+    
+    // Predictions kept for 2 seconds, by prediction_fingerprint
+    SingleFlight<Action> predictions_{std::chrono::milliseconds(2000), 1024};
     
     // Phase 6: ML service integration
     Action query_ml_service(const GameState& state);
-    nlohmann::json state_to_json(const GameState& state) const;
-    void load_onnx_model();  // Load ONNX model if available
+    std::optional<Action> fetch_prediction(const FeatureVector& features);
+    void fetch_predictions(std::span<const FeatureVector> rows, std::vector<std::optional<Action>>& actions);
+    // Hash of what the prediction depends on, close states have the same one
+    static uint64_t prediction_fingerprint(const GameState& state);
+    void load_onnx_model(const std::string& path, const QuantizedModel& quantized);  // Load ONNX model if available
+    void use_quantized_model(const QuantizedModel& quantized);
+    std::optional<Action> predict_in_process(const FeatureVector& features);
+    static Action action_of(const OnnxModel::Prediction& prediction);
     
     // Fallback helper
     Action decide_fallback(const GameState& state);
+    
+    // Batches of the model's or the service's predictions, declared last so they stop before the model and
+    // the service pool go
+    std::unique_ptr<MicroBatcher<FeatureVector, OnnxModel::Prediction>> model_batches_;
+    std::unique_ptr<MicroBatcher<FeatureVector, Action>> service_batches_;
 };
 
 } // namespace decision
@@ -0,0 +1,66 @@
+#pragma once
+#include "features.hpp"
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+namespace decision {
+
+// The decision model the Python service trains (ai-service/src/ml/model_trainer.py), run in-process with
+// ONNX Runtime. Its input is a row of the service's 28 features, its output the label of an action kind,
+// with the probabilities of each label when the model has them. Needs the engine built with
+// OPENKORE_AI_ONNX, load() fails otherwise.
+class OnnxModel {
+public:
+    static constexpr size_t FEATURE_COUNT = FeatureVector::MODEL_FEATURES;
+
+    // Labels of the trainer's action kinds
+    enum Label : long long { ATTACK = 0, SKILL = 1, MOVE = 2, ITEM = 3, NONE = 4 };
+
+    struct Prediction {
+        long long label;
+        float confidence;  // probability of the label, 1 if the model only gives labels
+    };
+
+    // The model at 'path', nullptr if there is none there, it can't be loaded or ONNX Runtime isn't built in
+    static std::unique_ptr<OnnxModel> load(const std::string& path);
+
+    ~OnnxModel();
+    OnnxModel(const OnnxModel&) = delete;
+    OnnxModel& operator=(const OnnxModel&) = delete;
+
+    // Runs the model on one row, or on a batch of them in one run. Thread safe, concurrent callers each use
+    // a binding of their own. Throw std::runtime_error if inference fails.
+    Prediction predict(const FeatureVector& features);
+    void predict(std::span<const FeatureVector> rows, std::vector<Prediction>& predictions);
+
+    // How the predictions of a model agree with those of a reference model on the same rows
+    struct Agreement {
+        size_t rows = 0;
+        size_t same_labels = 0;
+        double confidence_difference = 0.0;         // mean absolute difference of the confidences
+        std::chrono::nanoseconds reference_time{0}; // taken by each model over all the rows
+        std::chrono::nanoseconds time{0};
+
+        double ratio() const { return rows > 0 ? static_cast<double>(same_labels) / rows : 0.0; }
+    };
+
+    // Runs this model and 'reference' over the rows, in batches. Throws std::runtime_error if inference fails.
+    Agreement compare(OnnxModel& reference, std::span<const FeatureVector> rows);
+
+    // True when ONNX Runtime is built in
+    static bool available();
+
+private:
+    struct Impl;
+    explicit OnnxModel(std::unique_ptr<Impl> impl);
+
+    std::unique_ptr<Impl> impl_;
+};
+
+} // namespace decision
+} // namespace openkore_ai
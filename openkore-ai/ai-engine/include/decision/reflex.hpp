@@ -1,6 +1,8 @@
 #pragma once
 #include "../types.hpp"
+#include "../state_summary.hpp"
 #include <chrono>
+#include <cstdint>
 
 namespace openkore_ai {
 namespace decision {
@@ -11,17 +13,25 @@ public:
     
     // Check if reflex tier should handle this situation
     bool should_handle(const GameState& state) const;
+    bool should_handle(const GameState& state, const StateSummary& summary) const;
     
     // Make reflex decision (<1ms)
     Action decide(const GameState& state);
+    Action decide(const GameState& state, const StateSummary& summary);
     
 private:
-    // Emergency checks
-    bool is_hp_critical(const GameState& state) const;
-    bool is_sp_low(const GameState& state) const;
-    bool is_being_attacked(const GameState& state) const;
-    bool has_dangerous_status(const GameState& state) const;
-    bool is_overweight(const GameState& state) const;
+    // Emergencies by priority, as bits of emergencies()
+    enum Emergency : uint32_t {
+        HP_CRITICAL,
+        DANGEROUS_STATUS,
+        ATTACKED_WITH_LOW_HP,
+        OVERWEIGHT,
+        SP_LOW,
+        EMERGENCY_COUNT
+    };
+    
+    // Bits of the emergencies of a state, all tested without branching
+    static uint32_t emergencies(const StateSummary& summary);
     
     // Thresholds
     static constexpr float HP_CRITICAL_THRESHOLD = 0.25f;  // 25%
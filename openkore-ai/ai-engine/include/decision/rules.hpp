@@ -1,5 +1,6 @@
 #pragma once
 #include "../types.hpp"
+#include "../state_summary.hpp"
 
 namespace openkore_ai {
 namespace decision {
@@ -10,27 +11,26 @@ public:
     
     // Check if rules tier should handle this situation
     bool should_handle(const GameState& state) const;
+    bool should_handle(const GameState& state, const StateSummary& summary) const;
     
     // Make rule-based decision (<10ms)
     Action decide(const GameState& state);
+    Action decide(const GameState& state, const StateSummary& summary);
     
 private:
     // Combat rules
-    Action decide_combat(const GameState& state);
+    Action decide_combat(const StateSummary& summary);
     Action decide_targeting(const GameState& state);
-    Action decide_positioning(const GameState& state);
-    Action decide_healing(const GameState& state);
+    Action decide_positioning(const StateSummary& summary);
+    Action decide_healing(const StateSummary& summary);
     
     // Helper functions
-    Monster find_best_target(const GameState& state) const;
-    bool should_attack(const GameState& state) const;
-    bool should_heal(const GameState& state) const;
-    bool is_in_safe_position(const GameState& state) const;
+    bool should_attack(const GameState& state, const StateSummary& summary) const;
+    bool should_heal(const StateSummary& summary) const;
+    bool is_in_safe_position(const StateSummary& summary) const;
     
-    // Thresholds
-    static constexpr float HP_HEAL_THRESHOLD = 0.60f;       // 60%
-    static constexpr float SP_SKILL_THRESHOLD = 0.30f;      // 30%
-    static constexpr int MAX_ATTACK_DISTANCE = 15;
+    // Distances, the thresholds are the job's (JobRules)
+    static constexpr int MAX_ATTACK_DISTANCE = MonsterSummary::TARGET_RANGE;
     static constexpr int SAFE_DISTANCE = 8;
 };
 
@@ -0,0 +1,62 @@
+#pragma once
+#include "types.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace openkore_ai {
+
+// The last decision of each character, given again while the character keeps sending the same state: bots
+// standing idle or sitting send the same state every tick. A decision is only given again for a short while,
+// so the coordinators which track the character over time still see it regularly. Characters are spread over
+// mutex-protected shards, like SessionStore's sessions.
+class DecisionMemo {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Decision {
+        Action action;
+        DecisionTier tier = DecisionTier::REFLEX;
+        bool handled = true;    // false when no tier acted
+        uint16_t source = 0;    // of its outcomes, see DecisionPipeline::outcome_sources()
+    };
+
+    explicit DecisionMemo(size_t max_characters = 4096);
+
+    // Whether the tiers and coordinators see the same state in both: all fields but the timestamp are equal,
+    // lists in the same order
+    static bool same_state(const GameState& a, const GameState& b);
+
+    // Copies the decision stored for the character if it was made for the same state and hasn't expired
+    bool find(const GameState& state, std::chrono::steady_clock::time_point now, Decision& decision);
+
+    // Keeps the decision for the state until 'expires', replacing the character's previous one
+    void store(const GameState& state, std::chrono::steady_clock::time_point expires, const Decision& decision);
+
+    // Decisions given again
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+
+private:
+    struct Entry {
+        GameState state;    // assigned to, so a character's entry keeps its capacity
+        std::chrono::steady_clock::time_point expires;
+        Decision decision;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    Shard& shard_of(const std::string& character);
+
+    size_t max_entries_per_shard_;
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::atomic<uint64_t> hits_{0};
+};
+
+} // namespace openkore_ai
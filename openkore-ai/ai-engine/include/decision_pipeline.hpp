@@ -0,0 +1,149 @@
+#pragma once
+#include "types.hpp"
+#include "decision_memo.hpp"
+#include "decision_settings.hpp"
+#include "metrics.hpp"
+#include "party_board.hpp"
+#include "speculation.hpp"
+#include "state_history.hpp"
+#include "state_summary.hpp"
+#include "pdca/outcome_book.hpp"
+#include "decision/reflex.hpp"
+#include "decision/rules.hpp"
+#include "decision/ml.hpp"
+#include "decision/llm.hpp"
+#include "coordinators/coordinator_manager.hpp"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace openkore_ai {
+
+// Name of a tier in the responses and metrics
+std::string tier_to_string(DecisionTier tier);
+
+// The "action" object of a decide response
+nlohmann::json action_to_json(const Action& action);
+
+// The parts of a DecisionPipeline which can be set up while it already decides, see load_in_background()
+enum class PipelineComponent : uint8_t { REFLEX, RULES, ML, LLM, COORDINATORS };
+inline constexpr size_t PIPELINE_COMPONENTS = 5;
+
+// Name of a component in the health check
+std::string_view component_name(PipelineComponent component);
+
+// Bit of a component in DecisionResponse::skipped
+constexpr uint32_t component_bit(PipelineComponent component) { return 1u << static_cast<uint32_t>(component); }
+
+// The tiers and coordinators deciding on game states, asked in turn: reflex, coordinators, rules, ML and
+// LLM, until one of them acts, sharing one StateSummary of the state. The server sets up all of them, the
+// slow ones with load_in_background() so that it answers meanwhile; tiers left empty or still loading are
+// skipped, which also lets the tools decide without the Python service.
+//
+// A decision can have a deadline, from its request or DecisionSettings::deadline_ms. Reflex always decides;
+// the stages after it are skipped once less than their minimum budget is left, recorded in the response, and
+// the ML tier answers with a kept prediction instead of querying the service if it has one.
+//
+// The settings are replaced as a whole by configure(), read-copy-update style: each decision goes by the ones
+// in use when it started, and its thread only reads a version number unless they changed since its last one.
+struct DecisionPipeline {
+    std::unique_ptr<decision::ReflexTier> reflex;
+    std::unique_ptr<decision::RulesTier> rules;
+    std::unique_ptr<decision::MLTier> ml;
+    std::unique_ptr<decision::LLMTier> llm;
+    std::unique_ptr<coordinators::CoordinatorManager> coordinators;
+    // Decisions given again for repeated states, past the reflex tier; none without it
+    std::unique_ptr<DecisionMemo> memo;
+    // Snapshots of each character's states, for the trends of the summaries; none without it
+    std::unique_ptr<StateHistory> history;
+    // Focus targets shared by the bots of a party; each bot picks its own without it
+    std::unique_ptr<PartyBoard> party;
+    // Outcomes of the decisions for the PDCA loop of the Python service; none are kept without it
+    std::unique_ptr<pdca::OutcomeBook> outcomes;
+    // Decisions made ahead for the characters' likely next states, given like the memo's; none without it
+    std::unique_ptr<Speculator> speculation;
+
+    // Counts and latencies of the decisions made
+    metrics::DecisionMetrics metrics;
+
+    // Decides by 'deadline', or by the default one of the settings without it
+    DecisionResponse decide(const GameState& state, const std::string& request_id,
+                            std::optional<std::chrono::steady_clock::time_point> deadline = std::nullopt);
+    
+    // Decisions which skipped stages for their deadline
+    uint64_t degraded_count() const { return degraded_count_.load(std::memory_order_relaxed); }
+    
+    // Names of the sources the outcomes are counted by: the tiers by DecisionTier, then "coordinator.<name>"
+    // for each coordinator by its index in the manager
+    std::vector<std::string> outcome_sources() const;
+    
+    // Applies the settings from the next decision on, with the coordinators set up. Throws
+    // std::invalid_argument for coordinators the manager doesn't have, keeping the settings in use.
+    void configure(const DecisionSettings& settings);
+    
+    // The settings in use
+    DecisionSettings settings() const;
+    
+    // Sets up a component on a thread of its own, before the pipeline decides: 'load' assigns its member
+    // above, which decisions leave alone until it returns, asking the other components meanwhile. If 'load'
+    // throws, the error is logged and the component stays out. Loads run in parallel.
+    void load_in_background(PipelineComponent component, std::function<void()> load);
+    
+    // Whether the component's member is set up, or empty without being loaded. loading() while its
+    // load_in_background() runs; neither once it failed.
+    bool ready(PipelineComponent component) const {
+        return loads_[static_cast<size_t>(component)].load(std::memory_order_acquire) == Load::NONE;
+    }
+    bool loading(PipelineComponent component) const {
+        return loads_[static_cast<size_t>(component)].load(std::memory_order_acquire) == Load::RUNNING;
+    }
+    
+    // Waits for the loads started
+    void wait_loaded();
+    
+    DecisionPipeline() = default;
+    ~DecisionPipeline();
+    DecisionPipeline(const DecisionPipeline&) = delete;
+    DecisionPipeline& operator=(const DecisionPipeline&) = delete;
+    
+private:
+    // What a decision goes by: the settings and the coordinator schedule compiled from them
+    struct Configuration {
+        uint64_t version = 0;
+        DecisionSettings settings;
+        std::shared_ptr<const coordinators::CoordinatorSchedule> schedule;  // null for the manager's default
+    };
+    
+    enum class Load : uint8_t { NONE, RUNNING, FAILED };
+    
+    // The configuration in use, as cached by this thread; valid until its next call
+    const std::shared_ptr<const Configuration>& configuration() const;
+    // The decision for a successor state of Speculator, none if the stages past reflex can't make it ahead:
+    // reflex would act, a coordinator keeping state or the LLM would, or ML would have to query the service
+    std::optional<DecisionMemo::Decision> decide_ahead(const GameState& state, const Trends& trends,
+                                                       const Configuration& configuration);
+    // Publishes the settings with the coordinators ready, under configure_mutex_
+    void apply(const DecisionSettings& settings);
+    
+    std::atomic<std::shared_ptr<const Configuration>> configuration_{std::make_shared<const Configuration>()};
+    std::atomic<uint64_t> version_{0};
+    std::atomic<uint64_t> degraded_count_{0};
+    std::mutex configure_mutex_;    // configure() and the coordinators being loaded
+    
+    // Released once a component's member is written
+    std::array<std::atomic<Load>, PIPELINE_COMPONENTS> loads_{};
+    std::mutex loaders_mutex_;
+    std::vector<std::thread> loaders_;
+};
+
+} // namespace openkore_ai
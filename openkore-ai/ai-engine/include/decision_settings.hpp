@@ -0,0 +1,34 @@
+#pragma once
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+
+// Settings of the tiers and coordinators, the "decision_system" section of ai-engine.yaml and the coordinator
+// keys of its "server" section. Unlike ServerConfig these apply again whenever the file changes, from the
+// next decision on.
+struct DecisionSettings {
+    bool reflex_enabled = true;
+    bool rules_enabled = true;
+    bool ml_enabled = true;
+    bool llm_enabled = true;
+    int memo_ttl_ms = 500;      // how long a character's decision is given again for the same state, 0 for never
+    
+    // Time a decision may take when its request doesn't say, 0 for no deadline. Past reflex, a stage is only
+    // asked while at least its minimum budget is left; the ML tier then answers with a kept prediction.
+    double deadline_ms = 0;
+    int coordinators_min_budget_us = 0;
+    int rules_min_budget_us = 0;
+    int ml_min_budget_us = 2000;    // a prediction of the Python service takes a few milliseconds
+    int llm_min_budget_us = 0;      // LLM queries run in the background
+
+    std::vector<std::string> disabled_coordinators;  // names, as in the coordinator.* stage metrics
+    int coordinator_deadline_us = 5000;     // coordinators slower than this are left out of a decision
+    bool collect_all_coordinators = false;  // evaluate the lower priorities even when a higher one decided
+
+    // Reads the settings of a YAML config file, keeping the defaults of those it doesn't have. Throws
+    // std::runtime_error if the file can't be read or a value is invalid.
+    static DecisionSettings load(const std::string& path);
+};
+
+} // namespace openkore_ai
@@ -0,0 +1,66 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+
+// Binary record of the decide requests and their responses, for replaying real traffic offline.
+//
+// Records are MessagePack maps {"ts_us", "request", "status", "response"}, each preceded by its size as
+// a big endian uint32, in memory-mapped segment files of a fixed size named decisions-NNNNNN.trace.
+// A segment starts with SEGMENT_MAGIC and ends at a zero size or at the end of the file; segments of
+// a crashed engine are still readable up to their last complete record. A record which doesn't fit
+// starts the next segment, and only the newest max_segments are kept.
+class DecisionTrace {
+public:
+    static constexpr char SEGMENT_MAGIC[8] = {'O', 'K', 'A', 'I', 'T', 'R', 'C', '1'};
+
+    // Starts a new segment in the directory, numbered after the ones already there.
+    // Throws std::runtime_error if the directory or the segment can't be created.
+    DecisionTrace(const std::string& directory, size_t segment_size, size_t max_segments);
+    ~DecisionTrace();
+    DecisionTrace(const DecisionTrace&) = delete;
+    DecisionTrace& operator=(const DecisionTrace&) = delete;
+
+    // Appends a record, false if it was dropped because it is larger than a segment or no segment could be
+    // opened. Callers encode their record in parallel, only the copy into the segment is serialized.
+    bool record(const nlohmann::json& request, int status, const nlohmann::json& response);
+
+    uint64_t recorded() const { return recorded_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // Segment files of a directory, oldest first
+    static std::vector<std::filesystem::path> segments(const std::filesystem::path& directory);
+
+    // Calls visit with each record of a segment file and returns their number.
+    // Throws std::runtime_error if the file is not a segment or a record is corrupt.
+    static size_t read_segment(const std::filesystem::path& path, const std::function<void(nlohmann::json&)>& visit);
+
+private:
+    class Segment;
+
+    // Ends the current segment, if any, and opens the next one; the mutex must be held
+    bool next_segment();
+
+    std::filesystem::path directory_;
+    size_t segment_size_;
+    size_t max_segments_;
+
+    std::mutex mutex_;
+    std::unique_ptr<Segment> segment_;
+    size_t used_ = 0;
+    uint64_t sequence_ = 0;
+
+    std::atomic<uint64_t> recorded_{0};
+    std::atomic<uint64_t> dropped_{0};
+};
+
+} // namespace openkore_ai
@@ -0,0 +1,37 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace openkore_ai {
+
+// Calls 'changed' on a thread of its own whenever the modification time of a file changes, checking every
+// 'interval'. 'changed' handles its own errors; a file that can't be read counts as unchanged.
+class FileWatcher {
+public:
+    FileWatcher(std::string path, std::chrono::milliseconds interval, std::function<void()> changed);
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    const std::string& path() const { return path_; }
+
+private:
+    void run();
+
+    std::string path_;
+    std::chrono::milliseconds interval_;
+    std::function<void()> changed_;
+    std::filesystem::file_time_type seen_time_{};
+
+    std::mutex mutex_;
+    std::condition_variable stop_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace openkore_ai
@@ -0,0 +1,41 @@
+#pragma once
+#include "types.hpp"
+#include <nlohmann/json.hpp>
+#include <string_view>
+
+namespace openkore_ai {
+
+// Builds a game state from the "game_state" object of a decide request
+GameState parse_game_state(const nlohmann::json& j);
+
+// Same as parse_game_state, but overwrites an existing state in place. The strings and lists of the state
+// keep their capacity, so reusing one state for request after request stops allocating once it has grown
+// to the usual request size.
+void parse_game_state_into(const nlohmann::json& j, GameState& state);
+
+// Same as parse_game_state_into, from the JSON text of the "game_state" object, which simdjson's on-demand
+// parser reads in one pass without building a document. Returns false if it can't: the text is malformed, or
+// a field doesn't have the type the plugin sends (a number where a string is expected, a float for an int...).
+// The state is then only partly overwritten, and the caller parses the text with nlohmann::json instead, which
+// converts what it can and throws on the rest. The values of the fields it doesn't know aren't checked.
+// Always false when the engine is built without simdjson (OPENKORE_AI_SIMDJSON).
+bool parse_game_state_text(std::string_view text, GameState& state);
+
+// Reads a decide request in JSON with simdjson: 'fields' gets every field of the request object but
+// "game_state", whose text is left in the body for parse_game_state_text. Returns false if the body isn't
+// a JSON object, or without simdjson; the caller then decodes the whole body with nlohmann::json.
+bool split_decide_request(std::string_view body, nlohmann::json& fields, std::string_view& game_state);
+
+// Reads the name of the character from the text of a game state, for routing the request before it's parsed.
+// Returns false if it isn't there, if the text is malformed, or without simdjson.
+bool read_character_name(std::string_view game_state, std::string& name);
+
+// Patches a game state with the "delta" object of a decide request. Only the given fields change:
+// - "character": any fields of the character, "position" may hold only some of map, x and y,
+//   "status_effects" replaces the whole list
+// - "monsters", "inventory" and "nearby_players": "removed" lists the ids (names for players) to remove,
+//   "updated" holds partial entries which change the entries with the same id or name, and "added"
+//   holds full entries, which replace existing ones with the same id or name
+void apply_game_state_delta(GameState& state, const nlohmann::json& delta);
+
+} // namespace openkore_ai
@@ -0,0 +1,61 @@
+#pragma once
+#include <httplib.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openkore_ai {
+
+// Worker threads of the HTTP server, with a bounded queue of the connections waiting for them.
+// Connections beyond the queue depth are not served normally: they go to a single shedding thread, on which
+// shedding() is true, so the server can answer their requests with 503 at once instead of queueing them.
+// Connections are refused outright only when the shedding queue is full as well.
+//
+// A worker whose connection is going to wait long on something else can hand its place over to a new thread
+// (hand_off_worker()), so the other connections keep all the workers; it ends with that connection.
+class HttpTaskQueue : public httplib::TaskQueue {
+public:
+    // queue_depth 0 means no limit; workers are pinned to the CPUs round robin, if any are given
+    HttpTaskQueue(size_t threads, size_t queue_depth, const std::vector<int>& cpu_affinity);
+    ~HttpTaskQueue() override;
+
+    bool enqueue(std::function<void()> fn) override;
+    void shutdown() override;
+
+    // True on the thread which serves the connections over the queue depth
+    static bool shedding();
+
+    // Starts a worker in place of the calling one, which then serves its connection to the end and stops.
+    // Returns false, doing nothing, on threads which aren't workers of a queue or which handed off already.
+    static bool hand_off_worker();
+
+    // Connections shed or refused since the start, over all queues
+    static uint64_t shed_count();
+
+    // Connections waiting for a worker now, over all queues, not counting the shed ones
+    static size_t waiting();
+
+private:
+    void worker_loop(std::deque<std::function<void()>>& queue, int cpu);
+    // Joins the workers which handed off and stopped since the last call, under mutex_
+    void join_finished();
+
+    size_t queue_depth_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::function<void()>> queue_;
+    std::deque<std::function<void()>> shed_queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+    std::vector<std::thread::id> finished_;
+};
+
+// Pins the calling thread to one CPU, returns false where that is not supported
+bool pin_current_thread(int cpu);
+
+} // namespace openkore_ai
@@ -0,0 +1,60 @@
+#pragma once
+#include "types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace openkore_ai {
+
+// What the coordinators use an item for
+enum class ItemCategory : uint8_t { HP_RECOVERY, SP_RECOVERY, CURE, LOOT, OTHER };
+inline constexpr size_t ITEM_CATEGORIES = 5;
+
+struct ItemInfo {
+    int id = 0;
+    std::string name;
+    ItemCategory category = ItemCategory::OTHER;
+    int heal_hp = 0;    // average HP restored
+    int heal_sp = 0;    // average SP restored
+
+    // What the item restores for its category, the HP or the SP, 0 for the others
+    int potency() const {
+        return category == ItemCategory::HP_RECOVERY ? heal_hp : category == ItemCategory::SP_RECOVERY ? heal_sp : 0;
+    }
+};
+
+// Items by ID: the consumables and loot the coordinators pick from, with their categories and heal values,
+// and the names of the others from a table of the server, the "<id>#<name>#" lines of tables/<server>/items.txt.
+// Categories go by ID, so they hold for any names the server gives the items. Loaded at startup, read only
+// afterwards.
+class ItemDatabase {
+public:
+    // Only the items known to the engine
+    ItemDatabase();
+
+    // The database the state summaries use
+    static ItemDatabase& shared();
+
+    // Adds the names of an items.txt table, those of known items take the table's name. Returns the number of
+    // items read, 0 if the file can't be read.
+    size_t load_names(const std::string& path);
+
+    // nullptr for unknown items
+    const ItemInfo* find(int id) const;
+    const ItemInfo* find(std::string_view name) const;
+
+    // The item of an inventory entry, found by its ID, or by its name when the ID isn't a number
+    const ItemInfo* find(const Item& item) const;
+
+    size_t size() const { return items_.size(); }
+
+private:
+    void add(int id, std::string name);
+
+    std::unordered_map<int, ItemInfo> items_;
+    std::unordered_map<std::string_view, const ItemInfo*> by_name_;  // views of the names in items_
+};
+
+} // namespace openkore_ai
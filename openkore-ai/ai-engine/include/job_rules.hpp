@@ -0,0 +1,89 @@
+#pragma once
+#include "file_watcher.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace openkore_ai {
+
+// Tuning of the rules tier and the coordinators for a job, the keys of a job's section in job_rules.yaml
+struct JobRules {
+    float heal_below = 0.60f;       // RulesTier heals under this HP ratio...
+    float heal_above = 0.25f;       // ...and above this one, lower is the reflex tier's
+    float attack_min_hp = 0.40f;    // RulesTier doesn't attack under this HP ratio
+    float skill_min_sp = 0.30f;     // skills are used from this SP ratio up
+    std::string attack_skill;       // single target skill, basic attacks without one
+    std::string primary_stat = "STR";
+    std::string secondary_stat = "VIT";
+    std::string learn_skill;        // skill to put points in, none for no recommendation
+    bool first_job = false;         // changes job at level 50
+};
+
+// Index of a job in a JobRuleTable, 0 for the "default" rules of the jobs without a section
+using JobId = uint16_t;
+
+// The rules of all jobs compiled into a table indexed by job ID. The "default" section applies to every
+// job; the section of a job only sets some keys over it. Immutable once compiled.
+class JobRuleTable {
+public:
+    // Compiles a job_rules.yaml, 'name' for the errors. Throws std::runtime_error for invalid values and
+    // unknown keys.
+    static std::shared_ptr<const JobRuleTable> compile(std::istream& in, const std::string& name);
+
+    // The rules the engine has without a job_rules.yaml, those of config/job_rules.yaml
+    static std::shared_ptr<const JobRuleTable> builtin();
+
+    JobId id_of(std::string_view job) const;
+    const JobRules& operator[](JobId id) const { return rules_[id]; }
+    const JobRules& rules_for(std::string_view job) const { return rules_[id_of(job)]; }
+
+    size_t jobs() const { return rules_.size() - 1; }
+
+private:
+    std::vector<JobRules> rules_;                       // by JobId
+    std::vector<std::string> names_;                    // by JobId, "default" first
+    std::unordered_map<std::string_view, JobId> ids_;   // views of names_
+};
+
+// The job rules in use, compiled from a file and compiled again when it changes. Requests hold on to the
+// table they started with, so a reload only applies to the requests after it.
+class JobRuleBook {
+public:
+    // The book the state summaries use, with the built-in rules until load()
+    static JobRuleBook& shared();
+
+    JobRuleBook();
+    ~JobRuleBook();
+    JobRuleBook(const JobRuleBook&) = delete;
+    JobRuleBook& operator=(const JobRuleBook&) = delete;
+
+    std::shared_ptr<const JobRuleTable> current() const { return table_.load(); }
+
+    // Compiles the file and uses it from now on, and for reload(). Throws std::runtime_error if it can't be
+    // read or is invalid, keeping the rules in use.
+    void load(const std::string& path);
+    // Compiles the file of load() again, throws as load() does
+    void reload();
+
+    // Reloads the file of load() whenever its modification time changes, checking every 'interval'; errors
+    // are logged and the rules in use kept
+    void watch(std::chrono::milliseconds interval);
+
+    size_t reloads() const { return reloads_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<std::shared_ptr<const JobRuleTable>> table_;
+    std::mutex mutex_;              // load() and reload()
+    std::string path_;
+    std::atomic<size_t> reloads_{0};
+    std::unique_ptr<FileWatcher> watcher_;
+};
+
+} // namespace openkore_ai
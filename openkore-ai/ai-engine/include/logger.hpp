@@ -5,7 +5,12 @@
 #undef ERROR
 #endif
 
+#include <atomic>
+#include <chrono>
+#include <concepts>
+#include <cstdint>
 #include <string>
+#include <sstream>
 #include <fstream>
 #include <mutex>
 
@@ -19,11 +24,22 @@ enum class LogLevel {
     ERROR_LEVEL = 3
 };
 
+class LogSite;
+
 class Logger {
 public:
     // Initialize logger with log directory and minimum level
     static void initialize(const std::string& log_dir = "logs", LogLevel min_level = LogLevel::INFO);
     
+    // Lowest level written from now on
+    static void set_level(LogLevel level);
+    
+    // Whether messages of the level are written, a single relaxed load
+    static bool enabled(LogLevel level) { return level >= min_level_.load(std::memory_order_relaxed); }
+    
+    // Level named "debug", "info", "warning" or "error"; throws std::invalid_argument for other names
+    static LogLevel parse_level(const std::string& name);
+    
     // Log messages at different levels
     static void debug(const std::string& message, const std::string& context = "");
     static void info(const std::string& message, const std::string& context = "");
@@ -36,21 +52,141 @@ public:
     static void log_response(const std::string& path, int status_code,
                             double latency_ms, const std::string& body = "");
     
-    // Cleanup
+    // Same, but the body is only produced, by calling 'body()', when debug logging is on
+    template <std::invocable BodyFn>
+    static void log_request(const std::string& method, const std::string& path, BodyFn&& body, size_t body_size) {
+        log_request(method, path, enabled(LogLevel::DEBUG) ? std::string(body()) : std::string(), body_size);
+    }
+    template <std::invocable BodyFn>
+    static void log_response(const std::string& path, int status_code, double latency_ms, BodyFn&& body) {
+        log_response(path, status_code, latency_ms, enabled(LogLevel::DEBUG) ? std::string(body()) : std::string());
+    }
+    
+    // Hands lines to a background writer from now on. Callers only format the line and put it in a
+    // lock-free ring of 'capacity' lines; the writer writes them in batches and flushes the file every
+    // 'flush_interval' and after each error. When the ring is full, lines below ERROR are dropped and
+    // counted, errors wait for room.
+    static void start_async(size_t capacity = 8192,
+                            std::chrono::milliseconds flush_interval = std::chrono::milliseconds(1000));
+    
+    // Lines dropped because the ring was full
+    static uint64_t dropped_count();
+    
+    // Limits of each call site of the OKAI_LOG_* macros from now on, see LogSite: 'lines_per_second' 0 for
+    // none, and whether a message the same as the site's previous one is only counted
+    static void set_site_limits(uint32_t lines_per_second, bool suppress_repeats);
+    
+    // Lines left out by the call sites, over the limit or repeated
+    static uint64_t suppressed_count() { return suppressed_total_.load(std::memory_order_relaxed); }
+    
+    // Writes out the lines still queued and stops the background writer, if any, then closes the file
     static void cleanup();
     
 private:
+    class AsyncWriter;
+    friend class LogSite;
+    
     static void log(LogLevel level, const std::string& message, const std::string& context = "");
+    static std::string format_line(LogLevel level, const std::string& message, const std::string& context);
     static void rotate_log_file();
     static std::string get_timestamp();
+    static void append_timestamp(std::string& out);
     static std::string level_to_string(LogLevel level);
+    // Appends the lines of the call sites' notices, by level, the way the background writer batches them
+    static void append_site_notices(std::string& out, std::string& err, std::string& file);
     
     static std::mutex log_mutex_;
     static std::ofstream log_file_;
     static std::string log_directory_;
     static std::string current_date_;
-    static LogLevel min_level_;
+    static std::chrono::system_clock::time_point next_rotation_;  // local midnight after current_date_
+    static std::atomic<LogLevel> min_level_;
+    static std::atomic<AsyncWriter*> async_writer_;
+    static std::atomic<uint32_t> site_rate_limit_;
+    static std::atomic<bool> suppress_repeats_;
+    static std::atomic<uint64_t> suppressed_total_;
+};
+
+// A call site of the OKAI_LOG_* macros, which keeps repetitive messages from swamping the log: it writes at
+// most Logger::set_site_limits() lines a second, and a message the same as its previous one is only counted.
+// The lines left out are reported as "N similar lines suppressed" and "last message repeated N times", by the
+// site's next line or within a second by the background writer. admit() is checked before the message is
+// formatted, so suppressed lines cost a few relaxed atomics. Sites are never destroyed, they're static.
+class LogSite {
+public:
+    LogSite(LogLevel level, std::string context);
+    LogSite(const LogSite&) = delete;
+    LogSite& operator=(const LogSite&) = delete;
+    
+    // Whether a line may be written now, else it is counted as suppressed
+    bool admit() {
+        uint32_t limit = Logger::site_rate_limit_.load(std::memory_order_relaxed);
+        if (limit == 0) {
+            return true;
+        }
+        int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+        int64_t window = window_.load(std::memory_order_relaxed);
+        if (window != second && window_.compare_exchange_strong(window, second, std::memory_order_relaxed)) {
+            lines_.store(0, std::memory_order_relaxed);
+        }
+        if (lines_.fetch_add(1, std::memory_order_relaxed) < limit) {
+            return true;
+        }
+        suppressed_.fetch_add(1, std::memory_order_relaxed);
+        Logger::suppressed_total_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    // Writes the formatted message, after the notice of the lines left out before it, unless it repeats the
+    // previous one
+    void write(const std::string& message);
+    
+private:
+    friend class Logger;
+    
+    // The notice of the lines left out since the last one, false if there were none
+    bool take_notice(std::string& notice);
+    
+    static std::atomic<LogSite*> sites_;  // all of them, the newest first
+    
+    LogLevel level_;
+    std::string context_;
+    LogSite* next_ = nullptr;
+    std::atomic<int64_t> window_{-1};     // second of the lines counted
+    std::atomic<uint32_t> lines_{0};
+    std::atomic<uint64_t> suppressed_{0};
+    std::atomic<uint64_t> repeats_{0};
+    std::atomic<uint64_t> last_hash_{0};  // of the previous message
 };
 
 } // namespace logging
 } // namespace openkore_ai
+
+// Logging with the message given as a stream expression, which is only evaluated when the level is on and
+// the call site within its limits (LogSite):
+//     OKAI_LOG_INFO("DECIDE", "Request " << request_id << " - Character: " << state.character.name);
+#define OKAI_LOG_AT(level, context, message)                                                       \
+    do {                                                                                           \
+        if (::openkore_ai::logging::Logger::enabled(::openkore_ai::logging::LogLevel::level)) {   \
+            static ::openkore_ai::logging::LogSite okai_log_site(                                  \
+                ::openkore_ai::logging::LogLevel::level, context);                                 \
+            if (okai_log_site.admit()) {                                                           \
+                std::ostringstream okai_log_line;                                                  \
+                okai_log_line << message;                                                          \
+                okai_log_site.write(okai_log_line.str());                                          \
+            }                                                                                      \
+        }                                                                                          \
+    } while (0)
+#define OKAI_LOG_DEBUG(context, message) OKAI_LOG_AT(DEBUG, context, message)
+#define OKAI_LOG_INFO(context, message) OKAI_LOG_AT(INFO, context, message)
+#define OKAI_LOG_WARNING(context, message) OKAI_LOG_AT(WARNING, context, message)
+#define OKAI_LOG_ERROR(context, message) OKAI_LOG_AT(ERROR_LEVEL, context, message)
+
+// Debug trace of the decision hot path, like OKAI_LOG_DEBUG; builds with OPENKORE_AI_NO_TRACE leave the
+// traces out entirely.
+#ifdef OPENKORE_AI_NO_TRACE
+#define OKAI_TRACE(context, message) do { } while (0)
+#else
+#define OKAI_TRACE(context, message) OKAI_LOG_DEBUG(context, message)
+#endif
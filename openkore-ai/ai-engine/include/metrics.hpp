@@ -0,0 +1,163 @@
+#pragma once
+#include "alloc_stats.hpp"
+#include "types.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+namespace metrics {
+
+// Latency histogram with log-linear buckets, like HdrHistogram: values below 2^SUB_BUCKET_BITS
+// have a bucket each, every higher power of two is split in 2^SUB_BUCKET_BITS buckets.
+// Recorded values are at most 1/16 (6.25%) off. Recording is a few relaxed atomic adds, no locks.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 36;  // 2^36 us is about 19 hours, larger values go in the last bucket
+    static constexpr int BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    // Plain copy of a histogram, several of them can be added together
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;
+        uint64_t max = 0;
+        std::array<uint64_t, BUCKET_COUNT> buckets{};
+
+        void add(const Snapshot& other);
+        double mean() const;
+        // Upper bound of the bucket holding the value at quantile q (0..1), 0 if empty
+        uint64_t percentile(double q) const;
+        // Number of values in the buckets which end at or below 'value'
+        uint64_t count_at_most(uint64_t value) const;
+    };
+
+    void record(uint64_t value);
+    void add_to(Snapshot& snapshot) const;
+
+    static int bucket_index(uint64_t value);
+    static uint64_t bucket_upper_bound(int index);
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets_{};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// Decision counts and latencies per tier. Worker threads write to their own shard,
+// so concurrent requests never wait on each other; readers add the shards up when asked.
+class DecisionMetrics {
+public:
+    static constexpr size_t TIER_COUNT = 4;
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Snapshot {
+        std::array<uint64_t, TIER_COUNT> counts{};
+        uint64_t unhandled = 0;
+        std::array<LatencyHistogram::Snapshot, TIER_COUNT> latency_us;
+        LatencyHistogram::Snapshot total_latency_us;
+
+        uint64_t total() const;
+    };
+
+    // Records a decision made by 'tier', or by no tier at all if 'handled' is false
+    void record(DecisionTier tier, bool handled, uint64_t latency_us);
+    Snapshot snapshot() const;
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, TIER_COUNT> counts{};
+        std::atomic<uint64_t> unhandled{0};
+        std::array<LatencyHistogram, TIER_COUNT> latency_us;
+    };
+
+    Shard& shard_for_thread();
+
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::atomic<size_t> next_shard_{0};
+};
+
+// Latency histograms of named stages of a request, like "request.parse" or "rules.decide".
+// Stages are registered once and then recorded by id; like DecisionMetrics, every thread records
+// into its own shard. A shard only allocates the histograms of the stages recorded through it.
+// Builds which count allocations (alloc_stats::ENABLED) also keep a histogram of the allocations per pass
+// through each stage.
+class StageMetrics {
+public:
+    static constexpr size_t MAX_STAGES = 64;
+    static constexpr size_t SHARD_COUNT = 16;
+
+    StageMetrics() = default;
+    StageMetrics(const StageMetrics&) = delete;
+    StageMetrics& operator=(const StageMetrics&) = delete;
+    ~StageMetrics();
+
+    // Id of a stage, registering it on first use. Past MAX_STAGES all new names share the last id.
+    size_t stage(const std::string& name);
+    void record(size_t stage, uint64_t latency_us);
+    void record_allocations(size_t stage, uint64_t allocations);
+    // Stage names with their histograms, in registration order
+    std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> snapshot() const;
+    // The same for the allocations, only of the stages which recorded some
+    std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> allocation_snapshot() const;
+
+private:
+    using Histograms = std::array<std::atomic<LatencyHistogram*>, MAX_STAGES>;
+
+    struct alignas(64) Shard {
+        Histograms stages{};
+        Histograms allocations{};
+    };
+
+    // The histogram of a stage in the calling thread's shard, created on first use
+    LatencyHistogram& histogram(Histograms Shard::*histograms, size_t stage);
+    std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> snapshot(Histograms Shard::*histograms) const;
+
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::atomic<size_t> next_shard_{0};
+    mutable std::mutex names_mutex_;
+    std::vector<std::string> names_;
+    std::map<std::string, size_t> ids_;
+};
+
+// The stage metrics of the engine
+StageMetrics& stages();
+
+// Records the time between its construction and destruction as a stage of the engine's stage metrics,
+// and the allocations of the thread meanwhile when they are counted
+class StageTimer {
+public:
+    explicit StageTimer(size_t stage)
+        : stage_(stage), allocations_(alloc_stats::ENABLED ? alloc_stats::thread_counts().allocations : 0),
+          start_(std::chrono::steady_clock::now()) {}
+    ~StageTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - start_;
+        stages().record(stage_, std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+        if constexpr (alloc_stats::ENABLED) {
+            stages().record_allocations(stage_, alloc_stats::thread_counts().allocations - allocations_);
+        }
+    }
+    StageTimer(const StageTimer&) = delete;
+    StageTimer& operator=(const StageTimer&) = delete;
+
+private:
+    size_t stage_;
+    uint64_t allocations_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Both kinds of metrics in the Prometheus text exposition format, 'tier_names' labels the tiers
+std::string prometheus_text(const DecisionMetrics::Snapshot& decisions,
+                            const std::array<std::string, DecisionMetrics::TIER_COUNT>& tier_names,
+                            const std::vector<std::pair<std::string, LatencyHistogram::Snapshot>>& stages);
+
+} // namespace metrics
+} // namespace openkore_ai
@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace openkore_ai {
+
+// Gathers the rows of concurrent callers into batches for a model or service which is cheaper per row in
+// bulk. A dispatcher thread runs a batch once 'max_batch' rows wait or the first of them has waited
+// 'max_delay', and hands each caller the result of its row. Rows arriving while a batch runs make up the
+// next one, so batches grow with the load and a row waits at most 'max_delay' plus one batch. Thread safe.
+template <typename Row, typename Result>
+class MicroBatcher {
+public:
+    // Runs a batch: fills results[i], already sized, with the result of rows[i], left empty on failure
+    using RunBatch = std::function<void(std::span<const Row> rows, std::vector<std::optional<Result>>& results)>;
+
+    MicroBatcher(RunBatch run, size_t max_batch, std::chrono::microseconds max_delay)
+        : run_(std::move(run)), max_batch_(max_batch ? max_batch : 1), max_delay_(max_delay),
+          dispatcher_([this] { dispatch(); }) {}
+
+    MicroBatcher(const MicroBatcher&) = delete;
+    MicroBatcher& operator=(const MicroBatcher&) = delete;
+
+    // Runs the rows still waiting, then stops the dispatcher
+    ~MicroBatcher() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        queued_.notify_one();
+        dispatcher_.join();
+    }
+
+    // The result of 'row', once its batch has run. Rethrows what the batch threw.
+    std::optional<Result> run(Row row) {
+        std::future<std::optional<Result>> result;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (rows_.empty()) {
+                oldest_ = std::chrono::steady_clock::now();
+            }
+            rows_.push_back(std::move(row));
+            waiting_.emplace_back();
+            result = waiting_.back().get_future();
+        }
+        queued_.notify_one();
+        return result.get();
+    }
+
+    // Batches run and rows in them since the start
+    size_t batches() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return batches_;
+    }
+
+    size_t rows() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return rows_total_;
+    }
+
+private:
+    void dispatch() {
+        std::vector<Row> rows;
+        std::vector<std::promise<std::optional<Result>>> waiting;
+        std::vector<std::optional<Result>> results;
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            queued_.wait(lock, [this] { return stopping_ || !rows_.empty(); });
+            if (rows_.empty()) {
+                return;
+            }
+            queued_.wait_until(lock, oldest_ + max_delay_,
+                               [this] { return stopping_ || rows_.size() >= max_batch_; });
+            size_t count = std::min(rows_.size(), max_batch_);
+            rows.assign(std::make_move_iterator(rows_.begin()), std::make_move_iterator(rows_.begin() + count));
+            waiting.assign(std::make_move_iterator(waiting_.begin()),
+                           std::make_move_iterator(waiting_.begin() + count));
+            rows_.erase(rows_.begin(), rows_.begin() + count);
+            waiting_.erase(waiting_.begin(), waiting_.begin() + count);
+            batches_++;
+            rows_total_ += count;
+            lock.unlock();
+
+            results.assign(count, std::nullopt);
+            std::exception_ptr failure;
+            try {
+                run_(std::span<const Row>(rows.data(), rows.size()), results);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+            for (size_t i = 0; i < count; i++) {
+                if (failure) {
+                    waiting[i].set_exception(failure);
+                } else {
+                    waiting[i].set_value(std::move(results[i]));
+                }
+            }
+            rows.clear();
+            waiting.clear();
+            lock.lock();
+        }
+    }
+
+    RunBatch run_;
+    size_t max_batch_;
+    std::chrono::microseconds max_delay_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable queued_;
+    std::vector<Row> rows_;
+    std::vector<std::promise<std::optional<Result>>> waiting_;
+    std::chrono::steady_clock::time_point oldest_;
+    size_t batches_ = 0;
+    size_t rows_total_ = 0;
+    bool stopping_ = false;
+
+    std::thread dispatcher_;  // last, started once the rest is initialized
+};
+
+} // namespace openkore_ai
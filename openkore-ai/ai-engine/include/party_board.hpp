@@ -0,0 +1,41 @@
+#pragma once
+#include "types.hpp"
+#include "character_states.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace openkore_ai {
+
+// What the bots of one party on one map share between their decisions: the monster they focus on, so that
+// they fight the same one instead of each its own nearest. The first member with a target makes it the
+// party's focus; the others take it over their own while it is within their MonsterSummary::TARGET_RANGE.
+// The focus moves on once the member who chose it no longer sees it, killed or lost, or when no member has
+// seen it for FOCUS_TTL. Kept by party (GameState::party_id) and map in the shards of CharacterStates,
+// parties not seen for a minute are forgotten. Thread safe.
+class PartyBoard {
+public:
+    static constexpr std::chrono::milliseconds FOCUS_TTL{1500};
+
+    // The character's target given the party's focus: the focus itself if the character has it in range,
+    // else 'own', which becomes the focus if there is none. 'own' for characters out of a party.
+    const Monster* focus(const GameState& state, const Monster* own,
+                         std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Parties known, and decisions which took the party's focus over their own target
+    size_t parties() const { return parties_.size(); }
+    uint64_t shared_count() const { return shared_.load(std::memory_order_relaxed); }
+
+private:
+    struct Party {
+        std::string focus_id;       // empty for no focus
+        std::string chosen_by;      // the member who made it the focus
+        std::chrono::steady_clock::time_point seen;  // when a member last had it in range
+    };
+
+    CharacterStates<Party> parties_{std::chrono::seconds(60)};
+    std::atomic<uint64_t> shared_{0};
+};
+
+} // namespace openkore_ai
@@ -0,0 +1,109 @@
+#pragma once
+#include "../types.hpp"
+#include "../character_states.hpp"
+#include <nlohmann/json.hpp>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+namespace pdca {
+
+// Outcomes of the engine's decisions, aggregated in the engine for the Check phase of the Python service's
+// PDCA loop, which then gets compact summaries instead of every decision.
+//
+// A decision's outcome is told by the character's next state: the HP it lost and the base exp it gained
+// meanwhile, and whether it died. It went well if the character is alive and lost at most FAILURE_HP_SHARE
+// of its max HP. Outcomes are counted by the source of the decision (a tier or a coordinator, numbered by
+// the caller) and the kind of its action, in counters sharded like metrics::DecisionMetrics: recording is a
+// few relaxed atomic adds, only the character's last decision is kept under a lock.
+class OutcomeBook {
+public:
+    static constexpr size_t MAX_SOURCES = 64;   // higher sources share the last one
+    static constexpr size_t KIND_COUNT = static_cast<size_t>(ActionKind::OTHER) + 1;
+    static constexpr size_t SHARD_COUNT = 16;
+    static constexpr float FAILURE_HP_SHARE = 0.25f;
+    // A state coming later than this after a decision isn't its outcome anymore
+    static constexpr std::chrono::milliseconds MAX_GAP{30000};
+    // HP lost as a share of the max HP: none, below 5%, 10%, 25% and 50%, and more
+    static constexpr size_t HP_LOSS_BUCKETS = 6;
+
+    struct Aggregate {
+        uint64_t outcomes = 0;
+        uint64_t successes = 0;
+        uint64_t deaths = 0;
+        uint64_t hp_lost = 0;
+        uint64_t exp_gained = 0;
+        uint64_t duration_ms = 0;   // from the decisions to their outcomes
+        std::array<uint64_t, HP_LOSS_BUCKETS> hp_loss{};
+    };
+
+    struct Entry {
+        uint16_t source;
+        ActionKind kind;
+        Aggregate aggregate;
+    };
+
+    OutcomeBook() = default;
+    OutcomeBook(const OutcomeBook&) = delete;
+    OutcomeBook& operator=(const OutcomeBook&) = delete;
+    ~OutcomeBook();
+
+    // Records the decision made on 'state' at 'now', and the outcome of the character's previous one
+    void record(const GameState& state, uint16_t source, ActionKind kind, std::chrono::steady_clock::time_point now);
+
+    // The outcomes since the last call, by source and kind. A record made meanwhile may be split over two calls.
+    std::vector<Entry> take();
+
+    // Outcomes recorded since the start
+    uint64_t outcomes() const { return outcomes_.load(std::memory_order_relaxed); }
+
+    static size_t hp_loss_bucket(int hp_lost, int max_hp);
+
+private:
+    // What is kept of a character's last decision
+    struct Pending {
+        int64_t time_ms = -1;       // none yet
+        uint16_t source = 0;
+        ActionKind kind = ActionKind::NONE;
+        int32_t hp = 0;
+        int32_t max_hp = 0;
+        int32_t level = 0;
+        int32_t base_exp = 0;
+    };
+
+    struct Cell {
+        std::atomic<uint64_t> outcomes{0};
+        std::atomic<uint64_t> successes{0};
+        std::atomic<uint64_t> deaths{0};
+        std::atomic<uint64_t> hp_lost{0};
+        std::atomic<uint64_t> exp_gained{0};
+        std::atomic<uint64_t> duration_ms{0};
+        std::array<std::atomic<uint64_t>, HP_LOSS_BUCKETS> hp_loss{};
+    };
+
+    using Row = std::array<Cell, KIND_COUNT>;
+
+    struct alignas(64) Shard {
+        std::array<std::atomic<Row*>, MAX_SOURCES> rows{};
+    };
+
+    // The cell of the calling thread's shard, its row created on first use
+    Cell& cell(uint16_t source, ActionKind kind);
+
+    CharacterStates<Pending> pending_;
+    std::array<Shard, SHARD_COUNT> shards_;
+    std::atomic<size_t> next_shard_{0};
+    std::atomic<uint64_t> outcomes_{0};
+};
+
+// The summary of taken outcomes sent to the Python service: "window_s" and "outcomes", each with "source"
+// (named by 'source_names', "source.<n>" past them) and "action", the counts, sums and a few ratios
+nlohmann::json summary_json(const std::vector<OutcomeBook::Entry>& entries,
+                            const std::vector<std::string>& source_names, double window_s);
+
+} // namespace pdca
+} // namespace openkore_ai
@@ -0,0 +1,50 @@
+#pragma once
+#include "outcome_book.hpp"
+#include "../service_client.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace openkore_ai {
+namespace pdca {
+
+// Sends the outcomes of a book to the Python service every 'interval', on a thread of its own, as a
+// summary_json() posted to /api/v1/pdca/outcomes. Windows without outcomes aren't sent; the summary of a
+// window the service doesn't take is dropped, the counts are only kept until the next window.
+class OutcomeReporter {
+public:
+    // 'source_names' names the sources of the book when a summary is made
+    OutcomeReporter(OutcomeBook& book, std::shared_ptr<ServiceClientPool> service, std::chrono::seconds interval,
+                    std::function<std::vector<std::string>()> source_names);
+    ~OutcomeReporter();
+    OutcomeReporter(const OutcomeReporter&) = delete;
+    OutcomeReporter& operator=(const OutcomeReporter&) = delete;
+
+    uint64_t sent() const { return sent_.load(std::memory_order_relaxed); }
+    uint64_t failed() const { return failed_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    void report(double window_s);
+
+    OutcomeBook& book_;
+    std::shared_ptr<ServiceClientPool> service_;
+    std::chrono::seconds interval_;
+    std::function<std::vector<std::string>()> source_names_;
+    std::atomic<uint64_t> sent_{0};
+    std::atomic<uint64_t> failed_{0};
+
+    std::mutex mutex_;
+    std::condition_variable stop_;
+    bool stopping_ = false;
+    std::thread thread_;
+};
+
+} // namespace pdca
+} // namespace openkore_ai
@@ -0,0 +1,92 @@
+#pragma once
+#include "logger.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+
+// Concurrency and connection settings of the engine's servers, the "server" section of ai-engine.yaml,
+// the connections to the Python service of its "python_service" section, the in-process model of its "ml"
+// section, the item table of its "items" section, the job rules of its "rules" section, the logger settings
+// of its "logging" section, the decision trace settings of its "trace" section, the outcome summaries of
+// its "pdca" section and the warm restarts of its "snapshot" section. The settings which apply
+// again when the file changes are DecisionSettings.
+struct ServerConfig {
+    std::string host = "127.0.0.1";
+    int port = 9901;
+    int stream_port = 9903;         // 0 turns the stream transport off
+
+    size_t threads = 0;             // HTTP worker threads, 0 for one per core
+    size_t queue_depth = 1024;      // connections waiting for a worker before new ones get 503, 0 for no limit
+    size_t batch_threads = 0;       // threads for /api/v1/decide/batch, 0 for one per core but one
+    size_t character_threads = 0;   // threads deciding for fixed sets of characters, 0 to decide on the HTTP threads
+    int admission_reflex_delay_ms = 50;   // expected wait past which decisions are left to the reflex tier, 0 for never
+    int admission_reject_delay_ms = 200;  // expected wait past which non-critical decisions get 429, 0 for never
+
+    size_t keep_alive_max_count = 100;  // requests served on a connection before it is closed
+    int keep_alive_timeout_s = 5;       // idle time before a kept-alive connection is closed
+    int read_timeout_ms = 5000;
+    int write_timeout_ms = 5000;
+
+    std::vector<int> cpu_affinity;  // CPUs the worker threads are pinned to, round robin; empty for no pinning
+
+    bool parallel_coordinators = false;   // evaluate the coordinators on the batch threads
+    int config_reload_check_ms = 2000;    // how often the file is checked for DecisionSettings changes, 0 for never
+
+    std::string python_service_url = "http://127.0.0.1:9902";
+    size_t python_max_connections = 8;    // kept-alive connections shared by the tiers
+    int python_connect_timeout_ms = 5000; // also the longest wait for a free connection
+    int python_timeout_ms = 300000;       // LLM queries and strategic plans, ML predictions time out after 5s
+    size_t python_strategic_threads = 2;  // strategic plans fetched at once, see StrategicProxy
+
+    std::string ml_model_path = "../models/decision_model.onnx";  // used when built with OPENKORE_AI_ONNX
+    size_t ml_batch_size = 16;      // concurrent predictions run together, 1 runs each on its own
+    int ml_batch_delay_us = 200;    // longest wait for a batch to fill
+    bool ml_quantized = false;      // predict with the int8 model instead, if it passes its check
+    std::string ml_quantized_model_path = "../models/decision_model.int8.onnx";
+    std::string ml_quantized_check_states = "traces";  // recorded states both models are compared on
+    size_t ml_quantized_check_limit = 2000;
+    double ml_quantized_min_agreement = 0.98;  // share of the states the int8 model must get the same label for
+
+    std::string items_table = "../../tables/iRO/items.txt";  // names of the server's items, for ItemDatabase
+
+    std::string rules_file = "../../config/job_rules.yaml";  // per-job tuning, see JobRuleBook
+    int rules_reload_check_ms = 2000;   // how often the file is checked for changes, 0 for never
+
+    logging::LogLevel log_level = logging::LogLevel::INFO;  // "debug" turns on the decision traces
+    bool log_async = true;          // log through the background writer
+    size_t log_ring_size = 8192;    // lines the background writer can fall behind by before dropping some
+    uint32_t log_site_lines_per_s = 50;   // lines each call site of the OKAI_LOG_* macros writes a second, 0 for all
+    bool log_suppress_repeats = true;   // a message the same as its call site's previous one is only counted
+
+    bool trace_enabled = false;                  // record every decision for ai-engine-replay
+    std::string trace_directory = "traces";
+    size_t trace_segment_size = 64 << 20;        // bytes per segment file
+    size_t trace_max_segments = 16;              // older segments are deleted
+
+    bool pdca_enabled = true;           // aggregate the outcomes of the decisions, see pdca::OutcomeBook
+    int pdca_summary_interval_s = 60;   // how often they are sent to the Python service, 0 for never
+
+    size_t speculation_threads = 0;     // threads deciding ahead for the likely next states, see Speculator; 0 for none
+    int speculation_ttl_ms = 2000;      // how long a decision made ahead is given
+
+    bool world_enabled = true;          // share the monsters of a map between its bots, see WorldBoard
+    int world_ttl_ms = 2000;            // how long a bot's sightings are shared after its last state
+
+    bool snapshot_enabled = true;       // save the sessions on SIGTERM and restore them at startup, see SessionSnapshot
+    std::string snapshot_path = "ai-engine.snapshot";
+
+    // Fills in the settings found in the sections of a YAML config file, keeping the defaults of
+    // the others. Throws std::runtime_error if the file can't be read or a value is invalid.
+    static ServerConfig load(const std::string& path);
+
+    // Resolved thread counts, for the 0 defaults
+    size_t http_threads() const;
+    size_t batch_workers() const;
+};
+
+// Parses a list of CPUs such as "0-3,6" or "[0, 1, 2]"
+std::vector<int> parse_cpu_list(const std::string& text);
+
+} // namespace openkore_ai
@@ -0,0 +1,70 @@
+#pragma once
+#include <httplib.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+
+// Keep-alive connections to the Python AI service, shared by the tiers and handlers which call it.
+// An httplib::Client sends one request at a time, so each caller leases a client of its own and gives it
+// back afterwards with its connection still open for the next one. At most max_connections are open at
+// once; callers wait for a free one up to the connect timeout. Thread safe.
+class ServiceClientPool {
+public:
+    // A client leased from the pool, given back when the lease goes away
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept = default;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease();
+
+        explicit operator bool() const { return client_ != nullptr; }
+        httplib::Client* operator->() const { return client_.get(); }
+        httplib::Client& operator*() const { return *client_; }
+
+    private:
+        friend class ServiceClientPool;
+        Lease(ServiceClientPool* pool, std::unique_ptr<httplib::Client> client)
+            : pool_(pool), client_(std::move(client)) {}
+
+        ServiceClientPool* pool_ = nullptr;
+        std::unique_ptr<httplib::Client> client_;
+    };
+
+    // url is like "http://127.0.0.1:9902". Throws std::invalid_argument if httplib can't use it.
+    ServiceClientPool(std::string url, size_t max_connections = 8,
+                      std::chrono::milliseconds connect_timeout = std::chrono::milliseconds(5000));
+    ServiceClientPool(const ServiceClientPool&) = delete;
+    ServiceClientPool& operator=(const ServiceClientPool&) = delete;
+
+    // A client whose requests time out after 'read_timeout', or an empty lease if all connections stayed
+    // busy for the connect timeout
+    Lease acquire(std::chrono::milliseconds read_timeout);
+
+    const std::string& url() const { return url_; }
+
+    // Clients created since the start, the others were reused
+    size_t connections_opened() const;
+
+private:
+    std::unique_ptr<httplib::Client> make_client() const;
+    void release(std::unique_ptr<httplib::Client> client);
+
+    std::string url_;
+    size_t max_connections_;
+    std::chrono::milliseconds connect_timeout_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable released_;
+    std::vector<std::unique_ptr<httplib::Client>> idle_;
+    size_t open_ = 0;
+    size_t opened_total_ = 0;
+};
+
+} // namespace openkore_ai
@@ -0,0 +1,140 @@
+#pragma once
+#include "types.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace openkore_ai {
+
+// Compact binary encoding of what the engine keeps about its bots between decisions, so that a restarted
+// engine carries on where the previous one stopped instead of learning every character again. Numbers are
+// little endian and fixed width, strings are their uint32 length and bytes, lists their uint32 count and
+// entries. Times are written as milliseconds before the snapshot was taken, and read back as the same time
+// before the snapshot at the reading engine's clock, moved back by how long the engine was down; so what
+// would have expired meanwhile expires on time.
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    void u8(uint8_t value) { data_.push_back(static_cast<char>(value)); }
+    void u16(uint16_t value);
+    void u32(uint32_t value);
+    void u64(uint64_t value);
+    void i32(int32_t value) { u32(static_cast<uint32_t>(value)); }
+    void i64(int64_t value) { u64(static_cast<uint64_t>(value)); }
+    void f32(float value);
+    void str(std::string_view value);
+
+    // A steady_clock time, or the milliseconds of one since the clock's epoch
+    void time(std::chrono::steady_clock::time_point value);
+    void time_ms(int64_t steady_ms);
+
+    void action(const Action& action);
+    void game_state(const GameState& state);
+
+    // Leaves room for a count which is only known once the entries are written, see set_count()
+    size_t count_placeholder();
+    void set_count(size_t offset, uint32_t count);
+
+    const std::string& data() const { return data_; }
+    // When the snapshot is taken, which the times are written before
+    std::chrono::steady_clock::time_point now() const {
+        return std::chrono::steady_clock::time_point(std::chrono::milliseconds(now_ms_));
+    }
+
+private:
+    int64_t now_ms_;
+    std::string data_;
+};
+
+// Reads what SnapshotWriter wrote, from memory it doesn't own. Throws std::runtime_error when the data is
+// cut off or invalid.
+class SnapshotReader {
+public:
+    // 'base_ms' is the steady_clock time, in milliseconds since its epoch, the written times are before
+    SnapshotReader(const char* data, size_t size, int64_t base_ms) : data_(data), size_(size), base_ms_(base_ms) {}
+
+    uint8_t u8();
+    uint16_t u16();
+    uint32_t u32();
+    uint64_t u64();
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    int64_t i64() { return static_cast<int64_t>(u64()); }
+    float f32();
+    std::string str();
+    // A count of entries, each of at least 'entry_size' bytes; checked against the data left
+    uint32_t count(size_t entry_size = 1);
+
+    std::chrono::steady_clock::time_point time();
+    int64_t time_ms();
+
+    Action action();
+    void game_state(GameState& state);
+
+    // The next 'size' bytes as a reader of their own, with the same times
+    SnapshotReader sub(size_t size);
+
+    bool done() const { return offset_ == size_; }
+    int64_t base_ms() const { return base_ms_; }
+    // All the bytes of the reader, read or not
+    std::string_view data() const { return {data_, size_}; }
+
+private:
+    const char* take(size_t size);
+
+    const char* data_;
+    size_t size_;
+    size_t offset_ = 0;
+    int64_t base_ms_;
+};
+
+// A snapshot file: SNAPSHOT_MAGIC, the system_clock time it was taken at in milliseconds, then sections,
+// each its uint32 tag, its uint32 size and a SnapshotWriter's data. Readers skip the sections they don't know.
+class SessionSnapshot {
+public:
+    static constexpr char SNAPSHOT_MAGIC[8] = {'O', 'K', 'A', 'I', 'S', 'N', 'P', '1'};
+
+    enum Section : uint32_t {
+        SESSIONS = 1,       // SessionStore
+        HISTORY = 2,        // StateHistory
+        COORDINATORS = 3    // CoordinatorManager
+    };
+
+    // Writes the sections to 'path' through a temporary file renamed over it, so a snapshot is never seen
+    // half written, and returns its size. Throws std::runtime_error if it can't be written.
+    static size_t write(const std::filesystem::path& path,
+                        const std::vector<std::pair<Section, const SnapshotWriter*>>& sections);
+
+    // Maps the snapshot at 'path' in memory. Throws std::runtime_error if it can't be read or isn't a snapshot.
+    explicit SessionSnapshot(const std::filesystem::path& path);
+    ~SessionSnapshot();
+    SessionSnapshot(const SessionSnapshot&) = delete;
+    SessionSnapshot& operator=(const SessionSnapshot&) = delete;
+
+    // The section with the tag, if the snapshot has one; valid while the snapshot is
+    std::optional<SnapshotReader> section(Section tag) const;
+
+    // How long ago the snapshot was taken, by the system clock
+    std::chrono::milliseconds age() const { return age_; }
+
+private:
+    void unmap();
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    std::chrono::milliseconds age_{0};
+    int64_t base_ms_ = 0;
+    std::vector<std::pair<Section, std::pair<size_t, size_t>>> sections_;  // offset and size of each
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
+
+} // namespace openkore_ai
@@ -0,0 +1,65 @@
+#pragma once
+#include "types.hpp"
+#include "session_snapshot.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace openkore_ai {
+
+// Last game state of each bot session, so clients can send only what changed since their previous request.
+// Each stored state has a version, which grows by one with every change; a delta names the version it was
+// made against, and is refused if the stored state is not at that version any more.
+// Sessions are spread over mutex-protected shards, so requests of different bots rarely wait on each other.
+class SessionStore {
+public:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    explicit SessionStore(std::chrono::seconds ttl = std::chrono::seconds(600), size_t max_sessions = 4096);
+
+    // Stores a full game state for the session and returns its new version
+    uint64_t put(const std::string& session_id, const GameState& state);
+
+    // Patches the stored state of the session in place, copies it to 'patched' and returns its new version.
+    // 'patched' is assigned to rather than rebuilt, so a reused state keeps its capacity.
+    // Returns nothing if the session is unknown, has expired, or is not at 'base_version' (when given).
+    // If the patch throws, the session is dropped, as its state may be half patched.
+    std::optional<uint64_t> update(const std::string& session_id, std::optional<uint64_t> base_version,
+                                   const std::function<void(GameState&)>& patch, GameState& patched);
+
+    size_t size() const;
+
+    // Writes the sessions with their versions, so that clients carry on sending deltas to a restarted engine
+    void save(SnapshotWriter& out) const;
+    // Adds the sessions saved, but those which have expired meanwhile, and returns their number. Throws
+    // std::runtime_error if the data is invalid, keeping the sessions read until then.
+    size_t restore(SnapshotReader& in);
+
+private:
+    struct Entry {
+        GameState state;
+        uint64_t version = 0;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    struct Shard {
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, Entry> entries;
+    };
+
+    Shard& shard_of(const std::string& session_id);
+    // Drops the expired sessions of a shard, and the least recently used ones past its share of max_sessions
+    void trim(Shard& shard, std::chrono::steady_clock::time_point now);
+
+    std::chrono::seconds ttl_;
+    size_t max_sessions_per_shard_;
+    std::array<Shard, SHARD_COUNT> shards_;
+};
+
+} // namespace openkore_ai
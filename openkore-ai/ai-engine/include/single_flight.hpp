@@ -0,0 +1,162 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+namespace openkore_ai {
+
+// 64-bit FNV-1a hash of the fields a query depends on, for keying SingleFlight
+class Fingerprint {
+public:
+    Fingerprint& add(std::string_view text) {
+        for (unsigned char c : text) {
+            mix(c);
+        }
+        mix(0xff);  // ends the text, so ("ab", "c") and ("a", "bc") differ
+        return *this;
+    }
+
+    Fingerprint& add(long long number) {
+        for (int i = 0; i < 8; i++) {
+            mix(static_cast<unsigned char>(number >> (i * 8)));
+        }
+        return *this;
+    }
+
+    // Adds 'value' / 'max' in 'steps' steps, so states that differ by less than a step have the same fingerprint
+    Fingerprint& add_ratio(long long value, long long max, int steps) {
+        return add(max > 0 ? value * steps / max : -1);
+    }
+
+    // Adds the fingerprint of each item, in no particular order: lists which only differ in their order get
+    // the same fingerprint
+    template <typename Items, typename AddItem>
+    Fingerprint& add_unordered(const Items& items, AddItem add_item) {
+        uint64_t sum = 0;
+        for (const auto& item : items) {
+            Fingerprint item_fingerprint;
+            add_item(item_fingerprint, item);
+            sum += item_fingerprint.value();
+        }
+        return add(static_cast<long long>(sum));
+    }
+
+    uint64_t value() const { return hash_; }
+
+private:
+    void mix(unsigned char byte) {
+        hash_ ^= byte;
+        hash_ *= 0x100000001b3ULL;
+    }
+
+    uint64_t hash_ = 0xcbf29ce484222325ULL;
+};
+
+// Shares the answers of a slow service between identical queries. Concurrent callers with the same key wait
+// for a single call, and its answer is reused for 'ttl' afterwards; empty answers, failures, are shared with
+// the callers already waiting but not kept. Thread safe.
+template <typename T>
+class SingleFlight {
+public:
+    SingleFlight(std::chrono::milliseconds ttl, size_t max_entries) : ttl_(ttl), max_entries_(max_entries) {}
+
+    // The answer for the key: a kept one, the one of the call in progress, or fetch() called on this thread
+    std::optional<T> get(uint64_t key, const std::function<std::optional<T>()>& fetch) {
+        auto now = std::chrono::steady_clock::now();
+        std::promise<std::optional<T>> promise;
+        std::shared_future<std::optional<T>> shared;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = entries_.find(key);
+            if (it != entries_.end() && (it->second.in_flight || now < it->second.expires)) {
+                shared = it->second.answer;
+            } else {
+                if (entries_.size() >= max_entries_) {
+                    trim(now);
+                }
+                Entry& entry = entries_[key];
+                entry.answer = promise.get_future().share();
+                entry.in_flight = true;
+            }
+        }
+        if (shared.valid()) {
+            return shared.get();
+        }
+
+        std::optional<T> answer;
+        try {
+            answer = fetch();
+        } catch (...) {
+            finish(key, false);
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        finish(key, answer.has_value());
+        promise.set_value(answer);
+        return answer;
+    }
+
+    // The kept answer for the key, without waiting for a call in progress or making one
+    std::optional<T> peek(uint64_t key) {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end() || it->second.in_flight || now >= it->second.expires) {
+            return std::nullopt;
+        }
+        return it->second.answer.get();
+    }
+
+private:
+    struct Entry {
+        std::shared_future<std::optional<T>> answer;
+        bool in_flight = false;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    // Keeps the answer of a finished call for the TTL, or forgets the call
+    void finish(uint64_t key, bool keep) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it == entries_.end()) {
+            return;
+        }
+        if (keep) {
+            it->second.in_flight = false;
+            it->second.expires = std::chrono::steady_clock::now() + ttl_;
+        } else {
+            entries_.erase(it);
+        }
+    }
+
+    // Drops the expired answers, and all kept ones if that is not enough; the mutex must be held
+    void trim(std::chrono::steady_clock::time_point now) {
+        for (bool all : {false, true}) {
+            for (auto it = entries_.begin(); it != entries_.end();) {
+                if (!it->second.in_flight && (all || now >= it->second.expires)) {
+                    it = entries_.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (entries_.size() < max_entries_) {
+                return;
+            }
+        }
+    }
+
+    std::chrono::milliseconds ttl_;
+    size_t max_entries_;
+    std::mutex mutex_;
+    std::unordered_map<uint64_t, Entry> entries_;
+};
+
+} // namespace openkore_ai
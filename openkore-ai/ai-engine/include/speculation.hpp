@@ -0,0 +1,84 @@
+#pragma once
+#include "types.hpp"
+#include "character_states.hpp"
+#include "decision_memo.hpp"
+#include "worker_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+
+// Decisions made ahead, on threads which would be idle otherwise, for the states a character is likely to send
+// next: its target gone after it attacked, or its HP one regeneration step higher. A request whose state is one
+// of them gets the decision made ahead, like a DecisionMemo one. The steps are the character's own, the last HP
+// rise and exp gain seen between its requests. Work only starts on a free thread and is never queued, so the
+// decisions made ahead don't hold up the others when the engine is busy.
+class Speculator {
+public:
+    static constexpr size_t MAX_SUCCESSORS = 2;
+
+    // How much a character's state changes at a regeneration tick and a kill, 0 until seen
+    struct Steps {
+        int hp = 0;
+        int base_exp = 0;
+        int job_exp = 0;
+    };
+
+    // Decides for a successor state, nullopt if its decision can't be made ahead
+    using Decide = std::function<std::optional<DecisionMemo::Decision>(const GameState& successor)>;
+
+    // Decisions made ahead are given for 'ttl' after they are made
+    Speculator(size_t threads, std::chrono::milliseconds ttl);
+    Speculator(const Speculator&) = delete;
+    Speculator& operator=(const Speculator&) = delete;
+
+    // Copies the decision made ahead for the state, if there is one which hasn't expired
+    bool find(const GameState& state, std::chrono::steady_clock::time_point now, DecisionMemo::Decision& decision);
+
+    // Learns the character's steps from the state, then decides ahead for the successors of the state and the
+    // action decided for it if a thread is free, replacing the character's previous ones
+    void speculate(const GameState& state, const Action& action, Decide decide);
+
+    // The likely next states after the action; those the steps don't tell yet are left out
+    static std::vector<GameState> successors(const GameState& state, const Action& action, const Steps& steps);
+
+    // Decisions made ahead, those given, and the states whose successors were left out for lack of a thread
+    uint64_t speculated() const { return speculated_.load(std::memory_order_relaxed); }
+    uint64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Guess {
+        GameState state;
+        std::chrono::steady_clock::time_point expires;
+        DecisionMemo::Decision decision;
+    };
+
+    struct Character {
+        bool seen = false;
+        int hp = 0;
+        int level = 0;
+        int base_exp = 0;
+        int job_exp = 0;
+        Steps steps;
+        uint64_t round = 0;         // of the successors being decided, older rounds' decisions are dropped
+        std::vector<Guess> guesses;
+    };
+
+    size_t threads_;
+    std::chrono::milliseconds ttl_;
+    CharacterStates<Character> characters_;
+    std::atomic<size_t> busy_{0};
+    std::atomic<uint64_t> speculated_{0};
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> dropped_{0};
+    // Last member, so its threads are joined before the rest goes away
+    WorkerPool pool_;
+};
+
+} // namespace openkore_ai
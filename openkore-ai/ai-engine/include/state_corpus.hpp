@@ -0,0 +1,19 @@
+#pragma once
+#include "types.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace openkore_ai {
+
+// Game states collected or recorded for offline runs. A corpus is JSON files holding a game state, a decide
+// request with a "game_state", or an array of them; JSON lines files (.jsonl) with one of those per line;
+// decision trace segments, of which the delta requests are left out; or directories of those, read in name
+// order.
+//
+// Adds the states at 'path' to 'states' until it holds 'limit' of them. Throws std::exception if a file
+// can't be read or parsed.
+void load_states(const std::filesystem::path& path, std::vector<GameState>& states, size_t limit = SIZE_MAX);
+
+} // namespace openkore_ai
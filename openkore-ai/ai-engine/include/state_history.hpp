@@ -0,0 +1,72 @@
+#pragma once
+#include "types.hpp"
+#include "character_states.hpp"
+#include "session_snapshot.hpp"
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace openkore_ai {
+
+// How the character's state has been changing over its last requests, from StateHistory. All zero without
+// a history, or before the character's second request.
+struct Trends {
+    size_t samples = 0;             // snapshots they come from, at most StateHistory::CAPACITY
+    int64_t span_ms = 0;            // from the oldest snapshot to now
+    float hp_per_s = 0.0f;          // HP change per second over the last RATE_WINDOW, negative when hit
+    float sp_per_s = 0.0f;
+    int64_t time_in_place_ms = 0;   // since the character last moved or changed map
+    float exp_per_hour = 0.0f;      // base exp gained over the span, level ups included
+    float kills_per_minute = 0.0f;  // snapshots where the base exp rose, per minute: roughly the monsters killed
+
+    // Seconds until the HP runs out at the current rate, a negative value if it isn't falling
+    float seconds_to_death(int hp) const { return hp_per_s < 0.0f ? hp / -hp_per_s : -1.0f; }
+};
+
+// Compact snapshots of each character's last states, kept by the engine so that tiers can tell how the
+// state changes without the client sending its history. A character's snapshots are a ring of CAPACITY,
+// taken at most every MIN_INTERVAL: requests in between replace the newest one. The trends are kept up to
+// date as snapshots come and go, without going over the ring.
+class StateHistory {
+public:
+    static constexpr size_t CAPACITY = 128;
+    static constexpr std::chrono::milliseconds MIN_INTERVAL{250};
+    static constexpr std::chrono::milliseconds RATE_WINDOW{5000};
+
+    // Adds the state as the character's snapshot at 'now' and returns its trends
+    Trends record(const GameState& state, std::chrono::steady_clock::time_point now);
+
+    size_t characters() const { return characters_.size(); }
+
+    // Writes the snapshots of each character, and adds those saved back, returning the number of characters;
+    // restore() throws std::runtime_error if the data is invalid
+    void save(SnapshotWriter& out) const;
+    size_t restore(SnapshotReader& in);
+
+private:
+    struct Snapshot {
+        int64_t time_ms;
+        int32_t hp;
+        int32_t sp;
+        int32_t exp_gained;     // base exp gained since the previous snapshot
+        int16_t x;
+        int16_t y;
+        uint32_t map;           // hash of the map name
+        int32_t base_exp;
+    };
+
+    struct History {
+        std::array<Snapshot, CAPACITY> ring;
+        uint64_t count = 0;         // snapshots taken, the newest is at count - 1, the oldest at least count - CAPACITY
+        uint64_t rate_start = 0;    // the oldest snapshot within RATE_WINDOW
+        int64_t moved_ms = 0;       // when the position last changed
+        int64_t exp_gained = 0;     // over the snapshots after the oldest
+        int32_t gains = 0;          // snapshots after the oldest with exp gained
+
+        Snapshot& at(uint64_t index) { return ring[index % CAPACITY]; }
+    };
+
+    CharacterStates<History> characters_;
+};
+
+} // namespace openkore_ai
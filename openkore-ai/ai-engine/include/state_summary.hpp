@@ -0,0 +1,162 @@
+#pragma once
+#include "types.hpp"
+#include "item_database.hpp"
+#include "job_rules.hpp"
+#include "state_history.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+namespace openkore_ai {
+
+class PartyBoard;
+
+// Status effects the tiers react to, as bits of StateSummary::statuses
+namespace status {
+inline constexpr uint32_t STUNNED = 1u << 0;
+inline constexpr uint32_t FROZEN = 1u << 1;
+inline constexpr uint32_t STONE_CURSE = 1u << 2;
+inline constexpr uint32_t SLEEP = 1u << 3;
+inline constexpr uint32_t BLIND = 1u << 4;
+inline constexpr uint32_t SILENCE = 1u << 5;
+
+// Those that need a cure right away, all of the above for now
+inline constexpr uint32_t DANGEROUS = STUNNED | FROZEN | STONE_CURSE | SLEEP | BLIND | SILENCE;
+
+struct Name {
+    std::string_view name;
+    uint32_t bit;
+};
+
+inline constexpr std::array<Name, 6> NAMES = {{
+    {"Stunned", STUNNED}, {"Frozen", FROZEN}, {"Stone Curse", STONE_CURSE}, {"Sleep", SLEEP},
+    {"Blind", BLIND}, {"Silence", SILENCE},
+}};
+
+// Bit of a status effect, 0 for those the tiers don't react to
+constexpr uint32_t bit_of(std::string_view name) {
+    for (const Name& status : NAMES) {
+        if (status.name == name) {
+            return status.bit;
+        }
+    }
+    return 0;
+}
+} // namespace status
+
+// Actors counted by their distance to the character, to tell how many are within any radius up to
+// MAX_RADIUS in constant time, however many there are
+class DistanceCounts {
+public:
+    static constexpr int MAX_RADIUS = 15;  // the client's sight, beyond it the summaries scan
+
+    void add(int distance, int count = 1) { counts_[std::clamp(distance, 0, MAX_RADIUS + 1)] += count; }
+    // Once all are added
+    void accumulate();
+
+    // Actors at most 'radius' cells away, for a radius up to MAX_RADIUS
+    int within(int radius) const { return radius < 0 ? 0 : counts_[std::min(radius, MAX_RADIUS)]; }
+
+private:
+    std::array<int, MAX_RADIUS + 2> counts_{};  // the last one counts those beyond MAX_RADIUS
+};
+
+// The monsters around the character, see StateSummary::monsters()
+struct MonsterSummary {
+    static constexpr int TARGET_RANGE = 15;
+
+    const Monster* nearest = nullptr;
+    // Within TARGET_RANGE, the nearest aggressive monster, or the nearest monster if the first one in
+    // range isn't aggressive and no aggressive one is nearer; the party's focus instead, with a PartyBoard
+    const Monster* target = nullptr;
+
+    // Monsters, and aggressive ones, at most 'radius' cells away
+    int within(int radius) const;
+    int aggressive_within(int radius) const;
+
+private:
+    friend struct StateSummary;
+    const std::vector<Monster>* monsters_ = nullptr;
+    DistanceCounts all_;
+    DistanceCounts aggressive_;
+};
+
+// The other players around the character, see StateSummary::players()
+struct PlayerSummary {
+    const Player* nearest = nullptr;  // the first of the nearest ones
+
+    // Players at most 'radius' cells away
+    int within(int radius) const;
+
+private:
+    friend struct StateSummary;
+    const std::vector<Player>* players_ = nullptr;
+    DistanceCounts all_;
+};
+
+// The character's inventory by item category, see StateSummary::inventory()
+struct InventorySummary {
+    // Amount of the items of a category held
+    int amount_of(ItemCategory category) const { return amounts_[static_cast<size_t>(category)]; }
+
+    // Of the items of a category held, the one restoring the least or the most (ItemInfo::potency),
+    // nullptr if there are none
+    const ItemInfo* weakest(ItemCategory category) const;
+    const ItemInfo* strongest(ItemCategory category) const;
+
+private:
+    friend struct StateSummary;
+    std::array<int, ITEM_CATEGORIES> amounts_{};
+    // Items of ItemDatabase held, by category then potency, and where each category starts
+    std::vector<const ItemInfo*> held_;
+    std::array<uint32_t, ITEM_CATEGORIES + 1> starts_{};
+};
+
+// What the tiers and coordinators ask of a game state, shared by all of them for a request. The character's
+// ratios and statuses are computed up front; the monster, player and inventory summaries and the job's rules
+// on first use, once, the summaries in one pass over their list, the inventory's with ItemDatabase::shared(). Ratios of a zero maximum are those of a safe state: full HP and SP, no weight.
+// Keeps a reference to the state, which must outlive it, and to the PartyBoard the target is shared on, if any.
+// Thread safe.
+struct StateSummary {
+    float hp_ratio = 1.0f;
+    float sp_ratio = 1.0f;
+    float weight_ratio = 0.0f;
+    uint32_t statuses = 0;          // status:: bits of the character's status effects
+    Trends trends;                  // of the character's last states, none without a StateHistory
+
+    static constexpr int ATTACK_RANGE = 5;  // cells within which an aggressive monster is attacking
+
+    explicit StateSummary(const GameState& state, const Trends& trends = {}, PartyBoard* party = nullptr);
+    StateSummary(const StateSummary&) = delete;
+    StateSummary& operator=(const StateSummary&) = delete;
+
+    const MonsterSummary& monsters() const;
+    const PlayerSummary& players() const;
+    const InventorySummary& inventory() const;
+
+    // The rules of the character's job, from the table JobRuleBook::shared() had on first use
+    const JobRules& job() const;
+
+private:
+    const GameState& state_;
+    PartyBoard* party_;
+    // Set, with release, once the summary below them is written; written under mutex_
+    mutable std::atomic<bool> monsters_ready_{false};
+    mutable std::atomic<bool> players_ready_{false};
+    mutable std::atomic<bool> inventory_ready_{false};
+    mutable std::atomic<bool> job_ready_{false};
+    mutable std::mutex mutex_;
+    mutable MonsterSummary monsters_;
+    mutable PlayerSummary players_;
+    mutable InventorySummary inventory_;
+    mutable std::shared_ptr<const JobRuleTable> job_rules_;
+    mutable const JobRules* job_ = nullptr;
+};
+
+} // namespace openkore_ai
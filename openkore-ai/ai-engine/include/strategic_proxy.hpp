@@ -0,0 +1,45 @@
+#pragma once
+#include "service_client.hpp"
+#include "worker_pool.hpp"
+#include <httplib.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace openkore_ai {
+
+// Passes POST /api/v1/strategic/plan through to the Python service, streaming the plan to the client as it
+// arrives instead of buffering it. Plans take up to the service timeout, so each one is fetched on a thread of
+// the proxy's own pool, at most 'threads' at once, while the HTTP worker serving the request hands its place
+// in the HTTP pool over (HttpTaskQueue::hand_off_worker) and forwards the chunks: tactical decisions keep
+// all the workers. Errors of the service are answered as before, with a "fallback_plan" of "tactical_only".
+class StrategicProxy {
+public:
+    StrategicProxy(std::shared_ptr<ServiceClientPool> service, size_t threads, std::chrono::milliseconds timeout);
+    StrategicProxy(const StrategicProxy&) = delete;
+    StrategicProxy& operator=(const StrategicProxy&) = delete;
+
+    void handle(const httplib::Request& req, httplib::Response& res);
+
+    // Plans being fetched now, and requests refused since the start for having 'threads' of them
+    size_t in_flight() const { return in_flight_.load(std::memory_order_relaxed); }
+    uint64_t refused() const { return refused_.load(std::memory_order_relaxed); }
+
+private:
+    struct Stream;
+
+    // Fetches the plan into the stream, on a thread of the pool
+    void fetch(const std::shared_ptr<Stream>& stream, const std::string& body);
+
+    std::shared_ptr<ServiceClientPool> service_;
+    size_t max_in_flight_;
+    std::chrono::milliseconds timeout_;
+    std::atomic<size_t> in_flight_{0};
+    std::atomic<uint64_t> refused_{0};
+    WorkerPool pool_;
+};
+
+} // namespace openkore_ai
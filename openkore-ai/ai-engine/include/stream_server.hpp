@@ -0,0 +1,61 @@
+#pragma once
+#include "wire_format.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace openkore_ai {
+
+// Long-lived TCP transport for decide requests, next to the HTTP server.
+//
+// Both directions are a stream of frames, all numbers big endian:
+//   request:  uint32 length, uint8 format, body              (length counts the format byte and the body)
+//   response: uint32 length, uint16 status, uint8 format, body (length counts status, format and body)
+// The format byte is a WireFormat (0 JSON, 1 MessagePack, 2 CBOR); responses use the format of their request
+// and have the status and body the HTTP endpoint would give. Clients may send several requests without
+// waiting, the responses of a connection come back in request order.
+class StreamServer {
+public:
+    struct Reply {
+        uint16_t status;
+        std::string body;
+    };
+    using Handler = std::function<Reply(const std::string& body, WireFormat format)>;
+
+    static constexpr uint32_t MAX_FRAME_SIZE = 16 * 1024 * 1024;
+
+    explicit StreamServer(Handler handler);
+    ~StreamServer();
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+
+    // Binds the port and starts accepting connections in the background, false if the port can't be bound
+    bool start(const std::string& host, int port);
+    void stop();
+
+private:
+#ifdef _WIN32
+    using socket_t = uintptr_t;
+#else
+    using socket_t = int;
+#endif
+
+    void accept_loop();
+    void serve(socket_t client);
+    void close_socket(socket_t socket);
+
+    Handler handler_;
+    socket_t listener_;
+    std::atomic<bool> running_{false};
+    std::thread accept_thread_;
+    std::mutex clients_mutex_;
+    std::condition_variable clients_done_;
+    std::vector<socket_t> clients_;
+};
+
+} // namespace openkore_ai
@@ -1,9 +1,11 @@
 #pragma once
+#include "action.hpp"
 #include <string>
 #include <vector>
 #include <map>
 #include <optional>
 #include <chrono>
+#include <cstdint>
 
 namespace openkore_ai {
 
@@ -37,6 +39,8 @@ struct Monster {
     int max_hp;
     int distance;
     bool is_aggressive;
+    int x = -1;             // on the character's map, -1 when the plugin doesn't send the position
+    int y = -1;
 };
 
 // Item data
@@ -63,17 +67,11 @@ struct GameState {
     std::vector<Item> inventory;
     std::vector<Player> nearby_players;
     std::map<std::string, std::string> party_members;
+    std::string party_id;   // the character's party, empty out of one
+    std::string server;     // the bot's server, to share the monsters of its map in a WorldBoard; empty not to
     long long timestamp_ms;
 };
 
-// Action to execute
-struct Action {
-    std::string type;  // "attack", "skill", "move", "item", "talk", "sit", "stand", "none"
-    std::map<std::string, std::string> parameters;
-    std::string reason;
-    float confidence;
-};
-
 // Decision tier enum
 enum class DecisionTier {
     REFLEX,   // <1ms - immediate reactions
@@ -94,7 +92,9 @@ struct DecisionResponse {
     Action action;
     DecisionTier tier_used;
     long long latency_ms;
+    long long latency_us;
     std::string request_id;
+    uint32_t skipped = 0;  // bits of the PipelineComponents left out to meet the deadline
 };
 
 // Health check response
@@ -0,0 +1,24 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <string>
+
+namespace openkore_ai {
+
+// Body encodings of the decide requests. Over HTTP, requests name theirs in Content-Type and responses
+// use the one asked for in Accept, or else the one of the request.
+enum class WireFormat {
+    JSON,
+    MSGPACK,
+    CBOR
+};
+
+WireFormat wire_format_of(const std::string& media_type, WireFormat fallback);
+const char* wire_content_type(WireFormat format);
+
+nlohmann::json decode_body(const std::string& body, WireFormat format);
+std::string encode_body(const nlohmann::json& j, WireFormat format);
+
+// Body as it is written to the log, binary bodies are only described
+std::string loggable_body(const std::string& body, WireFormat format);
+
+} // namespace openkore_ai
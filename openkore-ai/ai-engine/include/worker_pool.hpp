@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openkore_ai {
+
+// Fixed set of threads which share out the items of parallel_for calls.
+// The calling thread works on its own call too, so a call never waits behind others for a free worker,
+// and concurrent calls spread over the workers as those become free.
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Calls task(i) once for every i below count and returns when all calls are done. task must not throw.
+    void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+    // Runs the task on a worker without waiting for it, or right here if the pool has no threads
+    void submit(std::function<void()> task);
+
+    size_t size() const { return threads_.size(); }
+
+private:
+    struct Job {
+        const std::function<void(size_t)>* task;
+        std::function<void(size_t)> owned_task;  // the task of a submitted job
+        size_t count;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+
+    // Runs items of the job until none are left to claim
+    static void work_on(Job& job);
+    void worker_loop();
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::shared_ptr<Job>> jobs_;
+    bool stopping_ = false;
+    std::vector<std::thread> threads_;
+};
+
+} // namespace openkore_ai
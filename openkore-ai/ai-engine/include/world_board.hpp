@@ -0,0 +1,53 @@
+#pragma once
+#include "types.hpp"
+#include "character_states.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace openkore_ai {
+
+// The monsters the bots on one map of one server see, put together for all of them: each bot's state gets
+// those the others see within VIEW_RANGE of it, so that a bot knows of a monster coming its way before it is
+// on its own screen and the bots of a host track a map's monsters once between them. Only monsters sent with
+// their position are shared, by bots which send their server (GameState::server); the others' are taken as
+// not aggressive, they attack someone else. A bot's sightings are replaced by its next state and expire after
+// the ttl. Kept by server and map in the shards of CharacterStates, maps nobody was on for a minute are
+// forgotten. Thread safe.
+class WorldBoard {
+public:
+    static constexpr int VIEW_RANGE = 14;           // cells, about a client's screen
+    static constexpr size_t MAX_SIGHTINGS = 512;    // kept per map, the oldest go first
+
+    explicit WorldBoard(std::chrono::milliseconds ttl = std::chrono::milliseconds(2000)) : ttl_(ttl) {}
+    WorldBoard(const WorldBoard&) = delete;
+    WorldBoard& operator=(const WorldBoard&) = delete;
+
+    // Publishes the positioned monsters of the state as its character's sightings, then adds to the state
+    // those the others saw in range which it doesn't have, with their distance to the character. Returns how
+    // many were added; nothing is shared for a state without a server or map.
+    size_t share(GameState& state, std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    // Maps known, and monsters added to the states from the others' sightings
+    size_t maps() const { return maps_.size(); }
+    uint64_t shared_count() const { return shared_.load(std::memory_order_relaxed); }
+
+private:
+    struct Sighting {
+        Monster monster;
+        std::string seen_by;
+        std::chrono::steady_clock::time_point seen;
+    };
+
+    struct Map {
+        std::vector<Sighting> sightings;    // oldest first
+    };
+
+    std::chrono::milliseconds ttl_;
+    CharacterStates<Map> maps_{std::chrono::seconds(60)};
+    std::atomic<uint64_t> shared_{0};
+};
+
+} // namespace openkore_ai
@@ -0,0 +1,129 @@
+#include "../include/action.hpp"
+#include <array>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace openkore_ai {
+
+namespace {
+
+constexpr std::array<std::string_view, static_cast<size_t>(ActionKind::OTHER) + 1> kind_names = {
+    "none", "attack", "skill", "move", "item", "talk", "sit", "stand", "command", "drop",
+    "job_change", "add_stat", "add_skill", "npc_talk", "npc_menu", "npc_buy", "npc_close", ""
+};
+
+constexpr std::array<std::string_view, params::BUILTIN_COUNT> builtin_keys = {
+    "item", "skill", "target", "target_area", "x", "y", "direction", "command", "emergency", "amount",
+    "target_job", "stat", "points", "action", "option", "items"
+};
+
+// Most parameter names there may be, so services can't grow the table without bound
+constexpr size_t MAX_PARAM_KEYS = 4096;
+
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view text) const { return std::hash<std::string_view>{}(text); }
+};
+
+// Names of the keys past the built-in ones, their strings never move
+class KeyTable {
+public:
+    KeyTable() {
+        for (size_t i = 0; i < builtin_keys.size(); i++) {
+            keys_.emplace(std::string(builtin_keys[i]), static_cast<ParamKey>(i));
+        }
+    }
+
+    ParamKey intern(std::string_view name) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = keys_.find(name);
+            if (it != keys_.end()) {
+                return it->second;
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        auto it = keys_.find(name);
+        if (it != keys_.end()) {
+            return it->second;
+        }
+        if (keys_.size() >= MAX_PARAM_KEYS) {
+            throw std::length_error("too many action parameter names");
+        }
+        ParamKey key = static_cast<ParamKey>(keys_.size());
+        names_.emplace_back(name);
+        keys_.emplace(names_.back(), key);
+        return key;
+    }
+
+    std::string_view name(ParamKey key) {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        size_t index = key - params::BUILTIN_COUNT;
+        return index < names_.size() ? std::string_view(names_[index]) : std::string_view();
+    }
+
+private:
+    std::shared_mutex mutex_;
+    std::unordered_map<std::string, ParamKey, StringHash, std::equal_to<>> keys_;
+    std::deque<std::string> names_;
+};
+
+KeyTable& key_table() {
+    static KeyTable table;
+    return table;
+}
+
+} // namespace
+
+std::string_view action_kind_name(ActionKind kind) {
+    return kind_names[static_cast<size_t>(kind)];
+}
+
+ActionKind action_kind_of(std::string_view name) {
+    for (size_t i = 0; i < kind_names.size() - 1; i++) {
+        if (kind_names[i] == name) {
+            return static_cast<ActionKind>(i);
+        }
+    }
+    return ActionKind::OTHER;
+}
+
+ParamKey param_key(std::string_view name) {
+    for (size_t i = 0; i < builtin_keys.size(); i++) {
+        if (builtin_keys[i] == name) {
+            return static_cast<ParamKey>(i);
+        }
+    }
+    return key_table().intern(name);
+}
+
+std::string_view param_key_name(ParamKey key) {
+    if (key < params::BUILTIN_COUNT) {
+        return builtin_keys[key];
+    }
+    return key_table().name(key);
+}
+
+void ActionParams::set(ParamKey key, std::string value) {
+    for (Entry& entry : entries_) {
+        if (entry.first == key) {
+            entry.second = std::move(value);
+            return;
+        }
+    }
+    entries_.emplace_back(key, std::move(value));
+}
+
+const std::string* ActionParams::get(ParamKey key) const {
+    for (const Entry& entry : entries_) {
+        if (entry.first == key) {
+            return &entry.second;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,63 @@
+#include "../include/admission.hpp"
+#include <algorithm>
+
+namespace openkore_ai {
+
+AdmissionControl::Ticket::Ticket(AdmissionControl& control, Verdict verdict)
+    : control_(control), verdict_(verdict), start_(std::chrono::steady_clock::now()) {}
+
+AdmissionControl::Ticket::~Ticket() {
+    control_.finish(verdict_, std::chrono::steady_clock::now() - start_);
+}
+
+AdmissionControl::AdmissionControl(size_t workers, std::chrono::microseconds reflex_delay,
+                                   std::chrono::microseconds reject_delay)
+    : workers_(std::max<size_t>(workers, 1)),
+      reflex_delay_us_(static_cast<uint64_t>(reflex_delay.count())),
+      reject_delay_us_(static_cast<uint64_t>(reject_delay.count())) {}
+
+uint64_t AdmissionControl::expected_delay_us(size_t waiting) const {
+    uint64_t ahead = in_flight_.load(std::memory_order_relaxed) + waiting;
+    return ahead * service_time_us_.load(std::memory_order_relaxed) / workers_;
+}
+
+AdmissionControl::Ticket AdmissionControl::admit(bool critical, size_t waiting) {
+    waiting_.store(waiting, std::memory_order_relaxed);
+    uint64_t delay = expected_delay_us(waiting);
+    Verdict verdict = Verdict::ADMIT;
+    if (reject_delay_us_ > 0 && delay > reject_delay_us_ && !critical) {
+        verdict = Verdict::REJECT;
+        rejected_.fetch_add(1, std::memory_order_relaxed);
+    } else if (reflex_delay_us_ > 0 && delay > reflex_delay_us_) {
+        verdict = Verdict::REFLEX_ONLY;
+        reflex_only_.fetch_add(1, std::memory_order_relaxed);
+    }
+    in_flight_.fetch_add(1, std::memory_order_relaxed);
+    return Ticket(*this, verdict);
+}
+
+void AdmissionControl::finish(Verdict verdict, std::chrono::steady_clock::duration elapsed) {
+    in_flight_.fetch_sub(1, std::memory_order_relaxed);
+    if (verdict != Verdict::ADMIT) {
+        return;
+    }
+    // Only full decisions are measured, those shed would make the engine look faster than it is
+    auto sample = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    uint64_t average = service_time_us_.load(std::memory_order_relaxed);
+    uint64_t updated;
+    do {
+        updated = average == 0 ? std::max<uint64_t>(sample, 1)
+                               : average - (average >> SMOOTHING_SHIFT) + (sample >> SMOOTHING_SHIFT);
+    } while (!service_time_us_.compare_exchange_weak(average, updated, std::memory_order_relaxed));
+}
+
+int AdmissionControl::retry_after_s() const {
+    uint64_t delay = expected_delay_us(waiting_.load(std::memory_order_relaxed));
+    return static_cast<int>(std::clamp<uint64_t>((delay + 999999) / 1000000, 1, 60));
+}
+
+std::chrono::microseconds AdmissionControl::service_time() const {
+    return std::chrono::microseconds(service_time_us_.load(std::memory_order_relaxed));
+}
+
+} // namespace openkore_ai
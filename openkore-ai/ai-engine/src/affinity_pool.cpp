@@ -0,0 +1,97 @@
+#include "../include/affinity_pool.hpp"
+#include "../include/http_task_queue.hpp"
+
+namespace openkore_ai {
+
+namespace {
+
+// The worker the calling thread is, so tasks a task runs for its own key don't wait for themselves
+thread_local const void* current_worker = nullptr;
+
+} // namespace
+
+AffinityPool::AffinityPool(size_t threads, const std::vector<int>& cpu_affinity) {
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < threads; i++) {
+        int cpu = cpu_affinity.empty() ? -1 : cpu_affinity[i % cpu_affinity.size()];
+        Worker& worker = *workers_[i];
+        worker.thread = std::thread([this, &worker, cpu] {
+            if (cpu >= 0) {
+                pin_current_thread(cpu);
+            }
+            worker_loop(worker);
+        });
+    }
+}
+
+AffinityPool::~AffinityPool() {
+    for (auto& worker : workers_) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->stopping = true;
+        }
+        worker->wake.notify_one();
+    }
+    for (auto& worker : workers_) {
+        worker->thread.join();
+    }
+}
+
+void AffinityPool::run(std::string_view key, const std::function<void()>& task) {
+    if (workers_.empty()) {
+        task();
+        return;
+    }
+    Worker& worker = *workers_[std::hash<std::string_view>{}(key) % workers_.size()];
+    if (current_worker == &worker) {
+        task();
+        return;
+    }
+
+    Call call;
+    call.task = &task;
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.calls.push_back(&call);
+    }
+    worker.wake.notify_one();
+
+    std::unique_lock<std::mutex> lock(call.mutex);
+    call.finished.wait(lock, [&] { return call.done; });
+    if (call.error) {
+        std::rethrow_exception(call.error);
+    }
+}
+
+void AffinityPool::worker_loop(Worker& worker) {
+    current_worker = &worker;
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    while (true) {
+        worker.wake.wait(lock, [&] { return worker.stopping || !worker.calls.empty(); });
+        if (worker.calls.empty()) {
+            return;
+        }
+        Call* call = worker.calls.front();
+        worker.calls.pop_front();
+        lock.unlock();
+
+        try {
+            (*call->task)();
+        } catch (...) {
+            call->error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> call_lock(call->mutex);
+            call->done = true;
+            // Notified under the lock, as the caller's Call goes away as soon as it sees done
+            call->finished.notify_one();
+        }
+
+        lock.lock();
+    }
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,152 @@
+#include "../include/alloc_stats.hpp"
+#include <array>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+namespace openkore_ai {
+namespace alloc_stats {
+
+namespace {
+
+#ifdef OPENKORE_AI_WITH_ALLOC_STATS
+// Process counts, sharded like metrics::DecisionMetrics so threads don't contend on them
+constexpr size_t SHARD_COUNT = 16;
+
+struct alignas(64) Shard {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+std::array<Shard, SHARD_COUNT> shards;
+std::atomic<size_t> next_shard{0};
+
+// Plain values only: they are used by operator new itself, before and after the other thread_locals
+thread_local Counts counts_of_thread;
+thread_local Shard* shard_of_thread = nullptr;
+
+Shard& shard_for_thread() {
+    if (!shard_of_thread) {
+        shard_of_thread = &shards[next_shard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT];
+    }
+    return *shard_of_thread;
+}
+
+void count_allocation(std::size_t size) {
+    counts_of_thread.allocations++;
+    counts_of_thread.bytes += size;
+    Shard& shard = shard_for_thread();
+    shard.allocations.fetch_add(1, std::memory_order_relaxed);
+    shard.bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void count_free() {
+    counts_of_thread.frees++;
+    shard_for_thread().frees.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+} // namespace
+
+Counts thread_counts() {
+#ifdef OPENKORE_AI_WITH_ALLOC_STATS
+    return counts_of_thread;
+#else
+    return {};
+#endif
+}
+
+Counts process_counts() {
+    Counts counts;
+#ifdef OPENKORE_AI_WITH_ALLOC_STATS
+    for (const Shard& shard : shards) {
+        counts.allocations += shard.allocations.load(std::memory_order_relaxed);
+        counts.frees += shard.frees.load(std::memory_order_relaxed);
+        counts.bytes += shard.bytes.load(std::memory_order_relaxed);
+    }
+#endif
+    return counts;
+}
+
+Memory memory() {
+    Memory memory;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        memory.rss_bytes = counters.WorkingSetSize;
+        memory.peak_rss_bytes = counters.PeakWorkingSetSize;
+    }
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#ifdef __APPLE__
+        memory.peak_rss_bytes = static_cast<uint64_t>(usage.ru_maxrss);
+#else
+        memory.peak_rss_bytes = static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+    }
+#ifdef __linux__
+    // The second field is the resident size, in pages
+    if (FILE* statm = std::fopen("/proc/self/statm", "r")) {
+        unsigned long long size = 0, resident = 0;
+        if (std::fscanf(statm, "%llu %llu", &size, &resident) == 2) {
+            memory.rss_bytes = resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        }
+        std::fclose(statm);
+    }
+#endif
+#endif
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    memory.heap_known = true;
+    memory.heap_arena_bytes = info.arena;
+    memory.heap_mmap_bytes = info.hblkhd;
+    memory.heap_in_use_bytes = info.uordblks + info.hblkhd;
+    memory.heap_free_bytes = info.fordblks;
+#endif
+    return memory;
+}
+
+} // namespace alloc_stats
+} // namespace openkore_ai
+
+#ifdef OPENKORE_AI_WITH_ALLOC_STATS
+// The counting global operators. The array and nothrow forms of the standard library call these ones;
+// over-aligned allocations keep the default operators and are not counted.
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC sees the malloc behind the replaced operators once they are inlined
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+    openkore_ai::alloc_stats::count_allocation(size);
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    if (memory) {
+        openkore_ai::alloc_stats::count_free();
+    }
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    operator delete(memory);
+}
+#endif
@@ -0,0 +1,120 @@
+#include "../include/config_file.hpp"
+#include <stdexcept>
+
+namespace openkore_ai {
+namespace config {
+
+namespace {
+
+// Drops a trailing "# comment" which is not inside quotes
+std::string strip_comment(const std::string& line) {
+    char quote = 0;
+    for (size_t i = 0; i < line.size(); i++) {
+        char c = line[i];
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+            }
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '#' && (i == 0 || line[i - 1] == ' ' || line[i - 1] == '\t')) {
+            return line.substr(0, i);
+        }
+    }
+    return line;
+}
+
+std::string unquote(const std::string& value) {
+    if (value.size() >= 2 && (value.front() == '"' || value.front() == '\'') && value.back() == value.front()) {
+        return value.substr(1, value.size() - 2);
+    }
+    return value;
+}
+
+} // namespace
+
+std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+bool to_bool(const std::string& value) {
+    if (value == "true" || value == "yes" || value == "on") {
+        return true;
+    }
+    if (value == "false" || value == "no" || value == "off") {
+        return false;
+    }
+    throw std::invalid_argument(value);
+}
+
+long long to_number(const std::string& value, long long min, long long max) {
+    size_t used = 0;
+    long long number = std::stoll(value, &used);
+    if (used != value.size() || number < min || number > max) {
+        throw std::invalid_argument(value);
+    }
+    return number;
+}
+
+double to_real(const std::string& value, double min, double max) {
+    size_t used = 0;
+    double number = std::stod(value, &used);
+    if (used != value.size() || !(number >= min && number <= max)) {
+        throw std::invalid_argument(value);
+    }
+    return number;
+}
+
+std::vector<std::string> to_list(const std::string& value) {
+    std::string list = trim(value);
+    if (list.size() >= 2 && list.front() == '[' && list.back() == ']') {
+        list = list.substr(1, list.size() - 2);
+    }
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        std::string item = unquote(trim(list.substr(start, comma == std::string::npos ? std::string::npos
+                                                                                       : comma - start)));
+        if (!item.empty()) {
+            items.push_back(std::move(item));
+        }
+        if (comma == std::string::npos) {
+            break;
+        }
+        start = comma + 1;
+    }
+    return items;
+}
+
+void read_entries(std::istream& in, const Entry& entry) {
+    std::string line;
+    std::string section;
+    int line_number = 0;
+    while (std::getline(in, line)) {
+        line_number++;
+        line = strip_comment(line);
+        if (trim(line).empty()) {
+            continue;
+        }
+        size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string key = trim(line.substr(0, colon));
+        std::string value = unquote(trim(line.substr(colon + 1)));
+        if (line[0] != ' ' && line[0] != '\t') {
+            section = key;
+            continue;
+        }
+        entry(section, key, value, line_number);
+    }
+}
+
+} // namespace config
+} // namespace openkore_ai
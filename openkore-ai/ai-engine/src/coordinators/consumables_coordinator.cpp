@@ -1,6 +1,5 @@
 #include "../../include/coordinators/consumables_coordinator.hpp"
 #include <iostream>
-#include <algorithm>
 
 namespace openkore_ai {
 namespace coordinators {
@@ -16,143 +15,91 @@ ConsumablesCoordinator::ConsumablesCoordinator()
     std::cout << "[ConsumablesCoordinator] Fully initialized" << std::endl;
 }
 
-bool ConsumablesCoordinator::should_activate(const GameState& state) const {
-    float hp_percent = state.character.max_hp > 0 
-        ? static_cast<float>(state.character.hp) / state.character.max_hp 
-        : 1.0f;
-    
-    float sp_percent = state.character.max_sp > 0 
-        ? static_cast<float>(state.character.sp) / state.character.max_sp 
-        : 1.0f;
-    
-    float weight_percent = state.character.max_weight > 0 
-        ? static_cast<float>(state.character.weight) / state.character.max_weight 
-        : 0.0f;
+bool ConsumablesCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
+    float hp_percent = summary.hp_ratio;
+    float sp_percent = summary.sp_ratio;
+    float weight_percent = summary.weight_ratio;
     
     return hp_percent < hp_warning_threshold_ 
         || sp_percent < sp_warning_threshold_
         || weight_percent > weight_warning_threshold_;
 }
 
-Action ConsumablesCoordinator::decide(const GameState& state) {
-    float hp_percent = state.character.max_hp > 0 
-        ? static_cast<float>(state.character.hp) / state.character.max_hp 
-        : 1.0f;
-    
-    float sp_percent = state.character.max_sp > 0 
-        ? static_cast<float>(state.character.sp) / state.character.max_sp 
-        : 1.0f;
-    
-    float weight_percent = state.character.max_weight > 0 
-        ? static_cast<float>(state.character.weight) / state.character.max_weight 
-        : 0.0f;
+Action ConsumablesCoordinator::decide(const GameState& state, const StateSummary& summary) {
+    float hp_percent = summary.hp_ratio;
+    float sp_percent = summary.sp_ratio;
+    float weight_percent = summary.weight_ratio;
     
     // Emergency HP
     if (hp_percent < hp_emergency_threshold_) {
-        std::string item = find_best_hp_item(state, true);
+        std::string item = find_best_hp_item(summary.inventory(), true);
         if (!item.empty()) {
-            Action action = create_action("item", "EMERGENCY: HP critical", 0.95f);
-            action.parameters["item"] = item;
-            action.parameters["emergency"] = "true";
+            Action action = create_action(ActionKind::ITEM, "EMERGENCY: HP critical", 0.95f);
+            action.parameters.set(params::ITEM, item);
+            action.parameters.set(params::EMERGENCY, "true");
             return action;
         }
     }
     
     // Warning HP
     if (hp_percent < hp_warning_threshold_) {
-        std::string item = find_best_hp_item(state, false);
+        std::string item = find_best_hp_item(summary.inventory(), false);
         if (!item.empty()) {
-            Action action = create_action("item", "HP low", 0.75f);
-            action.parameters["item"] = item;
+            Action action = create_action(ActionKind::ITEM, "HP low", 0.75f);
+            action.parameters.set(params::ITEM, item);
             return action;
         }
     }
     
     // Emergency SP
     if (sp_percent < sp_emergency_threshold_) {
-        std::string item = find_best_sp_item(state, true);
+        std::string item = find_best_sp_item(summary.inventory(), true);
         if (!item.empty()) {
-            Action action = create_action("item", "SP critical", 0.85f);
-            action.parameters["item"] = item;
+            Action action = create_action(ActionKind::ITEM, "SP critical", 0.85f);
+            action.parameters.set(params::ITEM, item);
             return action;
         }
     }
     
     // Warning SP
     if (sp_percent < sp_warning_threshold_) {
-        std::string item = find_best_sp_item(state, false);
+        std::string item = find_best_sp_item(summary.inventory(), false);
         if (!item.empty()) {
-            Action action = create_action("item", "SP low", 0.65f);
-            action.parameters["item"] = item;
+            Action action = create_action(ActionKind::ITEM, "SP low", 0.65f);
+            action.parameters.set(params::ITEM, item);
             return action;
         }
     }
     
     // Overweight
     if (weight_percent > weight_warning_threshold_) {
-        std::string item = find_item_to_drop(state);
+        std::string item = find_item_to_drop(summary.inventory());
         if (!item.empty()) {
-            Action action = create_action("drop", "Overweight", 0.70f);
-            action.parameters["item"] = item;
-            action.parameters["amount"] = "1";
+            Action action = create_action(ActionKind::DROP, "Overweight", 0.70f);
+            action.parameters.set(params::ITEM, item);
+            action.parameters.set(params::AMOUNT, "1");
             return action;
         }
     }
     
-    return create_action("none", "Consumables OK", 0.1f);
+    return create_action(ActionKind::NONE, "Consumables OK", 0.1f);
 }
 
-std::string ConsumablesCoordinator::find_best_hp_item(const GameState& state, bool emergency) const {
-    std::vector<std::string> priority = emergency 
-        ? std::vector<std::string>{"White Potion", "Red Potion", "Orange Potion", "Yellow Potion"}
-        : std::vector<std::string>{"Red Potion", "Orange Potion", "Yellow Potion"};
-    
-    for (const auto& item_name : priority) {
-        auto it = std::find_if(state.inventory.begin(), state.inventory.end(),
-            [&item_name](const Item& item) {
-                return item.name == item_name && item.amount > 0;
-            });
-        
-        if (it != state.inventory.end()) {
-            return item_name;
-        }
-    }
-    
-    return "";
+// Emergencies take the strongest item, so one is enough; otherwise the weakest, not to waste the others
+std::string ConsumablesCoordinator::find_best_hp_item(const InventorySummary& inventory, bool emergency) const {
+    const ItemInfo* item = emergency ? inventory.strongest(ItemCategory::HP_RECOVERY)
+                                     : inventory.weakest(ItemCategory::HP_RECOVERY);
+    return item ? item->name : "";
 }
 
-std::string ConsumablesCoordinator::find_best_sp_item(const GameState& state, bool emergency) const {
-    std::vector<std::string> sp_items = {"Blue Potion", "Royal Jelly"};
-    
-    for (const auto& item_name : sp_items) {
-        auto it = std::find_if(state.inventory.begin(), state.inventory.end(),
-            [&item_name](const Item& item) {
-                return item.name == item_name && item.amount > 0;
-            });
-        
-        if (it != state.inventory.end()) {
-            return item_name;
-        }
-    }
-    
-    return "";
+std::string ConsumablesCoordinator::find_best_sp_item(const InventorySummary& inventory, bool emergency) const {
+    const ItemInfo* item = inventory.weakest(ItemCategory::SP_RECOVERY);
+    return item ? item->name : "";
 }
 
-std::string ConsumablesCoordinator::find_item_to_drop(const GameState& state) const {
-    std::vector<std::string> droppable = {"Jellopy", "Fluff", "Clover"};
-    
-    for (const auto& item_name : droppable) {
-        auto it = std::find_if(state.inventory.begin(), state.inventory.end(),
-            [&item_name](const Item& item) {
-                return item.name == item_name && item.amount > 0;
-            });
-        
-        if (it != state.inventory.end()) {
-            return item_name;
-        }
-    }
-    
-    return "";
+std::string ConsumablesCoordinator::find_item_to_drop(const InventorySummary& inventory) const {
+    const ItemInfo* item = inventory.weakest(ItemCategory::LOOT);
+    return item ? item->name : "";
 }
 
 } // namespace coordinators
@@ -7,9 +7,9 @@ CoordinatorBase::CoordinatorBase(const std::string& name, Priority default_prior
     : name_(name), priority_(default_priority) {
 }
 
-Action CoordinatorBase::create_action(const std::string& type, const std::string& reason, float confidence) const {
+Action CoordinatorBase::create_action(ActionKind kind, const std::string& reason, float confidence) const {
     Action action;
-    action.type = type;
+    action.kind = kind;
     action.reason = name_ + ": " + reason;
     action.confidence = confidence;
     return action;
@@ -1,77 +1,188 @@
 #include "../../include/coordinators/coordinator_manager.hpp"
-#include "../../include/coordinators/combat_coordinator.hpp"
-#include "../../include/coordinators/economy_coordinator.hpp"
-#include "../../include/coordinators/navigation_coordinator.hpp"
-#include "../../include/coordinators/social_coordinator.hpp"
-#include "../../include/coordinators/consumables_coordinator.hpp"
-#include "../../include/coordinators/progression_coordinator.hpp"
-#include "../../include/coordinators/npc_coordinator.hpp"
-#include "../../include/coordinators/planning_coordinator.hpp"
-#include "../../include/coordinators/stub_coordinators.hpp"
+#include "../../include/metrics.hpp"
+#include "../../include/logger.hpp"
 #include <iostream>
 #include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <utility>
 
 namespace openkore_ai {
 namespace coordinators {
 
+namespace {
+
+using Evaluator = std::optional<Action> (*)(BuiltinCoordinators&, const GameState&, const StateSummary&);
+
+// Calls a built-in coordinator as the class it is, which is final, so that its calls are direct
+template <size_t I>
+std::optional<Action> evaluate_builtin(BuiltinCoordinators& builtin, const GameState& state,
+                                       const StateSummary& summary) {
+    auto& coordinator = std::get<I>(builtin.all());
+    if (!coordinator.should_activate(state, summary)) {
+        return std::nullopt;
+    }
+    return coordinator.decide(state, summary);
+}
+
+template <size_t... I>
+constexpr std::array<Evaluator, sizeof...(I)> builtin_evaluators(std::index_sequence<I...>) {
+    return {&evaluate_builtin<I>...};
+}
+
+constexpr auto BUILTIN_EVALUATORS = builtin_evaluators(std::make_index_sequence<BUILTIN_COORDINATORS>());
+
+} // namespace
+
 CoordinatorManager::CoordinatorManager() {
     std::cout << "[CoordinatorManager] Initializing..." << std::endl;
 }
 
 void CoordinatorManager::initialize() {
-    // Initialize all 14 coordinators
-    // Fully implemented coordinators
-    coordinators_.push_back(std::make_unique<CombatCoordinator>());
-    coordinators_.push_back(std::make_unique<EconomyCoordinator>());
+    // Initialize all 14 coordinators, see BuiltinCoordinators
+    builtin_ = std::make_unique<BuiltinCoordinators>();
+    std::apply([this](auto&... coordinator) { (coordinators_.push_back(&coordinator), ...); }, builtin_->all());
     
-    // Navigation coordinator
-    coordinators_.push_back(std::make_unique<NavigationCoordinator>());
-    coordinators_.push_back(std::make_unique<NPCCoordinator>());
-    coordinators_.push_back(std::make_unique<PlanningCoordinator>());
-    coordinators_.push_back(std::make_unique<SocialCoordinator>());
-    coordinators_.push_back(std::make_unique<ConsumablesCoordinator>());
-    coordinators_.push_back(std::make_unique<ProgressionCoordinator>());
-    
-    // Additional coordinators
-    coordinators_.push_back(std::make_unique<CompanionsCoordinator>());
-    coordinators_.push_back(std::make_unique<InstancesCoordinator>());
-    coordinators_.push_back(std::make_unique<CraftingCoordinator>());
-    coordinators_.push_back(std::make_unique<EnvironmentCoordinator>());
-    coordinators_.push_back(std::make_unique<JobSpecificCoordinator>());
-    coordinators_.push_back(std::make_unique<PvPWoECoordinator>());
+    for (size_t i = 0; i < coordinators_.size(); i++) {
+        stage_ids_.push_back(metrics::stages().stage("coordinator." + coordinators_[i]->get_name()));
+    }
+    default_schedule_ = compile(DecisionSettings());
     
     std::cout << "[CoordinatorManager] Initialized " << coordinators_.size() << " coordinators" << std::endl;
 }
 
+void CoordinatorManager::add_coordinator(std::unique_ptr<CoordinatorBase> coordinator) {
+    coordinators_.push_back(coordinator.get());
+    stage_ids_.push_back(metrics::stages().stage("coordinator." + coordinator->get_name()));
+    added_.push_back(std::move(coordinator));
+    default_schedule_ = compile(DecisionSettings());
+}
+
+std::shared_ptr<const CoordinatorSchedule> CoordinatorManager::compile(const DecisionSettings& settings) const {
+    std::vector<char> enabled(coordinators_.size(), 1);
+    for (const std::string& name : settings.disabled_coordinators) {
+        auto it = std::find_if(coordinators_.begin(), coordinators_.end(),
+                               [&](const auto& coordinator) { return coordinator->get_name() == name; });
+        if (it == coordinators_.end()) {
+            throw std::invalid_argument("unknown coordinator " + name);
+        }
+        enabled[it - coordinators_.begin()] = 0;
+    }
+    
+    auto schedule = std::make_shared<CoordinatorSchedule>();
+    for (size_t i = 0; i < coordinators_.size(); i++) {
+        if (!enabled[i]) {
+            continue;
+        }
+        size_t priority = static_cast<size_t>(coordinators_[i]->get_priority());
+        if (schedule->buckets.size() <= priority) {
+            schedule->buckets.resize(priority + 1);
+        }
+        schedule->buckets[priority].push_back(i);
+    }
+    std::erase_if(schedule->buckets, [](const std::vector<size_t>& bucket) { return bucket.empty(); });
+    schedule->deadline = std::chrono::microseconds(settings.coordinator_deadline_us);
+    schedule->collect_all = settings.collect_all_coordinators;
+    return schedule;
+}
+
+std::optional<Action> CoordinatorManager::evaluate(size_t i, const GameState& state, const StateSummary& summary) {
+    if (i < BUILTIN_COORDINATORS) {
+        return BUILTIN_EVALUATORS[i](*builtin_, state, summary);
+    }
+    CoordinatorBase* coordinator = coordinators_[i];
+    if (!coordinator->should_activate(state, summary)) {
+        return std::nullopt;
+    }
+    return coordinator->decide(state, summary);
+}
+
+void CoordinatorManager::enable_parallel(WorkerPool& pool) {
+    pool_ = &pool;
+}
+
 Action CoordinatorManager::get_coordinator_decision(const GameState& state) {
+    return get_coordinator_decision(state, StateSummary(state));
+}
+
+Action CoordinatorManager::get_coordinator_decision(const GameState& state, const StateSummary& summary,
+                                                    std::chrono::steady_clock::time_point deadline,
+                                                    size_t* chosen) {
+    return get_coordinator_decision(state, summary, *default_schedule_, deadline, chosen);
+}
+
+Action CoordinatorManager::get_coordinator_decision(const GameState& state, const StateSummary& summary,
+                                                    const CoordinatorSchedule& schedule,
+                                                    std::chrono::steady_clock::time_point deadline,
+                                                    size_t* chosen) {
     std::vector<std::pair<CoordinatorBase*, Action>> recommendations;
     
-    // Collect recommendations from active coordinators
-    for (auto& coordinator : coordinators_) {
-        if (coordinator->should_activate(state)) {
-            Action action = coordinator->decide(state);
-            if (action.type != "none") {
-                recommendations.push_back({coordinator.get(), action});
-                std::cout << "[CoordinatorManager] " << coordinator->get_name() 
-                         << " recommends: " << action.type << std::endl;
+    // Collect recommendations from active coordinators, highest priority first. select_best_action prefers
+    // any action of a higher priority, so once a bucket recommends something the lower ones can't win.
+    auto parallel_deadline = std::min(std::chrono::steady_clock::now() + schedule.deadline, deadline);
+    std::shared_ptr<const SummarizedState> shared_state;
+    for (const std::vector<size_t>& bucket : schedule.buckets) {
+        if (pool_ && bucket.size() > 1) {
+            if (!shared_state) {
+                shared_state = std::make_shared<const SummarizedState>(state, summary.trends);
             }
+            collect_parallel(shared_state, bucket, parallel_deadline, recommendations);
+        } else {
+            collect_sequential(state, summary, bucket, deadline, recommendations);
+        }
+        if (!recommendations.empty() && !schedule.collect_all) {
+            break;
         }
     }
     
     if (recommendations.empty()) {
         Action no_action;
-        no_action.type = "none";
+        no_action.kind = ActionKind::NONE;
         no_action.reason = "CoordinatorManager: No coordinator recommendations";
         no_action.confidence = 0.5f;
         return no_action;
     }
     
     // Select best action
-    return select_best_action(recommendations);
+    return select_best_action(recommendations, chosen);
+}
+
+std::optional<Action> CoordinatorManager::speculative_decision(const GameState& state, const StateSummary& summary,
+                                                              const CoordinatorSchedule* schedule, size_t* chosen) {
+    std::vector<std::pair<CoordinatorBase*, Action>> recommendations;
+    for (const std::vector<size_t>& bucket : (schedule ? *schedule : *default_schedule_).buckets) {
+        for (size_t i : bucket) {
+            CoordinatorBase* coordinator = coordinators_[i];
+            if (coordinator->keeps_state()) {
+                if (coordinator->should_activate(state, summary)) {
+                    return std::nullopt;
+                }
+                continue;
+            }
+            std::optional<Action> action = evaluate(i, state, summary);
+            if (action && action->kind != ActionKind::NONE) {
+                recommendations.push_back({coordinator, std::move(*action)});
+            }
+        }
+        if (!recommendations.empty()) {
+            break;
+        }
+    }
+    
+    if (recommendations.empty()) {
+        Action no_action;
+        no_action.kind = ActionKind::NONE;
+        no_action.reason = "CoordinatorManager: No coordinator recommendations";
+        no_action.confidence = 0.5f;
+        return no_action;
+    }
+    return select_best_action(recommendations, chosen);
 }
 
 Action CoordinatorManager::select_best_action(
-    const std::vector<std::pair<CoordinatorBase*, Action>>& recommendations) const {
+    const std::vector<std::pair<CoordinatorBase*, Action>>& recommendations, size_t* chosen) const {
     
     // Priority-based selection: Lower priority value = higher priority
     auto best = std::min_element(recommendations.begin(), recommendations.end(),
@@ -85,27 +196,175 @@ Action CoordinatorManager::select_best_action(
         });
     
     if (best != recommendations.end()) {
-        std::cout << "[CoordinatorManager] Selected action from " << best->first->get_name() 
-                 << " (priority: " << static_cast<int>(best->first->get_priority()) 
-                 << ", confidence: " << best->second.confidence << ")" << std::endl;
+        OKAI_TRACE("CoordinatorManager", "Selected action from " << best->first->get_name()
+                   << " (priority: " << static_cast<int>(best->first->get_priority())
+                   << ", confidence: " << best->second.confidence << ")");
+        if (chosen) {
+            *chosen = std::find(coordinators_.begin(), coordinators_.end(), best->first) - coordinators_.begin();
+        }
         return best->second;
     }
     
     Action no_action;
-    no_action.type = "none";
+    no_action.kind = ActionKind::NONE;
     no_action.reason = "CoordinatorManager: Selection failed";
     no_action.confidence = 0.3f;
     return no_action;
 }
 
+void CoordinatorManager::collect_sequential(const GameState& state, const StateSummary& summary,
+                                            const std::vector<size_t>& bucket,
+                                            std::chrono::steady_clock::time_point deadline,
+                                            std::vector<std::pair<CoordinatorBase*, Action>>& recommendations) {
+    bool timed = deadline != std::chrono::steady_clock::time_point::max();
+    for (size_t i : bucket) {
+        if (timed && std::chrono::steady_clock::now() >= deadline) {
+            late_count_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        metrics::StageTimer timer(stage_ids_[i]);
+        std::optional<Action> action = evaluate(i, state, summary);
+        if (action && action->kind != ActionKind::NONE) {
+            OKAI_TRACE("CoordinatorManager", coordinators_[i]->get_name() << " recommends: " << action->type_name());
+            recommendations.push_back({coordinators_[i], std::move(*action)});
+        }
+    }
+}
+
+namespace {
+
+// One parallel evaluation of a bucket. Coordinators that miss the deadline keep running after the decision
+// is made, so the round shares ownership of the state, has its own copy of the bucket, which a new schedule
+// may have freed meanwhile, and lives until the last of them is done.
+struct Round {
+    std::shared_ptr<const SummarizedState> state;
+    std::vector<size_t> bucket;
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable finished_one;
+    size_t finished = 0;
+    std::vector<char> evaluated;  // set once a coordinator has run, under the mutex
+    std::vector<std::optional<Action>> actions;
+    std::vector<std::exception_ptr> errors;
+};
+
+} // namespace
+
+void CoordinatorManager::collect_parallel(const std::shared_ptr<const SummarizedState>& state,
+                                          const std::vector<size_t>& bucket,
+                                          std::chrono::steady_clock::time_point deadline,
+                                          std::vector<std::pair<CoordinatorBase*, Action>>& recommendations) {
+    auto round = std::make_shared<Round>();
+    round->state = state;
+    round->bucket = bucket;
+    round->deadline = deadline;
+    round->evaluated.resize(bucket.size());
+    round->actions.resize(bucket.size());
+    round->errors.resize(bucket.size());
+    
+    // Each runner takes the next coordinator nobody has started yet, until all are taken; those only
+    // taken after the deadline are skipped
+    auto run = [this, round] {
+        size_t n;
+        while ((n = round->next.fetch_add(1)) < round->bucket.size()) {
+            size_t i = round->bucket[n];
+            std::optional<Action> action;
+            std::exception_ptr error;
+            bool in_time = std::chrono::steady_clock::now() < round->deadline;
+            if (in_time) {
+                try {
+                    metrics::StageTimer timer(stage_ids_[i]);
+                    action = evaluate(i, round->state->state, round->state->summary);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+            }
+            {
+                std::lock_guard<std::mutex> lock(round->mutex);
+                round->evaluated[n] = in_time;
+                round->actions[n] = std::move(action);
+                round->errors[n] = error;
+                round->finished++;
+            }
+            round->finished_one.notify_all();
+        }
+    };
+    
+    size_t helpers = std::min(pool_->size(), bucket.size() - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        pool_->submit(run);
+    }
+    run();
+    
+    std::unique_lock<std::mutex> lock(round->mutex);
+    round->finished_one.wait_until(lock, deadline, [&] { return round->finished == bucket.size(); });
+    
+    for (size_t n = 0; n < bucket.size(); n++) {
+        if (!round->evaluated[n]) {
+            late_count_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (round->errors[n]) {
+            std::rethrow_exception(round->errors[n]);
+        }
+        std::optional<Action>& action = round->actions[n];
+        if (action && action->kind != ActionKind::NONE) {
+            CoordinatorBase* coordinator = coordinators_[bucket[n]];
+            OKAI_TRACE("CoordinatorManager", coordinator->get_name() << " recommends: " << action->type_name());
+            recommendations.push_back({coordinator, std::move(*action)});
+        }
+    }
+}
+
 CoordinatorBase* CoordinatorManager::get_coordinator(const std::string& name) const {
-    for (const auto& coordinator : coordinators_) {
+    for (CoordinatorBase* coordinator : coordinators_) {
         if (coordinator->get_name() == name) {
-            return coordinator.get();
+            return coordinator;
         }
     }
     return nullptr;
 }
 
+void CoordinatorManager::save(SnapshotWriter& out) const {
+    size_t count_offset = out.count_placeholder();
+    uint32_t count = 0;
+    for (const CoordinatorBase* coordinator : coordinators_) {
+        if (!coordinator->keeps_state()) {
+            continue;
+        }
+        // Each in a block of its own, which managers without the coordinator skip
+        SnapshotWriter state(out.now());
+        coordinator->save_state(state);
+        out.str(coordinator->get_name());
+        out.str(state.data());
+        count++;
+    }
+    out.set_count(count_offset, count);
+}
+
+size_t CoordinatorManager::restore(SnapshotReader& in) {
+    size_t restored = 0;
+    for (uint32_t i = 0, count = in.count(8); i < count; i++) {
+        std::string name = in.str();
+        SnapshotReader state = in.sub(in.u32());
+        CoordinatorBase* coordinator = get_coordinator(name);
+        if (!coordinator || !coordinator->keeps_state()) {
+            continue;
+        }
+        coordinator->restore_state(state);
+        restored++;
+    }
+    return restored;
+}
+
+std::vector<std::string> CoordinatorManager::names() const {
+    std::vector<std::string> names;
+    for (CoordinatorBase* coordinator : coordinators_) {
+        names.push_back(coordinator->get_name());
+    }
+    return names;
+}
+
 } // namespace coordinators
 } // namespace openkore_ai
@@ -9,23 +9,23 @@ EconomyCoordinator::EconomyCoordinator()
     std::cout << "[EconomyCoordinator] Initialized" << std::endl;
 }
 
-bool EconomyCoordinator::should_activate(const GameState& state) const {
+bool EconomyCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     // Activate when overweight or inventory is full
     return is_overweight(state) || should_sell_items(state);
 }
 
-Action EconomyCoordinator::decide(const GameState& state) {
+Action EconomyCoordinator::decide(const GameState& state, const StateSummary& summary) {
     // Check if overweight
     if (is_overweight(state)) {
-        return create_action("move", "Overweight, returning to storage", 0.85f);
+        return create_action(ActionKind::MOVE, "Overweight, returning to storage", 0.85f);
     }
     
     // Check if should sell items
     if (should_sell_items(state)) {
-        return create_action("move", "Inventory full, going to sell items", 0.80f);
+        return create_action(ActionKind::MOVE, "Inventory full, going to sell items", 0.80f);
     }
     
-    return create_action("none", "Economy check passed", 0.5f);
+    return create_action(ActionKind::NONE, "Economy check passed", 0.5f);
 }
 
 bool EconomyCoordinator::is_overweight(const GameState& state) const {
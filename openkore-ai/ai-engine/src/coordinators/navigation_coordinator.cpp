@@ -1,4 +1,5 @@
 #include "../../include/coordinators/navigation_coordinator.hpp"
+#include "../../include/logger.hpp"
 #include <iostream>
 #include <cmath>
 #include <algorithm>
@@ -8,38 +9,32 @@ namespace coordinators {
 
 NavigationCoordinator::NavigationCoordinator() 
     : CoordinatorBase("NavigationCoordinator", Priority::LOW) {
-    stuck_threshold_ = 3;
-    stuck_counter_ = 0;
-    last_position_x_ = -1;
-    last_position_y_ = -1;
-    
     std::cout << "[NavigationCoordinator] Fully initialized" << std::endl;
 }
 
-bool NavigationCoordinator::should_activate(const GameState& state) const {
+bool NavigationCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     // Only activate if stuck
-    return is_stuck(state);
+    return is_stuck(summary);
 }
 
-Action NavigationCoordinator::decide(const GameState& state) {
-    if (is_stuck(state)) {
+Action NavigationCoordinator::decide(const GameState& state, const StateSummary& summary) {
+    if (is_stuck(summary)) {
         return handle_stuck(state);
     }
     
-    return create_action("none", "Navigation OK", 0.1f);
+    return create_action(ActionKind::NONE, "Navigation OK", 0.1f);
 }
 
-bool NavigationCoordinator::is_stuck(const GameState& state) const {
-    // Check if position hasn't changed
-    if (last_position_x_ == state.character.position.x && 
-        last_position_y_ == state.character.position.y) {
-        return stuck_counter_ >= stuck_threshold_;
-    }
-    return false;
+bool NavigationCoordinator::is_stuck(const StateSummary& summary) const {
+    // In place for a while, neither fighting nor sitting to recover
+    const Trends& trends = summary.trends;
+    return trends.samples > 1 && trends.time_in_place_ms >= STUCK_TIME_MS
+        && trends.hp_per_s <= 0.0f && trends.sp_per_s <= 0.0f
+        && summary.monsters().within(MonsterSummary::TARGET_RANGE) == 0;
 }
 
 Action NavigationCoordinator::handle_stuck(const GameState& state) {
-    std::cout << "[NavigationCoordinator] Stuck detected" << std::endl;
+    OKAI_TRACE("NavigationCoordinator", "Stuck detected");
     
     // Check for teleport items
     auto has_fly_wing = std::find_if(state.inventory.begin(), state.inventory.end(),
@@ -48,30 +43,20 @@ Action NavigationCoordinator::handle_stuck(const GameState& state) {
         });
     
     if (has_fly_wing != state.inventory.end()) {
-        Action action = create_action("item", "Stuck - using Fly Wing", 0.90f);
-        action.parameters["item"] = "Fly Wing";
+        Action action = create_action(ActionKind::ITEM, "Stuck - using Fly Wing", 0.90f);
+        action.parameters.set(params::ITEM, "Fly Wing");
         return action;
     }
     
     // Random walk
-    Action action = create_action("move", "Stuck - random walk", 0.80f);
-    action.parameters["x"] = std::to_string(state.character.position.x + (rand() % 5 - 2));
-    action.parameters["y"] = std::to_string(state.character.position.y + (rand() % 5 - 2));
+    Action action = create_action(ActionKind::MOVE, "Stuck - random walk", 0.80f);
+    action.parameters.set(params::X, std::to_string(state.character.position.x + (rand() % 5 - 2)));
+    action.parameters.set(params::Y, std::to_string(state.character.position.y + (rand() % 5 - 2)));
     return action;
 }
 
 Action NavigationCoordinator::navigate_to_destination(const GameState& state) const {
-    // Update stuck tracking
-    NavigationCoordinator* mutable_this = const_cast<NavigationCoordinator*>(this);
-    if (last_position_x_ == state.character.position.x && last_position_y_ == state.character.position.y) {
-        mutable_this->stuck_counter_++;
-    } else {
-        mutable_this->stuck_counter_ = 0;
-        mutable_this->last_position_x_ = state.character.position.x;
-        mutable_this->last_position_y_ = state.character.position.y;
-    }
-    
-    return create_action("none", "No destination", 0.1f);
+    return create_action(ActionKind::NONE, "No destination", 0.1f);
 }
 
 std::string NavigationCoordinator::find_nearest_portal(const GameState& state) const {
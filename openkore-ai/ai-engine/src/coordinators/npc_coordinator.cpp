@@ -1,6 +1,8 @@
 #include "../../include/coordinators/npc_coordinator.hpp"
 #include <iostream>
 #include <algorithm>
+#include <optional>
+#include <stdexcept>
 
 namespace openkore_ai {
 namespace coordinators {
@@ -8,71 +10,79 @@ namespace coordinators {
 NPCCoordinator::NPCCoordinator() 
     : CoordinatorBase("NPCCoordinator", Priority::MEDIUM) {
     npc_interaction_range_ = 5;
-    current_npc_id_ = "";
-    dialogue_state_ = DialogueState::IDLE;
     
     std::cout << "[NPCCoordinator] Fully initialized" << std::endl;
 }
 
-bool NPCCoordinator::should_activate(const GameState& state) const {
+bool NPCCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     // Activate if in dialogue or need potions
-    if (dialogue_state_ != DialogueState::IDLE) {
+    bool in_dialogue = dialogues_.with(state.character.name, [](const Dialogue& dialogue) {
+        return dialogue.state != DialogueState::IDLE;
+    });
+    if (in_dialogue) {
         return true;
     }
     
     // Check if need to buy potions
-    return check_need_potions(state);
+    return check_need_potions(summary);
 }
 
-Action NPCCoordinator::decide(const GameState& state) {
+Action NPCCoordinator::decide(const GameState& state, const StateSummary& summary) {
     // Handle active dialogue
-    if (dialogue_state_ != DialogueState::IDLE) {
-        return handle_active_dialogue(state);
+    std::optional<Action> dialogue_action = dialogues_.with(state.character.name,
+        [this](Dialogue& dialogue) -> std::optional<Action> {
+            if (dialogue.state == DialogueState::IDLE) {
+                return std::nullopt;
+            }
+            return handle_active_dialogue(dialogue);
+        });
+    if (dialogue_action) {
+        return std::move(*dialogue_action);
     }
     
     // Check if need potions
-    if (check_need_potions(state)) {
-        Action action = create_action("talk", "Need to buy consumables", 0.75f);
-        action.parameters["target"] = "Tool Dealer";
-        action.parameters["action"] = "buy_potions";
+    if (check_need_potions(summary)) {
+        Action action = create_action(ActionKind::TALK, "Need to buy consumables", 0.75f);
+        action.parameters.set(params::TARGET, "Tool Dealer");
+        action.parameters.set(params::ACTION, "buy_potions");
         return action;
     }
     
-    return create_action("none", "NPC: No interaction needed", 0.1f);
+    return create_action(ActionKind::NONE, "NPC: No interaction needed", 0.1f);
 }
 
-Action NPCCoordinator::handle_active_dialogue(const GameState& state) {
-    switch (dialogue_state_) {
+Action NPCCoordinator::handle_active_dialogue(Dialogue& dialogue) {
+    switch (dialogue.state) {
         case DialogueState::TALKING:
             {
-                Action action = create_action("npc_talk", "Continue dialogue", 0.90f);
-                action.parameters["action"] = "continue";
+                Action action = create_action(ActionKind::NPC_TALK, "Continue dialogue", 0.90f);
+                action.parameters.set(params::ACTION, "continue");
                 return action;
             }
         case DialogueState::MENU:
             {
-                Action action = create_action("npc_menu", "Select menu option", 0.90f);
-                action.parameters["option"] = "0";
+                Action action = create_action(ActionKind::NPC_MENU, "Select menu option", 0.90f);
+                action.parameters.set(params::OPTION, "0");
                 return action;
             }
         case DialogueState::BUYING:
             {
-                Action action = create_action("npc_buy", "Purchase items", 0.90f);
-                action.parameters["items"] = "potions";
+                Action action = create_action(ActionKind::NPC_BUY, "Purchase items", 0.90f);
+                action.parameters.set(params::ITEMS, "potions");
                 return action;
             }
         default:
-            dialogue_state_ = DialogueState::IDLE;
-            return create_action("npc_close", "Close dialogue", 0.80f);
+            dialogue.state = DialogueState::IDLE;
+            return create_action(ActionKind::NPC_CLOSE, "Close dialogue", 0.80f);
     }
 }
 
-Action NPCCoordinator::initiate_npc_talk(const std::string& npc_id, const std::string& reason) {
-    current_npc_id_ = npc_id;
-    dialogue_state_ = DialogueState::TALKING;
+Action NPCCoordinator::initiate_npc_talk(Dialogue& dialogue, const std::string& npc_id, const std::string& reason) {
+    dialogue.npc_id = npc_id;
+    dialogue.state = DialogueState::TALKING;
     
-    Action action = create_action("talk", reason, 0.85f);
-    action.parameters["target"] = npc_id;
+    Action action = create_action(ActionKind::TALK, reason, 0.85f);
+    action.parameters.set(params::TARGET, npc_id);
     return action;
 }
 
@@ -84,23 +94,9 @@ std::string NPCCoordinator::find_shop_npc(const GameState& state, const std::str
     return "";
 }
 
-bool NPCCoordinator::check_need_potions(const GameState& state) const {
-    int hp_potion_count = 0;
-    int sp_potion_count = 0;
-    
-    for (const auto& item : state.inventory) {
-        if (item.name.find("Potion") != std::string::npos) {
-            if (item.name.find("Red") != std::string::npos || 
-                item.name.find("White") != std::string::npos) {
-                hp_potion_count += item.amount;
-            }
-            if (item.name.find("Blue") != std::string::npos) {
-                sp_potion_count += item.amount;
-            }
-        }
-    }
-    
-    return hp_potion_count < 10 || sp_potion_count < 10;
+bool NPCCoordinator::check_need_potions(const StateSummary& summary) const {
+    const InventorySummary& inventory = summary.inventory();
+    return inventory.amount_of(ItemCategory::HP_RECOVERY) < 10 || inventory.amount_of(ItemCategory::SP_RECOVERY) < 10;
 }
 
 bool NPCCoordinator::has_nearby_shop_npc(const GameState& state) const {
@@ -117,5 +113,34 @@ int NPCCoordinator::calculate_npc_distance(const GameState& state, const std::st
     return 0;
 }
 
+void NPCCoordinator::save_state(SnapshotWriter& out) const {
+    size_t count_offset = out.count_placeholder();
+    uint32_t count = 0;
+    dialogues_.each([&](const std::string& character, const Dialogue& dialogue,
+                        std::chrono::steady_clock::time_point last_used) {
+        out.str(character);
+        out.time(last_used);
+        out.str(dialogue.npc_id);
+        out.u8(static_cast<uint8_t>(dialogue.state));
+        count++;
+    });
+    out.set_count(count_offset, count);
+}
+
+void NPCCoordinator::restore_state(SnapshotReader& in) {
+    for (uint32_t i = 0, count = in.count(17); i < count; i++) {
+        std::string character = in.str();
+        auto last_used = in.time();
+        Dialogue dialogue;
+        dialogue.npc_id = in.str();
+        uint8_t state = in.u8();
+        if (state > static_cast<uint8_t>(DialogueState::SELLING)) {
+            throw std::runtime_error("invalid dialogue state of " + character + " in snapshot");
+        }
+        dialogue.state = static_cast<DialogueState>(state);
+        dialogues_.restore(character, std::move(dialogue), last_used);
+    }
+}
+
 } // namespace coordinators
 } // namespace openkore_ai
@@ -1,86 +1,118 @@
 #include "../../include/coordinators/planning_coordinator.hpp"
 #include <iostream>
+#include <optional>
+#include <stdexcept>
 
 namespace openkore_ai {
 namespace coordinators {
 
 PlanningCoordinator::PlanningCoordinator() 
     : CoordinatorBase("PlanningCoordinator", Priority::LOW) {
-    current_plan_step_ = 0;
-    has_active_plan_ = false;
-    
     std::cout << "[PlanningCoordinator] Fully initialized" << std::endl;
 }
 
-bool PlanningCoordinator::should_activate(const GameState& state) const {
-    if (has_active_plan_ && current_plan_step_ < active_plan_.size()) {
-        return true;
-    }
-    
-    return needs_complex_planning(state);
+bool PlanningCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
+    bool planned = plans_.with(state.character.name, [](const Plan& plan) {
+        return plan.active && plan.current_step < plan.steps.size();
+    });
+    return planned || needs_complex_planning(state, summary);
 }
 
-Action PlanningCoordinator::decide(const GameState& state) {
-    if (!has_active_plan_ || active_plan_.empty()) {
-        create_plan_for_current_situation(state);
-    }
-    
-    if (has_active_plan_ && current_plan_step_ < active_plan_.size()) {
-        Action step = active_plan_[current_plan_step_];
-        current_plan_step_++;
+Action PlanningCoordinator::decide(const GameState& state, const StateSummary& summary) {
+    std::optional<Action> step = plans_.with(state.character.name, [&](Plan& plan) -> std::optional<Action> {
+        if (!plan.active || plan.steps.empty()) {
+            create_plan_for_current_situation(plan, state, summary);
+        }
+        
+        if (!plan.active || plan.current_step >= plan.steps.size()) {
+            return std::nullopt;
+        }
+        Action next = plan.steps[plan.current_step];
+        plan.current_step++;
         
-        if (current_plan_step_ >= active_plan_.size()) {
-            has_active_plan_ = false;
-            current_plan_step_ = 0;
-            active_plan_.clear();
+        if (plan.current_step >= plan.steps.size()) {
+            plan.active = false;
+            plan.current_step = 0;
+            plan.steps.clear();
         }
         
-        return step;
+        return next;
+    });
+    if (step) {
+        return std::move(*step);
     }
     
-    return create_action("none", "No plan active", 0.1f);
+    return create_action(ActionKind::NONE, "No plan active", 0.1f);
+}
+
+bool PlanningCoordinator::needs_complex_planning(const GameState& state, const StateSummary& summary) const {
+    return is_losing_fight(state, summary);
 }
 
-bool PlanningCoordinator::needs_complex_planning(const GameState& state) const {
+bool PlanningCoordinator::is_losing_fight(const GameState& state, const StateSummary& summary) const {
     int threats = static_cast<int>(state.monsters.size());
-    float hp_percent = state.character.max_hp > 0 
-        ? static_cast<float>(state.character.hp) / state.character.max_hp 
-        : 1.0f;
+    float seconds_left = summary.trends.seconds_to_death(state.character.hp);
     
-    return threats >= 3 && hp_percent < 0.30f;
+    // Low on HP, or losing it fast enough to be low soon
+    return threats >= 3 && (summary.hp_ratio < 0.30f || (seconds_left >= 0.0f && seconds_left < LOSING_SECONDS));
 }
 
-void PlanningCoordinator::create_plan_for_current_situation(const GameState& state) {
-    active_plan_.clear();
-    current_plan_step_ = 0;
-    has_active_plan_ = false;
-    
-    int threats = static_cast<int>(state.monsters.size());
-    float hp_percent = state.character.max_hp > 0 
-        ? static_cast<float>(state.character.hp) / state.character.max_hp 
-        : 1.0f;
+void PlanningCoordinator::create_plan_for_current_situation(Plan& plan, const GameState& state,
+                                                            const StateSummary& summary) const {
+    plan.steps.clear();
+    plan.current_step = 0;
+    plan.active = false;
     
-    if (threats >= 3 && hp_percent < 0.30f) {
-        Action step1 = create_action("item", "Plan: Emergency heal", 0.95f);
-        step1.parameters["item"] = "White Potion";
-        active_plan_.push_back(step1);
+    if (is_losing_fight(state, summary)) {
+        Action step1 = create_action(ActionKind::ITEM, "Plan: Emergency heal", 0.95f);
+        step1.parameters.set(params::ITEM, "White Potion");
+        plan.steps.push_back(step1);
         
-        Action step2 = create_action("move", "Plan: Retreat", 0.90f);
-        step2.parameters["direction"] = "retreat";
-        active_plan_.push_back(step2);
+        Action step2 = create_action(ActionKind::MOVE, "Plan: Retreat", 0.90f);
+        step2.parameters.set(params::DIRECTION, "retreat");
+        plan.steps.push_back(step2);
         
-        has_active_plan_ = true;
+        plan.active = true;
     }
 }
 
-bool PlanningCoordinator::check_need_resupply(const GameState& state) const {
-    int potion_count = 0;
-    for (const auto& item : state.inventory) {
-        if (item.name.find("Potion") != std::string::npos) {
-            potion_count += item.amount;
+bool PlanningCoordinator::check_need_resupply(const StateSummary& summary) const {
+    const InventorySummary& inventory = summary.inventory();
+    return inventory.amount_of(ItemCategory::HP_RECOVERY) + inventory.amount_of(ItemCategory::SP_RECOVERY) < 5;
+}
+
+void PlanningCoordinator::save_state(SnapshotWriter& out) const {
+    size_t count_offset = out.count_placeholder();
+    uint32_t count = 0;
+    plans_.each([&](const std::string& character, const Plan& plan, std::chrono::steady_clock::time_point last_used) {
+        out.str(character);
+        out.time(last_used);
+        out.u8(plan.active);
+        out.u32(static_cast<uint32_t>(plan.current_step));
+        out.u32(static_cast<uint32_t>(plan.steps.size()));
+        for (const Action& step : plan.steps) {
+            out.action(step);
+        }
+        count++;
+    });
+    out.set_count(count_offset, count);
+}
+
+void PlanningCoordinator::restore_state(SnapshotReader& in) {
+    for (uint32_t i = 0, count = in.count(21); i < count; i++) {
+        std::string character = in.str();
+        auto last_used = in.time();
+        Plan plan;
+        plan.active = in.u8() != 0;
+        plan.current_step = in.u32();
+        for (uint32_t step = 0, steps = in.count(15); step < steps; step++) {
+            plan.steps.push_back(in.action());
+        }
+        if (plan.current_step > plan.steps.size()) {
+            throw std::runtime_error("invalid plan of " + character + " in snapshot");
         }
+        plans_.restore(character, std::move(plan), last_used);
     }
-    return potion_count < 5;
 }
 
 } // namespace coordinators
@@ -9,52 +9,37 @@ SocialCoordinator::SocialCoordinator()
     std::cout << "[SocialCoordinator] Initialized (Phase 8 - Full Implementation)" << std::endl;
 }
 
-bool SocialCoordinator::should_activate(const GameState& state) const {
+bool SocialCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     // Activate when nearby players exist
     if (state.nearby_players.empty()) return false;
     
     // Only activate if we're not in combat
     if (!state.monsters.empty()) {
-        float hp_ratio = static_cast<float>(state.character.hp) / state.character.max_hp;
-        if (hp_ratio < 0.8f || state.monsters.size() > 2) {
+        if (summary.hp_ratio < 0.8f || state.monsters.size() > 2) {
             return false;  // Combat takes priority
         }
     }
     
     // Check if any players are close enough for interaction (within 10 cells)
-    for (const auto& player : state.nearby_players) {
-        if (player.distance <= 10) {
-            return true;
-        }
-    }
-    
-    return false;
+    return summary.players().within(10) > 0;
 }
 
-Action SocialCoordinator::decide(const GameState& state) {
+Action SocialCoordinator::decide(const GameState& state, const StateSummary& summary) {
     // Find closest player for potential interaction
-    std::string closest_player_name;
-    int min_distance = 999;
-    
-    for (const auto& player : state.nearby_players) {
-        if (player.distance < min_distance && player.distance <= 10) {
-            closest_player_name = player.name;
-            min_distance = player.distance;
-        }
-    }
+    const Player* closest = summary.players().nearest;
     
-    if (closest_player_name.empty()) {
-        return create_action("none", "No nearby players for social interaction", 0.1f);
+    if (!closest || closest->distance > 10) {
+        return create_action(ActionKind::NONE, "No nearby players for social interaction", 0.1f);
     }
     
     // Query Python social service for interaction decision
     // This would be triggered by actual player chat events in the Perl plugin
     // C++ coordinator just ensures social awareness is active
     
-    std::string reason = "Monitoring social interactions with " + closest_player_name + 
-                        " (distance: " + std::to_string(min_distance) + " cells)";
+    std::string reason = "Monitoring social interactions with " + closest->name + 
+                        " (distance: " + std::to_string(closest->distance) + " cells)";
     
-    return create_action("none", reason, 0.3f);
+    return create_action(ActionKind::NONE, reason, 0.3f);
 }
 
 } // namespace coordinators
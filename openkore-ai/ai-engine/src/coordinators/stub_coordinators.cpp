@@ -10,13 +10,13 @@ CompanionsCoordinator::CompanionsCoordinator()
     std::cout << "[CompanionsCoordinator] Fully initialized" << std::endl;
 }
 
-bool CompanionsCoordinator::should_activate(const GameState& state) const {
+bool CompanionsCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     // Simplified - can't detect companions without additional GameState fields
     return false;
 }
 
-Action CompanionsCoordinator::decide(const GameState& state) {
-    return create_action("none", "Companions OK", 0.1f);
+Action CompanionsCoordinator::decide(const GameState& state, const StateSummary& summary) {
+    return create_action(ActionKind::NONE, "Companions OK", 0.1f);
 }
 
 // Instances Coordinator
@@ -25,12 +25,12 @@ InstancesCoordinator::InstancesCoordinator()
     std::cout << "[InstancesCoordinator] Fully initialized" << std::endl;
 }
 
-bool InstancesCoordinator::should_activate(const GameState& state) const {
+bool InstancesCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     return false;
 }
 
-Action InstancesCoordinator::decide(const GameState& state) {
-    return create_action("none", "No instances active", 0.1f);
+Action InstancesCoordinator::decide(const GameState& state, const StateSummary& summary) {
+    return create_action(ActionKind::NONE, "No instances active", 0.1f);
 }
 
 // Crafting Coordinator
@@ -39,12 +39,12 @@ CraftingCoordinator::CraftingCoordinator()
     std::cout << "[CraftingCoordinator] Fully initialized" << std::endl;
 }
 
-bool CraftingCoordinator::should_activate(const GameState& state) const {
+bool CraftingCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     return false;
 }
 
-Action CraftingCoordinator::decide(const GameState& state) {
-    return create_action("none", "No crafting opportunities", 0.1f);
+Action CraftingCoordinator::decide(const GameState& state, const StateSummary& summary) {
+    return create_action(ActionKind::NONE, "No crafting opportunities", 0.1f);
 }
 
 // Environment Coordinator
@@ -53,12 +53,12 @@ EnvironmentCoordinator::EnvironmentCoordinator()
     std::cout << "[EnvironmentCoordinator] Fully initialized" << std::endl;
 }
 
-bool EnvironmentCoordinator::should_activate(const GameState& state) const {
+bool EnvironmentCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     return false;
 }
 
-Action EnvironmentCoordinator::decide(const GameState& state) {
-    return create_action("none", "Normal conditions", 0.1f);
+Action EnvironmentCoordinator::decide(const GameState& state, const StateSummary& summary) {
+    return create_action(ActionKind::NONE, "Normal conditions", 0.1f);
 }
 
 // Job-Specific Coordinator
@@ -67,7 +67,7 @@ JobSpecificCoordinator::JobSpecificCoordinator()
     std::cout << "[JobSpecificCoordinator] Fully initialized" << std::endl;
 }
 
-bool JobSpecificCoordinator::should_activate(const GameState& state) const {
+bool JobSpecificCoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     // Activate for support classes when players nearby
     std::string job = state.character.job_class;
     if (job == "Priest" || job == "Sage") {
@@ -78,16 +78,16 @@ bool JobSpecificCoordinator::should_activate(const GameState& state) const {
     return !state.monsters.empty();
 }
 
-Action JobSpecificCoordinator::decide(const GameState& state) {
+Action JobSpecificCoordinator::decide(const GameState& state, const StateSummary& summary) {
     std::string job = state.character.job_class;
     
     // Priest healing
     if (job == "Priest" || job == "Acolyte") {
         for (const auto& player : state.nearby_players) {
             if (player.distance <= 9) {
-                Action action = create_action("skill", "Heal party member", 0.90f);
-                action.parameters["skill"] = "Heal";
-                action.parameters["target"] = player.name;
+                Action action = create_action(ActionKind::SKILL, "Heal party member", 0.90f);
+                action.parameters.set(params::SKILL, "Heal");
+                action.parameters.set(params::TARGET, player.name);
                 return action;
             }
         }
@@ -96,13 +96,13 @@ Action JobSpecificCoordinator::decide(const GameState& state) {
     // Wizard AOE
     if (job == "Wizard" || job == "Magician") {
         if (state.monsters.size() >= 3) {
-            Action action = create_action("skill", "AOE on monsters", 0.85f);
-            action.parameters["skill"] = "Storm Gust";
+            Action action = create_action(ActionKind::SKILL, "AOE on monsters", 0.85f);
+            action.parameters.set(params::SKILL, "Storm Gust");
             return action;
         }
     }
     
-    return create_action("none", "No class-specific action", 0.1f);
+    return create_action(ActionKind::NONE, "No class-specific action", 0.1f);
 }
 
 // PvP/WoE Coordinator
@@ -111,13 +111,13 @@ PvPWoECoordinator::PvPWoECoordinator()
     std::cout << "[PvPWoECoordinator] Fully initialized" << std::endl;
 }
 
-bool PvPWoECoordinator::should_activate(const GameState& state) const {
+bool PvPWoECoordinator::should_activate(const GameState& state, const StateSummary& summary) const {
     // Would need pvp_zone flag in GameState
     return false;
 }
 
-Action PvPWoECoordinator::decide(const GameState& state) {
-    return create_action("none", "Not in PvP zone", 0.1f);
+Action PvPWoECoordinator::decide(const GameState& state, const StateSummary& summary) {
+    return create_action(ActionKind::NONE, "Not in PvP zone", 0.1f);
 }
 
 } // namespace coordinators
@@ -0,0 +1,205 @@
+#include "../include/decide_response.hpp"
+#include "../include/decision_pipeline.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace openkore_ai {
+
+namespace {
+
+// Appends a JSON string the way nlohmann::json escapes it: quotes, backslashes and control characters, the
+// rest as it is. Returns false at the first byte which isn't part of a valid UTF-8 sequence.
+bool write_string(std::string& out, std::string_view text) {
+    static const char HEX[] = "0123456789abcdef";
+    out.push_back('"');
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 0x80) {
+            // The length of the sequence and the range of its second byte, which rules out overlong forms,
+            // surrogates and code points past U+10FFFF
+            size_t length;
+            unsigned char low = 0x80, high = 0xBF;
+            if (c >= 0xC2 && c <= 0xDF) {
+                length = 2;
+            } else if (c >= 0xE0 && c <= 0xEF) {
+                length = 3;
+                if (c == 0xE0) low = 0xA0;
+                if (c == 0xED) high = 0x9F;
+            } else if (c >= 0xF0 && c <= 0xF4) {
+                length = 4;
+                if (c == 0xF0) low = 0x90;
+                if (c == 0xF4) high = 0x8F;
+            } else {
+                return false;
+            }
+            if (i + length > text.size()) {
+                return false;
+            }
+            for (size_t k = 1; k < length; k++) {
+                unsigned char next = static_cast<unsigned char>(text[i + k]);
+                if (next < (k == 1 ? low : 0x80) || next > (k == 1 ? high : 0xBF)) {
+                    return false;
+                }
+            }
+            out.append(text.data() + i, length);
+            i += length;
+            continue;
+        }
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out.push_back(HEX[c >> 4]);
+                    out.push_back(HEX[c & 0xF]);
+                } else {
+                    out.push_back(static_cast<char>(c));
+                }
+        }
+        i++;
+    }
+    out.push_back('"');
+    return true;
+}
+
+template <typename Integer>
+void write_integer(std::string& out, Integer value) {
+    char digits[24];
+    out.append(digits, std::to_chars(digits, digits + sizeof(digits), value).ptr);
+}
+
+// The shortest digits which read back as the same double, as nlohmann::json writes them: with ".0" when they
+// look like an integer, and null for infinities and NaN
+void write_double(std::string& out, double value) {
+    if (!std::isfinite(value)) {
+        out += "null";
+        return;
+    }
+    char digits[32];
+    char* end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+    out.append(digits, end);
+    if (std::find_if(digits, end, [](char c) { return c == '.' || c == 'e'; }) == end) {
+        out += ".0";
+    }
+}
+
+// The comma and key of a field after the first one
+void write_key(std::string& out, std::string_view key) {
+    out += ",\"";
+    out.append(key);
+    out += "\":";
+}
+
+} // namespace
+
+nlohmann::json decide_response_json(const DecideAnswer& answer) {
+    const DecisionResponse& decision = answer.decision;
+    nlohmann::json response_json;
+    response_json["action"] = action_to_json(decision.action);
+    response_json["tier_used"] = tier_to_string(decision.tier_used);
+    response_json["latency_ms"] = decision.latency_ms;
+    response_json["latency_us"] = decision.latency_us;
+    response_json["request_id"] = decision.request_id;
+    if (decision.skipped) {
+        nlohmann::json& skipped = response_json["skipped"] = nlohmann::json::array();
+        for (size_t component = 0; component < PIPELINE_COMPONENTS; component++) {
+            if (decision.skipped & component_bit(static_cast<PipelineComponent>(component))) {
+                skipped.push_back(component_name(static_cast<PipelineComponent>(component)));
+            }
+        }
+    }
+    if (!answer.session_id.empty()) {
+        response_json["session_id"] = answer.session_id;
+        response_json["state_version"] = answer.state_version;
+    }
+    return response_json;
+}
+
+bool write_decide_response(const DecideAnswer& answer, std::string& out) {
+    const DecisionResponse& decision = answer.decision;
+    const Action& action = decision.action;
+
+    // The keys in the order nlohmann::json keeps them, sorted
+    out += "{\"action\":{\"confidence\":";
+    write_double(out, static_cast<double>(action.confidence));
+    out += ",\"parameters\":{";
+    thread_local std::vector<std::pair<std::string_view, const std::string*>> parameters;
+    parameters.clear();
+    for (const auto& [key, value] : action.parameters) {
+        parameters.emplace_back(param_key_name(key), &value);
+    }
+    std::sort(parameters.begin(), parameters.end(),
+              [](const auto& a, const auto& b) { return a.first < b.first; });
+    for (size_t i = 0; i < parameters.size(); i++) {
+        if (i > 0) {
+            out.push_back(',');
+        }
+        if (!write_string(out, parameters[i].first)) {
+            return false;
+        }
+        out.push_back(':');
+        if (!write_string(out, *parameters[i].second)) {
+            return false;
+        }
+    }
+    out += "},\"reason\":";
+    if (!write_string(out, action.reason)) {
+        return false;
+    }
+    out += ",\"type\":";
+    if (!write_string(out, action.type_name())) {
+        return false;
+    }
+    out.push_back('}');
+
+    write_key(out, "latency_ms");
+    write_integer(out, decision.latency_ms);
+    write_key(out, "latency_us");
+    write_integer(out, decision.latency_us);
+    write_key(out, "request_id");
+    if (!write_string(out, decision.request_id)) {
+        return false;
+    }
+    if (!answer.session_id.empty()) {
+        write_key(out, "session_id");
+        if (!write_string(out, answer.session_id)) {
+            return false;
+        }
+    }
+    if (decision.skipped) {
+        write_key(out, "skipped");
+        out.push_back('[');
+        bool first = true;
+        for (size_t component = 0; component < PIPELINE_COMPONENTS; component++) {
+            if (decision.skipped & component_bit(static_cast<PipelineComponent>(component))) {
+                if (!first) {
+                    out.push_back(',');
+                }
+                first = false;
+                write_string(out, component_name(static_cast<PipelineComponent>(component)));
+            }
+        }
+        out.push_back(']');
+    }
+    if (!answer.session_id.empty()) {
+        write_key(out, "state_version");
+        write_integer(out, answer.state_version);
+    }
+    write_key(out, "tier_used");
+    write_string(out, tier_to_string(decision.tier_used));
+    out.push_back('}');
+    return true;
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,140 @@
+#include "../../include/decision/features.hpp"
+#include <algorithm>
+#include <ctime>
+#include <limits>
+
+namespace openkore_ai {
+namespace decision {
+
+namespace {
+
+float ratio(int value, int max) {
+    return static_cast<float>(value) / static_cast<float>(std::max(max, 1));
+}
+
+// The hour of day, cached for the minute
+float hour_of_day() {
+    thread_local std::time_t cached_minute = -1;
+    thread_local float cached_hour = 0.0f;
+    std::time_t now = std::time(nullptr);
+    if (now / 60 != cached_minute) {
+        std::tm local{};
+#ifdef _WIN32
+        localtime_s(&local, &now);
+#else
+        localtime_r(&now, &local);
+#endif
+        cached_minute = now / 60;
+        cached_hour = static_cast<float>(local.tm_hour) / 24.0f;
+    }
+    return cached_hour;
+}
+
+} // namespace
+
+void extract_features(const GameState& state, FeatureVector& features) {
+    float* f = features.values.data();
+    std::fill(features.values.begin(), features.values.end(), 0.0f);
+
+    // The model's features, computed as the Python service's FeatureExtractor.extract_features does
+    const CharacterState& character = state.character;
+    f[0] = static_cast<float>(character.level);
+    f[1] = ratio(character.hp, character.max_hp);
+    f[2] = ratio(character.sp, character.max_sp);
+    f[3] = ratio(character.weight, character.max_weight);
+    f[4] = std::min(character.zeny / 1000000.0f, 10.0f);
+    f[5] = std::min(character.base_exp / 10000000.0f, 10.0f);
+    f[6] = std::min(character.job_exp / 1000000.0f, 10.0f);
+    f[7] = static_cast<float>(character.status_effects.size());
+
+    // One pass over the monsters, keeping the nearest ones sorted by insertion
+    const std::vector<Monster>& monsters = state.monsters;
+    constexpr size_t K = FeatureVector::NEAREST_MONSTERS;
+    float nearest_distance[K];
+    const Monster* nearest[K];
+    size_t nearest_count = 0;
+    f[8] = static_cast<float>(std::min<size_t>(monsters.size(), 20));
+    if (!monsters.empty()) {
+        constexpr float most = std::numeric_limits<float>::max();
+        float distance_sum = 0.0f, aggressive = 0.0f, in_range = 0.0f;
+        float min_hp_ratio = most, min_distance = most, min_hp = most, max_distance = -most;
+        for (const Monster& monster : monsters) {
+            float distance = static_cast<float>(monster.distance);
+            distance_sum += distance;
+            aggressive += monster.is_aggressive;
+            in_range += distance <= 10.0f;
+            min_hp_ratio = std::min(min_hp_ratio, ratio(monster.hp, monster.max_hp));
+            min_distance = std::min(min_distance, distance);
+            max_distance = std::max(max_distance, distance);
+            min_hp = std::min(min_hp, static_cast<float>(monster.hp));
+
+            if (nearest_count < K || distance < nearest_distance[K - 1]) {
+                size_t i = nearest_count < K ? nearest_count++ : K - 1;
+                for (; i > 0 && nearest_distance[i - 1] > distance; i--) {
+                    nearest_distance[i] = nearest_distance[i - 1];
+                    nearest[i] = nearest[i - 1];
+                }
+                nearest_distance[i] = distance;
+                nearest[i] = &monster;
+            }
+        }
+        f[9] = distance_sum / static_cast<float>(monsters.size());
+        f[10] = aggressive;
+        f[11] = min_hp_ratio;
+        f[12] = max_distance;
+        f[13] = in_range;
+        f[14] = min_hp;
+        f[15] = min_distance;
+    }
+
+    const std::vector<Item>& inventory = state.inventory;
+    const ItemDatabase& items = ItemDatabase::shared();
+    float potions = 0.0f, equipment = 0.0f, value = 0.0f;
+    for (size_t i = 0; i < inventory.size(); i++) {
+        const Item& item = inventory[i];
+        potions += item.name.find("Potion") != std::string::npos;
+        const ItemInfo* info = items.find(item);
+        if (info && info->category != ItemCategory::OTHER) {
+            f[FeatureVector::ITEMS + static_cast<size_t>(info->category)] += static_cast<float>(item.amount);
+        }
+        equipment += item.type == "weapon" || item.type == "armor";
+        if (i < 10) {
+            value += static_cast<float>(item.amount) * 100.0f;
+        }
+    }
+    f[16] = static_cast<float>(inventory.size());
+    f[17] = potions;
+    f[18] = equipment;
+    f[19] = f[16] - potions - equipment;
+    f[20] = value;
+    f[21] = std::max(100.0f - f[16], 0.0f);
+
+    const std::vector<Player>& players = state.nearby_players;
+    float party = 0.0f, guild = 0.0f, player_distance = 0.0f;
+    for (const Player& player : players) {
+        party += player.is_party_member;
+        guild += !player.guild.empty();
+        player_distance += static_cast<float>(player.distance);
+    }
+    f[22] = static_cast<float>(players.size());
+    f[23] = party;
+    f[24] = guild;
+    f[25] = players.empty() ? 999.0f : player_distance / static_cast<float>(players.size());
+
+    // The session duration stays 0, the service starts its session at the query
+    f[26] = hour_of_day();
+
+    float* slot = f + FeatureVector::MONSTERS;
+    for (size_t i = 0; i < K; i++, slot += FeatureVector::MONSTER_FIELDS) {
+        if (i < nearest_count) {
+            slot[0] = std::min(nearest_distance[i] / FeatureVector::MONSTER_RANGE, 1.0f);
+            slot[1] = ratio(nearest[i]->hp, nearest[i]->max_hp);
+            slot[2] = nearest[i]->is_aggressive;
+        } else {
+            slot[0] = 1.0f;
+        }
+    }
+}
+
+} // namespace decision
+} // namespace openkore_ai
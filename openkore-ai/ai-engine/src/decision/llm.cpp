@@ -10,20 +10,19 @@ using json = nlohmann::json;
 namespace openkore_ai {
 namespace decision {
 
-LLMTier::LLMTier(const std::string& python_service_url)
-    : python_service_url_(python_service_url) {
+LLMTier::LLMTier(std::shared_ptr<ServiceClientPool> service, std::chrono::milliseconds timeout)
+    : service_(std::move(service)), timeout_(timeout), queries_(QUERY_THREADS) {
     // Note: Do not log in constructor as logger may not be initialized yet
     // Logging will occur on first use
-    std::cout << "[LLMTier] Constructor: Python service URL = " << python_service_url_ << std::endl;
+    std::cout << "[LLMTier] Constructor: Python service URL = " << service_->url() << std::endl;
 }
 
-bool LLMTier::should_handle(const GameState& state) const {
-    // Only use LLM for complex strategic decisions, and rate limit queries
-    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
-    
-    if (now_ms - last_query_time_ms_ < MIN_QUERY_INTERVAL_MS) {
+bool LLMTier::may_query(const GameState& state, const CharacterQueries* queries,
+                        std::chrono::steady_clock::time_point now) const {
+    if (pending_ >= MAX_PENDING_QUERIES) {
+        return false;
+    }
+    if (queries && (queries->pending || now - queries->last_query < MIN_QUERY_INTERVAL)) {
         return false;  // Too soon since last query
     }
     
@@ -31,56 +30,116 @@ bool LLMTier::should_handle(const GameState& state) const {
     // - Character level milestones (every 10 levels)
     // - When stuck (no action for extended period)
     // - Strategic planning (party formation, farming location changes)
-    
-    if (state.character.level % 10 == 0 && state.character.level >= 10) {
-        return true;  // Level milestone
+    return state.character.level % 10 == 0 && state.character.level >= 10;
+}
+
+bool LLMTier::should_handle(const GameState& state) const {
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = characters_.find(state.character.name);
+    const CharacterQueries* queries = it == characters_.end() ? nullptr : &it->second;
+    if (queries && queries->answer && now - queries->answered < ANSWER_TTL) {
+        return true;
+    }
+    return may_query(state, queries, now);
+}
+
+void LLMTier::trim(std::chrono::steady_clock::time_point now) {
+    for (auto it = characters_.begin(); it != characters_.end();) {
+        const CharacterQueries& queries = it->second;
+        bool waiting = queries.answer && now - queries.answered < ANSWER_TTL;
+        if (!queries.pending && !waiting && now - queries.last_query >= MIN_QUERY_INTERVAL) {
+            it = characters_.erase(it);
+        } else {
+            ++it;
+        }
     }
-    
-    return false;
 }
 
 Action LLMTier::decide(const GameState& state) {
     using namespace openkore_ai::logging;
-    auto start = std::chrono::steady_clock::now();
+    auto now = std::chrono::steady_clock::now();
     
-    Logger::info("Querying Python AI Service for strategic decision...", "LLMTier");
-    
-    auto result = query_python_service(state);
-    
-    auto end = std::chrono::steady_clock::now();
-    auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    Action action;
+    action.kind = ActionKind::NONE;
+    action.confidence = 0.2f;
     
-    std::ostringstream msg;
-    msg << "Query completed in " << latency_ms << "ms";
-    Logger::info(msg.str(), "LLMTier");
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = characters_.find(state.character.name);
+    if (it != characters_.end() && it->second.answer) {
+        std::optional<Action> answer = std::move(it->second.answer);
+        it->second.answer.reset();
+        if (now - it->second.answered < ANSWER_TTL) {
+            OKAI_LOG_INFO("LLMTier", "Strategic answer for " << state.character.name << ": " << answer->type_name());
+            return std::move(*answer);
+        }
+    }
     
-    // Update last query time
-    last_query_time_ms_ = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
+    if (!may_query(state, it == characters_.end() ? nullptr : &it->second, now)) {
+        action.reason = "LLM: No strategic action";
+        return action;
+    }
     
-    if (result.has_value()) {
-        return result.value();
+    if (it == characters_.end()) {
+        if (characters_.size() >= MAX_CHARACTERS) {
+            trim(now);
+        }
+        it = characters_.emplace(state.character.name, CharacterQueries()).first;
     }
+    it->second.pending = true;
+    it->second.last_query = now;
+    pending_++;
     
-    // Fallback if LLM query failed
-    Action action;
-    action.type = "none";
-    action.reason = "LLM: Query failed, no strategic action";
-    action.confidence = 0.2f;
+    // The state is copied, callers reuse theirs for the next request
+    queries_.submit([this, state] {
+        auto start = std::chrono::steady_clock::now();
+        std::optional<Action> result = answers_.get(strategy_fingerprint(state),
+                                                    [&] { return query_python_service(state); });
+        auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        OKAI_LOG_INFO("LLMTier", "Query for " << state.character.name << " completed in " << latency_ms << "ms");
+        
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_--;
+        CharacterQueries& queries = characters_[state.character.name];
+        queries.pending = false;
+        if (result) {
+            queries.answer = std::move(result);
+            queries.answered = std::chrono::steady_clock::now();
+        }
+    });
+    
+    Logger::info("Querying Python AI Service for strategic decision...", "LLMTier");
+    action.reason = "LLM: Strategic query sent, the answer comes with a later decision";
     return action;
 }
 
+uint64_t LLMTier::strategy_fingerprint(const GameState& state) {
+    // The fields of game_state_to_json which matter for a strategy, HP and SP in 10% steps
+    Fingerprint fingerprint;
+    const CharacterState& character = state.character;
+    fingerprint.add(character.job_class)
+        .add(character.level)
+        .add(character.position.map)
+        .add_ratio(character.hp, character.max_hp, 10)
+        .add_ratio(character.sp, character.max_sp, 10);
+    fingerprint.add_unordered(state.monsters, [](Fingerprint& item, const Monster& monster) {
+        item.add(monster.name).add(monster.is_aggressive);
+    });
+    return fingerprint.value();
+}
+
 std::optional<Action> LLMTier::query_python_service(const GameState& state) {
     using namespace openkore_ai::logging;
     
     try {
         Logger::debug("Connecting to Python AI Service...", "LLMTier");
         
-        // Parse URL
-        httplib::Client client("http://127.0.0.1:9902");
-        client.set_connection_timeout(5, 0);  // 5 seconds connection timeout
-        client.set_read_timeout(300, 0);       // 300 seconds read timeout (5 minutes)
+        ServiceClientPool::Lease client = service_->acquire(timeout_);
+        if (!client) {
+            OKAI_LOG_ERROR("LLMTier", "No free connection to the Python service at " << service_->url());
+            return std::nullopt;
+        }
         
         // Build request
         json request_json;
@@ -89,23 +148,22 @@ std::optional<Action> LLMTier::query_python_service(const GameState& state) {
         request_json["context"] = "Strategic planning for character progression";
         request_json["request_id"] = "llm_" + std::to_string(state.timestamp_ms);
         
-        Logger::log_request("POST", "/api/v1/llm/query", request_json.dump(), request_json.dump().size());
+        std::string request_body = request_json.dump();
+        Logger::log_request("POST", "/api/v1/llm/query", request_body, request_body.size());
         
         // Send POST request
-        auto response = client.Post("/api/v1/llm/query",
-                                   request_json.dump(),
+        auto response = client->Post("/api/v1/llm/query",
+                                   request_body,
                                    "application/json");
         
         if (!response) {
-            Logger::error("Failed to connect to Python service at http://127.0.0.1:9902", "LLMTier");
+            OKAI_LOG_ERROR("LLMTier", "Failed to connect to Python service at " << service_->url());
             return std::nullopt;
         }
         
         if (response->status != 200) {
-            std::ostringstream msg;
-            msg << "Python service returned error status: " << response->status;
-            Logger::error(msg.str(), "LLMTier");
-            Logger::debug("Response body: " + response->body, "LLMTier");
+            OKAI_LOG_ERROR("LLMTier", "Python service returned error status: " << response->status);
+            OKAI_LOG_DEBUG("LLMTier", "Response body: " << response->body);
             return std::nullopt;
         }
         
@@ -117,18 +175,18 @@ std::optional<Action> LLMTier::query_python_service(const GameState& state) {
         
         if (response_json.contains("action") && !response_json["action"].is_null()) {
             Action action;
-            action.type = response_json["action"]["type"];
+            action.set_type(response_json["action"]["type"].get<std::string>());
             action.reason = response_json["action"]["reason"];
             action.confidence = response_json["action"]["confidence"];
             
             // Parse parameters
             if (response_json["action"].contains("parameters")) {
                 for (auto& [key, value] : response_json["action"]["parameters"].items()) {
-                    action.parameters[key] = value.get<std::string>();
+                    action.parameters.set(param_key(key), value.get<std::string>());
                 }
             }
             
-            Logger::info("Successfully parsed LLM action: " + action.type, "LLMTier");
+            OKAI_LOG_INFO("LLMTier", "Successfully parsed LLM action: " << action.type_name());
             return action;
         }
         
@@ -136,7 +194,7 @@ std::optional<Action> LLMTier::query_python_service(const GameState& state) {
         return std::nullopt;
         
     } catch (const std::exception& e) {
-        Logger::error(std::string("Exception during query: ") + e.what(), "LLMTier");
+        OKAI_LOG_ERROR("LLMTier", "Exception during query: " << e.what());
         return std::nullopt;
     }
 }
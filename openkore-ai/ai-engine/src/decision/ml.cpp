@@ -1,4 +1,9 @@
 #include "../../include/decision/ml.hpp"
+#include "../../include/logger.hpp"
+#include "../../include/state_corpus.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
 #include <iostream>
 #include <httplib.h>
 #include <nlohmann/json.hpp>
@@ -8,142 +13,257 @@ using json = nlohmann::json;
 namespace openkore_ai {
 namespace decision {
 
-MLTier::MLTier() {
+namespace {
+
+// Whether ONNX Runtime's int8 kernels get the CPU's dot product instructions, where quantized models gain most
+bool has_vnni() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_cpu_supports("avx512vnni");
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
+MLTier::MLTier(std::shared_ptr<ServiceClientPool> service, const std::string& model_path, size_t batch_size,
+               std::chrono::microseconds batch_delay, const QuantizedModel& quantized)
+    : service_(std::move(service)) {
     std::cout << "[MLTier] Initialized (Phase 6 - ML Pipeline ready)" << std::endl;
-    model_loaded_ = false;  // Will be set true when model available
     
     // Check if ONNX model exists and load it
-    load_onnx_model();
+    load_onnx_model(model_path, quantized);
+    
+    if (batch_size > 1 && model_) {
+        model_batches_ = std::make_unique<MicroBatcher<FeatureVector, OnnxModel::Prediction>>(
+            [this, predictions = std::vector<OnnxModel::Prediction>()](
+                std::span<const FeatureVector> rows, std::vector<std::optional<OnnxModel::Prediction>>& results) mutable {
+                model_->predict(rows, predictions);
+                std::copy(predictions.begin(), predictions.end(), results.begin());
+            },
+            batch_size, batch_delay);
+    } else if (batch_size > 1) {
+        service_batches_ = std::make_unique<MicroBatcher<FeatureVector, Action>>(
+            [this](std::span<const FeatureVector> rows, std::vector<std::optional<Action>>& results) {
+                fetch_predictions(rows, results);
+            },
+            batch_size, batch_delay);
+    }
+}
+
+size_t MLTier::batches() const {
+    return model_batches_ ? model_batches_->batches() : service_batches_ ? service_batches_->batches() : 0;
+}
+
+size_t MLTier::batched_predictions() const {
+    return model_batches_ ? model_batches_->rows() : service_batches_ ? service_batches_->rows() : 0;
 }
 
 bool MLTier::should_handle(const GameState& state) const {
-    // Phase 6: Check with Python service if ML should be used
-    // For now, defer to Python service cold-start manager
-    return false;  // Python service will handle ML queries
+    // Without the model, defer to the Python service's cold-start manager
+    return model_ != nullptr;
 }
 
 Action MLTier::decide(const GameState& state) {
+    if (model_) {
+        FeatureVector features;
+        extract_features(state, features);
+        if (std::optional<Action> action = predict_in_process(features)) {
+            return std::move(*action);
+        }
+    }
     // Phase 6: Query Python service for ML prediction
     return query_ml_service(state);
 }
 
+std::optional<Action> MLTier::predict_in_process(const FeatureVector& features) {
+    try {
+        if (model_batches_) {
+            std::optional<OnnxModel::Prediction> prediction = model_batches_->run(features);
+            return prediction ? std::optional<Action>(action_of(*prediction)) : std::nullopt;
+        }
+        return action_of(model_->predict(features));
+    } catch (const std::exception& e) {
+        OKAI_LOG_WARNING("MLTier", e.what());
+        return std::nullopt;
+    }
+}
+
+Action MLTier::action_of(const OnnxModel::Prediction& prediction) {
+    // The service's action_map
+    static constexpr ActionKind kinds[] = {ActionKind::ATTACK, ActionKind::SKILL, ActionKind::MOVE,
+                                           ActionKind::ITEM, ActionKind::NONE};
+    Action action;
+    action.kind = prediction.label >= 0 && prediction.label <= OnnxModel::NONE ? kinds[prediction.label]
+                                                                                : ActionKind::NONE;
+    char reason[64];
+    std::snprintf(reason, sizeof(reason), "ML prediction (confidence: %.2f)", prediction.confidence);
+    action.reason = reason;
+    action.confidence = prediction.confidence;
+    OKAI_TRACE("MLTier", "In-process prediction: " << action.type_name() << " (confidence: "
+               << action.confidence << ")");
+    return action;
+}
+
+std::optional<Action> MLTier::decide_cached(const GameState& state) {
+    return predictions_.peek(prediction_fingerprint(state));
+}
+
 Action MLTier::query_ml_service(const GameState& state) {
+    // Bots in the same situation share one prediction
+    std::optional<Action> prediction = predictions_.get(prediction_fingerprint(state), [&] {
+        FeatureVector features;
+        extract_features(state, features);
+        return fetch_prediction(features);
+    });
+    return prediction ? std::move(*prediction) : decide_fallback(state);
+}
+
+uint64_t MLTier::prediction_fingerprint(const GameState& state) {
+    // The fields the features depend on most, ratios in 5% steps and distances in steps of 2 cells, in any list order
+    Fingerprint fingerprint;
+    const CharacterState& character = state.character;
+    fingerprint.add(character.level)
+        .add_ratio(character.hp, character.max_hp, 20)
+        .add_ratio(character.sp, character.max_sp, 20)
+        .add_ratio(character.weight, character.max_weight, 20);
+    fingerprint.add_unordered(state.monsters, [](Fingerprint& item, const Monster& monster) {
+        item.add(monster.name).add_ratio(monster.hp, monster.max_hp, 20).add(monster.distance / 2)
+            .add(monster.is_aggressive);
+    });
+    fingerprint.add_unordered(state.inventory, [](Fingerprint& entry, const Item& item) {
+        entry.add(item.name).add(item.amount);
+    });
+    return fingerprint.value();
+}
+
+std::optional<Action> MLTier::fetch_prediction(const FeatureVector& features) {
+    if (service_batches_) {
+        return service_batches_->run(features);
+    }
+    std::vector<std::optional<Action>> actions(1);
+    fetch_predictions(std::span<const FeatureVector>(&features, 1), actions);
+    return std::move(actions[0]);
+}
+
+void MLTier::fetch_predictions(std::span<const FeatureVector> rows, std::vector<std::optional<Action>>& actions) {
     try {
-        httplib::Client client("http://127.0.0.1:9902");
-        client.set_read_timeout(5, 0);
+        ServiceClientPool::Lease client = service_->acquire(QUERY_TIMEOUT);
+        if (!client) {
+            OKAI_LOG_WARNING("MLTier", "No free connection to the Python service");
+            return;
+        }
         
-        // Build request
+        // The service takes the model's rows as they are, instead of extracting them from the states again
         json request_json;
-        request_json["game_state"] = state_to_json(state);
+        json& features = request_json["features"] = json::array();
+        for (const FeatureVector& row : rows) {
+            std::span<const float> input = row.model_input();
+            features.push_back(std::vector<float>(input.begin(), input.end()));
+        }
         request_json["request_type"] = "ml_prediction";
         
-        auto response = client.Post("/api/v1/ml/predict",
+        auto response = client->Post("/api/v1/ml/predict",
                                    request_json.dump(),
                                    "application/json");
         
         if (response && response->status == 200) {
             json result = json::parse(response->body);
+            const json& predicted = result["actions"];
             
-            Action action;
-            action.type = result["action"]["type"];
-            action.reason = result["action"]["reason"];
-            action.confidence = result["action"]["confidence"];
-            
-            // Parse parameters
-            if (result["action"].contains("parameters")) {
-                for (auto& [key, value] : result["action"]["parameters"].items()) {
-                    if (value.is_string()) {
-                        action.parameters[key] = value.get<std::string>();
-                    } else {
-                        action.parameters[key] = value.dump();
+            for (size_t i = 0; i < rows.size() && i < predicted.size(); i++) {
+                Action action;
+                action.set_type(predicted[i]["type"].get<std::string>());
+                action.reason = predicted[i]["reason"];
+                action.confidence = predicted[i]["confidence"];
+                
+                // Parse parameters
+                if (predicted[i].contains("parameters")) {
+                    for (auto& [key, value] : predicted[i]["parameters"].items()) {
+                        if (value.is_string()) {
+                            action.parameters.set(param_key(key), value.get<std::string>());
+                        } else {
+                            action.parameters.set(param_key(key), value.dump());
+                        }
                     }
                 }
+                
+                OKAI_TRACE("MLTier", "Prediction: " << action.type_name() << " (confidence: " << action.confidence << ")");
+                actions[i] = std::move(action);
             }
-            
-            std::cout << "[MLTier] Prediction: " << action.type 
-                     << " (confidence: " << action.confidence << ")" << std::endl;
-            
-            return action;
         } else {
-            std::cerr << "[MLTier] HTTP error: " 
-                     << (response ? response->status : -1) << std::endl;
+            OKAI_LOG_WARNING("MLTier", "HTTP error: " << (response ? response->status : -1));
         }
         
     } catch (const std::exception& e) {
-        std::cerr << "[MLTier] Query failed: " << e.what() << std::endl;
+        OKAI_LOG_WARNING("MLTier", "Query failed: " << e.what());
     }
-    
-    return decide_fallback(state);
-}
-
-json MLTier::state_to_json(const GameState& state) const {
-    json j;
-    
-    // Character info
-    j["character"]["level"] = state.character.level;
-    j["character"]["hp"] = state.character.hp;
-    j["character"]["max_hp"] = state.character.max_hp;
-    j["character"]["sp"] = state.character.sp;
-    j["character"]["max_sp"] = state.character.max_sp;
-    j["character"]["weight"] = state.character.weight;
-    j["character"]["max_weight"] = state.character.max_weight;
-    j["character"]["zeny"] = state.character.zeny;
-    j["character"]["base_exp"] = state.character.base_exp;
-    j["character"]["job_exp"] = state.character.job_exp;
-    j["character"]["status_effects"] = json::array();
-    
-    // Monsters
-    j["monsters"] = json::array();
-    for (const auto& monster : state.monsters) {
-        json m;
-        m["name"] = monster.name;
-        m["hp"] = monster.hp;
-        m["max_hp"] = monster.max_hp;
-        m["distance"] = monster.distance;
-        m["is_aggressive"] = monster.is_aggressive;
-        j["monsters"].push_back(m);
-    }
-    
-    // Inventory
-    j["inventory"] = json::array();
-    for (const auto& item : state.inventory) {
-        json i;
-        i["name"] = item.name;
-        i["amount"] = item.amount;
-        i["type"] = item.type;
-        j["inventory"].push_back(i);
-    }
-    
-    // Players
-    j["nearby_players"] = json::array();
-    
-    return j;
 }
 
 Action MLTier::decide_fallback(const GameState& state) {
     Action action;
-    action.type = "none";
+    action.kind = ActionKind::NONE;
     action.reason = "ML: Model not loaded or service unavailable";
     action.confidence = 0.1f;
     return action;
 }
 
-void MLTier::load_onnx_model() {
-    // Check for ONNX model file
-    const std::string model_path = "../models/decision_model.onnx";
-    
-    // Note: Full ONNX Runtime integration requires linking against ONNX Runtime library
-    // For now, we rely on Python service for ML inference via HTTP
-    // To enable C++ inference:
-    // 1. Install ONNX Runtime: https://onnxruntime.ai/
-    // 2. Link against onnxruntime library in CMakeLists.txt
-    // 3. Include <onnxruntime/core/session/onnxruntime_cxx_api.h>
-    // 4. Create Ort::Env, Ort::Session, run inference
+void MLTier::load_onnx_model(const std::string& path, const QuantizedModel& quantized) {
+    model_ = OnnxModel::load(path);
+    if (model_ && !quantized.path.empty()) {
+        use_quantized_model(quantized);
+    }
+    if (model_) {
+        std::cout << "[MLTier] Predicting in-process with " << path << std::endl;
+    } else {
+        std::cout << "[MLTier] ML inference deferred to Python service (HTTP API)" << std::endl;
+    }
+}
+
+void MLTier::use_quantized_model(const QuantizedModel& quantized) {
+    std::unique_ptr<OnnxModel> candidate = OnnxModel::load(quantized.path);
+    if (!candidate) {
+        OKAI_LOG_WARNING("MLTier", "No quantized model at " << quantized.path << ", predicting with the fp32 model");
+        return;
+    }
     
-    std::cout << "[MLTier] ONNX loading deferred to Python service (HTTP API)" << std::endl;
-    std::cout << "[MLTier] Python service handles ML model training and inference" << std::endl;
+    // Both models predict for the recorded states, the quantized one must mostly come to the same labels
+    std::vector<FeatureVector> rows;
+    OnnxModel::Agreement agreement;
+    try {
+        std::vector<GameState> states;
+        load_states(quantized.check_states, states, quantized.check_limit);
+        rows.resize(states.size());
+        for (size_t i = 0; i < states.size(); i++) {
+            extract_features(states[i], rows[i]);
+        }
+        if (!rows.empty()) {
+            agreement = candidate->compare(*model_, rows);
+        }
+    } catch (const std::exception& e) {
+        OKAI_LOG_WARNING("MLTier", "Quantized model not checked, predicting with the fp32 model: " << e.what());
+        return;
+    }
+    if (rows.empty()) {
+        OKAI_LOG_WARNING("MLTier", "No recorded states in " << quantized.check_states
+                         << " to check the quantized model with, predicting with the fp32 model");
+        return;
+    }
     
-    model_loaded_ = false;  // C++ uses Python service, not direct ONNX
+    char summary[160];
+    std::snprintf(summary, sizeof(summary), "agrees on %.1f%% of %zu recorded states, confidences %.3f apart, "
+                  "%.1fx as fast", agreement.ratio() * 100, agreement.rows, agreement.confidence_difference,
+                  agreement.time.count() > 0 ? static_cast<double>(agreement.reference_time.count())
+                                                   / agreement.time.count() : 0.0);
+    if (agreement.ratio() < quantized.min_agreement) {
+        OKAI_LOG_WARNING("MLTier", quantized.path << " " << summary << ", below " << quantized.min_agreement * 100
+                         << "%: predicting with the fp32 model");
+        return;
+    }
+    OKAI_LOG_INFO("MLTier", "Predicting with " << quantized.path << ", which " << summary
+                  << (has_vnni() ? " (VNNI kernels)" : ""));
+    model_ = std::move(candidate);
+    quantized_ = true;
 }
 
 } // namespace decision
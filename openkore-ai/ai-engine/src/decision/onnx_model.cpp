@@ -0,0 +1,240 @@
+#include "../../include/decision/onnx_model.hpp"
+#include "../../include/logger.hpp"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <stdexcept>
+
+#ifdef OPENKORE_AI_WITH_ONNX
+#include <onnxruntime_cxx_api.h>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace openkore_ai {
+namespace decision {
+
+#ifdef OPENKORE_AI_WITH_ONNX
+
+namespace {
+
+// Input and output tensors over buffers of their own, reused by each run and only bound again when the
+// number of rows changes
+struct Binding {
+    explicit Binding(Ort::Session& session) : io(session) {}
+
+    void bind(size_t rows, const Ort::MemoryInfo& memory, const char* input_name, const char* label_name,
+              const char* probability_name) {
+        if (rows == bound_rows) {
+            return;
+        }
+        input.resize(rows * OnnxModel::FEATURE_COUNT);
+        labels.resize(rows);
+        const int64_t input_shape[] = {static_cast<int64_t>(rows), OnnxModel::FEATURE_COUNT};
+        const int64_t label_shape[] = {static_cast<int64_t>(rows)};
+        input_tensor = Ort::Value::CreateTensor<float>(memory, input.data(), input.size(), input_shape, 2);
+        label_tensor = Ort::Value::CreateTensor<int64_t>(memory, labels.data(), labels.size(), label_shape, 1);
+        io.BindInput(input_name, input_tensor);
+        io.BindOutput(label_name, label_tensor);
+        // The probabilities are a map per row with skl2onnx's defaults, ONNX Runtime allocates those
+        if (probability_name) {
+            io.BindOutput(probability_name, memory);
+        }
+        bound_rows = rows;
+    }
+
+    std::vector<float> input;
+    std::vector<int64_t> labels;
+    size_t bound_rows = 0;
+    Ort::Value input_tensor{nullptr};
+    Ort::Value label_tensor{nullptr};
+    Ort::IoBinding io;
+};
+
+// Probability of row's 'label' in the second output, a [rows, labels] tensor or a sequence of label maps
+float label_probability(Ort::Value& probabilities, size_t row, int64_t label) {
+    Ort::AllocatorWithDefaultOptions allocator;
+    if (probabilities.IsTensor()) {
+        std::vector<int64_t> shape = probabilities.GetTensorTypeAndShapeInfo().GetShape();
+        size_t labels = shape.size() == 2 ? static_cast<size_t>(shape[1]) : 0;
+        return label >= 0 && static_cast<size_t>(label) < labels
+                   ? probabilities.GetTensorData<float>()[row * labels + label] : 0.0f;
+    }
+    if (probabilities.GetCount() <= row) {
+        return 1.0f;
+    }
+    Ort::Value map = probabilities.GetValue(static_cast<int>(row), allocator);
+    Ort::Value keys = map.GetValue(0, allocator);
+    Ort::Value values = map.GetValue(1, allocator);
+    size_t count = keys.GetTensorTypeAndShapeInfo().GetElementCount();
+    const int64_t* key = keys.GetTensorData<int64_t>();
+    for (size_t i = 0; i < count; i++) {
+        if (key[i] == label) {
+            return values.GetTensorData<float>()[i];
+        }
+    }
+    return 0.0f;
+}
+
+} // namespace
+
+struct OnnxModel::Impl {
+    Impl(const std::filesystem::path& path, const Ort::SessionOptions& options)
+        : session(env(), path.c_str(), options),
+          memory(Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault)) {
+        Ort::AllocatorWithDefaultOptions allocator;
+        input_name = session.GetInputNameAllocated(0, allocator);
+        label_name = session.GetOutputNameAllocated(0, allocator);
+        if (session.GetOutputCount() > 1) {
+            probability_name = session.GetOutputNameAllocated(1, allocator);
+        }
+    }
+
+    // One environment for the process, as ONNX Runtime wants
+    static Ort::Env& env() {
+        static Ort::Env instance(ORT_LOGGING_LEVEL_WARNING, "openkore-ai");
+        return instance;
+    }
+
+    Ort::Session session;
+    Ort::MemoryInfo memory;
+    Ort::AllocatedStringPtr input_name{nullptr, Ort::detail::AllocatedFree(nullptr)};
+    Ort::AllocatedStringPtr label_name{nullptr, Ort::detail::AllocatedFree(nullptr)};
+    Ort::AllocatedStringPtr probability_name{nullptr, Ort::detail::AllocatedFree(nullptr)};
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Binding>> idle;  // bindings of finished runs
+};
+
+bool OnnxModel::available() {
+    return true;
+}
+
+std::unique_ptr<OnnxModel> OnnxModel::load(const std::string& path) {
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error)) {
+        OKAI_LOG_INFO("OnnxModel", "No model at " << path);
+        return nullptr;
+    }
+    try {
+        Ort::SessionOptions options;
+        // Each decision thread runs its own predictions, a small model gains nothing from more threads
+        options.SetIntraOpNumThreads(1);
+        options.SetInterOpNumThreads(1);
+        options.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_ENABLE_ALL);
+        auto impl = std::make_unique<Impl>(std::filesystem::path(path), options);
+
+        std::vector<int64_t> shape = impl->session.GetInputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+        if (shape.size() != 2 || shape[1] != static_cast<int64_t>(FEATURE_COUNT)) {
+            OKAI_LOG_WARNING("OnnxModel", path << " doesn't take rows of " << FEATURE_COUNT << " features");
+            return nullptr;
+        }
+        OKAI_LOG_INFO("OnnxModel", "Loaded " << path);
+        return std::unique_ptr<OnnxModel>(new OnnxModel(std::move(impl)));
+    } catch (const Ort::Exception& e) {
+        OKAI_LOG_WARNING("OnnxModel", "Can't load " << path << ": " << e.what());
+        return nullptr;
+    }
+}
+
+OnnxModel::Prediction OnnxModel::predict(const FeatureVector& features) {
+    std::vector<Prediction> predictions;
+    predict(std::span<const FeatureVector>(&features, 1), predictions);
+    return predictions[0];
+}
+
+void OnnxModel::predict(std::span<const FeatureVector> rows, std::vector<Prediction>& predictions) {
+    std::unique_ptr<Binding> binding;
+    {
+        std::lock_guard<std::mutex> lock(impl_->mutex);
+        if (!impl_->idle.empty()) {
+            binding = std::move(impl_->idle.back());
+            impl_->idle.pop_back();
+        }
+    }
+    predictions.assign(rows.size(), Prediction{NONE, 0.0f});
+    try {
+        if (!binding) {
+            binding = std::make_unique<Binding>(impl_->session);
+        }
+        binding->bind(rows.size(), impl_->memory, impl_->input_name.get(), impl_->label_name.get(),
+                      impl_->probability_name.get());
+        float* input = binding->input.data();
+        for (const FeatureVector& row : rows) {
+            std::span<const float, FEATURE_COUNT> features = row.model_input();
+            input = std::copy(features.begin(), features.end(), input);
+        }
+        impl_->session.Run(Ort::RunOptions{nullptr}, binding->io);
+        std::vector<Ort::Value> outputs;
+        if (impl_->probability_name) {
+            outputs = binding->io.GetOutputValues();
+        }
+        for (size_t i = 0; i < rows.size(); i++) {
+            predictions[i].label = binding->labels[i];
+            predictions[i].confidence = outputs.size() > 1 ? label_probability(outputs[1], i, binding->labels[i])
+                                                           : 1.0f;
+        }
+    } catch (const Ort::Exception& e) {
+        throw std::runtime_error(std::string("ONNX inference failed: ") + e.what());
+    }
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->idle.push_back(std::move(binding));
+}
+
+#else
+
+struct OnnxModel::Impl {};
+
+bool OnnxModel::available() {
+    return false;
+}
+
+std::unique_ptr<OnnxModel> OnnxModel::load(const std::string& path) {
+    std::error_code error;
+    if (std::filesystem::is_regular_file(path, error)) {
+        OKAI_LOG_INFO("OnnxModel", "Built without OPENKORE_AI_ONNX, " << path << " is left to the Python service");
+    }
+    return nullptr;
+}
+
+OnnxModel::Prediction OnnxModel::predict(const FeatureVector&) {
+    throw std::runtime_error("ONNX Runtime is not built in");
+}
+
+void OnnxModel::predict(std::span<const FeatureVector>, std::vector<Prediction>&) {
+    throw std::runtime_error("ONNX Runtime is not built in");
+}
+
+#endif
+
+OnnxModel::Agreement OnnxModel::compare(OnnxModel& reference, std::span<const FeatureVector> rows) {
+    constexpr size_t BATCH = 256;
+    Agreement agreement;
+    std::vector<Prediction> expected;
+    std::vector<Prediction> predicted;
+    for (size_t first = 0; first < rows.size(); first += BATCH) {
+        std::span<const FeatureVector> batch = rows.subspan(first, std::min(BATCH, rows.size() - first));
+        auto start = std::chrono::steady_clock::now();
+        reference.predict(batch, expected);
+        auto middle = std::chrono::steady_clock::now();
+        predict(batch, predicted);
+        agreement.reference_time += middle - start;
+        agreement.time += std::chrono::steady_clock::now() - middle;
+        for (size_t i = 0; i < batch.size(); i++) {
+            agreement.same_labels += predicted[i].label == expected[i].label;
+            agreement.confidence_difference += std::fabs(predicted[i].confidence - expected[i].confidence);
+        }
+        agreement.rows += batch.size();
+    }
+    if (agreement.rows > 0) {
+        agreement.confidence_difference /= agreement.rows;
+    }
+    return agreement;
+}
+
+OnnxModel::OnnxModel(std::unique_ptr<Impl> impl) : impl_(std::move(impl)) {}
+
+OnnxModel::~OnnxModel() = default;
+
+} // namespace decision
+} // namespace openkore_ai
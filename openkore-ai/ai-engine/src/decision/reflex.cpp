@@ -1,129 +1,76 @@
 #include "../../include/decision/reflex.hpp"
-#include <algorithm>
+#include <bit>
 #include <iostream>
+#include <string_view>
 
 namespace openkore_ai {
 namespace decision {
 
+namespace {
+
+// Answer to each emergency, in the order of ReflexTier::Emergency
+struct Reflex {
+    ActionKind kind;
+    ParamKey key;
+    std::string_view value;
+    std::string_view reason;
+};
+
+constexpr Reflex REFLEXES[] = {
+    {ActionKind::ITEM, params::ITEM, "White Potion", "Reflex: HP critical (<25%), emergency healing"},
+    {ActionKind::ITEM, params::ITEM, "Green Potion", "Reflex: Dangerous status effect detected"},  // Status recovery
+    {ActionKind::ITEM, params::ITEM, "Red Potion", "Reflex: Low HP while under attack"},
+    {ActionKind::COMMAND, params::COMMAND, "storage", "Reflex: Overweight, need to store items"},
+    {ActionKind::ITEM, params::ITEM, "Blue Potion", "Reflex: SP critically low"},
+};
+
+} // namespace
+
 ReflexTier::ReflexTier() {
+    static_assert(std::size(REFLEXES) == EMERGENCY_COUNT);
     std::cout << "[ReflexTier] Initialized" << std::endl;
 }
 
-bool ReflexTier::should_handle(const GameState& state) const {
-    // Only handle true emergencies
-    if (is_hp_critical(state)) return true;
-    if (has_dangerous_status(state)) return true;
-    if (is_overweight(state)) return true;
-    
-    // Being attacked with low HP (not critical but concerning)
-    if (is_being_attacked(state)) {
-        float hp_ratio = static_cast<float>(state.character.hp) / state.character.max_hp;
-        if (hp_ratio < HP_LOW_THRESHOLD) {
-            return true;
-        }
-    }
-    
-    // SP low for magic classes
-    if (is_sp_low(state)) {
-        return true;
-    }
-    
-    return false;
+uint32_t ReflexTier::emergencies(const StateSummary& summary) {
+    return static_cast<uint32_t>(summary.hp_ratio < HP_CRITICAL_THRESHOLD) << HP_CRITICAL
+        | static_cast<uint32_t>((summary.statuses & status::DANGEROUS) != 0) << DANGEROUS_STATUS
+        | static_cast<uint32_t>((summary.monsters().aggressive_within(StateSummary::ATTACK_RANGE) > 0)
+                                & (summary.hp_ratio < HP_LOW_THRESHOLD)) << ATTACKED_WITH_LOW_HP
+        | static_cast<uint32_t>(summary.weight_ratio >= WEIGHT_CRITICAL_THRESHOLD) << OVERWEIGHT
+        | static_cast<uint32_t>(summary.sp_ratio < SP_LOW_THRESHOLD) << SP_LOW;
 }
 
-Action ReflexTier::decide(const GameState& state) {
-    Action action;
-    action.confidence = 0.95f;
-    
-    // Priority 1: Critical HP - use healing item immediately
-    if (is_hp_critical(state)) {
-        action.type = "item";
-        action.parameters["item"] = "White Potion";
-        action.reason = "Reflex: HP critical (<25%), emergency healing";
-        return action;
-    }
-    
-    // Priority 2: Dangerous status effects (stunned, frozen, stone curse)
-    if (has_dangerous_status(state)) {
-        action.type = "item";
-        action.parameters["item"] = "Green Potion";  // Status recovery
-        action.reason = "Reflex: Dangerous status effect detected";
-        return action;
-    }
-    
-    // Priority 3: Being attacked with low HP
-    if (is_hp_critical(state) || (state.character.hp < state.character.max_hp * HP_LOW_THRESHOLD && is_being_attacked(state))) {
-        action.type = "item";
-        action.parameters["item"] = "Red Potion";
-        action.reason = "Reflex: Low HP while under attack";
-        return action;
-    }
-    
-    // Priority 4: Overweight (can't move efficiently)
-    if (is_overweight(state)) {
-        action.type = "command";
-        action.parameters["command"] = "storage";
-        action.reason = "Reflex: Overweight, need to store items";
-        return action;
-    }
-    
-    // Priority 5: Low SP (for magic users)
-    if (is_sp_low(state)) {
-        action.type = "item";
-        action.parameters["item"] = "Blue Potion";
-        action.reason = "Reflex: SP critically low";
-        return action;
-    }
-    
-    // No reflex action needed
-    action.type = "none";
-    action.reason = "Reflex: No emergency detected";
-    action.confidence = 0.5f;
-    return action;
+bool ReflexTier::should_handle(const GameState& state) const {
+    return should_handle(state, StateSummary(state));
 }
 
-bool ReflexTier::is_hp_critical(const GameState& state) const {
-    if (state.character.max_hp == 0) return false;
-    float hp_ratio = static_cast<float>(state.character.hp) / state.character.max_hp;
-    return hp_ratio < HP_CRITICAL_THRESHOLD;
+bool ReflexTier::should_handle(const GameState& state, const StateSummary& summary) const {
+    // Only handle true emergencies
+    return emergencies(summary) != 0;
 }
 
-bool ReflexTier::is_sp_low(const GameState& state) const {
-    if (state.character.max_sp == 0) return false;
-    float sp_ratio = static_cast<float>(state.character.sp) / state.character.max_sp;
-    return sp_ratio < SP_LOW_THRESHOLD;
+Action ReflexTier::decide(const GameState& state) {
+    return decide(state, StateSummary(state));
 }
 
-bool ReflexTier::is_being_attacked(const GameState& state) const {
-    // Check if any nearby monsters are aggressive
-    for (const auto& monster : state.monsters) {
-        if (monster.is_aggressive && monster.distance <= 5) {
-            return true;
-        }
+Action ReflexTier::decide(const GameState& state, const StateSummary& summary) {
+    Action action;
+    uint32_t found = emergencies(summary);
+    if (found == 0) {
+        // No reflex action needed
+        action.kind = ActionKind::NONE;
+        action.reason = "Reflex: No emergency detected";
+        action.confidence = 0.5f;
+        return action;
     }
-    return false;
-}
-
-bool ReflexTier::has_dangerous_status(const GameState& state) const {
-    // Dangerous status effects that need immediate action
-    const std::vector<std::string> dangerous_statuses = {
-        "Stunned", "Frozen", "Stone Curse", "Sleep", "Blind", "Silence"
-    };
     
-    for (const auto& status : state.character.status_effects) {
-        for (const auto& dangerous : dangerous_statuses) {
-            if (status == dangerous) {
-                return true;
-            }
-        }
-    }
-    return false;
-}
-
-bool ReflexTier::is_overweight(const GameState& state) const {
-    if (state.character.max_weight == 0) return false;
-    float weight_ratio = static_cast<float>(state.character.weight) / state.character.max_weight;
-    return weight_ratio >= WEIGHT_CRITICAL_THRESHOLD;
+    // The most urgent one
+    const Reflex& reflex = REFLEXES[std::countr_zero(found)];
+    action.kind = reflex.kind;
+    action.parameters.set(reflex.key, std::string(reflex.value));
+    action.reason = reflex.reason;
+    action.confidence = 0.95f;
+    return action;
 }
 
 } // namespace decision
@@ -1,6 +1,4 @@
 #include "../../include/decision/rules.hpp"
-#include <algorithm>
-#include <limits>
 #include <iostream>
 
 namespace openkore_ai {
@@ -11,62 +9,72 @@ RulesTier::RulesTier() {
 }
 
 bool RulesTier::should_handle(const GameState& state) const {
+    return should_handle(state, StateSummary(state));
+}
+
+bool RulesTier::should_handle(const GameState& state, const StateSummary& summary) const {
     // Rules tier handles non-emergency tactical situations
-    return !state.monsters.empty() || should_heal(state);
+    return !state.monsters.empty() || should_heal(summary);
 }
 
 Action RulesTier::decide(const GameState& state) {
+    return decide(state, StateSummary(state));
+}
+
+Action RulesTier::decide(const GameState& state, const StateSummary& summary) {
     // Decision priority:
     // 1. Healing (non-emergency)
     // 2. Combat
     // 3. Positioning
     
-    if (should_heal(state)) {
-        return decide_healing(state);
+    if (should_heal(summary)) {
+        return decide_healing(summary);
     }
     
-    if (should_attack(state)) {
-        return decide_combat(state);
+    if (should_attack(state, summary)) {
+        return decide_combat(summary);
     }
     
-    if (!is_in_safe_position(state)) {
-        return decide_positioning(state);
+    if (!is_in_safe_position(summary)) {
+        return decide_positioning(summary);
     }
     
     // No tactical action needed
     Action action;
-    action.type = "none";
+    action.kind = ActionKind::NONE;
     action.reason = "Rules: No tactical action required";
     action.confidence = 0.6f;
     return action;
 }
 
-Action RulesTier::decide_combat(const GameState& state) {
-    Monster target = find_best_target(state);
+Action RulesTier::decide_combat(const StateSummary& summary) {
+    // Targeting priority:
+    // 1. Aggressive monsters attacking us
+    // 2. Closest monsters within attack range
+    const Monster* target = summary.monsters().target;
     
     Action action;
     action.confidence = 0.8f;
     
-    if (target.id.empty()) {
-        action.type = "none";
+    if (!target) {
+        action.kind = ActionKind::NONE;
         action.reason = "Rules: No valid target found";
         return action;
     }
     
     // Check if we have enough SP for skills
-    float sp_ratio = static_cast<float>(state.character.sp) / state.character.max_sp;
-    
-    if (sp_ratio > SP_SKILL_THRESHOLD && target.distance <= 10) {
+    const JobRules& job = summary.job();
+    if (!job.attack_skill.empty() && summary.sp_ratio > job.skill_min_sp && target->distance <= 10) {
         // Use skill attack
-        action.type = "skill";
-        action.parameters["skill"] = "Bash";  // Example skill
-        action.parameters["target"] = target.id;
-        action.reason = "Rules: Using skill attack on " + target.name;
+        action.kind = ActionKind::SKILL;
+        action.parameters.set(params::SKILL, job.attack_skill);
+        action.parameters.set(params::TARGET, target->id);
+        action.reason = "Rules: Using skill attack on " + target->name;
     } else {
         // Use basic attack
-        action.type = "attack";
-        action.parameters["target"] = target.id;
-        action.reason = "Rules: Basic attack on " + target.name;
+        action.kind = ActionKind::ATTACK;
+        action.parameters.set(params::TARGET, target->id);
+        action.reason = "Rules: Basic attack on " + target->name;
     }
     
     return action;
@@ -75,123 +83,68 @@ Action RulesTier::decide_combat(const GameState& state) {
 Action RulesTier::decide_targeting(const GameState& state) {
     // This is called by decide_combat
     Action action;
-    action.type = "none";
+    action.kind = ActionKind::NONE;
     action.reason = "Rules: Targeting logic (handled by combat)";
     action.confidence = 0.7f;
     return action;
 }
 
-Action RulesTier::decide_positioning(const GameState& state) {
+Action RulesTier::decide_positioning(const StateSummary& summary) {
     Action action;
     action.confidence = 0.7f;
     
     // If too many aggressive monsters nearby, retreat
-    int aggressive_count = 0;
-    for (const auto& monster : state.monsters) {
-        if (monster.is_aggressive && monster.distance <= SAFE_DISTANCE) {
-            aggressive_count++;
-        }
-    }
-    
-    if (aggressive_count >= 3) {
-        action.type = "move";
-        action.parameters["direction"] = "away";
+    if (summary.monsters().aggressive_within(SAFE_DISTANCE) >= 3) {
+        action.kind = ActionKind::MOVE;
+        action.parameters.set(params::DIRECTION, "away");
         action.reason = "Rules: Too many aggressive monsters, retreating";
         return action;
     }
     
-    action.type = "none";
+    action.kind = ActionKind::NONE;
     action.reason = "Rules: Position is safe";
     return action;
 }
 
-Action RulesTier::decide_healing(const GameState& state) {
+Action RulesTier::decide_healing(const StateSummary& summary) {
     Action action;
     action.confidence = 0.75f;
     
-    float hp_ratio = static_cast<float>(state.character.hp) / state.character.max_hp;
-    
-    if (hp_ratio < HP_HEAL_THRESHOLD) {
-        action.type = "item";
-        action.parameters["item"] = "Red Potion";
-        action.reason = "Rules: HP below 60%, healing";
+    if (summary.hp_ratio < summary.job().heal_below) {
+        action.kind = ActionKind::ITEM;
+        action.parameters.set(params::ITEM, "Red Potion");
+        action.reason = "Rules: HP low, healing";
         return action;
     }
     
-    action.type = "none";
+    action.kind = ActionKind::NONE;
     action.reason = "Rules: HP sufficient";
     return action;
 }
 
-Monster RulesTier::find_best_target(const GameState& state) const {
-    Monster best_target;
-    best_target.id = "";
-    
-    if (state.monsters.empty()) {
-        return best_target;
-    }
-    
-    // Targeting priority:
-    // 1. Aggressive monsters attacking us
-    // 2. Closest monsters within attack range
-    // 3. Weakest monsters (lowest HP)
-    
-    int min_distance = std::numeric_limits<int>::max();
-    
-    for (const auto& monster : state.monsters) {
-        // Skip monsters too far away
-        if (monster.distance > MAX_ATTACK_DISTANCE) {
-            continue;
-        }
-        
-        // Prioritize aggressive monsters
-        if (monster.is_aggressive && monster.distance < min_distance) {
-            best_target = monster;
-            min_distance = monster.distance;
-        } else if (!monster.is_aggressive && best_target.id.empty() && monster.distance < min_distance) {
-            best_target = monster;
-            min_distance = monster.distance;
-        }
-    }
-    
-    return best_target;
-}
-
-bool RulesTier::should_attack(const GameState& state) const {
+bool RulesTier::should_attack(const GameState& state, const StateSummary& summary) const {
     // Attack if there are monsters within range and we're healthy enough
     if (state.monsters.empty()) {
         return false;
     }
     
-    float hp_ratio = static_cast<float>(state.character.hp) / state.character.max_hp;
-    if (hp_ratio < 0.4f) {
+    if (summary.hp_ratio < summary.job().attack_min_hp) {
         return false;  // Too low HP to attack
     }
     
     // Check if any monster is in attack range
-    for (const auto& monster : state.monsters) {
-        if (monster.distance <= MAX_ATTACK_DISTANCE) {
-            return true;
-        }
-    }
-    
-    return false;
+    return summary.monsters().within(MAX_ATTACK_DISTANCE) > 0;
 }
 
-bool RulesTier::should_heal(const GameState& state) const {
-    float hp_ratio = static_cast<float>(state.character.hp) / state.character.max_hp;
-    return hp_ratio < HP_HEAL_THRESHOLD && hp_ratio > 0.25f;  // Not critical, but needs healing
+bool RulesTier::should_heal(const StateSummary& summary) const {
+    // Not critical, but needs healing
+    const JobRules& job = summary.job();
+    return summary.hp_ratio < job.heal_below && summary.hp_ratio > job.heal_above;
 }
 
-bool RulesTier::is_in_safe_position(const GameState& state) const {
+bool RulesTier::is_in_safe_position(const StateSummary& summary) const {
     // Position is safe if not surrounded by aggressive monsters
-    int aggressive_count = 0;
-    for (const auto& monster : state.monsters) {
-        if (monster.is_aggressive && monster.distance <= SAFE_DISTANCE) {
-            aggressive_count++;
-        }
-    }
-    return aggressive_count < 3;
+    return summary.monsters().aggressive_within(SAFE_DISTANCE) < 3;
 }
 
 } // namespace decision
@@ -0,0 +1,87 @@
+#include "../include/decision_memo.hpp"
+#include <algorithm>
+
+namespace openkore_ai {
+
+namespace {
+
+// Numbers first, they differ more often and are cheaper to compare
+
+bool same_character(const CharacterState& a, const CharacterState& b) {
+    return a.hp == b.hp && a.sp == b.sp && a.position.x == b.position.x && a.position.y == b.position.y
+        && a.weight == b.weight && a.zeny == b.zeny && a.base_exp == b.base_exp && a.job_exp == b.job_exp
+        && a.level == b.level && a.max_hp == b.max_hp && a.max_sp == b.max_sp && a.max_weight == b.max_weight
+        && a.name == b.name && a.position.map == b.position.map && a.job_class == b.job_class
+        && a.status_effects == b.status_effects;
+}
+
+bool same_monster(const Monster& a, const Monster& b) {
+    return a.hp == b.hp && a.distance == b.distance && a.max_hp == b.max_hp && a.is_aggressive == b.is_aggressive
+        && a.id == b.id && a.name == b.name;
+}
+
+bool same_item(const Item& a, const Item& b) {
+    return a.amount == b.amount && a.id == b.id && a.name == b.name && a.type == b.type;
+}
+
+bool same_player(const Player& a, const Player& b) {
+    return a.distance == b.distance && a.level == b.level && a.is_party_member == b.is_party_member
+        && a.name == b.name && a.guild == b.guild;
+}
+
+} // namespace
+
+DecisionMemo::DecisionMemo(size_t max_characters)
+    : max_entries_per_shard_(std::max<size_t>(1, max_characters / SHARD_COUNT)) {
+}
+
+DecisionMemo::Shard& DecisionMemo::shard_of(const std::string& character) {
+    return shards_[std::hash<std::string>{}(character) % SHARD_COUNT];
+}
+
+bool DecisionMemo::same_state(const GameState& a, const GameState& b) {
+    return same_character(a.character, b.character)
+        && std::equal(a.monsters.begin(), a.monsters.end(), b.monsters.begin(), b.monsters.end(), same_monster)
+        && std::equal(a.inventory.begin(), a.inventory.end(), b.inventory.begin(), b.inventory.end(), same_item)
+        && std::equal(a.nearby_players.begin(), a.nearby_players.end(), b.nearby_players.begin(),
+                      b.nearby_players.end(), same_player)
+        && a.party_members == b.party_members && a.party_id == b.party_id;
+}
+
+bool DecisionMemo::find(const GameState& state, std::chrono::steady_clock::time_point now, Decision& decision) {
+    Shard& shard = shard_of(state.character.name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(state.character.name);
+    if (it == shard.entries.end() || now >= it->second.expires || !same_state(it->second.state, state)) {
+        return false;
+    }
+    decision = it->second.decision;
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void DecisionMemo::store(const GameState& state, std::chrono::steady_clock::time_point expires,
+                         const Decision& decision) {
+    Shard& shard = shard_of(state.character.name);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(state.character.name);
+    if (it == shard.entries.end()) {
+        // New characters are the only time a shard grows, so expired and then the oldest entries go here
+        if (shard.entries.size() >= max_entries_per_shard_) {
+            auto now = std::chrono::steady_clock::now();
+            std::erase_if(shard.entries, [&](const auto& item) { return now >= item.second.expires; });
+        }
+        while (shard.entries.size() >= max_entries_per_shard_) {
+            auto oldest = std::min_element(shard.entries.begin(), shard.entries.end(),
+                [](const auto& a, const auto& b) { return a.second.expires < b.second.expires; });
+            shard.entries.erase(oldest);
+        }
+        it = shard.entries.emplace(state.character.name, Entry()).first;
+    }
+    Entry& entry = it->second;
+    entry.state = state;
+    entry.expires = expires;
+    entry.decision = decision;
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,385 @@
+#include "../include/decision_pipeline.hpp"
+#include "../include/logger.hpp"
+#include <array>
+#include <chrono>
+#include <optional>
+
+namespace openkore_ai {
+
+namespace {
+
+// Stage ids of the tiers and coordinators, see metrics::StageMetrics
+struct PipelineStages {
+    size_t coordinators;
+    std::array<size_t, metrics::DecisionMetrics::TIER_COUNT> should_handle;
+    std::array<size_t, metrics::DecisionMetrics::TIER_COUNT> decide;
+
+    PipelineStages() {
+        metrics::StageMetrics& stages = metrics::stages();
+        for (size_t tier = 0; tier < metrics::DecisionMetrics::TIER_COUNT; tier++) {
+            std::string name = tier_to_string(static_cast<DecisionTier>(tier));
+            should_handle[tier] = stages.stage(name + ".should_handle");
+            decide[tier] = stages.stage(name + ".decide");
+        }
+        coordinators = stages.stage("coordinators");
+    }
+};
+
+// Versions of the configurations of all pipelines, so that a thread's cached one can't pass for that of
+// another pipeline
+std::atomic<uint64_t> configuration_versions{0};
+
+const PipelineStages& pipeline_stages() {
+    static const PipelineStages stages;
+    return stages;
+}
+
+// Lets a tier decide if it should handle the state, timing both calls as stages. Tiers which read the
+// request's summary get it instead of working it out again.
+template <typename Tier>
+bool run_tier(Tier* tier, DecisionTier tier_id, const GameState& state, const StateSummary& summary,
+              DecisionResponse& response) {
+    if (!tier) {
+        return false;
+    }
+    size_t index = static_cast<size_t>(tier_id);
+    constexpr bool summarized = requires { tier->decide(state, summary); };
+    {
+        metrics::StageTimer timer(pipeline_stages().should_handle[index]);
+        bool handle;
+        if constexpr (summarized) {
+            handle = tier->should_handle(state, summary);
+        } else {
+            handle = tier->should_handle(state);
+        }
+        if (!handle) {
+            return false;
+        }
+    }
+    metrics::StageTimer timer(pipeline_stages().decide[index]);
+    if constexpr (summarized) {
+        response.action = tier->decide(state, summary);
+    } else {
+        response.action = tier->decide(state);
+    }
+    response.tier_used = tier_id;
+    return true;
+}
+
+} // namespace
+
+std::string tier_to_string(DecisionTier tier) {
+    switch (tier) {
+        case DecisionTier::REFLEX: return "reflex";
+        case DecisionTier::RULES: return "rules";
+        case DecisionTier::ML: return "ml";
+        case DecisionTier::LLM: return "llm";
+        default: return "unknown";
+    }
+}
+
+std::string_view component_name(PipelineComponent component) {
+    switch (component) {
+        case PipelineComponent::REFLEX: return "reflex_tier";
+        case PipelineComponent::RULES: return "rules_tier";
+        case PipelineComponent::ML: return "ml_tier";
+        case PipelineComponent::LLM: return "llm_tier";
+        case PipelineComponent::COORDINATORS: return "coordinator_framework";
+    }
+    return "unknown";
+}
+
+nlohmann::json action_to_json(const Action& action) {
+    nlohmann::json j;
+    j["type"] = action.type_name();
+    nlohmann::json& parameters = j["parameters"] = nlohmann::json::object();
+    for (const auto& [key, value] : action.parameters) {
+        parameters[param_key_name(key)] = value;
+    }
+    j["reason"] = action.reason;
+    j["confidence"] = action.confidence;
+    return j;
+}
+
+DecisionPipeline::~DecisionPipeline() {
+    // Its threads decide with the tiers
+    speculation.reset();
+    wait_loaded();
+}
+
+void DecisionPipeline::configure(const DecisionSettings& settings) {
+    std::lock_guard<std::mutex> lock(configure_mutex_);
+    apply(settings);
+}
+
+void DecisionPipeline::apply(const DecisionSettings& settings) {
+    auto configuration = std::make_shared<Configuration>();
+    configuration->settings = settings;
+    if (ready(PipelineComponent::COORDINATORS) && coordinators) {
+        configuration->schedule = coordinators->compile(settings);
+    }
+    configuration->version = configuration_versions.fetch_add(1, std::memory_order_relaxed) + 1;
+    configuration_.store(std::move(configuration));
+    // Published after the configuration, so a thread seeing the new version loads at least this configuration
+    version_.store(configuration_.load()->version, std::memory_order_release);
+}
+
+DecisionSettings DecisionPipeline::settings() const {
+    return configuration_.load()->settings;
+}
+
+void DecisionPipeline::load_in_background(PipelineComponent component, std::function<void()> load) {
+    std::atomic<Load>& state = loads_[static_cast<size_t>(component)];
+    state.store(Load::RUNNING, std::memory_order_release);
+    std::lock_guard<std::mutex> lock(loaders_mutex_);
+    loaders_.emplace_back([this, component, &state, load = std::move(load)] {
+        auto start = std::chrono::steady_clock::now();
+        try {
+            load();
+        } catch (const std::exception& e) {
+            OKAI_LOG_ERROR("Startup", component_name(component) << " failed to load: " << e.what());
+            state.store(Load::FAILED, std::memory_order_release);
+            return;
+        }
+        if (component == PipelineComponent::COORDINATORS) {
+            // The settings in use were applied without them, their schedule is compiled now
+            std::lock_guard<std::mutex> configure_lock(configure_mutex_);
+            state.store(Load::NONE, std::memory_order_release);
+            apply(configuration_.load()->settings);
+        } else {
+            state.store(Load::NONE, std::memory_order_release);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        OKAI_LOG_INFO("Startup", component_name(component) << " ready after " << elapsed.count() << "ms");
+    });
+}
+
+void DecisionPipeline::wait_loaded() {
+    std::vector<std::thread> loaders;
+    {
+        std::lock_guard<std::mutex> lock(loaders_mutex_);
+        loaders.swap(loaders_);
+    }
+    for (std::thread& loader : loaders) {
+        loader.join();
+    }
+}
+
+std::vector<std::string> DecisionPipeline::outcome_sources() const {
+    std::vector<std::string> sources;
+    for (size_t tier = 0; tier < metrics::DecisionMetrics::TIER_COUNT; tier++) {
+        sources.push_back(tier_to_string(static_cast<DecisionTier>(tier)));
+    }
+    if (ready(PipelineComponent::COORDINATORS) && coordinators) {
+        for (const std::string& name : coordinators->names()) {
+            sources.push_back("coordinator." + name);
+        }
+    }
+    return sources;
+}
+
+const std::shared_ptr<const DecisionPipeline::Configuration>& DecisionPipeline::configuration() const {
+    thread_local std::shared_ptr<const Configuration> cached;
+    uint64_t version = version_.load(std::memory_order_acquire);
+    if (!cached || cached->version != version) {
+        cached = configuration_.load();
+    }
+    return cached;
+}
+
+std::optional<DecisionMemo::Decision> DecisionPipeline::decide_ahead(const GameState& state, const Trends& trends,
+                                                                     const Configuration& configuration) {
+    // Without the party board: characters in a party aren't decided ahead, their targets are shared
+    const StateSummary summary(state, trends);
+    const DecisionSettings& settings = configuration.settings;
+    
+    // Reflex decides on the spot anyway
+    if (settings.reflex_enabled && ready(PipelineComponent::REFLEX) && reflex
+        && reflex->should_handle(state, summary)) {
+        return std::nullopt;
+    }
+    if (ready(PipelineComponent::COORDINATORS) && coordinators) {
+        size_t coordinator = 0;
+        std::optional<Action> action =
+            coordinators->speculative_decision(state, summary, configuration.schedule.get(), &coordinator);
+        if (!action) {
+            return std::nullopt;
+        }
+        if (action->kind != ActionKind::NONE) {
+            return DecisionMemo::Decision{std::move(*action), DecisionTier::RULES, true,
+                                          static_cast<uint16_t>(metrics::DecisionMetrics::TIER_COUNT + coordinator)};
+        }
+    }
+    if (settings.rules_enabled && ready(PipelineComponent::RULES) && rules && rules->should_handle(state, summary)) {
+        return DecisionMemo::Decision{rules->decide(state, summary), DecisionTier::RULES, true,
+                                      static_cast<uint16_t>(DecisionTier::RULES)};
+    }
+    if (settings.ml_enabled && ready(PipelineComponent::ML) && ml && ml->should_handle(state)) {
+        // In-process predictions are made ahead, those of the service only if it made one for a state like this
+        std::optional<Action> prediction = ml->model_loaded() ? std::optional<Action>(ml->decide(state))
+                                                              : ml->decide_cached(state);
+        if (!prediction) {
+            return std::nullopt;
+        }
+        return DecisionMemo::Decision{std::move(*prediction), DecisionTier::ML, true,
+                                      static_cast<uint16_t>(DecisionTier::ML)};
+    }
+    if (settings.llm_enabled && ready(PipelineComponent::LLM) && llm && llm->should_handle(state)) {
+        return std::nullopt;
+    }
+    
+    Action none;
+    none.reason = "No tier required action";
+    none.confidence = 0.5f;
+    return DecisionMemo::Decision{std::move(none), DecisionTier::REFLEX, false,
+                                  static_cast<uint16_t>(DecisionTier::REFLEX)};
+}
+
+DecisionResponse DecisionPipeline::decide(const GameState& state, const std::string& request_id,
+                                          std::optional<std::chrono::steady_clock::time_point> deadline) {
+    auto start = std::chrono::steady_clock::now();
+    
+    DecisionResponse response;
+    response.request_id = request_id;
+    bool handled = true;
+    // Of the outcome: the tier used, unless a coordinator or the memo tells otherwise
+    std::optional<uint16_t> source;
+    size_t coordinator = 0;
+    const StateSummary summary(state, history ? history->record(state, start) : Trends{}, party.get());
+    const std::shared_ptr<const Configuration>& configuration_in_use = this->configuration();
+    const Configuration& configuration = *configuration_in_use;
+    const DecisionSettings& settings = configuration.settings;
+    bool remember = false;
+    bool decide_successors = false;
+    
+    if (!deadline && settings.deadline_ms > 0) {
+        deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                               std::chrono::duration<double, std::milli>(settings.deadline_ms));
+    }
+    // Whether a stage has its minimum budget left, else it's recorded as skipped
+    auto in_budget = [&](PipelineComponent component, int min_budget_us) {
+        if (!deadline || std::chrono::steady_clock::now() + std::chrono::microseconds(min_budget_us) < *deadline) {
+            return true;
+        }
+        response.skipped |= component_bit(component);
+        return false;
+    };
+    
+    // Tier 1: Reflex (<1ms)
+    if (settings.reflex_enabled && ready(PipelineComponent::REFLEX)
+        && run_tier(reflex.get(), DecisionTier::REFLEX, state, summary, response)) {
+        goto done;
+    }
+    
+    // The same state as the character's last one gets the same decision, while it is fresh
+    if (memo && settings.memo_ttl_ms > 0) {
+        DecisionMemo::Decision remembered;
+        if (memo->find(state, start, remembered)) {
+            response.action = std::move(remembered.action);
+            response.tier_used = remembered.tier;
+            handled = remembered.handled;
+            source = remembered.source;
+            goto done;
+        }
+        remember = true;
+    }
+    
+    // A state decided ahead, after the character's previous one
+    if (speculation) {
+        decide_successors = !party || state.party_id.empty();
+        DecisionMemo::Decision ahead;
+        if (decide_successors && speculation->find(state, start, ahead)) {
+            response.action = std::move(ahead.action);
+            response.tier_used = ahead.tier;
+            handled = ahead.handled;
+            source = ahead.source;
+            goto done;
+        }
+    }
+    
+    // Phase 5: Consult coordinator system (operates at tactical/rules level)
+    if (ready(PipelineComponent::COORDINATORS) && coordinators
+        && in_budget(PipelineComponent::COORDINATORS, settings.coordinators_min_budget_us)) {
+        Action coordinator_action;
+        {
+            metrics::StageTimer timer(pipeline_stages().coordinators);
+            auto coordinator_deadline = deadline.value_or(std::chrono::steady_clock::time_point::max());
+            coordinator_action = configuration.schedule
+                ? coordinators->get_coordinator_decision(state, summary, *configuration.schedule,
+                                                         coordinator_deadline, &coordinator)
+                : coordinators->get_coordinator_decision(state, summary, coordinator_deadline, &coordinator);
+        }
+        if (coordinator_action.kind != ActionKind::NONE) {
+            response.action = coordinator_action;
+            response.tier_used = DecisionTier::RULES;  // Coordinators operate at tactical level
+            source = static_cast<uint16_t>(metrics::DecisionMetrics::TIER_COUNT + coordinator);
+            goto done;
+        }
+    }
+    
+    // Tier 2: Rules (<10ms)
+    if (settings.rules_enabled && ready(PipelineComponent::RULES) && rules
+        && in_budget(PipelineComponent::RULES, settings.rules_min_budget_us)
+        && run_tier(rules.get(), DecisionTier::RULES, state, summary, response)) {
+        goto done;
+    }
+    
+    // Tier 3: ML (<100ms), a kept prediction if there's no time to ask for one
+    if (settings.ml_enabled && ready(PipelineComponent::ML) && ml) {
+        if (in_budget(PipelineComponent::ML, settings.ml_min_budget_us)) {
+            if (run_tier(ml.get(), DecisionTier::ML, state, summary, response)) {
+                goto done;
+            }
+        } else if (ml->should_handle(state)) {
+            if (std::optional<Action> cached = ml->decide_cached(state)) {
+                response.action = std::move(*cached);
+                response.tier_used = DecisionTier::ML;
+                goto done;
+            }
+        }
+    }
+    
+    // Tier 4: LLM (30-300s)
+    if (settings.llm_enabled && ready(PipelineComponent::LLM) && llm
+        && in_budget(PipelineComponent::LLM, settings.llm_min_budget_us)
+        && run_tier(llm.get(), DecisionTier::LLM, state, summary, response)) {
+        goto done;
+    }
+    
+    // No tier handled this - default action
+    response.action.kind = ActionKind::NONE;
+    response.action.reason = response.skipped ? "No tier acted before the deadline" : "No tier required action";
+    response.action.confidence = 0.5f;
+    response.tier_used = DecisionTier::REFLEX;
+    handled = false;
+    
+done:
+    if (!source) {
+        source = static_cast<uint16_t>(response.tier_used);
+    }
+    // LLM answers are handed over once, and those of skipped stages are left to the next decision
+    if (response.skipped) {
+        degraded_count_.fetch_add(1, std::memory_order_relaxed);
+    } else if (remember && response.tier_used != DecisionTier::LLM) {
+        memo->store(state, start + std::chrono::milliseconds(settings.memo_ttl_ms),
+                    {response.action, response.tier_used, handled, *source});
+    }
+    if (outcomes) {
+        outcomes->record(state, *source, response.action.kind, start);
+    }
+    if (decide_successors && !response.skipped && response.tier_used != DecisionTier::LLM) {
+        speculation->speculate(state, response.action,
+            [this, configuration = configuration_in_use, trends = summary.trends](const GameState& successor) {
+                return decide_ahead(successor, trends, *configuration);
+            });
+    }
+    auto end = std::chrono::steady_clock::now();
+    response.latency_us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    response.latency_ms = response.latency_us / 1000;
+    
+    metrics.record(response.tier_used, handled, static_cast<uint64_t>(response.latency_us));
+    
+    return response;
+}
+
+} // namespace openkore_ai
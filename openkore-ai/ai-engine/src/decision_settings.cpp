@@ -0,0 +1,58 @@
+#include "../include/decision_settings.hpp"
+#include "../include/config_file.hpp"
+#include <fstream>
+#include <stdexcept>
+
+namespace openkore_ai {
+
+DecisionSettings DecisionSettings::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot read config file " + path);
+    }
+
+    DecisionSettings settings;
+    config::read_entries(file, [&](const std::string& section, const std::string& key, const std::string& value,
+                                   int line_number) {
+        if (section != "decision_system" && section != "server") {
+            return;
+        }
+        try {
+            if (section == "server") {
+                if (key == "coordinator_deadline_us") {
+                    settings.coordinator_deadline_us = static_cast<int>(config::to_number(value, 1, 60000000));
+                } else if (key == "collect_all_coordinators") {
+                    settings.collect_all_coordinators = config::to_bool(value);
+                }
+            } else if (key == "reflex_enabled") {
+                settings.reflex_enabled = config::to_bool(value);
+            } else if (key == "rules_enabled") {
+                settings.rules_enabled = config::to_bool(value);
+            } else if (key == "ml_enabled") {
+                settings.ml_enabled = config::to_bool(value);
+            } else if (key == "llm_enabled") {
+                settings.llm_enabled = config::to_bool(value);
+            } else if (key == "memo_ttl_ms") {
+                settings.memo_ttl_ms = static_cast<int>(config::to_number(value, 0, 60000));
+            } else if (key == "deadline_ms") {
+                settings.deadline_ms = config::to_real(value, 0, 60000);
+            } else if (key == "coordinators_min_budget_us") {
+                settings.coordinators_min_budget_us = static_cast<int>(config::to_number(value, 0, 60000000));
+            } else if (key == "rules_min_budget_us") {
+                settings.rules_min_budget_us = static_cast<int>(config::to_number(value, 0, 60000000));
+            } else if (key == "ml_min_budget_us") {
+                settings.ml_min_budget_us = static_cast<int>(config::to_number(value, 0, 60000000));
+            } else if (key == "llm_min_budget_us") {
+                settings.llm_min_budget_us = static_cast<int>(config::to_number(value, 0, 60000000));
+            } else if (key == "disabled_coordinators") {
+                settings.disabled_coordinators = config::to_list(value);
+            }
+        } catch (const std::logic_error&) {
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for " + section
+                                     + "." + key + ": " + value);
+        }
+    });
+    return settings;
+}
+
+} // namespace openkore_ai
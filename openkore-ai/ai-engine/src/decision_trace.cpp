@@ -0,0 +1,274 @@
+#include "../include/decision_trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace openkore_ai {
+
+namespace {
+
+constexpr size_t MAGIC_SIZE = sizeof(DecisionTrace::SEGMENT_MAGIC);
+constexpr size_t SIZE_BYTES = 4;
+
+std::string segment_name(uint64_t sequence) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "decisions-%06llu.trace", static_cast<unsigned long long>(sequence));
+    return name;
+}
+
+// Sequence number of a segment file name, 0 if it is not one
+uint64_t segment_sequence(const std::filesystem::path& path) {
+    std::string name = path.filename().string();
+    const std::string prefix = "decisions-";
+    const std::string suffix = ".trace";
+    if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0
+        || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+        return 0;
+    }
+    std::string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+    if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return 0;
+    }
+    return std::stoull(digits);
+}
+
+void write_u32(char* out, uint32_t value) {
+    out[0] = static_cast<char>(value >> 24);
+    out[1] = static_cast<char>(value >> 16);
+    out[2] = static_cast<char>(value >> 8);
+    out[3] = static_cast<char>(value);
+}
+
+uint32_t read_u32(const unsigned char* data) {
+    return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+}
+
+} // namespace
+
+// A segment file mapped in memory. The file has its full size from the start, zero filled,
+// and is cut down to the used part when closed.
+class DecisionTrace::Segment {
+public:
+    Segment(const std::filesystem::path& path, size_t size) : size_(size) {
+#ifdef _WIN32
+        file_ = CreateFileW(path.wstring().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                            CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file_ == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Cannot create trace segment " + path.string());
+        }
+        ULARGE_INTEGER mapped_size;
+        mapped_size.QuadPart = size;
+        mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READWRITE, mapped_size.HighPart, mapped_size.LowPart,
+                                      nullptr);
+        if (mapping_) {
+            data_ = static_cast<char*>(MapViewOfFile(mapping_, FILE_MAP_WRITE, 0, 0, size));
+        }
+        if (!data_) {
+            if (mapping_) {
+                CloseHandle(mapping_);
+            }
+            CloseHandle(file_);
+            throw std::runtime_error("Cannot map trace segment " + path.string());
+        }
+#else
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd_ < 0) {
+            throw std::runtime_error("Cannot create trace segment " + path.string());
+        }
+        void* data = MAP_FAILED;
+        if (::ftruncate(fd_, static_cast<off_t>(size)) == 0) {
+            data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        }
+        if (data == MAP_FAILED) {
+            ::close(fd_);
+            throw std::runtime_error("Cannot map trace segment " + path.string());
+        }
+        data_ = static_cast<char*>(data);
+#endif
+    }
+
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    char* data() { return data_; }
+    size_t size() const { return size_; }
+
+    // Unmaps the file and cuts it down to its first 'used' bytes
+    void close(size_t used) {
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(used);
+        if (SetFilePointerEx(file_, end, nullptr, FILE_BEGIN)) {
+            SetEndOfFile(file_);
+        }
+        CloseHandle(file_);
+#else
+        ::munmap(data_, size_);
+        if (::ftruncate(fd_, static_cast<off_t>(used)) != 0) {
+            // The zero filled rest ends the segment anyway
+        }
+        ::close(fd_);
+#endif
+        data_ = nullptr;
+    }
+
+private:
+    size_t size_;
+    char* data_ = nullptr;
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+DecisionTrace::DecisionTrace(const std::string& directory, size_t segment_size, size_t max_segments)
+    : directory_(directory), segment_size_(segment_size), max_segments_(std::max<size_t>(1, max_segments)) {
+    if (segment_size_ < MAGIC_SIZE + SIZE_BYTES + 1 || segment_size_ > UINT32_MAX) {
+        throw std::runtime_error("Invalid trace segment size " + std::to_string(segment_size));
+    }
+    try {
+        std::filesystem::create_directories(directory_);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(std::string("Cannot create trace directory: ") + e.what());
+    }
+    for (const auto& path : segments(directory_)) {
+        sequence_ = std::max(sequence_, segment_sequence(path));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!next_segment()) {
+        throw std::runtime_error("Cannot create trace segment in " + directory);
+    }
+}
+
+DecisionTrace::~DecisionTrace() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (segment_) {
+        segment_->close(used_);
+    }
+}
+
+bool DecisionTrace::next_segment() {
+    if (segment_) {
+        segment_->close(used_);
+        segment_.reset();
+    }
+
+    // Drop the oldest segments, keeping room for the new one
+    std::vector<std::filesystem::path> existing = segments(directory_);
+    for (size_t i = 0; i + max_segments_ <= existing.size(); i++) {
+        std::error_code error;
+        std::filesystem::remove(existing[i], error);
+    }
+
+    sequence_++;
+    try {
+        segment_ = std::make_unique<Segment>(directory_ / segment_name(sequence_), segment_size_);
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    std::memcpy(segment_->data(), SEGMENT_MAGIC, MAGIC_SIZE);
+    used_ = MAGIC_SIZE;
+    return true;
+}
+
+bool DecisionTrace::record(const nlohmann::json& request, int status, const nlohmann::json& response) {
+    // Encoded on the calling thread, into a buffer which keeps its capacity
+    thread_local std::vector<uint8_t> encoded;
+    encoded.clear();
+    auto ts_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    nlohmann::json::to_msgpack(nlohmann::json{{"ts_us", ts_us}, {"request", request}, {"status", status},
+                                              {"response", response}},
+                               encoded);
+
+    size_t needed = SIZE_BYTES + encoded.size();
+    if (MAGIC_SIZE + needed > segment_size_) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if ((!segment_ || used_ + needed > segment_size_) && !next_segment()) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    char* out = segment_->data() + used_;
+    write_u32(out, static_cast<uint32_t>(encoded.size()));
+    std::memcpy(out + SIZE_BYTES, encoded.data(), encoded.size());
+    used_ += needed;
+    recorded_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+std::vector<std::filesystem::path> DecisionTrace::segments(const std::filesystem::path& directory) {
+    std::vector<std::pair<uint64_t, std::filesystem::path>> found;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        uint64_t sequence = segment_sequence(entry.path());
+        if (sequence != 0 && entry.is_regular_file(error)) {
+            found.emplace_back(sequence, entry.path());
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::filesystem::path> paths;
+    paths.reserve(found.size());
+    for (auto& [sequence, path] : found) {
+        paths.push_back(std::move(path));
+    }
+    return paths;
+}
+
+size_t DecisionTrace::read_segment(const std::filesystem::path& path,
+                                   const std::function<void(nlohmann::json&)>& visit) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot read trace segment " + path.string());
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < MAGIC_SIZE || std::memcmp(data.data(), SEGMENT_MAGIC, MAGIC_SIZE) != 0) {
+        throw std::runtime_error(path.string() + " is not a decision trace segment");
+    }
+
+    size_t count = 0;
+    size_t offset = MAGIC_SIZE;
+    while (offset + SIZE_BYTES <= data.size()) {
+        uint32_t size = read_u32(data.data() + offset);
+        if (size == 0) {
+            break;
+        }
+        offset += SIZE_BYTES;
+        if (size > data.size() - offset) {
+            throw std::runtime_error(path.string() + ": record at offset " + std::to_string(offset - SIZE_BYTES)
+                                     + " is cut off");
+        }
+        nlohmann::json record;
+        try {
+            record = nlohmann::json::from_msgpack(data.begin() + offset, data.begin() + offset + size);
+        } catch (const nlohmann::json::exception& e) {
+            throw std::runtime_error(path.string() + ": corrupt record at offset "
+                                     + std::to_string(offset - SIZE_BYTES) + ": " + e.what());
+        }
+        offset += size;
+        visit(record);
+        count++;
+    }
+    return count;
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,38 @@
+#include "../include/file_watcher.hpp"
+
+namespace openkore_ai {
+
+FileWatcher::FileWatcher(std::string path, std::chrono::milliseconds interval, std::function<void()> changed)
+    : path_(std::move(path)), interval_(interval), changed_(std::move(changed)) {
+    // Changes from now on, the caller has just loaded the file
+    std::error_code error;
+    seen_time_ = std::filesystem::last_write_time(path_, error);
+    thread_ = std::thread([this] { run(); });
+}
+
+FileWatcher::~FileWatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    stop_.notify_all();
+    thread_.join();
+}
+
+void FileWatcher::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stop_.wait_for(lock, interval_, [this] { return stopping_; })) {
+        std::error_code error;
+        std::filesystem::file_time_type time = std::filesystem::last_write_time(path_, error);
+        if (error || time == seen_time_) {
+            continue;
+        }
+        // Not retried until the file changes again, if 'changed' fails
+        seen_time_ = time;
+        lock.unlock();
+        changed_();
+        lock.lock();
+    }
+}
+
+} // namespace openkore_ai
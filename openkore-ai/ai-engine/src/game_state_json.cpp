@@ -0,0 +1,530 @@
+#include "../include/game_state_json.hpp"
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+#ifdef OPENKORE_AI_WITH_SIMDJSON
+#include <charconv>
+#include <simdjson.h>
+#endif
+
+using json = nlohmann::json;
+
+namespace openkore_ai {
+
+namespace {
+
+// Sets a field from the object only if it has the key
+template <typename T>
+void set_if_present(const json& j, const char* key, T& field) {
+    auto it = j.find(key);
+    if (it != j.end()) {
+        it->get_to(field);
+    }
+}
+
+// An id as a string, the plugin sends numbers for those of monsters and items
+std::string id_string(const json& j) {
+    return j.is_number_integer() ? std::to_string(j.get<long long>()) : j.get<std::string>();
+}
+
+void set_id_if_present(const json& j, const char* key, std::string& id) {
+    auto it = j.find(key);
+    if (it == j.end()) {
+        return;
+    }
+    if (it->is_number_integer()) {
+        id = std::to_string(it->get<long long>());
+    } else {
+        it->get_to(id);
+    }
+}
+
+// Reads a list of strings into an existing vector, reusing its strings
+void assign_strings(const json& j, std::vector<std::string>& list) {
+    list.resize(j.size());
+    size_t i = 0;
+    for (const auto& entry : j) {
+        list[i++] = entry.get_ref<const std::string&>();
+    }
+}
+
+void patch_character(CharacterState& character, const json& j) {
+    set_if_present(j, "name", character.name);
+    set_if_present(j, "level", character.level);
+    set_if_present(j, "hp", character.hp);
+    set_if_present(j, "max_hp", character.max_hp);
+    set_if_present(j, "sp", character.sp);
+    set_if_present(j, "max_sp", character.max_sp);
+    auto position = j.find("position");
+    if (position != j.end()) {
+        set_if_present(*position, "map", character.position.map);
+        set_if_present(*position, "x", character.position.x);
+        set_if_present(*position, "y", character.position.y);
+    }
+    set_if_present(j, "weight", character.weight);
+    set_if_present(j, "max_weight", character.max_weight);
+    set_if_present(j, "zeny", character.zeny);
+    set_if_present(j, "job_class", character.job_class);
+    auto status_effects = j.find("status_effects");
+    if (status_effects != j.end()) {
+        assign_strings(*status_effects, character.status_effects);
+    }
+}
+
+void patch_monster(Monster& monster, const json& j) {
+    set_id_if_present(j, "id", monster.id);
+    set_if_present(j, "name", monster.name);
+    set_if_present(j, "hp", monster.hp);
+    set_if_present(j, "max_hp", monster.max_hp);
+    set_if_present(j, "distance", monster.distance);
+    set_if_present(j, "is_aggressive", monster.is_aggressive);
+    set_if_present(j, "x", monster.x);
+    set_if_present(j, "y", monster.y);
+}
+
+void patch_item(Item& item, const json& j) {
+    set_id_if_present(j, "id", item.id);
+    set_if_present(j, "name", item.name);
+    set_if_present(j, "amount", item.amount);
+    set_if_present(j, "type", item.type);
+}
+
+void patch_player(Player& player, const json& j) {
+    set_if_present(j, "name", player.name);
+    set_if_present(j, "level", player.level);
+    set_if_present(j, "guild", player.guild);
+    set_if_present(j, "distance", player.distance);
+    set_if_present(j, "is_party_member", player.is_party_member);
+}
+
+// Sets every field back to what a value-initialized one has, without freeing the strings
+void reset(CharacterState& character) {
+    character.name.clear();
+    character.level = character.base_exp = character.job_exp = 0;
+    character.hp = character.max_hp = character.sp = character.max_sp = 0;
+    character.position.map.clear();
+    character.position.x = character.position.y = 0;
+    character.weight = character.max_weight = character.zeny = 0;
+    character.job_class.clear();
+    // status_effects is overwritten by patch_character when given, which reuses its strings
+}
+
+void reset(Monster& monster) {
+    monster.id.clear();
+    monster.name.clear();
+    monster.hp = monster.max_hp = monster.distance = 0;
+    monster.is_aggressive = false;
+    monster.x = monster.y = -1;
+}
+
+void reset(Item& item) {
+    item.id.clear();
+    item.name.clear();
+    item.amount = 0;
+    item.type.clear();
+}
+
+void reset(Player& player) {
+    player.name.clear();
+    player.level = player.distance = 0;
+    player.guild.clear();
+    player.is_party_member = false;
+}
+
+// Overwrites a list with the entries of the array, reusing the entities already in it
+template <typename Entity, typename Patch>
+void parse_list(const json& j, const char* name, std::vector<Entity>& list, Patch patch) {
+    auto entries = j.find(name);
+    if (entries == j.end()) {
+        list.clear();
+        return;
+    }
+    list.resize(entries->size());
+    size_t i = 0;
+    for (const auto& entry : *entries) {
+        Entity& entity = list[i++];
+        reset(entity);
+        patch(entity, entry);
+    }
+}
+
+// Applies the removed, updated and added entries of a list delta, entities are matched by 'key'
+template <typename Entity, typename Patch>
+void apply_list_delta(const json& delta, const char* name, std::vector<Entity>& list,
+                      std::string Entity::*key, const char* key_name, Patch patch) {
+    auto changes = delta.find(name);
+    if (changes == delta.end()) {
+        return;
+    }
+
+    auto removed = changes->find("removed");
+    if (removed != changes->end() && !removed->empty()) {
+        std::unordered_set<std::string> keys;
+        for (const auto& k : *removed) {
+            keys.insert(id_string(k));
+        }
+        std::erase_if(list, [&](const Entity& entity) { return keys.count(entity.*key) > 0; });
+    }
+
+    auto find = [&](const std::string& k) {
+        return std::find_if(list.begin(), list.end(), [&](const Entity& entity) { return entity.*key == k; });
+    };
+
+    auto updated = changes->find("updated");
+    if (updated != changes->end()) {
+        for (const auto& entry : *updated) {
+            auto it = find(id_string(entry.at(key_name)));
+            if (it != list.end()) {
+                patch(*it, entry);
+            }
+        }
+    }
+
+    auto added = changes->find("added");
+    if (added != changes->end()) {
+        for (const auto& entry : *added) {
+            Entity entity{};
+            patch(entity, entry);
+            auto it = find(entity.*key);
+            if (it != list.end()) {
+                *it = std::move(entity);
+            } else {
+                list.push_back(std::move(entity));
+            }
+        }
+    }
+}
+
+#ifdef OPENKORE_AI_WITH_SIMDJSON
+namespace ondemand = simdjson::ondemand;
+
+// The parser of the thread, which keeps its buffers from document to document
+ondemand::parser& thread_parser() {
+    thread_local ondemand::parser parser;
+    return parser;
+}
+
+// The text copied to a buffer with the padding simdjson reads past the end, reused by the thread
+simdjson::padded_string_view padded(std::string_view text) {
+    thread_local std::string buffer;
+    buffer.reserve(text.size() + simdjson::SIMDJSON_PADDING);
+    buffer.assign(text);
+    return simdjson::padded_string_view(buffer.data(), buffer.size(), buffer.capacity());
+}
+
+// Read a value into a field like get_to, but only from the JSON type of the field
+bool read(ondemand::value& value, int& field) {
+    int64_t number;
+    if (value.get_int64().get(number)) {
+        return false;
+    }
+    field = static_cast<int>(number);
+    return true;
+}
+
+bool read(ondemand::value& value, bool& field) {
+    return !value.get_bool().get(field);
+}
+
+bool read(ondemand::value& value, std::string& field) {
+    std::string_view text;
+    if (value.get_string().get(text)) {
+        return false;
+    }
+    field.assign(text);
+    return true;
+}
+
+// Like id_string, reusing the string
+bool read_id(ondemand::value& value, std::string& id) {
+    ondemand::json_type type;
+    if (value.type().get(type)) {
+        return false;
+    }
+    if (type != ondemand::json_type::number) {
+        return read(value, id);
+    }
+    int64_t number;
+    if (value.get_int64().get(number)) {
+        return false;
+    }
+    char digits[24];
+    auto end = std::to_chars(digits, digits + sizeof(digits), number).ptr;
+    id.assign(digits, end);
+    return true;
+}
+
+// Calls 'read_field' with the key and value of each field of an object, until it returns false
+template <typename ReadField>
+bool read_object(ondemand::value& value, ReadField read_field) {
+    ondemand::object object;
+    if (value.get_object().get(object)) {
+        return false;
+    }
+    for (auto field : object) {
+        std::string_view key;
+        ondemand::value field_value;
+        if (field.unescaped_key().get(key) || field.value().get(field_value) || !read_field(key, field_value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Overwrites a list with the entries of an array like assign_strings and parse_list do, calling
+// 'read_entry' with the value and entity of each entry
+template <typename Entity, typename ReadEntry>
+bool read_array(ondemand::value& value, std::vector<Entity>& list, ReadEntry read_entry) {
+    ondemand::array array;
+    if (value.get_array().get(array)) {
+        return false;
+    }
+    size_t count = 0;
+    for (auto entry : array) {
+        ondemand::value entry_value;
+        if (entry.get(entry_value)) {
+            return false;
+        }
+        if (count == list.size()) {
+            list.emplace_back();
+        }
+        if (!read_entry(entry_value, list[count++])) {
+            return false;
+        }
+    }
+    list.resize(count);
+    return true;
+}
+
+bool read_character(ondemand::value& value, CharacterState& character) {
+    bool status_effects = false;
+    bool read_all = read_object(value, [&](std::string_view key, ondemand::value& field) {
+        if (key == "name") return read(field, character.name);
+        if (key == "level") return read(field, character.level);
+        if (key == "hp") return read(field, character.hp);
+        if (key == "max_hp") return read(field, character.max_hp);
+        if (key == "sp") return read(field, character.sp);
+        if (key == "max_sp") return read(field, character.max_sp);
+        if (key == "position") {
+            return read_object(field, [&](std::string_view position_key, ondemand::value& position_field) {
+                if (position_key == "map") return read(position_field, character.position.map);
+                if (position_key == "x") return read(position_field, character.position.x);
+                if (position_key == "y") return read(position_field, character.position.y);
+                return true;
+            });
+        }
+        if (key == "weight") return read(field, character.weight);
+        if (key == "max_weight") return read(field, character.max_weight);
+        if (key == "zeny") return read(field, character.zeny);
+        if (key == "job_class") return read(field, character.job_class);
+        if (key == "status_effects") {
+            status_effects = true;
+            return read_array(field, character.status_effects,
+                              [](ondemand::value& entry, std::string& effect) { return read(entry, effect); });
+        }
+        return true;
+    });
+    if (!status_effects) {
+        character.status_effects.clear();
+    }
+    return read_all;
+}
+
+bool read_monster(ondemand::value& value, Monster& monster) {
+    reset(monster);
+    return read_object(value, [&](std::string_view key, ondemand::value& field) {
+        if (key == "id") return read_id(field, monster.id);
+        if (key == "name") return read(field, monster.name);
+        if (key == "hp") return read(field, monster.hp);
+        if (key == "max_hp") return read(field, monster.max_hp);
+        if (key == "distance") return read(field, monster.distance);
+        if (key == "is_aggressive") return read(field, monster.is_aggressive);
+        if (key == "x") return read(field, monster.x);
+        if (key == "y") return read(field, monster.y);
+        return true;
+    });
+}
+
+bool read_item(ondemand::value& value, Item& item) {
+    reset(item);
+    return read_object(value, [&](std::string_view key, ondemand::value& field) {
+        if (key == "id") return read_id(field, item.id);
+        if (key == "name") return read(field, item.name);
+        if (key == "amount") return read(field, item.amount);
+        if (key == "type") return read(field, item.type);
+        return true;
+    });
+}
+
+bool read_player(ondemand::value& value, Player& player) {
+    reset(player);
+    return read_object(value, [&](std::string_view key, ondemand::value& field) {
+        if (key == "name") return read(field, player.name);
+        if (key == "level") return read(field, player.level);
+        if (key == "guild") return read(field, player.guild);
+        if (key == "distance") return read(field, player.distance);
+        if (key == "is_party_member") return read(field, player.is_party_member);
+        return true;
+    });
+}
+#endif
+
+long long now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()
+    ).count();
+}
+
+} // namespace
+
+GameState parse_game_state(const json& j) {
+    GameState state{};
+    parse_game_state_into(j, state);
+    return state;
+}
+
+void parse_game_state_into(const json& j, GameState& state) {
+    const json& character = j.at("character");
+    reset(state.character);
+    if (!character.contains("status_effects")) {
+        state.character.status_effects.clear();
+    }
+    patch_character(state.character, character);
+    parse_list(j, "monsters", state.monsters, patch_monster);
+    parse_list(j, "inventory", state.inventory, patch_item);
+    parse_list(j, "nearby_players", state.nearby_players, patch_player);
+    state.party_members.clear();
+    state.party_id.clear();
+    set_if_present(j, "party_id", state.party_id);
+    state.server.clear();
+    set_if_present(j, "server", state.server);
+
+    state.timestamp_ms = now_ms();
+}
+
+bool parse_game_state_text(std::string_view text, GameState& state) {
+#ifdef OPENKORE_AI_WITH_SIMDJSON
+    ondemand::document document;
+    ondemand::object object;
+    if (thread_parser().iterate(padded(text)).get(document) || document.get_object().get(object)) {
+        return false;
+    }
+    bool character = false, monsters = false, inventory = false, nearby_players = false;
+    state.party_members.clear();
+    state.party_id.clear();
+    state.server.clear();
+    for (auto field : object) {
+        std::string_view key;
+        ondemand::value value;
+        if (field.unescaped_key().get(key) || field.value().get(value)) {
+            return false;
+        }
+        bool read_field = true;
+        if (key == "character") {
+            // The last of the same fields wins, as with nlohmann::json
+            reset(state.character);
+            read_field = character = read_character(value, state.character);
+        } else if (key == "monsters") {
+            read_field = monsters = read_array(value, state.monsters, read_monster);
+        } else if (key == "inventory") {
+            read_field = inventory = read_array(value, state.inventory, read_item);
+        } else if (key == "nearby_players") {
+            read_field = nearby_players = read_array(value, state.nearby_players, read_player);
+        } else if (key == "party_id") {
+            read_field = read(value, state.party_id);
+        } else if (key == "server") {
+            read_field = read(value, state.server);
+        }
+        if (!read_field) {
+            return false;
+        }
+    }
+    if (!character || !document.at_end()) {
+        return false;
+    }
+    if (!monsters) {
+        state.monsters.clear();
+    }
+    if (!inventory) {
+        state.inventory.clear();
+    }
+    if (!nearby_players) {
+        state.nearby_players.clear();
+    }
+
+    state.timestamp_ms = now_ms();
+    return true;
+#else
+    (void) text;
+    (void) state;
+    return false;
+#endif
+}
+
+bool split_decide_request(std::string_view body, json& fields, std::string_view& game_state) {
+#ifdef OPENKORE_AI_WITH_SIMDJSON
+    simdjson::padded_string_view input = padded(body);
+    ondemand::document document;
+    ondemand::object object;
+    if (thread_parser().iterate(input).get(document) || document.get_object().get(object)) {
+        return false;
+    }
+    fields = json::object();
+    game_state = {};
+    for (auto field : object) {
+        std::string_view key;
+        ondemand::value value;
+        std::string_view raw;
+        if (field.unescaped_key().get(key) || field.value().get(value) || value.raw_json().get(raw)) {
+            return false;
+        }
+        if (key == "game_state") {
+            // The same text in the body, which outlives the padded copy
+            game_state = body.substr(raw.data() - input.data(), raw.size());
+        } else {
+            // The other fields are small, besides a delta
+            json& parsed = fields[std::string(key)] = json::parse(raw.begin(), raw.end(), nullptr, false);
+            if (parsed.is_discarded()) {
+                return false;
+            }
+        }
+    }
+    return document.at_end();
+#else
+    (void) body;
+    (void) fields;
+    (void) game_state;
+    return false;
+#endif
+}
+
+bool read_character_name(std::string_view game_state, std::string& name) {
+#ifdef OPENKORE_AI_WITH_SIMDJSON
+    ondemand::document document;
+    ondemand::value character, value;
+    return !thread_parser().iterate(padded(game_state)).get(document)
+        && !document.find_field_unordered("character").get(character)
+        && !character.find_field_unordered("name").get(value)
+        && read(value, name);
+#else
+    (void) game_state;
+    (void) name;
+    return false;
+#endif
+}
+
+void apply_game_state_delta(GameState& state, const json& delta) {
+    auto character = delta.find("character");
+    if (character != delta.end()) {
+        patch_character(state.character, *character);
+    }
+    apply_list_delta(delta, "monsters", state.monsters, &Monster::id, "id", patch_monster);
+    apply_list_delta(delta, "inventory", state.inventory, &Item::id, "id", patch_item);
+    apply_list_delta(delta, "nearby_players", state.nearby_players, &Player::name, "name", patch_player);
+    set_if_present(delta, "party_id", state.party_id);
+    set_if_present(delta, "server", state.server);
+
+    state.timestamp_ms = now_ms();
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,176 @@
+#include "../include/http_task_queue.hpp"
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace openkore_ai {
+
+namespace {
+
+thread_local bool is_shedding_thread = false;
+// The queue whose connections the thread serves, and whether it handed its place off
+thread_local HttpTaskQueue* worker_queue = nullptr;
+thread_local int worker_cpu = -1;
+thread_local bool handed_off = false;
+std::atomic<uint64_t> shed_total{0};
+std::atomic<size_t> waiting_total{0};
+
+} // namespace
+
+bool pin_current_thread(int cpu) {
+#ifdef _WIN32
+    if (cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+        return false;
+    }
+    return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) != 0;
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+HttpTaskQueue::HttpTaskQueue(size_t threads, size_t queue_depth, const std::vector<int>& cpu_affinity)
+    : queue_depth_(queue_depth) {
+    threads_.reserve(threads + 1);
+    for (size_t i = 0; i < threads; i++) {
+        int cpu = cpu_affinity.empty() ? -1 : cpu_affinity[i % cpu_affinity.size()];
+        threads_.emplace_back([this, cpu] { worker_loop(queue_, cpu); });
+    }
+    if (queue_depth_ > 0) {
+        threads_.emplace_back([this] {
+            is_shedding_thread = true;
+            worker_loop(shed_queue_, -1);
+        });
+    }
+}
+
+HttpTaskQueue::~HttpTaskQueue() {
+    shutdown();
+}
+
+bool HttpTaskQueue::enqueue(std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return false;
+        }
+        if (queue_depth_ == 0 || queue_.size() < queue_depth_) {
+            queue_.push_back(std::move(fn));
+            waiting_total.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            shed_total.fetch_add(1, std::memory_order_relaxed);
+            if (shed_queue_.size() >= queue_depth_) {
+                // httplib closes the connection
+                return false;
+            }
+            shed_queue_.push_back(std::move(fn));
+        }
+    }
+    wake_.notify_all();
+    return true;
+}
+
+void HttpTaskQueue::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            return;
+        }
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    // No workers start once stopping
+    std::vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threads.swap(threads_);
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+bool HttpTaskQueue::shedding() {
+    return is_shedding_thread;
+}
+
+bool HttpTaskQueue::hand_off_worker() {
+    HttpTaskQueue* queue = worker_queue;
+    if (!queue || handed_off) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(queue->mutex_);
+    if (queue->stopping_) {
+        return false;
+    }
+    queue->join_finished();
+    int cpu = worker_cpu;
+    queue->threads_.emplace_back([queue, cpu] { queue->worker_loop(queue->queue_, cpu); });
+    handed_off = true;
+    return true;
+}
+
+void HttpTaskQueue::join_finished() {
+    for (std::thread::id id : finished_) {
+        auto it = std::find_if(threads_.begin(), threads_.end(), [&](const std::thread& thread) {
+            return thread.get_id() == id;
+        });
+        if (it != threads_.end()) {
+            // It has left its loop, only its return is left
+            it->join();
+            threads_.erase(it);
+        }
+    }
+    finished_.clear();
+}
+
+uint64_t HttpTaskQueue::shed_count() {
+    return shed_total.load(std::memory_order_relaxed);
+}
+
+size_t HttpTaskQueue::waiting() {
+    return waiting_total.load(std::memory_order_relaxed);
+}
+
+void HttpTaskQueue::worker_loop(std::deque<std::function<void()>>& queue, int cpu) {
+    if (cpu >= 0) {
+        pin_current_thread(cpu);
+    }
+    if (&queue == &queue_) {
+        worker_queue = this;
+        worker_cpu = cpu;
+    }
+    while (true) {
+        std::function<void()> fn;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || !queue.empty(); });
+            // Queued connections are still served when stopping, like httplib's own pool does
+            if (queue.empty()) {
+                return;
+            }
+            fn = std::move(queue.front());
+            queue.pop_front();
+            if (&queue == &queue_) {
+                waiting_total.fetch_sub(1, std::memory_order_relaxed);
+            }
+        }
+        fn();
+        if (handed_off) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            finished_.push_back(std::this_thread::get_id());
+            return;
+        }
+    }
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,145 @@
+#include "../include/item_database.hpp"
+#include <array>
+#include <charconv>
+#include <fstream>
+
+namespace openkore_ai {
+
+namespace {
+
+struct KnownItem {
+    int id;
+    const char* name;
+    ItemCategory category;
+    int heal_hp;
+    int heal_sp;
+};
+
+// Heal values are the averages of the ranges in the item scripts
+constexpr std::array<KnownItem, 19> KNOWN_ITEMS = {{
+    {501, "Red Potion", ItemCategory::HP_RECOVERY, 55, 0},
+    {502, "Orange Potion", ItemCategory::HP_RECOVERY, 125, 0},
+    {503, "Yellow Potion", ItemCategory::HP_RECOVERY, 205, 0},
+    {504, "White Potion", ItemCategory::HP_RECOVERY, 365, 0},
+    {507, "Red Herb", ItemCategory::HP_RECOVERY, 23, 0},
+    {508, "Yellow Herb", ItemCategory::HP_RECOVERY, 48, 0},
+    {509, "White Herb", ItemCategory::HP_RECOVERY, 95, 0},
+    {545, "Condensed Red Potion", ItemCategory::HP_RECOVERY, 55, 0},
+    {546, "Condensed Yellow Potion", ItemCategory::HP_RECOVERY, 205, 0},
+    {547, "Condensed White Potion", ItemCategory::HP_RECOVERY, 365, 0},
+    {505, "Blue Potion", ItemCategory::SP_RECOVERY, 0, 50},
+    {510, "Blue Herb", ItemCategory::SP_RECOVERY, 0, 22},
+    {526, "Royal Jelly", ItemCategory::SP_RECOVERY, 365, 50},
+    {506, "Green Potion", ItemCategory::CURE, 0, 0},
+    {511, "Green Herb", ItemCategory::CURE, 0, 0},
+    {525, "Panacea", ItemCategory::CURE, 0, 0},
+    {705, "Clover", ItemCategory::LOOT, 0, 0},
+    {909, "Jellopy", ItemCategory::LOOT, 0, 0},
+    {914, "Fluff", ItemCategory::LOOT, 0, 0},
+}};
+
+} // namespace
+
+ItemDatabase::ItemDatabase() {
+    items_.reserve(KNOWN_ITEMS.size());
+    for (const KnownItem& known : KNOWN_ITEMS) {
+        ItemInfo& info = items_[known.id];
+        info.id = known.id;
+        info.name = known.name;
+        info.category = known.category;
+        info.heal_hp = known.heal_hp;
+        info.heal_sp = known.heal_sp;
+        by_name_.emplace(info.name, &info);
+    }
+}
+
+ItemDatabase& ItemDatabase::shared() {
+    static ItemDatabase database;
+    return database;
+}
+
+void ItemDatabase::add(int id, std::string name) {
+    auto [it, added] = items_.try_emplace(id);
+    ItemInfo& info = it->second;
+    if (!added) {
+        if (info.name == name) {
+            return;
+        }
+        auto named = by_name_.find(info.name);
+        if (named != by_name_.end() && named->second == &info) {
+            by_name_.erase(named);
+        }
+    }
+    info.id = id;
+    info.name = std::move(name);
+    by_name_.emplace(info.name, &info);
+}
+
+size_t ItemDatabase::load_names(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return 0;
+    }
+    // Read as OpenKore's parseROLUT does
+    size_t count = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            line.erase(0, 3);
+        }
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line.compare(0, 2, "//") == 0) {
+            continue;
+        }
+        size_t hash = line.find('#');
+        if (hash == std::string::npos) {
+            continue;
+        }
+        int id = 0;
+        auto [end, error] = std::from_chars(line.data(), line.data() + hash, id);
+        if (error != std::errc() || end != line.data() + hash) {
+            continue;
+        }
+        size_t name_end = line.find('#', hash + 1);
+        std::string name = line.substr(hash + 1, name_end == std::string::npos ? std::string::npos : name_end - hash - 1);
+        for (char& c : name) {
+            if (c == '_') {
+                c = ' ';
+            }
+        }
+        size_t first = name.find_first_not_of(" \t");
+        if (first == std::string::npos) {
+            continue;
+        }
+        name = name.substr(first, name.find_last_not_of(" \t") - first + 1);
+        add(id, std::move(name));
+        count++;
+    }
+    return count;
+}
+
+const ItemInfo* ItemDatabase::find(int id) const {
+    auto it = items_.find(id);
+    return it != items_.end() ? &it->second : nullptr;
+}
+
+const ItemInfo* ItemDatabase::find(std::string_view name) const {
+    auto it = by_name_.find(name);
+    return it != by_name_.end() ? it->second : nullptr;
+}
+
+const ItemInfo* ItemDatabase::find(const Item& item) const {
+    int id = 0;
+    const char* end = item.id.data() + item.id.size();
+    auto [parsed, error] = std::from_chars(item.id.data(), end, id);
+    if (error == std::errc() && parsed == end) {
+        if (const ItemInfo* info = find(id)) {
+            return info;
+        }
+    }
+    return find(std::string_view(item.name));
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,199 @@
+#include "../include/job_rules.hpp"
+#include "../include/config_file.hpp"
+#include "../include/logger.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace openkore_ai {
+
+namespace {
+
+// config/job_rules.yaml as shipped, without its comments
+constexpr const char* BUILTIN_RULES = R"(
+default:
+  heal_below: 0.60
+  heal_above: 0.25
+  attack_min_hp: 0.40
+  skill_min_sp: 0.30
+  attack_skill: ""
+  primary_stat: STR
+  secondary_stat: VIT
+  learn_skill: ""
+  first_job: false
+Swordsman:
+  attack_skill: Bash
+  learn_skill: Bash
+  first_job: true
+Knight:
+  attack_skill: Bash
+Magician:
+  attack_skill: Fire Bolt
+  primary_stat: INT
+  learn_skill: Fire Bolt
+  first_job: true
+Wizard:
+  attack_skill: Fire Bolt
+  primary_stat: INT
+Archer:
+  attack_skill: Double Strafe
+  primary_stat: DEX
+  learn_skill: Double Strafe
+  first_job: true
+Hunter:
+  attack_skill: Double Strafe
+  primary_stat: DEX
+Acolyte:
+  first_job: true
+Merchant:
+  first_job: true
+Thief:
+  primary_stat: AGI
+  first_job: true
+Assassin:
+  primary_stat: AGI
+)";
+
+constexpr const char* DEFAULT_SECTION = "default";
+
+// Sets a key of a job's rules, false for unknown keys
+bool set_rule(JobRules& rules, const std::string& key, const std::string& value) {
+    if (key == "heal_below") {
+        rules.heal_below = static_cast<float>(config::to_real(value, 0.0, 1.0));
+    } else if (key == "heal_above") {
+        rules.heal_above = static_cast<float>(config::to_real(value, 0.0, 1.0));
+    } else if (key == "attack_min_hp") {
+        rules.attack_min_hp = static_cast<float>(config::to_real(value, 0.0, 1.0));
+    } else if (key == "skill_min_sp") {
+        rules.skill_min_sp = static_cast<float>(config::to_real(value, 0.0, 1.0));
+    } else if (key == "attack_skill") {
+        rules.attack_skill = value;
+    } else if (key == "primary_stat") {
+        rules.primary_stat = value;
+    } else if (key == "secondary_stat") {
+        rules.secondary_stat = value;
+    } else if (key == "learn_skill") {
+        rules.learn_skill = value;
+    } else if (key == "first_job") {
+        rules.first_job = config::to_bool(value);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::shared_ptr<const JobRuleTable> JobRuleTable::compile(std::istream& in, const std::string& name) {
+    // The keys of each section in order, to apply the default ones first whatever the order of the file
+    struct Key {
+        std::string key;
+        std::string value;
+        int line_number;
+    };
+    std::vector<std::pair<std::string, std::vector<Key>>> sections = {{DEFAULT_SECTION, {}}};
+    config::read_entries(in, [&](const std::string& section, const std::string& key, const std::string& value,
+                                 int line_number) {
+        auto it = std::find_if(sections.begin(), sections.end(),
+                               [&](const auto& entry) { return entry.first == section; });
+        if (it == sections.end()) {
+            sections.emplace_back(section, std::vector<Key>());
+            it = sections.end() - 1;
+        }
+        it->second.push_back({key, value, line_number});
+    });
+    if (sections.size() > UINT16_MAX) {
+        throw std::runtime_error(name + ": too many jobs");
+    }
+
+    auto table = std::make_shared<JobRuleTable>();
+    table->rules_.reserve(sections.size());
+    table->names_.reserve(sections.size());
+    for (const auto& [section, keys] : sections) {
+        JobRules rules = table->rules_.empty() ? JobRules() : table->rules_.front();
+        for (const Key& key : keys) {
+            try {
+                if (!set_rule(rules, key.key, key.value)) {
+                    throw std::runtime_error(name + ":" + std::to_string(key.line_number) + ": unknown key "
+                                             + section + "." + key.key);
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(name + ":" + std::to_string(key.line_number) + ": invalid value for "
+                                         + section + "." + key.key + ": " + key.value);
+            }
+        }
+        table->rules_.push_back(std::move(rules));
+        table->names_.push_back(section);
+    }
+    for (size_t id = 1; id < table->names_.size(); id++) {
+        table->ids_.emplace(table->names_[id], static_cast<JobId>(id));
+    }
+    return table;
+}
+
+std::shared_ptr<const JobRuleTable> JobRuleTable::builtin() {
+    static const std::shared_ptr<const JobRuleTable> table = [] {
+        std::istringstream in(BUILTIN_RULES);
+        return compile(in, "built-in job rules");
+    }();
+    return table;
+}
+
+JobId JobRuleTable::id_of(std::string_view job) const {
+    auto it = ids_.find(job);
+    return it != ids_.end() ? it->second : 0;
+}
+
+JobRuleBook& JobRuleBook::shared() {
+    static JobRuleBook book;
+    return book;
+}
+
+JobRuleBook::JobRuleBook() : table_(JobRuleTable::builtin()) {}
+
+JobRuleBook::~JobRuleBook() = default;
+
+void JobRuleBook::load(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot read job rules " + path);
+    }
+    table_.store(JobRuleTable::compile(file, path));
+    path_ = path;
+}
+
+void JobRuleBook::reload() {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        path = path_;
+    }
+    if (path.empty()) {
+        throw std::runtime_error("No job rules file to reload");
+    }
+    load(path);
+    reloads_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void JobRuleBook::watch(std::chrono::milliseconds interval) {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        path = path_;
+    }
+    if (watcher_ || path.empty()) {
+        return;
+    }
+    watcher_ = std::make_unique<FileWatcher>(path, interval, [this, path] {
+        try {
+            reload();
+            OKAI_LOG_INFO("JobRules", "Reloaded " << path << " (" << current()->jobs() << " jobs)");
+        } catch (const std::exception& e) {
+            OKAI_LOG_WARNING("JobRules", "Keeping the job rules in use: " << e.what());
+        }
+    });
+}
+
+} // namespace openkore_ai
@@ -5,6 +5,10 @@
 #include <chrono>
 #include <iomanip>
 #include <sstream>
+#include <condition_variable>
+#include <functional>
+#include <thread>
+#include <vector>
 
 namespace openkore_ai {
 namespace logging {
@@ -14,7 +18,192 @@ std::mutex Logger::log_mutex_;
 std::ofstream Logger::log_file_;
 std::string Logger::log_directory_;
 std::string Logger::current_date_;
-LogLevel Logger::min_level_ = LogLevel::INFO;
+std::chrono::system_clock::time_point Logger::next_rotation_;
+std::atomic<LogLevel> Logger::min_level_{LogLevel::INFO};
+std::atomic<Logger::AsyncWriter*> Logger::async_writer_{nullptr};
+std::atomic<uint32_t> Logger::site_rate_limit_{50};
+std::atomic<bool> Logger::suppress_repeats_{true};
+std::atomic<uint64_t> Logger::suppressed_total_{0};
+std::atomic<LogSite*> LogSite::sites_{nullptr};
+
+// Bounded multi-producer ring of formatted lines (Vyukov's queue) with a single consumer, the writer thread.
+// Each slot's sequence number says whether it is free for the producer at that position or filled for the
+// consumer, so producers only contend on the tail index.
+class Logger::AsyncWriter {
+public:
+    AsyncWriter(size_t capacity, std::chrono::milliseconds flush_interval)
+        : flush_interval_(flush_interval) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_ = std::vector<Slot>(size);
+        mask_ = size - 1;
+        for (size_t i = 0; i < size; i++) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        thread_ = std::thread(&AsyncWriter::run, this);
+    }
+    
+    // Writes out what is queued and ends the writer thread
+    void stop() {
+        stopping_.store(true);
+        wake();
+        thread_.join();
+    }
+    
+    // False if the ring is full
+    bool push(LogLevel level, std::string&& line) {
+        size_t position = tail_.load(std::memory_order_relaxed);
+        Slot* slot;
+        while (true) {
+            slot = &slots_[position & mask_];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->level = level;
+        slot->line = std::move(line);
+        slot->sequence.store(position + 1, std::memory_order_release);
+        
+        // The writer only needs waking when it has gone idle, or when an error must be flushed now
+        if (idle_.load(std::memory_order_acquire) || level >= LogLevel::ERROR_LEVEL) {
+            wake();
+        }
+        return true;
+    }
+    
+    std::atomic<uint64_t> dropped{0};        // not reported in the log yet
+    std::atomic<uint64_t> dropped_total{0};
+    
+private:
+    struct Slot {
+        std::atomic<size_t> sequence{0};
+        LogLevel level = LogLevel::INFO;
+        std::string line;
+    };
+    
+    void wake() {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_.notify_one();
+    }
+    
+    // Moves the lines ready in the ring to the batch, returns whether one of them was an error
+    bool drain(std::string& out, std::string& err) {
+        bool saw_error = false;
+        while (true) {
+            Slot& slot = slots_[head_ & mask_];
+            if (slot.sequence.load(std::memory_order_acquire) != head_ + 1) {
+                return saw_error;
+            }
+            std::string& target = slot.level >= LogLevel::WARNING ? err : out;
+            target += slot.line;
+            target += '\n';
+            file_batch_ += slot.line;
+            file_batch_ += '\n';
+            saw_error |= slot.level >= LogLevel::ERROR_LEVEL;
+            slot.line.clear();
+            slot.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+            head_++;
+        }
+    }
+    
+    void run() {
+        std::string out;
+        std::string err;
+        auto last_flush = std::chrono::steady_clock::now();
+        auto last_notices = last_flush;
+        auto next_open_retry = last_flush;
+        while (true) {
+            bool stopping = stopping_.load();
+            out.clear();
+            err.clear();
+            file_batch_.clear();
+            bool saw_error = drain(out, err);
+            
+            uint64_t lost = dropped.exchange(0, std::memory_order_relaxed);
+            if (lost > 0) {
+                std::string notice = get_timestamp() + " | WARN  | [LOGGER] " + std::to_string(lost)
+                                     + " lines dropped, the log ring was full\n";
+                err += notice;
+                file_batch_ += notice;
+            }
+            
+            auto now = std::chrono::steady_clock::now();
+            // Lines the call sites left out are reported within a second, also when the sites go quiet
+            if (stopping || now - last_notices >= std::chrono::seconds(1)) {
+                append_site_notices(out, err, file_batch_);
+                last_notices = now;
+            }
+            if (!file_batch_.empty()) {
+                std::lock_guard<std::mutex> lock(log_mutex_);
+                if (log_file_.is_open() || now >= next_open_retry) {
+                    try {
+                        rotate_log_file();
+                    } catch (const std::exception& e) {
+                        // The lines still reach the console, the file is tried again a bit later
+                        std::cerr << "[LOGGER] Log rotation failed, retrying in 5s: " << e.what() << std::endl;
+                        next_open_retry = now + std::chrono::seconds(5);
+                    }
+                }
+                if (!out.empty()) {
+                    std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+                    std::cout.flush();
+                }
+                if (!err.empty()) {
+                    std::cerr.write(err.data(), static_cast<std::streamsize>(err.size()));
+                }
+                if (log_file_.is_open()) {
+                    log_file_.write(file_batch_.data(), static_cast<std::streamsize>(file_batch_.size()));
+                    if (saw_error || stopping || now - last_flush >= flush_interval_) {
+                        log_file_.flush();
+                        last_flush = now;
+                    }
+                }
+            } else if (now - last_flush >= flush_interval_) {
+                std::lock_guard<std::mutex> lock(log_mutex_);
+                if (log_file_.is_open()) {
+                    log_file_.flush();
+                }
+                last_flush = now;
+            }
+            
+            if (stopping) {
+                return;
+            }
+            if (file_batch_.empty()) {
+                // Nothing came in, sleep until a producer wakes us or the flush is due
+                std::unique_lock<std::mutex> lock(wake_mutex_);
+                idle_.store(true, std::memory_order_release);
+                Slot& next = slots_[head_ & mask_];
+                if (next.sequence.load(std::memory_order_acquire) != head_ + 1 && !stopping_.load()) {
+                    wake_.wait_for(lock, flush_interval_);
+                }
+                idle_.store(false, std::memory_order_release);
+            }
+        }
+    }
+    
+    std::vector<Slot> slots_;
+    size_t mask_ = 0;
+    std::atomic<size_t> tail_{0};
+    size_t head_ = 0;  // only used by the writer
+    std::string file_batch_;
+    std::chrono::milliseconds flush_interval_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<bool> idle_{false};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::thread thread_;
+};
 
 void Logger::initialize(const std::string& log_dir, LogLevel min_level) {
     std::lock_guard<std::mutex> lock(log_mutex_);
@@ -53,31 +242,57 @@ void Logger::initialize(const std::string& log_dir, LogLevel min_level) {
     }
 }
 
+void Logger::set_level(LogLevel level) {
+    min_level_.store(level, std::memory_order_relaxed);
+}
+
+LogLevel Logger::parse_level(const std::string& name) {
+    if (name == "debug") return LogLevel::DEBUG;
+    if (name == "info") return LogLevel::INFO;
+    if (name == "warning" || name == "warn") return LogLevel::WARNING;
+    if (name == "error") return LogLevel::ERROR_LEVEL;
+    throw std::invalid_argument("unknown log level " + name);
+}
+
+namespace {
+
+std::tm local_time(std::time_t time) {
+    std::tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
+    return tm;
+}
+
+} // namespace
+
 void Logger::rotate_log_file() {
+    // The date only changes at midnight, until then the open file is the right one
+    auto now = std::chrono::system_clock::now();
+    if (log_file_.is_open() && now < next_rotation_) {
+        return;
+    }
+    
     // Close existing file if open
     if (log_file_.is_open()) {
         log_file_.close();
     }
     
-    // Get current date
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    std::tm tm;
-    
-#ifdef _WIN32
-    localtime_s(&tm, &time_t);
-#else
-    localtime_r(&time_t, &tm);
-#endif
-    
-    std::ostringstream date_stream;
-    date_stream << std::put_time(&tm, "%Y-%m-%d");
-    std::string new_date = date_stream.str();
+    // Get current date, and the next midnight
+    std::tm tm = local_time(std::chrono::system_clock::to_time_t(now));
+    char date[16];
+    std::strftime(date, sizeof(date), "%Y-%m-%d", &tm);
+    std::string new_date = date;
     
-    // Check if date changed
-    if (new_date == current_date_ && log_file_.is_open()) {
-        return; // No need to rotate
-    }
+    std::tm midnight = tm;
+    midnight.tm_hour = 0;
+    midnight.tm_min = 0;
+    midnight.tm_sec = 0;
+    midnight.tm_mday += 1;
+    midnight.tm_isdst = -1;
+    next_rotation_ = std::chrono::system_clock::from_time_t(std::mktime(&midnight));
     
     current_date_ = new_date;
     
@@ -103,24 +318,32 @@ void Logger::rotate_log_file() {
     }
 }
 
-std::string Logger::get_timestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()
-    ) % 1000;
+void Logger::append_timestamp(std::string& out) {
+    // Only the milliseconds change within a second, the rest is formatted once per second and thread
+    thread_local std::time_t cached_second = -1;
+    thread_local char cached_text[20];
     
-    std::tm tm;
-#ifdef _WIN32
-    localtime_s(&tm, &time_t);
-#else
-    localtime_r(&time_t, &tm);
-#endif
+    auto now = std::chrono::system_clock::now();
+    auto since_epoch = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    std::time_t second = std::chrono::system_clock::to_time_t(now);
+    if (second != cached_second) {
+        std::tm tm = local_time(second);
+        std::strftime(cached_text, sizeof(cached_text), "%Y-%m-%d %H:%M:%S", &tm);
+        cached_second = second;
+    }
     
-    std::ostringstream oss;
-    oss << std::put_time(&tm, "%Y-%m-%d %H:%M:%S")
-        << '.' << std::setfill('0') << std::setw(3) << ms.count();
-    return oss.str();
+    int ms = static_cast<int>(since_epoch % 1000);
+    char millis[4] = {static_cast<char>('0' + ms / 100), static_cast<char>('0' + ms / 10 % 10),
+                      static_cast<char>('0' + ms % 10), 0};
+    out.append(cached_text, 19);
+    out += '.';
+    out.append(millis, 3);
+}
+
+std::string Logger::get_timestamp() {
+    std::string timestamp;
+    append_timestamp(timestamp);
+    return timestamp;
 }
 
 std::string Logger::level_to_string(LogLevel level) {
@@ -133,39 +356,132 @@ std::string Logger::level_to_string(LogLevel level) {
     }
 }
 
+std::string Logger::format_line(LogLevel level, const std::string& message, const std::string& context) {
+    std::string line;
+    line.reserve(40 + context.size() + message.size());
+    append_timestamp(line);
+    line += " | ";
+    line += level_to_string(level);
+    line += " | ";
+    if (!context.empty()) {
+        line += '[';
+        line += context;
+        line += "] ";
+    }
+    line += message;
+    return line;
+}
+
+void Logger::start_async(size_t capacity, std::chrono::milliseconds flush_interval) {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    if (async_writer_.load() == nullptr) {
+        async_writer_.store(new AsyncWriter(capacity, flush_interval), std::memory_order_release);
+    }
+}
+
+uint64_t Logger::dropped_count() {
+    AsyncWriter* writer = async_writer_.load(std::memory_order_acquire);
+    return writer ? writer->dropped_total.load(std::memory_order_relaxed) : 0;
+}
+
+void Logger::set_site_limits(uint32_t lines_per_second, bool suppress_repeats) {
+    site_rate_limit_.store(lines_per_second, std::memory_order_relaxed);
+    suppress_repeats_.store(suppress_repeats, std::memory_order_relaxed);
+}
+
+void Logger::append_site_notices(std::string& out, std::string& err, std::string& file) {
+    std::string notice;
+    for (LogSite* site = LogSite::sites_.load(std::memory_order_acquire); site; site = site->next_) {
+        if (!site->take_notice(notice)) {
+            continue;
+        }
+        std::string line = format_line(site->level_, notice, site->context_);
+        std::string& console = site->level_ >= LogLevel::WARNING ? err : out;
+        console += line;
+        console += '\n';
+        file += line;
+        file += '\n';
+    }
+}
+
+LogSite::LogSite(LogLevel level, std::string context) : level_(level), context_(std::move(context)) {
+    next_ = sites_.load(std::memory_order_relaxed);
+    while (!sites_.compare_exchange_weak(next_, this, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+}
+
+void LogSite::write(const std::string& message) {
+    if (Logger::suppress_repeats_.load(std::memory_order_relaxed)) {
+        uint64_t hash = std::hash<std::string>{}(message);
+        if (last_hash_.exchange(hash, std::memory_order_relaxed) == hash) {
+            repeats_.fetch_add(1, std::memory_order_relaxed);
+            Logger::suppressed_total_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    std::string notice;
+    if (take_notice(notice)) {
+        Logger::log(level_, notice, context_);
+    }
+    Logger::log(level_, message, context_);
+}
+
+bool LogSite::take_notice(std::string& notice) {
+    // Mostly both are 0, which only takes two loads
+    uint64_t repeats = repeats_.load(std::memory_order_relaxed) ? repeats_.exchange(0, std::memory_order_relaxed) : 0;
+    uint64_t suppressed = suppressed_.load(std::memory_order_relaxed)
+        ? suppressed_.exchange(0, std::memory_order_relaxed) : 0;
+    if (repeats == 0 && suppressed == 0) {
+        return false;
+    }
+    notice.clear();
+    if (repeats > 0) {
+        notice = "last message repeated " + std::to_string(repeats) + " times";
+    }
+    if (suppressed > 0) {
+        if (!notice.empty()) {
+            notice += ", ";
+        }
+        notice += std::to_string(suppressed) + " similar lines suppressed";
+    }
+    return true;
+}
+
 void Logger::log(LogLevel level, const std::string& message, const std::string& context) {
-    if (level < min_level_) {
+    if (!enabled(level)) {
         return; // Skip if below minimum level
     }
     
+    std::string line = format_line(level, message, context);
+    
+    AsyncWriter* writer = async_writer_.load(std::memory_order_acquire);
+    if (writer) {
+        while (!writer->push(level, std::move(line))) {
+            if (level < LogLevel::ERROR_LEVEL) {
+                writer->dropped.fetch_add(1, std::memory_order_relaxed);
+                writer->dropped_total.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            std::this_thread::yield();
+        }
+        return;
+    }
+    
     std::lock_guard<std::mutex> lock(log_mutex_);
     
     // Check if we need to rotate (daily rotation)
     rotate_log_file();
     
-    // Format log message
-    std::string timestamp = get_timestamp();
-    std::string level_str = level_to_string(level);
-    
-    std::ostringstream log_line;
-    log_line << timestamp << " | " << level_str << " | ";
-    
-    if (!context.empty()) {
-        log_line << "[" << context << "] ";
-    }
-    
-    log_line << message;
-    
     // Write to console
     if (level >= LogLevel::WARNING) {
-        std::cerr << log_line.str() << std::endl;
+        std::cerr << line << std::endl;
     } else {
-        std::cout << log_line.str() << std::endl;
+        std::cout << line << std::endl;
     }
     
     // Write to file
     if (log_file_.is_open()) {
-        log_file_ << log_line.str() << std::endl;
+        log_file_ << line << std::endl;
         log_file_.flush(); // Ensure immediate write
     }
 }
@@ -188,40 +504,51 @@ void Logger::error(const std::string& message, const std::string& context) {
 
 void Logger::log_request(const std::string& method, const std::string& path,
                         const std::string& body, size_t body_size) {
-    std::ostringstream msg;
-    msg << ">>> " << method << " " << path;
-    info(msg.str(), "REQUEST");
+    if (enabled(LogLevel::INFO)) {
+        info(">>> " + method + " " + path, "REQUEST");
+    }
     
-    if (!body.empty() && body_size > 0) {
-        std::string truncated_body = body;
+    if (!body.empty() && body_size > 0 && enabled(LogLevel::DEBUG)) {
+        std::string line = "Body: ";
+        line.append(body, 0, 500);
         if (body.length() > 500) {
-            truncated_body = body.substr(0, 500) + "... (truncated)";
+            line += "... (truncated)";
         }
-        debug("Body: " + truncated_body, "REQUEST");
+        debug(line, "REQUEST");
     }
 }
 
 void Logger::log_response(const std::string& path, int status_code,
                          double latency_ms, const std::string& body) {
-    std::ostringstream msg;
-    msg << "<<< " << path << " - Status: " << status_code
-        << " - Time: " << std::fixed << std::setprecision(3) << latency_ms << "ms";
-    info(msg.str(), "RESPONSE");
+    if (enabled(LogLevel::INFO)) {
+        std::ostringstream msg;
+        msg << "<<< " << path << " - Status: " << status_code
+            << " - Time: " << std::fixed << std::setprecision(3) << latency_ms << "ms";
+        info(msg.str(), "RESPONSE");
+    }
     
-    if (!body.empty()) {
-        std::string truncated_body = body;
+    if (!body.empty() && enabled(LogLevel::DEBUG)) {
+        std::string line = "Body: ";
+        line.append(body, 0, 300);
         if (body.length() > 300) {
-            truncated_body = body.substr(0, 300) + "... (truncated)";
+            line += "... (truncated)";
         }
-        debug("Body: " + truncated_body, "RESPONSE");
+        debug(line, "RESPONSE");
     }
 }
 
 void Logger::cleanup() {
-    std::lock_guard<std::mutex> lock(log_mutex_);
+    info("[LOGGER] Shutting down logger");
     
+    // Lines logged from now on are written synchronously. The writer is not freed, as a thread may still be
+    // about to push to it.
+    AsyncWriter* writer = async_writer_.exchange(nullptr, std::memory_order_acq_rel);
+    if (writer) {
+        writer->stop();
+    }
+    
+    std::lock_guard<std::mutex> lock(log_mutex_);
     if (log_file_.is_open()) {
-        info("[LOGGER] Shutting down logger");
         log_file_.close();
     }
 }
@@ -4,19 +4,43 @@
 #include <memory>
 #include <thread>
 #include <chrono>
-#include <mutex>
 #include <filesystem>
 #include <exception>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <pthread.h>
+#include <signal.h>
 #endif
 #include "types.hpp"
-#include "decision/reflex.hpp"
-#include "decision/rules.hpp"
-#include "decision/ml.hpp"
-#include "decision/llm.hpp"
-#include "coordinators/coordinator_manager.hpp"
+#include "decision_pipeline.hpp"
+#include "decision_trace.hpp"
 #include "logger.hpp"
+#include "metrics.hpp"
+#include "alloc_stats.hpp"
+#include "game_state_json.hpp"
+#include "decide_response.hpp"
+#include "session_store.hpp"
+#include "session_snapshot.hpp"
+#include "world_board.hpp"
+#include "wire_format.hpp"
+#include "stream_server.hpp"
+#include "worker_pool.hpp"
+#include "affinity_pool.hpp"
+#include "server_config.hpp"
+#include "http_task_queue.hpp"
+#include "admission.hpp"
+#include "service_client.hpp"
+#include "strategic_proxy.hpp"
+#include "item_database.hpp"
+#include "job_rules.hpp"
+#include "decision_settings.hpp"
+#include "file_watcher.hpp"
+#include "pdca/outcome_reporter.hpp"
 
 using json = nlohmann::json;
 using namespace openkore_ai;
@@ -24,200 +48,476 @@ using namespace openkore_ai;
 // Global state
 auto start_time = std::chrono::steady_clock::now();
 
-// Global decision tiers
-std::unique_ptr<decision::ReflexTier> reflex_tier;
-std::unique_ptr<decision::RulesTier> rules_tier;
-std::unique_ptr<decision::MLTier> ml_tier;
-std::unique_ptr<decision::LLMTier> llm_tier;
-
-// Global coordinator manager (Phase 5)
-std::unique_ptr<coordinators::CoordinatorManager> coordinator_manager;
-
-// Statistics
-struct DecisionStats {
-    uint64_t reflex_count = 0;
-    uint64_t rules_count = 0;
-    uint64_t ml_count = 0;
-    uint64_t llm_count = 0;
-    uint64_t total_count = 0;
-    double avg_latency_ms = 0.0;
-    std::mutex stats_mutex;
-} stats;
-
-// Convert JSON to GameState
-GameState parse_game_state(const json& j) {
-    GameState state;
-    
-    // Parse character
-    state.character.name = j["character"]["name"];
-    state.character.level = j["character"]["level"];
-    state.character.hp = j["character"]["hp"];
-    state.character.max_hp = j["character"]["max_hp"];
-    state.character.sp = j["character"]["sp"];
-    state.character.max_sp = j["character"]["max_sp"];
-    state.character.position.map = j["character"]["position"]["map"];
-    state.character.position.x = j["character"]["position"]["x"];
-    state.character.position.y = j["character"]["position"]["y"];
-    state.character.weight = j["character"]["weight"];
-    state.character.max_weight = j["character"]["max_weight"];
-    state.character.zeny = j["character"]["zeny"];
-    state.character.job_class = j["character"]["job_class"];
-    
-    // Parse status effects
-    if (j["character"].contains("status_effects")) {
-        for (const auto& effect : j["character"]["status_effects"]) {
-            state.character.status_effects.push_back(effect);
-        }
+// Global decision tiers and coordinators
+DecisionPipeline pipeline;
+
+std::unique_ptr<StreamServer> stream_server;
+
+// Connections to the Python AI service, shared by the ML and LLM tiers and strategic planning
+std::shared_ptr<ServiceClientPool> python_service;
+
+// Streams strategic plans from the Python service, on threads of its own
+std::unique_ptr<StrategicProxy> strategic_proxy;
+
+// Record of the decisions for offline replay, if turned on
+std::unique_ptr<DecisionTrace> decision_trace;
+
+// Sends the outcome summaries of pipeline.outcomes to the Python service
+std::unique_ptr<pdca::OutcomeReporter> outcome_reporter;
+
+// Game states of the bots which send deltas
+SessionStore session_store;
+
+// The monsters the bots on a map see between them, added to each one's state; none shared without it
+std::unique_ptr<WorldBoard> world_board;
+
+// Where the sessions are saved for the next engine, see save_snapshot(); empty when they aren't
+std::string snapshot_path;
+
+// Saves the sessions, the state histories and what the coordinators keep about the characters to
+// snapshot_path, replacing the previous snapshot, and returns its size. Throws std::runtime_error if it
+// can't be written.
+size_t save_snapshot() {
+    static std::mutex saving;
+    std::lock_guard<std::mutex> lock(saving);
+    SnapshotWriter sessions;
+    SnapshotWriter history(sessions.now());
+    SnapshotWriter coordinators(sessions.now());
+    session_store.save(sessions);
+    pipeline.history->save(history);
+    std::vector<std::pair<SessionSnapshot::Section, const SnapshotWriter*>> sections = {
+        {SessionSnapshot::SESSIONS, &sessions}, {SessionSnapshot::HISTORY, &history}};
+    if (pipeline.ready(PipelineComponent::COORDINATORS) && pipeline.coordinators) {
+        pipeline.coordinators->save(coordinators);
+        sections.emplace_back(SessionSnapshot::COORDINATORS, &coordinators);
     }
-    
-    // Parse monsters
-    if (j.contains("monsters")) {
-        for (const auto& m : j["monsters"]) {
-            Monster monster;
-            monster.id = m["id"];
-            monster.name = m["name"];
-            monster.hp = m.value("hp", 0);
-            monster.max_hp = m.value("max_hp", 0);
-            monster.distance = m["distance"];
-            monster.is_aggressive = m.value("is_aggressive", false);
-            state.monsters.push_back(monster);
-        }
+    return SessionSnapshot::write(snapshot_path, sections);
+}
+
+// What the coordinators kept in a restored snapshot, given to them once they are set up
+struct CoordinatorSnapshot {
+    std::string data;
+    int64_t base_ms = 0;
+};
+
+// Restores the sessions and state histories of the snapshot at snapshot_path, if there is one, and removes
+// it: a snapshot is only restored once, by the engine started after the one which saved it. A snapshot which
+// can't be read is left for inspection after a warning, whatever was read of it is kept.
+CoordinatorSnapshot restore_snapshot() {
+    using namespace openkore_ai::logging;
+    CoordinatorSnapshot coordinators;
+    if (!std::filesystem::exists(snapshot_path)) {
+        return coordinators;
     }
-    
-    // Parse inventory
-    if (j.contains("inventory")) {
-        for (const auto& i : j["inventory"]) {
-            Item item;
-            item.id = i["id"];
-            item.name = i["name"];
-            item.amount = i["amount"];
-            item.type = i["type"];
-            state.inventory.push_back(item);
+    try {
+        size_t sessions = 0;
+        size_t characters = 0;
+        long long age_s = 0;
+        {
+            SessionSnapshot snapshot(snapshot_path);
+            age_s = std::chrono::duration_cast<std::chrono::seconds>(snapshot.age()).count();
+            if (auto section = snapshot.section(SessionSnapshot::SESSIONS)) {
+                sessions = session_store.restore(*section);
+            }
+            if (auto section = snapshot.section(SessionSnapshot::HISTORY)) {
+                characters = pipeline.history->restore(*section);
+            }
+            if (auto section = snapshot.section(SessionSnapshot::COORDINATORS)) {
+                coordinators.data = std::string(section->data());
+                coordinators.base_ms = section->base_ms();
+            }
         }
+        std::filesystem::remove(snapshot_path);
+        Logger::info("Restored " + std::to_string(sessions) + " sessions and the history of "
+                     + std::to_string(characters) + " characters from " + snapshot_path + ", saved "
+                     + std::to_string(age_s) + "s ago");
+    } catch (const std::exception& e) {
+        Logger::warning(std::string("Snapshot not restored: ") + e.what());
     }
-    
-    // Parse nearby players
-    if (j.contains("nearby_players")) {
-        for (const auto& player_json : j["nearby_players"]) {
-            Player player;
-            player.name = player_json["name"];
-            player.level = player_json["level"];
-            player.guild = player_json.value("guild", "");
-            player.distance = player_json["distance"];
-            player.is_party_member = player_json.value("is_party_member", false);
-            state.nearby_players.push_back(player);
+    return coordinators;
+}
+
+#ifndef _WIN32
+// Calls on_stop once SIGTERM or SIGINT arrives, from a thread of its own. The signals must be blocked in
+// every thread, see main(), so that only this one takes them.
+class StopSignals {
+public:
+    StopSignals(const sigset_t& signals, std::function<void()> on_stop)
+        : signals_(signals), thread_([this, on_stop = std::move(on_stop)] {
+              int signal = 0;
+              sigwait(&signals_, &signal);
+              if (!done_.exchange(true)) {
+                  on_stop();
+              }
+          }) {}
+
+    // Without a signal, wakes the thread with one
+    ~StopSignals() {
+        if (!done_.exchange(true)) {
+            pthread_kill(thread_.native_handle(), SIGTERM);
         }
+        thread_.join();
     }
-    
-    state.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        std::chrono::system_clock::now().time_since_epoch()
-    ).count();
-    
-    return state;
-}
 
-// Convert Action to JSON
-json action_to_json(const Action& action) {
-    json j;
-    j["type"] = action.type;
-    j["parameters"] = action.parameters;
-    j["reason"] = action.reason;
-    j["confidence"] = action.confidence;
-    return j;
-}
+    StopSignals(const StopSignals&) = delete;
+    StopSignals& operator=(const StopSignals&) = delete;
+
+private:
+    sigset_t signals_;
+    std::atomic<bool> done_{false};
+    std::thread thread_;
+};
+#endif
 
-// Convert DecisionTier to string
-std::string tier_to_string(DecisionTier tier) {
-    switch (tier) {
-        case DecisionTier::REFLEX: return "reflex";
-        case DecisionTier::RULES: return "rules";
-        case DecisionTier::ML: return "ml";
-        case DecisionTier::LLM: return "llm";
-        default: return "unknown";
+// The config file, whose decision settings apply again when it changes; empty without one
+std::string config_path;
+std::unique_ptr<FileWatcher> config_watcher;
+std::atomic<size_t> config_reloads{0};
+
+// Applies the decision settings of the config file from the next decision on; throws if the file can't be
+// read or is invalid, keeping the settings in use
+void reload_decision_settings() {
+    if (config_path.empty()) {
+        throw std::runtime_error("The engine was started without a config file");
     }
+    pipeline.configure(DecisionSettings::load(config_path));
+    config_reloads.fetch_add(1, std::memory_order_relaxed);
 }
 
+// Stage ids of the decide requests around the decision itself, see metrics::StageMetrics
+struct DecideStages {
+    size_t request;
+    size_t decode;
+    size_t parse;
+    size_t serialize;
+    size_t encode;
+
+    DecideStages() {
+        metrics::StageMetrics& stages = metrics::stages();
+        request = stages.stage("request");
+        decode = stages.stage("request.decode");
+        parse = stages.stage("request.parse");
+        serialize = stages.stage("response.serialize");
+        encode = stages.stage("response.encode");
+    }
+} decide_stages;
+
 // Multi-tier decision function
-DecisionResponse make_decision(const GameState& state, const std::string& request_id) {
-    auto start = std::chrono::steady_clock::now();
-    
-    DecisionResponse response;
-    response.request_id = request_id;
-    
-    // Tier 1: Reflex (<1ms)
-    if (reflex_tier->should_handle(state)) {
-        response.action = reflex_tier->decide(state);
-        response.tier_used = DecisionTier::REFLEX;
-        std::lock_guard<std::mutex> lock(stats.stats_mutex);
-        stats.reflex_count++;
-        stats.total_count++;
-        goto done;
+DecisionResponse make_decision(const GameState& state, const std::string& request_id,
+                               std::optional<std::chrono::steady_clock::time_point> deadline) {
+    return pipeline.decide(state, request_id, deadline);
+}
+
+// Status and body of the reply to one decide request. A decision is kept as its answer, which is only made
+// a document when one is needed, see reply_json; the JSON replies are written from it directly.
+struct DecideResult {
+    int status;
+    json body;
+    std::optional<DecideAnswer> answer;
+};
+
+// The body of a result as a document
+json& reply_json(DecideResult& result) {
+    if (result.answer) {
+        metrics::StageTimer timer(decide_stages.serialize);
+        result.body = decide_response_json(*result.answer);
+        result.answer.reset();
     }
+    return result.body;
+}
+
+// Decides on one decoded request, throws if it is malformed. Only the reflex tier and the memo decide when
+// reflex_only, as if the deadline had passed.
+// The game state is read from 'game_state_text' instead of the request when given, see split_decide_request.
+DecideResult decide_request(const json& request_json, bool reflex_only = false, std::string_view game_state_text = {}) {
+    using namespace openkore_ai::logging;
     
-    // Phase 5: Consult coordinator system (operates at tactical/rules level)
+    // Reused by the requests handled on this thread, so parsing doesn't allocate in the steady state
+    thread_local GameState state;
+    auto received = std::chrono::steady_clock::now();
+    std::string request_id;
+    std::string session_id;
+    uint64_t state_version = 0;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
     {
-        Action coordinator_action = coordinator_manager->get_coordinator_decision(state);
-        if (coordinator_action.type != "none") {
-            response.action = coordinator_action;
-            response.tier_used = DecisionTier::RULES;  // Coordinators operate at tactical level
-            std::lock_guard<std::mutex> lock(stats.stats_mutex);
-            stats.rules_count++;
-            stats.total_count++;
-            goto done;
+        metrics::StageTimer timer(decide_stages.parse);
+        request_id = request_json.value("request_id", "unknown");
+        session_id = request_json.value("session_id", "");
+        
+        // Milliseconds the client waits for the answer, counted from here
+        auto deadline_ms = request_json.find("deadline_ms");
+        if (deadline_ms != request_json.end()) {
+            double budget = deadline_ms->get<double>();
+            if (!(budget > 0)) {
+                throw std::invalid_argument("deadline_ms must be positive");
+            }
+            deadline = received + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                      std::chrono::duration<double, std::milli>(std::min(budget, 3600000.0)));
+        }
+        if (reflex_only) {
+            deadline = received;
+        }
+        
+        auto delta = request_json.find("delta");
+        if (delta != request_json.end()) {
+            // Patch the state kept from the previous requests of the session
+            if (session_id.empty()) {
+                throw std::invalid_argument("delta requests need a session_id");
+            }
+            std::optional<uint64_t> base_version;
+            if (request_json.contains("base_version")) {
+                base_version = request_json["base_version"].get<uint64_t>();
+            }
+            auto patched = session_store.update(session_id, base_version,
+                [&](GameState& stored) { apply_game_state_delta(stored, *delta); }, state);
+            if (!patched) {
+                // The client must send its full state again
+                json conflict_json;
+                conflict_json["error"] = "unknown session or stale base_version, send the full game_state";
+                conflict_json["session_id"] = session_id;
+                conflict_json["request_id"] = request_id;
+                OKAI_LOG_WARNING("DECIDE", "Session " << session_id << " needs a full state");
+                return {409, std::move(conflict_json), std::nullopt};
+            }
+            state_version = *patched;
+        } else {
+            if (!game_state_text.empty()) {
+                // nlohmann::json converts what the fast path can't, or throws as it always did
+                if (!parse_game_state_text(game_state_text, state)) {
+                    parse_game_state_into(json::parse(game_state_text), state);
+                }
+            } else {
+                parse_game_state_into(request_json.at("game_state"), state);
+            }
+            if (!session_id.empty()) {
+                state_version = session_store.put(session_id, state);
+            }
+        }
+        // After the session took the state, which keeps only the character's own monsters
+        if (world_board) {
+            world_board->share(state, received);
         }
     }
     
-    // Tier 2: Rules (<10ms)
-    if (rules_tier->should_handle(state)) {
-        response.action = rules_tier->decide(state);
-        response.tier_used = DecisionTier::RULES;
-        std::lock_guard<std::mutex> lock(stats.stats_mutex);
-        stats.rules_count++;
-        stats.total_count++;
-        goto done;
-    }
+    OKAI_LOG_INFO("DECIDE", "Request " << request_id
+                  << " - Character: " << state.character.name
+                  << " (Lv " << state.character.level << ", "
+                  << state.character.hp << "/" << state.character.max_hp << " HP)");
     
-    // Tier 3: ML (<100ms) - Phase 2: Stub
-    if (ml_tier->should_handle(state)) {
-        response.action = ml_tier->decide(state);
-        response.tier_used = DecisionTier::ML;
-        std::lock_guard<std::mutex> lock(stats.stats_mutex);
-        stats.ml_count++;
-        stats.total_count++;
-        goto done;
-    }
+    // Make decision using multi-tier system
+    DecisionResponse decision = make_decision(state, request_id, deadline);
     
-    // Tier 4: LLM (30-300s)
-    if (llm_tier->should_handle(state)) {
-        response.action = llm_tier->decide(state);
-        response.tier_used = DecisionTier::LLM;
-        std::lock_guard<std::mutex> lock(stats.stats_mutex);
-        stats.llm_count++;
-        stats.total_count++;
-        goto done;
+    OKAI_LOG_INFO("DECIDE", "Response: " << decision.action.type_name()
+                  << " via " << tier_to_string(decision.tier_used)
+                  << " (" << decision.latency_ms << "ms)");
+    return {200, json(), DecideAnswer{std::move(decision), std::move(session_id), state_version}};
+}
+
+// Threads deciding for fixed sets of characters, if turned on
+std::unique_ptr<AffinityPool> character_pool;
+
+// What routes a request to its thread of character_pool: the session, or the character. The name is read
+// into 'name' from the game state's text when there is one.
+std::string_view affinity_key(const json& request_json, std::string_view game_state_text, std::string& name) {
+    auto session = request_json.find("session_id");
+    if (session != request_json.end() && session->is_string() && !session->get_ref<const std::string&>().empty()) {
+        return session->get_ref<const std::string&>();
     }
+    if (!game_state_text.empty()) {
+        return read_character_name(game_state_text, name) ? std::string_view(name) : std::string_view();
+    }
+    auto game_state = request_json.find("game_state");
+    if (game_state != request_json.end() && game_state->is_object()) {
+        auto character = game_state->find("character");
+        if (character != game_state->end() && character->is_object()) {
+            auto name = character->find("name");
+            if (name != character->end() && name->is_string()) {
+                return name->get_ref<const std::string&>();
+            }
+        }
+    }
+    return {};
+}
+
+// Decides on one decoded request on the character's thread, or right here without character_pool
+DecideResult decide_for_character(const json& request_json, bool reflex_only, std::string_view game_state_text = {}) {
+    if (!character_pool) {
+        return decide_request(request_json, reflex_only, game_state_text);
+    }
+    DecideResult result{};
+    std::string name;
+    character_pool->run(affinity_key(request_json, game_state_text, name),
+                        [&] { result = decide_request(request_json, reflex_only, game_state_text); });
+    return result;
+}
+
+// Sheds the decide requests the engine has no time for, see AdmissionControl; null admits them all
+std::unique_ptr<AdmissionControl> admission;
+
+// Decides on one decoded request with 'decide' as admission allows: fully, by reflex only, or not at all
+// with 429 for non-critical requests, which the client tells with "critical": true
+template <typename Decide>
+DecideResult decide_admitted(const json& request_json, Decide&& decide) {
+    if (!admission) {
+        return decide(request_json, false);
+    }
+    auto critical = request_json.find("critical");
+    AdmissionControl::Ticket ticket = admission->admit(critical != request_json.end() && critical->is_boolean()
+                                                           && critical->get<bool>(),
+                                                       HttpTaskQueue::waiting());
+    if (ticket.verdict() == AdmissionControl::Verdict::REJECT) {
+        json busy_json;
+        busy_json["error"] = "engine overloaded, retry later";
+        busy_json["retry_after_s"] = admission->retry_after_s();
+        busy_json["request_id"] = request_json.value("request_id", "unknown");
+        return {429, std::move(busy_json), std::nullopt};
+    }
+    return decide(request_json, ticket.verdict() == AdmissionControl::Verdict::REFLEX_ONLY);
+}
+
+// Status and encoded body of the reply to a decide request
+struct DecideReply {
+    int status;
+    std::string body;
+};
+
+// Handles one decide request, for both the HTTP endpoint and the stream transport
+DecideReply handle_decide(const std::string& request_body, WireFormat request_format, WireFormat response_format,
+                          const std::string& path) {
+    using namespace openkore_ai::logging;
+    auto start_time = std::chrono::steady_clock::now();
+    // The whole request, so allocation counting builds also show what one costs in all
+    metrics::StageTimer request_timer(decide_stages.request);
     
-    // No tier handled this - default action
-    response.action.type = "none";
-    response.action.reason = "No tier required action";
-    response.action.confidence = 0.5f;
-    response.tier_used = DecisionTier::REFLEX;
-    
-done:
-    auto end = std::chrono::steady_clock::now();
-    response.latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    try {
+        // Log incoming request
+        Logger::log_request("POST", path, [&] { return loggable_body(request_body, request_format); },
+                            request_body.size());
+        
+        json request_json;
+        // The game state of a JSON request is left as text, which decide_request reads straight into its state
+        // without building a document; traces record whole requests, so they get them decoded
+        std::string_view game_state_text;
+        {
+            metrics::StageTimer timer(decide_stages.decode);
+            if (request_format != WireFormat::JSON || decision_trace
+                || !split_decide_request(request_body, request_json, game_state_text)) {
+                game_state_text = {};
+                request_json = decode_body(request_body, request_format);
+            }
+        }
+        DecideResult result = decide_admitted(request_json, [&](const json& request, bool reflex_only) {
+            return decide_for_character(request, reflex_only, game_state_text);
+        });
+        if (decision_trace) {
+            decision_trace->record(request_json, result.status, reply_json(result));
+        }
+        
+        std::string response_body;
+        if (result.answer && response_format == WireFormat::JSON) {
+            // Written in one pass into the thread's buffer, the same text is logged
+            metrics::StageTimer timer(decide_stages.serialize);
+            thread_local std::string written;
+            written.clear();
+            if (write_decide_response(*result.answer, written)) {
+                response_body = written;
+            }
+        }
+        if (response_body.empty()) {
+            json& body = reply_json(result);
+            metrics::StageTimer timer(decide_stages.encode);
+            response_body = encode_body(body, response_format);
+        }
+        
+        // Log response
+        auto end_time = std::chrono::steady_clock::now();
+        auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        Logger::log_response(path, result.status, latency_ms,
+                             [&] { return loggable_body(response_body, response_format); });
+        return {result.status, std::move(response_body)};
+        
+    } catch (const std::exception& e) {
+        Logger::error(std::string("Exception: ") + e.what(), "DECIDE");
+        
+        json error_json;
+        error_json["error"] = e.what();
+        
+        // Log error response
+        auto end_time = std::chrono::steady_clock::now();
+        auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        Logger::log_response(path, 500, latency_ms, [&] { return error_json.dump(); });
+        return {500, encode_body(error_json, response_format)};
+    }
+}
+
+// Most requests a batch may hold
+constexpr size_t MAX_BATCH_SIZE = 1024;
+
+// Threads deciding on the requests of the batches
+std::unique_ptr<WorkerPool> decide_pool;
+
+// Handles a batch of decide requests, each one is answered as if it came alone.
+// The body is an array of requests, or an object with them in "requests"; the reply has the replies in the
+// same order in "responses", each with its own "status".
+DecideReply handle_decide_batch(const std::string& request_body, WireFormat request_format,
+                                WireFormat response_format, const std::string& path) {
+    using namespace openkore_ai::logging;
+    auto start_time = std::chrono::steady_clock::now();
+    int status = 200;
+    json response_json;
     
-    // Update average latency
-    {
-        std::lock_guard<std::mutex> lock(stats.stats_mutex);
-        if (stats.total_count > 0) {
-            stats.avg_latency_ms = (stats.avg_latency_ms * (stats.total_count - 1) + response.latency_ms) / stats.total_count;
+    try {
+        Logger::log_request("POST", path, [&] { return loggable_body(request_body, request_format); },
+                            request_body.size());
+        
+        json batch_json;
+        {
+            metrics::StageTimer timer(decide_stages.decode);
+            batch_json = decode_body(request_body, request_format);
+        }
+        const json& requests = batch_json.is_object() ? batch_json.at("requests") : batch_json;
+        if (!requests.is_array()) {
+            throw std::invalid_argument("a batch must be an array of requests");
+        }
+        
+        if (requests.size() > MAX_BATCH_SIZE) {
+            status = 413;
+            response_json["error"] = "batches hold at most " + std::to_string(MAX_BATCH_SIZE) + " requests";
         } else {
-            stats.avg_latency_ms = response.latency_ms;
+            std::vector<json> replies(requests.size());
+            decide_pool->parallel_for(requests.size(), [&](size_t i) {
+                try {
+                    DecideResult result = decide_admitted(requests[i], [](const json& request, bool reflex_only) {
+                        return decide_request(request, reflex_only);
+                    });
+                    if (decision_trace) {
+                        decision_trace->record(requests[i], result.status, reply_json(result));
+                    }
+                    json& body = reply_json(result);
+                    body["status"] = result.status;
+                    replies[i] = std::move(body);
+                } catch (const std::exception& e) {
+                    Logger::error(std::string("Exception in batch item: ") + e.what(), "DECIDE");
+                    replies[i] = {{"status", 500}, {"error", e.what()}};
+                }
+            });
+            response_json["responses"] = std::move(replies);
         }
+    } catch (const std::exception& e) {
+        Logger::error(std::string("Exception: ") + e.what(), "DECIDE");
+        status = 500;
+        response_json = {{"error", e.what()}};
     }
     
-    return response;
+    std::string response_body;
+    {
+        metrics::StageTimer timer(decide_stages.encode);
+        response_body = encode_body(response_json, response_format);
+    }
+    auto end_time = std::chrono::steady_clock::now();
+    auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+    Logger::log_response(path, status, latency_ms, [&] { return loggable_body(response_body, response_format); });
+    return {status, std::move(response_body)};
 }
 
 // Helper function for early error reporting (before logger is ready)
@@ -228,7 +528,17 @@ void report_early_error(const std::string& message) {
 #endif
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+#ifndef _WIN32
+    // SIGTERM and SIGINT stop the server, which then saves the sessions, see StopSignals; blocked before any
+    // thread starts, as threads inherit the mask
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGTERM);
+    sigaddset(&stop_signals, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+#endif
+
     // PHASE 1: Early initialization checks (before any complex operations)
     try {
         std::cout << "[STARTUP] AI Engine starting..." << std::endl;
@@ -258,7 +568,6 @@ int main() {
             Logger::initialize("logs");
             Logger::info("========================================");
             Logger::info("OpenKore AI Engine v1.0.0 (Phase 5)");
-            Logger::info("Starting HTTP server on http://127.0.0.1:9901");
             Logger::info("Working directory: " + std::filesystem::current_path().string());
             Logger::info("========================================");
             std::cout << "[STARTUP] Logger initialized successfully" << std::endl;
@@ -268,13 +577,67 @@ int main() {
             return 1;
         }
         
-        // PHASE 3: Create HTTP server
+        // Server settings, from --config or ai-engine.yaml in the working directory
         using namespace openkore_ai::logging;
+        ServerConfig server_config;
+        DecisionSettings decision_settings;
+        try {
+            for (int i = 1; i + 1 < argc; i++) {
+                if (std::string(argv[i]) == "--config") {
+                    config_path = argv[i + 1];
+                }
+            }
+            if (config_path.empty() && std::filesystem::exists("ai-engine.yaml")) {
+                config_path = "ai-engine.yaml";
+            }
+            if (!config_path.empty()) {
+                server_config = ServerConfig::load(config_path);
+                decision_settings = DecisionSettings::load(config_path);
+                Logger::set_level(server_config.log_level);
+                Logger::set_site_limits(server_config.log_site_lines_per_s, server_config.log_suppress_repeats);
+                Logger::info("Server settings loaded from " + config_path);
+            }
+        } catch (const std::exception& e) {
+            std::string error_msg = std::string("Failed to load config: ") + e.what();
+            Logger::error(error_msg);
+            report_early_error(error_msg);
+            return 1;
+        }
+        if (server_config.log_async) {
+            Logger::start_async(server_config.log_ring_size);
+        }
+        
+        // PHASE 3: Create HTTP server
         std::cout << "[STARTUP] Creating HTTP server..." << std::endl;
         std::unique_ptr<httplib::Server> server;
         try {
             server = std::make_unique<httplib::Server>();
-            Logger::info("HTTP server instance created");
+            server->new_task_queue = [&server_config] {
+                return new HttpTaskQueue(server_config.http_threads(), server_config.queue_depth,
+                                         server_config.cpu_affinity);
+            };
+            server->set_keep_alive_max_count(server_config.keep_alive_max_count);
+            server->set_keep_alive_timeout(server_config.keep_alive_timeout_s);
+            server->set_read_timeout(server_config.read_timeout_ms / 1000, (server_config.read_timeout_ms % 1000) * 1000);
+            server->set_write_timeout(server_config.write_timeout_ms / 1000, (server_config.write_timeout_ms % 1000) * 1000);
+            
+            // Connections over the queue depth are answered at once, clients should retry shortly
+            server->set_pre_routing_handler([](const httplib::Request&, httplib::Response& res) {
+                if (!HttpTaskQueue::shedding()) {
+                    return httplib::Server::HandlerResponse::Unhandled;
+                }
+                res.status = 503;
+                res.set_header("Retry-After", "1");
+                res.set_header("Connection", "close");
+                res.set_content("{\"error\":\"server busy\"}", "application/json");
+                return httplib::Server::HandlerResponse::Handled;
+            });
+            
+            std::ostringstream settings;
+            settings << "HTTP server instance created (" << server_config.http_threads() << " threads, queue depth "
+                     << server_config.queue_depth << ", keep-alive " << server_config.keep_alive_max_count
+                     << " requests / " << server_config.keep_alive_timeout_s << "s)";
+            Logger::info(settings.str());
             std::cout << "[STARTUP] HTTP server created successfully" << std::endl;
         } catch (const std::exception& e) {
             std::string error_msg = std::string("Failed to create HTTP server: ") + e.what();
@@ -284,23 +647,106 @@ int main() {
         }
         
         // PHASE 4: Initialize decision tiers
+        CoordinatorSnapshot restored_coordinators;
         std::cout << "[STARTUP] Initializing decision tiers..." << std::endl;
         try {
             Logger::info("Initializing decision tiers...");
             
+            python_service = std::make_shared<ServiceClientPool>(
+                server_config.python_service_url, server_config.python_max_connections,
+                std::chrono::milliseconds(server_config.python_connect_timeout_ms));
+            strategic_proxy = std::make_unique<StrategicProxy>(
+                python_service, server_config.python_strategic_threads,
+                std::chrono::milliseconds(server_config.python_timeout_ms));
+            
+            size_t item_names = ItemDatabase::shared().load_names(server_config.items_table);
+            if (item_names > 0) {
+                Logger::info("Read " + std::to_string(item_names) + " item names from " + server_config.items_table);
+            } else {
+                Logger::warning("Can't read the item table " + server_config.items_table
+                                + ", only the engine's own consumables and loot are known");
+            }
+            
+            try {
+                JobRuleBook::shared().load(server_config.rules_file);
+                Logger::info("Job rules loaded from " + server_config.rules_file + " ("
+                             + std::to_string(JobRuleBook::shared().current()->jobs()) + " jobs)");
+            } catch (const std::exception& e) {
+                Logger::warning(std::string(e.what()) + ", using the built-in job rules");
+            }
+            if (server_config.rules_reload_check_ms > 0) {
+                JobRuleBook::shared().watch(std::chrono::milliseconds(server_config.rules_reload_check_ms));
+            }
+            
             Logger::debug("Creating ReflexTier...");
-            reflex_tier = std::make_unique<decision::ReflexTier>();
+            pipeline.reflex = std::make_unique<decision::ReflexTier>();
             
             Logger::debug("Creating RulesTier...");
-            rules_tier = std::make_unique<decision::RulesTier>();
+            pipeline.rules = std::make_unique<decision::RulesTier>();
+            
+            // The ML model and the LLM client load while the server already answers with the tiers above
+            Logger::debug("Loading MLTier...");
+            decision::QuantizedModel quantized;
+            if (server_config.ml_quantized) {
+                quantized.path = server_config.ml_quantized_model_path;
+                quantized.check_states = server_config.ml_quantized_check_states;
+                quantized.check_limit = server_config.ml_quantized_check_limit;
+                quantized.min_agreement = server_config.ml_quantized_min_agreement;
+            }
+            pipeline.load_in_background(PipelineComponent::ML,
+                [model = server_config.ml_model_path, batch_size = server_config.ml_batch_size,
+                 batch_delay = std::chrono::microseconds(server_config.ml_batch_delay_us),
+                 quantized] {
+                    pipeline.ml = std::make_unique<decision::MLTier>(python_service, model, batch_size, batch_delay,
+                                                                     quantized);
+                });
             
-            Logger::debug("Creating MLTier...");
-            ml_tier = std::make_unique<decision::MLTier>();
+            Logger::debug("Loading LLMTier...");
+            pipeline.load_in_background(PipelineComponent::LLM,
+                [timeout = std::chrono::milliseconds(server_config.python_timeout_ms)] {
+                    pipeline.llm = std::make_unique<decision::LLMTier>(python_service, timeout);
+                });
             
-            Logger::debug("Creating LLMTier...");
-            llm_tier = std::make_unique<decision::LLMTier>("http://127.0.0.1:9902");
+            pipeline.memo = std::make_unique<DecisionMemo>();
+            pipeline.history = std::make_unique<StateHistory>();
+            pipeline.party = std::make_unique<PartyBoard>();
+            if (server_config.snapshot_enabled) {
+                snapshot_path = server_config.snapshot_path;
+                restored_coordinators = restore_snapshot();
+            }
+            if (server_config.world_enabled) {
+                world_board = std::make_unique<WorldBoard>(std::chrono::milliseconds(server_config.world_ttl_ms));
+            }
+            if (server_config.speculation_threads > 0) {
+                pipeline.speculation = std::make_unique<Speculator>(server_config.speculation_threads,
+                    std::chrono::milliseconds(server_config.speculation_ttl_ms));
+                Logger::info("Deciding ahead on " + std::to_string(server_config.speculation_threads) + " threads");
+            }
+            if (server_config.pdca_enabled) {
+                pipeline.outcomes = std::make_unique<pdca::OutcomeBook>();
+                if (server_config.pdca_summary_interval_s > 0) {
+                    outcome_reporter = std::make_unique<pdca::OutcomeReporter>(*pipeline.outcomes, python_service,
+                        std::chrono::seconds(server_config.pdca_summary_interval_s),
+                        [] { return pipeline.outcome_sources(); });
+                }
+            }
             
-            Logger::info("All decision tiers initialized successfully");
+            decide_pool = std::make_unique<WorkerPool>(server_config.batch_workers());
+            if (server_config.admission_reflex_delay_ms > 0 || server_config.admission_reject_delay_ms > 0) {
+                size_t workers = server_config.character_threads > 0 ? server_config.character_threads
+                                                                     : server_config.http_threads();
+                admission = std::make_unique<AdmissionControl>(workers,
+                    std::chrono::milliseconds(server_config.admission_reflex_delay_ms),
+                    std::chrono::milliseconds(server_config.admission_reject_delay_ms));
+            }
+            if (server_config.character_threads > 0) {
+                character_pool = std::make_unique<AffinityPool>(server_config.character_threads,
+                                                                server_config.cpu_affinity);
+                Logger::info("Deciding for each character on one of " + std::to_string(server_config.character_threads)
+                             + " threads");
+            }
+            
+            Logger::info("Decision tiers initialized, ML and LLM loading in the background");
             std::cout << "[STARTUP] Decision tiers initialized successfully" << std::endl;
         } catch (const std::exception& e) {
             std::string error_msg = std::string("Failed to initialize decision tiers: ") + e.what();
@@ -313,10 +759,41 @@ int main() {
         std::cout << "[STARTUP] Initializing coordinator framework..." << std::endl;
         try {
             Logger::info("Initializing coordinator framework (Phase 5)...");
-            coordinator_manager = std::make_unique<coordinators::CoordinatorManager>();
-            coordinator_manager->initialize();
-            Logger::info("Coordinator framework initialized successfully");
-            std::cout << "[STARTUP] Coordinator framework initialized successfully" << std::endl;
+            // Decisions go without the coordinators until they are set up, then with the settings in use
+            pipeline.configure(decision_settings);
+            pipeline.load_in_background(PipelineComponent::COORDINATORS,
+                [parallel = server_config.parallel_coordinators, restored = std::move(restored_coordinators)] {
+                    auto manager = std::make_unique<coordinators::CoordinatorManager>();
+                    manager->initialize();
+                    if (!restored.data.empty()) {
+                        try {
+                            SnapshotReader in(restored.data.data(), restored.data.size(), restored.base_ms);
+                            size_t count = manager->restore(in);
+                            Logger::info("Restored the state of " + std::to_string(count) + " coordinators");
+                        } catch (const std::exception& e) {
+                            Logger::warning(std::string("Coordinator state not restored: ") + e.what());
+                        }
+                    }
+                    if (parallel) {
+                        manager->enable_parallel(*decide_pool);
+                        Logger::info("Coordinators evaluated in parallel, deadline "
+                                     + std::to_string(pipeline.settings().coordinator_deadline_us) + "us");
+                    }
+                    pipeline.coordinators = std::move(manager);
+                });
+            if (!config_path.empty() && server_config.config_reload_check_ms > 0) {
+                config_watcher = std::make_unique<FileWatcher>(config_path,
+                    std::chrono::milliseconds(server_config.config_reload_check_ms), [] {
+                        try {
+                            reload_decision_settings();
+                            Logger::info("Decision settings reloaded from " + config_path);
+                        } catch (const std::exception& e) {
+                            Logger::warning(std::string("Keeping the decision settings in use: ") + e.what());
+                        }
+                    });
+            }
+            Logger::info("Coordinator framework loading in the background");
+            std::cout << "[STARTUP] Coordinator framework loading..." << std::endl;
         } catch (const std::exception& e) {
             std::string error_msg = std::string("Failed to initialize coordinator framework: ") + e.what();
             Logger::error(error_msg);
@@ -324,69 +801,45 @@ int main() {
             return 1;
         }
     
+        // Binary record of the decisions, for ai-engine-replay; the engine runs without it if it can't be written
+        if (server_config.trace_enabled) {
+            try {
+                decision_trace = std::make_unique<DecisionTrace>(server_config.trace_directory,
+                                                                 server_config.trace_segment_size,
+                                                                 server_config.trace_max_segments);
+                Logger::info("Recording decisions to " + server_config.trace_directory);
+            } catch (const std::exception& e) {
+                Logger::warning(std::string("Decision trace disabled: ") + e.what());
+            }
+        }
+    
         // PHASE 6: Register HTTP endpoints
         std::cout << "[STARTUP] Registering HTTP endpoints..." << std::endl;
         Logger::info("Registering HTTP endpoints...");
         
         // POST /api/v1/decide - Main decision endpoint
         server->Post("/api/v1/decide", [](const httplib::Request& req, httplib::Response& res) {
-        using namespace openkore_ai::logging;
-        auto start_time = std::chrono::steady_clock::now();
+        WireFormat request_format = wire_format_of(req.get_header_value("Content-Type"), WireFormat::JSON);
+        WireFormat response_format = wire_format_of(req.get_header_value("Accept"), request_format);
         
-        try {
-            // Log incoming request
-            Logger::log_request("POST", "/api/v1/decide", req.body, req.body.size());
-            
-            json request_json = json::parse(req.body);
-            GameState state = parse_game_state(request_json["game_state"]);
-            std::string request_id = request_json.value("request_id", "unknown");
-            
-            std::ostringstream msg;
-            msg << "Request " << request_id
-                << " - Character: " << state.character.name
-                << " (Lv " << state.character.level << ", "
-                << state.character.hp << "/" << state.character.max_hp << " HP)";
-            Logger::info(msg.str(), "DECIDE");
-            
-            // Make decision using multi-tier system
-            DecisionResponse decision = make_decision(state, request_id);
-            
-            // Build response
-            json response_json;
-            response_json["action"] = action_to_json(decision.action);
-            response_json["tier_used"] = tier_to_string(decision.tier_used);
-            response_json["latency_ms"] = decision.latency_ms;
-            response_json["request_id"] = decision.request_id;
-            
-            std::ostringstream resp_msg;
-            resp_msg << "Response: " << decision.action.type
-                     << " via " << tier_to_string(decision.tier_used)
-                     << " (" << decision.latency_ms << "ms)";
-            Logger::info(resp_msg.str(), "DECIDE");
-            
-            res.set_content(response_json.dump(), "application/json");
-            res.status = 200;
-            
-            // Log response
-            auto end_time = std::chrono::steady_clock::now();
-            auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-            Logger::log_response("/api/v1/decide", 200, latency_ms, response_json.dump());
-            
-        } catch (const std::exception& e) {
-            Logger::error(std::string("Exception: ") + e.what(), "DECIDE");
-            
-            json error_json;
-            error_json["error"] = e.what();
-            res.set_content(error_json.dump(), "application/json");
-            res.status = 500;
-            
-            // Log error response
-            auto end_time = std::chrono::steady_clock::now();
-            auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-            Logger::log_response("/api/v1/decide", 500, latency_ms, error_json.dump());
+        DecideReply reply = handle_decide(req.body, request_format, response_format, "/api/v1/decide");
+        res.set_content(reply.body, wire_content_type(response_format));
+        res.status = reply.status;
+        if (reply.status == 429) {
+            res.set_header("Retry-After", std::to_string(admission->retry_after_s()));
         }
     });
     
+        // POST /api/v1/decide/batch - Decisions for many bots in one request
+        server->Post("/api/v1/decide/batch", [](const httplib::Request& req, httplib::Response& res) {
+        WireFormat request_format = wire_format_of(req.get_header_value("Content-Type"), WireFormat::JSON);
+        WireFormat response_format = wire_format_of(req.get_header_value("Accept"), request_format);
+        
+        DecideReply reply = handle_decide_batch(req.body, request_format, response_format, "/api/v1/decide/batch");
+        res.set_content(reply.body, wire_content_type(response_format));
+        res.status = reply.status;
+    });
+    
         // GET /api/v1/health - Health check endpoint
         server->Get("/api/v1/health", [](const httplib::Request&, httplib::Response& res) {
         auto now = std::chrono::steady_clock::now();
@@ -394,11 +847,27 @@ int main() {
         
         json health_json;
         health_json["status"] = "healthy";
-        health_json["components"]["reflex_tier"] = true;
-        health_json["components"]["rules_tier"] = true;
-        health_json["components"]["ml_tier"] = false;     // Stub only
-        health_json["components"]["llm_tier"] = true;
-        health_json["components"]["coordinator_framework"] = true;  // Phase 5
+        // A component is up once set up and turned on; those still loading are listed
+        DecisionSettings settings = pipeline.settings();
+        auto up = [](PipelineComponent component, bool enabled, bool set_up) {
+            return enabled && pipeline.ready(component) && set_up;
+        };
+        json& components = health_json["components"];
+        components["reflex_tier"] = up(PipelineComponent::REFLEX, settings.reflex_enabled, pipeline.reflex != nullptr);
+        components["rules_tier"] = up(PipelineComponent::RULES, settings.rules_enabled, pipeline.rules != nullptr);
+        components["ml_tier"] = up(PipelineComponent::ML, settings.ml_enabled, pipeline.ml != nullptr)
+                                && pipeline.ml->model_loaded();  // in-process model
+        components["llm_tier"] = up(PipelineComponent::LLM, settings.llm_enabled, pipeline.llm != nullptr);
+        components["coordinator_framework"] = up(PipelineComponent::COORDINATORS, true,
+                                                 pipeline.coordinators != nullptr);
+        json loading = json::array();
+        for (size_t component = 0; component < PIPELINE_COMPONENTS; component++) {
+            if (pipeline.loading(static_cast<PipelineComponent>(component))) {
+                loading.push_back(component_name(static_cast<PipelineComponent>(component)));
+            }
+        }
+        health_json["ready"] = loading.empty();
+        health_json["loading"] = std::move(loading);
         health_json["uptime_seconds"] = uptime_seconds;
         health_json["version"] = "1.0.0-phase5";
         
@@ -406,121 +875,223 @@ int main() {
         res.status = 200;
     });
     
+        // POST /api/v1/rules/reload - Compiles the job rules file again
+        server->Post("/api/v1/rules/reload", [](const httplib::Request&, httplib::Response& res) {
+        json reply;
+        try {
+            JobRuleBook::shared().reload();
+            reply["status"] = "reloaded";
+            reply["jobs"] = JobRuleBook::shared().current()->jobs();
+            res.status = 200;
+        } catch (const std::exception& e) {
+            reply["status"] = "error";
+            reply["error"] = e.what();
+            res.status = 400;
+        }
+        res.set_content(reply.dump(), "application/json");
+    });
+    
+        // POST /api/v1/config/reload - Applies the decision settings of the config file again
+        server->Post("/api/v1/config/reload", [](const httplib::Request&, httplib::Response& res) {
+        json reply;
+        try {
+            reload_decision_settings();
+            reply["status"] = "reloaded";
+            res.status = 200;
+        } catch (const std::exception& e) {
+            reply["status"] = "error";
+            reply["error"] = e.what();
+            res.status = 400;
+        }
+        res.set_content(reply.dump(), "application/json");
+    });
+    
+        // POST /api/v1/admin/snapshot - Saves the sessions for the next engine, see save_snapshot()
+        server->Post("/api/v1/admin/snapshot", [](const httplib::Request&, httplib::Response& res) {
+        json reply;
+        if (snapshot_path.empty()) {
+            reply["status"] = "error";
+            reply["error"] = "snapshots are disabled";
+            res.status = 400;
+        } else {
+            try {
+                reply["bytes"] = save_snapshot();
+                reply["status"] = "saved";
+                reply["path"] = snapshot_path;
+                reply["sessions"] = session_store.size();
+                res.status = 200;
+            } catch (const std::exception& e) {
+                reply["status"] = "error";
+                reply["error"] = e.what();
+                res.status = 500;
+            }
+        }
+        res.set_content(reply.dump(), "application/json");
+    });
+    
         // GET /api/v1/metrics - Metrics endpoint
         server->Get("/api/v1/metrics", [](const httplib::Request&, httplib::Response& res) {
-        std::lock_guard<std::mutex> lock(stats.stats_mutex);
+        metrics::DecisionMetrics::Snapshot snapshot = pipeline.metrics.snapshot();
+        auto latency_json = [](const metrics::LatencyHistogram::Snapshot& latency) {
+            json j;
+            j["count"] = latency.count;
+            j["mean"] = latency.mean();
+            j["p50"] = latency.percentile(0.50);
+            j["p90"] = latency.percentile(0.90);
+            j["p95"] = latency.percentile(0.95);
+            j["p99"] = latency.percentile(0.99);
+            j["max"] = latency.max;
+            return j;
+        };
         
         json metrics_json;
-        metrics_json["requests_total"] = stats.total_count;
-        metrics_json["requests_by_tier"]["reflex"] = stats.reflex_count;
-        metrics_json["requests_by_tier"]["rules"] = stats.rules_count;
-        metrics_json["requests_by_tier"]["ml"] = stats.ml_count;
-        metrics_json["requests_by_tier"]["llm"] = stats.llm_count;
-        metrics_json["avg_latency_ms"] = stats.avg_latency_ms;
+        metrics_json["requests_total"] = snapshot.total();
+        metrics_json["requests_unhandled"] = snapshot.unhandled;
+        metrics_json["sessions"] = session_store.size();
+        metrics_json["http_connections_shed"] = HttpTaskQueue::shed_count();
+        bool coordinators_ready = pipeline.ready(PipelineComponent::COORDINATORS) && pipeline.coordinators;
+        metrics_json["coordinators_late"] = coordinators_ready ? pipeline.coordinators->late_count() : 0;
+        metrics_json["log_lines_dropped"] = Logger::dropped_count();
+        metrics_json["log_lines_suppressed"] = Logger::suppressed_count();
+        metrics_json["python_service_clients"] = python_service->connections_opened();
+        metrics_json["strategic_in_flight"] = strategic_proxy->in_flight();
+        metrics_json["strategic_plans_refused"] = strategic_proxy->refused();
+        bool ml_ready = pipeline.ready(PipelineComponent::ML) && pipeline.ml;
+        metrics_json["ml_batches"] = ml_ready ? pipeline.ml->batches() : 0;
+        metrics_json["ml_batched_predictions"] = ml_ready ? pipeline.ml->batched_predictions() : 0;
+        metrics_json["ml_quantized"] = ml_ready && pipeline.ml->quantized();
+        metrics_json["job_rules_reloads"] = JobRuleBook::shared().reloads();
+        metrics_json["decisions_memoized"] = pipeline.memo->hits();
+        metrics_json["decisions_degraded"] = pipeline.degraded_count();
+        metrics_json["parties"] = pipeline.party->parties();
+        metrics_json["party_focus_shared"] = pipeline.party->shared_count();
+        metrics_json["world_maps"] = world_board ? world_board->maps() : 0;
+        metrics_json["world_monsters_shared"] = world_board ? world_board->shared_count() : 0;
+        metrics_json["decisions_reflex_only"] = admission ? admission->reflex_only_count() : 0;
+        metrics_json["decisions_rejected"] = admission ? admission->rejected_count() : 0;
+        metrics_json["decisions_in_flight"] = admission ? admission->in_flight() : 0;
+        metrics_json["decision_service_time_us"] = admission ? admission->service_time().count() : 0;
+        metrics_json["config_reloads"] = config_reloads.load(std::memory_order_relaxed);
+        if (pipeline.outcomes) {
+            metrics_json["pdca_outcomes"] = pipeline.outcomes->outcomes();
+            metrics_json["pdca_summaries_sent"] = outcome_reporter ? outcome_reporter->sent() : 0;
+            metrics_json["pdca_summaries_failed"] = outcome_reporter ? outcome_reporter->failed() : 0;
+        }
+        if (pipeline.speculation) {
+            metrics_json["speculated_decisions"] = pipeline.speculation->speculated();
+            metrics_json["speculation_hits"] = pipeline.speculation->hits();
+            metrics_json["speculations_dropped"] = pipeline.speculation->dropped();
+        }
+        if (decision_trace) {
+            metrics_json["trace_records"] = decision_trace->recorded();
+            metrics_json["trace_records_dropped"] = decision_trace->dropped();
+        }
+        for (size_t tier = 0; tier < metrics::DecisionMetrics::TIER_COUNT; tier++) {
+            std::string name = tier_to_string(static_cast<DecisionTier>(tier));
+            metrics_json["requests_by_tier"][name] = snapshot.counts[tier];
+            metrics_json["latency_us_by_tier"][name] = latency_json(snapshot.latency_us[tier]);
+        }
+        metrics_json["latency_us"] = latency_json(snapshot.total_latency_us);
+        metrics_json["avg_latency_ms"] = snapshot.total_latency_us.mean() / 1000.0;
+        for (const auto& [name, latency] : metrics::stages().snapshot()) {
+            metrics_json["latency_us_by_stage"][name] = latency_json(latency);
+        }
+        
+        alloc_stats::Memory memory = alloc_stats::memory();
+        json& memory_json = metrics_json["memory"];
+        memory_json["rss_bytes"] = memory.rss_bytes;
+        memory_json["peak_rss_bytes"] = memory.peak_rss_bytes;
+        if (memory.heap_known) {
+            memory_json["heap_arena_bytes"] = memory.heap_arena_bytes;
+            memory_json["heap_mmap_bytes"] = memory.heap_mmap_bytes;
+            memory_json["heap_in_use_bytes"] = memory.heap_in_use_bytes;
+            memory_json["heap_free_bytes"] = memory.heap_free_bytes;
+        }
+        if constexpr (alloc_stats::ENABLED) {
+            alloc_stats::Counts allocations = alloc_stats::process_counts();
+            metrics_json["allocations"] = {{"total", allocations.allocations},
+                                           {"frees", allocations.frees},
+                                           {"live", allocations.allocations - allocations.frees},
+                                           {"bytes", allocations.bytes}};
+            for (const auto& [name, counts] : metrics::stages().allocation_snapshot()) {
+                metrics_json["allocations_by_stage"][name] = latency_json(counts);
+            }
+        }
         
         res.set_content(metrics_json.dump(), "application/json");
         res.status = 200;
     });
     
+        // GET /metrics - The same metrics in the Prometheus text format
+        server->Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        std::array<std::string, metrics::DecisionMetrics::TIER_COUNT> tier_names;
+        for (size_t tier = 0; tier < tier_names.size(); tier++) {
+            tier_names[tier] = tier_to_string(static_cast<DecisionTier>(tier));
+        }
+        
+        res.set_content(metrics::prometheus_text(pipeline.metrics.snapshot(), tier_names, metrics::stages().snapshot()),
+                        "text/plain; version=0.0.4");
+        res.status = 200;
+    });
+    
         // POST /api/v1/strategic/plan - Strategic planning endpoint
         server->Post("/api/v1/strategic/plan", [](const httplib::Request& req, httplib::Response& res) {
-        using namespace openkore_ai::logging;
-        auto start_time = std::chrono::steady_clock::now();
-        
-        try {
-            Logger::log_request("POST", "/api/v1/strategic/plan", req.body, req.body.size());
-            Logger::info("Strategic planning request received", "STRATEGIC");
-            
-            // Forward request to Python AI Service on port 9902
-            httplib::Client client("127.0.0.1", 9902);
-            client.set_connection_timeout(0, 300000); // 300 seconds timeout for strategic planning
-            client.set_read_timeout(300, 0);          // 300 seconds read timeout
-            
-            auto response = client.Post("/api/v1/strategic/plan",
-                                       req.body,
-                                       "application/json");
-            
-            if (!response) {
-                Logger::error("Failed to connect to AI Service for strategic planning", "STRATEGIC");
-                
-                json error_json;
-                error_json["status"] = "error";
-                error_json["message"] = "Failed to connect to AI Service (port 9902)";
-                error_json["fallback_plan"] = "tactical_only";
-                
-                res.set_content(error_json.dump(), "application/json");
-                res.status = 503; // Service Unavailable
-                
-                auto end_time = std::chrono::steady_clock::now();
-                auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-                Logger::log_response("/api/v1/strategic/plan", 503, latency_ms, error_json.dump());
-                return;
-            }
-            
-            if (response->status != 200) {
-                Logger::warning(std::string("AI Service returned error: ") + std::to_string(response->status), "STRATEGIC");
-                
-                json error_json;
-                error_json["status"] = "error";
-                error_json["message"] = "AI Service strategic planning failed";
-                error_json["fallback_plan"] = "tactical_only";
-                error_json["details"] = response->body;
-                
-                res.set_content(error_json.dump(), "application/json");
-                res.status = response->status;
-                
-                auto end_time = std::chrono::steady_clock::now();
-                auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-                Logger::log_response("/api/v1/strategic/plan", response->status, latency_ms, error_json.dump());
-                return;
-            }
-            
-            // Success - forward response from AI Service
-            Logger::info("Strategic planning completed successfully", "STRATEGIC");
-            
-            res.set_content(response->body, "application/json");
-            res.status = 200;
-            
-            auto end_time = std::chrono::steady_clock::now();
-            auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-            Logger::log_response("/api/v1/strategic/plan", 200, latency_ms, response->body);
-            
-        } catch (const std::exception& e) {
-            Logger::error(std::string("Exception in strategic planning: ") + e.what(), "STRATEGIC");
-            
-            json error_json;
-            error_json["status"] = "error";
-            error_json["message"] = e.what();
-            error_json["fallback_plan"] = "tactical_only";
-            
-            res.set_content(error_json.dump(), "application/json");
-            res.status = 500;
-            
-            auto end_time = std::chrono::steady_clock::now();
-            auto latency_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
-            Logger::log_response("/api/v1/strategic/plan", 500, latency_ms, error_json.dump());
-        }
+        strategic_proxy->handle(req, res);
     });
     
         Logger::info("All HTTP endpoints registered");
         std::cout << "[STARTUP] HTTP endpoints registered successfully" << std::endl;
         
         // PHASE 7: Start server
-        std::cout << "[STARTUP] Starting HTTP server on 127.0.0.1:9901..." << std::endl;
+        std::string endpoint = server_config.host + ":" + std::to_string(server_config.port);
+        std::cout << "[STARTUP] Starting HTTP server on " << endpoint << "..." << std::endl;
         Logger::info("========================================");
         Logger::info("Server ready. Starting listener...");
-        Logger::info("Endpoint: http://127.0.0.1:9901");
+        Logger::info("Endpoint: http://" + endpoint);
         Logger::info("Logs directory: " + std::filesystem::absolute("logs").string());
         Logger::info("========================================");
         
         std::cout << "========================================" << std::endl;
         std::cout << "AI Engine is running!" << std::endl;
-        std::cout << "Endpoint: http://127.0.0.1:9901" << std::endl;
+        std::cout << "Endpoint: http://" << endpoint << std::endl;
         std::cout << "Press Ctrl+C to stop" << std::endl;
         std::cout << "========================================" << std::endl;
         
-        if (!server->listen("127.0.0.1", 9901)) {
-            std::string error_msg = "Failed to start server on port 9901 - port may be in use or access denied";
+        // Persistent socket transport for clients that decide every tick, HTTP keeps working without it
+        if (server_config.stream_port != 0) {
+            stream_server = std::make_unique<StreamServer>([](const std::string& body, WireFormat format) {
+                DecideReply reply = handle_decide(body, format, format, "stream");
+                return StreamServer::Reply{static_cast<uint16_t>(reply.status), std::move(reply.body)};
+            });
+            std::string stream_endpoint = server_config.host + ":" + std::to_string(server_config.stream_port);
+            if (stream_server->start(server_config.host, server_config.stream_port)) {
+                Logger::info("Stream endpoint: tcp://" + stream_endpoint);
+            } else {
+                Logger::warning("Failed to start stream transport on " + stream_endpoint + ", only HTTP is available");
+                stream_server.reset();
+            }
+        }
+        
+        bool listened;
+        {
+#ifndef _WIN32
+            std::atomic<bool> listen_returned{false};
+            StopSignals stop(stop_signals, [&listen_returned, &server] {
+                Logger::info("Stop signal received, stopping the server");
+                // The listener can't be stopped before it runs
+                while (!server->is_running() && !listen_returned) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                server->stop();
+            });
+#endif
+            listened = server->listen(server_config.host, server_config.port);
+#ifndef _WIN32
+            listen_returned = true;
+#endif
+        }
+        if (!listened) {
+            std::string error_msg = "Failed to start server on " + endpoint + " - port may be in use or access denied";
             Logger::error(error_msg);
             report_early_error(error_msg);
             Logger::cleanup();
@@ -528,6 +1099,22 @@ int main() {
         }
         
         // Server stopped
+        pipeline.wait_loaded();
+        config_watcher.reset();
+        outcome_reporter.reset();
+        strategic_proxy.reset();
+        stream_server.reset();
+        character_pool.reset();
+        // No decision changes the sessions anymore
+        if (!snapshot_path.empty()) {
+            try {
+                size_t bytes = save_snapshot();
+                Logger::info("Saved the sessions to " + snapshot_path + " (" + std::to_string(bytes) + " bytes)");
+            } catch (const std::exception& e) {
+                Logger::error(std::string("Sessions not saved: ") + e.what());
+            }
+        }
+        decision_trace.reset();
         Logger::info("Server stopped");
         Logger::cleanup();
         return 0;
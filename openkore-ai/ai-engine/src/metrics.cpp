@@ -0,0 +1,282 @@
+#include "../include/metrics.hpp"
+#include <algorithm>
+#include <bit>
+#include <iomanip>
+#include <sstream>
+
+namespace openkore_ai {
+namespace metrics {
+
+int LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < SUB_BUCKETS) {
+        return static_cast<int>(value);
+    }
+    int exponent = 63 - std::countl_zero(value);
+    if (exponent > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    int sub_bucket = static_cast<int>((value >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub_bucket;
+}
+
+uint64_t LatencyHistogram::bucket_upper_bound(int index) {
+    if (index < SUB_BUCKETS) {
+        return static_cast<uint64_t>(index);
+    }
+    int exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+    uint64_t sub_bucket = static_cast<uint64_t>(index % SUB_BUCKETS);
+    uint64_t width = uint64_t(1) << (exponent - SUB_BUCKET_BITS);
+    return (uint64_t(1) << exponent) + (sub_bucket + 1) * width - 1;
+}
+
+void LatencyHistogram::record(uint64_t value) {
+    buckets_[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::add_to(Snapshot& snapshot) const {
+    // Not an atomic copy, a snapshot taken during recording may be off by the values being recorded
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        snapshot.buckets[i] += buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count += count_.load(std::memory_order_relaxed);
+    snapshot.sum += sum_.load(std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    if (max > snapshot.max) {
+        snapshot.max = max;
+    }
+}
+
+void LatencyHistogram::Snapshot::add(const Snapshot& other) {
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max) {
+        max = other.max;
+    }
+}
+
+double LatencyHistogram::Snapshot::mean() const {
+    return count > 0 ? static_cast<double>(sum) / count : 0.0;
+}
+
+uint64_t LatencyHistogram::Snapshot::percentile(double q) const {
+    uint64_t total = 0;
+    for (uint64_t bucket : buckets) {
+        total += bucket;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(q * total);
+    if (rank >= total) {
+        rank = total - 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            // The last bucket also holds everything past its range
+            uint64_t bound = bucket_upper_bound(i);
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+uint64_t LatencyHistogram::Snapshot::count_at_most(uint64_t value) const {
+    uint64_t count = 0;
+    for (int i = 0; i < BUCKET_COUNT && bucket_upper_bound(i) <= value; i++) {
+        count += buckets[i];
+    }
+    return count;
+}
+
+uint64_t DecisionMetrics::Snapshot::total() const {
+    uint64_t total = 0;
+    for (uint64_t count : counts) {
+        total += count;
+    }
+    return total;
+}
+
+DecisionMetrics::Shard& DecisionMetrics::shard_for_thread() {
+    // Threads are spread over the shards in the order they first record something
+    thread_local size_t shard = next_shard_.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+    return shards_[shard];
+}
+
+void DecisionMetrics::record(DecisionTier tier, bool handled, uint64_t latency_us) {
+    Shard& shard = shard_for_thread();
+    if (!handled) {
+        shard.unhandled.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    size_t index = static_cast<size_t>(tier);
+    shard.counts[index].fetch_add(1, std::memory_order_relaxed);
+    shard.latency_us[index].record(latency_us);
+}
+
+DecisionMetrics::Snapshot DecisionMetrics::snapshot() const {
+    Snapshot snapshot;
+    for (const Shard& shard : shards_) {
+        for (size_t tier = 0; tier < TIER_COUNT; tier++) {
+            snapshot.counts[tier] += shard.counts[tier].load(std::memory_order_relaxed);
+            shard.latency_us[tier].add_to(snapshot.latency_us[tier]);
+        }
+        snapshot.unhandled += shard.unhandled.load(std::memory_order_relaxed);
+    }
+    for (size_t tier = 0; tier < TIER_COUNT; tier++) {
+        snapshot.total_latency_us.add(snapshot.latency_us[tier]);
+    }
+    return snapshot;
+}
+
+StageMetrics::~StageMetrics() {
+    for (Shard& shard : shards_) {
+        for (auto& histogram : shard.stages) {
+            delete histogram.load();
+        }
+        for (auto& histogram : shard.allocations) {
+            delete histogram.load();
+        }
+    }
+}
+
+size_t StageMetrics::stage(const std::string& name) {
+    std::lock_guard<std::mutex> lock(names_mutex_);
+    auto it = ids_.find(name);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    if (names_.size() == MAX_STAGES) {
+        return MAX_STAGES - 1;
+    }
+    names_.push_back(name);
+    ids_[name] = names_.size() - 1;
+    return names_.size() - 1;
+}
+
+LatencyHistogram& StageMetrics::histogram(Histograms Shard::*histograms, size_t stage) {
+    thread_local size_t shard_index = next_shard_.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+    std::atomic<LatencyHistogram*>& slot = (shards_[shard_index].*histograms)[stage];
+
+    LatencyHistogram* histogram = slot.load(std::memory_order_acquire);
+    if (!histogram) {
+        // Two threads of the same shard may race here, the loser uses the winner's histogram
+        LatencyHistogram* created = new LatencyHistogram();
+        if (slot.compare_exchange_strong(histogram, created, std::memory_order_acq_rel)) {
+            histogram = created;
+        } else {
+            delete created;
+        }
+    }
+    return *histogram;
+}
+
+void StageMetrics::record(size_t stage, uint64_t latency_us) {
+    histogram(&Shard::stages, stage).record(latency_us);
+}
+
+void StageMetrics::record_allocations(size_t stage, uint64_t allocations) {
+    histogram(&Shard::allocations, stage).record(allocations);
+}
+
+std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> StageMetrics::snapshot(Histograms Shard::*histograms) const {
+    std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> result;
+    {
+        std::lock_guard<std::mutex> lock(names_mutex_);
+        for (const std::string& name : names_) {
+            result.emplace_back(name, LatencyHistogram::Snapshot());
+        }
+    }
+    for (const Shard& shard : shards_) {
+        for (size_t stage = 0; stage < result.size(); stage++) {
+            const LatencyHistogram* histogram = (shard.*histograms)[stage].load(std::memory_order_acquire);
+            if (histogram) {
+                histogram->add_to(result[stage].second);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> StageMetrics::snapshot() const {
+    return snapshot(&Shard::stages);
+}
+
+std::vector<std::pair<std::string, LatencyHistogram::Snapshot>> StageMetrics::allocation_snapshot() const {
+    auto result = snapshot(&Shard::allocations);
+    result.erase(std::remove_if(result.begin(), result.end(), [](const auto& stage) { return stage.second.count == 0; }),
+                 result.end());
+    return result;
+}
+
+StageMetrics& stages() {
+    static StageMetrics metrics;
+    return metrics;
+}
+
+namespace {
+
+// Histogram bounds exported to Prometheus, in microseconds
+const uint64_t PROMETHEUS_BOUNDS_US[] = {
+    10, 25, 50, 100, 250, 500,
+    1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000,
+    1000000, 2500000, 5000000, 10000000, 30000000, 60000000, 120000000, 300000000
+};
+
+void write_histogram(std::ostringstream& out, const std::string& name, const std::string& labels,
+                     const LatencyHistogram::Snapshot& histogram) {
+    std::string separator = labels.empty() ? "" : ",";
+    for (uint64_t bound : PROMETHEUS_BOUNDS_US) {
+        out << name << "_bucket{" << labels << separator << "le=\"" << bound / 1e6 << "\"} "
+            << histogram.count_at_most(bound) << "\n";
+    }
+    out << name << "_bucket{" << labels << separator << "le=\"+Inf\"} " << histogram.count << "\n";
+    out << name << "_sum" << (labels.empty() ? "" : "{" + labels + "}") << " " << histogram.sum / 1e6 << "\n";
+    out << name << "_count" << (labels.empty() ? "" : "{" + labels + "}") << " " << histogram.count << "\n";
+}
+
+} // namespace
+
+std::string prometheus_text(const DecisionMetrics::Snapshot& decisions,
+                            const std::array<std::string, DecisionMetrics::TIER_COUNT>& tier_names,
+                            const std::vector<std::pair<std::string, LatencyHistogram::Snapshot>>& stages) {
+    std::ostringstream out;
+    out << std::setprecision(9);
+
+    out << "# HELP openkore_ai_decisions_total Decisions made, by the tier which made them.\n";
+    out << "# TYPE openkore_ai_decisions_total counter\n";
+    for (size_t tier = 0; tier < DecisionMetrics::TIER_COUNT; tier++) {
+        out << "openkore_ai_decisions_total{tier=\"" << tier_names[tier] << "\"} " << decisions.counts[tier] << "\n";
+    }
+    out << "# HELP openkore_ai_decisions_unhandled_total Decisions no tier made an action for.\n";
+    out << "# TYPE openkore_ai_decisions_unhandled_total counter\n";
+    out << "openkore_ai_decisions_unhandled_total " << decisions.unhandled << "\n";
+
+    out << "# HELP openkore_ai_decision_duration_seconds Time to make a decision, by tier.\n";
+    out << "# TYPE openkore_ai_decision_duration_seconds histogram\n";
+    for (size_t tier = 0; tier < DecisionMetrics::TIER_COUNT; tier++) {
+        write_histogram(out, "openkore_ai_decision_duration_seconds", "tier=\"" + tier_names[tier] + "\"", decisions.latency_us[tier]);
+    }
+
+    out << "# HELP openkore_ai_stage_duration_seconds Time spent in each stage of the decide requests.\n";
+    out << "# TYPE openkore_ai_stage_duration_seconds histogram\n";
+    for (const auto& [name, histogram] : stages) {
+        write_histogram(out, "openkore_ai_stage_duration_seconds", "stage=\"" + name + "\"", histogram);
+    }
+    return out.str();
+}
+
+} // namespace metrics
+} // namespace openkore_ai
@@ -0,0 +1,44 @@
+#include "../include/party_board.hpp"
+#include "../include/state_summary.hpp"
+#include <algorithm>
+
+namespace openkore_ai {
+
+const Monster* PartyBoard::focus(const GameState& state, const Monster* own, std::chrono::steady_clock::time_point now) {
+    if (state.party_id.empty()) {
+        return own;
+    }
+    const std::string& character = state.character.name;
+    std::string key = state.party_id;
+    key += '\0';
+    key += state.character.position.map;
+
+    return parties_.with(key, [&](Party& party) -> const Monster* {
+        if (!party.focus_id.empty()) {
+            auto focus = std::find_if(state.monsters.begin(), state.monsters.end(), [&](const Monster& monster) {
+                return monster.id == party.focus_id && monster.distance <= MonsterSummary::TARGET_RANGE;
+            });
+            if (focus != state.monsters.end()) {
+                party.seen = now;
+                if (&*focus != own) {
+                    shared_.fetch_add(1, std::memory_order_relaxed);
+                }
+                return &*focus;
+            }
+            if (party.chosen_by != character && now - party.seen < FOCUS_TTL) {
+                return own;
+            }
+        }
+        // No focus, or it's gone: the character's own target is the party's next one
+        if (own) {
+            party.focus_id = own->id;
+            party.chosen_by = character;
+            party.seen = now;
+        } else {
+            party.focus_id.clear();
+        }
+        return own;
+    });
+}
+
+} // namespace openkore_ai
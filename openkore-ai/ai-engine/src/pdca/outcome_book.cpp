@@ -0,0 +1,170 @@
+#include "../../include/pdca/outcome_book.hpp"
+#include "../../include/action.hpp"
+#include <algorithm>
+#include <map>
+#include <optional>
+#include <utility>
+
+namespace openkore_ai {
+namespace pdca {
+
+namespace {
+
+// The outcome of a character's previous decision, as its state is now
+struct Outcome {
+    uint16_t source;
+    ActionKind kind;
+    bool died;
+    int32_t hp_lost;
+    int32_t max_hp;
+    int32_t exp_gained;
+    int64_t duration_ms;
+};
+
+} // namespace
+
+OutcomeBook::~OutcomeBook() {
+    for (Shard& shard : shards_) {
+        for (auto& row : shard.rows) {
+            delete row.load();
+        }
+    }
+}
+
+size_t OutcomeBook::hp_loss_bucket(int hp_lost, int max_hp) {
+    if (hp_lost <= 0) {
+        return 0;
+    }
+    float share = static_cast<float>(hp_lost) / static_cast<float>(std::max(1, max_hp));
+    if (share < 0.05f) return 1;
+    if (share < 0.10f) return 2;
+    if (share < 0.25f) return 3;
+    if (share < 0.50f) return 4;
+    return 5;
+}
+
+OutcomeBook::Cell& OutcomeBook::cell(uint16_t source, ActionKind kind) {
+    thread_local size_t shard_index = next_shard_.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+    std::atomic<Row*>& slot = shards_[shard_index].rows[std::min<size_t>(source, MAX_SOURCES - 1)];
+
+    Row* row = slot.load(std::memory_order_acquire);
+    if (!row) {
+        // Two threads of the same shard may race here, the loser uses the winner's row
+        Row* created = new Row();
+        if (slot.compare_exchange_strong(row, created, std::memory_order_acq_rel)) {
+            row = created;
+        } else {
+            delete created;
+        }
+    }
+    return (*row)[static_cast<size_t>(kind)];
+}
+
+void OutcomeBook::record(const GameState& state, uint16_t source, ActionKind kind,
+                         std::chrono::steady_clock::time_point now) {
+    const CharacterState& character = state.character;
+    int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+
+    std::optional<Outcome> outcome = pending_.with(character.name, [&](Pending& pending) {
+        std::optional<Outcome> previous;
+        if (pending.time_ms >= 0 && now_ms - pending.time_ms <= MAX_GAP.count()) {
+            int32_t exp_gained = 0;
+            if (character.level == pending.level) {
+                exp_gained = std::max(0, character.base_exp - pending.base_exp);
+            } else if (character.level > pending.level) {
+                // Exp starts again at a level up, what was gained before it isn't known
+                exp_gained = std::max(0, character.base_exp);
+            }
+            previous = Outcome{pending.source, pending.kind, pending.hp > 0 && character.hp <= 0,
+                               std::max(0, pending.hp - character.hp), pending.max_hp, exp_gained,
+                               now_ms - pending.time_ms};
+        }
+        pending = Pending{now_ms, source, kind, character.hp, character.max_hp, character.level, character.base_exp};
+        return previous;
+    });
+    if (!outcome) {
+        return;
+    }
+
+    bool success = !outcome->died
+        && static_cast<float>(outcome->hp_lost) <= FAILURE_HP_SHARE * static_cast<float>(std::max(1, outcome->max_hp));
+    Cell& aggregate = cell(outcome->source, outcome->kind);
+    aggregate.outcomes.fetch_add(1, std::memory_order_relaxed);
+    if (success) {
+        aggregate.successes.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (outcome->died) {
+        aggregate.deaths.fetch_add(1, std::memory_order_relaxed);
+    }
+    aggregate.hp_lost.fetch_add(static_cast<uint64_t>(outcome->hp_lost), std::memory_order_relaxed);
+    aggregate.exp_gained.fetch_add(static_cast<uint64_t>(outcome->exp_gained), std::memory_order_relaxed);
+    aggregate.duration_ms.fetch_add(static_cast<uint64_t>(outcome->duration_ms), std::memory_order_relaxed);
+    aggregate.hp_loss[hp_loss_bucket(outcome->hp_lost, outcome->max_hp)].fetch_add(1, std::memory_order_relaxed);
+    outcomes_.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::vector<OutcomeBook::Entry> OutcomeBook::take() {
+    std::map<std::pair<uint16_t, size_t>, Aggregate> totals;
+    auto take_counter = [](std::atomic<uint64_t>& counter) { return counter.exchange(0, std::memory_order_relaxed); };
+    for (Shard& shard : shards_) {
+        for (size_t source = 0; source < MAX_SOURCES; source++) {
+            Row* row = shard.rows[source].load(std::memory_order_acquire);
+            if (!row) {
+                continue;
+            }
+            for (size_t kind = 0; kind < KIND_COUNT; kind++) {
+                Cell& cell = (*row)[kind];
+                uint64_t outcomes = take_counter(cell.outcomes);
+                if (outcomes == 0) {
+                    continue;
+                }
+                Aggregate& total = totals[{static_cast<uint16_t>(source), kind}];
+                total.outcomes += outcomes;
+                total.successes += take_counter(cell.successes);
+                total.deaths += take_counter(cell.deaths);
+                total.hp_lost += take_counter(cell.hp_lost);
+                total.exp_gained += take_counter(cell.exp_gained);
+                total.duration_ms += take_counter(cell.duration_ms);
+                for (size_t bucket = 0; bucket < HP_LOSS_BUCKETS; bucket++) {
+                    total.hp_loss[bucket] += take_counter(cell.hp_loss[bucket]);
+                }
+            }
+        }
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve(totals.size());
+    for (const auto& [key, aggregate] : totals) {
+        entries.push_back({key.first, static_cast<ActionKind>(key.second), aggregate});
+    }
+    return entries;
+}
+
+nlohmann::json summary_json(const std::vector<OutcomeBook::Entry>& entries,
+                            const std::vector<std::string>& source_names, double window_s) {
+    nlohmann::json outcomes = nlohmann::json::array();
+    for (const OutcomeBook::Entry& entry : entries) {
+        const OutcomeBook::Aggregate& aggregate = entry.aggregate;
+        double count = static_cast<double>(aggregate.outcomes);
+        std::string_view kind = entry.kind == ActionKind::OTHER ? std::string_view("other") : action_kind_name(entry.kind);
+        nlohmann::json outcome;
+        outcome["source"] = entry.source < source_names.size() ? source_names[entry.source]
+                                                                : "source." + std::to_string(entry.source);
+        outcome["action"] = kind;
+        outcome["outcomes"] = aggregate.outcomes;
+        outcome["successes"] = aggregate.successes;
+        outcome["success_rate"] = aggregate.successes / count;
+        outcome["deaths"] = aggregate.deaths;
+        outcome["hp_lost"] = aggregate.hp_lost;
+        outcome["hp_lost_mean"] = aggregate.hp_lost / count;
+        outcome["exp_gained"] = aggregate.exp_gained;
+        outcome["exp_gained_mean"] = aggregate.exp_gained / count;
+        outcome["duration_ms_mean"] = aggregate.duration_ms / count;
+        outcome["hp_loss_buckets"] = aggregate.hp_loss;
+        outcomes.push_back(std::move(outcome));
+    }
+    return {{"window_s", window_s}, {"outcomes", std::move(outcomes)}};
+}
+
+} // namespace pdca
+} // namespace openkore_ai
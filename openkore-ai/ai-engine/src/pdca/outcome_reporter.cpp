@@ -0,0 +1,68 @@
+#include "../../include/pdca/outcome_reporter.hpp"
+#include "../../include/logger.hpp"
+#include <exception>
+
+namespace openkore_ai {
+namespace pdca {
+
+namespace {
+
+// Longest wait for the service to take a summary
+constexpr std::chrono::milliseconds REPORT_TIMEOUT{5000};
+
+} // namespace
+
+OutcomeReporter::OutcomeReporter(OutcomeBook& book, std::shared_ptr<ServiceClientPool> service,
+                                 std::chrono::seconds interval, std::function<std::vector<std::string>()> source_names)
+    : book_(book), service_(std::move(service)), interval_(interval), source_names_(std::move(source_names)) {
+    thread_ = std::thread([this] { run(); });
+}
+
+OutcomeReporter::~OutcomeReporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    stop_.notify_all();
+    thread_.join();
+}
+
+void OutcomeReporter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto window_start = std::chrono::steady_clock::now();
+    while (!stop_.wait_for(lock, interval_, [this] { return stopping_; })) {
+        auto now = std::chrono::steady_clock::now();
+        double window_s = std::chrono::duration<double>(now - window_start).count();
+        window_start = now;
+        lock.unlock();
+        report(window_s);
+        lock.lock();
+    }
+}
+
+void OutcomeReporter::report(double window_s) {
+    std::vector<OutcomeBook::Entry> entries = book_.take();
+    if (entries.empty()) {
+        return;
+    }
+    try {
+        std::string body = summary_json(entries, source_names_(), window_s).dump();
+        ServiceClientPool::Lease client = service_->acquire(REPORT_TIMEOUT);
+        if (!client) {
+            OKAI_LOG_WARNING("PDCA", "No free connection to the Python service for the outcome summary");
+        } else if (auto response = client->Post("/api/v1/pdca/outcomes", body, "application/json");
+                   response && response->status == 200) {
+            sent_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            OKAI_LOG_WARNING("PDCA", "Outcome summary not taken by the Python service: "
+                             << (response ? response->status : -1));
+        }
+    } catch (const std::exception& e) {
+        OKAI_LOG_WARNING("PDCA", "Outcome summary not sent: " << e.what());
+    }
+    failed_.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // namespace pdca
+} // namespace openkore_ai
@@ -0,0 +1,249 @@
+#include "../include/server_config.hpp"
+#include "../include/config_file.hpp"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+
+namespace openkore_ai {
+
+using config::to_bool;
+using config::to_number;
+using config::trim;
+
+std::vector<int> parse_cpu_list(const std::string& text) {
+    std::vector<int> cpus;
+    for (const std::string& item : config::to_list(text)) {
+        size_t dash = item.find('-');
+        int first = static_cast<int>(to_number(trim(item.substr(0, dash)), 0, 4095));
+        int last = dash == std::string::npos ? first
+                                             : static_cast<int>(to_number(trim(item.substr(dash + 1)), first, 4095));
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+ServerConfig ServerConfig::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot read config file " + path);
+    }
+
+    ServerConfig config;
+    config::read_entries(file, [&](const std::string& section, const std::string& key, const std::string& value,
+                                   int line_number) {
+        if (section == "logging") {
+            if (key == "level") {
+                try {
+                    config.log_level = logging::Logger::parse_level(value);
+                } catch (const std::invalid_argument&) {
+                    throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid logging.level: "
+                                             + value);
+                }
+            }
+            try {
+                if (key == "async") {
+                    config.log_async = to_bool(value);
+                } else if (key == "ring_size") {
+                    config.log_ring_size = static_cast<size_t>(to_number(value, 16, 1 << 24));
+                } else if (key == "site_lines_per_s") {
+                    config.log_site_lines_per_s = static_cast<uint32_t>(to_number(value, 0, 1000000));
+                } else if (key == "suppress_repeats") {
+                    config.log_suppress_repeats = to_bool(value);
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for logging."
+                                         + key + ": " + value);
+            }
+            return;
+        }
+        if (section == "python_service") {
+            try {
+                if (key == "url") {
+                    config.python_service_url = value;
+                } else if (key == "max_connections") {
+                    config.python_max_connections = static_cast<size_t>(to_number(value, 1, 1024));
+                } else if (key == "connect_timeout_ms") {
+                    config.python_connect_timeout_ms = static_cast<int>(to_number(value, 1, 3600000));
+                } else if (key == "timeout_ms") {
+                    config.python_timeout_ms = static_cast<int>(to_number(value, 1, 3600000));
+                } else if (key == "strategic_threads") {
+                    config.python_strategic_threads = static_cast<size_t>(to_number(value, 1, 256));
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for python_service."
+                                         + key + ": " + value);
+            }
+            return;
+        }
+        if (section == "ml") {
+            try {
+                if (key == "model_path") {
+                    config.ml_model_path = value;
+                } else if (key == "batch_size") {
+                    config.ml_batch_size = static_cast<size_t>(to_number(value, 1, 4096));
+                } else if (key == "batch_delay_us") {
+                    config.ml_batch_delay_us = static_cast<int>(to_number(value, 0, 1000000));
+                } else if (key == "quantized") {
+                    config.ml_quantized = to_bool(value);
+                } else if (key == "quantized_model_path") {
+                    config.ml_quantized_model_path = value;
+                } else if (key == "quantized_check_states") {
+                    config.ml_quantized_check_states = value;
+                } else if (key == "quantized_check_limit") {
+                    config.ml_quantized_check_limit = static_cast<size_t>(to_number(value, 1, 1000000));
+                } else if (key == "quantized_min_agreement") {
+                    config.ml_quantized_min_agreement = config::to_real(value, 0, 1);
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for ml."
+                                         + key + ": " + value);
+            }
+            return;
+        }
+        if (section == "items") {
+            if (key == "table") {
+                config.items_table = value;
+            }
+            return;
+        }
+        if (section == "rules") {
+            try {
+                if (key == "file") {
+                    config.rules_file = value;
+                } else if (key == "reload_check_ms") {
+                    config.rules_reload_check_ms = static_cast<int>(to_number(value, 0, 3600000));
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for rules."
+                                         + key + ": " + value);
+            }
+            return;
+        }
+        if (section == "trace") {
+            try {
+                if (key == "enabled") {
+                    config.trace_enabled = to_bool(value);
+                } else if (key == "directory") {
+                    config.trace_directory = value;
+                } else if (key == "segment_mb") {
+                    config.trace_segment_size = static_cast<size_t>(to_number(value, 1, 4095)) << 20;
+                } else if (key == "max_segments") {
+                    config.trace_max_segments = static_cast<size_t>(to_number(value, 1, 1 << 20));
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for trace."
+                                         + key + ": " + value);
+            }
+            return;
+        }
+        if (section == "pdca") {
+            try {
+                if (key == "enabled") {
+                    config.pdca_enabled = to_bool(value);
+                } else if (key == "summary_interval_s") {
+                    config.pdca_summary_interval_s = static_cast<int>(to_number(value, 0, 86400));
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for pdca."
+                                         + key + ": " + value);
+            }
+            return;
+        }
+        if (section == "speculation") {
+            try {
+                if (key == "threads") {
+                    config.speculation_threads = static_cast<size_t>(to_number(value, 0, 256));
+                } else if (key == "ttl_ms") {
+                    config.speculation_ttl_ms = static_cast<int>(to_number(value, 1, 3600000));
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for speculation."
+                                         + key + ": " + value);
+            }
+            return;
+        }
+        if (section == "world") {
+            try {
+                if (key == "enabled") {
+                    config.world_enabled = to_bool(value);
+                } else if (key == "ttl_ms") {
+                    config.world_ttl_ms = static_cast<int>(to_number(value, 1, 3600000));
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for world."
+                                         + key + ": " + value);
+            }
+            return;
+        }
+        if (section == "snapshot") {
+            try {
+                if (key == "enabled") {
+                    config.snapshot_enabled = to_bool(value);
+                } else if (key == "path") {
+                    config.snapshot_path = value;
+                }
+            } catch (const std::logic_error&) {
+                throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for snapshot."
+                                         + key + ": " + value);
+            }
+            return;
+        }
+        if (section != "server") {
+            return;
+        }
+
+        try {
+            if (key == "host") {
+                config.host = value;
+            } else if (key == "port") {
+                config.port = static_cast<int>(to_number(value, 1, 65535));
+            } else if (key == "stream_port") {
+                config.stream_port = static_cast<int>(to_number(value, 0, 65535));
+            } else if (key == "threads") {
+                config.threads = static_cast<size_t>(to_number(value, 0, 1024));
+            } else if (key == "queue_depth") {
+                config.queue_depth = static_cast<size_t>(to_number(value, 0, 1 << 20));
+            } else if (key == "batch_threads") {
+                config.batch_threads = static_cast<size_t>(to_number(value, 0, 1024));
+            } else if (key == "character_threads") {
+                config.character_threads = static_cast<size_t>(to_number(value, 0, 1024));
+            } else if (key == "admission_reflex_delay_ms") {
+                config.admission_reflex_delay_ms = static_cast<int>(to_number(value, 0, 3600000));
+            } else if (key == "admission_reject_delay_ms") {
+                config.admission_reject_delay_ms = static_cast<int>(to_number(value, 0, 3600000));
+            } else if (key == "keep_alive_max_count") {
+                config.keep_alive_max_count = static_cast<size_t>(to_number(value, 1, 1 << 20));
+            } else if (key == "keep_alive_timeout_s") {
+                config.keep_alive_timeout_s = static_cast<int>(to_number(value, 1, 3600));
+            } else if (key == "read_timeout_ms") {
+                config.read_timeout_ms = static_cast<int>(to_number(value, 1, 3600000));
+            } else if (key == "write_timeout_ms") {
+                config.write_timeout_ms = static_cast<int>(to_number(value, 1, 3600000));
+            } else if (key == "cpu_affinity") {
+                config.cpu_affinity = parse_cpu_list(value);
+            } else if (key == "parallel_coordinators") {
+                config.parallel_coordinators = to_bool(value);
+            } else if (key == "config_reload_check_ms") {
+                config.config_reload_check_ms = static_cast<int>(to_number(value, 0, 3600000));
+            }
+        } catch (const std::logic_error&) {
+            throw std::runtime_error(path + ":" + std::to_string(line_number) + ": invalid value for server." + key
+                                     + ": " + value);
+        }
+    });
+    return config;
+}
+
+size_t ServerConfig::http_threads() const {
+    return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+size_t ServerConfig::batch_workers() const {
+    // The thread handling a batch works on it too
+    return batch_threads ? batch_threads : std::max(1u, std::thread::hardware_concurrency()) - 1;
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,76 @@
+#include "../include/service_client.hpp"
+#include <stdexcept>
+
+namespace openkore_ai {
+
+ServiceClientPool::Lease& ServiceClientPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        if (client_) {
+            pool_->release(std::move(client_));
+        }
+        pool_ = other.pool_;
+        client_ = std::move(other.client_);
+    }
+    return *this;
+}
+
+ServiceClientPool::Lease::~Lease() {
+    if (client_) {
+        pool_->release(std::move(client_));
+    }
+}
+
+ServiceClientPool::ServiceClientPool(std::string url, size_t max_connections,
+                                     std::chrono::milliseconds connect_timeout)
+    : url_(std::move(url)), max_connections_(max_connections ? max_connections : 1),
+      connect_timeout_(connect_timeout) {
+    if (!make_client()->is_valid()) {
+        throw std::invalid_argument("invalid Python service URL " + url_);
+    }
+}
+
+std::unique_ptr<httplib::Client> ServiceClientPool::make_client() const {
+    auto client = std::make_unique<httplib::Client>(url_);
+    client->set_keep_alive(true);
+    auto connect_us = std::chrono::duration_cast<std::chrono::microseconds>(connect_timeout_).count();
+    client->set_connection_timeout(connect_us / 1000000, connect_us % 1000000);
+    return client;
+}
+
+ServiceClientPool::Lease ServiceClientPool::acquire(std::chrono::milliseconds read_timeout) {
+    std::unique_ptr<httplib::Client> client;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!released_.wait_for(lock, connect_timeout_,
+                                [this] { return !idle_.empty() || open_ < max_connections_; })) {
+            return Lease();
+        }
+        if (!idle_.empty()) {
+            client = std::move(idle_.back());
+            idle_.pop_back();
+        } else {
+            open_++;
+            opened_total_++;
+        }
+    }
+    if (!client) {
+        client = make_client();
+    }
+    client->set_read_timeout(read_timeout.count() / 1000, (read_timeout.count() % 1000) * 1000);
+    return Lease(this, std::move(client));
+}
+
+void ServiceClientPool::release(std::unique_ptr<httplib::Client> client) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(std::move(client));
+    }
+    released_.notify_one();
+}
+
+size_t ServiceClientPool::connections_opened() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return opened_total_;
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,437 @@
+#include "../include/session_snapshot.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace openkore_ai {
+
+namespace {
+
+constexpr size_t MAGIC_SIZE = sizeof(SessionSnapshot::SNAPSHOT_MAGIC);
+constexpr size_t HEADER_SIZE = MAGIC_SIZE + 8;
+constexpr size_t SECTION_HEADER_SIZE = 8;
+
+int64_t steady_ms(std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time.time_since_epoch()).count();
+}
+
+int64_t system_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+uint64_t read_le(const char* data, size_t size) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < size; i++) {
+        value |= uint64_t(static_cast<unsigned char>(data[i])) << (8 * i);
+    }
+    return value;
+}
+
+void append_le(std::string& out, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        out.push_back(static_cast<char>(value >> (8 * i)));
+    }
+}
+
+} // namespace
+
+SnapshotWriter::SnapshotWriter(std::chrono::steady_clock::time_point now) : now_ms_(steady_ms(now)) {
+}
+
+void SnapshotWriter::u16(uint16_t value) {
+    append_le(data_, value, 2);
+}
+
+void SnapshotWriter::u32(uint32_t value) {
+    append_le(data_, value, 4);
+}
+
+void SnapshotWriter::u64(uint64_t value) {
+    append_le(data_, value, 8);
+}
+
+void SnapshotWriter::f32(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    u32(bits);
+}
+
+void SnapshotWriter::str(std::string_view value) {
+    u32(static_cast<uint32_t>(value.size()));
+    data_.append(value);
+}
+
+void SnapshotWriter::time(std::chrono::steady_clock::time_point value) {
+    time_ms(steady_ms(value));
+}
+
+void SnapshotWriter::time_ms(int64_t steady_ms) {
+    i64(now_ms_ - steady_ms);
+}
+
+void SnapshotWriter::action(const Action& action) {
+    u8(static_cast<uint8_t>(action.kind));
+    str(action.other_kind);
+    // By name, the keys of the names first seen in service replies differ from one engine to the next
+    u16(static_cast<uint16_t>(action.parameters.size()));
+    for (const auto& [key, value] : action.parameters) {
+        str(param_key_name(key));
+        str(value);
+    }
+    str(action.reason);
+    f32(action.confidence);
+}
+
+void SnapshotWriter::game_state(const GameState& state) {
+    const CharacterState& character = state.character;
+    str(character.name);
+    i32(character.level);
+    i32(character.base_exp);
+    i32(character.job_exp);
+    i32(character.hp);
+    i32(character.max_hp);
+    i32(character.sp);
+    i32(character.max_sp);
+    str(character.position.map);
+    i32(character.position.x);
+    i32(character.position.y);
+    i32(character.weight);
+    i32(character.max_weight);
+    i32(character.zeny);
+    str(character.job_class);
+    u32(static_cast<uint32_t>(character.status_effects.size()));
+    for (const std::string& effect : character.status_effects) {
+        str(effect);
+    }
+
+    u32(static_cast<uint32_t>(state.monsters.size()));
+    for (const Monster& monster : state.monsters) {
+        str(monster.id);
+        str(monster.name);
+        i32(monster.hp);
+        i32(monster.max_hp);
+        i32(monster.distance);
+        u8(monster.is_aggressive);
+        i32(monster.x);
+        i32(monster.y);
+    }
+    u32(static_cast<uint32_t>(state.inventory.size()));
+    for (const Item& item : state.inventory) {
+        str(item.id);
+        str(item.name);
+        i32(item.amount);
+        str(item.type);
+    }
+    u32(static_cast<uint32_t>(state.nearby_players.size()));
+    for (const Player& player : state.nearby_players) {
+        str(player.name);
+        i32(player.level);
+        str(player.guild);
+        i32(player.distance);
+        u8(player.is_party_member);
+    }
+    u32(static_cast<uint32_t>(state.party_members.size()));
+    for (const auto& [name, value] : state.party_members) {
+        str(name);
+        str(value);
+    }
+    str(state.party_id);
+    str(state.server);
+    i64(state.timestamp_ms);
+}
+
+size_t SnapshotWriter::count_placeholder() {
+    size_t offset = data_.size();
+    u32(0);
+    return offset;
+}
+
+void SnapshotWriter::set_count(size_t offset, uint32_t count) {
+    for (size_t i = 0; i < 4; i++) {
+        data_[offset + i] = static_cast<char>(count >> (8 * i));
+    }
+}
+
+const char* SnapshotReader::take(size_t size) {
+    if (size > size_ - offset_) {
+        throw std::runtime_error("snapshot data is cut off");
+    }
+    const char* data = data_ + offset_;
+    offset_ += size;
+    return data;
+}
+
+uint8_t SnapshotReader::u8() {
+    return static_cast<uint8_t>(*take(1));
+}
+
+uint16_t SnapshotReader::u16() {
+    return static_cast<uint16_t>(read_le(take(2), 2));
+}
+
+uint32_t SnapshotReader::u32() {
+    return static_cast<uint32_t>(read_le(take(4), 4));
+}
+
+uint64_t SnapshotReader::u64() {
+    return read_le(take(8), 8);
+}
+
+float SnapshotReader::f32() {
+    uint32_t bits = u32();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string SnapshotReader::str() {
+    uint32_t size = u32();
+    const char* data = take(size);
+    return std::string(data, size);
+}
+
+uint32_t SnapshotReader::count(size_t entry_size) {
+    uint32_t count = u32();
+    if (count > (size_ - offset_) / std::max<size_t>(1, entry_size)) {
+        throw std::runtime_error("snapshot list of " + std::to_string(count) + " entries is cut off");
+    }
+    return count;
+}
+
+std::chrono::steady_clock::time_point SnapshotReader::time() {
+    return std::chrono::steady_clock::time_point(std::chrono::milliseconds(time_ms()));
+}
+
+int64_t SnapshotReader::time_ms() {
+    return base_ms_ - i64();
+}
+
+Action SnapshotReader::action() {
+    Action action;
+    uint8_t kind = u8();
+    if (kind > static_cast<uint8_t>(ActionKind::OTHER)) {
+        throw std::runtime_error("invalid action kind " + std::to_string(kind) + " in snapshot");
+    }
+    action.kind = static_cast<ActionKind>(kind);
+    action.other_kind = str();
+    for (uint16_t i = 0, parameters = u16(); i < parameters; i++) {
+        std::string name = str();
+        action.parameters.set(param_key(name), str());
+    }
+    action.reason = str();
+    action.confidence = f32();
+    return action;
+}
+
+void SnapshotReader::game_state(GameState& state) {
+    CharacterState& character = state.character;
+    character.name = str();
+    character.level = i32();
+    character.base_exp = i32();
+    character.job_exp = i32();
+    character.hp = i32();
+    character.max_hp = i32();
+    character.sp = i32();
+    character.max_sp = i32();
+    character.position.map = str();
+    character.position.x = i32();
+    character.position.y = i32();
+    character.weight = i32();
+    character.max_weight = i32();
+    character.zeny = i32();
+    character.job_class = str();
+    character.status_effects.resize(count(4));
+    for (std::string& effect : character.status_effects) {
+        effect = str();
+    }
+
+    state.monsters.resize(count(29));
+    for (Monster& monster : state.monsters) {
+        monster.id = str();
+        monster.name = str();
+        monster.hp = i32();
+        monster.max_hp = i32();
+        monster.distance = i32();
+        monster.is_aggressive = u8() != 0;
+        monster.x = i32();
+        monster.y = i32();
+    }
+    state.inventory.resize(count(16));
+    for (Item& item : state.inventory) {
+        item.id = str();
+        item.name = str();
+        item.amount = i32();
+        item.type = str();
+    }
+    state.nearby_players.resize(count(17));
+    for (Player& player : state.nearby_players) {
+        player.name = str();
+        player.level = i32();
+        player.guild = str();
+        player.distance = i32();
+        player.is_party_member = u8() != 0;
+    }
+    state.party_members.clear();
+    for (uint32_t i = 0, members = count(8); i < members; i++) {
+        std::string name = str();
+        state.party_members[std::move(name)] = str();
+    }
+    state.party_id = str();
+    state.server = str();
+    state.timestamp_ms = i64();
+}
+
+SnapshotReader SnapshotReader::sub(size_t size) {
+    const char* data = take(size);
+    return SnapshotReader(data, size, base_ms_);
+}
+
+size_t SessionSnapshot::write(const std::filesystem::path& path,
+                              const std::vector<std::pair<Section, const SnapshotWriter*>>& sections) {
+    std::string header(SNAPSHOT_MAGIC, MAGIC_SIZE);
+    append_le(header, static_cast<uint64_t>(system_ms()), 8);
+
+    std::filesystem::path temporary = path;
+    temporary += ".tmp";
+    size_t size = header.size();
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            throw std::runtime_error("Cannot create snapshot " + temporary.string());
+        }
+        file.write(header.data(), static_cast<std::streamsize>(header.size()));
+        for (const auto& [tag, writer] : sections) {
+            const std::string& data = writer->data();
+            if (data.size() > UINT32_MAX) {
+                throw std::runtime_error("Snapshot section " + std::to_string(tag) + " is too large");
+            }
+            std::string section_header;
+            append_le(section_header, tag, 4);
+            append_le(section_header, data.size(), 4);
+            file.write(section_header.data(), static_cast<std::streamsize>(section_header.size()));
+            file.write(data.data(), static_cast<std::streamsize>(data.size()));
+            size += section_header.size() + data.size();
+        }
+        file.flush();
+        if (!file) {
+            throw std::runtime_error("Cannot write snapshot " + temporary.string());
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error("Cannot replace snapshot " + path.string());
+    }
+    return size;
+}
+
+SessionSnapshot::SessionSnapshot(const std::filesystem::path& path) {
+    std::error_code error;
+    uintmax_t file_size = std::filesystem::file_size(path, error);
+    if (error) {
+        throw std::runtime_error("Cannot read snapshot " + path.string());
+    }
+    if (file_size < HEADER_SIZE) {
+        throw std::runtime_error(path.string() + " is not an engine snapshot");
+    }
+    size_ = static_cast<size_t>(file_size);
+#ifdef _WIN32
+    HANDLE file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot read snapshot " + path.string());
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping) {
+        data_ = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size_));
+    }
+    if (!data_) {
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map snapshot " + path.string());
+    }
+    file_ = file;
+    mapping_ = mapping;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot read snapshot " + path.string());
+    }
+    void* data = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Cannot map snapshot " + path.string());
+    }
+    data_ = static_cast<const char*>(data);
+#endif
+
+    try {
+        if (std::memcmp(data_, SNAPSHOT_MAGIC, MAGIC_SIZE) != 0) {
+            throw std::runtime_error(path.string() + " is not an engine snapshot");
+        }
+        int64_t taken_ms = static_cast<int64_t>(read_le(data_ + MAGIC_SIZE, 8));
+        age_ = std::chrono::milliseconds(std::max<int64_t>(0, system_ms() - taken_ms));
+        base_ms_ = steady_ms(std::chrono::steady_clock::now()) - age_.count();
+
+        size_t offset = HEADER_SIZE;
+        while (offset < size_) {
+            if (size_ - offset < SECTION_HEADER_SIZE) {
+                throw std::runtime_error(path.string() + ": section at offset " + std::to_string(offset)
+                                         + " is cut off");
+            }
+            uint32_t tag = static_cast<uint32_t>(read_le(data_ + offset, 4));
+            size_t size = static_cast<size_t>(read_le(data_ + offset + 4, 4));
+            offset += SECTION_HEADER_SIZE;
+            if (size > size_ - offset) {
+                throw std::runtime_error(path.string() + ": section at offset "
+                                         + std::to_string(offset - SECTION_HEADER_SIZE) + " is cut off");
+            }
+            sections_.push_back({static_cast<Section>(tag), {offset, size}});
+            offset += size;
+        }
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+SessionSnapshot::~SessionSnapshot() {
+    unmap();
+}
+
+void SessionSnapshot::unmap() {
+    if (!data_) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+    CloseHandle(static_cast<HANDLE>(file_));
+#else
+    ::munmap(const_cast<char*>(data_), size_);
+#endif
+    data_ = nullptr;
+}
+
+std::optional<SnapshotReader> SessionSnapshot::section(Section tag) const {
+    for (const auto& [section, place] : sections_) {
+        if (section == tag) {
+            return SnapshotReader(data_ + place.first, place.second, base_ms_);
+        }
+    }
+    return std::nullopt;
+}
+
+} // namespace openkore_ai
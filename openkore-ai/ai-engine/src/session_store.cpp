@@ -0,0 +1,120 @@
+#include "../include/session_store.hpp"
+#include <algorithm>
+
+namespace openkore_ai {
+
+SessionStore::SessionStore(std::chrono::seconds ttl, size_t max_sessions)
+    : ttl_(ttl), max_sessions_per_shard_(std::max<size_t>(1, max_sessions / SHARD_COUNT)) {
+}
+
+SessionStore::Shard& SessionStore::shard_of(const std::string& session_id) {
+    return shards_[std::hash<std::string>{}(session_id) % SHARD_COUNT];
+}
+
+void SessionStore::trim(Shard& shard, std::chrono::steady_clock::time_point now) {
+    std::erase_if(shard.entries, [&](const auto& item) { return now - item.second.last_used > ttl_; });
+    while (shard.entries.size() > max_sessions_per_shard_) {
+        auto oldest = std::min_element(shard.entries.begin(), shard.entries.end(),
+            [](const auto& a, const auto& b) { return a.second.last_used < b.second.last_used; });
+        shard.entries.erase(oldest);
+    }
+}
+
+uint64_t SessionStore::put(const std::string& session_id, const GameState& state) {
+    Shard& shard = shard_of(session_id);
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(session_id);
+    if (it == shard.entries.end()) {
+        // New sessions are the only time a shard grows, so old ones are dropped here
+        trim(shard, now);
+        it = shard.entries.emplace(session_id, Entry()).first;
+    }
+    it->second.state = state;
+    it->second.version++;
+    it->second.last_used = now;
+    return it->second.version;
+}
+
+std::optional<uint64_t> SessionStore::update(const std::string& session_id, std::optional<uint64_t> base_version,
+                                             const std::function<void(GameState&)>& patch, GameState& patched) {
+    Shard& shard = shard_of(session_id);
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.entries.find(session_id);
+    if (it == shard.entries.end()) {
+        return std::nullopt;
+    }
+    Entry& entry = it->second;
+    if (now - entry.last_used > ttl_) {
+        shard.entries.erase(it);
+        return std::nullopt;
+    }
+    if (base_version && *base_version != entry.version) {
+        return std::nullopt;
+    }
+
+    try {
+        patch(entry.state);
+    } catch (...) {
+        shard.entries.erase(it);
+        throw;
+    }
+    entry.version++;
+    entry.last_used = now;
+    patched = entry.state;
+    return entry.version;
+}
+
+size_t SessionStore::size() const {
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.entries.size();
+    }
+    return total;
+}
+
+void SessionStore::save(SnapshotWriter& out) const {
+    size_t count_offset = out.count_placeholder();
+    uint32_t count = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (const auto& [session_id, entry] : shard.entries) {
+            out.str(session_id);
+            out.u64(entry.version);
+            out.time(entry.last_used);
+            out.game_state(entry.state);
+            count++;
+        }
+    }
+    out.set_count(count_offset, count);
+}
+
+size_t SessionStore::restore(SnapshotReader& in) {
+    auto now = std::chrono::steady_clock::now();
+    size_t restored = 0;
+    for (uint32_t i = 0, count = in.count(20); i < count; i++) {
+        std::string session_id = in.str();
+        Entry entry;
+        entry.version = in.u64();
+        entry.last_used = in.time();
+        in.game_state(entry.state);
+        if (now - entry.last_used > ttl_) {
+            continue;
+        }
+
+        Shard& shard = shard_of(session_id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.entries.find(session_id) == shard.entries.end()) {
+            trim(shard, now);
+        }
+        shard.entries[session_id] = std::move(entry);
+        restored++;
+    }
+    return restored;
+}
+
+} // namespace openkore_ai
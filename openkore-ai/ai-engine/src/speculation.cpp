@@ -0,0 +1,115 @@
+#include "../include/speculation.hpp"
+#include "../include/logger.hpp"
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace openkore_ai {
+
+Speculator::Speculator(size_t threads, std::chrono::milliseconds ttl)
+    : threads_(std::max<size_t>(1, threads)), ttl_(ttl), pool_(threads_) {}
+
+bool Speculator::find(const GameState& state, std::chrono::steady_clock::time_point now,
+                      DecisionMemo::Decision& decision) {
+    bool found = characters_.with(state.character.name, [&](Character& character) {
+        for (const Guess& guess : character.guesses) {
+            if (now < guess.expires && DecisionMemo::same_state(guess.state, state)) {
+                decision = guess.decision;
+                return true;
+            }
+        }
+        return false;
+    });
+    if (found) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return found;
+}
+
+std::vector<GameState> Speculator::successors(const GameState& state, const Action& action, const Steps& steps) {
+    std::vector<GameState> next;
+    next.reserve(MAX_SUCCESSORS);
+    const CharacterState& character = state.character;
+
+    // The target dies, the exp of a kill comes in
+    const std::string* target = action.kind == ActionKind::ATTACK || action.kind == ActionKind::SKILL
+        ? action.parameters.get(params::TARGET) : nullptr;
+    if (target && steps.base_exp > 0) {
+        auto monster = std::find_if(state.monsters.begin(), state.monsters.end(),
+                                    [&](const Monster& m) { return m.id == *target; });
+        if (monster != state.monsters.end()) {
+            GameState& successor = next.emplace_back(state);
+            successor.monsters.erase(successor.monsters.begin() + (monster - state.monsters.begin()));
+            successor.character.base_exp += steps.base_exp;
+            successor.character.job_exp += steps.job_exp;
+        }
+    }
+
+    // A regeneration tick
+    if (steps.hp > 0 && character.hp > 0 && character.hp < character.max_hp) {
+        GameState& successor = next.emplace_back(state);
+        successor.character.hp = std::min(character.max_hp, character.hp + steps.hp);
+    }
+    return next;
+}
+
+void Speculator::speculate(const GameState& state, const Action& action, Decide decide) {
+    const CharacterState& current = state.character;
+    auto [round, steps] = characters_.with(current.name, [&](Character& character) {
+        if (character.seen) {
+            if (current.hp > character.hp) {
+                character.steps.hp = current.hp - character.hp;
+            }
+            if (current.level == character.level && current.base_exp > character.base_exp) {
+                character.steps.base_exp = current.base_exp - character.base_exp;
+                character.steps.job_exp = std::max(0, current.job_exp - character.job_exp);
+            }
+        }
+        character.seen = true;
+        character.hp = current.hp;
+        character.level = current.level;
+        character.base_exp = current.base_exp;
+        character.job_exp = current.job_exp;
+        character.guesses.clear();
+        return std::pair(++character.round, character.steps);
+    });
+
+    if (busy_.fetch_add(1, std::memory_order_acq_rel) >= threads_) {
+        busy_.fetch_sub(1, std::memory_order_acq_rel);
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    std::vector<GameState> next = successors(state, action, steps);
+    if (next.empty()) {
+        busy_.fetch_sub(1, std::memory_order_acq_rel);
+        return;
+    }
+    pool_.submit([this, name = current.name, round = round, next = std::move(next),
+                  decide = std::move(decide)]() mutable {
+        try {
+            for (GameState& successor : next) {
+                std::optional<DecisionMemo::Decision> decision = decide(successor);
+                if (!decision) {
+                    continue;
+                }
+                speculated_.fetch_add(1, std::memory_order_relaxed);
+                auto expires = std::chrono::steady_clock::now() + ttl_;
+                bool current_round = characters_.with(name, [&](Character& character) {
+                    if (character.round != round) {
+                        return false;
+                    }
+                    character.guesses.push_back({std::move(successor), expires, std::move(*decision)});
+                    return true;
+                });
+                if (!current_round) {
+                    break;
+                }
+            }
+        } catch (const std::exception& e) {
+            OKAI_LOG_WARNING("Speculation", "Decision ahead failed: " << e.what());
+        }
+        busy_.fetch_sub(1, std::memory_order_acq_rel);
+    });
+}
+
+} // namespace openkore_ai
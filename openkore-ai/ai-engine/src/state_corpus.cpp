@@ -0,0 +1,79 @@
+#include "../include/state_corpus.hpp"
+#include "../include/decision_trace.hpp"
+#include "../include/game_state_json.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace openkore_ai {
+
+namespace {
+
+using json = nlohmann::json;
+
+// Adds the game states of a parsed corpus document
+void add_states(const json& document, std::vector<GameState>& states, size_t limit) {
+    if (states.size() >= limit) {
+        return;
+    }
+    if (document.is_array()) {
+        for (const json& item : document) {
+            add_states(item, states, limit);
+        }
+    } else if (document.contains("request")) {
+        // Trace record, deltas are left out
+        if (document["request"].contains("game_state")) {
+            states.push_back(parse_game_state(document["request"]["game_state"]));
+        }
+    } else if (document.contains("game_state")) {
+        states.push_back(parse_game_state(document["game_state"]));
+    } else {
+        states.push_back(parse_game_state(document));
+    }
+}
+
+} // namespace
+
+void load_states(const std::filesystem::path& path, std::vector<GameState>& states, size_t limit) {
+    if (states.size() >= limit) {
+        return;
+    }
+    if (std::filesystem::is_directory(path)) {
+        std::vector<std::filesystem::path> entries;
+        for (const auto& entry : std::filesystem::directory_iterator(path)) {
+            entries.push_back(entry.path());
+        }
+        std::sort(entries.begin(), entries.end());
+        for (const auto& entry : entries) {
+            std::string extension = entry.extension().string();
+            if (extension == ".json" || extension == ".jsonl" || extension == ".trace") {
+                load_states(entry, states, limit);
+            }
+        }
+        return;
+    }
+
+    std::string extension = path.extension().string();
+    if (extension == ".trace") {
+        DecisionTrace::read_segment(path, [&](json& record) { add_states(record, states, limit); });
+        return;
+    }
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Cannot read " + path.string());
+    }
+    if (extension == ".jsonl") {
+        std::string line;
+        while (states.size() < limit && std::getline(file, line)) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                add_states(json::parse(line), states, limit);
+            }
+        }
+    } else {
+        add_states(json::parse(file), states, limit);
+    }
+}
+
+} // namespace openkore_ai
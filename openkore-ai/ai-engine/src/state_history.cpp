@@ -0,0 +1,142 @@
+#include "../include/state_history.hpp"
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string_view>
+
+namespace openkore_ai {
+
+Trends StateHistory::record(const GameState& state, std::chrono::steady_clock::time_point now) {
+    const CharacterState& character = state.character;
+    Snapshot snapshot;
+    snapshot.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()).count();
+    snapshot.hp = character.hp;
+    snapshot.sp = character.sp;
+    snapshot.exp_gained = 0;
+    snapshot.x = static_cast<int16_t>(character.position.x);
+    snapshot.y = static_cast<int16_t>(character.position.y);
+    snapshot.map = static_cast<uint32_t>(std::hash<std::string_view>{}(character.position.map));
+    snapshot.base_exp = character.base_exp;
+
+    return characters_.with(character.name, [&](History& history) {
+        if (history.count == 0) {
+            history.moved_ms = snapshot.time_ms;
+        } else {
+            const Snapshot& newest = history.at(history.count - 1);
+            if (snapshot.x != newest.x || snapshot.y != newest.y || snapshot.map != newest.map) {
+                history.moved_ms = snapshot.time_ms;
+            }
+        }
+
+        // Replace the newest snapshot if it is too recent, else take a new one, dropping the oldest when full
+        bool replace = history.count > 1
+                       && snapshot.time_ms - history.at(history.count - 1).time_ms < MIN_INTERVAL.count();
+        if (replace) {
+            Snapshot& newest = history.at(history.count - 1);
+            history.exp_gained -= newest.exp_gained;
+            history.gains -= newest.exp_gained > 0;
+            history.count--;
+        } else if (history.count >= CAPACITY) {
+            // The snapshot after the oldest becomes the oldest, its gain isn't within the span any more
+            uint64_t oldest = history.count - CAPACITY;
+            const Snapshot& next = history.at(oldest + 1);
+            history.exp_gained -= next.exp_gained;
+            history.gains -= next.exp_gained > 0;
+        }
+        if (history.count > 0) {
+            // Exp falls at a level up, what was gained then isn't known
+            snapshot.exp_gained = std::max(0, snapshot.base_exp - history.at(history.count - 1).base_exp);
+            history.exp_gained += snapshot.exp_gained;
+            history.gains += snapshot.exp_gained > 0;
+        }
+        history.at(history.count) = snapshot;
+        history.count++;
+
+        uint64_t oldest = history.count > CAPACITY ? history.count - CAPACITY : 0;
+        uint64_t newest = history.count - 1;
+        history.rate_start = std::max(history.rate_start, oldest);
+        while (history.rate_start < newest
+               && snapshot.time_ms - history.at(history.rate_start).time_ms > RATE_WINDOW.count()) {
+            history.rate_start++;
+        }
+
+        Trends trends;
+        trends.samples = static_cast<size_t>(history.count - oldest);
+        trends.span_ms = snapshot.time_ms - history.at(oldest).time_ms;
+        trends.time_in_place_ms = snapshot.time_ms - history.moved_ms;
+        const Snapshot& start = history.at(history.rate_start);
+        if (snapshot.time_ms > start.time_ms) {
+            float seconds = (snapshot.time_ms - start.time_ms) / 1000.0f;
+            trends.hp_per_s = (snapshot.hp - start.hp) / seconds;
+            trends.sp_per_s = (snapshot.sp - start.sp) / seconds;
+        }
+        if (trends.span_ms > 0) {
+            trends.exp_per_hour = history.exp_gained * 3600000.0f / trends.span_ms;
+            trends.kills_per_minute = history.gains * 60000.0f / trends.span_ms;
+        }
+        return trends;
+    });
+}
+
+void StateHistory::save(SnapshotWriter& out) const {
+    size_t count_offset = out.count_placeholder();
+    uint32_t count = 0;
+    characters_.each([&](const std::string& character, const History& history,
+                         std::chrono::steady_clock::time_point last_used) {
+        out.str(character);
+        out.time(last_used);
+        out.u64(history.count);
+        out.u64(history.rate_start);
+        out.time_ms(history.moved_ms);
+        out.i64(history.exp_gained);
+        out.i32(history.gains);
+        // Only the snapshots in the ring, each at the index it has
+        for (uint64_t index = history.count > CAPACITY ? history.count - CAPACITY : 0; index < history.count;
+             index++) {
+            const Snapshot& snapshot = history.ring[index % CAPACITY];
+            out.time_ms(snapshot.time_ms);
+            out.i32(snapshot.hp);
+            out.i32(snapshot.sp);
+            out.i32(snapshot.exp_gained);
+            out.u16(static_cast<uint16_t>(snapshot.x));
+            out.u16(static_cast<uint16_t>(snapshot.y));
+            out.u32(snapshot.map);
+            out.i32(snapshot.base_exp);
+        }
+        count++;
+    });
+    out.set_count(count_offset, count);
+}
+
+size_t StateHistory::restore(SnapshotReader& in) {
+    size_t restored = 0;
+    for (uint32_t i = 0, count = in.count(48); i < count; i++) {
+        std::string character = in.str();
+        auto last_used = in.time();
+        History history;
+        history.count = in.u64();
+        history.rate_start = in.u64();
+        history.moved_ms = in.time_ms();
+        history.exp_gained = in.i64();
+        history.gains = in.i32();
+        uint64_t oldest = history.count > CAPACITY ? history.count - CAPACITY : 0;
+        if (history.rate_start < oldest || (history.count > 0 && history.rate_start >= history.count)) {
+            throw std::runtime_error("invalid history of " + character + " in snapshot");
+        }
+        for (uint64_t index = oldest; index < history.count; index++) {
+            Snapshot& snapshot = history.at(index);
+            snapshot.time_ms = in.time_ms();
+            snapshot.hp = in.i32();
+            snapshot.sp = in.i32();
+            snapshot.exp_gained = in.i32();
+            snapshot.x = static_cast<int16_t>(in.u16());
+            snapshot.y = static_cast<int16_t>(in.u16());
+            snapshot.map = in.u32();
+            snapshot.base_exp = in.i32();
+        }
+        restored += characters_.restore(character, history, last_used);
+    }
+    return restored;
+}
+
+} // namespace openkore_ai
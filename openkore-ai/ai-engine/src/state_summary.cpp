@@ -0,0 +1,182 @@
+#include "../include/state_summary.hpp"
+#include "../include/party_board.hpp"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+namespace openkore_ai {
+
+namespace {
+
+// Runs 'build' the first time for 'ready', the other callers wait for it to finish
+template <typename Build>
+void build_once(std::atomic<bool>& ready, std::mutex& mutex, Build build) {
+    if (ready.load(std::memory_order_acquire)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!ready.load(std::memory_order_relaxed)) {
+        build();
+        ready.store(true, std::memory_order_release);
+    }
+}
+
+} // namespace
+
+void DistanceCounts::accumulate() {
+    for (size_t d = 1; d < counts_.size(); d++) {
+        counts_[d] += counts_[d - 1];
+    }
+}
+
+int MonsterSummary::within(int radius) const {
+    if (radius <= DistanceCounts::MAX_RADIUS) {
+        return all_.within(radius);
+    }
+    return static_cast<int>(std::count_if(monsters_->begin(), monsters_->end(),
+                                          [radius](const Monster& monster) { return monster.distance <= radius; }));
+}
+
+int MonsterSummary::aggressive_within(int radius) const {
+    if (radius <= DistanceCounts::MAX_RADIUS) {
+        return aggressive_.within(radius);
+    }
+    return static_cast<int>(std::count_if(monsters_->begin(), monsters_->end(), [radius](const Monster& monster) {
+        return monster.is_aggressive && monster.distance <= radius;
+    }));
+}
+
+int PlayerSummary::within(int radius) const {
+    if (radius <= DistanceCounts::MAX_RADIUS) {
+        return all_.within(radius);
+    }
+    return static_cast<int>(std::count_if(players_->begin(), players_->end(),
+                                          [radius](const Player& player) { return player.distance <= radius; }));
+}
+
+const ItemInfo* InventorySummary::weakest(ItemCategory category) const {
+    size_t c = static_cast<size_t>(category);
+    return starts_[c] != starts_[c + 1] ? held_[starts_[c]] : nullptr;
+}
+
+const ItemInfo* InventorySummary::strongest(ItemCategory category) const {
+    size_t c = static_cast<size_t>(category);
+    return starts_[c] != starts_[c + 1] ? held_[starts_[c + 1] - 1] : nullptr;
+}
+
+StateSummary::StateSummary(const GameState& state, const Trends& trends, PartyBoard* party)
+    : trends(trends), state_(state), party_(party) {
+    const CharacterState& character = state.character;
+    if (character.max_hp != 0) {
+        hp_ratio = static_cast<float>(character.hp) / character.max_hp;
+    }
+    if (character.max_sp != 0) {
+        sp_ratio = static_cast<float>(character.sp) / character.max_sp;
+    }
+    if (character.max_weight != 0) {
+        weight_ratio = static_cast<float>(character.weight) / character.max_weight;
+    }
+    for (const std::string& effect : character.status_effects) {
+        statuses |= status::bit_of(effect);
+    }
+}
+
+const MonsterSummary& StateSummary::monsters() const {
+    build_once(monsters_ready_, mutex_, [this] {
+        MonsterSummary& summary = monsters_;
+        const std::vector<Monster>& monsters = state_.monsters;
+        summary.monsters_ = &monsters;
+        // Without branches: the nearest monster, the first one in range and the nearest aggressive one in range,
+        // each the first of those at its distance, are kept by index with conditional moves
+        constexpr size_t NONE = SIZE_MAX;
+        size_t nearest = NONE, first = NONE, aggressive = NONE;
+        int nearest_distance = INT_MAX, aggressive_distance = MonsterSummary::TARGET_RANGE + 1;
+        for (size_t i = 0; i < monsters.size(); i++) {
+            const Monster& monster = monsters[i];
+            int distance = monster.distance;
+            bool nearer = distance < nearest_distance || nearest == NONE;
+            nearest = nearer ? i : nearest;
+            nearest_distance = nearer ? distance : nearest_distance;
+            first = (first == NONE && distance <= MonsterSummary::TARGET_RANGE) ? i : first;
+            bool nearer_aggressive = monster.is_aggressive && distance < aggressive_distance;
+            aggressive = nearer_aggressive ? i : aggressive;
+            aggressive_distance = nearer_aggressive ? distance : aggressive_distance;
+            summary.all_.add(distance);
+            summary.aggressive_.add(distance, monster.is_aggressive);
+        }
+        summary.all_.accumulate();
+        summary.aggressive_.accumulate();
+
+        if (nearest != NONE) {
+            summary.nearest = &monsters[nearest];
+        }
+        // The first monster in range, unless an aggressive one is nearer; if it's aggressive itself it's the
+        // nearest aggressive one
+        if (first != NONE) {
+            bool nearer = aggressive != NONE && (aggressive_distance < monsters[first].distance || aggressive == first);
+            summary.target = &monsters[nearer ? aggressive : first];
+        }
+        if (party_) {
+            summary.target = party_->focus(state_, summary.target);
+        }
+    });
+    return monsters_;
+}
+
+const PlayerSummary& StateSummary::players() const {
+    build_once(players_ready_, mutex_, [this] {
+        PlayerSummary& summary = players_;
+        summary.players_ = &state_.nearby_players;
+        for (const Player& player : state_.nearby_players) {
+            if (!summary.nearest || player.distance < summary.nearest->distance) {
+                summary.nearest = &player;
+            }
+            summary.all_.add(player.distance);
+        }
+        summary.all_.accumulate();
+    });
+    return players_;
+}
+
+const InventorySummary& StateSummary::inventory() const {
+    build_once(inventory_ready_, mutex_, [this] {
+        InventorySummary& summary = inventory_;
+        const ItemDatabase& items = ItemDatabase::shared();
+        summary.held_.reserve(state_.inventory.size());
+        for (const Item& item : state_.inventory) {
+            const ItemInfo* info = item.amount > 0 ? items.find(item) : nullptr;
+            if (!info || info->category == ItemCategory::OTHER) {
+                continue;
+            }
+            summary.amounts_[static_cast<size_t>(info->category)] += item.amount;
+            summary.held_.push_back(info);
+        }
+        std::sort(summary.held_.begin(), summary.held_.end(), [](const ItemInfo* a, const ItemInfo* b) {
+            if (a->category != b->category) {
+                return a->category < b->category;
+            }
+            return a->potency() != b->potency() ? a->potency() < b->potency() : a->id < b->id;
+        });
+        // Stacks of the same item count once
+        summary.held_.erase(std::unique(summary.held_.begin(), summary.held_.end()), summary.held_.end());
+        size_t i = 0;
+        for (size_t c = 0; c < ITEM_CATEGORIES; c++) {
+            summary.starts_[c] = static_cast<uint32_t>(i);
+            while (i < summary.held_.size() && static_cast<size_t>(summary.held_[i]->category) == c) {
+                i++;
+            }
+        }
+        summary.starts_[ITEM_CATEGORIES] = static_cast<uint32_t>(i);
+    });
+    return inventory_;
+}
+
+const JobRules& StateSummary::job() const {
+    build_once(job_ready_, mutex_, [this] {
+        job_rules_ = JobRuleBook::shared().current();
+        job_ = &job_rules_->rules_for(state_.character.job_class);
+    });
+    return *job_;
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,184 @@
+#include "../include/strategic_proxy.hpp"
+#include "../include/http_task_queue.hpp"
+#include "../include/logger.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+namespace openkore_ai {
+
+namespace {
+
+constexpr const char* PATH = "/api/v1/strategic/plan";
+
+using json = nlohmann::json;
+
+long long elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A JSON error answer, logged
+void answer_error(httplib::Response& res, int status, const std::string& message, std::chrono::steady_clock::time_point start,
+                  const std::string* details = nullptr) {
+    json error_json;
+    error_json["status"] = "error";
+    error_json["message"] = message;
+    error_json["fallback_plan"] = "tactical_only";
+    if (details) {
+        error_json["details"] = *details;
+    }
+    std::string body = error_json.dump();
+    res.set_content(body, "application/json");
+    res.status = status;
+    logging::Logger::log_response(PATH, status, elapsed_ms(start), body);
+}
+
+} // namespace
+
+// A plan on its way from the service to the client: the fetching thread adds what it reads, the HTTP worker
+// takes it out
+struct StrategicProxy::Stream {
+    std::mutex mutex;
+    std::condition_variable changed;
+    int status = 0;                 // of the service's response, 0 until its headers came
+    std::string content_type;
+    std::deque<std::string> chunks;
+    bool finished = false;          // the fetch is over
+    bool failed = false;            // it ended without a complete response
+    bool cancelled = false;         // the client is gone, the fetch stops at the next chunk
+    uint64_t forwarded = 0;         // bytes written to the client
+};
+
+StrategicProxy::StrategicProxy(std::shared_ptr<ServiceClientPool> service, size_t threads,
+                               std::chrono::milliseconds timeout)
+    : service_(std::move(service)), max_in_flight_(std::max<size_t>(1, threads)), timeout_(timeout),
+      pool_(max_in_flight_) {}
+
+void StrategicProxy::fetch(const std::shared_ptr<Stream>& stream, const std::string& body) {
+    bool complete = false;
+    try {
+        ServiceClientPool::Lease client = service_->acquire(timeout_);
+        if (client) {
+            httplib::Request request;
+            request.method = "POST";
+            request.path = PATH;
+            request.headers.emplace("Content-Type", "application/json");
+            request.body = body;
+            request.response_handler = [&](const httplib::Response& response) {
+                std::lock_guard<std::mutex> lock(stream->mutex);
+                stream->status = response.status;
+                stream->content_type = response.get_header_value("Content-Type");
+                stream->changed.notify_all();
+                return !stream->cancelled;
+            };
+            request.content_receiver = [&](const char* data, size_t length, uint64_t, uint64_t) {
+                std::lock_guard<std::mutex> lock(stream->mutex);
+                if (stream->cancelled) {
+                    return false;
+                }
+                stream->chunks.emplace_back(data, length);
+                stream->changed.notify_all();
+                return true;
+            };
+            httplib::Response response;
+            httplib::Error error = httplib::Error::Success;
+            complete = client->send(request, response, error);
+        }
+    } catch (const std::exception& e) {
+        OKAI_LOG_ERROR("STRATEGIC", "Exception in strategic planning: " << e.what());
+    }
+    std::lock_guard<std::mutex> lock(stream->mutex);
+    stream->finished = true;
+    stream->failed = !complete;
+    stream->changed.notify_all();
+}
+
+void StrategicProxy::handle(const httplib::Request& req, httplib::Response& res) {
+    using logging::Logger;
+    auto start_time = std::chrono::steady_clock::now();
+
+    if (in_flight_.fetch_add(1) >= max_in_flight_) {
+        in_flight_.fetch_sub(1);
+        refused_.fetch_add(1, std::memory_order_relaxed);
+        Logger::warning("Too many strategic plans in progress, request refused", "STRATEGIC");
+        res.set_header("Retry-After", "5");
+        answer_error(res, 503, "Too many strategic plans in progress, retry later", start_time);
+        return;
+    }
+
+    Logger::log_request("POST", PATH, req.body, req.body.size());
+    Logger::info("Strategic planning request received", "STRATEGIC");
+
+    auto stream = std::make_shared<Stream>();
+    pool_.submit([this, stream, body = req.body] {
+        fetch(stream, body);
+        in_flight_.fetch_sub(1);
+    });
+    // This worker waits for the plan from now on, a new one serves the other connections
+    HttpTaskQueue::hand_off_worker();
+
+    std::unique_lock<std::mutex> lock(stream->mutex);
+    stream->changed.wait(lock, [&] { return stream->status != 0 || stream->finished; });
+    if (stream->status == 0) {
+        lock.unlock();
+        Logger::error("Failed to connect to AI Service for strategic planning", "STRATEGIC");
+        answer_error(res, 503, "Failed to connect to AI Service (" + service_->url() + ")", start_time);
+        return;
+    }
+    if (stream->status != 200) {
+        // Error bodies are short, they're passed on whole in "details"
+        stream->changed.wait(lock, [&] { return stream->finished; });
+        std::string details;
+        for (const std::string& chunk : stream->chunks) {
+            details += chunk;
+        }
+        int status = stream->status;
+        lock.unlock();
+        OKAI_LOG_WARNING("STRATEGIC", "AI Service returned error: " << status);
+        answer_error(res, status, "AI Service strategic planning failed", start_time, &details);
+        return;
+    }
+
+    res.status = 200;
+    std::string content_type = stream->content_type.empty() ? "application/json" : stream->content_type;
+    lock.unlock();
+    res.set_chunked_content_provider(content_type,
+        [stream](size_t, httplib::DataSink& sink) {
+            std::unique_lock<std::mutex> lock(stream->mutex);
+            stream->changed.wait(lock, [&] { return !stream->chunks.empty() || stream->finished; });
+            if (stream->chunks.empty()) {
+                if (stream->failed) {
+                    // The plan broke off: the client sees the chunked body end without its last chunk
+                    return false;
+                }
+                sink.done();
+                return true;
+            }
+            std::string chunk = std::move(stream->chunks.front());
+            stream->chunks.pop_front();
+            stream->forwarded += chunk.size();
+            lock.unlock();
+            return sink.write(chunk.data(), chunk.size());
+        },
+        [stream, start_time](bool success) {
+            uint64_t forwarded;
+            {
+                std::lock_guard<std::mutex> lock(stream->mutex);
+                stream->cancelled = !success;
+                forwarded = stream->forwarded;
+            }
+            if (success) {
+                Logger::info("Strategic planning completed successfully", "STRATEGIC");
+            } else {
+                Logger::warning("Strategic plan not passed on whole, the client or the service broke off", "STRATEGIC");
+            }
+            Logger::log_response(PATH, 200, elapsed_ms(start_time),
+                                 [&] { return "(" + std::to_string(forwarded) + " bytes streamed)"; });
+        });
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,193 @@
+#include "../include/stream_server.hpp"
+#include "../include/logger.hpp"
+#include <algorithm>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace openkore_ai {
+
+namespace {
+
+#ifdef _WIN32
+const uintptr_t INVALID = INVALID_SOCKET;
+#else
+const int INVALID = -1;
+#endif
+
+template <typename Socket>
+bool read_all(Socket socket, char* data, size_t size) {
+    while (size > 0) {
+        int received = recv(socket, data, static_cast<int>(std::min<size_t>(size, 1 << 20)), 0);
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= received;
+    }
+    return true;
+}
+
+template <typename Socket>
+bool write_all(Socket socket, const char* data, size_t size) {
+    while (size > 0) {
+        int sent = send(socket, data, static_cast<int>(std::min<size_t>(size, 1 << 20)), 0);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+uint32_t read_u32(const unsigned char* data) {
+    return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+}
+
+} // namespace
+
+StreamServer::StreamServer(Handler handler) : handler_(std::move(handler)), listener_(INVALID) {
+}
+
+StreamServer::~StreamServer() {
+    stop();
+}
+
+void StreamServer::close_socket(socket_t socket) {
+#ifdef _WIN32
+    closesocket(socket);
+#else
+    close(socket);
+#endif
+}
+
+bool StreamServer::start(const std::string& host, int port) {
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        return false;
+    }
+#endif
+    listener_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener_ == INVALID) {
+        return false;
+    }
+
+    int yes = 1;
+    setsockopt(listener_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&yes), sizeof(yes));
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1
+        || bind(listener_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listener_, SOMAXCONN) != 0) {
+        close_socket(listener_);
+        listener_ = INVALID;
+        return false;
+    }
+
+    running_ = true;
+    accept_thread_ = std::thread(&StreamServer::accept_loop, this);
+    return true;
+}
+
+void StreamServer::stop() {
+    if (!running_.exchange(false)) {
+        return;
+    }
+    // Closing the sockets makes the blocked accept and recv calls return
+#ifndef _WIN32
+    shutdown(listener_, SHUT_RDWR);
+#endif
+    close_socket(listener_);
+    if (accept_thread_.joinable()) {
+        accept_thread_.join();
+    }
+
+    std::unique_lock<std::mutex> lock(clients_mutex_);
+    for (socket_t client : clients_) {
+#ifdef _WIN32
+        shutdown(client, SD_BOTH);
+#else
+        shutdown(client, SHUT_RDWR);
+#endif
+    }
+    // Connection threads are detached, they must be done with this object before it goes away
+    clients_done_.wait(lock, [this] { return clients_.empty(); });
+}
+
+void StreamServer::accept_loop() {
+    while (running_) {
+        socket_t client = accept(listener_, nullptr, nullptr);
+        if (client == INVALID) {
+            continue;
+        }
+
+        // Replies are small and sent right away, they must not wait for Nagle's algorithm
+        int yes = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&yes), sizeof(yes));
+        {
+            std::lock_guard<std::mutex> lock(clients_mutex_);
+            clients_.push_back(client);
+        }
+        std::thread(&StreamServer::serve, this, client).detach();
+    }
+}
+
+void StreamServer::serve(socket_t client) {
+    using namespace openkore_ai::logging;
+    std::string body;
+    std::string reply_frame;
+
+    while (running_) {
+        unsigned char header[5];
+        if (!read_all(client, reinterpret_cast<char*>(header), sizeof(header))) {
+            break;
+        }
+        uint32_t length = read_u32(header);
+        if (length < 1 || length > MAX_FRAME_SIZE) {
+            Logger::warning("Stream client sent a frame of " + std::to_string(length) + " bytes, closing it", "STREAM");
+            break;
+        }
+        WireFormat format = header[4] == 1 ? WireFormat::MSGPACK : header[4] == 2 ? WireFormat::CBOR : WireFormat::JSON;
+        body.resize(length - 1);
+        if (!body.empty() && !read_all(client, body.data(), body.size())) {
+            break;
+        }
+
+        Reply reply = handler_(body, format);
+
+        uint32_t reply_length = static_cast<uint32_t>(reply.body.size() + 3);
+        reply_frame.clear();
+        reply_frame.reserve(reply.body.size() + 7);
+        reply_frame.push_back(static_cast<char>(reply_length >> 24));
+        reply_frame.push_back(static_cast<char>(reply_length >> 16));
+        reply_frame.push_back(static_cast<char>(reply_length >> 8));
+        reply_frame.push_back(static_cast<char>(reply_length));
+        reply_frame.push_back(static_cast<char>(reply.status >> 8));
+        reply_frame.push_back(static_cast<char>(reply.status));
+        reply_frame.push_back(static_cast<char>(header[4]));
+        reply_frame.append(reply.body);
+        if (!write_all(client, reply_frame.data(), reply_frame.size())) {
+            break;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(clients_mutex_);
+        clients_.erase(std::remove(clients_.begin(), clients_.end(), client), clients_.end());
+        close_socket(client);
+    }
+    clients_done_.notify_all();
+}
+
+} // namespace openkore_ai
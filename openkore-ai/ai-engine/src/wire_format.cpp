@@ -0,0 +1,51 @@
+#include "../include/wire_format.hpp"
+
+namespace openkore_ai {
+
+WireFormat wire_format_of(const std::string& media_type, WireFormat fallback) {
+    if (media_type.find("msgpack") != std::string::npos) {
+        return WireFormat::MSGPACK;  // application/msgpack, application/x-msgpack or application/vnd.msgpack
+    }
+    if (media_type.find("application/cbor") != std::string::npos) {
+        return WireFormat::CBOR;
+    }
+    if (media_type.find("application/json") != std::string::npos) {
+        return WireFormat::JSON;
+    }
+    return fallback;
+}
+
+const char* wire_content_type(WireFormat format) {
+    switch (format) {
+        case WireFormat::MSGPACK: return "application/msgpack";
+        case WireFormat::CBOR: return "application/cbor";
+        default: return "application/json";
+    }
+}
+
+nlohmann::json decode_body(const std::string& body, WireFormat format) {
+    switch (format) {
+        case WireFormat::MSGPACK: return nlohmann::json::from_msgpack(body);
+        case WireFormat::CBOR: return nlohmann::json::from_cbor(body);
+        default: return nlohmann::json::parse(body);
+    }
+}
+
+std::string encode_body(const nlohmann::json& j, WireFormat format) {
+    std::string body;
+    switch (format) {
+        case WireFormat::MSGPACK: nlohmann::json::to_msgpack(j, body); break;
+        case WireFormat::CBOR: nlohmann::json::to_cbor(j, body); break;
+        default: body = j.dump(); break;
+    }
+    return body;
+}
+
+std::string loggable_body(const std::string& body, WireFormat format) {
+    if (format == WireFormat::JSON) {
+        return body;
+    }
+    return "(" + std::to_string(body.size()) + " bytes of " + wire_content_type(format) + ")";
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,103 @@
+#include "../include/worker_pool.hpp"
+#include <algorithm>
+
+namespace openkore_ai {
+
+WorkerPool::WorkerPool(size_t threads) {
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; i++) {
+        threads_.emplace_back(&WorkerPool::worker_loop, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& thread : threads_) {
+        thread.join();
+    }
+}
+
+void WorkerPool::work_on(Job& job) {
+    size_t index;
+    while ((index = job.next.fetch_add(1, std::memory_order_relaxed)) < job.count) {
+        (*job.task)(index);
+        if (job.done.fetch_add(1, std::memory_order_acq_rel) + 1 == job.count) {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            job.finished.notify_all();
+        }
+    }
+}
+
+void WorkerPool::parallel_for(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    auto job = std::make_shared<Job>();
+    job->task = &task;
+    job->count = count;
+
+    if (count > 1 && !threads_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            jobs_.push_back(job);
+        }
+        // At most count - 1 workers can find something to do besides this thread
+        if (count - 1 >= threads_.size()) {
+            wake_.notify_all();
+        } else {
+            for (size_t i = 0; i < count - 1; i++) {
+                wake_.notify_one();
+            }
+        }
+    }
+
+    work_on(*job);
+
+    {
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished.wait(lock, [&] { return job->done.load(std::memory_order_acquire) == count; });
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    jobs_.erase(std::remove(jobs_.begin(), jobs_.end(), job), jobs_.end());
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    if (threads_.empty()) {
+        task();
+        return;
+    }
+    auto job = std::make_shared<Job>();
+    job->owned_task = [task = std::move(task)](size_t) { task(); };
+    job->task = &job->owned_task;
+    job->count = 1;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    wake_.notify_one();
+}
+
+void WorkerPool::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        wake_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+        if (stopping_) {
+            return;
+        }
+        std::shared_ptr<Job> job = jobs_.front();
+        if (job->next.load(std::memory_order_relaxed) >= job->count) {
+            // Every item is claimed, the caller waits for the last ones itself
+            jobs_.pop_front();
+            continue;
+        }
+        lock.unlock();
+        work_on(*job);
+        lock.lock();
+    }
+}
+
+} // namespace openkore_ai
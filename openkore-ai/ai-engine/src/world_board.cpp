@@ -0,0 +1,59 @@
+#include "../include/world_board.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace openkore_ai {
+
+size_t WorldBoard::share(GameState& state, std::chrono::steady_clock::time_point now) {
+    const CharacterState& character = state.character;
+    if (state.server.empty() || character.position.map.empty()) {
+        return 0;
+    }
+    std::string key = state.server;
+    key += '\0';
+    key += character.position.map;
+
+    size_t added = maps_.with(key, [&](Map& map) -> size_t {
+        // The character's previous sightings make way for its current ones
+        std::erase_if(map.sightings, [&](const Sighting& sighting) {
+            return sighting.seen_by == character.name || now - sighting.seen > ttl_;
+        });
+        for (const Monster& monster : state.monsters) {
+            if (monster.x >= 0 && monster.y >= 0) {
+                map.sightings.push_back({monster, character.name, now});
+            }
+        }
+        if (map.sightings.size() > MAX_SIGHTINGS) {
+            map.sightings.erase(map.sightings.begin(), map.sightings.end() - MAX_SIGHTINGS);
+        }
+
+        // The latest sighting of a monster seen by several others wins
+        size_t count = 0;
+        for (auto sighting = map.sightings.rbegin(); sighting != map.sightings.rend(); ++sighting) {
+            if (sighting->seen_by == character.name) {
+                continue;
+            }
+            int dx = sighting->monster.x - character.position.x;
+            int dy = sighting->monster.y - character.position.y;
+            if (std::abs(dx) > VIEW_RANGE || std::abs(dy) > VIEW_RANGE) {
+                continue;
+            }
+            bool known = std::any_of(state.monsters.begin(), state.monsters.end(),
+                                     [&](const Monster& monster) { return monster.id == sighting->monster.id; });
+            if (known) {
+                continue;
+            }
+            Monster& monster = state.monsters.emplace_back(sighting->monster);
+            monster.distance = static_cast<int>(std::sqrt(static_cast<double>(dx * dx + dy * dy)));
+            monster.is_aggressive = false;
+            count++;
+        }
+        return count;
+    });
+    if (added > 0) {
+        shared_.fetch_add(added, std::memory_order_relaxed);
+    }
+    return added;
+}
+
+} // namespace openkore_ai
@@ -0,0 +1,243 @@
+// Measures the decision path without the HTTP stack: the reflex and rules tiers, the coordinators and the
+// whole pipeline, each in a tight loop over a corpus of game states, on one thread and on several.
+//
+//   ai-engine-bench [--iterations N] [--threads N] [--json FILE] <corpus>...
+//
+// The corpus is what load_states reads (see state_corpus.hpp): JSON files of game states or decide requests,
+// JSON lines files, decision trace segments, or directories of those; tools/bench_corpus has a few typical
+// states. For each benchmark it reports the decisions per second, the thread time per decision and the heap
+// allocations per decision; --json also writes them to a file, for comparing runs.
+#include "alloc_stats.hpp"
+#include "decision_pipeline.hpp"
+#include "logger.hpp"
+#include "state_corpus.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using namespace openkore_ai;
+
+#ifdef OPENKORE_AI_WITH_ALLOC_STATS
+// The engine counts them itself, see alloc_stats.hpp
+uint64_t thread_allocations() {
+    return alloc_stats::thread_counts().allocations;
+}
+#else
+// Heap allocations of the calling thread, counted by the replaced operator new below.
+// Over-aligned allocations keep the default operators and are not counted.
+#if defined(__GNUC__) && !defined(__clang__)
+// GCC sees the malloc behind the replaced operators once they are inlined
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+thread_local uint64_t allocations_of_thread = 0;
+
+uint64_t thread_allocations() {
+    return allocations_of_thread;
+}
+
+void* operator new(std::size_t size) {
+    allocations_of_thread++;
+    if (void* memory = std::malloc(size ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+#endif
+
+namespace {
+
+struct Options {
+    size_t iterations = 20000;
+    size_t threads = std::max(2u, std::thread::hardware_concurrency());
+    std::string json_path;
+    std::vector<std::filesystem::path> inputs;
+};
+
+void usage() {
+    std::cerr << "Usage: ai-engine-bench [--iterations N] [--threads N] [--json FILE] <corpus>...\n";
+}
+
+struct BenchResult {
+    std::string name;
+    size_t threads;
+    uint64_t decisions;
+    double seconds;
+    uint64_t allocations;
+    
+    double decisions_per_second() const { return seconds > 0 ? decisions / seconds : 0.0; }
+    double ns_per_decision() const { return decisions ? seconds * 1e9 * threads / decisions : 0.0; }
+    double allocations_per_decision() const { return decisions ? double(allocations) / decisions : 0.0; }
+};
+
+// Runs 'decide' over the corpus 'iterations' times on each of 'threads' threads, after a warm-up pass
+template <typename Decide>
+BenchResult run(const std::string& name, const std::vector<GameState>& states, size_t iterations, size_t threads,
+                Decide decide) {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<int> sink{0};
+    
+    auto worker = [&] {
+        for (const GameState& state : states) {
+            sink.fetch_add(static_cast<int>(decide(state)), std::memory_order_relaxed);
+        }
+        ready.fetch_add(1);
+        while (!go.load()) {
+            std::this_thread::yield();
+        }
+        uint64_t before = thread_allocations();
+        int kinds = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            for (const GameState& state : states) {
+                kinds += static_cast<int>(decide(state));
+            }
+        }
+        allocations.fetch_add(thread_allocations() - before);
+        sink.fetch_add(kinds, std::memory_order_relaxed);
+    };
+    
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; i++) {
+        workers.emplace_back(worker);
+    }
+    while (ready.load() < threads) {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true);
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return {name, threads, static_cast<uint64_t>(iterations) * states.size() * threads, seconds, allocations.load()};
+}
+
+// Decision of a tier, or NONE if it doesn't handle the state
+template <typename Tier>
+ActionKind tier_decision(Tier& tier, const GameState& state) {
+    return tier.should_handle(state) ? tier.decide(state).kind : ActionKind::NONE;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--iterations" && has_value) {
+                options.iterations = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--threads" && has_value) {
+                options.threads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--json" && has_value) {
+                options.json_path = argv[++i];
+            } else if (arg.rfind("--", 0) == 0) {
+                usage();
+                return 2;
+            } else {
+                options.inputs.emplace_back(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid argument: " << e.what() << "\n";
+        usage();
+        return 2;
+    }
+    if (options.inputs.empty()) {
+        usage();
+        return 2;
+    }
+    
+    std::vector<GameState> states;
+    try {
+        for (const auto& input : options.inputs) {
+            load_states(input, states);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    if (states.empty()) {
+        std::cerr << "No game states found\n";
+        return 1;
+    }
+    
+    try {
+        logging::Logger::initialize("logs", logging::LogLevel::WARNING);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    
+    // The Python service tiers are left out, they would measure the network
+    DecisionPipeline pipeline;
+    pipeline.reflex = std::make_unique<decision::ReflexTier>();
+    pipeline.rules = std::make_unique<decision::RulesTier>();
+    pipeline.coordinators = std::make_unique<coordinators::CoordinatorManager>();
+    pipeline.coordinators->initialize();
+    
+    auto reflex = [&](const GameState& state) { return tier_decision(*pipeline.reflex, state); };
+    auto rules = [&](const GameState& state) { return tier_decision(*pipeline.rules, state); };
+    auto coordinators = [&](const GameState& state) {
+        return pipeline.coordinators->get_coordinator_decision(state).kind;
+    };
+    auto full = [&](const GameState& state) { return pipeline.decide(state, "bench").action.kind; };
+    
+    std::vector<BenchResult> results;
+    for (size_t threads : {size_t(1), options.threads}) {
+        results.push_back(run("reflex", states, options.iterations, threads, reflex));
+        results.push_back(run("rules", states, options.iterations, threads, rules));
+        results.push_back(run("coordinators", states, options.iterations, threads, coordinators));
+        results.push_back(run("pipeline", states, options.iterations, threads, full));
+        if (options.threads == 1) {
+            break;
+        }
+    }
+    
+    std::printf("%zu game states, %zu iterations\n\n", states.size(), options.iterations);
+    std::printf("%-14s %7s %14s %12s %16s\n", "benchmark", "threads", "decisions/s", "ns/decision",
+                "allocs/decision");
+    for (const BenchResult& result : results) {
+        std::printf("%-14s %7zu %14.0f %12.1f %16.2f\n", result.name.c_str(), result.threads,
+                    result.decisions_per_second(), result.ns_per_decision(), result.allocations_per_decision());
+    }
+    
+    if (!options.json_path.empty()) {
+        json report;
+        report["states"] = states.size();
+        report["iterations"] = options.iterations;
+        for (const BenchResult& result : results) {
+            report["results"].push_back({{"name", result.name}, {"threads", result.threads},
+                                         {"decisions", result.decisions},
+                                         {"decisions_per_second", result.decisions_per_second()},
+                                         {"ns_per_decision", result.ns_per_decision()},
+                                         {"allocations_per_decision", result.allocations_per_decision()}});
+        }
+        std::ofstream(options.json_path) << report.dump(2) << std::endl;
+    }
+    
+    logging::Logger::cleanup();
+    return 0;
+}
@@ -0,0 +1,673 @@
+// Puts a running engine under the load of many bots: N simulated characters send decide requests with their
+// own, changing game states over keep-alive HTTP connections or the stream transport, and the throughput, the
+// latencies per tier and the shed and failed requests are reported at the end.
+//
+//   ai-engine-loadgen [--host HOST] [--port PORT] [--transport http|stream] [--format json|msgpack|cbor]
+//                     [--bots N] [--connections N] [--interval-ms MS] [--duration S] [--requests N]
+//                     [--monsters MEAN[:MAX]] [--inventory MEAN[:MAX]] [--seed N] [--json FILE] [<corpus>...]
+//
+// Without a corpus the characters are made up, their monster and inventory counts drawn from Poisson
+// distributions of the given means, capped at the maximums. With one (what load_states reads, see
+// state_corpus.hpp) the characters start from its states in turn. Either way each character then changes from
+// request to request as a playing one would: monsters die and spawn, HP goes down under attack and comes back.
+//
+// The bots are spread over the connections, each one a thread which sends the requests of its bots one after
+// the other. With --interval-ms 0 they send as fast as the engine answers; otherwise each bot sends every
+// interval, and the latencies are counted from when its request was due, so a slow engine doesn't hide its
+// delays by holding the senders back.
+#include "decision_pipeline.hpp"
+#include "metrics.hpp"
+#include "state_corpus.hpp"
+#include "wire_format.hpp"
+#include <httplib.h>
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+using namespace openkore_ai;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Mean and cap of a count drawn for each state
+struct CountDistribution {
+    double mean;
+    int max;
+};
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 0;                   // 0 for the default one of the transport
+    bool stream = false;
+    WireFormat format = WireFormat::JSON;
+    size_t bots = 16;
+    size_t connections = 0;         // 0 for one per bot, up to 64
+    int interval_ms = 0;
+    double duration_s = 10;
+    uint64_t requests = 0;          // 0 for no limit
+    CountDistribution monsters{3, 30};
+    CountDistribution inventory{8, 100};
+    uint32_t seed = 1;
+    std::string json_path;
+    std::vector<std::filesystem::path> inputs;
+};
+
+void usage() {
+    std::cerr << "Usage: ai-engine-loadgen [--host HOST] [--port PORT] [--transport http|stream]"
+                 " [--format json|msgpack|cbor] [--bots N] [--connections N] [--interval-ms MS] [--duration S]"
+                 " [--requests N] [--monsters MEAN[:MAX]] [--inventory MEAN[:MAX]] [--seed N] [--json FILE]"
+                 " [<corpus>...]\n";
+}
+
+CountDistribution parse_distribution(const std::string& text) {
+    size_t colon = text.find(':');
+    CountDistribution distribution{std::stod(text.substr(0, colon)), 0};
+    distribution.max = colon == std::string::npos ? std::max(1, static_cast<int>(distribution.mean * 4))
+                                                  : std::stoi(text.substr(colon + 1));
+    if (distribution.mean < 0 || distribution.max < 0) {
+        throw std::invalid_argument("negative count in " + text);
+    }
+    return distribution;
+}
+
+int draw(const CountDistribution& distribution, std::mt19937& random) {
+    if (distribution.mean <= 0) {
+        return 0;
+    }
+    return std::min(distribution.max, std::poisson_distribution<int>(distribution.mean)(random));
+}
+
+// What the bots sent and got, shared by the connection threads
+struct Results {
+    static constexpr size_t OTHER_TIER = metrics::DecisionMetrics::TIER_COUNT;
+
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> answered{0};      // 200, with a decision
+    std::atomic<uint64_t> shed{0};          // 429 or 503, the engine had no time for them
+    std::atomic<uint64_t> failed{0};        // other statuses, broken connections and undecodable replies
+    std::atomic<uint64_t> sent_bytes{0};
+    metrics::LatencyHistogram latency_us;
+    // Of the answered requests, by the "tier_used" of their reply; the last one holds those naming no known tier
+    std::array<metrics::LatencyHistogram, OTHER_TIER + 1> tier_latency_us;
+};
+
+size_t tier_index(const json& reply) {
+    auto tier = reply.find("tier_used");
+    if (tier == reply.end() || !tier->is_string()) {
+        return Results::OTHER_TIER;
+    }
+    for (size_t index = 0; index < Results::OTHER_TIER; index++) {
+        if (*tier == tier_to_string(static_cast<DecisionTier>(index))) {
+            return index;
+        }
+    }
+    return Results::OTHER_TIER;
+}
+
+const char* MONSTER_NAMES[] = {"Poring", "Lunatic", "Fabre", "Condor", "Willow", "Spore", "Poporing", "Ghoul",
+                               "Nightmare", "Orc Warrior", "Skeleton", "Zombie", "Hornet", "Rocker"};
+const char* ITEM_NAMES[][2] = {{"Red Potion", "usable"}, {"Orange Potion", "usable"}, {"Blue Potion", "usable"},
+                               {"Fly Wing", "usable"}, {"Jellopy", "etc"}, {"Fluff", "etc"}, {"Shell", "etc"},
+                               {"Arrow", "ammo"}, {"Knife", "weapon"}, {"Cotton Shirt", "armor"}};
+const char* JOBS[] = {"Novice", "Swordman", "Mage", "Archer", "Acolyte", "Merchant", "Thief", "Knight", "Priest",
+                      "Wizard", "Hunter", "Assassin"};
+const char* MAPS[] = {"prt_fild08", "moc_fild07", "pay_fild04", "gl_church", "gef_dun01", "new_1-1", "prontera"};
+
+// One simulated character, its state moves on a little before each request
+class Bot {
+public:
+    Bot(size_t number, const GameState* start, const Options& options)
+        : options_(options), random_(options.seed * 7919u + static_cast<uint32_t>(number)) {
+        if (start) {
+            state_ = *start;
+            for (const Monster& monster : state_.monsters) {
+                next_monster_id_ = std::max(next_monster_id_, std::atoi(monster.id.c_str()) + 1);
+            }
+        } else {
+            make_up();
+        }
+        state_.character.name += "-" + std::to_string(number);
+        name_ = state_.character.name;
+    }
+
+    Clock::time_point due;          // of its next request, with --interval-ms
+
+    // The request for the state after one more step
+    json next_request(uint64_t number) {
+        if (number > 0) {
+            step();
+        }
+        json request;
+        request["request_id"] = name_ + "-" + std::to_string(number);
+        request["game_state"] = to_json();
+        return request;
+    }
+
+private:
+    int uniform(int low, int high) { return std::uniform_int_distribution<int>(low, high)(random_); }
+    bool chance(double p) { return std::bernoulli_distribution(p)(random_); }
+
+    Monster make_monster() {
+        Monster monster;
+        monster.id = std::to_string(next_monster_id_++);
+        monster.name = MONSTER_NAMES[uniform(0, std::size(MONSTER_NAMES) - 1)];
+        monster.max_hp = uniform(40, 3000);
+        monster.hp = monster.max_hp;
+        monster.distance = uniform(1, 14);
+        monster.is_aggressive = chance(0.3);
+        return monster;
+    }
+
+    void make_up() {
+        CharacterState& character = state_.character;
+        character.name = JOBS[uniform(0, std::size(JOBS) - 1)];
+        character.job_class = character.name;
+        character.level = uniform(1, 99);
+        character.base_exp = uniform(0, 100000);
+        character.job_exp = uniform(0, 50000);
+        character.max_hp = 40 + character.level * uniform(20, 80);
+        character.hp = uniform(character.max_hp / 4, character.max_hp);
+        character.max_sp = 10 + character.level * uniform(2, 10);
+        character.sp = uniform(0, character.max_sp);
+        character.position = {MAPS[uniform(0, std::size(MAPS) - 1)], uniform(20, 300), uniform(20, 300)};
+        character.max_weight = 800 + character.level * 40;
+        character.weight = uniform(0, character.max_weight);
+        character.zeny = uniform(0, 1000000);
+        for (int i = draw(options_.monsters, random_); i > 0; i--) {
+            state_.monsters.push_back(make_monster());
+        }
+        for (int i = draw(options_.inventory, random_); i > 0; i--) {
+            const char* const* item = ITEM_NAMES[uniform(0, std::size(ITEM_NAMES) - 1)];
+            state_.inventory.push_back({std::to_string(500 + state_.inventory.size()), item[0], uniform(1, 300),
+                                        item[1]});
+        }
+        state_.timestamp_ms = 1700000000000LL;
+    }
+
+    // Half a second of play
+    void step() {
+        CharacterState& character = state_.character;
+        state_.timestamp_ms += 500;
+
+        bool attacked = false;
+        for (Monster& monster : state_.monsters) {
+            monster.distance = std::max(1, monster.distance + uniform(-1, 1));
+            attacked = attacked || (monster.is_aggressive && monster.distance <= 2);
+        }
+        if (!state_.monsters.empty() && chance(0.25)) {
+            Monster& target = state_.monsters.front();
+            target.hp -= uniform(1, std::max(1, target.max_hp / 3));
+            if (target.hp <= 0) {
+                state_.monsters.erase(state_.monsters.begin());
+                character.base_exp += uniform(10, 500);
+                character.job_exp += uniform(5, 300);
+            }
+        }
+        if (static_cast<int>(state_.monsters.size()) < options_.monsters.max && chance(0.2)) {
+            state_.monsters.push_back(make_monster());
+        }
+
+        if (attacked) {
+            character.hp -= uniform(0, std::max(1, character.max_hp / 12));
+        } else {
+            character.hp += std::max(1, character.max_hp / 50);
+        }
+        if (character.hp <= 0) {
+            // Back at the save point
+            character.hp = character.max_hp;
+            state_.monsters.clear();
+        }
+        character.hp = std::min(character.hp, character.max_hp);
+        character.sp = std::min(character.max_sp, character.sp + 1);
+        if (character.hp < character.max_hp / 2 && !state_.inventory.empty() && state_.inventory.front().amount > 0) {
+            state_.inventory.front().amount--;
+        }
+        character.position.x += uniform(-1, 1);
+        character.position.y += uniform(-1, 1);
+    }
+
+    json to_json() const {
+        const CharacterState& character = state_.character;
+        json state;
+        state["character"] = {
+            {"name", character.name}, {"level", character.level}, {"base_exp", character.base_exp},
+            {"job_exp", character.job_exp}, {"hp", character.hp}, {"max_hp", character.max_hp},
+            {"sp", character.sp}, {"max_sp", character.max_sp},
+            {"position", {{"map", character.position.map}, {"x", character.position.x}, {"y", character.position.y}}},
+            {"weight", character.weight}, {"max_weight", character.max_weight}, {"zeny", character.zeny},
+            {"job_class", character.job_class}, {"status_effects", character.status_effects}};
+        json& monsters = state["monsters"] = json::array();
+        for (const Monster& monster : state_.monsters) {
+            monsters.push_back({{"id", monster.id}, {"name", monster.name}, {"hp", monster.hp},
+                                {"max_hp", monster.max_hp}, {"distance", monster.distance},
+                                {"is_aggressive", monster.is_aggressive}});
+        }
+        json& inventory = state["inventory"] = json::array();
+        for (const Item& item : state_.inventory) {
+            inventory.push_back({{"id", item.id}, {"name", item.name}, {"amount", item.amount}, {"type", item.type}});
+        }
+        json& players = state["nearby_players"] = json::array();
+        for (const Player& player : state_.nearby_players) {
+            players.push_back({{"name", player.name}, {"level", player.level}, {"guild", player.guild},
+                               {"distance", player.distance}, {"is_party_member", player.is_party_member}});
+        }
+        state["timestamp_ms"] = state_.timestamp_ms;
+        return state;
+    }
+
+    const Options& options_;
+    std::mt19937 random_;
+    GameState state_{};
+    std::string name_;
+    int next_monster_id_ = 10000;
+};
+
+// A decide request on its way, as either transport sends it
+class Connection {
+public:
+    virtual ~Connection() = default;
+    // Sends the body and waits for the reply; false if the connection broke
+    virtual bool decide(const std::string& body, int& status, std::string& reply) = 0;
+};
+
+class HttpConnection : public Connection {
+public:
+    HttpConnection(const Options& options) : client_(options.host, options.port), format_(options.format) {
+        client_.set_keep_alive(true);
+        client_.set_connection_timeout(5);
+        client_.set_read_timeout(30);
+    }
+
+    bool decide(const std::string& body, int& status, std::string& reply) override {
+        httplib::Headers headers{{"Accept", wire_content_type(format_)}};
+        httplib::Result result = client_.Post("/api/v1/decide", headers, body, wire_content_type(format_));
+        if (!result) {
+            return false;
+        }
+        status = result->status;
+        reply = std::move(result->body);
+        return true;
+    }
+
+private:
+    httplib::Client client_;
+    WireFormat format_;
+};
+
+// Frames of the stream transport, see stream_server.hpp
+class StreamConnection : public Connection {
+public:
+#ifdef _WIN32
+    using socket_t = SOCKET;
+    static constexpr socket_t INVALID = INVALID_SOCKET;
+#else
+    using socket_t = int;
+    static constexpr socket_t INVALID = -1;
+#endif
+
+    StreamConnection(const Options& options) : options_(options) {}
+    ~StreamConnection() override { disconnect(); }
+
+    bool decide(const std::string& body, int& status, std::string& reply) override {
+        if (socket_ == INVALID && !connect()) {
+            return false;
+        }
+        uint32_t length = static_cast<uint32_t>(body.size() + 1);
+        frame_.clear();
+        frame_.push_back(static_cast<char>(length >> 24));
+        frame_.push_back(static_cast<char>(length >> 16));
+        frame_.push_back(static_cast<char>(length >> 8));
+        frame_.push_back(static_cast<char>(length));
+        frame_.push_back(static_cast<char>(options_.format));
+        frame_.append(body);
+
+        unsigned char header[7];
+        bool done = write_all(frame_.data(), frame_.size())
+            && read_all(reinterpret_cast<char*>(header), sizeof(header));
+        if (done) {
+            uint32_t reply_length = (uint32_t(header[0]) << 24) | (uint32_t(header[1]) << 16)
+                | (uint32_t(header[2]) << 8) | uint32_t(header[3]);
+            status = (header[4] << 8) | header[5];
+            reply.resize(reply_length >= 3 ? reply_length - 3 : 0);
+            done = reply_length >= 3 && (reply.empty() || read_all(reply.data(), reply.size()));
+        }
+        if (!done) {
+            // Connected again for the next request
+            disconnect();
+        }
+        return done;
+    }
+
+private:
+    bool connect() {
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = nullptr;
+        if (getaddrinfo(options_.host.c_str(), std::to_string(options_.port).c_str(), &hints, &addresses) != 0) {
+            return false;
+        }
+        for (addrinfo* address = addresses; address && socket_ == INVALID; address = address->ai_next) {
+            socket_ = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+            if (socket_ == INVALID) {
+                continue;
+            }
+            if (::connect(socket_, address->ai_addr, static_cast<int>(address->ai_addrlen)) != 0) {
+                disconnect();
+                continue;
+            }
+            int nodelay = 1;
+            setsockopt(socket_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&nodelay), sizeof(nodelay));
+        }
+        freeaddrinfo(addresses);
+        return socket_ != INVALID;
+    }
+
+    void disconnect() {
+        if (socket_ != INVALID) {
+#ifdef _WIN32
+            closesocket(socket_);
+#else
+            close(socket_);
+#endif
+            socket_ = INVALID;
+        }
+    }
+
+    bool read_all(char* data, size_t size) {
+        while (size > 0) {
+            int received = recv(socket_, data, static_cast<int>(std::min<size_t>(size, 1 << 20)), 0);
+            if (received <= 0) {
+                return false;
+            }
+            data += received;
+            size -= received;
+        }
+        return true;
+    }
+
+    bool write_all(const char* data, size_t size) {
+        while (size > 0) {
+            int sent = send(socket_, data, static_cast<int>(std::min<size_t>(size, 1 << 20)), 0);
+            if (sent <= 0) {
+                return false;
+            }
+            data += sent;
+            size -= sent;
+        }
+        return true;
+    }
+
+    const Options& options_;
+    socket_t socket_ = INVALID;
+    std::string frame_;
+};
+
+// Sends the requests of the bots of one connection until the time or the requests are up
+void run_connection(const Options& options, std::vector<Bot*> bots, Clock::time_point end,
+                    std::atomic<uint64_t>& remaining, Results& results) {
+    std::unique_ptr<Connection> connection;
+    if (options.stream) {
+        connection = std::make_unique<StreamConnection>(options);
+    } else {
+        connection = std::make_unique<HttpConnection>(options);
+    }
+    auto interval = std::chrono::milliseconds(options.interval_ms);
+    std::vector<uint64_t> numbers(bots.size(), 0);
+    std::string reply;
+    size_t next = 0;
+
+    while (true) {
+        // The bot whose request is due first; round robin when they send as fast as they can
+        size_t index = next++ % bots.size();
+        if (options.interval_ms > 0) {
+            index = std::min_element(bots.begin(), bots.end(), [](const Bot* a, const Bot* b) { return a->due < b->due; })
+                - bots.begin();
+            std::this_thread::sleep_until(bots[index]->due);
+        }
+        Bot& bot = *bots[index];
+        Clock::time_point start = options.interval_ms > 0 ? bot.due : Clock::now();
+        if (start >= end) {
+            break;
+        }
+        if (options.requests > 0) {
+            uint64_t left = remaining.load(std::memory_order_relaxed);
+            do {
+                if (left == 0) {
+                    return;
+                }
+            } while (!remaining.compare_exchange_weak(left, left - 1, std::memory_order_relaxed));
+        }
+
+        std::string body = encode_body(bot.next_request(numbers[index]++), options.format);
+        bot.due += interval;
+        results.sent.fetch_add(1, std::memory_order_relaxed);
+        results.sent_bytes.fetch_add(body.size(), std::memory_order_relaxed);
+        int status = 0;
+        if (!connection->decide(body, status, reply)) {
+            results.failed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        uint64_t latency_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+        if (status == 429 || status == 503) {
+            results.shed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (status != 200) {
+            results.failed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        size_t tier = Results::OTHER_TIER;
+        try {
+            tier = tier_index(decode_body(reply, options.format));
+        } catch (const std::exception&) {
+            results.failed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        results.answered.fetch_add(1, std::memory_order_relaxed);
+        results.latency_us.record(latency_us);
+        results.tier_latency_us[tier].record(latency_us);
+    }
+}
+
+json latency_json(const metrics::LatencyHistogram::Snapshot& latency) {
+    return {{"count", latency.count}, {"mean", latency.mean()}, {"p50", latency.percentile(0.50)},
+            {"p90", latency.percentile(0.90)}, {"p99", latency.percentile(0.99)},
+            {"p999", latency.percentile(0.999)}, {"max", latency.max}};
+}
+
+void print_latency(const char* label, const metrics::LatencyHistogram::Snapshot& latency) {
+    std::printf("%-19s %llu, mean %.0f, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, max %llu\n", label,
+                static_cast<unsigned long long>(latency.count), latency.mean(),
+                static_cast<unsigned long long>(latency.percentile(0.50)),
+                static_cast<unsigned long long>(latency.percentile(0.90)),
+                static_cast<unsigned long long>(latency.percentile(0.99)),
+                static_cast<unsigned long long>(latency.percentile(0.999)),
+                static_cast<unsigned long long>(latency.max));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--host" && has_value) {
+                options.host = argv[++i];
+            } else if (arg == "--port" && has_value) {
+                options.port = std::stoi(argv[++i]);
+            } else if (arg == "--transport" && has_value) {
+                std::string transport = argv[++i];
+                if (transport != "http" && transport != "stream") {
+                    throw std::invalid_argument("unknown transport " + transport);
+                }
+                options.stream = transport == "stream";
+            } else if (arg == "--format" && has_value) {
+                std::string format = argv[++i];
+                if (format != "json" && format != "msgpack" && format != "cbor") {
+                    throw std::invalid_argument("unknown format " + format);
+                }
+                options.format = format == "msgpack" ? WireFormat::MSGPACK
+                    : format == "cbor" ? WireFormat::CBOR : WireFormat::JSON;
+            } else if (arg == "--bots" && has_value) {
+                options.bots = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--connections" && has_value) {
+                options.connections = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--interval-ms" && has_value) {
+                options.interval_ms = std::max(0, std::stoi(argv[++i]));
+            } else if (arg == "--duration" && has_value) {
+                options.duration_s = std::max(0.1, std::stod(argv[++i]));
+            } else if (arg == "--requests" && has_value) {
+                options.requests = std::stoull(argv[++i]);
+            } else if (arg == "--monsters" && has_value) {
+                options.monsters = parse_distribution(argv[++i]);
+            } else if (arg == "--inventory" && has_value) {
+                options.inventory = parse_distribution(argv[++i]);
+            } else if (arg == "--seed" && has_value) {
+                options.seed = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--json" && has_value) {
+                options.json_path = argv[++i];
+            } else if (arg.rfind("--", 0) == 0) {
+                usage();
+                return 2;
+            } else {
+                options.inputs.emplace_back(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid argument: " << e.what() << "\n";
+        usage();
+        return 2;
+    }
+    if (options.port == 0) {
+        options.port = options.stream ? 9903 : 9901;
+    }
+    if (options.connections == 0) {
+        options.connections = std::min<size_t>(options.bots, 64);
+    }
+    options.connections = std::min(options.connections, options.bots);
+
+    std::vector<GameState> corpus;
+    try {
+        for (const auto& input : options.inputs) {
+            load_states(input, corpus);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    if (!options.inputs.empty() && corpus.empty()) {
+        std::cerr << "No game states found\n";
+        return 1;
+    }
+
+#ifdef _WIN32
+    WSADATA wsa_data;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+        std::cerr << "WSAStartup failed\n";
+        return 1;
+    }
+#endif
+
+    std::vector<std::unique_ptr<Bot>> bots;
+    std::vector<std::vector<Bot*>> per_connection(options.connections);
+    Clock::time_point start = Clock::now();
+    for (size_t number = 0; number < options.bots; number++) {
+        const GameState* state = corpus.empty() ? nullptr : &corpus[number % corpus.size()];
+        Bot& bot = *bots.emplace_back(std::make_unique<Bot>(number, state, options));
+        // The bots of a connection start spread over the interval instead of all at once
+        bot.due = start + std::chrono::microseconds(static_cast<long long>(options.interval_ms) * 1000 * number
+                                                    / options.bots);
+        per_connection[number % options.connections].push_back(&bot);
+    }
+
+    Results results;
+    std::atomic<uint64_t> remaining{options.requests};
+    Clock::time_point end = start + std::chrono::microseconds(static_cast<long long>(options.duration_s * 1e6));
+    std::vector<std::thread> threads;
+    for (const std::vector<Bot*>& connection_bots : per_connection) {
+        threads.emplace_back(run_connection, std::cref(options), connection_bots, end, std::ref(remaining),
+                             std::ref(results));
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64_t sent = results.sent.load();
+    double per_request = sent ? 1.0 / sent : 0.0;
+    metrics::LatencyHistogram::Snapshot latency;
+    results.latency_us.add_to(latency);
+    std::printf("transport           %s %s:%d, %s\n", options.stream ? "stream" : "http", options.host.c_str(),
+                options.port, wire_content_type(options.format));
+    std::printf("bots                %zu on %zu connections, %s\n", options.bots, options.connections,
+                corpus.empty() ? "made up" : "from the corpus");
+    std::printf("requests            %llu in %.1f s, %.0f/s, %.0f bytes each\n", static_cast<unsigned long long>(sent),
+                seconds, seconds > 0 ? sent / seconds : 0.0, results.sent_bytes.load() * per_request);
+    std::printf("answered            %llu\n", static_cast<unsigned long long>(results.answered.load()));
+    std::printf("shed                %llu (%.2f%%)\n", static_cast<unsigned long long>(results.shed.load()),
+                results.shed.load() * per_request * 100);
+    std::printf("failed              %llu (%.2f%%)\n", static_cast<unsigned long long>(results.failed.load()),
+                results.failed.load() * per_request * 100);
+    print_latency("latency us", latency);
+
+    json report;
+    report["transport"] = options.stream ? "stream" : "http";
+    report["format"] = wire_content_type(options.format);
+    report["bots"] = options.bots;
+    report["connections"] = options.connections;
+    report["interval_ms"] = options.interval_ms;
+    report["seconds"] = seconds;
+    report["requests"] = sent;
+    report["requests_per_s"] = seconds > 0 ? sent / seconds : 0.0;
+    report["answered"] = results.answered.load();
+    report["shed"] = results.shed.load();
+    report["failed"] = results.failed.load();
+    report["latency_us"] = latency_json(latency);
+    for (size_t tier = 0; tier <= Results::OTHER_TIER; tier++) {
+        metrics::LatencyHistogram::Snapshot tier_latency;
+        results.tier_latency_us[tier].add_to(tier_latency);
+        if (tier_latency.count == 0) {
+            continue;
+        }
+        std::string name = tier < Results::OTHER_TIER ? tier_to_string(static_cast<DecisionTier>(tier)) : "other";
+        print_latency(("  " + name).c_str(), tier_latency);
+        report["tiers"][name] = latency_json(tier_latency);
+    }
+
+    if (!options.json_path.empty()) {
+        std::ofstream(options.json_path) << report.dump(2) << std::endl;
+    }
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return results.answered.load() > 0 ? 0 : 1;
+}
@@ -0,0 +1,241 @@
+// Replays the decision traces recorded by the engine (the "trace" section of ai-engine.yaml) through the
+// decision pipeline as fast as it can, and reports the decision rate and latencies, so it also serves as
+// a throughput benchmark on real traffic. With -DOPENKORE_AI_ALLOC_STATS=ON it also reports the heap
+// allocations per decision and per stage.
+//
+//   ai-engine-replay [--repeat N] [--threads N] [--with-service] [--log-level LEVEL] <directory or segment>...
+//
+// Requests are replayed in their recorded order, the delta requests of a session patch the state left by
+// its previous ones. The ML and LLM tiers ask the Python service, they are only used with --with-service.
+#include "alloc_stats.hpp"
+#include "decision_pipeline.hpp"
+#include "decision_trace.hpp"
+#include "game_state_json.hpp"
+#include "logger.hpp"
+#include "session_store.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+using json = nlohmann::json;
+using namespace openkore_ai;
+
+namespace {
+
+struct Options {
+    int repeat = 1;
+    size_t threads = 1;
+    bool with_service = false;
+    logging::LogLevel log_level = logging::LogLevel::WARNING;
+    std::vector<std::filesystem::path> inputs;
+};
+
+void usage() {
+    std::cerr << "Usage: ai-engine-replay [--repeat N] [--threads N] [--with-service] [--log-level LEVEL]"
+                 " <trace directory or segment>...\n";
+}
+
+// Outcome of replaying one pass over the records
+struct PassResult {
+    std::atomic<uint64_t> decisions{0};
+    std::atomic<uint64_t> skipped{0};     // deltas of sessions which are unknown at that point
+    std::atomic<uint64_t> different{0};   // decisions of another action type than the recorded one
+    std::atomic<uint64_t> allocations{0}; // made by the decisions, when they are counted
+    std::atomic<uint64_t> allocated_bytes{0};
+};
+
+// Replays the records of one thread, in order
+void replay(DecisionPipeline& pipeline, SessionStore& sessions, const std::vector<const json*>& records,
+            PassResult& result) {
+    GameState state;
+    for (const json* record : records) {
+        const json& request = record->at("request");
+        std::string request_id = request.value("request_id", "");
+        std::string session_id = request.value("session_id", "");
+        
+        auto delta = request.find("delta");
+        if (delta != request.end()) {
+            std::optional<uint64_t> base_version;
+            if (request.contains("base_version")) {
+                base_version = request["base_version"].get<uint64_t>();
+            }
+            if (!sessions.update(session_id, base_version,
+                                 [&](GameState& stored) { apply_game_state_delta(stored, *delta); }, state)) {
+                result.skipped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+        } else {
+            parse_game_state_into(request.at("game_state"), state);
+            if (!session_id.empty()) {
+                sessions.put(session_id, state);
+            }
+        }
+        
+        alloc_stats::Counts before = alloc_stats::thread_counts();
+        DecisionResponse decision = pipeline.decide(state, request_id);
+        alloc_stats::Counts allocated = alloc_stats::thread_counts() - before;
+        result.decisions.fetch_add(1, std::memory_order_relaxed);
+        result.allocations.fetch_add(allocated.allocations, std::memory_order_relaxed);
+        result.allocated_bytes.fetch_add(allocated.bytes, std::memory_order_relaxed);
+        
+        const json& response = record->at("response");
+        auto action = response.find("action");
+        if (action != response.end() && action->value("type", "") != decision.action.type_name()) {
+            result.different.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--repeat" && has_value) {
+                options.repeat = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--threads" && has_value) {
+                options.threads = std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--with-service") {
+                options.with_service = true;
+            } else if (arg == "--log-level" && has_value) {
+                options.log_level = logging::Logger::parse_level(argv[++i]);
+            } else if (arg.rfind("--", 0) == 0) {
+                usage();
+                return 2;
+            } else {
+                options.inputs.emplace_back(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Invalid argument: " << e.what() << "\n";
+        usage();
+        return 2;
+    }
+    if (options.inputs.empty()) {
+        usage();
+        return 2;
+    }
+    
+    // Load all records first, so the replay doesn't measure the disk
+    std::vector<json> records;
+    try {
+        for (const auto& input : options.inputs) {
+            std::vector<std::filesystem::path> segments;
+            if (std::filesystem::is_directory(input)) {
+                segments = DecisionTrace::segments(input);
+            } else {
+                segments.push_back(input);
+            }
+            for (const auto& segment : segments) {
+                DecisionTrace::read_segment(segment, [&](json& record) { records.push_back(std::move(record)); });
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    if (records.empty()) {
+        std::cerr << "No records found\n";
+        return 1;
+    }
+    
+    // The requests of a session stay on one thread, in order; those without a session are spread round robin
+    std::vector<std::vector<const json*>> per_thread(options.threads);
+    size_t next_thread = 0;
+    for (const json& record : records) {
+        std::string session_id = record.at("request").value("session_id", "");
+        size_t thread = session_id.empty() ? next_thread++ % options.threads
+                                           : std::hash<std::string>()(session_id) % options.threads;
+        per_thread[thread].push_back(&record);
+    }
+    
+    try {
+        logging::Logger::initialize("logs", options.log_level);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    
+    DecisionPipeline pipeline;
+    pipeline.reflex = std::make_unique<decision::ReflexTier>();
+    pipeline.rules = std::make_unique<decision::RulesTier>();
+    if (options.with_service) {
+        auto service = std::make_shared<ServiceClientPool>("http://127.0.0.1:9902");
+        pipeline.ml = std::make_unique<decision::MLTier>(service);
+        pipeline.llm = std::make_unique<decision::LLMTier>(service);
+    }
+    pipeline.coordinators = std::make_unique<coordinators::CoordinatorManager>();
+    pipeline.coordinators->initialize();
+    
+    PassResult result;
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < options.repeat; pass++) {
+        SessionStore sessions;
+        std::vector<std::thread> threads;
+        for (size_t thread = 1; thread < options.threads; thread++) {
+            threads.emplace_back(replay, std::ref(pipeline), std::ref(sessions), std::cref(per_thread[thread]),
+                                 std::ref(result));
+        }
+        replay(pipeline, sessions, per_thread[0], result);
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    metrics::DecisionMetrics::Snapshot snapshot = pipeline.metrics.snapshot();
+    uint64_t decisions = result.decisions.load();
+    std::printf("records             %zu\n", records.size());
+    std::printf("passes              %d on %zu threads\n", options.repeat, options.threads);
+    std::printf("decisions           %llu (%llu deltas skipped)\n", static_cast<unsigned long long>(decisions),
+                static_cast<unsigned long long>(result.skipped.load()));
+    std::printf("decisions/s         %.0f\n", seconds > 0 ? decisions / seconds : 0.0);
+    std::printf("latency us          mean %.2f, p50 %llu, p99 %llu, max %llu\n", snapshot.total_latency_us.mean(),
+                static_cast<unsigned long long>(snapshot.total_latency_us.percentile(0.50)),
+                static_cast<unsigned long long>(snapshot.total_latency_us.percentile(0.99)),
+                static_cast<unsigned long long>(snapshot.total_latency_us.max));
+    for (size_t tier = 0; tier < metrics::DecisionMetrics::TIER_COUNT; tier++) {
+        std::printf("  %-17s %llu\n", tier_to_string(static_cast<DecisionTier>(tier)).c_str(),
+                    static_cast<unsigned long long>(snapshot.counts[tier]));
+    }
+    std::printf("  %-17s %llu\n", "unhandled", static_cast<unsigned long long>(snapshot.unhandled));
+    std::printf("other action types  %llu\n", static_cast<unsigned long long>(result.different.load()));
+    
+    alloc_stats::Memory memory = alloc_stats::memory();
+    std::printf("memory MB           rss %.1f, peak rss %.1f\n", memory.rss_bytes / 1048576.0,
+                memory.peak_rss_bytes / 1048576.0);
+    if (memory.heap_known) {
+        std::printf("heap MB             in use %.1f, free %.1f, arena %.1f, mmap %.1f\n",
+                    memory.heap_in_use_bytes / 1048576.0, memory.heap_free_bytes / 1048576.0,
+                    memory.heap_arena_bytes / 1048576.0, memory.heap_mmap_bytes / 1048576.0);
+    }
+    if constexpr (alloc_stats::ENABLED) {
+        double per_decision = decisions ? 1.0 / decisions : 0.0;
+        std::printf("allocs/decision     %.2f (%.0f bytes)\n", result.allocations.load() * per_decision,
+                    result.allocated_bytes.load() * per_decision);
+        for (const auto& [name, allocations] : metrics::stages().allocation_snapshot()) {
+            std::printf("  %-17s mean %.2f, p99 %llu, max %llu\n", name.c_str(), allocations.mean(),
+                        static_cast<unsigned long long>(allocations.percentile(0.99)),
+                        static_cast<unsigned long long>(allocations.max));
+        }
+    } else {
+        std::printf("allocs/decision     not counted, build with -DOPENKORE_AI_ALLOC_STATS=ON\n");
+    }
+    
+    logging::Logger::cleanup();
+    return 0;
+}
@@ -4098,6 +4098,18 @@ async def pdca_act(session_id: str, new_macros: List[tuple]):
         logger.error(f"PDCA act error: {e}")
         raise HTTPException(status_code=500, detail=str(e))
 
+@app.post("/api/v1/pdca/outcomes")
+async def pdca_outcomes(summary: Dict[str, Any] = Body(...)):
+    """PDCA Check input: outcome summary of the C++ engine's decisions
+    
+    Sent every pdca.summary_interval_s by the engine, instead of every decision:
+    {"window_s": 60.0, "outcomes": [{"source": "coordinator.CombatCoordinator", "action": "attack",
+     "outcomes": 120, "successes": 112, "success_rate": 0.93, "deaths": 0, "hp_lost": 5400, ...}]}
+    """
+    outcomes = checker.record_outcomes(summary)
+    logger.debug(f"[PDCA] Outcome summary: {outcomes} outcomes over {summary.get('window_s', 0):.0f}s")
+    return {"received": True, "outcomes": outcomes}
+
 @app.post("/api/v1/pdca/cycle")
 async def pdca_full_cycle(session_id: str, character_state: dict):
     """Execute complete PDCA cycle"""
@@ -4132,42 +4144,61 @@ async def pdca_full_cycle(session_id: str, character_state: dict):
 
 @app.post("/api/v1/ml/predict")
 async def ml_predict(game_state: dict, request_type: str = "ml_prediction"):
-    """ML prediction endpoint - Phase 6"""
+    """ML prediction endpoint - Phase 6
+
+    The AI engine sends the features it extracted itself as "features": a row of them, or a list of rows
+    for a batch of predictions, answered with a list of "actions". Other clients send the game state and
+    the features are extracted here.
+    """
     try:
+        features = game_state.get("features")
+        batch = bool(features) and isinstance(features[0], list)
+        rows = features if batch else [features]
+        
         # Check cold-start phase
         if cold_start_manager.should_use_llm():
             # Use LLM during cold-start
+            action = {
+                "type": "defer_to_llm",
+                "reason": f"Cold-start phase {cold_start_manager.current_phase}: Using LLM",
+                "confidence": 0.7
+            }
             return {
-                "action": {
-                    "type": "defer_to_llm",
-                    "reason": f"Cold-start phase {cold_start_manager.current_phase}: Using LLM",
-                    "confidence": 0.7
-                },
+                **({"actions": [action] * len(rows)} if batch else {"action": action}),
                 "phase": cold_start_manager.current_phase,
                 "model_available": False
             }
             
         # Extract features
-        features = FeatureExtractor.extract_features(game_state, int(time.time()))
+        if features is not None:
+            if any(len(row) != len(FeatureExtractor.FEATURE_NAMES) for row in rows):
+                raise HTTPException(status_code=400, detail=f"expected {len(FeatureExtractor.FEATURE_NAMES)} features")
+        else:
+            rows = [FeatureExtractor.extract_features(game_state.get("game_state", game_state), int(time.time()))]
         
-        # Make prediction
-        prediction, confidence = await model_trainer.predict(features)
+        # Make predictions
+        predictions = await model_trainer.predict_batch(rows)
         
-        # Convert prediction to action
+        # Convert predictions to actions
         action_map = {0: 'attack', 1: 'skill', 2: 'move', 3: 'item', 4: 'none'}
-        action_type = action_map.get(prediction, 'none')
-        
-        return {
-            "action": {
-                "type": action_type,
+        actions = [
+            {
+                "type": action_map.get(prediction, 'none'),
                 "parameters": {},
                 "reason": f"ML prediction (confidence: {confidence:.2f})",
                 "confidence": confidence
-            },
+            }
+            for prediction, confidence in predictions
+        ]
+        
+        return {
+            **({"actions": actions} if batch else {"action": actions[0]}),
             "phase": cold_start_manager.current_phase,
             "model_available": model_trainer.model is not None
         }
         
+    except HTTPException:
+        raise
     except Exception as e:
         logger.error(f"ML prediction error: {e}")
         raise HTTPException(status_code=500, detail=str(e))
@@ -3,7 +3,7 @@ ML Model Training and ONNX Export
 Trains decision models and exports to ONNX for C++ inference
 """
 
-from typing import Optional, Tuple, Dict, Any
+from typing import Optional, Tuple, Dict, Any, List
 import numpy as np
 from sklearn.ensemble import RandomForestClassifier
 from sklearn.model_selection import train_test_split
@@ -82,6 +82,7 @@ class ModelTrainer:
                 f.write(onnx_model.SerializeToString())
                 
             logger.success(f"ONNX model exported to {onnx_path}")
+            self._export_quantized(onnx_path)
             return str(onnx_path)
             
         except ImportError:
@@ -92,6 +93,23 @@ class ModelTrainer:
             logger.error(f"ONNX export failed: {e}")
             return None
             
+    def _export_quantized(self, onnx_path: Path) -> Optional[str]:
+        """Export an int8-quantized copy of the ONNX model, which the engine uses with ml.quantized"""
+        try:
+            from onnxruntime.quantization import quantize_dynamic, QuantType
+        except ImportError:
+            logger.info("onnxruntime not installed - skipping int8 export")
+            return None
+
+        quantized_path = onnx_path.with_name("decision_model.int8.onnx")
+        try:
+            quantize_dynamic(str(onnx_path), str(quantized_path), weight_type=QuantType.QInt8)
+        except Exception as e:
+            logger.warning(f"int8 export failed: {e}")
+            return None
+        logger.success(f"int8 model exported to {quantized_path}")
+        return str(quantized_path)
+            
     async def predict(self, features: np.ndarray) -> Tuple[int, float]:
         """Make prediction using trained model"""
         if not self.model:
@@ -103,4 +121,15 @@ class ModelTrainer:
         
         return int(prediction), confidence
 
+    async def predict_batch(self, rows: List[np.ndarray]) -> List[Tuple[int, float]]:
+        """Make predictions for a batch of feature rows in one model call"""
+        if not self.model:
+            return [(4, 0.0)] * len(rows)
+            
+        predictions = self.model.predict(rows)
+        probabilities = self.model.predict_proba(rows)
+        
+        return [(int(prediction), float(row[prediction]))
+                for prediction, row in zip(predictions, probabilities)]
+
 model_trainer = ModelTrainer()
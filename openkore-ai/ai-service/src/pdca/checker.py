@@ -2,6 +2,7 @@
 PDCA Check Phase: Monitor and evaluate performance metrics
 """
 
+from collections import deque
 from typing import Dict, Any, List
 from loguru import logger
 import time
@@ -13,8 +14,31 @@ class PDCAChecker:
         self.metrics_buffer = []
         self.check_interval = 300  # Check every 5 minutes
         self.last_check_time = time.time()
+        # Outcome summaries of the C++ engine's decisions, the newest last; an hour at its default interval
+        self.outcome_summaries = deque(maxlen=60)
         logger.info("PDCA Checker initialized")
         
+    def record_outcomes(self, summary: Dict[str, Any]) -> int:
+        """Keep an outcome summary of the engine, returns the outcomes it has"""
+        summary = dict(summary)
+        summary["received"] = int(time.time())
+        self.outcome_summaries.append(summary)
+        return sum(entry.get("outcomes", 0) for entry in summary.get("outcomes", []))
+        
+    def outcome_totals(self) -> Dict[str, Dict[str, Any]]:
+        """Outcomes of the kept summaries by "source/action", with their success rate"""
+        totals: Dict[str, Dict[str, Any]] = {}
+        for summary in self.outcome_summaries:
+            for entry in summary.get("outcomes", []):
+                key = f"{entry.get('source')}/{entry.get('action')}"
+                total = totals.setdefault(key, {"outcomes": 0, "successes": 0, "deaths": 0,
+                                                "hp_lost": 0, "exp_gained": 0})
+                for field in total:
+                    total[field] += entry.get(field, 0)
+        for total in totals.values():
+            total["success_rate"] = total["successes"] / total["outcomes"] if total["outcomes"] else 0.0
+        return totals
+        
     async def collect_metrics(self, session_id: str, game_state: Dict[str, Any]) -> Dict[str, Any]:
         """Collect current metrics from game state"""
         from database.schema import db
@@ -87,6 +111,14 @@ class PDCAChecker:
             evaluation["issues"].append("Weight frequently high - improve inventory management")
             evaluation["needs_improvement"] = True
             
+        # Decisions of the engine which often go badly, with enough of them to tell
+        for key, total in self.outcome_totals().items():
+            if total["outcomes"] >= 20 and total["success_rate"] < 0.5:
+                evaluation["issues"].append(
+                    f"{key} decisions succeed {total['success_rate']:.0%} of the time, "
+                    f"{total['deaths']} deaths - review that strategy")
+                evaluation["needs_improvement"] = True
+            
         if len(evaluation["issues"]) > 0:
             evaluation["status"] = "needs_improvement"
             
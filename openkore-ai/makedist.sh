@@ -16,6 +16,7 @@ DIRS=(.
 	src/auto/XSTools/OSL
 	src/auto/XSTools/OSL/doc
 	src/auto/XSTools/OSL/IO
+	src/auto/XSTools/OSL/Memory
 	src/auto/XSTools/OSL/Net
 	src/auto/XSTools/OSL/Net/Unix
 	src/auto/XSTools/OSL/Net/Win32
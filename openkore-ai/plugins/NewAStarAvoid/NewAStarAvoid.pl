@@ -85,6 +85,9 @@ my %portals_obstacles = (
 
 my %obstaclesList;
 
+# Weights of all obstacles of the map, stamped and unstamped as they come, move and go (see stamp_obstacle)
+my $obstacle_layer;
+
 my %removed_obstacle_still_in_list;
 
 my $mustRePath = 0;
@@ -96,6 +99,7 @@ my $teleport_soon_timeout;
 
 sub on_packet_mapChange {
 	undef %obstaclesList;
+	undef $obstacle_layer;
 	$mustRePath = 0;
 }
 
@@ -224,16 +228,15 @@ sub add_obstacle {
 	
 	if (exists $removed_obstacle_still_in_list{$actor->{ID}}) {
 		warning "[".PLUGIN_NAME."] New obstacle $actor on location ".$actor->{pos_to}{x}." ".$actor->{pos_to}{y}." already exists in removed_obstacle_still_in_list, deleting from it and updating position.\n";
-		delete $obstaclesList{$actor->{ID}};
 		delete $removed_obstacle_still_in_list{$actor->{ID}};
 	}
+	delete_obstacle($actor->{ID});
 	
 	warning "[".PLUGIN_NAME."] Adding obstacle $actor on location ".$actor->{pos_to}{x}." ".$actor->{pos_to}{y}.".\n";
 	
-	my $weight_changes = create_changes_array($actor->{pos_to}, $obstacle);
-	
-	$obstaclesList{$actor->{ID}}{pos_to} = $actor->{pos_to};
-	$obstaclesList{$actor->{ID}}{weight} = $weight_changes;
+	$obstaclesList{$actor->{ID}}{pos_to} = { x => $actor->{pos_to}{x}, y => $actor->{pos_to}{y} };
+	$obstaclesList{$actor->{ID}}{dist} = $obstacle->{dist};
+	$obstaclesList{$actor->{ID}}{ratio} = $obstacle->{weight};
 	$obstaclesList{$actor->{ID}}{type} = $type;
 	$obstaclesList{$actor->{ID}}{name} = $actor->name;
 	if ($type eq 'monster') {
@@ -241,6 +244,7 @@ sub add_obstacle {
 	}
 	
 	define_extras($actor->{ID}, $obstacle);
+	stamp_obstacle($obstaclesList{$actor->{ID}});
 	
 	$mustRePath = 1;
 }
@@ -268,10 +272,9 @@ sub move_obstacle {
 	
 	warning "[".PLUGIN_NAME."] Moving obstacle $actor (from ".$actor->{pos}{x}." ".$actor->{pos}{y}." to ".$actor->{pos_to}{x}." ".$actor->{pos_to}{y}.").\n";
 	
-	my $weight_changes = create_changes_array($actor->{pos_to}, $obstacle);
-	
-	$obstaclesList{$actor->{ID}}{pos_to} = $actor->{pos_to};
-	$obstaclesList{$actor->{ID}}{weight} = $weight_changes;
+	unstamp_obstacle($obstaclesList{$actor->{ID}});
+	$obstaclesList{$actor->{ID}}{pos_to} = { x => $actor->{pos_to}{x}, y => $actor->{pos_to}{y} };
+	stamp_obstacle($obstaclesList{$actor->{ID}});
 	
 	$mustRePath = 1;
 }
@@ -287,7 +290,7 @@ sub remove_obstacle {
 	
 	} else {
 		warning "[".PLUGIN_NAME."] Removing obstacle $actor from ".$actor->{pos_to}{x}." ".$actor->{pos_to}{y}.".\n"; 
-		delete $obstaclesList{$actor->{ID}};
+		delete_obstacle($actor->{ID});
 		$mustRePath = 1;
 	}
 }
@@ -340,7 +343,7 @@ sub on_AI_pre_manual_removed_obstacle_still_in_list {
 			warning "[REMOVING TEST] wwwwttttffffff 1.\n";
 		} else {
 			warning "[removed_obstacle_still_in_list] Removing obstacle ".$obstacle->{name}." (".$obstacle->{type}.") from ".$obstacle->{pos_to}{x}." ".$obstacle->{pos_to}{y}." we at ($realMyPos->{x} $realMyPos->{y}) dist:$dist, sight:$sight.\n";
-			delete $obstaclesList{$obstacle_ID};
+			delete_obstacle($obstacle_ID);
 			delete $removed_obstacle_still_in_list{$obstacle_ID};
 			$mustRePath = 1;
 		}
@@ -431,7 +434,7 @@ sub on_PathFindingReset {
 	#Log::warning "[test] on_PathFindingReset: Using grided info for ".@obstacles." obstacles.\n";
 	
 	$args->{customWeights} = 1;
-	$args->{secondWeightMap} = get_final_grid();
+	$args->{secondWeightMap} = $obstacle_layer;
 	
 	$args->{avoidWalls} = 1 unless (defined $args->{avoidWalls});
 	$args->{weight_map} = \($args->{field}->{weightMap}) unless (defined $args->{weight_map});
@@ -455,88 +458,29 @@ sub getOffset {
 	return (($y * $width) + $x);
 }
 
-sub get_final_grid {
-	my $changes = sum_all_changes();
-	return $changes;
+# The obstacle layer of $field, made the first time an obstacle is stamped on the map
+sub get_obstacle_layer {
+	$obstacle_layer ||= PathFinding::DangerMap->new($field->{width}, $field->{height});
+	return $obstacle_layer;
 }
 
-sub get_weight_for_block {
-	my ($ratio, $dist) = @_;
-	if ($dist == 0) {
-		$dist = 1;
-	}
-	my $weight = int($ratio/($dist*$dist));
-	if ($weight >= $weight_limit) {
-		$weight = $weight_limit;
-	}
-	return $weight;
+# Adds the weights of an obstacle around its position, $weight_limit at most per cell
+sub stamp_obstacle {
+	my ($obstacle) = @_;
+	get_obstacle_layer()->stampInverseSquare($obstacle->{pos_to}{x}, $obstacle->{pos_to}{y}, $obstacle->{dist}, $obstacle->{ratio}, $weight_limit);
 }
 
-sub create_changes_array {
-	my ($obstacle_pos, $obstacle) = @_;
-	
-	my %obstacle = %{$obstacle};
-	
-	my $max_distance = $obstacle{dist};
-	my $ratio = $obstacle{weight};
-	
-	my @changes_array;
-	
-	my ($min_x, $min_y, $max_x, $max_y) = $field->getSquareEdgesFromCoord($obstacle_pos, $max_distance);
-	
-	my @y_range = ($min_y..$max_y);
-	my @x_range = ($min_x..$max_x);
-	
-	foreach my $y (@y_range) {
-		foreach my $x (@x_range) {
-			next unless ($field->isWalkable($x, $y));
-			my $pos = {
-				x => $x,
-				y => $y
-			};
-			
-			my $distance = adjustedBlockDistance($pos, $obstacle_pos);
-			my $delta_weight = get_weight_for_block($ratio, $distance);
-			#warning "[".PLUGIN_NAME."] $x $y ($distance) -> $delta_weight.\n";
-			push(@changes_array, {
-				x => $x,
-				y => $y,
-				weight => $delta_weight
-			});
-		}
-	}
-	
-	@changes_array = sort { $b->{weight} <=> $a->{weight} } @changes_array;
-	
-	return \@changes_array;
+# Takes the weights of an obstacle back out, at the position it was stamped at
+sub unstamp_obstacle {
+	my ($obstacle) = @_;
+	get_obstacle_layer()->unstampInverseSquare($obstacle->{pos_to}{x}, $obstacle->{pos_to}{y}, $obstacle->{dist}, $obstacle->{ratio}, $weight_limit);
 }
 
-sub sum_all_changes {
-	my %changes_hash;
-	
-	#warning "[".PLUGIN_NAME."] 1 obstaclesList: ". Data::Dumper::Dumper \%obstaclesList;
-	
-	foreach my $key (keys %obstaclesList) {
-		#warning "[".PLUGIN_NAME."] sum_all_avoid - testing obstacle at $obstaclesList{$key}{pos_to}{x} $obstaclesList{$key}{pos_to}{y}.\n";
-		foreach my $change (@{$obstaclesList{$key}{weight}}) {
-			my $x = $change->{x};
-			my $y = $change->{y};
-			my $changed = $change->{weight};
-			$changes_hash{$x}{$y} += $changed;
-		}
-	}
-	
-	my @rebuilt_array;
-	foreach my $x_keys (keys %changes_hash) {
-		foreach my $y_keys (keys %{$changes_hash{$x_keys}}) {
-			next if ($changes_hash{$x_keys}{$y_keys} == 0);
-			push(@rebuilt_array, { x => $x_keys, y => $y_keys, weight => $changes_hash{$x_keys}{$y_keys} });
-		}
-	}
-	
-	#warning "[".PLUGIN_NAME."] 2 rebuilt: ". Data::Dumper::Dumper \@rebuilt_array;
-	
-	return \@rebuilt_array;
+sub delete_obstacle {
+	my ($ID) = @_;
+	return unless (exists $obstaclesList{$ID});
+	unstamp_obstacle($obstaclesList{$ID});
+	delete $obstaclesList{$ID};
 }
 
 ###################################################
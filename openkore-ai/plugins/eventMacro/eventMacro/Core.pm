@@ -41,6 +41,9 @@ sub new {
 	$self->{Array_Variable_List_Hash} = {};
 	$self->{Hash_Variable_List_Hash} = {};
 
+	# Variables set without callbacks, which conditions haven't seen yet
+	$self->{Unnotified_Variables} = {};
+
 	#must add a sorting algorithm here later
 	$self->{triggered_prioritized_automacros_index_list} = [];
 
@@ -924,7 +927,10 @@ sub set_scalar_var {
 		$self->{Scalar_Variable_List_Hash}{$variable_name} = $variable_value;
 	}
 
-	return if (defined $check_callbacks && $check_callbacks == 0);
+	if (defined $check_callbacks && $check_callbacks == 0) {
+		$self->mark_variable_unnotified('scalar', $variable_name);
+		return;
+	}
 	$self->manage_variables_callbacks('scalar', $variable_name, $before_value, $variable_value);
 }
 
@@ -1081,7 +1087,11 @@ sub set_array_var {
 	} else {
 		$self->{Array_Variable_List_Hash}{$variable_name}[$index] = $variable_value;
 	}
-	return if (defined $check_callbacks && $check_callbacks == 0);
+	if (defined $check_callbacks && $check_callbacks == 0) {
+		$self->mark_variable_unnotified('accessed_array', $variable_name, $index);
+		$self->mark_variable_unnotified('array', $variable_name);
+		return;
+	}
 	$self->manage_variables_callbacks('accessed_array', $variable_name, $before_value, $variable_value, $index);
 	$self->array_size_change($variable_name, $before_size);
 }
@@ -1201,7 +1211,11 @@ sub set_hash_var {
 
 	$self->{Hash_Variable_List_Hash}{$variable_name}{$key} = $variable_value;
 
-	return if (defined $check_callbacks && $check_callbacks == 0);
+	if (defined $check_callbacks && $check_callbacks == 0) {
+		$self->mark_variable_unnotified('accessed_hash', $variable_name, $key);
+		$self->mark_variable_unnotified('hash', $variable_name);
+		return;
+	}
 	$self->manage_variables_callbacks('accessed_hash', $variable_name, $before_value, $variable_value, $key);
 	$self->hash_size_change($variable_name, $before_size);
 }
@@ -1228,9 +1242,35 @@ sub is_hash_var_defined {
 }
 ########
 
+sub mark_variable_unnotified {
+	my ($self, $variable_type, $variable_name, $complement) = @_;
+	$self->{Unnotified_Variables}{$variable_type}{$variable_name}{defined $complement ? $complement : ''} = 1;
+}
+
+# Conditions only depend on the values of their variables, so a variable set to the value it
+# already had doesn't need them to be validated again, unless it was last set without callbacks.
+sub is_variable_change_notified {
+	my ($self, $variable_type, $variable_name, $before_value, $value, $complement) = @_;
+
+	if (exists $self->{Unnotified_Variables}{$variable_type} && exists $self->{Unnotified_Variables}{$variable_type}{$variable_name}) {
+		my $complements = $self->{Unnotified_Variables}{$variable_type}{$variable_name};
+		if (delete $complements->{defined $complement ? $complement : ''}) {
+			delete $self->{Unnotified_Variables}{$variable_type}{$variable_name} unless (scalar keys %{$complements});
+			return 1;
+		}
+	}
+
+	return (defined $before_value ? (!defined $value || $before_value ne $value) : defined $value);
+}
+
 sub manage_variables_callbacks {
 	my ($self, $variable_type, $variable_name, $before_value, $value, $complement) = @_;
 
+	unless ($self->is_variable_change_notified($variable_type, $variable_name, $before_value, $value, $complement)) {
+		debug "[eventMacro] Variable '".$variable_name."' of type '".$variable_type."' kept its value, no condition needs to be checked.\n", "eventMacro", 3;
+		return;
+	}
+
 	$self->sub_callback_variable_event($variable_type, $variable_name, $before_value, $value, $complement);
 
 	if ($variable_type eq 'scalar') {
@@ -1242,7 +1282,7 @@ sub manage_variables_callbacks {
 	} elsif ($variable_type eq 'array') {
 
 		if (exists $self->{Event_Related_Static_Variables}{array} && exists $self->{Event_Related_Static_Variables}{array}{$variable_name}) {
-			$self->manage_event_callbacks('variable', $variable_name, $value, $$self->{Event_Related_Static_Variables}{array}{$variable_name}, $variable_type, $complement);
+			$self->manage_event_callbacks('variable', $variable_name, $value, $self->{Event_Related_Static_Variables}{array}{$variable_name}, $variable_type, $complement);
 		}
 
 	} elsif ($variable_type eq 'hash') {
@@ -1381,6 +1421,7 @@ sub manage_event_callbacks {
 
 		my @conditions_indexes_array = keys %{ $conditions_indexes_hash };
 
+		my $checked_state_type = 0;
 		foreach my $condition_index (@conditions_indexes_array) {
 			my $condition = $automacro->{conditionList}->get($condition_index);
 
@@ -1391,17 +1432,20 @@ sub manage_event_callbacks {
 			} else {
 				debug "[eventMacro] Variable value will be updated in condition of state type in automacro '".$automacro->get_name()."'.\n", "eventMacro", 3 if ($callback_type eq 'variable');
 
-				my $result = $automacro->check_state_type_condition($condition_index, $callback_type, $callback_name, $callback_args);
-
-				#add to running queue
-				if (!$result && $automacro->running_status) {
-					$self->remove_from_triggered_prioritized_automacros_index_list($automacro);
+				$automacro->check_state_type_condition($condition_index, $callback_type, $callback_name, $callback_args);
+				$checked_state_type = 1;
+			}
+		}
 
-				#remove from running queue
-				} elsif ($result && exists $self->{Currently_AI_state_Adapted_Automacros}{$automacro_index} && $automacro->can_be_added_to_queue) {
-					$self->add_to_triggered_prioritized_automacros_index_list($automacro);
+		# The running queue only changes once all the conditions of this callback are checked
+		if ($checked_state_type) {
+			#remove from running queue
+			if ($automacro->running_status && !$automacro->are_conditions_fulfilled) {
+				$self->remove_from_triggered_prioritized_automacros_index_list($automacro);
 
-				}
+			#add to running queue
+			} elsif (exists $self->{Currently_AI_state_Adapted_Automacros}{$automacro_index} && $automacro->can_be_added_to_queue) {
+				$self->add_to_triggered_prioritized_automacros_index_list($automacro);
 			}
 		}
 
@@ -0,0 +1,75 @@
+package ConditionCallbacksTest;
+
+use strict;
+use warnings;
+use FindBin qw($RealBin);
+use lib "$RealBin";
+
+use Test::More;
+use Globals qw($char);
+use AI;
+use eventMacro::Core;
+use eventMacro::Data;
+
+my %checks;
+
+sub start {
+	$char = { lv => 10, lv_job => 5 };
+
+	no warnings 'redefine';
+	my $check_state_type_condition = \&eventMacro::Automacro::check_state_type_condition;
+	local *eventMacro::Automacro::check_state_type_condition = sub {
+		my ($automacro, $condition_index) = @_;
+		$checks{$automacro->{conditionList}->get($condition_index)->get_name}++;
+		return $check_state_type_condition->(@_);
+	};
+
+	$eventMacro = eventMacro::Core->new( "$RealBin/textfiles/ConditionCallbacksTest.txt" );
+	my $automacro = $eventMacro->{Automacro_List}->getByName('auto1');
+
+	subtest 'scalar' => sub {
+		%checks = ();
+		$eventMacro->set_scalar_var('minLevel', 5);
+		is ($checks{BaseLevel}, 1, "A new value is checked");
+		ok (!exists $checks{JobLevel}, "Only by the conditions using it");
+
+		$eventMacro->set_scalar_var('minLevel', 5);
+		is ($checks{BaseLevel}, 1, "The same value isn't checked again");
+
+		$eventMacro->set_scalar_var('minLevel', 20, 0);
+		is ($checks{BaseLevel}, 1, "Nor one set without callbacks");
+		$eventMacro->set_scalar_var('minLevel', 20);
+		is ($checks{BaseLevel}, 2, "Until it is set again");
+
+		$eventMacro->set_scalar_var('minLevel', 'undef');
+		is ($checks{BaseLevel}, 3, "Undefining is a change");
+		$eventMacro->set_scalar_var('minLevel', 'undef');
+		is ($checks{BaseLevel}, 3, "Once");
+	};
+
+	subtest 'array' => sub {
+		%checks = ();
+		$eventMacro->push_array('levels', 1);
+		is ($checks{JobLevel}, 1, "A new size is checked");
+		$eventMacro->set_array_var('levels', 0, 2);
+		is ($checks{JobLevel}, 1, "The size didn't change");
+		$eventMacro->set_full_array('levels', [3, 4, 5, 6, 7]);
+		is ($checks{JobLevel}, 2, "Until it does");
+	};
+
+	subtest 'running queue' => sub {
+		$eventMacro->adapt_to_AI_state(AI::AUTO);
+		$eventMacro->set_scalar_var('minLevel', 8);
+		ok ($automacro->are_conditions_fulfilled, "The conditions are fulfilled");
+		is ($automacro->running_status, 1, "The automacro is queued");
+		is (scalar @{$eventMacro->{triggered_prioritized_automacros_index_list}}, 1, "Once");
+
+		$eventMacro->set_scalar_var('minLevel', 12);
+		is ($automacro->running_status, 0, "It leaves the queue when a condition stops being fulfilled");
+		is (scalar @{$eventMacro->{triggered_prioritized_automacros_index_list}}, 0, "The queue is empty");
+	};
+
+	undef $char;
+}
+
+1;
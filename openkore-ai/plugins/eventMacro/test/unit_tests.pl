@@ -38,6 +38,7 @@ my @tests = qw(
 	Validator::RegexCheckTest
 	LoadConditionsTest
 	DynamicAutoVarsTest
+	ConditionCallbacksTest
 	RunnerParseCommandTest
 	RunnerStatementTest
 );
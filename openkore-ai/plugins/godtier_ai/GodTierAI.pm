@@ -7,6 +7,7 @@ use Plugins;
 use Globals;
 use Log qw(message warning error debug);
 use Utils;
+use Utils::HashRing;
 use JSON;
 use Time::HiRes qw(time);
 
@@ -40,6 +41,19 @@ my $http_tiny;             # HTTP::Tiny instance
 my $ua;                    # LWP::UserAgent instance (legacy, not used with HTTP::Tiny)
 my $degraded_mode = 0;     # Flag: running in degraded mode (no HTTP)
 
+# Native decision client (Utils::EngineClient from XSTools), if available.
+# Keeps one connection to the AI service open, and never blocks the AI loop:
+# a decision is posted in one cycle and picked up in a later one.
+my $decision_client;
+my $decision_request_start = 0;
+
+# Servers the decisions are spread over, by party or character, see
+# decide_ring(); the native client of each one, and the one of the request
+# in progress
+my $decide_ring;
+my %decision_clients;
+my $decision_node;
+
 # Request tracking
 my $request_counter = 0;
 
@@ -1465,6 +1479,20 @@ sub on_load {
         message "[GodTierAI] HTTP::Tiny client initialized (timeout: 10s)", "success";
     }
 
+    unless (defined $decision_client) {
+        my ($host, $port) = $ai_service_url =~ m{^http://([^/:]+):(\d+)};
+        eval {
+            require Utils::EngineClient;
+            $decision_client = new Utils::EngineClient($host, $port, 10000);
+        };
+        if ($decision_client) {
+            $decision_clients{"$host:$port"} = $decision_client;
+            message "[GodTierAI] Native decision client initialized ($host:$port, non-blocking)\n", "success";
+        } else {
+            warning "[GodTierAI] Native decision client unavailable, decisions use HTTP::Tiny: " . ($@ || 'no XSTools') . "\n";
+        }
+    }
+
     
     message "[GodTierAI] Initializing plugin...\n", "info";
     
@@ -1725,6 +1753,9 @@ sub collect_game_state {
         inventory => [],
         nearby_players => [],
         party_members => {},
+        party_id => ($char->{party} && defined $char->{party}{name}) ? "$char->{party}{name}" : '',
+        # The engine shares the monsters of a map between the bots of a server
+        server => defined $config{master} ? "$config{master}" : '',
         timestamp_ms => int(time() * 1000),
     );
     
@@ -1759,6 +1790,8 @@ sub collect_game_state {
             distance => int(safe_distance($char->{pos_to}, $monster->{pos_to})),
             # FIX: Prevent "uninitialized value" warnings that cause memory accumulation
             is_aggressive => (defined $monster->{dmgToYou} && $monster->{dmgToYou} > 0) ? JSON::true : JSON::false,
+            ($monster->{pos_to} && defined $monster->{pos_to}{x}
+                ? (x => int($monster->{pos_to}{x}), y => int($monster->{pos_to}{y} || 0)) : ()),
         };
     }
     
@@ -2101,12 +2134,26 @@ sub request_decision {
         timestamp_ms => int(time() * 1000),
     );
     
+    select_decision_node();
+    
+    # The native client encodes the request itself and returns at once;
+    # poll_decision() picks the response up in a later AI cycle
+    if ($decision_client) {
+        if ($decision_client->post("/api/v1/decide", \%request)) {
+            $decision_request_start = time();
+            message "[GodTierAI] [REQUEST-DEBUG] Decision request $request_id posted, response expected next cycles\n", "info";
+        } else {
+            debug "[GodTierAI] [REQUEST-DEBUG] Previous decision request still pending\n", "ai";
+        }
+        return undef;
+    }
+    
     my $json_request = encode_json(\%request);
     my $json_size = length($json_request);
     
     message "[GodTierAI] [REQUEST-DEBUG] JSON payload size: $json_size bytes\n", "info";
     message "[GodTierAI] [REQUEST-DEBUG] Using HTTP client: HTTP::Tiny\n", "info";
-    message "[GodTierAI] [REQUEST-DEBUG] Sending POST to $ai_service_url/api/v1/decide\n", "info";
+    message "[GodTierAI] [REQUEST-DEBUG] Sending POST to http://$decision_node/api/v1/decide\n", "info";
     
     my $request_start = time();
     
@@ -2114,7 +2161,7 @@ sub request_decision {
     my $response;
     eval {
         $response = $http_tiny->post(
-            "$ai_service_url/api/v1/decide",
+            "http://$decision_node/api/v1/decide",
             {
                 headers => { 'Content-Type' => 'application/json' },
                 content => $json_request,
@@ -2129,16 +2176,63 @@ sub request_decision {
     }
     
     my $request_duration = time() - $request_start;
+    # HTTP::Tiny reports connection failures as 599
+    fail_over_decision_node() if (!$response->{success} && $response->{status} >= 500);
     
     message "[GodTierAI] [REQUEST-DEBUG] HTTP request completed in ${request_duration}s\n", "info";
     message "[GodTierAI] [REQUEST-DEBUG] HTTP status: " . $response->{status} . " " . $response->{reason} . "\n", "info";
     
-    if ($response->{success}) {
+    return decision_from_response($response->{success}, $response->{status} . " " . $response->{reason},
+        $response->{content}, $game_state);
+}
+
+# The ring of the servers decisions are requested from: the "host:port" list
+# of the godtierAI_decideServers option of config.txt, separated by commas,
+# or the AI service alone. Built on first use, once config.txt is loaded.
+sub decide_ring {
+    unless ($decide_ring) {
+        my @servers = grep { /^[^:\s]+:\d+$/ } split(/\s*,\s*/, $config{godtierAI_decideServers} || '');
+        unless (@servers) {
+            my ($host, $port) = $ai_service_url =~ m{^http://([^/:]+):(\d+)};
+            @servers = ("$host:$port");
+        }
+        $decide_ring = new Utils::HashRing(\@servers);
+        message "[GodTierAI] Decisions spread over: @servers\n", "info" if (@servers > 1);
+    }
+    return $decide_ring;
+}
+
+# Picks the server of the next decision request. Bots of a party go to the
+# same one, which shares their focus target, others by character; the ones
+# of a server down go to the next server of the ring meanwhile. With the
+# native client, the request goes over that server's connection.
+sub select_decision_node {
+    my $key = ($char->{party} && defined $char->{party}{name}) ? "party:$char->{party}{name}" : "character:$char->{name}";
+    $decision_node = decide_ring()->node($key);
+    if ($decision_client && $decision_client->getStatus() == Utils::EngineClient::IDLE()) {
+        $decision_client = $decision_clients{$decision_node} ||= new Utils::EngineClient(split(/:/, $decision_node), 10000);
+    }
+}
+
+# Takes the server of the request which just failed out of the ring for 30
+# seconds, the next requests fail over to the next one
+sub fail_over_decision_node {
+    return unless (defined $decision_node && decide_ring()->nodes() > 1);
+    decide_ring()->markDown($decision_node, 30);
+    warning "[GodTierAI] Decide server $decision_node failed, failing over for 30s\n";
+}
+
+# Decode a decision response, or handle its failure adaptively
+sub decision_from_response {
+    my ($success, $status, $content, $game_state) = @_;
+    my $action_type = 'ai_decision';
+    
+    if ($success) {
         message "[GodTierAI] [REQUEST-DEBUG] Response successful, decoding JSON...\n", "success";
         
         my $data;
         eval {
-            $data = decode_json($response->{content});
+            $data = decode_json($content);
         };
         
         if ($@) {
@@ -2154,9 +2248,9 @@ sub request_decision {
         
         return $data;
     } else {
-        my $error_reason = $response->{status} . " " . $response->{reason};
+        my $error_reason = $status;
         error "[GodTierAI] [REQUEST-DEBUG] Request FAILED: $error_reason\n";
-        error "[GodTierAI] [REQUEST-DEBUG] Response body: " . ($response->{content} || 'N/A') . "\n";
+        error "[GodTierAI] [REQUEST-DEBUG] Response body: " . ($content || 'N/A') . "\n";
         
         # ADAPTIVE: Track failure and handle adaptively
         track_failure($action_type, $error_reason);
@@ -2164,6 +2258,33 @@ sub request_decision {
     }
 }
 
+# Pick up the response of a decision request posted by the native client.
+# Returns the decision, or undef if there is none (yet).
+sub poll_decision {
+    my $status = $decision_client->poll();
+    return undef if ($status == Utils::EngineClient::IDLE() || $status == Utils::EngineClient::PENDING());
+    
+    my $request_duration = time() - $decision_request_start;
+    my ($success, $reason, $content);
+    if ($status == Utils::EngineClient::DONE()) {
+        my $code = $decision_client->getResponseCode();
+        $success = ($code >= 200 && $code < 300);
+        $reason = $code;
+        $content = $decision_client->getResponseBody();
+    } else {
+        $success = 0;
+        $reason = $decision_client->getError();
+    }
+    $decision_client->reset();
+    fail_over_decision_node() if ($status == Utils::EngineClient::ERROR() || $reason =~ /^5\d\d$/);
+    message "[GodTierAI] [REQUEST-DEBUG] Decision response after ${request_duration}s: $reason\n", "info";
+    
+    # The state is only needed to fall back to a local decision
+    my $game_state = $success ? undef : collect_game_state();
+    return undef if (!$success && !defined $game_state);
+    return decision_from_response($success, $reason, $content, $game_state);
+}
+
 # Enhanced: Execute action with social support
 sub execute_action {
     my ($action_data) = @_;
@@ -3758,6 +3879,12 @@ sub on_ai_pre {
         return;
     }
     
+    # Pick up the decision requested during an earlier cycle
+    if ($decision_client) {
+        my $decision = poll_decision();
+        run_decision($decision) if ($decision);
+    }
+    
     # DIAGNOSTIC: Log when rate limiting is active
     if ($current_time - $last_query_time < 2.0) {
         # Rate limited - this is expected every cycle
@@ -3838,18 +3965,17 @@ sub on_ai_pre {
     # Called every 2 seconds for immediate gameplay needs
     # Response time: <2 seconds (required for smooth gameplay)
     # ========================================================================
+    if ($decision_client && $decision_client->getStatus() == Utils::EngineClient::PENDING()) {
+        debug "[GodTierAI] [DECISION-CYCLE] Still waiting for the previous decision\n", "ai";
+        return;
+    }
+    
     message "[GodTierAI] [DECISION-CYCLE] Calling request_decision()...\n", "info";
     my $decision = request_decision();
     
     if ($decision) {
-        my $tier = $decision->{tier_used} || 'unknown';
-        my $latency = $decision->{latency_ms} // 0;
-        my $tier_str = defined($tier) ? $tier : 'unknown';
-        my $latency_str = defined($latency) ? "${latency}ms" : 'N/A';
-        message "[GodTierAI] [DECISION-CYCLE] Decision received from tier '$tier_str' in $latency_str\n", "success";
-        
-        execute_action($decision);
-    } else {
+        run_decision($decision);
+    } elsif (!$decision_client) {
         warning "[GodTierAI] [DECISION-CYCLE] request_decision() returned undef/empty\n";
     }
     
@@ -3857,6 +3983,17 @@ sub on_ai_pre {
     undef $decision;
 }
 
+sub run_decision {
+    my ($decision) = @_;
+    my $tier = $decision->{tier_used} || 'unknown';
+    my $latency = $decision->{latency_ms} // 0;
+    my $tier_str = defined($tier) ? $tier : 'unknown';
+    my $latency_str = defined($latency) ? "${latency}ms" : 'N/A';
+    message "[GodTierAI] [DECISION-CYCLE] Decision received from tier '$tier_str' in $latency_str\n", "success";
+    
+    execute_action($decision);
+}
+
 # FIX #3: PERIODIC CHECK FOR UNUSED STAT/SKILL POINTS
 # This proactively checks for unused points every 30 seconds and allocates them
 # Solves the issue where character has unused points but no level-up event triggered
@@ -47,23 +47,61 @@ struct _Client {
 		int fd;
 	#endif
 	PrivateData *priv;
+
+	/* Data received but not processed yet. */
+	char *in;
+	int in_len, in_size;
+
+	/* Replies not sent yet, from out + out_pos to out + out_len. */
+	char *out;
+	int out_pos, out_len, out_size;
+
+	/* The events the server waits for on this client. */
+	int events;
+	int eof;
 };
 
+/* Called when a client connects. */
 typedef void (*NewClientCallback) (Client *client);
 
+/* Called when a client can be read from or written to.
+ * Returns: 0 if the client must be disconnected, 1 otherwise. */
+typedef int  (*ClientEventCallback) (Client *client);
+
+/* Called before a client is disconnected and freed. */
+typedef void (*ClientClosedCallback) (Client *client);
+
 
-/* Initialize a client socket. */
+/* The largest amount of data received from a client, which
+ * must fit any request. */
+#define CLIENT_MAX_INPUT (4 + 65535)
+
+/* Stop reading from a client which has this many bytes of
+ * replies waiting, until it reads them. */
+#define CLIENT_MAX_OUTPUT (256 * 1024)
+
+
+/* Initialize a newly connected client socket: make it non-blocking,
+ * and give it empty buffers. */
 void client_init (Client *client);
 
-/* Receive data from a client.
- * Returns: The number of bytes received, or -1 on error. */
-int  client_recv (Client *client, void *buf, int len);
+/* Receive what's available from a client into its input buffer.
+ * Returns: 0 on error or if the client closed the connection, 1 otherwise. */
+int  client_fill (Client *client);
 
-/* Send data to a client.
+/* Queue data to be sent to a client. */
+void client_write (Client *client, const void *data, int len);
+
+/* Send as much of the queued data as the socket takes.
  * Returns: 0 on error, 1 on success. */
-int  client_send (Client *client, const void *data, int len);
+int  client_flush (Client *client);
+
+/* Whether the server should wait for a client to become readable or writable. */
+int  client_wants_read  (Client *client);
+int  client_wants_write (Client *client);
 
-void client_close (Client *client);
+/* Close the socket and free the client. */
+void client_free (Client *client);
 
 
 #endif /* _CLIENT_H_ */
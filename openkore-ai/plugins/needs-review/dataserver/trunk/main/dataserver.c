@@ -21,11 +21,13 @@
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include "dataserver.h"
 #include "processing.h"
 #include "fileparsers.h"
-#include "threads.h"
+#include "rcu.h"
 #include "utils.h"
 
 
@@ -35,138 +37,75 @@
 	#define Server WinServer
 	#define server_trylock win_server_trylock
 	#define start win_start
+
+	typedef HANDLE ReloadThread;
+	#define ReloadThreadValue DWORD WINAPI
+	#define RELOAD_THREAD_RETURN_VALUE 0
+	#define reload_thread_start(thread, entry) \
+		((thread = CreateThread (NULL, 0, entry, NULL, 0, NULL)) != NULL)
+	#define reload_thread_join(thread) \
+		do { WaitForSingleObject (thread, INFINITE); CloseHandle (thread); } while (0)
 #else
 	#include <sys/select.h>
 	#include <sys/time.h>
 	#include <signal.h>
 	#include <unistd.h>
+	#include <pthread.h>
 	#include "unix-server.h"
 
 	#define Server UnixServer
 	#define server_trylock unix_server_trylock
 	#define start unix_start
+
+	typedef pthread_t ReloadThread;
+	#define ReloadThreadValue void *
+	#define RELOAD_THREAD_RETURN_VALUE NULL
+	#define reload_thread_start(thread, entry) (pthread_create (&thread, NULL, entry, NULL) == 0)
+	#define reload_thread_join(thread) pthread_join (thread, NULL)
 #endif
 
 
-/* Table files are stored in this array. */
-StringHash *hashFiles[NUM_HASH_FILES];
+typedef StringHash * (*TableLoader) (const char *filename);
+
+/* The table files, in the order of their numbers in the protocol. */
+static const struct {
+	const char *basename;
+	TableLoader loader;
+} table_files[NUM_HASH_FILES] = {
+	{ "itemsdescriptions.txt",  desc_info_load },
+	{ "skillsdescriptions.txt", desc_info_load },
+	{ "cities.txt",             rolut_load },
+	{ "elements.txt",           rolut_load },
+	{ "items.txt",              rolut_load },
+	{ "itemslotcounttable.txt", rolut_load },
+	{ "maps.txt",               rolut_load }
+};
+
+/* The tables being served, replaced by reloads. */
+static TableSet *current_tables;
+
+/* The event loop's number as an RCU reader. */
+static int loop_reader;
+
+/* Reloading. A reload is requested by SIGHUP, or by the table files changing
+ * with --watch. It runs in its own thread, and is done when reload_done is set. */
+static volatile int reload_requested = 0;
+static int reloading = 0;
+static int reload_done = 0;
+static ReloadThread reload_thread;
+static time_t last_watch = 0;
 
 /* Other variables. */
 static Server *server;
-static ThreadData *threads;
 Options options;
 
+static void on_tick (void);
 
 
-static void
-client_thread_callback (void *pointer)
+TableSet *
+tables_current (void)
 {
-	ThreadData *thread_data;
-	fd_set readfds;
-	struct timeval tv;
-	int highestfd;
-
-	thread_data = (ThreadData *) pointer;
-	highestfd = -1;
-
-	while (1) {
-		Client *client, *new_client = NULL;
-		int i;
-
-		/* Check whether we've just been assigned a new client,
-		 * or whether the server is shutting down. */
-		if (TRYLOCK (thread_data->lock)) {
-			if (thread_data->quit) {
-				/* Server is shutting down. Free resources and exit thread. */
-				UNLOCK (thread_data->lock);
-
-				foreach_llist (thread_data->clients, Client *, client) {
-				//for (client = (Client *) thread_data->clients->first; client != NULL; client = (Client *) client->parent.next) {
-					free (client->priv);
-					client_close (client);
-				}
-
-				llist_free (thread_data->clients);
-				return;
-			}
-
-			if (thread_data->new_client) {
-				new_client = thread_data->new_client;
-				thread_data->new_client = NULL;
-				thread_data->nclients++;
-			}
-			UNLOCK (thread_data->lock);
-		}
-
-		if (new_client) {
-			/* We've been assigned a new client; add to client list. */
-			new_client->priv = calloc (sizeof (PrivateData), 1);
-			llist_append_existing (thread_data->clients, new_client);
-			highestfd = -1;
-			yield ();
-		}
-
-		client = (Client *) thread_data->clients->first;
-		if (client == NULL) {
-			/* We have no clients so just sleep. */
-			milisleep (10);
-			continue;
-		}
-
-
-		/* Check which clients have incoming data. */
-		FD_ZERO (&readfds);
-		foreach_llist (thread_data->clients, Client *, client) {
-			/* FIXME: fd_set can only hold FD_SETSIZE number of file descriptors.
-			 * On my system, that's 1024. Maybe we should check for this? */
-			FD_SET (client->fd, &readfds);
-			if (highestfd == -1 || client->fd > highestfd)
-				highestfd = client->fd;
-		}
-
-		tv.tv_sec = 0;
-		tv.tv_usec = 50000;
-		i = select (highestfd + 1, &readfds, NULL, NULL, &tv);
-		if (i == -1) {
-			/* An error occured. */
-			error ("select() failed: %s\n", strerror (errno));
-			exit (1);
-
-		} else if (i == 0)
-			/* Timeout; no clients have data pending. */
-			continue;
-
-		/* Iterate through clients that have incoming data pending. */
-		client = (Client *) thread_data->clients->first;
-
-		while (client != NULL) {
-			Client *current;
-			int failed = 0;
-
-			current = client;
-			client = (Client *) client->parent.next;
-
-			if (FD_ISSET (current->fd, &readfds))
-				failed = !process_client (thread_data, current, current->priv);
-			else
-				continue;
-
-			if (failed) {
-				/* Remove client. */
-				DEBUG ("Thread %d, client %p: removing client from list\n", thread_data->ID, current);
-				highestfd = -1;
-				free (current->priv);
-				client_close (current);
-				llist_remove (thread_data->clients, (LListItem *) current);
-
-				LOCK (thread_data->lock);
-				thread_data->nclients--;
-				UNLOCK (thread_data->lock);
-			}
-		}
-
-		yield ();
-	}
+	return rcu_dereference ((void **) &current_tables);
 }
 
 
@@ -174,34 +113,15 @@ client_thread_callback (void *pointer)
 static void
 on_new_client (Client *client)
 {
-	int i, smallest, found;
-
-	/* Assign this client to the thread with the least clients. */
-	smallest = 0;
-	found = -1;
-
-	for (i = 0; i < options.threads; i++) {
-		int nclients;
-
-		LOCK (threads[i].lock);
-		nclients = threads[i].nclients;
-		UNLOCK (threads[i].lock);
-
-		if (nclients == 0) {
-			found = i;
-			break;
-
-		} else if (found == -1 || nclients < smallest) {
-			found = i;
-			smallest = nclients;
-		}
-	}
+	DEBUG ("New client %p\n", client);
+	client->priv = calloc (sizeof (PrivateData), 1);
+}
 
-	DEBUG ("New client %p; assign to thread %d\n", client, found);
-	LOCK (threads[found].lock);
-	threads[found].new_client = client;
-	UNLOCK (threads[found].lock);
-	yield ();
+/* Client disconnected, or is being disconnected. */
+static void
+on_client_closed (Client *client)
+{
+	free (client->priv);
 }
 
 
@@ -214,24 +134,16 @@ on_new_client (Client *client)
 static int
 win_start ()
 {
-	int i;
-
 	/* Start server. */
-	server = win_server_new (7232, on_new_client);
+	server = win_server_new (7232, on_new_client, process_client, on_client_closed);
 	if (server == NULL)
 		return 1;
+	server->tick_callback = on_tick;
 
 	/* Enter main loop. */
 	message ("Server ready.\n");
 	win_server_main_loop (server);
 
-	/* Main loop exited; tell all threads to quit. */
-	for (i = 0; i < options.threads; i++) {
-		LOCK (threads[i].lock);
-		threads[i].quit = 1;
-		UNLOCK (threads[i].lock);
-	}
-
 	return win_server_free (server);
 }
 
@@ -244,33 +156,33 @@ unix_stop ()
 	server->stop = 1;
 }
 
+static void
+unix_reload ()
+{
+	reload_requested = 1;
+}
+
 
 static int
 unix_start ()
 {
-	int i;
-
 	/* Setup signal handlers for clean exiting. */
 	signal (SIGINT,  unix_stop);
 	signal (SIGQUIT, unix_stop);
 	signal (SIGTERM, unix_stop);
-	signal (SIGHUP,  unix_stop);
+	/* SIGHUP reloads the table files. */
+	signal (SIGHUP,  unix_reload);
 
 	/* Start server and run until we've caught a signal. */
-	server = unix_server_new (strdup ("/tmp/kore-dataserver.socket"), on_new_client);
+	server = unix_server_new (strdup ("/tmp/kore-dataserver.socket"), on_new_client,
+				  process_client, on_client_closed);
 	if (server == NULL)
 		return 1;
+	server->tick_callback = on_tick;
 
 	message ("Server ready.\n");
 	unix_server_main_loop (server);
 
-	/* Main loop exited; tell all threads to quit. */
-	for (i = 0; i < options.threads; i++) {
-		LOCK (threads[i].lock);
-		threads[i].quit = 1;
-		UNLOCK (threads[i].lock);
-	}
-
 	return unix_server_free (server);
 }
 
@@ -282,8 +194,11 @@ usage (int retval)
 {
 	#define USAGE "Usage: dataserver [ARGS]\n\n" \
 			"  --tables DIR     Specify the tables folder. Default: working directory\n" \
-			"  --threads NUM    Specify the number of threads for handling client\n" \
-			"                   connections. (default: 5)\n"		\
+			"  --images DIR     Specify the folder of the precompiled table images.\n" \
+			"                   Default: the tables folder\n" \
+			"  --compile        Compile the table files into images, and exit.\n" \
+			"  --watch SECONDS  Check every SECONDS whether the table files changed,\n" \
+			"                   and reload them if so. Default: 0, never check\n" \
 			"  --silent         Don't output any messages unless absolutely necessary.\n" \
 			"  --debug          Enable debugging messages.\n"
 	printf ("%s", USAGE);
@@ -291,25 +206,183 @@ usage (int retval)
 }
 
 
-static StringHash *
-load_hash_file (const char *basename, StringHash * (*loader) (const char *filename), int required)
+/* Whether an image exists, and isn't older than the table file it was compiled from. */
+static int
+image_is_fresh (const char *image_file, const char *file)
+{
+	struct stat image_stat, file_stat;
+
+	if (stat (image_file, &image_stat) != 0)
+		return 0;
+	return stat (file, &file_stat) != 0 || image_stat.st_mtime >= file_stat.st_mtime;
+}
+
+/* Map the image of a table file if there's an up-to-date one;
+ * otherwise parse the table file, and compile it in memory
+ * (and to the image file, with --compile). A table which can't be
+ * loaded is fatal, except when reloading: then NULL is returned. */
+static TableImage *
+load_hash_file (const char *basename, TableLoader loader, int reload)
 {
 	char file[PATH_MAX];
+	char image_file[PATH_MAX];
 	StringHash *hash;
+	TableImage *image;
 
 	snprintf (file, sizeof (file), "%s/%s", options.tables, basename);
+	snprintf (image_file, sizeof (image_file), "%s/%s.img", options.images, basename);
+	if (!options.compile && image_is_fresh (image_file, file)) {
+		image = table_image_open (image_file);
+		if (image != NULL) {
+			message ("Mapped %s\n", image_file);
+			return image;
+		}
+		message ("Invalid image %s; ", image_file);
+	}
+
 	message ("Loading %s... ", file);
 	hash = loader (file);
 	if (hash == NULL) {
 		message ("not found\n");
-		if (required) {
-			error ("Error: cannot load %s\n", file);
-			error ("If your table files are somewhere else, then use the --tables parameter.\n");
+		error ("Error: cannot load %s\n", file);
+		if (reload)
+			return NULL;
+		error ("If your table files are somewhere else, then use the --tables parameter.\n");
+		exit (1);
+	}
+	message ("\n");
+
+	if (options.compile) {
+		if (table_image_write (hash, image_file) != 0) {
+			error ("Error: cannot write %s: %s\n", image_file, strerror (errno));
 			exit (1);
 		}
-	} else
-		message ("\n");
-	return hash;
+		message ("Compiled %s\n", image_file);
+	}
+	image = table_image_new_from_hash (hash);
+	string_hash_free (hash);
+	if (image == NULL) {
+		error ("Error: not enough memory for %s\n", file);
+		if (!reload)
+			exit (1);
+	}
+	return image;
+}
+
+
+static void
+free_tables (TableSet *tables)
+{
+	int i;
+
+	for (i = 0; i < NUM_HASH_FILES; i++) {
+		if (tables->files[i] != NULL)
+			table_image_free (tables->files[i]);
+	}
+	free (tables);
+}
+
+/* Load all table files. Returns NULL if one can't be loaded when reloading. */
+static TableSet *
+load_tables (int reload)
+{
+	TableSet *tables;
+	int i;
+
+	tables = calloc (sizeof (TableSet), 1);
+	tables->loaded_at = time (NULL);
+	for (i = 0; i < NUM_HASH_FILES; i++) {
+		tables->files[i] = load_hash_file (table_files[i].basename, table_files[i].loader, reload);
+		if (tables->files[i] == NULL) {
+			free_tables (tables);
+			return NULL;
+		}
+	}
+	return tables;
+}
+
+/* Whether a table file, or its image, changed since the tables were loaded. */
+static int
+tables_changed (TableSet *tables)
+{
+	char file[PATH_MAX];
+	struct stat file_stat;
+	int i;
+
+	for (i = 0; i < NUM_HASH_FILES; i++) {
+		snprintf (file, sizeof (file), "%s/%s", options.tables, table_files[i].basename);
+		if (stat (file, &file_stat) == 0 && file_stat.st_mtime > tables->loaded_at)
+			return 1;
+		snprintf (file, sizeof (file), "%s/%s.img", options.images, table_files[i].basename);
+		if (stat (file, &file_stat) == 0 && file_stat.st_mtime > tables->loaded_at)
+			return 1;
+	}
+	return 0;
+}
+
+/* Build the new tables off to the side, while the event loop keeps serving
+ * the old ones; swap them in, and free the old ones once the event loop can't
+ * be using them anymore. */
+static ReloadThreadValue
+reload_thread_entry (void *arg)
+{
+	TableSet *tables, *old;
+
+	(void) arg;
+	message ("Reloading the table files...\n");
+	tables = load_tables (1);
+	if (tables == NULL) {
+		error ("Reloading failed; still serving the previous tables.\n");
+	} else {
+		tables->generation = current_tables->generation + 1;
+		old = rcu_publish ((void **) &current_tables, tables);
+		rcu_synchronize ();
+		free_tables (old);
+		message ("Tables reloaded (generation %u).\n", tables->generation);
+	}
+	__atomic_store_n (&reload_done, 1, __ATOMIC_RELEASE);
+	return RELOAD_THREAD_RETURN_VALUE;
+}
+
+/* Called by the event loop between events. */
+static void
+on_tick (void)
+{
+	rcu_quiescent (loop_reader);
+
+	if (reloading) {
+		if (!__atomic_load_n (&reload_done, __ATOMIC_ACQUIRE))
+			return;
+		reload_thread_join (reload_thread);
+		reloading = 0;
+	}
+
+	if (options.watch > 0 && time (NULL) - last_watch >= options.watch) {
+		last_watch = time (NULL);
+		if (tables_changed (current_tables))
+			reload_requested = 1;
+	}
+
+	if (reload_requested) {
+		reload_requested = 0;
+		reload_done = 0;
+		if (reload_thread_start (reload_thread, reload_thread_entry))
+			reloading = 1;
+		else
+			error ("Cannot start a thread to reload the tables.\n");
+	}
+}
+
+/* Wait for a reload in progress, before the tables are freed. */
+static void
+finish_reload (void)
+{
+	if (reloading) {
+		/* The event loop doesn't use the tables anymore. */
+		rcu_offline (loop_reader);
+		reload_thread_join (reload_thread);
+		reloading = 0;
+	}
 }
 
 
@@ -318,21 +391,9 @@ main (int argc, char *argv[])
 {
 	int i, ret;
 
-	/* Check whether there's already a server running. */
-	ret = server_trylock ();
-	if (ret == -1)
-		/* Error. */
-		return 1;
-	else if (ret == 0) {
-		/* Yes. */
-		error ("Server already running.\n");
-		return 2;
-	}
-
 	/* Parse arguments. */
 	memset (&options, 0, sizeof (options));
 	options.tables = ".";
-	options.threads = 5;
 
 	for (i = 1; i < argc; i++) {
 		if (strcmp (argv[i], "--help") == 0) {
@@ -346,14 +407,29 @@ main (int argc, char *argv[])
 			options.tables = argv[i + 1];
 			i++;
 
-		} else if (strcmp (argv[i], "--threads") == 0) {
+		} else if (strcmp (argv[i], "--images") == 0) {
 			if (argv[i + 1] == NULL) {
-				error ("--threads requires a number.\n");
+				error ("--images requires a directory name.\n");
+				usage (1);
+			}
+			options.images = argv[i + 1];
+			i++;
+
+		} else if (strcmp (argv[i], "--compile") == 0) {
+			options.compile = 1;
+
+		} else if (strcmp (argv[i], "--watch") == 0) {
+			if (argv[i + 1] == NULL) {
+				error ("--watch requires a number of seconds.\n");
 				usage (1);
 			}
-			options.threads = atoi (argv[i + 1]);
-			if (options.threads <= 0) {
-				error ("The number of threads must be bigger than 0.\n");
+			options.watch = atoi (argv[i + 1]);
+			i++;
+
+		} else if (strcmp (argv[i], "--threads") == 0) {
+			/* Obsolete: all clients are served by one event loop. */
+			if (argv[i + 1] == NULL) {
+				error ("--threads requires a number.\n");
 				usage (1);
 			}
 			i++;
@@ -370,44 +446,37 @@ main (int argc, char *argv[])
 		}
 	}
 
-	/* Load data files. */
-	hashFiles[0] = load_hash_file ("itemsdescriptions.txt",  desc_info_load, 1);
-	hashFiles[1] = load_hash_file ("skillsdescriptions.txt", desc_info_load, 1);
-        hashFiles[2] = load_hash_file ("cities.txt",             rolut_load, 1);
-	hashFiles[3] = load_hash_file ("elements.txt",           rolut_load, 1);
-	hashFiles[4] = load_hash_file ("items.txt",              rolut_load, 1);
-	hashFiles[5] = load_hash_file ("itemslotcounttable.txt", rolut_load, 1);
-	hashFiles[6] = load_hash_file ("maps.txt",               rolut_load, 1);
-
-	/* Initialize threads for handling client connections. */
-	threads = malloc (options.threads * sizeof (ThreadData));
-	for (i = 0; i < options.threads; i++) {
-		threads[i].lock = mutex_new ();
-		threads[i].ID = i;
-		threads[i].new_client = NULL;
-		threads[i].quit = 0;
-		threads[i].nclients = 0;
-		threads[i].clients = llist_new (sizeof (Client));
-
-		threads[i].thread = thread_new (client_thread_callback, &(threads[i]), 0);
-		if (!threads[i].thread) {
-			error ("Unable to create a thread.\n");
+	if (options.images == NULL)
+		options.images = options.tables;
+
+	/* Check whether there's already a server running; compiling doesn't disturb it. */
+	if (!options.compile) {
+		ret = server_trylock ();
+		if (ret == -1)
+			/* Error. */
 			return 1;
+		else if (ret == 0) {
+			/* Yes. */
+			error ("Server already running.\n");
+			return 2;
 		}
 	}
 
+	/* Load data files. */
+	current_tables = load_tables (0);
+	if (options.compile) {
+		free_tables (current_tables);
+		return 0;
+	}
+
 	/* Initialize server and main loop. */
+	loop_reader = rcu_register_reader ();
+	last_watch = time (NULL);
 	ret = start ();
 
 	/* Free resources. */
-	for (i = 0; i < options.threads; i++) {
-		thread_join (threads[i].thread);
-		mutex_free (threads[i].lock);
-	}
-	free (threads);
-
-	for (i = 0; i < NUM_HASH_FILES; i++)
-		string_hash_free (hashFiles[i]);
+	finish_reload ();
+	free_tables (current_tables);
 
 	return ret;
 }
@@ -19,45 +19,49 @@
 #ifndef _DATASERVER_H_
 #define _DATASERVER_H_
 
+#include <time.h>
 #include "client.h"
-#include "string-hash.h"
-#include "threads.h"
+#include "table-image.h"
 
 
 #define NUM_HASH_FILES 7
-#define CLIENT_BUF_SIZE 512
 
 
 typedef struct {
 	char *tables;
+	char *images;
+	int compile;
 	int silent;
 	int debug;
-	int threads;
+	/* Seconds between checks for changed table files, 0 to never check. */
+	int watch;
 } Options;
 
 
-struct _PrivateData {
-	StringHashItem *iterators[NUM_HASH_FILES];
-
-	char buf[CLIENT_BUF_SIZE];
-	int buf_len;
-};
-
-
+/* One version of all the tables. Requests are served from the current
+ * one; a reload builds a new one and replaces it, see tables_current(). */
 typedef struct {
-	Mutex *lock;
-	Thread *thread;
-	Client *new_client;
-	int quit;
+	TableImage *files[NUM_HASH_FILES];
+	/* Counts the reloads. */
+	unsigned int generation;
+	/* When the table files were loaded. */
+	time_t loaded_at;
+} TableSet;
 
-	int ID;
-	int nclients;
-	LList *clients;
-} ThreadData;
+
+struct _PrivateData {
+	/* The index of the next entry to send plus one, or 0 when not iterating.
+	 * An iteration which spans a reload goes on in the new tables. */
+	unsigned int iterators[NUM_HASH_FILES];
+};
 
 
 extern Options options;
-extern StringHash *hashFiles[NUM_HASH_FILES];
+
+/* The tables to serve a request from. The event loop passes a quiescent
+ * point (see rcu.h) between client events, so they must not be kept
+ * longer than one request. */
+TableSet *tables_current (void);
 
 
 #endif /* _DATASERVER_H_ */
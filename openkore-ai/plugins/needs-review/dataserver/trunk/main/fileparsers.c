@@ -151,7 +151,7 @@ rolut_load (const char *filename)
 			line[len - 1] = 0;
 			len--;
 		}
-		if (line[len - 1] == '\r') {
+		if (len > 0 && line[len - 1] == '\r') {
 			line[len - 1] = 0;
 			len--;
 		}
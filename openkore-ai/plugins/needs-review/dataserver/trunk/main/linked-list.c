@@ -65,6 +65,13 @@ llist_append_existing (LList *list, void *item)
 
 void
 llist_remove (LList *list, LListItem *item)
+{
+	llist_remove_existing (list, item);
+	free (item);
+}
+
+void
+llist_remove_existing (LList *list, LListItem *item)
 {
 	LListItem *i, *prev;
 
@@ -84,7 +91,6 @@ llist_remove (LList *list, LListItem *item)
 		list->len--;
 		break;
 	}
-	free (item);
 }
 
 void
@@ -58,6 +58,9 @@ void llist_append_existing (LList *list, void *item);
  * inside item manually before calling this function. */
 void llist_remove (LList *list, LListItem *item);
 
+/* Like llist_remove(), but doesn't free the memory used by item. */
+void llist_remove_existing (LList *list, LListItem *item);
+
 /* Free the linked list, including items. If you have any pointers
  * in your items, then you must free them before calling this function. */
 void llist_free   (LList *list);
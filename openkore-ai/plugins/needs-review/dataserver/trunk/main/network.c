@@ -1,8 +1,14 @@
-#ifndef WIN32
+#ifdef WIN32
+	#include <winsock2.h>
+#else
 	#include <sys/types.h>
 	#include <sys/socket.h>
 	#include <unistd.h>
+	#include <fcntl.h>
+	#include <errno.h>
 #endif /* WIN32 */
+#include <stdlib.h>
+#include <string.h>
 
 #include "client.h"
 
@@ -12,36 +18,144 @@
 	#define MSG_NOSIGNAL_NOT_SUPPORTED
 #endif
 
+#ifdef WIN32
+	#define would_block() (WSAGetLastError () == WSAEWOULDBLOCK)
+	#define interrupted() (WSAGetLastError () == WSAEINTR)
+#else
+	#define would_block() (errno == EAGAIN || errno == EWOULDBLOCK)
+	#define interrupted() (errno == EINTR)
+#endif
+
 
 void
 client_init (Client *client)
 {
+	#ifdef WIN32
+	u_long enabled = 1;
+	ioctlsocket (client->fd, FIONBIO, &enabled);
+	#else
+	fcntl (client->fd, F_SETFL, fcntl (client->fd, F_GETFL) | O_NONBLOCK);
+	#endif
+
 	#ifdef SO_NOSIGPIPE
-	int enabled = 1;
-	setsockopt (client->fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof (enabled));
+	{
+		int enabled = 1;
+		setsockopt (client->fd, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof (enabled));
+	}
 	#endif
+
+	client->priv = NULL;
+	client->in = NULL;
+	client->in_len = client->in_size = 0;
+	client->out = NULL;
+	client->out_pos = client->out_len = client->out_size = 0;
+	client->events = 0;
+	client->eof = 0;
 }
 
 
 int
-client_recv (Client *client, void *buf, int len)
+client_fill (Client *client)
 {
-	return recv (client->fd, buf, len, MSG_NOSIGNAL);
+	while (client->in_len < CLIENT_MAX_INPUT) {
+		int len;
+
+		if (client->in_len == client->in_size) {
+			/* Keep a spare byte, so a request can be NUL-terminated in place. */
+			client->in_size = (client->in_size == 0) ? 512 : client->in_size * 2;
+			if (client->in_size > CLIENT_MAX_INPUT)
+				client->in_size = CLIENT_MAX_INPUT;
+			client->in = realloc (client->in, client->in_size + 1);
+		}
+
+		len = recv (client->fd, client->in + client->in_len, client->in_size - client->in_len, MSG_NOSIGNAL);
+		if (len > 0) {
+			client->in_len += len;
+		} else if (len == 0) {
+			client->eof = 1;
+			return 0;
+		} else if (would_block ()) {
+			return 1;
+		} else if (!interrupted ()) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+void
+client_write (Client *client, const void *data, int len)
+{
+	if (client->out_pos > 0 && client->out_pos == client->out_len)
+		client->out_pos = client->out_len = 0;
+
+	if (client->out_len + len > client->out_size) {
+		if (client->out_pos > 0) {
+			/* Reuse the space of what's been sent. */
+			memmove (client->out, client->out + client->out_pos, client->out_len - client->out_pos);
+			client->out_len -= client->out_pos;
+			client->out_pos = 0;
+		}
+		while (client->out_len + len > client->out_size)
+			client->out_size = (client->out_size == 0) ? 512 : client->out_size * 2;
+		client->out = realloc (client->out, client->out_size);
+	}
+	memcpy (client->out + client->out_len, data, len);
+	client->out_len += len;
+}
+
+
+int
+client_flush (Client *client)
+{
+	while (client->out_pos < client->out_len) {
+		int len;
+
+		len = send (client->fd, client->out + client->out_pos,
+			client->out_len - client->out_pos, MSG_NOSIGNAL);
+		if (len > 0) {
+			client->out_pos += len;
+		} else if (len == -1 && would_block ()) {
+			return 1;
+		} else if (len == 0 || !interrupted ()) {
+			return 0;
+		}
+	}
+
+	client->out_pos = client->out_len = 0;
+	if (client->out_size > CLIENT_MAX_OUTPUT) {
+		/* Don't keep the memory of a burst around. */
+		free (client->out);
+		client->out = NULL;
+		client->out_size = 0;
+	}
+	return 1;
 }
 
 
 int
-client_send (Client *client, const void *data, int len)
+client_wants_read (Client *client)
 {
-	return send (client->fd, data, len, MSG_NOSIGNAL) != -1;
+	return client->out_len - client->out_pos < CLIENT_MAX_OUTPUT;
 }
 
+int
+client_wants_write (Client *client)
+{
+	return client->out_pos < client->out_len;
+}
+
+
 void
-client_close (Client *client)
+client_free (Client *client)
 {
 #ifdef WIN32
 	closesocket (client->fd);
 #else
 	close (client->fd);
 #endif
+	free (client->in);
+	free (client->out);
+	free (client);
 }
@@ -6,19 +6,24 @@
 #include "dataserver.h"
 #include "utils.h"
 
+/* The maximum number of entries sent for one range request. */
+#define RANGE_MAX_ENTRIES 1024
+
 
 /* Client connections are handled like this:
- * The server has multiple client threads. Each client thread can handle multiple
- * clients. When a client connects, the main thread assigns the client to a client
- * thread. This way we have a constant number of threads.
+ * The server waits for events on every client socket at once, in a single
+ * thread. When a client is readable, everything it sent is received, and
+ * every complete request in its buffer is answered; so a client may send
+ * many requests without waiting for the replies. Replies are queued and sent
+ * as the socket takes them. A client which doesn't read its replies isn't
+ * read from until it does.
  */
 
 
 static int
 send_reply (Client *client, const char *data)
 {
-	unsigned char status;
-	int ret;
+	unsigned char header[3];
 
 	/*
 	 * struct {
@@ -30,50 +35,64 @@ send_reply (Client *client, const char *data)
 	 */
 
 	if (data == NULL) {
-		status = 0;
-		ret = client_send (client, &status, 1);
+		header[0] = 0;
+		client_write (client, header, 1);
 
 	} else {
 		uint16_t len, nlen;
 
-		status = 1;
 		len = strlen (data);
 		nlen = htons (len);
-
-		ret = client_send (client, &status, 1);
-		if (ret)
-			ret = client_send (client, &nlen, 2);
-		if (ret)
-			ret = client_send (client, data, len);
+		header[0] = 1;
+		memcpy (header + 1, &nlen, 2);
+		client_write (client, header, 3);
+		client_write (client, data, len);
 	}
+	return 1;
+}
 
-	if (!ret) {
-		DEBUG ("Cannot send data to client %p: %s\n", client, strerror (errno));
-	}
-	return ret;
+/* Start a reply which frames count single replies. */
+static void
+send_batch_header (Client *client, unsigned int count)
+{
+	unsigned char header[3];
+	uint16_t ncount;
+
+	/*
+	 * struct {
+	 *    unsigned char status;   // always 1
+	 *    uint16_t count;
+	 *    // Followed by 'count' replies in the format of send_reply()
+	 * }
+	 */
+	ncount = htons ((uint16_t) count);
+	header[0] = 1;
+	memcpy (header + 1, &ncount, 2);
+	client_write (client, header, 3);
 }
 
 
 /* Process packet contents. */
 static int
-process_data (ThreadData *thread_data, Client *client, unsigned char major, unsigned char minor, char *data, int size)
+process_data (Client *client, unsigned char major, unsigned char minor, char *data, int size)
 {
 	PrivateData *priv = client->priv;
+	TableSet *tables = tables_current ();
 
 	switch (major) {
 	case 0: {
 		/* Major command 0: retrieve data from table files of StringHash type. */
 		if (minor >= NUM_HASH_FILES) {
 			/* Invalid file requested. */
-			DEBUG ("Thread %d, client %p: invalid file requested: %d\n",
-			       thread_data->ID, client, (int) minor);
+			DEBUG ("Client %p: invalid file requested: %d\n", client, (int) minor);
 			return 0;
 		} else
-			return send_reply (client, string_hash_get (hashFiles[(int) minor], data));
+			return send_reply (client, table_image_get (tables->files[(int) minor], data));
 	}
 
 	case 1: {
-		StringHashItem *item;
+		unsigned int next;
+		const char *key;
 		int fileIndex;
 
 		/* Major command 255: special operations for StringHash table files. */
@@ -82,31 +101,95 @@ process_data (ThreadData *thread_data, Client *client, unsigned char major, unsi
 			fileIndex = minor;
 
 			/* Send the first key in the hash and go to the next iteration. */
-			item = (StringHashItem *) hashFiles[fileIndex]->first;
-			if (item == NULL)
+			key = table_image_key (tables->files[fileIndex], 0);
+			if (key == NULL)
 				return send_reply (client, NULL);
 
-			priv->iterators[fileIndex] = (StringHashItem *) ((LListItem *) item)->next;
-			return send_reply (client, item->key);
+			priv->iterators[fileIndex] = 2;
+			return send_reply (client, key);
 
 		} else if (minor >= 127 && minor < 127 + NUM_HASH_FILES) {
 			/* Command: iterate next. */
 			fileIndex = minor - 127;
 
 			/* Send the key in the current iteration and go to the next one. */
-			item = priv->iterators[fileIndex];
-			if (item == NULL)
+			next = priv->iterators[fileIndex];
+			if (next == 0 || (key = table_image_key (tables->files[fileIndex], next - 1)) == NULL)
 				return send_reply (client, NULL);
 
-			priv->iterators[fileIndex] = (StringHashItem *) ((LListItem *) item)->next;
-			return send_reply (client, item->key);
+			priv->iterators[fileIndex] = next + 1;
+			return send_reply (client, key);
 
 		} else {
 			/* Invalid command. */
-			DEBUG ("Thread %d, client %p: invalid command for major 1: %d\n",
-			       thread_data->ID, client, (int) minor);
+			DEBUG ("Client %p: invalid command for major 1: %d\n", client, (int) minor);
+			return 0;
+		}
+	}
+
+	case 2: {
+		unsigned int count;
+		char *key, *end;
+
+		/* Major command 2: retrieve many values from a table file at once.
+		 * 'data' holds the keys, each one followed by a NUL. The request
+		 * size limits the number of keys, so the count always fits. */
+		if (minor >= NUM_HASH_FILES) {
+			DEBUG ("Client %p: invalid file requested: %d\n", client, (int) minor);
+			return 0;
+		}
+
+		end = data + size;
+		count = 0;
+		for (key = data; key < end; key += strlen (key) + 1)
+			count++;
+
+		send_batch_header (client, count);
+		for (key = data; key < end; key += strlen (key) + 1)
+			send_reply (client, table_image_get (tables->files[(int) minor], key));
+		return 1;
+	}
+
+	case 3: {
+		uint32_t start;
+		uint16_t count;
+		unsigned int i, total;
+
+		/* Major command 3: retrieve a range of entries from a table file.
+		 * struct {
+		 *    uint32_t start;   // Index of the first entry
+		 *    uint16_t count;   // Number of entries
+		 * }
+		 * The reply frames a key and a value reply for each entry that exists;
+		 * at most RANGE_MAX_ENTRIES entries are sent per request. */
+		if (minor >= NUM_HASH_FILES) {
+			DEBUG ("Client %p: invalid file requested: %d\n", client, (int) minor);
 			return 0;
 		}
+		if (size != 6) {
+			DEBUG ("Client %p: invalid range request size: %d\n", client, size);
+			return 0;
+		}
+
+		memcpy (&start, data, 4);
+		memcpy (&count, data + 4, 2);
+		start = ntohl (start);
+		count = ntohs (count);
+		if (count > RANGE_MAX_ENTRIES)
+			count = RANGE_MAX_ENTRIES;
+
+		total = tables->files[(int) minor]->header->count;
+		if (start >= total)
+			count = 0;
+		else if (count > total - start)
+			count = total - start;
+
+		send_batch_header (client, count * 2);
+		for (i = start; i < start + count; i++) {
+			send_reply (client, table_image_key (tables->files[(int) minor], i));
+			send_reply (client, table_image_value (tables->files[(int) minor], i));
+		}
+		return 1;
 	}
 
 	default:
@@ -122,33 +205,18 @@ process_data (ThreadData *thread_data, Client *client, unsigned char major, unsi
  * It unserializes packets and takes care of input data buffering.
  */
 int
-process_client (ThreadData *thread_data, Client *client, PrivateData *priv)
+process_client (Client *client)
 {
-	int tmp, len;
-
-	unsigned char major, minor;
-	uint16_t size;
-	char *data;
-
-	/* Buffer is full. The client is trying to perform a request with a rediculously
-	 * big name. It's probably misbehaving, so disconnect it. */
-	if (priv->buf_len >= CLIENT_BUF_SIZE) {
-		DEBUG ("Thread %d, client %p: buffer full; disconnecting client\n",
-		       thread_data->ID, client);
-		return 0;
-	}
+	int pos, packets;
 
-	/* Receive data from client. */
-	len = client_recv (client, priv->buf + priv->buf_len, CLIENT_BUF_SIZE - priv->buf_len);
-	if (len <= 0) {
+	/* Receive data from client, unless it has enough replies to read already. */
+	if (client_wants_read (client) && !client_fill (client)) {
 		/* Client exited. */
-		DEBUG ("Thread %d, client %p: client exited\n", thread_data->ID, client);
+		DEBUG ("Client %p: client exited\n", client);
 		return 0;
 	}
 
-	priv->buf_len += len;
-
-	/* We expect the following packet:
+	/* We expect the following packets, one after the other:
 	 * struct {
 	 *     unsigned char major;
 	 *     unsigned char minor;
@@ -158,35 +226,53 @@ process_client (ThreadData *thread_data, Client *client, PrivateData *priv)
 	 *
 	 * major and minor specify which file's data the client is requesting.
 	 */
-	if (len < 4)
-		/* Packet too small; continue receiving. */
-		return 1;
-
-	/* Get the 'major', 'minor' and 'size' fields and check whether we've received enough data. */
-	major = priv->buf[0];
-	minor = priv->buf[1];
-	memcpy (&size, priv->buf + 2, 2);
-	size = ntohs (size);
-	if (len < 4 + size)
-		return 1;
+	packets = 0;
+	do {
+		pos = 0;
+		while (client->in_len - pos >= 4 && client_wants_read (client)) {
+			unsigned char major, minor;
+			uint16_t size;
+			char *data, saved;
+			int ok;
+
+			/* Get the 'major', 'minor' and 'size' fields and check whether we've received enough data. */
+			major = client->in[pos];
+			minor = client->in[pos + 1];
+			memcpy (&size, client->in + pos + 2, 2);
+			size = ntohs (size);
+			if (client->in_len - pos < 4 + size)
+				/* Packet incomplete; continue receiving. */
+				break;
+
+			/* The 'data' field, NUL-terminated in place; the buffer has a spare byte. */
+			data = client->in + pos + 4;
+			saved = data[size];
+			data[size] = 0;
+			ok = process_data (client, major, minor, data, size);
+			data[size] = saved;
+			if (!ok)
+				return 0;
+
+			pos += 4 + size;
+			packets++;
+		}
 
-	/* Get the 'data' field. */
-	data = malloc (size + 1);
-	memcpy (data, priv->buf + 4, size);
-	data[size] = 0;
+		/* Remove the processed packets from the buffer. */
+		if (pos > 0) {
+			memmove (client->in, client->in + pos, client->in_len - pos);
+			client->in_len -= pos;
+		}
 
-	/* Process the packet's content. */
-	if (!process_data (thread_data, client, major, minor, data, size)) {
-		free (data);
-		return 0;
-	}
+		if (!client_flush (client)) {
+			DEBUG ("Cannot send data to client %p: %s\n", client, strerror (errno));
+			return 0;
+		}
 
-	/* Remove this packet from the buffer. */
-	tmp = priv->buf_len - size - 4;
-	if (tmp > 0)
-		memmove (priv->buf, priv->buf + size + 4, tmp);
-	priv->buf_len -= size + 4;
+		/* If the replies were sent at once, the requests which had to
+		 * wait for them won't get another event. */
+	} while (pos > 0 && client->in_len >= 4 && !client_wants_write (client));
 
-	free (data);
+	if (packets > 1)
+		DEBUG ("Client %p: %d pipelined requests\n", client, packets);
 	return 1;
 }
@@ -4,6 +4,8 @@
 #include "dataserver.h"
 #include "client.h"
 
-int process_client (ThreadData *thread_data, Client *client, PrivateData *priv);
+/* Answer the requests a client sent, and send the replies.
+ * This is the server's ClientEventCallback. */
+int process_client (Client *client);
 
 #endif /* _PROCESSING_H_ */
@@ -0,0 +1,104 @@
+/*  Kore Shared Data Server
+ *  Copyright (C) 2005  Hongli Lai <hongli AT navi DOT cx>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifdef WIN32
+	#include <windows.h>
+	#define sleep_ms(ms) Sleep (ms)
+#else
+	#include <unistd.h>
+	#define sleep_ms(ms) usleep ((ms) * 1000)
+#endif
+
+#include "rcu.h"
+
+
+/* How often rcu_synchronize() checks the readers, in miliseconds. */
+#define SYNCHRONIZE_INTERVAL 5
+
+
+/* A counter for each reader, which only that reader changes:
+ * it grows by 2 at each quiescent point, and is odd while the
+ * reader is offline. */
+static unsigned long counters[RCU_MAX_READERS];
+static int reader_count = 0;
+
+
+int
+rcu_register_reader (void)
+{
+	int reader;
+
+	reader = __atomic_fetch_add (&reader_count, 1, __ATOMIC_SEQ_CST);
+	if (reader >= RCU_MAX_READERS) {
+		__atomic_fetch_sub (&reader_count, 1, __ATOMIC_SEQ_CST);
+		return -1;
+	}
+	return reader;
+}
+
+void
+rcu_quiescent (int reader)
+{
+	__atomic_add_fetch (&counters[reader], 2, __ATOMIC_SEQ_CST);
+}
+
+void
+rcu_offline (int reader)
+{
+	__atomic_add_fetch (&counters[reader], 1, __ATOMIC_SEQ_CST);
+}
+
+void
+rcu_online (int reader)
+{
+	__atomic_add_fetch (&counters[reader], 1, __ATOMIC_SEQ_CST);
+}
+
+void *
+rcu_dereference (void **slot)
+{
+	return __atomic_load_n (slot, __ATOMIC_ACQUIRE);
+}
+
+void *
+rcu_publish (void **slot, void *value)
+{
+	return __atomic_exchange_n (slot, value, __ATOMIC_SEQ_CST);
+}
+
+void
+rcu_synchronize (void)
+{
+	unsigned long seen[RCU_MAX_READERS];
+	int i, count;
+
+	count = __atomic_load_n (&reader_count, __ATOMIC_SEQ_CST);
+	if (count > RCU_MAX_READERS)
+		count = RCU_MAX_READERS;
+	for (i = 0; i < count; i++)
+		seen[i] = __atomic_load_n (&counters[i], __ATOMIC_SEQ_CST);
+
+	/* A reader which was offline, or whose counter changed since,
+	 * got the data after it was published. */
+	for (i = 0; i < count; i++) {
+		if (seen[i] & 1)
+			continue;
+		while (__atomic_load_n (&counters[i], __ATOMIC_SEQ_CST) == seen[i])
+			sleep_ms (SYNCHRONIZE_INTERVAL);
+	}
+}
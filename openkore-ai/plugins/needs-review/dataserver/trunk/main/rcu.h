@@ -0,0 +1,58 @@
+/*  Kore Shared Data Server
+ *  Copyright (C) 2005  Hongli Lai <hongli AT navi DOT cx>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _RCU_H_
+#define _RCU_H_
+
+/*****************************************************
+ * Read-copy-update: data which readers use without
+ * locks, and which a writer replaces with a new copy.
+ *
+ * Readers use the data between quiescent points, and
+ * must not keep pointers to it past them. The writer
+ * publishes the new copy with rcu_publish(), which
+ * readers get from then on with rcu_dereference(),
+ * and then frees the old one after rcu_synchronize(),
+ * when every reader has passed a quiescent point and
+ * can't be using it anymore.
+ *
+ * A reader which is offline doesn't use the data, and
+ * isn't waited for.
+ *****************************************************/
+
+#define RCU_MAX_READERS 32
+
+
+/* Register the calling thread as a reader, online.
+ * Returns its number, or -1 if there are RCU_MAX_READERS already. */
+int   rcu_register_reader (void);
+
+/* The reader doesn't use any data it got before this point. */
+void  rcu_quiescent (int reader);
+void  rcu_offline   (int reader);
+void  rcu_online    (int reader);
+
+void *rcu_dereference (void **slot);
+
+/* Make the data at 'slot' 'value'. Returns the previous data. */
+void *rcu_publish (void **slot, void *value);
+
+/* Wait until every online reader has passed a quiescent point. */
+void  rcu_synchronize (void);
+
+#endif /* _RCU_H_ */
@@ -22,10 +22,60 @@
 #include "utils.h"
 
 
+#define INITIAL_SIZE 64
+
+
 StringHash *
 string_hash_new ()
 {
-	return (StringHash *) llist_new (sizeof (StringHashItem));
+	StringHash *hash;
+
+	hash = malloc (sizeof (StringHash));
+	hash->items = llist_new (sizeof (StringHashItem));
+	hash->size = INITIAL_SIZE;
+	hash->count = 0;
+	hash->slots = calloc (hash->size, sizeof (StringHashItem *));
+	return hash;
+}
+
+/* Put an item into the first empty slot for its hash. */
+static void
+put_slot (StringHashItem **slots, unsigned int size, StringHashItem *item)
+{
+	unsigned int i;
+
+	for (i = item->hash & (size - 1); slots[i] != NULL; i = (i + 1) & (size - 1));
+	slots[i] = item;
+}
+
+static void
+grow (StringHash *hash)
+{
+	StringHashItem **slots;
+	unsigned int size, i;
+
+	size = hash->size * 2;
+	slots = calloc (size, sizeof (StringHashItem *));
+	for (i = 0; i < hash->size; i++) {
+		if (hash->slots[i] != NULL)
+			put_slot (slots, size, hash->slots[i]);
+	}
+	free (hash->slots);
+	hash->slots = slots;
+	hash->size = size;
+}
+
+static StringHashItem *
+find (StringHash *hash, const char *key, unsigned int key_hash)
+{
+	StringHashItem *item;
+	unsigned int i;
+
+	for (i = key_hash & (hash->size - 1); (item = hash->slots[i]) != NULL; i = (i + 1) & (hash->size - 1)) {
+		if (item->hash == key_hash && strcmp (item->key, key) == 0)
+			return item;
+	}
+	return NULL;
 }
 
 void
@@ -33,24 +83,28 @@ string_hash_set (StringHash *hash, char *key, char *value)
 {
 	StringHashItem *item;
 
-	item = (StringHashItem *) llist_append ((LList *) hash);
+	item = (StringHashItem *) llist_append (hash->items);
 	item->key = key;
 	item->hash = calc_hash (key);
 	item->value = value;
+
+	/* Like with the list this replaces, the first value of a key is
+	 * the one which is found, but every item is iterated. */
+	if (find (hash, key, item->hash) != NULL)
+		return;
+	if ((hash->count + 1) * 2 > hash->size)
+		grow (hash);
+	put_slot (hash->slots, hash->size, item);
+	hash->count++;
 }
 
 const char *
 string_hash_get (StringHash *hash, const char *key)
 {
-	unsigned int item_hash;
 	StringHashItem *item;
 
-	item_hash = calc_hash (key);
-	for (item = (StringHashItem *) hash->first; item != NULL; item = (StringHashItem *) item->parent.next) {
-		if (item_hash == item->hash && strcmp (item->key, key) == 0)
-			return item->value;
-	}
-	return NULL;
+	item = find (hash, key, calc_hash (key));
+	return (item != NULL) ? item->value : NULL;
 }
 
 void
@@ -58,9 +112,11 @@ string_hash_free (StringHash *hash)
 {
 	StringHashItem *item;
 
-	foreach_llist (hash, StringHashItem *, item) {
+	foreach_llist (hash->items, StringHashItem *, item) {
 		free (item->key);
 		free (item->value);
 	}
-	llist_free (hash);
+	llist_free (hash->items);
+	free (hash->slots);
+	free (hash);
 }
@@ -22,7 +22,9 @@
 #include "linked-list.h"
 
 /*****************************************************
- * String key-value associative list implementation.
+ * String key-value associative array implementation.
+ * Lookups go through an open-addressed table; the
+ * items can also be iterated in insertion order.
  *****************************************************/
 
 
@@ -34,7 +36,18 @@ typedef struct {
 	unsigned int hash;
 } StringHashItem;
 
-typedef LList StringHash;
+typedef struct {
+	/* The items, in insertion order. */
+	LList *items;
+
+	/* The slots, a power of two of them, which are NULL or point to
+	 * an item. A key is looked up from slot (hash & (size - 1)),
+	 * and then slot by slot until the key or an empty slot is found.
+	 * Never more than half full. */
+	StringHashItem **slots;
+	unsigned int size;
+	unsigned int count;
+} StringHash;
 
 
 StringHash *string_hash_new  ();
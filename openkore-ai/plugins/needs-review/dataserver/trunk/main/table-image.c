@@ -0,0 +1,311 @@
+/*  Kore Shared Data Server
+ *  Copyright (C) 2005  Hongli Lai <hongli AT navi DOT cx>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "table-image.h"
+#include "utils.h"
+
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+
+/* Lay out the image of a StringHash in a newly allocated buffer. */
+static char *
+build (StringHash *hash, unsigned int *size)
+{
+	TableImageHeader *header;
+	TableImageEntry *entries;
+	unsigned int *slots;
+	char *data, *strings;
+	StringHashItem *item;
+	unsigned int count, slot_count, strings_size, i, used;
+
+	/* A fill factor of at most one half, like StringHash. */
+	count = hash->items->len;
+	strings_size = 0;
+	foreach_llist (hash->items, StringHashItem *, item)
+		strings_size += strlen (item->key) + strlen (item->value) + 2;
+	for (slot_count = 16; slot_count < count * 2; slot_count *= 2);
+
+	*size = sizeof (TableImageHeader) + count * sizeof (TableImageEntry)
+		+ slot_count * sizeof (unsigned int) + strings_size;
+	data = calloc (1, *size);
+	if (data == NULL)
+		return NULL;
+
+	header = (TableImageHeader *) data;
+	memcpy (header->magic, TABLE_IMAGE_MAGIC, sizeof (TABLE_IMAGE_MAGIC));
+	header->version = TABLE_IMAGE_VERSION;
+	header->count = count;
+	header->slot_count = slot_count;
+	header->size = *size;
+	header->entries = sizeof (TableImageHeader);
+	header->slots = header->entries + count * sizeof (TableImageEntry);
+	header->strings = header->slots + slot_count * sizeof (unsigned int);
+
+	entries = (TableImageEntry *) (data + header->entries);
+	slots = (unsigned int *) (data + header->slots);
+	strings = data + header->strings;
+
+	i = 0;
+	used = 0;
+	foreach_llist (hash->items, StringHashItem *, item) {
+		entries[i].hash = item->hash;
+		entries[i].key = used;
+		strcpy (strings + used, item->key);
+		used += strlen (item->key) + 1;
+		entries[i].value = used;
+		strcpy (strings + used, item->value);
+		used += strlen (item->value) + 1;
+		i++;
+	}
+
+	/* Only the first entry of a key gets a slot. */
+	for (i = 0; i < count; i++) {
+		unsigned int s;
+
+		for (s = entries[i].hash & (slot_count - 1); slots[s] != 0; s = (s + 1) & (slot_count - 1)) {
+			TableImageEntry *other = &entries[slots[s] - 1];
+			if (other->hash == entries[i].hash
+			 && strcmp (strings + other->key, strings + entries[i].key) == 0)
+				break;
+		}
+		if (slots[s] == 0)
+			slots[s] = i + 1;
+	}
+
+	return data;
+}
+
+/* Check that the offsets in an image stay inside it. */
+static int
+validate (const char *data, unsigned int size)
+{
+	const TableImageHeader *header = (const TableImageHeader *) data;
+	const TableImageEntry *entries;
+	unsigned int strings_size, used, i;
+
+	if (size < sizeof (TableImageHeader)
+	 || memcmp (header->magic, TABLE_IMAGE_MAGIC, sizeof (TABLE_IMAGE_MAGIC)) != 0
+	 || header->version != TABLE_IMAGE_VERSION
+	 || header->size != size
+	 || header->slot_count == 0
+	 || (header->slot_count & (header->slot_count - 1)) != 0
+	 || header->count >= header->slot_count
+	 || header->entries != sizeof (TableImageHeader)
+	 || header->slots != header->entries + header->count * sizeof (TableImageEntry)
+	 || header->strings != header->slots + header->slot_count * sizeof (unsigned int)
+	 || header->strings > size
+	 || (size > header->strings && data[size - 1] != '\0'))
+		return 0;
+
+	/* The last string ends at the end of the image, so every
+	 * offset inside the strings points to a NUL-terminated one. */
+	entries = (const TableImageEntry *) (data + header->entries);
+	strings_size = size - header->strings;
+	for (i = 0; i < header->count; i++) {
+		if (entries[i].key >= strings_size || entries[i].value >= strings_size)
+			return 0;
+	}
+	/* At least one slot must be empty, or lookups wouldn't end. */
+	used = 0;
+	for (i = 0; i < header->slot_count; i++) {
+		const unsigned int *slots = (const unsigned int *) (data + header->slots);
+		if (slots[i] > header->count)
+			return 0;
+		if (slots[i] != 0)
+			used++;
+	}
+	return used < header->slot_count;
+}
+
+static TableImage *
+wrap (const char *data)
+{
+	TableImage *image;
+
+	image = malloc (sizeof (TableImage));
+	image->data = data;
+	image->header = (const TableImageHeader *) data;
+	image->entries = (const TableImageEntry *) (data + image->header->entries);
+	image->slots = (const unsigned int *) (data + image->header->slots);
+	image->strings = data + image->header->strings;
+	image->mapped = 0;
+	image->mapping = NULL;
+	return image;
+}
+
+
+TableImage *
+table_image_new_from_hash (StringHash *hash)
+{
+	unsigned int size;
+	char *data;
+
+	data = build (hash, &size);
+	if (data == NULL)
+		return NULL;
+	return wrap (data);
+}
+
+int
+table_image_write (StringHash *hash, const char *filename)
+{
+	unsigned int size;
+	char *data;
+	FILE *f;
+	int ret = 0;
+
+	data = build (hash, &size);
+	if (data == NULL)
+		return -1;
+
+	f = fopen (filename, "wb");
+	if (f == NULL) {
+		free (data);
+		return -1;
+	}
+	if (fwrite (data, 1, size, f) != size)
+		ret = -1;
+	if (fclose (f) != 0)
+		ret = -1;
+	free (data);
+	return ret;
+}
+
+#ifdef WIN32
+
+TableImage *
+table_image_open (const char *filename)
+{
+	HANDLE file, mapping;
+	DWORD size;
+	const char *data;
+	TableImage *image;
+
+	file = CreateFile (filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+	size = GetFileSize (file, NULL);
+	mapping = CreateFileMapping (file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle (file);
+	if (mapping == NULL)
+		return NULL;
+	data = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL || !validate (data, size)) {
+		if (data != NULL)
+			UnmapViewOfFile (data);
+		CloseHandle (mapping);
+		return NULL;
+	}
+
+	image = wrap (data);
+	image->mapped = 1;
+	image->mapping = mapping;
+	return image;
+}
+
+#else
+
+TableImage *
+table_image_open (const char *filename)
+{
+	struct stat buf;
+	const char *data;
+	TableImage *image;
+	int fd;
+
+	fd = open (filename, O_RDONLY);
+	if (fd == -1)
+		return NULL;
+	if (fstat (fd, &buf) == -1 || buf.st_size == 0) {
+		close (fd);
+		return NULL;
+	}
+	data = mmap (NULL, buf.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+	if (data == MAP_FAILED)
+		return NULL;
+	if (!validate (data, buf.st_size)) {
+		munmap ((void *) data, buf.st_size);
+		return NULL;
+	}
+
+	image = wrap (data);
+	image->mapped = 1;
+	return image;
+}
+
+#endif /* WIN32 */
+
+const char *
+table_image_get (TableImage *image, const char *key)
+{
+	unsigned int key_hash, mask, s;
+
+	key_hash = calc_hash (key);
+	mask = image->header->slot_count - 1;
+	for (s = key_hash & mask; image->slots[s] != 0; s = (s + 1) & mask) {
+		const TableImageEntry *entry = &image->entries[image->slots[s] - 1];
+		if (entry->hash == key_hash && strcmp (image->strings + entry->key, key) == 0)
+			return image->strings + entry->value;
+	}
+	return NULL;
+}
+
+const char *
+table_image_key (TableImage *image, unsigned int index)
+{
+	if (index >= image->header->count)
+		return NULL;
+	return image->strings + image->entries[index].key;
+}
+
+const char *
+table_image_value (TableImage *image, unsigned int index)
+{
+	if (index >= image->header->count)
+		return NULL;
+	return image->strings + image->entries[index].value;
+}
+
+void
+table_image_free (TableImage *image)
+{
+	if (!image->mapped)
+		free ((void *) image->data);
+#ifdef WIN32
+	else {
+		UnmapViewOfFile (image->data);
+		CloseHandle (image->mapping);
+	}
+#else
+	else
+		munmap ((void *) image->data, image->header->size);
+#endif
+	free (image);
+}
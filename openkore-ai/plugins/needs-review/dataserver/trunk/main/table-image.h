@@ -0,0 +1,98 @@
+/*  Kore Shared Data Server
+ *  Copyright (C) 2005  Hongli Lai <hongli AT navi DOT cx>
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _TABLE_IMAGE_H_
+#define _TABLE_IMAGE_H_
+
+#include "string-hash.h"
+
+/*****************************************************
+ * Immutable images of table files, which are either
+ * memory-mapped from a precompiled file, or built in
+ * memory from a parsed StringHash. Replies are served
+ * directly from the image.
+ *
+ * Layout (all numbers are 32-bit, in the byte order of
+ * the machine which compiled the image):
+ *
+ *   TableImageHeader
+ *   TableImageEntry entries[count]    - in insertion order
+ *   uint32 slots[slot_count]          - entry index + 1, or 0
+ *   char strings[]                    - NUL-terminated keys and values
+ *
+ * A key is looked up from slot (hash & (slot_count - 1)),
+ * and then slot by slot until the key or an empty slot is
+ * found. Like StringHash, the first value of a duplicated
+ * key is the one which is found.
+ *****************************************************/
+
+#define TABLE_IMAGE_MAGIC "KORETBL"
+#define TABLE_IMAGE_VERSION 1
+
+typedef struct {
+	char magic[8];
+	unsigned int version;
+	unsigned int count;
+	unsigned int slot_count;
+	unsigned int size;
+
+	/* Offsets from the start of the image. */
+	unsigned int entries;
+	unsigned int slots;
+	unsigned int strings;
+	unsigned int reserved;
+} TableImageHeader;
+
+typedef struct {
+	unsigned int hash;
+	/* Offsets from the start of the strings. */
+	unsigned int key;
+	unsigned int value;
+} TableImageEntry;
+
+typedef struct {
+	const char *data;
+	const TableImageHeader *header;
+	const TableImageEntry *entries;
+	const unsigned int *slots;
+	const char *strings;
+
+	/* How the data was obtained, so that it can be freed. */
+	int mapped;
+	void *mapping;
+} TableImage;
+
+
+/* Build an image in memory from a StringHash. The hash can be freed afterwards. */
+TableImage *table_image_new_from_hash (StringHash *hash);
+
+/* Write the image of a StringHash to a file. Returns 0 on success, -1 on error. */
+int         table_image_write (StringHash *hash, const char *filename);
+
+/* Map an image file. Returns NULL if the file cannot be opened or isn't a valid image. */
+TableImage *table_image_open  (const char *filename);
+
+const char *table_image_get   (TableImage *image, const char *key);
+
+/* Returns the key of the entry at index (in insertion order), or NULL past the last one. */
+const char *table_image_key   (TableImage *image, unsigned int index);
+const char *table_image_value (TableImage *image, unsigned int index);
+
+void        table_image_free  (TableImage *image);
+
+#endif /* _TABLE_IMAGE_H_ */
@@ -28,12 +28,20 @@
 #include <string.h>
 #include <fcntl.h>
 #include <errno.h>
+#ifdef __linux__
+	#include <sys/epoll.h>
+	#define USE_EPOLL
+#endif
 
 #include "unix-server.h"
 #include "client.h"
+#include "utils.h"
 
 
 #define LOCKFILE "/tmp/kore-dataserver.lock"
+/* How often the main loop checks whether the server should stop, in miliseconds. */
+#define POLL_TIMEOUT 500
+#define MAX_EVENTS 64
 
 
 /* Create a lockfile so you can't run two servers at the same time.
@@ -81,7 +89,8 @@ unix_server_trylock ()
 
 
 UnixServer *
-unix_server_new (char *filename, NewClientCallback callback)
+unix_server_new (char *filename, NewClientCallback callback,
+		 ClientEventCallback event_callback, ClientClosedCallback closed_callback)
 {
 	int fd;
 	struct sockaddr_un addr;
@@ -102,69 +111,214 @@ unix_server_new (char *filename, NewClientCallback callback)
 		return NULL;
 	}
 
-	/* Setup listen queue. */
-	if (listen (fd, 5) == -1) {
+	/* Setup listen queue. Hundreds of bots may connect at once. */
+	if (listen (fd, SOMAXCONN) == -1) {
 		perror ("dataserver: cannot setup server socket for listening");
 		close (fd);
 		return NULL;
 	}
+	fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
 
 	/* Ready to rock. */
 	server = malloc (sizeof (UnixServer));
 	server->fd = fd;
 	server->callback = callback;
+	server->event_callback = event_callback;
+	server->closed_callback = closed_callback;
+	server->tick_callback = NULL;
 	server->filename = filename;
 	server->stop = 0;
 	server->retval = 0;
+	server->clients = llist_new (sizeof (Client));
+	server->epoll_fd = -1;
+
+#ifdef USE_EPOLL
+	server->epoll_fd = epoll_create (MAX_EVENTS);
+	if (server->epoll_fd == -1) {
+		perror ("dataserver: cannot create epoll instance");
+		close (fd);
+		llist_free (server->clients);
+		free (server);
+		return NULL;
+	} else {
+		struct epoll_event event;
+
+		memset (&event, 0, sizeof (event));
+		event.events = EPOLLIN;
+		event.data.ptr = NULL;
+		epoll_ctl (server->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+	}
+#endif
 	return server;
 }
 
 
-void
-unix_server_main_loop (UnixServer *server)
+/* Wait for the events the client needs next.
+ * Returns: 0 on error, 1 on success. */
+static int
+update_events (UnixServer *server, Client *client)
 {
-	while (!server->stop) {
-		struct pollfd ufds;
-		struct sockaddr_un addr;
-		socklen_t addr_len;
-		int fd, tmp;
-		Client *client;
+	int events;
 
-		/* Check whether there are incoming connections. */
-		ufds.fd = server->fd;
-		ufds.events = POLLIN;
-		tmp = poll (&ufds, 1, 500);
-		if (tmp == -1) {
-			/* Error. But it's OK if the system call was interrupted
-			 * (by Ctrl-C or whatever). */
-			if (errno != EINTR) {
-				perror ("dataserver: Cannot poll server socket");
-				server->retval = 1;
-			}
-			return;
+	events = 0;
+	if (client_wants_read (client))
+		events |= POLLIN;
+	if (client_wants_write (client))
+		events |= POLLOUT;
+	if (events == client->events)
+		return 1;
 
-		} else if (tmp == 0)
-			/* No incoming connections. */
-			continue;
+#ifdef USE_EPOLL
+	{
+		struct epoll_event event;
 
+		memset (&event, 0, sizeof (event));
+		event.events = ((events & POLLIN) ? EPOLLIN : 0) | ((events & POLLOUT) ? EPOLLOUT : 0);
+		event.data.ptr = client;
+		if (epoll_ctl (server->epoll_fd, (client->events == -1) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD,
+			       client->fd, &event) == -1)
+			return 0;
+	}
+#endif
+	client->events = events;
+	return 1;
+}
+
+static void
+remove_client (UnixServer *server, Client *client)
+{
+	DEBUG ("Client %p: removing client\n", client);
+	server->closed_callback (client);
+	llist_remove_existing (server->clients, (LListItem *) client);
+	/* Closing the socket also removes it from the epoll instance. */
+	client_free (client);
+}
+
+/* Accept all pending connections.
+ * Returns: 0 on error, 1 on success. */
+static int
+accept_clients (UnixServer *server)
+{
+	while (1) {
+		struct sockaddr_un addr;
+		socklen_t addr_len;
+		int fd;
+		Client *client;
 
-		/* Accept incoming connection. */
 		addr_len = sizeof (addr);
-		do {
-			fd = accept (server->fd, (struct sockaddr *) &addr, &addr_len);
-		} while (fd == -1 && errno == EINTR);
+		fd = accept (server->fd, (struct sockaddr *) &addr, &addr_len);
 		if (fd == -1) {
-			/* Accept failed but the error is not EINTR. */
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED)
+				return 1;
+			if (errno == EMFILE || errno == ENFILE) {
+				/* Out of file descriptors; let the connection wait. */
+				error ("dataserver: Cannot accept connection: %s\n", strerror (errno));
+				return 1;
+			}
 			perror ("dataserver: Cannot accept connection");
-			server->retval = 1;
-			return;
+			return 0;
 		}
 
 		/* Create a Client structure and pass it to the callback. */
 		client = malloc (sizeof (Client));
 		client->fd = fd;
 		client_init (client);
+		client->events = -1;
+		llist_append_existing (server->clients, client);
 		server->callback (client);
+		if (!update_events (server, client))
+			remove_client (server, client);
+	}
+}
+
+static void
+handle_client (UnixServer *server, Client *client)
+{
+	if (!server->event_callback (client) || !update_events (server, client))
+		remove_client (server, client);
+}
+
+
+void
+unix_server_main_loop (UnixServer *server)
+{
+	while (!server->stop) {
+		int i, n;
+
+		if (server->tick_callback != NULL)
+			server->tick_callback ();
+
+#ifdef USE_EPOLL
+		struct epoll_event events[MAX_EVENTS];
+
+		n = epoll_wait (server->epoll_fd, events, MAX_EVENTS, POLL_TIMEOUT);
+#else
+		struct pollfd *ufds;
+		Client **clients;
+		Client *client;
+		int count;
+
+		/* Wait for the listening socket and every client. */
+		ufds = malloc ((server->clients->len + 1) * sizeof (struct pollfd));
+		clients = malloc ((server->clients->len + 1) * sizeof (Client *));
+		ufds[0].fd = server->fd;
+		ufds[0].events = POLLIN;
+		ufds[0].revents = 0;
+		i = 1;
+		foreach_llist (server->clients, Client *, client) {
+			ufds[i].fd = client->fd;
+			ufds[i].events = client->events;
+			ufds[i].revents = 0;
+			clients[i] = client;
+			i++;
+		}
+		count = i;
+		n = poll (ufds, count, POLL_TIMEOUT);
+#endif
+		if (n == -1) {
+			/* Error. But it's OK if the system call was interrupted
+			 * by a signal: SIGHUP reloads the tables, and the others
+			 * set server->stop. */
+			int interrupted = errno == EINTR;
+
+			if (!interrupted) {
+				perror ("dataserver: Cannot poll sockets");
+				server->retval = 1;
+			}
+#ifndef USE_EPOLL
+			free (ufds);
+			free (clients);
+#endif
+			if (interrupted)
+				continue;
+			return;
+		}
+
+#ifdef USE_EPOLL
+		for (i = 0; i < n; i++) {
+			if (events[i].data.ptr == NULL) {
+				if (!accept_clients (server)) {
+					server->retval = 1;
+					return;
+				}
+			} else
+				handle_client (server, (Client *) events[i].data.ptr);
+		}
+#else
+		for (i = 1; i < count; i++) {
+			if (ufds[i].revents != 0)
+				handle_client (server, clients[i]);
+		}
+		i = ufds[0].revents != 0;
+		free (ufds);
+		free (clients);
+		if (i && !accept_clients (server)) {
+			server->retval = 1;
+			return;
+		}
+#endif
 	}
 }
 
@@ -175,6 +329,11 @@ unix_server_free (UnixServer *server)
 	int retval;
 
 	retval = server->retval;
+	while (server->clients->first != NULL)
+		remove_client (server, (Client *) server->clients->first);
+	llist_free (server->clients);
+	if (server->epoll_fd != -1)
+		close (server->epoll_fd);
 	close (server->fd);
 	remove (server->filename);
 	free (server->filename);
@@ -26,15 +26,27 @@
 typedef struct {
 	int fd;
 	NewClientCallback callback;
+	ClientEventCallback event_callback;
+	ClientClosedCallback closed_callback;
+	/* Called at every loop iteration, between events; may be NULL. */
+	void (*tick_callback) (void);
 	char *filename;
 	int stop;
 	int retval;
+
+	/* The connected clients. */
+	LList *clients;
+	/* The epoll instance, on Linux. */
+	int epoll_fd;
 } UnixServer;
 
 
 int unix_server_trylock ();
 
-UnixServer *unix_server_new (char *filename, NewClientCallback callback);
+/* Create a server on a Unix socket. Its main loop waits for events on
+ * every client at once, with epoll on Linux and poll() elsewhere. */
+UnixServer *unix_server_new (char *filename, NewClientCallback callback,
+			     ClientEventCallback event_callback, ClientClosedCallback closed_callback);
 void unix_server_main_loop (UnixServer *server);
 int  unix_server_free (UnixServer *server);
 
@@ -16,8 +16,12 @@
  *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+/* Winsock's select() takes at most FD_SETSIZE sockets, 64 by default. */
+#define FD_SETSIZE 1024
+
 #include "win-server.h"
 #include "client.h"
+#include "utils.h"
 
 
 /* Create a lockfile so you can't run two servers at the same time.
@@ -45,7 +49,8 @@ win_server_trylock ()
 
 
 WinServer *
-win_server_new (int port, NewClientCallback callback)
+win_server_new (int port, NewClientCallback callback,
+		ClientEventCallback event_callback, ClientClosedCallback closed_callback)
 {
 	SOCKET sock;
 	WSADATA data;
@@ -71,7 +76,7 @@ win_server_new (int port, NewClientCallback callback)
 	}
 
 	/* Setup listen queue. */
-	if (listen (sock, 5) == SOCKET_ERROR) {
+	if (listen (sock, SOMAXCONN) == SOCKET_ERROR) {
 		closesocket (sock);
 		return NULL;
 	}
@@ -80,38 +85,72 @@ win_server_new (int port, NewClientCallback callback)
 	server = malloc (sizeof (WinServer));
 	server->sock = sock;
 	server->callback = callback;
+	server->event_callback = event_callback;
+	server->closed_callback = closed_callback;
+	server->tick_callback = NULL;
 	server->stop = 0;
+	server->clients = llist_new (sizeof (Client));
 	return server;
 }
 
 
+static void
+remove_client (WinServer *server, Client *client)
+{
+	DEBUG ("Client %p: removing client\n", client);
+	server->closed_callback (client);
+	llist_remove_existing (server->clients, (LListItem *) client);
+	client_free (client);
+}
+
+
 void
 win_server_main_loop (WinServer *server)
 {
 	while (!server->stop) {
-		fd_set readfds;
+		fd_set readfds, writefds;
 		int ret;
-		Client *client;
+		Client *client, *next;
 		struct timeval tv;
 		struct sockaddr_in addr;
 		int addr_len;
 		SOCKET sock;
 
-		/* Check whether there are incoming connections. */
+		if (server->tick_callback != NULL)
+			server->tick_callback ();
+
+		/* Wait for incoming connections, and for every client. */
 		tv.tv_sec = 0;
 		tv.tv_usec = 50000;
 		FD_ZERO (&readfds);
-		FD_SET (server->sock, &readfds);
-		ret = select (0, &readfds, NULL, NULL, &tv);
+		FD_ZERO (&writefds);
+		if (server->clients->len < FD_SETSIZE - 1)
+			FD_SET (server->sock, &readfds);
+		foreach_llist (server->clients, Client *, client) {
+			if (client_wants_read (client))
+				FD_SET (client->fd, &readfds);
+			if (client_wants_write (client))
+				FD_SET (client->fd, &writefds);
+		}
+		ret = select (0, &readfds, &writefds, NULL, &tv);
 		
 		if (ret == SOCKET_ERROR) {
 			/* Error. */
 			return;
 
 		} else if (ret == 0)
-			/* No incoming connections. */
+			/* Nothing happened. */
 			continue;
 
+		for (client = (Client *) server->clients->first; client != NULL; client = next) {
+			next = (Client *) client->parent.next;
+			if ((FD_ISSET (client->fd, &readfds) || FD_ISSET (client->fd, &writefds))
+			 && !server->event_callback (client))
+				remove_client (server, client);
+		}
+
+		if (!FD_ISSET (server->sock, &readfds))
+			continue;
 
 		/* Accept incoming connection. */
 		addr_len = sizeof (addr);
@@ -125,6 +164,7 @@ win_server_main_loop (WinServer *server)
 		client = malloc (sizeof (Client));
 		client->fd = sock;
 		client_init (client);
+		llist_append_existing (server->clients, client);
 		server->callback (client);
 	}
 }
@@ -133,6 +173,9 @@ win_server_main_loop (WinServer *server)
 int
 win_server_free (WinServer *server)
 {
+	while (server->clients->first != NULL)
+		remove_client (server, (Client *) server->clients->first);
+	llist_free (server->clients);
 	closesocket (server->sock);
 	free (server);
 	WSACleanup ();
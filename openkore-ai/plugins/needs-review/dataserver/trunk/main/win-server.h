@@ -26,13 +26,23 @@
 typedef struct {
 	SOCKET sock;
 	NewClientCallback callback;
+	ClientEventCallback event_callback;
+	ClientClosedCallback closed_callback;
+	/* Called at every loop iteration, between events; may be NULL. */
+	void (*tick_callback) (void);
 	int stop;
+
+	/* The connected clients. */
+	LList *clients;
 } WinServer;
 
 
 int win_server_trylock ();
 
-WinServer *win_server_new (int port, NewClientCallback callback);
+/* Create a server on a local TCP port. Its main loop waits for events
+ * on every client at once, with select(). */
+WinServer *win_server_new (int port, NewClientCallback callback,
+			   ClientEventCallback event_callback, ClientClosedCallback closed_callback);
 void win_server_main_loop (WinServer *server);
 int  win_server_free (WinServer *server);
 
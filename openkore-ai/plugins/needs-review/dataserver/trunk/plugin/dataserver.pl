@@ -62,26 +62,104 @@ sub start {
 	}
 }
 
+# Replies which have been received but not read yet.
+our $recvBuf = '';
+
+sub request {
+	my ($major, $minor, $data) = @_;
+	return chr($major) . chr($minor) . pack("n", length($data)) . $data;
+}
+
+# Make sure that at least $len bytes of reply data are buffered.
+sub need {
+	my ($len) = @_;
+	while (length($recvBuf) < $len) {
+		my $tmp;
+		recv($sock, $tmp, 16 * 1024, 0);
+		return 0 if (!defined $tmp || $tmp eq '');
+		$recvBuf .= $tmp;
+	}
+	return 1;
+}
+
+# Read one reply. Returns undef on error.
+sub readReply {
+	return undef if (!need(1));
+
+	# Status: error
+	if (substr($recvBuf, 0, 1) eq "\0") {
+		substr($recvBuf, 0, 1, '');
+		return undef;
+	}
+
+	# Status: success
+	return undef if (!need(3));
+	my $len = unpack("n", substr($recvBuf, 1, 2));
+	return undef if (!need($len + 3));
+	my $result = substr($recvBuf, 3, $len);
+	substr($recvBuf, 0, $len + 3, '');
+	return $result;
+}
+
+# Read a reply which frames many replies. Returns a list of replies.
+sub readBatchReply {
+	return () if (!need(3) || substr($recvBuf, 0, 1) eq "\0");
+	my $count = unpack("n", substr($recvBuf, 1, 2));
+	substr($recvBuf, 0, 3, '');
+	return map { readReply() } 1..$count;
+}
+
 sub fetch {
 	my ($major, $minor, $name) = @_;
-	my $buf = '';
+	send($sock, request($major, $minor, $name), 0);
+	return readReply();
+}
 
-	send($sock, chr($major) . chr($minor) . pack("n", length($name)) . $name, 0);
-	while (1) {
-		my ($tmp, $len);
+##
+# pipeline(requests...)
+# requests: array references of the form [major, minor, data].
+# Returns: the replies, in the same order.
+#
+# Send many simple requests at once, and read all the replies afterwards.
+sub pipeline {
+	my @requests = @_;
+	send($sock, join('', map { request(@{$_}) } @requests), 0);
+	return map { readReply() } @requests;
+}
 
-		recv($sock, $tmp, 2 * 1024, 0);
-		return undef if (!defined $tmp || $tmp eq '');
-		$buf .= $tmp;
+##
+# fetchMany(fileIndex, keys...)
+# Returns: the values of the keys, in the same order. Missing keys are undef.
+#
+# Look up many keys with one request per 64 KB of keys.
+sub fetchMany {
+	my ($fileIndex, @keys) = @_;
+	my (@batches, $data);
+
+	$data = '';
+	foreach my $key (@keys) {
+		if (length($data) + length($key) + 1 > 65535) {
+			push @batches, $data;
+			$data = '';
+		}
+		$data .= "$key\0";
+	}
+	push @batches, $data if ($data ne '');
 
-		# Status: error
-		return undef if (substr($buf, 0, 1) eq "\0");
+	send($sock, join('', map { request(2, $fileIndex, $_) } @batches), 0);
+	return map { readBatchReply() } @batches;
+}
 
-		# Status: success
-		$len = unpack("n", substr($buf, 1, 2));
-		next if (length($buf) < $len + 3);
-		return substr($buf, 3, $len);
-	}
+##
+# fetchRange(fileIndex, start, count)
+# Returns: a list of (key, value) pairs.
+#
+# Retrieve the entries of a table file, in file order. The server sends
+# at most 1024 entries per request, so fewer may be returned.
+sub fetchRange {
+	my ($fileIndex, $start, $count) = @_;
+	send($sock, request(3, $fileIndex, pack("Nn", $start, $count)), 0);
+	return readBatchReply();
 }
 
 sub parseRoOrDescLUT {
@@ -146,14 +224,25 @@ sub EXISTS {
 	return defined($self->FETCH($key));
 }
 
+# Keys are fetched in ranges, so that iterating over a table
+# doesn't take one round trip per key.
 sub FIRSTKEY {
 	my ($self) = @_;
-	return SharedMemoryPlugin::fetch(1, $self->{fileIndex}, '');
+	$self->{keys} = [];
+	$self->{next} = 0;
+	return $self->NEXTKEY();
 }
 
 sub NEXTKEY {
 	my ($self) = @_;
-	return SharedMemoryPlugin::fetch(1, 127 + $self->{fileIndex}, '');
+	if (!@{$self->{keys}}) {
+		my @entries = SharedMemoryPlugin::fetchRange($self->{fileIndex}, $self->{next}, 1024);
+		for (my $i = 0; $i < @entries; $i += 2) {
+			push @{$self->{keys}}, $entries[$i];
+		}
+		$self->{next} += @entries / 2;
+	}
+	return shift @{$self->{keys}};
 }
 
 sub SCALAR {
@@ -799,12 +799,24 @@ sub main {
 			ai_setSuspend(0);
 			my $skill = new Skill(auto => $config{"attackSkillSlot_$slot"});
 			my $skill_lvl = $config{"attackSkillSlot_${slot}_lvl"} || $char->getSkillLevel($skill);
+			my $skill_target = $config{"attackSkillSlot_${slot}_isSelfSkill"} ? $char : $target;
+
+			# Center ground skills where their area hits the most monsters, the target still being one of them
+			my $radius = judgeSkillArea($skill->getIDN);
+			if ($config{"attackSkillSlot_${slot}_areaPlacement"} && $radius && $skill->getTargetType == Skill::TARGET_LOCATION) {
+				my ($center, $hits) = $field->bestAreaCenter($realMyPos, int($skill->getRange), $realMonsterPos, $radius, $radius, $monstersList->getItems);
+				if ($center) {
+					debug "[attackSkillSlot] Area of ".qq~$config{"attackSkillSlot_$slot"}~." centered on ($center->{x}, $center->{y}), hitting $hits monsters\n", "ai_attack";
+					$skill_target = { pos_to => $center };
+				}
+			}
+
 			ai_skillUse2(
 				$skill,
 				$skill_lvl,
 				$config{"attackSkillSlot_${slot}_maxCastTime"},
 				$config{"attackSkillSlot_${slot}_minCastTime"},
-				$config{"attackSkillSlot_${slot}_isSelfSkill"} ? $char : $target,
+				$skill_target,
 				"attackSkillSlot_${slot}",
 				undef,
 				"attackSkill",
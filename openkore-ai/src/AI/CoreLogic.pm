@@ -25,7 +25,7 @@ use Text::ParseWords;
 use utf8;
 
 use Globals;
-use Log qw(message warning error debug);
+use Log qw(message warning error debug debugf);
 use Misc;
 use Network::Send ();
 use Settings;
@@ -42,13 +42,24 @@ use Task::TalkNPC;
 use Task::UseSkill;
 use Task::ErrorReport;
 use Utils::Exceptions;
+use Utils::TimerWheel;
+
+# The checks of the AI which only rearm themselves are polled through a timer wheel, so they
+# don't call timeOut() on every iteration; their timeout is the one in %timeout unless given
+# here. Their entries in %timeout are still kept up to date, and are what they're set from.
+our %timed = (ai_wipe_check => undef, ai_getInfo => undef, avoidDistantActors => 1);
+our $timers;
+# The timed checks which are due during this iteration
+our %due;
 
 # This is the main function from which the rest of the AI
 # will be invoked.
 sub iterate {
 	Benchmark::begin("ai_prepare") if DEBUG;
+	processTimers();
 	processWipeOldActors();
 	processActorAvoid();
+	processDangerMap();
 	processGetPlayerInfo();
 	processMisc();
 	processReAddMissingPortals();
@@ -222,9 +233,38 @@ sub iterate {
 #############################################################
 
 
+sub timedTimeout {
+	my ($name) = @_;
+	return defined $timed{$name} ? $timed{$name} : $timeout{$name}{timeout};
+}
+
+# Finds the timed checks which are due, reading the clock once.
+sub processTimers {
+	if (!$timers) {
+		$timers = new Utils::TimerWheel();
+		$timers->set($_, 0) for (keys %timed);
+	}
+	%due = ();
+	foreach my $name ($timers->expired) {
+		# The entry may have been pushed back since the timer was set
+		if (timeOut($timeout{$name}{time}, timedTimeout($name))) {
+			$due{$name} = 1;
+		} else {
+			$timers->set($name, timedTimeout($name), $timeout{$name}{time});
+		}
+	}
+}
+
+# Makes a timed check due again after its timeout.
+sub rearm {
+	my ($name) = @_;
+	$timeout{$name}{time} = $timers->now;
+	$timers->set($name, timedTimeout($name));
+}
+
 # Wipe old entries in the %actor_old hashes.
 sub processWipeOldActors {
-	if (timeOut($timeout{ai_wipe_check})) {
+	if ($due{ai_wipe_check}) {
 		my $timeout = $timeout{ai_wipe_old}{timeout};
 
 		foreach (keys %players_old) {
@@ -261,18 +301,44 @@ sub processWipeOldActors {
 		#	}
 		#}
 
-		$timeout{'ai_wipe_check'}{'time'} = time;
+		rearm('ai_wipe_check');
 		debug "Wiped old\n", "ai", 2;
 	}
 }
 
+# Keeps the danger layer of the field in sync with the aggressive monsters, only the ones which moved,
+# became aggressive or calmed down since the last iteration are stamped again. Monsters which leave the
+# list take their danger with them in Misc::actorRemoved().
+sub processDangerMap {
+	return unless ($field);
+	if (!$config{route_avoidDanger}) {
+		delete $field->{dangerMap};
+		return;
+	}
+	my $danger = $field->dangerMap;
+	my $radius = defined $config{route_avoidDangerRadius} ? $config{route_avoidDangerRadius} : 3;
+	my $weight = $config{route_avoidDanger};
+
+	for my $monster (@$monstersList) {
+		my $stamp = $monster->{dangerStamp};
+		my $pos = $monster->{pos_to};
+		if (!$pos || $monster->{dead} || !is_aggressive($monster, mon_control($monster->{name}, $monster->{nameID}), 1, 0)) {
+			Field::unstampDanger($monster) if ($stamp);
+			next;
+		}
+		next if ($stamp && $stamp->[0] == $danger && $stamp->[1] == $pos->{x} && $stamp->[2] == $pos->{y}
+			&& $stamp->[3] == $radius && $stamp->[4] == $weight);
+		$field->stampDanger($monster, $radius, $weight);
+	}
+}
+
 sub processActorAvoid {
-	my $realMyPos = calcPosFromPathfinding($field, $char);
-	my $max_dist = $config{clientSight} + 1;
-	my $max_to_delete = $max_dist*2;
+	if ($due{avoidDistantActors}) {
+		my $realMyPos = calcPosFromPathfinding($field, $char);
+		my $max_dist = $config{clientSight} + 1;
+		my $max_to_delete = $max_dist*2;
 
-	if (timeOut($timeout{'avoidDistantActors'}{'time'}, 1)) {
-		$timeout{'avoidDistantActors'}{'time'} = time;
+		rearm('avoidDistantActors');
 		foreach my $list ($playersList, $monstersList, $npcsList, $petsList, $portalsList, $slavesList, $elementalsList) {
 			for my $actor (@$list) {
 				my $realActorPos = calcPosition($actor);
@@ -301,7 +367,7 @@ sub processActorAvoid {
 }
 
 sub processGetPlayerInfo {
-	if (timeOut($timeout{ai_getInfo})) {
+	if ($due{ai_getInfo}) {
 		processNameRequestQueue(\@unknownPlayers, [$playersList, $slavesList]);
 		processNameRequestQueue(\@unknownNPCs, [$npcsList]);
 
@@ -323,7 +389,7 @@ sub processGetPlayerInfo {
 				last;
 			}
 		}
-		$timeout{ai_getInfo}{time} = time;
+		rearm('ai_getInfo');
 	}
 }
 
@@ -853,7 +919,7 @@ sub processTake {
 	} elsif (AI::action eq "take") {
 		my $myPos = $char->{pos};
 		my $dist = blockDistance($item->{pos}, $myPos);
-		debug "Planning to take $item->{name} ($item->{binID}), distance $dist\n", "drop";
+		debugf("drop", undef, "Planning to take %s (%s), distance %s\n", $item->{name}, $item->{binID}, $dist);
 
 		if ($char->{sitting}) {
 			stand();
@@ -1586,7 +1652,7 @@ sub processAutoStorage {
 
 					my $control = items_control($item->{name}, $item->{nameID});
 
-					debug "AUTOSTORAGE: $item->{name} x $item->{amount} - store = $control->{storage}, keep = $control->{keep}\n", "storage";
+					debugf("storage", undef, "AUTOSTORAGE: %s x %s - store = %s, keep = %s\n", $item->{name}, $item->{amount}, $control->{storage}, $control->{keep});
 					if ($control->{storage} && $item->{amount} > $control->{keep}) {
 						if ($args->{lastIndex} eq $item->{ID} &&
 						    timeOut($timeout{'ai_storageAuto_giveup'})) {
@@ -1616,7 +1682,7 @@ sub processAutoStorage {
 
 					my $control = items_control($item->{name}, $item->{nameID});
 
-					debug "AUTOSTORAGE (cart): $item->{name} x $item->{amount} - store = $control->{storage}, keep = $control->{keep}\n", "storage";
+					debugf("storage", undef, "AUTOSTORAGE (cart): %s x %s - store = %s, keep = %s\n", $item->{name}, $item->{amount}, $control->{storage}, $control->{keep});
 					# store from cart as well as inventory if the flag is equal to 2
 					if ($control->{storage} == 2 && $item->{amount} > $control->{keep}) {
 						if ($args->{cartLastIndex} eq $item->{ID} &&
@@ -2318,7 +2384,7 @@ sub processAutoCart {
 						$obj{index} = $invItem->{binID};
 						$obj{amount} = $invItem->{amount} - $control->{keep};
 						push @addItems, \%obj;
-						debug "Scheduling $invItem->{name} ($invItem->{binID}) x $obj{amount} for adding to cart\n", "ai_autoCart";
+						debugf("ai_autoCart", undef, "Scheduling %s (%s) x %s for adding to cart\n", $invItem->{name}, $invItem->{binID}, $obj{amount});
 					}
 				}
 				cartAdd(\@addItems);
@@ -2343,7 +2409,7 @@ sub processAutoCart {
 					$obj{index} = $cartItem->{binID};
 					$obj{amount} = $amount;
 					push @getItems, \%obj;
-					debug "Scheduling $cartItem->{name} ($cartItem->{ID}) x $obj{amount} for getting from cart\n", "ai_autoCart";
+					debugf("ai_autoCart", undef, "Scheduling %s (%s) x %s for getting from cart\n", $cartItem->{name}, $cartItem->{ID}, $obj{amount});
 				}
 			}
 			cartGet(\@getItems);
@@ -2477,7 +2543,7 @@ sub processMoveNearSlave {
 sub processRandomWalk {
 	if (AI::isIdle && (AI::SlaveManager::isIdle()) && $config{route_randomWalk} && !$ai_v{sitAuto_forcedBySitCommand}
 		&& (!$field->isCity || $config{route_randomWalk_inTown})
-		&& length($field->{rawMap})
+		&& (length($field->{rawMap}) || $field->{rawChunks})
 		){
 		if ($char->{pos}{x} == $config{'lockMap_x'} && !($config{'lockMap_randX'} > 0) && ($char->{pos}{y} == $config{'lockMap_y'} && !($config{'lockMap_randY'} >0))) {
 			error T("Coordinate lockmap is used; randomWalk disabled\n");
@@ -2490,20 +2556,22 @@ sub processRandomWalk {
 		Plugins::callHook('ai_processRandomWalk' => \%plugin_args);
 		return if ($plugin_args{return});
 
-		my ($randX, $randY);
-		my $i = 500;
-		do {
-			$randX = int(rand($field->width-1)+1);
-			$randX = $config{'lockMap_x'} if ($char->{pos}{x} == $config{'lockMap_x'} && !($config{'lockMap_randX'} > 0));
-			$randX = $config{'lockMap_x'} - $config{'lockMap_randX'} + int(rand(2*$config{'lockMap_randX'}+1)) if ($config{'lockMap_x'} ne '' && $config{'lockMap_randX'} >= 0);
-			$randY = int(rand($field->height-1)+1);
-			$randY = $config{'lockMap_y'} if ($char->{pos}{y} == $config{'lockMap_y'} && !($config{'lockMap_randY'} > 0));
-			$randY = $config{'lockMap_y'} - $config{'lockMap_randY'} + int(rand(2*$config{'lockMap_randY'}+1)) if ($config{'lockMap_y'} ne '' && $config{'lockMap_randY'} >= 0);
-		} while (--$i && (!$field->isWalkable($randX, $randY) || $randX == 0 || $randY == 0));
-		if (!$i) {
+		# The area to walk in, the whole map or the lockMap rectangle
+		my ($min_x, $max_x) = (1, $field->width - 1);
+		($min_x, $max_x) = ($config{'lockMap_x'}) x 2 if ($char->{pos}{x} == $config{'lockMap_x'} && !($config{'lockMap_randX'} > 0));
+		($min_x, $max_x) = ($config{'lockMap_x'} - $config{'lockMap_randX'}, $config{'lockMap_x'} + $config{'lockMap_randX'}) if ($config{'lockMap_x'} ne '' && $config{'lockMap_randX'} >= 0);
+		my ($min_y, $max_y) = (1, $field->height - 1);
+		($min_y, $max_y) = ($config{'lockMap_y'}) x 2 if ($char->{pos}{y} == $config{'lockMap_y'} && !($config{'lockMap_randY'} > 0));
+		($min_y, $max_y) = ($config{'lockMap_y'} - $config{'lockMap_randY'}, $config{'lockMap_y'} + $config{'lockMap_randY'}) if ($config{'lockMap_y'} ne '' && $config{'lockMap_randY'} >= 0);
+		$min_x = 1 if ($min_x < 1);
+		$min_y = 1 if ($min_y < 1);
+
+		my ($cell) = $field->sampleWalkableArea($min_x, $max_x, $min_y, $max_y, 1);
+		if (!$cell) {
 			error T("Invalid coordinates specified for randomWalk (coordinates are unwalkable); randomWalk disabled\n");
 			$config{'route_randomWalk'} = 0;
 		} else {
+			my ($randX, $randY) = @{$cell}{qw(x y)};
 			message TF("Calculating random route to: %s: %s, %s\n", $field->descString(), $randX, $randY), "route";
 			ai_route(
 				$field->baseName,
@@ -3457,6 +3525,8 @@ sub processItemsAutoGather {
 		my $myPos = calcPosition($char);
 		my $minPlayerDist = $config{itemsGatherAutoMinPlayerDistance} || 6;
 		my $minPortalDist = $config{itemsGatherAutoMinPortalDistance} || 5;
+		my $playerPositions = nearPlayerPositions();
+		my $portalPositions = $portalsList->packedPositions('pos');
 
 		foreach (@itemsID) {
 			next unless $_;
@@ -3465,8 +3535,8 @@ sub processItemsAutoGather {
 				|| $item->{take_failed} >= 1
 				|| pickupitems($item->{name}, $item->{nameID}) eq "0"
 				|| pickupitems($item->{name}, $item->{nameID}) == -1 );
-			if (!positionNearPlayer($item->{pos}, $minPlayerDist) &&
-			    !positionNearPortal($item->{pos}, $minPortalDist)) {
+			if (!positionNearPlayer($item->{pos}, $minPlayerDist, $playerPositions) &&
+			    !positionNearPortal($item->{pos}, $minPortalDist, $portalPositions)) {
 				my $pos = calcPosition($item);
 				my $dist = adjustedBlockDistance($myPos, $pos);
 				if (!defined($bestItem)) {
@@ -29,6 +29,7 @@ use strict;
 use Carp::Assert;
 use Utils::Assert;
 use Utils::ObjectList;
+use Utils::PathFinding;
 use base qw(ObjectList);
 
 use Actor;
@@ -137,6 +138,41 @@ sub getByName {
 	return undef;
 }
 
+##
+# String ActorList::packPositions(Array<Actor>* actors, [String key = 'pos_to'])
+# Returns: the x and y coordinates of $actor->{$key} of every actor, as native 16 bit integers packed with pack("s*").
+#
+# Actors without a position get one far away from every cell of a field.
+# The result is what PathFinding::positionsInRange() takes.
+sub packPositions {
+	my ($actors, $key) = @_;
+	$key = 'pos_to' unless (defined $key);
+	return pack('s*', map { defined $_->{$key}{x} ? ($_->{$key}{x}, $_->{$key}{y}) : (-32768, -32768) } @{$actors});
+}
+
+##
+# String $ActorList->packedPositions([String key = 'pos_to'])
+# Returns: the positions of the actors in the order of $ActorList->getItems(), see ActorList::packPositions().
+sub packedPositions {
+	my ($self, $key) = @_;
+	return packPositions($self->getItems(), $key);
+}
+
+##
+# Array<Actor> $ActorList->inRange(Hash* pos, [int dist], [String key = 'pos_to'])
+# pos: a hash with x and y values.
+# dist: the maximum block distance of the actors, all actors are returned if undefined.
+# Returns: the actors whose $actor->{$key} is within $dist blocks of $pos, nearest first.
+#
+# The positions of all actors are compared and sorted in one native call (see PathFinding::positionsInRange()),
+# which is much faster than calling blockDistance() for each actor in crowded places.
+sub inRange {
+	my ($self, $pos, $dist, $key) = @_;
+	my $items = $self->getItems();
+	return () unless (@{$items});
+	return @{$items}[PathFinding::positionsInRange($self->packedPositions($key), $pos->{x}, $pos->{y}, defined $dist ? $dist : -1)];
+}
+
 ##
 # boolean $ActorList->remove(Actor actor)
 # Requires: defined($actor) && defined($actor->{ID})
@@ -7,21 +7,31 @@ use Bus::Messages qw(unserialize);
 
 sub new {
 	my ($class) = @_;
-	my %self = (buffer => '');
+	# Messages are read at an offset in the buffer, and the data read is only removed
+	# when more is added, instead of after every message
+	my %self = (buffer => '', offset => 0);
 	return bless \%self, $class;
 }
 
 sub add {
 	my $self = $_[0];
+	if ($self->{offset}) {
+		substr($self->{buffer}, 0, $self->{offset}, '');
+		$self->{offset} = 0;
+	}
 	$self->{buffer} .= $_[1];
 }
 
 sub readNext {
 	my ($self, $ID) = @_;
 	my $processed;
-	my $args = unserialize($self->{buffer}, $ID, \$processed);
+	my $args = unserialize($self->{buffer}, $ID, \$processed, $self->{offset});
 	if ($args) {
-		substr($self->{buffer}, 0, $processed, '');
+		$self->{offset} += $processed;
+		if ($self->{offset} >= length($self->{buffer})) {
+			$self->{buffer} = '';
+			$self->{offset} = 0;
+		}
 	}
 	return $args;
 }
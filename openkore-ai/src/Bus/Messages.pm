@@ -80,6 +80,11 @@
 #     uint24 length;
 #     char   value[length];
 # } ArrayEntry;</pre>
+#
+# <h3>Native codec</h3>
+# When the XSTools library can be loaded, serialize() and unserialize() are done by
+# Bus::Messages::Native in one call each, instead of field by field. Both give the
+# same messages and arguments; tools which run without XSTools use the Perl code.
 
 package Bus::Messages;
 
@@ -93,6 +98,8 @@ use Utils::Exceptions;
 
 our @EXPORT_OK = qw(serialize unserialize);
 
+our $native = eval { require FastUtils; 1 };
+
 
 ##
 # Bytes Bus::Messages::serialize(String ID, arguments)
@@ -105,6 +112,7 @@ our @EXPORT_OK = qw(serialize unserialize);
 # This symbol is exportable.
 sub serialize {
 	my ($ID, $arguments) = @_;
+	return Bus::Messages::Native::serialize($ID, $arguments) if ($native);
 
 	# Header
 	my $options = (!$arguments || ref($arguments) eq 'HASH') ? 0 : 1;
@@ -151,11 +159,12 @@ sub serialize {
 }
 
 ##
-# Bus::Messages::unserialize(Bytes data, String* ID, [int* processed])
+# Bus::Messages::unserialize(Bytes data, String* ID, [int* processed], [int offset = 0])
 # data: The raw message data.
 # ID: A reference to a scalar. The message ID will be stored here.
 # processed: A reference to a scalar. The number of bytes processed will be stored in
 #            here. This argument may be undef.
+# offset: Where the message starts in $data.
 # Returns: A reference to a hash or an array. These are the arguments of the message.
 #          Returns undef if $data is not a complete message.
 #
@@ -166,7 +175,19 @@ sub serialize {
 #
 # This symbol is exportable.
 sub unserialize {
-	my ($data, $r_ID, $processed) = @_;
+	my ($data, $r_ID, $processed, $offset) = @_;
+	if ($native) {
+		my ($args, $ID, $messageLen) = Bus::Messages::Native::unserialize($data, $offset || 0);
+		if (!$args) {
+			# Incomplete, or the exception class and message
+			$ID->throw($messageLen) if (defined $ID);
+			return undef;
+		}
+		$$r_ID = $ID;
+		$$processed = $messageLen if ($processed);
+		return $args;
+	}
+	$data = substr($data, $offset) if ($offset);
 	my $dataLen = length($data);
 	return undef if ($dataLen < 4);
 
@@ -174,13 +195,12 @@ sub unserialize {
 	my $messageLen = unpack("N", $data);
 	return undef if ($dataLen < $messageLen);
 	my ($options, $ID) = unpack("x[N] C C/a", $data);
+	$offset = 6 + length($ID);
 	Encode::_utf8_on($ID);
 	if (!Encode::is_utf8($ID, 1)) {
 		UTF8MalformedException->throw("Malformed UTF-8 data in message ID.");
 	}
 
-	my $offset = 6 + length($ID);
-
 	my $args;
 	if ($options == 0) {
 		# Key-value map arguments.
@@ -188,11 +208,11 @@ sub unserialize {
 		while ($offset < $messageLen) {
 			# Key and type.
 			my ($key, $type) = unpack("x[$offset] C/a C", $data);
+			$offset += 2 + length($key);
 			Encode::_utf8_on($key);
 			if (!Encode::_utf8_on($key)) {
 				UTF8MalformedException->throw("Malformed UTF-8 data in key.");
 			}
-			$offset += 2 + length($key);
 
 			# Value length.
 			my ($valueLen) = substr($data, $offset, 3);
@@ -0,0 +1,193 @@
+#########################################################################
+#  OpenKore - Bus System
+#
+#  This software is open source, licensed under the GNU General Public
+#  License, version 2.
+#  Basically, this means that you're allowed to modify and distribute
+#  this software. However, if you distribute modified versions, you MUST
+#  also distribute the source code.
+#  See http://www.gnu.org/licenses/gpl.html for the full license.
+#########################################################################
+##
+# MODULE DESCRIPTION: Bus server with a native relay
+#
+# The bus server which bus-server.pl starts when the XSTools library can be
+# loaded. It speaks the protocol of @MODULE(Bus::Server::MainServer), but the
+# sockets are served by Bus::Server::Relay (src/auto/XSTools/misc/busrelay.cpp),
+# an OSL::Reactor which relays the messages between clients from their framing
+# alone: a message with a TO argument goes to that client, any other one is
+# broadcast, with FROM added at the end of the frame in both cases. The frames
+# aren't deserialized and serialized again, and a broadcast frame is queued once
+# for all its recipients.
+#
+# This server only gets what the relay can't route: the messages it processes
+# itself (HELLO, LIST_CLIENTS), array messages, malformed ones and private
+# messages for a client which doesn't exist, as well as the connections and
+# disconnections. Relayed messages aren't logged.
+#
+# A client which doesn't read its messages is disconnected once more than 16 MB
+# are queued for it; queueDepth() tells how much is.
+package Bus::Server::NativeServer;
+
+use strict;
+use warnings;
+use mro;
+use Socket qw(inet_aton inet_ntoa);
+use FastUtils;
+use Bus::Messages qw(serialize unserialize);
+use Bus::Server::MainServer;
+use base qw(Bus::Server::MainServer);
+use Log qw(debug message);
+use Utils::Exceptions;
+
+# Event types of Bus::Server::Relay->take()
+use constant {
+	CONNECTED => 0,
+	MESSAGE => 1,
+	DISCONNECTED => 2,
+};
+
+
+##
+# Bus::Server::NativeServer->new([int port, String bind], options...)
+#
+# Create a new bus server, like Bus::Server::MainServer->new().
+#
+# Throws SocketException if the server socket cannot be created.
+sub new {
+	my $class = shift;
+	my $port = shift || 0;
+	my $bind = shift || 'localhost';
+	my %args = @_;
+	my %self = (
+		BAS_maxID => 0,
+		BAS_busClients => {},
+		quiet => $args{quiet}
+	);
+
+	my $address = inet_aton($bind);
+	SocketException->throw("Unknown host $bind") if (!$address);
+	$self{BS_host} = inet_ntoa($address);
+	eval {
+		$self{relay} = new Bus::Server::Relay($port, $self{BS_host});
+	};
+	SocketException->throw($@) if ($@);
+	$self{BS_port} = $self{relay}->getPort();
+
+	my $self = bless \%self, $class;
+	no strict 'refs';
+	foreach my $package (@{mro::get_linear_isa($class)}) {
+		foreach my $name (keys %{"${package}::"}) {
+			$self{relay}->handle($1) if ($name =~ /^process(.+)$/ && $package->can($name));
+		}
+	}
+	return $self;
+}
+
+sub clients {
+	my ($self) = @_;
+	my $clients = $self->{BAS_busClients};
+	return [map { $clients->{$_} } sort { $a <=> $b } keys %{$clients}];
+}
+
+sub send {
+	my ($self, $clientID, $messageID, $args) = @_;
+	return -1 if (!$self->{BAS_busClients}{$clientID});
+	return $self->{relay}->send($clientID, serialize($messageID, $args)) ? 1 : 0;
+}
+
+##
+# void $Bus_Server_NativeServer->iterate([float timeout])
+# timeout: The maximum time to wait for clients, in seconds. Waits one second
+#          at most if negative, and not at all if not given.
+#
+# Serve the clients, and process what the relay couldn't route.
+sub iterate {
+	my ($self, $timeout) = @_;
+	if (@_ == 1) {
+		$timeout = 0;
+	} elsif (!defined $timeout || $timeout < 0) {
+		$timeout = 1;
+	}
+
+	my $relay = $self->{relay};
+	if ($relay->run(int($timeout * 1000)) < 0) {
+		message("[Bus::Server::NativeServer] Waiting for clients failed\n", "bus");
+	}
+	my @events = $relay->take();
+	while (@events) {
+		my ($ID, $type, $data) = splice(@events, 0, 3);
+		my $client = $self->{BAS_busClients}{$ID};
+
+		if ($type == CONNECTED) {
+			$client = Bus::Server::NativeServer::Client->new($relay, $ID, $data);
+			# Bus::Server::AbstractServer gives the client this ID
+			$self->{BAS_maxID} = $ID;
+			$self->onClientNew($client, $ID);
+
+		} elsif ($type == MESSAGE && $client) {
+			eval {
+				my $MID;
+				my $args = unserialize($data, \$MID);
+				$self->messageReceived($client, $MID, $args) if ($args);
+			};
+			if ($@) {
+				message("[Bus::Server::NativeServer] Error processing a message from $client->{name}: $@\n", "bus");
+			}
+
+		} elsif ($type == DISCONNECTED && $client) {
+			$self->onClientExit($client);
+		}
+
+		if ($self->{BAS_busClients}{$ID}) {
+			$relay->setBroadcasts($ID, $client->{state} == Bus::Server::MainServer::IDENTIFIED
+				&& !$client->{privateOnly});
+		}
+		# Clients closed by the processing disconnect now
+		push @events, $relay->take();
+	}
+}
+
+##
+# ($frames, $bytes) $Bus_Server_NativeServer->queueDepth(int clientID)
+#
+# Returns the number of messages queued for a client and their size, or an
+# empty list if it isn't connected.
+sub queueDepth {
+	my ($self, $clientID) = @_;
+	return $self->{relay}->queue($clientID);
+}
+
+##
+# $Bus_Server_NativeServer->relayed()
+#
+# Returns the number of messages the relay routed so far, a broadcast
+# counting once, and the number of copies of them queued for their recipients.
+sub relayed {
+	my ($self) = @_;
+	return ($self->{relay}->relayed(), $self->{relay}->delivered());
+}
+
+
+package Bus::Server::NativeServer::Client;
+
+sub new {
+	my ($class, $relay, $ID, $IP) = @_;
+	return bless { relay => $relay, ID => $ID, IP => $IP }, $class;
+}
+
+sub getIP {
+	return $_[0]->{IP};
+}
+
+# There are no file descriptors to show in the log, the client ID takes their place
+sub getFD {
+	return $_[0]->{ID};
+}
+
+sub close {
+	my ($self) = @_;
+	$self->{relay}->close($self->{ID});
+}
+
+1;
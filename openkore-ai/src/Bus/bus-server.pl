@@ -78,14 +78,27 @@ sub __start {
 		if (time - $last_conn_log > 60) {
 			my $count = scalar @{$server->clients()};
 			printf "Active connections: $count\n";
+			if ($server->can('queueDepth')) {
+				my ($relayed, $delivered) = $server->relayed();
+				my ($deepest, $bytes) = (undef, 0);
+				foreach my $client (@{$server->clients()}) {
+					my (undef, $queued) = $server->queueDepth($client->{ID});
+					($deepest, $bytes) = ($client, $queued) if ($queued && $queued > $bytes);
+				}
+				printf "Messages relayed: %d (%d deliveries)%s\n", $relayed, $delivered,
+					$deepest ? ", largest queue: $bytes bytes for $deepest->{name}" : "";
+			}
 			$last_conn_log = time;
 		}
 	}
 }
 
 sub startServer {
-	require Bus::Server::MainServer;
-	$server = new Bus::Server::MainServer($options{port}, $options{bind},
+	# The native server relays messages without parsing them, when XSTools can be loaded
+	my $class = eval { require Bus::Server::NativeServer; 1 }
+		? 'Bus::Server::NativeServer' : 'Bus::Server::MainServer';
+	eval "require $class" or die $@;
+	$server = $class->new($options{port}, $options{bind},
 			quiet => $options{quiet});
 	return { host => $server->getHost(), port => $server->getPort() };
 }
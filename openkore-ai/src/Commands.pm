@@ -685,6 +685,12 @@ sub initHandlers {
 			], \&cmdTank],
 		['tele', T("Teleport to a random location."), \&cmdTeleport],
 		['testshop', T("Show what your vending shop would sell."), \&cmdTestShop],
+		['ticks', [
+			T("Main loop latency report."),
+			["", T("displays the percentiles of the main loop iterations and of their phases")],
+			["last", T("displays the phases of the last iteration")],
+			["reset", T("resets the latency report")]
+			], \&cmdTicks],
 		['timeout', [
 			T("Set a timeout."),
 			[T("<type>"), T("displays value of <type>")],
@@ -6041,6 +6047,23 @@ sub cmdTeleport {
 	ai_useTeleport($arg1);
 }
 
+sub cmdTicks {
+	my (undef, $args) = @_;
+	if ($args eq 'reset') {
+		Utils::TickTimer::reset();
+		message T("Main loop latency report reset.\n"), "info";
+	} elsif ($args eq 'last') {
+		message TF("Last main loop iteration: %s\n", Utils::TickTimer::breakdown(Utils::TickTimer::lastTickTime())), "list";
+	} elsif ($args eq '') {
+		message center(T(" Main loop latency "), 71, '-') . "\n" .
+			Utils::TickTimer::report() .
+			('-' x 71) . "\n", "list";
+	} else {
+		error T("Syntax Error in function 'ticks' (Main loop latency report)\n" .
+			"Usage: ticks [last|reset]\n");
+	}
+}
+
 sub cmdTestShop {
 	my @items = main::makeShop();
 	return unless @items;
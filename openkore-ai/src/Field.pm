@@ -34,8 +34,21 @@
 # - <tt>width</tt> - The field's width. You should not access this item directly; use $Field->width() instead.
 # - <tt>height</tt> - The field's height. You should not access this item directly; use $Field->width() instead.
 # - <tt>rawMap</tt> - The raw map data. Contains information about which blocks you can walk on (byte 0),
-#                     and which not (byte 1).
+#                     and which not (byte 1). Undef if the raw map is kept in rawChunks instead, use $Field->rawMap() to read all of it.
+# - <tt>rawChunks</tt> - The raw map as a Utils::FieldChunks object, if the fieldChunks option is set. See $Field->rawRegion().
 # - <tt>weightMap</tt> - The weight map data. Used by pathfinding.
+# - <tt>neighborMask</tt> - Walkable neighbors of each cell, derived from weightMap. Use $Field->neighborMask() instead.
+# - <tt>abstractGraph</tt> - The hierarchical pathfinding graph of this field. Use $Field->abstractGraph() instead.
+# - <tt>components</tt> - Connected walkable area of each cell, derived from weightMap. Use $Field->components() instead.
+# - <tt>distanceFields</tt> - Cache of the distance fields calculated on this field. Use $Field->distanceField() instead.
+# - <tt>visibilityCache</tt> - Line of sight cache of the cells attacked from. Use $Field->visibilityCache() instead.
+# - <tt>dangerMap</tt> - Danger layer stamped by the aggressive monsters around. Use $Field->dangerMap() instead.
+# - <tt>weightProfiles</tt> - Weight maps of the weight profiles used on this field. Use $Field->weightProfileMap() instead.
+# - <tt>landmarks</tt> - Landmark distance tables of weightMap, for the A* heuristic. Use $Field->landmarks() instead.
+# - <tt>walkablePrefix</tt> - Number of walkable cells before each cell of its row. Use $Field->walkablePrefix() instead.
+# - <tt>tileMap</tt> - Native handle of rawMap for the tile queries. Use $Field->tileMap() instead.
+# - <tt>tileBits</tt> - Bit layers of rawMap, by tile type. Use $Field->tileBits() instead.
+# - <tt>fieldCache</tt> - The Utils::FieldCache the maps were loaded from, if any. See $Field->loadFieldCache().
 # `l`
 package Field;
 
@@ -54,6 +67,8 @@ use Utils::Exceptions;
 use Translation qw(T TF);
 use Misc;
 use Utils;
+use Utils::Whirlpool qw(whirlpool_file);
+use Utils::TickTimer;
 
 # Block types.
 use constant {
@@ -64,6 +79,41 @@ use constant {
 	TILE_CLIFF  => 8,
 };
 
+# Block types of the gat cell types sent by the server when a cell changes, as converted by fields/tools/gat_to_fld2.pl
+my @gatTileTypes = (
+	TILE_WALK,
+	TILE_NOWALK,
+	TILE_WATER,
+	TILE_WALK | TILE_WATER,
+	TILE_WATER | TILE_SNIPE,
+	TILE_CLIFF | TILE_SNIPE,
+	TILE_CLIFF,
+);
+
+# Number of distance fields kept by $Field->distanceField()
+use constant DISTANCE_FIELD_CACHE_SIZE => 16;
+
+# Field cache (.fldc file) format, see $Field->loadFieldCache()
+use constant {
+	FIELD_CACHE_VERSION => 1,
+	FIELD_CACHE_ALIGNMENT => 4096,
+	FIELD_CACHE_RAW => 1,
+	FIELD_CACHE_WEIGHT => 2,
+	FIELD_CACHE_NEIGHBOR_MASK => 3,
+	FIELD_CACHE_COMPONENTS => 4,
+	FIELD_CACHE_HPA => 5,
+	FIELD_CACHE_SOURCE_HASH => 6,
+	FIELD_CACHE_LANDMARKS => 7,
+	# Weight profile maps are stored with this bit set and a hash of their weights, see $Field->weightProfileMap()
+	FIELD_CACHE_WEIGHT_PROFILE => 0x80000000,
+};
+
+# Number of weight profile maps kept by $Field->weightProfileMap()
+use constant WEIGHT_PROFILE_CACHE_SIZE => 4;
+
+# Number of landmarks of $Field->landmarks()
+use constant LANDMARK_COUNT => 8;
+
 ##
 # Field->new(options...)
 #
@@ -102,6 +152,7 @@ sub new {
 	my %args = @_;
 	my $self = bless {}, $class;
 
+	Utils::TickTimer::begin(Utils::TickTimer::FIELD);
 	if ($args{file}) {
 		$self->loadFile($args{file}, $args{loadWeightMap});
 	} elsif ($args{name}) {
@@ -109,6 +160,7 @@ sub new {
 	} else {
 		ArgumentException->throw("No field name or filename specified.");
 	}
+	Utils::TickTimer::end(Utils::TickTimer::FIELD);
 
 	return $self;
 }
@@ -197,6 +249,7 @@ sub height {
 # If you want to check whether the block is walkable, use $field->isWalkable() instead.
 sub getBlock {
 	my ($self, $offset) = @_;
+	return $self->{rawChunks}->cell($offset % $self->{width}, int($offset / $self->{width})) if ($self->{rawChunks});
 	return ord(substr($self->{rawMap}, $offset, 1));
 }
 
@@ -249,40 +302,100 @@ sub getCellInfo {
 # boolean $Field->isWalkable(int x, int y)
 #
 # Check whether you can walk on ($x,$y) on this field.
-#  1.73 microsec -> 798.04 nanosec p.o.
 sub isWalkable {
-	my ($self, $x, $y) = @_;
-	return PathFinding::checkTile($x, $y, TILE_WALK, $self->{width}, $self->{height}, \$self->{rawMap});
+	return ($_[0]{tileMap} || $_[0]->tileMap)->isWalkable($_[1], $_[2]);
 }
 
 ##
 # boolean $Field->isSnipable(int x, int y)
 #
 # Check whether you can snipe through ($x,$y) on this field.
-#  1.73 microsec -> 798.04 nanosec p.o.
 sub isSnipable {
-	my ($self, $x, $y) = @_;
-	return PathFinding::checkTile($x, $y, TILE_SNIPE, $self->{width}, $self->{height}, \$self->{rawMap});
+	return ($_[0]{tileMap} || $_[0]->tileMap)->isSnipable($_[1], $_[2]);
 }
 
 ##
 # boolean $Field->isWater(int x, int y)
 #
 # Check whether there is water ($x,$y) on this field.
-#  1.73 microsec -> 798.04 nanosec p.o.
 sub isWater {
-	my ($self, $x, $y) = @_;
-	return PathFinding::checkTile($x, $y, TILE_WATER, $self->{width}, $self->{height}, \$self->{rawMap});
+	return ($_[0]{tileMap} || $_[0]->tileMap)->isWater($_[1], $_[2]);
 }
 
 ##
 # boolean $Field->isCliff(int x, int y)
 #
 # Check whether cell ($x,$y) in a cliff on this field.
-#  1.73 microsec -> 798.04 nanosec p.o.
 sub isCliff {
-	my ($self, $x, $y) = @_;
-	return PathFinding::checkTile($x, $y, TILE_CLIFF, $self->{width}, $self->{height}, \$self->{rawMap});
+	return ($_[0]{tileMap} || $_[0]->tileMap)->isCliff($_[1], $_[2]);
+}
+
+##
+# PathFinding::TileMap $Field->tileMap()
+# Returns: the native handle of the raw map of this field.
+#
+# The tile queries (isWalkable, isSnipable, isWater and isCliff) are called thousands of times per AI
+# iteration. The handle keeps the raw map scalar and the field size, so each query only passes the
+# coordinates to native code instead of the map and its size.
+sub tileMap {
+	my ($self) = @_;
+	return $self->{tileMap} ||= PathFinding::TileMap->new($self->{rawChunks} || \$self->{rawMap}, $self->{width}, $self->{height});
+}
+
+##
+# String* $Field->rawMap()
+# Returns: a reference to the whole raw map of this field.
+#
+# If the raw map is kept in chunks (see $Field->rawRegion()), all of them are decompressed into a new
+# string, so only use it for what needs the whole field at once.
+sub rawMap {
+	my ($self) = @_;
+	return \$self->{rawMap} unless ($self->{rawChunks});
+	my $rawMap = $self->{rawChunks}->region(0, 0, $self->{width}, $self->{height});
+	return \$rawMap;
+}
+
+##
+# (String*, int, int, int, int) $Field->rawRegion(int x1, int y1, int x2, int y2, [int margin = 0])
+# Returns: a reference to a raw map holding the cells between (x1, y1) and (x2, y2) and margin cells
+#          around them, its width and height, and the coordinates of its top left cell on the field.
+#
+# With the fieldChunks option, the raw map of a field which isn't mapped from the field cache is kept
+# as compressed 64x64 chunks (see src/auto/XSTools/misc/fieldchunks.h), which are decompressed when
+# their cells are read, and fieldChunks of them are kept decompressed. The tile queries read the
+# chunks, and the line of sight and area checks run on the region of the field they cover, made from
+# the chunks. Without chunks, the region is the whole field.
+sub rawRegion {
+	my ($self, $x1, $y1, $x2, $y2, $margin) = @_;
+	return (\$self->{rawMap}, $self->{width}, $self->{height}, 0, 0) unless ($self->{rawChunks});
+
+	$margin ||= 0;
+	($x1, $x2) = ($x2, $x1) if ($x1 > $x2);
+	($y1, $y2) = ($y2, $y1) if ($y1 > $y2);
+	$x1 = clampCell($x1 - $margin, $self->{width});
+	$y1 = clampCell($y1 - $margin, $self->{height});
+	$x2 = clampCell($x2 + $margin, $self->{width});
+	$y2 = clampCell($y2 + $margin, $self->{height});
+	my $region = $self->{rawChunks}->region($x1, $y1, $x2 - $x1 + 1, $y2 - $y1 + 1);
+	return (\$region, $x2 - $x1 + 1, $y2 - $y1 + 1, $x1, $y1);
+}
+
+sub clampCell {
+	my ($value, $size) = @_;
+	return ($value < 0) ? 0 : ($value >= $size) ? $size - 1 : $value;
+}
+
+##
+# String $Field->tileBits(int tile)
+# tile: One of the block type constants, like TILE_WALK.
+# Returns: a string with one bit per cell, set for the cells of the given type.
+#
+# Code which checks many cells in a loop can read the bits with vec($bits, $y * $field->width + $x, 1)
+# instead of calling a method for every cell. Cells out of the field must be checked by the caller.
+sub tileBits {
+	my ($self, $tile) = @_;
+	$self->{tileBits}{$tile} = $self->tileMap->bits($tile) unless (defined $self->{tileBits}{$tile});
+	return $self->{tileBits}{$tile};
 }
 
 sub getBlockWeight {
@@ -292,6 +405,238 @@ sub getBlockWeight {
 	return ord(substr($self->{weightMap}, $offset, 1));
 }
 
+##
+# Scalar* $Field->neighborMask()
+# Returns: a reference to the neighbor mask of this field, or undef if the weight map is not loaded.
+#
+# The neighbor mask holds one byte per cell with a bit set for each direction in which
+# the cell can be walked to. It is derived from the weight map and built the first time
+# it is requested, so PathFinding sessions on this field don't have to check walls for every step.
+#
+# If you modify $self->{weightMap}, delete $self->{neighborMask}, $self->{components} and $self->{landmarks} so they get rebuilt,
+# and call PathFinding::clearRouteCache() so routes found on the old map are dropped. $Field->changeCells() does that for
+# cells the server changes, repairing the neighbor mask and the connected areas instead.
+sub neighborMask {
+	my ($self) = @_;
+	return undef unless (defined $self->{weightMap});
+	$self->{neighborMask} = PathFinding::makeNeighborMask(\$self->{weightMap}, $self->{width}, $self->{height})
+		unless (defined $self->{neighborMask});
+	return \$self->{neighborMask};
+}
+
+##
+# HierarchicalPathFinding $Field->abstractGraph()
+# Returns: the hierarchical pathfinding graph of this field, or undef if the weight map is not loaded.
+#
+# The graph is used to plan long routes. It is loaded from the .hpa file next to the field's
+# .weight file, or built and saved there the first time it is requested.
+sub abstractGraph {
+	my ($self) = @_;
+	return undef unless (defined $self->{weightMap});
+	return $self->{abstractGraph} if ($self->{abstractGraph});
+
+	require Utils::HierarchicalPathFinding;
+	my %args = (weight_map => \$self->{weightMap}, width => $self->{width}, height => $self->{height});
+	my $cache = $self->{fieldCache};
+	if ($cache && $cache->hasLayer(FIELD_CACHE_HPA)) {
+		my %layer;
+		$cache->attach(FIELD_CACHE_HPA, \%layer, 'data');
+		$self->{abstractGraph} = HierarchicalPathFinding->loadData($layer{data}, %args);
+	}
+	if (!$self->{abstractGraph} && $self->{abstractGraphFile}) {
+		$self->{abstractGraph} = HierarchicalPathFinding->load($self->{abstractGraphFile}, %args);
+	}
+	if (!$self->{abstractGraph}) {
+		$self->{abstractGraph} = HierarchicalPathFinding->build(%args);
+		$self->{abstractGraph}->save($self->{abstractGraphFile}) if ($self->{abstractGraphFile});
+	}
+	# Add the graph to the field cache, so the next load finds everything in it
+	if ($self->{fieldCacheFile} && !($cache && $cache->hasLayer(FIELD_CACHE_HPA))) {
+		$self->saveFieldCache($self->{fieldCacheFile}, $self->{fieldCacheSource});
+	}
+	return $self->{abstractGraph};
+}
+
+##
+# Array<int>* Field::weightProfile(profile)
+# profile: The name of a weight profile, or a reference to an array of weights.
+# Returns: the weights of the profile, or undef for the field's own weight map.
+#
+# A weight profile gives the pathfinding weight of the cells 1, 2, 3... cells away from the
+# nearest wall, see Utils::makeWeightProfile(). Profiles are named in the config with
+# <tt>weightProfile_<i>name</i> 80, 60, 40, 20, 10, 0</tt>; the name "default" and unknown names
+# are the field's own weight map.
+sub weightProfile {
+	my ($profile) = @_;
+	return $profile if (ref $profile eq 'ARRAY');
+	return undef if (!defined $profile || $profile eq '' || $profile eq 'default' || !$config{"weightProfile_$profile"});
+	return [split /\s*,\s*/, $config{"weightProfile_$profile"}];
+}
+
+##
+# String* $Field->weightProfileMap([profile])
+# profile: The name of a weight profile, or a reference to an array of weights, see Field::weightProfile().
+# Returns: a reference to the weight map of the profile, the field's own weight map if none is given, or undef if the weight map is not loaded.
+#
+# The weight maps of other profiles than the default one are derived from the distance map on first
+# use, and share the walls of the field's weight map, so the neighbor mask, the connected areas and the
+# landmarks of the field are also theirs. The last WEIGHT_PROFILE_CACHE_SIZE of them are kept, also in
+# the field cache, so bots on the same host share them. Pass the profile to $PathFinding->reset() with
+# its weight_profile option.
+sub weightProfileMap {
+	my ($self, $profile) = @_;
+	return undef unless (defined $self->{weightMap});
+	my $weights = weightProfile($profile);
+	return \$self->{weightMap} unless ($weights);
+
+	my $key = join(',', map { int } @{$weights});
+	my $profiles = $self->{weightProfiles} ||= {};
+	my $entry = $profiles->{$key};
+	if (!$entry) {
+		# The least recently used map makes room for the new one
+		if (keys %{$profiles} >= WEIGHT_PROFILE_CACHE_SIZE) {
+			my ($oldest) = sort { $profiles->{$a}{used} <=> $profiles->{$b}{used} } keys %{$profiles};
+			delete $profiles->{$oldest};
+		}
+		$entry = $profiles->{$key} = { weights => [split /,/, $key], layer => weightProfileLayer($key) };
+
+		my $cache = $self->{fieldCache};
+		if (!($cache && $cache->attach($entry->{layer}, $entry, 'map'))) {
+			my $distMap = Utils::makeDistMap(${$self->rawMap}, $self->{width}, $self->{height});
+			$entry->{map} = Utils::makeWeightProfile($distMap, $self->{width}, $self->{height}, $entry->{weights}, \$self->{weightMap});
+			$self->saveFieldCache($self->{fieldCacheFile}, $self->{fieldCacheSource}) if ($self->{fieldCacheFile});
+		}
+	}
+	$entry->{used} = ++$self->{weightProfileUses};
+	return \$entry->{map};
+}
+
+# Field cache layer of the weight map of a profile, given as its comma separated weights
+sub weightProfileLayer {
+	my ($key) = @_;
+	require Digest::MD5;
+	return FIELD_CACHE_WEIGHT_PROFILE | (unpack("N", Digest::MD5::md5($key)) & 0x7FFFFFFF);
+}
+
+##
+# String* $Field->landmarks()
+# Returns: a reference to the landmark distance tables of this field, or undef if the weight map is not loaded.
+#
+# The tables hold the walking cost from a few landmarks spread over the field to every cell (see
+# src/auto/XSTools/PathFinding/landmarks.h). Searches given them with the landmarks option of
+# $PathFinding->reset() know how much walls are in the way, so they expand much fewer nodes on
+# maze-like fields. The tables are built the first time they are requested, and kept in the field cache.
+sub landmarks {
+	my ($self) = @_;
+	return undef unless (defined $self->{weightMap});
+	return \$self->{landmarks} if (defined $self->{landmarks});
+
+	my $cache = $self->{fieldCache};
+	if ($cache && $cache->hasLayer(FIELD_CACHE_LANDMARKS)) {
+		$cache->attach(FIELD_CACHE_LANDMARKS, $self, 'landmarks');
+		return \$self->{landmarks};
+	}
+	$self->{landmarks} = PathFinding::makeLandmarks(\$self->{weightMap}, $self->{width}, $self->{height}, LANDMARK_COUNT);
+	if ($self->{fieldCacheFile}) {
+		$self->saveFieldCache($self->{fieldCacheFile}, $self->{fieldCacheSource});
+	}
+	return \$self->{landmarks};
+}
+
+##
+# String* $Field->walkablePrefix()
+# Returns: a reference to the walkable prefix counts of this field, as built by PathFinding::makeWalkablePrefix().
+sub walkablePrefix {
+	my ($self) = @_;
+	$self->{walkablePrefix} = PathFinding::makeWalkablePrefix($self->rawMap, $self->{width}, $self->{height})
+		unless (defined $self->{walkablePrefix});
+	return \$self->{walkablePrefix};
+}
+
+##
+# Array $Field->sampleWalkable(Hash* pos, int radius, int count, [boolean reachable])
+# Returns: up to $count different walkable positions, drawn at random within $radius blocks of $pos.
+#
+# If $reachable is set, only positions which can be walked to from $pos without leaving the radius are drawn.
+# Uses the walkable prefix counts of the field, so it costs about the same for a radius of 5 or of 50.
+sub sampleWalkable {
+	my ($self, $pos, $radius, $count, $reachable) = @_;
+	my $distances;
+	if ($reachable) {
+		$distances = $self->distanceField($pos->{x}, $pos->{y}, $radius);
+		return () unless ($distances);
+	}
+	my $packed = PathFinding::sampleWalkable($self->walkablePrefix, $self->{width}, $self->{height},
+		$pos->{x} - $radius, $pos->{x} + $radius, $pos->{y} - $radius, $pos->{y} + $radius, $count,
+		$distances, $pos->{x} - $radius, $pos->{y} - $radius, 2 * $radius + 1);
+	my @cells = unpack('v*', $packed);
+	return map { { x => $cells[$_ * 2], y => $cells[$_ * 2 + 1] } } (0 .. @cells / 2 - 1);
+}
+
+##
+# Array $Field->sampleWalkableArea(int min_x, int max_x, int min_y, int max_y, int count)
+# Returns: up to $count different walkable positions, drawn at random in the given rectangle.
+sub sampleWalkableArea {
+	my ($self, $min_x, $max_x, $min_y, $max_y, $count) = @_;
+	my $packed = PathFinding::sampleWalkable($self->walkablePrefix, $self->{width}, $self->{height}, $min_x, $max_x, $min_y, $max_y, $count);
+	my @cells = unpack('v*', $packed);
+	return map { { x => $cells[$_ * 2], y => $cells[$_ * 2 + 1] } } (0 .. @cells / 2 - 1);
+}
+
+##
+# String* $Field->components()
+# Returns: a reference to the connected area labels of this field, or undef if the weight map is not loaded.
+#
+# Each cell has the number of the walkable area it is in, as built by PathFinding::makeComponents(),
+# so PathFinding can tell right away that there is no path between two areas instead of searching
+# the whole area of the start. The labels are loaded from the .comp file next to the field's .weight
+# file, or built and saved there the first time they are requested.
+sub components {
+	my ($self) = @_;
+	return undef unless (defined $self->{weightMap});
+	return \$self->{components} if (defined $self->{components});
+
+	my $file = $self->{componentsFile};
+	if ($file && -f $file && open(my $f, "<", $file)) {
+		binmode $f;
+		local $/;
+		my $data = <$f>;
+		close $f;
+		my ($magic, $version, $width, $height) = unpack("a2 v v v", substr($data, 0, 8, ''));
+		if ($magic eq 'V#' && $version == 1 && $width == $self->{width} && $height == $self->{height} && length($data) == $width * $height * 2) {
+			$self->{components} = $data;
+		}
+	}
+	if (!defined $self->{components}) {
+		$self->{components} = PathFinding::makeComponents(\$self->{weightMap}, $self->{width}, $self->{height});
+		if ($file && open(my $f, ">", $file)) {
+			binmode $f;
+			print $f pack("a2 v1", 'V#', 1);
+			print $f pack("v v", $self->{width}, $self->{height});
+			print $f $self->{components};
+			close $f;
+		}
+	}
+	return \$self->{components};
+}
+
+##
+# String* $Field->distanceField(int x, int y, int radius)
+# Returns: a reference to the distance field of ($x, $y), or undef if ($x, $y) is not walkable.
+#
+# Cached version of PathFinding::distanceField(), so AI loops asking for walking distances
+# from the same position over and over only calculate them once. Read distances with
+# PathFinding::distanceFieldAt().
+sub distanceField {
+	my ($self, $x, $y, $radius) = @_;
+	my $key = "$x $y $radius";
+	return $self->{distanceFields}{$key} if (exists $self->{distanceFields}{$key});
+
+	# Keep the cache small, AI loops usually only ask for a few sources at a time
+	$self->{distanceFields} = {} if (keys %{$self->{distanceFields} || {}} >= DISTANCE_FIELD_CACHE_SIZE);
+	return $self->{distanceFields}{$key} = PathFinding::distanceField($self, $x, $y, $radius);
+}
+
 sub getBlockDist {
 	my ($self, $x, $y) = @_;
 	return 0 if ($self->isOffMap($x, $y));
@@ -299,6 +644,73 @@ sub getBlockDist {
 	return ord(substr($self->{dstMap}, $offset, 1));
 }
 
+##
+# int $Field->changeCells(Hash* cell, ...)
+# cell: a hash with the x and y of a cell and its new gat cell type as 'type' (0 walkable, 1 wall, 5 snipable cliff...).
+# Returns: the number of cells which changed.
+#
+# Used when the server changes cells of the field, for example while an Ice Wall stands. The raw map, the weight
+# map and the weight maps of the profiles are repaired around the changed cells only, and so are the neighbor mask
+# and the connected areas if they were built. The rest is rebuilt on next use: the landmarks, the hierarchical graph,
+# the walkable prefix counts, the distance fields and the line of sight caches. The changes are not saved, the field
+# is loaded as it is in the field files next time, and the routes found before are dropped. Cells which were water
+# stay water, the server doesn't say how deep they are.
+sub changeCells {
+	my ($self, @cells) = @_;
+	my $rawMap;
+	my $raw = $self->{rawChunks} ? \($rawMap = ${$self->rawMap}) : \$self->{rawMap};
+	my (@changed, @walkability);
+
+	foreach my $cell (@cells) {
+		next if ($self->isOffMap($cell->{x}, $cell->{y}));
+		my $offset = $self->getOffset($cell->{x}, $cell->{y});
+		my $old = ord(substr($$raw, $offset, 1));
+		my $new = $gatTileTypes[$cell->{type}];
+		$new = TILE_NOWALK unless (defined $new);
+		$new |= $old & TILE_WATER;
+		next if ($new == $old);
+		substr($$raw, $offset, 1, chr($new));
+		push @changed, $cell;
+		push @walkability, $cell->{x}, $cell->{y} if (($old ^ $new) & TILE_WALK);
+	}
+	return 0 unless (@changed);
+
+	if ($self->{rawChunks}) {
+		$self->{rawChunks} = Utils::FieldChunks->new($raw, $self->{width}, $self->{height}, $config{fieldChunks});
+		$self->{rawMap} = $rawMap unless ($self->{rawChunks});
+	}
+	delete $self->{tileMap};
+	delete $self->{tileBits};
+	delete $self->{visibilityCache};
+
+	if (@walkability) {
+		my ($width, $height) = ($self->{width}, $self->{height});
+		my $cells = pack('v*', @walkability);
+		if (defined $self->{weightMap}) {
+			Utils::repairWeightProfile(\$self->{weightMap}, $raw, $width, $height, $cells);
+			foreach my $entry (grep { defined $_->{map} } values %{$self->{weightProfiles} || {}}) {
+				Utils::repairWeightProfile(\$entry->{map}, $raw, $width, $height, $cells, $entry->{weights}, \$self->{weightMap});
+			}
+			PathFinding::repairNeighborMask(\$self->{neighborMask}, \$self->{weightMap}, $width, $height, $cells) if (defined $self->{neighborMask});
+			PathFinding::repairComponents(\$self->{components}, \$self->{weightMap}, $width, $height, $cells) if (defined $self->{components});
+		}
+		Utils::repairDistMap(\$self->{dstMap}, $raw, $width, $height, $cells) if (defined $self->{dstMap});
+		delete $self->{landmarks};
+		delete $self->{abstractGraph};
+		delete $self->{walkablePrefix};
+		delete $self->{distanceFields};
+	}
+
+	# What is kept in files or in the field cache is the field as it was loaded
+	delete $self->{fieldCache};
+	delete $self->{fieldCacheFile};
+	delete $self->{fieldCacheSource};
+	delete $self->{abstractGraphFile};
+	delete $self->{componentsFile};
+	PathFinding::clearRouteCache();
+	return scalar @changed;
+}
+
 ##
 # $Field->closestWalkableSpot(pos, max_distance)
 # pos: reference to a position hash (which contains 'x' and 'y' keys).
@@ -317,12 +729,12 @@ sub closestWalkableSpot {
 	
 	my @current_distance = (1..$max_distance);
 	
+	# calcRectArea only returns walkable blocks, so the first one found is the closest
 	foreach my $distance (@current_distance) {
-		my @blocks = $self->calcRectArea($center{x}, $center{y}, $distance);
-		foreach my $block (@blocks) {
-			next if (!$self->isWalkable($block->{x}, $block->{y}));
-			return $block;
-		}
+		my $blocks = $self->calcRectArea_packed($center{x}, $center{y}, $distance);
+		next unless (length $blocks);
+		my ($x, $y) = PathFinding::packedCell($blocks, 0);
+		return { x => $x, y => $y };
 	}
 	
 	return undef;
@@ -347,10 +759,114 @@ sub calcRectArea {
 	my ($self, $x, $y, $radius) = @_;
 
 	my @walkableBlocks;
+	if ($self->{rawChunks}) {
+		my ($map, $width, $height, $left, $top) = $self->rawRegion($x - $radius, $y - $radius, $x + $radius, $y + $radius);
+		PathFinding::calcRectArea($x - $left, $y - $top, $radius, TILE_WALK, $width, $height, $map, \@walkableBlocks);
+		$_->{x} += $left, $_->{y} += $top for (@walkableBlocks);
+		return @walkableBlocks;
+	}
 	PathFinding::calcRectArea($x, $y, $radius, TILE_WALK, $self->{width}, $self->{height}, \$self->{rawMap}, \@walkableBlocks);
 	return @walkableBlocks;
 }
 
+##
+# String $Field->calcRectArea_packed($x, $y, $radius)
+# Returns: the same positions as $Field->calcRectArea(), as x and y coordinates packed with pack("v*").
+#
+# Read the result with PathFinding::packedLength() and PathFinding::packedCell().
+sub calcRectArea_packed {
+	my ($self, $x, $y, $radius) = @_;
+	if ($self->{rawChunks}) {
+		my ($map, $width, $height, $left, $top) = $self->rawRegion($x - $radius, $y - $radius, $x + $radius, $y + $radius);
+		my @cells = unpack('v*', PathFinding::calcRectArea_packed($x - $left, $y - $top, $radius, TILE_WALK, $width, $height, $map));
+		return pack('v*', map { $cells[$_] + (($_ % 2) ? $top : $left) } 0 .. $#cells);
+	}
+	return PathFinding::calcRectArea_packed($x, $y, $radius, TILE_WALK, $self->{width}, $self->{height}, \$self->{rawMap});
+}
+
+##
+# PathFinding::VisibilityCache $Field->visibilityCache()
+# Returns: the line of sight cache of this field, or undef if the attackVisibilityCache option is 0.
+#
+# Bots keep checking the line of sight from the same few cells they attack from. The cache keeps, for the
+# last attackVisibilityCache such cells, which cells within clientSight can be seen from them, so checkLOS
+# and canAttack from these cells are a bit lookup. It gives the same results as the direct checks.
+sub visibilityCache {
+	my ($self) = @_;
+	return undef unless ($config{attackVisibilityCache});
+	return $self->{visibilityCache} ||= PathFinding::VisibilityCache->new($self->{width}, $self->{height}, $config{clientSight} || 15, $config{attackVisibilityCache});
+}
+
+##
+# Array $Field->smoothSolution(Array* solution, int max_segment)
+# Returns: the cells of $solution collapsed into straight walks of at most $max_segment steps
+#          (see PathFinding::smoothSolution()), the last cell of every walk has its <tt>waypoint</tt> key set.
+# Returns the lowest and highest coordinates of an array of position hashes
+sub boundingBox {
+	my ($positions) = @_;
+	my ($x1, $y1, $x2, $y2) = ($positions->[0]{x}, $positions->[0]{y}, $positions->[0]{x}, $positions->[0]{y});
+	foreach my $pos (@{$positions}) {
+		$x1 = $pos->{x} if ($pos->{x} < $x1);
+		$y1 = $pos->{y} if ($pos->{y} < $y1);
+		$x2 = $pos->{x} if ($pos->{x} > $x2);
+		$y2 = $pos->{y} if ($pos->{y} > $y2);
+	}
+	return ($x1, $y1, $x2, $y2);
+}
+
+sub smoothSolution {
+	my ($self, $solution, $max_segment) = @_;
+	my ($path, $waypoints);
+	if ($self->{rawChunks} && @{$solution}) {
+		my ($map, $width, $height, $left, $top) = $self->rawRegion(boundingBox($solution));
+		($path, $waypoints) = PathFinding::smoothSolution(pack('v*', map { $_->{x} - $left, $_->{y} - $top } @{$solution}),
+			$max_segment, TILE_WALK, $width, $height, $map);
+		my @cells = unpack('v*', $path);
+		$path = pack('v*', map { $cells[$_] + (($_ % 2) ? $top : $left) } 0 .. $#cells);
+	} else {
+		($path, $waypoints) = PathFinding::smoothSolution(pack('v*', map { $_->{x}, $_->{y} } @{$solution}),
+			$max_segment, TILE_WALK, $self->{width}, $self->{height}, \$self->{rawMap});
+	}
+	my @smoothed = PathFinding::unpackSolution($path);
+	$smoothed[$_]{waypoint} = 1 for (unpack('V*', $waypoints));
+	return @smoothed;
+}
+
+##
+# PathFinding::DangerMap $Field->dangerMap()
+# Returns: the danger layer of this field, or undef if the route_avoidDanger option is 0.
+#
+# Aggressive monsters stamp route_avoidDanger around them on the layer (see AI::CoreLogic::processDangerMap()),
+# and routes are searched with it, so they go around the monsters instead of through them.
+sub dangerMap {
+	my ($self) = @_;
+	return undef unless ($config{route_avoidDanger});
+	return $self->{dangerMap} ||= PathFinding::DangerMap->new($self->{width}, $self->{height});
+}
+
+##
+# void $Field->stampDanger(Actor actor, int radius, int weight)
+#
+# Stamps the danger of $actor around its destination cell, taking out the one it stamped before, if any.
+sub stampDanger {
+	my ($self, $actor, $radius, $weight) = @_;
+	my $map = $self->dangerMap or return;
+	unstampDanger($actor);
+	$map->stamp($actor->{pos_to}{x}, $actor->{pos_to}{y}, $radius, $weight);
+	$actor->{dangerStamp} = [$map, $actor->{pos_to}{x}, $actor->{pos_to}{y}, $radius, $weight];
+}
+
+##
+# void Field::unstampDanger(Actor actor)
+#
+# Takes the danger stamped by $actor out of the layer it was stamped on.
+sub unstampDanger {
+	my ($actor) = @_;
+	my $stamp = delete $actor->{dangerStamp} or return;
+	my ($map, @kernel) = @{$stamp};
+	$map->unstamp(@kernel);
+}
+
 # Bresenham's algorithm
 #
 # Used for checking if there are no obstacles in the direct line of sight of 2 actors
@@ -368,7 +884,11 @@ sub checkLOS {
 		$tile = TILE_WALK;
 	}
 	
-	return PathFinding::checkLOS($from->{x}, $from->{y}, $to->{x}, $to->{y}, $tile, $self->{width}, $self->{height}, \$self->{rawMap});
+	if ($self->{rawChunks}) {
+		my ($map, $width, $height, $left, $top) = $self->rawRegion($from->{x}, $from->{y}, $to->{x}, $to->{y});
+		return PathFinding::checkLOS($from->{x} - $left, $from->{y} - $top, $to->{x} - $left, $to->{y} - $top, $tile, $width, $height, $map);
+	}
+	return PathFinding::checkLOS($from->{x}, $from->{y}, $to->{x}, $to->{y}, $tile, $self->{width}, $self->{height}, \$self->{rawMap}, $config{attackVisibilityCache} ? ($self->{visibilityCache} || $self->visibilityCache) : undef);
 }
 
 # Returns:
@@ -388,7 +908,58 @@ sub canAttack {
 		$tile = TILE_WALK;
 	}
 	
-	return PathFinding::canAttack($pos1->{x}, $pos1->{y}, $pos2->{x}, $pos2->{y}, $tile, $self->{width}, $self->{height}, $range, $clientSight, \$self->{rawMap});
+	if ($self->{rawChunks}) {
+		my ($map, $width, $height, $left, $top) = $self->rawRegion($pos1->{x}, $pos1->{y}, $pos2->{x}, $pos2->{y});
+		return PathFinding::canAttack($pos1->{x} - $left, $pos1->{y} - $top, $pos2->{x} - $left, $pos2->{y} - $top, $tile, $width, $height, $range, $clientSight, $map);
+	}
+	return PathFinding::canAttack($pos1->{x}, $pos1->{y}, $pos2->{x}, $pos2->{y}, $tile, $self->{width}, $self->{height}, $range, $clientSight, \$self->{rawMap}, $config{attackVisibilityCache} ? ($self->{visibilityCache} || $self->visibilityCache) : undef);
+}
+
+# Same as checkLOS, from one position to every position of the array reference $targets
+# Returns the list of results, in the order of $targets
+#
+# All lines are checked in a single XS call, use it when many actors are checked at once
+sub checkLOSMany {
+	my ($self, $from, $targets, $can_snipe) = @_;
+	return () unless (@{$targets});
+
+	my $tile = $can_snipe ? TILE_WALK|TILE_SNIPE : TILE_WALK;
+	if ($self->{rawChunks}) {
+		my ($map, $width, $height, $left, $top) = $self->rawRegion(boundingBox([$from, @{$targets}]));
+		return unpack('c*', PathFinding::checkLOS_packed($from->{x} - $left, $from->{y} - $top, pack('v*', map { $_->{x} - $left, $_->{y} - $top } @{$targets}), $tile, $width, $height, $map));
+	}
+	my $packed = pack('v*', map { $_->{x}, $_->{y} } @{$targets});
+	return unpack('c*', PathFinding::checkLOS_packed($from->{x}, $from->{y}, $packed, $tile, $self->{width}, $self->{height}, \$self->{rawMap}, $config{attackVisibilityCache} ? ($self->{visibilityCache} || $self->visibilityCache) : undef));
+}
+
+# Same as canAttack, from one position to every position of the array reference $targets
+# Returns the list of results, in the order of $targets
+sub canAttackMany {
+	my ($self, $pos, $targets, $can_snipe, $range, $clientSight) = @_;
+	return () unless (@{$targets});
+
+	my $tile = $can_snipe ? TILE_WALK|TILE_SNIPE : TILE_WALK;
+	if ($self->{rawChunks}) {
+		my ($map, $width, $height, $left, $top) = $self->rawRegion(boundingBox([$pos, @{$targets}]));
+		return unpack('c*', PathFinding::canAttack_packed($pos->{x} - $left, $pos->{y} - $top, pack('v*', map { $_->{x} - $left, $_->{y} - $top } @{$targets}), $tile, $width, $height, $range, $clientSight, $map));
+	}
+	my $packed = pack('v*', map { $_->{x}, $_->{y} } @{$targets});
+	return unpack('c*', PathFinding::canAttack_packed($pos->{x}, $pos->{y}, $packed, $tile, $self->{width}, $self->{height}, $range, $clientSight, \$self->{rawMap}, $config{attackVisibilityCache} ? ($self->{visibilityCache} || $self->visibilityCache) : undef));
+}
+
+# Finds where to centre a square skill area of $radius blocks cast from $caster with $range, so that it hits the most
+# of the actors in the array reference $actors, with the area centred within $around blocks of $pos
+# Returns the centre as a position hash and the number of actors it hits, or an empty list if no cell can be targeted
+#
+# See PathFinding::bestAreaCenter
+sub bestAreaCenter {
+	my ($self, $caster, $range, $pos, $around, $radius, $actors, $can_snipe) = @_;
+
+	my $tile = $can_snipe ? TILE_WALK|TILE_SNIPE : TILE_WALK;
+	my ($x, $y, $hits) = PathFinding::bestAreaCenter(ActorList::packPositions($actors), $caster->{x}, $caster->{y}, $range, $pos->{x}, $pos->{y}, $around, $radius,
+		$tile, $self->{width}, $self->{height}, $self->rawMap, ($config{attackVisibilityCache} && !$self->{rawChunks}) ? ($self->{visibilityCache} || $self->visibilityCache) : undef);
+	return () unless (defined $hits);
+	return ({ x => $x, y => $y }, $hits);
 }
 
 # Used for checking if there are no obstacles in a given walking solution
@@ -401,6 +972,10 @@ sub canAttack {
 # Reference: hercules src\map\path.c path_search - flag&1
 sub checkPathFree {
 	my ($self, $from, $to) = @_;
+	if ($self->{rawChunks}) {
+		my ($map, $width, $height, $left, $top) = $self->rawRegion($from->{x}, $from->{y}, $to->{x}, $to->{y});
+		return PathFinding::checkPathFree($from->{x} - $left, $from->{y} - $top, $to->{x} - $left, $to->{y} - $top, TILE_WALK, $width, $height, $map);
+	}
 	return PathFinding::checkPathFree($from->{x}, $from->{y}, $to->{x}, $to->{y}, TILE_WALK, $self->{width}, $self->{height}, \$self->{rawMap});
 }
 
@@ -475,46 +1050,24 @@ sub loadFile {
 		FileNotFoundException->throw("File $filename does not exist.");
 	}
 
+	my $weightFile = $filename;
+	$weightFile =~ s/\.fld2(\.gz)?$/.weight/i;
+	my $cacheFile = $filename;
+	$cacheFile =~ s/\.fld2(\.gz)?$/.fldc/i;
+	if ($loadWeightMap && $config{fieldCache} && $self->loadFieldCache($cacheFile, $filename, $weightFile)) {
+		return 1;
+	}
 
-	# Load the field file.
-	my ($fieldData, $width, $height);
-	if ($filename =~ /\.gz$/) {
-		use bytes;
-		no encoding 'utf8';
 
-		my $gz = gzopen($filename, 'rb');
-		if (!$gz) {
-			IOException->throw("Cannot open $filename for reading.");
-		} else {
-			$fieldData = '';
-			while (!$gz->gzeof()) {
-				my $buf;
-				if ($gz->gzread($buf) >= 0) {
-					$fieldData .= $buf;
-				} else {
-					IOException->throw("An error occured while decompressing $filename.");
-				}
-			}
-			$gz->gzclose();
-		}
-
-	} else {
-		my $f;
-		if (open($f, "<", $filename)) {
-			binmode($f);
-			local($/);
-			$fieldData = <$f>;
-			close($f);
-		} else {
-			IOException->throw("Cannot open $filename for reading.");
-		}
+	# Load the field file, it may already have been read in the background by Field->prefetch().
+	my ($fieldData, $width, $height, @maps) = Utils::takePrefetchedField($filename);
+	($fieldData, $width, $height) = Utils::inflateField($filename) unless (defined $fieldData);
+	if (!defined $fieldData) {
+		IOException->throw("Cannot read $filename.");
 	}
 
-	($width, $height) = unpack("v v", substr($fieldData, 0, 4, ''));
-
 	# Load the associated weight map (.weight file)
-	my $weightFile = $filename;
-	$weightFile =~ s/\.fld2(\.gz)?$/.weight/i;
+	my ($neighborMask, $components);
 	if ($loadWeightMap) {
 		if ((!-f $weightFile && !-f $weightFile.'.gz') || !$self->loadWeightMap($weightFile, $width, $height)) {
 			
@@ -522,9 +1075,13 @@ sub loadFile {
 			my $distFile = $filename;
 			$distFile =~ s/\.fld2(\.gz)?$/.dist/i;
 			if ((!-f $distFile && !-f $distFile.'.gz') || !$self->loadDistanceMap($distFile, $width, $height)) {
-				# (Re)create the distance map.
+				# (Re)create the distance map, together with the weight map and neighbor mask.
 				my $f;
-				$self->{dstMap} = Utils::makeDistMap($fieldData, $width, $height);
+				if (@maps) {
+					($self->{dstMap}, $self->{weightMap}, $neighborMask, $components) = @maps;
+				} else {
+					($self->{dstMap}, $self->{weightMap}, $neighborMask) = Utils::makeFieldMaps($fieldData, $width, $height);
+				}
 				if (open($f, ">", $distFile)) {
 					binmode $f;
 					print $f pack("a2 v1", 'V#', 4);
@@ -536,7 +1093,7 @@ sub loadFile {
 			
 			# (Re)create the weight map.
 			my $f;
-			$self->{weightMap} = Utils::makeWeightMap($self->{dstMap}, $width, $height);
+			$self->{weightMap} = Utils::makeWeightMap($self->{dstMap}, $width, $height) unless (defined $neighborMask);
 			if (open($f, ">", $weightFile)) {
 				binmode $f;
 				print $f pack("a2 v1", 'V#', 1);
@@ -551,12 +1108,224 @@ sub loadFile {
 		delete $self->{weightMap};
 	}
 
+	$self->clearDerivedData($filename, $weightFile, $width, $height);
+	$self->{neighborMask} = $neighborMask if (defined $neighborMask);
+	$self->{components} = $components if (defined $components);
+	$self->{rawMap} = $fieldData;
+	if ($loadWeightMap && $config{fieldCache}) {
+		$self->{fieldCacheFile} = $cacheFile;
+		$self->{fieldCacheSource} = $filename;
+		# Switch to the mapped maps right away, so the first bot which loads a field shares its memory with the next ones too
+		if ($self->saveFieldCache($cacheFile, $filename)) {
+			$self->loadFieldCache($cacheFile, $filename, $weightFile);
+		}
+	}
+	# Keep the raw map in compressed chunks if it isn't mapped from the field cache, see $Field->rawRegion()
+	if ($config{fieldChunks} && !$self->{fieldCache}) {
+		$self->{rawChunks} = Utils::FieldChunks->new(\$self->{rawMap}, $width, $height, $config{fieldChunks});
+		delete $self->{rawMap} if ($self->{rawChunks});
+	}
+	return 1;
+}
+
+# Forgets everything derived from the previously loaded field and sets the names of the new one.
+sub clearDerivedData {
+	my ($self, $filename, $weightFile, $width, $height) = @_;
+
+	delete $self->{neighborMask};
+	delete $self->{components};
+	delete $self->{abstractGraph};
+	delete $self->{distanceFields};
+	delete $self->{walkablePrefix};
+	delete $self->{landmarks};
+	delete $self->{weightProfiles};
+	delete $self->{visibilityCache};
+	delete $self->{dangerMap};
+	delete $self->{tileMap};
+	delete $self->{tileBits};
+	delete $self->{rawChunks};
+	delete $self->{fieldCache};
+	delete $self->{fieldCacheFile};
+	delete $self->{fieldCacheSource};
+	$self->{abstractGraphFile} = $weightFile;
+	$self->{abstractGraphFile} =~ s/\.weight$/.hpa/i;
+	$self->{componentsFile} = $weightFile;
+	$self->{componentsFile} =~ s/\.weight$/.comp/i;
 	$self->{width}  = $width;
 	$self->{height} = $height;
-	$self->{rawMap} = $fieldData;
 	(undef, undef, $self->{baseName}) = File::Spec->splitpath($filename);
 	$self->{baseName} =~ s/\.fld2$//i;
 	$self->{name} = $self->{baseName};
+}
+
+##
+# boolean $Field->loadFieldCache(String filename, String source, String weightFile)
+# filename: The filename of the field cache (.fldc file).
+# source: The field file the cache was made from.
+# weightFile: The filename of the field's weight map, other files are named after it.
+# Returns: Whether the field was loaded from the cache. If not, it should be loaded from the field file.
+#
+# A field cache holds the raw map, weight map, neighbor mask, connected areas and, once it
+# has been built, the hierarchical pathfinding graph of a field in a single uncompressed file
+# (see src/auto/XSTools/misc/fieldcache.h). The file is mapped in memory instead of being read,
+# so the maps are not copied, and bots on the same host share the memory of the fields they
+# have in common: the pages of the file are only copied for a bot which modifies them.
+#
+# The cache is only used if the field file has the same size and modification time as
+# when the cache was written, see also Field->refreshFieldCaches().
+sub loadFieldCache {
+	my ($self, $filename, $source, $weightFile) = @_;
+
+	my $cache = openFieldCache($filename, $source);
+	return 0 unless ($cache);
+
+	$self->clearDerivedData($source, $weightFile, $cache->width, $cache->height);
+	$cache->attach(FIELD_CACHE_RAW, $self, 'rawMap');
+	$cache->attach(FIELD_CACHE_WEIGHT, $self, 'weightMap');
+	$cache->attach(FIELD_CACHE_NEIGHBOR_MASK, $self, 'neighborMask');
+	$cache->attach(FIELD_CACHE_COMPONENTS, $self, 'components');
+	$self->{fieldCache} = $cache;
+	$self->{fieldCacheFile} = $filename;
+	$self->{fieldCacheSource} = $source;
+	return 1;
+}
+
+# Opens a field cache, returns undef if it does not exist, is out of date or lacks one of the maps of a field.
+sub openFieldCache {
+	my ($filename, $source) = @_;
+
+	return undef unless (-f $filename);
+	my $cache = Utils::FieldCache->open($filename);
+	return undef unless ($cache);
+	my ($size, $time) = (stat($source))[7, 9];
+	return undef if ($cache->sourceSize != $size || $cache->sourceTime != ($time & 0xFFFFFFFF));
+	return undef unless (grep { $cache->hasLayer($_) } FIELD_CACHE_RAW, FIELD_CACHE_WEIGHT, FIELD_CACHE_NEIGHBOR_MASK, FIELD_CACHE_COMPONENTS) == 4;
+	return $cache;
+}
+
+##
+# (int, int) Field->refreshFieldCaches([String folder])
+# folder: The folder of the field files and their caches, $Settings::fields_folder by default.
+# Returns: the number of field caches which are up to date again, and the number of those which are out of date.
+#
+# The field caches of field files whose modification time changed, but not their contents, as after
+# copying or checking out the fields folder, are marked up to date again instead of being written
+# again when their field is loaded. The contents are compared with the hash of the field file each
+# cache holds; the field files are hashed at once on several native threads, see
+# Utils::Whirlpool::hashFiles().
+sub refreshFieldCaches {
+	my ($class, $folder) = @_;
+	$folder = $Settings::fields_folder if (!defined $folder);
+	$folder = File::Spec->curdir if (!defined $folder || $folder eq '');
+	my $dir;
+	return (0, 0) unless (opendir($dir, $folder));
+	my @cacheFiles = map { File::Spec->catfile($folder, $_) } grep { /\.fldc$/i } readdir($dir);
+	closedir($dir);
+
+	my (@changed, $stale);
+	foreach my $cacheFile (@cacheFiles) {
+		my $base = $cacheFile;
+		$base =~ s/\.fldc$//i;
+		my ($source) = grep { -f $_ } ("$base.fld2", "$base.fld2.gz");
+		next unless (defined $source);
+		my $cache = Utils::FieldCache->open($cacheFile);
+		next unless ($cache);
+		my ($size, $time) = (stat($source))[7, 9];
+		next if ($cache->sourceSize == $size && $cache->sourceTime == ($time & 0xFFFFFFFF));
+
+		my %layer;
+		if ($cache->sourceSize == $size && $cache->attach(FIELD_CACHE_SOURCE_HASH, \%layer, 'hash')) {
+			# Copied, the mapping is released before the file is written
+			push @changed, [$cacheFile, $source, "$layer{hash}", $time];
+		} else {
+			$stale++;
+		}
+	}
+
+	my @hashes = Utils::Whirlpool::hashFiles([map { $_->[1] } @changed]);
+	my $refreshed = 0;
+	for my $i (0 .. $#changed) {
+		my ($cacheFile, $source, $hash, $time) = @{$changed[$i]};
+		my $f;
+		if (defined $hashes[$i] && $hashes[$i] eq $hash && open($f, "+<", $cacheFile)) {
+			binmode $f;
+			# The source time of the header
+			if (seek($f, 20, 0) && print $f pack("V", $time & 0xFFFFFFFF)) {
+				$refreshed++;
+			} else {
+				$stale++;
+			}
+			close($f);
+		} else {
+			$stale++;
+		}
+	}
+	return ($refreshed, $stale || 0);
+}
+
+##
+# boolean $Field->saveFieldCache(String filename, String source)
+# filename: The filename of the field cache (.fldc file).
+# source: The field file the maps were loaded from.
+# Returns: Whether the file could be written.
+#
+# Writes the field cache of the loaded field, see $Field->loadFieldCache(). The neighbor
+# mask and the connected areas are built if needed, the hierarchical pathfinding graph, the
+# landmark tables and the weight profile maps are only stored if they are already loaded or
+# in the cache the field was loaded from.
+sub saveFieldCache {
+	my ($self, $filename, $source) = @_;
+	return 0 unless (defined $self->{weightMap});
+
+	my @layers = (
+		[FIELD_CACHE_RAW, $self->rawMap],
+		[FIELD_CACHE_WEIGHT, \$self->{weightMap}],
+		[FIELD_CACHE_NEIGHBOR_MASK, $self->neighborMask],
+		[FIELD_CACHE_COMPONENTS, $self->components],
+	);
+	push @layers, [FIELD_CACHE_HPA, \$self->{abstractGraph}->serialize] if ($self->{abstractGraph});
+	push @layers, [FIELD_CACHE_LANDMARKS, \$self->{landmarks}] if (defined $self->{landmarks});
+	push @layers, map { [$_->{layer}, \$_->{map}] } grep { defined $_->{map} } values %{$self->{weightProfiles} || {}};
+	my $sourceHash = whirlpool_file($source);
+	push @layers, [FIELD_CACHE_SOURCE_HASH, \$sourceHash] if (defined $sourceHash);
+
+	# The layers of the cache the field was loaded from which are not loaded are kept, with up to WEIGHT_PROFILE_CACHE_SIZE
+	# weight profile maps of other bots
+	if (my $cache = $self->{fieldCache}) {
+		my %written = map { $_->[0] => 1 } @layers;
+		my $profiles = 0;
+		for my $id (grep { !$written{$_} } $cache->layers) {
+			next if (($id & FIELD_CACHE_WEIGHT_PROFILE) && $profiles++ >= WEIGHT_PROFILE_CACHE_SIZE);
+			my %layer;
+			push @layers, [$id, \$layer{data}] if ($cache->attach($id, \%layer, 'data'));
+		}
+	}
+
+	# Every layer starts on a page boundary and is followed by at least one zero byte
+	my ($size, $time) = (stat($source))[7, 9];
+	my $offset = FIELD_CACHE_ALIGNMENT;
+	my $header = pack("a4 V v v V V V", 'FLDC', FIELD_CACHE_VERSION, $self->{width}, $self->{height}, scalar @layers, $size, $time & 0xFFFFFFFF);
+	my @offsets;
+	for my $layer (@layers) {
+		push @offsets, $offset;
+		$header .= pack("V V V", $layer->[0], $offset, length ${$layer->[1]});
+		$offset += (int(length(${$layer->[1]}) / FIELD_CACHE_ALIGNMENT) + 1) * FIELD_CACHE_ALIGNMENT;
+	}
+
+	# Written to a temporary file first, processes which mapped the old file keep it
+	my $f;
+	my $temp = "$filename.$$";
+	return 0 unless (open($f, ">", $temp));
+	binmode $f;
+	print $f $header, "\0" x (FIELD_CACHE_ALIGNMENT - length $header);
+	for my $i (0 .. $#layers) {
+		my $length = length ${$layers[$i][1]};
+		print $f ${$layers[$i][1]}, "\0" x (FIELD_CACHE_ALIGNMENT - $length % FIELD_CACHE_ALIGNMENT);
+	}
+	if (!close($f) || !rename($temp, $filename)) {
+		unlink $temp;
+		return 0;
+	}
 	return 1;
 }
 
@@ -722,6 +1491,20 @@ sub loadByName {
 	my $baseName;
 	($baseName, $self->{instanceID}) = $self->nameToBaseName($name);
 	$self->{baseName} = $baseName;
+	my $file = $self->findFile;
+
+	if (defined $file) {
+		$self->loadFile($file, $loadWeightMap);
+		$self->{baseName} = $baseName;
+		$self->{name} = $name;
+	} else {
+		FileNotFoundException->throw("No corresponding field file found for field '$name'.");
+	}
+}
+
+# Returns the field file of $self->baseName, undef if there is none.
+sub findFile {
+	my ($self) = @_;
 	my $file = $self->sourceName . ".fld2";
 
 	if ($Settings::fields_folder) {
@@ -730,14 +1513,38 @@ sub loadByName {
 	if (! -f $file) {
 		$file .= ".gz";
 	}
+	return (-f $file) ? $file : undef;
+}
 
-	if (-f $file) {
-		$self->loadFile($file, $loadWeightMap);
-		$self->{baseName} = $baseName;
-		$self->{name} = $name;
-	} else {
-		FileNotFoundException->throw("No corresponding field file found for field '$name'.");
+##
+# int Field->prefetch(String name...)
+# Returns: the number of fields which started loading.
+#
+# Starts reading the field files of the given fields in a native background thread, and
+# building their maps if they have no weight or distance map file yet, so that loading
+# one of these fields later only takes the results instead of stalling the bot. Fields
+# which are in an up to date field cache are skipped, mapping the cache is already fast.
+#
+# Results which are never taken are dropped once more fields are prefetched,
+# see src/auto/XSTools/misc/fieldprefetch.h.
+sub prefetch {
+	my ($class, @names) = @_;
+	my $count = 0;
+
+	foreach my $name (@names) {
+		my $self = bless {}, $class;
+		($self->{baseName}) = $self->nameToBaseName($name);
+		my $file = $self->findFile;
+		next unless (defined $file);
+		$file =~ s/\//\\/g if ($^O eq 'MSWin32');
+
+		my $base = $file;
+		$base =~ s/\.fld2(\.gz)?$//i;
+		next if ($config{fieldCache} && openFieldCache("$base.fldc", $file));
+		my $buildMaps = !grep { -f $_ } map { ("$base.$_", "$base.$_.gz") } qw(weight dist);
+		$count++ if (Utils::prefetchField($file, $buildMaps ? 1 : 0));
 	}
+	return $count;
 }
 
 # Map a field name to its field file's base name.
@@ -794,6 +1601,41 @@ sub sourceName {
 
 ### CATEGORY: Map image API
 
+##
+# String $Field->imageRGB()
+# Returns: the map image as RGB data, 3 bytes per block starting with the top row, as made by Utils::fieldImage().
+#
+# The image is rendered once per field and kept with it, so map viewers can make their bitmaps from it
+# without an image file in between.
+sub imageRGB {
+	my ($self) = @_;
+	return $self->{imageRGB} ||= Utils::fieldImage(${$self->rawMap}, $self->width, $self->height);
+}
+
+##
+# String $Field->imageXPM()
+# Returns: the map image as XPM text, as made by Utils::xpmmake().
+#
+# Like $Field->imageRGB(), the image is rendered once per field.
+sub imageXPM {
+	my ($self) = @_;
+	return $self->{imageXPM} ||= Utils::xpmmake($self->width, $self->height, ${$self->rawMap});
+}
+
+##
+# String $Field->imageFile(String formats)
+# formats: comma separated image formats, in order of preference.
+# Returns: path to an existing map image file in one of the formats, or undef.
+sub imageFile {
+	my ($self, $search) = @_;
+	my $name = $self->sourceName;
+
+	for (map { File::Spec->catfile($Settings::maps_folder, "$name.$_") } split /\s*,\s*/, $search) {
+		return $_ if -f;
+	}
+	return undef;
+}
+
 ##
 # String $Field->image([String format])
 # format: image format
@@ -810,9 +1652,8 @@ sub image {
 		$format = 'xpm';
 	}
 
-	for (map { File::Spec->catfile($Settings::maps_folder, "$name.$_") } split /\s*,\s*/, $search) {
-		return $_ if -f;
-	}
+	my $existing = $self->imageFile($search);
+	return $existing if $existing;
 
 	if (!-d $Settings::maps_folder) {
 		if (!File::Path::make_path($Settings::maps_folder)) {
@@ -820,13 +1661,14 @@ sub image {
 		}
 	}
 
-	my $xpmFile = File::Spec->catfile($Settings::maps_folder, "$name.xpm");
-	return unless open my $f, '>', $xpmFile;
-	binmode $f;
-	print $f Utils::xpmmake($self->width, $self->height, $self->{rawMap});
-	close $f;
-
-	return $xpmFile if $format eq 'xpm';
+	if ($format eq 'xpm') {
+		my $xpmFile = File::Spec->catfile($Settings::maps_folder, "$name.xpm");
+		return unless open my $f, '>', $xpmFile;
+		binmode $f;
+		print $f $self->imageXPM;
+		close $f;
+		return $xpmFile;
+	}
 
 	undef $@;
 	eval q(use Wx ':everything');
@@ -839,7 +1681,7 @@ sub image {
 	);
 
 	my $file = File::Spec->catfile($Settings::maps_folder, "$name.$format");
-	my $image = Wx::Image->newNameType($xpmFile, eval 'wxBITMAP_TYPE_ANY()');
+	my $image = Wx::Image->newData($self->width, $self->height, $self->imageRGB);
 	$image->SaveFile($file, $wxImageType{$format});
 
 	return $file;
@@ -39,6 +39,10 @@ sub new {
 	if ($^O eq 'MSWin32') {
 		$mod = 'Interface::Console::Win32';
 		
+	} elsif ($Settings::log_sink) {
+		# Headless: nobody watches the terminal
+		$mod = 'Interface::Console::Sink';
+
 	# manual suggests that to run on both threaded and non-threaded Perl
 	# but it creates segfault on exit (FreeBSD, threaded Perl 5.10.1)
 	# so using Console::Simple if Console::Unix doesn't work depends on user
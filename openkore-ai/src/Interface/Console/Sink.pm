@@ -0,0 +1,70 @@
+#########################################################################
+#  OpenKore - Interface::Console::Sink
+#  Headless interface which writes log records for a collector.
+#
+#  This program is free software; you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation; either version 2 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#########################################################################
+##
+# MODULE DESCRIPTION: Headless log sink interface
+#
+# An interface for bots which run on servers, where no one watches the
+# terminal. Instead of coloring and printing every message, messages are
+# handed to a native writer thread (see src/auto/XSTools/unix/logsink.h),
+# which writes them as JSON or binary records to a memory-mapped ring file
+# or to a Unix datagram socket.
+#
+# Interface::Console uses this interface when the --log-sink option is given:
+# <pre class="example">
+# openkore.pl --log-sink=ring:logs/console.ring
+# openkore.pl --log-sink=unix:/run/openkore/log.sock --log-sink-format=binary
+# </pre>
+# Input is still read from stdin, when there is one.
+package Interface::Console::Sink;
+
+use strict;
+use warnings;
+
+use Interface;
+use base 'Interface::Console::Simple';
+use Utils::Unix;
+
+sub new {
+	my ($class) = @_;
+	Utils::Unix::LogSink::open($Settings::log_sink, $Settings::log_sink_format || 'json');
+	return bless {}, $class;
+}
+
+sub DESTROY {
+	Utils::Unix::LogSink::close();
+}
+
+sub writeOutput {
+	my ($self, $type, $message, $domain) = @_;
+	Utils::Unix::LogSink::write($type, defined $domain ? $domain : '', $message);
+}
+
+sub errorDialog {
+	my ($self, $message) = @_;
+	$self->writeOutput("error", $message . "\n");
+	Utils::Unix::LogSink::flush();
+}
+
+sub title {
+	my ($self, $title) = @_;
+
+	if ($title) {
+		$self->{title} = $title;
+	} else {
+		return $self->{title};
+	}
+}
+
+1;
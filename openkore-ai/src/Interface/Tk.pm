@@ -1323,7 +1323,7 @@ sub loadMap {
 	$self->{map}{'canvas'}->createText(50,20,-text =>'Processing..',-tags=>'map');
 
 	my $name = $field->baseName;
-	$self->{map}{'map'} = $self->{map}{'canvas'}->Photo(-format => 'xpm', -data => Utils::xpmmake($field->width, $field->height, $field->{rawMap}));
+	$self->{map}{'map'} = $self->{map}{'canvas'}->Photo(-format => 'xpm', -data => $field->imageXPM);
 
 	$self->{map}{'canvas'}->delete('map');
 	$self->{map}{'canvas'}->createImage(2,2,-image =>$self->{map}{'map'},-anchor => 'nw',-tags=>'map');
@@ -699,7 +699,7 @@ sub loadMap {
 	} elsif (-f $self->_map("$name.bmp")) {
 		$self->{map}{'map'} = $self->{map}{'canvas'}->Bitmap(-file => $self->_map("$name.bmp"));
 	} else {
-		$self->{map}{'map'} = $self->{map}{'canvas'}->Photo(-format => 'xpm', -data => Utils::xpmmake($field->width, $field->height, $field->{rawMap}));
+		$self->{map}{'map'} = $self->{map}{'canvas'}->Photo(-format => 'xpm', -data => $field->imageXPM);
 	}
 
 	$self->{map}{'canvas'}->delete('map');
@@ -171,7 +171,7 @@ sub setMonsters {
 	my $old = $self->{monsters};
 
 	if (!$old || @{$monsters} != @{$old}) {
-		$self->{needUpdate} = 1;
+		$self->_actorsMoved('monsters', $monsters, 'pos_to', $config{wx_map_namesDetail} || 8);
 		$self->{monsters} = $monsters;
 		return;
 	}
@@ -180,7 +180,7 @@ sub setMonsters {
 		my $pos1 = $monsters->[$i]{pos_to};
 		my $pos2 = $old->[$i]{pos_to};
 		if ($pos1->{x} != $pos2->{x} && $pos1->{y} != $pos2->{y}) {
-			$self->{needUpdate} = 1;
+			$self->_actorsMoved('monsters', $monsters, 'pos_to', $config{wx_map_namesDetail} || 8);
 			$self->{monsters} = $monsters;
 			return;
 		}
@@ -199,7 +199,7 @@ sub setPlayers {
 	my $old = $self->{players};
 
 	if (!$old || @{$players} != @{$old}) {
-		$self->{needUpdate} = 1;
+		$self->_actorsMoved('players', $players, 'pos_to', $config{wx_map_playerNameZoom} || 8);
 		$self->{players} = $players;
 		return;
 	}
@@ -208,7 +208,7 @@ sub setPlayers {
 		my $pos1 = $players->[$i]{pos_to};
 		my $pos2 = $old->[$i]{pos_to};
 		if ($pos1->{x} != $pos2->{x} && $pos1->{y} != $pos2->{y}) {
-			$self->{needUpdate} = 1;
+			$self->_actorsMoved('players', $players, 'pos_to', $config{wx_map_playerNameZoom} || 8);
 			$self->{players} = $players;
 			return;
 		}
@@ -244,7 +244,7 @@ sub setNPCs {
 	my $old = $self->{npcs};
 
 	if (!$old || @{$npcs} != @{$old}) {
-		$self->{needUpdate} = 1;
+		$self->_actorsMoved('npcs', $npcs, 'pos', $config{wx_map_namesDetail} || 8);
 		$self->{npcs} = $npcs;
 		return;
 	}
@@ -253,7 +253,7 @@ sub setNPCs {
 		my $pos1 = $npcs->[$i]{pos};
 		my $pos2 = $old->[$i]{pos};
 		if ($pos1->{x} != $pos2->{x} && $pos1->{y} != $pos2->{y}) {
-			$self->{needUpdate} = 1;
+			$self->_actorsMoved('npcs', $npcs, 'pos', $config{wx_map_namesDetail} || 8);
 			$self->{npcs} = $npcs;
 			return;
 		}
@@ -266,7 +266,7 @@ sub setSlaves {
 	my $old = $self->{slaves};
 
 	if (!$old || @{$slaves} != @{$old}) {
-		$self->{needUpdate} = 1;
+		$self->_actorsMoved('slaves', $slaves, 'pos_to');
 		$self->{slaves} = $slaves;
 		return;
 	}
@@ -275,7 +275,7 @@ sub setSlaves {
 		my $pos1 = $slaves->[$i]{pos_to};
 		my $pos2 = $old->[$i]{pos_to};
 		if ($pos1->{x} != $pos2->{x} && $pos1->{y} != $pos2->{y}) {
-			$self->{needUpdate} = 1;
+			$self->_actorsMoved('slaves', $slaves, 'pos_to');
 			$self->{slaves} = $slaves;
 			return;
 		}
@@ -300,7 +300,15 @@ sub update {
 	my $self = shift;
 	if ($self->{needUpdate}) {
 		$self->{needUpdate} = 0;
+		delete $self->{dirty};
 		$self->Refresh;
+	} elsif ($self->{dirty}) {
+		# Only actors moved, so only the areas around their old and new positions are repainted
+		my $margin = 2 * $self->{actorSize} + 2;
+		foreach my $pos (@{delete $self->{dirty}}) {
+			my ($x, $y) = $self->_posXYToView(@{$pos});
+			$self->RefreshRect(new Wx::Rect($x - $margin, $y - $margin, 2 * $margin + 1, 2 * $margin + 1), 0);
+		}
 	}
 }
 
@@ -353,6 +361,22 @@ sub parsePortals {
 
 #### Private ####
 
+# Remembers the positions of a list of actors and marks them and the previous ones for repainting.
+# The whole view is repainted when names are drawn next to the actors, or when too many of them moved.
+sub _actorsMoved {
+	my ($self, $layer, $actors, $key, $nameZoom) = @_;
+	my @positions = map { [$_->{$key}{x}, $_->{$key}{y}] } grep { $_->{$key} } @{$actors};
+	my $old = $self->{actorPositions}{$layer};
+	$self->{actorPositions}{$layer} = \@positions;
+
+	if (!$old || !$self->{view}{xscale} || ($nameZoom && $self->{zoom} >= $nameZoom)
+	 || @{$self->{dirty} || []} + @{$old} + @positions > 64) {
+		$self->{needUpdate} = 1;
+	} else {
+		push @{$self->{dirty}}, @{$old}, @positions;
+	}
+}
+
 sub _onResize {
 	my $self = shift;
 	$self->{needUpdate} = 1;
@@ -408,7 +432,12 @@ sub _updateBitmap {
 	my ($self) = @_;
 	
 	undef $self->{bitmap};
-	$self->{bitmap} = $self->_loadMapImage ($self->{field}{object});
+	# The unscaled image is kept for the current field, so zooming doesn't load it again
+	if (!$self->{image} || $self->{image}{field} ne $self->{field}{name}) {
+		my $image = $self->_loadMapImage ($self->{field}{object});
+		$self->{image} = $image && { field => $self->{field}{name}, image => $image };
+	}
+	$self->{bitmap} = $self->{image} && _makeBitmap($self->{image}{image}, $self->{zoom});
 	return unless $self->{bitmap};
 	
 	my ($w, $h) = ($self->{bitmap}->GetWidth, $self->{bitmap}->GetHeight);
@@ -456,20 +485,29 @@ sub _loadImage {
 # 		$addedHandlers{$ext} = 1;
 # 	}
 
-	my $image = Wx::Image->newNameType($file, wxBITMAP_TYPE_ANY);
+	return _makeBitmap(Wx::Image->newNameType($file, wxBITMAP_TYPE_ANY), $scale);
+}
+
+sub _makeBitmap {
+	my ($image, $scale) = @_;
 	
 	if ($scale && $scale != 1) {
-		$image->Rescale ($image->GetWidth * $scale, $image->GetHeight * $scale);
+		$image = $image->Scale ($image->GetWidth * $scale, $image->GetHeight * $scale);
 	}
 	
 	my $bitmap = new Wx::Bitmap($image);
 	return ($bitmap && $bitmap->Ok()) ? $bitmap : undef;
 }
 
+# Unscaled image of a field, from the maps folder if there is one or else rendered from the field data
 sub _loadMapImage {
 	my $self = shift;
 	my $field = shift;
-	return _loadImage($field->image, $self->{zoom});
+	
+	if (my $file = $field->imageFile('jpg, png, bmp, xpm')) {
+		return Wx::Image->newNameType($file, wxBITMAP_TYPE_ANY);
+	}
+	return Wx::Image->newData($field->width, $field->height, $field->imageRGB);
 }
 
 sub _drawArrow {
@@ -577,8 +615,13 @@ sub _onPaint {
 	
 	return unless $self->{bitmap};
 	
+	# The drawing buffer is kept between paints while the size doesn't change
+	my ($width, $height) = $paintDC->GetSizeWH;
+	if (!$self->{buffer} || $self->{buffer}->GetWidth != $width || $self->{buffer}->GetHeight != $height) {
+		$self->{buffer} = new Wx::Bitmap ($width, $height);
+	}
 	my $dc = new Wx::MemoryDC ();
-	$dc->SelectObject (new Wx::Bitmap ($paintDC->GetSizeWH));
+	$dc->SelectObject ($self->{buffer});
 	
 	my ($portal_r, $actor_r) = ($self->{portalSize}, $self->{actorSize});
 	my ($portal_d, $actor_d) = map {$_ * 2} ($portal_r, $actor_r);
@@ -805,7 +848,8 @@ sub _onPaint {
 		$dc->DrawEllipse($x - 5, $y - 5, 10, 10);
 	}
 	
-	$paintDC->Blit (0, 0, $paintDC->GetSizeWH, $dc, 0, 0);
+	$paintDC->Blit (0, 0, $width, $height, $dc, 0, 0);
+	$dc->SelectObject (wxNullBitmap);
 }
 
 1;
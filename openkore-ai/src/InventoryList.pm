@@ -19,6 +19,11 @@
 #
 # <h3>Differences compared to ActorList</h3>
 # All items are @CLASS(Actor::Item).
+#
+# The items are indexed by lowercased name, nameID and type, so looking them
+# up by any of these doesn't go through the whole list. Names changed with
+# $Actor->setName() are indexed again by themselves; call reindex() after
+# changing the name, nameID or type of an item in the list otherwise.
 package InventoryList;
 
 use strict;
@@ -59,8 +64,25 @@ sub new {
 	#             defined(get($i))
 	#             get($i)->{binID} == $i
 	#             $i is unique in the entire nameIndex.
+	#         $v is sorted, so its first item is the first one with that name in this list.
 	$self->{nameIndex} = {};
 
+	# Hash<int, Array<int>> nameIDIndex
+	# Hash<int, Array<int>> typeIndex
+	# Map the nameID and the type of the items to lists of item indices,
+	# with the same invariants as nameIndex. Items without a type aren't in
+	# typeIndex.
+	$self->{nameIDIndex} = {};
+	$self->{typeIndex} = {};
+
+	# Hash<int, Array> indexKeys
+	# The name, nameID and type keys each item is indexed under, so that
+	# it's found in the indices when these change.
+	#
+	# Invariant:
+	#     scalar(keys indexKeys) == size()
+	$self->{indexKeys} = {};
+
 	# Hash<int, Scalar> nameChangeEvents
 	# InventoryList watches for name change events in all of its
 	# items. This variable maps an item index in this list to the
@@ -109,9 +131,7 @@ sub add {
 
 	my $binID = $self->SUPER::add($item);
 	$item->{binID} = $binID;
-
-	my $indexSlot = $self->getNameIndexSlot($item->{name});
-	push @{$indexSlot}, $binID;
+	$self->addToIndices($item);
 
 	my $eventID = $item->onNameChange->add($self, \&onNameChange);
 	$self->{nameChangeEvents}{$binID} = $eventID;
@@ -146,13 +166,7 @@ if (DEBUG) {
 sub getByName {
 	my ($self, $name, $onlyIdentified) = @_;
 	assert(defined $name, "This method requires a defined item name") if DEBUG;
-	for my $item (@$self) {
-		next unless (!$onlyIdentified || $item->{identified});
-		if (lc($item->{name}) eq lc($name)) {
-			return $item;
-		}
-	}
-	return undef;
+	return $self->getFirstIndexed($self->{nameIndex}{lc($name)}, $onlyIdentified);
 }
 
 ##
@@ -163,14 +177,7 @@ sub getByName {
 sub sumByName {
 	my ($self, $name, $onlyIdentified) = @_;
 	assert(defined $name, "This method requires a defined item name") if DEBUG;
-	my $sum = 0;
-	for my $item (@$self) {
-		next unless (!$onlyIdentified || $item->{identified});
-		if (lc($item->{name}) eq lc($name)) {
-			$sum = $sum + $item->{amount};
-		}
-	}
-	return $sum;
+	return $self->sumIndexed($self->{nameIndex}{lc($name)}, $onlyIdentified);
 }
 
 ##
@@ -180,13 +187,7 @@ sub sumByName {
 # If nothing is found, undef is returned.
 sub getByNameID {
 	my ($self, $nameID, $onlyIdentified) = @_;
-	for my $item (@$self) {
-		next unless (!$onlyIdentified || $item->{identified});
-		if ($item->{nameID} == $nameID) {
-			return $item;
-		}
-	}
-	return undef;
+	return $self->getFirstIndexed($self->{nameIDIndex}{numericKey($nameID)}, $onlyIdentified);
 }
 
 ##
@@ -196,14 +197,18 @@ sub getByNameID {
 # If nothing is found, 0 is returned.
 sub sumByNameID {
 	my ($self, $nameID, $onlyIdentified) = @_;
-	my $sum = 0;
-	for my $item (@$self) {
-		next unless (!$onlyIdentified || $item->{identified});
-		if ($item->{nameID} == $nameID) {
-			$sum = $sum + $item->{amount};
-		}
-	}
-	return $sum;
+	return $self->sumIndexed($self->{nameIDIndex}{numericKey($nameID)}, $onlyIdentified);
+}
+
+##
+# Array<Actor::Item> $InventoryList->getByType(int type)
+#
+# Returns the items of a given type, such as 10 for arrows, in the order of
+# this list.
+sub getByType {
+	my ($self, $type) = @_;
+	my $indexSlot = $self->{typeIndex}{numericKey($type)};
+	return $indexSlot ? map { $self->get($_) } @{$indexSlot} : ();
 }
 
 ##
@@ -296,18 +301,7 @@ sub remove {
 
 	my $result = $self->SUPER::remove($item);
 	if ($result) {
-		my $indexSlot = $self->getNameIndexSlot($item->{name});
-
-		if (@{$indexSlot} == 1) {
-			delete $self->{nameIndex}{lc($item->{name})};
-		} else {
-			for (my $i = 0; $i < @{$indexSlot}; $i++) {
-				if ($indexSlot->[$i] == $item->{binID}) {
-					splice(@{$indexSlot}, $i, 1);
-					last;
-				}
-			}
-		}
+		$self->removeFromIndices($item->{binID});
 
 		my $eventID = $self->{nameChangeEvents}{$item->{binID}};
 		delete $self->{nameChangeEvents}{$item->{binID}};
@@ -348,6 +342,9 @@ sub doClear {
 	}
 	$self->SUPER::doClear();
 	$self->{nameIndex} = {};
+	$self->{nameIDIndex} = {};
+	$self->{typeIndex} = {};
+	$self->{indexKeys} = {};
 	$self->{nameChangeEvents} = {};
 }
 
@@ -362,52 +359,120 @@ sub checkValidity {
 		should(lc($self->getByName($k)->{name}), $k);
 		should(lc $k, $k);
 	}
-	
-	my $sum = 0;
-	my %binIDCount;
-	foreach my $v (values %{$self->{nameIndex}}) {
-		assert(defined $v, "Name-Index hash has undefined ID list");
-		assert(@{$v} > 0, "Name-Index hash has empty ID list");
-		foreach my $i (@{$v}) {
-			assert(defined $i, "ID list in Name-Index hash has undefined ID as element");
-			assert(defined $self->get($i), "Failed to find an ID that is in this InventoryList");
-			assert($self->get($i)->{binID} == $i, "InventoryList has invalid binID in one of its elements");
-			$binIDCount{$i}++;
-			should($binIDCount{$i}, 1);
+	foreach my $k (keys %{$self->{nameIDIndex}}) {
+		should(numericKey($self->getByNameID($k)->{nameID}), $k);
+	}
+	foreach my $k (keys %{$self->{typeIndex}}) {
+		should(numericKey(($self->getByType($k))[0]->{type}), $k);
+	}
+
+	foreach my $index (qw(nameIndex nameIDIndex typeIndex)) {
+		my $sum = 0;
+		my %binIDCount;
+		foreach my $v (values %{$self->{$index}}) {
+			assert(defined $v, "$index hash has undefined ID list");
+			assert(@{$v} > 0, "$index hash has empty ID list");
+			foreach my $i (@{$v}) {
+				assert(defined $i, "ID list in $index hash has undefined ID as element");
+				assert(defined $self->get($i), "Failed to find an ID that is in this InventoryList");
+				assert($self->get($i)->{binID} == $i, "InventoryList has invalid binID in one of its elements");
+				$binIDCount{$i}++;
+				should($binIDCount{$i}, 1);
+			}
+			should(join(',', sort { $a <=> $b } @{$v}), join(',', @{$v}));
+			$sum += @{$v};
 		}
-		$sum += @{$v};
+		should($sum, $index eq 'typeIndex' ? scalar(grep { defined $_->{type} } @$self) : $self->size());
 	}
-	should($sum, $self->size());
+	should(scalar(keys %{$self->{indexKeys}}), $self->size());
 
 	assert(defined $self->{nameChangeEvents}, "Name-change event hash is undefined");
 	should(scalar(keys %{$self->{nameChangeEvents}}), $self->size());
 }
 
-sub getNameIndexSlot {
-	my ($self, $name) = @_;
-	return $self->{nameIndex}{lc($name)} ||= [];
+##
+# void $InventoryList->reindex(Actor::Item item)
+# Requires: $self->find($item) != -1
+#
+# Indexes an item of this list again, after its name, nameID or type changed.
+sub reindex {
+	my ($self, $item) = @_;
+	assert(defined($item->{name}), 'An item must have a name.') if DEBUG;
+	assert(defined($self->{indexKeys}{$item->{binID}}), 'The item must be in this list.') if DEBUG;
+	$self->removeFromIndices($item->{binID});
+	$self->addToIndices($item);
 }
 
-sub onNameChange {
-	my ($self, $item, $args) = @_;
-	assert(defined($item->{name}), 'An item must have a name.');
+# The key of a nameID or type in the indices: the number it's equal to with ==
+sub numericKey {
+	no warnings qw(numeric uninitialized);
+	return $_[0] + 0;
+}
+
+sub addToIndices {
+	my ($self, $item) = @_;
+	my @keys = (lc($item->{name}), numericKey($item->{nameID}),
+		defined($item->{type}) ? numericKey($item->{type}) : undef);
+	my $binID = $item->{binID};
+	$self->{indexKeys}{$binID} = \@keys;
+	indexSlotAdd($self->{nameIndex}, $keys[0], $binID);
+	indexSlotAdd($self->{nameIDIndex}, $keys[1], $binID);
+	indexSlotAdd($self->{typeIndex}, $keys[2], $binID) if (defined $keys[2]);
+}
+
+sub removeFromIndices {
+	my ($self, $binID) = @_;
+	my $keys = delete $self->{indexKeys}{$binID};
+	indexSlotRemove($self->{nameIndex}, $keys->[0], $binID);
+	indexSlotRemove($self->{nameIDIndex}, $keys->[1], $binID);
+	indexSlotRemove($self->{typeIndex}, $keys->[2], $binID) if (defined $keys->[2]);
+}
 
-	my $indexSlot = $self->getNameIndexSlot($args->{oldName});
+# Slots are kept sorted: most items are added at the end of the list, freed
+# indices are taken again first
+sub indexSlotAdd {
+	my ($index, $key, $binID) = @_;
+	my $indexSlot = $index->{$key} ||= [];
+	my $i = @{$indexSlot};
+	$i-- while ($i > 0 && $indexSlot->[$i - 1] > $binID);
+	splice(@{$indexSlot}, $i, 0, $binID);
+}
+
+sub indexSlotRemove {
+	my ($index, $key, $binID) = @_;
+	my $indexSlot = $index->{$key};
 	for (my $i = 0; $i < @{$indexSlot}; $i++) {
-		if ($indexSlot->[$i] == $item->{binID}) {
-			# Delete from old index slot.
+		if ($indexSlot->[$i] == $binID) {
 			splice(@{$indexSlot}, $i, 1);
-			if (@{$indexSlot} == 0) {
-				delete $self->{nameIndex}{lc($args->{oldName})};
-			}
-
-			# Add to new index slot.
-			$indexSlot = $self->getNameIndexSlot($item->{name});
-			push @{$indexSlot}, $item->{binID};
-			return;
+			last;
 		}
 	}
-	assert(0, 'This should never be reached.') if DEBUG;
+	delete $index->{$key} if (!@{$indexSlot});
+}
+
+sub getFirstIndexed {
+	my ($self, $indexSlot, $onlyIdentified) = @_;
+	return undef if (!$indexSlot);
+	foreach my $binID (@{$indexSlot}) {
+		my $item = $self->get($binID);
+		return $item if (!$onlyIdentified || $item->{identified});
+	}
+	return undef;
+}
+
+sub sumIndexed {
+	my ($self, $indexSlot, $onlyIdentified) = @_;
+	my $sum = 0;
+	foreach my $binID (@{$indexSlot || []}) {
+		my $item = $self->get($binID);
+		$sum += $item->{amount} if (!$onlyIdentified || $item->{identified});
+	}
+	return $sum;
+}
+
+sub onNameChange {
+	my ($self, $item) = @_;
+	$self->reindex($item);
 }
 
 # isReady is true if this InventoryList has actionable data. Eg, storage is open, or we have a cart, etc.
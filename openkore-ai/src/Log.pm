@@ -42,6 +42,12 @@
 # The most important functions are:
 # Log::message(), Log::warning(), Log::error(), Log::debug()
 #
+# Messages which are neither printed, written to a file nor given to a hook
+# are dropped right away: the filter has a bit for each domain, type and
+# level, tested in src/auto/XSTools/misc/fastutils.xs. Log::debugf() and the
+# other *f() functions check it before formatting their message, so a
+# disabled debug domain doesn't cost the sprintf.
+#
 # You pass the following arguments to those functions:
 # `l
 # - message: The message you want to print.
@@ -116,7 +122,7 @@ use Globals qw(%config $interface %consoleColors $field);
 use Utils::DataStructures qw(binAdd existsInList);
 use Utils qw(binAdd existsInList getFormattedDate);
 
-our @EXPORT_OK = qw(message warning error debug);
+our @EXPORT_OK = qw(message warning error debug messagef warningf errorf debugf);
 
 
 #################################
@@ -150,6 +156,13 @@ our %debugFiles;
 # Message hooks are stored here
 our @hooks;
 
+# Hash<String, int> filter
+# For each domain logged so far, the types and levels of its messages which
+# are wanted, see compileFilter(). Call Log::resetFilter() after changing
+# any of the variables above, or the config options the filter depends on
+# without Misc::configModify().
+our %filter;
+
 # Enable/disable adding a timestamp to log files.
 our $logTimestamp;
 # Enable/disable adding a timestamp to chat logs.
@@ -174,6 +187,57 @@ sub MODINIT {
 	$chatTimestamp = 1;
 }
 
+# The verbosity, console, files and level override of each message type, in
+# the order of the filter's bits
+sub filterTypes {
+	my ($domain) = @_;
+	my $squelched = existsInList($config{squelchDomains}, $domain);
+	my $verbose = existsInList($config{verboseDomains}, $domain);
+	my $override = $verbose ? 0 : ($squelched ? 5 : undef);
+	return (
+		[$config{verbose}, \%messageConsole, \%messageFiles, $override],
+		[$warningVerbosity, \%warningConsole, \%warningFiles, $override],
+		[$errorVerbosity, \%errorConsole, \%errorFiles, undef],
+		[(defined $config{debug}) ? $config{debug} : 0, \%debugConsole, \%debugFiles,
+			$squelched ? 5 : (existsInList($config{debugDomains}, $domain) ? 0 : undef)],
+	);
+}
+
+##
+# int Log::compileFilter(String domain)
+#
+# Compiles the filter of a domain: bit 8 * type + level is set when the
+# messages of that type and level would be printed, written to a file or
+# given to a hook, the types being message, warning, error and debug. The
+# last bit of a type is for level 7 and up. Returns the bits, which are
+# added to %filter.
+sub compileFilter {
+	my ($domain) = @_;
+	my $all = (grep { defined } @hooks) || existsInList($config{beepDomains}, $domain);
+	my $mask = 0;
+	my $bit = 0;
+	foreach my $type (filterTypes($domain)) {
+		my ($verbosity, $console, $files) = @{$type};
+		$verbosity = 1 if (!defined $verbosity || $verbosity eq "");
+		my $wanted = $all || ($files->{$domain} && @{$files->{$domain}});
+		my $printed = !defined($console->{$domain}) || $console->{$domain};
+		for my $level (0..7) {
+			my $effective = defined $type->[3] ? $type->[3] : $level;
+			$mask |= 1 << $bit if ($wanted || ($printed && $effective <= $verbosity));
+			$bit++;
+		}
+	}
+	return $filter{$domain} = $mask;
+}
+
+##
+# void Log::resetFilter()
+#
+# Forgets the compiled filter; it's compiled again as messages are logged.
+sub resetFilter {
+	%filter = ();
+}
+
 sub processMsg {
 	my $type = shift;
 	my $message = shift;
@@ -270,6 +334,7 @@ sub processMsg {
 # Prints a normal message. See the description for Log.pm for more details
 # about the parameters.
 sub message {
+	return if (!isWanted('message', $_[1], $_[2]));
 	my ($message, $domain, $level) = @_;
 	$domain ||= "console";
 	$level = 5 if existsInList($config{squelchDomains}, $domain);
@@ -290,6 +355,7 @@ sub message {
 # Prints a warning message. It warns the user that a possible non-fatal error has occured or will occur.
 # See the description for Log.pm for more details about the parameters.
 sub warning {
+	return if (!isWanted('warning', $_[1], $_[2]));
 	my ($message, $domain, $level) = @_;
 	$domain ||= "console";
 	$level = 5 if existsInList($config{squelchDomains}, $domain);
@@ -322,6 +388,7 @@ sub warning {
 # `l`
 # See the description for Log.pm for more details about the parameters.
 sub error {
+	return if (!isWanted('error', $_[1], $_[2]));
 	my ($message, $domain, $level) = @_;
 	$domain ||= "console";
 	return processMsg("error",
@@ -340,6 +407,7 @@ sub error {
 #
 # Prints a debugging message. See the description for Log.pm for more details about the parameters.
 sub debug {
+	return if (!isWanted('debug', $_[1], $_[2]));
 	my ($message, $domain, $level) = @_;
 	$domain ||= "console";
 	$level = 1 if (!defined $level);
@@ -355,6 +423,33 @@ sub debug {
 }
 
 
+##
+# Log::messagef(domain, level, format, args...)
+# Log::warningf(domain, level, format, args...)
+# Log::errorf(domain, level, format, args...)
+# Log::debugf(domain, level, format, args...)
+# domain, level: As for Log::message(); either may be undef.
+# format: A sprintf() format, the message once formatted with args.
+#
+# Like Log::message() and the others, but the message is only formatted
+# when it's wanted. For messages in hot code, such as packet handlers:
+# <pre class="example">
+# debugf("parseMsg_presence", 2, "Player %s moved to (%d, %d)\n", $name, $x, $y);
+# </pre>
+#
+# The *f() functions are implemented in src/auto/XSTools/misc/fastutils.xs.
+
+##
+# boolean Log::isWanted(String type, [String domain], [int level])
+# type: One of "message", "warning", "error" or "debug".
+#
+# Whether a message of that type, domain and level would be printed, written
+# to a file or given to a hook. Code which builds a message at some cost can
+# check this first.
+#
+# isWanted() is implemented in src/auto/XSTools/misc/fastutils.xs.
+
+
 ##
 # Log::addHook(r_func, [user_data])
 # r_func: A reference to the function to call.
@@ -401,6 +496,7 @@ sub addHook {
 	my %hook;
 	$hook{func} = $r_func;
 	$hook{user_data} = $user_data;
+	resetFilter();
 	return binAdd(\@hooks, \%hook);
 }
 
@@ -418,6 +514,7 @@ sub addHook {
 sub delHook {
 	my $ID = shift;
 	delete $hooks[$ID];
+	resetFilter();
 }
 
 ##
@@ -452,6 +549,7 @@ sub initLogFiles {
 	parseLogToFile($config{logToFile_Warnings}, \%warningFiles) if $config{logToFile_Warnings};
 	parseLogToFile($config{logToFile_Errors}, \%errorFiles) if $config{logToFile_Errors};
 	parseLogToFile($config{logToFile_Debug}, \%debugFiles) if $config{logToFile_Debug};
+	resetFilter();
 }
 
 
@@ -108,6 +108,7 @@ our @EXPORT = (
 	actorAdded
 	actorRemoved
 	actorListClearing
+	actorIDIndex
 	avoidGM_talk
 	avoidList_talk
 	avoidList_ID
@@ -148,6 +149,7 @@ our @EXPORT = (
 	mon_control
 	monsterName
 	positionNearPlayer
+	nearPlayerPositions
 	positionNearPortal
 	printItemDesc
 	processNameRequestQueue
@@ -350,6 +352,7 @@ sub configModify {
 	}
 	$config{$key} = $val;
 	Settings::update_log_filenames() if $key =~ /^(username|char|server)$/o;
+	Log::resetFilter();
 	saveConfigFile();
 	
 	Plugins::callHook('post_configModify');
@@ -382,6 +385,7 @@ sub bulkConfigModify {
 		}
 
 		$config{$key} = $r_hash->{$key};
+		Log::resetFilter();
 
 		if ($key =~ /password/i) {
 			message TF("Config '%s' set to %s (was *not-displayed*)\n", $key, $r_hash->{$key}), "info" unless ($silent);
@@ -1014,6 +1018,20 @@ EOF
 #######################################
 #######################################
 
+# Utils::IDIndex of the slots in the ID array of each actor type, kept in sync by actorAdded/actorRemoved.
+my %actorIDIndexes;
+
+##
+# Utils::IDIndex actorIDIndex(String type)
+# type: an actor type, as returned by actorAddedRemovedVars: 'item', 'player', 'monster', etc.
+#
+# Returns the index of the ID array of the given actor type, which finds the slot of an actor ID
+# in constant time. $index->find($ID) gives the same slot as binFind(\@monstersID, $ID).
+sub actorIDIndex {
+	my ($type) = @_;
+	return $actorIDIndexes{$type} ||= new Utils::IDIndex();
+}
+
 # TODO: move actorAdded/Removed to Actor?
 sub actorAddedRemovedVars {
 	my ($actor) = @_;
@@ -1069,7 +1087,7 @@ sub actorAdded {
 		}
 		should(binSize($list) + 1, $source->size()) if DEBUG;
 
-		binAdd($list, $actor->{ID});
+		$list->[actorIDIndex($type)->add($actor->{ID})] = $actor->{ID};
 		$hash->{$actor->{ID}} = $actor;
 		objectAdded($type, $actor->{ID}, $actor);
 
@@ -1108,9 +1126,11 @@ sub actorRemoved {
 		}
 		should(binSize($list) - 1, $source->size()) if DEBUG;
 
-		binRemove($list, $actor->{ID});
+		my $slot = actorIDIndex($type)->remove($actor->{ID});
+		delete $list->[$slot] if (defined $slot);
 		delete $hash->{$actor->{ID}};
 		objectRemoved($type, $actor->{ID}, $actor);
+		Field::unstampDanger($actor) if ($actor->{dangerStamp});
 
 		if ($type eq "player" && $venderLists{ID}) {
 			binRemove(\@venderListsID, $actor->{ID});
@@ -1130,6 +1150,9 @@ sub actorRemoved {
 }
 
 sub actorListClearing {
+	my (undef, $source) = @_;
+	# Monsters which are cleared don't go through actorRemoved, the danger they stamped goes with them
+	$field->{dangerMap}->clear if ($source == $monstersList && $field && $field->{dangerMap});
 	undef %items;
 	undef %players;
 	undef %monsters;
@@ -1146,6 +1169,7 @@ sub actorListClearing {
 	undef @petsID;
 	undef @slavesID;
 	undef @elementalsID;
+	$_->clear() foreach (values %actorIDIndexes);
 }
 
 sub calcStat {
@@ -2834,11 +2858,11 @@ sub objectRemoved {
 # If $name has no specific settings, try using the setting for $nameID.
 # If both have no specific setting, use 'all'.
 # If 'all' is not set, return "do nothing" (empty hash);
-sub items_control {
-	my ($name, $nameID) = @_;
-
-	return $items_control{lc($name)} || $items_control{$nameID} || $items_control{all} || {};
-}
+#
+# items_control(), mon_control() and pickupitems() are called for every item
+# and monster the AI looks at, and are implemented in
+# src/auto/XSTools/misc/fastutils.xs: ASCII names are lowercased there without
+# an allocation, and the other names are lowercased by lowercaseName() once.
 
 ##
 # mon_control($name, $nameID)
@@ -2847,11 +2871,6 @@ sub items_control {
 # If $name has no specific settings, try using the setting for $nameID.
 # If both have no specific setting, use 'all'.
 # If 'all' is not set, return "attack";
-sub mon_control {
-	my ($name, $nameID) = @_;
-
-	return $mon_control{lc($name)} || $mon_control{$nameID} || $mon_control{all} || { attack_auto => 1 };
-}
 
 ##
 # pickupitems($name, $nameID)
@@ -2860,41 +2879,47 @@ sub mon_control {
 # If $name has no specific settings, try using the setting for $nameID.
 # If both have no specific setting, use 'all'.
 # If 'all' is not set, return "pick up" (1);
-sub pickupitems {
-	my ($name, $nameID) = @_;
-
-	if (exists $pickupitems{lc($name)}) {
-		return $pickupitems{lc($name)};
-	} elsif (exists $pickupitems{$nameID}) {
-		return $pickupitems{$nameID};
-	} elsif (exists $pickupitems{all}) {
-		return $pickupitems{all};
-	}
 
-	return 1;
+# The lowercased name, for the names items_control() and the others don't lowercase themselves
+sub lowercaseName {
+	return lc $_[0];
 }
 
+##
+# boolean positionNearPlayer(Hash* pos, int dist, [String positions])
+# positions: the result of nearPlayerPositions(), to check several positions without going through the player list for each of them.
+# Returns: whether a player who is neither a party member nor in tankersList is within $dist blocks of $pos.
 sub positionNearPlayer {
-	my $r_hash = shift;
-	my $dist = shift;
+	my ($r_hash, $dist, $positions) = @_;
+	$positions = nearPlayerPositions() unless (defined $positions);
+	my @near = PathFinding::positionsInRange($positions, $r_hash->{x}, $r_hash->{y}, $dist);
+	return @near ? 1 : 0;
+}
 
-	for my $player (@$playersList) {
-		my $ID = $player->{ID};
-		next if ($char->{party}{joined} && $char->{party}{users}{$ID});
-		next if (defined($player->{name}) && existsInList($config{tankersList}, $player->{name}));
-		return 1 if (blockDistance($r_hash, $player->{pos_to}) <= $dist);
-	}
-	return 0;
+##
+# String nearPlayerPositions()
+# Returns: the packed positions of the players positionNearPlayer() looks at,
+#          the ones which are neither party members nor in tankersList.
+#
+# Pass them to positionNearPlayer() when checking many positions in a row,
+# so the player list is only gone through once.
+sub nearPlayerPositions {
+	my @players = grep {
+		!($char->{party}{joined} && $char->{party}{users}{$_->{ID}})
+		&& !(defined($_->{name}) && existsInList($config{tankersList}, $_->{name}))
+	} @$playersList;
+	return ActorList::packPositions(\@players);
 }
 
+##
+# boolean positionNearPortal(Hash* pos, int dist, [String positions])
+# positions: the result of $portalsList->packedPositions('pos'), to check several positions in a row.
+# Returns: whether a portal is within $dist blocks of $pos.
 sub positionNearPortal {
-	my $r_hash = shift;
-	my $dist = shift;
-
-	for my $portal (@$portalsList) {
-		return 1 if (blockDistance($r_hash, $portal->{pos}) <= $dist);
-	}
-	return 0;
+	my ($r_hash, $dist, $positions) = @_;
+	$positions = $portalsList->packedPositions('pos') unless (defined $positions);
+	my @near = PathFinding::positionsInRange($positions, $r_hash->{x}, $r_hash->{y}, $dist);
+	return @near ? 1 : 0;
 }
 
 ##
@@ -3692,12 +3717,20 @@ sub getBestTarget {
 
 	# First of all we check monsters in LOS, then the rest of monsters
 
+	# TODO: Is there any situation where we should use calcPosFromPathfinding or calcPosFromTime here?
+	my @positions = map { calcPosFromPathfinding($field, $monsters{$_}) } @{$possibleTargets};
+	# The lines of sight of all monsters are checked in a single call
+	my @inLOS = $field->checkLOSMany($myPos, \@positions, $attackCanSnipe);
+	my $index = -1;
+	my $playerPositions = nearPlayerPositions();
+	my $portalPositions = $portalsList->packedPositions('pos');
+
 	foreach (@{$possibleTargets}) {
+		$index++;
 		my $monster = $monsters{$_};
-		# TODO: Is there any situation where we should use calcPosFromPathfinding or calcPosFromTime here?
-		my $pos = calcPosFromPathfinding($field, $monster);
-		next if (positionNearPlayer($pos, $playerDist)
-			|| positionNearPortal($pos, $portalDist)
+		my $pos = $positions[$index];
+		next if (positionNearPlayer($pos, $playerDist, $playerPositions)
+			|| positionNearPortal($pos, $portalDist, $portalPositions)
 		);
 		my $control = mon_control($monster->{name},$monster->{nameID});
 		if (defined $control) {
@@ -3720,7 +3753,7 @@ sub getBestTarget {
 		Plugins::callHook('getBestTarget' => \%plugin_args);
 		next if ($plugin_args{return});
 
-		if (!$field->checkLOS($myPos, $pos, $attackCanSnipe)) {
+		if (!$inLOS[$index]) {
 			push(@noLOSMonsters, $_);
 			push(@noLOSMonsters_pos, $pos);
 			next;
@@ -3745,21 +3778,20 @@ sub getBestTarget {
 	if ($attackCheckLOS && !$bestTarget && scalar(@noLOSMonsters) > 0) {
 		my $pathfinding = new PathFinding;
 		my ($min_pathfinding_x, $min_pathfinding_y, $max_pathfinding_x, $max_pathfinding_y) = $field->getSquareEdgesFromCoord($myPos, $config{attackRouteMaxPathDistance});
-		foreach my $index (0..$#noLOSMonsters) {
-			
-			# The most optimal solution is to include the path lenghts' comparison, however it will take
-			# more time and CPU resources, so, we use rough solution with priority and distance comparison
 
-			my $monster = $monsters{$noLOSMonsters[$index]};
-			# TODO: Is there any situation where we should use calcPosFromPathfinding or calcPosFromTime here?
-			my $pos = $noLOSMonsters_pos[$index];
+		# TODO: Is there any situation where we should use calcPosFromPathfinding or calcPosFromTime here?
+		# avoid get targets away from attackRouteMaxPathDistance
+		my @indexes = grep { blockDistance($myPos, $noLOSMonsters_pos[$_]) < $config{attackRouteMaxPathDistance} } 0..$#noLOSMonsters;
 
-			# avoid get targets away from attackRouteMaxPathDistance
-			next if(blockDistance($myPos, $pos) >= $config{attackRouteMaxPathDistance});
+		# The most optimal solution is to include the path lenghts' comparison, however it will take
+		# more time and CPU resources, so, we use rough solution with priority and distance comparison
 
+		# All paths start from our position, so a single search gives the distance to every monster
+		my @dists;
+		if (@indexes) {
 			$pathfinding->reset(
 				start => $myPos,
-				dest  => $pos,
+				dest  => $myPos,
 				field => $field,
 				avoidWalls => 0,
 				randomFactor => 0,
@@ -3767,10 +3799,18 @@ sub getBestTarget {
 				min_x => $min_pathfinding_x,
 				max_x => $max_pathfinding_x,
 				min_y => $min_pathfinding_y,
-				max_y => $max_pathfinding_y
+				max_y => $max_pathfinding_y,
+				# The monsters are usually a few cells away, the window around them only grows for the ones behind walls
+				window => 5
 			);
-			my $dist = $pathfinding->runcount;
-			if ($dist <= 0 || $dist > $config{attackRouteMaxPathDistance}) {
+			@dists = $pathfinding->runcounts([@noLOSMonsters_pos[@indexes]]);
+		}
+
+		foreach my $i (0..$#indexes) {
+			my $index = $indexes[$i];
+			my $monster = $monsters{$noLOSMonsters[$index]};
+			my $dist = $dists[$i];
+			if (!defined $dist || $dist <= 0 || $dist > $config{attackRouteMaxPathDistance}) {
 				$monster->{attack_failedLOS} = time;
 				next;
 			}
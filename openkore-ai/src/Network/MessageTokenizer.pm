@@ -17,6 +17,11 @@
 # that all server messages are received as a byte stream.
 # This class is specialized in extracting discrete RO server or client messages from a byte
 # stream.
+#
+# The byte stream is kept by Network::MessageTokenizer::Native (see
+# auto/XSTools/misc/tokenizer.h), in a ring buffer with a table of the
+# packet lengths. readNext() takes every complete message from it at once,
+# and hands them out one by one.
 package Network::MessageTokenizer;
 
 use strict;
@@ -25,6 +30,10 @@ use Modules 'register';
 use bytes;
 no encoding 'utf8';
 use enum qw(KNOWN_MESSAGE UNKNOWN_MESSAGE ACCOUNT_ID);
+use FastUtils;
+
+# Incremented by packetLengthsChanged(), so that tokenizers know when to reload their packet lengths.
+our $lengthsGeneration = 0;
 
 ##
 # Network::MessageTokenizer->new(Hash* rpackets)
@@ -39,9 +48,41 @@ sub new {
 	my %self = (
 
 		rpackets => $rpackets,
-		buffer => ''
+		native => new Network::MessageTokenizer::Native(),
+		# Messages which were taken from the native buffer, but not returned by readNext() yet
+		messages => [],
+		# How many of them are known messages; only the last one may be unknown
+		known => 0,
 	);
-	return bless \%self, $class;
+	my $self = bless \%self, $class;
+	$self->loadLengths();
+	return $self;
+}
+
+##
+# void Network::MessageTokenizer::packetLengthsChanged()
+#
+# Tell every tokenizer to reload the lengths from its packet length database,
+# which must be done after it changed.
+sub packetLengthsChanged {
+	$lengthsGeneration++;
+}
+
+sub loadLengths {
+	my ($self) = @_;
+	$self->unread();
+	$self->{native}->setLengths($self->{rpackets});
+	$self->{generation} = $lengthsGeneration;
+}
+
+# Put the messages which weren't returned yet back in the native buffer, to be read again.
+sub unread {
+	my ($self) = @_;
+	if (@{$self->{messages}}) {
+		$self->{native}->prepend(join('', @{$self->{messages}}));
+		$self->{messages} = [];
+		$self->{known} = 0;
+	}
 }
 
 ##
@@ -52,7 +93,7 @@ sub new {
 sub add {
 	my ($self, $data) = @_;
 	assert(defined $data, "Can't add undefined data to MessageTokenizer buffer") if DEBUG;
-	$self->{buffer} .= $data;
+	$self->{native}->add($data);
 }
 
 ##
@@ -63,10 +104,11 @@ sub add {
 # bytes are removed.
 sub clear {
 	my ($self, $size) = @_;
+	$self->unread();
 	if (defined $size) {
-		substr($_[0]->{buffer}, 0, $size, '');
+		$self->{native}->remove($size);
 	} else {
-		$_[0]->{buffer} = '';
+		$self->{native}->remove($self->{native}->size());
 	}
 }
 
@@ -76,6 +118,8 @@ sub clear {
 # Tell this tokenizer that the next message might be the account ID.
 sub nextMessageMightBeAccountID {
 	my ($self) = @_;
+	# The messages which were already taken may start with it
+	$self->unread();
 	$self->{nextMessageMightBeAccountID} = 1;
 }
 
@@ -94,7 +138,9 @@ sub getMessageID {
 #
 # Get the internal buffer.
 sub getBuffer {
-	return $_[0]->{buffer};
+	my ($self) = @_;
+	$self->unread();
+	return $self->{native}->getBuffer();
 }
 
 ##
@@ -112,65 +158,40 @@ sub getBuffer {
 # `l`
 sub readNext {
 	my ($self, $type) = @_;
-	my $buffer = \$self->{buffer};
-
-	return undef if (length($$buffer) < 2);
-
-	my $switch = getMessageID($$buffer);
-	my $rpackets = $self->{rpackets};
-	my $size = $rpackets->{$switch}{length};
 
-	my $result;
+	$self->loadLengths() if ($self->{generation} != $lengthsGeneration);
 
-	#Log::warning sprintf("Packet %s %d %d \n", $switch, $rpackets->{$switch}{length}, $size);
+	if ($self->{nextMessageMightBeAccountID}) {
+		my $native = $self->{native};
+		return undef if ($native->size() < 2);
 
-	my $nextMessageMightBeAccountID = $self->{nextMessageMightBeAccountID};
-	$self->{nextMessageMightBeAccountID} = undef;
-
-	if ($nextMessageMightBeAccountID) {
-		if (length($$buffer) >= 4) {
-
-		$result = substr($$buffer, 0, 4);
-		if (unpack("V1",$result) == unpack("V1",$Globals::accountID)) {
-				substr($$buffer, 0, 4, '');
+		if ($native->size() >= 4) {
+			$self->{nextMessageMightBeAccountID} = undef;
+			my $result = $native->peek(4);
+			if (unpack("V1", $result) == unpack("V1", $Globals::accountID)) {
+				$native->remove(4);
 				$$type = ACCOUNT_ID;
-			} else {
-				# Account ID is "hidden" in a packet (0283 is one of them)
-				return $self->readNext($type);
+				return $result;
 			}
-
+			# Account ID is "hidden" in a packet (0283 is one of them)
 		} else {
-			$self->{nextMessageMightBeAccountID} = $nextMessageMightBeAccountID;
-		}
-
-	} elsif ($size > 1) {
-		# Static length message.
-		if (length($$buffer) >= $size) {
-			$result = substr($$buffer, 0, $size);
-			substr($$buffer, 0, $size, '');
-			$$type = KNOWN_MESSAGE;
+			return undef;
 		}
+	}
 
-	} elsif (
-		defined($size)
-		and $size == 0 # old Kore convention
-		|| $size == -1 # packet extractor v3
-	) {
-		# Variable length message.
-		if (length($$buffer) >= 4) {
-			$size = unpack("v", substr($$buffer, 2, 2));
-			if (length($$buffer) >= $size) {
-				$result = substr($$buffer, 0, $size, '');
-				$$type = KNOWN_MESSAGE;
-			}
-		}
+	my $messages = $self->{messages};
+	if (!@{$messages}) {
+		$self->{known} = $self->{native}->readBatch($messages);
+		return undef if (!@{$messages});
+	}
 
+	if ($self->{known} > 0) {
+		$self->{known}--;
+		$$type = KNOWN_MESSAGE;
 	} else {
-		$result = $$buffer;
-		$self->{buffer} = '';
 		$$type = UNKNOWN_MESSAGE;
 	}
-	return $result;
+	return shift @{$messages};
 }
 
 # ragnarok servers
@@ -0,0 +1,144 @@
+#########################################################################
+#  OpenKore - Networking subsystem
+#
+#  This software is open source, licensed under the GNU General Public
+#  License, version 2.
+#  Basically, this means that you're allowed to modify and distribute
+#  this software. However, if you distribute modified versions, you MUST
+#  also distribute the source code.
+#  See http://www.gnu.org/licenses/gpl.html for the full license.
+#########################################################################
+##
+# MODULE DESCRIPTION: Reading many server connections in one loop
+#
+# A process which holds the connections of several accounts would otherwise
+# select() and tokenize each of them on its own. A multiplexer waits for all
+# of them at once (epoll on Linux, poll() elsewhere), reads whatever arrived,
+# splits it in messages natively with the packet lengths of each connection,
+# and then calls the handler of each connection with its messages, in order.
+# The native part is src/auto/XSTools/misc/netmux.cpp.
+#
+# The sockets stay owned by the caller, who sends to them as usual. A socket
+# must be removed from the multiplexer before it's closed.
+# <pre class="example">
+# my $mux = new Network::Multiplexer();
+# my $id = $mux->add($socket, \%rpackets, sub {
+#     my ($id, $type, $message) = @_;
+#     if ($type == Network::Multiplexer::CLOSED) {
+#         $mux->remove($id);
+#         close($socket);
+#     } else {
+#         $accounts[$id]->handle($type, $message);
+#     }
+# });
+# while (1) {
+#     $mux->iterate(0.05);
+# }
+# </pre>
+package Network::Multiplexer;
+
+use strict;
+use Modules 'register';
+use FastUtils;
+use Network::MessageTokenizer;
+
+##
+# Network::Multiplexer::MESSAGE, Network::Multiplexer::UNKNOWN_MESSAGE, Network::Multiplexer::CLOSED
+#
+# The types of what a handler is called with: a known message, data which
+# doesn't start with a known message (up to what was read), and the closing of
+# the connection, with the start of a message which wasn't complete if any.
+# A closed connection isn't read anymore, but stays until it's removed.
+use constant {
+	MESSAGE => 0,
+	UNKNOWN_MESSAGE => 1,
+	CLOSED => 2,
+};
+
+##
+# Network::Multiplexer Network::Multiplexer->new()
+#
+# Create a multiplexer without connections.
+sub new {
+	my ($class) = @_;
+	my %self = (
+		native => new Network::Multiplexer::Native(),
+		# Connection ID => [handler, packet length database, length generation]
+		connections => {},
+	);
+	return bless \%self, $class;
+}
+
+##
+# int $Network_Multiplexer->add(socket, Hash* rpackets, handler)
+# socket: An open socket, such as an IO::Socket::INET.
+# rpackets: The packet length database of the connection.
+# handler: A code reference, called with (id, type, message) for each message read.
+# Returns: The ID of the connection, or undef if the socket can't be waited for.
+#          The ID of a removed connection is reused.
+#
+# Start reading a socket. The packet lengths are read again whenever
+# Network::MessageTokenizer::packetLengthsChanged() was called.
+sub add {
+	my ($self, $socket, $rpackets, $handler) = @_;
+	my $id = $self->{native}->add($socket);
+	return undef if ($id < 0);
+	$self->{native}->setLengths($id, $rpackets);
+	$self->{connections}{$id} = [$handler, $rpackets, $Network::MessageTokenizer::lengthsGeneration];
+	return $id;
+}
+
+##
+# void $Network_Multiplexer->remove(int id)
+#
+# Stop reading a connection. Its handler isn't called anymore, even for the
+# messages which were already read.
+sub remove {
+	my ($self, $id) = @_;
+	return unless (delete $self->{connections}{$id});
+	$self->{native}->remove($id);
+}
+
+##
+# int $Network_Multiplexer->count()
+#
+# Returns the number of connections.
+sub count {
+	return $_[0]->{native}->count;
+}
+
+##
+# int $Network_Multiplexer->iterate([double timeout = 0])
+# timeout: The maximum time to wait for data, in seconds.
+# Returns: The number of handler calls.
+#
+# Wait until some connections can be read, read them and call their
+# handlers, which may add and remove connections.
+sub iterate {
+	my ($self, $timeout) = @_;
+	my $connections = $self->{connections};
+	my $native = $self->{native};
+
+	foreach my $id (keys %{$connections}) {
+		my $connection = $connections->{$id};
+		if ($connection->[2] != $Network::MessageTokenizer::lengthsGeneration) {
+			$native->setLengths($id, $connection->[1]);
+			$connection->[2] = $Network::MessageTokenizer::lengthsGeneration;
+		}
+	}
+
+	$native->wait(int(($timeout || 0) * 1000));
+	my @events = $native->take;
+	my %read = %{$connections};
+	my $calls = 0;
+	for (my $i = 0; $i < @events; $i += 3) {
+		# A handler called before may have removed it, and added another connection with its ID
+		my $connection = $read{$events[$i]};
+		next unless ($connection && $connections->{$events[$i]} && $connections->{$events[$i]} == $connection);
+		$connection->[0]->(@events[$i .. $i + 2]);
+		$calls++;
+	}
+	return $calls;
+}
+
+1;
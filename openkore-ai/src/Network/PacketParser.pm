@@ -37,6 +37,7 @@ use Network::MessageTokenizer;
 use Misc;
 use Plugins;
 use Utils;
+use FastUtils;
 use Utils::Exceptions;
 use Utils::Crypton;
 use Translation;
@@ -257,7 +258,15 @@ sub parse {
 		KEYS => $handler->[2],
 	);
 	if ($handler->[1]) {
-		@args{@{$handler->[2]}} = unpack("x2 $handler->[1]", $msg);
+		# The template is compiled once per handler, and kept with the template it was compiled from
+		my $compiled = $handler->[3];
+		unless ($compiled && $compiled->[0] eq $handler->[1]) {
+			$compiled = $handler->[3] = [$handler->[1],
+				Network::PacketParser::Unpacker->new("x2 $handler->[1]", $handler->[2] || [])];
+		}
+		unless ($compiled->[1] && $compiled->[1]->unpack($msg, \%args)) {
+			@args{@{$handler->[2]}} = unpack("x2 $handler->[1]", $msg);
+		}
 	}
 	if (my $custom_parse = $self->can('parse_'.$handler->[0])) {
 		$self->$custom_parse(\%args);
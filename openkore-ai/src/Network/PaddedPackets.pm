@@ -11,6 +11,25 @@
 
 # See src/auto/XSTools/PaddedPackets/README.TXT for more information.
 # Parts of this module is implemented in src/auto/XSTools/PaddedPackets/PaddedPackets.xs
+#
+# The functions below use the global engine, with the hash data of the
+# account OpenKore is logged in with. Code that generates packets for
+# several accounts gives each one a Network::PaddedPackets::Engine:
+#
+#   my $engine = new Network::PaddedPackets::Engine;
+#   $engine->setHashData($accountId, $mapSync, $sync);  # numbers, as setHashData() unpacks them
+#   $engine->setPacketIDs($attackID, $skillUseID);
+#   my $packet = $engine->createAtk($targetId);         # also createSitStand($sit),
+#                                                       # createSkillUse($skillId, $skillLv, $targetId)
+#   my @keys = unpack('V*', $engine->decodeKeys($packet, 2));  # fewer keys if $packet is cut short
+#
+# and can encode the packets of many accounts in one call:
+#
+#   my @packets = Network::PaddedPackets::createBatch([
+#       [$engine1, 'attack', $targetId],
+#       [$engine2, 'skill', $skillId, $skillLv, $targetId],
+#       [$engine3, 'sit'],      # or 'stand'
+#   ]);
 
 package Network::PaddedPackets;
 
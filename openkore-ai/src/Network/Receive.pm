@@ -35,7 +35,7 @@ use AI;
 use Globals;
 use Field;
 #use Settings;
-use Log qw(message warning error debug);
+use Log qw(message warning error debug debugf);
 use FileParsers qw(updateMonsterLUT updateNPCLUT);
 use I18N qw(bytesToString stringToBytes);
 use Interface;
@@ -2263,23 +2263,23 @@ typedef enum <unnamed-tag> {
 			Plugins::callHook('portal_exist', {portal => $actor});
 
 		} elsif ($actor->isa('Actor::Monster')) {
-			debug sprintf("Monster Exists: %s (%d)\n", $actor->name, $actor->{binID}), "parseMsg_presence", 1;
+			debugf("parseMsg_presence", 1, "Monster Exists: %s (%d)\n", $actor->name, $actor->{binID});
 			Plugins::callHook('monster_exist', {monster => $actor});
 
 		} elsif ($actor->isa('Actor::Pet')) {
-			debug sprintf("Pet Exists: %s (%d)\n", $actor->name, $actor->{binID}), "parseMsg_presence", 1;
+			debugf("parseMsg_presence", 1, "Pet Exists: %s (%d)\n", $actor->name, $actor->{binID});
 			Plugins::callHook('pet_exist', {pet => $actor});
 
 		} elsif ($actor->isa('Actor::Slave')) {
-			debug sprintf("Slave Exists: %s (%d)\n", $actor->name, $actor->{binID}), "parseMsg_presence", 1;
+			debugf("parseMsg_presence", 1, "Slave Exists: %s (%d)\n", $actor->name, $actor->{binID});
 			Plugins::callHook('slave_exist', {slave => $actor});
 
 		} elsif ($actor->isa('Actor::Elemental')) {
-			debug sprintf("Elemental Exists: %s (%d)\n", $actor->name, $actor->{binID}), "parseMsg_presence", 1;
+			debugf("parseMsg_presence", 1, "Elemental Exists: %s (%d)\n", $actor->name, $actor->{binID});
 			Plugins::callHook('elemental_exist', {elemental => $actor});
 
 		} else {
-			debug sprintf("Unknown Actor Exists: %s (%d)\n", $actor->name, $actor->{binID}), "parseMsg_presence", 1;
+			debugf("parseMsg_presence", 1, "Unknown Actor Exists: %s (%d)\n", $actor->name, $actor->{binID});
 			Plugins::callHook('unknown_exist', {unknown => $actor});
 		}
 
@@ -2331,30 +2331,31 @@ typedef enum <unnamed-tag> {
 		$actor->{look}{head} = 0;
 
 		if ($actor->isa('Actor::Player')) {
-			debug "Player Moved: " . $actor->name . " ($actor->{binID}) Level $actor->{lv} $sex_lut{$actor->{sex}} $jobs_lut{$actor->{jobID}} - ($coordsFrom{x}, $coordsFrom{y}) -> ($coordsTo{x}, $coordsTo{y})\n", "parseMsg";
+			debugf("parseMsg", undef, "Player Moved: %s (%s) Level %s %s %s - (%s, %s) -> (%s, %s)\n", $actor->name, $actor->{binID}, $actor->{lv},
+				$sex_lut{$actor->{sex}}, $jobs_lut{$actor->{jobID}}, $coordsFrom{x}, $coordsFrom{y}, $coordsTo{x}, $coordsTo{y});
 			Plugins::callHook('player_moved', $actor);
 		} elsif ($actor->isa('Actor::Monster')) {
-			debug "Monster Moved: " . $actor->nameIdx . " - ($coordsFrom{x}, $coordsFrom{y}) -> ($coordsTo{x}, $coordsTo{y})\n", "parseMsg";
+			debugf("parseMsg", undef, "Monster Moved: %s - (%s, %s) -> (%s, %s)\n", $actor->nameIdx, $coordsFrom{x}, $coordsFrom{y}, $coordsTo{x}, $coordsTo{y});
 			Plugins::callHook('monster_moved', $actor);
 		} elsif ($actor->isa('Actor::Pet')) {
-			debug "Pet Moved: " . $actor->nameIdx . " - ($coordsFrom{x}, $coordsFrom{y}) -> ($coordsTo{x}, $coordsTo{y})\n", "parseMsg";
+			debugf("parseMsg", undef, "Pet Moved: %s - (%s, %s) -> (%s, %s)\n", $actor->nameIdx, $coordsFrom{x}, $coordsFrom{y}, $coordsTo{x}, $coordsTo{y});
 			Plugins::callHook('pet_moved', $actor);
 		} elsif ($actor->isa('Actor::Slave')) {
-			debug "Slave Moved: " . $actor->nameIdx . " - ($coordsFrom{x}, $coordsFrom{y}) -> ($coordsTo{x}, $coordsTo{y})\n", "parseMsg";
+			debugf("parseMsg", undef, "Slave Moved: %s - (%s, %s) -> (%s, %s)\n", $actor->nameIdx, $coordsFrom{x}, $coordsFrom{y}, $coordsTo{x}, $coordsTo{y});
 			Plugins::callHook('slave_moved', $actor);
 		} elsif ($actor->isa('Actor::Portal')) {
 			# This can never happen of course.
-			debug "Portal Moved: " . $actor->nameIdx . " - ($coordsFrom{x}, $coordsFrom{y}) -> ($coordsTo{x}, $coordsTo{y})\n", "parseMsg";
+			debugf("parseMsg", undef, "Portal Moved: %s - (%s, %s) -> (%s, %s)\n", $actor->nameIdx, $coordsFrom{x}, $coordsFrom{y}, $coordsTo{x}, $coordsTo{y});
 			Plugins::callHook('portal_moved', $actor);
 		} elsif ($actor->isa('Actor::NPC')) {
 			# Neither can this.
-			debug "NPC Moved: " . $actor->nameIdx . " - ($coordsFrom{x}, $coordsFrom{y}) -> ($coordsTo{x}, $coordsTo{y})\n", "parseMsg";
+			debugf("parseMsg", undef, "NPC Moved: %s - (%s, %s) -> (%s, %s)\n", $actor->nameIdx, $coordsFrom{x}, $coordsFrom{y}, $coordsTo{x}, $coordsTo{y});
 			Plugins::callHook('npc_moved', $actor);
 		} elsif ($actor->isa('Actor::Elemental')) {
-			debug "Elemental Moved: " . $actor->nameIdx . " - ($coordsFrom{x}, $coordsFrom{y}) -> ($coordsTo{x}, $coordsTo{y})\n", "parseMsg";
+			debugf("parseMsg", undef, "Elemental Moved: %s - (%s, %s) -> (%s, %s)\n", $actor->nameIdx, $coordsFrom{x}, $coordsFrom{y}, $coordsTo{x}, $coordsTo{y});
 			Plugins::callHook('pet_moved', $actor);
 		} else {
-			debug "Unknown Actor Moved: " . $actor->nameIdx . " - ($coordsFrom{x}, $coordsFrom{y}) -> ($coordsTo{x}, $coordsTo{y})\n", "parseMsg";
+			debugf("parseMsg", undef, "Unknown Actor Moved: %s - (%s, %s) -> (%s, %s)\n", $actor->nameIdx, $coordsFrom{x}, $coordsFrom{y}, $coordsTo{x}, $coordsTo{y});
 			Plugins::callHook('unknown_moved', $actor);
 		}
 
@@ -2750,7 +2751,7 @@ sub actor_info {
 		$npc->setName($name);
 		$npc->{info} = 1;
 		if ($config{debug} >= 2) {
-			my $binID = binFind(\@npcsID, $args->{ID});
+			my $binID = actorIDIndex('npc')->find($args->{ID});
 			debug "NPC Info: $npc->{name} ($binID)\n", "parseMsg", 2;
 		}
 
@@ -2768,7 +2769,7 @@ sub actor_info {
 		$pet->setName($name);
 		$pet->{info} = 1;
 		if ($config{debug} >= 2) {
-			my $binID = binFind(\@petsID, $args->{ID});
+			my $binID = actorIDIndex('pet')->find($args->{ID});
 			debug "Pet Info: $pet->{name_given} ($binID)\n", "parseMsg", 2;
 		}
 		Plugins::callHook('petNameUpdate', {pet => $pet});
@@ -2779,7 +2780,7 @@ sub actor_info {
 		$slave->{name_given} = $name;
 		$slave->setName($name);
 		$slave->{info} = 1;
-		my $binID = binFind(\@slavesID, $args->{ID});
+		my $binID = actorIDIndex('slave')->find($args->{ID});
 		debug "Slave Info: $name ($binID)\n", "parseMsg_presence", 2;
 		updatePlayerNameCache($slave);
 		Plugins::callHook('slaveNameUpdate', {slave => $slave});
@@ -2791,7 +2792,7 @@ sub actor_info {
 		$elemental->setName($name);
 		$elemental->{info} = 1;
 		if ($config{debug} >= 2) {
-			my $binID = binFind(\@elementalsID, $args->{ID});
+			my $binID = actorIDIndex('elemental')->find($args->{ID});
 			debug "elemental Info: $elemental->{name_given} ($binID)\n", "parseMsg", 2;
 		}
 		Plugins::callHook('elementalNameUpdate', {elemental => $elemental});
@@ -4065,7 +4066,7 @@ sub monster_hp_info {
 		$monster->{hp} = $args->{hp};
 		$monster->{hp_max} = $args->{hp_max};
 
-		debug TF("Monster %s has hp %s/%s (%s%)\n", $monster->name, $monster->{hp}, $monster->{hp_max}, $monster->{hp} * 100 / $monster->{hp_max}), "parseMsg_damage";
+		debugf("parseMsg_damage", undef, T("Monster %s has hp %s/%s (%s%)\n"), $monster->name, $monster->{hp}, $monster->{hp_max}, $monster->{hp} * 100 / $monster->{hp_max});
 	}
 }
 
@@ -4077,7 +4078,7 @@ sub monster_hp_info_tiny {
 	if ($monster) {
 		$monster->{hp_percent} = $args->{hp} * 5;
 
-		debug TF("Monster %s has about %d%% hp left\n", $monster->name, $monster->{hp_percent}), "parseMsg_damage";
+		debugf("parseMsg_damage", undef, T("Monster %s has about %d%% hp left\n"), $monster->name, $monster->{hp_percent});
 	}
 }
 
@@ -10481,10 +10482,13 @@ sub guild_alliance_added {
 }
 
 # 0192
-# TODO: add actual functionality, maybe alter field?
+# Sent when a cell of the map changes, ex. while an Ice Wall stands
 sub map_change_cell {
 	my ($self, $args) = @_;
 	debug "Cell on ($args->{x}, $args->{y}) has been changed to $args->{type} on $args->{map_name}\n", "info";
+	my ($map) = $args->{map_name} =~ /^([^.]*)/;
+	return unless ($field && $map eq $field->name);
+	$field->changeCells({ x => $args->{x}, y => $args->{y}, type => $args->{type} });
 }
 
 # 01D1
@@ -1042,7 +1042,12 @@ sub _items_list {
 		for ([keys %$item]) {
 			@{$local_item}{@$_} = @{$item}{@$_};
 		}
-		$local_item->{name} = itemName($local_item);
+		if ($add) {
+			$local_item->{name} = itemName($local_item);
+		} else {
+			# Its list indexes it again, its nameID or type may have changed too
+			$local_item->setName(itemName($local_item));
+		}
 		$local_item->{serverID} = unpack('v', $local_item->{ID});
 
 		$args->{callback}($local_item) if $args->{callback};
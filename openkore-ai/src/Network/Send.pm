@@ -310,8 +310,7 @@ sub parse_master_login {
 		my $key = pack('C24', (6, 169, 33, 64, 54, 184, 161, 91, 81, 46, 3, 213, 52, 18, 0, 6, 61, 175, 186, 66, 157, 158, 180, 48));
 		my $chain = pack('C24', (61, 175, 186, 66, 157, 158, 180, 48, 180, 34, 218, 128, 44, 159, 172, 65, 1, 2, 4, 8, 16, 32, 128));
 		my $in = pack('a24', $args->{password_rijndael});
-		my $rijndael = Utils::Rijndael->new;
-		$rijndael->MakeKey($key, $chain, 24, 24);
+		my $rijndael = Utils::Rijndael::keyed($key, $chain, 24, 24);
 		$args->{password} = unpack("Z24", $rijndael->Decrypt($in, undef, 24, 0));
 	}
 }
@@ -337,8 +336,7 @@ sub reconstruct_master_login {
 		my $key = pack('C24', (6, 169, 33, 64, 54, 184, 161, 91, 81, 46, 3, 213, 52, 18, 0, 6, 61, 175, 186, 66, 157, 158, 180, 48));
 		my $chain = pack('C24', (61, 175, 186, 66, 157, 158, 180, 48, 180, 34, 218, 128, 44, 159, 172, 65, 1, 2, 4, 8, 16, 32, 128));
 		my $in = pack('a24', $args->{password});
-		my $rijndael = Utils::Rijndael->new;
-		$rijndael->MakeKey($key, $chain, 24, 24);
+		my $rijndael = Utils::Rijndael::keyed($key, $chain, 24, 24);
 		$args->{password_rijndael} = $rijndael->Encrypt($in, undef, 24, 0);
 	}
 }
@@ -418,8 +416,7 @@ sub reconstruct_game_login {
 		$mac = uc($mac);
 		my $in = pack('a16', $mac);
 
-		my $rijndael = Utils::Rijndael->new;
-		$rijndael->MakeKey($key, $chain, 16, 16);
+		my $rijndael = Utils::Rijndael::keyed($key, $chain, 16, 16);
 		$args->{mac} = $rijndael->Encrypt($in, undef, 16, 0);
 	}
 }
@@ -1452,8 +1449,7 @@ sub encrypt_password {
 		my $key = pack('C32', (0x06, 0xA9, 0x21, 0x40, 0x36, 0xB8, 0xA1, 0x5B, 0x51, 0x2E, 0x03, 0xD5, 0x34, 0x12, 0x00, 0x06, 0x06, 0xA9, 0x21, 0x40, 0x36, 0xB8, 0xA1, 0x5B, 0x51, 0x2E, 0x03, 0xD5, 0x34, 0x12, 0x00, 0x06));
 		my $chain = pack('C32', (0x3D, 0xAF, 0xBA, 0x42, 0x9D, 0x9E, 0xB4, 0x30, 0xB4, 0x22, 0xDA, 0x80, 0x2C, 0x9F, 0xAC, 0x41, 0x3D, 0xAF, 0xBA, 0x42, 0x9D, 0x9E, 0xB4, 0x30, 0xB4, 0x22, 0xDA, 0x80, 0x2C, 0x9F, 0xAC, 0x41));
 		my $in = pack('a32', $password);
-		my $rijndael = Utils::Rijndael->new;
-		$rijndael->MakeKey($key, $chain, 32, 32);
+		my $rijndael = Utils::Rijndael::keyed($key, $chain, 32, 32);
 		$password_rijndael = unpack("Z32", $rijndael->Encrypt($in, undef, 32, 0));
 		return $password_rijndael;
 	} else {
@@ -85,8 +85,7 @@ sub parse_master_login {
 		my $key = pack('C32', (0x06, 0xA9, 0x21, 0x40, 0x36, 0xB8, 0xA1, 0x5B, 0x51, 0x2E, 0x03, 0xD5, 0x34, 0x12, 0x00, 0x06, 0x06, 0xA9, 0x21, 0x40, 0x36, 0xB8, 0xA1, 0x5B, 0x51, 0x2E, 0x03, 0xD5, 0x34, 0x12, 0x00, 0x06));
 		my $chain = pack('C32', (0x3D, 0xAF, 0xBA, 0x42, 0x9D, 0x9E, 0xB4, 0x30, 0xB4, 0x22, 0xDA, 0x80, 0x2C, 0x9F, 0xAC, 0x41, 0x3D, 0xAF, 0xBA, 0x42, 0x9D, 0x9E, 0xB4, 0x30, 0xB4, 0x22, 0xDA, 0x80, 0x2C, 0x9F, 0xAC, 0x41));
 		my $in = pack('a32', $args->{password_rijndael});
-		my $rijndael = Utils::Rijndael->new;
-		$rijndael->MakeKey($key, $chain, 32, 32);
+		my $rijndael = Utils::Rijndael::keyed($key, $chain, 32, 32);
 		$args->{password} = unpack("Z32", $rijndael->Decrypt($in, undef, 32, 0));
 	}
 }
@@ -104,8 +103,7 @@ sub reconstruct_master_login {
 		my $key = pack('C32', (0x06, 0xA9, 0x21, 0x40, 0x36, 0xB8, 0xA1, 0x5B, 0x51, 0x2E, 0x03, 0xD5, 0x34, 0x12, 0x00, 0x06, 0x06, 0xA9, 0x21, 0x40, 0x36, 0xB8, 0xA1, 0x5B, 0x51, 0x2E, 0x03, 0xD5, 0x34, 0x12, 0x00, 0x06));
 		my $chain = pack('C32', (0x3D, 0xAF, 0xBA, 0x42, 0x9D, 0x9E, 0xB4, 0x30, 0xB4, 0x22, 0xDA, 0x80, 0x2C, 0x9F, 0xAC, 0x41, 0x3D, 0xAF, 0xBA, 0x42, 0x9D, 0x9E, 0xB4, 0x30, 0xB4, 0x22, 0xDA, 0x80, 0x2C, 0x9F, 0xAC, 0x41));
 		my $in = pack('a32', $args->{password});
-		my $rijndael = Utils::Rijndael->new;
-		$rijndael->MakeKey($key, $chain, 32, 32);
+		my $rijndael = Utils::Rijndael::keyed($key, $chain, 32, 32);
 		$args->{password_rijndael} = $rijndael->Encrypt($in, undef, 32, 0);
 	}
 }
@@ -58,6 +58,7 @@ sub new {
 	$self->{incomingPackets} = "";
 	$self->{serverPackets} = "";
 	$self->{clientPackets} = "";
+	$self->{dllOutput} = "";
 
 	$masterServer = $masterServers{$config{master}};
 	$packetParser = Network::Receive->create($self, $masterServer->{serverType});
@@ -66,6 +67,8 @@ sub new {
 
 	$self->{tokenizer} = new Network::MessageTokenizer($self->getRecvPackets());
 	$self->{kore_map_changed_hook} = Plugins::addHook('packet/map_changed', \&kore_map_changed, $self);
+	# Packets queued by sendToDLL() in batching mode leave by the end of the iteration at the latest
+	$self->{kore_flush_hook} = Plugins::addHook('mainLoop_post', \&kore_flush, $self);
 
 	message T("X-Kore mode intialized.\n"), "startup";
 
@@ -79,7 +82,7 @@ sub version {
 sub DESTROY {
 	my $self = shift;
 
-	close($self->{client});
+	close($self->{client}) if ($self->{client});
 }
 
 ######################
@@ -87,6 +90,7 @@ sub DESTROY {
 ######################
 
 sub serverAlive {
+	return $_[0]->{shm}->peerAlive if ($_[0]->{shm});
 	return $_[0]->{client} && $_[0]->{client}->connected;
 }
 
@@ -118,7 +122,7 @@ sub serverSend {
 	my $self = shift;
 	my $msg = shift;
 	Plugins::callHook('Network::serverSend/pre', {msg => \$msg});
-	$self->{client}->send("S".pack("v", length($msg)).$msg) if ($self->serverAlive);
+	$self->sendToDLL("S".pack("v", length($msg)).$msg) if ($self->serverAlive);
 }
 
 sub serverDisconnect {
@@ -167,7 +171,7 @@ sub clientConnect {
 # $net->clientPeerHost
 #
 sub clientPeerHost {
-	return $_[0]->{client}->peerhost if ($_[0]->clientAlive);
+	return $_[0]->{client}->peerhost if ($_[0]->clientAlive && $_[0]->{client});
 	return undef;
 }
 
@@ -175,7 +179,7 @@ sub clientPeerHost {
 # $net->clientPeerPort
 #
 sub clientPeerPort {
-	return $_[0]->{client}->peerport if ($_[0]->clientAlive);
+	return $_[0]->{client}->peerport if ($_[0]->clientAlive && $_[0]->{client});
 	return undef;
 }
 
@@ -207,7 +211,7 @@ sub clientSend {
 		$msg = "";
 	}
 
-	$self->{client}->send("R".pack("v", length($msg)).$msg) if ($self->clientAlive);
+	$self->sendToDLL("R".pack("v", length($msg)).$msg) if ($self->clientAlive);
 }
 
 sub clientDisconnect {
@@ -224,7 +228,55 @@ sub clientDisconnect {
 # Send a keep-alive packet to the injected DLL.
 sub injectSync {
 	my $self = shift;
-	$self->{client}->send("K" . pack("v", 0)) if ($self->serverAlive);
+	$self->sendToDLL("K" . pack("v", 0)) if ($self->serverAlive);
+}
+
+##
+# $net->sendToDLL(data)
+#
+# Send packets to the injected DLL, through shared memory or the X-Kore server socket.
+#
+# With the XKore_batchPackets option, packets are queued and written together, like
+# Nagle's algorithm: once the oldest one waited a millisecond, when a lot is queued, or
+# at the end of the main loop iteration.
+#
+# This function is meant to be used internally only.
+sub sendToDLL {
+	my ($self, $data) = @_;
+
+	if (!$config{XKore_batchPackets}) {
+		$self->writeToDLL($data);
+		return;
+	}
+	$self->{dllOutputTime} = time if (!length($self->{dllOutput}));
+	$self->{dllOutput} .= $data;
+	$self->flushToDLL if (length($self->{dllOutput}) >= 16 * 1024 || time - $self->{dllOutputTime} >= 0.001);
+}
+
+##
+# $net->flushToDLL()
+#
+# Write the packets which sendToDLL() queued.
+#
+# This function is meant to be used internally only.
+sub flushToDLL {
+	my $self = shift;
+
+	return unless (length($self->{dllOutput}));
+	my $data = $self->{dllOutput};
+	$self->{dllOutput} = "";
+	$self->writeToDLL($data) if ($self->serverAlive);
+}
+
+sub writeToDLL {
+	my ($self, $data) = @_;
+
+	if ($self->{shm}) {
+		debug "X-Kore shared memory full, dropping " . length($data) . " bytes\n", "connection"
+			unless ($self->{shm}->send($data));
+	} else {
+		$self->{client}->send($data);
+	}
 }
 
 ##
@@ -254,6 +306,7 @@ sub checkConnection {
 
 	# (Re-)initialize X-Kore if necessary
 	$self->setState(Network::NOT_CONNECTED);
+	$self->{dllOutput} = "";
 	my $pid;
 	# Wait until the RO client has started
 
@@ -318,6 +371,14 @@ sub checkConnection {
 
 	sleep 1;
 
+	# Offer the DLL shared memory instead of the X-Kore server socket; the
+	# previous one must go first, it can't be created twice
+	delete $self->{shm};
+	if ($config{XKore_sharedMemory}) {
+		$self->{shm} = new Utils::Win32::XKoreShm($pid);
+		error T("Unable to create the X-Kore shared memory, using the X-Kore server instead.\n") if (!$self->{shm});
+	}
+
 	# Inject DLL
 	if($config{XKore_injectDLL}) {
 		if (!$self->inject($pid)) {
@@ -370,16 +431,28 @@ sub inject {
 
 ##
 # $net->waitForClient()
-# Returns: the socket which connects X-Kore to the client.
+# Returns: the socket which connects X-Kore to the client, undef when it uses shared memory.
 #
-# Wait until the client has connected the X-Kore server.
+# Wait until the client has connected the X-Kore server, or opened the shared memory.
 #
 # This function is meant to be used internally only.
 sub waitForClient {
 	my $self = shift;
 
 	message T("Waiting for the Ragnarok Online client to connect to X-Kore..."), "startup";
-	$self->{client} = $self->{server}->accept;
+	if ($self->{shm}) {
+		# A DLL without shared memory support connects to the X-Kore server instead
+		until ($self->{shm}->peerAlive) {
+			if (dataWaiting(\$self->{server})) {
+				delete $self->{shm};
+				$self->{client} = $self->{server}->accept;
+				last;
+			}
+			$self->{shm}->wait(100);
+		}
+	} else {
+		$self->{client} = $self->{server}->accept;
+	}
 	# Translation Comment: Waiting for the Ragnarok Online client to connect to X-Kore...
 	message " " . T("ready\n"), "startup";
 	return $self->{client};
@@ -396,14 +469,20 @@ sub recv {
 	my $self = shift;
 	my $msg;
 
-	return undef unless dataWaiting(\$self->{client});
-	undef $@;
-	eval {
-		$self->{client}->recv($msg, 32 * 1024);
-	};
-	if (!defined $msg || length($msg) == 0 || $@) {
-		delete $self->{client};
-		return undef;
+	if ($self->{shm}) {
+		# The connection closing shows in serverAlive()
+		$msg = $self->{shm}->recv;
+		return undef unless length($msg);
+	} else {
+		return undef unless dataWaiting(\$self->{client});
+		undef $@;
+		eval {
+			$self->{client}->recv($msg, 32 * 1024);
+		};
+		if (!defined $msg || length($msg) == 0 || $@) {
+			delete $self->{client};
+			return undef;
+		}
 	}
 
 	$self->{incomingPackets} .= $msg;
@@ -630,6 +709,11 @@ sub getRecvPackets {
 	return \%rpackets;
 }
 
+sub kore_flush {
+	my (undef, undef, $self) = @_;
+	$self->flushToDLL;
+}
+
 sub kore_map_changed {
 	# Reset CryptKey when mapserver change
 	if($currentClientKey && $messageSender->{encryption}->{crypt_key}) {
@@ -38,10 +38,25 @@ use Network;
 use Network::Send ();
 use Utils::Exceptions;
 use Network::MessageTokenizer;
+use FastUtils;
 
 my $clientBuffer;
 my $currentClientKey = 0;
 
+# Modes of Network::XKoreProxy::Relay, see src/auto/XSTools/misc/proxyrelay.h
+use constant {
+	RELAY_MIRROR => 0,
+	RELAY_FORWARD => 1,
+	RELAY_HOLD => 2,
+};
+
+# Server messages which modifyPacketIn() and clientSend() may change, drop or act upon before
+# they reach the client, so the relay leaves them to the main loop
+our @relayHeldMessages = qw(
+	0069 006A 006C 0071 0081 0092 00B3 0259 0276 02AE 02CA 083E 08B9 0A4C
+	0A4D 0AC4 0AC5 0AC7 0AC9 0ACD 0AE0 0AE3 0B07 0B60 0C32
+);
+
 # Members:
 #
 # Socket proxy_listen
@@ -52,6 +67,14 @@ my $currentClientKey = 0;
 # Socket proxy
 #    A client socket, which connects XKoreProxy with the RO client.
 #    This is only defined when the RO client has connected to XKoreProxy.
+#
+# Network::XKoreProxy::Relay relay
+#    The native relay of the server messages to the client, see
+#    $net->startRelay(). Only defined while it runs.
+#
+# Array<Bytes> relayForwarded
+#    The messages given to the parser which the relay already sent to the
+#    client, in order, so that clientSend() doesn't send them again.
 
 ##
 # Network::XKoreProxy->new()
@@ -105,6 +128,7 @@ sub version {
 sub DESTROY {
 	my $self = shift;
 
+	$self->stopRelay();
 	close($self->{proxy_listen});
 	close($self->{proxy});
 }
@@ -141,7 +165,82 @@ sub serverPeerPort {
 
 sub serverRecv {
 	my $self = shift;
-	return $self->{server}->serverRecv();
+	$self->startRelay() if ($config{XKore_relay} && !$self->{relay});
+	return $self->{server}->serverRecv() unless ($self->{relay});
+
+	my $relay = $self->{relay};
+	# What the main loop had to send for the messages taken last time has been sent
+	$relay->release();
+	my $closed = $relay->serverClosed();
+	my ($msg, @forwarded) = $relay->take();
+	push @{$self->{relayForwarded}}, @forwarded;
+
+	if ($closed || $self->{relayGeneration} != $Network::MessageTokenizer::lengthsGeneration) {
+		# The relay is started again with the new message lengths, once the messages it read are parsed
+		$msg .= $self->stopRelay();
+		if ($closed) {
+			close($self->{server}{remote_socket});
+			return undef unless (length($msg));
+		}
+	}
+	return undef unless (length($msg));
+	if (Plugins::hasHook('Network::serverRecv')) {
+		Plugins::callHook('Network::serverRecv', {msg => \$msg});
+	}
+	return $msg;
+}
+
+##
+# boolean $Network_XKoreProxy->startRelay()
+# Returns: whether the relay runs.
+#
+# With the XKore_relay option, once the bot is in game, a native thread reads the messages of
+# the server and sends them to the client right away, instead of the client getting them after
+# the main loop parsed them (see src/auto/XSTools/misc/proxyrelay.h). The parser still gets every
+# message it knows, but it can only change or drop the messages of @relayHeldMessages and those
+# which a Network/Receive/willMangle hook says it will mangle: the relay stops forwarding at
+# such a message, until the main loop sent its version of it.
+sub startRelay {
+	my ($self) = @_;
+	return 1 if ($self->{relay});
+	return 0 unless ($self->getState() == Network::IN_GAME && $self->serverAlive && $self->proxyAlive && !$self->{waitClientDC});
+	# The relay reads from the server from now on, so the parser must not be waiting for the rest of a message
+	return 0 if (length($incomingMessages->getBuffer) || length($clientBuffer));
+
+	my $relay = Network::XKoreProxy::Relay->new($self->{server}{remote_socket}, $self->{proxy}, \%rpackets);
+	my %held = map { $_ => 1 } @relayHeldMessages;
+	foreach my $switch (keys %rpackets) {
+		next unless ($switch =~ /^[0-9A-F]{4}$/);
+		if ($held{$switch} || $packetParser->willMangle($switch)) {
+			$relay->setMode(hex($switch), RELAY_HOLD);
+		} elsif (!$packetParser->{packet_list}{$switch}) {
+			# The parser doesn't know it, it would only report it as unknown
+			$relay->setMode(hex($switch), RELAY_FORWARD);
+		}
+	}
+	return 0 unless ($relay->start());
+
+	debug "X-Kore Proxy: relaying the server messages to the client\n", "xkoreProxy";
+	$self->{relay} = $relay;
+	$self->{relayForwarded} = [];
+	$self->{relayGeneration} = $Network::MessageTokenizer::lengthsGeneration;
+	return 1;
+}
+
+##
+# Bytes $Network_XKoreProxy->stopRelay()
+# Returns: what the relay read from the server which was not taken yet.
+#
+# Stop the relay, if it runs. The main loop reads from the server and sends to the client itself again.
+# The relay must be stopped before the sockets are closed.
+sub stopRelay {
+	my ($self) = @_;
+	my $relay = delete $self->{relay} or return '';
+	$relay->stop();
+	my ($msg) = $relay->take();
+	$self->{relayForwarded} = [];
+	debug sprintf("X-Kore Proxy: relay stopped, %d messages forwarded, %d held\n", $relay->forwarded, $relay->held), "xkoreProxy";
+	return $msg;
 }
 
 sub serverSend {
@@ -195,6 +294,7 @@ sub serverDisconnect {
 
 	return unless ($self->serverAlive);
 
+	$self->stopRelay();
 	close($self->{proxy}) unless $preserveClient;
 	$self->{waitClientDC} = 1 if $preserveClient;
 
@@ -267,6 +367,9 @@ sub clientSend {
 		}
 	}
 
+	# The relay already sent it
+	return if ($self->{relayForwarded} && @{$self->{relayForwarded}} && $self->relayForwarded($msg));
+
 	$msg = $self->modifyPacketIn($msg, $switch) unless ($dontMod);
 	if ($config{debugPacket_ro_received}) {
 		debug "Modified packet sent to client\n", "xkoreProxy";
@@ -277,12 +380,31 @@ sub clientSend {
 	$clientBuffer .= $msg;
 }
 
+# Whether the relay sent this message to the client. The parser returns the messages in the order they came,
+# those before it which it didn't return were dropped or changed by plugins.
+sub relayForwarded {
+	my ($self, $msg) = @_;
+	my $forwarded = $self->{relayForwarded};
+	for (my $i = 0; $i < @{$forwarded}; $i++) {
+		next if ($forwarded->[$i] ne $msg);
+		splice(@{$forwarded}, 0, $i + 1);
+		return 1;
+	}
+	return 0;
+}
+
 sub clientFlush {
 	my $self = shift;
 
+	# Every message the parser was given has been handled
+	$self->{relayForwarded} = [] if ($self->{relay});
 	return unless (length($clientBuffer));
 
-	$self->{proxy}->send($clientBuffer);
+	if ($self->{relay}) {
+		$self->{relay}->send($clientBuffer);
+	} else {
+		$self->{proxy}->send($clientBuffer);
+	}
 	debug "Client network buffer flushed out\n", "xkoreProxy";
 	$clientBuffer = '';
 }
@@ -295,6 +417,7 @@ sub clientRecv {
 	$self->{proxy}->recv($msg, 1024 * 32);
 	if (length($msg) == 0) {
 		# Connection from client closed
+		$self->stopRelay();
 		close($self->{proxy});
 		return undef;
 	}
@@ -374,6 +497,7 @@ sub checkProxy {
 			$self->serverDisconnect();
 		}
 
+		$self->stopRelay();
 		close $self->{proxy} if $self->{proxy};
 		$self->{waitClientDC} = undef;
 		debug "Removing pending packet from queue\n", "xkoreProxy" if (defined $self->{packetPending});
@@ -467,6 +591,7 @@ sub checkPacketReplay {
 			$self->{replayTimeout}{timeout} = 2.5;
 		} else {
 			error T("Client did not respond. Forcing disconnection\n"), "connection";
+			$self->stopRelay();
 			close($self->{proxy});
 			return;
 		}
@@ -58,6 +58,11 @@ our $current_plugin_folder;
 
 our @plugins;
 our %hooks;
+# Hash<String, Array<Plugins::HookEntry>> subscribers
+# The callbacks of every hook which has any, in the order callHook() calls
+# them. A list is replaced rather than changed when its hooks change, so a
+# call in progress keeps calling the callbacks it started with.
+our %subscribers;
 
 use enum qw(HOOKNAME INDEX);
 use enum qw(CALLBACK USER_DATA);
@@ -424,6 +429,7 @@ sub addHook {
 	my @handle;
 	$handle[HOOKNAME] = stringToQuark($hookName);
 	$handle[INDEX] = $hookList->add(bless(\@entry, "Plugins::HookEntry"));
+	_updateSubscribers($hookName);
 	return bless(\@handle, 'Plugins::HookHandle');
 }
 
@@ -502,6 +508,7 @@ sub delHook {
 		if ($hookList && $hookList->size() == 0) {
 			delete $hooks{$hookName};
 		}
+		_updateSubscribers($hookName);
 
 	} else {
 		ArgumentException->throw("Invalid hook handle passed to Plugins::delHook().");
@@ -531,24 +538,25 @@ sub delHooks {
 # </pre>
 #
 # See also: Plugins::addHook()
-sub callHook {
-	my ($hookName, $argument) = @_;
-	my $hookList = $hooks{$hookName};
-	if ($hookList) {
-		my @items = @{ $hookList->getItems };
-		foreach my $entry (@items) {
-			$entry->[CALLBACK]->($hookName, $argument, $entry->[USER_DATA]);
-		}
-	}
-}
+#
+# callHook() is implemented in src/auto/XSTools/misc/fastutils.xs. A hook
+# without callbacks costs a single lookup; a hook with callbacks calls the
+# list %subscribers has for it.
 
 ##
 # boolean Plugins::hasHook(String hookName)
 #
 # Check whether there are any hooks registered for the specified hook name.
-sub hasHook {
+#
+# hasHook() is implemented in src/auto/XSTools/misc/fastutils.xs.
+
+sub _updateSubscribers {
 	my ($hookName) = @_;
-	return defined $hooks{$hookName};
+	if ($hooks{$hookName}) {
+		$subscribers{$hookName} = [@{$hooks{$hookName}->getItems}];
+	} else {
+		delete $subscribers{$hookName};
+	}
 }
 
 1;
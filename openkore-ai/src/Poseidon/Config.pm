@@ -67,6 +67,7 @@ sub parseArguments {
 		'server_type=s',			\$config{server_type},
 		'debug=s',					\$config{debug},
 		'fake_ip=s',				\$config{fake_ip},
+		'query_cache_ttl=s',		\$config{query_cache_ttl},
 	);
 	
 	$config{file} = "poseidon.txt" if ($config{file} eq "");
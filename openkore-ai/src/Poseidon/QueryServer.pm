@@ -12,6 +12,7 @@ package Poseidon::QueryServer;
 
 use strict;
 use Scalar::Util;
+use Time::HiRes qw(time);
 use Base::Server;
 use Bus::MessageParser;
 use Bus::Messages qw(serialize);
@@ -24,10 +25,18 @@ use Utils qw (getFormattedDateShort);
 
 my $CLASS = "Poseidon::QueryServer";
 
+# Seconds between two summaries of the queries
+use constant STATS_INTERVAL => 60;
+
 
 # struct Request {
-#     Bytes packet;
 #     Base::Server::Client client;
+#     float time;
+# }
+#
+# struct Query {
+#     Bytes packet;
+#     Array<Request> requests;
 # }
 
 ##
@@ -38,6 +47,11 @@ my $CLASS = "Poseidon::QueryServer";
 # Require: defined($port) && defined($ROServer)
 #
 # Create a new Poseidon::QueryServer object.
+#
+# The RO client answers one query at a time, so bots which send the same
+# GameGuard packet while it's queued or asked share the answer. With
+# query_cache_ttl set in poseidon.txt, answers are also given again to
+# the same packet for that many seconds, without asking the RO client.
 sub new {
 	my ($class, $port, $host, $roServer) = @_;
 	my $self = $class->SUPER::new($port, $host);
@@ -45,20 +59,39 @@ sub new {
 	# Invariant: server isa 'Poseidon::RagnarokServer'
 	$self->{"$CLASS server"} = $roServer;
 
-	# Array<Request> queue
+	# Array<Query> queue
 	#
-	# The GameGuard query packets queue.
+	# The GameGuard queries not answered yet, the first one being the one
+	# the RO client is asked.
 	#
 	# Invariant: defined(queue)
 	$self->{"$CLASS queue"} = [];
 
+	# Hash<Bytes, Query> pending
+	#
+	# The queries of the queue, by packet.
+	#
+	# Invariant: scalar(keys pending) == scalar(@queue)
+	$self->{"$CLASS pending"} = {};
+
+	# Hash<Bytes, Hash> cache
+	#
+	# The last response to each packet, and when it was received.
+	$self->{"$CLASS cache"} = {};
+
+	$self->{"$CLASS stats"} = {
+		queries => 0, asked => 0, shared => 0, cached => 0,
+		answered => 0, totalLatency => 0, maxLatency => 0
+	};
+	$self->{"$CLASS statsTime"} = time;
+
 	return $self;
 }
 
 ##
 # void $QueryServer->process(Base::Server::Client client, String ID, Hash* args)
 #
-# Push an OpenKore GameGuard query to the queue.
+# Push an OpenKore GameGuard query to the queue, or answer it from the cache.
 sub process {
 	my ($self, $client, $ID, $args) = @_;
 
@@ -69,11 +102,6 @@ sub process {
 	
 	print "[PoseidonServer]-> Received query from bot client " . $client->getIndex() . "\n";
 
-	my %request = (
-		packet => $args->{packet},
-		client => $client
-	);
-
 	# perform client authentication here
 	Plugins::callHook('Poseidon/server_authenticate', {
 		args_hash => $args,
@@ -83,15 +111,81 @@ sub process {
 	# want the Poseidon server to respond to the query
 	return if ($args->{auth_failed});
 
+	my $now = time;
+	my $packet = $args->{packet};
+	$self->{"$CLASS stats"}{queries}++;
+
+	my $cached = $self->{"$CLASS cache"}{$packet};
+	if ($cached && $config{query_cache_ttl} > 0 && $now - $cached->{time} <= $config{query_cache_ttl}) {
+		$self->{"$CLASS stats"}{cached}++;
+		$self->reply($client, $cached->{response}, $now, 'cached result');
+		return;
+	}
+
+	my $query = $self->{"$CLASS pending"}{$packet};
+	if ($query) {
+		$self->{"$CLASS stats"}{shared}++;
+	} else {
+		$query = { packet => $packet, requests => [] };
+		$self->{"$CLASS pending"}{$packet} = $query;
+		push @{$self->{"$CLASS queue"}}, $query;
+	}
+
+	my %request = (
+		client => $client,
+		time => $now
+	);
 	Scalar::Util::weaken($request{client});
-	push @{$self->{"$CLASS queue"}}, \%request;
-#	my $packet = substr($ipcArgs->{packet}, 0, 18);
+	push @{$query->{requests}}, \%request;
+}
+
+##
+# Hash* $QueryServer->getStats()
+#
+# Returns how many queries were received, asked to the RO client, shared
+# with an identical query or answered from the cache, and how many were
+# answered with which average and maximum latency, in seconds.
+sub getStats {
+	my ($self) = @_;
+	my %stats = %{$self->{"$CLASS stats"}};
+	$stats{averageLatency} = $stats{answered} ? $stats{totalLatency} / $stats{answered} : 0;
+	return \%stats;
 }
 
 
 ##################################################
 
 
+# Sends a response to a bot client, which waited for it since $since
+sub reply {
+	my ($self, $client, $response, $since, $description) = @_;
+	my $stats = $self->{"$CLASS stats"};
+	my $latency = time - $since;
+
+	$client->send(serialize("Poseidon Reply", { packet => $response }));
+	$client->close();
+	$stats->{answered}++;
+	$stats->{totalLatency} += $latency;
+	$stats->{maxLatency} = $latency if ($latency > $stats->{maxLatency});
+	printf("[PoseidonServer]-> Sent %s to client %s after %d ms\n", $description, $client->getIndex(), $latency * 1000);
+}
+
+# Forgets the responses older than query_cache_ttl
+sub expireCache {
+	my ($self, $now) = @_;
+	my $cache = $self->{"$CLASS cache"};
+	foreach my $packet (keys %{$cache}) {
+		delete $cache->{$packet} if ($now - $cache->{$packet}{time} > $config{query_cache_ttl});
+	}
+}
+
+sub printStats {
+	my ($self) = @_;
+	my $stats = $self->getStats();
+	printf("[PoseidonServer]-> %d queries: %d asked, %d shared, %d cached; %d answered in %d ms on average, %d ms at most\n",
+		@{$stats}{qw(queries asked shared cached answered)}, $stats->{averageLatency} * 1000, $stats->{maxLatency} * 1000);
+}
+
 sub onClientNew {
 	my ($self, $client, $index) = @_;
 	$client->{"$CLASS parser"} = new Bus::MessageParser();
@@ -128,22 +222,32 @@ sub iterate {
 
 	if ($server->getState() eq 'requested') 
 	{
-		# Send the response to the client.
-		if (@{$queue} > 0 && $queue->[0]{client}) {
-			my ($data, %args);
-
-			$args{packet} = $server->readResponse();
-			visualDump($args{packet}) if ($config{debug});
-			$data = serialize("Poseidon Reply", \%args);
-			$queue->[0]{client}->send($data);
-			$queue->[0]{client}->close();
-			print "[PoseidonServer]-> Sent result to client : " . $queue->[0]{client}->getIndex() . "\n";
+		# Send the response to the clients which asked for it, the ones
+		# which disconnected meanwhile are gone
+		my $response = $server->readResponse();
+		my $query = shift @{$queue};
+		if ($query) {
+			my $now = time;
+			delete $self->{"$CLASS pending"}{$query->{packet}};
+			visualDump($response) if ($config{debug});
+			if ($config{query_cache_ttl} > 0) {
+				$self->expireCache($now);
+				$self->{"$CLASS cache"}{$query->{packet}} = { response => $response, time => $now };
+			}
+			foreach my $request (@{$query->{requests}}) {
+				$self->reply($request->{client}, $response, $request->{time}, 'result') if ($request->{client});
+			}
 		}
-		shift @{$queue};
 
 	} elsif (@{$queue} > 0 && $server->getState() eq 'ready') {
 		print "[PoseidonServer]-> Querying Ragnarok Online client [" . getFormattedDateShort(time, 1) . "]...\n";
 		$server->query($queue->[0]{packet});
+		$self->{"$CLASS stats"}{asked}++ if ($server->getState() eq 'requesting');
+	}
+
+	if (time - $self->{"$CLASS statsTime"} >= STATS_INTERVAL) {
+		$self->printStats() if ($self->{"$CLASS stats"}{queries});
+		$self->{"$CLASS statsTime"} = time;
 	}
 }
 
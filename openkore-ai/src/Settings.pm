@@ -51,9 +51,11 @@ use FindBin qw($RealBin);
 use Getopt::Long;
 use File::Path qw/make_path/;
 use File::Spec;
+use B;
 use Translation qw(T TF);
 use Utils::ObjectList;
 use Utils::Exceptions;
+use Utils::TableCache;
 use List::MoreUtils qw( uniq );
 use Globals qw( %config @servers );
 
@@ -129,6 +131,8 @@ our $dead_log_file;
 our $sys_file;
 
 our $interface;
+our $log_sink;
+our $log_sink_format;
 our $lockdown;
 our $starting_ai;
 our $command;
@@ -176,6 +180,8 @@ sub parseArguments {
 	undef $storage_log_file;
 	undef $sys_file;
 	undef $interface;
+	undef $log_sink;
+	undef $log_sink_format;
 	undef $lockdown;
 
 	# Allow plugins to have their own command line options.
@@ -200,6 +206,8 @@ sub parseArguments {
 		'sys=s',			\$sys_file,
 
 		'interface=s',		\$interface,
+		'log-sink=s',		\$log_sink,
+		'log-sink-format=s',	\$log_sink_format,
 		'lockdown',			\$lockdown,
 		'ai=s',				\$starting_ai,
 		'command=s',		\$command,
@@ -335,6 +343,10 @@ sub getUsageText {
 
 		Other options:
 		--interface=NAME          Which interface to use at startup.
+		--log-sink=TARGET         Write console messages as records to TARGET
+		                          (ring:FILE[:SIZE] or unix:SOCKET) instead of
+		                          the terminal. Unix only.
+		--log-sink-format=FORMAT  The format of the records: json or binary.
 		--lockdown                Disable potentially insecure features.
 		--ai                      Starting AI mode (on, manual, off) (default: on)
 		--command=COMMAND         Initial command to place on the AI queue
@@ -440,7 +452,16 @@ sub addControlFile {
 ##
 # Settings::addTableFile(String name, options...)
 #
-# This is like Settings::addControlFile(), but for table files.
+# This is like Settings::addControlFile(), but for table files. It also
+# allows this option:
+# `l
+# - cache: whether the table may be loaded from a Utils::TableCache image,
+#       while the tableCache option of config.txt is set, instead of being
+#       parsed. The loader must be an array, the references in which are all
+#       filled by the loader and by nothing else. This may be the name of a
+#       hook through which plugins parse the table instead, the image isn't
+#       used while the hook has callbacks.
+# `l`
 sub addTableFile {
 	my $name = shift;
 	return _addFile($name, TABLE_FILE_TYPE, @_);
@@ -549,7 +570,16 @@ sub loadByHandle {
 		$load->{args} = \@array;
 		Plugins::callHook('load_'.$internalFilename, $load);
 		unless ($load->{return}) {
-			$loader->($filename, @array);
+			if (!_useTableCache($object)) {
+				$loader->($filename, @array);
+			} else {
+				my $signature = _tableCacheSignature($object, $loader, @array);
+				my @targets = grep { ref($_) } @array;
+				if (!Utils::TableCache::load($filename, $signature, @targets)) {
+					$loader->($filename, @array);
+					Utils::TableCache::save($filename, $signature, @targets);
+				}
+			}
 		}
 		$pos_load->{args} = \@array;
 		Plugins::callHook('pos_load_'.$internalFilename, $pos_load);
@@ -859,13 +889,31 @@ sub _addFile {
 		autoSearch => exists($options{autoSearch}) ? $options{autoSearch} : 1,
 		onLoaded => exists($options{onLoaded}) ? $options{onLoaded} : undef,
 		internalName => exists($options{internalName}) ? $options{internalName} : undef,
-		loader     => $options{loader}
+		loader     => $options{loader},
+		cache      => $options{cache}
 	};
 	my $index = $files->add(bless($object, 'Settings::Handle'));
 	$object->{index} = $index;
 	return $index;
 }
 
+# Whether a table file is loaded through its Utils::TableCache image, see Settings::addTableFile()
+sub _useTableCache {
+	my ($object) = @_;
+	return 0 unless ($object->{cache} && $config{tableCache} && $object->{type} == TABLE_FILE_TYPE);
+	return !($object->{cache} ne '1' && Plugins::hasHook($object->{cache}));
+}
+
+# What an image must have been made by: the table, the loader and its other arguments, and the
+# modification time of the loader's source, so that images made by an older parser aren't used
+sub _tableCacheSignature {
+	my ($object, $loader, @args) = @_;
+	my $code = B::svref_2object($loader);
+	my $time = (stat($code->FILE))[9] || 0;
+	return join("\0", $object->{internalName} || $object->{name}, $code->GV->NAME, $time,
+		map { ref($_) || (defined($_) ? $_ : '') } @args);
+}
+
 sub _processSysConfig {
 	my ($writeMode) = @_;
 	my ($f, @lines, %keysNotWritten);
@@ -25,6 +25,7 @@ use Task;
 use base qw(Task);
 use Task::Route;
 use Field;
+use Utils::PathFinding;
 use Globals qw(%config $field %portals_lut %portals_los %timeout $char %routeWeights %portals_commands %portals_spawns %portals_airships);
 use Translation qw(T TF);
 use Log qw(debug warning error);
@@ -214,11 +215,25 @@ sub iterate {
 		debug "CalcMapRoute - initialized with '".(scalar keys %{$openlist})."' options.\n", "calc_map_route";
 
 	} elsif ( $self->{stage} == CALCULATE_ROUTE ) {
+		unless ($self->{graph}) {
+			# The portal graph is built for every route: portals may be enabled or disabled at any time
+			$self->{graph} = PathFinding::PortalGraph->new(
+				portals => \%portals_lut,
+				los => \%portals_los,
+				airships => $self->{noAirship} ? undef : \%portals_airships,
+				weights => \%routeWeights,
+				budget => $self->{budget},
+				tickets => $self->{tickets_amount}
+			);
+			$self->{graph}->open($_, $self->{openlist}{$_}) foreach (keys %{$self->{openlist}});
+		}
+
 		my $time = time;
 		while ( !$self->{done} && (!$self->{maxTime} || !timeOut($time, $self->{maxTime})) ) {
 			$self->searchStep();
 		}
 		if ($self->{found}) {
+			delete $self->{graph};
 			delete $self->{openlist};
 			delete $self->{solution};
 			delete $self->{closelist};
@@ -228,6 +243,7 @@ sub iterate {
 			debug sprintf("%s\n", $self->getRouteString()), "calc_map_route";
 
 		} elsif ($self->{done}) {
+			delete $self->{graph};
 			my $destpos = $self->{targets}[0]->{x} ? " (".$self->{targets}[0]->{x}.",".$self->{targets}[0]->{y}.")" : undef;
 			$self->setError(CANNOT_CALCULATE_ROUTE, TF("Cannot calculate a route from %s (%d,%d) to %s%s",
 				$self->{source}{field}->baseName, $self->{source}{x}, $self->{source}{y},
@@ -279,32 +295,23 @@ sub getFullRouteString {
 sub searchStep {
 	my ($self) = @_;
 	# declare portals list
-	my $openlist = $self->{openlist}; # Nodes not visited yet
+	my $openlist = $self->{openlist}; # Starting nodes not visited yet, the graph holds the others
 	my $closelist = $self->{closelist}; # Nodes already visited
 
-	# exit early if no more paths to check
-	unless ($openlist && %{$openlist}) {
+	# closes the node with the lowest walk cost, and opens the ones reachable from it
+	my ($parent, $node) = $self->{graph}->next();
+	unless (defined $parent) {
 		$self->{done} = 1;
 		$self->{found} = '';
 		return 0;
 	}
+	debug "[CalcMapRoute - searchStep - Loop] $parent, $node->{walk}\n", "calc_map_route";
 
-	# selects the node with the lowest walk cost
-	my $parent = (sort {$openlist->{$a}{walk} <=> $openlist->{$b}{walk}} keys %{$openlist})[0];
-	debug "[CalcMapRoute - searchStep - Loop] $parent, $openlist->{$parent}{walk}\n", "calc_map_route";
-
-	# Uncomment this if you want minimum MAP count. Otherwise use the above for minimum step count
-	#foreach my $parent (keys %{$openlist})
 		my ($portal, $dest) = split /=/, $parent;
-		# skip if budget exceeded
-		if ($self->{budget} ne '' && $self->{budget} < ($openlist->{$parent}{zeny} - $openlist->{$parent}{zeny_covered_by_tickets})) {
-			# This link is too expensive
-			delete $openlist->{$parent};
-			next;
-
-		} else {
-			# MOVE this entry into the CLOSELIST
-			$closelist->{$parent} = delete $openlist->{$parent};
+		# MOVE this entry into the CLOSELIST, keeping what the openlist knew about the starting nodes
+		$closelist->{$parent} = { %{ delete($openlist->{$parent}) || {} }, %{$node} };
+		if ($node->{is_airship} && !defined $closelist->{$parent}{airship_message}) {
+			$closelist->{$parent}{airship_message} = hashSafeGetValue(\%portals_airships, $portal, 'dest', $dest, 'message');
 		}
 
 		# support to multiple targets
@@ -374,56 +381,6 @@ sub searchStep {
 				return;
 			}
 		}
-
-		# get all children of each openlist.
-		# explore connected portals and NPC warps
-		foreach my $child (keys %{$portals_los{$dest}}) {
-			next unless $portals_los{$dest}{$child}; # next if no child
-			# iterates through the child's/portals that have connection to destination
-			foreach my $subchild (grep { $portals_lut{$child}{dest}{$_}{enabled} } keys %{$portals_lut{$child}{dest}}) {
-				my $destID = $subchild;
-				my $mapName = $portals_lut{$child}{source}{map};
-				#############################################################
-				my $penalty = int($routeWeights{lc($mapName)}) +
-					int(($portals_lut{$child}{dest}{$subchild}{steps} ne '') ? $routeWeights{NPC} : $routeWeights{PORTAL}); # get node/child penalty based on routeWeights
-				my $thisWalk = $penalty + $closelist->{$parent}{walk} + $portals_los{$dest}{$child}; # calculate the final node/child penalty routeWeights + walk distance + accumulated cost
-				if (!exists $closelist->{"$child=$subchild"}) { # check if node is already explorated
-					if ( !exists $openlist->{"$child=$subchild"} || $openlist->{"$child=$subchild"}{walk} > $thisWalk ) { # check the current node cost less
-						debug "[CalcMapRoute - searchStep - Add] from '$parent' to '$child=$subchild' cost '$thisWalk'\n", "calc_map_route", 2;
-						$openlist->{"$child=$subchild"}{parent} = $parent;
-						$openlist->{"$child=$subchild"}{walk} = $thisWalk;
-						$openlist->{"$child=$subchild"}{zeny} = $closelist->{$parent}{zeny} + $portals_lut{$child}{dest}{$subchild}{cost};
-						$openlist->{"$child=$subchild"}{allow_ticket} = $portals_lut{$child}{dest}{$subchild}{allow_ticket};
-						if ($openlist->{"$child=$subchild"}{allow_ticket} && $self->{tickets_amount} > $openlist->{"$child=$subchild"}{amount_of_tickets_used}) { # checks if route allow use ticket and how many we spent so far
-							$openlist->{"$child=$subchild"}{zeny_covered_by_tickets} = $closelist->{$parent}{zeny_covered_by_tickets} + $openlist->{"$child=$subchild"}{zeny};
-							$openlist->{"$child=$subchild"}{amount_of_tickets_used} = $closelist->{$parent}{amount_of_tickets_used} + 1;
-						} else {
-							$openlist->{"$child=$subchild"}{zeny_covered_by_tickets} = $closelist->{$parent}{zeny_covered_by_tickets};
-							$openlist->{"$child=$subchild"}{amount_of_tickets_used} = $closelist->{$parent}{amount_of_tickets_used};
-						}
-					}
-				}
-			}
-
-			next if ($self->{noAirship} || !exists $portals_airships{$child});
-			# iterates airships
-			foreach my $subchild (grep { $portals_airships{$child}{dest}{$_}{enabled} } keys %{$portals_airships{$child}{dest}}) {
-				my $destID = $subchild;
-				my $mapName = $portals_airships{$child}{source}{map};
-				#############################################################
-				my $penalty = int($routeWeights{lc($mapName)}) + $routeWeights{AIRSHIP}; # get node/child penalty based on routeWeights
-				my $thisWalk = $penalty + $closelist->{$parent}{walk} + $portals_los{$dest}{$child}; # calculate the final node/child penalty routeWeights + walk distance + accumulated cost
-				if (!exists $closelist->{"$child=$subchild"}) { # check if node is already explorated
-					if ( !exists $openlist->{"$child=$subchild"} || $openlist->{"$child=$subchild"}{walk} > $thisWalk ) { # check the current node cost less
-						$openlist->{"$child=$subchild"}{parent} = $parent;
-						$openlist->{"$child=$subchild"}{walk} = $thisWalk;
-						$openlist->{"$child=$subchild"}{zeny} = $closelist->{$parent}{zeny};
-						$openlist->{"$child=$subchild"}{airship_message} = $portals_airships{$child}{dest}{$subchild}{message};
-						$openlist->{"$child=$subchild"}{is_airship} = 1;
-					}
-				}
-			}
-		}
 }
 
 # Add @go commands to openlist
@@ -19,6 +19,7 @@ use Scalar::Util;
 
 use Modules 'register';
 use Globals;
+use Field;
 use Task::WithSubtask;
 use Task::Route;
 use Task::CalcMapRoute;
@@ -177,6 +178,7 @@ sub iterate {
 		delete $self->{missing_portal};
 		delete $self->{guess_portal};
 		shift @{$self->{mapSolution}};
+		$self->prefetchFields();
 
 	} elsif ( $self->{mapSolution}[0]{is_command} ) {
 		$self->{timeout} = time unless $self->{timeout};
@@ -768,6 +770,18 @@ sub initMapCalculator {
 	$self->setSubtask($task);
 }
 
+# Starts loading the next route_prefetchFields fields of the map solution in the background,
+# so that entering them doesn't stall the bot while the field is loaded.
+sub prefetchFields {
+	my ($self) = @_;
+	return unless ($config{route_prefetchFields} && @{$self->{mapSolution}});
+
+	my @maps = map { $_->{map} } @{$self->{mapSolution}}[1 .. $#{$self->{mapSolution}}];
+	push @maps, $self->{dest}{map};
+	splice(@maps, $config{route_prefetchFields}) if (@maps > $config{route_prefetchFields});
+	Field->prefetch(@maps);
+}
+
 sub subtaskDone {
 	my ($self, $task) = @_;
 	if ($task->isa('Task::CalcMapRoute')) {
@@ -783,6 +797,7 @@ sub subtaskDone {
 
 		} else {
 			$self->{mapSolution} = $task->getRoute();
+			$self->prefetchFields();
 			# The map solution is empty, meaning that the destination
 			# is on the same map and that we can walk there directly.
 			# Of course, we only do that if we have a specific position
@@ -35,7 +35,7 @@ use Network;
 use Field;
 use Translation qw(T TF);
 use Misc;
-use Utils qw(timeOut adjustedBlockDistance distance blockDistance calcPosFromPathfinding);
+use Utils qw(timeOut distance blockDistance calcPosFromPathfinding);
 use Utils::Exceptions;
 use Utils::Set;
 use Utils::PathFinding;
@@ -58,6 +58,9 @@ use enum qw(
 
 # TODO: Add Homunculus support
 
+# Shared PathFinding session used by getRoute()
+my $routePathfinding;
+
 
 ##
 # Task::Route->new(options...)
@@ -228,6 +231,11 @@ sub iterate {
 			@{$self->{last_pos_to}}{qw(x y)} = @{$pos_to}{qw(x y)};
 			$self->{start} = 1;
 			$self->{confirmed_correct_vector} = 0;
+
+			# With route_smooth, the solution is made of straight walks, moving to the end of each is enough to walk it
+			if ($config{$self->{actor}{configPrefix}.'route_smooth'}) {
+				@{$self->{solution}} = $self->{dest}{map}->smoothSolution($self->{solution}, $config{$self->{actor}{configPrefix}.'route_step'});
+			}
 			
 			if ($self->{pyDistFromGoal} || $self->{distFromGoal}) {
 				$self->{anyDistFromGoal} = 1;
@@ -266,6 +274,9 @@ sub iterate {
 
 			$self->iterate();
 
+		} elsif ($self->{searchInProgress}) {
+			# The route search used up its time slice or runs in the background, it goes on in the next iteration
+
 		} else {
 			debug "Something's wrong; there is no path from " . $self->{dest}{map}->baseName . "($calc_pos->{x},$calc_pos->{y}) to " . $self->{dest}{map}->baseName . "($self->{dest}{pos}{x},$self->{dest}{pos}{y}).\n", "route";
 			$self->setError(CANNOT_CALCULATE_ROUTE, "Unable to calculate a route.");
@@ -283,6 +294,7 @@ sub iterate {
 		if ($self->{maxDistance} && $self->{maxDistance} < @{$solution}) {
 			splice(@{$solution}, 1 + $self->{maxDistance});
 		}
+		$self->{routeCursor} = PathFinding::RouteCursor->new($solution);
 
 		undef $self->{mapChanged};
 		undef $self->{step_index};
@@ -339,58 +351,17 @@ sub iterate {
 		} else {
 			# Failsafe
 			my $lookahead_failsafe_max = $self->{step_index} + 1;
-			my $lookahead_failsafe_count;
 
 			# This looks ahead in the solution array and finds the closest position in it to our current {pos}, then it looks $lookahead_failsafe_max further, just to be sure
-			
-			$lookahead_failsafe_count = 0;
-			my $best_index;
-			my $best_dist;
-			
-			foreach my $step_i (0..$#{$solution}) {
-				my $step = $solution->[$step_i];
-				if ($step->{x} == $current_calc_pos->{x} && $step->{y} == $current_calc_pos->{y}) {
-					$best_index = $step_i;
-					$best_dist = 0;
-					last;
-				}
-				my $dist = adjustedBlockDistance($current_calc_pos, $step);
-				if (!defined $best_dist || $best_dist > $dist) {
-					$best_index = $step_i;
-					$best_dist = $dist;
-					$lookahead_failsafe_count = 0;
-				} else {
-					$lookahead_failsafe_count++;
-				}
-				if ($lookahead_failsafe_count == $lookahead_failsafe_max) {
-					last;
-				}
+			# The steps are kept natively by the route cursor, which is made again if the solution was changed
+			my $cursor = $self->{routeCursor};
+			if (!$cursor || $cursor->size != @{$solution}) {
+				$cursor = $self->{routeCursor} = PathFinding::RouteCursor->new($solution);
 			}
-			my $best_pos_step = $best_index;
+			my $best_pos_step = $cursor->locate($current_calc_pos->{x}, $current_calc_pos->{y}, $lookahead_failsafe_max);
 
 			# This does the same, but with {pos_to}
-			undef $best_index;
-			undef $best_dist;
-			foreach my $step_i (0..$#{$solution}) {
-				my $step = $solution->[$step_i];
-				if ($step->{x} == $current_pos_to->{x} && $step->{y} == $current_pos_to->{y}) {
-					$best_index = $step_i;
-					$best_dist = 0;
-					last;
-				}
-				my $dist = adjustedBlockDistance($current_pos_to, $step);
-				if (!defined $best_dist || $best_dist > $dist) {
-					$best_index = $step_i;
-					$best_dist = $dist;
-					$lookahead_failsafe_count = 0;
-				} else {
-					$lookahead_failsafe_count++;
-				}
-				if ($lookahead_failsafe_count == $lookahead_failsafe_max) {
-					last;
-				}
-			}
-			my $best_pos_to_step = $best_index;
+			my $best_pos_to_step = $cursor->locate($current_pos_to->{x}, $current_pos_to->{y}, $lookahead_failsafe_max);
 
 			# Here there may be the need to check if 'pos' has changed yet best_pos_step is still the same, creating a lag in the movement
 
@@ -422,6 +393,7 @@ sub iterate {
 				debug "Route $self->{actor} - trimming down solution (" . @{$solution} . ") by ".($best_pos_step)." steps\n", "route";
 
 				splice(@{$solution}, 0, $best_pos_step);
+				$cursor->trim($best_pos_step);
 			}
 
 			$self->{last_best_pos_step} = $best_pos_step;
@@ -560,20 +532,12 @@ sub iterate {
 			# Here maybe we should also use pos_to (in the form of best_pos_to_step) to decide the next step index, as it can make the routing way more responsive
 
 			
-			if ($self->{anyDistFromGoal}) {
-				my $step = $solution->[$self->{step_index}];
-				# We are close enough to the destination
-				if (exists $step->{closeToEnd} && $step->{closeToEnd}) {
-					my $current_i = $self->{step_index};
-					while (1) {
-						last if ($current_i == 0);
-						last if ($solution->[($current_i-1)]{closeToEnd} == 0);
-						$current_i--;
-					}
-					$self->{step_index} = $current_i;
-				}
-			}
-			@{$self->{next_pos}}{qw(x y)} = @{$solution->[$self->{step_index}]}{qw(x y)};
+			# With anyDistFromGoal, the first step close enough to the destination is far enough.
+			# A smoothed solution keeps moving to the end of the straight walk we are on, instead of a cell which moves
+			# along with us. Once it is about reached the next one is taken, so we don't stop on it.
+			my ($step_index, $next_x, $next_y) = $self->{routeCursor}->nextStep($self->{step_index}, $self->{anyDistFromGoal});
+			$self->{step_index} = $step_index;
+			@{$self->{next_pos}}{qw(x y)} = ($next_x, $next_y);
 
 			# But first, check whether the distance of the next point isn't abnormally large.
 			# If it is, then we've moved to an unexpected place. This could be caused by auto-attack, for example.
@@ -702,6 +666,8 @@ sub resetRoute {
 	my ($self) = @_;
 	$self->{solution} = [];
 	$self->{stage} = CALCULATE_ROUTE;
+	delete $self->{searchInProgress};
+	delete $self->{routeCursor};
 }
 
 ##
@@ -725,6 +691,12 @@ sub resetRoute {
 sub getRoute {
 	my ($class, $solution, $field, $start, $dest, $avoidWalls, $randomFactor, $useManhattan, $self_call) = @_;
 	assertClass($field, 'Field') if DEBUG;
+
+	# Resume the search which used up its time slice in a previous iteration
+	if ($self_call && ref($class) && $class->{searchInProgress}) {
+		return (routeSearchStep($class, $solution, $class->{searchInProgress}) >= 0 ? 1 : 0);
+	}
+
 	if (!defined $dest->{x} || $dest->{y} eq '') {
 		@{$solution} = () if ($solution);
 		return 1;
@@ -756,14 +728,28 @@ sub getRoute {
 
 	Plugins::callHook('getRoute' => \%plugin_args);
 
+	# With route_searchTimeSlice, the task searches for at most that many microseconds per iteration.
+	# With route_searchWorkers, the search runs in a worker thread and the task checks every iteration whether it is done.
+	my $sliced = !$plugin_args{return} && $self_call && ref($class) && $config{route_searchTimeSlice};
+	my $background = !$plugin_args{return} && $self_call && ref($class) && $config{route_searchWorkers}
+		&& (PathFinding::workers() || PathFinding::startWorkers($config{route_searchWorkers}));
+
 	my $pathfinding;
 	if ($plugin_args{return}) {
 		$pathfinding = $plugin_args{pathfinding};
 	} else {
-		$pathfinding = new PathFinding();
+		# Routes longer than route_hierarchicalMinDistance are planned on the field's abstract graph instead of the full map
+		if ($config{route_hierarchicalMinDistance} && blockDistance($closest_start, $closest_dest) >= $config{route_hierarchicalMinDistance}) {
+			return 1 if (getHierarchicalRoute($solution, $field, $closest_start, $closest_dest, $avoidWalls, $randomFactor, $useManhattan));
+		}
+
+		# Reuse one session across routes, resetting it is much cheaper than allocating a new one.
+		# Sliced and background searches go on after this call, so each task has its own session for them.
+		$pathfinding = ($sliced || $background) ? ($class->{pathfinding} ||= new PathFinding()) : ($routePathfinding ||= new PathFinding());
 	}
 
-	# Calculate path
+	# Calculate path, with route_landmarks the search is guided by the field's landmark tables (see Field->landmarks())
+	# and with route_weightProfile it keeps away from the walls as that weight profile says (see Field->weightProfileMap())
 	$pathfinding->reset(
 		start => $closest_start,
 		dest  => $closest_dest,
@@ -771,20 +757,67 @@ sub getRoute {
 		avoidWalls => $avoidWalls,
 		randomFactor => $randomFactor,
 		useManhattan => $useManhattan,
+		time_budget => $sliced ? $config{route_searchTimeSlice} : undef,
+		danger => $field->{dangerMap},
+		landmarks => $config{route_landmarks} ? $field->landmarks : undef,
+		weight_profile => $config{route_weightProfile},
 		getRoute => 1
 	);
 	return undef if (!$pathfinding);
 
 	my $ret;
-	if ($solution) {
+	if ($background && $pathfinding->submit) {
+		$ret = routeSearchStep($class, $solution, $pathfinding);
+	} elsif ($sliced) {
+		$ret = routeSearchStep($class, $solution, $pathfinding);
+	} elsif ($solution) {
 		$ret = $pathfinding->run($solution);
 	} else {
 		$ret = $pathfinding->runcount();
 	}
 
+	# The search ran out of time, which happens for long routes on big maps, retry it on the abstract graph
+	if ($ret == -3 && !$plugin_args{return}) {
+		return 1 if (getHierarchicalRoute($solution, $field, $closest_start, $closest_dest, $avoidWalls, $randomFactor, $useManhattan));
+	}
+
 	return ($ret >= 0 ? 1 : 0);
 }
 
+# Runs the task's route search until it finishes or uses up its time slice, or checks whether its background
+# search is done. Unfinished searches are kept in searchInProgress for the next getRoute() call.
+# Returns: the same as PathFinding->run(), -4 while the search is not finished.
+sub routeSearchStep {
+	my ($self, $solution, $pathfinding) = @_;
+	my $ret = $pathfinding->poll ? $pathfinding->collect($solution) : -4;
+	if ($ret == -4) {
+		$self->{searchInProgress} = $pathfinding;
+	} else {
+		delete $self->{searchInProgress};
+	}
+	return $ret;
+}
+
+# Calculates a route with the field's hierarchical pathfinding graph, see Utils/HierarchicalPathFinding.pm
+# Returns: 1 if a route was found, 0 if not.
+sub getHierarchicalRoute {
+	my ($solution, $field, $start, $dest, $avoidWalls, $randomFactor, $useManhattan) = @_;
+	my $graph = $field->abstractGraph;
+	return 0 unless ($graph);
+
+	my @path = $graph->findPath(
+		start => $start,
+		dest  => $dest,
+		avoidWalls => $avoidWalls,
+		randomFactor => $randomFactor,
+		useManhattan => $useManhattan
+	);
+	return 0 unless (@path);
+
+	@{$solution} = @path if ($solution);
+	return 1;
+}
+
 sub mapChanged {
 	my (undef, undef, $holder) = @_;
 	my $self = $holder->[0];
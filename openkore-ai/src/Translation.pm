@@ -151,15 +151,14 @@ sub _autodetect {
 # my $t = new Translation;
 # print($t->translate("hello world\n"));
 sub translate {
-	my ($self, $message) = @_;
-	_translate($self->{trans}, \$message);
-	return $message;
+	my $self = shift;
+	return _T($self->{trans}, $_[0]);
 }
 
 sub translatef {
-	my ($self, $rawMessage, @content) = @_;
-	_translate($self->{trans}, \$rawMessage);
-	return sprintf($rawMessage, @content);
+	my $self = shift;
+	my $format = _T($self->{trans}, shift);
+	return sprintf($format, @_);
 }
 
 ##
@@ -179,9 +178,8 @@ sub translatef {
 # Translation::initDefault();
 # print(T("hello world\n"));
 sub T {
-	my ($message) = @_;
-	_translate($_translation->{trans}, \$message);
-	return $message;
+	# Passing $_[0] itself lets _T() recognize string literals it has seen before
+	return _T($_translation->{trans}, $_[0]);
 }
 
 ##
@@ -198,9 +196,8 @@ sub T {
 # Example:
 # print(TF("Go to %s for more information", $url));
 sub TF {
-	my $message = shift;
-	_translate($_translation->{trans}, \$message);
-	return sprintf($message, @_);
+	my $format = _T($_translation->{trans}, shift);
+	return sprintf($format, @_);
 }
 
 ##
@@ -58,6 +58,8 @@ our @EXPORT = (
 our %strings;
 our %quarks;
 
+my $client_solution_pathfinding;
+
 use constant {
 	MOVE_COST => 10,
 	MOVE_DIAGONAL_COST => 14,
@@ -89,20 +91,19 @@ sub get_client_solution {
 	# Game client uses the same A* Pathfinding as openkore but uses and inadmissible heuristic (Manhattan distance)
 	# To better simulate the client pathfinding we tell openkore's pathfinding to use the same Manhattan heuristic
 	# We also deactivate any custom pathfinding weights (randomFactor, avoidWalls, customWeights)
-	# TODO: This 35 probably should be something dynamic like (max(abs(pos_x-posto_x),abs(pos_y-posto_y)))
-	my ($min_pathfinding_x, $min_pathfinding_y, $max_pathfinding_x, $max_pathfinding_y) = $field->getSquareEdgesFromCoord($pos, 35);
-	my $dist_path = new PathFinding(
+	# The search starts in a window around both positions, which only grows when the path has to go around something
+	# A single session is reused for every call so its node buffers stay allocated between searches
+	$client_solution_pathfinding ||= new PathFinding();
+	$client_solution_pathfinding->reset(
 		field => $field,
 		start => $pos,
 		dest => $pos_to,
 		avoidWalls => 0,
 		randomFactor => 0,
 		useManhattan => 1,
-		min_x => $min_pathfinding_x,
-		max_x => $max_pathfinding_x,
-		min_y => $min_pathfinding_y,
-		max_y => $max_pathfinding_y
-	)->run($solution);
+		window => 5
+	);
+	$client_solution_pathfinding->run($solution);
 	return $solution;
 }
 
@@ -182,6 +183,31 @@ sub get_solution {
 	}
 }
 
+##
+# clientPath(field, actor)
+# Returns: a hash with the packed solution of the current move of $actor (as returned by PathFinding::run_packed())
+#          and the times when each of its cells is reached (as returned by PathFinding::solutionTimes()).
+#
+# The path is computed once for every move, and kept in the actor until it moves again.
+sub clientPath {
+	my ($field, $actor) = @_;
+	my $you = UNIVERSAL::isa($actor, "Actor::You");
+	my $key = join(' ', $actor->{time_move}, @{$actor->{pos}}{qw(x y)}, @{$actor->{pos_to}}{qw(x y)}, $you ? $actor->{solution} : ());
+	my $path = $actor->{client_path};
+
+	if (!$path || $path->{key} ne $key) {
+		# The character's solution was saved at Receive.pm::character_moves
+		my $solution = $you ? $actor->{solution} : get_solution($field, $actor->{pos}, $actor->{pos_to});
+		my $packed = pack('v*', map { ($_->{x}, $_->{y}) } @{$solution || []});
+		$path = $actor->{client_path} = {
+			key => $key,
+			solution => $packed,
+			times => PathFinding::solutionTimes($packed),
+		};
+	}
+	return $path;
+}
+
 # Currently the go-to function to get the position of a given actor on critical ocasions (eg. Attack logic)
 sub calcPosFromPathfinding {
 	my ($field, $actor, $extra_time) = @_;
@@ -193,24 +219,16 @@ sub calcPosFromPathfinding {
 		return $actor->{pos};
 	}
 
-	my $solution;
-
-	# If the actor is the character then we should have already saved the time calc and solution at Receive.pm::character_moves
-	if (UNIVERSAL::isa($actor, "Actor::You")) {
-		if ($time >= $actor->{time_move_calc}) {
-			return $actor->{pos_to};
-		}
-		$solution = $actor->{solution};
-
-	} else {
-		$solution = get_solution($field, $actor->{pos}, $actor->{pos_to});
+	if (UNIVERSAL::isa($actor, "Actor::You") && $time >= $actor->{time_move_calc}) {
+		return $actor->{pos_to};
 	}
 
-	my $steps_walked = calcStepsWalkedFromTimeAndSolution($solution, $speed, $time);
-
-	my $pos = $solution->[$steps_walked];
+	my $path = clientPath($field, $actor);
+	my $steps_walked = PathFinding::stepAtTime($path->{times}, $speed, $time);
+	return undef unless (defined $steps_walked);
 
-	return $pos;
+	my ($x, $y) = PathFinding::packedCell($path->{solution}, $steps_walked);
+	return { x => $x, y => $y };
 }
 
 # Wrapper for calcTimeFromSolution so you don't need to call get_client_solution and calcTimeFromSolution when you only need the time
@@ -413,10 +431,8 @@ sub calcPosFromTime {
 		return $pos;
 	}
 
-	my $solution = get_client_easy_solution($pos, $pos_to);
-	my $steps_walked = calcStepsWalkedFromTimeAndSolution($solution, $speed, $time);
-	my $pos = $solution->[$steps_walked];
-	return $pos;
+	my ($x, $y) = PathFinding::easyPosAtTime($pos->{x}, $pos->{y}, $pos_to->{x}, $pos_to->{y}, $speed, $time);
+	return { x => $x, y => $y };
 }
 
 ##
@@ -1062,12 +1078,9 @@ sub getCoordString {
 	my $x = int(shift);
 	my $y = int(shift);
 	my $nopadding = shift;
-	my $coords = "";
+	# 0x44, then x and y in 10 bits each, then 4 bits of 0
+	my $coords = pack('N', 0x44000000 | (($x & 0x3FF) << 14) | (($y & 0x3FF) << 4));
 
-	shiftPack(\$coords, 0x44, 8);
-	shiftPack(\$coords, $x, 10);
-	shiftPack(\$coords, $y, 10);
-	shiftPack(\$coords, 0, 4);
 	$coords = substr($coords, 1)
 		if (($masterServer->{serverType} == 0) || $nopadding);
 
@@ -1078,12 +1091,9 @@ sub getCoordString2 {
 	my $x = int(shift);
 	my $y = int(shift);
 	my $nopadding = shift;
-	my $coords = "";
+	# 0x44, then x and y in 10 bits each, then 28 bits of 0
+	my $coords = pack('C N x2', 0x44, (($x & 0x3FF) << 22) | (($y & 0x3FF) << 12));
 
-	shiftPack(\$coords, 0x44, 8);
-	shiftPack(\$coords, $x, 10);
-	shiftPack(\$coords, $y, 10);
-	shiftPack(\$coords, 0, 28);
 	$coords = substr($coords, 1)
 		if (($masterServer->{serverType} == 0) || ($masterServer->{serverType} == 3) || ($masterServer->{serverType} == 5) || $nopadding);
 
@@ -1234,11 +1244,6 @@ sub judgeSkillArea {
 # Another 0.5 bytes or 4 bits are reserved for body direction.
 #
 # ex. stand/spawn packet (4 + 10 + 10 = 24 bits = 3 bytes = a3)
-sub makeCoordsDir {
-	my ($r_hash, $rawCoords, $bodyDir) = @_;
-	unShiftPack(\$rawCoords, $bodyDir, 4);
-	makeCoordsXY($r_hash, \$rawCoords);
-}
 
 ##
 # makeCoordsFromTo(r_hashFrom, r_hashTo, rawCoords)
@@ -1255,13 +1260,6 @@ sub makeCoordsDir {
 # ex. walk packet (4 + 4 + 10 + 10 + 10 + 10 = 48 bits = 6 bytes = a6)
 #
 # TODO: Maybe aegis, athena, cronus, brathena or other emulators actually use this sx0/sy0 argument and we don't know
-sub makeCoordsFromTo {
-	my ($r_hashFrom, $r_hashTo, $rawCoords) = @_;
-	unShiftPack(\$rawCoords, undef, 4); # seems to be returning 8 (always?)
-	unShiftPack(\$rawCoords, undef, 4); # seems to be returning 8 (always?)
-	makeCoordsXY($r_hashTo, \$rawCoords);
-	makeCoordsXY($r_hashFrom, \$rawCoords);
-}
 
 ##
 # makeCoordsXY(r_hashFrom, r_hashRawCoords)
@@ -1269,11 +1267,8 @@ sub makeCoordsFromTo {
 # Read makeCoords()
 #
 # Note: this function is used as a help function for: makeCoordsDir, makeCoordsFromTo
-sub makeCoordsXY {
-	my ($r_hash, $r_hashRawCoords) = @_;
-	unShiftPack($r_hashRawCoords, \$r_hash->{y}, 10);
-	unShiftPack($r_hashRawCoords, \$r_hash->{x}, 10);
-}
+
+# makeCoordsDir(), makeCoordsFromTo() and makeCoordsXY() are implemented in src/auto/XSTools/misc/fastutils.xs
 
 ##
 # shiftPack(data, value, bits)
@@ -1282,31 +1277,8 @@ sub makeCoordsXY {
 # bits: maximum number of bits used by value
 #
 # Packs a value onto a set of data using bitwise shifts
-sub shiftPack {
-	my ($data, $value, $bits) = @_;
- 	my ($newdata, $dw1, $dw2, $i, $mask, $done);
-
-	$mask = 2 ** (32 - $bits) - 1;
-	$i = length($$data);
-
-	$newdata = "";
-	$done = 0;
-
-	$dw1 = $value & (2 ** $bits - 1);
- 	do {
-		$i -= 4;
-		$dw2 = ($i > 0) ?
-			unpack('N', substr($$data, $i, 4)) :
-			unpack('N', pack('x' . abs($i)) . substr($$data, 0, 4 + $i));
-
-		$dw1 = $dw1 | (($dw2 & $mask) << $bits);
-		$newdata = pack('N', $dw1) . $newdata;
-		$dw1 = $dw2 >> (32 - $bits);
-	} while ($i + 4 > 0);
-
-	$newdata = substr($newdata, 1) while (substr($newdata, 0, 1) eq pack('C', 0) && length($newdata));
-	$$data = $newdata;
-}
+
+# shiftPack() is implemented in src/auto/XSTools/misc/fastutils.xs
 
 ##
 # urldecode(encoded_string)
@@ -1336,36 +1308,8 @@ sub urlencode {
 # bits: number of bits value requires
 #
 # This is the reverse operation of shiftPack.
-sub unShiftPack {
-	my ($data, $reference, $bits) = @_;
-	my ($newdata, $dw1, $dw2, $i, $mask, $done);
-
-	$mask = 2 ** $bits - 1;
-	$i = length($$data);
-
-	$newdata = "";
-	$done = 0;
 
-	do {
-		$i -= 4;
-		$dw2 = ($i > 0) ?
-			unpack('N', substr($$data, $i, 4)) :
-			unpack('N', pack('x' . abs($i)) . substr($$data, 0, 4 + $i));
-
-		unless ($done) {
-			$$reference = $dw2 & (2 ** $bits - 1) if (defined $reference);
-			$done = 1;
-		} else {
-			$dw1 = $dw1 | (($dw2 & $mask) << (32 - $bits));
-			$newdata = pack('N', $dw1) . $newdata;
-		}
-
-		$dw1 = $dw2 >> $bits;
-	} while ($i + 4 > 0);
-
-	$newdata = substr($newdata, 1) while (substr($newdata, 0, 1) eq pack('C', 0) && length($newdata));
-	$$data = $newdata;
-}
+# unShiftPack() is implemented in src/auto/XSTools/misc/fastutils.xs
 
 ##
 # makeDistMap(data, width, height)
@@ -1483,6 +1427,105 @@ sub unShiftPack {
 # 	return $data;
 # }
 
+##
+# makeFieldMaps(data, width, height)
+# data: the raw field data.
+# width: the field's width.
+# height: the field's height.
+# Returns: the distance map, the weight map and the neighbor mask of the field, or an empty list if data is not a field of this size.
+#
+# Builds the three maps a field needs for pathfinding in one native call, without the intermediate
+# copies of makeDistMap() followed by makeWeightMap() and PathFinding::makeNeighborMask().
+
+##
+# makeWeightProfile(distMap, width, height, profile, [walls])
+# distMap: the distance map of the field, as built by makeDistMap().
+# width: the field's width.
+# height: the field's height.
+# profile: a reference to an array of weights from 0 to 127, the ones of the cells 1, 2, 3... cells away from the nearest wall.
+# walls: a reference to the weight map this one is an alternative to, its walls are kept.
+# Returns: the weight map, or undef if distMap or walls is not a map of this size.
+#
+# Same as makeWeightMap(), with other weights than the default ones (60, 50, 20, 10, 0). The cells
+# farther from the walls than the profile has weights get the last one. See also Field->weightProfileMap().
+
+##
+# repairDistMap(Scalar* distMap, Scalar* rawMap, width, height, cells)
+# distMap: a reference to the distance map of the field as it was, as built by makeDistMap(). It is changed in place.
+# rawMap: a reference to the raw field data, with the new cells.
+# cells: the x and y of the cells which changed, packed with pack("v*").
+#
+# Brings the distance map up to date with the raw map, visiting only the cells whose distance to the nearest wall changes.
+
+##
+# repairWeightProfile(Scalar* weightMap, Scalar* rawMap, width, height, cells, [profile], [walls])
+# weightMap: a reference to the weight map of the field as it was, as built by makeWeightMap(), or by makeWeightProfile() with
+#            profile and walls. It is changed in place.
+# rawMap: a reference to the raw field data, with the new cells.
+# cells: the x and y of the cells which changed, packed with pack("v*").
+#
+# Brings the weight map up to date with the raw map. Only the cells closer to a changed one than the profile has
+# weights can get another weight, their distances to the walls are made again from the raw map around the
+# changed cells. Repair the weight map the others take their walls from first. See also Field->changeCells().
+
+##
+# inflateField(filename)
+# filename: a .fld2 or .fld2.gz field file.
+# Returns: the raw field data, the field's width and height, or an empty list if the file cannot be read.
+#
+# Reads a field file into a buffer of its final size, the file is decompressed if needed.
+
+##
+# prefetchField(filename, buildMaps)
+# filename: a .fld2 or .fld2.gz field file.
+# buildMaps: whether to also build the maps of the field, as makeFieldMaps() and PathFinding::makeComponents() do.
+# Returns: whether the file was queued, false if it is already queued or has been read already.
+#
+# Reads a field file in a native background thread. Use Field->prefetch() instead.
+
+##
+# takePrefetchedField(filename)
+# filename: a field file given to prefetchField().
+# Returns: what inflateField() returns, followed by what makeFieldMaps() returns and the connected areas if the maps were built,
+#          or an empty list if the file was not read in the background or has changed since.
+#
+# Takes the result of prefetchField(), waiting for it if the file is being read. A file
+# which is still queued is dropped, reading it in the calling thread is as fast.
+
+##
+# simdLevel()
+# Returns: the instruction set the native field and pathfinding kernels use: "scalar", "sse2", "avx2" or "avx512".
+#
+# XSTools picks the kernels for the CPU it runs on when it is loaded. Setting the OPENKORE_SIMD
+# environment variable to one of these names before starting makes it use that level at most,
+# "scalar" to debug without SIMD.
+
+##
+# nativeThreads()
+# Returns: the number of threads in the native thread pool, 0 if it is not running.
+#
+# XSTools runs its background work, such as background pathfinding searches (see PathFinding::startWorkers()),
+# field prefetching (see prefetchField()) and Utils::Whirlpool::hashFiles(), on one shared pool of native
+# threads. It is started with one thread per CPU by the first of them which needs it.
+
+##
+# setNativeThreads(count)
+# count: the number of threads, 0 for one per CPU.
+# Returns: the number of threads running.
+#
+# Restarts the native thread pool with another number of threads, after finishing the work already queued.
+# The pool keeps this number if it is stopped and started again.
+
+##
+# fieldImage(data, width, height)
+# data: the raw field data.
+# width: the field's width.
+# height: the field's height.
+# Returns: the map image as RGB data, 3 bytes per block starting with the top row, or undef if data is not a field of this size.
+#
+# Renders the same colors as xpmmake() right into the returned scalar. Use $Field->imageRGB() instead,
+# which keeps the image with the field.
+
 sub makeIP {
 	my $raw = shift;
 	my $ret;
@@ -43,6 +43,19 @@
 # print Benchmark::results() if DEBUG;
 # </pre>
 #
+# Measurements nest: a domain which begins while another one is being measured
+# is counted as its child, so results() shows each domain's totals and folded()
+# shows where in the tree the time went. Each thread is measured separately.
+#
+# Looking up a domain name costs a little on every call; code which is measured
+# very often can intern its domains once and pass the IDs instead:
+# <pre class="example">
+# my $parseDomain = Benchmark::domain("parse");
+# Benchmark::begin($parseDomain) if DEBUG;
+# parse();
+# Benchmark::end($parseDomain) if DEBUG;
+# </pre>
+#
 # You should always put "if DEBUG" after every Benchmark method call. That allows
 # you to disable benchmarking if the NDEBUG environment variable is set, which
 # will eliminate benchmarking overhead. Since DEBUG is a constant, Perl will compile
@@ -63,9 +76,12 @@ eval {
 };
 if ($@) {
 	error T("Benchmarking was not compiled on this system\n");
+	*domain = sub { $_[0] };
 	*begin = sub {};
 	*end = sub {};
+	*reset = sub {};
 	*results = sub { T("Benchmarking was not compiled on this system\n") };
+	*folded = sub { '' };
 	return 1;
 }
 
@@ -74,18 +90,41 @@ init();
 # Note that some functions are implemented in src/auto/XSTools/utils/perl/Benchmark.xs
 
 ##
-# void Benchmark::begin(String domain)
-# domain: A unique name for the piece of code you're benchmarking.
+# int Benchmark::domain(String name)
+# name: A unique name for the piece of code you're benchmarking.
+# Requires: defined($name)
+#
+# Returns the ID of a domain, which begin() and end() take instead of its name.
+# The same name always gets the same ID, in every thread.
+
+##
+# void Benchmark::begin(domain)
+# domain: A unique name for the piece of code you're benchmarking, or its ID from Benchmark::domain().
 # Requires: defined($domain)
 #
 # Begin measuring the time that a piece of code will take.
 
 ##
-# void Benchmark::end(String domain)
-# domain: A unique name for the piece of code you're benchmarking.
+# void Benchmark::end(domain)
+# domain: A unique name for the piece of code you're benchmarking, or its ID from Benchmark::domain().
 # Requires: defined($domain)
 #
-# End measuring the time that a piece of code took.
+# End measuring the time that a piece of code took. Domains which began
+# after this one and didn't end yet are ended too.
+
+##
+# void Benchmark::reset()
+#
+# Forget the measurements of the calling thread.
+
+##
+# String Benchmark::folded([boolean cpu])
+# cpu: Whether to report CPU time instead of real time.
+# Ensures: defined(result)
+#
+# Returns the measurements as folded stacks, which flamegraph.pl turns into a
+# flame graph: one "outer;inner microseconds" line per place in the tree,
+# counting the time which wasn't spent in the domains measured inside it.
 
 sub percent {
 	my ($part, $total) = @_;
@@ -108,10 +147,10 @@ sub results {
 	my $results = getResults();
 
 	my ($result, $totalCPU, $totalReal);
-	$result  = sprintf "%-30s  %-23s  %-23s\n", "Domain", "CPU", "Real";
-	$result .= "------------------------------------------------------------------------\n";
+	$result  = sprintf "%-30s  %-23s  %-23s  %s\n", "Domain", "CPU", "Real", "Calls";
+	$result .= "-------------------------------------------------------------------------------\n";
 
-	$totalCPU = clock2msec($results->{$relativeTo}{clock});
+	$totalCPU = $results->{$relativeTo}{cpuTime};
 	$totalReal = $results->{$relativeTo}{realTime};
 
 	my $sortFunc = sub($$) {
@@ -127,10 +166,11 @@ sub results {
 
 	foreach my $domain (sort $sortFunc keys(%{$results})) {
 		my $item = $results->{$domain};
-		$result .= sprintf "%-30s  %-23s  %-23s\n",
+		$result .= sprintf "%-30s  %-23s  %-23s  %d\n",
 			$domain,
-			sprintf("%.3f (%s)", clock2msec($item->{clock}), percent(clock2msec($item->{clock}), $totalCPU)),
-			sprintf("%.3f (%s)", $item->{realTime},          percent($item->{realTime}, $totalReal));
+			sprintf("%.3f (%s)", $item->{cpuTime},  percent($item->{cpuTime}, $totalCPU)),
+			sprintf("%.3f (%s)", $item->{realTime}, percent($item->{realTime}, $totalReal)),
+			$item->{calls};
 	}
 	return $result;
 }
@@ -90,6 +90,9 @@ sub binAdd {
 # our @array = ("hello", "world", "!");
 # binFind(\@array, "world");   # => 1
 # binFind(\@array, "?");       # => undef
+#
+# This looks at every element of $array. The slot of an ID in one of the actor ID arrays
+# (@monstersID, @playersID, etc.) is found in constant time with Misc::actorIDIndex().
 
 # This function is written in src/auto/XSTools/misc/fastutils.xs
 
@@ -0,0 +1,116 @@
+#########################################################################
+#  OpenKore - Asynchronous client for the AI engine
+#
+#  This software is open source, licensed under the GNU General Public
+#  License, version 2.
+#  Basically, this means that you're allowed to modify and distribute
+#  this software. However, if you distribute modified versions, you MUST
+#  also distribute the source code.
+#  See http://www.gnu.org/licenses/gpl.html for the full license.
+#########################################################################
+##
+# MODULE DESCRIPTION: Asynchronous client for the AI engine
+#
+# Posts JSON requests to the AI engine (or the AI service) over one HTTP
+# connection which is kept open, without ever blocking. A request is sent
+# as far as the socket takes it when it's posted, and the rest of it, and
+# the response, are sent and received by poll(), which should be called
+# every AI iteration until it returns DONE or ERROR.
+#
+# The request body is encoded from Perl data natively, like encode_json()
+# would encode it, so building the request costs no JSON module call.
+#
+# <h3>Example:</h3>
+# <pre class="example">
+# my $client = new Utils::EngineClient("127.0.0.1", 9902);
+# $client->post("/api/v1/decide", { game_state => $state });
+# ...
+# # Later, like in the next AI iteration:
+# my $status = $client->poll();
+# if ($status == Utils::EngineClient::DONE) {
+#     my $decision = decode_json($client->getResponseBody());
+#     $client->reset();
+# } elsif ($status == Utils::EngineClient::ERROR) {
+#     warning $client->getError() . "\n";
+#     $client->reset();
+# }
+# </pre>
+package Utils::EngineClient;
+
+use strict;
+use XSTools;
+
+use constant IDLE => 0;
+use constant PENDING => 1;
+use constant DONE => 2;
+use constant ERROR => 3;
+
+XSTools::bootModule('Utils::EngineClient');
+
+# Note that the functions are implemented in src/auto/XSTools/utils/perl/EngineClient.xs
+
+##
+# Utils::EngineClient Utils::EngineClient->new(String host, int port, [int timeout = 10000])
+# host: The host name or address of the server.
+# port: The port of the server.
+# timeout: How long a request may take, in milliseconds.
+#
+# Create a new client. It connects when the first request is posted.
+
+##
+# boolean $Utils_EngineClient->post(String path, data)
+# path: The request path, like "/api/v1/decide".
+# data: A reference to the data to post as JSON, or a string to post as is.
+# Returns: Whether the request was started; false if another request is still pending.
+#
+# Start posting a request. If the last response wasn't reset() yet, it's lost.
+
+##
+# int $Utils_EngineClient->poll()
+# Returns: IDLE, PENDING, DONE or ERROR.
+#
+# Send and receive whatever can be without blocking.
+
+##
+# int $Utils_EngineClient->getStatus()
+#
+# Returns the status, like poll() does, without sending or receiving anything.
+
+##
+# int $Utils_EngineClient->getResponseCode()
+# Requires: $Utils_EngineClient->getStatus() == DONE
+#
+# Returns the HTTP status code of the response.
+
+##
+# Bytes $Utils_EngineClient->getResponseBody()
+# Requires: $Utils_EngineClient->getStatus() == DONE
+#
+# Returns the body of the response, as the server sent it.
+
+##
+# String $Utils_EngineClient->getError()
+# Requires: $Utils_EngineClient->getStatus() == ERROR
+#
+# Returns why the request failed.
+
+##
+# void $Utils_EngineClient->reset()
+# Requires: $Utils_EngineClient->getStatus() != PENDING
+#
+# Forget the last response or error; the status becomes IDLE.
+
+##
+# boolean $Utils_EngineClient->isConnected()
+#
+# Whether the connection to the server is open.
+
+##
+# Bytes Utils::EngineClient::encodeJSON(data)
+# Ensures: defined(result)
+#
+# Returns data encoded as JSON, in UTF-8, like post() encodes it. This
+# gives the same result as encode_json(), except for the order of hash
+# keys, and that references which loop back become null instead of an error.
+
+1;
@@ -0,0 +1,178 @@
+#########################################################################
+#  OpenKore - Consistent hash ring
+#
+#  This software is open source, licensed under the GNU General Public
+#  License, version 2.
+#  Basically, this means that you're allowed to modify and distribute
+#  this software. However, if you distribute modified versions, you MUST
+#  also distribute the source code.
+#  See http://www.gnu.org/licenses/gpl.html for the full license.
+#########################################################################
+##
+# MODULE DESCRIPTION: Consistent hash ring
+#
+# Spreads keys over a set of nodes, like bots over several AI engines, so
+# that a key always goes to the same node while it's up. Every node is put
+# on a ring of hashes at a number of points (its replicas), and a key goes
+# to the node of the first point at or after its own hash. Adding or
+# removing a node only moves the keys of its ring arcs, about 1/N of them,
+# so the state the nodes keep for their keys stays where it is for the
+# others.
+#
+# Nodes can be marked down for a while: their keys go to the next node of
+# the ring in the meantime, the same one for all of them, and come back
+# once the node is up again.
+# <pre class="example">
+# my $ring = new Utils::HashRing(['10.0.0.1:9901', '10.0.0.2:9901']);
+# my $node = $ring->node($char->{name});
+# ...
+# $ring->markDown($node, 30) if ($failed);
+# </pre>
+package Utils::HashRing;
+
+use strict;
+use Digest::MD5 qw(md5);
+use Time::HiRes qw(time);
+
+use constant DEFAULT_REPLICAS => 64;
+
+##
+# Utils::HashRing Utils::HashRing->new([Array<String> nodes], [int replicas = 64])
+# nodes: The nodes to put on the ring.
+# replicas: The points each node has on the ring; more spread the keys more evenly.
+#
+# Create a ring of nodes, which are all up.
+sub new {
+	my ($class, $nodes, $replicas) = @_;
+	my $self = bless {
+		replicas => $replicas || DEFAULT_REPLICAS,
+		nodes => [],
+		# Points of the ring, sorted by hash, and the node of each
+		hashes => [],
+		owners => [],
+		# Maps the nodes marked down to the time they're up again
+		down => {}
+	}, $class;
+	$self->add($_) foreach (@{$nodes || []});
+	return $self;
+}
+
+sub _hash {
+	return unpack('N', md5($_[0]));
+}
+
+sub _build {
+	my ($self) = @_;
+	my @points;
+	foreach my $node (@{$self->{nodes}}) {
+		push @points, [_hash("$node#$_"), $node] for (1 .. $self->{replicas});
+	}
+	@points = sort { $a->[0] <=> $b->[0] || $a->[1] cmp $b->[1] } @points;
+	$self->{hashes} = [map { $_->[0] } @points];
+	$self->{owners} = [map { $_->[1] } @points];
+}
+
+##
+# void $Utils_HashRing->add(String node)
+#
+# Put a node on the ring, if it isn't on it yet.
+sub add {
+	my ($self, $node) = @_;
+	return if (grep { $_ eq $node } @{$self->{nodes}});
+	push @{$self->{nodes}}, $node;
+	$self->_build();
+}
+
+##
+# void $Utils_HashRing->remove(String node)
+#
+# Take a node off the ring.
+sub remove {
+	my ($self, $node) = @_;
+	$self->{nodes} = [grep { $_ ne $node } @{$self->{nodes}}];
+	delete $self->{down}{$node};
+	$self->_build();
+}
+
+##
+# Array<String> $Utils_HashRing->nodes([String key])
+#
+# Returns the nodes of the ring. Given a key, they're in the order the key
+# goes to them: its node first, then the ones it fails over to.
+sub nodes {
+	my ($self, $key) = @_;
+	return @{$self->{nodes}} if (!defined $key);
+
+	my $hashes = $self->{hashes};
+	my $owners = $self->{owners};
+	my $count = @{$hashes};
+	return () if ($count == 0);
+
+	# The first point at or after the key's hash, wrapping around
+	my $hash = _hash($key);
+	my ($low, $high) = (0, $count);
+	while ($low < $high) {
+		my $middle = ($low + $high) >> 1;
+		if ($hashes->[$middle] < $hash) {
+			$low = $middle + 1;
+		} else {
+			$high = $middle;
+		}
+	}
+
+	my (@order, %seen);
+	for (my $i = 0; $i < $count && @order < @{$self->{nodes}}; $i++) {
+		my $node = $owners->[($low + $i) % $count];
+		push @order, $node if (!$seen{$node}++);
+	}
+	return @order;
+}
+
+##
+# String $Utils_HashRing->node(String key)
+#
+# Returns the node a key goes to: the first one of nodes($key) which is up,
+# or its very first one if they're all down. undef for an empty ring.
+sub node {
+	my ($self, $key) = @_;
+	my @order = $self->nodes($key);
+	foreach my $node (@order) {
+		return $node if ($self->isUp($node));
+	}
+	return $order[0];
+}
+
+##
+# void $Utils_HashRing->markDown(String node, double seconds)
+#
+# Make the keys of a node go to the next ones for some seconds.
+sub markDown {
+	my ($self, $node, $seconds) = @_;
+	$self->{down}{$node} = time + $seconds;
+}
+
+##
+# void $Utils_HashRing->markUp(String node)
+#
+# Make the keys of a node go to it again.
+sub markUp {
+	my ($self, $node) = @_;
+	delete $self->{down}{$node};
+}
+
+##
+# boolean $Utils_HashRing->isUp(String node)
+#
+# Whether a node isn't marked down, or was but its time ran out.
+sub isUp {
+	my ($self, $node) = @_;
+	my $until = $self->{down}{$node};
+	return 1 if (!defined $until);
+	if ($until <= time) {
+		delete $self->{down}{$node};
+		return 1;
+	}
+	return 0;
+}
+
+1;
@@ -0,0 +1,407 @@
+#########################################################################
+#  OpenKore - Hierarchical pathfinding
+#
+#  This software is open source, licensed under the GNU General Public
+#  License, version 2.
+#  Basically, this means that you're allowed to modify and distribute
+#  this software. However, if you distribute modified versions, you MUST
+#  also distribute the source code.
+#  See http://www.gnu.org/licenses/gpl.html for the full license.
+#########################################################################
+##
+# MODULE DESCRIPTION: Hierarchical pathfinding (HPA*).
+#
+# A full resolution A* search over a whole big map can take longer than its
+# time limit. This module splits a map in square clusters and precomputes an
+# abstract graph of the cluster entrances: one or two cells on each open stretch
+# of a cluster border, connected to the entrances of the neighbor cluster and
+# to the other entrances of the same cluster they can reach without leaving it.
+#
+# A long route is first planned on the abstract graph, then only the segments
+# between consecutive entrances are refined with PathFinding, each of them
+# limited to the area of a single cluster. The result is close to, but not
+# always exactly, the shortest path.
+#
+# The abstract graph only depends on the walkable cells of the weight map,
+# $Field->abstractGraph() builds it once and stores it next to the .weight file.
+#
+# <h3>Example</h3>
+# <pre class="example">
+# my $graph = $field->abstractGraph;
+# my @solution = $graph->findPath(start => $start, dest => $dest, avoidWalls => 1);
+# </pre>
+package HierarchicalPathFinding;
+
+use strict;
+use warnings;
+use Carp;
+
+use Modules 'register';
+use Utils::PathFinding;
+
+use constant {
+	# Default width and height of a cluster, in cells
+	CLUSTER_SIZE => 32,
+	# Open border stretches at least this long get an entrance at each end instead of one in their middle
+	MAX_SINGLE_ENTRANCE => 6,
+	FILE_VERSION => 1,
+};
+
+##
+# HierarchicalPathFinding->build(weight_map => Scalar*, width => int, height => int, [cluster_size => int])
+# Returns: a new HierarchicalPathFinding object.
+#
+# Builds the abstract graph of a weight map.
+sub build {
+	my ($class, %args) = @_;
+	croak "Required arguments missing, specify 'weight_map', 'width' and 'height'\n"
+		unless ($args{weight_map} && $args{width} && $args{height});
+
+	my $self = $class->_new($args{weight_map}, $args{width}, $args{height}, $args{cluster_size} || CLUSTER_SIZE);
+	my $size = $self->{clusterSize};
+
+	# Entrances between each cluster and its east and north neighbors
+	for (my $clusterY = 0; $clusterY < $self->{height}; $clusterY += $size) {
+		for (my $clusterX = 0; $clusterX < $self->{width}; $clusterX += $size) {
+			my $lastX = $self->_min($clusterX + $size, $self->{width}) - 1;
+			my $lastY = $self->_min($clusterY + $size, $self->{height}) - 1;
+			$self->_addEntrances([map { [$lastX, $_] } $clusterY .. $lastY], 1, 0) if ($lastX + 1 < $self->{width});
+			$self->_addEntrances([map { [$_, $lastY] } $clusterX .. $lastX], 0, 1) if ($lastY + 1 < $self->{height});
+		}
+	}
+
+	# Connect the entrances of each cluster which can reach each other without leaving it
+	foreach my $nodes (values %{$self->{clusterNodes}}) {
+		for my $i (0 .. $#{$nodes}) {
+			for my $j ($i + 1 .. $#{$nodes}) {
+				my $steps = $self->_localSteps($self->_nodePos($nodes->[$i]), $self->_nodePos($nodes->[$j]));
+				$self->_addEdge($nodes->[$i], $nodes->[$j], $steps) if ($steps >= 0);
+			}
+		}
+	}
+
+	return $self;
+}
+
+##
+# HierarchicalPathFinding->load(String filename, weight_map => Scalar*, width => int, height => int)
+# Returns: a HierarchicalPathFinding object, or undef if the file doesn't exist or was built for another weight map.
+sub load {
+	my ($class, $filename, %args) = @_;
+	my ($f, $data);
+
+	return undef unless (open($f, "<", $filename));
+	binmode $f;
+	{
+		local($/);
+		$data = <$f>;
+	}
+	close $f;
+
+	return $class->loadData($data, %args);
+}
+
+##
+# HierarchicalPathFinding->loadData(String data, weight_map => Scalar*, width => int, height => int)
+# Returns: a HierarchicalPathFinding object, or undef if the data is not valid or was built for another weight map.
+#
+# Like load(), from the contents of a file written by save() (see also serialize()).
+sub loadData {
+	my ($class, $data, %args) = @_;
+
+	return undef if (length($data) < 18);
+	my ($magic, $version, $width, $height, $size, $checksum) = unpack("a2 v v v v V", substr($data, 0, 14, ''));
+	return undef if ($magic ne 'V#' || $version != FILE_VERSION);
+	return undef if ($width != $args{width} || $height != $args{height} || $checksum != _checksum($args{weight_map}));
+
+	my $self = $class->_new($args{weight_map}, $width, $height, $size);
+	my $nodeCount = unpack("V", substr($data, 0, 4, ''));
+	return undef if (length($data) < $nodeCount * 4 + 4);
+	my @coords = unpack("v" . ($nodeCount * 2), substr($data, 0, $nodeCount * 4, ''));
+	$self->_addNode($coords[$_ * 2], $coords[$_ * 2 + 1]) for (0 .. $nodeCount - 1);
+
+	my $edgeCount = unpack("V", substr($data, 0, 4, ''));
+	return undef if (length($data) != $edgeCount * 12);
+	my @edges = unpack("V" . ($edgeCount * 3), $data);
+	$self->_addEdge($edges[$_ * 3], $edges[$_ * 3 + 1], $edges[$_ * 3 + 2]) for (0 .. $edgeCount - 1);
+
+	return $self;
+}
+
+##
+# boolean $HierarchicalPathFinding->save(String filename)
+# Returns: whether the file could be written.
+sub save {
+	my ($self, $filename) = @_;
+	my $f;
+
+	return 0 unless (open($f, ">", $filename));
+	binmode $f;
+	print $f $self->serialize;
+	close $f;
+	return 1;
+}
+
+##
+# String $HierarchicalPathFinding->serialize()
+# Returns: the contents of the file written by save().
+sub serialize {
+	my ($self) = @_;
+	my $data = pack("a2 v", 'V#', FILE_VERSION);
+	$data .= pack("v v v V", $self->{width}, $self->{height}, $self->{clusterSize}, _checksum($self->{weightMap}));
+	$data .= pack("V", scalar @{$self->{nodeX}});
+	$data .= pack("v*", map { ($self->{nodeX}[$_], $self->{nodeY}[$_]) } 0 .. $#{$self->{nodeX}});
+
+	my @edges;
+	for my $node (0 .. $#{$self->{edges}}) {
+		push @edges, map { [$node, @{$_}] } grep { $_->[0] > $node } @{$self->{edges}[$node]};
+	}
+	$data .= pack("V", scalar @edges);
+	$data .= pack("V*", map { @{$_} } @edges);
+	return $data;
+}
+
+##
+# Array $HierarchicalPathFinding->findPath(start => Hash*, dest => Hash*, [PathFinding options...])
+# Returns: the solution, an array of hashes of x and y coordinates from start to dest, including both of them, or an empty array if there is no path.
+#
+# Plans the route on the abstract graph and refines it with PathFinding. The optional
+# arguments (avoidWalls, randomFactor...) are passed to each refining search.
+sub findPath {
+	my ($self, %args) = @_;
+	my $start = $args{start};
+	my $dest = $args{dest};
+	croak "Required arguments 'start' and 'dest' missing\n" unless ($start && $dest);
+
+	return ({ x => $start->{x}, y => $start->{y} }) if ($start->{x} == $dest->{x} && $start->{y} == $dest->{y});
+	my $path = $self->_abstractPath($start, $dest);
+	return () unless ($path);
+
+	my @solution = ({ x => $start->{x}, y => $start->{y} });
+	for my $i (1 .. $#{$path}) {
+		my ($from, $to) = ($path->[$i - 1], $path->[$i]);
+		if ($self->_clusterOf($from->{x}, $from->{y}) ne $self->_clusterOf($to->{x}, $to->{y})) {
+			# Neighbor entrances on both sides of a cluster border
+			push @solution, { x => $to->{x}, y => $to->{y} };
+			next;
+		}
+
+		my @segment;
+		$self->_localSearch($from, $to, \@segment, %args);
+		return () unless (@segment);
+		shift @segment;
+		push @solution, @segment;
+	}
+	return @solution;
+}
+
+sub _new {
+	my ($class, $weightMap, $width, $height, $size) = @_;
+	return bless {
+		weightMap => $weightMap,
+		width => $width,
+		height => $height,
+		clusterSize => $size,
+		nodeX => [],
+		nodeY => [],
+		nodeIndex => {},
+		edges => [],
+		clusterNodes => {},
+		pathfinding => new PathFinding,
+	}, $class;
+}
+
+sub _min {
+	my (undef, $a, $b) = @_;
+	return $a < $b ? $a : $b;
+}
+
+sub _checksum {
+	my ($weightMap) = @_;
+	return unpack("%32C*", $$weightMap);
+}
+
+sub _isWalkable {
+	my ($self, $x, $y) = @_;
+	return ord(substr(${$self->{weightMap}}, $y * $self->{width} + $x, 1)) != 255;
+}
+
+sub _clusterOf {
+	my ($self, $x, $y) = @_;
+	return int($x / $self->{clusterSize}) . ',' . int($y / $self->{clusterSize});
+}
+
+sub _clusterBox {
+	my ($self, $x, $y) = @_;
+	my $size = $self->{clusterSize};
+	my $minX = int($x / $size) * $size;
+	my $minY = int($y / $size) * $size;
+	return ($minX, $self->_min($minX + $size, $self->{width}) - 1, $minY, $self->_min($minY + $size, $self->{height}) - 1);
+}
+
+sub _nodePos {
+	my ($self, $node) = @_;
+	return { x => $self->{nodeX}[$node], y => $self->{nodeY}[$node] };
+}
+
+sub _addNode {
+	my ($self, $x, $y) = @_;
+	my $key = "$x,$y";
+	return $self->{nodeIndex}{$key} if (defined $self->{nodeIndex}{$key});
+
+	my $node = scalar @{$self->{nodeX}};
+	push @{$self->{nodeX}}, $x;
+	push @{$self->{nodeY}}, $y;
+	push @{$self->{edges}}, [];
+	push @{$self->{clusterNodes}{$self->_clusterOf($x, $y)}}, $node;
+	$self->{nodeIndex}{$key} = $node;
+	return $node;
+}
+
+sub _addEdge {
+	my ($self, $a, $b, $steps) = @_;
+	push @{$self->{edges}[$a]}, [$b, $steps];
+	push @{$self->{edges}[$b]}, [$a, $steps];
+}
+
+# Adds the entrances of a cluster border, $cells are the border cells on this cluster's side and ($dx, $dy) points to the neighbor cluster
+sub _addEntrances {
+	my ($self, $cells, $dx, $dy) = @_;
+	my @run;
+	foreach my $cell (@{$cells}, undef) {
+		if ($cell && $self->_isWalkable($cell->[0], $cell->[1]) && $self->_isWalkable($cell->[0] + $dx, $cell->[1] + $dy)) {
+			push @run, $cell;
+			next;
+		}
+		next unless (@run);
+
+		my @entrances = (@run >= MAX_SINGLE_ENTRANCE) ? ($run[0], $run[-1]) : ($run[int(@run / 2)]);
+		foreach my $entrance (@entrances) {
+			my $inside = $self->_addNode($entrance->[0], $entrance->[1]);
+			my $outside = $self->_addNode($entrance->[0] + $dx, $entrance->[1] + $dy);
+			$self->_addEdge($inside, $outside, 1);
+		}
+		@run = ();
+	}
+}
+
+# Runs a PathFinding search limited to the cluster of $from, which must also hold $to
+sub _localSearch {
+	my ($self, $from, $to, $solution, %args) = @_;
+	my ($minX, $maxX, $minY, $maxY) = $self->_clusterBox($from->{x}, $from->{y});
+	delete @args{qw(start dest weight_map width height min_x max_x min_y max_y field)};
+	$self->{pathfinding}->reset(
+		%args,
+		weight_map => $self->{weightMap},
+		width => $self->{width},
+		height => $self->{height},
+		start => $from,
+		dest => $to,
+		min_x => $minX,
+		max_x => $maxX,
+		min_y => $minY,
+		max_y => $maxY,
+	);
+	return $solution ? $self->{pathfinding}->run($solution) : $self->{pathfinding}->runcount;
+}
+
+# Number of steps between two cells of the same cluster, using the cheapest search settings, or -1 if there is no path inside the cluster
+sub _localSteps {
+	my ($self, $from, $to) = @_;
+	return $self->_localSearch($from, $to, undef, avoidWalls => 0, algorithm => 'jps', timeout => 60000);
+}
+
+# A* over the abstract graph, with the start and dest cells temporarily connected to the entrances of their clusters
+# Returns: a reference to the list of cells to go through, including start and dest, or undef if there is no path
+sub _abstractPath {
+	my ($self, $start, $dest) = @_;
+	my $startNode = 'start';
+	my $destNode = 'dest';
+	my %extraEdges;
+
+	foreach my $end ([$startNode, $start], [$destNode, $dest]) {
+		my ($name, $pos) = @{$end};
+		foreach my $node (@{$self->{clusterNodes}{$self->_clusterOf($pos->{x}, $pos->{y})} || []}) {
+			my $steps = $self->_localSteps($pos, $self->_nodePos($node));
+			next if ($steps < 0);
+			push @{$extraEdges{$name}}, [$node, $steps];
+			push @{$extraEdges{$node}}, [$name, $steps];
+		}
+	}
+	if ($self->_clusterOf($start->{x}, $start->{y}) eq $self->_clusterOf($dest->{x}, $dest->{y})) {
+		my $steps = $self->_localSteps($start, $dest);
+		push @{$extraEdges{$startNode}}, [$destNode, $steps] if ($steps >= 0);
+	}
+
+	my %pos = ($startNode => $start, $destNode => $dest);
+	my $position = sub { $pos{$_[0]} || $self->_nodePos($_[0]) };
+	my $heuristic = sub {
+		my $p = $position->($_[0]);
+		my ($dx, $dy) = (abs($p->{x} - $dest->{x}), abs($p->{y} - $dest->{y}));
+		return $dx > $dy ? $dx : $dy;
+	};
+
+	my %g = ($startNode => 0);
+	my %predecessor;
+	my %closed;
+	my @heap = ([$heuristic->($startNode), $startNode]);
+	while (@heap) {
+		my $current = _heapPop(\@heap)->[1];
+		next if ($closed{$current}++);
+
+		if ($current eq $destNode) {
+			my @path = ($dest);
+			while ($current ne $startNode) {
+				$current = $predecessor{$current};
+				unshift @path, $position->($current);
+			}
+			return \@path;
+		}
+
+		my @neighbors = @{$extraEdges{$current} || []};
+		push @neighbors, @{$self->{edges}[$current]} if ($current ne $startNode && $current ne $destNode);
+		foreach my $edge (@neighbors) {
+			my ($neighbor, $steps) = @{$edge};
+			next if ($closed{$neighbor});
+			my $score = $g{$current} + $steps;
+			next if (defined $g{$neighbor} && $g{$neighbor} <= $score);
+			$g{$neighbor} = $score;
+			$predecessor{$neighbor} = $current;
+			_heapPush(\@heap, [$score + $heuristic->($neighbor), $neighbor]);
+		}
+	}
+	return undef;
+}
+
+# Minimal binary heap of [score, item] pairs, outdated entries are skipped by the caller
+sub _heapPush {
+	my ($heap, $entry) = @_;
+	my $index = push(@{$heap}, $entry) - 1;
+	while ($index > 0) {
+		my $parent = ($index - 1) >> 1;
+		last if ($heap->[$parent][0] <= $heap->[$index][0]);
+		@{$heap}[$parent, $index] = @{$heap}[$index, $parent];
+		$index = $parent;
+	}
+}
+
+sub _heapPop {
+	my ($heap) = @_;
+	my $top = $heap->[0];
+	my $last = pop @{$heap};
+	return $top unless (@{$heap});
+
+	$heap->[0] = $last;
+	my $index = 0;
+	while (1) {
+		my $child = $index * 2 + 1;
+		last if ($child > $#{$heap});
+		$child++ if ($child + 1 <= $#{$heap} && $heap->[$child + 1][0] < $heap->[$child][0]);
+		last if ($heap->[$index][0] <= $heap->[$child][0]);
+		@{$heap}[$child, $index] = @{$heap}[$index, $child];
+		$index = $child;
+	}
+	return $top;
+}
+
+1;
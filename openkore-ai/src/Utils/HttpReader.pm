@@ -28,6 +28,15 @@ use base qw(HttpReader);
 
 package MirrorHttpReader;
 
+# new MirrorHttpReader(\@urls, [timeout], [raceWidth])
+# Races up to raceWidth mirrors (default 3) and downloads from the first to answer.
+#
+# MirrorHttpReader::setLatencyFile(file)
+# Remembers how fast each server answered in that file, across runs.
+#
+# MirrorHttpReader::getLatency(url)
+# The remembered latency of the server of url in miliseconds, -1 if unknown.
+
 use base qw(HttpReader);
 
 1;
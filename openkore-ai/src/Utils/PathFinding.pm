@@ -34,6 +34,15 @@ use XSTools;
 use Modules 'register';
 XSTools::bootModule("PathFinding");
 
+# Search algorithm numbers understood by _reset, see algorithm.h
+use constant {
+	ALGORITHM_ASTAR => 0,
+	ALGORITHM_JPS => 1,
+	ALGORITHM_BIDIRECTIONAL => 2,
+	OPEN_LIST_HEAP => 0,
+	OPEN_LIST_BUCKET => 1,
+};
+
 
 
 ##
@@ -81,8 +90,27 @@ sub new {
 # - min_y: limits the map in a certain minimum y coordinate, defaults to 0
 # - max_y: limits the map in a certain maximum y coordinate, defaults to height-1
 # - customWeights: if secondWeightMap should be used during pathing, defaults to 0
-# - secondWeightMap: An array of hashes containing 3 keys, 'x', 'y' and 'weight', for all the cells which had their weight changed, 'weight' is the weight of the cell, defaults to undef
+# - secondWeightMap: An array of hashes containing 3 keys, 'x', 'y' and 'weight', for all the cells which had their weight changed, 'weight' is the weight of the cell, or a PathFinding::DangerMap of the same size as the map kept up to date by the caller, which the search reads in place instead of copying its cells, defaults to undef
+# - weight_profile: the name of a weight profile or a reference to an array of weights (see Field::weightProfile()), the search then uses the field's weight map of the profile (see $Field->weightProfileMap()), defaults to the field's own weight map
+# - neighbor_mask: a reference to the precomputed neighbor mask of weight_map (see $Field->neighborMask()), defaults to the field's one when weight_map is the field's weight map or the one of its weight profile
+# - algorithm: 'astar', 'jps' (Jump Point Search, much faster on open maps but only for uniform cost searches, falls back to A* when avoidWalls, customWeights, danger or randomFactor are set) 'bidirectional' (searches from both ends at once and stops once no cheaper path can be found, for long routes through maze-like maps where the heuristic is weak, falls back to A* when randomFactor or useManhattan are set) or 'auto' (JPS whenever it gives the same path cost as A*), defaults to 'astar'
+# - open_list: 'heap' (binary heap) or 'bucket' (bucket queue indexed by f score, faster on big searches but may pick a different path among the ones of the same cost), defaults to 'heap', the bidirectional search always uses binary heaps
+## - node_budget: the maximum number of nodes to expand in each call to run(), runcount() or run_packed(), defaults to 0 (no limit)
+# - time_budget: the maximum number of microseconds to search in each call to run(), runcount() or run_packed(), defaults to 0 (no limit)
+# - components: a reference to the connected area labels of weight_map (see $Field->components()), searches between two areas then fail right away, defaults to the field's ones when weight_map is the field's weight map
+# - cache_key: a string naming the weight map, searches with a cache key are kept in the route cache (see PathFinding::setRouteCacheSize()), defaults to the field's name when weight_map is the field's weight map
+# - danger: a PathFinding::DangerMap of the same size as the map (see $Field->dangerMap()), its weight is added to every cell stepped on, defaults to undef
+# - landmarks: a reference to the landmark distance tables of weight_map (see $Field->landmarks()), the A* and JPS searches then use the tighter landmark heuristic, which finds the same path cost but expands much fewer nodes when walls are in the way. Ignored with useManhattan and by the bidirectional search, defaults to undef
+# - window: a margin in cells, the A* search then starts in the box around the start and the destination grown by this margin, and doubles it each time the search runs out of nodes inside it, up to the min_x, max_x, min_y and max_y bounds (see $PathFinding->windowGrowths()). Defaults to 0, searching the whole bounds at once
 # `l`
+#
+# A window keeps the search from spreading over the whole bounds when the path is close to the straight line,
+# while a path which has to go around a big obstacle is still found: when the window grows, the search resumes
+# from the nodes it already expanded. The path found inside a window may cost more than one going out of it.
+#
+# With a node or time budget, a long search is spread over several calls: each call returns -4 once its budget
+# runs out, and the next call resumes the search where it stopped. This allows searching a little on every AI
+# iteration instead of blocking until the path is found.
 sub reset {
 	my $class = shift;
 	my %args = @_;
@@ -105,7 +133,8 @@ sub reset {
 	Plugins::callHook('PathFindingReset', \%hookArgs);
 	if ($hookArgs{return}) {
 		$args{avoidWalls} = 1 unless (defined $args{avoidWalls});
-		$args{weight_map} = \($args{field}->{weightMap}) unless (defined $args{weight_map});
+		$args{weight_map} = UNIVERSAL::isa($args{field}, 'Field') ? $args{field}->weightProfileMap($args{weight_profile}) : \($args{field}->{weightMap})
+			unless (defined $args{weight_map});
 
 		$args{customWeights} = 0 unless (defined $args{customWeights});
 		$args{secondWeightMap} = undef unless (defined $args{secondWeightMap});
@@ -122,6 +151,25 @@ sub reset {
 		$args{max_y} = ($args{height}-1) unless (defined $args{max_y});
 	}
 
+	# The field's neighbor mask is only valid for the field's own weight map and the ones of its weight profiles, which have the same walls
+	if (!defined $args{neighbor_mask} && $args{field} && UNIVERSAL::isa($args{field}, 'Field')
+	 && ref $args{weight_map} && $args{weight_map} == $args{field}->weightProfileMap($args{weight_profile})) {
+		my $profile = Field::weightProfile($args{weight_profile});
+		$args{neighbor_mask} = $args{field}->neighborMask;
+		$args{cache_key} = $args{field}->name . ($profile ? ' ' . join(',', @{$profile}) : '') unless (defined $args{cache_key});
+		$args{components} = $args{field}->components unless (defined $args{components});
+	}
+
+	# Jump Point Search is only used automatically for uniform cost searches with the admissible heuristic,
+	# the client mimicking manhattan searches must keep A*'s order of expansion
+	my $algorithm = $args{algorithm} || 'astar';
+	if ($algorithm eq 'auto') {
+		$algorithm = (!$args{avoidWalls} && !$args{customWeights} && !$args{danger} && !$args{randomFactor} && !$args{useManhattan}) ? 'jps' : 'astar';
+	}
+	croak "Unknown pathfinding algorithm '$algorithm'\n" unless ($algorithm eq 'astar' || $algorithm eq 'jps' || $algorithm eq 'bidirectional');
+	my $open_list = $args{open_list} || 'heap';
+	croak "Unknown pathfinding open list '$open_list'\n" unless ($open_list eq 'heap' || $open_list eq 'bucket');
+
 	return $class->_reset(
 		$args{weight_map}, 
 		$args{avoidWalls}, 
@@ -139,7 +187,17 @@ sub reset {
 		$args{min_x},
 		$args{max_x},
 		$args{min_y},
-		$args{max_y}
+		$args{max_y},
+		$args{neighbor_mask},
+		$algorithm eq 'jps' ? ALGORITHM_JPS : $algorithm eq 'bidirectional' ? ALGORITHM_BIDIRECTIONAL : ALGORITHM_ASTAR,
+		$open_list eq 'bucket' ? OPEN_LIST_BUCKET : OPEN_LIST_HEAP,
+		$args{node_budget},
+		$args{time_budget},
+		$args{cache_key},
+		$args{components},
+		$args{danger},
+		$args{window},
+		$args{landmarks}
 	);
 }
 
@@ -148,17 +206,443 @@ sub reset {
 # $PathFinding->run(solution_array)
 # solution_array: Reference to an array in which the solution is stored. It will contain hashes of x and y coordinates from the start to the end of the path, including the starting pos
 # Returns:
+#    -4 when the node or time budget of this call ran out, call it again to continue the search.
 #    -3 when pathfinding is not yet complete.
 #    -2 when Pathfinding->reset was not called.
 #    -1 on no path found.
 #    The number of steps required to walk from source to destination on success.
 
+##
+# $PathFinding->run_packed(solution)
+# solution: Reference to a scalar in which the solution is stored, as x and y coordinates packed with pack("v*"), from the start to the end of the path.
+# Returns: the same as $PathFinding->run()
+#
+# Same as $PathFinding->run(), but doesn't create a hash for every step of the path.
+# Read the solution with PathFinding::packedLength(), PathFinding::packedCell() or PathFinding::unpackSolution().
+
 ##
 # $PathFinding->runcount()
 # Returns:
+#    -4 when the node or time budget of this call ran out, call it again to continue the search.
 #    -3 when pathfinding is not yet complete.
 #    -2 when Pathfinding->reset was not called.
 #    -1 on no path found.
 #    The number of steps required to walk from source to destination on success.
 
+##
+# $PathFinding->runcounts(destinations, [solutions])
+# destinations: Reference to an array of hashes of x and y coordinates.
+# solutions: Reference to an array in which, for each destination, a reference to its solution array (as returned by run) is stored, or undef if it can't be reached.
+# Returns: a list with, for each destination, the same value runcount would return for it.
+#
+# Calculates the paths from the start position given to reset to many destinations with a single search,
+# instead of resetting and running a search for each of them. The reset 'dest' argument is ignored, but
+# must still be a walkable cell (the start position will do), and the other reset options are honored.
+# Destinations that are not walkable or out of the min/max coordinates get -1.
+# You must call reset before running another search with this object.
+
+##
+# int PathFinding::startWorkers(int count)
+# Returns: the number of worker threads running.
+#
+# Starts the native thread pool with $count threads, which run the searches of PathFinding::runAll() concurrently.
+# Does nothing if the pool is already running, it is shared with the rest of XSTools (see Utils::nativeThreads()).
+# Without workers, PathFinding::runAll() runs the searches one by one.
+
+##
+# void PathFinding::stopWorkers()
+#
+# Finishes the queued searches and stops the worker threads, which are the threads of the native thread pool.
+
+##
+# int PathFinding::workers()
+# Returns: the number of worker threads running.
+
+##
+# Array PathFinding::runAll(PathFinding sessions...)
+# sessions: PathFinding objects on which reset() was called.
+# Returns: a list with, for each session, the same value runcount() would return for it.
+#
+# Runs the searches of several sessions at the same time on the worker threads (see PathFinding::startWorkers())
+# and waits until all of them are done. Call run() or run_packed() on a session afterwards to get its solution,
+# that doesn't search again. The fields of the sessions must stay loaded until this returns.
+sub runAll {
+	my @sessions = @_;
+	$_->_submit foreach (@sessions);
+	return map { $_->runcount } @sessions;
+}
+
+##
+# String PathFinding::makeComponents(Scalar* weight_map, int width, int height)
+# Returns: the connected walkable area of each cell of weight_map, as little endian unsigned shorts packed with pack("v*").
+#
+# Areas are numbered from 1 in the order of their first cell, walls get 0, and the cells of the areas after the
+# 65534th one get 0xFFFF (nothing is known about them). See $Field->components() for a cached version.
+
+##
+# void PathFinding::repairComponents(Scalar* labels, Scalar* weight_map, int width, int height, String cells)
+# labels: a reference to the connected areas made by makeComponents() before the cells changed. They are changed in place.
+# cells: the x and y of the cells whose walkability changed in weight_map, packed with pack("v*").
+#
+# Floods again the areas the changed cells and their neighbors are in, the others keep their numbers. An area cut in
+# parts keeps its number for one of them and the others get new ones, areas joined by a cell get one of theirs, so
+# the labels tell apart the same areas as new ones would, though not always by the same numbers.
+
+##
+# void PathFinding::repairNeighborMask(Scalar* mask, Scalar* weight_map, int width, int height, String cells)
+# mask: a reference to the neighbor mask made by makeNeighborMask() before the cells changed. It is changed in place.
+# cells: the x and y of the cells whose walkability changed in weight_map, packed with pack("v*").
+#
+# Recomputes the mask of the changed cells and of their neighbors, the others can't change.
+
+##
+# boolean $PathFinding->cached()
+# Returns: whether the result of the search the session was reset for is known without searching, because it was found in the route cache
+# or because the start and destination are in different connected areas (see the components argument of reset()).
+
+##
+# int $PathFinding->expanded()
+# Returns: the number of nodes the search the session was reset for took out of its open lists so far, over all
+# its runs, 0 if its result was known without searching. A measure of how much work the search algorithm did.
+
+##
+# int $PathFinding->windowGrowths()
+# Returns: the number of times the adaptive search window (see the window argument of reset()) had to grow so far.
+
+##
+# void PathFinding::setRouteCacheSize(int size)
+# size: the maximum number of searches kept in the route cache, 0 disables it. Defaults to 64.
+#
+# Bots keep walking between the same few spots of a map, so the results of the searches reset with a
+# cache_key are kept: a search repeated with the same cache key, start, destination, avoidWalls,
+# useManhattan, bounds, window, algorithm and open list costs a hash table lookup. The custom weights are part
+# of the key, a search with a changed secondWeightMap is never given the path of an old one. Searches
+# with a randomFactor and searches which ran out of time are not cached. Changing the size empties the cache.
+
+##
+# int PathFinding::routeCacheSize()
+# Returns: the maximum number of searches kept in the route cache.
+
+##
+# int PathFinding::routeCacheCount()
+# Returns: the number of searches in the route cache.
+
+##
+# void PathFinding::clearRouteCache()
+#
+# Empties the route cache, to be called when the weight map of a cache key changes.
+
+##
+# PathFinding PathFinding::submit(args...)
+# PathFinding $PathFinding->submit([args...])
+# args: Arguments to pass to $PathFinding->reset().
+# Returns: the PathFinding object running the search, or undef if the arguments are wrong.
+#
+# Starts a search in the background and returns right away, the AI loop can go on handling packets
+# while a worker thread (see PathFinding::startWorkers()) searches. Called as a function, a new
+# PathFinding object is created for the search. Called as a method without arguments, it searches
+# with the arguments of the last reset().
+#
+# Check whether the search is done with $PathFinding->poll(), and get its result with
+# $PathFinding->collect(). Without worker threads, the search is run before submit() returns.
+sub submit {
+	my $self = (ref($_[0]) && UNIVERSAL::isa($_[0], 'PathFinding')) ? shift : new PathFinding();
+	# A failed reset leaves the session uninitialized, which _submit refuses
+	$self->reset(@_) if (@_);
+	return $self->_submit ? $self : undef;
+}
+
+##
+# boolean $PathFinding->poll()
+# Returns: whether the result of the search started by submit() is ready, a call to collect() will then not block.
+
+##
+# int $PathFinding->collect([Array* solution_array])
+# Returns: the same as $PathFinding->run() if solution_array is given, or as $PathFinding->runcount() if not.
+#
+# Gets the result of the search started by submit(), waiting for it if it is not done yet.
+sub collect {
+	my ($self, $solution) = @_;
+	return $solution ? $self->run($solution) : $self->runcount;
+}
+
+END {
+	stopWorkers();
+}
+
+##
+# int PathFinding::packedLength(String packed)
+# Returns: the number of cells in a packed solution, as returned by run_packed() or calcRectArea_packed().
+sub packedLength {
+	return length($_[0]) >> 2;
+}
+
+##
+# (int, int) PathFinding::packedCell(String packed, int index)
+# Returns: the x and y coordinates of the cell at $index in a packed solution.
+sub packedCell {
+	return unpack("v v", substr($_[0], $_[1] << 2, 4));
+}
+
+##
+# String PathFinding::solutionTimes(String packed)
+# packed: a packed solution, as returned by run_packed().
+# Returns: native unsigned 32 bit integers, when each cell of the solution is reached from the first one, in tenths of the time of an orthogonal step.
+#
+# Diagonal steps take 1.4 times as long as orthogonal ones, like in Utils::calcStepsWalkedFromTimeAndSolution().
+
+##
+# int PathFinding::stepAtTime(String times, float speed, float time)
+# times: the times of a solution, as returned by PathFinding::solutionTimes().
+# speed: the time an orthogonal step takes, in seconds.
+# time: the time since the move started, in seconds.
+# Returns: the index of the cell of the solution reached at $time, or undef if the solution is empty.
+#
+# This is a binary search over the times, so the times of a path can be kept and asked about for as long as the move lasts.
+
+##
+# (int, int) PathFinding::easyPosAtTime(int x, int y, int to_x, int to_y, float speed, float time)
+# Returns: the x and y coordinates reached at $time when walking from ($x, $y) to ($to_x, $to_y) along
+#          the path of Utils::get_client_easy_solution(), like PathFinding::stepAtTime() for that path.
+
+##
+# (String, String) PathFinding::smoothSolution(String packed, int max_segment, int tile, int width, int height, String* rawMap)
+# packed: a packed solution, as returned by run_packed().
+# Returns: the smoothed solution, packed the same way, and the indexes in it of its waypoints, packed with pack("V*").
+#
+# Every waypoint is the furthest cell of the solution, at most $max_segment steps after the previous one (or the
+# first cell), which PathFinding::checkPathFree() can walk to in a straight line. The cells between two waypoints
+# are the ones of that walk, so a move request to the next waypoint is enough for the server to walk the whole
+# segment. The smoothed solution is never longer than the original one, and its last cell is always a waypoint.
+
+##
+# Array PathFinding::unpackSolution(String packed)
+# Returns: the cells of a packed solution as hashes of x and y coordinates, like run() returns them.
+sub unpackSolution {
+	my @coords = unpack("v*", $_[0]);
+	return map { { x => $coords[$_ * 2], y => $coords[$_ * 2 + 1] } } 0 .. (@coords >> 1) - 1;
+}
+
+##
+# PathFinding::RouteCursor PathFinding::RouteCursor->new(Array* solution)
+# solution: the steps of a route, hashes with x and y coordinates, and the closeToEnd and waypoint flags Task::Route sets.
+#
+# The steps of a route being walked, kept natively so Task::Route doesn't go over the hashes of the solution on every iteration.
+# The cursor is a copy: trim it along with the solution, and make a new one if the solution changes otherwise.
+#
+# `l
+# - <tt>$cursor->size()</tt> - the number of steps left.
+# - <tt>$cursor->cell(index)</tt> - the x and y coordinates of a step left, an empty list if there is none at index.
+# - <tt>$cursor->locate(x, y, lookahead)</tt> - the index of the step closest to (x, y) by Utils::adjustedBlockDistance(), which
+#   is the first one on (x, y) if any. The search stops lookahead steps after the closest one so far. Undef if no step is left.
+# - <tt>$cursor->trim(count)</tt> - drops the first count steps, the ones walked already.
+# - <tt>$cursor->nextStep(step_index, closeToEnd)</tt> - the index of the step to walk to and the coordinates to move to:
+#   if closeToEnd is set and the step at step_index is close to the end, the first step of its run of them; and the coordinates of
+#   the first waypoint after the second step up to it if there is one, of the step otherwise.
+# `l`
+
+my $distanceFieldPathfinding;
+
+##
+# String* PathFinding::distanceField(Field field, int x, int y, int radius)
+# Returns: a reference to the distance field, or undef if ($x, $y) is not walkable.
+#
+# Calculates the walking cost from ($x, $y) to every cell at most $radius blocks away from it, with
+# the same weights as a search with avoidWalls disabled: 10 for each ortogonal step and 14 for each
+# diagonal one. Only paths which stay within $radius blocks of ($x, $y) are considered.
+#
+# The distance field is a string of (2 * $radius + 1) ^ 2 packed little endian unsigned shorts,
+# row by row starting at ($x - $radius, $y - $radius). Read it with PathFinding::distanceFieldAt().
+# See $Field->distanceField() for a cached version.
+sub distanceField {
+	my ($field, $x, $y, $radius) = @_;
+	return undef unless ($field->isWalkable($x, $y));
+
+	my $start = { x => $x, y => $y };
+	$distanceFieldPathfinding ||= new PathFinding;
+	$distanceFieldPathfinding->reset(
+		field => $field,
+		start => $start,
+		dest => $start,
+		avoidWalls => 0,
+		min_x => ($x > $radius) ? $x - $radius : 0,
+		max_x => ($x + $radius < $field->width) ? $x + $radius : $field->width - 1,
+		min_y => ($y > $radius) ? $y - $radius : 0,
+		max_y => ($y + $radius < $field->height) ? $y + $radius : $field->height - 1
+	);
+	my $distances = $distanceFieldPathfinding->_distanceField($x - $radius, $y - $radius, 2 * $radius + 1);
+	return defined $distances ? \$distances : undef;
+}
+
+##
+# int PathFinding::distanceFieldAt(String* distances, int x, int y, int radius, int to_x, int to_y)
+# distances, x, y, radius: a distance field and the arguments it was calculated with.
+# Returns: the walking cost from ($x, $y) to ($to_x, $to_y), or -1 if it can't be reached within the distance field.
+sub distanceFieldAt {
+	my ($distances, $x, $y, $radius, $to_x, $to_y) = @_;
+	my $size = 2 * $radius + 1;
+	my $column = $to_x - $x + $radius;
+	my $row = $to_y - $y + $radius;
+	return -1 if ($column < 0 || $row < 0 || $column >= $size || $row >= $size);
+
+	my $cost = unpack("v", substr($$distances, (($row * $size) + $column) * 2, 2));
+	return ($cost == 0xFFFF) ? -1 : $cost;
+}
+
+##
+# Array PathFinding::positionsInRange(String positions, int x, int y, [int dist = -1])
+# positions: x, y pairs of native 16 bit integers, as built by pack("s*", ...).
+# Returns: the indices of the positions within $dist blocks of ($x, $y), or of all of them if $dist is negative,
+#          nearest first and in the order of $positions for equal distances.
+#
+# Filters and sorts a whole list of positions in one native call instead of one blockDistance() per position.
+# See $ActorList->inRange().
+
+##
+# Array PathFinding::blockDistanceMany(String positions, int x, int y)
+# positions: packed like for PathFinding::positionsInRange().
+# Returns: the block distance from ($x, $y) to each position, in the order of $positions.
+#
+# Distances are saturated at 32767.
+
+##
+# Array PathFinding::clientDistMany(String positions, int x, int y)
+# positions: packed like for PathFinding::positionsInRange().
+# Returns: the PathFinding::getClientDist() distance from ($x, $y) to each position, in the order of $positions.
+
+##
+# (int, int, int) PathFinding::bestAreaCenter(String positions, int caster_x, int caster_y, int range, int around_x, int around_y, int around, int radius, int tile, int width, int height, String* rawMap, [PathFinding::VisibilityCache visibility])
+# positions: packed like for PathFinding::positionsInRange().
+# Returns: the x and y coordinates of the best centre for a square skill area of $radius blocks and the number of positions
+#          it hits, or an empty list if no cell can be targeted.
+#
+# Candidates are the cells within $around blocks of ($around_x, $around_y) which ($caster_x, $caster_y) can target:
+# within $range like getClientDist() measures it, walkable for $tile and in line of sight. The positions within the area
+# of every candidate are counted at once with a 2D prefix sum. Ties go to the candidate closest to ($around_x, $around_y).
+
+##
+# PathFinding::DangerMap->new(int width, int height)
+# Returns: an empty danger layer for a map of $width x $height cells.
+#
+# A danger layer holds an extra weight for every cell, which searches reset with it (see the danger argument of
+# $PathFinding->reset()) add to the cost of stepping on the cell. Dangerous actors stamp a kernel around their
+# cell, the weight falling off with the squared distance to nothing past the radius, and unstamp it when they
+# move or leave, so the layer is kept up to date a few cells at a time instead of being rebuilt for every search.
+# Search results are kept in the route cache only for the version of the layer they were found with.
+#
+# Methods:
+# `l
+# - stamp(x, y, radius, weight): adds the kernel centered on (x, y), with $weight on that cell.
+# - unstamp(x, y, radius, weight): takes a kernel stamped with the same arguments back out.
+# - stampInverseSquare(x, y, radius, ratio, limit): adds int($ratio / $d ** 2), at most $limit, to the cells up to $radius
+#   blocks around (x, y), $d being their adjustedBlockDistance() to it and at least 1. For obstacles to route around.
+# - unstampInverseSquare(x, y, radius, ratio, limit): takes a kernel stamped with the same arguments back out.
+# - at(x, y): the weight of a cell, 0 out of the map.
+# - stamps(): the number of kernels stamped and not unstamped yet.
+# - version(): a counter incremented by every change.
+# - clear(): takes all kernels out.
+# `l`
+
+
+##
+# PathFinding::Replanner->new(args...)
+# Returns: a PathFinding::Replanner object, or undef if start or dest are not walkable.
+#
+# Required arguments:
+# `l
+# - start: a hash containing x and y values where the path should start.
+# - dest: a hash as above, but for the path's destination.
+# - field, or weight_map, width and height: as in $PathFinding->reset().
+# `l`
+#
+# Optional arguments:
+# `l
+# - avoidWalls: if walls should be avoided during pathing, defaults to 1
+# - secondWeightMap: an array of hashes containing 3 keys, 'x', 'y' and 'weight', for the cells with an extra weight
+# - weight_profile: the weight profile of the field's weight map, as in $PathFinding->reset()
+# `l`
+#
+# A replanner keeps the state of its search (D* Lite) between runs, so when the extra weights of some cells
+# change, for example the cells occupied by monsters, or the start moves along the path, the next run only
+# repairs the part of the search affected by the change instead of searching the whole map again.
+# It finds paths of the same cost as $PathFinding->run() with customWeights and the same secondWeightMap.
+#
+# Methods:
+# `l
+# - run(solution_array): like $PathFinding->run(), returns -1 if there is no path or the number of cells in the solution.
+# - runcount(): like $PathFinding->runcount().
+# - updateCells(cells): sets the extra weight of each {x, y, weight} hash in the cells array, 0 removes it.
+# - moveStart(x, y): moves the start of the path, usually to the cell the character just walked to.
+# - expanded(): the number of nodes expanded by the last run, a measure of how much had to be repaired.
+# `l`
+sub PathFinding::Replanner::new {
+	my $class = shift;
+	my %args = @_;
+
+	croak "Required arguments missing or wrong, specify correct 'field' or 'weight_map' and 'width' and 'height'\n"
+	unless ($args{field} && UNIVERSAL::isa($args{field}, 'Field')) || ($args{weight_map} && $args{width} && $args{height});
+	croak "Required argument 'start' missing\n" unless $args{start};
+	croak "Required argument 'dest' missing\n" unless $args{dest};
+
+	my $self = PathFinding::Replanner::_create(
+		$args{weight_map} || $args{field}->weightProfileMap($args{weight_profile}),
+		$args{width} || $args{field}{width},
+		$args{height} || $args{field}{height},
+		defined $args{avoidWalls} ? $args{avoidWalls} : 1,
+		$args{start}{x},
+		$args{start}{y},
+		$args{dest}{x},
+		$args{dest}{y}
+	);
+	$self->updateCells($args{secondWeightMap}) if ($self && $args{secondWeightMap});
+	return $self;
+}
+
+##
+# PathFinding::PortalGraph->new(args...)
+# Returns: a PathFinding::PortalGraph object.
+#
+# Required arguments:
+# `l
+# - portals: portals like %portals_lut.
+# - los: walking distances from spawns to portals like %portals_los.
+# - weights: weights like %routeWeights.
+# `l`
+#
+# Optional arguments:
+# `l
+# - airships: airships like %portals_airships, defaults to none
+# - budget: the zeny which may be spent on the route, '' or undef for no limit
+# - tickets: the number of warp tickets which may pay for links which allow them
+# `l`
+#
+# A portal graph searches routes between maps natively, over the links of the portal tables (a portal and one
+# of its destinations) and the walking distances between them, which Misc::compilePortals() precomputes with
+# the pathfinding and caches in portalsLOS.txt. The links a search starts from are given to open(), then
+# next() closes the links in order of their walk weight, the same order as Task::CalcMapRoute searched them.
+#
+# Methods:
+# `l
+# - open(key, entry): opens the link "portal=dest" with the walk, zeny, allow_ticket, zeny_covered_by_tickets,
+#   amount_of_tickets_used and is_airship values of the hash entry, the link may be one which isn't in the tables.
+# - next(): closes the next link and returns its key and a hash of the same values as above and its parent link,
+#   undef for the links given to open(), or an empty list when no link is left open.
+# - expanded(): the number of links closed so far.
+# `l`
+sub PathFinding::PortalGraph::new {
+	my $class = shift;
+	my %args = @_;
+
+	croak "Required arguments 'portals', 'los' and 'weights' missing\n" unless ($args{portals} && $args{los} && $args{weights});
+
+	return PathFinding::PortalGraph::_create(
+		$args{portals},
+		$args{los},
+		$args{airships} || {},
+		$args{weights},
+		$args{budget},
+		$args{tickets} || 0
+	);
+}
+
 1;
@@ -0,0 +1,185 @@
+#########################################################################
+#  OpenKore - Sampling profiler
+#
+#  This software is open source, licensed under the GNU General Public
+#  License, version 2.
+#  Basically, this means that you're allowed to modify and distribute
+#  this software. However, if you distribute modified versions, you MUST
+#  also distribute the source code.
+#  See http://www.gnu.org/licenses/gpl.html for the full license.
+#########################################################################
+##
+# MODULE DESCRIPTION: Sampling profiler
+#
+# Finds out where the time goes without changing the code being profiled.
+# While the profiler runs, the interpreter is interrupted regularly at its
+# next safe point (like a signal would) and the subs being run are counted.
+# Unlike <a href="Benchmark.html">Benchmark</a>, code which isn't sampled runs
+# at full speed, so it can stay enabled on a bot which is really playing.
+#
+# Set the <tt>profiler</tt> config option to the number of samples per second
+# (1000 is a good start) to enable it. Every <tt>profiler_dumpInterval</tt>
+# seconds, the stacks which were sampled so far are written to
+# <tt>profile.txt</tt> in the logs folder, in the folded format which
+# flamegraph.pl reads, and the hottest subs and lines are logged in the
+# "profiler" debug domain.
+#
+# <h3>Example:</h3>
+# <pre class="example">
+# Utils::Profiler::start(1000);
+# ... do something ...
+# Utils::Profiler::stop();
+# print Utils::Profiler::report(10);
+# </pre>
+package Utils::Profiler;
+
+use strict;
+use Time::HiRes qw(time);
+use XSTools;
+use Modules 'register';
+use Globals qw(%config);
+use Log qw(debug warning);
+use Translation qw(T TF);
+use Plugins;
+use Utils qw(timeOut);
+
+XSTools::bootModule('Utils::Profiler');
+
+# Note that some functions are implemented in src/auto/XSTools/utils/perl/Profiler.xs
+
+##
+# boolean Utils::Profiler::start([int rate = 1000])
+# rate: The number of samples per second.
+#
+# Start sampling the calling interpreter. Returns whether the profiler runs.
+# Samples are added to the ones taken before; see reset().
+
+##
+# void Utils::Profiler::stop()
+#
+# Stop sampling. The samples are kept.
+
+##
+# boolean Utils::Profiler::isRunning()
+
+##
+# int Utils::Profiler::samples()
+#
+# Returns the number of samples taken since the last reset().
+
+##
+# void Utils::Profiler::reset()
+#
+# Forget the samples.
+
+##
+# String Utils::Profiler::folded()
+# Ensures: defined(result)
+#
+# Returns the samples in the folded stack format of flamegraph.pl: one
+# "outer;inner;file:line count" line per stack which was seen.
+
+our ($rate, $dumpTime);
+
+sub init {
+	Plugins::addHook('mainLoop_post', \&iterate);
+}
+
+# Follow the config options
+sub iterate {
+	if (!$config{profiler}) {
+		if (isRunning()) {
+			stop();
+			writeProfile();
+		}
+		return;
+	}
+
+	if (isRunning() && $rate != $config{profiler}) {
+		stop();
+	}
+	if (!isRunning()) {
+		$rate = $config{profiler};
+		if (!eval { start($rate) }) {
+			warning TF("Unable to start the profiler at %s samples per second\n", $rate);
+			$config{profiler} = 0;
+			return;
+		}
+		$dumpTime = time;
+	} elsif (timeOut($dumpTime, $config{profiler_dumpInterval} || 60)) {
+		writeProfile();
+		$dumpTime = time;
+	}
+}
+
+##
+# void Utils::Profiler::writeProfile()
+#
+# Write the samples to profile.txt in the logs folder, and log the hottest
+# places in the "profiler" debug domain.
+sub writeProfile {
+	my $file = "$Settings::logs_folder/profile.txt";
+	if (open(my $f, '>', $file)) {
+		print $f folded();
+		close $f;
+	} else {
+		warning TF("Unable to write the profile to %s: %s\n", $file, $!);
+	}
+	debug report(10), "profiler";
+}
+
+##
+# String Utils::Profiler::report([int limit = 20])
+# limit: The number of subs and lines to report.
+# Ensures: defined(result)
+#
+# Returns a table of the subs in which the most samples were taken, counting
+# the subs they called ("Total") or not ("Self"), and of the lines in which
+# the most samples were taken.
+sub report {
+	my ($limit) = @_;
+	my (%self, %total, %lines);
+	my $samples = 0;
+	$limit ||= 20;
+
+	foreach my $entry (split /\n/, folded()) {
+		my ($stack, $count) = $entry =~ /^(.*) (\d+)$/ or next;
+		my @frames = split /;/, $stack;
+		my $line = $frames[-1] =~ /:\d+$/ ? pop @frames : undef;
+		my %seen;
+
+		$samples += $count;
+		$lines{$line} += $count if (defined $line);
+		$self{@frames ? $frames[-1] : 'main'} += $count;
+		foreach my $sub (@frames) {
+			$total{$sub} += $count unless ($seen{$sub}++);
+		}
+	}
+	return T("No profiler samples\n") if (!$samples);
+
+	my $percent = sub { sprintf("%d (%.1f%%)", $_[0], $_[0] / $samples * 100) };
+	my @subs = (sort { $self{$b} <=> $self{$a} } keys %self)[0 .. $limit - 1];
+	my @hotLines = (sort { $lines{$b} <=> $lines{$a} } keys %lines)[0 .. $limit - 1];
+	my $result = TF("Profiler: %d samples\n", $samples);
+
+	$result .= sprintf("%-50s  %-16s  %-16s\n", T("Sub"), T("Self"), T("Total"));
+	$result .= "-------------------------------------------------------------------------------------\n";
+	foreach my $sub (grep { defined } @subs) {
+		$result .= sprintf("%-50s  %-16s  %-16s\n", $sub, $percent->($self{$sub}),
+			$total{$sub} ? $percent->($total{$sub}) : '-');
+	}
+	$result .= "\n";
+	$result .= sprintf("%-50s  %-16s\n", T("Line"), T("Samples"));
+	$result .= "-------------------------------------------------------------------------------------\n";
+	foreach my $line (grep { defined } @hotLines) {
+		$result .= sprintf("%-50s  %-16s\n", $line, $percent->($lines{$line}));
+	}
+	return $result;
+}
+
+# The timer thread must not outlive the interpreter
+END {
+	stop();
+}
+
+1;
@@ -48,6 +48,16 @@ XSTools::bootModule('Utils::Rijndael');
 # - keylength: length of the key<br>
 # - blockSize: length of the block<br>
 # `l`
+#
+# With 16 byte blocks (AES), the AES instructions of the CPU are used when it has them, see UseHardware().
+
+##
+# boolean $Rijndael->UseHardware(boolean enable)
+#
+# Whether to use the AES instructions of the CPU (AES-NI, ARMv8 cryptography extension) for 16 byte blocks,
+# which is the default, or the tables. Both give the same results. Other block sizes always use the tables.
+#
+# Returns: whether the AES instructions are used.
 
 ##
 # $Rijndael->Encrypt(char* in, char* not_used, size_t n, int iMode)
@@ -76,10 +86,57 @@ XSTools::bootModule('Utils::Rijndael');
 #
 # Returns: the decrypted string
 
+##
+# void $Rijndael->EncryptInPlace(data, int iMode)
+# data: a string whose length is a multiple of the block size.
+# iMode: as for Encrypt().
+#
+# Encrypts data in its own buffer, without making a new string, so a scalar reused for each packet of a
+# stream is never reallocated. In CBC and CFB modes the chain goes on from the previous call, as for
+# Encrypt(). Dies if the key isn't set or the length isn't a multiple of the block size.
+
+##
+# void $Rijndael->DecryptInPlace(data, int iMode)
+#
+# Decrypts data in its own buffer, see EncryptInPlace().
+
 sub give_hex {
 	return uc unpack("H*", shift);
 }
 
+our %keyed;
+
+##
+# Utils::Rijndael::Keyed Utils::Rijndael::keyed(key, chain, int keylength, int blockSize)
+#
+# A Rijndael object with the given key, shared by everyone who asks for the same key, chain and sizes, so
+# that the key schedule is only made once. See Utils::Rijndael::Keyed->new().
+sub keyed {
+	my ($key, $chain, $keylength, $blockSize) = @_;
+	return $keyed{join(':', $keylength, $blockSize, unpack('H*', $key), unpack('H*', $chain))} ||=
+		Utils::Rijndael::Keyed->new($key, $chain, $keylength, $blockSize);
+}
+
+
+package Utils::Rijndael::Keyed;
+
+use strict;
+use Carp;
+
+our @ISA = qw(Utils::Rijndael);
+
+##
+# Utils::Rijndael::Keyed->new(key, chain, int keylength, int blockSize)
+#
+# A Utils::Rijndael object made with the given key, which can't be changed. Encrypt() and Decrypt() start
+# from the chain in every mode, instead of going on from the previous call, so that using the object
+# never changes it and it can be shared. Dies if the key is shorter than keylength; a shorter chain is
+# padded with zeros.
+
+sub MakeKey {
+	croak "The key of a Utils::Rijndael::Keyed can't be changed";
+}
+
 =pod test
 # will be given as parameters to the Utils::Rijndael functions (prototyped from xs)
 my $key = pack('C24', (6, 169, 33, 64, 54, 184, 161, 91, 81, 46, 3, 213, 52, 18, 0, 6, 61, 175, 186, 66, 157, 158, 180, 48));
@@ -0,0 +1,114 @@
+#########################################################################
+#  OpenKore - Table cache
+#
+#  This software is open source, licensed under the GNU General Public
+#  License, version 2.
+#  Basically, this means that you're allowed to modify and distribute
+#  this software. However, if you distribute modified versions, you MUST
+#  also distribute the source code.
+#  See http://www.gnu.org/licenses/gpl.html for the full license.
+#########################################################################
+##
+# MODULE DESCRIPTION: Binary images of parsed table files
+#
+# Parsing the table files line by line with regular expressions takes most
+# of the startup time, and every bot of a fleet parses the same files. A
+# table cache is the result of parsing a table file, written as a Storable
+# image (a .tblc file next to the table file) which is read back natively in
+# one pass, much faster than the file is parsed.
+#
+# An image records the size and modification time of the table file it was
+# made from, and a signature of how it was parsed; it's only used while both
+# are the same. Images are written to a temporary file and renamed, so bots
+# starting at the same time never read a partial one.
+#
+# See also the <tt>cache</tt> option of Settings::addTableFile().
+package Utils::TableCache;
+
+use strict;
+use Storable qw(nstore retrieve);
+
+# Version of the layout of the images, changing it makes the existing ones out of date
+use constant FORMAT => 1;
+
+##
+# String Utils::TableCache::filename(String source)
+#
+# Returns the filename of the image of a table file.
+sub filename {
+	my ($source) = @_;
+	return "$source.tblc";
+}
+
+sub _sourceStamp {
+	my ($source) = @_;
+	my ($size, $time) = (stat($source))[7, 9];
+	return defined($size) ? "$size:$time" : undef;
+}
+
+##
+# boolean Utils::TableCache::load(String source, String signature, targets...)
+# source: The table file.
+# signature: What the data was parsed by, like the name of the parser and its options.
+# targets: References to the hashes, arrays and scalars the table is parsed into.
+# Returns: Whether the targets were filled from the image. If not, the table file should be parsed.
+#
+# Fill the targets with the data of the image of a table file, if it's up to
+# date. The targets are only filled if all of them are.
+sub load {
+	my ($source, $signature, @targets) = @_;
+	my $file = filename($source);
+	return 0 unless (-f $file);
+
+	my $image = eval { retrieve($file) };
+	return 0 unless (ref($image) eq 'HASH' && $image->{format} == FORMAT);
+	my $stamp = _sourceStamp($source);
+	return 0 unless (defined $stamp && $image->{source} eq $stamp && $image->{signature} eq $signature);
+
+	my $data = $image->{data};
+	return 0 unless (ref($data) eq 'ARRAY' && @{$data} == @targets);
+	for (my $i = 0; $i < @targets; $i++) {
+		return 0 unless (ref($data->[$i]) eq ref($targets[$i]));
+	}
+	for (my $i = 0; $i < @targets; $i++) {
+		my ($target, $value) = ($targets[$i], $data->[$i]);
+		if (ref($target) eq 'HASH') {
+			%{$target} = %{$value};
+		} elsif (ref($target) eq 'ARRAY') {
+			@{$target} = @{$value};
+		} else {
+			${$target} = ${$value};
+		}
+	}
+	return 1;
+}
+
+##
+# boolean Utils::TableCache::save(String source, String signature, targets...)
+# Returns: Whether the image was written.
+#
+# Write the image of a table file just parsed into the targets, see
+# Utils::TableCache::load(). Nothing is written if the folder of the table
+# file is read-only.
+sub save {
+	my ($source, $signature, @targets) = @_;
+	my $stamp = _sourceStamp($source);
+	return 0 unless (defined $stamp);
+
+	my $file = filename($source);
+	my $temp = "$file.$$.tmp";
+	my $image = {
+		format => FORMAT,
+		source => $stamp,
+		signature => $signature,
+		data => \@targets
+	};
+	# Windows doesn't rename over an existing file
+	if (!eval { nstore($image, $temp) } || !(rename($temp, $file) || (unlink($file) && rename($temp, $file)))) {
+		unlink($temp);
+		return 0;
+	}
+	return 1;
+}
+
+1;
@@ -0,0 +1,150 @@
+#########################################################################
+#  OpenKore - Main loop latency tracking
+#
+#  This software is open source, licensed under the GNU General Public
+#  License, version 2.
+#  Basically, this means that you're allowed to modify and distribute
+#  this software. However, if you distribute modified versions, you MUST
+#  also distribute the source code.
+#  See http://www.gnu.org/licenses/gpl.html for the full license.
+#########################################################################
+##
+# MODULE DESCRIPTION: Main loop latency tracking
+#
+# Times every iteration of the main loop (a "tick") and the phases it spends
+# its time in: receiving data, parsing packets, the AI, tasks, pathfinding and
+# field loading. The times go into histograms, so the usual and the worst
+# ticks can be told apart, and a tick which takes longer than the
+# <tt>tickBudget</tt> config option (in milliseconds) is logged with its phases
+# in the "slowTick" warning domain.
+#
+# Phases nest: time spent in a phase which runs inside another one (like
+# pathfinding inside the AI) is only counted for the inner one.
+#
+# The timing is implemented in src/auto/XSTools/misc/ticktimer.cpp, and is
+# cheap enough to be always on:
+# <pre class="example">
+# Utils::TickTimer::begin(Utils::TickTimer::AI);
+# AI::CoreLogic::iterate();
+# Utils::TickTimer::end(Utils::TickTimer::AI);
+# </pre>
+package Utils::TickTimer;
+
+use strict;
+use Time::HiRes qw(time);
+use FastUtils;
+use Globals qw(%config);
+use Log qw(warning);
+use Translation qw(T TF);
+
+##
+# int Utils::TickTimer::phase(String name)
+#
+# Returns the ID of a phase, which begin() and end() take. At most 16 phases can exist.
+
+##
+# void Utils::TickTimer::begin(int phase)
+# void Utils::TickTimer::end(int phase)
+#
+# Time a phase of the current tick. end() also ends the phases which began after it.
+
+##
+# Hash* Utils::TickTimer::lastTick()
+#
+# Returns the phases which ran during the last tick, each as a hash with
+# <tt>time</tt> (microseconds) and <tt>calls</tt>.
+
+##
+# int Utils::TickTimer::lastTickTime()
+#
+# Returns the microseconds the last tick took.
+
+##
+# Hash* Utils::TickTimer::histogram([phase])
+#
+# Returns the <tt>count</tt> of recorded times of a phase, with their
+# <tt>max</tt> and their <tt>p50</tt>, <tt>p90</tt> and <tt>p99</tt>
+# percentiles, in microseconds. Without a phase, the times of the ticks.
+
+use constant {
+	NETWORK => phase('network'),
+	PARSE => phase('parse'),
+	AI => phase('ai'),
+	TASKS => phase('tasks'),
+	FIELD => phase('field'),
+	PATHFINDING => phase('pathfinding'),
+};
+
+our ($lastWarning, $suppressed) = (0, 0);
+
+##
+# int Utils::TickTimer::finishTick()
+#
+# End the current tick, and log it if it took longer than the budget.
+# Returns its length in microseconds.
+sub finishTick {
+	my $time = endTick();
+	my $budget = $config{tickBudget};
+
+	if ($budget && $time > $budget * 1000) {
+		# At most one report per second; the others are counted
+		if (time - $lastWarning >= 1) {
+			warning TF("Slow tick: %s (budget %d ms%s): %s\n",
+				milliseconds($time), $budget,
+				$suppressed ? TF(", %d more slow ticks", $suppressed) : '',
+				breakdown($time)), 'slowTick';
+			$lastWarning = time;
+			$suppressed = 0;
+		} else {
+			$suppressed++;
+		}
+	}
+	return $time;
+}
+
+sub milliseconds {
+	return sprintf("%.1f ms", $_[0] / 1000);
+}
+
+##
+# String Utils::TickTimer::breakdown(int time)
+# time: The length of the last tick, in microseconds.
+#
+# Returns the phases of the last tick, slowest first, and the time which no phase took.
+sub breakdown {
+	my ($time) = @_;
+	my $phases = lastTick();
+	my @result;
+	my $rest = $time;
+
+	foreach my $name (sort { $phases->{$b}{time} <=> $phases->{$a}{time} } keys %{$phases}) {
+		my $phase = $phases->{$name};
+		my $p99 = histogram($name)->{p99};
+		$rest -= $phase->{time};
+		push @result, sprintf("%s %s%s (p99 %s)", $name, milliseconds($phase->{time}),
+			$phase->{calls} > 1 ? " x$phase->{calls}" : '', milliseconds($p99));
+	}
+	push @result, sprintf("%s %s", T("other"), milliseconds($rest > 0 ? $rest : 0));
+	return join(', ', @result);
+}
+
+##
+# String Utils::TickTimer::report()
+# Ensures: defined(result)
+#
+# Returns a table of the percentiles of the ticks and of each phase.
+sub report {
+	my $result = sprintf("%-14s  %8s  %10s  %10s  %10s  %10s\n",
+		T("Phase"), T("Count"), "p50", "p90", "p99", T("Max"));
+	$result .= "-----------------------------------------------------------------------\n";
+	foreach my $name (undef, phases()) {
+		my $histogram = histogram($name);
+		next if (defined $name && !$histogram->{count});
+		$result .= sprintf("%-14s  %8d  %10s  %10s  %10s  %10s\n",
+			defined $name ? $name : T("tick"), $histogram->{count},
+			map { milliseconds($histogram->{$_}) } qw(p50 p90 p99 max));
+	}
+	return $result;
+}
+
+1;
@@ -0,0 +1,79 @@
+#########################################################################
+#  OpenKore - Timer wheel
+#
+#  This software is open source, licensed under the GNU General Public
+#  License, version 2.
+#  Basically, this means that you're allowed to modify and distribute
+#  this software. However, if you distribute modified versions, you MUST
+#  also distribute the source code.
+#  See http://www.gnu.org/licenses/gpl.html for the full license.
+#########################################################################
+##
+# MODULE DESCRIPTION: Named timeouts checked in one call
+#
+# A set of named timers, which are registered once with their deadline and
+# then polled all at once: expired() reads the clock and returns the timers
+# which became due since the last call, instead of timeOut() being called for
+# every one of them on every iteration. The time expired() read is the wheel's
+# clock until the next call, which set() and remaining() measure from.
+#
+# The timers are kept in a hierarchical timer wheel, implemented in
+# src/auto/XSTools/misc/timerwheel.cpp, so polling costs the same however
+# many timers are pending. A timer is never reported before its deadline, and
+# at most one tick (the resolution, 10 milliseconds by default) after it.
+# <pre class="example">
+# my $timers = new Utils::TimerWheel();
+# $timers->set('wipe', 30);
+# ...
+# foreach my $name ($timers->expired) {
+#     wipe() if ($name eq 'wipe');
+# }
+# </pre>
+package Utils::TimerWheel;
+
+use strict;
+use Time::HiRes qw(time);
+use FastUtils;
+
+##
+# Utils::TimerWheel Utils::TimerWheel->new([double resolution = 0.01])
+# resolution: The length of a tick in seconds.
+#
+# Create a timer wheel without timers, whose clock is the current time.
+
+##
+# void $Utils_TimerWheel->set(String name, double seconds, [double since])
+#
+# Make a timer due seconds after since, or after the wheel's clock. A pending
+# timer with the same name is replaced.
+
+##
+# void $Utils_TimerWheel->cancel(String name)
+#
+# Make a timer no longer pending, if it is.
+
+##
+# double $Utils_TimerWheel->remaining(String name)
+#
+# Returns the seconds from the wheel's clock to the deadline of a timer, which
+# are negative if it's overdue, or undef if it isn't pending.
+
+##
+# Array<String> $Utils_TimerWheel->expired([double now])
+# now: The current time, which is read from the clock if not given.
+#
+# Returns the names of the timers which became due, which are no longer
+# pending, and makes now the wheel's clock.
+
+##
+# double $Utils_TimerWheel->now()
+#
+# Returns the wheel's clock: the time of the last expired() call, or of the
+# wheel's creation.
+
+##
+# int $Utils_TimerWheel->count()
+#
+# Returns the number of pending timers.
+
+1;
@@ -23,15 +23,22 @@
 #                                # 73e83be698b288febcf88e3e03c4f0757ea8964e59b63d93708b138cc42a66eb3
 # $hash = whirlpool_hex("abc");  # 4e2448a4c6f486bb16b6562c73b4020bf3043e3a731bce721ae1b303d97e6d4c
 #                                # 7181eebdb6c57e277d0e34957114cbd6c797fc9d95d8b582d225292076d4eef5
+# $hash = whirlpool_file_hex("tables/items.txt");
+#
+# my $wp = new Utils::Whirlpool();
+# $wp->add($header);
+# $wp->addFile($filename) or die "Cannot read $filename";
+# $hash = $wp->finalize();
 # </pre>
 package Utils::Whirlpool;
 
 use strict;
+use File::Spec;
 use XSTools;
 use Exporter;
 use base qw(Exporter);
 
-our @EXPORT_OK = qw(whirlpool whirlpool_hex);
+our @EXPORT_OK = qw(whirlpool whirlpool_hex whirlpool_file whirlpool_file_hex whirlpool_manifest);
 
 XSTools::bootModule('Utils::Whirlpool');
 
@@ -63,4 +70,70 @@ sub whirlpool_hex {
 	return unpack("H*", &whirlpool);
 }
 
+##
+# Bytes Utils::Whirlpool::whirlpool_file(String filename)
+# filename: The file to calculate the hash for.
+# Returns: A whirlpool hash of the file's contents in raw bytes, or undef if the file can't be read.
+#
+# Calculate the Whirlpool hash of a file. The file is mapped in memory rather than read into a
+# Perl string, so hashing big files is about as fast as reading them.
+#
+# This symbol is exportable.
+sub whirlpool_file {
+	my $wp = new Utils::Whirlpool();
+	return $wp->addFile($_[0]) ? $wp->finalize() : undef;
+}
+
+##
+# String Utils::Whirlpool::whirlpool_file_hex(String filename)
+# filename: The file to calculate the hash for.
+# Returns: A whirlpool hash of the file's contents as hexadecimal string, or undef if the file can't be read.
+#
+# Calculate the Whirlpool hash of a file, see whirlpool_file().
+#
+# This symbol is exportable.
+sub whirlpool_file_hex {
+	my $hash = &whirlpool_file;
+	return defined($hash) ? unpack("H*", $hash) : undef;
+}
+
+##
+# Array<Bytes> Utils::Whirlpool::hashFiles(Array<String>* filenames, [int threads])
+# filenames: The files to calculate the hashes for.
+# threads: The number of native threads to use at most, 0 or none for all of the native thread pool (see Utils::nativeThreads()).
+# Returns: The whirlpool hash of each file in raw bytes, in the order of filenames, undef for the
+#          files which can't be read.
+#
+# Calculate the Whirlpool hashes of many files at once, each thread hashing the next file not taken
+# yet, as whirlpool_file() does.
+
+##
+# Hash<String> Utils::Whirlpool::whirlpool_manifest(String folder, [Regexp pattern])
+# folder: The folder whose files to hash.
+# pattern: Only the files whose names match it are hashed, all of them if not given.
+# Returns: A reference to a hash of the names of the files in the folder (not in its subfolders) and
+#          their whirlpool hashes as hexadecimal strings, or undef if the folder can't be read.
+#
+# Calculate the Whirlpool hashes of the files of a folder, with hashFiles().
+#
+# This symbol is exportable.
+sub whirlpool_manifest {
+	my ($folder, $pattern) = @_;
+	my $dir;
+	return undef unless (opendir($dir, $folder));
+	my @names = sort grep { (!defined($pattern) || /$pattern/) && -f File::Spec->catfile($folder, $_) } readdir($dir);
+	closedir($dir);
+
+	my @hashes = hashFiles([map { File::Spec->catfile($folder, $_) } @names]);
+	my %manifest;
+	@manifest{@names} = map { defined($_) ? unpack("H*", $_) : undef } @hashes;
+	return \%manifest;
+}
+
+##
+# boolean $Utils_Whirlpool->addFile(String filename)
+# Returns: Whether the whole file could be read.
+#
+# Add the contents of a file to the data being hashed, as add() would the file's contents.
+
 1;
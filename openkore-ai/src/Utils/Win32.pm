@@ -55,4 +55,34 @@ XSTools::bootModule('Utils::Win32');
 #
 # Convert a UTF-8 string into a multibyte string, encoded in the specified codepage.
 
+##
+# Utils::Win32::XKoreShm Utils::Win32::XKoreShm->new(int pid)
+# pid: the process ID of the RO client.
+# Returns: the transport, or undef if it can't be created.
+#
+# Create the shared memory which NetRedirect.dll, injected into the RO client, uses
+# instead of the X-Kore server socket. It carries the same packets as the socket.
+# The DLL sees the connection closing when the object is destroyed.
+
+##
+# boolean $XKoreShm->send(Bytes data)
+#
+# Send data to the DLL. Returns false, sending nothing, if the buffer doesn't have room for it.
+
+##
+# Bytes $XKoreShm->recv()
+#
+# Returns what the DLL sent since the last call, or an empty string.
+
+##
+# boolean $XKoreShm->peerAlive()
+#
+# Check whether the DLL has opened the shared memory and the RO client is still running.
+
+##
+# boolean $XKoreShm->wait(int timeout)
+# timeout: in milliseconds.
+#
+# Wait until the DLL sent something or opened the shared memory. Returns false on timeout.
+
 1;
@@ -23,6 +23,7 @@
 #include "Pointer.h"
 #include "Types.h"
 #include "IO/All.h"
+#include "Memory/All.h"
 #include "Net/All.h"
 #include "Threading/All.h"
 
@@ -30,6 +31,7 @@
  * @defgroup Base Base
  * @defgroup Threading Concurrency & Threading
  * @defgroup IO Input/Output
+ * @defgroup Memory Memory Management
  * @defgroup Net Networking
  */
 
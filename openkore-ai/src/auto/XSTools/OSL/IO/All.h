@@ -18,6 +18,7 @@
  *  MA  02110-1301  USA
  */
 
+#include "BufferedInputStream.h"
 #include "BufferedOutputStream.h"
 #include "InputStream.h"
 #include "IOException.h"
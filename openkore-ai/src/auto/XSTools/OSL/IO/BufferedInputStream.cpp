@@ -0,0 +1,161 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "BufferedInputStream.h"
+#include "IOException.h"
+
+namespace OSL {
+
+	BufferedInputStream::BufferedInputStream(InputStream *stream, unsigned int size) {
+		assert(stream != NULL);
+		assert(size > 0);
+
+		this->stream = stream;
+		stream->ref();
+		maxsize = size;
+		buffer = new char[size];
+		start = 0;
+		count = 0;
+	}
+
+	BufferedInputStream::~BufferedInputStream() {
+		close();
+	}
+
+	void
+	BufferedInputStream::close() {
+		if (stream != NULL) {
+			stream->close();
+			stream->unref();
+			delete[] buffer;
+			stream = NULL;
+			buffer = NULL;
+			start = 0;
+			count = 0;
+		}
+	}
+
+	bool
+	BufferedInputStream::fill() {
+		// Make room after the buffered bytes
+		if (start + count == maxsize && start > 0) {
+			memmove(buffer, buffer + start, count);
+			start = 0;
+		}
+
+		int result = stream->read(buffer + start + count, maxsize - start - count);
+		if (result == -1) {
+			return false;
+		}
+		count += result;
+		return true;
+	}
+
+	bool
+	BufferedInputStream::eof() const {
+		if (stream == NULL) {
+			throw IOException("The stream is closed.");
+		}
+		return count == 0 && stream->eof();
+	}
+
+	int
+	BufferedInputStream::read(char *buffer, unsigned int size) {
+		assert(buffer != NULL);
+		assert(size > 0);
+
+		if (stream == NULL) {
+			throw IOException("The stream is closed.");
+		}
+
+		if (count == 0) {
+			if (size >= maxsize) {
+				return stream->read(buffer, size);
+			}
+			start = 0;
+			if (!fill()) {
+				return -1;
+			}
+		}
+
+		unsigned int n = (size < count) ? size : count;
+		memcpy(buffer, this->buffer + start, n);
+		start += n;
+		count -= n;
+		if (count == 0) {
+			start = 0;
+		}
+		return n;
+	}
+
+	unsigned int
+	BufferedInputStream::available() const throw() {
+		return count;
+	}
+
+	int
+	BufferedInputStream::peek(char *buffer, unsigned int size) {
+		assert(buffer != NULL);
+		assert(size > 0);
+
+		if (stream == NULL) {
+			throw IOException("The stream is closed.");
+		}
+
+		if (count == 0) {
+			start = 0;
+			if (!fill()) {
+				return -1;
+			}
+		}
+
+		unsigned int n = (size < count) ? size : count;
+		memcpy(buffer, this->buffer + start, n);
+		return n;
+	}
+
+	unsigned int
+	BufferedInputStream::readahead(unsigned int size) {
+		if (stream == NULL) {
+			throw IOException("The stream is closed.");
+		}
+
+		if (size > maxsize) {
+			size = maxsize;
+		}
+		// Move the buffered bytes to the front if what is asked for
+		// doesn't fit after them
+		if (start > 0 && start + size > maxsize) {
+			memmove(buffer, buffer + start, count);
+			start = 0;
+		}
+		while (count < size) {
+			unsigned int before = count;
+			if (!fill() || count == before) {
+				// End of the stream, or nothing to read right now
+				break;
+			}
+		}
+		return count;
+	}
+
+}
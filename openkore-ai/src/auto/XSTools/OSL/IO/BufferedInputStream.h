@@ -0,0 +1,131 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifndef _OSL_BUFFERED_INPUT_STREAM_H_
+#define _OSL_BUFFERED_INPUT_STREAM_H_
+
+#include "InputStream.h"
+
+namespace OSL {
+
+	/**
+	 * An input stream which wraps another input stream, and reads
+	 * as much data as fits in its buffer at once, so that many small
+	 * reads don't each cost a read on the wrapped stream. The buffered
+	 * data can be looked at before it is read, with peek().
+	 *
+	 * Reads at least as large as the buffer, while nothing is buffered,
+	 * go straight to the wrapped stream without being copied.
+	 *
+	 * When a BufferedInputStream is closed or deleted, its underlying
+	 * input stream is also closed, and dereferenced.
+	 *
+	 * This implementation is NOT thread-safe!
+	 *
+	 * @class BufferedInputStream OSL/IO/BufferedInputStream.h
+	 * @ingroup IO
+	 */
+	class BufferedInputStream: public InputStream {
+	private:
+		/** The wrapped stream. Can be NULL. */
+		InputStream *stream;
+
+		/**
+		 * The buffer.
+		 * @invariant (stream != NULL) == (buffer != NULL)
+		 */
+		char *buffer;
+
+		/** The maximum buffer size. */
+		unsigned int maxsize;
+
+		/**
+		 * The buffered bytes are at buffer + start.
+		 * @invariant start + count <= maxsize
+		 */
+		unsigned int start;
+
+		/**
+		 * The number of buffered bytes.
+		 * @invariant 0 <= count <= maxsize
+		 */
+		unsigned int count;
+
+		/**
+		 * Read once from the wrapped stream, after the buffered bytes.
+		 * Returns false if the end of the stream has been reached.
+		 */
+		bool fill();
+
+	public:
+		/** The default buffer size. */
+		static const unsigned int DEFAULT_BUFFER_SIZE = 4096;
+
+		/**
+		 * Create a new BufferedInputStream.
+		 * stream's reference count will be increased by 1.
+		 *
+		 * @param stream The input stream to wrap.
+		 * @param size   The maximum size of the buffer.
+		 * @pre stream != NULL
+		 * @pre size > 0
+		 */
+		BufferedInputStream(InputStream *stream, unsigned int size = DEFAULT_BUFFER_SIZE);
+
+		~BufferedInputStream();
+		virtual void close();
+		virtual bool eof() const;
+		virtual int read(char *buffer, unsigned int size);
+
+		/**
+		 * Returns the number of bytes which can be read without
+		 * reading from the wrapped stream.
+		 */
+		unsigned int available() const throw();
+
+		/**
+		 * Copy up to size bytes of the data which read() would return,
+		 * without removing them from the stream. Reads from the wrapped
+		 * stream once if nothing is buffered.
+		 *
+		 * @param buffer The buffer to receive the data.
+		 * @param size   The maximum size of buffer.
+		 * @return The number of bytes copied, which may be 0, or -1 if the
+		 *         end of the stream has been reached.
+		 * @pre  buffer != NULL
+		 * @pre  size > 0
+		 * @throws IOException
+		 */
+		int peek(char *buffer, unsigned int size);
+
+		/**
+		 * Read from the wrapped stream until at least size bytes are
+		 * buffered, the buffer is full, or the end of the stream has
+		 * been reached, so that they can be peeked at or read at once.
+		 *
+		 * @return available()
+		 * @throws IOException
+		 */
+		unsigned int readahead(unsigned int size);
+	};
+
+}
+
+#endif /* _OSL_BUFFERED_INPUT_STREAM_H_ */
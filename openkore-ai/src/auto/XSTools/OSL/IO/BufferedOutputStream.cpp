@@ -44,29 +44,80 @@ namespace OSL {
 			flush();
 			stream->close();
 			stream->unref();
-			delete buffer;
+			delete[] buffer;
 			stream = NULL;
 			buffer = NULL;
 		}
 	}
 
 	void
-	BufferedOutputStream::flush() throw(IOException) {
+	BufferedOutputStream::writeAll(IOVector *vectors, unsigned int count) {
+		// The wrapped stream may write less than it was given;
+		// skip what it wrote and try again with the rest.
+		while (count > 0) {
+			if (vectors->size == 0) {
+				vectors++;
+				count--;
+				continue;
+			}
+
+			unsigned int written = stream->writev(vectors, count);
+			while (count > 0 && written >= vectors->size) {
+				written -= vectors->size;
+				vectors++;
+				count--;
+			}
+			if (count > 0) {
+				vectors->data += written;
+				vectors->size -= written;
+			}
+		}
+	}
+
+	void
+	BufferedOutputStream::writeThrough(const IOVector *vectors, unsigned int count) {
+		IOVector small[8];
+		IOVector *all = (count < 8) ? small : new IOVector[count + 1];
+
+		all[0].data = buffer;
+		all[0].size = this->count;
+		memcpy(all + 1, vectors, count * sizeof(IOVector));
+		// Like in flush(), the buffer is emptied first in case
+		// writing throws an exception.
+		this->count = 0;
+		try {
+			writeAll(all, count + 1);
+		} catch (...) {
+			if (all != small) {
+				delete[] all;
+			}
+			throw;
+		}
+		if (all != small) {
+			delete[] all;
+		}
+	}
+
+	void
+	BufferedOutputStream::flush() {
 		if (stream == NULL) {
 			throw IOException("The stream is closed.");
 
 		} else if (count > 0) {
-			// We make a copy of count just in case write() or
+			IOVector vector;
+
+			vector.data = buffer;
+			vector.size = count;
+			// We reset count just in case write() or
 			// flush() throws an exception.
-			unsigned int c = count;
 			count = 0;
-			stream->write(buffer, c);
+			writeAll(&vector, 1);
 			stream->flush();
 		}
 	}
 
 	unsigned int
-	BufferedOutputStream::write(const char *data, unsigned int size) throw(IOException) {
+	BufferedOutputStream::write(const char *data, unsigned int size) {
 		assert(data != NULL);
 		assert(size > 0);
 
@@ -74,24 +125,47 @@ namespace OSL {
 			throw IOException("The stream is closed.");
 		}
 
-		unsigned int written = 0;
-		size_t rest = size;
-
-		while (rest > 0) {
-			size_t n = rest;
-			if (n > maxsize - count) {
-				n = maxsize - count;
+		if (size <= maxsize - count) {
+			memcpy(buffer + count, data, size);
+			count += size;
+			if (count == maxsize) {
+				flush();
 			}
-			memcpy (buffer + count, data + written, n);
-			count += n;
-			rest -= n;
-			written += n;
+		} else {
+			IOVector vector;
 
-			if (count == maxsize) {
+			vector.data = data;
+			vector.size = size;
+			writeThrough(&vector, 1);
+		}
+		return size;
+	}
+
+	unsigned int
+	BufferedOutputStream::writev(const IOVector *vectors, unsigned int count) {
+		unsigned int total = 0;
+
+		assert(vectors != NULL);
+
+		if (stream == NULL) {
+			throw IOException("The stream is closed.");
+		}
+
+		for (unsigned int i = 0; i < count; i++) {
+			total += vectors[i].size;
+		}
+		if (total <= maxsize - this->count) {
+			for (unsigned int i = 0; i < count; i++) {
+				memcpy(buffer + this->count, vectors[i].data, vectors[i].size);
+				this->count += vectors[i].size;
+			}
+			if (this->count == maxsize) {
 				flush();
 			}
+		} else {
+			writeThrough(vectors, count);
 		}
-		return written;
+		return total;
 	}
 
 }
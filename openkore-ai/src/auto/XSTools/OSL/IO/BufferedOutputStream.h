@@ -31,6 +31,10 @@ namespace OSL {
 	 * data immediately. This results in better performance for some
 	 * output streams.
 	 *
+	 * Data which doesn't fit in the buffer anymore isn't copied into it:
+	 * it is written together with the buffered data, in a single
+	 * OutputStream::writev() call on the wrapped stream.
+	 *
 	 * When a BufferedOutputStream is closed or deleted, its underlying
 	 * output stream is also closed, and dereferenced.
 	 *
@@ -59,6 +63,12 @@ namespace OSL {
 		 */
 		unsigned int count;
 
+		/** Write all of the parts to the wrapped stream, modifying vectors. */
+		void writeAll(IOVector *vectors, unsigned int count);
+
+		/** Write the buffered data and the parts to the wrapped stream. */
+		void writeThrough(const IOVector *vectors, unsigned int count);
+
 	public:
 		/** The default buffer size. */
 		static const unsigned int DEFAULT_BUFFER_SIZE = 512;
@@ -75,8 +85,9 @@ namespace OSL {
 
 		~BufferedOutputStream();
 		virtual void close();
-		virtual void flush() throw(IOException);
-		virtual unsigned int write(const char *data, unsigned int size) throw(IOException);
+		virtual void flush();
+		virtual unsigned int write(const char *data, unsigned int size);
+		virtual unsigned int writev(const IOVector *vectors, unsigned int count);
 	};
 
 }
@@ -51,13 +51,13 @@ namespace OSL {
 			}
 
 			virtual bool
-			eof() const throw(IOException) {
+			eof() const {
 				MutexLocker lock(mutex);
 				return wrapped->eof();
 			}
 
 			virtual int
-			read(char *buffer, unsigned int size) throw(IOException) {
+			read(char *buffer, unsigned int size) {
 				MutexLocker lock(mutex);
 				return wrapped->read(buffer, size);
 			}
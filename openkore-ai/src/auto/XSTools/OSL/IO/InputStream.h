@@ -52,7 +52,7 @@ namespace OSL {
 		 *
 		 * @throws IOException
 		 */
-		virtual bool eof() const throw(IOException) = 0;
+		virtual bool eof() const = 0;
 
 		/**
 		 * Read up to size bytes of data from this stream.
@@ -66,7 +66,7 @@ namespace OSL {
 		 * @post if eof(): result == -1
 		 * @throws IOException
 		 */
-		virtual int read(char *buffer, unsigned int size) throw(IOException) = 0;
+		virtual int read(char *buffer, unsigned int size) = 0;
 
 		/**
 		 * Create a thread-safe wrapper around this InputStream.
@@ -50,19 +50,43 @@ namespace OSL {
 			}
 
 			virtual void
-			flush() throw(IOException) {
+			flush() {
 				MutexLocker lock(mutex);
 				wrapped->flush();
 			}
 
 			virtual unsigned int
-			write(const char *data, unsigned int size) throw(IOException) {
+			write(const char *data, unsigned int size) {
 				MutexLocker lock(mutex);
 				return wrapped->write(data, size);
 			}
+
+			virtual unsigned int
+			writev(const IOVector *vectors, unsigned int count) {
+				MutexLocker lock(mutex);
+				return wrapped->writev(vectors, count);
+			}
 		};
 	}
 
+	unsigned int
+	OutputStream::writev(const IOVector *vectors, unsigned int count) {
+		unsigned int total = 0;
+
+		for (unsigned int i = 0; i < count; i++) {
+			if (vectors[i].size == 0) {
+				continue;
+			}
+
+			unsigned int written = write(vectors[i].data, vectors[i].size);
+			total += written;
+			if (written < vectors[i].size) {
+				break;
+			}
+		}
+		return total;
+	}
+
 	OutputStream *
 	OutputStream::createThreadSafe() throw() {
 		return new ThreadSafeOutputStream(this);
@@ -26,6 +26,18 @@
 
 namespace OSL {
 
+	/**
+	 * A part of the data given to OutputStream::writev().
+	 *
+	 * @ingroup IO
+	 */
+	struct IOVector {
+		/** The bytes of this part. */
+		const char *data;
+		/** The number of bytes in data. */
+		unsigned int size;
+	};
+
 	/**
 	 * An abstract base class for all output stream classes.
 	 *
@@ -55,7 +67,7 @@ namespace OSL {
 		 *
 		 * @throws IOException
 		 */
-		virtual void flush() throw(IOException) = 0;
+		virtual void flush() = 0;
 
 		/**
 		 * Write data into the stream.
@@ -71,7 +83,25 @@ namespace OSL {
 		 * @pre size > 0
 		 * @throws  IOException
 		 */
-		virtual unsigned int write(const char *data, unsigned int size) throw(IOException) = 0;
+		virtual unsigned int write(const char *data, unsigned int size) = 0;
+
+		/**
+		 * Write the parts of data in vectors into the stream, one after
+		 * another, as if write() had been called on each of them.
+		 *
+		 * Streams which can hand several buffers to the underlying device
+		 * at once (such as sockets) override this, so that data gathered
+		 * from several places costs a single system call and no copy. The
+		 * default implementation calls write() on each part.
+		 *
+		 * @param vectors The parts to write.
+		 * @param count   The number of parts in vectors.
+		 * @return  The number of bytes written, which may be smaller than
+		 *          the total size of the parts, like for write().
+		 * @pre vectors != NULL
+		 * @throws  IOException
+		 */
+		virtual unsigned int writev(const IOVector *vectors, unsigned int count);
 
 		/**
 		 * Create a thread-safe wrapper around this OutputStream.
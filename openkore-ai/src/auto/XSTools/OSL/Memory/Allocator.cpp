@@ -0,0 +1,343 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "Allocator.h"
+
+#ifdef WIN32
+	typedef SRWLOCK NativeMutex;
+	#define NATIVE_MUTEX_INITIALIZER SRWLOCK_INIT
+	#define nativeLock(mutex) AcquireSRWLockExclusive(mutex)
+	#define nativeUnlock(mutex) ReleaseSRWLockExclusive(mutex)
+#else
+	typedef pthread_mutex_t NativeMutex;
+	#define NATIVE_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+	#define nativeLock(mutex) pthread_mutex_lock(mutex)
+	#define nativeUnlock(mutex) pthread_mutex_unlock(mutex)
+#endif
+
+#ifdef _MSC_VER
+	#define THREAD_LOCAL __declspec(thread)
+#else
+	#define THREAD_LOCAL __thread
+#endif
+
+namespace OSL {
+namespace Memory {
+
+	namespace {
+		// MIN_BLOCK_SIZE, twice that, and so on up to MAX_BLOCK_SIZE
+		const unsigned int CLASS_COUNT = 9;
+		// New blocks are cut out of slabs this big
+		const size_t SLAB_SIZE = 64 * 1024;
+		// A thread keeps about this many free bytes per size class
+		const size_t CACHE_SIZE = 32 * 1024;
+
+		// A free block, which is linked through its first bytes
+		struct FreeBlock {
+			FreeBlock *next;
+		};
+
+		// The blocks which no thread cache holds
+		struct GlobalList {
+			NativeMutex lock;
+			FreeBlock *blocks;
+		};
+
+		struct ThreadCache {
+			FreeBlock *blocks[CLASS_COUNT];
+			unsigned int counts[CLASS_COUNT];
+		};
+
+		#define GLOBAL_LIST_INITIALIZER { NATIVE_MUTEX_INITIALIZER, NULL }
+
+		GlobalList globalLists[CLASS_COUNT] = {
+			GLOBAL_LIST_INITIALIZER, GLOBAL_LIST_INITIALIZER, GLOBAL_LIST_INITIALIZER,
+			GLOBAL_LIST_INITIALIZER, GLOBAL_LIST_INITIALIZER, GLOBAL_LIST_INITIALIZER,
+			GLOBAL_LIST_INITIALIZER, GLOBAL_LIST_INITIALIZER, GLOBAL_LIST_INITIALIZER
+		};
+
+		// The cache of the current thread; NULL until it allocates,
+		// and after it exited
+		THREAD_LOCAL ThreadCache *currentCache = NULL;
+
+
+		unsigned int
+		classOf(size_t size) {
+			unsigned int index = 0;
+			size_t classSize = MIN_BLOCK_SIZE;
+			while (classSize < size) {
+				classSize *= 2;
+				index++;
+			}
+			return index;
+		}
+
+		size_t
+		classSize(unsigned int index) {
+			return MIN_BLOCK_SIZE << index;
+		}
+
+		// The number of blocks past which a thread gives half of them back
+		unsigned int
+		cacheLimit(unsigned int index) {
+			return CACHE_SIZE / classSize(index);
+		}
+
+		// Move a list of blocks, from first to last, to the global list
+		void
+		giveBack(unsigned int index, FreeBlock *first, FreeBlock *last) {
+			GlobalList &list = globalLists[index];
+			nativeLock(&list.lock);
+			last->next = list.blocks;
+			list.blocks = first;
+			nativeUnlock(&list.lock);
+		}
+
+		// Fill a thread's empty list from the global one, or with a new slab
+		void
+		refill(ThreadCache *cache, unsigned int index) {
+			GlobalList &list = globalLists[index];
+			unsigned int wanted = cacheLimit(index) / 2;
+			unsigned int count = 0;
+			FreeBlock *first, *last = NULL;
+
+			nativeLock(&list.lock);
+			first = list.blocks;
+			for (FreeBlock *block = first; block != NULL && count < wanted; block = block->next) {
+				last = block;
+				count++;
+			}
+			if (last != NULL) {
+				list.blocks = last->next;
+				last->next = NULL;
+			}
+			nativeUnlock(&list.lock);
+
+			if (count == 0) {
+				size_t size = classSize(index);
+				char *slab = (char *) malloc(SLAB_SIZE);
+				if (slab == NULL) {
+					return;
+				}
+				first = NULL;
+				for (size_t offset = SLAB_SIZE; offset >= size; offset -= size) {
+					FreeBlock *block = (FreeBlock *) (slab + offset - size);
+					block->next = first;
+					first = block;
+					count++;
+				}
+			}
+			cache->blocks[index] = first;
+			cache->counts[index] = count;
+		}
+
+		void
+		flush(ThreadCache *cache) {
+			for (unsigned int index = 0; index < CLASS_COUNT; index++) {
+				FreeBlock *first = cache->blocks[index];
+				if (first != NULL) {
+					FreeBlock *last = first;
+					while (last->next != NULL) {
+						last = last->next;
+					}
+					giveBack(index, first, last);
+				}
+			}
+		}
+
+		#ifdef WIN32
+			INIT_ONCE cacheKeyOnce = INIT_ONCE_STATIC_INIT;
+			DWORD cacheKey = FLS_OUT_OF_INDEXES;
+
+			void WINAPI
+			threadExited(void *data) {
+				flush((ThreadCache *) data);
+				free(data);
+				currentCache = NULL;
+			}
+
+			BOOL CALLBACK
+			createCacheKey(INIT_ONCE *, void *, void **) {
+				cacheKey = FlsAlloc(threadExited);
+				return TRUE;
+			}
+
+			bool
+			registerCache(ThreadCache *cache) {
+				InitOnceExecuteOnce(&cacheKeyOnce, createCacheKey, NULL, NULL);
+				return cacheKey != FLS_OUT_OF_INDEXES && FlsSetValue(cacheKey, cache);
+			}
+		#else
+			pthread_once_t cacheKeyOnce = PTHREAD_ONCE_INIT;
+			pthread_key_t cacheKey;
+			bool haveCacheKey = false;
+
+			void
+			threadExited(void *data) {
+				flush((ThreadCache *) data);
+				free(data);
+				currentCache = NULL;
+			}
+
+			void
+			createCacheKey() {
+				haveCacheKey = pthread_key_create(&cacheKey, threadExited) == 0;
+			}
+
+			bool
+			registerCache(ThreadCache *cache) {
+				pthread_once(&cacheKeyOnce, createCacheKey);
+				return haveCacheKey && pthread_setspecific(cacheKey, cache) == 0;
+			}
+		#endif
+
+		/*
+		 * Returns the cache of the current thread, or NULL if it can't
+		 * have one, in which case it uses the global lists directly.
+		 */
+		ThreadCache *
+		getCache() {
+			ThreadCache *cache = currentCache;
+			if (cache == NULL) {
+				cache = (ThreadCache *) calloc(1, sizeof(ThreadCache));
+				if (cache == NULL) {
+					return NULL;
+				}
+				if (!registerCache(cache)) {
+					// It would never be flushed
+					free(cache);
+					return NULL;
+				}
+				currentCache = cache;
+			}
+			return cache;
+		}
+	}
+
+	void *
+	allocate(size_t size) throw() {
+		if (size > MAX_BLOCK_SIZE) {
+			return malloc(size);
+		}
+
+		unsigned int index = classOf(size);
+		ThreadCache *cache = getCache();
+		FreeBlock *block;
+
+		if (cache == NULL) {
+			GlobalList &list = globalLists[index];
+			nativeLock(&list.lock);
+			block = list.blocks;
+			if (block != NULL) {
+				list.blocks = block->next;
+			}
+			nativeUnlock(&list.lock);
+			// Blocks of the right size from malloc() may join the lists later
+			return (block != NULL) ? block : malloc(classSize(index));
+		}
+
+		if (cache->blocks[index] == NULL) {
+			refill(cache, index);
+			if (cache->blocks[index] == NULL) {
+				return NULL;
+			}
+		}
+		block = cache->blocks[index];
+		cache->blocks[index] = block->next;
+		cache->counts[index]--;
+		return block;
+	}
+
+	void
+	deallocate(void *block, size_t size) throw() {
+		if (block == NULL) {
+			return;
+		} else if (size > MAX_BLOCK_SIZE) {
+			free(block);
+			return;
+		}
+
+		unsigned int index = classOf(size);
+		ThreadCache *cache = getCache();
+		FreeBlock *freed = (FreeBlock *) block;
+
+		if (cache == NULL) {
+			giveBack(index, freed, freed);
+			return;
+		}
+
+		freed->next = cache->blocks[index];
+		cache->blocks[index] = freed;
+		cache->counts[index]++;
+		if (cache->counts[index] > cacheLimit(index)) {
+			// Keep half, so that the next few frees don't come back here
+			unsigned int kept = cache->counts[index] / 2;
+			FreeBlock *last = freed;
+			for (unsigned int i = 1; i < kept; i++) {
+				last = last->next;
+			}
+			FreeBlock *first = last->next;
+			last->next = NULL;
+			cache->counts[index] = kept;
+
+			last = first;
+			while (last->next != NULL) {
+				last = last->next;
+			}
+			giveBack(index, first, last);
+		}
+	}
+
+	size_t
+	blockSize(size_t size) throw() {
+		if (size > MAX_BLOCK_SIZE) {
+			return size;
+		} else {
+			return classSize(classOf(size));
+		}
+	}
+
+	char *
+	duplicate(const char *str) throw() {
+		size_t size = strlen(str) + 1;
+		char *result = (char *) allocate(size);
+		if (result != NULL) {
+			memcpy(result, str, size);
+		}
+		return result;
+	}
+
+	void
+	release(char *str) throw() {
+		if (str != NULL) {
+			deallocate(str, strlen(str) + 1);
+		}
+	}
+
+}
+}
@@ -0,0 +1,99 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifndef _OSL_ALLOCATOR_H_
+#define _OSL_ALLOCATOR_H_
+
+#include <stddef.h>
+
+namespace OSL {
+namespace Memory {
+
+	/*
+	 * A slab allocator for small blocks, which are rounded up to one of a
+	 * few size classes: powers of two from MIN_BLOCK_SIZE to MAX_BLOCK_SIZE.
+	 * Each thread keeps the blocks it freed in a cache of its own, which it
+	 * allocates from without locking; only when its cache runs empty or
+	 * full does it take or give back a batch of blocks, from or to a
+	 * global list per size class. Threads which allocate in one place and
+	 * free in another, like a producer and a consumer, thus rarely meet on
+	 * a lock, as they do in malloc().
+	 *
+	 * Larger blocks are left to malloc(). Memory in the size classes is
+	 * not given back to the system, but kept for later allocations; a
+	 * thread's cache goes back to the global lists when it exits.
+	 *
+	 * All functions are thread-safe.
+	 */
+
+	/** The size of the smallest size class. */
+	const size_t MIN_BLOCK_SIZE = 16;
+	/** The size of the largest size class; larger blocks come from malloc(). */
+	const size_t MAX_BLOCK_SIZE = 4096;
+
+	/**
+	 * Allocate a block of memory, like malloc().
+	 *
+	 * @return A block of at least size bytes, aligned like malloc()'s,
+	 *         or NULL if out of memory.
+	 * @ingroup Memory
+	 */
+	void *allocate(size_t size) throw();
+
+	/**
+	 * Free a block returned by allocate().
+	 *
+	 * @param block  The block, or NULL.
+	 * @param size   The size that was passed to allocate().
+	 * @ingroup Memory
+	 */
+	void deallocate(void *block, size_t size) throw();
+
+	/**
+	 * Returns the number of bytes allocate() actually reserves for
+	 * a block of size bytes.
+	 *
+	 * @ingroup Memory
+	 */
+	size_t blockSize(size_t size) throw();
+
+	/**
+	 * Copy a string, like strdup(), into memory from allocate().
+	 *
+	 * @return The copy, which must be freed with release(), or NULL
+	 *         if out of memory.
+	 * @require str != NULL
+	 * @ingroup Memory
+	 */
+	char *duplicate(const char *str) throw();
+
+	/**
+	 * Free a string returned by duplicate(), whose length must not
+	 * have changed.
+	 *
+	 * @param str  The string, or NULL.
+	 * @ingroup Memory
+	 */
+	void release(char *str) throw();
+
+}
+}
+
+#endif /* _OSL_ALLOCATOR_H_ */
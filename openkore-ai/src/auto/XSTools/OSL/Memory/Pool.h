@@ -0,0 +1,119 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifndef _OSL_POOL_H_
+#define _OSL_POOL_H_
+
+#include <new>
+#include "Allocator.h"
+
+namespace OSL {
+namespace Memory {
+
+	/**
+	 * Objects of one type, whose memory comes from the size class
+	 * allocator instead of the heap. All the objects of a type share
+	 * its size class, so a Pool is only a typed way to get at it, and no
+	 * instance is needed:
+	 * @code
+	 * Foo *foo = Pool<Foo>::create(1, "bar");
+	 * ...
+	 * Pool<Foo>::destroy(foo);
+	 * @endcode
+	 *
+	 * An object must be destroyed through the Pool of its own type, not
+	 * through that of a base class, or with delete.
+	 *
+	 * @class Pool OSL/Memory/Pool.h
+	 * @ingroup Memory
+	 */
+	template <typename T>
+	class Pool {
+	public:
+		/**
+		 * Allocate and construct an object.
+		 *
+		 * @throws std::bad_alloc If out of memory.
+		 */
+		static T *
+		create() {
+			void *block = reserve();
+			try {
+				return new (block) T();
+			} catch (...) {
+				deallocate(block, sizeof(T));
+				throw;
+			}
+		}
+
+		/** @see create() */
+		template <typename A>
+		static T *
+		create(const A &a) {
+			void *block = reserve();
+			try {
+				return new (block) T(a);
+			} catch (...) {
+				deallocate(block, sizeof(T));
+				throw;
+			}
+		}
+
+		/** @see create() */
+		template <typename A, typename B>
+		static T *
+		create(const A &a, const B &b) {
+			void *block = reserve();
+			try {
+				return new (block) T(a, b);
+			} catch (...) {
+				deallocate(block, sizeof(T));
+				throw;
+			}
+		}
+
+		/**
+		 * Destruct an object returned by create(), and free its memory.
+		 *
+		 * @param object  The object, or NULL.
+		 */
+		static void
+		destroy(T *object) {
+			if (object != NULL) {
+				object->~T();
+				deallocate(object, sizeof(T));
+			}
+		}
+
+	private:
+		static void *
+		reserve() {
+			void *block = allocate(sizeof(T));
+			if (block == NULL) {
+				throw std::bad_alloc();
+			}
+			return block;
+		}
+	};
+
+}
+}
+
+#endif /* _OSL_POOL_H_ */
@@ -18,5 +18,6 @@
  *  MA  02110-1301  USA
  */
 
+#include "Reactor.h"
 #include "ServerSocket.h"
 #include "Socket.h"
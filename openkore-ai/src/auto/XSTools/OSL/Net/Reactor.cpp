@@ -0,0 +1,306 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifdef WIN32
+	// WSAPoll() is only declared for Windows Vista and later
+	#if !defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0600
+		#undef _WIN32_WINNT
+		#define _WIN32_WINNT 0x0600
+	#endif
+#endif
+
+#include <map>
+#include <vector>
+#include <stdio.h>
+#include <assert.h>
+#include "../IO/IOException.h"
+#include "Reactor.h"
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <winsock2.h>
+	#include "Win32/Socket.h"
+#else
+	#include "Unix/Socket.h"
+#endif
+
+namespace OSL {
+namespace _Intern {
+
+	/**
+	 * @internal
+	 * A socket registered with a Reactor.
+	 */
+	struct Registration {
+		Object *socket;
+		SocketHandle handle;
+		int events;
+		Reactor::Handler *handler;
+		/** Set by Reactor::remove(), until the current run() is done with it. */
+		bool removed;
+		/** The position of the socket in the backend's array, if it has one. */
+		unsigned int index;
+	};
+
+	/**
+	 * @internal
+	 * The events a backend found on one socket.
+	 */
+	struct ReadyEvent {
+		Registration *registration;
+		int events;
+	};
+
+	/**
+	 * @internal
+	 * An operating system's way of waiting for many sockets.
+	 *
+	 * Sockets without events are not waited for at all, so that their
+	 * errors aren't reported over and over.
+	 */
+	class ReactorBackend {
+	public:
+		virtual ~ReactorBackend() {}
+
+		/** @throws SocketException */
+		virtual void add(Registration *registration) = 0;
+		/** @throws SocketException */
+		virtual void modify(Registration *registration, int oldEvents) = 0;
+		virtual void remove(Registration *registration) = 0;
+
+		/**
+		 * Wait for events and append them to ready. Returns
+		 * early, possibly without events, when wakeup() is called.
+		 *
+		 * @throws IOException
+		 */
+		virtual void wait(int timeout, std::vector<ReadyEvent> &ready) = 0;
+
+		/** This method is thread-safe. */
+		virtual void wakeup() = 0;
+	};
+
+	/**
+	 * @internal
+	 * Create the best backend for this system.
+	 *
+	 * @throws SocketException
+	 */
+	static ReactorBackend *createReactorBackend();
+
+} // namespace _Intern
+} // namespace OSL
+
+#ifdef WIN32
+	#include "Win32/Reactor.cpp"
+#else
+	#include "Unix/Reactor.cpp"
+#endif
+
+namespace OSL {
+	using namespace _Intern;
+
+	namespace {
+		typedef std::map<SocketHandle, Registration *> RegistrationMap;
+
+		struct ReactorImpl {
+			ReactorBackend *backend;
+			RegistrationMap registrations;
+			// Removed during run(), freed once it's done
+			std::vector<Registration *> removed;
+			std::vector<ReadyEvent> ready;
+			bool running;
+		};
+
+		void
+		freeRemoved(ReactorImpl *impl) {
+			for (unsigned int i = 0; i < impl->removed.size(); i++) {
+				delete impl->removed[i];
+			}
+			impl->removed.clear();
+		}
+	}
+
+	#define IMPL ((ReactorImpl *) impl)
+
+	Reactor::Handler::~Handler() {
+	}
+
+	Reactor::Reactor() {
+		ReactorImpl *impl = new ReactorImpl();
+		try {
+			impl->backend = createReactorBackend();
+		} catch (...) {
+			delete impl;
+			throw;
+		}
+		impl->running = false;
+		this->impl = impl;
+	}
+
+	Reactor::~Reactor() {
+		RegistrationMap::iterator it;
+
+		assert(!IMPL->running);
+		for (it = IMPL->registrations.begin(); it != IMPL->registrations.end(); it++) {
+			IMPL->backend->remove(it->second);
+			it->second->socket->unref();
+			delete it->second;
+		}
+		freeRemoved(IMPL);
+		delete IMPL->backend;
+		delete IMPL;
+	}
+
+	void
+	Reactor::add(Socket *socket, int events, Handler *handler) {
+		assert(socket != NULL);
+		add(socket, socket->getHandle(), events, handler);
+	}
+
+	void
+	Reactor::add(ServerSocket *socket, int events, Handler *handler) {
+		assert(socket != NULL);
+		add(socket, socket->getHandle(), events, handler);
+	}
+
+	void
+	Reactor::add(Object *socket, SocketHandle handle, int events, Handler *handler) {
+		assert(handler != NULL);
+		assert(IMPL->registrations.find(handle) == IMPL->registrations.end());
+
+		Registration *registration = new Registration();
+		registration->socket = socket;
+		registration->handle = handle;
+		registration->events = events;
+		registration->handler = handler;
+		registration->removed = false;
+		registration->index = 0;
+		try {
+			IMPL->backend->add(registration);
+		} catch (...) {
+			delete registration;
+			throw;
+		}
+		IMPL->registrations[handle] = registration;
+		socket->ref();
+	}
+
+	void
+	Reactor::modify(Socket *socket, int events) {
+		assert(socket != NULL);
+		modify(socket->getHandle(), events);
+	}
+
+	void
+	Reactor::modify(ServerSocket *socket, int events) {
+		assert(socket != NULL);
+		modify(socket->getHandle(), events);
+	}
+
+	void
+	Reactor::modify(SocketHandle handle, int events) {
+		RegistrationMap::iterator it = IMPL->registrations.find(handle);
+		assert(it != IMPL->registrations.end());
+
+		Registration *registration = it->second;
+		int oldEvents = registration->events;
+		if (oldEvents != events) {
+			registration->events = events;
+			try {
+				IMPL->backend->modify(registration, oldEvents);
+			} catch (...) {
+				registration->events = oldEvents;
+				throw;
+			}
+		}
+	}
+
+	void
+	Reactor::remove(Socket *socket) {
+		assert(socket != NULL);
+		remove(socket->getHandle());
+	}
+
+	void
+	Reactor::remove(ServerSocket *socket) {
+		assert(socket != NULL);
+		remove(socket->getHandle());
+	}
+
+	void
+	Reactor::remove(SocketHandle handle) {
+		RegistrationMap::iterator it = IMPL->registrations.find(handle);
+		assert(it != IMPL->registrations.end());
+
+		Registration *registration = it->second;
+		IMPL->registrations.erase(it);
+		IMPL->backend->remove(registration);
+		registration->removed = true;
+		registration->socket->unref();
+		if (IMPL->running) {
+			IMPL->removed.push_back(registration);
+		} else {
+			delete registration;
+		}
+	}
+
+	unsigned int
+	Reactor::getCount() const {
+		return IMPL->registrations.size();
+	}
+
+	unsigned int
+	Reactor::run(int timeout) {
+		assert(timeout >= -1);
+		assert(!IMPL->running);
+
+		std::vector<ReadyEvent> &ready = IMPL->ready;
+		unsigned int called = 0;
+
+		ready.clear();
+		IMPL->backend->wait(timeout, ready);
+
+		IMPL->running = true;
+		try {
+			for (unsigned int i = 0; i < ready.size(); i++) {
+				Registration *registration = ready[i].registration;
+				// Skip sockets which an earlier handler removed or stopped waiting for
+				if (!registration->removed && registration->events != 0) {
+					registration->handler->handleEvents(this, ready[i].events);
+					called++;
+				}
+			}
+		} catch (...) {
+			IMPL->running = false;
+			freeRemoved(IMPL);
+			throw;
+		}
+		IMPL->running = false;
+		freeRemoved(IMPL);
+		return called;
+	}
+
+	void
+	Reactor::wakeup() {
+		IMPL->backend->wakeup();
+	}
+
+}
@@ -0,0 +1,194 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifndef _OSL_REACTOR_H_
+#define _OSL_REACTOR_H_
+
+#include "../Object.h"
+#include "Socket.h"
+#include "ServerSocket.h"
+
+namespace OSL {
+
+	/**
+	 * Waits for many non-blocking sockets at once, and calls the handlers of
+	 * those which are ready, so that one thread can serve a lot of clients.
+	 *
+	 * The reactor uses epoll on Linux, kqueue on BSD and Mac OS X, WSAPoll
+	 * on Windows and poll() on other systems. Readiness is level-triggered:
+	 * a handler is called again by every run() for as long as its socket
+	 * stays ready, so it doesn't have to read everything at once.
+	 *
+	 * A socket stays referenced by the reactor while it is registered.
+	 * Only wakeup() may be called by other threads; the other methods must be
+	 * called by the thread which calls run(), handlers included. Handlers may
+	 * add, modify and remove any socket, their own as well.
+	 *
+	 * Example:
+	 * @code
+	 * class Client: public Reactor::Handler {
+	 * public:
+	 *     Socket *socket;
+	 *
+	 *     virtual void handleEvents(Reactor *reactor, int events) {
+	 *         char buffer[1024];
+	 *         int size = socket->getInputStream()->read(buffer, sizeof(buffer));
+	 *         if (size == -1) {
+	 *             reactor->remove(socket);
+	 *             socket->unref();
+	 *             delete this;
+	 *         } else if (size > 0) {
+	 *             ...
+	 *         }
+	 *     }
+	 * };
+	 *
+	 * Reactor *reactor = new Reactor();
+	 * client->socket->setBlocking(false);
+	 * reactor->add(client->socket, Reactor::READABLE, client);
+	 * while (true) {
+	 *     reactor->run();
+	 * }
+	 * @endcode
+	 *
+	 * @class Reactor OSL/Net/Reactor.h
+	 * @ingroup Net
+	 */
+	class Reactor: public Object {
+	public:
+		/** The events a socket may be waited for. */
+		enum Event {
+			/**
+			 * Data can be read, or a server socket can accept a client.
+			 * Errors and closed connections are reported as READABLE,
+			 * so that the next read() throws or returns -1.
+			 */
+			READABLE = 1,
+			/** Data can be written. */
+			WRITABLE = 2
+		};
+
+		/**
+		 * Called by a Reactor when a socket is ready.
+		 *
+		 * @class Handler OSL/Net/Reactor.h
+		 * @ingroup Net
+		 */
+		class Handler {
+		public:
+			virtual ~Handler();
+
+			/**
+			 * Handle a ready socket.
+			 *
+			 * @param reactor The reactor which calls this handler.
+			 * @param events  The events which happened, a combination
+			 *                of Reactor::Event values.
+			 */
+			virtual void handleEvents(Reactor *reactor, int events) = 0;
+		};
+
+		/**
+		 * Create a new reactor without any sockets.
+		 *
+		 * @pre Socket::init() must have been called once.
+		 * @throws SocketException
+		 */
+		Reactor();
+		virtual ~Reactor();
+
+		/**
+		 * Start waiting for events on a socket, which should be in
+		 * non-blocking mode.
+		 *
+		 * @param socket  The socket, which is not registered yet.
+		 * @param events  The events to wait for, a combination of
+		 *                Reactor::Event values, or 0 for none yet.
+		 * @param handler The handler to call when the socket is ready.
+		 *                It is not freed by the reactor.
+		 * @pre socket != NULL && handler != NULL
+		 * @throws SocketException
+		 */
+		void add(Socket *socket, int events, Handler *handler);
+		void add(ServerSocket *socket, int events, Handler *handler);
+
+		/**
+		 * Change the events a registered socket is waited for, for
+		 * example to wait until it is WRITABLE while there is data
+		 * left to send.
+		 *
+		 * @pre socket is registered.
+		 * @throws SocketException
+		 */
+		void modify(Socket *socket, int events);
+		void modify(ServerSocket *socket, int events);
+
+		/**
+		 * Stop waiting for events on a socket, and unreference it. Its
+		 * handler won't be called anymore, even if the socket had other
+		 * events waiting to be handled in the current run().
+		 *
+		 * A socket must be removed before it is closed.
+		 *
+		 * @pre socket is registered.
+		 */
+		void remove(Socket *socket);
+		void remove(ServerSocket *socket);
+
+		/**
+		 * Returns the number of registered sockets.
+		 */
+		unsigned int getCount() const;
+
+		/**
+		 * Wait until some sockets are ready, and call their handlers.
+		 *
+		 * @param timeout The maximum time (in miliseconds) to wait, or
+		 *                -1 to wait until a socket is ready or until
+		 *                wakeup() is called.
+		 * @return The number of handlers called.
+		 * @throws IOException Waiting failed. Exceptions thrown by
+		 *                     handlers are passed on as well.
+		 */
+		unsigned int run(int timeout = -1);
+
+		/**
+		 * Make the current or next run() return, even if no socket is
+		 * ready. This lets other threads hand work to the thread which
+		 * runs the reactor.
+		 *
+		 * This method is thread-safe.
+		 */
+		void wakeup();
+
+	private:
+		void *impl;
+
+		void add(Object *socket, SocketHandle handle, int events, Handler *handler);
+		void modify(SocketHandle handle, int events);
+		void remove(SocketHandle handle);
+
+		Reactor(const Reactor &);
+		Reactor &operator=(const Reactor &);
+	};
+
+}
+
+#endif /* _OSL_REACTOR_H_ */
@@ -52,6 +52,10 @@ namespace OSL {
 		 *
 		 * @param timeout The maximum time (in miliseconds) to wait for a client
 		 *                before this function returns. Specify -1 to wait forever.
+		 * In non-blocking mode, the timeout is ignored and NULL is
+		 * returned right away when no client is waiting. Accepted
+		 * sockets are always in blocking mode.
+		 *
 		 * @return A new client Socket, or NULL on time out.
 		 * @post timeout >= -1
 		 * @post !isClosed()
@@ -78,6 +82,23 @@ namespace OSL {
 		 * Check whether the server socket is closed.
 		 */
 		virtual bool isClosed() = 0;
+
+		/**
+		 * Switch this server socket between blocking and non-blocking
+		 * mode. Server sockets start in blocking mode.
+		 *
+		 * @pre !isClosed()
+		 * @throws SocketException
+		 * @see accept()
+		 */
+		virtual void setBlocking(bool blocking) = 0;
+
+		/**
+		 * Returns the operating system's handle of this server socket.
+		 *
+		 * @pre !isClosed()
+		 */
+		virtual SocketHandle getHandle() const = 0;
 	};
 
 }
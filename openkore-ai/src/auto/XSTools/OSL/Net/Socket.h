@@ -24,9 +24,22 @@
 #include "../Exception.h"
 #include "../IO/InputStream.h"
 #include "../IO/OutputStream.h"
+#include <stddef.h>
 
 namespace OSL {
 
+	/**
+	 * The operating system's handle of a socket: a file descriptor on
+	 * Unix, a SOCKET on Windows.
+	 *
+	 * @ingroup Net
+	 */
+	#ifdef WIN32
+		typedef size_t SocketHandle;
+	#else
+		typedef int SocketHandle;
+	#endif
+
 	/**
 	 * Thrown when a socket exception occurs.
 	 *
@@ -88,7 +101,8 @@ namespace OSL {
 		 *
 		 * @note
 		 *    When read() returns -1, it means that the peer
-		 *    has closed the connection. read() will never return 0.
+		 *    has closed the connection. read() only returns 0 in
+		 *    non-blocking mode, when no data has arrived yet.
 		 *
 		 * @note
 		 *    This stream is thread-safe.
@@ -111,6 +125,26 @@ namespace OSL {
 		 * @post result != NULL
 		 */
 		virtual OutputStream *getOutputStream() const = 0;
+
+		/**
+		 * Switch this socket between blocking and non-blocking mode.
+		 * Sockets start in blocking mode.
+		 *
+		 * In non-blocking mode, the input stream's read() returns 0
+		 * instead of waiting for data, and the output stream's write()
+		 * and writev() return 0 when the send buffer is full. A Reactor
+		 * tells when it's worth to try again. Don't wrap a
+		 * BufferedOutputStream around a non-blocking socket: it keeps
+		 * retrying until everything is sent.
+		 *
+		 * @throws SocketException
+		 */
+		virtual void setBlocking(bool blocking) = 0;
+
+		/**
+		 * Returns the operating system's handle of this socket.
+		 */
+		virtual SocketHandle getHandle() const = 0;
 	};
 
 }
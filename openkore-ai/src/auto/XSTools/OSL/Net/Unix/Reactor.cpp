@@ -0,0 +1,492 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+// Do not compile this file independently, it's supposed to be automatically
+// included by another source file.
+
+#include <sys/poll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+// Define OSL_REACTOR_POLL to use poll() even if something better is available
+#if defined(OSL_REACTOR_POLL)
+#elif defined(__linux__)
+	#include <sys/epoll.h>
+	#define OSL_REACTOR_EPOLL
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__) \
+   || defined(__NetBSD__) || defined(__DragonFly__)
+	#include <sys/types.h>
+	#include <sys/event.h>
+	#include <sys/time.h>
+	#define OSL_REACTOR_KQUEUE
+#else
+	#define OSL_REACTOR_POLL
+#endif
+
+namespace OSL {
+namespace _Intern {
+
+	static void
+	throwSocketError(const char *what) {
+		char message[200];
+		int error = errno;
+		snprintf(message, sizeof(message), "%s: %s", what, strerror(error));
+		throw SocketException(message, error);
+	}
+
+	static void
+	setCloseOnExec(int fd) {
+		fcntl(fd, F_SETFD, fcntl(fd, F_GETFD, 0) | FD_CLOEXEC);
+	}
+
+	/**
+	 * @internal
+	 * A pipe which the backends wait for along with the sockets,
+	 * so that wakeup() can interrupt them.
+	 */
+	class WakeupPipe {
+	private:
+		int fds[2];
+	public:
+		WakeupPipe() {
+			if (pipe(fds) == -1) {
+				throwSocketError("Cannot create a pipe");
+			}
+			try {
+				UnixSocket::setBlocking(fds[0], false);
+				UnixSocket::setBlocking(fds[1], false);
+			} catch (...) {
+				::close(fds[0]);
+				::close(fds[1]);
+				throw;
+			}
+			setCloseOnExec(fds[0]);
+			setCloseOnExec(fds[1]);
+		}
+
+		~WakeupPipe() {
+			::close(fds[0]);
+			::close(fds[1]);
+		}
+
+		int
+		getReadHandle() const {
+			return fds[0];
+		}
+
+		void
+		signal() {
+			char c = 0;
+			ssize_t result;
+
+			// When the pipe is full, the reactor wakes up anyway
+			do {
+				result = ::write(fds[1], &c, 1);
+			} while (result == -1 && errno == EINTR);
+		}
+
+		void
+		drain() {
+			char buffer[64];
+			while (::read(fds[0], buffer, sizeof(buffer)) > 0);
+		}
+	};
+
+#ifdef OSL_REACTOR_EPOLL
+	/**
+	 * @internal
+	 * A reactor backend which uses Linux's epoll.
+	 */
+	class EpollBackend: public ReactorBackend {
+	private:
+		WakeupPipe wakeupPipe;
+		int fd;
+		std::vector<struct epoll_event> events;
+
+		void
+		control(int operation, Registration *registration) {
+			struct epoll_event event;
+
+			memset(&event, 0, sizeof(event));
+			if (registration->events & Reactor::READABLE) {
+				event.events |= EPOLLIN;
+			}
+			if (registration->events & Reactor::WRITABLE) {
+				event.events |= EPOLLOUT;
+			}
+			event.data.ptr = registration;
+			if (epoll_ctl(fd, operation, registration->handle, &event) == -1) {
+				throwSocketError("Cannot wait for socket");
+			}
+		}
+
+	public:
+		EpollBackend()
+			: events(64)
+		{
+			struct epoll_event event;
+
+			fd = epoll_create(64);
+			if (fd == -1) {
+				throwSocketError("Cannot create epoll descriptor");
+			}
+			setCloseOnExec(fd);
+
+			memset(&event, 0, sizeof(event));
+			event.events = EPOLLIN;
+			event.data.ptr = NULL;
+			if (epoll_ctl(fd, EPOLL_CTL_ADD, wakeupPipe.getReadHandle(), &event) == -1) {
+				int error = errno;
+				::close(fd);
+				errno = error;
+				throwSocketError("Cannot wait for pipe");
+			}
+		}
+
+		~EpollBackend() {
+			::close(fd);
+		}
+
+		virtual void
+		add(Registration *registration) {
+			if (registration->events != 0) {
+				control(EPOLL_CTL_ADD, registration);
+			}
+		}
+
+		virtual void
+		modify(Registration *registration, int oldEvents) {
+			if (oldEvents == 0) {
+				control(EPOLL_CTL_ADD, registration);
+			} else if (registration->events == 0) {
+				control(EPOLL_CTL_DEL, registration);
+			} else {
+				control(EPOLL_CTL_MOD, registration);
+			}
+		}
+
+		virtual void
+		remove(Registration *registration) {
+			if (registration->events != 0) {
+				// Older kernels want an event, even though it's not used
+				struct epoll_event event;
+				memset(&event, 0, sizeof(event));
+				epoll_ctl(fd, EPOLL_CTL_DEL, registration->handle, &event);
+			}
+		}
+
+		virtual void
+		wait(int timeout, std::vector<ReadyEvent> &ready) {
+			int count = epoll_wait(fd, &events[0], events.size(), timeout);
+			if (count == -1) {
+				if (errno == EINTR) {
+					return;
+				}
+				throw IOException(strerror(errno), errno);
+			}
+
+			for (int i = 0; i < count; i++) {
+				Registration *registration = (Registration *) events[i].data.ptr;
+				unsigned int flags = events[i].events;
+				ReadyEvent event;
+
+				if (registration == NULL) {
+					wakeupPipe.drain();
+					continue;
+				}
+				event.registration = registration;
+				event.events = 0;
+				if (flags & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+					event.events |= Reactor::READABLE;
+				}
+				if ((flags & EPOLLOUT)
+				 || ((flags & (EPOLLERR | EPOLLHUP)) && (registration->events & Reactor::WRITABLE))) {
+					event.events |= Reactor::WRITABLE;
+				}
+				ready.push_back(event);
+			}
+
+			// Many sockets are busy; fetch more of them at once next time
+			if ((unsigned int) count == events.size() && events.size() < 4096) {
+				events.resize(events.size() * 2);
+			}
+		}
+
+		virtual void
+		wakeup() {
+			wakeupPipe.signal();
+		}
+	};
+#endif /* OSL_REACTOR_EPOLL */
+
+#ifdef OSL_REACTOR_KQUEUE
+	#ifdef __NetBSD__
+		#define KQUEUE_UDATA(pointer) ((intptr_t) (pointer))
+	#else
+		#define KQUEUE_UDATA(pointer) ((void *) (pointer))
+	#endif
+
+	/**
+	 * @internal
+	 * A reactor backend which uses BSD's kqueue.
+	 */
+	class KqueueBackend: public ReactorBackend {
+	private:
+		WakeupPipe wakeupPipe;
+		int fd;
+		std::vector<struct kevent> events;
+
+		bool
+		change(Registration *registration, int oldEvents, int newEvents) {
+			struct kevent changes[2];
+			int count = 0;
+
+			if ((oldEvents ^ newEvents) & Reactor::READABLE) {
+				EV_SET(&changes[count], registration->handle, EVFILT_READ,
+					(newEvents & Reactor::READABLE) ? EV_ADD : EV_DELETE,
+					0, 0, KQUEUE_UDATA(registration));
+				count++;
+			}
+			if ((oldEvents ^ newEvents) & Reactor::WRITABLE) {
+				EV_SET(&changes[count], registration->handle, EVFILT_WRITE,
+					(newEvents & Reactor::WRITABLE) ? EV_ADD : EV_DELETE,
+					0, 0, KQUEUE_UDATA(registration));
+				count++;
+			}
+			return count == 0 || kevent(fd, changes, count, NULL, 0, NULL) != -1;
+		}
+
+	public:
+		KqueueBackend()
+			: events(64)
+		{
+			struct kevent change;
+
+			fd = kqueue();
+			if (fd == -1) {
+				throwSocketError("Cannot create kqueue");
+			}
+			setCloseOnExec(fd);
+
+			EV_SET(&change, wakeupPipe.getReadHandle(), EVFILT_READ, EV_ADD, 0, 0, KQUEUE_UDATA(NULL));
+			if (kevent(fd, &change, 1, NULL, 0, NULL) == -1) {
+				int error = errno;
+				::close(fd);
+				errno = error;
+				throwSocketError("Cannot wait for pipe");
+			}
+		}
+
+		~KqueueBackend() {
+			::close(fd);
+		}
+
+		virtual void
+		add(Registration *registration) {
+			if (!change(registration, 0, registration->events)) {
+				throwSocketError("Cannot wait for socket");
+			}
+		}
+
+		virtual void
+		modify(Registration *registration, int oldEvents) {
+			if (!change(registration, oldEvents, registration->events)) {
+				throwSocketError("Cannot wait for socket");
+			}
+		}
+
+		virtual void
+		remove(Registration *registration) {
+			change(registration, registration->events, 0);
+		}
+
+		virtual void
+		wait(int timeout, std::vector<ReadyEvent> &ready) {
+			struct timespec time, *timePointer = NULL;
+
+			if (timeout >= 0) {
+				time.tv_sec = timeout / 1000;
+				time.tv_nsec = (timeout % 1000) * 1000000;
+				timePointer = &time;
+			}
+			int count = kevent(fd, NULL, 0, &events[0], events.size(), timePointer);
+			if (count == -1) {
+				if (errno == EINTR) {
+					return;
+				}
+				throw IOException(strerror(errno), errno);
+			}
+
+			for (int i = 0; i < count; i++) {
+				Registration *registration = (Registration *) events[i].udata;
+				ReadyEvent event;
+
+				if (registration == NULL) {
+					wakeupPipe.drain();
+					continue;
+				}
+				event.registration = registration;
+				if (events[i].flags & (EV_ERROR | EV_EOF)) {
+					event.events = Reactor::READABLE | (registration->events & Reactor::WRITABLE);
+				} else if (events[i].filter == EVFILT_READ) {
+					event.events = Reactor::READABLE;
+				} else {
+					event.events = Reactor::WRITABLE;
+				}
+				ready.push_back(event);
+			}
+
+			if ((unsigned int) count == events.size() && events.size() < 4096) {
+				events.resize(events.size() * 2);
+			}
+		}
+
+		virtual void
+		wakeup() {
+			wakeupPipe.signal();
+		}
+	};
+#endif /* OSL_REACTOR_KQUEUE */
+
+#ifdef OSL_REACTOR_POLL
+	/**
+	 * @internal
+	 * A reactor backend which uses poll(), for systems without
+	 * anything better.
+	 */
+	class PollBackend: public ReactorBackend {
+	private:
+		WakeupPipe wakeupPipe;
+		std::vector<struct pollfd> fds;
+		// The registration of each element of fds
+		std::vector<Registration *> registrations;
+
+		void
+		update(Registration *registration) {
+			struct pollfd *item = &fds[registration->index];
+
+			// poll() ignores negative file descriptors
+			item->fd = (registration->events != 0) ? registration->handle : -1;
+			item->events = 0;
+			if (registration->events & Reactor::READABLE) {
+				item->events |= POLLIN;
+			}
+			if (registration->events & Reactor::WRITABLE) {
+				item->events |= POLLOUT;
+			}
+			item->revents = 0;
+		}
+
+	public:
+		PollBackend() {
+			struct pollfd item;
+
+			item.fd = wakeupPipe.getReadHandle();
+			item.events = POLLIN;
+			item.revents = 0;
+			fds.push_back(item);
+			registrations.push_back(NULL);
+		}
+
+		virtual void
+		add(Registration *registration) {
+			struct pollfd item;
+
+			memset(&item, 0, sizeof(item));
+			registration->index = fds.size();
+			fds.push_back(item);
+			registrations.push_back(registration);
+			update(registration);
+		}
+
+		virtual void
+		modify(Registration *registration, int oldEvents) {
+			update(registration);
+		}
+
+		virtual void
+		remove(Registration *registration) {
+			unsigned int index = registration->index;
+			unsigned int last = fds.size() - 1;
+
+			fds[index] = fds[last];
+			registrations[index] = registrations[last];
+			registrations[index]->index = index;
+			fds.pop_back();
+			registrations.pop_back();
+		}
+
+		virtual void
+		wait(int timeout, std::vector<ReadyEvent> &ready) {
+			int count = poll(&fds[0], fds.size(), timeout);
+			if (count == -1) {
+				if (errno == EINTR) {
+					return;
+				}
+				throw IOException(strerror(errno), errno);
+			}
+
+			for (unsigned int i = 0; i < fds.size() && count > 0; i++) {
+				short flags = fds[i].revents;
+				ReadyEvent event;
+
+				if (flags == 0) {
+					continue;
+				}
+				count--;
+				if (registrations[i] == NULL) {
+					wakeupPipe.drain();
+					continue;
+				}
+				event.registration = registrations[i];
+				event.events = 0;
+				if (flags & (POLLIN | POLLERR | POLLHUP | POLLNVAL)) {
+					event.events |= Reactor::READABLE;
+				}
+				if ((flags & POLLOUT)
+				 || ((flags & (POLLERR | POLLHUP | POLLNVAL)) && (registrations[i]->events & Reactor::WRITABLE))) {
+					event.events |= Reactor::WRITABLE;
+				}
+				ready.push_back(event);
+			}
+		}
+
+		virtual void
+		wakeup() {
+			wakeupPipe.signal();
+		}
+	};
+#endif /* OSL_REACTOR_POLL */
+
+	static ReactorBackend *
+	createReactorBackend() {
+		#if defined(OSL_REACTOR_EPOLL)
+			return new EpollBackend();
+		#elif defined(OSL_REACTOR_KQUEUE)
+			return new KqueueBackend();
+		#else
+			return new PollBackend();
+		#endif
+	}
+
+} // namespace _Intern
+} // namespace OSL
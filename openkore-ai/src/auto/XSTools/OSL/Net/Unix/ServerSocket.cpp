@@ -40,6 +40,7 @@ private:
 	 * @invariant port > 0
 	 */
 	unsigned short port;
+	bool blocking;
 
 public:
 	UnixServerSocket(const char *address, unsigned short port) {
@@ -47,6 +48,7 @@ public:
 		if (fd == -1) {
 			throw SocketException(strerror(errno), errno);
 		}
+		blocking = true;
 
 		int on = 1;
 		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
@@ -108,7 +110,7 @@ public:
 			throw IOException("Server socket is closed.");
 		}
 
-		if (timeout > -1) {
+		if (timeout > -1 && blocking) {
 			struct pollfd ufds;
 			int result;
 
@@ -132,9 +134,21 @@ public:
 		socklen_t len = sizeof(addr);
 		int clientfd = ::accept(fd, (struct sockaddr *) &addr, &len);
 		if (clientfd == -1) {
+			if (!blocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+				return NULL;
+			}
 			throw IOException(strerror(errno), errno);
 		}
 
+		if (!blocking) {
+			// BSD lets the client inherit O_NONBLOCK, Linux doesn't
+			try {
+				UnixSocket::setBlocking(clientfd, true);
+			} catch (...) {
+				::close(clientfd);
+				throw;
+			}
+		}
 		return new UnixSocket(clientfd);
 	}
 
@@ -152,4 +166,15 @@ public:
 	virtual bool isClosed() {
 		return fd == -1;
 	}
+
+	virtual void setBlocking(bool blocking) {
+		assert(fd != -1);
+		UnixSocket::setBlocking(fd, blocking);
+		this->blocking = blocking;
+	}
+
+	virtual SocketHandle getHandle() const {
+		assert(fd != -1);
+		return fd;
+	}
 };
@@ -21,9 +21,11 @@
 // Do not compile this file independently, it's supposed to be automatically
 // included by another source file.
 
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
 #include <assert.h>
@@ -35,6 +37,12 @@
 	#define MSG_NOSIGNAL_NOT_SUPPORTED
 #endif
 
+// The most parts OutStream::writev() sends at once
+#define MAX_IO_VECTORS 64
+
+// Whether a failed call only means that a non-blocking socket isn't ready
+#define WOULD_BLOCK(error) ((error) == EAGAIN || (error) == EWOULDBLOCK)
+
 namespace OSL {
 namespace _Intern {
 
@@ -63,12 +71,12 @@ namespace _Intern {
 		}
 
 		virtual bool
-		eof() const throw(IOException) {
+		eof() const {
 			return m_eof;
 		}
 
 		virtual int
-		read(char *buffer, unsigned int size) throw(IOException) {
+		read(char *buffer, unsigned int size) {
 			assert(buffer != NULL);
 			assert(size > 0);
 
@@ -78,6 +86,9 @@ namespace _Intern {
 
 			ssize_t result = recv(fd, buffer, size, 0);
 			if (result == -1) {
+				if (WOULD_BLOCK(errno)) {
+					return 0;
+				}
 				throw IOException(strerror(errno), errno);
 			} else if (result == 0) {
 				m_eof = true;
@@ -111,16 +122,48 @@ namespace _Intern {
 		}
 
 		virtual void
-		flush() throw(IOException) {
+		flush() {
 		}
 
 		virtual unsigned int
-		write(const char *data, unsigned int size) throw(IOException) {
+		write(const char *data, unsigned int size) {
 			assert(data != NULL);
 			assert(size > 0);
 
 			ssize_t result = send(fd, data, size, MSG_NOSIGNAL);
 			if (result == -1) {
+				if (WOULD_BLOCK(errno)) {
+					return 0;
+				}
+				throw IOException(strerror(errno), errno);
+			}
+			return result;
+		}
+
+		virtual unsigned int
+		writev(const IOVector *vectors, unsigned int count) {
+			struct iovec parts[MAX_IO_VECTORS];
+			struct msghdr message;
+
+			assert(vectors != NULL);
+
+			// The rest is written by the next call, like a partial send()
+			if (count > MAX_IO_VECTORS) {
+				count = MAX_IO_VECTORS;
+			}
+			for (unsigned int i = 0; i < count; i++) {
+				parts[i].iov_base = (void *) vectors[i].data;
+				parts[i].iov_len = vectors[i].size;
+			}
+			memset(&message, 0, sizeof(message));
+			message.msg_iov = parts;
+			message.msg_iovlen = count;
+
+			ssize_t result = sendmsg(fd, &message, MSG_NOSIGNAL);
+			if (result == -1) {
+				if (WOULD_BLOCK(errno)) {
+					return 0;
+				}
 				throw IOException(strerror(errno), errno);
 			}
 			return result;
@@ -200,6 +243,28 @@ namespace _Intern {
 		return out;
 	}
 
+	void
+	UnixSocket::setBlocking(bool blocking) {
+		setBlocking(fd, blocking);
+	}
+
+	SocketHandle
+	UnixSocket::getHandle() const {
+		return fd;
+	}
+
+	void
+	UnixSocket::setBlocking(int fd, bool blocking) {
+		int flags = fcntl(fd, F_GETFL, 0);
+		if (flags != -1) {
+			flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+			flags = fcntl(fd, F_SETFL, flags);
+		}
+		if (flags == -1) {
+			throw SocketException(strerror(errno), errno);
+		}
+	}
+
 } // namespace _Intern
 } // namespace OSL
 
@@ -69,6 +69,15 @@ namespace _Intern {
 		virtual ~UnixSocket();
 		virtual InputStream *getInputStream() const;
 		virtual OutputStream *getOutputStream() const;
+		virtual void setBlocking(bool blocking);
+		virtual SocketHandle getHandle() const;
+
+		/**
+		* Switch a file descriptor between blocking and non-blocking mode.
+		*
+		* @throws SocketException
+		*/
+		static void setBlocking(int fd, bool blocking);
 	};
 
 } // namespace _Intern
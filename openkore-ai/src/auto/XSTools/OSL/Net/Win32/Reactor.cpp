@@ -0,0 +1,213 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+// Do not compile this file independently, it's supposed to be automatically
+// included by another source file.
+
+#include <string.h>
+
+namespace OSL {
+namespace _Intern {
+
+	static void
+	throwSocketError(const char *what) {
+		char message[100];
+		int error = WSAGetLastError();
+		snprintf(message, sizeof(message), "%s. (error %d)", what, error);
+		throw SocketException(message, error);
+	}
+
+	/**
+	 * @internal
+	 * A UDP socket connected to itself, which the backend waits for along
+	 * with the other sockets, so that wakeup() can interrupt it. Windows
+	 * can't wait for pipes and sockets together.
+	 */
+	class WakeupSocket {
+	private:
+		SOCKET fd;
+	public:
+		WakeupSocket() {
+			struct sockaddr_in addr;
+			int len = sizeof(addr);
+
+			fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+			if (fd == INVALID_SOCKET) {
+				throwSocketError("Cannot create socket");
+			}
+			memset(&addr, 0, sizeof(addr));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			addr.sin_port = 0;
+			if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == SOCKET_ERROR
+			 || getsockname(fd, (struct sockaddr *) &addr, &len) == SOCKET_ERROR
+			 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == SOCKET_ERROR) {
+				int error = WSAGetLastError();
+				closesocket(fd);
+				WSASetLastError(error);
+				throwSocketError("Cannot set up wakeup socket");
+			}
+			try {
+				WinSocket::setBlocking(fd, false);
+			} catch (...) {
+				closesocket(fd);
+				throw;
+			}
+		}
+
+		~WakeupSocket() {
+			closesocket(fd);
+		}
+
+		SOCKET
+		getHandle() const {
+			return fd;
+		}
+
+		void
+		signal() {
+			char c = 0;
+			// When the socket's buffer is full, the reactor wakes up anyway
+			send(fd, &c, 1, 0);
+		}
+
+		void
+		drain() {
+			char buffer[64];
+			while (recv(fd, buffer, sizeof(buffer), 0) > 0);
+		}
+	};
+
+	/**
+	 * @internal
+	 * A reactor backend which uses WSAPoll().
+	 */
+	class WSAPollBackend: public ReactorBackend {
+	private:
+		WakeupSocket wakeupSocket;
+		std::vector<WSAPOLLFD> fds;
+		// The registration of each element of fds
+		std::vector<Registration *> registrations;
+
+		void
+		update(Registration *registration) {
+			WSAPOLLFD *item = &fds[registration->index];
+
+			// WSAPoll() ignores INVALID_SOCKET
+			item->fd = (registration->events != 0) ? (SOCKET) registration->handle : INVALID_SOCKET;
+			item->events = 0;
+			if (registration->events & Reactor::READABLE) {
+				item->events |= POLLRDNORM;
+			}
+			if (registration->events & Reactor::WRITABLE) {
+				item->events |= POLLWRNORM;
+			}
+			item->revents = 0;
+		}
+
+	public:
+		WSAPollBackend() {
+			WSAPOLLFD item;
+
+			item.fd = wakeupSocket.getHandle();
+			item.events = POLLRDNORM;
+			item.revents = 0;
+			fds.push_back(item);
+			registrations.push_back(NULL);
+		}
+
+		virtual void
+		add(Registration *registration) {
+			WSAPOLLFD item;
+
+			memset(&item, 0, sizeof(item));
+			registration->index = fds.size();
+			fds.push_back(item);
+			registrations.push_back(registration);
+			update(registration);
+		}
+
+		virtual void
+		modify(Registration *registration, int oldEvents) {
+			update(registration);
+		}
+
+		virtual void
+		remove(Registration *registration) {
+			unsigned int index = registration->index;
+			unsigned int last = fds.size() - 1;
+
+			fds[index] = fds[last];
+			registrations[index] = registrations[last];
+			registrations[index]->index = index;
+			fds.pop_back();
+			registrations.pop_back();
+		}
+
+		virtual void
+		wait(int timeout, std::vector<ReadyEvent> &ready) {
+			int count = WSAPoll(&fds[0], fds.size(), timeout);
+			if (count == SOCKET_ERROR) {
+				int error = WSAGetLastError();
+				char message[100];
+				snprintf(message, sizeof(message),
+					"Cannot poll sockets. (error %d)",
+					error);
+				throw IOException(message, error);
+			}
+
+			for (unsigned int i = 0; i < fds.size() && count > 0; i++) {
+				SHORT flags = fds[i].revents;
+				ReadyEvent event;
+
+				if (flags == 0) {
+					continue;
+				}
+				count--;
+				if (registrations[i] == NULL) {
+					wakeupSocket.drain();
+					continue;
+				}
+				event.registration = registrations[i];
+				event.events = 0;
+				if (flags & (POLLRDNORM | POLLERR | POLLHUP | POLLNVAL)) {
+					event.events |= Reactor::READABLE;
+				}
+				if ((flags & POLLWRNORM)
+				 || ((flags & (POLLERR | POLLHUP | POLLNVAL)) && (registrations[i]->events & Reactor::WRITABLE))) {
+					event.events |= Reactor::WRITABLE;
+				}
+				ready.push_back(event);
+			}
+		}
+
+		virtual void
+		wakeup() {
+			wakeupSocket.signal();
+		}
+	};
+
+	static ReactorBackend *
+	createReactorBackend() {
+		return new WSAPollBackend();
+	}
+
+} // namespace _Intern
+} // namespace OSL
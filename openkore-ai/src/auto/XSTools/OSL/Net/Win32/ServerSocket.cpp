@@ -41,6 +41,7 @@ private:
 	 * @invariant port > 0
 	 */
 	unsigned short port;
+	bool blocking;
 
 public:
 	WinServerSocket(const char *address, unsigned short port) {
@@ -53,6 +54,7 @@ public:
 				error);
 			throw SocketException(message, error);
 		}
+		blocking = true;
 
 		struct sockaddr_in addr;
 		char *c_address = NULL;
@@ -112,7 +114,7 @@ public:
 			throw IOException("Server socket is closed.");
 		}
 
-		if (timeout > -1) {
+		if (timeout > -1 && blocking) {
 			fd_set readfds;
 			int result;
 			struct timeval tv;
@@ -140,6 +142,9 @@ public:
 		SOCKET clientfd = ::accept(fd, (struct sockaddr *) &addr, &len);
 		if (clientfd == INVALID_SOCKET) {
 			int error = WSAGetLastError();
+			if (!blocking && error == WSAEWOULDBLOCK) {
+				return NULL;
+			}
 			char message[100];
 			snprintf(message, sizeof(message),
 				"Cannot accept client socket. (error %d)",
@@ -147,6 +152,15 @@ public:
 			throw IOException(message, error);
 		}
 
+		if (!blocking) {
+			// Accepted sockets inherit the non-blocking mode
+			try {
+				WinSocket::setBlocking(clientfd, true);
+			} catch (...) {
+				closesocket(clientfd);
+				throw;
+			}
+		}
 		return new WinSocket(clientfd);
 	}
 
@@ -164,4 +178,15 @@ public:
 	virtual bool isClosed() {
 		return fd == INVALID_SOCKET;
 	}
+
+	virtual void setBlocking(bool blocking) {
+		assert(fd != INVALID_SOCKET);
+		WinSocket::setBlocking(fd, blocking);
+		this->blocking = blocking;
+	}
+
+	virtual SocketHandle getHandle() const {
+		assert(fd != INVALID_SOCKET);
+		return fd;
+	}
 };
@@ -23,6 +23,9 @@
 
 #include "Socket.h"
 
+// The most parts OutStream::writev() sends at once
+#define MAX_IO_VECTORS 64
+
 namespace OSL {
 namespace _Intern {
 
@@ -61,12 +64,12 @@ namespace _Intern {
 		}
 
 		virtual bool
-		eof() const throw(IOException) {
+		eof() const {
 			return m_eof;
 		}
 
 		virtual int
-		read(char *buffer, unsigned int size) throw(IOException) {
+		read(char *buffer, unsigned int size) {
 			assert(buffer != NULL);
 			assert(size > 0);
 
@@ -76,6 +79,9 @@ namespace _Intern {
 
 			ssize_t result = ::recv(fd, buffer, size, 0);
 			if (result == SOCKET_ERROR) {
+				if (WSAGetLastError() == WSAEWOULDBLOCK) {
+					return 0;
+				}
 				throw IOException("Unable to receive data.", WSAGetLastError());
 			} else if (result == 0) {
 				m_eof = true;
@@ -109,20 +115,47 @@ namespace _Intern {
 		}
 
 		virtual void
-		flush() throw(IOException) {
+		flush() {
 		}
 
 		virtual unsigned int
-		write(const char *data, unsigned int size) throw(IOException) {
+		write(const char *data, unsigned int size) {
 			assert(data != NULL);
 			assert(size > 0);
 
 			ssize_t result = ::send(fd, data, size, 0);
 			if (result == SOCKET_ERROR) {
+				if (WSAGetLastError() == WSAEWOULDBLOCK) {
+					return 0;
+				}
 				throw IOException("Unable to send data.", WSAGetLastError());
 			}
 			return result;
 		}
+
+		virtual unsigned int
+		writev(const IOVector *vectors, unsigned int count) {
+			WSABUF parts[MAX_IO_VECTORS];
+			DWORD sent = 0;
+
+			assert(vectors != NULL);
+
+			// The rest is written by the next call, like a partial send()
+			if (count > MAX_IO_VECTORS) {
+				count = MAX_IO_VECTORS;
+			}
+			for (unsigned int i = 0; i < count; i++) {
+				parts[i].buf = (char *) vectors[i].data;
+				parts[i].len = vectors[i].size;
+			}
+			if (WSASend(fd, parts, count, &sent, 0, NULL, NULL) == SOCKET_ERROR) {
+				if (WSAGetLastError() == WSAEWOULDBLOCK) {
+					return 0;
+				}
+				throw IOException("Unable to send data.", WSAGetLastError());
+			}
+			return sent;
+		}
 	};
 
 
@@ -194,5 +227,28 @@ namespace _Intern {
 		return out;
 	}
 
+	void
+	WinSocket::setBlocking(bool blocking) {
+		setBlocking(fd, blocking);
+	}
+
+	SocketHandle
+	WinSocket::getHandle() const {
+		return fd;
+	}
+
+	void
+	WinSocket::setBlocking(SOCKET fd, bool blocking) {
+		u_long nonBlocking = blocking ? 0 : 1;
+		if (ioctlsocket(fd, FIONBIO, &nonBlocking) == SOCKET_ERROR) {
+			int error = WSAGetLastError();
+			char message[100];
+			snprintf(message, sizeof(message),
+				"Cannot change the socket's blocking mode. (error %d)",
+				error);
+			throw SocketException(message, error);
+		}
+	}
+
 } // namespace _Intern
 } // namespace OSL
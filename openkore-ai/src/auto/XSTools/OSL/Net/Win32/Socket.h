@@ -67,6 +67,15 @@ namespace _Intern {
 		virtual ~WinSocket();
 		virtual InputStream *getInputStream() const;
 		virtual OutputStream *getOutputStream() const;
+		virtual void setBlocking(bool blocking);
+		virtual SocketHandle getHandle() const;
+
+		/**
+		* Switch a SOCKET between blocking and non-blocking mode.
+		*
+		* @throws SocketException
+		*/
+		static void setBlocking(SOCKET fd, bool blocking);
 	};
 
 } // namespace _Intern
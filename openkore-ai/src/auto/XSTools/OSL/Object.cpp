@@ -18,8 +18,10 @@
  *  MA  02110-1301  USA
  */
 
+#include <new>
 #include "Object.h"
 #include "Threading/Atomic.h"
+#include "Memory/Allocator.h"
 
 namespace OSL {
 
@@ -28,9 +30,33 @@ namespace OSL {
 		m_isStackObject = false;
 	}
 
+	Object::Object(const Object &other) throw() {
+		refcount = 1;
+		m_isStackObject = other.m_isStackObject;
+	}
+
 	Object::~Object() {
 	}
 
+	void *
+	Object::operator new(size_t size) {
+		void *object = Memory::allocate(size);
+		if (object == NULL) {
+			throw std::bad_alloc();
+		}
+		return object;
+	}
+
+	void
+	Object::operator delete(void *object, size_t size) throw() {
+		Memory::deallocate(object, size);
+	}
+
+	Object &
+	Object::operator=(const Object &) throw() {
+		return *this;
+	}
+
 	void
 	Object::ref() throw() {
 		Atomic::increment(refcount);
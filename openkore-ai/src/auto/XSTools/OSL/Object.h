@@ -21,6 +21,9 @@
 #ifndef _OSL_OBJECT_H_
 #define _OSL_OBJECT_H_
 
+#include <stddef.h>
+#include "Threading/Atomic.h"
+
 namespace OSL {
 
 	/**
@@ -78,7 +81,7 @@ namespace OSL {
 	 */
 	class Object {
 	private:
-		int refcount;
+		Atomic::Integer refcount;
 		bool m_isStackObject;
 	public:
 		/**
@@ -86,8 +89,31 @@ namespace OSL {
 		 */
 		Object() throw();
 
+		/**
+		 * Construct a copy of an Object. The copy is a new object,
+		 * with a reference count of 1.
+		 */
+		Object(const Object &other) throw();
+
 		virtual ~Object();
 
+		/**
+		 * Objects are allocated by the size class allocator, so that
+		 * threads which create and free many small ones don't wait
+		 * for each other in malloc().
+		 *
+		 * @throws std::bad_alloc If out of memory.
+		 * @see Memory::allocate()
+		 */
+		static void *operator new(size_t size);
+		static void operator delete(void *object, size_t size) throw();
+
+		/**
+		 * Assigning an Object leaves its reference count, and whether
+		 * it is a stack object, as they are.
+		 */
+		Object &operator=(const Object &other) throw();
+
 		/**
 		 * Increase the reference count by 1. You should call unref()
 		 * when you no longer need to reference to this object anymore.
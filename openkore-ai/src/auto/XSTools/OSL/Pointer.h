@@ -27,6 +27,10 @@
 #include "Exception.h"
 #include "Threading/Atomic.h"
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+	#define OSL_MOVE_SEMANTICS
+#endif
+
 namespace OSL {
 
 	/**
@@ -40,36 +44,213 @@ namespace OSL {
 		PointerException(const char *msg = NULL, int code = 0);
 	};
 
-	template <class T> class Pointer;
-
 	namespace _Intern {
+		/** Reference counts which several threads may change at once. */
+		struct AtomicCount {
+			typedef Atomic::Integer Integer;
+
+			static void increment(Integer &i) throw() { Atomic::increment(i); }
+			static bool decrement(Integer &i) throw() { return Atomic::decrement(i); }
+			static int load(const Integer &i) throw() { return Atomic::load(i); }
+		};
+
+		/** Reference counts which only one thread ever changes. */
+		struct LocalCount {
+			typedef int Integer;
+
+			static void increment(Integer &i) throw() { i++; }
+			static bool decrement(Integer &i) throw() { return --i == 0; }
+			static int load(const Integer &i) throw() { return i; }
+		};
+
 		/**
 		 * Class which contains metadata about a referee, such as
 		 * the reference count.
 		 */
-		template <class T>
+		template <class T, class Count>
 		class PointerSharedData {
-		private:
-			friend class Pointer<T>;
-
+		public:
 			/**
 			 * The reference count.
 			 * @invariant refcount >= 0
 			 */
-			int refcount;
+			typename Count::Integer refcount;
 
 			/** Whether referee is an OSL::Object */
 			bool isObject;
 
 			/** The referee. */
 			T *data;
-		public:
+
 			PointerSharedData() {
 				refcount = 1;
 				isObject = false;
 				data = NULL;
 			}
 		};
+
+		/**
+		 * What Pointer and LocalPointer have in common; Count is how
+		 * they count references.
+		 */
+		template <class T, class Count>
+		class PointerBase {
+		private:
+			typedef PointerSharedData<T, Count> SharedData;
+
+			static void
+			dereference(SharedData *shared) throw() {
+				if (shared != NULL && Count::decrement(shared->refcount)) {
+					if (shared->isObject) {
+						reinterpret_cast<Object *>(shared->data)->unref();
+					} else {
+						delete shared->data;
+					}
+					delete shared;
+				}
+			}
+
+		protected:
+			SharedData *shared;
+
+			PointerBase() throw() {
+				shared = NULL;
+			}
+
+			~PointerBase() throw() {
+				dereference(shared);
+			}
+
+			/**
+			 * Refer to data, which is an Object if isObject; addReference
+			 * tells whether to ref() it, or to take over a reference the
+			 * caller holds.
+			 */
+			void
+			createReference(T *data, bool isObject, bool addReference) throw() {
+				if (data != NULL) {
+					shared = new SharedData();
+					shared->isObject = isObject;
+					if (isObject && addReference) {
+						reinterpret_cast<Object *>(data)->ref();
+					}
+					shared->data = data;
+				} else {
+					shared = NULL;
+				}
+			}
+
+			void
+			createReference(const PointerBase &pointer) throw() {
+				shared = pointer.shared;
+				if (shared != NULL) {
+					Count::increment(shared->refcount);
+				}
+			}
+
+			void
+			assign(T *data) throw() {
+				if (shared == NULL || data != shared->data) {
+					SharedData *old = shared;
+					createReference(data, false, false);
+					dereference(old);
+				}
+			}
+
+			void
+			assign(const PointerBase &pointer) throw() {
+				if (pointer.shared != shared) {
+					// The old referee may own pointer, so it goes last
+					SharedData *old = shared;
+					createReference(pointer);
+					dereference(old);
+				}
+			}
+
+			/** Take over the reference of pointer, which becomes empty. */
+			void
+			take(PointerBase &pointer) throw() {
+				if (&pointer != this) {
+					SharedData *old = shared;
+					shared = pointer.shared;
+					pointer.shared = NULL;
+					dereference(old);
+				}
+			}
+
+			void
+			swapWith(PointerBase &pointer) throw() {
+				SharedData *other = pointer.shared;
+				pointer.shared = shared;
+				shared = other;
+			}
+
+		public:
+			/**
+			 * Empty this smart pointer without freeing its referee,
+			 * which the caller owns from now on.
+			 *
+			 * For a smart pointer to an Object, the caller gets a
+			 * reference to it, which it must unref() eventually; that
+			 * is the reference of this smart pointer if it was the last
+			 * one. Other referees are only released by the last smart
+			 * pointer to them.
+			 *
+			 * @return The referee, or NULL if this smart pointer is
+			 *         empty or shares a referee which isn't an Object,
+			 *         in which case it is left as it is.
+			 */
+			T *
+			release() throw() {
+				if (shared == NULL) {
+					return NULL;
+				}
+
+				T *data = shared->data;
+				if (Count::load(shared->refcount) == 1) {
+					delete shared;
+				} else if (shared->isObject) {
+					reinterpret_cast<Object *>(data)->ref();
+					dereference(shared);
+				} else {
+					return NULL;
+				}
+				shared = NULL;
+				return data;
+			}
+
+			T& operator*() {
+				if (shared != NULL && shared->data != NULL) {
+					return *shared->data;
+				} else {
+					throw PointerException("Cannot dereference a NULL Pointer.");
+				}
+			}
+
+			T* operator->() throw() {
+				if (shared != NULL) {
+					return shared->data;
+				} else {
+					return NULL;
+				}
+			}
+
+			operator T * () throw() {
+				if (shared != NULL) {
+					return shared->data;
+				} else {
+					return NULL;
+				}
+			}
+
+			operator T & () {
+				if (shared != NULL) {
+					return *shared->data;
+				} else {
+					throw PointerException("Cannot dereference a NULL Pointer.");
+				}
+			}
+		};
 	}
 
 	/**
@@ -173,6 +354,24 @@ namespace OSL {
 	 * examples and caveats.
 	 *
 	 *
+	 * @section moves Passing smart pointers around
+	 * Each copy of a smart pointer changes the reference count twice, once
+	 * when it is made and once when it is deleted; these are atomic
+	 * operations, which are slow when several processors use the count.
+	 * Smart pointers which are only handed on don't need them: with a C++11
+	 * compiler, a smart pointer can be moved, which leaves the original
+	 * empty, while swap() does the same with any compiler.
+	 * @code
+	 * Pointer<Foo> foo(new Foo());
+	 * queue.push_back(std::move(foo));  // foo is now empty
+	 * @endcode
+	 * release() gives up a referee without freeing it, and adopt() takes
+	 * over a reference to an Object.
+	 *
+	 * Use a LocalPointer instead for data which only one thread uses: its
+	 * reference count isn't atomic.
+	 *
+	 *
 	 * @anchor Pointer-Caveats
 	 * @section Caveats
 	 * Don't create two smart pointers to the same data. Newly instantiated
@@ -200,55 +399,21 @@ namespace OSL {
 	 *
 	 * @class Pointer OSL/Pointer.h
 	 * @ingroup Base
+	 * @see LocalPointer
 	 */
 	template <class T>
-	class Pointer {
+	class Pointer: public _Intern::PointerBase<T, _Intern::AtomicCount> {
 	private:
-		_Intern::PointerSharedData<T> *shared;
-
-		Pointer(T *data, bool isObject) throw() {
-			createReference(data, isObject);
-		}
-
-		void
-		dereferenceCurrent() throw() {
-			if (shared != NULL && Atomic::decrement(shared->refcount)) {
-				if (shared->isObject) {
-					reinterpret_cast<Object *>(shared->data)->unref();
-				} else {
-					delete shared->data;
-				}
-				delete shared;
-			}
-		}
-
-		void
-		createReference(T *data, bool isObject) throw() {
-			if (data != NULL) {
-				shared = new _Intern::PointerSharedData<T>();
-				shared->isObject = isObject;
-				if (isObject) {
-					reinterpret_cast<Object *>(data)->ref();
-				}
-				shared->data = data;
-			} else {
-				shared = NULL;
-			}
-		}
-
-		void
-		createReference(const Pointer<T> &pointer) throw() {
-			shared = pointer.shared;
-			Atomic::increment(shared->refcount);
+		Pointer(T *data, bool isObject, bool addReference) throw() {
+			this->createReference(data, isObject, addReference);
 		}
 
 	public:
 		Pointer() throw() {
-			createReference(NULL, false);
 		}
 
 		Pointer(T *data) throw() {
-			createReference(data, false);
+			this->createReference(data, false, false);
 		}
 
 		/**
@@ -310,65 +475,158 @@ namespace OSL {
 		 */
 		static Pointer<T>
 		createForObject(Object *data) throw() {
-			return Pointer<T>(static_cast<T *>(data), true);
+			return Pointer<T>(static_cast<T *>(data), true, true);
+		}
+
+		/**
+		 * Creates a smart pointer for the given Object like
+		 * createForObject(), which takes over a reference that the
+		 * caller holds instead of adding one. The Object is thus
+		 * deleted with the last smart pointer to it, unless it was
+		 * referenced again:
+		 * @code
+		 * Pointer<Foo> p = Pointer<Foo>::adopt(new Foo());
+		 * @endcode
+		 */
+		static Pointer<T>
+		adopt(Object *data) throw() {
+			return Pointer<T>(static_cast<T *>(data), true, false);
 		}
 
 		Pointer(const Pointer<T> &pointer) throw() {
-			createReference(pointer);
+			this->createReference(pointer);
 		}
 
+		#ifdef OSL_MOVE_SEMANTICS
+			/** Take over the referee of pointer, which becomes empty. */
+			Pointer(Pointer<T> &&pointer) throw() {
+				this->take(pointer);
+			}
+		#endif
+
 		virtual ~Pointer() throw() {
-			dereferenceCurrent();
 		}
 
 		Pointer<T> &
 		operator=(T *data) throw() {
-			if (shared == NULL || data != shared->data) {
-				dereferenceCurrent();
-				createReference(data, false);
-			}
+			this->assign(data);
 			return *this;
 		}
 
 		Pointer<T> &
 		operator=(const Pointer<T> &pointer) throw() {
-			if (shared == NULL || pointer.shared->data != shared->data) {
-				dereferenceCurrent();
-				createReference(pointer);
-			}
+			this->assign(pointer);
 			return *this;
 		}
 
-		T& operator*() throw(PointerException) {
-			if (shared != NULL && shared->data != NULL) {
-				return *shared->data;
-			} else {
-				throw PointerException("Cannot dereference a NULL Pointer.");
+		#ifdef OSL_MOVE_SEMANTICS
+			/** Take over the referee of pointer, which becomes empty. */
+			Pointer<T> &
+			operator=(Pointer<T> &&pointer) throw() {
+				this->take(pointer);
+				return *this;
 			}
+		#endif
+
+		/**
+		 * Exchange referees with another smart pointer, without
+		 * changing any reference count.
+		 */
+		void
+		swap(Pointer<T> &pointer) throw() {
+			this->swapWith(pointer);
 		}
+	};
 
-		T* operator->() throw() {
-			if (shared != NULL) {
-				return shared->data;
-			} else {
-				return NULL;
-			}
+	/**
+	 * A smart pointer like Pointer, for data which only one thread uses.
+	 * Its reference count isn't atomic, so copying it is as cheap as
+	 * changing an int; copies of it may not be used by different threads
+	 * at all, not even one at a time without a lock between them. The
+	 * reference counts of Objects it refers to remain atomic.
+	 *
+	 * @class LocalPointer OSL/Pointer.h
+	 * @ingroup Base
+	 * @see Pointer
+	 */
+	template <class T>
+	class LocalPointer: public _Intern::PointerBase<T, _Intern::LocalCount> {
+	private:
+		LocalPointer(T *data, bool isObject, bool addReference) throw() {
+			this->createReference(data, isObject, addReference);
+		}
+
+	public:
+		LocalPointer() throw() {
+		}
+
+		LocalPointer(T *data) throw() {
+			this->createReference(data, false, false);
+		}
+
+		/** @see Pointer::createForObject() */
+		static LocalPointer<T>
+		createForObject(Object *data) throw() {
+			return LocalPointer<T>(static_cast<T *>(data), true, true);
+		}
+
+		/**
+		 * Creates a smart pointer for the given Object like
+		 * createForObject(), which takes over a reference that the
+		 * caller holds instead of adding one. The Object is thus
+		 * deleted with the last smart pointer to it, unless it was
+		 * referenced again:
+		 * @code
+		 * LocalPointer<Foo> p = LocalPointer<Foo>::adopt(new Foo());
+		 * @endcode
+		 */
+		static LocalPointer<T>
+		adopt(Object *data) throw() {
+			return LocalPointer<T>(static_cast<T *>(data), true, false);
 		}
 
-		operator T * () throw() {
-			if (shared != NULL) {
-				return shared->data;
-			} else {
-				return NULL;
+		LocalPointer(const LocalPointer<T> &pointer) throw() {
+			this->createReference(pointer);
+		}
+
+		#ifdef OSL_MOVE_SEMANTICS
+			/** Take over the referee of pointer, which becomes empty. */
+			LocalPointer(LocalPointer<T> &&pointer) throw() {
+				this->take(pointer);
 			}
+		#endif
+
+		virtual ~LocalPointer() throw() {
+		}
+
+		LocalPointer<T> &
+		operator=(T *data) throw() {
+			this->assign(data);
+			return *this;
+		}
+
+		LocalPointer<T> &
+		operator=(const LocalPointer<T> &pointer) throw() {
+			this->assign(pointer);
+			return *this;
 		}
 
-		operator T & () throw(PointerException) {
-			if (shared != NULL) {
-				return *shared->data;
-			} else {
-				throw PointerException("Cannot dereference a NULL Pointer.");
+		#ifdef OSL_MOVE_SEMANTICS
+			/** Take over the referee of pointer, which becomes empty. */
+			LocalPointer<T> &
+			operator=(LocalPointer<T> &&pointer) throw() {
+				this->take(pointer);
+				return *this;
 			}
+		#endif
+
+		/**
+		 * Exchange referees with another smart pointer, without
+		 * changing any reference count.
+		 */
+		void
+		swap(LocalPointer<T> &pointer) throw() {
+			this->swapWith(pointer);
 		}
 	};
 
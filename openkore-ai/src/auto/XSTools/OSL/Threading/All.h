@@ -19,7 +19,10 @@
  */
 
 #include "Atomic.h"
+#include "Executor.h"
 #include "Mutex.h"
+#include "MpscQueue.h"
 #include "MutexLocker.h"
 #include "Runnable.h"
+#include "SpscQueue.h"
 #include "Thread.h"
@@ -26,7 +26,12 @@
 	#define WIN32_X86
 #endif
 
-#if !defined(GCC_X86_32_OR_64) && !defined(WIN32_X86)
+#if defined(WIN32)
+	#include <windows.h>
+#endif
+
+#if (!defined(GCC_X86_32_OR_64) && !defined(WIN32_X86)) \
+ || (!defined(OSL_STD_ATOMIC) && !defined(__GNUC__) && !defined(WIN32))
 	#include "Mutex.h"
 	static OSL::Mutex lock;
 #endif
@@ -42,7 +47,7 @@ namespace OSL {
 				: "=m" (i)
 				: "ir" (1), "m" (i));
 		#elif defined(WIN32_X86)
-			InterlockedExchangeAdd(i, 1);
+			InterlockedExchangeAdd((volatile LONG *) &i, 1);
 		#else
 			lock.lock();
 			i++;
@@ -61,7 +66,7 @@ namespace OSL {
 				: "0" (-1), "m" (i));
 			return result == 1;
 		#elif defined(WIN32_X86)
-			return InterlockedExchangeAdd(i, -1) == 1;
+			return InterlockedExchangeAdd((volatile LONG *) &i, -1) == 1;
 		#else
 			bool result;
 			lock.lock();
@@ -72,4 +77,78 @@ namespace OSL {
 		#endif
 	}
 
+#ifndef OSL_STD_ATOMIC
+	/* Without std::atomic, these are full barriers */
+
+	int
+	Atomic::fetchAndAdd(Integer &i, int n) throw() {
+		#if defined(__GNUC__)
+			return __sync_fetch_and_add(&i, n);
+		#elif defined(WIN32)
+			return InterlockedExchangeAdd((volatile LONG *) &i, n);
+		#else
+			int result;
+			lock.lock();
+			result = i;
+			i += n;
+			lock.unlock();
+			return result;
+		#endif
+	}
+
+	bool
+	Atomic::compareAndSwap(Integer &i, int &expected, int desired) throw() {
+		int old;
+		#if defined(__GNUC__)
+			old = __sync_val_compare_and_swap(&i, expected, desired);
+		#elif defined(WIN32)
+			old = InterlockedCompareExchange((volatile LONG *) &i, desired, expected);
+		#else
+			lock.lock();
+			old = i;
+			if (old == expected) {
+				i = desired;
+			}
+			lock.unlock();
+		#endif
+		if (old == expected) {
+			return true;
+		} else {
+			expected = old;
+			return false;
+		}
+	}
+
+	int
+	Atomic::load(const Integer &i) throw() {
+		#if defined(__GNUC__)
+			int result = i;
+			__sync_synchronize();
+			return result;
+		#elif defined(WIN32)
+			return InterlockedCompareExchange((volatile LONG *) &i, 0, 0);
+		#else
+			int result;
+			lock.lock();
+			result = i;
+			lock.unlock();
+			return result;
+		#endif
+	}
+
+	void
+	Atomic::store(Integer &i, int value) throw() {
+		#if defined(__GNUC__)
+			__sync_synchronize();
+			i = value;
+		#elif defined(WIN32)
+			InterlockedExchange((volatile LONG *) &i, value);
+		#else
+			lock.lock();
+			i = value;
+			lock.unlock();
+		#endif
+	}
+#endif
+
 }
@@ -21,6 +21,11 @@
 #ifndef _OSL_ATOMIC_H_
 #define _OSL_ATOMIC_H_
 
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700)
+	#define OSL_STD_ATOMIC
+	#include <atomic>
+#endif
+
 namespace OSL {
 
 	/**
@@ -31,6 +36,11 @@ namespace OSL {
 	 * fallback implementations on other platforms. Using these functions can
 	 * sometimes avoid the use of relatively expensive mutexes.
 	 *
+	 * With a C++11 compiler, the functions which take an Atomic::Integer
+	 * are inlined <code>std::atomic</code> operations, with only the
+	 * ordering that they document; otherwise they are implemented per
+	 * platform like the rest, with full barriers.
+	 *
 	 * @warning
 	 * Be careful with using these functions, they can cause all kinds of
 	 * weird problems. Read <a href="https://en.wikipedia.org/wiki/Memory_barrier">the
@@ -44,6 +54,15 @@ namespace OSL {
 	 */
 	class Atomic {
 	public:
+		/**
+		 * An integer which is only accessed through these functions.
+		 */
+		#ifdef OSL_STD_ATOMIC
+			typedef std::atomic<int> Integer;
+		#else
+			typedef volatile int Integer;
+		#endif
+
 		/**
 		 * Atomically increase an integer by 1.
 		 */
@@ -56,8 +75,85 @@ namespace OSL {
 		 *         was performed.
 		 */
 		static bool decrement(volatile int &i) throw();
+
+		#ifdef OSL_STD_ATOMIC
+			/**
+			 * Atomically increase an integer by 1. This doesn't order
+			 * anything else, which is enough for taking a reference.
+			 */
+			static void increment(Integer &i) throw();
+
+			/**
+			 * Atomically decrease an integer by 1. Whoever sees the
+			 * integer drop to 0 also sees everything done before the
+			 * other decrements, so it can free what it counts.
+			 *
+			 * @return Whether the integer is 0 after the decrement
+			 *         was performed.
+			 */
+			static bool decrement(Integer &i) throw();
+		#endif
+
+		/**
+		 * Atomically add to an integer, ordering it like decrement().
+		 *
+		 * @return The value before the addition.
+		 */
+		static int fetchAndAdd(Integer &i, int n) throw();
+
+		/**
+		 * Atomically set an integer to <tt>desired</tt> if it equals
+		 * <tt>expected</tt>, ordered like decrement() if it does.
+		 *
+		 * @param expected  Receives the current value if it isn't the expected one.
+		 * @return Whether the integer was set.
+		 */
+		static bool compareAndSwap(Integer &i, int &expected, int desired) throw();
+
+		/**
+		 * Read an integer, and see everything done before the store() of its value.
+		 */
+		static int load(const Integer &i) throw();
+
+		/**
+		 * Set an integer after everything done before, see load().
+		 */
+		static void store(Integer &i, int value) throw();
 	};
 
+	#ifdef OSL_STD_ATOMIC
+		inline void
+		Atomic::increment(Integer &i) throw() {
+			i.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		inline bool
+		Atomic::decrement(Integer &i) throw() {
+			return i.fetch_sub(1, std::memory_order_acq_rel) == 1;
+		}
+
+		inline int
+		Atomic::fetchAndAdd(Integer &i, int n) throw() {
+			return i.fetch_add(n, std::memory_order_acq_rel);
+		}
+
+		inline bool
+		Atomic::compareAndSwap(Integer &i, int &expected, int desired) throw() {
+			return i.compare_exchange_strong(expected, desired,
+				std::memory_order_acq_rel, std::memory_order_acquire);
+		}
+
+		inline int
+		Atomic::load(const Integer &i) throw() {
+			return i.load(std::memory_order_acquire);
+		}
+
+		inline void
+		Atomic::store(Integer &i, int value) throw() {
+			i.store(value, std::memory_order_release);
+		}
+	#endif
+
 }
 
 #endif /* _OSL_ATOMIC_H_ */
@@ -0,0 +1,495 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifdef WIN32
+	// Condition variables need Windows Vista
+	#if !defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0600
+		#undef _WIN32_WINNT
+		#define _WIN32_WINNT 0x0600
+	#endif
+	#define WIN32_MEAN_AND_LEAN
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <unistd.h>
+#endif
+#include <stddef.h>
+#include <deque>
+#include <algorithm>
+#include "Executor.h"
+
+#ifdef WIN32
+	typedef CRITICAL_SECTION NativeMutex;
+	typedef CONDITION_VARIABLE NativeCondition;
+	typedef HANDLE NativeThread;
+	#define nativeLock(mutex) EnterCriticalSection(mutex)
+	#define nativeUnlock(mutex) LeaveCriticalSection(mutex)
+	#define nativeWait(condition, mutex) SleepConditionVariableCS(condition, mutex, INFINITE)
+	#define nativeSignal(condition) WakeConditionVariable(condition)
+	#define nativeBroadcast(condition) WakeAllConditionVariable(condition)
+#else
+	typedef pthread_mutex_t NativeMutex;
+	typedef pthread_cond_t NativeCondition;
+	typedef pthread_t NativeThread;
+	#define nativeLock(mutex) pthread_mutex_lock(mutex)
+	#define nativeUnlock(mutex) pthread_mutex_unlock(mutex)
+	#define nativeWait(condition, mutex) pthread_cond_wait(condition, mutex)
+	#define nativeSignal(condition) pthread_cond_signal(condition)
+	#define nativeBroadcast(condition) pthread_cond_broadcast(condition)
+#endif
+
+#ifdef _MSC_VER
+	#define THREAD_LOCAL __declspec(thread)
+#else
+	#define THREAD_LOCAL __thread
+#endif
+
+namespace OSL {
+
+	namespace {
+		struct ExecutorImpl;
+
+		// The tasks queued for one thread, which the others steal from
+		struct WorkerQueue {
+			NativeMutex mutex;
+			std::deque<Task *> tasks;
+		};
+
+		struct Worker {
+			ExecutorImpl *impl;
+			unsigned int index;
+			NativeThread thread;
+		};
+
+		/*
+		 * 'lock' protects everything but the queues, which have their own
+		 * mutex; it is always taken before a queue's mutex, never after.
+		 * The queues and workers only change while no thread is running.
+		 */
+		struct ExecutorImpl {
+			NativeMutex lock;
+			// Signaled when a task is queued or the threads must stop
+			NativeCondition taskQueued;
+			// Signaled when a task is done
+			NativeCondition taskFinished;
+
+			WorkerQueue *queues;
+			Worker *workers;
+			unsigned int queueCount;
+			unsigned int threadCount;
+			unsigned int nextQueue;
+			bool stopping;
+
+			// The number of queued tasks, which threads sleep on when 0.
+			// Only increased with 'lock' held, so that they don't miss it.
+			Atomic::Integer pending;
+		};
+
+		// The worker which runs the current thread, NULL outside executor threads
+		THREAD_LOCAL Worker *currentWorker = NULL;
+
+
+		void
+		initMutex(NativeMutex *mutex) {
+			#ifdef WIN32
+				InitializeCriticalSection(mutex);
+			#else
+				pthread_mutex_init(mutex, NULL);
+			#endif
+		}
+
+		void
+		destroyMutex(NativeMutex *mutex) {
+			#ifdef WIN32
+				DeleteCriticalSection(mutex);
+			#else
+				pthread_mutex_destroy(mutex);
+			#endif
+		}
+	}
+
+	/*
+	 * What the threads do, and the parts of tasks they share with the
+	 * Task methods.
+	 */
+	class ExecutorWorker {
+	public:
+		// Marks a task as no longer used by the executor, after which
+		// it must not be touched anymore
+		static void
+		finish(Task *task) {
+			ExecutorImpl *impl = (ExecutorImpl *) task->executor->impl;
+
+			nativeLock(&impl->lock);
+			Atomic::store(task->finished, 1);
+			nativeBroadcast(&impl->taskFinished);
+			nativeUnlock(&impl->lock);
+		}
+
+		// Runs a task which was taken out of its queue, unless it was cancelled
+		static void
+		execute(Task *task) {
+			int expected = Task::QUEUED;
+
+			if (Atomic::compareAndSwap(task->status, expected, Task::RUNNING)) {
+				task->run();
+				Atomic::store(task->status, Task::DONE);
+			}
+			finish(task);
+		}
+
+		// Removes a task from whichever queue it is in
+		static bool
+		remove(Task *task) {
+			ExecutorImpl *impl = (ExecutorImpl *) task->executor->impl;
+			bool found = false;
+
+			nativeLock(&impl->lock);
+			for (unsigned int i = 0; i < impl->queueCount && !found; i++) {
+				WorkerQueue *queue = &impl->queues[i];
+				std::deque<Task *>::iterator it;
+
+				nativeLock(&queue->mutex);
+				it = std::find(queue->tasks.begin(), queue->tasks.end(), task);
+				if (it != queue->tasks.end()) {
+					queue->tasks.erase(it);
+					found = true;
+				}
+				nativeUnlock(&queue->mutex);
+			}
+			if (found) {
+				Atomic::decrement(impl->pending);
+			}
+			nativeUnlock(&impl->lock);
+			return found;
+		}
+
+		// Takes the oldest task of a worker's queue, or the newest one of
+		// another queue
+		static Task *
+		take(ExecutorImpl *impl, unsigned int index) {
+			Task *task = NULL;
+
+			for (unsigned int i = 0; i < impl->queueCount && task == NULL; i++) {
+				WorkerQueue *queue = &impl->queues[(index + i) % impl->queueCount];
+
+				nativeLock(&queue->mutex);
+				if (!queue->tasks.empty()) {
+					if (i == 0) {
+						task = queue->tasks.front();
+						queue->tasks.pop_front();
+					} else {
+						task = queue->tasks.back();
+						queue->tasks.pop_back();
+					}
+				}
+				nativeUnlock(&queue->mutex);
+			}
+			if (task != NULL) {
+				Atomic::decrement(impl->pending);
+			}
+			return task;
+		}
+
+		static void
+		run(Worker *worker) {
+			ExecutorImpl *impl = worker->impl;
+
+			currentWorker = worker;
+			while (true) {
+				Task *task = take(impl, worker->index);
+				if (task != NULL) {
+					execute(task);
+					continue;
+				}
+
+				// The queues are emptied before stopping
+				nativeLock(&impl->lock);
+				while (Atomic::load(impl->pending) <= 0 && !impl->stopping) {
+					nativeWait(&impl->taskQueued, &impl->lock);
+				}
+				if (Atomic::load(impl->pending) <= 0) {
+					nativeUnlock(&impl->lock);
+					break;
+				}
+				nativeUnlock(&impl->lock);
+			}
+			currentWorker = NULL;
+		}
+	};
+
+
+	/* Task */
+
+	Task::Task() throw() {
+		Atomic::store(status, IDLE);
+		Atomic::store(cancelled, 0);
+		Atomic::store(finished, 0);
+		executor = NULL;
+	}
+
+	Task::~Task() {
+	}
+
+	Task::Status
+	Task::getStatus() const throw() {
+		return (Status) Atomic::load(status);
+	}
+
+	bool
+	Task::isDone() const throw() {
+		return Atomic::load(finished) != 0;
+	}
+
+	bool
+	Task::isCancelled() const throw() {
+		return Atomic::load(cancelled) != 0;
+	}
+
+	bool
+	Task::cancel() throw() {
+		int expected = QUEUED;
+
+		Atomic::store(cancelled, 1);
+		if (!Atomic::compareAndSwap(status, expected, CANCELLED)) {
+			return false;
+		}
+		// Whoever takes it out of its queue finishes it
+		if (ExecutorWorker::remove(this)) {
+			ExecutorWorker::finish(this);
+		}
+		return true;
+	}
+
+	void
+	Task::wait() {
+		ExecutorImpl *impl = (ExecutorImpl *) executor->impl;
+
+		if (getStatus() == QUEUED && ExecutorWorker::remove(this)) {
+			ExecutorWorker::execute(this);
+			return;
+		}
+		nativeLock(&impl->lock);
+		while (!isDone()) {
+			nativeWait(&impl->taskFinished, &impl->lock);
+		}
+		nativeUnlock(&impl->lock);
+	}
+
+
+	/* Executor */
+
+	#ifdef WIN32
+		static DWORD WINAPI
+		workerEntry(LPVOID arg)
+	#else
+		static void *
+		workerEntry(void *arg)
+	#endif
+	{
+		ExecutorWorker::run((Worker *) arg);
+		#ifdef WIN32
+			return 0;
+		#else
+			return NULL;
+		#endif
+	}
+
+	Executor::Executor() throw() {
+		ExecutorImpl *impl = new ExecutorImpl();
+
+		initMutex(&impl->lock);
+		#ifdef WIN32
+			InitializeConditionVariable(&impl->taskQueued);
+			InitializeConditionVariable(&impl->taskFinished);
+		#else
+			pthread_cond_init(&impl->taskQueued, NULL);
+			pthread_cond_init(&impl->taskFinished, NULL);
+		#endif
+		impl->queues = NULL;
+		impl->workers = NULL;
+		impl->queueCount = 0;
+		impl->threadCount = 0;
+		impl->nextQueue = 0;
+		impl->stopping = false;
+		Atomic::store(impl->pending, 0);
+		this->impl = impl;
+	}
+
+	Executor::~Executor() {
+		ExecutorImpl *impl = (ExecutorImpl *) this->impl;
+
+		stop();
+		destroyMutex(&impl->lock);
+		#ifndef WIN32
+			pthread_cond_destroy(&impl->taskQueued);
+			pthread_cond_destroy(&impl->taskFinished);
+		#endif
+		delete impl;
+	}
+
+	Executor *
+	Executor::getInstance() {
+		static Executor *instance = new Executor();
+		return instance;
+	}
+
+	unsigned int
+	Executor::getProcessorCount() throw() {
+		#ifdef WIN32
+			SYSTEM_INFO info;
+			GetSystemInfo(&info);
+			return info.dwNumberOfProcessors > 0 ? (unsigned int) info.dwNumberOfProcessors : 1;
+		#else
+			long count = sysconf(_SC_NPROCESSORS_ONLN);
+			return count > 0 ? (unsigned int) count : 1;
+		#endif
+	}
+
+	unsigned int
+	Executor::start(unsigned int threads) {
+		ExecutorImpl *impl = (ExecutorImpl *) this->impl;
+		unsigned int i;
+
+		if (threads == 0) {
+			threads = getProcessorCount();
+		}
+
+		nativeLock(&impl->lock);
+		if (impl->threadCount > 0 || impl->stopping) {
+			i = impl->threadCount;
+			nativeUnlock(&impl->lock);
+			return i;
+		}
+
+		impl->queues = new WorkerQueue[threads];
+		impl->workers = new Worker[threads];
+		impl->queueCount = threads;
+		for (i = 0; i < threads; i++) {
+			initMutex(&impl->queues[i].mutex);
+		}
+		// The threads wait for the lock before looking at anything
+		for (i = 0; i < threads; i++) {
+			Worker *worker = &impl->workers[i];
+
+			worker->impl = impl;
+			worker->index = i;
+			#ifdef WIN32
+				worker->thread = CreateThread(NULL, 0, workerEntry, worker, 0, NULL);
+				if (worker->thread == NULL) {
+					break;
+				}
+			#else
+				if (pthread_create(&worker->thread, NULL, workerEntry, worker) != 0) {
+					break;
+				}
+			#endif
+		}
+		impl->threadCount = i;
+		impl->nextQueue = 0;
+		nativeUnlock(&impl->lock);
+
+		if (i == 0) {
+			stop();
+		}
+		return i;
+	}
+
+	void
+	Executor::stop() {
+		ExecutorImpl *impl = (ExecutorImpl *) this->impl;
+		unsigned int count;
+
+		nativeLock(&impl->lock);
+		if (impl->queues == NULL || impl->stopping) {
+			nativeUnlock(&impl->lock);
+			return;
+		}
+		impl->stopping = true;
+		count = impl->threadCount;
+		nativeBroadcast(&impl->taskQueued);
+		nativeUnlock(&impl->lock);
+
+		for (unsigned int i = 0; i < count; i++) {
+			#ifdef WIN32
+				WaitForSingleObject(impl->workers[i].thread, INFINITE);
+				CloseHandle(impl->workers[i].thread);
+			#else
+				pthread_join(impl->workers[i].thread, NULL);
+			#endif
+		}
+
+		nativeLock(&impl->lock);
+		for (unsigned int i = 0; i < impl->queueCount; i++) {
+			destroyMutex(&impl->queues[i].mutex);
+		}
+		delete[] impl->queues;
+		delete[] impl->workers;
+		impl->queues = NULL;
+		impl->workers = NULL;
+		impl->queueCount = 0;
+		impl->threadCount = 0;
+		impl->stopping = false;
+		nativeUnlock(&impl->lock);
+	}
+
+	unsigned int
+	Executor::getThreadCount() throw() {
+		ExecutorImpl *impl = (ExecutorImpl *) this->impl;
+		unsigned int count;
+
+		nativeLock(&impl->lock);
+		count = impl->stopping ? 0 : impl->threadCount;
+		nativeUnlock(&impl->lock);
+		return count;
+	}
+
+	void
+	Executor::submit(Task *task) {
+		ExecutorImpl *impl = (ExecutorImpl *) this->impl;
+		WorkerQueue *queue;
+
+		task->executor = this;
+		Atomic::store(task->cancelled, 0);
+		Atomic::store(task->finished, 0);
+		Atomic::store(task->status, Task::QUEUED);
+
+		nativeLock(&impl->lock);
+		if (impl->threadCount == 0 || impl->stopping) {
+			nativeUnlock(&impl->lock);
+			ExecutorWorker::execute(task);
+			return;
+		}
+
+		if (currentWorker != NULL && currentWorker->impl == impl) {
+			queue = &impl->queues[currentWorker->index];
+		} else {
+			queue = &impl->queues[impl->nextQueue];
+			impl->nextQueue = (impl->nextQueue + 1) % impl->threadCount;
+		}
+		nativeLock(&queue->mutex);
+		queue->tasks.push_back(task);
+		nativeUnlock(&queue->mutex);
+		Atomic::increment(impl->pending);
+		nativeSignal(&impl->taskQueued);
+		nativeUnlock(&impl->lock);
+	}
+
+}
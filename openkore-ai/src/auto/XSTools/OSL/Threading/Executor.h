@@ -0,0 +1,213 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifndef _OSL_EXECUTOR_H_
+#define _OSL_EXECUTOR_H_
+
+#include "Atomic.h"
+
+namespace OSL {
+
+	class Executor;
+	class ExecutorWorker;
+
+	/**
+	 * A unit of work for an Executor, which is also the future of its result:
+	 * subclasses implement run() and keep whatever it produces, which may be
+	 * read once isDone() returns true or wait() returned.
+	 *
+	 * A Task is owned by whoever submits it. It must stay alive until it is
+	 * done, which is also the case after a successful cancel(); wait() before
+	 * freeing it if unsure. A Task may be submitted again once it is done.
+	 *
+	 * @class Task OSL/Threading/Executor.h
+	 * @ingroup Threading
+	 */
+	class Task {
+	public:
+		enum Status {
+			/** Not submitted yet. */
+			IDLE,
+			/** Waiting for a thread. */
+			QUEUED,
+			/** run() is being called. */
+			RUNNING,
+			/** run() returned. */
+			DONE,
+			/** Cancelled before it ran; run() is not called. */
+			CANCELLED
+		};
+
+		Task() throw();
+		virtual ~Task();
+
+		/**
+		 * Does the work. Called by one of the executor's threads, or by
+		 * the thread which submitted or waits for the task.
+		 */
+		virtual void run() = 0;
+
+		/**
+		 * Returns the status of this task.
+		 *
+		 * This method is thread-safe.
+		 */
+		Status getStatus() const throw();
+
+		/**
+		 * Returns whether the executor is done with this task: run()
+		 * returned, or the task was cancelled before it ran.
+		 *
+		 * This method is thread-safe.
+		 */
+		bool isDone() const throw();
+
+		/**
+		 * Cancel this task. A task which is still queued won't run;
+		 * a running task only sees isCancelled() return true, and
+		 * may stop early if it checks it.
+		 *
+		 * @return Whether the task was prevented from running.
+		 * This method is thread-safe.
+		 */
+		bool cancel() throw();
+
+		/**
+		 * Returns whether cancel() was called since the task was submitted.
+		 *
+		 * This method is thread-safe.
+		 */
+		bool isCancelled() const throw();
+
+		/**
+		 * Block until this task is done. A task which no thread took
+		 * yet is run right away in the calling thread instead, so
+		 * tasks may wait for the tasks they submitted.
+		 *
+		 * @require The task was submitted.
+		 */
+		void wait();
+
+	private:
+		friend class Executor;
+		friend class ExecutorWorker;
+
+		Atomic::Integer status;
+		Atomic::Integer cancelled;
+		// Set by the executor once it no longer touches the task
+		Atomic::Integer finished;
+		Executor *executor;
+
+		Task(const Task &);
+		Task &operator=(const Task &);
+	};
+
+	/**
+	 * A fixed-size pool of native threads which run Tasks.
+	 *
+	 * Each thread has its own queue. Tasks submitted by one of the threads go
+	 * to that thread's queue, other tasks are spread over the queues in turn.
+	 * A thread takes the oldest task of its own queue, and when it is empty,
+	 * steals the newest task of another thread's queue; threads only sleep
+	 * when every queue is empty.
+	 *
+	 * getInstance() returns the executor shared by the whole process, so that
+	 * libraries which run work in the background don't start more threads
+	 * than there are processors.
+	 *
+	 * @class Executor OSL/Threading/Executor.h
+	 * @ingroup Threading
+	 */
+	class Executor {
+	public:
+		/**
+		 * Create an executor without threads; call start() to start them.
+		 */
+		Executor() throw();
+
+		/**
+		 * Stops the executor, after running the queued tasks.
+		 */
+		~Executor();
+
+		/**
+		 * Returns the executor shared by the process, which is never
+		 * freed and is not started until someone calls start().
+		 *
+		 * @ensure result != NULL
+		 */
+		static Executor *getInstance();
+
+		/**
+		 * Returns the number of processors of this machine.
+		 *
+		 * @ensure result >= 1
+		 */
+		static unsigned int getProcessorCount() throw();
+
+		/**
+		 * Start threads, unless the executor is already running.
+		 *
+		 * @param threads The number of threads, 0 for one per processor.
+		 * @return The number of running threads, which may be less than
+		 *         asked for if threads could not be created.
+		 * This method is thread-safe.
+		 */
+		unsigned int start(unsigned int threads = 0);
+
+		/**
+		 * Run the queued tasks and stop every thread. Tasks submitted
+		 * afterwards run in the submitting thread, until start() is
+		 * called again.
+		 *
+		 * This method is thread-safe, but must not be called by one of
+		 * this executor's threads.
+		 */
+		void stop();
+
+		/**
+		 * Returns the number of running threads.
+		 *
+		 * This method is thread-safe.
+		 */
+		unsigned int getThreadCount() throw();
+
+		/**
+		 * Queue a task. If the executor has no threads, the task is run
+		 * right away in the calling thread.
+		 *
+		 * @require task != NULL && task is not queued or running.
+		 * This method is thread-safe.
+		 */
+		void submit(Task *task);
+
+	private:
+		friend class Task;
+		friend class ExecutorWorker;
+
+		void *impl;
+
+		Executor(const Executor &);
+		Executor &operator=(const Executor &);
+	};
+
+}
+
+#endif /* _OSL_EXECUTOR_H_ */
@@ -0,0 +1,159 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifndef _OSL_MPSC_QUEUE_H_
+#define _OSL_MPSC_QUEUE_H_
+
+#include "SpscQueue.h"
+
+namespace OSL {
+
+	/**
+	 * A bounded queue between any number of producer threads and one
+	 * consumer thread, without locks.
+	 *
+	 * Every slot has a sequence number which says whose turn it is: producers
+	 * claim the next slot with a compare-and-swap on the write index, and
+	 * publish the item through the slot's sequence number, so a producer which
+	 * is slow to finish only holds up the consumer at that slot, never the
+	 * other producers. This is Dmitry Vyukov's bounded queue, with a single
+	 * consumer.
+	 *
+	 * push() may be called by any thread; pop() only by one thread at a time.
+	 *
+	 * @class MpscQueue OSL/Threading/MpscQueue.h
+	 * @ingroup Threading
+	 * @see SpscQueue
+	 */
+	template <typename T>
+	class MpscQueue {
+	private:
+		struct Cell {
+			/**
+			 * The position which may write this cell next, or that
+			 * position + 1 once the item there can be read.
+			 */
+			Atomic::Integer sequence;
+			T item;
+		};
+
+		Cell *cells;
+		unsigned int mask;
+		char pad0[OSL_CACHE_LINE_SIZE];
+		/** Written by the producers. */
+		Atomic::Integer writeIndex;
+		char pad1[OSL_CACHE_LINE_SIZE - sizeof(Atomic::Integer)];
+		/** Only written by the consumer. */
+		Atomic::Integer readIndex;
+		char pad2[OSL_CACHE_LINE_SIZE - sizeof(Atomic::Integer)];
+
+		MpscQueue(const MpscQueue &);
+		MpscQueue &operator=(const MpscQueue &);
+	public:
+		/**
+		 * Create a queue.
+		 *
+		 * @param capacity  The number of items it can hold, which is
+		 *                  rounded up to a power of two.
+		 */
+		MpscQueue(unsigned int capacity) {
+			unsigned int size = 1;
+			while (size < capacity) {
+				size <<= 1;
+			}
+			cells = new Cell[size];
+			mask = size - 1;
+			for (unsigned int i = 0; i < size; i++) {
+				Atomic::store(cells[i].sequence, (int) i);
+			}
+			Atomic::store(writeIndex, 0);
+			Atomic::store(readIndex, 0);
+		}
+
+		~MpscQueue() {
+			delete[] cells;
+		}
+
+		unsigned int capacity() const {
+			return mask + 1;
+		}
+
+		/**
+		 * Add an item at the end of the queue. Any thread may call this.
+		 *
+		 * @return Whether it was added; false if the queue is full.
+		 */
+		bool push(const T &item) {
+			int position = Atomic::load(writeIndex);
+			Cell *cell;
+
+			while (true) {
+				cell = &cells[(unsigned int) position & mask];
+				int difference = (int) ((unsigned int) Atomic::load(cell->sequence) - (unsigned int) position);
+				if (difference == 0) {
+					// The cell is free; claim it, unless someone else did first
+					if (Atomic::compareAndSwap(writeIndex, position, (int) ((unsigned int) position + 1))) {
+						break;
+					}
+				} else if (difference < 0) {
+					// The cell still holds the item from a round ago
+					return false;
+				} else {
+					// Someone else claimed it
+					position = Atomic::load(writeIndex);
+				}
+			}
+
+			cell->item = item;
+			Atomic::store(cell->sequence, (int) ((unsigned int) position + 1));
+			return true;
+		}
+
+		/**
+		 * Take the item at the front of the queue. Only the consumer may call this.
+		 *
+		 * @return Whether there was one; false if the queue is empty, or the
+		 *         producer of the next item didn't finish adding it yet.
+		 */
+		bool pop(T &item) {
+			unsigned int position = (unsigned int) Atomic::load(readIndex);
+			Cell *cell = &cells[position & mask];
+
+			if ((unsigned int) Atomic::load(cell->sequence) != position + 1) {
+				return false;
+			}
+			item = cell->item;
+			Atomic::store(cell->sequence, (int) (position + mask + 1));
+			Atomic::store(readIndex, (int) (position + 1));
+			return true;
+		}
+
+		/**
+		 * Whether the queue is empty. This is only certain for the consumer;
+		 * for anyone else, it may change at any time.
+		 */
+		bool empty() const {
+			return Atomic::load(readIndex) == Atomic::load(writeIndex);
+		}
+	};
+
+}
+
+#endif /* _OSL_MPSC_QUEUE_H_ */
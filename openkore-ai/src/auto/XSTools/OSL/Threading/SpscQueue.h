@@ -0,0 +1,127 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#ifndef _OSL_SPSC_QUEUE_H_
+#define _OSL_SPSC_QUEUE_H_
+
+#include "Atomic.h"
+
+/** The size of a cache line; things which different threads write are kept this far apart. */
+#define OSL_CACHE_LINE_SIZE 64
+
+namespace OSL {
+
+	/**
+	 * A bounded queue between one producer thread and one consumer thread,
+	 * which never lock each other out.
+	 *
+	 * Each side only writes its own index, and publishes it once it is done
+	 * with the item it pushed or popped; the indices are on separate cache
+	 * lines so that the two threads don't slow each other down.
+	 *
+	 * push() may only be called by one thread at a time, as may pop().
+	 *
+	 * @class SpscQueue OSL/Threading/SpscQueue.h
+	 * @ingroup Threading
+	 * @see MpscQueue
+	 */
+	template <typename T>
+	class SpscQueue {
+	private:
+		T *items;
+		unsigned int mask;
+		char pad0[OSL_CACHE_LINE_SIZE];
+		/** Only written by the producer. */
+		Atomic::Integer writeIndex;
+		char pad1[OSL_CACHE_LINE_SIZE - sizeof(Atomic::Integer)];
+		/** Only written by the consumer. */
+		Atomic::Integer readIndex;
+		char pad2[OSL_CACHE_LINE_SIZE - sizeof(Atomic::Integer)];
+
+		SpscQueue(const SpscQueue &);
+		SpscQueue &operator=(const SpscQueue &);
+	public:
+		/**
+		 * Create a queue.
+		 *
+		 * @param capacity  The number of items it can hold, which is
+		 *                  rounded up to a power of two.
+		 */
+		SpscQueue(unsigned int capacity) {
+			unsigned int size = 1;
+			while (size < capacity) {
+				size <<= 1;
+			}
+			items = new T[size];
+			mask = size - 1;
+			Atomic::store(writeIndex, 0);
+			Atomic::store(readIndex, 0);
+		}
+
+		~SpscQueue() {
+			delete[] items;
+		}
+
+		unsigned int capacity() const {
+			return mask + 1;
+		}
+
+		/**
+		 * Add an item at the end of the queue. Only the producer may call this.
+		 *
+		 * @return Whether it was added; false if the queue is full.
+		 */
+		bool push(const T &item) {
+			unsigned int write = (unsigned int) Atomic::load(writeIndex);
+			if (write - (unsigned int) Atomic::load(readIndex) > mask) {
+				return false;
+			}
+			items[write & mask] = item;
+			Atomic::store(writeIndex, (int) (write + 1));
+			return true;
+		}
+
+		/**
+		 * Take the item at the front of the queue. Only the consumer may call this.
+		 *
+		 * @return Whether there was one; false if the queue is empty.
+		 */
+		bool pop(T &item) {
+			unsigned int read = (unsigned int) Atomic::load(readIndex);
+			if (read == (unsigned int) Atomic::load(writeIndex)) {
+				return false;
+			}
+			item = items[read & mask];
+			Atomic::store(readIndex, (int) (read + 1));
+			return true;
+		}
+
+		/**
+		 * Whether the queue is empty. This is only certain for the consumer;
+		 * for anyone else, it may change at any time.
+		 */
+		bool empty() const {
+			return Atomic::load(readIndex) == Atomic::load(writeIndex);
+		}
+	};
+
+}
+
+#endif /* _OSL_SPSC_QUEUE_H_ */
@@ -57,7 +57,7 @@ namespace OSL {
 			* @throws ThreadException  If the thread cannot be started.
 			*/
 			virtual void start(Runnable *runnable, bool detached,
-					bool runnableShouldBeFreed) throw(ThreadException) = 0;
+					bool runnableShouldBeFreed) = 0;
 	
 			/**
 			* Join this thread. This function may only be called once.
@@ -103,7 +103,7 @@ namespace OSL {
 	}
 
 	void
-	Thread::start() throw(ThreadException) {
+	Thread::start() {
 		if (runnable != NULL) {
 			static_cast<ThreadImplementation *>(impl)->start(runnable, detached, true);
 		} else {
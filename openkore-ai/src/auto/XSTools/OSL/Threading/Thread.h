@@ -92,7 +92,7 @@ namespace OSL {
 		 * @throws  ThreadException  If the thread cannot be started.
 		 * @warning You may only call this function once.
 		 */
-		void start() throw(ThreadException);
+		void start();
 
 		void interrupt();
 
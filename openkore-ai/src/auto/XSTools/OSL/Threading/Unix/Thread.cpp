@@ -40,7 +40,7 @@ private:
 	}
 public:
 	virtual void
-	start(Runnable *runnable, bool detached, bool runnableShouldBeFreed) throw(ThreadException) {
+	start(Runnable *runnable, bool detached, bool runnableShouldBeFreed) {
 		this->runnable = runnable;
 		this->detached = detached;
 		this->runnableShouldBeFreed = runnableShouldBeFreed;
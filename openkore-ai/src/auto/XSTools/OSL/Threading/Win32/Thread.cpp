@@ -43,7 +43,7 @@ private:
 	}
 public:
 	virtual void
-	start(Runnable *runnable, bool detached, bool runnableShouldBeFreed) throw(ThreadException) {
+	start(Runnable *runnable, bool detached, bool runnableShouldBeFreed) {
 		DWORD threadID;
 
 		this->runnable = runnable;
@@ -22,6 +22,7 @@
 
 #include "tut.h"
 #include "../../Threading/Atomic.h"
+#include "../../Threading/Thread.h"
 
 /*
  * Test case for OSL::Atomic
@@ -32,6 +33,80 @@ namespace tut {
 
 	DEFINE_TEST_GROUP(AtomicTest);
 
+	#define THREADS 4
+	#define ITERATIONS 200000
+
+	// Increments and decrements shared counters from several threads at once
+	class Contender: public Thread {
+	public:
+		Atomic::Integer *counter;
+		volatile int *plainCounter;
+		Atomic::Integer *casCounter;
+		Object *object;
+
+		Contender() {
+			counter = NULL;
+			plainCounter = NULL;
+			casCounter = NULL;
+			object = NULL;
+		}
+
+		virtual void run() {
+			for (int i = 0; i < ITERATIONS; i++) {
+				if (counter != NULL) {
+					Atomic::increment(*counter);
+					Atomic::fetchAndAdd(*counter, 2);
+					Atomic::decrement(*counter);
+				}
+				if (plainCounter != NULL) {
+					Atomic::increment(*plainCounter);
+					Atomic::increment(*plainCounter);
+					Atomic::decrement(*plainCounter);
+				}
+				if (casCounter != NULL) {
+					int value = Atomic::load(*casCounter);
+					while (!Atomic::compareAndSwap(*casCounter, value, value + 1)) {
+					}
+				}
+				if (object != NULL) {
+					object->ref();
+					object->unref();
+				}
+			}
+		}
+	};
+
+	// Runs THREADS Contenders set up like the given one
+	static void
+	contend(const Contender &setup) {
+		Contender contenders[THREADS];
+
+		for (int i = 0; i < THREADS; i++) {
+			contenders[i].counter = setup.counter;
+			contenders[i].plainCounter = setup.plainCounter;
+			contenders[i].casCounter = setup.casCounter;
+			contenders[i].object = setup.object;
+			contenders[i].start();
+		}
+		for (int i = 0; i < THREADS; i++) {
+			contenders[i].join();
+		}
+	}
+
+	// Deletes itself once, sets deleted
+	class CountedObject: public Object {
+	public:
+		bool *deleted;
+
+		CountedObject(bool *deleted) {
+			this->deleted = deleted;
+		}
+
+		~CountedObject() {
+			*deleted = true;
+		}
+	};
+
 	TEST_METHOD(1) {
 		int i = 0;
 
@@ -49,4 +124,58 @@ namespace tut {
 		ensure(!Atomic::decrement(i));
 		ensure(Atomic::decrement(i));
 	}
+
+	TEST_METHOD(3) {
+		Atomic::Integer i(0);
+
+		Atomic::store(i, 5);
+		ensure_equals(Atomic::load(i), 5);
+		ensure_equals(Atomic::fetchAndAdd(i, 3), 5);
+		ensure_equals(Atomic::fetchAndAdd(i, -8), 8);
+		ensure_equals(Atomic::load(i), 0);
+		Atomic::increment(i);
+		ensure(Atomic::decrement(i));
+	}
+
+	TEST_METHOD(4) {
+		Atomic::Integer i(1);
+		int expected = 2;
+
+		ensure("Fails for another value", !Atomic::compareAndSwap(i, expected, 3));
+		ensure_equals("Returns the current value", expected, 1);
+		ensure_equals(Atomic::load(i), 1);
+		ensure("Succeeds for the current value", Atomic::compareAndSwap(i, expected, 3));
+		ensure_equals(Atomic::load(i), 3);
+	}
+
+	// Contention; the counters must add up however the threads interleave
+	TEST_METHOD(5) {
+		Atomic::Integer counter(0);
+		volatile int plainCounter = 0;
+		Atomic::Integer casCounter(0);
+		bool deleted = false;
+		CountedObject *object = new CountedObject(&deleted);
+		Contender setup;
+
+		setup.counter = &counter;
+		contend(setup);
+		ensure_equals("Integer counter", Atomic::load(counter), THREADS * ITERATIONS * 2);
+
+		setup.counter = NULL;
+		setup.plainCounter = &plainCounter;
+		contend(setup);
+		ensure_equals("volatile int counter", plainCounter, THREADS * ITERATIONS);
+
+		setup.plainCounter = NULL;
+		setup.casCounter = &casCounter;
+		contend(setup);
+		ensure_equals("compare-and-swap counter", Atomic::load(casCounter), THREADS * ITERATIONS);
+
+		setup.casCounter = NULL;
+		setup.object = object;
+		contend(setup);
+		ensure("Shared object is still alive", !deleted);
+		object->unref();
+		ensure("Shared object is deleted", deleted);
+	}
 }
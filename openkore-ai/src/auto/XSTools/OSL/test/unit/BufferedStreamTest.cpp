@@ -0,0 +1,250 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  Unit tests
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#include <string>
+#include <string.h>
+#include "tut.h"
+#include "../../IO/BufferedInputStream.h"
+#include "../../IO/BufferedOutputStream.h"
+#include "../../Net/Socket.h"
+#include "../../Net/ServerSocket.h"
+
+/*
+ * Test case for OSL::BufferedInputStream and OSL::BufferedOutputStream
+ */
+namespace tut {
+	struct BufferedStreamTest {
+	};
+
+	DEFINE_TEST_GROUP(BufferedStreamTest);
+
+	// Keeps what is written to it, at most 'limit' bytes per call
+	class RecordingOutputStream: public OutputStream {
+	public:
+		std::string data;
+		unsigned int calls;
+		unsigned int limit;
+
+		RecordingOutputStream(unsigned int limit = 0) {
+			calls = 0;
+			this->limit = limit;
+		}
+
+		virtual void close() {
+		}
+
+		virtual void flush() {
+		}
+
+		virtual unsigned int write(const char *data, unsigned int size) {
+			IOVector vector;
+			vector.data = data;
+			vector.size = size;
+			return writev(&vector, 1);
+		}
+
+		virtual unsigned int writev(const IOVector *vectors, unsigned int count) {
+			unsigned int total = 0;
+
+			calls++;
+			for (unsigned int i = 0; i < count; i++) {
+				unsigned int n = vectors[i].size;
+				if (limit > 0 && total + n > limit) {
+					n = limit - total;
+				}
+				this->data.append(vectors[i].data, n);
+				total += n;
+			}
+			return total;
+		}
+	};
+
+	// Returns the bytes of a string, at most 'chunk' bytes per read
+	class StringInputStream: public InputStream {
+	public:
+		std::string data;
+		unsigned int position;
+		unsigned int chunk;
+		unsigned int calls;
+
+		StringInputStream(const std::string &data, unsigned int chunk) {
+			this->data = data;
+			this->chunk = chunk;
+			position = 0;
+			calls = 0;
+		}
+
+		virtual void close() {
+		}
+
+		virtual bool eof() const {
+			return position == data.size();
+		}
+
+		virtual int read(char *buffer, unsigned int size) {
+			calls++;
+			if (eof()) {
+				return -1;
+			}
+			unsigned int n = data.size() - position;
+			if (n > size) {
+				n = size;
+			}
+			if (n > chunk) {
+				n = chunk;
+			}
+			memcpy(buffer, data.c_str() + position, n);
+			position += n;
+			return n;
+		}
+	};
+
+	// Small writes are buffered, large ones go out with the buffer in one call
+	TEST_METHOD(1) {
+		RecordingOutputStream *out = new RecordingOutputStream();
+		BufferedOutputStream *buffered = new BufferedOutputStream(out, 8);
+		std::string large(100, 'x');
+
+		buffered->write("abc", 3);
+		buffered->write("de", 2);
+		ensure_equals("Buffered", out->calls, 0u);
+		buffered->write(large.c_str(), large.size());
+		ensure_equals("One call for the buffer and the large write", out->calls, 1u);
+		ensure_equals(out->data, "abcde" + large);
+
+		IOVector parts[3];
+		parts[0].data = "12";
+		parts[0].size = 2;
+		parts[1].data = "";
+		parts[1].size = 0;
+		parts[2].data = "345";
+		parts[2].size = 3;
+		ensure_equals("Gathered", buffered->writev(parts, 3), 5u);
+		ensure_equals("Fits in the buffer", out->calls, 1u);
+		buffered->flush();
+		ensure_equals(out->calls, 2u);
+		ensure_equals(out->data, "abcde" + large + "12345");
+
+		buffered->unref();
+		out->unref();
+	}
+
+	// Partial writes of the wrapped stream are retried
+	TEST_METHOD(2) {
+		RecordingOutputStream *out = new RecordingOutputStream(7);
+		BufferedOutputStream *buffered = new BufferedOutputStream(out, 4);
+		std::string expected;
+
+		for (int i = 0; i < 20; i++) {
+			std::string part(i + 1, 'a' + i);
+			buffered->write(part.c_str(), part.size());
+			expected += part;
+		}
+		buffered->flush();
+		ensure_equals("Everything arrives in order", out->data, expected);
+
+		buffered->unref();
+		out->unref();
+	}
+
+	// Small reads come from the buffer, peek doesn't consume
+	TEST_METHOD(3) {
+		std::string data;
+		for (int i = 0; i < 1000; i++) {
+			data += (char) ('a' + i % 26);
+		}
+		StringInputStream *in = new StringInputStream(data, 1000);
+		BufferedInputStream *buffered = new BufferedInputStream(in, 64);
+		std::string result;
+		char buf[10];
+		int n;
+
+		ensure_equals("Peek", buffered->peek(buf, 5), 5);
+		ensure_equals(std::string(buf, 5), "abcde");
+		ensure_equals("Read ahead once", in->calls, 1u);
+		ensure_equals(buffered->available(), 64u);
+		while ((n = buffered->read(buf, 3)) != -1) {
+			result.append(buf, n);
+		}
+		ensure_equals("Everything read in order", result, data);
+		ensure("Few reads on the wrapped stream", in->calls < 1000 / 3 / 4);
+		ensure("End of the stream", buffered->eof());
+		ensure_equals("Nothing to peek at", buffered->peek(buf, 1), -1);
+
+		buffered->unref();
+		in->unref();
+	}
+
+	// readahead gathers several short reads; large reads bypass the buffer
+	TEST_METHOD(4) {
+		std::string data(200, 'z');
+		StringInputStream *in = new StringInputStream(data, 10);
+		BufferedInputStream *buffered = new BufferedInputStream(in, 50);
+		char buf[200];
+
+		ensure_equals("Read ahead", buffered->readahead(35), 40u);
+		ensure_equals(in->calls, 4u);
+		ensure_equals("Limited to the buffer size", buffered->readahead(1000), 50u);
+		ensure_equals("From the buffer", buffered->read(buf, 200), 50);
+		ensure_equals("Straight from the stream", buffered->read(buf, 200), 10);
+		ensure_equals(buffered->available(), 0u);
+
+		buffered->unref();
+		in->unref();
+	}
+
+	// Gathered writes and buffered reads over a real socket
+	TEST_METHOD(5) {
+		ServerSocket *server = ServerSocket::create("127.0.0.1", 0);
+		Socket *client = Socket::create("127.0.0.1", server->getPort());
+		Socket *accepted = server->accept();
+		BufferedOutputStream *out = new BufferedOutputStream(client->getOutputStream(), 16);
+		BufferedInputStream *in = new BufferedInputStream(accepted->getInputStream(), 32);
+		std::string large(5000, 'q');
+		std::string result;
+		char buf[100];
+
+		out->write("hello ", 6);
+		IOVector parts[2];
+		parts[0].data = large.c_str();
+		parts[0].size = large.size();
+		parts[1].data = " world";
+		parts[1].size = 6;
+		out->writev(parts, 2);
+		out->close();
+
+		while (true) {
+			int n = in->read(buf, sizeof(buf));
+			if (n == -1) {
+				break;
+			}
+			result.append(buf, n);
+		}
+		ensure_equals(result, "hello " + large + " world");
+
+		in->unref();
+		out->unref();
+		accepted->unref();
+		client->unref();
+		server->unref();
+	}
+}
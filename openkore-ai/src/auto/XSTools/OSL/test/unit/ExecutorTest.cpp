@@ -0,0 +1,222 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  Unit tests
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#include "tut.h"
+#include "../../Threading/Executor.h"
+#include "../../Threading/Atomic.h"
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <sched.h>
+#endif
+
+/*
+ * Test case for OSL::Executor and OSL::Task
+ */
+namespace tut {
+	struct ExecutorTest {
+	};
+
+	DEFINE_TEST_GROUP(ExecutorTest);
+
+	#define TASKS 1000
+
+	static void
+	executorYield() {
+		#ifdef WIN32
+			Sleep(0);
+		#else
+			sched_yield();
+		#endif
+	}
+
+	// Adds to a shared counter
+	class CountingTask: public Task {
+	public:
+		Atomic::Integer *counter;
+
+		virtual void run() {
+			Atomic::increment(*counter);
+		}
+	};
+
+	// Runs until it is cancelled, telling when it started
+	class BlockingTask: public Task {
+	public:
+		Atomic::Integer started;
+
+		BlockingTask() {
+			Atomic::store(started, 0);
+		}
+
+		virtual void run() {
+			Atomic::store(started, 1);
+			while (!isCancelled()) {
+				executorYield();
+			}
+		}
+	};
+
+	// Splits a sum over subtasks, which it submits and waits for
+	class SumTask: public Task {
+	public:
+		Executor *executor;
+		int from, to;
+		long long result;
+
+		virtual void run() {
+			if (to - from <= 16) {
+				result = 0;
+				for (int i = from; i < to; i++) {
+					result += i;
+				}
+			} else {
+				SumTask left, right;
+
+				left.executor = right.executor = executor;
+				left.from = from;
+				left.to = right.from = (from + to) / 2;
+				right.to = to;
+				executor->submit(&left);
+				executor->submit(&right);
+				left.wait();
+				right.wait();
+				result = left.result + right.result;
+			}
+		}
+	};
+
+	// Without threads, tasks run in the submitting thread
+	TEST_METHOD(1) {
+		Executor executor;
+		Atomic::Integer counter;
+		CountingTask task;
+
+		Atomic::store(counter, 0);
+		task.counter = &counter;
+		ensure_equals("Not started", executor.getThreadCount(), 0u);
+		ensure_equals("Idle at first", task.getStatus(), Task::IDLE);
+		executor.submit(&task);
+		ensure("Done right away", task.isDone());
+		ensure_equals("Ran", task.getStatus(), Task::DONE);
+		ensure_equals("Ran once", Atomic::load(counter), 1);
+		task.wait();
+		ensure("Nothing to cancel", !task.cancel());
+	}
+
+	// Many tasks on several threads each run once
+	TEST_METHOD(2) {
+		Executor executor;
+		Atomic::Integer counter;
+		CountingTask *tasks = new CountingTask[TASKS];
+
+		Atomic::store(counter, 0);
+		ensure_equals("Started", executor.start(4), 4u);
+		ensure_equals("Already started", executor.start(2), 4u);
+		for (int i = 0; i < TASKS; i++) {
+			tasks[i].counter = &counter;
+			executor.submit(&tasks[i]);
+		}
+		for (int i = 0; i < TASKS; i++) {
+			tasks[i].wait();
+			ensure_equals("Done", tasks[i].getStatus(), Task::DONE);
+		}
+		ensure_equals("Each task ran once", Atomic::load(counter), TASKS);
+
+		// Tasks can run again once they are done
+		for (int i = 0; i < TASKS; i++) {
+			executor.submit(&tasks[i]);
+		}
+		executor.stop();
+		ensure_equals("Queued tasks ran before stopping", Atomic::load(counter), 2 * TASKS);
+		ensure_equals("Stopped", executor.getThreadCount(), 0u);
+		delete[] tasks;
+	}
+
+	// Queued tasks can be cancelled, running ones are told to stop
+	TEST_METHOD(3) {
+		Executor executor;
+		BlockingTask blocker;
+		CountingTask task;
+		Atomic::Integer counter;
+
+		Atomic::store(counter, 0);
+		task.counter = &counter;
+		executor.start(1);
+		executor.submit(&blocker);
+		while (!Atomic::load(blocker.started)) {
+			executorYield();
+		}
+		executor.submit(&task);
+		ensure_equals("Waits for the only thread", task.getStatus(), Task::QUEUED);
+		ensure("Cancelled while queued", task.cancel());
+		ensure("Done once cancelled", task.isDone());
+		ensure_equals("Cancelled", task.getStatus(), Task::CANCELLED);
+		task.wait();
+
+		ensure("Cannot stop a running task", !blocker.cancel());
+		ensure("Told to stop", blocker.isCancelled());
+		blocker.wait();
+		ensure_equals("Stopped by itself", blocker.getStatus(), Task::DONE);
+		executor.stop();
+		ensure_equals("Cancelled task never ran", Atomic::load(counter), 0);
+	}
+
+	// Tasks which wait for the tasks they submit don't run out of threads
+	TEST_METHOD(4) {
+		Executor executor;
+		SumTask sum;
+
+		executor.start(2);
+		sum.executor = &executor;
+		sum.from = 0;
+		sum.to = 100000;
+		executor.submit(&sum);
+		sum.wait();
+		ensure_equals("Sum", sum.result, 100000LL * 99999 / 2);
+
+		// A task which no thread took yet runs in the waiting thread
+		BlockingTask blockers[2];
+		CountingTask task;
+		Atomic::Integer counter;
+
+		Atomic::store(counter, 0);
+		task.counter = &counter;
+		executor.submit(&blockers[0]);
+		executor.submit(&blockers[1]);
+		while (!Atomic::load(blockers[0].started) || !Atomic::load(blockers[1].started)) {
+			executorYield();
+		}
+		executor.submit(&task);
+		task.wait();
+		ensure_equals("Ran in this thread", Atomic::load(counter), 1);
+		blockers[0].cancel();
+		blockers[1].cancel();
+		executor.stop();
+	}
+
+	// The shared executor
+	TEST_METHOD(5) {
+		ensure("Shared", Executor::getInstance() == Executor::getInstance());
+		ensure("Processors", Executor::getProcessorCount() >= 1);
+	}
+}
@@ -0,0 +1,137 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  Unit tests
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#include "tut.h"
+#include "../../Threading/MpscQueue.h"
+#include "../../Threading/Thread.h"
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <sched.h>
+#endif
+
+/*
+ * Test case for OSL::MpscQueue
+ */
+namespace tut {
+	struct MpscQueueTest {
+	};
+
+	DEFINE_TEST_GROUP(MpscQueueTest);
+
+	// Lets the other threads run while waiting, which they may need to
+	// make progress on a single processor
+	static void
+	mpscYield() {
+		#ifdef WIN32
+			Sleep(0);
+		#else
+			sched_yield();
+		#endif
+	}
+
+	#define MPSC_PRODUCERS 4
+	#define MPSC_ITEMS 250000
+
+	// Pushes its id in the upper bits and 1 to MPSC_ITEMS in the lower bits,
+	// waiting while the queue is full
+	class MpscProducer: public Thread {
+	public:
+		MpscQueue<int> *queue;
+		int id;
+
+		virtual void run() {
+			for (int i = 1; i <= MPSC_ITEMS; i++) {
+				while (!queue->push((id << 24) | i)) {
+					mpscYield();
+				}
+			}
+		}
+	};
+
+	// Items come out as they went in, until the queue is full or empty
+	TEST_METHOD(1) {
+		MpscQueue<int> queue(5);
+		int item;
+
+		ensure_equals("Capacity is rounded up", queue.capacity(), 8u);
+		ensure("Empty at first", queue.empty());
+		ensure("Nothing to pop", !queue.pop(item));
+		for (int i = 0; i < 8; i++) {
+			ensure("Push", queue.push(i));
+		}
+		ensure("Full", !queue.push(8));
+		for (int i = 0; i < 8; i++) {
+			ensure("Pop", queue.pop(item));
+			ensure_equals("In order", item, i);
+		}
+		ensure("Empty again", queue.empty());
+		ensure("Nothing to pop", !queue.pop(item));
+	}
+
+	// Many rounds through the cells
+	TEST_METHOD(2) {
+		MpscQueue<int> queue(4);
+		int item;
+
+		for (int i = 0; i < 1000; i++) {
+			ensure("Push", queue.push(i));
+			ensure("Push", queue.push(-i));
+			ensure("Pop", queue.pop(item));
+			ensure_equals(item, i);
+			ensure("Pop", queue.pop(item));
+			ensure_equals(item, -i);
+		}
+		ensure("Empty", queue.empty());
+	}
+
+	// Several producer threads and this thread as the consumer; nothing is
+	// lost or duplicated, and each producer's items stay in order
+	TEST_METHOD(3) {
+		MpscQueue<int> queue(64);
+		MpscProducer producers[MPSC_PRODUCERS];
+		int last[MPSC_PRODUCERS];
+		int item, received = 0;
+
+		for (int i = 0; i < MPSC_PRODUCERS; i++) {
+			last[i] = 0;
+			producers[i].queue = &queue;
+			producers[i].id = i;
+			producers[i].start();
+		}
+		while (received < MPSC_PRODUCERS * MPSC_ITEMS) {
+			if (!queue.pop(item)) {
+				mpscYield();
+			} else {
+				int id = item >> 24;
+				ensure("Valid producer", id >= 0 && id < MPSC_PRODUCERS);
+				ensure_equals("A producer's items arrive in order", item & 0xFFFFFF, last[id] + 1);
+				last[id]++;
+				received++;
+			}
+		}
+		for (int i = 0; i < MPSC_PRODUCERS; i++) {
+			producers[i].join();
+		}
+		ensure("Nothing left", !queue.pop(item));
+	}
+}
@@ -0,0 +1,210 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  Unit tests
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#include "tut.h"
+#include <string.h>
+#include <stdexcept>
+#include "../../Memory/Pool.h"
+#include "../../Threading/SpscQueue.h"
+#include "../../Threading/Thread.h"
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <sched.h>
+#endif
+
+/*
+ * Test case for OSL::Memory::Pool and the size class allocator
+ */
+namespace tut {
+	struct PoolTest {
+	};
+
+	DEFINE_TEST_GROUP(PoolTest);
+
+	using namespace OSL::Memory;
+
+	static void
+	poolYield() {
+		#ifdef WIN32
+			Sleep(0);
+		#else
+			sched_yield();
+		#endif
+	}
+
+	static int pooledAlive = 0;
+
+	struct Pooled {
+		int a;
+		char b[40];
+
+		Pooled() {
+			a = 0;
+			b[0] = '\0';
+			pooledAlive++;
+		}
+
+		Pooled(int a, const char *b) {
+			if (a < 0) {
+				throw std::invalid_argument("a");
+			}
+			this->a = a;
+			strcpy(this->b, b);
+			pooledAlive++;
+		}
+
+		~Pooled() {
+			pooledAlive--;
+		}
+	};
+
+	#define POOL_BLOCKS 100000
+
+	// Allocates numbered blocks of all sizes for another thread to free
+	class PoolProducer: public Thread {
+	public:
+		SpscQueue<unsigned int *> *queue;
+
+		virtual void run() {
+			for (unsigned int i = 0; i < POOL_BLOCKS; i++) {
+				unsigned int *block = (unsigned int *) allocate(sizeSent(i));
+				block[0] = i;
+				while (!queue->push(block)) {
+					poolYield();
+				}
+			}
+		}
+
+		static size_t sizeSent(unsigned int i) {
+			return sizeof(unsigned int) + (i % MAX_BLOCK_SIZE);
+		}
+	};
+
+	// Sizes are rounded up to a size class, unless they're too big
+	TEST_METHOD(1) {
+		ensure_equals(blockSize(0), MIN_BLOCK_SIZE);
+		ensure_equals(blockSize(1), MIN_BLOCK_SIZE);
+		ensure_equals(blockSize(16), (size_t) 16);
+		ensure_equals(blockSize(17), (size_t) 32);
+		ensure_equals(blockSize(1000), (size_t) 1024);
+		ensure_equals(blockSize(MAX_BLOCK_SIZE), MAX_BLOCK_SIZE);
+		ensure_equals(blockSize(MAX_BLOCK_SIZE + 1), MAX_BLOCK_SIZE + 1);
+	}
+
+	// Blocks don't overlap, are aligned, and a freed block is reused
+	TEST_METHOD(2) {
+		char *blocks[64];
+
+		for (int i = 0; i < 64; i++) {
+			blocks[i] = (char *) allocate(24);
+			ensure("Allocated", blocks[i] != NULL);
+			ensure_equals("Aligned", (size_t) blocks[i] % sizeof(double), (size_t) 0);
+			memset(blocks[i], i, 24);
+		}
+		for (int i = 0; i < 64; i++) {
+			for (int j = 0; j < 24; j++) {
+				ensure_equals("Not overwritten", (int) blocks[i][j], i);
+			}
+		}
+
+		deallocate(blocks[10], 24);
+		ensure("A freed block is the next one used", allocate(20) == blocks[10]);
+		for (int i = 0; i < 64; i++) {
+			deallocate(blocks[i], 24);
+		}
+		deallocate(NULL, 24);
+	}
+
+	// Large blocks
+	TEST_METHOD(3) {
+		size_t size = MAX_BLOCK_SIZE * 4;
+		char *block = (char *) allocate(size);
+
+		ensure("Allocated", block != NULL);
+		memset(block, 'x', size);
+		ensure_equals(block[size - 1], 'x');
+		deallocate(block, size);
+	}
+
+	// Objects are constructed and destructed
+	TEST_METHOD(4) {
+		Pooled *first = Pool<Pooled>::create();
+		Pooled *second = Pool<Pooled>::create(5, "five");
+
+		ensure_equals(pooledAlive, 2);
+		ensure_equals(first->a, 0);
+		ensure_equals(second->a, 5);
+		ensure_equals(std::string(second->b), "five");
+		Pool<Pooled>::destroy(first);
+		Pool<Pooled>::destroy(second);
+		Pool<Pooled>::destroy(NULL);
+		ensure_equals(pooledAlive, 0);
+
+		try {
+			Pool<Pooled>::create(-1, "");
+			fail("Construction should have thrown");
+		} catch (const std::invalid_argument &) {
+			ensure_equals(pooledAlive, 0);
+		}
+	}
+
+	// Copies of strings
+	TEST_METHOD(5) {
+		char *empty = duplicate("");
+		char *copy = duplicate("hello world");
+
+		ensure_equals(std::string(empty), "");
+		ensure_equals(std::string(copy), "hello world");
+		release(empty);
+		release(copy);
+		release(NULL);
+	}
+
+	// Blocks allocated in one thread and freed in another
+	TEST_METHOD(6) {
+		SpscQueue<unsigned int *> queue(256);
+		PoolProducer producer;
+		unsigned int *block;
+		unsigned int expected = 0;
+
+		producer.queue = &queue;
+		producer.start();
+		while (expected < POOL_BLOCKS) {
+			if (!queue.pop(block)) {
+				poolYield();
+			} else {
+				ensure_equals("Blocks keep their contents", block[0], expected);
+				deallocate(block, PoolProducer::sizeSent(expected));
+				expected++;
+			}
+		}
+		producer.join();
+
+		// What the producer's cache held is available again
+		for (unsigned int i = 0; i < 1000; i++) {
+			block = (unsigned int *) allocate(PoolProducer::sizeSent(i));
+			ensure("Allocated", block != NULL);
+			deallocate(block, PoolProducer::sizeSent(i));
+		}
+	}
+}
@@ -0,0 +1,287 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  Unit tests
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <string.h>
+#include "tut.h"
+#include "../../Net/Reactor.h"
+#include "../../Threading/Executor.h"
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <unistd.h>
+#endif
+
+/*
+ * Test case for OSL::Reactor and non-blocking sockets
+ */
+namespace tut {
+	struct ReactorTest {
+	};
+
+	DEFINE_TEST_GROUP(ReactorTest);
+
+	#define CLIENTS 20
+
+	// Sends back whatever a client sends
+	class EchoHandler: public Reactor::Handler {
+	public:
+		Socket *socket;
+		unsigned int *closed;
+
+		virtual void handleEvents(Reactor *reactor, int events) {
+			char buffer[256];
+			int size = socket->getInputStream()->read(buffer, sizeof(buffer));
+
+			if (size == -1) {
+				reactor->remove(socket);
+				socket->unref();
+				(*closed)++;
+				delete this;
+			} else if (size > 0) {
+				socket->getOutputStream()->write(buffer, size);
+			}
+		}
+	};
+
+	// Accepts clients and registers an EchoHandler for each of them
+	class AcceptHandler: public Reactor::Handler {
+	public:
+		ServerSocket *server;
+		unsigned int accepted;
+		unsigned int closed;
+
+		virtual void handleEvents(Reactor *reactor, int events) {
+			Socket *client;
+
+			while ((client = server->accept()) != NULL) {
+				EchoHandler *handler = new EchoHandler();
+
+				client->setBlocking(false);
+				handler->socket = client;
+				handler->closed = &closed;
+				reactor->add(client, Reactor::READABLE, handler);
+				accepted++;
+			}
+		}
+	};
+
+	// Collects what the echo server sends back
+	class ClientHandler: public Reactor::Handler {
+	public:
+		Socket *socket;
+		std::string received;
+
+		virtual void handleEvents(Reactor *reactor, int events) {
+			char buffer[256];
+			int size = socket->getInputStream()->read(buffer, sizeof(buffer));
+
+			if (size > 0) {
+				received.append(buffer, size);
+			}
+		}
+	};
+
+	// Counts its calls
+	class CountingHandler: public Reactor::Handler {
+	public:
+		unsigned int calls;
+		int events;
+		Socket *other;
+
+		CountingHandler() {
+			calls = 0;
+			events = 0;
+			other = NULL;
+		}
+
+		virtual void handleEvents(Reactor *reactor, int events) {
+			calls++;
+			this->events = events;
+			if (other != NULL) {
+				reactor->remove(other);
+				other = NULL;
+			}
+		}
+	};
+
+	// Calls Reactor::wakeup() from one of the executor's threads
+	class WakeupTask: public Task {
+	public:
+		Reactor *reactor;
+
+		virtual void run() {
+			#ifdef WIN32
+				Sleep(50);
+			#else
+				usleep(50000);
+			#endif
+			reactor->wakeup();
+		}
+	};
+
+	static void
+	connectPair(ServerSocket *server, Socket *&client, Socket *&accepted) {
+		client = Socket::create("127.0.0.1", server->getPort());
+		accepted = server->accept();
+		client->setBlocking(false);
+		accepted->setBlocking(false);
+	}
+
+	// Non-blocking sockets don't wait
+	TEST_METHOD(1) {
+		ServerSocket *server = ServerSocket::create("127.0.0.1", 0);
+		Socket *client, *accepted;
+		char buffer[16];
+
+		server->setBlocking(false);
+		ensure("Nobody to accept", server->accept() == NULL);
+		server->setBlocking(true);
+
+		connectPair(server, client, accepted);
+		ensure_equals("No data yet", client->getInputStream()->read(buffer, sizeof(buffer)), 0);
+		ensure_equals(accepted->getOutputStream()->write("abc", 3), 3u);
+		accepted->getOutputStream()->close();
+
+		Reactor *reactor = new Reactor();
+		CountingHandler handler;
+		reactor->add(client, Reactor::READABLE, &handler);
+		ensure_equals(reactor->run(1000), 1u);
+		ensure_equals(handler.events, (int) Reactor::READABLE);
+		ensure_equals(client->getInputStream()->read(buffer, sizeof(buffer)), 3);
+		ensure_equals("End of stream", client->getInputStream()->read(buffer, sizeof(buffer)), -1);
+		reactor->remove(client);
+		ensure_equals(reactor->getCount(), 0u);
+
+		reactor->unref();
+		accepted->unref();
+		client->unref();
+		server->unref();
+	}
+
+	// One thread serves many clients
+	TEST_METHOD(2) {
+		ServerSocket *server = ServerSocket::create("127.0.0.1", 0);
+		Reactor *reactor = new Reactor();
+		AcceptHandler acceptor;
+		std::vector<ClientHandler *> clients;
+
+		server->setBlocking(false);
+		acceptor.server = server;
+		acceptor.accepted = 0;
+		acceptor.closed = 0;
+		reactor->add(server, Reactor::READABLE, &acceptor);
+
+		for (int i = 0; i < CLIENTS; i++) {
+			ClientHandler *client = new ClientHandler();
+			client->socket = Socket::create("127.0.0.1", server->getPort());
+			client->socket->setBlocking(false);
+			reactor->add(client->socket, Reactor::READABLE, client);
+			clients.push_back(client);
+			// Accept right away, the backlog is small
+			while (acceptor.accepted < clients.size()) {
+				reactor->run(1000);
+			}
+		}
+		ensure_equals(reactor->getCount(), (unsigned int) (1 + 2 * CLIENTS));
+
+		for (int i = 0; i < CLIENTS; i++) {
+			char message[32];
+			int len = snprintf(message, sizeof(message), "hello %d", i);
+			clients[i]->socket->getOutputStream()->write(message, len);
+		}
+		for (int i = 0; i < CLIENTS; i++) {
+			char message[32];
+			snprintf(message, sizeof(message), "hello %d", i);
+			while (clients[i]->received.size() < strlen(message)) {
+				ensure("Handlers called", reactor->run(1000) > 0);
+			}
+			ensure_equals("Echoed", clients[i]->received, std::string(message));
+		}
+
+		for (int i = 0; i < CLIENTS; i++) {
+			reactor->remove(clients[i]->socket);
+			clients[i]->socket->unref();
+			delete clients[i];
+		}
+		while (acceptor.closed < CLIENTS) {
+			reactor->run(1000);
+		}
+		ensure_equals("Only the server left", reactor->getCount(), 1u);
+
+		reactor->unref();
+		server->unref();
+	}
+
+	// Removed sockets aren't handled anymore, sockets without events aren't waited for
+	TEST_METHOD(3) {
+		ServerSocket *server = ServerSocket::create("127.0.0.1", 0);
+		Reactor *reactor = new Reactor();
+		Socket *client1, *accepted1, *client2, *accepted2;
+		CountingHandler handler1, handler2;
+
+		connectPair(server, client1, accepted1);
+		connectPair(server, client2, accepted2);
+		handler1.other = client2;
+		handler2.other = client1;
+		reactor->add(client1, Reactor::WRITABLE, &handler1);
+		reactor->add(client2, Reactor::WRITABLE, &handler2);
+		ensure_equals("Only one handler called", reactor->run(1000), 1u);
+		ensure_equals(handler1.calls + handler2.calls, 1u);
+		ensure_equals(reactor->getCount(), 1u);
+
+		Socket *left = (handler1.calls == 1) ? client1 : client2;
+		reactor->modify(left, 0);
+		ensure_equals("Not waited for", reactor->run(0), 0u);
+		reactor->modify(left, Reactor::WRITABLE);
+		ensure_equals("Waited for again", reactor->run(1000), 1u);
+		reactor->remove(left);
+
+		reactor->unref();
+		accepted1->unref();
+		client1->unref();
+		accepted2->unref();
+		client2->unref();
+		server->unref();
+	}
+
+	// wakeup() interrupts run()
+	TEST_METHOD(4) {
+		Reactor *reactor = new Reactor();
+		Executor executor;
+		WakeupTask task;
+
+		reactor->wakeup();
+		ensure_equals("Returns right away", reactor->run(-1), 0u);
+
+		executor.start(1);
+		task.reactor = reactor;
+		executor.submit(&task);
+		ensure_equals("Woken up by another thread", reactor->run(-1), 0u);
+		task.wait();
+		executor.stop();
+
+		reactor->unref();
+	}
+}
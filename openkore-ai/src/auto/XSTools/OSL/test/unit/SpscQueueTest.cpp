@@ -0,0 +1,123 @@
+/*
+ *  OpenKore C++ Standard Library
+ *  Copyright (C) 2006  VCL
+ *
+ *  Unit tests
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ *  MA  02110-1301  USA
+ */
+
+#include "tut.h"
+#include "../../Threading/SpscQueue.h"
+#include "../../Threading/Thread.h"
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <sched.h>
+#endif
+
+/*
+ * Test case for OSL::SpscQueue
+ */
+namespace tut {
+	struct SpscQueueTest {
+	};
+
+	DEFINE_TEST_GROUP(SpscQueueTest);
+
+	// Lets the other threads run while waiting, which they may need to
+	// make progress on a single processor
+	static void
+	spscYield() {
+		#ifdef WIN32
+			Sleep(0);
+		#else
+			sched_yield();
+		#endif
+	}
+
+	#define SPSC_ITEMS 1000000
+
+	// Pushes 1 to SPSC_ITEMS, waiting while the queue is full
+	class SpscProducer: public Thread {
+	public:
+		SpscQueue<int> *queue;
+
+		virtual void run() {
+			for (int i = 1; i <= SPSC_ITEMS; i++) {
+				while (!queue->push(i)) {
+					spscYield();
+				}
+			}
+		}
+	};
+
+	// Items come out as they went in, until the queue is full or empty
+	TEST_METHOD(1) {
+		SpscQueue<int> queue(5);
+		int item;
+
+		ensure_equals("Capacity is rounded up", queue.capacity(), 8u);
+		ensure("Empty at first", queue.empty());
+		ensure("Nothing to pop", !queue.pop(item));
+		for (int i = 0; i < 8; i++) {
+			ensure("Push", queue.push(i));
+		}
+		ensure("Full", !queue.push(8));
+		for (int i = 0; i < 8; i++) {
+			ensure("Pop", queue.pop(item));
+			ensure_equals("In order", item, i);
+		}
+		ensure("Empty again", queue.empty());
+		ensure("Nothing to pop", !queue.pop(item));
+	}
+
+	// Many rounds through the buffer
+	TEST_METHOD(2) {
+		SpscQueue<int> queue(4);
+		int item;
+
+		for (int i = 0; i < 1000; i++) {
+			ensure("Push", queue.push(i));
+			ensure("Push", queue.push(-i));
+			ensure("Pop", queue.pop(item));
+			ensure_equals(item, i);
+			ensure("Pop", queue.pop(item));
+			ensure_equals(item, -i);
+		}
+		ensure("Empty", queue.empty());
+	}
+
+	// A producer thread and this thread as the consumer
+	TEST_METHOD(3) {
+		SpscQueue<int> queue(64);
+		SpscProducer producer;
+		int item, expected = 1;
+
+		producer.queue = &queue;
+		producer.start();
+		while (expected <= SPSC_ITEMS) {
+			if (!queue.pop(item)) {
+				spscYield();
+			} else {
+				ensure_equals("Items arrive in order", item, expected);
+				expected++;
+			}
+		}
+		producer.join();
+		ensure("Nothing left", !queue.pop(item));
+	}
+}
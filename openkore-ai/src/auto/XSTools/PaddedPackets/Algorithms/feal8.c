@@ -10,7 +10,7 @@
 #endif
 
 
-typedef unsigned long HalfWord;
+typedef dword HalfWord;
 typedef unsigned int QuarterWord;
 
 static QuarterWord K[16];
@@ -125,7 +125,7 @@ static HalfWord f( HalfWord AA, QuarterWord BB )
 {
     unsigned char f1, f2 ;
     union {
-     unsigned long All ;
+     HalfWord All ;
      unsigned char Byte[4] ;
     } RetVal, A ;
     union {
@@ -153,7 +153,7 @@ static HalfWord FK( HalfWord AA, HalfWord BB )
 {
     unsigned char FK1, FK2 ;
     union {
-     unsigned long All ;
+     HalfWord All ;
      unsigned char Byte[4] ;
     } RetVal, A, B ;
 
@@ -176,7 +176,7 @@ static HalfWord FK( HalfWord AA, HalfWord BB )
 static HalfWord MakeH1( unsigned char *B )
 {
     union {
-     unsigned long All ;
+     HalfWord All ;
      unsigned char Byte[4] ;
     } RetVal ;
 
@@ -1,6 +1,8 @@
 #ifndef _FEAL8_H_
 #define _FEAL8_H_
 
+#include "../typedefs.h"
+
 #ifdef __cplusplus
 	extern "C" {
 #endif
@@ -7,10 +7,99 @@
 
 using namespace OpenKore::PaddedPackets;
 
-static Engine engine;
-static dword lastTargetId = 0;
-static word sitPacketID = 0x89;
-static word skillPacketID = 0x113;
+/**
+ * An Engine with the state of one account: its sync values, the packet
+ * IDs of its server and the target of its last attack. Exposed to Perl
+ * as Network::PaddedPackets::Engine; the functions of
+ * Network::PaddedPackets use a global one.
+ */
+class AccountEngine {
+public:
+	AccountEngine() {
+		lastTargetId = 0;
+		sitPacketID = 0x89;
+		skillPacketID = 0x113;
+	}
+
+	unsigned int createSitStand(byte *packet, bool sit) {
+		engine.addKey(lastTargetId);
+		lastTargetId = 0;
+		engine.addKey(sit ? 2 : 3);
+		return engine.encode(packet, sitPacketID);
+	}
+
+	unsigned int createAtk(byte *packet, dword targetId) {
+		engine.addKey(targetId);
+		engine.addKey(7);
+		return engine.encode(packet, sitPacketID);
+	}
+
+	unsigned int createSkillUse(byte *packet, dword skillId, dword skillLv, dword targetId) {
+		engine.addKey(skillLv);
+		engine.addKey(skillId);
+		engine.addKey(targetId);
+		return engine.encode(packet, skillPacketID);
+	}
+
+	Engine engine;
+	dword lastTargetId;
+	word sitPacketID;
+	word skillPacketID;
+};
+
+static AccountEngine engine;
+
+/* The packets of createBatch() are encoded here, no packet is longer */
+#define PADDED_PACKET_MAXLEN 256
+
+typedef AccountEngine * Network_PaddedPackets_Engine;
+
+/* Returns the engine of an item of createBatch(), NULL if it isn't one */
+static AccountEngine *
+PaddedPackets_engineOf (SV **sv)
+{
+	if (sv == NULL || !sv_isobject(*sv) || !sv_derived_from(*sv, "Network::PaddedPackets::Engine")) {
+		return NULL;
+	}
+	return (AccountEngine *) SvIV((SV *) SvRV(*sv));
+}
+
+/* Argument 'index' of a request of createBatch(), 0 when it's missing */
+static dword
+PaddedPackets_argument (AV *request, I32 index)
+{
+	SV **arg = av_fetch(request, index, 0);
+	return arg != NULL ? (dword) SvUV(*arg) : 0;
+}
+
+/* Decodes the keys of a packet in place, as pack("V*") of the keys, less
+   of them if the packet is too short */
+static SV *
+PaddedPackets_decodeKeys (Engine &engine, SV *packet, unsigned int keyCount)
+{
+	STRLEN len;
+	const byte *data = (const byte *) SvPVbyte(packet, len);
+	dword *keys;
+	unsigned int count, i;
+	SV *result;
+	unsigned char *out;
+
+	Newx(keys, keyCount, dword);
+	count = engine.decode(data, (unsigned int) len, keys, keyCount);
+	result = newSV(count * 4 + 1);
+	SvPOK_only(result);
+	out = (unsigned char *) SvPVX(result);
+	for (i = 0; i < count; i++) {
+		out[i * 4] = keys[i] & 0xFF;
+		out[i * 4 + 1] = (keys[i] >> 8) & 0xFF;
+		out[i * 4 + 2] = (keys[i] >> 16) & 0xFF;
+		out[i * 4 + 3] = (keys[i] >> 24) & 0xFF;
+	}
+	out[count * 4] = '\0';
+	SvCUR_set(result, count * 4);
+	Safefree(keys);
+	return result;
+}
 
 
 MODULE = Network::PaddedPackets		PACKAGE = Network::PaddedPackets
@@ -22,10 +111,7 @@ createSitStand(packet, sit)
 	char *packet
 	unsigned int sit
 CODE:
-	engine.addKey(lastTargetId);
-	lastTargetId = 0;
-	engine.addKey(sit ? 2 : 3);
-	RETVAL = engine.encode((byte *) packet, sitPacketID);
+	RETVAL = engine.createSitStand((byte *) packet, sit != 0);
 OUTPUT:
 	RETVAL
 
@@ -36,9 +122,7 @@ createAtk(packet, targetId, ctrl)
 	unsigned int ctrl
 CODE:
 	ctrl = ctrl + 1; // Shut up compiler warning.
-	engine.addKey(targetId);
-	engine.addKey(7);
-	RETVAL = engine.encode((byte *) packet, sitPacketID);
+	RETVAL = engine.createAtk((byte *) packet, targetId);
 OUTPUT:
 	RETVAL
 
@@ -49,10 +133,7 @@ createSkillUse(packet, skillId, skillLv, targetId)
 	unsigned int skillLv
 	unsigned int targetId
 CODE:
-	engine.addKey(skillLv);
-	engine.addKey(skillId);
-	engine.addKey(targetId);
-	RETVAL = engine.encode((byte *) packet, skillPacketID);
+	RETVAL = engine.createSkillUse((byte *) packet, skillId, skillLv, targetId);
 OUTPUT:
 	RETVAL
 
@@ -60,19 +141,19 @@ void
 setMapSync(mapSync)
 	unsigned int mapSync
 CODE:
-	engine.setMapSync(mapSync);
+	engine.engine.setMapSync(mapSync);
 
 void
 setSync(sync)
 	unsigned int sync
 CODE:
-	engine.setSync(sync);
+	engine.engine.setSync(sync);
 
 void
 setAccountId(accountId)
 	unsigned int accountId
 CODE:
-	engine.setAccId(accountId);
+	engine.engine.setAccId(accountId);
 
 void
 setPacket(packet, packetLength, targetId)
@@ -80,28 +161,181 @@ setPacket(packet, packetLength, targetId)
 	unsigned int packetLength
 	unsigned int targetId
 CODE:
-	engine.setPacket((byte *) packet, packetLength);
-	lastTargetId = targetId;
+	engine.engine.setPacket((byte *) packet, packetLength);
+	engine.lastTargetId = targetId;
 
 void
 setPacketIDs(sit, skill)
 	unsigned short sit
 	unsigned short skill
 CODE:
-	sitPacketID = sit;
-	skillPacketID = skill;
+	engine.sitPacketID = sit;
+	engine.skillPacketID = skill;
 
 void
 decodePacket(packet, keyCount)
 	char *packet
 	unsigned int keyCount
 CODE:
-	engine.decode((byte *) packet, keyCount);
+	engine.engine.decode((byte *) packet, keyCount);
 
 unsigned int
 getKey(keyIndex)
 	unsigned int keyIndex
 CODE:
-	RETVAL = engine.getKey(keyIndex);
+	RETVAL = engine.engine.getKey(keyIndex);
+OUTPUT:
+	RETVAL
+
+SV *
+decodeKeys(packet, keyCount)
+	SV *packet
+	unsigned int keyCount
+CODE:
+	RETVAL = PaddedPackets_decodeKeys(engine.engine, packet, keyCount);
+OUTPUT:
+	RETVAL
+
+void
+createBatch(requests)
+	SV *requests
+PREINIT:
+	AV *list;
+	I32 count, i;
+	byte packet[PADDED_PACKET_MAXLEN];
+PPCODE:
+	/* requests should be a reference to an array of
+	   [engine, "sit" | "stand" | "attack" | "skill", arguments...] */
+	if (!SvROK(requests) || SvTYPE(SvRV(requests)) != SVt_PVAV) {
+		croak("createBatch: requests is not an array reference");
+	}
+	list = (AV *) SvRV(requests);
+	count = av_len(list) + 1;
+	EXTEND(SP, count);
+	for (i = 0; i < count; i++) {
+		SV **item = av_fetch(list, i, 0);
+		AV *request;
+		AccountEngine *account;
+		const char *kind;
+		unsigned int len;
+
+		if (item == NULL || !SvROK(*item) || SvTYPE(SvRV(*item)) != SVt_PVAV) {
+			croak("createBatch: request %d is not an array reference", (int) i);
+		}
+		request = (AV *) SvRV(*item);
+		if (av_len(request) < 1 || (account = PaddedPackets_engineOf(av_fetch(request, 0, 0))) == NULL
+		 || av_fetch(request, 1, 0) == NULL) {
+			croak("createBatch: request %d is not [engine, kind, arguments...]", (int) i);
+		}
+
+		kind = SvPV_nolen(*av_fetch(request, 1, 0));
+		if (strEQ(kind, "sit")) {
+			len = account->createSitStand(packet, true);
+		} else if (strEQ(kind, "stand")) {
+			len = account->createSitStand(packet, false);
+		} else if (strEQ(kind, "attack")) {
+			len = account->createAtk(packet, PaddedPackets_argument(request, 2));
+		} else if (strEQ(kind, "skill")) {
+			len = account->createSkillUse(packet, PaddedPackets_argument(request, 2), PaddedPackets_argument(request, 3), PaddedPackets_argument(request, 4));
+		} else {
+			croak("createBatch: unknown packet kind '%s' in request %d", kind, (int) i);
+		}
+		PUSHs(sv_2mortal(newSVpvn((const char *) packet, len)));
+	}
+
+
+MODULE = Network::PaddedPackets		PACKAGE = Network::PaddedPackets::Engine		PREFIX = PaddedPacketsEngine_
+PROTOTYPES: ENABLE
+
+Network_PaddedPackets_Engine
+PaddedPacketsEngine_new(cls)
+	SV *cls
+CODE:
+	PERL_UNUSED_VAR(cls);
+	RETVAL = new AccountEngine();
 OUTPUT:
 	RETVAL
+
+void
+PaddedPacketsEngine_setHashData(self, accountId, mapSync, sync)
+	Network_PaddedPackets_Engine self
+	unsigned int accountId
+	unsigned int mapSync
+	unsigned int sync
+CODE:
+	self->engine.setAccId(accountId);
+	self->engine.setMapSync(mapSync);
+	self->engine.setSync(sync);
+
+void
+PaddedPacketsEngine_setPacketIDs(self, sit, skill)
+	Network_PaddedPackets_Engine self
+	unsigned short sit
+	unsigned short skill
+CODE:
+	self->sitPacketID = sit;
+	self->skillPacketID = skill;
+
+void
+PaddedPacketsEngine_setPacket(self, packet, targetId)
+	Network_PaddedPackets_Engine self
+	SV *packet
+	unsigned int targetId
+PREINIT:
+	STRLEN len;
+	const char *data;
+CODE:
+	data = SvPVbyte(packet, len);
+	self->engine.setPacket((byte *) data, len);
+	self->lastTargetId = targetId;
+
+SV *
+PaddedPacketsEngine_createSitStand(self, sit)
+	Network_PaddedPackets_Engine self
+	unsigned int sit
+PREINIT:
+	byte packet[PADDED_PACKET_MAXLEN];
+CODE:
+	RETVAL = newSVpvn((const char *) packet, self->createSitStand(packet, sit != 0));
+OUTPUT:
+	RETVAL
+
+SV *
+PaddedPacketsEngine_createAtk(self, targetId)
+	Network_PaddedPackets_Engine self
+	unsigned int targetId
+PREINIT:
+	byte packet[PADDED_PACKET_MAXLEN];
+CODE:
+	RETVAL = newSVpvn((const char *) packet, self->createAtk(packet, targetId));
+OUTPUT:
+	RETVAL
+
+SV *
+PaddedPacketsEngine_createSkillUse(self, skillId, skillLv, targetId)
+	Network_PaddedPackets_Engine self
+	unsigned int skillId
+	unsigned int skillLv
+	unsigned int targetId
+PREINIT:
+	byte packet[PADDED_PACKET_MAXLEN];
+CODE:
+	RETVAL = newSVpvn((const char *) packet, self->createSkillUse(packet, skillId, skillLv, targetId));
+OUTPUT:
+	RETVAL
+
+SV *
+PaddedPacketsEngine_decodeKeys(self, packet, keyCount)
+	Network_PaddedPackets_Engine self
+	SV *packet
+	unsigned int keyCount
+CODE:
+	RETVAL = PaddedPackets_decodeKeys(self->engine, packet, keyCount);
+OUTPUT:
+	RETVAL
+
+void
+PaddedPacketsEngine_DESTROY(self)
+	Network_PaddedPackets_Engine self
+CODE:
+	delete self;
@@ -1,4 +1,5 @@
 #include "block.h"
+#include "../OSL/Memory/Allocator.h"
 
 namespace OpenKore {
 namespace PaddedPackets {
@@ -6,18 +7,17 @@ namespace PaddedPackets {
 Block::Block()
 {
 	// Reserve some space
-	bufLen = 5;
-	buffer = new dword[bufLen];
-
-	memset(buffer, 0, bufLen * sizeof(dword));
+	bufLen = 8;
+	buffer = (dword *) OSL::Memory::allocate(bufLen * sizeof(dword));
+	if (buffer != NULL) {
+		memset(buffer, 0, bufLen * sizeof(dword));
+	}
 	currentPos = 0;
 }
 
 Block::~Block()
 {
-	if (buffer != NULL) {
-		delete[] buffer;
-	}
+	OSL::Memory::deallocate(buffer, bufLen * sizeof(dword));
 }
 
 void Block::reset()
@@ -31,22 +31,22 @@ void Block::add(dword data)
 		return;
 	}
 
-	if (currentPos == (bufLen - 1)) {
-		// Allocate more space.
-		bufLen = bufLen + 10;
-		dword *newBuffer = new dword[ bufLen ];
-
-		//if ( newBuffer == NULL )
-		//throw something here
+	if (currentPos == bufLen) {
+		// Allocate more space. Sizes double, like the size classes
+		// of the allocator, so that none of them is wasted.
+		unsigned int newLen = bufLen * 2;
+		dword *newBuffer = (dword *) OSL::Memory::allocate(newLen * sizeof(dword));
+		if (newBuffer == NULL) {
+			return;
+		}
 
-		memcpy( (void*)newBuffer, (void*)buffer, bufLen );
-		delete[] buffer;
+		memcpy(newBuffer, buffer, currentPos * sizeof(dword));
+		OSL::Memory::deallocate(buffer, bufLen * sizeof(dword));
 		buffer = newBuffer;
-	} else {
-		// Write to buffer directly.
-		buffer[currentPos] = data;
-		currentPos++;
+		bufLen = newLen;
 	}
+	buffer[currentPos] = data;
+	currentPos++;
 }
 
 unsigned int
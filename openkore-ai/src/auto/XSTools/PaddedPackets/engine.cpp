@@ -27,12 +27,26 @@ Engine::Engine()
 {
 	serverMapSync = 0;
 	clientSync = 0;
+	clientAccId = 0;
 
 	memset( pktBuffer, 0, PPENGINE_BUFSIZE * sizeof(byte) );
+
+	layout = NULL;
+	layoutCapacity = 0;
+	layoutKeys = 0;
+	layoutLength = 0;
+	layoutHash = 0;
+	layoutValid = false;
+
+	memset( hashCache, 0, sizeof(hashCache) );
+	hashNext = 0;
 }
 
 Engine::~Engine()
 {
+	if (layout != NULL) {
+		delete[] layout;
+	}
 }
 
 void
@@ -62,33 +76,86 @@ Engine::setAccId(dword accId)
 void
 Engine::setPacket(byte *packet, dword len)
 {
+	if (len > PPENGINE_BUFSIZE) {
+		len = PPENGINE_BUFSIZE;
+	}
 	memcpy( pktBuffer, packet, len);
 }
 
-unsigned int
-Engine::encode(byte *dest, word type)
+dword
+Engine::hash(word type)
+{
+	for (unsigned int i = 0; i < PPENGINE_HASHCACHE; i++) {
+		const HashEntry &entry = hashCache[i];
+		if (entry.valid && entry.type == type && entry.mapSync == serverMapSync
+		 && entry.sync == clientSync && entry.accId == clientAccId) {
+			return entry.hashData;
+		}
+	}
+
+	HashEntry &entry = hashCache[hashNext];
+	hashNext = (hashNext + 1) % PPENGINE_HASHCACHE;
+	entry.mapSync = serverMapSync;
+	entry.sync = clientSync;
+	entry.accId = clientAccId;
+	entry.type = type;
+	entry.hashData = createHash(serverMapSync, clientSync, clientAccId, type);
+	entry.valid = true;
+	return entry.hashData;
+}
+
+void
+Engine::buildLayout(dword hashData, unsigned int keys)
 {
-	dword offsets[] = { 15, 14, 12, 9, 5, 0 };
-	dword hashData = createHash(serverMapSync, clientSync, clientAccId, type);
+	static const dword offsets[PPENGINE_PASSES] = { 15, 14, 12, 9, 5, 0 };
+
+	if (keys * PPENGINE_PASSES > layoutCapacity) {
+		if (layout != NULL) {
+			delete[] layout;
+		}
+		layoutCapacity = keys * PPENGINE_PASSES;
+		layout = new word[layoutCapacity];
+	}
 
-	unsigned int packetLength = 0;
-	int iterations = 5;
-	// pad_2
-	for (int iter = 0; iter <= iterations; iter++) {
-		packetLength = (1 + inputKeys.getSize()) * 4;
+	for (int iter = 0; iter < PPENGINE_PASSES; iter++) {
+		layoutLength = (1 + keys) * 4;
 
 		dword intCtr = 5;
-		byte *writePtr = pktBuffer + 4;
-		for( unsigned int pass = 0; pass < inputKeys.getSize(); pass++ ) {
+		unsigned int writeOffset = 4;
+		for (unsigned int pass = 0; pass < keys; pass++) {
 			dword magic = ((intCtr * (dword)pass) + (hashData - offsets[iter])) % 0x27;
-			packetLength += magic;
+			layoutLength += magic;
 			intCtr += 3;
 
-			writePtr += (4 + magic);
-			*((dword*)writePtr - 1) = inputKeys[pass] + iter - 5;
+			writeOffset += (4 + magic);
+			layout[iter * keys + pass] = (word)(writeOffset - sizeof(dword));
+		}
+	}
+
+	layoutHash = hashData;
+	layoutKeys = keys;
+	layoutValid = true;
+}
+
+unsigned int
+Engine::encode(byte *dest, word type)
+{
+	dword hashData = hash(type);
+	unsigned int keys = inputKeys.getSize();
+
+	if (!layoutValid || layoutHash != hashData || layoutKeys != keys) {
+		buildLayout(hashData, keys);
+	}
+
+	// pad_2, the passes in order as the later ones overwrite parts of the earlier ones
+	const word *offset = layout;
+	for (int iter = 0; iter < PPENGINE_PASSES; iter++) {
+		for (unsigned int pass = 0; pass < keys; pass++) {
+			*(dword*)(pktBuffer + *offset++) = inputKeys[pass] + iter - (PPENGINE_PASSES - 1);
 		}
 	}
 
+	unsigned int packetLength = layoutLength;
 	pktBuffer[2] = (byte)packetLength;
 	*(word*)pktBuffer = (word)type;
 
@@ -105,7 +172,7 @@ Engine::decode(byte *src, unsigned int keys)
 	// Reset output keys
 	outputKeys.reset();
 
-	dword hashData = createHash(serverMapSync, clientSync, clientAccId, *(word*)src);
+	dword hashData = hash(*(word*)src);
 
 	dword intCtr = 5;
 	byte *readPtr = src + 4;
@@ -118,6 +185,30 @@ Engine::decode(byte *src, unsigned int keys)
 	}
 }
 
+unsigned int
+Engine::decode(const byte *src, unsigned int length, dword *keys, unsigned int count)
+{
+	if (length < 4) {
+		return 0;
+	}
+
+	dword hashData = hash(*(const word*)src);
+
+	dword intCtr = 5;
+	unsigned int readOffset = 4;
+	for( unsigned int pass = 0; pass < count; pass++ ) {
+		dword magic = ((intCtr * (dword)pass) + hashData) % 0x27;
+		intCtr += 3;
+
+		readOffset += (4 + magic);
+		if (readOffset > length) {
+			return pass;
+		}
+		keys[pass] = *((const dword*)(src + readOffset) - 1);
+	}
+	return count;
+}
+
 dword Engine::getKey(unsigned int index) const
 {
 	return outputKeys[index];
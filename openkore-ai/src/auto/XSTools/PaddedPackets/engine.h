@@ -23,6 +23,10 @@ namespace OpenKore {
 namespace PaddedPackets {
 
 	#define PPENGINE_BUFSIZE 512
+	// encode() writes the keys this many times, the last one being the packet's
+	#define PPENGINE_PASSES 6
+	// Number of hashes an Engine remembers
+	#define PPENGINE_HASHCACHE 8
 
 	class Engine {
 	public:
@@ -43,13 +47,43 @@ namespace PaddedPackets {
 		// Use GetKey() to actually get the keys
 		void decode(byte *src, unsigned int keys);
 
-		// copy external packet to internal buffer
+		// decodes up to 'count' keys of the 'length' bytes packet at src
+		// into keys, reading the packet where it is. Returns the number of
+		// keys decoded, fewer than 'count' if the packet is too short.
+		unsigned int decode(const byte *src, unsigned int length, dword *keys, unsigned int count);
+
+		// copy external packet to internal buffer, up to PPENGINE_BUFSIZE bytes
 		void setPacket(byte *packet, dword len);
 	
 	private:
+		// createHash() of the sync values and a packet ID, remembered
+		dword hash(word type);
+
+		// fills the layout for a hash and a number of keys
+		void buildLayout(dword hashData, unsigned int keys);
+
 		Block inputKeys, outputKeys;
 		dword serverMapSync, clientSync, clientAccId;
 		byte  pktBuffer[PPENGINE_BUFSIZE];
+
+		// Where encode() writes the keys for layoutHash and layoutKeys: the
+		// pktBuffer offset of key 'pass' in pass 'iter' is
+		// layout[iter * layoutKeys + pass]. The earlier passes only leave
+		// the padding bytes, but those are part of the packets.
+		word *layout;
+		unsigned int layoutCapacity, layoutKeys, layoutLength;
+		dword layoutHash;
+		bool layoutValid;
+
+		// The last hashes: they only change with the syncs, between which
+		// the same few packet IDs are encoded. Replaced in turn.
+		struct HashEntry {
+			dword mapSync, sync, accId, hashData;
+			word type;
+			bool valid;
+		};
+		HashEntry hashCache[PPENGINE_HASHCACHE];
+		unsigned int hashNext;
 	};
 
 } // PaddedPackets
@@ -18,7 +18,7 @@
 
 typedef unsigned char  byte;	// unsigned 8-bit type
 typedef unsigned short word;	// unsigned 16-bit type
-typedef unsigned long  dword;	// unsigned 32-bit type
+typedef unsigned int   dword;	// unsigned 32-bit type
 
 #ifdef __cplusplus
 	#define CEXTERN extern "C"
@@ -1,11 +1,390 @@
 #include <stdlib.h>
-#include <time.h>
+#include <math.h>
 #include "EXTERN.h"
 #include "perl.h"
 #include "XSUB.h"
 
 #include "algorithm.h"
+#include "cache.h"
+#include "portalgraph.h"
+#include "replan.h"
+#include "visibility.h"
+#include "danger.h"
+#include "landmarks.h"
+#include "workers.h"
+#include "../misc/ticktimer.h"
+#include "../misc/fieldchunks.h"
 typedef CalcPath_session * PathFinding;
+typedef Replan_session * PathFinding_Replanner;
+typedef VisibilityCache * PathFinding_VisibilityCache;
+typedef DangerMap * PathFinding_DangerMap;
+
+/* Writes 'count' x, y pairs as little endian unsigned shorts, the layout of pack("v*") */
+static void
+PathFinding_packCoords (unsigned char *data, const unsigned short *coords, long count)
+{
+	long i;
+	for (i = 0; i < count * 2; i++) {
+		data[i * 2] = coords[i] & 0xFF;
+		data[i * 2 + 1] = coords[i] >> 8;
+	}
+}
+
+static int
+PathFinding_compareAdress (const void *a, const void *b)
+{
+	unsigned int first = *(const unsigned int *) a;
+	unsigned int second = *(const unsigned int *) b;
+	return (first > second) - (first < second);
+}
+
+/* The optional visibility cache argument of the line of sight functions, undef for none */
+static VisibilityCache *
+PathFinding_visibilityArg (SV *visibility)
+{
+	if (!visibility || !SvOK(visibility)) {
+		return NULL;
+	}
+	if (!sv_derived_from(visibility, "PathFinding::VisibilityCache")) {
+		croak("visibility is not of type PathFinding::VisibilityCache");
+	}
+	return INT2PTR(VisibilityCache *, SvIV((SV *) SvRV(visibility)));
+}
+
+/* Waits for the background search of the session, if it has one, and releases the scalars kept alive for it.
+ * Returns 1 and leaves the search result in session->jobResult if there was a background search, 0 if not. */
+static int
+PathFinding_finishJob (PathFinding session)
+{
+	int i;
+
+	if (session->jobStatus == CALCPATH_JOB_NONE) {
+		return 0;
+	}
+
+	CalcPath_waitJob (session);
+	for (i = 0; i < 5; i++) {
+		if (session->jobOwners[i]) {
+			SvREFCNT_dec ((SV *) session->jobOwners[i]);
+		}
+	}
+	session->jobStatus = CALCPATH_JOB_NONE;
+	return 1;
+}
+
+/* Stores the finished search of a session in the route cache, walking its path back from the goal */
+static void
+PathFinding_cacheStore (PathFinding session, int status)
+{
+	RouteCache_key key;
+	unsigned short *coords = NULL;
+	long size = 0;
+
+	if (status == 1) {
+		unsigned int currentAdress = (session->endY * session->width) + session->endX;
+		long current;
+
+		size = (session->solution_size + 1);
+		coords = (unsigned short *) malloc(size * 2 * sizeof(unsigned short));
+		for (current = size - 1; current >= 0; current--) {
+			coords[current * 2] = currentAdress % session->width;
+			coords[current * 2 + 1] = currentAdress / session->width;
+			currentAdress = session->predecessor[currentAdress];
+		}
+	}
+
+	RouteCache_keyFromSession (session, session->routeCacheField, &key);
+	RouteCache_store (&key, status, coords, size);
+	free(coords);
+}
+
+/* Runs the search of the session, or takes the result of its background search or of the route cache */
+static int
+PathFinding_pathStep (PathFinding session)
+{
+	int status;
+
+	static int phase = -2;
+
+	if (session->cachedResult) {
+		return session->cachedResult;
+	}
+	if (phase == -2) {
+		phase = TickTimer_phase ("pathfinding");
+	}
+	TickTimer_begin (phase);
+	if (PathFinding_finishJob (session)) {
+		status = session->jobResult;
+	} else {
+		status = CalcPath_pathStep (session);
+	}
+
+	/* Unfinished searches and the ones which ran out of time are not cached, finished ones are stored once */
+	/* The path of a search during which the danger or obstacle layer changed is the one of no version of the layer */
+	if (session->routeCacheField && (status == 1 || status == -1)
+	 && (!session->danger || session->danger->version == session->dangerVersion)
+	 && (!session->obstacles || session->obstacles->version == session->obstaclesVersion)) {
+		PathFinding_cacheStore (session, status);
+		session->routeCacheField = 0;
+	}
+	TickTimer_end (phase);
+	return status;
+}
+
+/* The x and y of the cells packed with pack("v*"), as taken by the repair functions. Free the result with free(). */
+static int *
+PathFinding_changedCells (SV *cells, int *count)
+{
+	STRLEN len;
+	const unsigned char *packed;
+	int *coords;
+	int i;
+
+	if (!SvOK(cells)) {
+		croak("cells must be packed with pack(\"v*\", x, y, ...)");
+	}
+	packed = (const unsigned char *) SvPVbyte (cells, len);
+	*count = (int) (len / 4);
+	coords = (int *) malloc ((*count * 2 + 1) * sizeof(int));
+	for (i = 0; i < *count * 2; i++) {
+		coords[i] = packed[i * 2] | (packed[i * 2 + 1] << 8);
+	}
+	return coords;
+}
+
+/* The coordinate 'step' steps of get_client_easy_solution away from 'from' towards 'to' */
+static int
+PathFinding_easyCoord (int from, int to, long step)
+{
+	if (to > from) {
+		return (step < to - from) ? from + step : to;
+	}
+	return (step < from - to) ? from - step : to;
+}
+
+/* The raw map of a field for the tile queries. The scalar is kept alive and its buffer looked up on every query,
+ * so the map may be assigned again, only its size is fixed. The map may also be a Utils::FieldChunks object,
+ * whose chunks are then read instead. */
+typedef struct {
+	SV *rawMap;
+	FieldChunks *chunks;
+	int width;
+	int height;
+} TileMap;
+typedef TileMap * PathFinding_TileMap;
+
+/* Whether the cell (x, y) has one of the 'tile' bits, cells out of the map or of the scalar have none */
+static inline int
+PathFinding_tileAt (PathFinding_TileMap map, IV x, IV y, int tile)
+{
+	IV offset;
+
+	if (x < 0 || x >= map->width || y < 0 || y >= map->height) {
+		return 0;
+	}
+	if (map->chunks) {
+		return (FieldChunks_cell (map->chunks, (int) x, (int) y) & tile) != 0;
+	}
+	if (!SvPOK(map->rawMap)) {
+		return 0;
+	}
+	offset = (y * map->width) + x;
+	if ((STRLEN) offset >= SvCUR(map->rawMap)) {
+		return 0;
+	}
+	return (SvPVX(map->rawMap)[offset] & tile) != 0;
+}
+
+/* The steps of a route being walked, see Task::Route. The steps before 'start' were walked already. */
+#define ROUTE_CLOSE_TO_END 1
+#define ROUTE_WAYPOINT 2
+typedef struct {
+	unsigned short *cells;
+	unsigned char *flags;
+	long size;
+	long start;
+} RouteCursor;
+typedef RouteCursor * PathFinding_RouteCursor;
+
+/* Index of the step closest to (x, y) among the remaining ones, like the failsafe of Task::Route: the search stops at the
+ * step on (x, y), or 'lookahead' steps after the closest one so far, the distance being Utils::adjustedBlockDistance() */
+static long
+PathFinding_routeLocate (PathFinding_RouteCursor cursor, int x, int y, long lookahead)
+{
+	long best = -1, since = 0, i;
+	double bestDistance = 0;
+
+	for (i = cursor->start; i < cursor->size; i++) {
+		int dx = abs (cursor->cells[i * 2] - x);
+		int dy = abs (cursor->cells[i * 2 + 1] - y);
+		double distance;
+		if (dx == 0 && dy == 0) {
+			return i - cursor->start;
+		}
+		distance = (dx + dy) - ((2 - sqrt (2.0)) * ((dx < dy) ? dx : dy));
+		if (best < 0 || bestDistance > distance) {
+			best = i;
+			bestDistance = distance;
+			since = 0;
+		} else {
+			since++;
+		}
+		if (since == lookahead) {
+			break;
+		}
+	}
+	return (best < 0) ? -1 : best - cursor->start;
+}
+
+/* A portal graph with the "portal=dest" keys of its links and the names of its spawns */
+typedef struct {
+	PortalGraph *graph;
+	HV *nodes;
+	HV *spawns;
+	AV *keys;
+} PortalGraph_names;
+typedef PortalGraph_names * PathFinding_PortalGraph;
+
+/* The hash held by key in hv, NULL if there is none */
+static HV *
+PathFinding_subHash (HV *hv, const char *key, STRLEN len)
+{
+	SV **value = hv_fetch (hv, key, len, 0);
+	if (!value || !SvROK(*value) || SvTYPE(SvRV(*value)) != SVt_PVHV) {
+		return NULL;
+	}
+	return (HV *) SvRV(*value);
+}
+
+/* The number held by key in hv, 0 if there is none; integer truncates it like Perl's int() */
+static double
+PathFinding_hashNumber (HV *hv, const char *key, STRLEN len, int integer)
+{
+	SV **value = hv_fetch (hv, key, len, 0);
+	double number;
+	if (!value || !SvOK(*value)) {
+		return 0;
+	}
+	number = SvNV(*value);
+	if (integer) {
+		number = (number < 0) ? ceil(number) : floor(number);
+	}
+	return number;
+}
+
+static int
+PathFinding_hashTrue (HV *hv, const char *key, STRLEN len)
+{
+	SV **value = hv_fetch (hv, key, len, 0);
+	return value && SvTRUE(*value);
+}
+
+/* The weight of leaving a map, int($routeWeights{lc($map)}) */
+static double
+PathFinding_mapWeight (HV *weights, HV *portal)
+{
+	HV *source = PathFinding_subHash (portal, "source", 6);
+	SV **map;
+	STRLEN len, i;
+	const char *name;
+	char *lower;
+	double weight;
+
+	if (!source || !(map = hv_fetch (source, "map", 3, 0)) || !SvOK(*map)) {
+		return 0;
+	}
+	name = SvPV (*map, len);
+	lower = (char *) malloc(len + 1);
+	for (i = 0; i < len; i++) {
+		lower[i] = toLOWER(name[i]);
+	}
+	weight = PathFinding_hashNumber (weights, lower, len, 1);
+	free(lower);
+	return weight;
+}
+
+static long
+PathFinding_spawnIndex (PortalGraph_names *names, const char *spawn, STRLEN len)
+{
+	SV **index = hv_fetch (names->spawns, spawn, len, 0);
+	return index ? (long) SvIV(*index) : -1;
+}
+
+/* The node of the link "portal=dest", which is added if it's not in the graph yet */
+static long
+PathFinding_nodeIndex (PortalGraph_names *names, const char *key, STRLEN len)
+{
+	SV **index = hv_fetch (names->nodes, key, len, 0);
+	const char *dest;
+	long node;
+
+	if (index) {
+		return (long) SvIV(*index);
+	}
+	dest = (const char *) memchr (key, '=', len);
+	dest = dest ? dest + 1 : key + len;
+	node = PortalGraph_addNode (names->graph, PathFinding_spawnIndex (names, dest, key + len - dest));
+	hv_store (names->nodes, key, len, newSViv(node), 0);
+	av_push (names->keys, newSVpvn(key, len));
+	return node;
+}
+
+/* Adds an edge from spawn to every enabled destination of portal, the links of the portal tables in portals */
+static void
+PathFinding_addPortalEdges (PortalGraph_names *names, long spawn, HV *portals, const char *portalName, STRLEN portalLen,
+	double distance, HV *weights, int airship)
+{
+	HV *portal = PathFinding_subHash (portals, portalName, portalLen);
+	HV *dests;
+	HE *he;
+	double mapWeight;
+
+	if (!portal || !(dests = PathFinding_subHash (portal, "dest", 4))) {
+		return;
+	}
+	mapWeight = PathFinding_mapWeight (weights, portal);
+
+	hv_iterinit (dests);
+	while ((he = hv_iternext (dests))) {
+		SV *value = hv_iterval (dests, he);
+		HV *dest;
+		STRLEN destLen, keyLen;
+		const char *destName;
+		SV *key;
+		double walk, zeny;
+		unsigned char flags;
+
+		if (!SvROK(value) || SvTYPE(SvRV(value)) != SVt_PVHV) {
+			continue;
+		}
+		dest = (HV *) SvRV(value);
+		if (!PathFinding_hashTrue (dest, "enabled", 7)) {
+			continue;
+		}
+
+		if (airship) {
+			walk = mapWeight + PathFinding_hashNumber (weights, "AIRSHIP", 7, 0) + distance;
+			zeny = 0;
+			flags = PORTALGRAPH_AIRSHIP;
+		} else {
+			SV **steps = hv_fetch (dest, "steps", 5, 0);
+			STRLEN stepsLen = 0;
+			if (steps && SvOK(*steps)) {
+				(void) SvPV (*steps, stepsLen);
+			}
+			walk = mapWeight + (stepsLen ? PathFinding_hashNumber (weights, "NPC", 3, 1) : PathFinding_hashNumber (weights, "PORTAL", 6, 1)) + distance;
+			zeny = PathFinding_hashNumber (dest, "cost", 4, 0);
+			flags = PathFinding_hashTrue (dest, "allow_ticket", 12) ? PORTALGRAPH_ALLOW_TICKET : 0;
+		}
+
+		destName = HePV (he, destLen);
+		key = sv_2mortal (newSVpvn (portalName, portalLen));
+		sv_catpvn (key, "=", 1);
+		sv_catpvn (key, destName, destLen);
+		(void) SvPV (key, keyLen);
+		PortalGraph_addEdge (names->graph, spawn, PathFinding_nodeIndex (names, SvPVX(key), keyLen), walk, zeny, flags);
+	}
+}
 
 MODULE = PathFinding		PACKAGE = PathFinding		PREFIX = PathFinding_
 PROTOTYPES: ENABLE
@@ -20,7 +399,7 @@ PathFinding_create()
 
 
 void
-PathFinding__reset(session, weight_map, avoidWalls, customWeights, secondWeightMap, randomFactor, useManhattan, width, height, startx, starty, destx, desty, time_max, min_x, max_x, min_y, max_y)
+PathFinding__reset(session, weight_map, avoidWalls, customWeights, secondWeightMap, randomFactor, useManhattan, width, height, startx, starty, destx, desty, time_max, min_x, max_x, min_y, max_y, neighbor_mask = NULL, algorithm = NULL, open_list = NULL, node_budget = NULL, time_budget = NULL, cache_key = NULL, components = NULL, danger = NULL, window = NULL, landmarks = NULL)
 		PathFinding session
 		SV * weight_map
 		SV * avoidWalls
@@ -39,23 +418,30 @@ PathFinding__reset(session, weight_map, avoidWalls, customWeights, secondWeightM
 		SV * max_x
 		SV * min_y
 		SV * max_y
+		SV * neighbor_mask
+		SV * algorithm
+		SV * open_list
+		SV * node_budget
+		SV * time_budget
+		SV * cache_key
+		SV * components
+		SV * danger
+		SV * window
+		SV * landmarks
 
 	PREINIT:
 		char *weight_map_data = NULL;
 
 	CODE:
 
-		/* If the object was already initiated, clean map memory */
-		if (session->initialized) {
-			free_currentMap(session);
-			session->initialized = 0;
-		}
+		/* A background search still uses the buffers, its result is dropped */
+		PathFinding_finishJob (session);
 
-		/* If the path has already been calculated on this object, clean openlist memory */
-		if (session->run) {
-			free_openList(session);
-			session->run = 0;
-		}
+		/* The map and openlist buffers are kept allocated across resets, CalcPath_init only invalidates the nodes of the previous search */
+		session->initialized = 0;
+		session->run = 0;
+		session->cachedResult = 0;
+		session->routeCacheField = 0;
 
 		/* Check for any missing arguments */
 		if (!session || !weight_map || !avoidWalls  || !customWeights || !secondWeightMap || !randomFactor || !useManhattan || !width || !height || !startx || !starty || !destx || !desty || !time_max || !min_x || !max_x || !min_y || !max_y) {
@@ -151,6 +537,57 @@ PathFinding__reset(session, weight_map, avoidWalls, customWeights, secondWeightM
 		session->width = (int) SvUV (width);
 		session->height = (int) SvUV (height);
 
+		/* The neighbor mask is optional, it must be a reference to a string covering the whole map */
+		session->neighbor_mask = NULL;
+		if (neighbor_mask && SvOK(neighbor_mask)) {
+			STRLEN mask_len;
+			const char *mask_data;
+
+			if (!SvROK(neighbor_mask)) {
+				printf("[pathfinding reset error] bad neighbor_mask argument\n");
+				XSRETURN_NO;
+			}
+
+			mask_data = SvPVbyte (SvRV (neighbor_mask), mask_len);
+			if (mask_len != (STRLEN) session->width * session->height) {
+				printf("[pathfinding reset error] neighbor_mask size does not match the map (size: %d x %d).\n", session->width, session->height);
+				XSRETURN_NO;
+			}
+			session->neighbor_mask = (const unsigned char *) mask_data;
+		}
+
+		/* Kept alive by PathFinding__submit while a background search reads them */
+		session->jobOwners[0] = SvRV (weight_map);
+		session->jobOwners[1] = session->neighbor_mask ? SvRV (neighbor_mask) : NULL;
+		session->jobOwners[2] = NULL;
+		session->jobOwners[3] = NULL;
+		session->jobOwners[4] = NULL;
+		session->danger = NULL;
+		session->obstacles = NULL;
+
+		/* The landmark tables are optional, they must be a reference to a string of whole tables covering the map */
+		session->landmarks = NULL;
+		session->landmarkCount = 0;
+		if (landmarks && SvOK(landmarks)) {
+			STRLEN landmarks_len;
+			const char *landmarks_data;
+			STRLEN table_len = (STRLEN) session->width * session->height * sizeof(unsigned short);
+
+			if (!SvROK(landmarks)) {
+				printf("[pathfinding reset error] bad landmarks argument\n");
+				XSRETURN_NO;
+			}
+
+			landmarks_data = SvPVbyte (SvRV (landmarks), landmarks_len);
+			if (table_len == 0 || landmarks_len % table_len != 0 || landmarks_len / table_len > CALCPATH_MAX_LANDMARKS) {
+				printf("[pathfinding reset error] landmarks size does not match the map (size: %d x %d).\n", session->width, session->height);
+				XSRETURN_NO;
+			}
+			session->landmarks = (const unsigned short *) landmarks_data;
+			session->landmarkCount = (int) (landmarks_len / table_len);
+			session->jobOwners[3] = session->landmarkCount ? SvRV (landmarks) : NULL;
+		}
+
 		session->startX = (int) SvUV (startx);
 		session->startY = (int) SvUV (starty);
 		session->endX = (int) SvUV (destx);
@@ -161,7 +598,6 @@ PathFinding__reset(session, weight_map, avoidWalls, customWeights, secondWeightM
 		session->min_y = (int) SvUV (min_y);
 		session->max_y = (int) SvUV (max_y);
 
-		srand(time(0));
 		session->randomFactor = (unsigned int) SvUV (randomFactor);
 		session->useManhattan = (unsigned short) SvUV (useManhattan);
 
@@ -212,6 +648,95 @@ PathFinding__reset(session, weight_map, avoidWalls, customWeights, secondWeightM
 		session->customWeights = (unsigned short) SvUV (customWeights);
 		session->time_max = (unsigned int) SvUV (time_max);
 
+		/* The search algorithm is optional, CalcPath_init falls back to A* when the map or the options don't suit it */
+		session->algorithm = CALCPATH_ASTAR;
+		if (algorithm && SvOK(algorithm)) {
+			if (SvROK(algorithm) || SvTYPE(algorithm) >= SVt_PVAV) {
+				printf("[pathfinding reset error] bad algorithm argument\n");
+				XSRETURN_NO;
+			}
+
+			session->algorithm = (int) SvIV (algorithm);
+			if (session->algorithm != CALCPATH_ASTAR && session->algorithm != CALCPATH_JPS && session->algorithm != CALCPATH_BIDIRECTIONAL) {
+				printf("[pathfinding reset error] unknown algorithm %d\n", session->algorithm);
+				XSRETURN_NO;
+			}
+		}
+
+		/* The open list backend is optional, defaults to the binary heap */
+		session->openListType = OPENLIST_HEAP;
+		if (open_list && SvOK(open_list)) {
+			if (SvROK(open_list) || SvTYPE(open_list) >= SVt_PVAV) {
+				printf("[pathfinding reset error] bad open_list argument\n");
+				XSRETURN_NO;
+			}
+
+			session->openListType = (int) SvIV (open_list);
+			if (session->openListType != OPENLIST_HEAP && session->openListType != OPENLIST_BUCKET) {
+				printf("[pathfinding reset error] unknown open_list %d\n", session->openListType);
+				XSRETURN_NO;
+			}
+		}
+
+		/* The budgets of each run call are optional, defaults to no limit */
+		session->node_budget = 0;
+		if (node_budget && SvOK(node_budget)) {
+			if (SvROK(node_budget) || SvTYPE(node_budget) >= SVt_PVAV) {
+				printf("[pathfinding reset error] bad node_budget argument\n");
+				XSRETURN_NO;
+			}
+			session->node_budget = (unsigned long) SvUV (node_budget);
+		}
+
+		session->time_budget = 0;
+		if (time_budget && SvOK(time_budget)) {
+			if (SvROK(time_budget) || SvTYPE(time_budget) >= SVt_PVAV) {
+				printf("[pathfinding reset error] bad time_budget argument\n");
+				XSRETURN_NO;
+			}
+			session->time_budget = (unsigned long) SvUV (time_budget);
+		}
+
+		/* The adaptive search window is optional, defaults to searching the whole area at once */
+		session->window = 0;
+		if (window && SvOK(window)) {
+			if (SvROK(window) || SvTYPE(window) >= SVt_PVAV) {
+				printf("[pathfinding reset error] bad window argument\n");
+				XSRETURN_NO;
+			}
+			session->window = (int) SvUV (window);
+		}
+
+		/* The danger layer is optional, its weights are added to the ones of the map */
+		if (danger && SvOK(danger)) {
+			if (!sv_derived_from(danger, "PathFinding::DangerMap")) {
+				printf("[pathfinding reset error] danger is not of type PathFinding::DangerMap\n");
+				XSRETURN_NO;
+			}
+
+			session->danger = INT2PTR(DangerMap *, SvIV((SV *) SvRV(danger)));
+			if (session->danger->width != session->width || session->danger->height != session->height) {
+				printf("[pathfinding reset error] danger size does not match the map (size: %d x %d).\n", session->width, session->height);
+				session->danger = NULL;
+				XSRETURN_NO;
+			}
+			session->dangerVersion = session->danger->version;
+			session->jobOwners[2] = SvRV (danger);
+		}
+
+		/* secondWeightMap can also be an obstacle layer, a PathFinding::DangerMap added like the danger layer instead of cells to copy */
+		if (session->customWeights && SvROK(secondWeightMap) && sv_derived_from(secondWeightMap, "PathFinding::DangerMap")) {
+			session->obstacles = INT2PTR(DangerMap *, SvIV((SV *) SvRV(secondWeightMap)));
+			if (session->obstacles->width != session->width || session->obstacles->height != session->height) {
+				printf("[pathfinding reset error] secondWeightMap size does not match the map (size: %d x %d).\n", session->width, session->height);
+				session->obstacles = NULL;
+				XSRETURN_NO;
+			}
+			session->obstaclesVersion = session->obstacles->version;
+			session->jobOwners[4] = SvRV (secondWeightMap);
+			session->customWeights = 0;
+		}
+
 		CalcPath_init(session);
 
 		if (session->customWeights) {
@@ -242,6 +767,9 @@ PathFinding__reset(session, weight_map, avoidWalls, customWeights, secondWeightM
 				XSRETURN_NO;
 			}
 
+			/* Only the given cells are stored, in a hash table sized for them */
+			CalcPath_initCustomWeights (session, array_len + 1);
+
 			SV **fetched;
 			HV *hash;
 
@@ -346,17 +874,86 @@ PathFinding__reset(session, weight_map, avoidWalls, customWeights, secondWeightM
 
 				unsigned int weight = SvIV(*ref_weight);
 
-				long current = (y * session->width) + x;
+				/* Cells outside of the map can never be walked on */
+				if (x < 0 || x >= session->width || y < 0 || y >= session->height) {
+					continue;
+				}
 
-				session->second_weight_map[current] = weight;
+				CalcPath_setCustomWeight (session, (unsigned int) ((y * session->width) + x), weight);
 			}
-		} else {
+		} else if (!session->obstacles) {
 			if (SvOK(secondWeightMap)) {
 				printf("[pathfinding reset error] secondWeightMap is defined while customWeights is 0\n");
 				XSRETURN_NO;
 			}
 		}
 
+		/* With the connected area labels of the map (see makeComponents), a goal out of the area of the start has no path */
+		if (components && SvOK(components)) {
+			STRLEN components_len;
+			const unsigned char *labels;
+			unsigned long startAdress = ((unsigned long) session->startY * session->width) + session->startX;
+			unsigned long endAdress = ((unsigned long) session->endY * session->width) + session->endX;
+			unsigned int startLabel;
+			unsigned int endLabel;
+
+			if (!SvROK(components)) {
+				printf("[pathfinding reset error] bad components argument\n");
+				XSRETURN_NO;
+			}
+
+			labels = (const unsigned char *) SvPVbyte (SvRV (components), components_len);
+			if (components_len != (STRLEN) session->width * session->height * 2) {
+				printf("[pathfinding reset error] components size does not match the map (size: %d x %d).\n", session->width, session->height);
+				XSRETURN_NO;
+			}
+
+			startLabel = labels[startAdress * 2] | (labels[startAdress * 2 + 1] << 8);
+			endLabel = labels[endAdress * 2] | (labels[endAdress * 2 + 1] << 8);
+			if (startLabel != endLabel && startLabel != COMPONENT_UNKNOWN && endLabel != COMPONENT_UNKNOWN) {
+				session->cachedResult = -1;
+				XSRETURN_EMPTY;
+			}
+		}
+
+		/* Searches with a cache key are looked up in the route cache, random searches never give the same path twice */
+		if (cache_key && SvOK(cache_key) && !session->randomFactor && RouteCache_capacity () > 0) {
+			STRLEN key_len;
+			const unsigned char *key_data;
+			unsigned long long field = 14695981039346656037ULL;
+			const unsigned short *coords;
+			long length;
+			STRLEN i;
+			RouteCache_key key;
+
+			if (SvROK(cache_key) || SvTYPE(cache_key) >= SVt_PVAV) {
+				printf("[pathfinding reset error] bad cache_key argument\n");
+				XSRETURN_NO;
+			}
+
+			/* FNV-1a hash of the key */
+			key_data = (const unsigned char *) SvPVbyte (cache_key, key_len);
+			for (i = 0; i < key_len; i++) {
+				field = (field ^ key_data[i]) * 1099511628211ULL;
+			}
+			session->routeCacheField = field ? field : 1;
+
+			RouteCache_keyFromSession (session, session->routeCacheField, &key);
+			session->cachedResult = RouteCache_lookup (&key, &coords, &length);
+			if (session->cachedResult == 1) {
+				/* Rebuild the predecessors of the path so the solution is read the same way as the one of a search */
+				unsigned int previous = (coords[1] * session->width) + coords[0];
+				long step;
+
+				for (step = 0; step < length; step++) {
+					unsigned int adress = (coords[step * 2 + 1] * session->width) + coords[step * 2];
+					session->predecessor[adress] = previous;
+					previous = adress;
+				}
+				session->solution_size = length - 1;
+			}
+		}
+
 int
 PathFinding_run(session, solution_array)
 		PathFinding session
@@ -387,7 +984,7 @@ PathFinding_run(session, solution_array)
 			XSRETURN_NO;
 		}
 
-		status = CalcPath_pathStep (session);
+		status = PathFinding_pathStep (session);
 
 		if (status < 0) {
 			RETVAL = status;
@@ -400,23 +997,23 @@ PathFinding_run(session, solution_array)
 			av_clear (array);
 			av_extend (array, size);
 
-			Node currentNode = session->currentMap[(session->endY * session->width) + session->endX];
+			unsigned int currentAdress = (session->endY * session->width) + session->endX;
 			long current = session->solution_size;
 
 			while (1)
 			{
 				HV * rh = (HV *)sv_2mortal((SV *)newHV());
 
-				hv_store(rh, "x", 1, newSViv(currentNode.x), 0);
+				hv_store(rh, "x", 1, newSViv(currentAdress % session->width), 0);
 
-				hv_store(rh, "y", 1, newSViv(currentNode.y), 0);
+				hv_store(rh, "y", 1, newSViv(currentAdress / session->width), 0);
 
 				av_store(array, current, newRV((SV *)rh));
 
 				if (current == 0) {
 					break;
 				} else {
-					currentNode = session->currentMap[currentNode.predecessor];
+					currentAdress = session->predecessor[currentAdress];
 					current--;
 				}
 			}
@@ -427,219 +1024,887 @@ PathFinding_run(session, solution_array)
 		RETVAL
 
 int
-PathFinding_runcount(session)
+PathFinding_run_packed(session, solution)
 		PathFinding session
+		SV * solution
 	PREINIT:
 		int status;
 	CODE:
+		/* solution should be a reference to a scalar */
+		if (!solution || !SvROK(solution) || SvTYPE(SvRV(solution)) >= SVt_PVAV) {
+			printf("[pathfinding run error] solution is not a scalar reference\n");
+			XSRETURN_NO;
+		}
 
-		status = CalcPath_pathStep (session);
+		status = PathFinding_pathStep (session);
 
 		if (status < 0) {
 			RETVAL = status;
 		} else {
-			RETVAL = (long) session->solution_size;
+			long size = (session->solution_size + 1);
+			unsigned short *coords = (unsigned short *) malloc(size * 2 * sizeof(unsigned short));
+			unsigned int currentAdress = (session->endY * session->width) + session->endX;
+			long current;
+
+			for (current = size - 1; current >= 0; current--) {
+				coords[current * 2] = currentAdress % session->width;
+				coords[current * 2 + 1] = currentAdress / session->width;
+				currentAdress = session->predecessor[currentAdress];
+			}
+
+			SV *packed = SvRV (solution);
+			SvUPGRADE (packed, SVt_PV);
+			SvGROW (packed, (STRLEN) size * 4 + 1);
+			SvPOK_only (packed);
+			PathFinding_packCoords ((unsigned char *) SvPVX (packed), coords, size);
+			SvCUR_set (packed, size * 4);
+			free(coords);
+
+			RETVAL = size;
 		}
 	OUTPUT:
 		RETVAL
 
-void
-PathFinding_DESTROY(session)
+int
+PathFinding_runcount(session)
 		PathFinding session
 	PREINIT:
-		session = (PathFinding) 0; /* shut up compiler warning */
+		int status;
 	CODE:
-		CalcPath_destroy (session);
 
-int
-PathFinding_checkTile(ix, iy, itile, iwidth, iheight, rawMap)
-		SV * ix
-		SV * iy
-		SV * itile
-		SV * iwidth
-		SV * iheight
-		SV * rawMap
+		status = PathFinding_pathStep (session);
+
+		if (status < 0) {
+			RETVAL = status;
+		} else {
+			RETVAL = (long) session->solution_size;
+		}
+	OUTPUT:
+		RETVAL
 
+int
+PathFinding__submit(session)
+		PathFinding session
 	CODE:
-		int x = (int) SvUV (ix);
-		int y = (int) SvUV (iy);
-		int tile = (int) SvUV (itile);
-		int width = (int) SvUV (iwidth);
-		int height = (int) SvUV (iheight);
+		if (!session->initialized) {
+			printf("[pathfinding run error] You must call 'reset' before 'run'.\n");
+			XSRETURN_NO;
+		}
 
-		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+		/* A session can only have one background search at a time */
+		PathFinding_finishJob (session);
 
-		RETVAL = checkTile_inner(x, y, tile, width, height, rawMap_data);
+		/* The result is already known from the route cache */
+		if (session->cachedResult) {
+			XSRETURN_YES;
+		}
 
+		/* The search reads the weight map, neighbor mask and landmarks strings and the danger and obstacle layers from another thread, they must not be freed until it is done */
+		if (session->jobOwners[0]) {
+			SvREFCNT_inc ((SV *) session->jobOwners[0]);
+		}
+		if (session->jobOwners[1]) {
+			SvREFCNT_inc ((SV *) session->jobOwners[1]);
+		}
+		if (session->jobOwners[2]) {
+			SvREFCNT_inc ((SV *) session->jobOwners[2]);
+		}
+		if (session->jobOwners[3]) {
+			SvREFCNT_inc ((SV *) session->jobOwners[3]);
+		}
+		if (session->jobOwners[4]) {
+			SvREFCNT_inc ((SV *) session->jobOwners[4]);
+		}
+		CalcPath_submit (session);
+		RETVAL = 1;
 	OUTPUT:
 		RETVAL
 
 int
-PathFinding_checkLOS(istart_x, istart_y, iend_x, iend_y, itile, iwidth, iheight, rawMap)
-		SV * istart_x
-		SV * istart_y
-		SV * iend_x
-		SV * iend_y
-		SV * itile
-		SV * iwidth
-		SV * iheight
-		SV * rawMap
-
+PathFinding_poll(session)
+		PathFinding session
 	CODE:
-		int start_x = (int) SvUV (istart_x);
-		int start_y = (int) SvUV (istart_y);
-		int end_x = (int) SvUV (iend_x);
-		int end_y = (int) SvUV (iend_y);
-		int tile = (int) SvUV (itile);
-		int width = (int) SvUV (iwidth);
-		int height = (int) SvUV (iheight);
+		/* Sessions without a background search are always ready to be run */
+		RETVAL = (session->jobStatus == CALCPATH_JOB_NONE || CalcPath_jobStatus (session) == CALCPATH_JOB_DONE);
+	OUTPUT:
+		RETVAL
 
-		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+int
+PathFinding_startWorkers(count)
+		int count
+	CODE:
+		RETVAL = CalcPath_startWorkers (count);
+	OUTPUT:
+		RETVAL
 
-		RETVAL = checkLOS_inner(start_x, start_y, end_x, end_y, tile, width, height, rawMap_data);
+void
+PathFinding_stopWorkers()
+	CODE:
+		CalcPath_stopWorkers ();
 
+int
+PathFinding_workers()
+	CODE:
+		RETVAL = CalcPath_workerCount ();
 	OUTPUT:
 		RETVAL
 
 int
-PathFinding_canAttack(istart_x, istart_y, iend_x, iend_y, itile, iwidth, iheight, irange, iclientSight, rawMap)
-		SV * istart_x
-		SV * istart_y
-		SV * iend_x
-		SV * iend_y
-		SV * itile
-		SV * iwidth
-		SV * iheight
-		SV * irange
-		SV * iclientSight
-		SV * rawMap
-
+PathFinding_cached(session)
+		PathFinding session
 	CODE:
-		int start_x = (int) SvUV (istart_x);
-		int start_y = (int) SvUV (istart_y);
-		int end_x = (int) SvUV (iend_x);
-		int end_y = (int) SvUV (iend_y);
-		int tile = (int) SvUV (itile);
-		int width = (int) SvUV (iwidth);
-		int height = (int) SvUV (iheight);
-		int range = (int) SvUV (irange);
-		int clientSight = (int) SvUV (iclientSight);
-
-		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+		RETVAL = (session->cachedResult != 0);
+	OUTPUT:
+		RETVAL
 
-		RETVAL = canAttack_inner(start_x, start_y, end_x, end_y, tile, width, height, range, clientSight, rawMap_data);
+unsigned long
+PathFinding_expanded(session)
+		PathFinding session
+	CODE:
+		RETVAL = session->expanded;
+	OUTPUT:
+		RETVAL
 
+unsigned long
+PathFinding_windowGrowths(session)
+		PathFinding session
+	CODE:
+		RETVAL = session->windowGrowths;
 	OUTPUT:
 		RETVAL
 
 void
-PathFinding_calcRectArea(i_x, i_y, iradius, itile, iwidth, iheight, rawMap, solution_array)
-		SV * i_x
-		SV * i_y
-		SV * iradius
-		SV * itile
-		SV * iwidth
-		SV * iheight
-		SV * rawMap
-		SV * solution_array
+PathFinding_setRouteCacheSize(size)
+		long size
+	CODE:
+		RouteCache_setCapacity (size);
 
+long
+PathFinding_routeCacheSize()
 	CODE:
-		int x = (int) SvUV (i_x);
-		int y = (int) SvUV (i_y);
-		int radius = (int) SvUV (iradius);
-		int tile = (int) SvUV (itile);
-		int width = (int) SvUV (iwidth);
-		int height = (int) SvUV (iheight);
+		RETVAL = RouteCache_capacity ();
+	OUTPUT:
+		RETVAL
 
-		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+long
+PathFinding_routeCacheCount()
+	CODE:
+		RETVAL = RouteCache_count ();
+	OUTPUT:
+		RETVAL
 
-		int * limits = getSquareEdgesFromCoord_inner(x, y, radius, width, height);
-		int min_x = limits[0];
-		int min_y = limits[1];
-		int max_x = limits[2];
-		int max_y = limits[3];
+void
+PathFinding_clearRouteCache()
+	CODE:
+		RouteCache_clear ();
 
-		AV *array;
- 		array = (AV *) SvRV (solution_array);
-		av_clear (array);
+void
+PathFinding_runcounts(session, destinations, solutions = NULL)
+		PathFinding session
+		SV * destinations
+		SV * solutions
+	PREINIT:
+		AV *deref_destinations;
+		I32 array_len;
+		I32 index;
+		unsigned int *adresses;
+		unsigned int *goals;
+		long goalCount = 0;
+		long kept = 0;
+		int status;
+	PPCODE:
 
-		int offset;
+		/* destinations should be a reference to an array of {x, y} hashes */
+		if (!SvROK(destinations) || SvTYPE(SvRV(destinations)) != SVt_PVAV) {
+			printf("[pathfinding run error] destinations is not an array reference\n");
+			XSRETURN_EMPTY;
+		}
 
-		int value;
+		if (solutions && SvOK(solutions) && (!SvROK(solutions) || SvTYPE(SvRV(solutions)) != SVt_PVAV)) {
+			printf("[pathfinding run error] solutions is not an array reference\n");
+			XSRETURN_EMPTY;
+		}
 
-		int size;
+		deref_destinations = (AV *) SvRV (destinations);
+		array_len = av_len (deref_destinations) + 1;
+		if (array_len == 0) {
+			XSRETURN_EMPTY;
+		}
 
-		x = min_x;
-		y = min_y;
-		offset = (y * width) + x;
-		size = 0;
+		/* Adresses of the destinations, cells which can't be reached get the size of the map */
+		adresses = (unsigned int *) malloc(array_len * sizeof(unsigned int));
+		goals = (unsigned int *) malloc(array_len * sizeof(unsigned int));
+		for (index = 0; index < array_len; index++) {
+			SV **fetched = av_fetch (deref_destinations, index, 0);
+			SV **ref_x = NULL;
+			SV **ref_y = NULL;
+			int x;
+			int y;
+
+			adresses[index] = session->width * session->height;
+			if (fetched && SvROK(*fetched) && SvTYPE(SvRV(*fetched)) == SVt_PVHV) {
+				ref_x = hv_fetch((HV *) SvRV(*fetched), "x", 1, 0);
+				ref_y = hv_fetch((HV *) SvRV(*fetched), "y", 1, 0);
+			}
+			if (!ref_x || !ref_y || !SvOK(*ref_x) || !SvOK(*ref_y)) {
+				continue;
+			}
 
-		while (x < max_x) {
-			value = rawMap_data[offset];
-			if (value & tile) {
-				av_extend (array, (size+1));
-				HV * rh = (HV *)sv_2mortal((SV *)newHV());
+			x = (int) SvIV(*ref_x);
+			y = (int) SvIV(*ref_y);
+			if (x < session->limit_min_x || x > session->limit_max_x || y < session->limit_min_y || y > session->limit_max_y
+			 || session->map_base_weight[(y * session->width) + x] == -1) {
+				continue;
+			}
 
-				hv_store(rh, "x", 1, newSViv(x), 0);
-				hv_store(rh, "y", 1, newSViv(y), 0);
+			adresses[index] = (y * session->width) + x;
+			goals[goalCount++] = adresses[index];
+		}
 
-				av_store(array, size, newRV((SV *)rh));
-				size++;
+		/* CalcPath_multiGoal needs the goals sorted and without repeats */
+		qsort(goals, goalCount, sizeof(unsigned int), PathFinding_compareAdress);
+		for (index = 0; index < goalCount; index++) {
+			if (kept == 0 || goals[kept - 1] != goals[index]) {
+				goals[kept++] = goals[index];
 			}
-			offset++;
-			x++;
 		}
 
-		while (y < max_y) {
-			value = rawMap_data[offset];
-			if (value & tile) {
-				av_extend (array, (size+1));
-				HV * rh = (HV *)sv_2mortal((SV *)newHV());
+		/* The search overwrites the path of the reset, which must neither be read from nor stored in the route cache anymore */
+		PathFinding_finishJob (session);
+		session->cachedResult = 0;
+		session->routeCacheField = 0;
+		status = CalcPath_multiGoal (session, goals, kept);
 
-				hv_store(rh, "x", 1, newSViv(x), 0);
-				hv_store(rh, "y", 1, newSViv(y), 0);
+		if (solutions && SvOK(solutions)) {
+			av_clear ((AV *) SvRV(solutions));
+		}
 
-				av_store(array, size, newRV((SV *)rh));
-				size++;
+		EXTEND(SP, array_len);
+		for (index = 0; index < array_len; index++) {
+			long steps = -1;
+			if (status < 0 && status != -3) {
+				steps = status;
+			} else if (adresses[index] < (unsigned int) (session->width * session->height)) {
+				steps = CalcPath_stepsTo (session, adresses[index]);
+				if (steps < 0 && status == -3) {
+					steps = -3;
+				}
+			}
+			PUSHs(sv_2mortal(newSViv(steps)));
+
+			if (solutions && SvOK(solutions)) {
+				SV *solution = &PL_sv_undef;
+				if (steps >= 0) {
+					AV *array = newAV();
+					unsigned int currentAdress = adresses[index];
+					long current = steps;
+
+					av_extend (array, steps + 1);
+					while (1) {
+						HV * rh = (HV *)sv_2mortal((SV *)newHV());
+						hv_store(rh, "x", 1, newSViv(currentAdress % session->width), 0);
+						hv_store(rh, "y", 1, newSViv(currentAdress / session->width), 0);
+						av_store(array, current, newRV((SV *)rh));
+						if (current == 0) {
+							break;
+						}
+						currentAdress = session->predecessor[currentAdress];
+						current--;
+					}
+					solution = newRV_noinc((SV *) array);
+				}
+				av_store ((AV *) SvRV(solutions), index, solution == &PL_sv_undef ? newSV(0) : solution);
 			}
-			offset += width;
-			y++;
 		}
 
-		while (x > min_x) {
-			value = rawMap_data[offset];
-			if (value & tile) {
-				av_extend (array, (size+1));
-				HV * rh = (HV *)sv_2mortal((SV *)newHV());
-
-				hv_store(rh, "x", 1, newSViv(x), 0);
-				hv_store(rh, "y", 1, newSViv(y), 0);
+		free(adresses);
+		free(goals);
 
-				av_store(array, size, newRV((SV *)rh));
-				size++;
-			}
-			offset--;
-			x--;
+SV *
+PathFinding__distanceField(session, origin_x, origin_y, size)
+		PathFinding session
+		int origin_x
+		int origin_y
+		int size
+	PREINIT:
+		unsigned short *distances;
+		unsigned char *data;
+		long count;
+		long i;
+		int status;
+	CODE:
+		if (size <= 0) {
+			croak("distance field size must be positive");
 		}
 
-		while (y > min_y) {
-			value = rawMap_data[offset];
-			if (value & tile) {
-				av_extend (array, (size+1));
-				HV * rh = (HV *)sv_2mortal((SV *)newHV());
-
-				hv_store(rh, "x", 1, newSViv(x), 0);
-				hv_store(rh, "y", 1, newSViv(y), 0);
+		count = (long) size * size;
+		distances = (unsigned short *) malloc(count * sizeof(unsigned short));
+		PathFinding_finishJob (session);
+		session->cachedResult = 0;
+		session->routeCacheField = 0;
+		status = CalcPath_distanceField (session, origin_x, origin_y, size, distances);
+		if (status < 0) {
+			free(distances);
+			XSRETURN_UNDEF;
+		}
 
-				av_store(array, size, newRV((SV *)rh));
-				size++;
-			}
-			offset -= width;
-			y--;
+		/* Packed as little endian unsigned shorts, so Perl can read them with unpack("v") */
+		RETVAL = newSV (count * 2);
+		SvPOK_only (RETVAL);
+		data = (unsigned char *) SvPVX (RETVAL);
+		for (i = 0; i < count; i++) {
+			data[i * 2] = distances[i] & 0xFF;
+			data[i * 2 + 1] = distances[i] >> 8;
 		}
+		SvCUR_set (RETVAL, count * 2);
+		free(distances);
 
-int
-PathFinding_checkPathFree(istart_x, istart_y, iend_x, iend_y, itile, iwidth, iheight, rawMap)
+	OUTPUT:
+		RETVAL
+
+void
+PathFinding_DESTROY(session)
+		PathFinding session
+	PREINIT:
+		session = (PathFinding) 0; /* shut up compiler warning */
+	CODE:
+		PathFinding_finishJob (session);
+		CalcPath_destroy (session);
+
+SV *
+PathFinding_makeNeighborMask(weight_map, iwidth, iheight)
+		SV * weight_map
+		SV * iwidth
+		SV * iheight
+
+	CODE:
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+		STRLEN weight_map_len;
+
+		if (!SvROK(weight_map)) {
+			croak("weight_map must be a reference to a string");
+		}
+
+		const char * weight_map_data = (const char *) SvPVbyte (SvRV (weight_map), weight_map_len);
+		if (width <= 0 || height <= 0 || weight_map_len < (STRLEN) width * height) {
+			croak("weight_map is smaller than the given map size (%d x %d)", width, height);
+		}
+
+		RETVAL = newSV (width * height);
+		SvPOK_only (RETVAL);
+		CalcPath_buildNeighborMask (weight_map_data, width, height, (unsigned char *) SvPVX (RETVAL));
+		SvCUR_set (RETVAL, width * height);
+
+	OUTPUT:
+		RETVAL
+
+SV *
+PathFinding_makeLandmarks(weight_map, iwidth, iheight, icount)
+		SV * weight_map
+		SV * iwidth
+		SV * iheight
+		SV * icount
+
+	CODE:
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+		int count = (int) SvIV (icount);
+		STRLEN weight_map_len;
+		STRLEN length;
+
+		if (!SvROK(weight_map)) {
+			croak("weight_map must be a reference to a string");
+		}
+
+		const char * weight_map_data = (const char *) SvPVbyte (SvRV (weight_map), weight_map_len);
+		if (width <= 0 || height <= 0 || weight_map_len < (STRLEN) width * height) {
+			croak("weight_map is smaller than the given map size (%d x %d)", width, height);
+		}
+		if (count <= 0 || count > CALCPATH_MAX_LANDMARKS) {
+			croak("the landmark count must be between 1 and %d", CALCPATH_MAX_LANDMARKS);
+		}
+
+		/* Only the tables of the landmarks placed are returned */
+		length = (STRLEN) width * height * count * sizeof(unsigned short);
+		unsigned short *tables = (unsigned short *) malloc (length);
+		int placed = Landmarks_build (weight_map_data, width, height, count, tables);
+		RETVAL = newSV (placed ? (STRLEN) width * height * placed * sizeof(unsigned short) : 1);
+		SvPOK_only (RETVAL);
+		if (placed == count) {
+			memcpy (SvPVX (RETVAL), tables, length);
+		} else {
+			unsigned long cell;
+			unsigned short *target = (unsigned short *) SvPVX (RETVAL);
+			for (cell = 0; cell < (unsigned long) width * height; cell++) {
+				memcpy (target + cell * placed, tables + cell * count, placed * sizeof(unsigned short));
+			}
+		}
+		SvCUR_set (RETVAL, (STRLEN) width * height * placed * sizeof(unsigned short));
+		free (tables);
+
+	OUTPUT:
+		RETVAL
+
+SV *
+PathFinding_makeComponents(weight_map, iwidth, iheight)
+		SV * weight_map
+		SV * iwidth
+		SV * iheight
+
+	CODE:
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+		STRLEN weight_map_len;
+
+		if (!SvROK(weight_map)) {
+			croak("weight_map must be a reference to a string");
+		}
+
+		const char * weight_map_data = (const char *) SvPVbyte (SvRV (weight_map), weight_map_len);
+		if (width <= 0 || height <= 0 || weight_map_len < (STRLEN) width * height) {
+			croak("weight_map is smaller than the given map size (%d x %d)", width, height);
+		}
+
+		/* Little endian unsigned shorts, the layout of pack("v*"), so they can be saved as they are */
+		RETVAL = newSV (width * height * 2);
+		SvPOK_only (RETVAL);
+		CalcPath_buildComponents (weight_map_data, width, height, (unsigned char *) SvPVX (RETVAL));
+		SvCUR_set (RETVAL, width * height * 2);
+
+	OUTPUT:
+		RETVAL
+
+void
+PathFinding_repairNeighborMask(mask, weight_map, iwidth, iheight, cells)
+		SV * mask
+		SV * weight_map
+		SV * iwidth
+		SV * iheight
+		SV * cells
+
+	CODE:
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+		STRLEN weight_map_len;
+		STRLEN mask_len;
+		int count;
+
+		if (!SvROK(weight_map) || !SvROK(mask)) {
+			croak("mask and weight_map must be references to strings");
+		}
+
+		const char * weight_map_data = (const char *) SvPVbyte (SvRV (weight_map), weight_map_len);
+		unsigned char * mask_data = (unsigned char *) SvPV_force (SvRV (mask), mask_len);
+		if (width <= 0 || height <= 0 || weight_map_len < (STRLEN) width * height || mask_len != (STRLEN) width * height) {
+			croak("weight_map or mask is not of the given map size (%d x %d)", width, height);
+		}
+
+		/* The mask is changed in place, next to the cells whose walkability changed */
+		int * coords = PathFinding_changedCells (cells, &count);
+		CalcPath_repairNeighborMask (weight_map_data, width, height, coords, count, mask_data);
+		free (coords);
+
+void
+PathFinding_repairComponents(labels, weight_map, iwidth, iheight, cells)
+		SV * labels
+		SV * weight_map
+		SV * iwidth
+		SV * iheight
+		SV * cells
+
+	CODE:
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+		STRLEN weight_map_len;
+		STRLEN labels_len;
+		int count;
+
+		if (!SvROK(weight_map) || !SvROK(labels)) {
+			croak("labels and weight_map must be references to strings");
+		}
+
+		const char * weight_map_data = (const char *) SvPVbyte (SvRV (weight_map), weight_map_len);
+		unsigned char * labels_data = (unsigned char *) SvPV_force (SvRV (labels), labels_len);
+		if (width <= 0 || height <= 0 || weight_map_len < (STRLEN) width * height || labels_len != (STRLEN) width * height * 2) {
+			croak("weight_map or labels is not of the given map size (%d x %d)", width, height);
+		}
+
+		/* The labels are changed in place, only in the areas of the cells whose walkability changed */
+		int * coords = PathFinding_changedCells (cells, &count);
+		long highest = CalcPath_repairComponents (weight_map_data, width, height, coords, count, labels_data);
+		free (coords);
+		if (highest < 0) {
+			CalcPath_buildComponents (weight_map_data, width, height, labels_data);
+		}
+
+SV *
+PathFinding_makeWalkablePrefix(rawMap, iwidth, iheight)
+		SV * rawMap
+		SV * iwidth
+		SV * iheight
+
+	CODE:
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+		STRLEN rawMap_len;
+		STRLEN size;
+
+		if (!SvROK(rawMap)) {
+			croak("rawMap must be a reference to a string");
+		}
+
+		const char * rawMap_data = (const char *) SvPVbyte (SvRV (rawMap), rawMap_len);
+		if (width <= 0 || height <= 0 || width > 65535 || rawMap_len < (STRLEN) width * height) {
+			croak("rawMap is smaller than the given map size (%d x %d)", width, height);
+		}
+
+		/* Native unsigned shorts, only meant to be given back to sampleWalkable. Walkable cells have TILE_WALK (1) set, as in Field::isWalkable */
+		size = (STRLEN) (width + 1) * height * sizeof(unsigned short);
+		RETVAL = newSV (size);
+		SvPOK_only (RETVAL);
+		buildWalkablePrefix_inner (rawMap_data, width, height, 1, (unsigned short *) SvPVX (RETVAL));
+		SvCUR_set (RETVAL, size);
+
+	OUTPUT:
+		RETVAL
+
+SV *
+PathFinding_sampleWalkable(prefix, width, height, min_x, max_x, min_y, max_y, count, distances = NULL, left = 0, top = 0, size = 0)
+		SV * prefix
+		int width
+		int height
+		int min_x
+		int max_x
+		int min_y
+		int max_y
+		int count
+		SV * distances
+		int left
+		int top
+		int size
+	PREINIT:
+		STRLEN prefix_len;
+		const unsigned short *prefix_data;
+		const unsigned short *distances_data = NULL;
+		unsigned short *coords;
+		unsigned int state;
+		long drawn;
+	CODE:
+		if (!SvROK(prefix)) {
+			croak("prefix must be a reference to a string");
+		}
+		prefix_data = (const unsigned short *) SvPVbyte (SvRV (prefix), prefix_len);
+		if (width <= 0 || height <= 0 || prefix_len < (STRLEN) (width + 1) * height * sizeof(unsigned short)) {
+			croak("prefix is smaller than the given map size (%d x %d)", width, height);
+		}
+
+		if (distances && SvOK(distances)) {
+			STRLEN distances_len;
+			if (!SvROK(distances)) {
+				croak("distances must be a reference to a string");
+			}
+			distances_data = (const unsigned short *) SvPVbyte (SvRV (distances), distances_len);
+			if (size <= 0 || distances_len < (STRLEN) size * size * 2) {
+				croak("distances is smaller than the given size (%d x %d)", size, size);
+			}
+		}
+
+		/* The draws follow Perl's rand(), so srand() makes them repeatable */
+		if (!PL_srand_called) {
+			(void) seedDrand01 ((Rand_seed_t) seed ());
+			PL_srand_called = TRUE;
+		}
+		state = (unsigned int) (Drand01 () * 4294967295.0);
+		if (state == 0) {
+			state = 1;
+		}
+
+		coords = (unsigned short *) malloc((count > 0 ? count : 1) * 2 * sizeof(unsigned short));
+		drawn = sampleWalkable_inner (prefix_data, width, height, min_x, max_x, min_y, max_y, count, distances_data, left, top, size, &state, coords);
+
+		RETVAL = newSV (drawn * 4 + 1);
+		SvPOK_only (RETVAL);
+		PathFinding_packCoords ((unsigned char *) SvPVX (RETVAL), coords, drawn);
+		SvCUR_set (RETVAL, drawn * 4);
+		free(coords);
+
+	OUTPUT:
+		RETVAL
+
+int
+PathFinding_checkTile(ix, iy, itile, iwidth, iheight, rawMap)
+		SV * ix
+		SV * iy
+		SV * itile
+		SV * iwidth
+		SV * iheight
+		SV * rawMap
+
+	CODE:
+		int x = (int) SvUV (ix);
+		int y = (int) SvUV (iy);
+		int tile = (int) SvUV (itile);
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+
+		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+
+		RETVAL = checkTile_inner(x, y, tile, width, height, rawMap_data);
+
+	OUTPUT:
+		RETVAL
+
+int
+PathFinding_checkLOS(istart_x, istart_y, iend_x, iend_y, itile, iwidth, iheight, rawMap, visibility = NULL)
+		SV * istart_x
+		SV * istart_y
+		SV * iend_x
+		SV * iend_y
+		SV * itile
+		SV * iwidth
+		SV * iheight
+		SV * rawMap
+		SV * visibility
+
+	CODE:
+		int start_x = (int) SvUV (istart_x);
+		int start_y = (int) SvUV (istart_y);
+		int end_x = (int) SvUV (iend_x);
+		int end_y = (int) SvUV (iend_y);
+		int tile = (int) SvUV (itile);
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+
+		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+
+		VisibilityCache * cache = PathFinding_visibilityArg (visibility);
+
+		if (cache) {
+			RETVAL = Visibility_checkLOS(cache, start_x, start_y, end_x, end_y, tile, rawMap_data);
+		} else {
+			RETVAL = checkLOS_inner(start_x, start_y, end_x, end_y, tile, width, height, rawMap_data);
+		}
+
+	OUTPUT:
+		RETVAL
+
+int
+PathFinding_canAttack(istart_x, istart_y, iend_x, iend_y, itile, iwidth, iheight, irange, iclientSight, rawMap, visibility = NULL)
+		SV * istart_x
+		SV * istart_y
+		SV * iend_x
+		SV * iend_y
+		SV * itile
+		SV * iwidth
+		SV * iheight
+		SV * irange
+		SV * iclientSight
+		SV * rawMap
+		SV * visibility
+
+	CODE:
+		int start_x = (int) SvUV (istart_x);
+		int start_y = (int) SvUV (istart_y);
+		int end_x = (int) SvUV (iend_x);
+		int end_y = (int) SvUV (iend_y);
+		int tile = (int) SvUV (itile);
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+		int range = (int) SvUV (irange);
+		int clientSight = (int) SvUV (iclientSight);
+
+		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+
+		RETVAL = canAttack_inner(start_x, start_y, end_x, end_y, tile, width, height, range, clientSight, rawMap_data, PathFinding_visibilityArg (visibility));
+
+	OUTPUT:
+		RETVAL
+
+SV *
+PathFinding_checkLOS_packed(istart_x, istart_y, targets, itile, iwidth, iheight, rawMap, visibility = NULL)
+		SV * istart_x
+		SV * istart_y
+		SV * targets
+		SV * itile
+		SV * iwidth
+		SV * iheight
+		SV * rawMap
+		SV * visibility
+
+	CODE:
+		int start_x = (int) SvUV (istart_x);
+		int start_y = (int) SvUV (istart_y);
+		int tile = (int) SvUV (itile);
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+		STRLEN targets_len;
+
+		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+		const unsigned char * targets_data = (const unsigned char *) SvPVbyte (targets, targets_len);
+		long count = (long) (targets_len / 4);
+
+		/* One signed char per target, the layout of pack("c*") */
+		RETVAL = newSV (count + 1);
+		SvPOK_only (RETVAL);
+		checkLOSMany_inner(start_x, start_y, targets_data, count, tile, width, height, rawMap_data, PathFinding_visibilityArg (visibility), (signed char *) SvPVX (RETVAL));
+		SvCUR_set (RETVAL, count);
+
+	OUTPUT:
+		RETVAL
+
+SV *
+PathFinding_canAttack_packed(istart_x, istart_y, targets, itile, iwidth, iheight, irange, iclientSight, rawMap, visibility = NULL)
+		SV * istart_x
+		SV * istart_y
+		SV * targets
+		SV * itile
+		SV * iwidth
+		SV * iheight
+		SV * irange
+		SV * iclientSight
+		SV * rawMap
+		SV * visibility
+
+	CODE:
+		int start_x = (int) SvUV (istart_x);
+		int start_y = (int) SvUV (istart_y);
+		int tile = (int) SvUV (itile);
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+		int range = (int) SvUV (irange);
+		int clientSight = (int) SvUV (iclientSight);
+		STRLEN targets_len;
+
+		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+		const unsigned char * targets_data = (const unsigned char *) SvPVbyte (targets, targets_len);
+		long count = (long) (targets_len / 4);
+
+		RETVAL = newSV (count + 1);
+		SvPOK_only (RETVAL);
+		canAttackMany_inner(start_x, start_y, targets_data, count, tile, width, height, range, clientSight, rawMap_data, PathFinding_visibilityArg (visibility), (signed char *) SvPVX (RETVAL));
+		SvCUR_set (RETVAL, count);
+
+	OUTPUT:
+		RETVAL
+
+void
+PathFinding_bestAreaCenter(positions, caster_x, caster_y, range, around_x, around_y, around, radius, tile, width, height, rawMap, visibility = NULL)
+		SV * positions
+		int caster_x
+		int caster_y
+		int range
+		int around_x
+		int around_y
+		int around
+		int radius
+		int tile
+		int width
+		int height
+		SV * rawMap
+		SV * visibility
+	PREINIT:
+		STRLEN positions_len, rawMap_len;
+		const short *positions_data;
+		char *rawMap_data;
+		int center[2];
+		long hits;
+	PPCODE:
+		if (!SvROK(rawMap) || width <= 0 || height <= 0) {
+			XSRETURN_EMPTY;
+		}
+		rawMap_data = (char *) SvPVbyte (SvRV (rawMap), rawMap_len);
+		if (rawMap_len < (STRLEN) width * height) {
+			XSRETURN_EMPTY;
+		}
+
+		/* positions is packed like for blockDistanceMany */
+		positions_data = (const short *) SvPVbyte (positions, positions_len);
+		hits = bestAreaCenter_inner (positions_data, positions_len / (2 * sizeof(short)), caster_x, caster_y, range, around_x, around_y, around,
+			radius, tile, width, height, rawMap_data, PathFinding_visibilityArg (visibility), center);
+		if (hits < 0) {
+			XSRETURN_EMPTY;
+		}
+		EXTEND (SP, 3);
+		PUSHs (sv_2mortal (newSViv (center[0])));
+		PUSHs (sv_2mortal (newSViv (center[1])));
+		PUSHs (sv_2mortal (newSViv (hits)));
+
+void
+PathFinding_calcRectArea(i_x, i_y, iradius, itile, iwidth, iheight, rawMap, solution_array)
+		SV * i_x
+		SV * i_y
+		SV * iradius
+		SV * itile
+		SV * iwidth
+		SV * iheight
+		SV * rawMap
+		SV * solution_array
+
+	CODE:
+		int x = (int) SvUV (i_x);
+		int y = (int) SvUV (i_y);
+		int radius = (int) SvUV (iradius);
+		int tile = (int) SvUV (itile);
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+
+		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+
+		unsigned short * coords = (unsigned short *) malloc((8 * radius + 1) * 2 * sizeof(unsigned short));
+		int size = calcRectArea_inner(x, y, radius, tile, width, height, rawMap_data, coords);
+		int i;
+
+		AV *array;
+ 		array = (AV *) SvRV (solution_array);
+		av_clear (array);
+		av_extend (array, size);
+
+		for (i = 0; i < size; i++) {
+			HV * rh = (HV *)sv_2mortal((SV *)newHV());
+
+			hv_store(rh, "x", 1, newSViv(coords[i * 2]), 0);
+			hv_store(rh, "y", 1, newSViv(coords[i * 2 + 1]), 0);
+
+			av_store(array, i, newRV((SV *)rh));
+		}
+
+		free(coords);
+
+SV *
+PathFinding_calcRectArea_packed(i_x, i_y, iradius, itile, iwidth, iheight, rawMap)
+		SV * i_x
+		SV * i_y
+		SV * iradius
+		SV * itile
+		SV * iwidth
+		SV * iheight
+		SV * rawMap
+
+	CODE:
+		int x = (int) SvUV (i_x);
+		int y = (int) SvUV (i_y);
+		int radius = (int) SvUV (iradius);
+		int tile = (int) SvUV (itile);
+		int width = (int) SvUV (iwidth);
+		int height = (int) SvUV (iheight);
+
+		char * rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+
+		unsigned short * coords = (unsigned short *) malloc((8 * radius + 1) * 2 * sizeof(unsigned short));
+		int size = calcRectArea_inner(x, y, radius, tile, width, height, rawMap_data, coords);
+
+		RETVAL = newSV (size * 4 + 1);
+		SvPOK_only (RETVAL);
+		PathFinding_packCoords ((unsigned char *) SvPVX (RETVAL), coords, size);
+		SvCUR_set (RETVAL, size * 4);
+		free(coords);
+
+	OUTPUT:
+		RETVAL
+
+int
+PathFinding_checkPathFree(istart_x, istart_y, iend_x, iend_y, itile, iwidth, iheight, rawMap)
 		SV * istart_x
 		SV * istart_y
 		SV * iend_x
@@ -681,7 +1946,8 @@ PathFinding_getSquareEdgesFromCoord(i_x, i_y, iradius, iwidth, iheight, solution
 		int width = (int) SvUV (iwidth);
 		int height = (int) SvUV (iheight);
 
-		int * limits = getSquareEdgesFromCoord_inner(x, y, radius, width, height);
+		int limits[4];
+		getSquareEdgesFromCoord_inner(x, y, radius, width, height, limits);
 
 		AV *array;
  		array = (AV *) SvRV (solution_array);
@@ -711,6 +1977,175 @@ PathFinding_blockDistance(istart_x, istart_y, iend_x, iend_y)
 	OUTPUT:
 		RETVAL
 
+void
+PathFinding_positionsInRange(positions, x, y, dist = -1)
+		SV * positions
+		int x
+		int y
+		int dist
+	PREINIT:
+		STRLEN positions_len;
+		const short *positions_data;
+		unsigned int *indices;
+		long count;
+		long found;
+		long i;
+	PPCODE:
+		/* positions holds x, y pairs of native 16 bit integers, as built by pack('s*', ...) */
+		positions_data = (const short *) SvPVbyte (positions, positions_len);
+		count = positions_len / (2 * sizeof(short));
+		if (count == 0) {
+			XSRETURN_EMPTY;
+		}
+
+		indices = (unsigned int *) malloc(count * sizeof(unsigned int));
+		found = positionsInRange_inner (positions_data, count, x, y, dist, indices);
+		EXTEND (SP, found);
+		for (i = 0; i < found; i++) {
+			PUSHs (sv_2mortal (newSVuv (indices[i])));
+		}
+		free(indices);
+
+void
+PathFinding_blockDistanceMany(positions, x, y)
+		SV * positions
+		int x
+		int y
+	PREINIT:
+		STRLEN positions_len;
+		const short *positions_data;
+		unsigned short *distances;
+		long count;
+		long i;
+	PPCODE:
+		/* positions holds x, y pairs of native 16 bit integers, as built by pack('s*', ...) */
+		positions_data = (const short *) SvPVbyte (positions, positions_len);
+		count = positions_len / (2 * sizeof(short));
+		if (count == 0) {
+			XSRETURN_EMPTY;
+		}
+
+		distances = (unsigned short *) malloc(count * sizeof(unsigned short));
+		blockDistanceMany_inner (positions_data, count, x, y, distances);
+		EXTEND (SP, count);
+		for (i = 0; i < count; i++) {
+			PUSHs (sv_2mortal (newSVuv (distances[i])));
+		}
+		free(distances);
+
+SV *
+PathFinding_solutionTimes(solution)
+		SV * solution
+	PREINIT:
+		STRLEN solution_len;
+		const unsigned char *solution_data;
+		long count;
+	CODE:
+		/* solution is packed like the ones of run_packed(), the times are native unsigned 32 bit integers */
+		solution_data = (const unsigned char *) SvPVbyte (solution, solution_len);
+		count = solution_len / 4;
+		RETVAL = newSV (count * sizeof(unsigned int) + 1);
+		SvPOK_only (RETVAL);
+		solutionTimes_inner (solution_data, count, (unsigned int *) SvPVX (RETVAL));
+		SvCUR_set (RETVAL, count * sizeof(unsigned int));
+	OUTPUT:
+		RETVAL
+
+void
+PathFinding_smoothSolution(solution, max_segment, tile, width, height, rawMap)
+		SV * solution
+		long max_segment
+		int tile
+		int width
+		int height
+		SV * rawMap
+	PREINIT:
+		STRLEN solution_len;
+		const unsigned char *solution_data;
+		char *rawMap_data;
+		long count;
+		long size;
+		long waypointCount;
+		long i;
+		unsigned short *coords;
+		unsigned int *waypoints;
+		SV *path;
+		SV *indexes;
+	PPCODE:
+		/* solution is packed like the ones of run_packed(), so is the smoothed one, the waypoints are packed with pack("V*") */
+		if (!SvROK(rawMap)) {
+			croak("rawMap is not a reference");
+		}
+		solution_data = (const unsigned char *) SvPVbyte (solution, solution_len);
+		rawMap_data = (char *) SvPVbyte_nolen (SvRV (rawMap));
+		count = solution_len / 4;
+		for (i = 0; i < count; i++) {
+			int x = solution_data[i * 4] | (solution_data[i * 4 + 1] << 8);
+			int y = solution_data[i * 4 + 2] | (solution_data[i * 4 + 3] << 8);
+			if (x >= width || y >= height) {
+				croak("solution cell %d %d is out of the map (size: %d x %d)", x, y, width, height);
+			}
+		}
+
+		coords = (unsigned short *) malloc((count + 1) * 2 * sizeof(unsigned short));
+		waypoints = (unsigned int *) malloc((count + 1) * sizeof(unsigned int));
+		size = smoothSolution_inner (solution_data, count, max_segment, tile, width, height, rawMap_data, coords, waypoints, &waypointCount);
+
+		path = newSV (size * 4 + 1);
+		SvPOK_only (path);
+		PathFinding_packCoords ((unsigned char *) SvPVX (path), coords, size);
+		SvCUR_set (path, size * 4);
+
+		indexes = newSV (waypointCount * 4 + 1);
+		SvPOK_only (indexes);
+		for (i = 0; i < waypointCount; i++) {
+			unsigned char *data = (unsigned char *) SvPVX (indexes) + i * 4;
+			data[0] = waypoints[i] & 0xFF;
+			data[1] = (waypoints[i] >> 8) & 0xFF;
+			data[2] = (waypoints[i] >> 16) & 0xFF;
+			data[3] = waypoints[i] >> 24;
+		}
+		SvCUR_set (indexes, waypointCount * 4);
+		free(coords);
+		free(waypoints);
+
+		EXTEND (SP, 2);
+		PUSHs (sv_2mortal (path));
+		PUSHs (sv_2mortal (indexes));
+
+long
+PathFinding_stepAtTime(times, speed, time)
+		SV * times
+		double speed
+		double time
+	PREINIT:
+		STRLEN times_len;
+		const unsigned int *times_data;
+	CODE:
+		times_data = (const unsigned int *) SvPVbyte (times, times_len);
+		if (times_len < sizeof(unsigned int)) {
+			XSRETURN_UNDEF;
+		}
+		RETVAL = stepAtTime_inner (times_data, times_len / sizeof(unsigned int), speed, time);
+	OUTPUT:
+		RETVAL
+
+void
+PathFinding_easyPosAtTime(x, y, to_x, to_y, speed, time)
+		int x
+		int y
+		int to_x
+		int to_y
+		double speed
+		double time
+	PREINIT:
+		long step;
+	PPCODE:
+		step = easyStepAtTime_inner (to_x - x, to_y - y, speed, time);
+		EXTEND (SP, 2);
+		PUSHs (sv_2mortal (newSViv (PathFinding_easyCoord (x, to_x, step))));
+		PUSHs (sv_2mortal (newSViv (PathFinding_easyCoord (y, to_y, step))));
+
 int
 PathFinding_getClientDist(istart_x, istart_y, iend_x, iend_y)
 		SV * istart_x
@@ -729,6 +2164,33 @@ PathFinding_getClientDist(istart_x, istart_y, iend_x, iend_y)
 	OUTPUT:
 		RETVAL
 
+void
+PathFinding_clientDistMany(positions, x, y)
+		SV * positions
+		int x
+		int y
+	PREINIT:
+		STRLEN positions_len;
+		const short *positions_data;
+		unsigned short *distances;
+		long count;
+		long i;
+	PPCODE:
+		/* positions is packed like for blockDistanceMany */
+		positions_data = (const short *) SvPVbyte (positions, positions_len);
+		count = positions_len / (2 * sizeof(short));
+		if (count == 0) {
+			XSRETURN_EMPTY;
+		}
+
+		distances = (unsigned short *) malloc(count * sizeof(unsigned short));
+		clientDistMany_inner (positions_data, count, x, y, distances);
+		EXTEND (SP, count);
+		for (i = 0; i < count; i++) {
+			PUSHs (sv_2mortal (newSVuv (distances[i])));
+		}
+		free(distances);
+
 int
 PathFinding_get_client_easy_solution(istart_x, istart_y, iend_x, iend_y, solution_array)
 		SV * istart_x
@@ -793,3 +2255,710 @@ PathFinding_get_client_easy_solution(istart_x, istart_y, iend_x, iend_y, solutio
 
 	OUTPUT:
 		RETVAL
+
+
+MODULE = PathFinding		PACKAGE = PathFinding::Replanner		PREFIX = PathFindingReplanner_
+PROTOTYPES: ENABLE
+
+SV *
+PathFindingReplanner__create(weight_map, width, height, avoidWalls, startx, starty, destx, desty)
+		SV * weight_map
+		int width
+		int height
+		int avoidWalls
+		int startx
+		int starty
+		int destx
+		int desty
+	PREINIT:
+		STRLEN weight_map_len;
+		const char *weight_map_data;
+	CODE:
+		/* weight_map should be a reference to a string */
+		if (!SvROK(weight_map) || SvTYPE(SvRV(weight_map)) >= SVt_PVAV) {
+			printf("[pathfinding reset error] weight_map is not a reference to a string\n");
+			XSRETURN_UNDEF;
+		}
+
+		weight_map_data = (const char *) SvPVbyte (SvRV (weight_map), weight_map_len);
+		if (width <= 0 || height <= 0 || weight_map_len < (STRLEN) width * height) {
+			printf("[pathfinding reset error] weight_map is smaller than the given map size (%d x %d).\n", width, height);
+			XSRETURN_UNDEF;
+		}
+
+		if (startx < 0 || startx >= width || starty < 0 || starty >= height || weight_map_data[(starty * width) + startx] == -1) {
+			printf("[pathfinding reset error] Start coordinate %d %d is not a walkable cell of the map (size: %d x %d).\n", startx, starty, width, height);
+			XSRETURN_UNDEF;
+		}
+
+		if (destx < 0 || destx >= width || desty < 0 || desty >= height || weight_map_data[(desty * width) + destx] == -1) {
+			printf("[pathfinding reset error] End coordinate %d %d is not a walkable cell of the map (size: %d x %d).\n", destx, desty, width, height);
+			XSRETURN_UNDEF;
+		}
+
+		RETVAL = newSV (0);
+		sv_setref_pv (RETVAL, "PathFinding::Replanner", (void *) Replan_new (weight_map_data, width, height, avoidWalls != 0, startx, starty, destx, desty));
+	OUTPUT:
+		RETVAL
+
+int
+PathFindingReplanner_run(session, solution_array)
+		PathFinding_Replanner session
+		SV * solution_array
+	PREINIT:
+		unsigned int *path;
+		long length;
+		long i;
+	CODE:
+		/* solution_array should be a reference to an array */
+		if (!SvROK(solution_array) || SvTYPE(SvRV(solution_array)) != SVt_PVAV) {
+			printf("[pathfinding run error] solution_array is not an array reference\n");
+			XSRETURN_NO;
+		}
+
+		length = -1;
+		if (Replan_computePath (session) > 0) {
+			path = (unsigned int *) malloc((long) session->width * session->height * sizeof(unsigned int));
+			length = Replan_solution (session, path, (long) session->width * session->height);
+			if (length > 0) {
+				AV *array = (AV *) SvRV (solution_array);
+				av_clear (array);
+				av_extend (array, length);
+				for (i = 0; i < length; i++) {
+					HV * rh = (HV *)sv_2mortal((SV *)newHV());
+					hv_store(rh, "x", 1, newSViv(path[i] % session->width), 0);
+					hv_store(rh, "y", 1, newSViv(path[i] / session->width), 0);
+					av_store(array, i, newRV((SV *)rh));
+				}
+			}
+			free(path);
+		}
+		RETVAL = (length > 0) ? length : -1;
+	OUTPUT:
+		RETVAL
+
+int
+PathFindingReplanner_runcount(session)
+		PathFinding_Replanner session
+	PREINIT:
+		unsigned int *path;
+		long length;
+	CODE:
+		length = -1;
+		if (Replan_computePath (session) > 0) {
+			path = (unsigned int *) malloc((long) session->width * session->height * sizeof(unsigned int));
+			length = Replan_solution (session, path, (long) session->width * session->height);
+			free(path);
+		}
+		RETVAL = (length > 0) ? length - 1 : -1;
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingReplanner_updateCells(session, cells)
+		PathFinding_Replanner session
+		SV * cells
+	PREINIT:
+		AV *deref_cells;
+		I32 array_len;
+		I32 index;
+	CODE:
+		/* cells should be a reference to an array of {x, y, weight} hashes */
+		if (!SvROK(cells) || SvTYPE(SvRV(cells)) != SVt_PVAV) {
+			printf("[pathfinding run error] cells is not an array reference\n");
+			XSRETURN_EMPTY;
+		}
+
+		deref_cells = (AV *) SvRV (cells);
+		array_len = av_len (deref_cells) + 1;
+		for (index = 0; index < array_len; index++) {
+			SV **fetched = av_fetch (deref_cells, index, 0);
+			SV **ref_x;
+			SV **ref_y;
+			SV **ref_weight;
+			int x;
+			int y;
+
+			if (!fetched || !SvROK(*fetched) || SvTYPE(SvRV(*fetched)) != SVt_PVHV) {
+				continue;
+			}
+			ref_x = hv_fetch((HV *) SvRV(*fetched), "x", 1, 0);
+			ref_y = hv_fetch((HV *) SvRV(*fetched), "y", 1, 0);
+			ref_weight = hv_fetch((HV *) SvRV(*fetched), "weight", 6, 0);
+			if (!ref_x || !ref_y || !SvOK(*ref_x) || !SvOK(*ref_y)) {
+				continue;
+			}
+
+			x = (int) SvIV(*ref_x);
+			y = (int) SvIV(*ref_y);
+			if (x < 0 || x >= session->width || y < 0 || y >= session->height) {
+				continue;
+			}
+			Replan_setWeight (session, x, y, (ref_weight && SvOK(*ref_weight)) ? (unsigned int) SvUV(*ref_weight) : 0);
+		}
+
+int
+PathFindingReplanner_moveStart(session, x, y)
+		PathFinding_Replanner session
+		int x
+		int y
+	CODE:
+		if (x < 0 || x >= session->width || y < 0 || y >= session->height || session->map_base_weight[(y * session->width) + x] == -1) {
+			printf("[pathfinding run error] Start coordinate %d %d is not a walkable cell of the map (size: %d x %d).\n", x, y, session->width, session->height);
+			XSRETURN_NO;
+		}
+		Replan_moveStart (session, x, y);
+		RETVAL = 1;
+	OUTPUT:
+		RETVAL
+
+UV
+PathFindingReplanner_expanded(session)
+		PathFinding_Replanner session
+	CODE:
+		RETVAL = session->expanded;
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingReplanner_DESTROY(session)
+		PathFinding_Replanner session
+	CODE:
+		Replan_destroy (session);
+
+
+MODULE = PathFinding		PACKAGE = PathFinding::VisibilityCache		PREFIX = PathFindingVisibilityCache_
+PROTOTYPES: ENABLE
+
+PathFinding_VisibilityCache
+PathFindingVisibilityCache_new(cls, width, height, radius, capacity)
+		SV * cls
+		int width
+		int height
+		int radius
+		int capacity
+	CODE:
+		PERL_UNUSED_VAR(cls);
+		if (width <= 0 || height <= 0 || radius < 0 || capacity < 0) {
+			croak("bad visibility cache size");
+		}
+		RETVAL = Visibility_new (width, height, radius, capacity);
+	OUTPUT:
+		RETVAL
+
+long
+PathFindingVisibilityCache_count(cache)
+		PathFinding_VisibilityCache cache
+	CODE:
+		RETVAL = Visibility_count (cache);
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingVisibilityCache_clear(cache)
+		PathFinding_VisibilityCache cache
+	CODE:
+		Visibility_clear (cache);
+
+void
+PathFindingVisibilityCache_DESTROY(cache)
+		PathFinding_VisibilityCache cache
+	CODE:
+		Visibility_destroy (cache);
+
+
+MODULE = PathFinding		PACKAGE = PathFinding::DangerMap		PREFIX = PathFindingDangerMap_
+PROTOTYPES: ENABLE
+
+PathFinding_DangerMap
+PathFindingDangerMap_new(cls, width, height)
+		SV * cls
+		int width
+		int height
+	CODE:
+		PERL_UNUSED_VAR(cls);
+		if (width <= 0 || height <= 0) {
+			croak("bad danger map size");
+		}
+		RETVAL = Danger_new (width, height);
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingDangerMap_stamp(map, x, y, radius, weight)
+		PathFinding_DangerMap map
+		int x
+		int y
+		int radius
+		unsigned int weight
+	CODE:
+		if (radius < 0) {
+			croak("bad danger radius");
+		}
+		Danger_stamp (map, x, y, radius, weight);
+
+void
+PathFindingDangerMap_unstamp(map, x, y, radius, weight)
+		PathFinding_DangerMap map
+		int x
+		int y
+		int radius
+		unsigned int weight
+	CODE:
+		if (radius < 0) {
+			croak("bad danger radius");
+		}
+		Danger_unstamp (map, x, y, radius, weight);
+
+void
+PathFindingDangerMap_stampInverseSquare(map, x, y, radius, ratio, limit)
+		PathFinding_DangerMap map
+		int x
+		int y
+		int radius
+		unsigned int ratio
+		unsigned int limit
+	CODE:
+		if (radius < 0) {
+			croak("bad danger radius");
+		}
+		Danger_stampInverseSquare (map, x, y, radius, ratio, limit);
+
+void
+PathFindingDangerMap_unstampInverseSquare(map, x, y, radius, ratio, limit)
+		PathFinding_DangerMap map
+		int x
+		int y
+		int radius
+		unsigned int ratio
+		unsigned int limit
+	CODE:
+		if (radius < 0) {
+			croak("bad danger radius");
+		}
+		Danger_unstampInverseSquare (map, x, y, radius, ratio, limit);
+
+unsigned int
+PathFindingDangerMap_at(map, x, y)
+		PathFinding_DangerMap map
+		int x
+		int y
+	CODE:
+		RETVAL = Danger_at (map, x, y);
+	OUTPUT:
+		RETVAL
+
+long
+PathFindingDangerMap_stamps(map)
+		PathFinding_DangerMap map
+	CODE:
+		RETVAL = map->stamps;
+	OUTPUT:
+		RETVAL
+
+unsigned long
+PathFindingDangerMap_version(map)
+		PathFinding_DangerMap map
+	CODE:
+		RETVAL = map->version;
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingDangerMap_clear(map)
+		PathFinding_DangerMap map
+	CODE:
+		Danger_clear (map);
+
+void
+PathFindingDangerMap_DESTROY(map)
+		PathFinding_DangerMap map
+	CODE:
+		Danger_destroy (map);
+
+
+MODULE = PathFinding		PACKAGE = PathFinding::PortalGraph		PREFIX = PathFindingPortalGraph_
+PROTOTYPES: ENABLE
+
+PathFinding_PortalGraph
+PathFindingPortalGraph__create(portals, los, airships, weights, budget, tickets)
+		SV * portals
+		SV * los
+		SV * airships
+		SV * weights
+		SV * budget
+		long tickets
+	PREINIT:
+		HV *portalsHV, *losHV, *airshipsHV, *weightsHV;
+		HE *he;
+		STRLEN len;
+		int hasBudget;
+	CODE:
+		if (!SvROK(portals) || SvTYPE(SvRV(portals)) != SVt_PVHV
+		 || !SvROK(los) || SvTYPE(SvRV(los)) != SVt_PVHV
+		 || !SvROK(airships) || SvTYPE(SvRV(airships)) != SVt_PVHV
+		 || !SvROK(weights) || SvTYPE(SvRV(weights)) != SVt_PVHV) {
+			croak("portals, los, airships and weights must be hash references");
+		}
+		portalsHV = (HV *) SvRV(portals);
+		losHV = (HV *) SvRV(los);
+		airshipsHV = (HV *) SvRV(airships);
+		weightsHV = (HV *) SvRV(weights);
+
+		/* An empty budget is no budget, like $task->{budget} ne '' */
+		hasBudget = 0;
+		if (SvOK(budget)) {
+			(void) SvPV (budget, len);
+			hasBudget = len > 0;
+		}
+
+		RETVAL = (PortalGraph_names *) malloc(sizeof(PortalGraph_names));
+		RETVAL->graph = PortalGraph_new (hasBudget, hasBudget ? SvNV(budget) : 0, tickets);
+		RETVAL->nodes = newHV();
+		RETVAL->spawns = newHV();
+		RETVAL->keys = newAV();
+
+		/* The spawns are the ones walking distances are known from, so a link gets its spawn whenever it's added */
+		hv_iterinit (losHV);
+		while ((he = hv_iternext (losHV))) {
+			const char *spawn = HePV (he, len);
+			hv_store (RETVAL->spawns, spawn, len, newSViv (PortalGraph_addSpawn (RETVAL->graph)), 0);
+		}
+
+		hv_iterinit (losHV);
+		while ((he = hv_iternext (losHV))) {
+			SV *value = hv_iterval (losHV, he);
+			const char *spawnName = HePV (he, len);
+			long spawn = PathFinding_spawnIndex (RETVAL, spawnName, len);
+			HV *children;
+			HE *child;
+
+			if (!SvROK(value) || SvTYPE(SvRV(value)) != SVt_PVHV) {
+				continue;
+			}
+			children = (HV *) SvRV(value);
+			hv_iterinit (children);
+			while ((child = hv_iternext (children))) {
+				SV *distance = hv_iterval (children, child);
+				STRLEN portalLen;
+				const char *portal;
+
+				if (!SvTRUE(distance)) {
+					continue;
+				}
+				portal = HePV (child, portalLen);
+				PathFinding_addPortalEdges (RETVAL, spawn, portalsHV, portal, portalLen, SvNV(distance), weightsHV, 0);
+				PathFinding_addPortalEdges (RETVAL, spawn, airshipsHV, portal, portalLen, SvNV(distance), weightsHV, 1);
+			}
+		}
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingPortalGraph_open(graph, key, entry)
+		PathFinding_PortalGraph graph
+		SV * key
+		SV * entry
+	PREINIT:
+		HV *hv;
+		STRLEN len;
+		const char *name;
+		unsigned char flags;
+	CODE:
+		if (!SvROK(entry) || SvTYPE(SvRV(entry)) != SVt_PVHV) {
+			croak("entry must be a hash reference");
+		}
+		hv = (HV *) SvRV(entry);
+		name = SvPV (key, len);
+		flags = (PathFinding_hashTrue (hv, "allow_ticket", 12) ? PORTALGRAPH_ALLOW_TICKET : 0)
+			| (PathFinding_hashTrue (hv, "is_airship", 10) ? PORTALGRAPH_AIRSHIP : 0);
+		PortalGraph_open (graph->graph, PathFinding_nodeIndex (graph, name, len),
+			PathFinding_hashNumber (hv, "walk", 4, 0),
+			PathFinding_hashNumber (hv, "zeny", 4, 0),
+			PathFinding_hashNumber (hv, "zeny_covered_by_tickets", 23, 0),
+			(long) PathFinding_hashNumber (hv, "amount_of_tickets_used", 22, 1),
+			flags);
+
+void
+PathFindingPortalGraph_next(graph)
+		PathFinding_PortalGraph graph
+	PREINIT:
+		long index;
+		PortalGraph_node *node;
+		HV *result;
+		SV **key;
+	PPCODE:
+		index = PortalGraph_next (graph->graph);
+		if (index < 0) {
+			XSRETURN_EMPTY;
+		}
+		node = &graph->graph->nodes[index];
+		result = newHV();
+		hv_store (result, "walk", 4, newSVnv(node->walk), 0);
+		hv_store (result, "zeny", 4, newSVnv(node->zeny), 0);
+		hv_store (result, "allow_ticket", 12, newSViv((node->flags & PORTALGRAPH_ALLOW_TICKET) ? 1 : 0), 0);
+		hv_store (result, "zeny_covered_by_tickets", 23, newSVnv(node->zenyCovered), 0);
+		hv_store (result, "amount_of_tickets_used", 22, newSViv(node->ticketsUsed), 0);
+		hv_store (result, "is_airship", 10, newSViv((node->flags & PORTALGRAPH_AIRSHIP) ? 1 : 0), 0);
+		key = (node->parent >= 0) ? av_fetch (graph->keys, node->parent, 0) : NULL;
+		hv_store (result, "parent", 6, key ? newSVsv(*key) : newSV(0), 0);
+
+		key = av_fetch (graph->keys, index, 0);
+		EXTEND (SP, 2);
+		PUSHs (sv_2mortal (newSVsv (*key)));
+		PUSHs (sv_2mortal (newRV_noinc ((SV *) result)));
+
+unsigned long
+PathFindingPortalGraph_expanded(graph)
+		PathFinding_PortalGraph graph
+	CODE:
+		RETVAL = graph->graph->expanded;
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingPortalGraph_DESTROY(graph)
+		PathFinding_PortalGraph graph
+	CODE:
+		PortalGraph_destroy (graph->graph);
+		SvREFCNT_dec ((SV *) graph->nodes);
+		SvREFCNT_dec ((SV *) graph->spawns);
+		SvREFCNT_dec ((SV *) graph->keys);
+		free (graph);
+
+
+MODULE = PathFinding		PACKAGE = PathFinding::RouteCursor		PREFIX = PathFindingRouteCursor_
+PROTOTYPES: ENABLE
+
+PathFinding_RouteCursor
+PathFindingRouteCursor_new(klass, solution)
+		SV * klass
+		SV * solution
+	PREINIT:
+		AV *steps;
+		long i;
+	CODE:
+		PERL_UNUSED_VAR(klass);
+		if (!SvROK(solution) || SvTYPE(SvRV(solution)) != SVt_PVAV) {
+			croak("solution must be a reference to an array of steps");
+		}
+		steps = (AV *) SvRV(solution);
+		RETVAL = (PathFinding_RouteCursor) malloc (sizeof(RouteCursor));
+		RETVAL->size = av_len (steps) + 1;
+		RETVAL->start = 0;
+		RETVAL->cells = (unsigned short *) malloc ((RETVAL->size * 2 + 1) * sizeof(unsigned short));
+		RETVAL->flags = (unsigned char *) malloc (RETVAL->size + 1);
+		for (i = 0; i < RETVAL->size; i++) {
+			SV **step = av_fetch (steps, i, 0);
+			HV *hv = (step && SvROK(*step) && SvTYPE(SvRV(*step)) == SVt_PVHV) ? (HV *) SvRV(*step) : NULL;
+			RETVAL->cells[i * 2] = hv ? (unsigned short) PathFinding_hashNumber (hv, "x", 1, 1) : 0;
+			RETVAL->cells[i * 2 + 1] = hv ? (unsigned short) PathFinding_hashNumber (hv, "y", 1, 1) : 0;
+			RETVAL->flags[i] = 0;
+			if (hv && PathFinding_hashNumber (hv, "closeToEnd", 10, 0) != 0) {
+				RETVAL->flags[i] |= ROUTE_CLOSE_TO_END;
+			}
+			if (hv && PathFinding_hashNumber (hv, "waypoint", 8, 0) != 0) {
+				RETVAL->flags[i] |= ROUTE_WAYPOINT;
+			}
+		}
+	OUTPUT:
+		RETVAL
+
+long
+PathFindingRouteCursor_size(cursor)
+		PathFinding_RouteCursor cursor
+	CODE:
+		RETVAL = cursor->size - cursor->start;
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingRouteCursor_cell(cursor, index)
+		PathFinding_RouteCursor cursor
+		long index
+	PPCODE:
+		if (index < 0 || index >= cursor->size - cursor->start) {
+			XSRETURN_EMPTY;
+		}
+		EXTEND (SP, 2);
+		mPUSHi (cursor->cells[(cursor->start + index) * 2]);
+		mPUSHi (cursor->cells[(cursor->start + index) * 2 + 1]);
+
+SV *
+PathFindingRouteCursor_locate(cursor, x, y, lookahead)
+		PathFinding_RouteCursor cursor
+		int x
+		int y
+		long lookahead
+	PREINIT:
+		long index;
+	CODE:
+		index = PathFinding_routeLocate (cursor, x, y, lookahead);
+		RETVAL = (index < 0) ? &PL_sv_undef : newSViv (index);
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingRouteCursor_trim(cursor, count)
+		PathFinding_RouteCursor cursor
+		long count
+	CODE:
+		if (count > 0) {
+			cursor->start = (count < cursor->size - cursor->start) ? cursor->start + count : cursor->size;
+		}
+
+void
+PathFindingRouteCursor_nextStep(cursor, step_index, closeToEnd)
+		PathFinding_RouteCursor cursor
+		long step_index
+		int closeToEnd
+	PREINIT:
+		long index, target, i;
+	PPCODE:
+		/* The step to walk to: the first step close enough to the end, then the first waypoint after the second step */
+		if (step_index < 0 || step_index >= cursor->size - cursor->start) {
+			XSRETURN_EMPTY;
+		}
+		index = cursor->start + step_index;
+		if (closeToEnd && (cursor->flags[index] & ROUTE_CLOSE_TO_END)) {
+			while (index > cursor->start && (cursor->flags[index - 1] & ROUTE_CLOSE_TO_END)) {
+				index--;
+			}
+		}
+		target = index;
+		for (i = cursor->start + 2; i <= index; i++) {
+			if (cursor->flags[i] & ROUTE_WAYPOINT) {
+				target = i;
+				break;
+			}
+		}
+		EXTEND (SP, 3);
+		mPUSHi (index - cursor->start);
+		mPUSHi (cursor->cells[target * 2]);
+		mPUSHi (cursor->cells[target * 2 + 1]);
+
+void
+PathFindingRouteCursor_DESTROY(cursor)
+		PathFinding_RouteCursor cursor
+	CODE:
+		free (cursor->cells);
+		free (cursor->flags);
+		free (cursor);
+
+MODULE = PathFinding		PACKAGE = PathFinding::TileMap		PREFIX = PathFindingTileMap_
+PROTOTYPES: ENABLE
+
+PathFinding_TileMap
+PathFindingTileMap_new(klass, rawMap, width, height)
+		SV * klass
+		SV * rawMap
+		int width
+		int height
+	CODE:
+		PERL_UNUSED_VAR(klass);
+		if (!SvROK(rawMap) || (SvTYPE(SvRV(rawMap)) >= SVt_PVAV && !sv_derived_from(rawMap, "Utils::FieldChunks"))) {
+			croak("rawMap must be a reference to a scalar or a Utils::FieldChunks object");
+		}
+		if (width <= 0 || height <= 0) {
+			croak("bad map size %d x %d", width, height);
+		}
+		RETVAL = (PathFinding_TileMap) malloc (sizeof(TileMap));
+		RETVAL->rawMap = SvREFCNT_inc (SvRV(rawMap));
+		RETVAL->chunks = NULL;
+		if (sv_isobject(rawMap) && sv_derived_from(rawMap, "Utils::FieldChunks")) {
+			RETVAL->chunks = INT2PTR(FieldChunks *, SvIV(SvRV(rawMap)));
+			if (RETVAL->chunks->width != width || RETVAL->chunks->height != height) {
+				int chunksWidth = RETVAL->chunks->width, chunksHeight = RETVAL->chunks->height;
+				SvREFCNT_dec (RETVAL->rawMap);
+				free (RETVAL);
+				croak("the chunks hold a %d x %d map instead of %d x %d", chunksWidth, chunksHeight, width, height);
+			}
+		}
+		RETVAL->width = width;
+		RETVAL->height = height;
+	OUTPUT:
+		RETVAL
+
+int
+PathFindingTileMap_isWalkable(map, x, y)
+		PathFinding_TileMap map
+		IV x
+		IV y
+	ALIAS:
+		isSnipable = 2
+		isWater = 4
+		isCliff = 8
+	CODE:
+		RETVAL = PathFinding_tileAt (map, x, y, ix ? ix : 1);
+	OUTPUT:
+		RETVAL
+
+int
+PathFindingTileMap_checkTile(map, x, y, tile)
+		PathFinding_TileMap map
+		IV x
+		IV y
+		int tile
+	CODE:
+		RETVAL = PathFinding_tileAt (map, x, y, tile);
+	OUTPUT:
+		RETVAL
+
+SV *
+PathFindingTileMap_bits(map, tile)
+		PathFinding_TileMap map
+		int tile
+	PREINIT:
+		long size;
+		long offset;
+		unsigned char *bits;
+		const char *data;
+		STRLEN len;
+	CODE:
+		/* One bit per cell in the order of vec($bits, y * width + x, 1), the lowest bit of each byte first */
+		size = (long) map->width * map->height;
+		RETVAL = newSV ((size + 7) / 8 + 1);
+		SvPOK_only (RETVAL);
+		SvCUR_set (RETVAL, (size + 7) / 8);
+		bits = (unsigned char *) SvPVX (RETVAL);
+		memset (bits, 0, (size + 7) / 8 + 1);
+		if (map->chunks) {
+			for (offset = 0; offset < size; offset++) {
+				if (FieldChunks_cell (map->chunks, (int) (offset % map->width), (int) (offset / map->width)) & tile) {
+					bits[offset >> 3] |= 1 << (offset & 7);
+				}
+			}
+		} else {
+			data = SvPOK(map->rawMap) ? SvPVX(map->rawMap) : "";
+			len = SvPOK(map->rawMap) ? SvCUR(map->rawMap) : 0;
+			for (offset = 0; offset < size && (STRLEN) offset < len; offset++) {
+				if (data[offset] & tile) {
+					bits[offset >> 3] |= 1 << (offset & 7);
+				}
+			}
+		}
+	OUTPUT:
+		RETVAL
+
+int
+PathFindingTileMap_width(map)
+		PathFinding_TileMap map
+	CODE:
+		RETVAL = map->width;
+	OUTPUT:
+		RETVAL
+
+int
+PathFindingTileMap_height(map)
+		PathFinding_TileMap map
+	CODE:
+		RETVAL = map->height;
+	OUTPUT:
+		RETVAL
+
+void
+PathFindingTileMap_DESTROY(map)
+		PathFinding_TileMap map
+	CODE:
+		SvREFCNT_dec (map->rawMap);
+		free (map);
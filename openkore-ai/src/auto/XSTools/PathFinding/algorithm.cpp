@@ -2,15 +2,47 @@
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
+#include "../utils/cpu-features.h"
+#ifdef SIMD_X86
+	#include <immintrin.h>
+#endif
 #include "algorithm.h"
+#include "visibility.h"
+#include "danger.h"
+#include "landmarks.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
-#define NONE 0
-#define OPEN 1
-#define CLOSED 2
+// The list state of a node is only valid if it was written during the current generation, otherwise the node is treated as NONE
+#define NODE_STATE(session, adress) (((session)->nodeState[adress] >> 2) == (session)->generation ? ((session)->nodeState[adress] & 3) : NONE)
+#define SET_NODE_STATE(session, adress, state) ((session)->nodeState[adress] = ((session)->generation << 2) | (state))
+
+// Generations are stored in the upper 30 bits of nodeState
+#define MAX_GENERATION 0x3FFFFFFF
+
+// Neighbor mask bits pointing to each side, bit i is the direction (i_x[i], i_y[i]) used in CalcPath_pathStep
+#define NEIGHBORS_NORTH ((1 << 0) | (1 << 4) | (1 << 7))
+#define NEIGHBORS_SOUTH ((1 << 1) | (1 << 5) | (1 << 6))
+#define NEIGHBORS_EAST  ((1 << 2) | (1 << 4) | (1 << 5))
+#define NEIGHBORS_WEST  ((1 << 3) | (1 << 6) | (1 << 7))
+
+// Index of the lowest set bit of a non-zero neighbor mask
+static inline int
+lowestBit (unsigned int mask)
+{
+#ifdef __GNUC__
+	return __builtin_ctz(mask);
+#else
+	int i = 0;
+	while (!(mask & 1)) {
+		mask >>= 1;
+		i++;
+	}
+	return i;
+#endif
+}
 
 #ifdef WIN32
 	#include <windows.h>
@@ -25,6 +57,171 @@ extern "C" {
 	}
 #endif /* WIN32 */
 
+// Microseconds from an arbitrary point in time, used for the time budget of sliced searches
+static unsigned long long
+GetMicroTicks ()
+{
+#ifdef WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency (&frequency);
+	QueryPerformanceCounter (&counter);
+	return (unsigned long long) (counter.QuadPart / frequency.QuadPart) * 1000000
+		+ (unsigned long long) (counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart;
+#else
+	struct timeval tv;
+	gettimeofday (&tv, (struct timezone *) NULL);
+	return ((unsigned long long) tv.tv_sec * 1000000) + tv.tv_usec;
+#endif /* WIN32 */
+}
+
+// Limits of a single CalcPath_pathStep call
+typedef struct {
+	unsigned long timeout;
+	unsigned long long sliceStart;
+	unsigned long expanded;
+	int loop;
+} StepLimits;
+
+static inline void
+stepLimitsInit (CalcPath_session *session, StepLimits *limits)
+{
+	limits->timeout = (unsigned long) GetTickCount();
+	limits->sliceStart = (session->time_budget) ? GetMicroTicks() : 0;
+	limits->expanded = 0;
+	limits->loop = 0;
+}
+
+// Called before expanding each node, returns 0 to go on, -3 if the search ran out of time_max or -4 if the node or time budget of this call ran out.
+// The budget is only checked after expanding at least one node, so a sliced search always makes progress.
+static inline int
+stepLimitsReached (CalcPath_session *session, StepLimits *limits)
+{
+	if (session->node_budget && limits->expanded >= session->node_budget) {
+		return -4;
+	}
+	limits->expanded++;
+	session->expanded++;
+
+	// Every 100th loop check if we have ran out if time
+	limits->loop++;
+	if (limits->loop == 100) {
+		if (GetTickCount() - limits->timeout > session->time_max) {
+			printf("[pathfinding run error] Pathfinding ended before provided time.\n");
+			return -3;
+		}
+		if (session->time_budget && GetMicroTicks() - limits->sliceStart > session->time_budget) {
+			return -4;
+		}
+		limits->loop = 0;
+	}
+	return 0;
+}
+
+static void bucketListInit (CalcPath_session *session, unsigned long size);
+
+// Per session xorshift32 generator, unlike rand() it keeps no global state so sessions can search in different threads
+static inline unsigned int
+CalcPath_random (CalcPath_session *session)
+{
+	unsigned int x = session->randomState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	session->randomState = x;
+	return x;
+}
+
+
+// Heuristic of a node towards the session goal, raised to the landmark bound when the session has landmarks
+static inline unsigned int
+goalHeuristic (CalcPath_session *session, int x, int y)
+{
+	unsigned int h = heuristic_cost_estimate(x, y, session->endX, session->endY, session->useManhattan);
+	const unsigned short *costs;
+	int i;
+
+	if (!session->landmarkCount) {
+		return h;
+	}
+
+	// The cost to the goal is at least the difference of the costs of the node and the goal from any landmark
+	costs = session->landmarks + (unsigned long) (y * session->width + x) * session->landmarkCount;
+	for (i = 0; i < session->landmarkCount; i++) {
+		unsigned int node = costs[i];
+		unsigned int goal = session->landmarkGoal[i];
+		if (node < LANDMARK_FAR && goal < LANDMARK_FAR) {
+			unsigned int bound = (node > goal) ? node - goal : goal - node;
+			if (bound > h) {
+				h = bound;
+			}
+		}
+	}
+	return h;
+}
+
+/*******************************************/
+
+// Sets the window to windowBox grown by 'margin' cells, clipped to the search area given to reset
+static void
+windowSet (CalcPath_session *session, int margin)
+{
+	session->min_x = (session->windowBox[0] - margin > session->limit_min_x) ? session->windowBox[0] - margin : session->limit_min_x;
+	session->max_x = (session->windowBox[1] + margin < session->limit_max_x) ? session->windowBox[1] + margin : session->limit_max_x;
+	session->min_y = (session->windowBox[2] - margin > session->limit_min_y) ? session->windowBox[2] - margin : session->limit_min_y;
+	session->max_y = (session->windowBox[3] + margin < session->limit_max_y) ? session->windowBox[3] + margin : session->limit_max_y;
+
+	if (session->min_x == session->limit_min_x && session->max_x == session->limit_max_x
+	 && session->min_y == session->limit_min_y && session->max_y == session->limit_max_y) {
+		session->windowMargin = 0;
+	} else {
+		session->windowMargin = margin;
+	}
+}
+
+// Grows the window to cover the cell (x, y)
+static void
+windowCover (CalcPath_session *session, int x, int y)
+{
+	if (x < session->windowBox[0]) session->windowBox[0] = x;
+	if (x > session->windowBox[1]) session->windowBox[1] = x;
+	if (y < session->windowBox[2]) session->windowBox[2] = y;
+	if (y > session->windowBox[3]) session->windowBox[3] = y;
+}
+
+// Keeps a closed node which had neighbors out of the window, to expand it again once the window grows
+static void
+windowBorderAdd (CalcPath_session *session, unsigned int adress)
+{
+	if (session->windowBorderSize == session->windowBorderCapacity) {
+		session->windowBorderCapacity = session->windowBorderCapacity ? session->windowBorderCapacity * 2 : 256;
+		session->windowBorder = (unsigned int *) realloc (session->windowBorder, session->windowBorderCapacity * sizeof(unsigned int));
+	}
+	session->windowBorder[session->windowBorderSize++] = adress;
+}
+
+// Called when the open list runs out: doubles the margin of the window and opens the nodes of its old border again, with their
+// f score being g + h unless useHeuristic is 0 (Dijkstra). Returns 0 if the window can't grow or no node reached its border,
+// the search is then over.
+static int
+windowGrow (CalcPath_session *session, int useHeuristic)
+{
+	unsigned long i;
+
+	if (!session->windowMargin || session->windowBorderSize == 0) {
+		return 0;
+	}
+
+	windowSet (session, session->windowMargin * 2);
+	session->windowGrowths++;
+	for (i = 0; i < session->windowBorderSize; i++) {
+		unsigned int adress = session->windowBorder[i];
+		int x = adress % session->width;
+		int y = adress / session->width;
+		openListAdd (session, adress, session->gScore[adress] + (useHeuristic ? goalHeuristic(session, x, y) : 0));
+	}
+	session->windowBorderSize = 0;
+	return 1;
+}
 
 /*******************************************/
 
@@ -39,6 +236,63 @@ CalcPath_new ()
 
 	session->initialized = 0;
 	session->run = 0;
+	session->node_budget = 0;
+	session->time_budget = 0;
+
+	// Every session gets its own random sequence, the seed only has to be different between sessions and runs
+	session->randomState = ((unsigned int) GetTickCount() * 2654435761U) ^ (unsigned int) (size_t) session;
+	if (session->randomState == 0) {
+		session->randomState = 1;
+	}
+
+	session->neighbor_mask = NULL;
+	session->nodeState = NULL;
+	session->gScore = NULL;
+	session->predecessor = NULL;
+	session->openListIndex = NULL;
+	session->bidiState = NULL;
+	session->bidiGScore = NULL;
+	session->bidiSuccessor = NULL;
+	session->bidiCapacity = 0;
+	memset(session->bidiOpen, 0, sizeof(session->bidiOpen));
+	session->bidiDone = 0;
+	session->expanded = 0;
+	session->window = 0;
+	session->windowMargin = 0;
+	session->windowBorder = NULL;
+	session->windowBorderSize = 0;
+	session->windowBorderCapacity = 0;
+	session->windowGrowths = 0;
+	session->customWeightTable = NULL;
+	session->customWeightMask = 0;
+	session->customWeightDigest = 0;
+	session->danger = NULL;
+	session->dangerVersion = 0;
+	session->obstacles = NULL;
+	session->obstaclesVersion = 0;
+	session->openList = NULL;
+	session->buckets = NULL;
+	session->bucketLinks = NULL;
+	session->openListType = OPENLIST_HEAP;
+	session->nodeCapacity = 0;
+	session->customWeightCapacity = 0;
+	session->openListCapacity = 0;
+	session->bucketCount = 0;
+	session->bucketLinksCapacity = 0;
+	session->bucketsUsed = 0;
+	session->generation = 0;
+	session->jobStatus = 0;
+	session->jobResult = 0;
+	session->job = NULL;
+	session->jobOwners[0] = NULL;
+	session->jobOwners[1] = NULL;
+	session->jobOwners[2] = NULL;
+	session->jobOwners[3] = NULL;
+	session->jobOwners[4] = NULL;
+	session->landmarks = NULL;
+	session->landmarkCount = 0;
+	session->routeCacheField = 0;
+	session->cachedResult = 0;
 
 	return session;
 }
@@ -48,84 +302,906 @@ CalcPath_new ()
 void
 CalcPath_init (CalcPath_session *session)
 {
-	// Allocate enough memory in currentMap to hold all nodes in the map
-	// Here we use calloc instead of malloc (calloc sets all memory allocated to 0's) so all uninitialized cells have whichlist set to NONE
-	session->currentMap = (Node*) calloc(session->height * session->width, sizeof(Node));
-	if (session->customWeights) {
-		session->second_weight_map = (unsigned int*) calloc(session->height * session->width, sizeof(unsigned int));
+	unsigned long size = (unsigned long) session->height * session->width;
+
+	// The node arrays are only allocated when the session has never held a map this big, otherwise the old buffers are reused
+	// nodeState uses calloc instead of malloc (calloc sets all memory allocated to 0's) so all uninitialized cells belong to generation 0
+	// The other arrays are only read for nodes touched in the current generation, so they don't need to be cleared
+	if (size > session->nodeCapacity) {
+		free(session->nodeState);
+		free(session->gScore);
+		free(session->predecessor);
+		free(session->openListIndex);
+		session->nodeState = (unsigned int*) calloc(size, sizeof(unsigned int));
+		session->gScore = (unsigned int*) malloc(size * sizeof(unsigned int));
+		session->predecessor = (unsigned int*) malloc(size * sizeof(unsigned int));
+		session->openListIndex = (unsigned int*) malloc(size * sizeof(unsigned int));
+		session->nodeCapacity = size;
+		session->generation = 0;
+
+		// The generations start over, so do the ones of the backward search arrays, which are allocated again when needed
+		free(session->bidiState);
+		free(session->bidiGScore);
+		free(session->bidiSuccessor);
+		session->bidiState = NULL;
+		session->bidiGScore = NULL;
+		session->bidiSuccessor = NULL;
+		session->bidiCapacity = 0;
+	}
+
+	// Bump the generation, this invalidates all nodes of the previous search without touching them
+	// In the unlikely case the counter wraps around we have to clear nodeState once
+	session->generation++;
+	if (session->generation > MAX_GENERATION) {
+		memset(session->nodeState, 0, session->nodeCapacity * sizeof(unsigned int));
+		if (session->bidiState) {
+			memset(session->bidiState, 0, session->bidiCapacity * sizeof(unsigned int));
+		}
+		session->generation = 1;
+	}
+
+	// Jump Point Search skips over cells assuming every step has the same cost, so any extra weight forces a normal A* search
+	if (session->algorithm == CALCPATH_JPS && (session->avoidWalls || session->customWeights || session->danger || session->obstacles || session->randomFactor)) {
+		session->algorithm = CALCPATH_ASTAR;
+	}
+
+	// The stopping rule of the bidirectional search needs a consistent heuristic and the same cost for a step in both directions
+	if (session->algorithm == CALCPATH_BIDIRECTIONAL && (session->useManhattan || session->randomFactor)) {
+		session->algorithm = CALCPATH_ASTAR;
 	}
 
-	long goalAdress = (session->endY * session->width) + session->endX;
-	Node* goal = &session->currentMap[goalAdress];
-	goal->x = session->endX;
-	goal->y = session->endY;
-	goal->nodeAdress = goalAdress;
+	// The landmark bound is admissible, but the client mimicking manhattan searches must keep their heuristic, and the
+	// stopping rule of the bidirectional search is only checked with the diagonal distance
+	if (session->useManhattan || session->algorithm == CALCPATH_BIDIRECTIONAL) {
+		session->landmarkCount = 0;
+	}
+	if (session->landmarkCount) {
+		const unsigned short *goal = session->landmarks + (unsigned long) (session->endY * session->width + session->endX) * session->landmarkCount;
+		memcpy(session->landmarkGoal, goal, session->landmarkCount * sizeof(unsigned short));
+	}
 
-	long startAdress = (session->startY * session->width) + session->startX;
-	Node* start = &session->currentMap[startAdress];
-	start->x = session->startX;
-	start->y = session->startY;
-	start->nodeAdress = startAdress;
-	start->h = heuristic_cost_estimate(start->x, start->y, goal->x, goal->y, session->useManhattan);
-	start->f = start->h;
+	session->expanded = 0;
+	session->bidiDone = 0;
+
+	// The jump points and the backward search don't stop on the border of the window, so they always search the whole area
+	session->limit_min_x = session->min_x;
+	session->limit_max_x = session->max_x;
+	session->limit_min_y = session->min_y;
+	session->limit_max_y = session->max_y;
+	session->windowBox[0] = (session->startX < session->endX) ? session->startX : session->endX;
+	session->windowBox[1] = (session->startX > session->endX) ? session->startX : session->endX;
+	session->windowBox[2] = (session->startY < session->endY) ? session->startY : session->endY;
+	session->windowBox[3] = (session->startY > session->endY) ? session->startY : session->endY;
+	session->windowBorderSize = 0;
+	session->windowGrowths = 0;
+	session->windowMargin = 0;
+	if (session->window > 0 && session->algorithm == CALCPATH_ASTAR) {
+		windowSet (session, session->window);
+	}
 
+	session->cachedResult = 0;
 	session->initialized = 1;
 }
 
-// The actual A* pathfinding algorithm, loops until it finds a path or runs out of time.
-int 
-CalcPath_pathStep (CalcPath_session *session)
+/*******************************************/
+
+// Prepares an empty custom weights table for 'count' cells, it is kept at most half full so probe sequences stay short
+void
+CalcPath_initCustomWeights (CalcPath_session *session, long count)
 {
-	if (!session->initialized) {
-		printf("[pathfinding run error] You must call 'reset' before 'run'.\n");
-		return -2;
+	unsigned long slots = 16;
+	unsigned long i;
+
+	while (slots < (unsigned long) count * 2) {
+		slots <<= 1;
 	}
 
-	Node* start = &session->currentMap[((session->startY * session->width) + session->startX)];
-	Node* goal = &session->currentMap[((session->endY * session->width) + session->endX)];
+	if (slots > session->customWeightCapacity) {
+		free(session->customWeightTable);
+		session->customWeightTable = (CustomWeight*) malloc(slots * sizeof(CustomWeight));
+		session->customWeightCapacity = slots;
+	}
 
-	if (!session->run) {
-		session->run = 1;
-		session->openListSize = 0;
-		// Allocate enough memory in openList to hold the adress of all nodes in the map
-		session->openList = (long*) malloc((session->height * session->width) * sizeof(long));
+	for (i = 0; i < slots; i++) {
+		session->customWeightTable[i].adress = CUSTOM_WEIGHT_EMPTY;
+	}
+	session->customWeightMask = slots - 1;
+	session->customWeightDigest = 0;
+}
 
-		// To initialize the pathfinding add only the start node to openList
-		openListAdd (session, start);
+// Slot of 'adress' in the custom weights table, or the free slot where it should be added
+static inline unsigned long
+customWeightSlot (CalcPath_session *session, unsigned int adress)
+{
+	// Multiplying by an odd constant scatters the adresses of nearby cells over the table
+	unsigned long slot = (adress * 2654435761U) & session->customWeightMask;
+	while (session->customWeightTable[slot].adress != adress && session->customWeightTable[slot].adress != CUSTOM_WEIGHT_EMPTY) {
+		slot = (slot + 1) & session->customWeightMask;
 	}
+	return slot;
+}
 
-	// If the start node and goal node are the same return a valid path with length 0
-	if (goal->nodeAdress == start->nodeAdress) {
-		session->solution_size = 0;
+// Sets the extra weight of a cell, the table must have been prepared by CalcPath_initCustomWeights with room for it
+void
+CalcPath_setCustomWeight (CalcPath_session *session, unsigned int adress, unsigned int weight)
+{
+	unsigned long slot = customWeightSlot (session, adress);
+	session->customWeightTable[slot].adress = adress;
+	session->customWeightTable[slot].weight = weight;
+	// A sum of the mixed cells doesn't depend on the order in which they are given
+	session->customWeightDigest += ((((unsigned long long) adress << 32) | weight) * 0x9E3779B97F4A7C15ULL) ^ (adress * 0xC2B2AE3DU);
+}
+
+static inline unsigned int
+customWeightAt (CalcPath_session *session, unsigned int adress)
+{
+	unsigned long slot = customWeightSlot (session, adress);
+	return (session->customWeightTable[slot].adress == adress) ? session->customWeightTable[slot].weight : 0;
+}
+
+/*******************************************/
+
+// Jump Point Search (Harabor and Grastien), a variant of A* for uniform cost maps which only adds "jump points" to openList.
+// Straight and diagonal lines are scanned until a cell is found where an optimal path may have to turn, every cell in between is skipped.
+// Like the A* search, diagonal moves need both ortogonal composite nodes to be walkable, so there are no forced neighbors on diagonal moves.
+
+// A cell is walkable if it is inside the search area and not a wall
+#define JPS_WALKABLE(session, x, y) ((x) >= (session)->min_x && (x) <= (session)->max_x && (y) >= (session)->min_y && (y) <= (session)->max_y && (session)->map_base_weight[((y) * (session)->width) + (x)] != -1)
+
+#define JPS_SIGN(value) (((value) > 0) - ((value) < 0))
+
+// Scans from (x, y) in the ortogonal direction (dx, dy), returns 1 and stores the cell in (jump_x, jump_y) if a jump point was found
+static int
+jps_jumpStraight (CalcPath_session *session, int x, int y, int dx, int dy, int *jump_x, int *jump_y)
+{
+	while (1) {
+		x += dx;
+		y += dy;
+
+		if (!JPS_WALKABLE(session, x, y)) {
+			return 0;
+		}
+
+		// A cell is a jump point if it is the goal or if it has a forced neighbor,
+		// which is a side cell that can only be reached through this cell because the cell behind it is blocked
+		if ((x == session->endX && y == session->endY)
+		 || (dx != 0 && ((JPS_WALKABLE(session, x, y + 1) && !JPS_WALKABLE(session, x - dx, y + 1)) || (JPS_WALKABLE(session, x, y - 1) && !JPS_WALKABLE(session, x - dx, y - 1))))
+		 || (dy != 0 && ((JPS_WALKABLE(session, x + 1, y) && !JPS_WALKABLE(session, x + 1, y - dy)) || (JPS_WALKABLE(session, x - 1, y) && !JPS_WALKABLE(session, x - 1, y - dy))))) {
+			*jump_x = x;
+			*jump_y = y;
+			return 1;
+		}
+	}
+}
+
+// Scans from (x, y) in the diagonal direction (dx, dy), a cell is a jump point if one of the straight scans started from it finds a jump point
+static int
+jps_jumpDiagonal (CalcPath_session *session, int x, int y, int dx, int dy, int *jump_x, int *jump_y)
+{
+	int found_x;
+	int found_y;
+
+	while (1) {
+		if (!JPS_WALKABLE(session, x + dx, y) || !JPS_WALKABLE(session, x, y + dy) || !JPS_WALKABLE(session, x + dx, y + dy)) {
+			return 0;
+		}
+
+		x += dx;
+		y += dy;
+
+		if ((x == session->endX && y == session->endY)
+		 || jps_jumpStraight(session, x, y, dx, 0, &found_x, &found_y)
+		 || jps_jumpStraight(session, x, y, 0, dy, &found_x, &found_y)) {
+			*jump_x = x;
+			*jump_y = y;
+			return 1;
+		}
+	}
+}
+
+// The predecessor of a jump point is the previous jump point, which can be many cells away.
+// Walks the solution from the goal and links every skipped cell to the next one, so the path can be read one cell at a time like an A* solution.
+static void
+jps_expandPath (CalcPath_session *session, unsigned int goalAdress, unsigned int startAdress)
+{
+	unsigned int currentAdress = goalAdress;
+	unsigned int jumpAdress;
+	int current_x;
+	int current_y;
+	int jump_x;
+	int jump_y;
+	int dx;
+	int dy;
+
+	while (currentAdress != startAdress) {
+		jumpAdress = session->predecessor[currentAdress];
+		current_x = currentAdress % session->width;
+		current_y = currentAdress / session->width;
+		jump_x = jumpAdress % session->width;
+		jump_y = jumpAdress / session->width;
+		dx = JPS_SIGN(jump_x - current_x);
+		dy = JPS_SIGN(jump_y - current_y);
+
+		while (current_x + dx != jump_x || current_y + dy != jump_y) {
+			current_x += dx;
+			current_y += dy;
+			session->predecessor[currentAdress] = (current_y * session->width) + current_x;
+			currentAdress = session->predecessor[currentAdress];
+		}
+
+		session->predecessor[currentAdress] = jumpAdress;
+		currentAdress = jumpAdress;
+	}
+}
+
+// Same loop as the A* search in CalcPath_pathStep, but the neighbors of a node are the jump points found in its pruned directions
+static int
+jps_pathStep (CalcPath_session *session, unsigned int startAdress, unsigned int goalAdress)
+{
+	unsigned int currentAdress;
+	unsigned int parentAdress;
+	int current_x;
+	int current_y;
+	int parent_dx;
+	int parent_dy;
+
+	// Directions to scan from the current node, the start node scans all 8
+	short directions_x[8];
+	short directions_y[8];
+	short directions;
+	short i;
+
+	int jump_x;
+	int jump_y;
+	int found;
+	unsigned int jump_adress;
+	unsigned int jump_state;
+	unsigned int xDistance;
+	unsigned int yDistance;
+	unsigned int g_score;
+
+	StepLimits limits;
+	int limitStatus;
+	stepLimitsInit (session, &limits);
+
+	// A previous run already found the goal
+	if (NODE_STATE(session, goalAdress) == CLOSED) {
+		reconstruct_path(session, goalAdress, startAdress);
 		return 1;
 	}
 
-	Node* currentNode;
-	Node* neighborNode;
+	while (1) {
+		// If the openList is empty no path exists
+		if (session->openListSize == 0) {
+			return -1;
+		}
+
+		limitStatus = stepLimitsReached (session, &limits);
+		if (limitStatus < 0) {
+			return limitStatus;
+		}
+
+		currentAdress = openListGetLowest (session);
+
+		// Jump points can be far apart, so the goal is only done when it is taken out of openList
+		if (currentAdress == goalAdress) {
+			jps_expandPath(session, goalAdress, startAdress);
+			reconstruct_path(session, goalAdress, startAdress);
+			return 1;
+		}
+
+		current_x = currentAdress % session->width;
+		current_y = currentAdress / session->width;
+
+		directions = 0;
+		parentAdress = session->predecessor[currentAdress];
+		if (parentAdress == currentAdress) {
+			short all_x[8] = {0, 0, 1, -1, 1, 1, -1, -1};
+			short all_y[8] = {1, -1, 0, 0, 1, -1, -1, 1};
+			for (i = 0; i < 8; i++) {
+				directions_x[directions] = all_x[i];
+				directions_y[directions] = all_y[i];
+				directions++;
+			}
+		} else {
+			parent_dx = JPS_SIGN(current_x - (int) (parentAdress % session->width));
+			parent_dy = JPS_SIGN(current_y - (int) (parentAdress / session->width));
+
+			if (parent_dx != 0 && parent_dy != 0) {
+				// Diagonal move, keep going diagonally or along either of its ortogonal components
+				directions_x[0] = parent_dx; directions_y[0] = parent_dy;
+				directions_x[1] = parent_dx; directions_y[1] = 0;
+				directions_x[2] = 0;         directions_y[2] = parent_dy;
+				directions = 3;
+			} else if (parent_dx != 0) {
+				// Ortogonal move, keep going forward, turn to either side or move diagonally forward, never backwards
+				directions_x[0] = parent_dx; directions_y[0] = 0;
+				directions_x[1] = 0;         directions_y[1] = 1;
+				directions_x[2] = 0;         directions_y[2] = -1;
+				directions_x[3] = parent_dx; directions_y[3] = 1;
+				directions_x[4] = parent_dx; directions_y[4] = -1;
+				directions = 5;
+			} else {
+				directions_x[0] = 0;         directions_y[0] = parent_dy;
+				directions_x[1] = 1;         directions_y[1] = 0;
+				directions_x[2] = -1;        directions_y[2] = 0;
+				directions_x[3] = 1;         directions_y[3] = parent_dy;
+				directions_x[4] = -1;        directions_y[4] = parent_dy;
+				directions = 5;
+			}
+		}
+
+		for (i = 0; i < directions; i++) {
+			if (directions_x[i] != 0 && directions_y[i] != 0) {
+				found = jps_jumpDiagonal(session, current_x, current_y, directions_x[i], directions_y[i], &jump_x, &jump_y);
+			} else {
+				found = jps_jumpStraight(session, current_x, current_y, directions_x[i], directions_y[i], &jump_x, &jump_y);
+			}
+
+			if (!found) {
+				continue;
+			}
+
+			jump_adress = (jump_y * session->width) + jump_x;
+			jump_state = NODE_STATE(session, jump_adress);
+
+			if (jump_state == CLOSED) {
+				continue;
+			}
+
+			// Jump points are always in a straight or diagonal line, so the cost between them is 14 per diagonal step plus 10 per ortogonal step
+			xDistance = (jump_x > current_x) ? (jump_x - current_x) : (current_x - jump_x);
+			yDistance = (jump_y > current_y) ? (jump_y - current_y) : (current_y - jump_y);
+			g_score = session->gScore[currentAdress] + (10 * (xDistance + yDistance)) - (6 * ((xDistance > yDistance) ? yDistance : xDistance));
+
+			if (jump_state == NONE) {
+				session->predecessor[jump_adress] = currentAdress;
+				session->gScore[jump_adress] = g_score;
+				openListAdd (session, jump_adress, g_score + goalHeuristic(session, jump_x, jump_y));
+
+			} else if (g_score < session->gScore[jump_adress]) {
+				session->predecessor[jump_adress] = currentAdress;
+				session->gScore[jump_adress] = g_score;
+				reajustOpenListItem (session, jump_adress, g_score + goalHeuristic(session, jump_x, jump_y));
+			}
+		}
+	}
+	return -1;
+}
+
+/*******************************************/
+
+// Adds or updates all walkable neighbors of currentAdress in openList, their f score is g + h unless useHeuristic is 0 (Dijkstra)
+static inline void
+expandNode (CalcPath_session *session, unsigned int currentAdress, int useHeuristic)
+{
+	int current_x;
+	int current_y;
 
 	short i;
 
 	// All possible directions the character can move (in order: north, south, east, west, northeast, southeast, southwest, northwest)
-	short i_x[8] = {0, 0, 1, -1, 1, 1, -1, -1};
-	short i_y[8] = {1, -1, 0, 0, 1, -1, -1, 1};
+	static const short i_x[8] = {0, 0, 1, -1, 1, 1, -1, -1};
+	static const short i_y[8] = {1, -1, 0, 0, 1, -1, -1, 1};
 
+	unsigned int neighbors;
 	int neighbor_x;
 	int neighbor_y;
-	long neighbor_adress;
+	unsigned int neighbor_adress;
+	unsigned int neighbor_state;
 	unsigned long distanceFromCurrent;
 	unsigned int c_randomFactor;
 
 	unsigned int g_score = 0;
 
-	unsigned long timeout = (unsigned long) GetTickCount();
-	int loop = 0;
+	current_x = currentAdress % session->width;
+	current_y = currentAdress / session->width;
+
+	// Bitmask of the walkable neighbors of currentNode, diagonals are only set if both ortogonal composite nodes are walkable
+	// Use the precomputed field mask if we have one, otherwise compute it for this cell
+	if (session->neighbor_mask) {
+		neighbors = session->neighbor_mask[currentAdress];
+	} else {
+		neighbors = CalcPath_neighborMaskAt(session->map_base_weight, session->width, session->height, current_x, current_y);
+	}
+
+	// Nodes on the border of the search area cannot expand outside of it, the ones cut off by a window which can still grow are kept
+	if (current_x == session->min_x || current_x == session->max_x || current_y == session->min_y || current_y == session->max_y) {
+		unsigned int inside = neighbors;
+		if (current_x == session->min_x) inside &= ~NEIGHBORS_WEST;
+		if (current_x == session->max_x) inside &= ~NEIGHBORS_EAST;
+		if (current_y == session->min_y) inside &= ~NEIGHBORS_SOUTH;
+		if (current_y == session->max_y) inside &= ~NEIGHBORS_NORTH;
+		if (inside != neighbors && session->windowMargin) {
+			windowBorderAdd (session, currentAdress);
+		}
+		neighbors = inside;
+	}
+
+	// Loop between all walkable neighbors, in the same order as the directions above
+	while (neighbors)
+	{
+		i = lowestBit(neighbors);
+		neighbors &= neighbors - 1;
+
+		neighbor_x = current_x + i_x[i];
+		neighbor_y = current_y + i_y[i];
+		neighbor_adress = (neighbor_y * session->width) + neighbor_x;
+
+		neighbor_state = NODE_STATE(session, neighbor_adress);
+
+		// If a neighbor is in closedList ignore it, it has already been expanded and has its lowest possible g_score
+		if (neighbor_state == CLOSED) {
+			continue;
+		}
+
+		// First 4 neighbors in the list are in a ortogonal path and the last 4 are in a diagonal path from currentNode.
+		if (i >= 4) {
+			// We use 14 as the diagonal movement weight
+			distanceFromCurrent = 14;
+		} else {
+			// We use 10 for ortogonal movement weight
+			distanceFromCurrent = 10;
+		}
+
+		// If avoidWalls is true we add weight to cells near walls to disencourage the algorithm to move to them.
+		if (session->avoidWalls) {
+			distanceFromCurrent += session->map_base_weight[neighbor_adress];
+		}
+
+		if (session->customWeights) {
+			distanceFromCurrent += customWeightAt(session, neighbor_adress);
+		}
+
+		if (session->danger) {
+			distanceFromCurrent += session->danger->weights[neighbor_adress];
+		}
+
+		if (session->obstacles) {
+			distanceFromCurrent += session->obstacles->weights[neighbor_adress];
+		}
+
+		if (session->randomFactor) {
+			c_randomFactor = CalcPath_random(session) % session->randomFactor;
+			distanceFromCurrent += c_randomFactor;
+		}
+
+		// g_score is the summed weight of all nodes from start node to neighborNode, which is the g_score of currentNode + the weight to move from currentNode to neighborNode.
+		g_score = session->gScore[currentAdress] + distanceFromCurrent;
+
+		// If neighborNode is not in openList neither in closedList it has not been reached yet, initialize it and add it to openList
+		if (neighbor_state == NONE) {
+			session->predecessor[neighbor_adress] = currentAdress;
+			session->gScore[neighbor_adress] = g_score;
+			openListAdd (session, neighbor_adress, g_score + (useHeuristic ? goalHeuristic(session, neighbor_x, neighbor_y) : 0));
+
+		// If neighborNode is in a list it has to be in openList, since we cannot access nodes in closedList. 
+		} else {
+			// Check if we have found a shorter path to neighborNode, if so update it to have currentNode as its predecessor.
+			if (g_score < session->gScore[neighbor_adress]) {
+				session->predecessor[neighbor_adress] = currentAdress;
+				session->gScore[neighbor_adress] = g_score;
+				// Here we could remove neighborNode from openList and add it again to get it to the right position, but reajusting it saves time.
+				reajustOpenListItem (session, neighbor_adress, g_score + (useHeuristic ? goalHeuristic(session, neighbor_x, neighbor_y) : 0));
+			}
+		}
+	}
+}
+
+// Prepares openList for the first run of a search and adds the start node to it with score 'f'
+static void
+startRun (CalcPath_session *session, unsigned int startAdress, unsigned int f)
+{
+	session->run = 1;
+	session->openListSize = 0;
+	// Allocate enough memory in openList to hold all nodes in the map, unless a previous run already did
+	unsigned long size = (unsigned long) session->height * session->width;
+	if (session->openListType == OPENLIST_BUCKET) {
+		bucketListInit (session, size);
+	} else if (size > session->openListCapacity) {
+		free(session->openList);
+		session->openList = (OpenListEntry*) malloc(size * sizeof(OpenListEntry));
+		session->openListCapacity = size;
+	}
+
+	// To initialize the pathfinding add only the start node to openList
+	session->gScore[startAdress] = 0;
+	session->predecessor[startAdress] = startAdress;
+	openListAdd (session, startAdress, f);
+}
+
+/*******************************************/
+
+// Bidirectional A*: a search from the start towards the goal and one from the goal towards the start, the side with the
+// smaller open list is expanded each time. Every node reached from both sides joins a path, the best one is kept.
+// With a consistent heuristic any path not found yet costs at least the lowest f score of either open list, so the
+// search is done once one of them is not lower than the best path. This finds a path of the lowest cost on weighted
+// maps, where meeting the other side first is not enough.
+
+#define BIDI_STATE(session, adress) (((session)->bidiState[adress] >> 2) == (session)->generation ? ((session)->bidiState[adress] & 3) : NONE)
+#define SET_BIDI_STATE(session, adress, state) ((session)->bidiState[adress] = ((session)->generation << 2) | (state))
+
+#define BIDI_NO_PATH 0xFFFFFFFF
+
+static void
+lazyOpenListPush (LazyOpenList *list, unsigned int nodeAdress, unsigned int f)
+{
+	long index;
+
+	if (list->size == list->capacity) {
+		list->capacity = list->capacity ? list->capacity * 2 : 256;
+		list->entries = (OpenListEntry *) realloc (list->entries, list->capacity * sizeof(OpenListEntry));
+	}
+
+	index = list->size++;
+	while (index > 0) {
+		long parent = (index - 1) / 2;
+		if (list->entries[parent].f <= f) {
+			break;
+		}
+		list->entries[index] = list->entries[parent];
+		index = parent;
+	}
+	list->entries[index].f = f;
+	list->entries[index].nodeAdress = nodeAdress;
+}
+
+static void
+lazyOpenListPop (LazyOpenList *list)
+{
+	OpenListEntry last = list->entries[--list->size];
+	long index = 0;
 
 	while (1) {
-		// If the openList is empty no path exists
-		if (session->openListSize == 0) {
+		long child = index * 2 + 1;
+		if (child >= list->size) {
+			break;
+		}
+		if (child + 1 < list->size && list->entries[child + 1].f < list->entries[child].f) {
+			child++;
+		}
+		if (last.f <= list->entries[child].f) {
+			break;
+		}
+		list->entries[index] = list->entries[child];
+		index = child;
+	}
+	if (list->size > 0) {
+		list->entries[index] = last;
+	}
+}
+
+// Weight of stepping on a cell on top of the 10 or 14 of the step, the same one expandNode adds
+static inline unsigned long
+cellWeight (CalcPath_session *session, unsigned int adress)
+{
+	unsigned long weight = 0;
+
+	if (session->avoidWalls) {
+		weight += session->map_base_weight[adress];
+	}
+	if (session->customWeights) {
+		weight += customWeightAt(session, adress);
+	}
+	if (session->danger) {
+		weight += session->danger->weights[adress];
+	}
+	if (session->obstacles) {
+		weight += session->obstacles->weights[adress];
+	}
+	return weight;
+}
+
+// Drops the entries of nodes closed or improved since they were added from the top of the open list of a side (0 for the
+// forward search, 1 for the backward one), returns the f score of its lowest node or BIDI_NO_PATH if it is empty
+static unsigned int
+bidiLowest (CalcPath_session *session, int side)
+{
+	LazyOpenList *list = &session->bidiOpen[side];
+
+	while (list->size > 0) {
+		unsigned int adress = list->entries[0].nodeAdress;
+		unsigned int state = side ? BIDI_STATE(session, adress) : NODE_STATE(session, adress);
+		unsigned int g = side ? session->bidiGScore[adress] : session->gScore[adress];
+		int x = adress % session->width;
+		int y = adress / session->width;
+		unsigned int h = side ? heuristic_cost_estimate(x, y, session->startX, session->startY, 0) : heuristic_cost_estimate(x, y, session->endX, session->endY, 0);
+
+		if (state == OPEN && list->entries[0].f == g + h) {
+			return list->entries[0].f;
+		}
+		lazyOpenListPop (list);
+	}
+	return BIDI_NO_PATH;
+}
+
+// Adds or updates the walkable neighbors of a node in the open list of its side. A backward step from the node to a
+// neighbor is the forward step from the neighbor to the node, so it pays the weight of the node instead of the neighbor's.
+static void
+bidiExpand (CalcPath_session *session, int side, unsigned int currentAdress)
+{
+	static const short i_x[8] = {0, 0, 1, -1, 1, 1, -1, -1};
+	static const short i_y[8] = {1, -1, 0, 0, 1, -1, -1, 1};
+
+	unsigned int *gScore = side ? session->bidiGScore : session->gScore;
+	unsigned int *links = side ? session->bidiSuccessor : session->predecessor;
+	unsigned int *otherGScore = side ? session->gScore : session->bidiGScore;
+	int target_x = side ? session->startX : session->endX;
+	int target_y = side ? session->startY : session->endY;
+	int current_x = currentAdress % session->width;
+	int current_y = currentAdress / session->width;
+	unsigned long leaveWeight = side ? cellWeight(session, currentAdress) : 0;
+	unsigned int neighbors;
+	short i;
+
+	if (session->neighbor_mask) {
+		neighbors = session->neighbor_mask[currentAdress];
+	} else {
+		neighbors = CalcPath_neighborMaskAt(session->map_base_weight, session->width, session->height, current_x, current_y);
+	}
+	if (current_x == session->min_x) neighbors &= ~NEIGHBORS_WEST;
+	if (current_x == session->max_x) neighbors &= ~NEIGHBORS_EAST;
+	if (current_y == session->min_y) neighbors &= ~NEIGHBORS_SOUTH;
+	if (current_y == session->max_y) neighbors &= ~NEIGHBORS_NORTH;
+
+	while (neighbors) {
+		int neighbor_x;
+		int neighbor_y;
+		unsigned int neighbor_adress;
+		unsigned int neighbor_state;
+		unsigned int other_state;
+		unsigned int g_score;
+
+		i = lowestBit(neighbors);
+		neighbors &= neighbors - 1;
+
+		neighbor_x = current_x + i_x[i];
+		neighbor_y = current_y + i_y[i];
+		neighbor_adress = (neighbor_y * session->width) + neighbor_x;
+
+		neighbor_state = side ? BIDI_STATE(session, neighbor_adress) : NODE_STATE(session, neighbor_adress);
+		if (neighbor_state == CLOSED) {
+			continue;
+		}
+
+		g_score = gScore[currentAdress] + ((i >= 4) ? 14 : 10) + (side ? leaveWeight : cellWeight(session, neighbor_adress));
+		if (neighbor_state != NONE && g_score >= gScore[neighbor_adress]) {
+			continue;
+		}
+
+		gScore[neighbor_adress] = g_score;
+		links[neighbor_adress] = currentAdress;
+		if (side) {
+			SET_BIDI_STATE(session, neighbor_adress, OPEN);
+		} else {
+			SET_NODE_STATE(session, neighbor_adress, OPEN);
+		}
+		lazyOpenListPush (&session->bidiOpen[side], neighbor_adress, g_score + heuristic_cost_estimate(neighbor_x, neighbor_y, target_x, target_y, 0));
+
+		other_state = side ? NODE_STATE(session, neighbor_adress) : BIDI_STATE(session, neighbor_adress);
+		if (other_state != NONE && g_score + otherGScore[neighbor_adress] < session->bidiBest) {
+			session->bidiBest = g_score + otherGScore[neighbor_adress];
+			session->bidiMeet = neighbor_adress;
+		}
+	}
+}
+
+// Prepares both searches for the first run
+static void
+bidiStartRun (CalcPath_session *session, unsigned int startAdress, unsigned int goalAdress)
+{
+	if (session->bidiCapacity < session->nodeCapacity) {
+		free(session->bidiState);
+		free(session->bidiGScore);
+		free(session->bidiSuccessor);
+		session->bidiState = (unsigned int*) calloc(session->nodeCapacity, sizeof(unsigned int));
+		session->bidiGScore = (unsigned int*) malloc(session->nodeCapacity * sizeof(unsigned int));
+		session->bidiSuccessor = (unsigned int*) malloc(session->nodeCapacity * sizeof(unsigned int));
+		session->bidiCapacity = session->nodeCapacity;
+	}
+
+	session->run = 1;
+	session->bidiOpen[0].size = 0;
+	session->bidiOpen[1].size = 0;
+	session->bidiBest = BIDI_NO_PATH;
+	session->bidiMeet = startAdress;
+	session->bidiDone = 0;
+
+	session->gScore[startAdress] = 0;
+	session->predecessor[startAdress] = startAdress;
+	SET_NODE_STATE(session, startAdress, OPEN);
+	lazyOpenListPush (&session->bidiOpen[0], startAdress, heuristic_cost_estimate(session->startX, session->startY, session->endX, session->endY, 0));
+
+	session->bidiGScore[goalAdress] = 0;
+	session->bidiSuccessor[goalAdress] = goalAdress;
+	SET_BIDI_STATE(session, goalAdress, OPEN);
+	lazyOpenListPush (&session->bidiOpen[1], goalAdress, heuristic_cost_estimate(session->endX, session->endY, session->startX, session->startY, 0));
+}
+
+static int
+bidi_pathStep (CalcPath_session *session, unsigned int startAdress, unsigned int goalAdress)
+{
+	StepLimits limits;
+	int limitStatus;
+
+	if (!session->run) {
+		bidiStartRun (session, startAdress, goalAdress);
+	}
+
+	if (goalAdress == startAdress) {
+		session->solution_size = 0;
+		return 1;
+	}
+
+	// A previous run already found the path, this happens when the result of a background search is read again
+	if (session->bidiDone) {
+		reconstruct_path(session, goalAdress, startAdress);
+		return 1;
+	}
+
+	stepLimitsInit (session, &limits);
+
+	while (1) {
+		unsigned int forward = bidiLowest (session, 0);
+		unsigned int backward = bidiLowest (session, 1);
+		int side;
+		unsigned int currentAdress;
+
+		// An empty open list means the side reached all it could, there is no path if the sides never met
+		if (forward >= session->bidiBest || backward >= session->bidiBest) {
+			if (session->bidiBest == BIDI_NO_PATH) {
+				return -1;
+			}
+
+			// Link the backward half of the path to the forward one, so it is read from the goal like an A* solution
+			currentAdress = session->bidiMeet;
+			while (currentAdress != goalAdress) {
+				unsigned int next = session->bidiSuccessor[currentAdress];
+				session->predecessor[next] = currentAdress;
+				currentAdress = next;
+			}
+			session->bidiDone = 1;
+			reconstruct_path(session, goalAdress, startAdress);
+			return 1;
+		}
+
+		limitStatus = stepLimitsReached (session, &limits);
+		if (limitStatus < 0) {
+			return limitStatus;
+		}
+
+		side = (session->bidiOpen[0].size <= session->bidiOpen[1].size) ? 0 : 1;
+		currentAdress = session->bidiOpen[side].entries[0].nodeAdress;
+		lazyOpenListPop (&session->bidiOpen[side]);
+		if (side) {
+			SET_BIDI_STATE(session, currentAdress, CLOSED);
+		} else {
+			SET_NODE_STATE(session, currentAdress, CLOSED);
+		}
+		bidiExpand (session, side, currentAdress);
+	}
+	return -1;
+}
+
+// The actual A* pathfinding algorithm, loops until it finds a path, runs out of time or uses up the budget of this call (see CalcPath_session->node_budget).
+int 
+CalcPath_pathStep (CalcPath_session *session)
+{
+	if (!session->initialized) {
+		printf("[pathfinding run error] You must call 'reset' before 'run'.\n");
+		return -2;
+	}
+
+	unsigned int startAdress = (session->startY * session->width) + session->startX;
+	unsigned int goalAdress = (session->endY * session->width) + session->endX;
+
+	if (session->algorithm == CALCPATH_BIDIRECTIONAL) {
+		return bidi_pathStep(session, startAdress, goalAdress);
+	}
+
+	if (!session->run) {
+		startRun (session, startAdress, goalHeuristic(session, session->startX, session->startY));
+	}
+
+	// If the start node and goal node are the same return a valid path with length 0
+	if (goalAdress == startAdress) {
+		session->solution_size = 0;
+		return 1;
+	}
+
+	if (session->algorithm == CALCPATH_JPS) {
+		return jps_pathStep(session, startAdress, goalAdress);
+	}
+
+	unsigned int currentAdress;
+
+	// A previous run already found the goal, this happens when the result of a background search is read again
+	if (NODE_STATE(session, goalAdress) != NONE) {
+		reconstruct_path(session, goalAdress, startAdress);
+		return 1;
+	}
+
+	StepLimits limits;
+	int limitStatus;
+	stepLimitsInit (session, &limits);
+
+	while (1) {
+		// If the openList is empty no path exists, unless the window can still grow
+		if (session->openListSize == 0 && !windowGrow (session, 1)) {
 			return -1;
 		}
 
+		limitStatus = stepLimitsReached (session, &limits);
+		if (limitStatus < 0) {
+			return limitStatus;
+		}
+
+		// Set currentAdress to the top node in openList, and remove it from openList.
+		currentAdress = openListGetLowest (session);
+
+		// If the goal has been reached we have found the destination, reconstruct and return the path.
+		if (NODE_STATE(session, goalAdress) != NONE) {
+			//return path
+			reconstruct_path(session, goalAdress, startAdress);
+			return 1;
+		}
+
+		expandNode (session, currentAdress, 1);
+	}
+	return -1;
+}
+
+static int
+compareAdress (const void *a, const void *b)
+{
+	unsigned int first = *(const unsigned int *) a;
+	unsigned int second = *(const unsigned int *) b;
+	return (first > second) - (first < second);
+}
+
+// Dijkstra search from the session start which runs until every node in 'goals' has been reached, so a single search answers many destinations.
+// 'goals' must be sorted in ascending order without repeats. Read the result of each goal with CalcPath_stepsTo afterwards.
+// The open list is left in Dijkstra order, so the session must be reset before using CalcPath_pathStep again.
+int
+CalcPath_multiGoal (CalcPath_session *session, const unsigned int *goals, long goalCount)
+{
+	if (!session->initialized) {
+		printf("[pathfinding run error] You must call 'reset' before 'run'.\n");
+		return -2;
+	}
+
+	unsigned int startAdress = (session->startY * session->width) + session->startX;
+	unsigned int currentAdress;
+	long remaining = 0;
+	long i;
+
+	if (!session->run) {
+		// The window starts around all the goals
+		if (session->windowMargin) {
+			for (i = 0; i < goalCount; i++) {
+				windowCover (session, goals[i] % session->width, goals[i] / session->width);
+			}
+			windowSet (session, session->window);
+		}
+		startRun (session, startAdress, 0);
+	}
+
+	// Goals may have been reached by a previous call that ran out of time
+	for (i = 0; i < goalCount; i++) {
+		if (NODE_STATE(session, goals[i]) != CLOSED) {
+			remaining++;
+		}
+	}
+
+	unsigned long timeout = (unsigned long) GetTickCount();
+	int loop = 0;
+
+	while (remaining > 0) {
+		// If the openList is empty the remaining goals can't be reached, unless the window can still grow
+		if (session->openListSize == 0 && !windowGrow (session, 0)) {
+			return 1;
+		}
+
 		// Every 100th loop check if we have ran out if time
 		loop++;
 		if (loop == 100) {
@@ -136,95 +1212,90 @@ CalcPath_pathStep (CalcPath_session *session)
 				loop = 0;
 		}
 
-		// Set currentNode to the top node in openList, and remove it from openList.
-		currentNode = openListGetLowest (session);
-
-		// If currentNode is the goal we have reached the destination, reconstruct and return the path.
-		if (goal->predecessor) {
-			//return path
-			reconstruct_path(session, goal, start);
-			return 1;
+		// Nodes leave openList in order of their g score, so a goal has its shortest path once it is taken out
+		currentAdress = openListGetLowest (session);
+		if (bsearch(&currentAdress, goals, goalCount, sizeof(unsigned int), compareAdress)) {
+			remaining--;
 		}
 
-		// Loop between all neighbors
-		for (i = 0; i <= 7; i++)
-		{
-			neighbor_x = currentNode->x + i_x[i];
-			neighbor_y = currentNode->y + i_y[i];
-
-			if (neighbor_x > session->max_x || neighbor_y > session->max_y || neighbor_x < session->min_x || neighbor_y < session->min_y) {
-				continue;
-			}
+		expandNode (session, currentAdress, 0);
+	}
+	return 1;
+}
 
-			neighbor_adress = (neighbor_y * session->width) + neighbor_x;
+// Dijkstra search from the session start over its whole search area, then stores the cost (as used for g scores) of reaching each cell of a size x size grid starting at (originX, originY) in 'distances', row by row.
+// Cells which are out of the search area or can't be reached get 0xFFFF, costs too big to fit are stored as 0xFFFE.
+// Returns 1 on success or -3 if the search ran out of time.
+int
+CalcPath_distanceField (CalcPath_session *session, int originX, int originY, int size, unsigned short *distances)
+{
+	if (!session->initialized) {
+		printf("[pathfinding run error] You must call 'reset' before 'run'.\n");
+		return -2;
+	}
 
-			// Unwalkable nodes have weight -1, if a neighbor is unwalkable ignore it.
-			if (session->map_base_weight[neighbor_adress] == -1) {
-				continue;
-			}
+	unsigned int startAdress = (session->startY * session->width) + session->startX;
+	unsigned int adress;
+	int x;
+	int y;
 
-			neighborNode = &session->currentMap[neighbor_adress];
+	// The distances are wanted over the whole search area
+	if (!session->run) {
+		if (session->windowMargin) {
+			windowSet (session, session->width + session->height);
+		}
+		startRun (session, startAdress, 0);
+	}
 
-			// If a neighbor is in closedList ignore it, it has already been expanded and has its lowest possible g_score
-			if (neighborNode->whichlist == CLOSED) {
-				continue;
-			}
+	unsigned long timeout = (unsigned long) GetTickCount();
+	int loop = 0;
 
-			// First 4 neighbors in the list are in a ortogonal path and the last 4 are in a diagonal path from currentNode.
-			if (i >= 4) {
-				// If neighborNode has a diagonal path from currentNode then we can only move to it if both ortogonal composite nodes are walkable. (example: To move to the northeast both north and east must be walkable)
-			   if (session->map_base_weight[(currentNode->y * session->width) + neighbor_x] == -1 || session->map_base_weight[(neighbor_y * session->width) + currentNode->x] == -1) {
-					continue;
-				}
-				// We use 14 as the diagonal movement weight
-				distanceFromCurrent = 14;
-			} else {
-				// We use 10 for ortogonal movement weight
-				distanceFromCurrent = 10;
-			}
+	while (session->openListSize > 0) {
+		// Every 100th loop check if we have ran out if time
+		loop++;
+		if (loop == 100) {
+			if (GetTickCount() - timeout > session->time_max) {
+				printf("[pathfinding run error] Pathfinding ended before provided time.\n");
+				return -3;
+			} else
+				loop = 0;
+		}
 
-			// If avoidWalls is true we add weight to cells near walls to disencourage the algorithm to move to them.
-			if (session->avoidWalls) {
-				distanceFromCurrent += session->map_base_weight[neighbor_adress];
-			}
+		expandNode (session, openListGetLowest (session), 0);
+	}
 
-			if (session->customWeights) {
-				distanceFromCurrent += session->second_weight_map[neighbor_adress];
+	for (y = 0; y < size; y++) {
+		for (x = 0; x < size; x++) {
+			distances[(y * size) + x] = 0xFFFF;
+			if (originX + x < session->min_x || originX + x > session->max_x || originY + y < session->min_y || originY + y > session->max_y) {
+				continue;
 			}
 
-			if (session->randomFactor) {
-				c_randomFactor = rand() % session->randomFactor;
-				distanceFromCurrent += c_randomFactor;
+			adress = ((originY + y) * session->width) + originX + x;
+			if (NODE_STATE(session, adress) == CLOSED) {
+				distances[(y * size) + x] = (session->gScore[adress] < 0xFFFE) ? session->gScore[adress] : 0xFFFE;
 			}
+		}
+	}
+	return 1;
+}
 
-			// g_score is the summed weight of all nodes from start node to neighborNode, which is the g_score of currentNode + the weight to move from currentNode to neighborNode.
-			g_score = currentNode->g + distanceFromCurrent;
+// Returns the number of steps from the session start to 'adress', or -1 if the node has not been reached (closed) by the search
+long
+CalcPath_stepsTo (CalcPath_session *session, unsigned int adress)
+{
+	unsigned int startAdress = (session->startY * session->width) + session->startX;
+	long steps = 0;
 
-			// If neighborNode is not in openList neither in closedList it has not been reached yet, initialize it and add it to openList
-			if (neighborNode->whichlist == NONE) {
-				neighborNode->x = neighbor_x;
-				neighborNode->y = neighbor_y;
-				neighborNode->nodeAdress = neighbor_adress;
-				neighborNode->predecessor = currentNode->nodeAdress;
-				neighborNode->g = g_score;
-				neighborNode->h = heuristic_cost_estimate(neighborNode->x, neighborNode->y, session->endX, session->endY, session->useManhattan);
-				neighborNode->f = neighborNode->g + neighborNode->h;
-				openListAdd (session, neighborNode);
+	if (NODE_STATE(session, adress) != CLOSED) {
+		return -1;
+	}
 
-			// If neighborNode is in a list it has to be in openList, since we cannot access nodes in closedList. 
-			} else {
-				// Check if we have found a shorter path to neighborNode, if so update it to have currentNode as its predecessor.
-				if (g_score < neighborNode->g) {
-					neighborNode->predecessor = currentNode->nodeAdress;
-					neighborNode->g = g_score;
-					neighborNode->f = neighborNode->g + neighborNode->h;
-					// Here we could remove neighborNode from openList and add it again to get it to the right position, but reajusting it saves time.
-					reajustOpenListItem (session, neighborNode);
-				}
-			}
-		}
+	while (adress != startAdress) {
+		adress = session->predecessor[adress];
+		steps++;
 	}
-	return -1;
+	return steps;
 }
 
 // The heuristic used is diagonal distance, unless specified to use manhattan (to mimic client)
@@ -250,211 +1321,643 @@ heuristic_cost_estimate (int currentX, int currentY, int goalX, int goalY, bool
 
 // Starts from goal node and each loop changes to the current node predecessor until it reaches the start node, increasing solution size by 1 each loop.
 void
-reconstruct_path(CalcPath_session *session, Node* goal, Node* start)
+reconstruct_path(CalcPath_session *session, unsigned int goalAdress, unsigned int startAdress)
 {
-	Node* currentNode = goal;
+	unsigned int currentAdress = goalAdress;
 
 	session->solution_size = 0;
-	while (currentNode->nodeAdress != start->nodeAdress)
+	while (currentAdress != startAdress)
 	{
-		currentNode = &session->currentMap[currentNode->predecessor];
+		currentAdress = session->predecessor[currentAdress];
 		session->solution_size++;
 	}
 }
 
-// Openlist is a binary heap of min-heap type
-// Each member in openList is the adress (nodeAdress) of a node in the map (session->currentMap)
+// The bucket queue keeps one list of open nodes per f score, costs are small integers so adding and taking the lowest node are O(1) amortized
+// The heuristic can be inconsistent (manhattan), so a node may be added below the lowest bucket, in that case the lowest bucket moves back down
 
-// Add node 'currentNode' to openList
-void 
-openListAdd (CalcPath_session *session, Node* currentNode)
-{
-	// Index will be 1 + last index in openList, which is also its size
-	// Save in currentNode its index in openList
-	currentNode->openListIndex = session->openListSize;
-	currentNode->whichlist = OPEN;
-
-	// Defines openList[index] to currentNode adress
-	session->openList[currentNode->openListIndex] = currentNode->nodeAdress;
-
-	// Increses openListSize by 1, since we just added a new member
-	session->openListSize++;
+#define NO_NODE 0xFFFFFFFF
 
-	long parentIndex = (long)floor((currentNode->openListIndex - 1) / 2);
-	Node* parentNode;
+// Prepares the bucket queue for a new run
+static void
+bucketListInit (CalcPath_session *session, unsigned long size)
+{
+	if (size > session->bucketLinksCapacity) {
+		free(session->bucketLinks);
+		session->bucketLinks = (BucketLink*) malloc(size * sizeof(BucketLink));
+		session->bucketLinksCapacity = size;
+	}
 
-	// Repeat while currentNode still has a parent node, otherwise currentNode is the top node in the heap
-	while (parentIndex >= 0) {
+	// Only the buckets touched by the previous run can still hold nodes
+	if (session->bucketsUsed > 0) {
+		memset(session->buckets, 0xFF, session->bucketsUsed * sizeof(unsigned int));
+	}
+	session->bucketsUsed = 0;
+	session->bucketLowest = (unsigned long) -1;
+}
 
-		parentNode = &session->currentMap[session->openList[parentIndex]];
+// Puts node 'nodeAdress' in the front of the bucket of score 'f', growing the bucket array if needed
+static void
+bucketListPush (CalcPath_session *session, unsigned int nodeAdress, unsigned int f)
+{
+	if (f >= session->bucketCount) {
+		unsigned long count = (session->bucketCount < 1024) ? 1024 : session->bucketCount;
+		while (count <= f) {
+			count *= 2;
+		}
+		session->buckets = (unsigned int*) realloc(session->buckets, count * sizeof(unsigned int));
+		memset(session->buckets + session->bucketCount, 0xFF, (count - session->bucketCount) * sizeof(unsigned int));
+		session->bucketCount = count;
+	}
+	if (f >= session->bucketsUsed) {
+		session->bucketsUsed = (unsigned long) f + 1;
+	}
+	if (f < session->bucketLowest) {
+		session->bucketLowest = f;
+	}
 
-		// If parent node is bigger than currentNode, exchange their positions
-		if (parentNode->f > currentNode->f) {
-			// Changes the node adress of openList[currentNode->openListIndex] (which is 'currentNode') to that of openList[parentIndex] (which is the current parent of 'currentNode')
-			session->openList[currentNode->openListIndex] = session->openList[parentIndex];
+	BucketLink *link = &session->bucketLinks[nodeAdress];
+	link->f = f;
+	link->prev = NO_NODE;
+	link->next = session->buckets[f];
+	if (link->next != NO_NODE) {
+		session->bucketLinks[link->next].prev = nodeAdress;
+	}
+	session->buckets[f] = nodeAdress;
+}
 
-			// Changes openListIndex of the current parent of 'currentNode' to that of 'currentNode' since they exchanged positions
-			parentNode->openListIndex = currentNode->openListIndex;
+// Removes node 'nodeAdress' from its bucket
+static void
+bucketListUnlink (CalcPath_session *session, unsigned int nodeAdress)
+{
+	BucketLink *link = &session->bucketLinks[nodeAdress];
+	if (link->prev != NO_NODE) {
+		session->bucketLinks[link->prev].next = link->next;
+	} else {
+		session->buckets[link->f] = link->next;
+	}
+	if (link->next != NO_NODE) {
+		session->bucketLinks[link->next].prev = link->prev;
+	}
+}
 
-			// Changes the node adress of openList[parentIndex] (which is the current parent of 'currentNode') to that of openList[currentNode->openListIndex] (which is 'currentNode')
-			session->openList[parentIndex] = currentNode->nodeAdress;
+// Openlist is a binary heap of min-heap type, unless the session uses the bucket queue
+// Each member in openList holds the f score and the adress of a node in the map, session->openListIndex stores the position of each open node in the heap
 
-			// Changes openListIndex of 'currentNode' to that of the current parent of 'currentNode' since they exchanged positions
-			currentNode->openListIndex = parentIndex;
+// Moves the entry at 'index' up the heap until its parent is not bigger than it
+static void
+openListSiftUp (CalcPath_session *session, long index)
+{
+	OpenListEntry entry = session->openList[index];
+	long parentIndex;
 
-			// Updates parentIndex to that of the current parent of 'currentNode'
-			parentIndex = (long)floor((currentNode->openListIndex - 1) / 2);
+	// Repeat while the entry still has a parent node, otherwise it is the top node in the heap
+	while (index > 0) {
+		parentIndex = (index - 1) >> 1;
 
-		} else {
+		// If parent node is not bigger than the entry we found its position
+		if (session->openList[parentIndex].f <= entry.f) {
 			break;
 		}
+
+		// Move the parent down to the current position and store its new index
+		session->openList[index] = session->openList[parentIndex];
+		session->openListIndex[session->openList[index].nodeAdress] = index;
+		index = parentIndex;
 	}
+
+	session->openList[index] = entry;
+	session->openListIndex[entry.nodeAdress] = index;
 }
 
+// Add node 'nodeAdress' with score 'f' to openList
 void 
-reajustOpenListItem (CalcPath_session *session, Node* currentNode)
+openListAdd (CalcPath_session *session, unsigned int nodeAdress, unsigned int f)
 {
-	long parentIndex = (long)floor((currentNode->openListIndex - 1) / 2);
-	Node* parentNode;
-
-	// Repeat while currentNode still has a parent node, otherwise currentNode is the top node in the heap
-	while (parentIndex >= 0) {
-
-		parentNode = &session->currentMap[session->openList[parentIndex]];
-
-		// If parent node is bigger than currentNode, exchange their positions
-		if (parentNode->f > currentNode->f) {
-			// Changes the node adress of openList[currentNode->openListIndex] (which is 'currentNode') to that of openList[parentIndex] (which is the current parent of 'currentNode')
-			session->openList[currentNode->openListIndex] = session->openList[parentIndex];
-
-			// Changes openListIndex of the current parent of 'currentNode' to that of 'currentNode' since they exchanged positions
-			parentNode->openListIndex = currentNode->openListIndex;
+	// Index will be 1 + last index in openList, which is also its size
+	long index = session->openListSize;
+	session->openListSize++;
 
-			// Changes the node adress of openList[parentIndex] (which is the current parent of 'currentNode') to that of openList[currentNode->openListIndex] (which is 'currentNode')
-			session->openList[parentIndex] = currentNode->nodeAdress;
+	SET_NODE_STATE(session, nodeAdress, OPEN);
 
-			// Changes openListIndex of 'currentNode' to that of the current parent of 'currentNode' since they exchanged positions
-			currentNode->openListIndex = parentIndex;
+	if (session->openListType == OPENLIST_BUCKET) {
+		bucketListPush (session, nodeAdress, f);
+		return;
+	}
 
-			// Updates parentIndex to that of the current parent of 'currentNode'
-			parentIndex = (long)floor((currentNode->openListIndex - 1) / 2);
+	session->openList[index].f = f;
+	session->openList[index].nodeAdress = nodeAdress;
+	openListSiftUp (session, index);
+}
 
-		} else {
-			break;
-		}
+// Lowers the f score of a node already in openList, moving it up to its new position
+void 
+reajustOpenListItem (CalcPath_session *session, unsigned int nodeAdress, unsigned int f)
+{
+	if (session->openListType == OPENLIST_BUCKET) {
+		bucketListUnlink (session, nodeAdress);
+		bucketListPush (session, nodeAdress, f);
+		return;
 	}
+
+	long index = session->openListIndex[nodeAdress];
+	session->openList[index].f = f;
+	openListSiftUp (session, index);
 }
 
-Node* 
+// Removes the top node from openList and returns its adress
+unsigned int 
 openListGetLowest (CalcPath_session *session)
 {
+	if (session->openListType == OPENLIST_BUCKET) {
+		while (session->buckets[session->bucketLowest] == NO_NODE) {
+			session->bucketLowest++;
+		}
+		unsigned int bucketAdress = session->buckets[session->bucketLowest];
+		bucketListUnlink (session, bucketAdress);
+		SET_NODE_STATE(session, bucketAdress, CLOSED);
+		session->openListSize--;
+		return bucketAdress;
+	}
+
+	unsigned int lowestAdress = session->openList[0].nodeAdress;
+
+	// Saves that the lowest node is no longer in openList
+	SET_NODE_STATE(session, lowestAdress, CLOSED);
+
 	session->openListSize--;
 
-	Node* lowestNode = &session->currentMap[session->openList[0]];
+	// Since it was decreased, session->openListSize is now also the index of the last node in openList
+	// We move the last node in openList to the top and adjust it down as necessary
+	OpenListEntry movedEntry = session->openList[session->openListSize];
+	long lastIndex = session->openListSize - 1;
+	long index = 0;
+	long smallerChildIndex;
 
-	// Since it was decreaased, but the node was not removed yet, session->openListSize is now also the index of the last node in openList
-	// We move the last node in openList to this position and adjust it down as necessary
-	session->openList[lowestNode->openListIndex] = session->openList[session->openListSize];
+	while ((2 * index + 1) <= lastIndex) {
+		smallerChildIndex = 2 * index + 1;
 
-	Node* movedNode;
+		// If there are 2 children pick the smaller one, the right one on ties
+		if (smallerChildIndex + 1 <= lastIndex && session->openList[smallerChildIndex + 1].f <= session->openList[smallerChildIndex].f) {
+			smallerChildIndex++;
+		}
 
-	// Saves in movedNode that it now is the top node in openList
-	movedNode = &session->currentMap[session->openList[lowestNode->openListIndex]];
-	movedNode->openListIndex = lowestNode->openListIndex;
+		if (movedEntry.f <= session->openList[smallerChildIndex].f) {
+			break;
+		}
 
-	// Saves in lowestNode that it is no longer in openList
-	lowestNode->whichlist = CLOSED;
-	lowestNode->openListIndex = 0;
+		// Move the child up to the current position and store its new index
+		session->openList[index] = session->openList[smallerChildIndex];
+		session->openListIndex[session->openList[index].nodeAdress] = index;
+		index = smallerChildIndex;
+	}
 
-	long smallerChildIndex;
-	Node* smallerChildNode;
+	if (session->openListSize > 0) {
+		session->openList[index] = movedEntry;
+		session->openListIndex[movedEntry.nodeAdress] = index;
+	}
 
-	long rightChildIndex = 2 * movedNode->openListIndex + 2;
-	Node* rightChildNode;
+	return lowestAdress;
+}
 
-	long leftChildIndex = 2 * movedNode->openListIndex + 1;
-	Node* leftChildNode;
+// Frees the memory allocated by the node arrays
+void
+free_currentMap (CalcPath_session *session)
+{
+	free(session->nodeState);
+	free(session->gScore);
+	free(session->predecessor);
+	free(session->openListIndex);
+	free(session->bidiState);
+	free(session->bidiGScore);
+	free(session->bidiSuccessor);
+	free(session->customWeightTable);
+	free(session->windowBorder);
+	session->windowBorder = NULL;
+	session->windowBorderSize = 0;
+	session->windowBorderCapacity = 0;
+	session->bidiState = NULL;
+	session->bidiGScore = NULL;
+	session->bidiSuccessor = NULL;
+	session->bidiCapacity = 0;
+	session->neighbor_mask = NULL;
+	session->nodeState = NULL;
+	session->gScore = NULL;
+	session->predecessor = NULL;
+	session->openListIndex = NULL;
+	session->customWeightTable = NULL;
+	session->nodeCapacity = 0;
+	session->customWeightCapacity = 0;
+}
 
-	long lastIndex = session->openListSize-1;
+// Frees the memory allocated by openList and the bucket queue
+void
+free_openList (CalcPath_session *session)
+{
+	free(session->openList);
+	free(session->buckets);
+	free(session->bucketLinks);
+	free(session->bidiOpen[0].entries);
+	free(session->bidiOpen[1].entries);
+	memset(session->bidiOpen, 0, sizeof(session->bidiOpen));
+	session->openList = NULL;
+	session->buckets = NULL;
+	session->bucketLinks = NULL;
+	session->openListCapacity = 0;
+	session->bucketCount = 0;
+	session->bucketLinksCapacity = 0;
+	session->bucketsUsed = 0;
+}
+
+// Garantees that all memory allocations have been freed the pathfinding object is destroyed
+void
+CalcPath_destroy (CalcPath_session *session)
+{
+	free_currentMap(session);
+	free_openList(session);
+	free(session);
+}
 
-	while (leftChildIndex <= lastIndex) {
+// Unwalkable cells have weight -1 in the weight map, cells outside of the map are never walkable
+#define WEIGHT_WALKABLE(weight_map, width, height, x, y) ((x) >= 0 && (x) < (width) && (y) >= 0 && (y) < (height) && (weight_map)[((y) * (width)) + (x)] != -1)
 
-		//There are 2 children
-		if (rightChildIndex <= lastIndex) {
+// Returns the walkable neighbors bitmask of cell (x, y), bit i is set when direction (i_x[i], i_y[i]) of CalcPath_pathStep can be walked to.
+// A diagonal neighbor is only walkable if both ortogonal composite nodes are walkable. (example: To move to the northeast both north and east must be walkable)
+unsigned char
+CalcPath_neighborMaskAt (const char *weight_map, int width, int height, int x, int y)
+{
+	int north = WEIGHT_WALKABLE(weight_map, width, height, x, y + 1);
+	int south = WEIGHT_WALKABLE(weight_map, width, height, x, y - 1);
+	int east = WEIGHT_WALKABLE(weight_map, width, height, x + 1, y);
+	int west = WEIGHT_WALKABLE(weight_map, width, height, x - 1, y);
+
+	unsigned char mask = 0;
+	if (north) mask |= 1 << 0;
+	if (south) mask |= 1 << 1;
+	if (east) mask |= 1 << 2;
+	if (west) mask |= 1 << 3;
+	if (east && north && WEIGHT_WALKABLE(weight_map, width, height, x + 1, y + 1)) mask |= 1 << 4;
+	if (east && south && WEIGHT_WALKABLE(weight_map, width, height, x + 1, y - 1)) mask |= 1 << 5;
+	if (west && south && WEIGHT_WALKABLE(weight_map, width, height, x - 1, y - 1)) mask |= 1 << 6;
+	if (west && north && WEIGHT_WALKABLE(weight_map, width, height, x - 1, y + 1)) mask |= 1 << 7;
+	return mask;
+}
 
-			rightChildNode = &session->currentMap[session->openList[rightChildIndex]];
-			leftChildNode = &session->currentMap[session->openList[leftChildIndex]];
+static inline unsigned int
+componentRoot (unsigned int *parent, unsigned int label)
+{
+	while (parent[label] != label) {
+		parent[label] = parent[parent[label]];
+		label = parent[label];
+	}
+	return label;
+}
 
-			if (rightChildNode->f > leftChildNode->f) {
-				smallerChildIndex = leftChildIndex;
+// Labels the connected walkable areas of a weight map with two passes of union-find. Diagonal moves need both ortogonal
+// neighbors to be walkable, so the cells a search can walk between are exactly the 4-connected ones.
+// Fills 'labels' (width * height little endian unsigned shorts) with the area of each cell numbered from 1, 0 for walls
+// and COMPONENT_UNKNOWN for the areas after the 65534th one. Returns the number of areas.
+long
+CalcPath_buildComponents (const char *weight_map, int width, int height, unsigned char *labels)
+{
+	unsigned long size = (unsigned long) width * height;
+	unsigned int *provisional = (unsigned int *) malloc(size * sizeof(unsigned int));
+	unsigned int *parent = (unsigned int *) malloc((size + 1) * sizeof(unsigned int));
+	unsigned int *numbers;
+	unsigned int next = 1;
+	unsigned long adress;
+	long count = 0;
+	int x;
+	int y;
+
+	// First pass, each walkable cell joins the area of its west and south neighbors
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			adress = ((unsigned long) y * width) + x;
+			if (weight_map[adress] == -1) {
+				provisional[adress] = 0;
+				continue;
+			}
+			unsigned int west = (x > 0) ? provisional[adress - 1] : 0;
+			unsigned int south = (y > 0) ? provisional[adress - width] : 0;
+			if (west && south) {
+				unsigned int a = componentRoot (parent, west);
+				unsigned int b = componentRoot (parent, south);
+				if (a < b) {
+					parent[b] = a;
+				} else {
+					parent[a] = b;
+				}
+				provisional[adress] = (a < b) ? a : b;
+			} else if (west || south) {
+				provisional[adress] = west ? west : south;
 			} else {
-				smallerChildIndex = rightChildIndex;
+				parent[next] = next;
+				provisional[adress] = next++;
 			}
+		}
+	}
 
-		//There is 1 children
-		} else {
-			smallerChildIndex = leftChildIndex;
+	// Second pass, the areas are numbered in the order their first cell appears
+	numbers = (unsigned int *) calloc(next, sizeof(unsigned int));
+	for (adress = 0; adress < size; adress++) {
+		unsigned int label = 0;
+		if (provisional[adress]) {
+			unsigned int root = componentRoot (parent, provisional[adress]);
+			if (!numbers[root]) {
+				numbers[root] = ++count;
+			}
+			label = (numbers[root] < COMPONENT_UNKNOWN) ? numbers[root] : COMPONENT_UNKNOWN;
 		}
+		labels[adress * 2] = label & 0xFF;
+		labels[adress * 2 + 1] = label >> 8;
+	}
 
-		smallerChildNode = &session->currentMap[session->openList[smallerChildIndex]];
+	free(numbers);
+	free(parent);
+	free(provisional);
+	return count;
+}
 
-		if (movedNode->f > smallerChildNode->f) {
+// Neighbor masks of the cells of an interior row, those whose 3x3 neighborhoods are all inside the map, many
+// at a time: fills 'mask' from 'x' (at least 1) on in blocks and returns the x of the first cell left.
+// 'row' is the row's weights, the rows around it are 'width' bytes before and after it. The wider kernels
+// leave the end of the row to the narrower ones.
+typedef int (*NeighborMaskRowKernel) (const char *row, int width, int x, unsigned char *mask);
 
-			// Changes the node adress of openList[movedNode->openListIndex] (which is 'movedNode') to that of openList[smallerChildIndex] (which is the current child of 'movedNode')
-			session->openList[movedNode->openListIndex] = smallerChildNode->nodeAdress;
+static int
+neighborMaskRow_scalar (const char *row, int width, int x, unsigned char *mask)
+{
+	return x;
+}
 
-			// Changes openListIndex of the current child of 'movedNode' to that of 'movedNode' since they exchanged positions
-			smallerChildNode->openListIndex = movedNode->openListIndex;
+#ifdef SIMD_X86
+// Each of the loads is 0xFF for walkable cells and 0x00 for unwalkable ones
+SIMD_TARGET_SSE2 static int
+neighborMaskRow_sse2 (const char *row, int width, int x, unsigned char *mask)
+{
+	const __m128i unwalkable = _mm_set1_epi8(-1);
+	const char *above = row + width;
+	const char *below = row - width;
+
+	for (; x + 16 < width; x += 16) {
+		__m128i north = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (above + x)), unwalkable), unwalkable);
+		__m128i south = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (below + x)), unwalkable), unwalkable);
+		__m128i east = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (row + x + 1)), unwalkable), unwalkable);
+		__m128i west = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (row + x - 1)), unwalkable), unwalkable);
+		__m128i northeast = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (above + x + 1)), unwalkable), unwalkable);
+		__m128i southeast = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (below + x + 1)), unwalkable), unwalkable);
+		__m128i southwest = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (below + x - 1)), unwalkable), unwalkable);
+		__m128i northwest = _mm_andnot_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (above + x - 1)), unwalkable), unwalkable);
+
+		northeast = _mm_and_si128(northeast, _mm_and_si128(north, east));
+		southeast = _mm_and_si128(southeast, _mm_and_si128(south, east));
+		southwest = _mm_and_si128(southwest, _mm_and_si128(south, west));
+		northwest = _mm_and_si128(northwest, _mm_and_si128(north, west));
+
+		__m128i result = _mm_and_si128(north, _mm_set1_epi8(1 << 0));
+		result = _mm_or_si128(result, _mm_and_si128(south, _mm_set1_epi8(1 << 1)));
+		result = _mm_or_si128(result, _mm_and_si128(east, _mm_set1_epi8(1 << 2)));
+		result = _mm_or_si128(result, _mm_and_si128(west, _mm_set1_epi8(1 << 3)));
+		result = _mm_or_si128(result, _mm_and_si128(northeast, _mm_set1_epi8(1 << 4)));
+		result = _mm_or_si128(result, _mm_and_si128(southeast, _mm_set1_epi8(1 << 5)));
+		result = _mm_or_si128(result, _mm_and_si128(southwest, _mm_set1_epi8(1 << 6)));
+		result = _mm_or_si128(result, _mm_and_si128(northwest, _mm_set1_epi8((char) (1 << 7))));
+
+		_mm_storeu_si128((__m128i *) (mask + x), result);
+	}
+	return x;
+}
 
-			// Changes the node adress of openList[smallerChildIndex] (which is the current child of 'movedNode') to that of openList[movedNode->openListIndex] (which is 'movedNode')
-			session->openList[smallerChildIndex] = movedNode->nodeAdress;
+SIMD_TARGET_AVX2 static int
+neighborMaskRow_avx2 (const char *row, int width, int x, unsigned char *mask)
+{
+	const __m256i unwalkable = _mm256_set1_epi8(-1);
+	const char *above = row + width;
+	const char *below = row - width;
+
+	for (; x + 32 < width; x += 32) {
+		__m256i north = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (above + x)), unwalkable), unwalkable);
+		__m256i south = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (below + x)), unwalkable), unwalkable);
+		__m256i east = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (row + x + 1)), unwalkable), unwalkable);
+		__m256i west = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (row + x - 1)), unwalkable), unwalkable);
+		__m256i northeast = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (above + x + 1)), unwalkable), unwalkable);
+		__m256i southeast = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (below + x + 1)), unwalkable), unwalkable);
+		__m256i southwest = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (below + x - 1)), unwalkable), unwalkable);
+		__m256i northwest = _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (above + x - 1)), unwalkable), unwalkable);
+
+		northeast = _mm256_and_si256(northeast, _mm256_and_si256(north, east));
+		southeast = _mm256_and_si256(southeast, _mm256_and_si256(south, east));
+		southwest = _mm256_and_si256(southwest, _mm256_and_si256(south, west));
+		northwest = _mm256_and_si256(northwest, _mm256_and_si256(north, west));
+
+		__m256i result = _mm256_and_si256(north, _mm256_set1_epi8(1 << 0));
+		result = _mm256_or_si256(result, _mm256_and_si256(south, _mm256_set1_epi8(1 << 1)));
+		result = _mm256_or_si256(result, _mm256_and_si256(east, _mm256_set1_epi8(1 << 2)));
+		result = _mm256_or_si256(result, _mm256_and_si256(west, _mm256_set1_epi8(1 << 3)));
+		result = _mm256_or_si256(result, _mm256_and_si256(northeast, _mm256_set1_epi8(1 << 4)));
+		result = _mm256_or_si256(result, _mm256_and_si256(southeast, _mm256_set1_epi8(1 << 5)));
+		result = _mm256_or_si256(result, _mm256_and_si256(southwest, _mm256_set1_epi8(1 << 6)));
+		result = _mm256_or_si256(result, _mm256_and_si256(northwest, _mm256_set1_epi8((char) (1 << 7))));
+
+		_mm256_storeu_si256((__m256i *) (mask + x), result);
+	}
+	return neighborMaskRow_sse2(row, width, x, mask);
+}
 
-			// Changes openListIndex of 'movedNode' to that of the current child of 'movedNode' since they exchanged positions
-			movedNode->openListIndex = smallerChildIndex;
+// The comparisons give a bit per cell, set for walkable ones
+SIMD_TARGET_AVX512 static int
+neighborMaskRow_avx512 (const char *row, int width, int x, unsigned char *mask)
+{
+	const __m512i unwalkable = _mm512_set1_epi8(-1);
+	const char *above = row + width;
+	const char *below = row - width;
+
+	for (; x + 64 < width; x += 64) {
+		__mmask64 north = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *) (above + x)), unwalkable);
+		__mmask64 south = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *) (below + x)), unwalkable);
+		__mmask64 east = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *) (row + x + 1)), unwalkable);
+		__mmask64 west = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *) (row + x - 1)), unwalkable);
+		__mmask64 northeast = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *) (above + x + 1)), unwalkable);
+		__mmask64 southeast = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *) (below + x + 1)), unwalkable);
+		__mmask64 southwest = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *) (below + x - 1)), unwalkable);
+		__mmask64 northwest = _mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *) (above + x - 1)), unwalkable);
+
+		northeast &= north & east;
+		southeast &= south & east;
+		southwest &= south & west;
+		northwest &= north & west;
+
+		__m512i result = _mm512_maskz_set1_epi8(north, 1 << 0);
+		result = _mm512_or_si512(result, _mm512_maskz_set1_epi8(south, 1 << 1));
+		result = _mm512_or_si512(result, _mm512_maskz_set1_epi8(east, 1 << 2));
+		result = _mm512_or_si512(result, _mm512_maskz_set1_epi8(west, 1 << 3));
+		result = _mm512_or_si512(result, _mm512_maskz_set1_epi8(northeast, 1 << 4));
+		result = _mm512_or_si512(result, _mm512_maskz_set1_epi8(southeast, 1 << 5));
+		result = _mm512_or_si512(result, _mm512_maskz_set1_epi8(southwest, 1 << 6));
+		result = _mm512_or_si512(result, _mm512_maskz_set1_epi8(northwest, (char) (1 << 7)));
+
+		_mm512_storeu_si512((void *) (mask + x), result);
+	}
+	return neighborMaskRow_avx2(row, width, x, mask);
+}
+#endif
 
-			// Updates rightChildIndex and leftChildIndex to those of the current children of 'movedNode'
-			rightChildIndex = 2 * movedNode->openListIndex + 2;
-			leftChildIndex = 2 * movedNode->openListIndex + 1;
+static NeighborMaskRowKernel
+selectNeighborMaskRow ()
+{
+#ifdef SIMD_X86
+	switch (CPU_simdLevel()) {
+	case SIMD_AVX512: return neighborMaskRow_avx512;
+	case SIMD_AVX2: return neighborMaskRow_avx2;
+	case SIMD_SSE2: return neighborMaskRow_sse2;
+	}
+#endif
+	return neighborMaskRow_scalar;
+}
 
-		} else {
-			break;
+static const NeighborMaskRowKernel neighborMaskRow = selectNeighborMaskRow();
+
+// Fills 'mask' (width * height bytes) with the neighbors bitmask of every cell of the weight map.
+// This only depends on the walkability of the map, so it should be computed once per field and passed to every session.
+void
+CalcPath_buildNeighborMask (const char *weight_map, int width, int height, unsigned char *mask)
+{
+	int x;
+	int y;
+
+	for (y = 0; y < height; y++) {
+		x = 0;
+		if (y > 0 && y < height - 1) {
+			// The kernels start after the first cell
+			mask[y * width] = CalcPath_neighborMaskAt(weight_map, width, height, 0, y);
+			x = neighborMaskRow(weight_map + (y * width), width, 1, mask + (y * width));
+		}
+		for (; x < width; x++) {
+			mask[(y * width) + x] = CalcPath_neighborMaskAt(weight_map, width, height, x, y);
 		}
 	}
-
-	return lowestNode;
 }
 
-// Frees the memory allocated by currentMap
+// Recomputes in place the neighbors bitmask of the cells next to the 'cell_count' cells of 'cells' (their x and y) whose
+// walkability changed in the weight map, the others' can't change.
 void
-free_currentMap (CalcPath_session *session)
+CalcPath_repairNeighborMask (const char *weight_map, int width, int height, const int *cells, int cell_count, unsigned char *mask)
 {
-	free(session->currentMap);
-	if (session->customWeights) {
-		free(session->second_weight_map);
+	int c;
+	int x;
+	int y;
+
+	for (c = 0; c < cell_count; c++) {
+		for (y = cells[c * 2 + 1] - 1; y <= cells[c * 2 + 1] + 1; y++) {
+			for (x = cells[c * 2] - 1; x <= cells[c * 2] + 1; x++) {
+				if (x >= 0 && x < width && y >= 0 && y < height) {
+					mask[(y * width) + x] = CalcPath_neighborMaskAt(weight_map, width, height, x, y);
+				}
+			}
+		}
 	}
 }
 
-// Frees the memory allocated by openList
-void
-free_openList (CalcPath_session *session)
+static inline unsigned int
+componentLabel (const unsigned char *labels, unsigned long adress)
 {
-	free(session->openList);
+	return labels[adress * 2] | (labels[adress * 2 + 1] << 8);
 }
 
-// Garantees that all memory allocations have been freed the pathfinding object is destroyed
-void
-CalcPath_destroy (CalcPath_session *session)
+// Repairs in place the labels made by CalcPath_buildComponents after the walkability of the 'cell_count' cells of 'cells'
+// (their x and y) changed in the weight map. The areas a changed cell or its neighbors are in now are flooded again, the
+// others keep their labels: areas a new wall cut in parts get a new number for each part but the first, areas a
+// walkable cell joined get one of their numbers. So the labels tell the same areas apart as rebuilt ones, though not
+// always by the same numbers. Returns the highest number in use, or -1 if there is not enough memory.
+long
+CalcPath_repairComponents (const char *weight_map, int width, int height, const int *cells, int cell_count, unsigned char *labels)
 {
-	if (session->initialized) {
-		free(session->currentMap);
-		if (session->customWeights) {
-			free(session->second_weight_map);
+	unsigned long size = (unsigned long) width * height;
+	unsigned char *visited = (unsigned char *) calloc(size, 1);
+	unsigned long *queue = (unsigned long *) malloc(size * sizeof(unsigned long));
+	unsigned char *claimed = (unsigned char *) calloc(COMPONENT_UNKNOWN + 1, 1);
+	unsigned long adress, head, tail, start;
+	unsigned int highest = 0;
+	int c, n;
+
+	if (!visited || !queue || !claimed) {
+		free(visited);
+		free(queue);
+		free(claimed);
+		return -1;
+	}
+	for (adress = 0; adress < size; adress++) {
+		unsigned int label = componentLabel (labels, adress);
+		if (label > highest && label != COMPONENT_UNKNOWN) {
+			highest = label;
 		}
 	}
-	if (session->run) {
-		free(session->openList);
+
+	tail = 0;
+	for (c = 0; c < cell_count; c++) {
+		for (n = 0; n < 5; n++) {
+			int x = cells[c * 2] + ((n == 1) ? -1 : (n == 2) ? 1 : 0);
+			int y = cells[c * 2 + 1] + ((n == 3) ? -1 : (n == 4) ? 1 : 0);
+			unsigned int label = COMPONENT_UNKNOWN;
+			if (x < 0 || x >= width || y < 0 || y >= height) {
+				continue;
+			}
+			adress = ((unsigned long) y * width) + x;
+			if (weight_map[adress] == -1) {
+				labels[adress * 2] = labels[adress * 2 + 1] = 0;
+				continue;
+			}
+			if (visited[adress]) {
+				continue;
+			}
+
+			// Flood the area, it takes the lowest number it had which no other flooded area took
+			start = tail;
+			visited[adress] = 1;
+			queue[tail++] = adress;
+			for (head = start; head < tail; head++) {
+				unsigned long cell = queue[head];
+				unsigned int old = componentLabel (labels, cell);
+				int cx = (int) (cell % width);
+				int cy = (int) (cell / width);
+				if (old && old < label && !claimed[old]) {
+					label = old;
+				}
+				if (cx > 0 && !visited[cell - 1] && weight_map[cell - 1] != -1) {
+					visited[cell - 1] = 1;
+					queue[tail++] = cell - 1;
+				}
+				if (cx < width - 1 && !visited[cell + 1] && weight_map[cell + 1] != -1) {
+					visited[cell + 1] = 1;
+					queue[tail++] = cell + 1;
+				}
+				if (cy > 0 && !visited[cell - width] && weight_map[cell - width] != -1) {
+					visited[cell - width] = 1;
+					queue[tail++] = cell - width;
+				}
+				if (cy < height - 1 && !visited[cell + width] && weight_map[cell + width] != -1) {
+					visited[cell + width] = 1;
+					queue[tail++] = cell + width;
+				}
+			}
+			if (label == COMPONENT_UNKNOWN && highest < COMPONENT_UNKNOWN - 1) {
+				label = ++highest;
+			}
+			if (label != COMPONENT_UNKNOWN) {
+				claimed[label] = 1;
+			}
+			for (head = start; head < tail; head++) {
+				labels[queue[head] * 2] = label & 0xFF;
+				labels[queue[head] * 2 + 1] = label >> 8;
+			}
+		}
 	}
-	free(session);
+
+	free(claimed);
+	free(queue);
+	free(visited);
+	return highest;
 }
 
 int
@@ -549,7 +2052,7 @@ checkLOS_inner(int start_x, int start_y, int end_x, int end_y, int tile, int wid
 }
 
 int
-canAttack_inner(int start_x, int start_y, int end_x, int end_y, int tile, int width, int height, int range, int clientSight, char * rawMap_data) {
+canAttack_inner(int start_x, int start_y, int end_x, int end_y, int tile, int width, int height, int range, int clientSight, char * rawMap_data, VisibilityCache *visibility) {
 	int distance = blockDistance_inner(start_x, start_y, end_x, end_y);
 	if (distance < 2) {
 		return 1;
@@ -562,13 +2065,45 @@ canAttack_inner(int start_x, int start_y, int end_x, int end_y, int tile, int wi
 	if (client_distance > range) {
 		return 0;
 	}
-	if (!checkLOS_inner(start_x, start_y, end_x, end_y, tile, width, height, rawMap_data)) {
+	// The line of sight comes from the field's visibility cache when there is one
+	if (visibility) {
+		if (!Visibility_checkLOS(visibility, start_x, start_y, end_x, end_y, tile, rawMap_data)) {
+			return -1;
+		}
+	} else if (!checkLOS_inner(start_x, start_y, end_x, end_y, tile, width, height, rawMap_data)) {
 		return -1 ;
 	}
 
 	return 1;
 }
 
+// Bulk versions of checkLOS_inner and canAttack_inner, from one origin to 'count' targets packed as little endian x, y unsigned shorts (pack("v*")).
+// The result of each target is written to 'results', so a whole screen of actors is checked in a single call. 'visibility' may be NULL.
+void
+checkLOSMany_inner(int start_x, int start_y, const unsigned char *targets, long count, int tile, int width, int height, char * rawMap_data, VisibilityCache *visibility, signed char *results) {
+	long i;
+	if (start_x < 0 || start_x >= width || start_y < 0 || start_y >= height) {
+		memset(results, 0, count);
+		return;
+	}
+	for (i = 0; i < count; i++) {
+		int end_x = targets[i * 4] | (targets[i * 4 + 1] << 8);
+		int end_y = targets[i * 4 + 2] | (targets[i * 4 + 3] << 8);
+		results[i] = (signed char) (visibility ? Visibility_checkLOS(visibility, start_x, start_y, end_x, end_y, tile, rawMap_data)
+			: checkLOS_inner(start_x, start_y, end_x, end_y, tile, width, height, rawMap_data));
+	}
+}
+
+void
+canAttackMany_inner(int start_x, int start_y, const unsigned char *targets, long count, int tile, int width, int height, int range, int clientSight, char * rawMap_data, VisibilityCache *visibility, signed char *results) {
+	long i;
+	for (i = 0; i < count; i++) {
+		int end_x = targets[i * 4] | (targets[i * 4 + 1] << 8);
+		int end_y = targets[i * 4 + 2] | (targets[i * 4 + 3] << 8);
+		results[i] = (signed char) canAttack_inner(start_x, start_y, end_x, end_y, tile, width, height, range, clientSight, rawMap_data, visibility);
+	}
+}
+
 int
 checkPathFree_inner(int start_x, int start_y, int end_x, int end_y, int tile, int width, int height, char * rawMap_data) {
 	int offset;
@@ -629,11 +2164,10 @@ checkPathFree_inner(int start_x, int start_y, int end_x, int end_y, int tile, in
 	}
 }
 
-int *
-getSquareEdgesFromCoord_inner (int x, int y, int radius, int width, int height)
+// Stores the square of center (x, y) and radius 'radius' clipped to the map in 'limits', as min_x, min_y, max_x, max_y
+void
+getSquareEdgesFromCoord_inner (int x, int y, int radius, int width, int height, int *limits)
 {
-	static int limits[4];
-
 	// min_x
 	limits[0] = (x - radius);
 	if (limits[0] < 0) {
@@ -657,8 +2191,227 @@ getSquareEdgesFromCoord_inner (int x, int y, int radius, int width, int height)
 	if (limits[3] >= height) {
 		limits[3] = height-1;
 	}
+}
+
+// Stores the cells of the border of the square of center (x, y) and radius 'radius' which have 'tile' set in rawMap as x, y pairs in 'coords',
+// going clockwise from the corner of the lowest coordinates. 'coords' must have room for 8 * radius pairs.
+// Returns the number of cells stored.
+int
+calcRectArea_inner (int x, int y, int radius, int tile, int width, int height, const char *rawMap_data, unsigned short *coords)
+{
+	int limits[4];
+	getSquareEdgesFromCoord_inner(x, y, radius, width, height, limits);
+	int min_x = limits[0];
+	int min_y = limits[1];
+	int max_x = limits[2];
+	int max_y = limits[3];
+	int offset;
+	int size = 0;
+
+	x = min_x;
+	y = min_y;
+	offset = (y * width) + x;
+
+	while (x < max_x) {
+		if (rawMap_data[offset] & tile) {
+			coords[size * 2] = x;
+			coords[size * 2 + 1] = y;
+			size++;
+		}
+		offset++;
+		x++;
+	}
+
+	while (y < max_y) {
+		if (rawMap_data[offset] & tile) {
+			coords[size * 2] = x;
+			coords[size * 2 + 1] = y;
+			size++;
+		}
+		offset += width;
+		y++;
+	}
+
+	while (x > min_x) {
+		if (rawMap_data[offset] & tile) {
+			coords[size * 2] = x;
+			coords[size * 2 + 1] = y;
+			size++;
+		}
+		offset--;
+		x--;
+	}
+
+	while (y > min_y) {
+		if (rawMap_data[offset] & tile) {
+			coords[size * 2] = x;
+			coords[size * 2 + 1] = y;
+			size++;
+		}
+		offset -= width;
+		y--;
+	}
+
+	return size;
+}
+
+// Builds the walkable prefix counts of a map: for each row, (width + 1) counts where entry x is the number of cells with
+// 'tile' set in rawMap left of column x. The number of such cells between two columns of a row is then a subtraction.
+void
+buildWalkablePrefix_inner (const char *rawMap_data, int width, int height, int tile, unsigned short *prefix)
+{
+	int x;
+	int y;
+
+	for (y = 0; y < height; y++) {
+		unsigned short *row = prefix + ((long) y * (width + 1));
+		const char *cells = rawMap_data + ((long) y * width);
+		row[0] = 0;
+		for (x = 0; x < width; x++) {
+			row[x + 1] = row[x] + ((cells[x] & tile) ? 1 : 0);
+		}
+	}
+}
+
+static inline unsigned int
+sampleRandom (unsigned int *state)
+{
+	unsigned int x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+// Whether a cell can be reached according to the optional distance field of size x size cells starting at (left, top)
+static inline int
+sampleReachable (const unsigned short *distances, int left, int top, int size, int x, int y)
+{
+	if (!distances) {
+		return 1;
+	}
+	if (x < left || y < top || x >= left + size || y >= top + size) {
+		return 0;
+	}
+	return distances[((long) (y - top) * size) + (x - left)] != 0xFFFF;
+}
+
+// Draws up to 'count' distinct cells uniformly among the walkable cells of the rectangle (min_x, min_y) - (max_x, max_y),
+// using the prefix counts built by buildWalkablePrefix_inner. With a distance field (see CalcPath_distanceField) only the
+// cells it can reach are drawn. 'state' is the xorshift32 state of the draws, it must not be 0.
+// Stores the cells as x, y pairs in 'coords', which must have room for 'count' pairs, and returns how many were drawn.
+long
+sampleWalkable_inner (const unsigned short *prefix, int width, int height, int min_x, int max_x, int min_y, int max_y, long count,
+	const unsigned short *distances, int left, int top, int size, unsigned int *state, unsigned short *coords)
+{
+	long rows;
+	long *cumulative;
+	long total = 0;
+	long drawn = 0;
+	long attempts;
+	int y;
+
+	if (min_x < 0) min_x = 0;
+	if (min_y < 0) min_y = 0;
+	if (max_x >= width) max_x = width - 1;
+	if (max_y >= height) max_y = height - 1;
+	if (count <= 0 || min_x > max_x || min_y > max_y) {
+		return 0;
+	}
+
+	// Walkable cells in the rectangle up to each row, so a draw can be mapped to its row with a binary search
+	rows = max_y - min_y + 1;
+	cumulative = (long *) malloc((rows + 1) * sizeof(long));
+	cumulative[0] = 0;
+	for (y = min_y; y <= max_y; y++) {
+		const unsigned short *row = prefix + ((long) y * (width + 1));
+		total += row[max_x + 1] - row[min_x];
+		cumulative[y - min_y + 1] = total;
+	}
 
-	return limits;
+	if (count * 4 >= total) {
+		// Most of the cells are wanted: list the candidates and shuffle the beginning of the list
+		unsigned short *all = (unsigned short *) malloc((total > 0 ? total : 1) * 2 * sizeof(unsigned short));
+		long listed = 0;
+		long i;
+		int x;
+
+		for (y = min_y; y <= max_y; y++) {
+			const unsigned short *row = prefix + ((long) y * (width + 1));
+			for (x = min_x; x <= max_x; x++) {
+				if (row[x + 1] != row[x] && sampleReachable(distances, left, top, size, x, y)) {
+					all[listed * 2] = x;
+					all[listed * 2 + 1] = y;
+					listed++;
+				}
+			}
+		}
+		for (i = 0; i < listed && i < count; i++) {
+			long j = i + (long) (sampleRandom(state) % (unsigned int) (listed - i));
+			coords[i * 2] = all[j * 2];
+			coords[i * 2 + 1] = all[j * 2 + 1];
+			all[j * 2] = all[i * 2];
+			all[j * 2 + 1] = all[i * 2 + 1];
+		}
+		drawn = i;
+		free(all);
+		free(cumulative);
+		return drawn;
+	}
+
+	// Few cells are wanted: draw cells until there are enough distinct ones, the cells which can't be reached are drawn again
+	for (attempts = count * 16 + 64; attempts > 0 && drawn < count; attempts--) {
+		long target = (long) (sampleRandom(state) % (unsigned int) total);
+		long low = 0;
+		long high = rows - 1;
+		const unsigned short *row;
+		int x;
+		int hi;
+		long i;
+
+		while (low < high) {
+			long middle = (low + high + 1) / 2;
+			if (cumulative[middle] <= target) {
+				low = middle;
+			} else {
+				high = middle - 1;
+			}
+		}
+		y = min_y + (int) low;
+		row = prefix + ((long) y * (width + 1));
+
+		// The cell is the first column whose prefix count passes the rank of the draw in its row
+		target = row[min_x] + (target - cumulative[low]);
+		x = min_x;
+		hi = max_x;
+		while (x < hi) {
+			int middle = (x + hi) / 2;
+			if (row[middle + 1] > target) {
+				hi = middle;
+			} else {
+				x = middle + 1;
+			}
+		}
+
+		if (!sampleReachable(distances, left, top, size, x, y)) {
+			continue;
+		}
+		for (i = 0; i < drawn; i++) {
+			if (coords[i * 2] == x && coords[i * 2 + 1] == y) {
+				break;
+			}
+		}
+		if (i < drawn) {
+			continue;
+		}
+		coords[drawn * 2] = x;
+		coords[drawn * 2 + 1] = y;
+		drawn++;
+	}
+
+	free(cumulative);
+	return drawn;
 }
 
 int
@@ -671,21 +2424,422 @@ blockDistance_inner (int start_x, int start_y, int end_x, int end_y)
 	return dx > dy ? dx : dy;
 }
 
+// Clamps a coordinate to the range of the 16 bit positions the bulk distance functions work on
+static inline int
+clampPosition (int value)
+{
+	return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+}
+
+// Block distances from (x, y), both within 16 bits, to the first positions of blockDistanceMany_inner, many at
+// a time. Returns how many were done, the rest is left to the caller. The wider kernels leave the last ones
+// to the narrower ones.
+typedef long (*BlockDistancesKernel) (const short *positions, long count, int x, int y, unsigned short *distances);
+
+static long
+blockDistances_scalar (const short *positions, long count, int x, int y, unsigned short *distances)
+{
+	return 0;
+}
+
+#ifdef SIMD_X86
+// 8 positions at a time, the subtractions saturate so no lane can overflow
+SIMD_TARGET_SSE2 static long
+blockDistances_sse2 (const short *positions, long count, int x, int y, unsigned short *distances)
+{
+	const __m128i origin = _mm_set1_epi32((int) (((unsigned int) y << 16) | ((unsigned int) x & 0xFFFF)));
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i lowHalf = _mm_set1_epi32(0xFFFF);
+	long i;
+
+	for (i = 0; i + 8 <= count; i += 8) {
+		__m128i first = _mm_subs_epi16(_mm_loadu_si128((const __m128i *) (positions + i * 2)), origin);
+		__m128i second = _mm_subs_epi16(_mm_loadu_si128((const __m128i *) (positions + i * 2 + 8)), origin);
+
+		first = _mm_max_epi16(first, _mm_subs_epi16(zero, first));
+		second = _mm_max_epi16(second, _mm_subs_epi16(zero, second));
+		// The low half of each 32 bit lane becomes max(|dx|, |dy|)
+		first = _mm_and_si128(_mm_max_epi16(first, _mm_srli_epi32(first, 16)), lowHalf);
+		second = _mm_and_si128(_mm_max_epi16(second, _mm_srli_epi32(second, 16)), lowHalf);
+		_mm_storeu_si128((__m128i *) (distances + i), _mm_packs_epi32(first, second));
+	}
+	return i;
+}
+
+// 16 positions at a time, as blockDistances_sse2 does
+SIMD_TARGET_AVX2 static long
+blockDistances_avx2 (const short *positions, long count, int x, int y, unsigned short *distances)
+{
+	const __m256i origin = _mm256_set1_epi32((int) (((unsigned int) y << 16) | ((unsigned int) x & 0xFFFF)));
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i lowHalf = _mm256_set1_epi32(0xFFFF);
+	long i;
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		__m256i first = _mm256_subs_epi16(_mm256_loadu_si256((const __m256i *) (positions + i * 2)), origin);
+		__m256i second = _mm256_subs_epi16(_mm256_loadu_si256((const __m256i *) (positions + i * 2 + 16)), origin);
+
+		first = _mm256_max_epi16(first, _mm256_subs_epi16(zero, first));
+		second = _mm256_max_epi16(second, _mm256_subs_epi16(zero, second));
+		first = _mm256_and_si256(_mm256_max_epi16(first, _mm256_srli_epi32(first, 16)), lowHalf);
+		second = _mm256_and_si256(_mm256_max_epi16(second, _mm256_srli_epi32(second, 16)), lowHalf);
+		// The packing works within each 128 bit half, the quarters are put back in order
+		__m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), 0xD8);
+		_mm256_storeu_si256((__m256i *) (distances + i), packed);
+	}
+	return i + blockDistances_sse2(positions + i * 2, count - i, x, y, distances + i);
+}
+#endif
+
+// Actor lists are short, AVX-512 CPUs use the AVX2 kernel
+static BlockDistancesKernel
+selectBlockDistances ()
+{
+#ifdef SIMD_X86
+	switch (CPU_simdLevel()) {
+	case SIMD_AVX512:
+	case SIMD_AVX2: return blockDistances_avx2;
+	case SIMD_SSE2: return blockDistances_sse2;
+	}
+#endif
+	return blockDistances_scalar;
+}
+
+static const BlockDistancesKernel blockDistances = selectBlockDistances();
+
+// Computes the block distances from (x, y) to the positions, given as 'count' x, y pairs, into 'distances'.
+// Distances are saturated at 32767, which only matters for the -32768 placeholder of actors without a position.
+void
+blockDistanceMany_inner (const short *positions, long count, int x, int y, unsigned short *distances)
+{
+	long i;
+	int dx;
+	int dy;
+
+	x = clampPosition(x);
+	y = clampPosition(y);
+	for (i = blockDistances(positions, count, x, y, distances); i < count; i++) {
+		dx = positions[i * 2] - x;
+		dy = positions[i * 2 + 1] - y;
+		if (dx < 0) dx = -dx;
+		if (dy < 0) dy = -dy;
+		dx = dx > dy ? dx : dy;
+		distances[i] = (unsigned short) (dx > 32767 ? 32767 : dx);
+	}
+}
+
+// Finds the positions, given as 'count' x, y pairs, within block distance 'dist' of (x, y), or all of them if 'dist' is negative.
+// Stores their indices in 'indices', which must have room for 'count' of them, nearest first and in the order
+// of the positions for equal distances, and returns how many were found.
+long
+positionsInRange_inner (const short *positions, long count, int x, int y, int dist, unsigned int *indices)
+{
+	int *distances;
+	unsigned short *blockDistances;
+	long *starts;
+	int maxDist = 0;
+	long found = 0;
+	long i;
+
+	if (count <= 0) {
+		return 0;
+	}
+	distances = (int *) malloc(count * sizeof(int));
+	blockDistances = (unsigned short *) malloc(count * sizeof(unsigned short));
+	blockDistanceMany_inner(positions, count, x, y, blockDistances);
+	for (i = 0; i < count; i++) {
+		distances[i] = blockDistances[i];
+		if (dist >= 0 && distances[i] > dist) {
+			distances[i] = -1;
+			continue;
+		}
+		if (distances[i] > maxDist) {
+			maxDist = distances[i];
+		}
+		found++;
+	}
+
+	// Counting sort on the distance, which keeps the order of the positions for equal distances
+	starts = (long *) calloc(maxDist + 2, sizeof(long));
+	for (i = 0; i < count; i++) {
+		if (distances[i] >= 0) {
+			starts[distances[i] + 1]++;
+		}
+	}
+	for (i = 1; i <= maxDist + 1; i++) {
+		starts[i] += starts[i - 1];
+	}
+	for (i = 0; i < count; i++) {
+		if (distances[i] >= 0) {
+			indices[starts[distances[i]]++] = (unsigned int) i;
+		}
+	}
+
+	free(starts);
+	free(blockDistances);
+	free(distances);
+	return found;
+}
+
+// The client distance of a delta, which is (int) (sqrt(dx * dx + dy * dy) - 0.1) clamped to 0.
+// That is the largest r with (10 * r + 1) ^ 2 <= 100 * (dx * dx + dy * dy), so it is computed with
+// an integer square root of 100 times the squared distance and matches the floating point version exactly.
+static inline int
+clientDistOfDelta (int dx, int dy)
+{
+	unsigned long long m = (unsigned long long) (dx < 0 ? -(long long) dx : dx);
+	unsigned long long n = (unsigned long long) (dy < 0 ? -(long long) dy : dy);
+	unsigned long long target;
+	unsigned long long root;
+	unsigned long long next;
+
+	if (n > m) {
+		next = m;
+		m = n;
+		n = next;
+	}
+	if (m == 0) {
+		return 0;
+	}
+
+	// 10 * m + 5 * n is never below the root because n <= m, Newton's method then converges down to it
+	target = 100 * (m * m + n * n);
+	root = 10 * m + 5 * n;
+	for (;;) {
+		next = (root + target / root) / 2;
+		if (next >= root) {
+			break;
+		}
+		root = next;
+	}
+
+	return (int) ((root - 1) / 10);
+}
+
 int
 getClientDist_inner (int start_x, int start_y, int end_x, int end_y)
 {
-	int dx = start_x - end_x;
-	int dy = start_y - end_y;
+	return clientDistOfDelta(start_x - end_x, start_y - end_y);
+}
+
+// Computes the client distances from (x, y) to the positions, given as 'count' x, y pairs, into 'distances'.
+void
+clientDistMany_inner (const short *positions, long count, int x, int y, unsigned short *distances)
+{
+	long i;
+	int distance;
+
+	for (i = 0; i < count; i++) {
+		distance = clientDistOfDelta(positions[i * 2] - x, positions[i * 2 + 1] - y);
+		distances[i] = (unsigned short) (distance > 65535 ? 65535 : distance);
+	}
+}
+
+// Computes when each cell of a packed solution is reached from its first one, in tenths of the time of an orthogonal step,
+// the times calcStepsWalkedFromTimeAndSolution adds up: 10 for an orthogonal step and 14 for a diagonal one.
+void
+solutionTimes_inner (const unsigned char *packed, long count, unsigned int *times)
+{
+	long i;
+	unsigned int step = 0;
+
+	for (i = 0; i < count; i++) {
+		if (i > 0) {
+			int dx = (packed[i * 4] | (packed[i * 4 + 1] << 8)) != (packed[i * 4 - 4] | (packed[i * 4 - 3] << 8));
+			int dy = (packed[i * 4 + 2] | (packed[i * 4 + 3] << 8)) != (packed[i * 4 - 2] | (packed[i * 4 - 1] << 8));
+			// A step which doesn't move takes as long as the one before it
+			if (dx + dy) {
+				step = (dx + dy == 2) ? 14 : 10;
+			}
+			times[i] = times[i - 1] + step;
+		} else {
+			times[i] = 0;
+		}
+	}
+}
+
+// Returns the index of the cell an actor walking 'speed' seconds per orthogonal step is at 'time' seconds after leaving
+// the first one: the last cell reached before that time (binary search over the times of solutionTimes_inner).
+long
+stepAtTime_inner (const unsigned int *times, long count, double speed, double time)
+{
+	long low = 0;
+	long high = count - 1;
+
+	while (low < high) {
+		long middle = (low + high + 1) / 2;
+		if (times[middle] * speed / 10 < time) {
+			low = middle;
+		} else {
+			high = middle - 1;
+		}
+	}
+	return low;
+}
+
+// Same as stepAtTime_inner, for the straight path of get_client_easy_solution over dx, dy cells: diagonal steps first,
+// until one of the coordinates is reached, then orthogonal steps.
+long
+easyStepAtTime_inner (int dx, int dy, double speed, double time)
+{
+	long diagonal, low, high;
+
+	dx = abs(dx);
+	dy = abs(dy);
+	diagonal = (dx < dy) ? dx : dy;
+	low = 0;
+	high = (dx > dy) ? dx : dy;
+	while (low < high) {
+		long middle = (low + high + 1) / 2;
+		long steps = (middle <= diagonal) ? middle * 14 : diagonal * 14 + (middle - diagonal) * 10;
+		if (steps * speed / 10 < time) {
+			low = middle;
+		} else {
+			high = middle - 1;
+		}
+	}
+	return low;
+}
+
+// Finds the centre of a square skill area of 'radius' blocks which hits the most of 'count' positions (x, y pairs of native
+// shorts, like positionsInRange_inner takes them). Candidates are the cells within 'around' blocks of (around_x, around_y),
+// within 'range' client distance of the caster and in its line of sight, like a ground skill needs them. Hits come from a 2D
+// prefix sum of the positions over the areas of every candidate, so a candidate costs four lookups and line of sight is
+// only checked for the ones which would be better than the best so far. Ties go to the candidate closest to
+// (around_x, around_y). The centre is written to 'center'; returns the number of positions it hits, or -1 if no candidate
+// can be targeted. 'visibility' may be NULL.
+long
+bestAreaCenter_inner (const short *positions, long count, int caster_x, int caster_y, int range, int around_x, int around_y, int around,
+	int radius, int tile, int width, int height, char *rawMap_data, VisibilityCache *visibility, int *center)
+{
+	int min_x = around_x - around, max_x = around_x + around;
+	int min_y = around_y - around, max_y = around_y + around;
+	int grid_width, grid_height, left, top, x, y;
+	unsigned int *sums;
+	long i, best = -1;
+	int bestDist = 0;
+
+	// The client distance of cells range + 1 blocks away along an axis can still be range
+	if (min_x < caster_x - range - 1) min_x = caster_x - range - 1;
+	if (max_x > caster_x + range + 1) max_x = caster_x + range + 1;
+	if (min_y < caster_y - range - 1) min_y = caster_y - range - 1;
+	if (max_y > caster_y + range + 1) max_y = caster_y + range + 1;
+	if (min_x < 0) min_x = 0;
+	if (min_y < 0) min_y = 0;
+	if (max_x >= width) max_x = width - 1;
+	if (max_y >= height) max_y = height - 1;
+	if (radius < 0 || min_x > max_x || min_y > max_y) {
+		return -1;
+	}
+
+	// sums[(gy + 1) * (grid_width + 1) + gx + 1] is the number of positions in the grid up to (gx, gy)
+	left = min_x - radius;
+	top = min_y - radius;
+	grid_width = max_x - min_x + 2 * radius + 1;
+	grid_height = max_y - min_y + 2 * radius + 1;
+	sums = (unsigned int *) calloc((long) (grid_width + 1) * (grid_height + 1), sizeof(unsigned int));
+	for (i = 0; i < count; i++) {
+		int gx = positions[i * 2] - left;
+		int gy = positions[i * 2 + 1] - top;
+		if (gx >= 0 && gx < grid_width && gy >= 0 && gy < grid_height) {
+			sums[(long) (gy + 1) * (grid_width + 1) + gx + 1]++;
+		}
+	}
+	for (y = 1; y <= grid_height; y++) {
+		unsigned int *row = sums + (long) y * (grid_width + 1);
+		unsigned int *above = row - (grid_width + 1);
+		for (x = 1; x <= grid_width; x++) {
+			row[x] += row[x - 1] + above[x] - above[x - 1];
+		}
+	}
 
-	double temp_dist = sqrt((double)(dx*dx + dy*dy));
+	for (y = min_y; y <= max_y; y++) {
+		// The area of (x, y) spans grid rows y - min_y to y - min_y + 2 * radius
+		const unsigned int *low = sums + (long) (y - min_y) * (grid_width + 1);
+		const unsigned int *high = sums + (long) (y - min_y + 2 * radius + 1) * (grid_width + 1);
+		for (x = min_x; x <= max_x; x++) {
+			int x0 = x - min_x;
+			int x1 = x0 + 2 * radius + 1;
+			long hits = (long) high[x1] - high[x0] - low[x1] + low[x0];
+			int dx = abs(x - around_x), dy = abs(y - around_y);
+			int dist = (dx > dy) ? dx : dy;
+
+			if (hits < best || (hits == best && dist >= bestDist)) {
+				continue;
+			}
+			if (clientDistOfDelta(x - caster_x, y - caster_y) > range || !(rawMap_data[(y * width) + x] & tile)) {
+				continue;
+			}
+			if (!(visibility ? Visibility_checkLOS(visibility, caster_x, caster_y, x, y, tile, rawMap_data)
+				: checkLOS_inner(caster_x, caster_y, x, y, tile, width, height, rawMap_data))) {
+				continue;
+			}
+			best = hits;
+			bestDist = dist;
+			center[0] = x;
+			center[1] = y;
+		}
+	}
+	free(sums);
+	return best;
+}
 
-	temp_dist -= 0.1;
+// Collapses a packed solution into segments the server walks in a straight line: from every waypoint the next one is the
+// furthest cell of the solution, at most maxSegment steps ahead, which checkPathFree_inner can walk to. The cells between
+// two waypoints are replaced by the ones of that walk (diagonally first, then straight), which are never more than the
+// solution had. Writes the cells to coords and the index in coords of every waypoint after the first cell to waypoints,
+// both must have room for 'count' entries, and returns the number of cells written.
+long
+smoothSolution_inner (const unsigned char *packed, long count, long maxSegment, int tile, int width, int height, char *rawMap_data,
+	unsigned short *coords, unsigned int *waypoints, long *waypointCount)
+{
+	long size = 0;
+	long current = 0;
 
-	if (temp_dist < 0) {
-		temp_dist = 0;
+	*waypointCount = 0;
+	if (count <= 0) {
+		return 0;
+	}
+	if (maxSegment < 1) {
+		maxSegment = 1;
 	}
 
-	return ((int)temp_dist);
+	coords[0] = packed[0] | (packed[1] << 8);
+	coords[1] = packed[2] | (packed[3] << 8);
+	size = 1;
+
+	while (current < count - 1) {
+		int x = packed[current * 4] | (packed[current * 4 + 1] << 8);
+		int y = packed[current * 4 + 2] | (packed[current * 4 + 3] << 8);
+		long next = (current + maxSegment < count - 1) ? current + maxSegment : count - 1;
+		int to_x;
+		int to_y;
+
+		// The next cell of the solution is always kept, even if its diagonal cuts a corner checkPathFree_inner refuses
+		for (; next > current + 1; next--) {
+			to_x = packed[next * 4] | (packed[next * 4 + 1] << 8);
+			to_y = packed[next * 4 + 2] | (packed[next * 4 + 3] << 8);
+			if (checkPathFree_inner(x, y, to_x, to_y, tile, width, height, rawMap_data)) {
+				break;
+			}
+		}
+		to_x = packed[next * 4] | (packed[next * 4 + 1] << 8);
+		to_y = packed[next * 4 + 2] | (packed[next * 4 + 3] << 8);
+
+		while (x != to_x || y != to_y) {
+			x += (x < to_x) - (x > to_x);
+			y += (y < to_y) - (y > to_y);
+			coords[size * 2] = x;
+			coords[size * 2 + 1] = y;
+			size++;
+		}
+		// A solution may hold the same cell twice in a row, which adds no cell and no waypoint
+		if (size > 1 && (*waypointCount == 0 || waypoints[*waypointCount - 1] != (unsigned int) (size - 1))) {
+			waypoints[(*waypointCount)++] = size - 1;
+		}
+		current = next;
+	}
+	return size;
 }
 
 #ifdef __cplusplus
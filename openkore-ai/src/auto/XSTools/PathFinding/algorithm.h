@@ -5,35 +5,103 @@
 extern "C" {
 #endif /* __cplusplus */
 
+// Node list states, stored in the 2 lowest bits of CalcPath_session->nodeState
+#define NONE 0
+#define OPEN 1
+#define CLOSED 2
+
+// Search algorithms, Jump Point Search is only valid on uniform cost maps and the bidirectional search needs the
+// admissible heuristic and the same weights in both directions (no manhattan heuristic and no random factor)
+#define CALCPATH_ASTAR 0
+#define CALCPATH_JPS 1
+#define CALCPATH_BIDIRECTIONAL 2
+
+// Each member of the open list holds the f score of a node together with its adress, so the heap can be sifted without touching the node arrays
 typedef struct {
-	int x;
-	int y;
+	unsigned int f;
+	unsigned int nodeAdress;
+} OpenListEntry;
 
-	long nodeAdress;
+// Binary heap of the bidirectional search, nodes are added again when their score improves and the stale entries are skipped
+typedef struct {
+	OpenListEntry *entries;
+	long size;
+	long capacity;
+} LazyOpenList;
+
+// Open list backends, a binary heap or a bucket queue indexed by the f score
+#define OPENLIST_HEAP 0
+#define OPENLIST_BUCKET 1
+
+// Links of a node in the bucket queue, each bucket is a doubly linked list of the open nodes with the same f score
+typedef struct {
+	unsigned int next;
+	unsigned int prev;
+	unsigned int f;
+} BucketLink;
+
+// One cell of the custom weights overlay, free slots have the adress CUSTOM_WEIGHT_EMPTY
+typedef struct {
+	unsigned int adress;
+	unsigned int weight;
+} CustomWeight;
+
+#define CUSTOM_WEIGHT_EMPTY 0xFFFFFFFF
 
-	long predecessor;
+// Most landmarks a session can use, see landmarks.h
+#define CALCPATH_MAX_LANDMARKS 16
 
-	unsigned short whichlist;
-	long openListIndex;
+// Line of sight cache of a field, see visibility.h
+typedef struct VisibilityCache VisibilityCache;
 
-	unsigned long g;
-	unsigned long h;
-	unsigned long f;
-} Node;
+// Danger layer of a field, see danger.h
+typedef struct DangerMap DangerMap;
 
 typedef struct {
 	bool avoidWalls;
 	const char *map_base_weight;
 
+	// Optional precomputed neighbors bitmask of every cell, as built by CalcPath_buildNeighborMask, NULL to compute it while searching
+	const unsigned char *neighbor_mask;
+
 	bool customWeights;
-	unsigned int *second_weight_map;
+	// Extra weights of the few cells given in secondWeightMap, an open addressing hash table of the cell adresses with customWeightMask + 1 (a power of 2) slots
+	CustomWeight *customWeightTable;
+	unsigned long customWeightMask;
+	// Order independent digest of the cells set in the table, part of the route cache key (see cache.h)
+	unsigned long long customWeightDigest;
+
+	// Optional danger layer whose weight is added to every cell stepped on, NULL for none.
+	// dangerVersion is the version of the layer when the session was reset.
+	DangerMap *danger;
+	unsigned long dangerVersion;
+	// Optional obstacle layer given as secondWeightMap instead of its cells (customWeights is then false), added like the
+	// danger layer. obstaclesVersion is the version of the layer when the session was reset.
+	DangerMap *obstacles;
+	unsigned long obstaclesVersion;
 
 	unsigned int randomFactor;
+	// State of the session's own random number generator (xorshift32), never 0
+	unsigned int randomState;
 
 	bool useManhattan;
 
+	// Optional landmark distance tables of the weight map (see landmarks.h), landmarkCount costs per cell, NULL for none.
+	// They are only used by the A* and JPS searches with the admissible heuristic, landmarkGoal holds the costs of the goal.
+	const unsigned short *landmarks;
+	int landmarkCount;
+	unsigned short landmarkGoal[CALCPATH_MAX_LANDMARKS];
+
 	unsigned long time_max;
 
+	// Optional budget of a single CalcPath_pathStep call, in expanded nodes and in microseconds, 0 for no limit.
+	// Once it runs out the call returns -4 and the next call resumes the search from the saved open list.
+	unsigned long node_budget;
+	unsigned long time_budget;
+
+	// CALCPATH_ASTAR, CALCPATH_JPS or CALCPATH_BIDIRECTIONAL
+	int algorithm;
+
 	int width;
 	int height;
 
@@ -42,6 +110,24 @@ typedef struct {
 	int min_y;
 	int max_y;
 
+	// Adaptive search window of the A* searches, window is its first margin in cells or 0 for none. The search starts in the box
+	// around the start and the goal grown by the margin, min_x, max_x, min_y and max_y then hold the window and limit_min_x,
+	// limit_max_x, limit_min_y and limit_max_y the search area given to reset. Once the open list runs out the margin doubles, and
+	// the closed nodes whose neighbors were cut off by the window (windowBorder) are opened again, so the search resumes with the
+	// nodes it already expanded. windowMargin is the current margin, 0 once the window covers the whole search area.
+	int window;
+	int windowMargin;
+	int windowBox[4];
+	int limit_min_x;
+	int limit_max_x;
+	int limit_min_y;
+	int limit_max_y;
+	unsigned int *windowBorder;
+	unsigned long windowBorderSize;
+	unsigned long windowBorderCapacity;
+	// Number of times the window was grown since the last reset
+	unsigned long windowGrowths;
+
 	int startX;
 	int startY;
 	int endX;
@@ -53,26 +139,90 @@ typedef struct {
 
 	long openListSize;
 
-	Node *currentMap;
-
-	long *openList;
+	// Per node data is kept as a structure of arrays indexed by the node adress (y * width + x), the coordinates are derived from the adress
+	// nodeState holds the session generation in which the node was last touched in the upper bits and its list state (NONE, OPEN or CLOSED) in the 2 lowest bits
+	unsigned int *nodeState;
+	unsigned int *gScore;
+	unsigned int *predecessor;
+	unsigned int *openListIndex;
+
+	// Bidirectional search, the forward search uses the arrays above and the backward search from the goal these ones,
+	// bidiSuccessor holds the next node towards the goal. bidiOpen holds the open list of each direction (forward first).
+	// bidiBest is the cost of the best path found through a node reached from both sides, bidiMeet that node, and bidiDone
+	// is set once no better path can be found.
+	unsigned int *bidiState;
+	unsigned int *bidiGScore;
+	unsigned int *bidiSuccessor;
+	unsigned long bidiCapacity;
+	LazyOpenList bidiOpen[2];
+	unsigned int bidiBest;
+	unsigned int bidiMeet;
+	int bidiDone;
+
+	// Number of nodes taken out of the open lists since the last reset, over all the runs of the search
+	unsigned long expanded;
+
+	// OPENLIST_HEAP or OPENLIST_BUCKET
+	int openListType;
+
+	OpenListEntry *openList;
+
+	// Bucket queue, buckets holds the first node of each f score and bucketLinks the list links of every node
+	unsigned int *buckets;
+	BucketLink *bucketLinks;
+	// All f scores below bucketLowest have empty buckets, and only the first bucketsUsed buckets have been touched in this run
+	unsigned long bucketLowest;
+	unsigned long bucketsUsed;
+
+	// Buffers are kept alive between resets, these hold how many cells they were allocated for
+	unsigned long nodeCapacity;
+	unsigned long customWeightCapacity;
+	unsigned long openListCapacity;
+	unsigned long bucketCount;
+	unsigned long bucketLinksCapacity;
+
+	// Incremented on every CalcPath_init, so only the nodes touched by a search need to be reset
+	unsigned int generation;
+
+	// Background search state, see workers.h. jobStatus is one of the CALCPATH_JOB_* values and jobResult the CalcPath_pathStep result of the job, job its task while it is submitted
+	volatile int jobStatus;
+	int jobResult;
+	void *job;
+	// Opaque pointers of the caller, the Perl wrapper keeps the weight map, neighbor mask, danger layer, landmarks and obstacle layer scalars alive in here while a job runs
+	void *jobOwners[5];
+
+	// Route cache state, see cache.h. routeCacheField identifies the weight map of the search, 0 when its result must not be stored.
+	// cachedResult is the CalcPath_pathStep result of the search when reset already knows it, from the cache or because the
+	// start and goal are in different connected areas, 0 if not.
+	unsigned long long routeCacheField;
+	int cachedResult;
 } CalcPath_session;
 
 CalcPath_session *CalcPath_new ();
 
 void CalcPath_init (CalcPath_session *session);
 
+void CalcPath_initCustomWeights (CalcPath_session *session, long count);
+
+void CalcPath_setCustomWeight (CalcPath_session *session, unsigned int adress, unsigned int weight);
+
 int CalcPath_pathStep (CalcPath_session *session);
 
+int CalcPath_multiGoal (CalcPath_session *session, const unsigned int *goals, long goalCount);
+
+long CalcPath_stepsTo (CalcPath_session *session, unsigned int adress);
+
+int CalcPath_distanceField (CalcPath_session *session, int originX, int originY, int size, unsigned short *distances);
+
 int heuristic_cost_estimate(int currentX, int currentY, int goalX, int goalY, bool useManhattan);
 
-void reconstruct_path(CalcPath_session *session, Node* goal, Node* start);
+void reconstruct_path(CalcPath_session *session, unsigned int goalAdress, unsigned int startAdress);
 
-void openListAdd (CalcPath_session *session, Node* node);
+void openListAdd (CalcPath_session *session, unsigned int nodeAdress, unsigned int f);
 
-void reajustOpenListItem (CalcPath_session *session, Node* node);
+void reajustOpenListItem (CalcPath_session *session, unsigned int nodeAdress, unsigned int f);
 
-Node* openListGetLowest (CalcPath_session *session);
+unsigned int openListGetLowest (CalcPath_session *session);
 
 void free_currentMap (CalcPath_session *session);
 
@@ -80,20 +230,62 @@ void free_openList (CalcPath_session *session);
 
 void CalcPath_destroy (CalcPath_session *session);
 
+unsigned char CalcPath_neighborMaskAt (const char *weight_map, int width, int height, int x, int y);
+
+// Label of the cells of the connected areas which could not be numbered, nothing is known about their connections
+#define COMPONENT_UNKNOWN 0xFFFF
+
+long CalcPath_buildComponents (const char *weight_map, int width, int height, unsigned char *labels);
+
+void CalcPath_buildNeighborMask (const char *weight_map, int width, int height, unsigned char *mask);
+
+long CalcPath_repairComponents (const char *weight_map, int width, int height, const int *cells, int cell_count, unsigned char *labels);
+
+void CalcPath_repairNeighborMask (const char *weight_map, int width, int height, const int *cells, int cell_count, unsigned char *mask);
+
 int checkTile_inner (int start_x, int start_y, int tile, int width, int height, char * rawMap_data);
 
 int checkLOS_inner (int start_x, int start_y, int end_x, int end_y, int tile, int width, int height, char * rawMap_data);
 
-int canAttack_inner (int start_x, int start_y, int end_x, int end_y, int tile, int width, int height, int range, int clientSight, char * rawMap_data);
+int canAttack_inner (int start_x, int start_y, int end_x, int end_y, int tile, int width, int height, int range, int clientSight, char * rawMap_data, VisibilityCache *visibility);
+
+void checkLOSMany_inner (int start_x, int start_y, const unsigned char *targets, long count, int tile, int width, int height, char * rawMap_data, VisibilityCache *visibility, signed char *results);
+
+void canAttackMany_inner (int start_x, int start_y, const unsigned char *targets, long count, int tile, int width, int height, int range, int clientSight, char * rawMap_data, VisibilityCache *visibility, signed char *results);
 
 int checkPathFree_inner (int start_x, int start_y, int end_x, int end_y, int tile, int width, int height, char * rawMap_data);
 
-int * getSquareEdgesFromCoord_inner (int x, int y, int radius, int width, int height);
+void getSquareEdgesFromCoord_inner (int x, int y, int radius, int width, int height, int *limits);
+
+int calcRectArea_inner (int x, int y, int radius, int tile, int width, int height, const char *rawMap_data, unsigned short *coords);
+
+void buildWalkablePrefix_inner (const char *rawMap_data, int width, int height, int tile, unsigned short *prefix);
+
+long sampleWalkable_inner (const unsigned short *prefix, int width, int height, int min_x, int max_x, int min_y, int max_y, long count,
+	const unsigned short *distances, int left, int top, int size, unsigned int *state, unsigned short *coords);
 
 int blockDistance_inner (int start_x, int start_y, int end_x, int end_y);
 
+void blockDistanceMany_inner (const short *positions, long count, int x, int y, unsigned short *distances);
+
+long positionsInRange_inner (const short *positions, long count, int x, int y, int dist, unsigned int *indices);
+
 int getClientDist_inner (int start_x, int start_y, int end_x, int end_y);
 
+void clientDistMany_inner (const short *positions, long count, int x, int y, unsigned short *distances);
+
+void solutionTimes_inner (const unsigned char *packed, long count, unsigned int *times);
+
+long stepAtTime_inner (const unsigned int *times, long count, double speed, double time);
+
+long easyStepAtTime_inner (int dx, int dy, double speed, double time);
+
+long bestAreaCenter_inner (const short *positions, long count, int caster_x, int caster_y, int range, int around_x, int around_y, int around,
+	int radius, int tile, int width, int height, char *rawMap_data, VisibilityCache *visibility, int *center);
+
+long smoothSolution_inner (const unsigned char *packed, long count, long maxSegment, int tile, int width, int height, char *rawMap_data,
+	unsigned short *coords, unsigned int *waypoints, long *waypointCount);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -0,0 +1,277 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cache.h"
+#include "danger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define NO_ENTRY -1
+
+typedef struct {
+	RouteCache_key key;
+	unsigned long long hash;
+
+	// CalcPath_pathStep result, 1 or -1, and the x, y pairs of the path from the start to the goal
+	int status;
+	long length;
+	unsigned short *coords;
+
+	// Least recently used list, from the head (most recent) to the tail (next to be evicted)
+	long prev;
+	long next;
+	// Next entry in the same hash table bucket
+	long chain;
+} RouteCacheEntry;
+
+static struct {
+	long capacity;
+	long count;
+	RouteCacheEntry *entries;
+
+	// Hash table of the entries, bucketMask + 1 (a power of 2) buckets holding the first entry of their chain
+	long *buckets;
+	unsigned long bucketMask;
+
+	long head;
+	long tail;
+} cache = { ROUTE_CACHE_DEFAULT_CAPACITY, 0, NULL, NULL, 0, NO_ENTRY, NO_ENTRY };
+
+static inline unsigned long long
+mix (unsigned long long hash, unsigned long long value)
+{
+	hash ^= value + 0x9E3779B97F4A7C15ULL + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+static unsigned long long
+keyHash (const RouteCache_key *key)
+{
+	unsigned long long hash = key->field;
+	hash = mix (hash, key->customWeights);
+	hash = mix (hash, ((unsigned long long) key->dangerId << 32) ^ key->dangerVersion);
+	hash = mix (hash, ((unsigned long long) key->obstaclesId << 32) ^ key->obstaclesVersion);
+	hash = mix (hash, ((unsigned long long) key->width << 32) | (unsigned int) key->height);
+	hash = mix (hash, ((unsigned long long) key->startX << 32) | (unsigned int) key->startY);
+	hash = mix (hash, ((unsigned long long) key->endX << 32) | (unsigned int) key->endY);
+	hash = mix (hash, ((unsigned long long) key->min_x << 32) | (unsigned int) key->max_x);
+	hash = mix (hash, ((unsigned long long) key->min_y << 32) | (unsigned int) key->max_y);
+	hash = mix (hash, (unsigned int) key->window);
+	hash = mix (hash, ((unsigned long long) key->avoidWalls << 48) | ((unsigned long long) key->useManhattan << 32)
+		| ((unsigned int) key->algorithm << 16) | (unsigned int) key->openListType);
+	return hash;
+}
+
+static inline int
+keyEquals (const RouteCache_key *a, const RouteCache_key *b)
+{
+	return a->field == b->field && a->customWeights == b->customWeights
+		&& a->dangerId == b->dangerId && a->dangerVersion == b->dangerVersion
+		&& a->obstaclesId == b->obstaclesId && a->obstaclesVersion == b->obstaclesVersion
+		&& a->width == b->width && a->height == b->height
+		&& a->startX == b->startX && a->startY == b->startY && a->endX == b->endX && a->endY == b->endY
+		&& a->min_x == b->min_x && a->max_x == b->max_x && a->min_y == b->min_y && a->max_y == b->max_y
+		&& a->window == b->window
+		&& a->avoidWalls == b->avoidWalls && a->useManhattan == b->useManhattan
+		&& a->algorithm == b->algorithm && a->openListType == b->openListType;
+}
+
+// Fills the key of the search the session was reset for, 'field' identifies the weight map
+void
+RouteCache_keyFromSession (CalcPath_session *session, unsigned long long field, RouteCache_key *key)
+{
+	memset(key, 0, sizeof(RouteCache_key));
+	key->field = field;
+	key->customWeights = session->customWeights ? session->customWeightDigest : 0;
+	key->dangerId = session->danger ? session->danger->id : 0;
+	key->dangerVersion = session->danger ? session->dangerVersion : 0;
+	key->obstaclesId = session->obstacles ? session->obstacles->id : 0;
+	key->obstaclesVersion = session->obstacles ? session->obstaclesVersion : 0;
+	key->width = session->width;
+	key->height = session->height;
+	key->startX = session->startX;
+	key->startY = session->startY;
+	key->endX = session->endX;
+	key->endY = session->endY;
+	key->min_x = session->limit_min_x;
+	key->max_x = session->limit_max_x;
+	key->min_y = session->limit_min_y;
+	key->max_y = session->limit_max_y;
+	key->window = session->window;
+	key->avoidWalls = session->avoidWalls;
+	key->useManhattan = session->useManhattan;
+	key->algorithm = session->algorithm;
+	key->openListType = session->openListType;
+}
+
+static void
+lruUnlink (long index)
+{
+	RouteCacheEntry *entry = &cache.entries[index];
+	if (entry->prev != NO_ENTRY) {
+		cache.entries[entry->prev].next = entry->next;
+	} else {
+		cache.head = entry->next;
+	}
+	if (entry->next != NO_ENTRY) {
+		cache.entries[entry->next].prev = entry->prev;
+	} else {
+		cache.tail = entry->prev;
+	}
+}
+
+static void
+lruPushFront (long index)
+{
+	RouteCacheEntry *entry = &cache.entries[index];
+	entry->prev = NO_ENTRY;
+	entry->next = cache.head;
+	if (cache.head != NO_ENTRY) {
+		cache.entries[cache.head].prev = index;
+	} else {
+		cache.tail = index;
+	}
+	cache.head = index;
+}
+
+static void
+bucketUnlink (long index)
+{
+	long *link = &cache.buckets[cache.entries[index].hash & cache.bucketMask];
+	while (*link != index) {
+		link = &cache.entries[*link].chain;
+	}
+	*link = cache.entries[index].chain;
+}
+
+static long
+findEntry (const RouteCache_key *key, unsigned long long hash)
+{
+	long index;
+
+	if (!cache.entries) {
+		return NO_ENTRY;
+	}
+	for (index = cache.buckets[hash & cache.bucketMask]; index != NO_ENTRY; index = cache.entries[index].chain) {
+		if (cache.entries[index].hash == hash && keyEquals (&cache.entries[index].key, key)) {
+			return index;
+		}
+	}
+	return NO_ENTRY;
+}
+
+// Returns the cached search result, 1 or -1, and points 'coords' to its 'length' x, y pairs, or 0 if the search is not cached.
+// The coordinates stay valid until the next RouteCache_store or RouteCache_clear call.
+int
+RouteCache_lookup (const RouteCache_key *key, const unsigned short **coords, long *length)
+{
+	long index = findEntry (key, keyHash (key));
+
+	if (index == NO_ENTRY) {
+		return 0;
+	}
+	if (index != cache.head) {
+		lruUnlink (index);
+		lruPushFront (index);
+	}
+	*coords = cache.entries[index].coords;
+	*length = cache.entries[index].length;
+	return cache.entries[index].status;
+}
+
+// Adds a search result to the cache, evicting the least recently used one when it is full
+void
+RouteCache_store (const RouteCache_key *key, int status, const unsigned short *coords, long length)
+{
+	unsigned long long hash = keyHash (key);
+	RouteCacheEntry *entry;
+	long index;
+
+	if (cache.capacity <= 0) {
+		return;
+	}
+
+	if (!cache.entries) {
+		unsigned long buckets = 16;
+		while (buckets < (unsigned long) cache.capacity * 2) {
+			buckets <<= 1;
+		}
+		cache.entries = (RouteCacheEntry *) malloc(cache.capacity * sizeof(RouteCacheEntry));
+		cache.buckets = (long *) malloc(buckets * sizeof(long));
+		for (index = 0; index < (long) buckets; index++) {
+			cache.buckets[index] = NO_ENTRY;
+		}
+		cache.bucketMask = buckets - 1;
+	}
+
+	index = findEntry (key, hash);
+	if (index != NO_ENTRY) {
+		bucketUnlink (index);
+		lruUnlink (index);
+		free(cache.entries[index].coords);
+	} else if (cache.count < cache.capacity) {
+		index = cache.count++;
+	} else {
+		index = cache.tail;
+		bucketUnlink (index);
+		lruUnlink (index);
+		free(cache.entries[index].coords);
+	}
+
+	entry = &cache.entries[index];
+	entry->key = *key;
+	entry->hash = hash;
+	entry->status = status;
+	entry->length = length;
+	entry->coords = NULL;
+	if (length > 0) {
+		entry->coords = (unsigned short *) malloc(length * 2 * sizeof(unsigned short));
+		memcpy(entry->coords, coords, length * 2 * sizeof(unsigned short));
+	}
+	entry->chain = cache.buckets[hash & cache.bucketMask];
+	cache.buckets[hash & cache.bucketMask] = index;
+	lruPushFront (index);
+}
+
+// Drops every cached search
+void
+RouteCache_clear ()
+{
+	long index;
+
+	for (index = 0; index < cache.count; index++) {
+		free(cache.entries[index].coords);
+	}
+	free(cache.entries);
+	free(cache.buckets);
+	cache.entries = NULL;
+	cache.buckets = NULL;
+	cache.count = 0;
+	cache.head = NO_ENTRY;
+	cache.tail = NO_ENTRY;
+}
+
+// Sets the maximum number of cached searches, 0 disables the cache. The cached searches are dropped.
+void
+RouteCache_setCapacity (long capacity)
+{
+	RouteCache_clear ();
+	cache.capacity = (capacity > 0) ? capacity : 0;
+}
+
+long
+RouteCache_capacity ()
+{
+	return cache.capacity;
+}
+
+long
+RouteCache_count ()
+{
+	return cache.count;
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
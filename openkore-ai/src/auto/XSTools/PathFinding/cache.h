@@ -0,0 +1,65 @@
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+#include "algorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// A process wide LRU cache of search results, so searches repeated with the same field, start, goal and options
+// cost a hash table lookup. The key holds a digest of the custom weights, so a search with a changed overlay never
+// gets the path of the old one. Only used from the main thread, never by the worker threads.
+
+// Search parameters which decide the path found by a CalcPath_session search
+typedef struct {
+	// Digest of the caller given field key and of the custom weights overlay
+	unsigned long long field;
+	unsigned long long customWeights;
+	// Danger layer of the search and its version, 0 for none
+	unsigned long dangerId;
+	unsigned long dangerVersion;
+	// Same for the obstacle layer given as secondWeightMap
+	unsigned long obstaclesId;
+	unsigned long obstaclesVersion;
+
+	int width;
+	int height;
+	int startX;
+	int startY;
+	int endX;
+	int endY;
+	// Search area given to reset and the first margin of its adaptive window
+	int min_x;
+	int max_x;
+	int min_y;
+	int max_y;
+	int window;
+
+	unsigned short avoidWalls;
+	unsigned short useManhattan;
+	int algorithm;
+	int openListType;
+} RouteCache_key;
+
+#define ROUTE_CACHE_DEFAULT_CAPACITY 64
+
+void RouteCache_keyFromSession (CalcPath_session *session, unsigned long long field, RouteCache_key *key);
+
+int RouteCache_lookup (const RouteCache_key *key, const unsigned short **coords, long *length);
+
+void RouteCache_store (const RouteCache_key *key, int status, const unsigned short *coords, long length);
+
+void RouteCache_setCapacity (long capacity);
+
+long RouteCache_capacity ();
+
+long RouteCache_count ();
+
+void RouteCache_clear ();
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _CACHE_H_ */
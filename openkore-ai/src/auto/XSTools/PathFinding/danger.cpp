@@ -0,0 +1,153 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "danger.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+static unsigned long lastId = 0;
+
+DangerMap *
+Danger_new (int width, int height)
+{
+	DangerMap *map = (DangerMap *) malloc(sizeof(DangerMap));
+
+	map->width = width;
+	map->height = height;
+	map->weights = (unsigned int *) calloc((size_t) width * height, sizeof(unsigned int));
+	map->id = ++lastId;
+	map->version = 0;
+	map->stamps = 0;
+	return map;
+}
+
+// Adds or takes out the kernel centered on x, y. The kernel only depends on its arguments, cells out of the map are skipped.
+static void
+apply (DangerMap *map, int x, int y, int radius, unsigned int weight, int add)
+{
+	int min_x = (x - radius < 0) ? 0 : x - radius;
+	int max_x = (x + radius >= map->width) ? map->width - 1 : x + radius;
+	int min_y = (y - radius < 0) ? 0 : y - radius;
+	int max_y = (y + radius >= map->height) ? map->height - 1 : y + radius;
+	long outer = (long) (radius + 1) * (radius + 1);
+	int cell_x;
+	int cell_y;
+
+	for (cell_y = min_y; cell_y <= max_y; cell_y++) {
+		unsigned int *row = &map->weights[(size_t) cell_y * map->width];
+		long dy = cell_y - y;
+
+		for (cell_x = min_x; cell_x <= max_x; cell_x++) {
+			long dx = cell_x - x;
+			long distance = dx * dx + dy * dy;
+			unsigned int value;
+
+			if (distance >= outer) {
+				continue;
+			}
+			// 1 - d^2 / (radius + 1)^2 of the weight, which keeps the kernel in integers
+			value = (unsigned int) (((unsigned long long) weight * (outer - distance)) / outer);
+			if (add) {
+				row[cell_x] += value;
+			} else {
+				row[cell_x] -= value;
+			}
+		}
+	}
+	map->version++;
+}
+
+void
+Danger_stamp (DangerMap *map, int x, int y, int radius, unsigned int weight)
+{
+	apply (map, x, y, radius, weight, 1);
+	map->stamps++;
+}
+
+void
+Danger_unstamp (DangerMap *map, int x, int y, int radius, unsigned int weight)
+{
+	apply (map, x, y, radius, weight, 0);
+	map->stamps--;
+}
+
+// Adds or takes out the inverse square kernel centered on x, y. The octile distance is the one of
+// Utils::adjustedBlockDistance, so the weights are the same as those which NewAStarAvoid computed in Perl.
+static void
+applyInverseSquare (DangerMap *map, int x, int y, int radius, unsigned int ratio, unsigned int limit, int add)
+{
+	int min_x = (x - radius < 0) ? 0 : x - radius;
+	int max_x = (x + radius >= map->width) ? map->width - 1 : x + radius;
+	int min_y = (y - radius < 0) ? 0 : y - radius;
+	int max_y = (y + radius >= map->height) ? map->height - 1 : y + radius;
+	int cell_x;
+	int cell_y;
+
+	for (cell_y = min_y; cell_y <= max_y; cell_y++) {
+		unsigned int *row = &map->weights[(size_t) cell_y * map->width];
+		int dy = abs(cell_y - y);
+
+		for (cell_x = min_x; cell_x <= max_x; cell_x++) {
+			int dx = abs(cell_x - x);
+			double distance = dx + dy - (2 - sqrt(2.0)) * (dx < dy ? dx : dy);
+			double value;
+			unsigned int weight;
+
+			if (distance < 1) {
+				distance = 1;
+			}
+			value = ratio / (distance * distance);
+			weight = (value >= limit) ? limit : (unsigned int) value;
+			if (add) {
+				row[cell_x] += weight;
+			} else {
+				row[cell_x] -= weight;
+			}
+		}
+	}
+	map->version++;
+}
+
+void
+Danger_stampInverseSquare (DangerMap *map, int x, int y, int radius, unsigned int ratio, unsigned int limit)
+{
+	applyInverseSquare (map, x, y, radius, ratio, limit, 1);
+	map->stamps++;
+}
+
+void
+Danger_unstampInverseSquare (DangerMap *map, int x, int y, int radius, unsigned int ratio, unsigned int limit)
+{
+	applyInverseSquare (map, x, y, radius, ratio, limit, 0);
+	map->stamps--;
+}
+
+unsigned int
+Danger_at (const DangerMap *map, int x, int y)
+{
+	if (x < 0 || x >= map->width || y < 0 || y >= map->height) {
+		return 0;
+	}
+	return map->weights[(size_t) y * map->width + x];
+}
+
+void
+Danger_clear (DangerMap *map)
+{
+	memset(map->weights, 0, (size_t) map->width * map->height * sizeof(unsigned int));
+	map->stamps = 0;
+	map->version++;
+}
+
+void
+Danger_destroy (DangerMap *map)
+{
+	free(map->weights);
+	free(map);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
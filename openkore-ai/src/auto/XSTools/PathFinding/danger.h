@@ -0,0 +1,49 @@
+#ifndef _DANGER_H_
+#define _DANGER_H_
+
+#include "algorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Danger layer of a field: an extra weight for every cell, added to the cost of stepping on it by the searches reset
+// with the layer. Every dangerous actor stamps a radial kernel around its position, the weight falling linearly from
+// 'weight' on its cell to nothing past 'radius' cells. Unstamping the same kernel takes it back out exactly, so the
+// layer follows the actors as they move without being rebuilt.
+// Obstacles stamp an inverse square kernel instead: 'ratio' / d^2 up to 'limit' on the cells at an octile distance d
+// of at most 'radius' cells, the weight of the cells at a distance below 1 being that of 1.
+
+struct DangerMap {
+	int width;
+	int height;
+	unsigned int *weights;
+	// Unique for every layer ever created, with version it tells the route cache whether the layer changed since a search
+	unsigned long id;
+	// Incremented on every change of the weights
+	unsigned long version;
+	// Number of kernels stamped and not unstamped yet
+	long stamps;
+};
+
+DangerMap *Danger_new (int width, int height);
+
+void Danger_stamp (DangerMap *map, int x, int y, int radius, unsigned int weight);
+
+void Danger_unstamp (DangerMap *map, int x, int y, int radius, unsigned int weight);
+
+void Danger_stampInverseSquare (DangerMap *map, int x, int y, int radius, unsigned int ratio, unsigned int limit);
+
+void Danger_unstampInverseSquare (DangerMap *map, int x, int y, int radius, unsigned int ratio, unsigned int limit);
+
+unsigned int Danger_at (const DangerMap *map, int x, int y);
+
+void Danger_clear (DangerMap *map);
+
+void Danger_destroy (DangerMap *map);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _DANGER_H_ */
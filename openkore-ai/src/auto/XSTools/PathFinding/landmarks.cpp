@@ -0,0 +1,189 @@
+#include <stdlib.h>
+#include <string.h>
+#include "landmarks.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define COST_NONE 0xFFFFFFFF
+
+// Binary heap of the Dijkstra searches, each entry holds the cost of a cell in its upper 32 bits and its adress in the lower ones,
+// cells are pushed again when their cost improves and the stale entries are skipped
+typedef struct {
+	unsigned long long *entries;
+	long size;
+	long capacity;
+} LandmarkHeap;
+
+static void
+heapPush (LandmarkHeap *heap, unsigned int cost, unsigned int adress)
+{
+	unsigned long long entry = ((unsigned long long) cost << 32) | adress;
+	long index;
+
+	if (heap->size == heap->capacity) {
+		heap->capacity = (heap->capacity > 0) ? heap->capacity * 2 : 1024;
+		heap->entries = (unsigned long long *) realloc (heap->entries, heap->capacity * sizeof(unsigned long long));
+	}
+	index = heap->size++;
+	while (index > 0) {
+		long parent = (index - 1) / 2;
+		if (heap->entries[parent] <= entry) {
+			break;
+		}
+		heap->entries[index] = heap->entries[parent];
+		index = parent;
+	}
+	heap->entries[index] = entry;
+}
+
+static unsigned long long
+heapPop (LandmarkHeap *heap)
+{
+	unsigned long long top = heap->entries[0];
+	unsigned long long last = heap->entries[--heap->size];
+	long index = 0;
+
+	while (1) {
+		long child = index * 2 + 1;
+		if (child >= heap->size) {
+			break;
+		}
+		if (child + 1 < heap->size && heap->entries[child + 1] < heap->entries[child]) {
+			child++;
+		}
+		if (last <= heap->entries[child]) {
+			break;
+		}
+		heap->entries[index] = heap->entries[child];
+		index = child;
+	}
+	if (heap->size > 0) {
+		heap->entries[index] = last;
+	}
+	return top;
+}
+
+// Dijkstra search from 'source' with the 10 and 14 step costs, leaves the cost of every cell in 'costs', COST_NONE for the ones it can't reach
+static void
+landmarkCosts (const unsigned char *mask, int width, int height, unsigned int source, unsigned int *costs, LandmarkHeap *heap)
+{
+	// Same directions as the neighbor mask bits, see CalcPath_neighborMaskAt
+	static const short i_x[8] = {0, 0, 1, -1, 1, 1, -1, -1};
+	static const short i_y[8] = {1, -1, 0, 0, 1, -1, -1, 1};
+	unsigned long size = (unsigned long) width * height;
+	unsigned long i;
+
+	for (i = 0; i < size; i++) {
+		costs[i] = COST_NONE;
+	}
+	costs[source] = 0;
+	heap->size = 0;
+	heapPush (heap, 0, source);
+
+	while (heap->size > 0) {
+		unsigned long long entry = heapPop (heap);
+		unsigned int cost = (unsigned int) (entry >> 32);
+		unsigned int adress = (unsigned int) entry;
+		unsigned int neighbors = mask[adress];
+		int x = adress % width;
+		int y = adress / width;
+		int direction;
+
+		if (cost != costs[adress]) {
+			continue;
+		}
+		for (direction = 0; direction < 8; direction++) {
+			if (neighbors & (1 << direction)) {
+				unsigned int neighbor = (y + i_y[direction]) * width + x + i_x[direction];
+				unsigned int neighborCost = cost + ((direction >= 4) ? 14 : 10);
+				if (neighborCost < costs[neighbor]) {
+					costs[neighbor] = neighborCost;
+					heapPush (heap, neighborCost, neighbor);
+				}
+			}
+		}
+	}
+}
+
+int
+Landmarks_build (const char *weight_map, int width, int height, int count, unsigned short *tables)
+{
+	unsigned long size = (unsigned long) width * height;
+	unsigned char *mask;
+	unsigned int *costs;
+	unsigned int *nearest;
+	LandmarkHeap heap = {NULL, 0, 0};
+	unsigned long adress;
+	unsigned long source = size;
+	unsigned long closest = 0;
+	int placed = 0;
+
+	if (count > CALCPATH_MAX_LANDMARKS) {
+		count = CALCPATH_MAX_LANDMARKS;
+	}
+	for (adress = 0; adress < size * count; adress++) {
+		tables[adress] = LANDMARK_UNREACHABLE;
+	}
+
+	// The landmarks are spread over the area of the walkable cell closest to the middle of the map
+	for (adress = 0; adress < size; adress++) {
+		if (weight_map[adress] != -1) {
+			long dx = (long) (adress % width) - width / 2;
+			long dy = (long) (adress / width) - height / 2;
+			unsigned long distance = (unsigned long) (dx * dx + dy * dy);
+			if (source == size || distance < closest) {
+				source = adress;
+				closest = distance;
+			}
+		}
+	}
+	if (source == size || count <= 0) {
+		return 0;
+	}
+
+	mask = (unsigned char *) malloc (size);
+	costs = (unsigned int *) malloc (size * sizeof(unsigned int));
+	nearest = (unsigned int *) malloc (size * sizeof(unsigned int));
+	CalcPath_buildNeighborMask (weight_map, width, height, mask);
+
+	// The first landmark is the cell farthest from the middle one, then each one is the cell farthest from the closest landmark placed
+	landmarkCosts (mask, width, height, (unsigned int) source, nearest, &heap);
+	while (placed < count) {
+		unsigned int farthest = 0;
+		unsigned long landmark = source;
+
+		for (adress = 0; adress < size; adress++) {
+			if (nearest[adress] != COST_NONE && nearest[adress] > farthest) {
+				farthest = nearest[adress];
+				landmark = adress;
+			}
+		}
+		// Every cell of the area already is a landmark
+		if (farthest == 0 && placed > 0) {
+			break;
+		}
+
+		landmarkCosts (mask, width, height, (unsigned int) landmark, costs, &heap);
+		for (adress = 0; adress < size; adress++) {
+			if (costs[adress] != COST_NONE) {
+				tables[adress * count + placed] = (costs[adress] < LANDMARK_FAR) ? (unsigned short) costs[adress] : LANDMARK_FAR;
+				if (placed == 0 || costs[adress] < nearest[adress]) {
+					nearest[adress] = costs[adress];
+				}
+			}
+		}
+		placed++;
+	}
+
+	free (mask);
+	free (costs);
+	free (nearest);
+	free (heap.entries);
+	return placed;
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
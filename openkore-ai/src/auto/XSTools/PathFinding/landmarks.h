@@ -0,0 +1,34 @@
+#ifndef _LANDMARKS_H_
+#define _LANDMARKS_H_
+
+#include "algorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Landmark distance tables of a field, for the ALT (A*, landmarks and triangle inequality) heuristic. A few landmarks
+// are spread over the field, and the cost of walking from each of them to every cell is stored, with the 10 and 14
+// step costs of the searches and no extra weight. The cost of going from a cell to the goal is then at least the
+// difference of their costs from any landmark, which is much closer to the real cost than the diagonal distance
+// when walls are in the way, and the extra weights of a search only make the real cost higher.
+//
+// The tables are stored cell by cell: the costs of the landmarks from the cell at adress y * width + x are the
+// 'count' values starting at (y * width + x) * count.
+
+// Cost of the cells a landmark can't reach
+#define LANDMARK_UNREACHABLE 0xFFFF
+// Cost of the cells too far from a landmark for the cost to fit, the landmark tells nothing about them
+#define LANDMARK_FAR 0xFFFE
+
+// Spreads up to 'count' (at most CALCPATH_MAX_LANDMARKS) landmarks over the walkable area which holds the cell closest
+// to the middle of the map, each one as far as possible from the ones before, and stores their costs in 'tables',
+// which holds width * height * count values. Returns the number of landmarks placed, the costs of the missing ones
+// are LANDMARK_UNREACHABLE.
+int Landmarks_build (const char *weight_map, int width, int height, int count, unsigned short *tables);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _LANDMARKS_H_ */
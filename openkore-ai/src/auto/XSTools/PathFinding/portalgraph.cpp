@@ -0,0 +1,221 @@
+#include <stdlib.h>
+#include <string.h>
+#include "portalgraph.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Makes room for one more element at the end of an array which grows by doubling
+static void *
+grow (void *array, long count, long *capacity, size_t size)
+{
+	if (count < *capacity) {
+		return array;
+	}
+	*capacity = (*capacity > 0) ? *capacity * 2 : 64;
+	return realloc (array, *capacity * size);
+}
+
+static inline int
+heapLess (const PortalGraph_heapEntry *a, const PortalGraph_heapEntry *b)
+{
+	return a->walk < b->walk || (a->walk == b->walk && a->order < b->order);
+}
+
+static void
+heapPush (PortalGraph *graph, long node, double walk)
+{
+	long index;
+
+	graph->heap = (PortalGraph_heapEntry *) grow (graph->heap, graph->heapSize, &graph->heapCapacity, sizeof(PortalGraph_heapEntry));
+	index = graph->heapSize++;
+	graph->heap[index].walk = walk;
+	graph->heap[index].node = node;
+	graph->heap[index].order = graph->order++;
+
+	while (index > 0) {
+		long parent = (index - 1) / 2;
+		PortalGraph_heapEntry entry;
+		if (!heapLess (&graph->heap[index], &graph->heap[parent])) {
+			break;
+		}
+		entry = graph->heap[parent];
+		graph->heap[parent] = graph->heap[index];
+		graph->heap[index] = entry;
+		index = parent;
+	}
+}
+
+static PortalGraph_heapEntry
+heapPop (PortalGraph *graph)
+{
+	PortalGraph_heapEntry top = graph->heap[0];
+	long index = 0;
+
+	graph->heap[0] = graph->heap[--graph->heapSize];
+	while (1) {
+		long smallest = index;
+		long left = index * 2 + 1;
+		long right = left + 1;
+		PortalGraph_heapEntry entry;
+
+		if (left < graph->heapSize && heapLess (&graph->heap[left], &graph->heap[smallest])) {
+			smallest = left;
+		}
+		if (right < graph->heapSize && heapLess (&graph->heap[right], &graph->heap[smallest])) {
+			smallest = right;
+		}
+		if (smallest == index) {
+			break;
+		}
+		entry = graph->heap[smallest];
+		graph->heap[smallest] = graph->heap[index];
+		graph->heap[index] = entry;
+		index = smallest;
+	}
+	return top;
+}
+
+// Takes the edge from the closed link 'from', the same way as the search of Task::CalcMapRoute did
+static void
+relax (PortalGraph *graph, const PortalGraph_node *from, const PortalGraph_edge *edge)
+{
+	PortalGraph_node *node = &graph->nodes[edge->node];
+	double walk = from->walk + edge->walk;
+
+	if (node->state == PORTALGRAPH_CLOSED || (node->state == PORTALGRAPH_OPEN && node->walk <= walk)) {
+		return;
+	}
+	if (node->state == PORTALGRAPH_NONE) {
+		node->zenyCovered = 0;
+		node->ticketsUsed = 0;
+		node->flags = 0;
+	}
+
+	node->state = PORTALGRAPH_OPEN;
+	node->parent = from - graph->nodes;
+	node->walk = walk;
+	if (edge->flags & PORTALGRAPH_AIRSHIP) {
+		node->zeny = from->zeny;
+		node->flags |= PORTALGRAPH_AIRSHIP;
+	} else {
+		node->zeny = from->zeny + edge->zeny;
+		node->flags = (node->flags & ~PORTALGRAPH_ALLOW_TICKET) | (edge->flags & PORTALGRAPH_ALLOW_TICKET);
+		// The ticket count compared is the one of the route this one replaces
+		if ((edge->flags & PORTALGRAPH_ALLOW_TICKET) && graph->tickets > node->ticketsUsed) {
+			node->zenyCovered = from->zenyCovered + node->zeny;
+			node->ticketsUsed = from->ticketsUsed + 1;
+		} else {
+			node->zenyCovered = from->zenyCovered;
+			node->ticketsUsed = from->ticketsUsed;
+		}
+	}
+	heapPush (graph, edge->node, walk);
+}
+
+PortalGraph *
+PortalGraph_new (int hasBudget, double budget, long tickets)
+{
+	PortalGraph *graph = (PortalGraph *) calloc (1, sizeof(PortalGraph));
+	graph->hasBudget = hasBudget;
+	graph->budget = budget;
+	graph->tickets = tickets;
+	return graph;
+}
+
+long
+PortalGraph_addSpawn (PortalGraph *graph)
+{
+	graph->firstEdge = (long *) grow (graph->firstEdge, graph->spawnCount, &graph->spawnCapacity, sizeof(long));
+	graph->firstEdge[graph->spawnCount] = -1;
+	return graph->spawnCount++;
+}
+
+long
+PortalGraph_addNode (PortalGraph *graph, long spawn)
+{
+	PortalGraph_node *node;
+
+	graph->nodes = (PortalGraph_node *) grow (graph->nodes, graph->nodeCount, &graph->nodeCapacity, sizeof(PortalGraph_node));
+	node = &graph->nodes[graph->nodeCount];
+	memset (node, 0, sizeof(PortalGraph_node));
+	node->spawn = spawn;
+	node->state = PORTALGRAPH_NONE;
+	node->parent = -1;
+	return graph->nodeCount++;
+}
+
+void
+PortalGraph_addEdge (PortalGraph *graph, long spawn, long node, double walk, double zeny, unsigned char flags)
+{
+	PortalGraph_edge *edge;
+
+	graph->edges = (PortalGraph_edge *) grow (graph->edges, graph->edgeCount, &graph->edgeCapacity, sizeof(PortalGraph_edge));
+	edge = &graph->edges[graph->edgeCount];
+	edge->node = node;
+	edge->walk = walk;
+	edge->zeny = zeny;
+	edge->flags = flags;
+	edge->next = graph->firstEdge[spawn];
+	graph->firstEdge[spawn] = graph->edgeCount++;
+}
+
+void
+PortalGraph_open (PortalGraph *graph, long node, double walk, double zeny, double zenyCovered, long ticketsUsed, unsigned char flags)
+{
+	PortalGraph_node *entry = &graph->nodes[node];
+
+	entry->state = PORTALGRAPH_OPEN;
+	entry->walk = walk;
+	entry->zeny = zeny;
+	entry->zenyCovered = zenyCovered;
+	entry->ticketsUsed = ticketsUsed;
+	entry->flags = flags;
+	entry->parent = -1;
+	heapPush (graph, node, walk);
+}
+
+// Closes the open link with the lowest walk weight, opens the links reachable from it and returns it, or -1 if no
+// link is left open. Links over the budget are dropped, with no route to them, until a cheaper one opens them again.
+long
+PortalGraph_next (PortalGraph *graph)
+{
+	while (graph->heapSize > 0) {
+		PortalGraph_heapEntry top = heapPop (graph);
+		PortalGraph_node *node = &graph->nodes[top.node];
+		long edge;
+
+		if (node->state != PORTALGRAPH_OPEN || node->walk != top.walk) {
+			continue;
+		}
+		if (graph->hasBudget && graph->budget < node->zeny - node->zenyCovered) {
+			node->state = PORTALGRAPH_NONE;
+			continue;
+		}
+
+		node->state = PORTALGRAPH_CLOSED;
+		graph->expanded++;
+		if (node->spawn >= 0) {
+			for (edge = graph->firstEdge[node->spawn]; edge >= 0; edge = graph->edges[edge].next) {
+				relax (graph, node, &graph->edges[edge]);
+			}
+		}
+		return top.node;
+	}
+	return -1;
+}
+
+void
+PortalGraph_destroy (PortalGraph *graph)
+{
+	free (graph->nodes);
+	free (graph->edges);
+	free (graph->firstEdge);
+	free (graph->heap);
+	free (graph);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,100 @@
+#ifndef _PORTALGRAPH_H_
+#define _PORTALGRAPH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Route search between maps, a Dijkstra search over the links of the portal tables (a portal and one of its
+// destinations). Spawns are the cells the links lead to, and the edges leaving a spawn are the links reachable from it
+// with their walking distance, as found in portalsLOS.txt. It finds the same routes as the search of Task::CalcMapRoute
+// did in Perl, including the zeny budget and the use of warp tickets.
+
+#define PORTALGRAPH_ALLOW_TICKET 1
+#define PORTALGRAPH_AIRSHIP 2
+
+#define PORTALGRAPH_NONE 0
+#define PORTALGRAPH_OPEN 1
+#define PORTALGRAPH_CLOSED 2
+
+typedef struct {
+	long node;
+	// Weight of taking the edge: map and portal weights plus the walking distance
+	double walk;
+	// Cost of the link in zeny, the zeny of airships is the one of the link leading to them
+	double zeny;
+	unsigned char flags;
+	// Next edge leaving from the same spawn, -1 for the last one
+	long next;
+} PortalGraph_edge;
+
+typedef struct {
+	// Spawn the link leads to, -1 if no edge leaves from it
+	long spawn;
+	unsigned char state;
+
+	// Best route to the link found so far, final once it's closed
+	double walk;
+	double zeny;
+	double zenyCovered;
+	long ticketsUsed;
+	unsigned char flags;
+	// Link the route comes from, -1 for the links the search starts from
+	long parent;
+} PortalGraph_node;
+
+typedef struct {
+	double walk;
+	long node;
+	// Order in which entries were pushed, so links with the same weight are taken first come first served
+	unsigned long order;
+} PortalGraph_heapEntry;
+
+typedef struct {
+	PortalGraph_node *nodes;
+	long nodeCount;
+	long nodeCapacity;
+
+	PortalGraph_edge *edges;
+	long edgeCount;
+	long edgeCapacity;
+
+	// First edge leaving from every spawn, -1 for none
+	long *firstEdge;
+	long spawnCount;
+	long spawnCapacity;
+
+	// Open list, a binary heap which may hold entries of links which were improved or closed since, they're skipped
+	PortalGraph_heapEntry *heap;
+	long heapSize;
+	long heapCapacity;
+	unsigned long order;
+
+	// Routes costing more zeny than the budget, less what tickets cover, are dropped; budget is ignored if hasBudget is 0
+	int hasBudget;
+	double budget;
+	long tickets;
+
+	// Number of links closed so far
+	unsigned long expanded;
+} PortalGraph;
+
+PortalGraph *PortalGraph_new (int hasBudget, double budget, long tickets);
+
+long PortalGraph_addSpawn (PortalGraph *graph);
+
+long PortalGraph_addNode (PortalGraph *graph, long spawn);
+
+void PortalGraph_addEdge (PortalGraph *graph, long spawn, long node, double walk, double zeny, unsigned char flags);
+
+void PortalGraph_open (PortalGraph *graph, long node, double walk, double zeny, double zenyCovered, long ticketsUsed, unsigned char flags);
+
+long PortalGraph_next (PortalGraph *graph);
+
+void PortalGraph_destroy (PortalGraph *graph);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _PORTALGRAPH_H_ */
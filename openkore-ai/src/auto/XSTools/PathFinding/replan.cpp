@@ -0,0 +1,407 @@
+#include <stdlib.h>
+#include <string.h>
+#include "algorithm.h"
+#include "replan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define REPLAN_INFINITY 0xFFFFFFFF
+#define REPLAN_NOT_OPEN 0xFFFFFFFF
+
+// All possible directions the character can move, in the same order as the neighbor mask bits (north, south, east, west, northeast, southeast, southwest, northwest)
+static const short i_x[8] = {0, 0, 1, -1, 1, 1, -1, -1};
+static const short i_y[8] = {1, -1, 0, 0, 1, -1, -1, 1};
+
+// Sum of two costs which stays infinite if either of them is
+static inline unsigned int
+addCost (unsigned int a, unsigned int b)
+{
+	unsigned long long sum = (unsigned long long) a + b;
+	return (a == REPLAN_INFINITY || b == REPLAN_INFINITY || sum >= REPLAN_INFINITY) ? REPLAN_INFINITY : (unsigned int) sum;
+}
+
+// Cost of moving from a neighbor into 'toAdress' in direction i without its extra weight, the same as the one used by the A* search
+static inline unsigned int
+baseMoveCost (Replan_session *session, unsigned int toAdress, int i)
+{
+	unsigned long cost = (i >= 4) ? 14 : 10;
+	if (session->avoidWalls) {
+		cost += session->map_base_weight[toAdress];
+	}
+	return (unsigned int) cost;
+}
+
+static inline unsigned int
+moveCost (Replan_session *session, unsigned int toAdress, int i)
+{
+	return addCost(baseMoveCost(session, toAdress, i), session->weights[toAdress]);
+}
+
+// Keys are compared first by min(g, rhs) plus the heuristic to the start and then by min(g, rhs), both are packed in a single number
+static inline unsigned long long
+calculateKey (Replan_session *session, unsigned int adress)
+{
+	unsigned int m = (session->g[adress] < session->rhs[adress]) ? session->g[adress] : session->rhs[adress];
+	unsigned int h = heuristic_cost_estimate(adress % session->width, adress / session->width, session->startX, session->startY, 0);
+	return ((unsigned long long) addCost(addCost(m, h), session->km) << 32) | m;
+}
+
+/*******************************************/
+
+static inline void
+heapSet (Replan_session *session, long index, unsigned long long key, unsigned int adress)
+{
+	session->heapKey[index] = key;
+	session->heapAdress[index] = adress;
+	session->heapIndex[adress] = index;
+}
+
+static void
+heapSiftUp (Replan_session *session, long index)
+{
+	unsigned long long key = session->heapKey[index];
+	unsigned int adress = session->heapAdress[index];
+
+	while (index > 0 && session->heapKey[(index - 1) / 2] > key) {
+		heapSet (session, index, session->heapKey[(index - 1) / 2], session->heapAdress[(index - 1) / 2]);
+		index = (index - 1) / 2;
+	}
+	heapSet (session, index, key, adress);
+}
+
+static void
+heapSiftDown (Replan_session *session, long index)
+{
+	unsigned long long key = session->heapKey[index];
+	unsigned int adress = session->heapAdress[index];
+	long child;
+
+	while ((child = 2 * index + 1) < session->heapSize) {
+		if (child + 1 < session->heapSize && session->heapKey[child + 1] < session->heapKey[child]) {
+			child++;
+		}
+		if (key <= session->heapKey[child]) {
+			break;
+		}
+		heapSet (session, index, session->heapKey[child], session->heapAdress[child]);
+		index = child;
+	}
+	heapSet (session, index, key, adress);
+}
+
+static void
+heapRemove (Replan_session *session, unsigned int adress)
+{
+	long index = session->heapIndex[adress];
+	session->heapIndex[adress] = REPLAN_NOT_OPEN;
+	session->heapSize--;
+	if (index == session->heapSize) {
+		return;
+	}
+
+	// The last node takes the place of the removed one and moves up or down from there
+	heapSet (session, index, session->heapKey[session->heapSize], session->heapAdress[session->heapSize]);
+	if (index > 0 && session->heapKey[index] < session->heapKey[(index - 1) / 2]) {
+		heapSiftUp (session, index);
+	} else {
+		heapSiftDown (session, index);
+	}
+}
+
+// Inserts 'adress' in the open list or moves it to the position of its new key
+static void
+heapPush (Replan_session *session, unsigned int adress, unsigned long long key)
+{
+	long index;
+	if (session->heapIndex[adress] == REPLAN_NOT_OPEN) {
+		index = session->heapSize++;
+		heapSet (session, index, key, adress);
+		heapSiftUp (session, index);
+		return;
+	}
+
+	index = session->heapIndex[adress];
+	if (key < session->heapKey[index]) {
+		session->heapKey[index] = key;
+		heapSiftUp (session, index);
+	} else {
+		session->heapKey[index] = key;
+		heapSiftDown (session, index);
+	}
+}
+
+/*******************************************/
+
+// rhs of a node given the current g of its neighbors, the goal always has rhs 0
+static unsigned int
+computeRhs (Replan_session *session, unsigned int adress)
+{
+	if (adress == (unsigned int) (session->goalY * session->width + session->goalX)) {
+		return 0;
+	}
+
+	unsigned int neighbors = session->neighbor_mask[adress];
+	unsigned int best = REPLAN_INFINITY;
+	unsigned int cost;
+	unsigned int neighborAdress;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		if (!(neighbors & (1 << i))) {
+			continue;
+		}
+		neighborAdress = adress + (i_y[i] * session->width) + i_x[i];
+		cost = addCost(moveCost(session, neighborAdress, i), session->g[neighborAdress]);
+		if (cost < best) {
+			best = cost;
+		}
+	}
+	return best;
+}
+
+// Puts an inconsistent node in the open list with its current key and takes consistent nodes out of it
+static void
+updateVertex (Replan_session *session, unsigned int adress)
+{
+	if (session->g[adress] != session->rhs[adress]) {
+		heapPush (session, adress, calculateKey(session, adress));
+	} else if (session->heapIndex[adress] != REPLAN_NOT_OPEN) {
+		heapRemove (session, adress);
+	}
+}
+
+/*******************************************/
+
+// Creates a replanning session for a search from (startX, startY) to (goalX, goalY) on a copy of 'weight_map'.
+// Run Replan_computePath to find the first path. Both cells must be walkable.
+Replan_session *
+Replan_new (const char *weight_map, int width, int height, bool avoidWalls, int startX, int startY, int goalX, int goalY)
+{
+	Replan_session *session;
+	unsigned long size = (unsigned long) width * height;
+	unsigned long i;
+
+	session = (Replan_session*) malloc (sizeof (Replan_session));
+	session->map_base_weight = (char*) malloc(size);
+	memcpy(session->map_base_weight, weight_map, size);
+	session->neighbor_mask = (unsigned char*) malloc(size);
+	CalcPath_buildNeighborMask (session->map_base_weight, width, height, session->neighbor_mask);
+	session->avoidWalls = avoidWalls;
+	session->width = width;
+	session->height = height;
+	session->startX = session->lastX = startX;
+	session->startY = session->lastY = startY;
+	session->goalX = goalX;
+	session->goalY = goalY;
+	session->km = 0;
+	session->expanded = 0;
+
+	session->weights = (unsigned int*) calloc(size, sizeof(unsigned int));
+	session->g = (unsigned int*) malloc(size * sizeof(unsigned int));
+	session->rhs = (unsigned int*) malloc(size * sizeof(unsigned int));
+	session->heapKey = (unsigned long long*) malloc(size * sizeof(unsigned long long));
+	session->heapAdress = (unsigned int*) malloc(size * sizeof(unsigned int));
+	session->heapIndex = (unsigned int*) malloc(size * sizeof(unsigned int));
+	session->heapSize = 0;
+	for (i = 0; i < size; i++) {
+		session->g[i] = REPLAN_INFINITY;
+		session->rhs[i] = REPLAN_INFINITY;
+		session->heapIndex[i] = REPLAN_NOT_OPEN;
+	}
+
+	// The search starts from the goal
+	unsigned int goalAdress = (goalY * width) + goalX;
+	session->rhs[goalAdress] = 0;
+	heapPush (session, goalAdress, calculateKey(session, goalAdress));
+	return session;
+}
+
+// Changes the extra weight of cell (x, y), only the neighbors whose path goes through it are updated.
+// The path is repaired by the next Replan_computePath call.
+void
+Replan_setWeight (Replan_session *session, int x, int y, unsigned int weight)
+{
+	unsigned int adress = (y * session->width) + x;
+	unsigned int goalAdress = (session->goalY * session->width) + session->goalX;
+	unsigned int oldWeight = session->weights[adress];
+	unsigned int neighbors = session->neighbor_mask[adress];
+	unsigned int neighborAdress;
+	unsigned int oldCost;
+	unsigned int newCost;
+	int i;
+
+	if (oldWeight == weight || session->map_base_weight[adress] == -1) {
+		return;
+	}
+	session->weights[adress] = weight;
+
+	// Only the moves into the cell change their cost, those come from its walkable neighbors in the opposite direction
+	for (i = 0; i < 8; i++) {
+		if (!(neighbors & (1 << i))) {
+			continue;
+		}
+		neighborAdress = adress + (i_y[i] * session->width) + i_x[i];
+		if (neighborAdress == goalAdress) {
+			continue;
+		}
+
+		newCost = addCost(addCost(baseMoveCost(session, adress, i), weight), session->g[adress]);
+		oldCost = addCost(addCost(baseMoveCost(session, adress, i), oldWeight), session->g[adress]);
+		if (weight < oldWeight) {
+			if (newCost < session->rhs[neighborAdress]) {
+				session->rhs[neighborAdress] = newCost;
+			}
+		} else if (session->rhs[neighborAdress] == oldCost) {
+			session->rhs[neighborAdress] = computeRhs (session, neighborAdress);
+		}
+		updateVertex (session, neighborAdress);
+	}
+}
+
+// Moves the start of the search, usually to the next cell of the path once the character walked to it
+void
+Replan_moveStart (Replan_session *session, int x, int y)
+{
+	session->startX = x;
+	session->startY = y;
+}
+
+// Computes or repairs the shortest path from the start to the goal, only expanding the nodes made inconsistent by the changes since the last call.
+// Returns 1 if a path exists or -1 if not.
+int
+Replan_computePath (Replan_session *session)
+{
+	unsigned int startAdress = (session->startY * session->width) + session->startX;
+	unsigned int goalAdress = (session->goalY * session->width) + session->goalX;
+	unsigned int adress;
+	unsigned int neighborAdress;
+	unsigned int neighbors;
+	unsigned int oldG;
+	unsigned long long oldKey;
+	unsigned long long newKey;
+	int i;
+
+	// The keys in the open list were computed for the previous start, the heuristic from there to the new start keeps them comparable
+	if (session->startX != session->lastX || session->startY != session->lastY) {
+		session->km = addCost(session->km, heuristic_cost_estimate(session->lastX, session->lastY, session->startX, session->startY, 0));
+		session->lastX = session->startX;
+		session->lastY = session->startY;
+	}
+
+	session->expanded = 0;
+	while (session->heapSize > 0 && (session->heapKey[0] < calculateKey(session, startAdress) || session->rhs[startAdress] > session->g[startAdress])) {
+		adress = session->heapAdress[0];
+		oldKey = session->heapKey[0];
+		newKey = calculateKey(session, adress);
+		session->expanded++;
+
+		if (oldKey < newKey) {
+			// The key is outdated by the start moving, put it back in its right place
+			heapPush (session, adress, newKey);
+			continue;
+		}
+
+		neighbors = session->neighbor_mask[adress];
+		if (session->g[adress] > session->rhs[adress]) {
+			// Overconsistent, the node got cheaper, its neighbors may now reach the goal through it
+			session->g[adress] = session->rhs[adress];
+			heapRemove (session, adress);
+			for (i = 0; i < 8; i++) {
+				if (!(neighbors & (1 << i))) {
+					continue;
+				}
+				neighborAdress = adress + (i_y[i] * session->width) + i_x[i];
+				if (neighborAdress != goalAdress && addCost(moveCost(session, adress, i), session->g[adress]) < session->rhs[neighborAdress]) {
+					session->rhs[neighborAdress] = addCost(moveCost(session, adress, i), session->g[adress]);
+				}
+				updateVertex (session, neighborAdress);
+			}
+		} else {
+			// Underconsistent, the node got more expensive, every neighbor which went through it has to look for another way
+			oldG = session->g[adress];
+			session->g[adress] = REPLAN_INFINITY;
+			for (i = 0; i < 8; i++) {
+				if (!(neighbors & (1 << i))) {
+					continue;
+				}
+				neighborAdress = adress + (i_y[i] * session->width) + i_x[i];
+				if (neighborAdress != goalAdress && session->rhs[neighborAdress] == addCost(moveCost(session, adress, i), oldG)) {
+					session->rhs[neighborAdress] = computeRhs (session, neighborAdress);
+				}
+				updateVertex (session, neighborAdress);
+			}
+			if (adress != goalAdress) {
+				session->rhs[adress] = computeRhs (session, adress);
+			}
+			updateVertex (session, adress);
+		}
+	}
+
+	return (session->rhs[startAdress] == REPLAN_INFINITY) ? -1 : 1;
+}
+
+// Stores the adresses of the cells of the path found by Replan_computePath in 'path', from the start to the goal.
+// Returns the number of cells in the path, or -1 if there is no path or it is longer than maxLength.
+long
+Replan_solution (Replan_session *session, unsigned int *path, long maxLength)
+{
+	unsigned int adress = (session->startY * session->width) + session->startX;
+	unsigned int goalAdress = (session->goalY * session->width) + session->goalX;
+	unsigned int neighbors;
+	unsigned int neighborAdress;
+	unsigned int best;
+	unsigned int bestAdress;
+	unsigned int cost;
+	long length = 0;
+	int i;
+
+	if (session->rhs[adress] == REPLAN_INFINITY || maxLength < 1) {
+		return -1;
+	}
+
+	path[length++] = adress;
+	while (adress != goalAdress) {
+		// The next cell is the neighbor with the cheapest way to the goal
+		neighbors = session->neighbor_mask[adress];
+		best = REPLAN_INFINITY;
+		bestAdress = adress;
+		for (i = 0; i < 8; i++) {
+			if (!(neighbors & (1 << i))) {
+				continue;
+			}
+			neighborAdress = adress + (i_y[i] * session->width) + i_x[i];
+			cost = addCost(moveCost(session, neighborAdress, i), session->g[neighborAdress]);
+			if (cost < best) {
+				best = cost;
+				bestAdress = neighborAdress;
+			}
+		}
+
+		if (best == REPLAN_INFINITY || length >= maxLength) {
+			return -1;
+		}
+		adress = bestAdress;
+		path[length++] = adress;
+	}
+	return length;
+}
+
+void
+Replan_destroy (Replan_session *session)
+{
+	free(session->map_base_weight);
+	free(session->neighbor_mask);
+	free(session->weights);
+	free(session->g);
+	free(session->rhs);
+	free(session->heapKey);
+	free(session->heapAdress);
+	free(session->heapIndex);
+	free(session);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,67 @@
+#ifndef _REPLAN_H_
+#define _REPLAN_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Incremental replanning with D* Lite (Koenig and Likhachev).
+// The search runs backwards from the goal, so when cell weights change or the start moves along the path only the
+// part of the previous search affected by the change is repaired, instead of searching the whole map again.
+// Moves and their costs are the same as in a CalcPath_session A* search with the same avoidWalls and custom weights.
+
+typedef struct {
+	// Copy of the field weight map, the session may outlive the Perl string it was created from
+	char *map_base_weight;
+	bool avoidWalls;
+
+	// Neighbors bitmask of every cell, as built by CalcPath_buildNeighborMask
+	unsigned char *neighbor_mask;
+
+	int width;
+	int height;
+
+	int startX;
+	int startY;
+	int goalX;
+	int goalY;
+
+	// Extra weight of every cell, the same as secondWeightMap in a CalcPath_session search
+	unsigned int *weights;
+
+	// g is the cost to the goal found by the last expansion of a node, rhs the one given by its current neighbors, a node is consistent when both are equal
+	unsigned int *g;
+	unsigned int *rhs;
+
+	// Open list of the inconsistent nodes, a binary heap of their keys, heapIndex is REPLAN_NOT_OPEN for nodes which are not in it
+	unsigned long long *heapKey;
+	unsigned int *heapAdress;
+	unsigned int *heapIndex;
+	long heapSize;
+
+	// Added to the keys every time the start moves, so the keys of the nodes already in the open list stay valid lower bounds
+	unsigned int km;
+	int lastX;
+	int lastY;
+
+	// Number of nodes expanded by the last Replan_computePath call
+	unsigned long expanded;
+} Replan_session;
+
+Replan_session *Replan_new (const char *weight_map, int width, int height, bool avoidWalls, int startX, int startY, int goalX, int goalY);
+
+void Replan_setWeight (Replan_session *session, int x, int y, unsigned int weight);
+
+void Replan_moveStart (Replan_session *session, int x, int y);
+
+int Replan_computePath (Replan_session *session);
+
+long Replan_solution (Replan_session *session, unsigned int *path, long maxLength);
+
+void Replan_destroy (Replan_session *session);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _REPLAN_H_ */
@@ -0,0 +1,124 @@
+#include <stdlib.h>
+#include <string.h>
+#include "visibility.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+VisibilityCache *
+Visibility_new (int width, int height, int radius, long capacity)
+{
+	VisibilityCache *cache = (VisibilityCache *) malloc(sizeof(VisibilityCache));
+	long side = 2 * radius + 1;
+	long i;
+
+	cache->width = width;
+	cache->height = height;
+	cache->radius = radius;
+	cache->capacity = capacity;
+	cache->clock = 0;
+	cache->origins = (VisibilityOrigin *) malloc(capacity * sizeof(VisibilityOrigin));
+	for (i = 0; i < capacity; i++) {
+		cache->origins[i].lastUsed = 0;
+		cache->origins[i].bits = (unsigned char *) malloc((side * side + 7) / 8);
+	}
+	return cache;
+}
+
+// Returns the slot of an origin, computing its bitset in the least recently used slot if it is not cached
+static VisibilityOrigin *
+originFor (VisibilityCache *cache, int x, int y, int tile, char *rawMap_data)
+{
+	VisibilityOrigin *origin = NULL;
+	long i;
+	int dx;
+	int dy;
+	long bit = 0;
+
+	for (i = 0; i < cache->capacity; i++) {
+		VisibilityOrigin *slot = &cache->origins[i];
+		if (slot->lastUsed && slot->x == x && slot->y == y && slot->tile == tile) {
+			slot->lastUsed = ++cache->clock;
+			return slot;
+		}
+		if (!origin || slot->lastUsed < origin->lastUsed) {
+			origin = slot;
+		}
+	}
+
+	origin->x = x;
+	origin->y = y;
+	origin->tile = tile;
+	origin->lastUsed = ++cache->clock;
+	memset(origin->bits, 0, ((2 * cache->radius + 1) * (2 * cache->radius + 1) + 7) / 8);
+	for (dy = -cache->radius; dy <= cache->radius; dy++) {
+		for (dx = -cache->radius; dx <= cache->radius; dx++, bit++) {
+			if (checkLOS_inner(x, y, x + dx, y + dy, tile, cache->width, cache->height, rawMap_data)) {
+				origin->bits[bit >> 3] |= 1 << (bit & 7);
+			}
+		}
+	}
+	return origin;
+}
+
+// Same result as checkLOS_inner, targets further than the cache radius are checked directly
+int
+Visibility_checkLOS (VisibilityCache *cache, int start_x, int start_y, int end_x, int end_y, int tile, char *rawMap_data)
+{
+	int dx = end_x - start_x;
+	int dy = end_y - start_y;
+	long bit;
+	VisibilityOrigin *origin;
+
+	if (cache->capacity <= 0 || dx < -cache->radius || dx > cache->radius || dy < -cache->radius || dy > cache->radius
+	 || start_x < 0 || start_x >= cache->width || start_y < 0 || start_y >= cache->height) {
+		return checkLOS_inner(start_x, start_y, end_x, end_y, tile, cache->width, cache->height, rawMap_data);
+	}
+
+	origin = originFor (cache, start_x, start_y, tile, rawMap_data);
+	bit = (long) (dy + cache->radius) * (2 * cache->radius + 1) + (dx + cache->radius);
+	return (origin->bits[bit >> 3] >> (bit & 7)) & 1;
+}
+
+long
+Visibility_count (VisibilityCache *cache)
+{
+	long count = 0;
+	long i;
+
+	for (i = 0; i < cache->capacity; i++) {
+		if (cache->origins[i].lastUsed) {
+			count++;
+		}
+	}
+	return count;
+}
+
+// Drops every cached origin, to be called when the raw map changes
+void
+Visibility_clear (VisibilityCache *cache)
+{
+	long i;
+
+	for (i = 0; i < cache->capacity; i++) {
+		cache->origins[i].lastUsed = 0;
+	}
+	cache->clock = 0;
+}
+
+void
+Visibility_destroy (VisibilityCache *cache)
+{
+	long i;
+
+	for (i = 0; i < cache->capacity; i++) {
+		free(cache->origins[i].bits);
+	}
+	free(cache->origins);
+	free(cache);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
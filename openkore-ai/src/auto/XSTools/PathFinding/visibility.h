@@ -0,0 +1,47 @@
+#ifndef _VISIBILITY_H_
+#define _VISIBILITY_H_
+
+#include "algorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Visibility cache of a field: for the few cells actors keep attacking from, the line of sight to every cell within
+// 'radius' is computed once and kept as a bitset. The bits are filled with checkLOS_inner, so cached answers are
+// always the same as the ones of a direct check. The cache holds at most 'capacity' origins, the least recently used is replaced.
+
+typedef struct {
+	int x;
+	int y;
+	int tile;
+	// Clock of the last lookup of this origin, 0 for a free slot
+	unsigned long lastUsed;
+	// One bit per cell of the (2 * radius + 1) square centered on the origin, row by row
+	unsigned char *bits;
+} VisibilityOrigin;
+
+struct VisibilityCache {
+	int width;
+	int height;
+	int radius;
+	long capacity;
+	unsigned long clock;
+	VisibilityOrigin *origins;
+};
+
+VisibilityCache *Visibility_new (int width, int height, int radius, long capacity);
+
+int Visibility_checkLOS (VisibilityCache *cache, int start_x, int start_y, int end_x, int end_y, int tile, char *rawMap_data);
+
+long Visibility_count (VisibilityCache *cache);
+
+void Visibility_clear (VisibilityCache *cache);
+
+void Visibility_destroy (VisibilityCache *cache);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _VISIBILITY_H_ */
@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include "../OSL/Threading/Executor.h"
+#include "workers.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// The search of a session, stored in CalcPath_session->job from CalcPath_submit until CalcPath_waitJob
+class SearchTask: public OSL::Task {
+public:
+	CalcPath_session *session;
+
+	virtual void run() {
+		session->jobResult = CalcPath_pathStep (session);
+	}
+};
+
+// Starts 'count' threads in the shared pool, unless it is already running.
+// Returns the number of running threads, which may be less than 'count' if threads could not be created.
+int
+CalcPath_startWorkers (int count)
+{
+	OSL::Executor *executor = OSL::Executor::getInstance ();
+
+	if (count <= 0) {
+		return (int) executor->getThreadCount ();
+	}
+	return (int) executor->start ((unsigned int) count);
+}
+
+// Finishes the queued jobs and stops the threads of the shared pool
+void
+CalcPath_stopWorkers ()
+{
+	OSL::Executor::getInstance ()->stop ();
+}
+
+int
+CalcPath_workerCount ()
+{
+	return (int) OSL::Executor::getInstance ()->getThreadCount ();
+}
+
+// Queues the search of an initialized session, without workers it is run right away in the calling thread
+void
+CalcPath_submit (CalcPath_session *session)
+{
+	OSL::Executor *executor = OSL::Executor::getInstance ();
+	SearchTask *task;
+
+	if (executor->getThreadCount () == 0) {
+		session->jobResult = CalcPath_pathStep (session);
+		session->jobStatus = CALCPATH_JOB_DONE;
+		return;
+	}
+
+	task = new SearchTask ();
+	task->session = session;
+	session->job = task;
+	session->jobStatus = CALCPATH_JOB_QUEUED;
+	executor->submit (task);
+}
+
+// Returns the CALCPATH_JOB_* status of the session
+int
+CalcPath_jobStatus (CalcPath_session *session)
+{
+	SearchTask *task = (SearchTask *) session->job;
+
+	if (!task) {
+		return session->jobStatus;
+	}
+	switch (task->getStatus ()) {
+	case OSL::Task::QUEUED:
+		return CALCPATH_JOB_QUEUED;
+	case OSL::Task::RUNNING:
+		return CALCPATH_JOB_RUNNING;
+	default:
+		return task->isDone () ? CALCPATH_JOB_DONE : CALCPATH_JOB_RUNNING;
+	}
+}
+
+// Blocks until the job of the session is done and returns its CalcPath_pathStep result, the session status stays CALCPATH_JOB_DONE.
+// A job which no thread took yet is run in the calling thread.
+int
+CalcPath_waitJob (CalcPath_session *session)
+{
+	SearchTask *task = (SearchTask *) session->job;
+
+	if (session->jobStatus == CALCPATH_JOB_NONE) {
+		return -2;
+	}
+
+	if (task) {
+		task->wait ();
+		delete task;
+		session->job = NULL;
+		session->jobStatus = CALCPATH_JOB_DONE;
+	}
+	return session->jobResult;
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
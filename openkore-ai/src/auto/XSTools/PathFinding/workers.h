@@ -0,0 +1,37 @@
+#ifndef _WORKERS_H_
+#define _WORKERS_H_
+
+#include "algorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Background search status of a session, stored in CalcPath_session->jobStatus
+#define CALCPATH_JOB_NONE 0
+#define CALCPATH_JOB_QUEUED 1
+#define CALCPATH_JOB_RUNNING 2
+#define CALCPATH_JOB_DONE 3
+
+// Runs CalcPath_pathStep on the sessions submitted to it in the shared pool of native threads (OSL::Executor),
+// which the workers are the threads of.
+// A session must not be touched, other than through CalcPath_jobStatus and CalcPath_waitJob, between CalcPath_submit and the end of its job,
+// and the weight map and neighbor mask it points to must stay alive until then.
+
+int CalcPath_startWorkers (int count);
+
+void CalcPath_stopWorkers ();
+
+int CalcPath_workerCount ();
+
+void CalcPath_submit (CalcPath_session *session);
+
+int CalcPath_jobStatus (CalcPath_session *session);
+
+int CalcPath_waitJob (CalcPath_session *session);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _WORKERS_H_ */
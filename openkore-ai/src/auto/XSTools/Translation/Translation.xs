@@ -7,6 +7,41 @@
 #include "translator.h"
 #include "utils.h"
 
+#define CACHE_SIZE 256
+
+/*
+ * A message which _T() translated recently. Entries are found by the address
+ * and length of the Perl string the message came from: string literals keep
+ * their buffer from one call to the next, so looking them up doesn't need to
+ * hash the message.
+ */
+struct CacheEntry {
+	const char *buffer;
+	STRLEN len;
+	/* A copy of the message, since the buffer may hold another string by now. */
+	char *message;
+	/* The translation, or NULL if the message has none. */
+	SV *translation;
+};
+
+/* What _load() returns: a translator and its cache. */
+struct CachedTranslator {
+	Translator *translator;
+	CacheEntry cache[CACHE_SIZE];
+};
+
+static void
+clearEntry (pTHX_ CacheEntry *entry)
+{
+	Safefree (entry->message);
+	if (entry->translation != NULL)
+		SvREFCNT_dec (entry->translation);
+	entry->buffer = NULL;
+	entry->len = 0;
+	entry->message = NULL;
+	entry->translation = NULL;
+}
+
 
 MODULE = Translation     PACKAGE = Translation
 PROTOTYPES: ENABLE
@@ -15,10 +50,12 @@ void
 _load(file)
 	char *file
 INIT:
-	Translator *translator;
+	CachedTranslator *translator;
 CODE:
 	try {
-		translator = new Translator (file);
+		Translator *t = new Translator (file);
+		Newxz (translator, 1, CachedTranslator);
+		translator->translator = t;
 		XSRETURN_IV ((IV) translator);
 	} catch (...) {
 		XSRETURN_UNDEF;
@@ -27,8 +64,15 @@ CODE:
 void
 _unload(translator)
 	IV translator
+INIT:
+	CachedTranslator *t = (CachedTranslator *) translator;
 CODE:
-	delete (Translator *) translator;
+	if (t != NULL) {
+		for (int i = 0; i < CACHE_SIZE; i++)
+			clearEntry (aTHX_ &t->cache[i]);
+		delete t->translator;
+		Safefree (t);
+	}
 
 void
 _translate(translator, message)
@@ -46,12 +90,52 @@ CODE:
 	if (!msg || !SvOK (msg))
 		XSRETURN_EMPTY;
 
-	translation = ((Translator *) translator)->translate (SvPV_nolen (msg), len);
+	translation = ((CachedTranslator *) translator)->translator->translate (SvPV_nolen (msg), len);
 	if (translation != NULL) {
 		sv_setpvn (msg, translation, len);
 		SvUTF8_on (msg);
 	}
 
+SV *
+_T(translator, message)
+	IV translator
+	SV *message
+INIT:
+	CachedTranslator *t = (CachedTranslator *) translator;
+	const char *buffer;
+	STRLEN len;
+	CacheEntry *entry;
+CODE:
+	if (t == NULL || !SvOK (message)) {
+		RETVAL = newSVsv (message);
+	} else {
+		buffer = SvPV (message, len);
+		entry = &t->cache[(((size_t) buffer >> 3) ^ len) & (CACHE_SIZE - 1)];
+		if (entry->buffer != buffer || entry->len != len
+		    || memcmp (entry->message, buffer, len) != 0) {
+			const char *translation;
+			unsigned int translationLen;
+
+			clearEntry (aTHX_ entry);
+			entry->buffer = buffer;
+			entry->len = len;
+			entry->message = savepvn (buffer, len);
+			translation = t->translator->translate (entry->message, translationLen);
+			if (translation != NULL) {
+				entry->translation = newSVpvn (translation, translationLen);
+				SvUTF8_on (entry->translation);
+			}
+		}
+
+		// Copies of the cached translation share its buffer, on Perls with copy-on-write
+		if (entry->translation != NULL)
+			RETVAL = newSVsv (entry->translation);
+		else
+			RETVAL = newSVsv (message);
+	}
+OUTPUT:
+	RETVAL
+
 char *
 getLocaleCharset()
 CODE:
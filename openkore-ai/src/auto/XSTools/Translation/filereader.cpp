@@ -1,6 +0,0 @@
-#include "filereader.h"
-
-FileReader::~FileReader ()
-{
-	// Do nothing. This is to work around C++'s suckiness.
-}
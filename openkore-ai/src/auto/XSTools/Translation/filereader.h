@@ -1,19 +1,42 @@
 #ifndef _FILEREADER_H_
 #define _FILEREADER_H_
 
+#include <stddef.h>
+
 /**
- * Abstract interface for reading files. See UnixFileReader and WinFileReader.
+ * Reads a file through a read-only memory mapping (mmap() on Unix,
+ * CreateFileMapping() on Windows), so that processes which read the same
+ * file share its memory, and nothing is copied at load time.
+ *
+ * The accessors are inline and don't check their offset: the caller
+ * checks it against getSize().
  */
 class FileReader {
+private:
+	char *addr;
+	size_t len;
+	#ifdef WIN32
+	// HANDLEs, without including windows.h everywhere.
+	void *hFile;
+	void *hMapFile;
+	#endif
 public:
-	virtual ~FileReader ();
+	/**
+	 * Map a file. Throws an exception if it cannot be opened or mapped.
+	 *
+	 * @pre filename != NULL
+	 */
+	FileReader (const char *filename);
+	~FileReader ();
 
 	/**
 	 * Return the file size.
 	 *
 	 * @return The file size in bytes.
 	 */
-	virtual unsigned int getSize () = 0;
+	unsigned int getSize () const {
+		return (unsigned int) len;
+	}
 
 	/**
 	 * Read a 32-bit unsigned integer at the specified offset in the file.
@@ -21,7 +44,9 @@ public:
 	 * @param offset The offset to read from.
 	 * @return An integer read from the file.
 	 */
-	virtual unsigned int readInt (unsigned int offset) = 0;
+	unsigned int readInt (unsigned int offset) const {
+		return *(const unsigned int *) (addr + offset);
+	}
 
 	/**
 	 * Read a string at the specified offset in the file.
@@ -30,7 +55,9 @@ public:
 	 * @return A string read from the file. This string may or may not
 	 *         be NULL-terminated, depending on the content of the file.
 	 */
-	virtual const char  *readStr (unsigned int offset) = 0;
+	const char *readStr (unsigned int offset) const {
+		return addr + offset;
+	}
 };
 
 #endif /* _FILEREADER_H_ */
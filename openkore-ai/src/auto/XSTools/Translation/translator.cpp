@@ -1,25 +1,49 @@
 #include <stdlib.h>
 #include <string.h>
 #include "translator.h"
-#ifdef WIN32
-	#include "winfilereader.h"
-#else
-	#include "unixfilereader.h"
-#endif
 
 
 #define COUNT_OFFSET 8
 #define ORIG_TABLE_POINTER_OFFSET 12
 #define TRANSLATION_TABLE_POINTER_OFFSET 16
+#define HASH_TABLE_SIZE_OFFSET 20
+#define HASH_TABLE_POINTER_OFFSET 24
+
+
+/**
+ * The hash function which gettext uses for the hash table in .mo files.
+ */
+static unsigned int
+hashString (const char *str)
+{
+	unsigned int hval = 0, g;
+
+	while (*str != '\0') {
+		hval <<= 4;
+		hval += (unsigned char) *str++;
+		g = hval & 0xF0000000;
+		if (g != 0) {
+			hval ^= g >> 24;
+			hval ^= g;
+		}
+	}
+	return hval;
+}
+
+static bool
+isPrime (unsigned int n)
+{
+	for (unsigned int d = 3; d * d <= n; d += 2) {
+		if (n % d == 0)
+			return false;
+	}
+	return true;
+}
 
 #include <stdio.h>
 Translator::Translator (const char *filename)
 {
-	#ifdef WIN32
-	reader = new WinFileReader (filename);
-	#else
-	reader = new UnixFileReader (filename);
-	#endif
+	reader = new FileReader (filename);
 
 	// Sanity check file size.
 	if (reader->getSize () < TRANSLATION_TABLE_POINTER_OFFSET)
@@ -37,11 +61,63 @@ Translator::Translator (const char *filename)
 	if (reader->getSize () < origTableOffset
 	    || reader->getSize () < translationTableOffset)
 		throw 1;
+
+	// Use the file's hash table if it has a usable one.
+	hashTableSize = 0;
+	hashTableOffset = 0;
+	ownHashTable = NULL;
+	if (reader->getSize () >= HASH_TABLE_POINTER_OFFSET + 4) {
+		hashTableSize = reader->readInt (HASH_TABLE_SIZE_OFFSET);
+		hashTableOffset = reader->readInt (HASH_TABLE_POINTER_OFFSET);
+	}
+	if (hashTableSize <= 2
+	    || hashTableOffset > reader->getSize ()
+	    || (reader->getSize () - hashTableOffset) / 4 < hashTableSize)
+		buildHashTable ();
 }
 
 Translator::~Translator ()
 {
 	delete reader;
+	delete[] ownHashTable;
+}
+
+void
+Translator::buildHashTable ()
+{
+	// gettext's double hashing needs a prime table size, so that
+	// every probe sequence visits every slot.
+	hashTableSize = count + count / 3 + 3;
+	if (hashTableSize % 2 == 0)
+		hashTableSize++;
+	while (!isPrime (hashTableSize))
+		hashTableSize += 2;
+	hashTableOffset = 0;
+	ownHashTable = new unsigned int[hashTableSize];
+	memset (ownHashTable, 0, hashTableSize * sizeof (unsigned int));
+
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned int hval = hashString (getOrigMessage (i));
+		unsigned int slot = hval % hashTableSize;
+		unsigned int incr = 1 + hval % (hashTableSize - 2);
+
+		while (ownHashTable[slot] != 0) {
+			if (slot >= hashTableSize - incr)
+				slot -= hashTableSize - incr;
+			else
+				slot += incr;
+		}
+		ownHashTable[slot] = i + 1;
+	}
+}
+
+unsigned int
+Translator::getHashEntry (unsigned int slot)
+{
+	if (ownHashTable != NULL)
+		return ownHashTable[slot];
+	else
+		return reader->readInt (hashTableOffset + slot * 4);
 }
 
 const char *
@@ -54,6 +130,12 @@ Translator::getOrigMessage (unsigned int index)
 	return reader->readStr (msgOffset);
 }
 
+unsigned int
+Translator::getOrigLength (unsigned int index)
+{
+	return reader->readInt (origTableOffset + index * 8);
+}
+
 const char *
 Translator::getTranslationMessage (unsigned int index, unsigned int &len)
 {
@@ -63,27 +145,37 @@ Translator::getTranslationMessage (unsigned int index, unsigned int &len)
 	msgOffset = reader->readInt (translationTableOffset + index * 8 + 4);
 	return reader->readStr (msgOffset);
 }
-#include <stdio.h>
 const char *
 Translator::translate (const char *message, unsigned int &retlen)
 {
-	unsigned int low, high, mid;
-
-	// Lookup the translation with binary search.
-	low = 0;
-	high = count - 1;
-	while (low <= high) {
-		int i;
-
-		mid = (low + high) / 2;
-		i = strcmp (message, getOrigMessage (mid));
-		if (i < 0)
-			high = mid - 1;
-		else if (i > 0)
-			low = mid + 1;
-		else
+	unsigned int len, hval, slot, incr;
+
+	if (count == 0)
+		return NULL;
+
+	// Look up the translation in the hash table, with gettext's double hashing.
+	len = strlen (message);
+	hval = hashString (message);
+	slot = hval % hashTableSize;
+	incr = 1 + hval % (hashTableSize - 2);
+	for (unsigned int probes = 0; probes < hashTableSize; probes++) {
+		unsigned int entry = getHashEntry (slot);
+
+		if (entry == 0)
+			// Translation not found.
+			return NULL;
+
+		// The stored length includes the plural form, if any.
+		entry--;
+		if (entry < count && getOrigLength (entry) >= len
+		    && strcmp (message, getOrigMessage (entry)) == 0)
 			// Translation found.
-			return getTranslationMessage (mid, retlen);
+			return getTranslationMessage (entry, retlen);
+
+		if (slot >= hashTableSize - incr)
+			slot -= hashTableSize - incr;
+		else
+			slot += incr;
 	}
 
 	// Translation not found.
@@ -15,8 +15,18 @@ private:
 	unsigned int translationTableOffset;
 	unsigned int count;
 
+	// The hash table which maps original messages to their index + 1,
+	// with 0 for empty slots. It's the file's own if it has one, otherwise
+	// it's built at load time in ownHashTable.
+	unsigned int hashTableSize;
+	unsigned int hashTableOffset;
+	unsigned int *ownHashTable;
+
 	const char *getOrigMessage (unsigned int index);
+	unsigned int getOrigLength (unsigned int index);
 	const char *getTranslationMessage (unsigned int index, unsigned int &len);
+	unsigned int getHashEntry (unsigned int slot);
+	void buildHashTable ();
 public:
 	/**
 	 * Create a new Translator object. Throws an exception if the
@@ -29,7 +39,7 @@ public:
 	~Translator ();
 
 	/**
-	 * Translate a message.
+	 * Translate a message. This takes one hash table probe in most cases.
 	 *
 	 * @param message The message to translate.
 	 * @param msglen message's length.
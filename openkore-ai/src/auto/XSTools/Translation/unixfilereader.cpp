@@ -3,19 +3,17 @@
 #include <sys/mman.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include "filereader.h"
 
-#include "unixfilereader.h"
-
-
-UnixFileReader::UnixFileReader (const char *filename)
+FileReader::FileReader (const char *filename)
 {
 	struct stat buf;
 	int fd;
 
 	if (stat (filename, &buf) == -1)
 		throw 1;
-
 	len = buf.st_size;
+
 	fd = open (filename, O_RDONLY);
 	if (fd == -1)
 		throw 2;
@@ -26,29 +24,7 @@ UnixFileReader::UnixFileReader (const char *filename)
 		throw 3;
 }
 
-UnixFileReader::~UnixFileReader ()
+FileReader::~FileReader ()
 {
 	munmap (addr, len);
 }
-
-unsigned int
-UnixFileReader::getSize ()
-{
-	return (unsigned int) len;
-}
-
-unsigned int
-UnixFileReader::readInt (unsigned int offset)
-{
-	unsigned int *i;
-	i = (unsigned int *) &(addr[offset]);
-	return *i;
-}
-
-const char *
-UnixFileReader::readStr (unsigned int offset)
-{
-	const char *s;
-	s = (const char *) &(addr[offset]);
-	return s;
-}
@@ -1,12 +1,11 @@
-#include "winfilereader.h"
 #include <windows.h>
+#include "filereader.h"
 
 
-WinFileReader::WinFileReader (const char *filename)
+FileReader::FileReader (const char *filename)
 {
-	OFSTRUCT buf;
+	DWORD size;
 
-	buf.cBytes = sizeof (OFSTRUCT);
 	hFile = CreateFile (filename, GENERIC_READ, FILE_SHARE_READ,
 		NULL, OPEN_EXISTING, 0, NULL);
 	if (hFile == INVALID_HANDLE_VALUE)
@@ -26,32 +25,12 @@ WinFileReader::WinFileReader (const char *filename)
 		CloseHandle (hFile);
 		throw 2;
 	}
+	len = size;
 }
 
-WinFileReader::~WinFileReader ()
+FileReader::~FileReader ()
 {
+	UnmapViewOfFile (addr);
 	CloseHandle (hMapFile);
 	CloseHandle (hFile);
 }
-
-unsigned int
-WinFileReader::getSize ()
-{
-	return (unsigned int) size;
-}
-
-unsigned int
-WinFileReader::readInt (unsigned int offset)
-{
-	unsigned int *i;
-	i = (unsigned int *) &(addr[offset]);
-	return *i;
-}
-
-const char *
-WinFileReader::readStr (unsigned int offset)
-{
-	const char *s;
-	s = (const char *) &(addr[offset]);
-	return s;
-}
@@ -0,0 +1,661 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#ifdef WIN32
+	#ifndef _WIN32_WINNT
+		#define _WIN32_WINNT 0x0600
+	#endif
+	#define WIN32_LEAN_AND_MEAN
+	#include <winsock2.h>
+	#include <windows.h>
+	typedef int socklen_t;
+#else
+	#include <sys/types.h>
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+	#include <arpa/inet.h>
+#endif
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include "../OSL/Net/Reactor.h"
+#include "../OSL/Net/ServerSocket.h"
+#include "../OSL/IO/IOException.h"
+#include "busrelay.h"
+
+using namespace OSL;
+
+// Bytes read from a client at once
+#define BUS_RELAY_READ_SIZE (1024 * 64)
+// Clients accepted by one run at most
+#define BUS_RELAY_ACCEPTS 16
+// Frames written to a client at once at most
+#define BUS_RELAY_WRITE_FRAMES 64
+// The header of a message: length, options, and the length of the ID
+#define BUS_RELAY_HEADER_SIZE 6
+// The FROM entry appended to the messages relayed: key length, "FROM", integer type, value length, client ID
+#define BUS_RELAY_FROM_SIZE 13
+
+// A frame queued for its recipients, freed when the last one sent it
+struct BusFrame {
+	unsigned int refs;
+	unsigned int size;
+	char data[1];
+};
+
+struct QueuedFrame {
+	BusFrame *frame;
+	// Bytes of the frame already sent
+	unsigned int sent;
+};
+
+struct BusEvent {
+	unsigned int id;
+	int type;
+	std::string data;
+};
+
+struct BusClient;
+
+class BusAcceptor: public Reactor::Handler {
+public:
+	BusRelay *relay;
+	virtual void handleEvents (Reactor *reactor, int events);
+};
+
+struct BusRelay {
+	Reactor *reactor;
+	ServerSocket *server;
+	BusAcceptor acceptor;
+	// By ID, which is the order they connected in
+	std::map<unsigned int, BusClient *> clients;
+	std::set<std::string> handled;
+	std::vector<BusEvent> events;
+	// Clients which have frames queued, flushed at the end of a run
+	std::vector<unsigned int> dirty;
+	unsigned int nextID;
+	unsigned long relayed;
+	unsigned long delivered;
+	char buffer[BUS_RELAY_READ_SIZE];
+};
+
+struct BusClient: public Reactor::Handler {
+	BusRelay *relay;
+	unsigned int id;
+	Socket *socket;
+	std::string input;
+	std::deque<QueuedFrame> queue;
+	unsigned long queued;
+	bool broadcasts;
+	// Whether the reactor waits for the socket to be writable, while part of the queue couldn't be sent
+	bool writing;
+	bool dirty;
+
+	virtual void handleEvents (Reactor *reactor, int events);
+};
+
+static BusFrame *
+newFrame (const char *data, unsigned int size, unsigned int extra)
+{
+	BusFrame *frame = (BusFrame *) malloc (offsetof (BusFrame, data) + size + extra);
+
+	if (!frame) {
+		return NULL;
+	}
+	frame->refs = 0;
+	frame->size = size + extra;
+	memcpy (frame->data, data, size);
+	return frame;
+}
+
+static void
+unrefFrame (BusFrame *frame)
+{
+	if (--frame->refs == 0) {
+		free (frame);
+	}
+}
+
+static unsigned int
+readInt (const unsigned char *data, int bytes)
+{
+	unsigned int value = 0;
+
+	for (int i = 0; i < bytes; i++) {
+		value = (value << 8) | data[i];
+	}
+	return value;
+}
+
+static void
+writeInt (char *data, unsigned int value, int bytes)
+{
+	for (int i = bytes - 1; i >= 0; i--) {
+		data[i] = (char) (value & 0xFF);
+		value >>= 8;
+	}
+}
+
+static void
+pushEvent (BusRelay *relay, unsigned int id, int type, const char *data, unsigned int len)
+{
+	relay->events.push_back (BusEvent ());
+	BusEvent &event = relay->events.back ();
+	event.id = id;
+	event.type = type;
+	event.data.assign (data, len);
+}
+
+static BusClient *
+findClient (BusRelay *relay, unsigned int id)
+{
+	std::map<unsigned int, BusClient *>::iterator it = relay->clients.find (id);
+	return (it == relay->clients.end ()) ? NULL : it->second;
+}
+
+static void
+closeClient (BusRelay *relay, BusClient *client)
+{
+	relay->clients.erase (client->id);
+	relay->reactor->remove (client->socket);
+	client->socket->unref ();
+	while (!client->queue.empty ()) {
+		unrefFrame (client->queue.front ().frame);
+		client->queue.pop_front ();
+	}
+	pushEvent (relay, client->id, BUS_RELAY_DISCONNECTED, NULL, 0);
+	delete client;
+}
+
+// Sends what the socket takes of the queue; returns false if the client was closed
+static bool
+flushClient (BusRelay *relay, BusClient *client)
+{
+	while (!client->queue.empty ()) {
+		IOVector vectors[BUS_RELAY_WRITE_FRAMES];
+		unsigned int count = 0;
+		unsigned int written;
+
+		for (std::deque<QueuedFrame>::iterator it = client->queue.begin ();
+		     it != client->queue.end () && count < BUS_RELAY_WRITE_FRAMES; it++, count++) {
+			vectors[count].data = it->frame->data + it->sent;
+			vectors[count].size = it->frame->size - it->sent;
+		}
+		try {
+			written = client->socket->getOutputStream ()->writev (vectors, count);
+		} catch (IOException &e) {
+			closeClient (relay, client);
+			return false;
+		}
+		if (written == 0) {
+			break;
+		}
+		client->queued -= written;
+		while (written > 0) {
+			QueuedFrame &queued = client->queue.front ();
+			unsigned int left = queued.frame->size - queued.sent;
+
+			if (written < left) {
+				queued.sent += written;
+				break;
+			}
+			written -= left;
+			unrefFrame (queued.frame);
+			client->queue.pop_front ();
+		}
+	}
+
+	bool writing = !client->queue.empty ();
+	if (writing != client->writing) {
+		relay->reactor->modify (client->socket, writing ? (Reactor::READABLE | Reactor::WRITABLE) : Reactor::READABLE);
+		client->writing = writing;
+	}
+	return true;
+}
+
+// Queues a frame for a client, which is flushed at the end of the run; returns false if its queue is full
+static bool
+queueFrame (BusRelay *relay, BusClient *client, BusFrame *frame)
+{
+	QueuedFrame queued;
+
+	queued.frame = frame;
+	queued.sent = 0;
+	frame->refs++;
+	client->queue.push_back (queued);
+	client->queued += frame->size;
+	if (!client->dirty) {
+		client->dirty = true;
+		relay->dirty.push_back (client->id);
+	}
+	return client->queued <= BUS_RELAY_MAX_QUEUE;
+}
+
+static void
+flushDirty (BusRelay *relay)
+{
+	for (size_t i = 0; i < relay->dirty.size (); i++) {
+		BusClient *client = findClient (relay, relay->dirty[i]);
+		if (client) {
+			client->dirty = false;
+			flushClient (relay, client);
+		}
+	}
+	relay->dirty.clear ();
+}
+
+// Whether the bytes are valid UTF-8, as the ID of a message must be
+static bool
+validUTF8 (const unsigned char *data, unsigned int len)
+{
+	unsigned int i = 0;
+
+	while (i < len) {
+		unsigned char c = data[i];
+		unsigned int follow;
+
+		if (c < 0x80) {
+			i++;
+			continue;
+		} else if (c >= 0xC2 && c <= 0xDF) {
+			follow = 1;
+		} else if (c >= 0xE0 && c <= 0xEF) {
+			follow = 2;
+		} else if (c >= 0xF0 && c <= 0xF4) {
+			follow = 3;
+		} else {
+			return false;
+		}
+		if (len - i <= follow) {
+			return false;
+		}
+		for (unsigned int j = 1; j <= follow; j++) {
+			if ((data[i + j] & 0xC0) != 0x80) {
+				return false;
+			}
+		}
+		i += follow + 1;
+	}
+	return true;
+}
+
+// The client a TO value names, as the keys of the clients hash are their IDs in decimal; NULL if none
+static BusClient *
+recipient (BusRelay *relay, unsigned int type, const unsigned char *value, unsigned int len)
+{
+	unsigned int id = 0;
+
+	if (type == 2) {
+		return findClient (relay, readInt (value, 4));
+	}
+	if (len == 0 || len > 10 || (len > 1 && value[0] == '0')) {
+		return NULL;
+	}
+	for (unsigned int i = 0; i < len; i++) {
+		if (value[i] < '0' || value[i] > '9') {
+			return NULL;
+		}
+		unsigned long long next = (unsigned long long) id * 10 + (value[i] - '0');
+		if (next > 0xFFFFFFFFULL) {
+			return NULL;
+		}
+		id = (unsigned int) next;
+	}
+	return findClient (relay, id);
+}
+
+// Relays a complete frame, or hands it to the server
+static void
+routeFrame (BusRelay *relay, BusClient *sender, const unsigned char *data, unsigned int len)
+{
+	unsigned int IDLen = data[5];
+	unsigned int offset = BUS_RELAY_HEADER_SIZE + IDLen;
+	const unsigned char *to = NULL;
+	unsigned int toType = 0, toLen = 0;
+	BusClient *target = NULL;
+
+	if (offset > len || data[4] != 0 || !validUTF8 (data + BUS_RELAY_HEADER_SIZE, IDLen)
+	 || relay->handled.count (std::string ((const char *) data + BUS_RELAY_HEADER_SIZE, IDLen))) {
+		pushEvent (relay, sender->id, BUS_RELAY_MESSAGE, (const char *) data, len);
+		return;
+	}
+
+	// Find the TO entry, the last one if there are several as it is the one the hash keeps
+	while (offset < len) {
+		unsigned int keyLen = data[offset];
+		unsigned int valueOffset = offset + 1 + keyLen + 4;
+		unsigned int type, valueLen;
+
+		if (valueOffset > len) {
+			break;
+		}
+		type = data[offset + 1 + keyLen];
+		valueLen = readInt (data + offset + 1 + keyLen + 1, 3);
+		if (valueLen > len - valueOffset || (type == 2 && valueLen != 4)) {
+			break;
+		}
+		if (keyLen == 2 && data[offset + 1] == 'T' && data[offset + 2] == 'O') {
+			to = data + valueOffset;
+			toType = type;
+			toLen = valueLen;
+		}
+		offset = valueOffset + valueLen;
+	}
+	if (offset != len) {
+		// Malformed: the server reports it
+		pushEvent (relay, sender->id, BUS_RELAY_MESSAGE, (const char *) data, len);
+		return;
+	}
+	if (to) {
+		target = recipient (relay, toType, to, toLen);
+		if (!target) {
+			// The server tells the sender that there's no such client
+			pushEvent (relay, sender->id, BUS_RELAY_MESSAGE, (const char *) data, len);
+			return;
+		}
+	}
+
+	BusFrame *frame = newFrame ((const char *) data, len, BUS_RELAY_FROM_SIZE);
+	if (!frame) {
+		return;
+	}
+	char *from = frame->data + len;
+	from[0] = 4;
+	memcpy (from + 1, "FROM", 4);
+	from[5] = 2;
+	writeInt (from + 6, 4, 3);
+	writeInt (from + 9, sender->id, 4);
+	writeInt (frame->data, frame->size, 4);
+
+	std::vector<BusClient *> full;
+	frame->refs++;
+	relay->relayed++;
+	if (target) {
+		relay->delivered++;
+		if (!queueFrame (relay, target, frame)) {
+			full.push_back (target);
+		}
+	} else {
+		for (std::map<unsigned int, BusClient *>::iterator it = relay->clients.begin ();
+		     it != relay->clients.end (); it++) {
+			BusClient *client = it->second;
+			if (client->broadcasts && client != sender) {
+				relay->delivered++;
+				if (!queueFrame (relay, client, frame)) {
+					full.push_back (client);
+				}
+			}
+		}
+	}
+	unrefFrame (frame);
+	for (size_t i = 0; i < full.size (); i++) {
+		closeClient (relay, full[i]);
+	}
+}
+
+void
+BusClient::handleEvents (Reactor *reactor, int events)
+{
+	if (events & Reactor::WRITABLE) {
+		if (!flushClient (relay, this)) {
+			return;
+		}
+	}
+	if (!(events & Reactor::READABLE)) {
+		return;
+	}
+
+	int size;
+	try {
+		size = socket->getInputStream ()->read (relay->buffer, BUS_RELAY_READ_SIZE);
+	} catch (IOException &e) {
+		size = -1;
+	}
+	if (size == -1) {
+		closeClient (relay, this);
+		return;
+	} else if (size == 0) {
+		return;
+	}
+
+	// Route the complete frames; this client may be closed by then, if its own queue was full
+	BusRelay *bus = relay;
+	unsigned int clientID = id;
+	size_t start = 0;
+	input.append (bus->buffer, size);
+	while (input.size () - start >= 4) {
+		const unsigned char *data = (const unsigned char *) input.data () + start;
+		unsigned int len = readInt (data, 4);
+
+		if (len < BUS_RELAY_HEADER_SIZE) {
+			// Not a frame anyone can read past
+			closeClient (bus, this);
+			return;
+		}
+		if (input.size () - start < len) {
+			break;
+		}
+		routeFrame (bus, this, data, len);
+		if (!findClient (bus, clientID)) {
+			return;
+		}
+		start += len;
+	}
+	input.erase (0, start);
+}
+
+void
+BusAcceptor::handleEvents (Reactor *reactor, int events)
+{
+	for (int i = 0; i < BUS_RELAY_ACCEPTS; i++) {
+		Socket *socket;
+		try {
+			socket = relay->server->accept ();
+		} catch (IOException &e) {
+			return;
+		}
+		if (!socket) {
+			return;
+		}
+
+		struct sockaddr_in address;
+		socklen_t addressLen = sizeof (address);
+		const char *ip = "";
+		if (getpeername (socket->getHandle (), (struct sockaddr *) &address, &addressLen) == 0) {
+			ip = inet_ntoa (address.sin_addr);
+		}
+
+		BusClient *client = new BusClient ();
+		client->relay = relay;
+		client->id = relay->nextID++;
+		client->socket = socket;
+		client->queued = 0;
+		client->broadcasts = false;
+		client->writing = false;
+		client->dirty = false;
+		try {
+			socket->setBlocking (false);
+			reactor->add (socket, Reactor::READABLE, client);
+		} catch (Exception &e) {
+			socket->unref ();
+			delete client;
+			continue;
+		}
+		relay->clients[client->id] = client;
+		pushEvent (relay, client->id, BUS_RELAY_CONNECTED, ip, (unsigned int) strlen (ip));
+	}
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+BusRelay *
+BusRelay_new (const char *ip, unsigned short port, char *error, unsigned int errorSize)
+{
+	static bool initialized = false;
+	BusRelay *relay;
+
+	if (!initialized) {
+		Socket::init ();
+		initialized = true;
+	}
+	relay = new BusRelay ();
+	relay->nextID = 0;
+	relay->relayed = 0;
+	relay->delivered = 0;
+	relay->acceptor.relay = relay;
+	relay->reactor = NULL;
+	relay->server = NULL;
+	try {
+		relay->reactor = new Reactor ();
+		relay->server = ServerSocket::create (ip, port);
+		relay->server->setBlocking (false);
+		relay->reactor->add (relay->server, Reactor::READABLE, &relay->acceptor);
+	} catch (Exception &e) {
+		snprintf (error, errorSize, "%s", e.getMessage ());
+		if (relay->server) {
+			relay->server->unref ();
+		}
+		if (relay->reactor) {
+			relay->reactor->unref ();
+		}
+		delete relay;
+		return NULL;
+	}
+	return relay;
+}
+
+unsigned short
+BusRelay_port (BusRelay *relay)
+{
+	return relay->server->getPort ();
+}
+
+void
+BusRelay_handle (BusRelay *relay, const char *ID, unsigned int len)
+{
+	relay->handled.insert (std::string (ID, len));
+}
+
+void
+BusRelay_setBroadcasts (BusRelay *relay, unsigned int id, int enabled)
+{
+	BusClient *client = findClient (relay, id);
+	if (client) {
+		client->broadcasts = enabled != 0;
+	}
+}
+
+int
+BusRelay_send (BusRelay *relay, unsigned int id, const char *data, unsigned int len)
+{
+	BusClient *client = findClient (relay, id);
+	BusFrame *frame;
+	bool queued;
+
+	if (!client || len == 0 || !(frame = newFrame (data, len, 0))) {
+		return 0;
+	}
+	frame->refs++;
+	queued = queueFrame (relay, client, frame);
+	unrefFrame (frame);
+	if (!queued) {
+		closeClient (relay, client);
+		return 0;
+	}
+	// Sent now rather than at the end of the next run, which may be a while
+	client->dirty = false;
+	return flushClient (relay, client);
+}
+
+void
+BusRelay_close (BusRelay *relay, unsigned int id)
+{
+	BusClient *client = findClient (relay, id);
+	if (client) {
+		closeClient (relay, client);
+	}
+}
+
+int
+BusRelay_run (BusRelay *relay, int timeout)
+{
+	size_t before = relay->events.size ();
+
+	try {
+		relay->reactor->run (timeout);
+	} catch (Exception &e) {
+		return -1;
+	}
+	flushDirty (relay);
+	return (int) (relay->events.size () - before);
+}
+
+unsigned int
+BusRelay_take (BusRelay *relay, BusRelay_takeFunc take, void *arg)
+{
+	std::vector<BusEvent> events;
+	unsigned int count = 0;
+
+	// Events added by 'take', for clients it closes, are taken by the next pass
+	while (!relay->events.empty ()) {
+		events.swap (relay->events);
+		for (size_t i = 0; i < events.size (); i++) {
+			take (arg, events[i].id, events[i].type, events[i].data.data (), (unsigned int) events[i].data.size ());
+			count++;
+		}
+		events.clear ();
+	}
+	flushDirty (relay);
+	return count;
+}
+
+unsigned int
+BusRelay_count (BusRelay *relay)
+{
+	return (unsigned int) relay->clients.size ();
+}
+
+int
+BusRelay_queue (BusRelay *relay, unsigned int id, unsigned int *frames, unsigned long *bytes)
+{
+	BusClient *client = findClient (relay, id);
+	if (!client) {
+		return 0;
+	}
+	*frames = (unsigned int) client->queue.size ();
+	*bytes = client->queued;
+	return 1;
+}
+
+unsigned long
+BusRelay_relayed (BusRelay *relay)
+{
+	return relay->relayed;
+}
+
+unsigned long
+BusRelay_delivered (BusRelay *relay)
+{
+	return relay->delivered;
+}
+
+void
+BusRelay_free (BusRelay *relay)
+{
+	while (!relay->clients.empty ()) {
+		closeClient (relay, relay->clients.begin ()->second);
+	}
+	relay->reactor->remove (relay->server);
+	relay->server->unref ();
+	relay->reactor->unref ();
+	delete relay;
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
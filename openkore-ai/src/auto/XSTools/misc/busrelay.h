@@ -0,0 +1,74 @@
+#ifndef _BUSRELAY_H_
+#define _BUSRELAY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Bus server transport, the native part of Bus::Server::NativeServer. It accepts the bus clients and reads their
+// messages with an OSL::Reactor, and relays those it can route itself from their framing alone: a map message
+// with a TO key goes to that client, any other map message to every client which gets broadcasts but the sender.
+// A relayed message is the frame read with a FROM entry appended, which is queued as is to all its recipients.
+// The messages of the IDs the server handles, array messages, malformed ones and those for a client which
+// doesn't exist are handed to the server, like new and closed connections, see BusRelay_take.
+//
+// Client IDs count up from 0 and aren't reused. Clients don't get broadcasts until the server says so with
+// BusRelay_setBroadcasts. A client whose queue grows past BUS_RELAY_MAX_QUEUE bytes isn't reading its messages
+// and is disconnected.
+
+// Types of the events BusRelay_take hands out
+// A client connected, the data is its IP address
+#define BUS_RELAY_CONNECTED 0
+// A message for the server, the data is the whole frame
+#define BUS_RELAY_MESSAGE 1
+// A client disconnected or was disconnected
+#define BUS_RELAY_DISCONNECTED 2
+
+#define BUS_RELAY_MAX_QUEUE (16 * 1024 * 1024)
+
+typedef struct BusRelay BusRelay;
+
+// Starts listening at ip (NULL for every address) and port (0 for any free port). Returns NULL on failure,
+// with the reason in error.
+BusRelay *BusRelay_new (const char *ip, unsigned short port, char *error, unsigned int errorSize);
+
+unsigned short BusRelay_port (BusRelay *relay);
+
+// Hand the messages with this ID to the server instead of relaying them
+void BusRelay_handle (BusRelay *relay, const char *ID, unsigned int len);
+
+// Whether a client gets broadcast messages; does nothing if the ID isn't a client's
+void BusRelay_setBroadcasts (BusRelay *relay, unsigned int id, int enabled);
+
+// Queue a frame for a client. Returns 0 if the ID isn't a connected client's.
+int BusRelay_send (BusRelay *relay, unsigned int id, const char *data, unsigned int len);
+
+// Disconnect a client now, what is queued for it is dropped
+void BusRelay_close (BusRelay *relay, unsigned int id);
+
+// Waits up to 'timeout' milliseconds (-1 for no limit) until a socket is ready, then accepts, reads, relays and
+// writes what it can. Returns the number of events for the server it added, or -1 if waiting failed.
+int BusRelay_run (BusRelay *relay, int timeout);
+
+// Calls 'take' with each event for the server, in order; returns their number. 'take' may send and close.
+typedef void (*BusRelay_takeFunc) (void *arg, unsigned int id, int type, const char *data, unsigned int len);
+unsigned int BusRelay_take (BusRelay *relay, BusRelay_takeFunc take, void *arg);
+
+// Number of connected clients
+unsigned int BusRelay_count (BusRelay *relay);
+
+// What is queued for a client, in frames and bytes. Returns 0 if the ID isn't a connected client's.
+int BusRelay_queue (BusRelay *relay, unsigned int id, unsigned int *frames, unsigned long *bytes);
+
+// Messages relayed so far, broadcasts counted once, and the frames queued for recipients for them
+unsigned long BusRelay_relayed (BusRelay *relay);
+unsigned long BusRelay_delivered (BusRelay *relay);
+
+// Disconnects everyone and frees the relay
+void BusRelay_free (BusRelay *relay);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _BUSRELAY_H_ */
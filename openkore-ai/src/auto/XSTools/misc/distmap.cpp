@@ -0,0 +1,404 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "distmap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Weight of a cell by its distance to the nearest wall, cells farther than the table get the last weight
+static const char distance_to_weight[6] = { -1, 60, 50, 20, 10, 0 };
+static const int max_distance = 5;
+
+static inline void
+rowWeights (const unsigned char *distances, int width, char *weights)
+{
+	int x;
+	for (x = 0; x < width; x++) {
+		weights[x] = distance_to_weight[(distances[x] > max_distance) ? max_distance : distances[x]];
+	}
+}
+
+// Same as rowWeights with the weights of a profile, see makeWeightProfile_inner
+static inline void
+rowProfileWeights (const unsigned char *distances, const char *walls, int width, const char *profile, int count, char *weights)
+{
+	int x;
+	for (x = 0; x < width; x++) {
+		int distance = (distances[x] > count) ? count : distances[x];
+		if (walls ? walls[x] == -1 : distance == 0) {
+			weights[x] = -1;
+		} else {
+			weights[x] = profile[(distance > 0) ? distance - 1 : 0];
+		}
+	}
+}
+
+// City block distance transform in two passes over the map, so the cost only depends on the map size.
+// Cells out of the map count as walls, so walkable cells on the border get 1. Distances saturate at 255.
+// Each pass first takes the row it comes from into account for the whole row, which the compiler can vectorize,
+// then runs along the row, which is the only part with a dependency between cells.
+// When 'weightMap' is not NULL, the weights of each row are written as soon as its distances are final, while the row is still in the cache.
+void
+makeFieldMaps_inner (const unsigned char *rawMap, int width, int height, unsigned char *data, char *weightMap)
+{
+	unsigned char *row;
+	const unsigned char *previous;
+	int x, y;
+
+	// Forward pass, distance through the south and west neighbors
+	for (y = 0; y < height; y++) {
+		row = data + (long) y * width;
+		previous = (y > 0) ? row - width : NULL;
+		for (x = 0; x < width; x++) {
+			// first bit is 'walkable' info
+			row[x] = (rawMap[(long) y * width + x] & 1) ? 255 : 0;
+		}
+		if (previous) {
+			for (x = 0; x < width; x++) {
+				unsigned char south = (previous[x] < 255) ? previous[x] + 1 : 255;
+				row[x] = (row[x] < south) ? row[x] : south;
+			}
+		} else {
+			for (x = 0; x < width; x++) {
+				row[x] = (row[x] < 1) ? row[x] : 1;
+			}
+		}
+		if (width > 0 && row[0] > 1) {
+			row[0] = 1;
+		}
+		for (x = 1; x < width; x++) {
+			if (row[x] > row[x - 1] + 1) {
+				row[x] = row[x - 1] + 1;
+			}
+		}
+	}
+
+	// Backward pass, distance through the north and east neighbors
+	for (y = height - 1; y >= 0; y--) {
+		row = data + (long) y * width;
+		previous = (y < height - 1) ? row + width : NULL;
+		if (previous) {
+			for (x = 0; x < width; x++) {
+				unsigned char north = (previous[x] < 255) ? previous[x] + 1 : 255;
+				row[x] = (row[x] < north) ? row[x] : north;
+			}
+		} else {
+			for (x = 0; x < width; x++) {
+				row[x] = (row[x] < 1) ? row[x] : 1;
+			}
+		}
+		if (width > 0 && row[width - 1] > 1) {
+			row[width - 1] = 1;
+		}
+		for (x = width - 2; x >= 0; x--) {
+			if (row[x] > row[x + 1] + 1) {
+				row[x] = row[x + 1] + 1;
+			}
+		}
+		if (weightMap) {
+			rowWeights (row, width, weightMap + (long) y * width);
+		}
+	}
+}
+
+void
+makeDistMap_inner (const unsigned char *rawMap, int width, int height, unsigned char *distMap)
+{
+	makeFieldMaps_inner (rawMap, width, height, distMap, NULL);
+}
+
+void
+makeWeightMap_inner (const unsigned char *distMap, int width, int height, char *weightMap)
+{
+	int y;
+	for (y = 0; y < height; y++) {
+		rowWeights (distMap + (long) y * width, width, weightMap + (long) y * width);
+	}
+}
+
+void
+makeWeightProfile_inner (const unsigned char *distMap, const char *walls, int width, int height, const char *profile, int count, char *weightMap)
+{
+	int y;
+	for (y = 0; y < height; y++) {
+		rowProfileWeights (distMap + (long) y * width, walls ? walls + (long) y * width : NULL, width, profile, count, weightMap + (long) y * width);
+	}
+}
+
+// A cell is walkable if the first bit of its raw data is set, see makeFieldMaps_inner
+#define WALKABLE(rawMap, i) ((rawMap)[i] & 1)
+
+static inline int
+onBorder (int width, int height, int x, int y)
+{
+	return x == 0 || y == 0 || x == width - 1 || y == height - 1;
+}
+
+// Whether a walkable cell still is 'distance' away from the nearest wall: a valid neighbor is one cell closer,
+// or it is on the border of the map, 1 away from the walls around the map
+static inline int
+isSupported (const unsigned char *distMap, const unsigned char *invalid, int width, int height, int x, int y, unsigned char distance)
+{
+	long i = (long) y * width + x;
+	if (distance == 1 && onBorder (width, height, x, y)) {
+		return 1;
+	}
+	return (x > 0 && !invalid[i - 1] && distMap[i - 1] == distance - 1)
+		|| (x < width - 1 && !invalid[i + 1] && distMap[i + 1] == distance - 1)
+		|| (y > 0 && !invalid[i - width] && distMap[i - width] == distance - 1)
+		|| (y < height - 1 && !invalid[i + width] && distMap[i + width] == distance - 1);
+}
+
+// Distance of a cell through its neighbor 'j', unless it is one which lost its distance
+static inline unsigned char
+through (const unsigned char *distMap, const unsigned char *invalid, long j, unsigned char best)
+{
+	if (invalid && invalid[j]) {
+		return best;
+	}
+	unsigned char distance = (distMap[j] < 255) ? distMap[j] + 1 : 255;
+	return (distance < best) ? distance : best;
+}
+
+// Dynamic breadth first repair of the distance transform. Removed walls only make distances grow: the cells which no longer
+// have a neighbor one cell closer to a wall lose their distance, one distance at a time from the removed walls on. Then the
+// new walls and the cells which lost their distance, with what their valid neighbors give them, are the seeds from which
+// distances spread in increasing order, to the cells they make closer to a wall only. Cells at 255 never lose their distance,
+// they are as far as can be told already.
+void
+repairDistMap_inner (const unsigned char *rawMap, int width, int height, const int *cells, int cellCount, unsigned char *distMap)
+{
+	unsigned long size = (unsigned long) width * height;
+	unsigned char *invalid;
+	long *queue, *seeds, head, tail, walls, seedCount, next;
+	long levels[256];
+	int c, level;
+
+	if (width <= 0 || height <= 0 || cellCount <= 0) {
+		return;
+	}
+	invalid = (unsigned char *) calloc (size, 1);
+	queue = (long *) malloc (size * sizeof (long));
+	seeds = (long *) malloc (size * sizeof (long));
+	if (!invalid || !queue || !seeds) {
+		free (invalid);
+		free (queue);
+		free (seeds);
+		makeDistMap_inner (rawMap, width, height, distMap);
+		return;
+	}
+
+	// The new walls are at 0 and seed the lowering, the removed ones lose their distance
+	head = tail = walls = 0;
+	for (c = 0; c < cellCount; c++) {
+		int x = cells[c * 2], y = cells[c * 2 + 1];
+		long i;
+		if (x < 0 || y < 0 || x >= width || y >= height) {
+			continue;
+		}
+		i = (long) y * width + x;
+		if (!WALKABLE(rawMap, i)) {
+			if (distMap[i] != 0) {
+				distMap[i] = 0;
+				seeds[walls++] = i;
+			}
+		} else if (distMap[i] == 0 && !invalid[i]) {
+			invalid[i] = 1;
+			queue[tail++] = i;
+		}
+	}
+
+	// Raise, the queue is in increasing order of the distances the cells had
+	while (head < tail) {
+		long i = queue[head++];
+		int x = (int) (i % width), y = (int) (i / width);
+		int n;
+		for (n = 0; n < 4; n++) {
+			int nx = x + ((n == 0) ? -1 : (n == 1) ? 1 : 0);
+			int ny = y + ((n == 2) ? -1 : (n == 3) ? 1 : 0);
+			long j;
+			if (nx < 0 || ny < 0 || nx >= width || ny >= height) {
+				continue;
+			}
+			j = (long) ny * width + nx;
+			if (invalid[j] || !WALKABLE(rawMap, j) || distMap[j] == 255 || distMap[j] != distMap[i] + 1) {
+				continue;
+			}
+			if (!isSupported (distMap, invalid, width, height, nx, ny, distMap[j])) {
+				invalid[j] = 1;
+				queue[tail++] = j;
+			}
+		}
+	}
+
+	// The cells which lost their distance get the best one their valid neighbors give them, the others skip them
+	memset (levels, 0, sizeof (levels));
+	for (head = 0; head < tail; head++) {
+		long i = queue[head];
+		int x = (int) (i % width), y = (int) (i / width);
+		unsigned char best = onBorder (width, height, x, y) ? 1 : 255;
+		if (x > 0) best = through (distMap, invalid, i - 1, best);
+		if (x < width - 1) best = through (distMap, invalid, i + 1, best);
+		if (y > 0) best = through (distMap, invalid, i - width, best);
+		if (y < height - 1) best = through (distMap, invalid, i + width, best);
+		distMap[i] = best;
+		levels[best]++;
+	}
+
+	// Seeds: the new walls, then the others sorted by distance
+	for (level = 0, seedCount = walls; level < 255; level++) {
+		long count = levels[level];
+		levels[level] = seedCount;
+		seedCount += count;
+	}
+	for (head = 0; head < tail; head++) {
+		long i = queue[head];
+		if (distMap[i] < 255) {
+			seeds[levels[distMap[i]]++] = i;
+		}
+	}
+
+	// Lower, merging the seeds with the breadth first queue, whose distances never decrease either
+	head = tail = next = 0;
+	while (next < seedCount || head < tail) {
+		long i;
+		int x, y, n;
+		if (head < tail && (next >= seedCount || distMap[queue[head]] <= distMap[seeds[next]])) {
+			i = queue[head++];
+		} else {
+			i = seeds[next++];
+		}
+		x = (int) (i % width);
+		y = (int) (i / width);
+		for (n = 0; n < 4; n++) {
+			int nx = x + ((n == 0) ? -1 : (n == 1) ? 1 : 0);
+			int ny = y + ((n == 2) ? -1 : (n == 3) ? 1 : 0);
+			long j;
+			if (nx < 0 || ny < 0 || nx >= width || ny >= height) {
+				continue;
+			}
+			j = (long) ny * width + nx;
+			if (WALKABLE(rawMap, j) && through (distMap, NULL, i, 255) < distMap[j]) {
+				distMap[j] = through (distMap, NULL, i, 255);
+				queue[tail++] = j;
+			}
+		}
+	}
+
+	free (invalid);
+	free (queue);
+	free (seeds);
+}
+
+// Distances of the cells of the window (x1, y1) - (x2, y2) of the raw map, like makeFieldMaps_inner with the field's border
+// only where the window touches it: the walls out of the window are not seen, so only the distances smaller than the
+// margin between a cell and the sides of the window which are inside the field are right.
+static void
+windowDistances (const unsigned char *rawMap, int width, int height, int x1, int y1, int x2, int y2, unsigned char *data)
+{
+	int windowWidth = x2 - x1 + 1;
+	unsigned char *row;
+	const unsigned char *previous;
+	int x, y;
+
+	// Forward pass, distance through the south and west neighbors
+	for (y = y1; y <= y2; y++) {
+		row = data + (long) (y - y1) * windowWidth;
+		previous = (y > y1) ? row - windowWidth : NULL;
+		for (x = 0; x < windowWidth; x++) {
+			row[x] = (rawMap[(long) y * width + x1 + x] & 1) ? 255 : 0;
+			if (previous ? row[x] > previous[x] + 1 : (y == 0 && row[x] > 1)) {
+				row[x] = previous ? previous[x] + 1 : 1;
+			}
+		}
+		if (x1 == 0 && row[0] > 1) {
+			row[0] = 1;
+		}
+		for (x = 1; x < windowWidth; x++) {
+			if (row[x] > row[x - 1] + 1) {
+				row[x] = row[x - 1] + 1;
+			}
+		}
+	}
+
+	// Backward pass, distance through the north and east neighbors
+	for (y = y2; y >= y1; y--) {
+		row = data + (long) (y - y1) * windowWidth;
+		previous = (y < y2) ? row + windowWidth : NULL;
+		for (x = 0; x < windowWidth; x++) {
+			if (previous ? row[x] > previous[x] + 1 : (y == height - 1 && row[x] > 1)) {
+				row[x] = previous ? previous[x] + 1 : 1;
+			}
+		}
+		if (x2 == width - 1 && row[windowWidth - 1] > 1) {
+			row[windowWidth - 1] = 1;
+		}
+		for (x = windowWidth - 2; x >= 0; x--) {
+			if (row[x] > row[x + 1] + 1) {
+				row[x] = row[x + 1] + 1;
+			}
+		}
+	}
+}
+
+// The weights which can change are those of the cells closer to a changed one than 'count', the distances get capped there.
+// The walls they are closer to than 'count' are within 2 * count of the changed cells, so their distances in a window that
+// much larger than the bounding box of the changed cells are right, the others are 'count' or more there too.
+void
+repairWeightProfile_inner (const unsigned char *rawMap, const char *walls, int width, int height, const int *cells, int cellCount, const char *profile, int count, char *weightMap)
+{
+	int minX = width, minY = height, maxX = -1, maxY = -1;
+	int x1, y1, x2, y2, windowWidth, x, y, c;
+	unsigned char *distances;
+
+	if (!profile) {
+		profile = distance_to_weight + 1;
+		count = max_distance;
+	}
+	for (c = 0; c < cellCount; c++) {
+		int cx = cells[c * 2], cy = cells[c * 2 + 1];
+		if (cx < 0 || cy < 0 || cx >= width || cy >= height) {
+			continue;
+		}
+		minX = (cx < minX) ? cx : minX;
+		minY = (cy < minY) ? cy : minY;
+		maxX = (cx > maxX) ? cx : maxX;
+		maxY = (cy > maxY) ? cy : maxY;
+	}
+	if (maxX < 0 || count < 1) {
+		return;
+	}
+
+	x1 = (minX - 2 * count > 0) ? minX - 2 * count : 0;
+	y1 = (minY - 2 * count > 0) ? minY - 2 * count : 0;
+	x2 = (maxX + 2 * count < width - 1) ? maxX + 2 * count : width - 1;
+	y2 = (maxY + 2 * count < height - 1) ? maxY + 2 * count : height - 1;
+	windowWidth = x2 - x1 + 1;
+	distances = (unsigned char *) malloc ((size_t) windowWidth * (y2 - y1 + 1));
+	if (!distances) {
+		return;
+	}
+	windowDistances (rawMap, width, height, x1, y1, x2, y2, distances);
+
+	for (y = (minY - count + 1 > 0) ? minY - count + 1 : 0; y <= maxY + count - 1 && y < height; y++) {
+		int from = (minX - count + 1 > 0) ? minX - count + 1 : 0;
+		int to = (maxX + count - 1 < width - 1) ? maxX + count - 1 : width - 1;
+		long offset = (long) y * width;
+		for (x = from; x <= to; x++) {
+			int distance = distances[(long) (y - y1) * windowWidth + x - x1];
+			distance = (distance > count) ? count : distance;
+			if (walls ? walls[offset + x] == -1 : distance == 0) {
+				weightMap[offset + x] = -1;
+			} else {
+				weightMap[offset + x] = profile[(distance > 0) ? distance - 1 : 0];
+			}
+		}
+	}
+	free (distances);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,38 @@
+#ifndef _DISTMAP_H_
+#define _DISTMAP_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Field map preprocessing shared by Utils::makeDistMap, Utils::makeWeightMap, Utils::makeFieldMaps and the native benchmark.
+// All maps are width * height bytes, indexed by y * width + x.
+
+// Fills 'distMap' with the distance of every walkable cell of the raw field data to the nearest wall, 0 for walls
+void makeDistMap_inner (const unsigned char *rawMap, int width, int height, unsigned char *distMap);
+
+// Fills both maps in a single run over the raw field data, the same as makeDistMap_inner followed by makeWeightMap_inner
+void makeFieldMaps_inner (const unsigned char *rawMap, int width, int height, unsigned char *distMap, char *weightMap);
+
+// Fills 'weightMap' with the pathfinding weight of every cell of a distance map, -1 for walls
+void makeWeightMap_inner (const unsigned char *distMap, int width, int height, char *weightMap);
+
+// Fills 'weightMap' like makeWeightMap_inner with the weights of a profile: profile[i] is the weight of the cells i + 1 cells
+// away from the nearest wall, the cells farther than 'count' get the last one. The walls are the cells which are -1 in 'walls',
+// the weight map the profile is an alternative to, or the cells at distance 0 if it is NULL.
+void makeWeightProfile_inner (const unsigned char *distMap, const char *walls, int width, int height, const char *profile, int count, char *weightMap);
+
+// Repairs in place the distance map of the raw field data after some of its cells were changed. 'cells' holds the x and y of the
+// 'cellCount' changed cells, the raw map already has their new values. Only the cells whose distance changes are visited.
+void repairDistMap_inner (const unsigned char *rawMap, int width, int height, const int *cells, int cellCount, unsigned char *distMap);
+
+// Repairs in place a weight map made by makeWeightProfile_inner from the distance map of the raw field data, or by
+// makeWeightMap_inner if 'profile' is NULL, after some of its cells were changed: only the cells closer to a changed one than the
+// profile has weights can get another weight, their distances are made again from the raw map around the changed cells.
+void repairWeightProfile_inner (const unsigned char *rawMap, const char *walls, int width, int height, const int *cells, int cellCount, const char *profile, int count, char *weightMap);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _DISTMAP_H_ */
@@ -2,15 +2,753 @@
 #include <stdio.h>
 #include <string.h>
 #include <string>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+#include <zlib.h>
 #include "EXTERN.h"
 #include "perl.h"
 #include "XSUB.h"
+#include "distmap.h"
+#include "../PathFinding/algorithm.h"
+#include "fieldcache.h"
+#include "fieldchunks.h"
+#include "proxyrelay.h"
+#include "busrelay.h"
+#include "netmux.h"
+#include "fieldprefetch.h"
+#include "fieldimage.h"
+#include "tokenizer.h"
+#include "unpacker.h"
+#include "ticktimer.h"
+#include "timerwheel.h"
+#include "../utils/cpu-features.h"
+#include "../utils/c-bindings/executor.h"
 
 typedef double (*NVtime_t) ();
 static void *NVtime = NULL;
 
 using namespace std;
 
+struct IDHash {
+	size_t operator()(const string &key) const {
+		/* FNV-1a */
+		size_t hash = 2166136261U;
+		for (string::const_iterator it = key.begin(); it != key.end(); it++) {
+			hash = (hash ^ (unsigned char) *it) * 16777619U;
+		}
+		return hash;
+	}
+};
+
+/* Slots of the IDs of an array maintained with binAdd() and binRemove(): a new ID takes the lowest free slot. */
+class IDIndex {
+private:
+	typedef unordered_map<string, int, IDHash> SlotMap;
+
+	SlotMap slots;
+	priority_queue<int, vector<int>, greater<int> > freeSlots;
+	int end;
+public:
+	IDIndex() {
+		end = 0;
+	}
+
+	int add(const char *ID, STRLEN len) {
+		string k(ID, len);
+		SlotMap::iterator it = slots.find(k);
+		if (it != slots.end())
+			return it->second;
+		int slot;
+		if (freeSlots.empty()) {
+			slot = end++;
+		} else {
+			slot = freeSlots.top();
+			freeSlots.pop();
+		}
+		slots[k] = slot;
+		return slot;
+	}
+
+	int remove(const char *ID, STRLEN len) {
+		SlotMap::iterator it = slots.find(string(ID, len));
+		if (it == slots.end())
+			return -1;
+		int slot = it->second;
+		slots.erase(it);
+		freeSlots.push(slot);
+		return slot;
+	}
+
+	int find(const char *ID, STRLEN len) const {
+		SlotMap::const_iterator it = slots.find(string(ID, len));
+		return (it == slots.end()) ? -1 : it->second;
+	}
+
+	int size() const {
+		return (int) slots.size();
+	}
+
+	void clear() {
+		slots.clear();
+		freeSlots = priority_queue<int, vector<int>, greater<int> >();
+		end = 0;
+	}
+};
+
+/* Returns the FieldCache of a Utils::FieldCache object, croaks if it is closed */
+static FieldCache *
+fieldCacheOf (SV *self)
+{
+	if (!SvROK (self) || !sv_derived_from (self, "Utils::FieldCache"))
+		croak ("not a Utils::FieldCache object");
+	FieldCache *cache = INT2PTR (FieldCache *, SvIV (SvRV (self)));
+	if (!cache)
+		croak ("the field cache is closed");
+	return cache;
+}
+
+/* Returns the FieldChunks of a Utils::FieldChunks object */
+static FieldChunks *
+fieldChunksOf (SV *self)
+{
+	if (!SvROK (self) || !sv_derived_from (self, "Utils::FieldChunks"))
+		croak ("not a Utils::FieldChunks object");
+	return INT2PTR (FieldChunks *, SvIV (SvRV (self)));
+}
+
+/* Returns the IDIndex of a Utils::IDIndex object */
+static IDIndex *
+idIndexOf (SV *self)
+{
+	if (!SvROK (self) || !sv_derived_from (self, "Utils::IDIndex"))
+		croak ("not a Utils::IDIndex object");
+	return INT2PTR (IDIndex *, SvIV (SvRV (self)));
+}
+
+/* Returns the Tokenizer of a Network::MessageTokenizer::Native object */
+static Tokenizer *
+tokenizerOf (SV *self)
+{
+	if (!SvROK (self) || !sv_derived_from (self, "Network::MessageTokenizer::Native"))
+		croak ("not a Network::MessageTokenizer::Native object");
+	return INT2PTR (Tokenizer *, SvIV (SvRV (self)));
+}
+
+/* Sets the message lengths of a tokenizer from a recvpackets hash */
+static void
+setTokenizerLengths (Tokenizer *tokenizer, HV *rpackets)
+{
+	HE *entry;
+
+	Tokenizer_clearLengths (tokenizer);
+	hv_iterinit (rpackets);
+	while ((entry = hv_iternext (rpackets)) != NULL) {
+		I32 keyLen;
+		const char *key = hv_iterkey (entry, &keyLen);
+		SV *value = hv_iterval (rpackets, entry);
+		SV **length;
+		unsigned int id = 0;
+		int i;
+
+		/* Message IDs are looked up as 4 upper case hex digits */
+		if (keyLen != 4)
+			continue;
+		for (i = 0; i < 4; i++) {
+			char c = key[i];
+			if (c >= '0' && c <= '9')
+				id = id * 16 + c - '0';
+			else if (c >= 'A' && c <= 'F')
+				id = id * 16 + c - 'A' + 10;
+			else
+				break;
+		}
+		if (i < 4 || !SvROK (value) || SvTYPE (SvRV (value)) != SVt_PVHV)
+			continue;
+
+		length = hv_fetch ((HV *) SvRV (value), "length", 6, 0);
+		if (length && SvOK (*length))
+			Tokenizer_setLength (tokenizer, id, (int) SvIV (*length));
+	}
+}
+
+/* Returns the ProxyRelay of a Network::XKoreProxy::Relay object */
+static ProxyRelay *
+proxyRelayOf (SV *self)
+{
+	if (!SvROK (self) || !sv_derived_from (self, "Network::XKoreProxy::Relay"))
+		croak ("not a Network::XKoreProxy::Relay object");
+	return INT2PTR (ProxyRelay *, SvIV (SvRV (self)));
+}
+
+/* The operating system's handle of a Perl socket */
+static ProxyRelay_socket
+socketHandle (pTHX_ SV *socket)
+{
+	IO *io = sv_2io (socket);
+	int fd = (io && IoIFP (io)) ? PerlIO_fileno (IoIFP (io)) : -1;
+
+	if (fd < 0)
+		croak ("not an open socket");
+#ifdef WIN32
+	return (ProxyRelay_socket) win32_get_osfhandle (fd);
+#else
+	return fd;
+#endif
+}
+
+/* Collects the messages taken from a relay: all of them in 'data', the forwarded ones in 'forwarded' too */
+typedef struct {
+	SV *data;
+	AV *forwarded;
+} RelayTaken;
+
+static void
+takeRelayed (void *arg, const char *data, unsigned int len, int forwarded)
+{
+	dTHX;
+	RelayTaken *taken = (RelayTaken *) arg;
+
+	sv_catpvn (taken->data, data, len);
+	if (forwarded)
+		av_push (taken->forwarded, newSVpvn (data, len));
+}
+
+/* Returns the NetMux of a Network::Multiplexer::Native object */
+static NetMux *
+netMuxOf (SV *self)
+{
+	if (!SvROK (self) || !sv_derived_from (self, "Network::Multiplexer::Native"))
+		croak ("not a Network::Multiplexer::Native object");
+	return INT2PTR (NetMux *, SvIV (SvRV (self)));
+}
+
+/* Collects the events taken from a multiplexer, as (id, type, data) triples */
+static void
+takeMuxEvent (void *arg, int id, int type, const char *data, unsigned int len)
+{
+	dTHX;
+	AV *events = (AV *) arg;
+
+	av_push (events, newSViv (id));
+	av_push (events, newSViv (type));
+	av_push (events, newSVpvn (data, len));
+}
+
+/* Returns the BusRelay of a Bus::Server::Relay object */
+static BusRelay *
+busRelayOf (SV *self)
+{
+	if (!SvROK (self) || !sv_derived_from (self, "Bus::Server::Relay"))
+		croak ("not a Bus::Server::Relay object");
+	return INT2PTR (BusRelay *, SvIV (SvRV (self)));
+}
+
+/* Collects the events taken from a bus relay, as (id, type, data) triples */
+static void
+takeBusEvent (void *arg, unsigned int id, int type, const char *data, unsigned int len)
+{
+	dTHX;
+	AV *events = (AV *) arg;
+
+	av_push (events, newSVuv (id));
+	av_push (events, newSViv (type));
+	av_push (events, newSVpvn (data, len));
+}
+
+/* A new byte string with len bytes of the tokenizer's data, starting at offset */
+static SV *
+tokenizerData (Tokenizer *tokenizer, unsigned int offset, unsigned int len)
+{
+	/* newSV (0) wouldn't allocate a buffer */
+	SV *result = newSV (len + 1);
+	Tokenizer_copy (tokenizer, offset, len, SvPVX (result));
+	SvPVX (result)[len] = '\0';
+	SvCUR_set (result, len);
+	SvPOK_on (result);
+	return result;
+}
+
+
+/* The time, as Time::HiRes::time() returns it */
+static NV
+currentTime ()
+{
+	if (!NVtime) {
+		SV **svp = hv_fetch (PL_modglobal, "Time::NVtime", 12, 0);
+		if (!svp)
+			croak("Time::HiRes is required");
+		if (!SvIOK (*svp))
+			croak("Time::NVtime isn't a function pointer");
+		NVtime = INT2PTR (void *, SvIV (*svp));
+	}
+	return ((NVtime_t) NVtime) ();
+}
+
+/* A timer wheel, with the names of its timers */
+typedef struct {
+	TimerWheel *wheel;
+	/* Timer IDs by name, and names by ID */
+	HV *ids;
+	AV *names;
+} NamedTimerWheel;
+
+static NamedTimerWheel *
+timerWheelOf (SV *self)
+{
+	if (!SvROK (self) || !sv_derived_from (self, "Utils::TimerWheel"))
+		croak ("not a Utils::TimerWheel object");
+	return INT2PTR (NamedTimerWheel *, SvIV (SvRV (self)));
+}
+
+/* The ID of the timer with this name, registering it if create is set; -1 if there is none */
+static long
+timerOf (NamedTimerWheel *self, SV *name, int create)
+{
+	STRLEN len;
+	const char *key = SvPV (name, len);
+	SV **id = hv_fetch (self->ids, key, SvUTF8 (name) ? -(I32) len : (I32) len, 0);
+	long timer;
+
+	if (id)
+		return (long) SvIV (*id);
+	if (!create)
+		return -1;
+	timer = TimerWheel_add (self->wheel);
+	(void) hv_store (self->ids, key, SvUTF8 (name) ? -(I32) len : (I32) len, newSViv (timer), 0);
+	av_store (self->names, timer, newSVsv (name));
+	return timer;
+}
+
+/* The control tables Misc::items_control(), Misc::mon_control() and Misc::pickupitems()
+   look up, which are keyed by lowercased name or by the ID of the item or monster */
+#define CONTROL_ITEMS 0
+#define CONTROL_MONSTERS 1
+#define CONTROL_PICKUP 2
+#define CONTROL_NAME_SIZE 128
+#define CONTROL_FOLDED_MAX 4096
+
+static const char *controlTableNames[] = { "Globals::items_control", "Globals::mon_control", "Globals::pickupitems" };
+static GV *controlTables[3];
+/* Lowercased names which needed lc(), by name */
+static HV *controlFolded = NULL;
+
+static HV *
+controlTable (int table)
+{
+	if (!controlTables[table])
+		controlTables[table] = gv_fetchpv (controlTableNames[table], GV_ADD, SVt_PVHV);
+	return GvHVn (controlTables[table]);
+}
+
+/* The entry of a key, or NULL if it doesn't count: pickupitems entries count if
+   they exist, the others if they're true */
+static SV *
+controlEntry (HV *hv, int table, const char *key, I32 klen)
+{
+	SV **value = hv_fetch (hv, key, klen, 0);
+	if (!value)
+		return NULL;
+	if (table != CONTROL_PICKUP && !SvTRUE (*value))
+		return NULL;
+	return *value;
+}
+
+/* The entry of a name, looked up lowercased like lc() does: ASCII names and
+   byte strings are lowercased here, other names go through lc() once */
+static SV *
+controlNameEntry (HV *hv, int table, SV *name)
+{
+	char buffer[CONTROL_NAME_SIZE];
+	STRLEN len, i;
+	const char *str = SvPV (name, len);
+	int ascii = 1;
+	SV **folded;
+
+	if (len < CONTROL_NAME_SIZE) {
+		for (i = 0; i < len; i++) {
+			unsigned char c = str[i];
+			if (c >= 0x80)
+				ascii = 0;
+			buffer[i] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+		}
+		if (ascii || !SvUTF8 (name))
+			return controlEntry (hv, table, buffer, (I32) len);
+	}
+
+	if (!controlFolded)
+		controlFolded = newHV ();
+	folded = hv_fetch (controlFolded, str, SvUTF8 (name) ? -(I32) len : (I32) len, 0);
+	if (!folded) {
+		dSP;
+		SV *result;
+		int count;
+
+		if (HvUSEDKEYS (controlFolded) >= CONTROL_FOLDED_MAX)
+			hv_clear (controlFolded);
+		ENTER;
+		SAVETMPS;
+		PUSHMARK (SP);
+		XPUSHs (name);
+		PUTBACK;
+		count = call_pv ("Misc::lowercaseName", G_SCALAR);
+		SPAGAIN;
+		result = (count == 1) ? newSVsv (POPs) : newSVpvs ("");
+		PUTBACK;
+		FREETMPS;
+		LEAVE;
+		folded = hv_store (controlFolded, str, SvUTF8 (name) ? -(I32) len : (I32) len, result, 0);
+	}
+	str = SvPV (*folded, len);
+	return controlEntry (hv, table, str, SvUTF8 (*folded) ? -(I32) len : (I32) len);
+}
+
+/* %Plugins::subscribers: the callbacks of every hook which has any, as
+   Plugins::callHook() calls them */
+static GV *hookSubscribersGV = NULL;
+
+static AV *
+hookSubscribers (SV *hookName)
+{
+	HE *he;
+	SV *list;
+
+	if (!hookSubscribersGV)
+		hookSubscribersGV = gv_fetchpv ("Plugins::subscribers", GV_ADD, SVt_PVHV);
+	he = hv_fetch_ent (GvHVn (hookSubscribersGV), hookName, 0, 0);
+	if (!he)
+		return NULL;
+	list = HeVAL (he);
+	if (!SvROK (list) || SvTYPE (SvRV (list)) != SVt_PVAV)
+		return NULL;
+	return (AV *) SvRV (list);
+}
+
+/* %Log::filter: for each domain logged so far, a bit for each message type and
+   level which Log.pm would print, write or give to a hook, see Log::compileFilter().
+   Types take 8 bits each, in the order of LOG_TYPES; the last bit of a type is
+   for its levels from LOG_LEVELS - 1 up. */
+#define LOG_LEVELS 8
+static const char LOG_TYPES[] = "mwed";
+static GV *logFilterGV = NULL;
+
+/* The bit of a message type, by the first letter of its name */
+static int
+logTypeOf (SV *type)
+{
+	const char *name = SvPV_nolen (type);
+	const char *found = name[0] ? strchr (LOG_TYPES, name[0]) : NULL;
+
+	if (!found)
+		croak ("Invalid log message type");
+	return (int) (found - LOG_TYPES);
+}
+
+/* Whether a message is wanted; negative levels aren't in the filter and always are */
+static bool
+logWanted (int type, SV *domain, SV *level)
+{
+	HE *he;
+	UV mask;
+	IV lv;
+
+	if (!SvTRUE (domain))
+		domain = sv_2mortal (newSVpvs ("console"));
+	lv = SvOK (level) ? SvIV (level) : (LOG_TYPES[type] == 'd');
+	if (lv < 0)
+		return true;
+	if (lv >= LOG_LEVELS)
+		lv = LOG_LEVELS - 1;
+
+	if (!logFilterGV)
+		logFilterGV = gv_fetchpv ("Log::filter", GV_ADD, SVt_PVHV);
+	he = hv_fetch_ent (GvHVn (logFilterGV), domain, 0, 0);
+	if (he) {
+		mask = SvUV (HeVAL (he));
+	} else {
+		/* Compiled once per domain, after which it's in the filter */
+		dSP;
+		int count;
+
+		ENTER;
+		SAVETMPS;
+		PUSHMARK (SP);
+		XPUSHs (domain);
+		PUTBACK;
+		count = call_pv ("Log::compileFilter", G_SCALAR);
+		SPAGAIN;
+		if (count == 1) {
+			SV *result = POPs;
+			mask = SvUV (result);
+		} else {
+			mask = ~(UV) 0;
+		}
+		PUTBACK;
+		FREETMPS;
+		LEAVE;
+	}
+	return (mask >> (type * LOG_LEVELS + lv)) & 1;
+}
+
+/* A compiled packet template, and the shared keys its values are stored under */
+typedef struct {
+	Unpacker *unpacker;
+	unsigned int keyCount;
+	SV **keys;
+} PacketUnpacker;
+
+/* A phase ID, from its name or its ID; undef is the tick itself */
+static int
+tickPhaseOf (SV *phase)
+{
+	int id;
+
+	if (!SvOK (phase))
+		return TICKTIMER_TICK;
+	if (SvIOK (phase) && !SvPOK (phase))
+		id = SvIV (phase);
+	else
+		id = TickTimer_phase (SvPV_nolen (phase));
+	if (id < 0 || id >= TickTimer_phaseCount ())
+		croak ("Invalid tick phase");
+	return id;
+}
+
+/* Bit strings of shiftPack() and unShiftPack(): big-endian numbers, without leading zero bytes */
+
+/* Sets data to the bytes of a big-endian number, without its leading zero bytes */
+static void
+setPacked (SV *data, const unsigned char *bytes, STRLEN len)
+{
+	while (len > 0 && bytes[0] == 0) {
+		bytes++;
+		len--;
+	}
+	sv_setpvn_mg (data, (const char *) bytes, len);
+}
+
+/* The number at the end of a bit string, up to 8 bytes of it */
+static unsigned long long
+packedTail (const unsigned char *bytes, STRLEN len)
+{
+	unsigned long long value = 0;
+	STRLEN i = (len > 8) ? len - 8 : 0;
+
+	for (; i < len; i++)
+		value = (value << 8) | bytes[i];
+	return value;
+}
+
+/* Sets data to the bit string of bytes, shifted right by bits */
+static void
+setShiftedRight (SV *data, const unsigned char *bytes, STRLEN len, unsigned int bits)
+{
+	STRLEN outLen = (len > bits / 8) ? len - bits / 8 : 0, i;
+	unsigned int shift = bits % 8;
+	unsigned char *out;
+
+	Newx (out, outLen + 1, unsigned char);
+	for (i = 0; i < outLen; i++) {
+		out[i] = bytes[i] >> shift;
+		if (i > 0)
+			out[i] |= (unsigned char) (bytes[i - 1] << (8 - shift));
+	}
+	setPacked (data, out, outLen);
+	Safefree (out);
+}
+
+/* Stores the coordinates at the end of value, y in the lowest 10 bits */
+static void
+storeCoords (SV *r_hash, unsigned long long value)
+{
+	HV *hash;
+
+	if (!SvROK (r_hash) || SvTYPE (SvRV (r_hash)) != SVt_PVHV)
+		croak ("Coordinates must be stored in a hash");
+	hash = (HV *) SvRV (r_hash);
+	/* Assigned like $r_hash->{y} = ... would */
+	sv_setiv_mg (*hv_fetchs (hash, "y", 1), (IV) (value & 0x3FF));
+	sv_setiv_mg (*hv_fetchs (hash, "x", 1), (IV) ((value >> 10) & 0x3FF));
+}
+
+static PacketUnpacker *
+packetUnpackerOf (SV *self)
+{
+	if (!SvROK (self) || !sv_derived_from (self, "Network::PacketParser::Unpacker"))
+		croak ("not a Network::PacketParser::Unpacker object");
+	return INT2PTR (PacketUnpacker *, SvIV (SvRV (self)));
+}
+
+/* The x and y of the cells packed with pack("v*"), as taken by the repair functions. Free the result with Safefree. */
+static int *
+changedCells (SV *cells, int *count)
+{
+	STRLEN len;
+	const unsigned char *packed;
+	int *coords;
+	int i;
+
+	if (!SvOK (cells))
+		croak ("cells must be packed with pack(\"v*\", x, y, ...)");
+	packed = (const unsigned char *) SvPVbyte (cells, len);
+	*count = (int) (len / 4);
+	New (0, coords, *count * 2 + 1, int);
+	for (i = 0; i < *count * 2; i++) {
+		coords[i] = packed[i * 2] | (packed[i * 2 + 1] << 8);
+	}
+	return coords;
+}
+
+/* The map of a reference to a scalar, which the repair functions change in place */
+static unsigned char *
+repairedMap (SV *map, const char *name, int width, int height)
+{
+	STRLEN len;
+	unsigned char *data;
+
+	if (!SvROK (map) || SvROK (SvRV (map)))
+		croak ("%s must be a reference to a string", name);
+	data = (unsigned char *) SvPV_force (SvRV (map), len);
+	if (width <= 0 || height <= 0 || len != (STRLEN) width * height)
+		croak ("%s is not a %d x %d map", name, width, height);
+	return data;
+}
+
+/* The weights of a weight profile, see Utils::makeWeightProfile(). Returns their count. */
+static int
+profileWeights (SV *profile, char *weights, int max)
+{
+	AV *list;
+	int count, i;
+
+	/* The weights are the ones of the cells 1, 2, 3... cells away from the nearest wall, between 0 and 127 */
+	if (!SvROK (profile) || SvTYPE (SvRV (profile)) != SVt_PVAV)
+		croak ("profile must be a reference to an array of weights");
+	list = (AV *) SvRV (profile);
+	count = av_len (list) + 1;
+	if (count < 1 || count > max)
+		croak ("a weight profile has between 1 and %d weights", max);
+	for (i = 0; i < count; i++) {
+		SV **weight = av_fetch (list, i, 0);
+		IV value = (weight && SvOK (*weight)) ? SvIV (*weight) : -1;
+		if (value < 0 || value > 127)
+			croak ("the weights of a profile are between 0 and 127");
+		weights[i] = (char) value;
+	}
+	return count;
+}
+
+/* Bus messages, see Bus::Messages for the format. Strings are stored as their UTF-8 bytes when they have the
+   UTF8 flag and as they are otherwise, like encode_utf8() only does for the former. */
+
+static void
+busAppendInt24 (SV *out, STRLEN value)
+{
+	char bytes[3];
+
+	bytes[0] = (char) ((value >> 16) & 0xFF);
+	bytes[1] = (char) ((value >> 8) & 0xFF);
+	bytes[2] = (char) (value & 0xFF);
+	sv_catpvn (out, bytes, 3);
+}
+
+/* A value of a map or array entry: undef and binary strings are type 0, UTF-8 strings type 1 and runs of digits,
+   which valueToData() takes for integers as /^\d+$/ does, type 2 */
+static void
+busAppendValue (SV *out, SV *value)
+{
+	STRLEN len, i;
+	const char *data;
+	char header[4];
+
+	if (!value || !SvOK (value)) {
+		sv_catpvn (out, "\0\0\0\0", 4);
+		return;
+	}
+	data = SvPV (value, len);
+	i = 0;
+	while (i < len && data[i] >= '0' && data[i] <= '9')
+		i++;
+	if (i > 0 && (i == len || (i == len - 1 && data[i] == '\n'))) {
+		U32 number = (U32) SvUV (value);
+		char bytes[8] = { 2, 0, 0, 4 };
+
+		bytes[4] = (char) ((number >> 24) & 0xFF);
+		bytes[5] = (char) ((number >> 16) & 0xFF);
+		bytes[6] = (char) ((number >> 8) & 0xFF);
+		bytes[7] = (char) (number & 0xFF);
+		sv_catpvn (out, bytes, 8);
+		return;
+	}
+	header[0] = SvUTF8 (value) ? 1 : 0;
+	sv_catpvn (out, header, 1);
+	busAppendInt24 (out, len);
+	sv_catpvn (out, data, len);
+}
+
+/* Bounds of a message being read: reads past the end get the bytes which are there, as unpack() and substr() do */
+typedef struct {
+	const unsigned char *data;
+	STRLEN size;
+	STRLEN offset;
+} BusReader;
+
+static unsigned int
+busReadByte (BusReader *reader)
+{
+	if (reader->offset >= reader->size) {
+		reader->offset++;
+		return 0;
+	}
+	return reader->data[reader->offset++];
+}
+
+/* The next len bytes, or as many as there are; returns their count */
+static STRLEN
+busReadBytes (BusReader *reader, STRLEN len, const char **bytes)
+{
+	STRLEN available = reader->offset < reader->size ? reader->size - reader->offset : 0;
+
+	if (len > available)
+		len = available;
+	*bytes = (const char *) reader->data + reader->offset;
+	reader->offset += len;
+	return len;
+}
+
+/* A length, which is 0 if the data ends before its 3 bytes, like fromInt24() of them gives */
+static STRLEN
+busReadInt24 (BusReader *reader)
+{
+	const unsigned char *bytes;
+	STRLEN start = reader->offset;
+
+	if (busReadBytes (reader, 3, (const char **) &bytes) != 3) {
+		reader->offset = start + 3;
+		return 0;
+	}
+	return ((STRLEN) bytes[0] << 16) | ((STRLEN) bytes[1] << 8) | bytes[2];
+}
+
+/* A value as dataToValue() makes it: keeps the bytes of binary values, turns the UTF8 flag on for UTF-8 values
+   and reads integers. Returns NULL for an integer which isn't 4 bytes long, whose length is then in *len. */
+static SV *
+busValue (unsigned int type, const char *bytes, STRLEN *len)
+{
+	SV *value;
+
+	if (type == 2) {
+		const unsigned char *number = (const unsigned char *) bytes;
+
+		if (*len != 4)
+			return NULL;
+		return newSVuv (((U32) number[0] << 24) | ((U32) number[1] << 16) | ((U32) number[2] << 8) | number[3]);
+	}
+	value = newSVpvn (bytes, *len);
+	if (type == 1)
+		SvUTF8_on (value);
+	return value;
+}
 
 MODULE = FastUtils	PACKAGE = Utils
 PROTOTYPES: ENABLE
@@ -89,15 +827,7 @@ timeOut(r_time, compare_time = NULL)
 			if (!(v_timeout = SvNV (compare_time)))
 				XSRETURN_YES;
 
-			if (!NVtime) {
-				SV **svp = hv_fetch (PL_modglobal, "Time::NVtime", 12, 0);
-				if (!svp)
-					croak("Time::HiRes is required");
-				if (!SvIOK (*svp))
-					croak("Time::NVtime isn't a function pointer");
-				NVtime = INT2PTR (void *, SvIV (*svp));
-			}
-			current_time = ((NVtime_t) NVtime) ();
+			current_time = currentTime ();
 
 		} else {
 			/* r_time is a hash */
@@ -113,15 +843,7 @@ timeOut(r_time, compare_time = NULL)
 			if (!(sv_timeout = hv_fetch (hash, "timeout", 7, 0)) || !(v_timeout = SvNV (*sv_timeout)))
 				XSRETURN_YES;
 
-			if (!NVtime) {
-				SV **svp = hv_fetch (PL_modglobal, "Time::NVtime", 12, 0);
-				if (!svp)
-					croak("Time::HiRes is required");
-				if (!SvIOK (*svp))
-					croak("Time::NVtime isn't a function pointer");
-				NVtime = INT2PTR (void *, SvIV (*svp));
-			}
-			current_time = ((NVtime_t) NVtime) ();
+			current_time = currentTime ();
 		}
 
 		RETVAL = (current_time - v_time > v_timeout);
@@ -129,69 +851,45 @@ timeOut(r_time, compare_time = NULL)
 		RETVAL
 
 
-char *
+SV *
 xpmmake(width, height, field_data)
 	int width
 	int height
 	char *field_data
+INIT:
+	unsigned long size;
 CODE:
-	// Create an XPM from raw field data.
-	// Written in C++ for speed.
-	string data;
-	int y, x;
-	char tmp[10], *buf, *line;
-
-	data.reserve (width * height + 1024);
-	data.append (
-		"/* XPM */\n"
-		"static char * my_xpm[] = {\n"
-		"\"");
-	snprintf (tmp, sizeof (tmp), "%d %d", width, height);
-	data.append (tmp);
-	data.append (" 8 1\",\n"
-		"\"A\tc #313131\",\n"
-		"\"B\tc #FAFAFA\",\n"
-		"\"C\tc #CCA86C\",\n"
-		"\"D\tc #0088CC\",\n"
-		"\"E\tc #399BCC\",\n"
-		"\"F\tc #696262\",\n"
-		"\"G\tc #CCA86C\",\n"
-		"\"H\tc #313131\",\n");
-
-	line = (char *) malloc (width);
-	for (y = height - 1; y >= 0; y--) {
-		for (x = 0; x < width; x++) {
-			int tile = field_data[y * width + x];
-			if(tile&0) { // TILE_NOWALK
-				line[x] = 'A';
-			} else if(tile&1 && tile&4) {// TILE_WALK and TILE_WATER
-				line[x] = 'E';
-			} else if(tile&1) { // TILE_WALK
-				line[x] = 'B';
-			} else if(tile&4) { // TILE_WATER
-				line[x] = 'D';
-			} else if(tile&2 && tile&8) { // TILE_SNIPE and TILE_CLIFF
-				line[x] = 'G';
-			} else if(tile&2) { // TILE_SNIPE
-				line[x] = 'C';
-			} else if(tile&8) { // TILE_CLIFF
-				line[x] = 'F';
-			} else{ 
-				line[x] = 'H';
-			}
-		}
-		data.append ("\"");
-		data.append (line, width);
-		data.append ("\",\n");
-	}
-	free (line);
-	data.append ("};\n");
+	/* Create an XPM from raw field data, written right into the buffer of the returned scalar */
+	size = FieldImage_xpmSize (width, height);
+	RETVAL = newSV (size);
+	SvPOK_only (RETVAL);
+	FieldImage_renderXPM ((const unsigned char *) field_data, width, height, SvPVX (RETVAL));
+	SvCUR_set (RETVAL, size);
+	*SvEND (RETVAL) = '\0';
+OUTPUT:
+	RETVAL
+
+
+SV *
+fieldImage(rawMap, width, height)
+	SV *rawMap
+	int width
+	int height
+INIT:
+	STRLEN len;
+	unsigned char *c_rawMap;
+CODE:
+	if (!SvOK (rawMap))
+		XSRETURN_UNDEF;
+
+	c_rawMap = (unsigned char *) SvPV (rawMap, len);
+	if (width <= 0 || height <= 0 || (int) len != width * height)
+		XSRETURN_UNDEF;
 
-	// I hope sizeof(char) == 1...
-	New (0, buf, data.size () + 1, char);
-	Copy (data.c_str (), buf, data.size (), char);
-	buf[data.size ()] = '\0';
-	RETVAL = buf;
+	RETVAL = newSV (len * 3);
+	SvPOK_only (RETVAL);
+	FieldImage_renderRGB (c_rawMap, width, height, (unsigned char *) SvPVX (RETVAL));
+	SvCUR_set (RETVAL, len * 3);
 OUTPUT:
 	RETVAL
 
@@ -203,10 +901,7 @@ makeDistMap(rawMap, width, height)
 	int height
 INIT:
 	STRLEN len;
-	int i, x, y;
-	int dist_current, val;
 	unsigned char *c_rawMap, *data;
-	bool done;
 CODE:
 	if (!SvOK (rawMap))
 		XSRETURN_UNDEF;
@@ -215,137 +910,96 @@ CODE:
 	if ((int) len != width * height)
 		XSRETURN_UNDEF;
 
-	/* Simplify the raw map data. Each byte in the raw map data
-	   represents a block on the field, but only some bytes are
-	   interesting to pathfinding. */
 	New (0, data, len, unsigned char);
-	Copy (c_rawMap, data, len, unsigned char);
-	int info;
-	int walkable;
-	for (i = 0; i < (int) len; i++) {
-		// first bit is 'walkable' info
-		info = data[i];
-		walkable = (info & 1) ? 1 : 0;
-		if (walkable == 1) {
-			data[i] = 255;
-		} else {
-			data[i] = 0;
-		}
-	}
+	makeDistMap_inner (c_rawMap, width, height, data);
+	RETVAL = newSVpv ((const char *) data, len);
+	Safefree (data);
+OUTPUT:
+	RETVAL
 
-	done = false;
-	while (!done) {
-		done = true;
-
-		// 'push' wall distance right and up
-		for (y = 0; y < height; y++) {
-			for (x = 0; x < width; x++) {
-				i = y * width + x; // i: cell to examine
-				
-				if (data[i] > 0 && (x == 0 || y == 0 || x == width - 1 || y == height - 1)) {
-					data[i] = 1;
-				}
-				
-				dist_current = data[i]; // dist_current: initial dist of i from walkable/nonwalkable check above
-				
-				if (x != width - 1) {
-					int east_cell = y * width + x + 1; // ir: cell to the right
-					int dist_east_cell = (int) data[east_cell]; // dist_east_cell: initial dist of ir from walkable/nonwalkable check above
-					int delta_dist = dist_current - dist_east_cell; // delta_dist: 
-					if (delta_dist > 1) { // dist_current > dist_east_cell: real dist_current is dist_east_cell + 1
-						val = dist_east_cell + 1;
-						if (val > 255) {
-							val = 255;
-						}
-						data[i] = val;
-						done = false;
-					} else if (delta_dist < -1) { // dist_current < dist_east_cell: real dist_east_cell is dist_current + 1
-						val = dist_current + 1;
-						if (val > 255) {
-							val = 255;
-						}
-						data[east_cell] = val;
-						done = false;
-					}
-				}
-
-				if (y != height - 1) {
-					int north_cell = (y + 1) * width + x;
-					int dist_north_cell = (int) data[north_cell];
-					int delta_dist = dist_current - dist_north_cell;
-					if (delta_dist > 1) {
-						int val = dist_north_cell + 1;
-						if (val > 255) {
-							val = 255;
-						}
-						data[i] = (char) val;
-						done = false;
-					} else if (delta_dist < -1) {
-						int val = dist_current + 1;
-						if (val > 255) {
-							val = 255;
-						}
-						data[north_cell] = (char) val;
-						done = true;
-					}
-				}
-			}
-		}
 
-		// 'push' wall distance left and down
-		for (y = height - 1; y >= 0; y--) {
-			for (x = width - 1; x >= 0 ; x--) {
-				i = y * width + x;
-				dist_current = data[i];
-				
-				if (x != 0) {
-					int west_cell = y * width + x - 1;
-					int dist_west_cell = data[west_cell];
-					int delta_dist = dist_current - dist_west_cell;
-					if (delta_dist > 1) {
-						val = dist_west_cell + 1;
-						if (val > 255) {
-							val = 255;
-						}
-						data[i] = val;
-						done = false;
-					} else if (delta_dist < -1) {
-						val = dist_current + 1;
-						if (val > 255) {
-							val = 255;
-						}
-						data[west_cell] = val;
-						done = false;
-					}
-				}
-				
-				if (y != 0) {
-					int south_cell = (y - 1) * width + x;
-					int dist_south_cell = data[south_cell];
-					int delta_dist = dist_current - dist_south_cell;
-					if (delta_dist > 1) {
-						val = dist_south_cell + 1;
-						if (val > 255) {
-							val = 255;
-						}
-						data[i] = val;
-						done = false;
-					} else if (delta_dist < -1) {
-						val = dist_current + 1;
-						if (val > 255) {
-							val = 255;
-						}
-						data[south_cell] = val;
-						done = false;
-					}
-				}
-			}
-		}
+void
+inflateField(filename)
+	char *filename
+INIT:
+	gzFile gz;
+	unsigned char header[4];
+	int width, height, read = 0;
+	STRLEN size, done;
+	SV *data;
+PPCODE:
+	/* Reads a .fld2 or .fld2.gz file (gzread passes uncompressed files through) right into
+	   a buffer of the final size, the header gives the size of the map. */
+	gz = gzopen (filename, "rb");
+	if (!gz)
+		XSRETURN_EMPTY;
+	if (gzread (gz, header, 4) != 4) {
+		gzclose (gz);
+		XSRETURN_EMPTY;
 	}
+	width = header[0] | (header[1] << 8);
+	height = header[2] | (header[3] << 8);
+	size = (STRLEN) width * height;
 
-	RETVAL = newSVpv ((const char *) data, len);
-OUTPUT:
-	RETVAL
+	data = newSV (size + 1);
+	SvPOK_only (data);
+	done = 0;
+	while (done < size) {
+		read = gzread (gz, SvPVX (data) + done, (unsigned int) (size - done));
+		if (read <= 0)
+			break;
+		done += read;
+	}
+	gzclose (gz);
+	if (read < 0) {
+		SvREFCNT_dec (data);
+		XSRETURN_EMPTY;
+	}
+
+	/* Truncated files give the cells they have, like the Perl reader did */
+	SvCUR_set (data, done);
+	*SvEND (data) = '\0';
+	EXTEND (SP, 3);
+	PUSHs (sv_2mortal (data));
+	PUSHs (sv_2mortal (newSViv (width)));
+	PUSHs (sv_2mortal (newSViv (height)));
+
+
+void
+makeFieldMaps(rawMap, width, height)
+	SV *rawMap
+	int width
+	int height
+INIT:
+	STRLEN len;
+	unsigned char *c_rawMap;
+	SV *distMap, *weightMap, *neighborMask;
+PPCODE:
+	if (!SvOK (rawMap))
+		XSRETURN_EMPTY;
+
+	c_rawMap = (unsigned char *) SvPV (rawMap, len);
+	if (width <= 0 || height <= 0 || (int) len != width * height)
+		XSRETURN_EMPTY;
+
+	/* The maps are built right into the buffers of the returned scalars */
+	distMap = newSV (len);
+	weightMap = newSV (len);
+	neighborMask = newSV (len);
+	SvPOK_only (distMap);
+	SvPOK_only (weightMap);
+	SvPOK_only (neighborMask);
+
+	makeFieldMaps_inner (c_rawMap, width, height, (unsigned char *) SvPVX (distMap), SvPVX (weightMap));
+	CalcPath_buildNeighborMask (SvPVX (weightMap), width, height, (unsigned char *) SvPVX (neighborMask));
+
+	SvCUR_set (distMap, len);
+	SvCUR_set (weightMap, len);
+	SvCUR_set (neighborMask, len);
+	EXTEND (SP, 3);
+	PUSHs (sv_2mortal (distMap));
+	PUSHs (sv_2mortal (weightMap));
+	PUSHs (sv_2mortal (neighborMask));
 
 
 SV *
@@ -355,38 +1009,1780 @@ makeWeightMap(distMap, width, height)
 	int height
 INIT:
 	STRLEN len;
-	int i, x, y;
-	int dist;
-	char *c_weightMap, *data;
+	unsigned char *c_distMap;
+	char *data;
 CODE:
 	if (!SvOK (distMap))
 		XSRETURN_UNDEF;
 
-	c_weightMap = (char *) SvPV (distMap, len);
+	c_distMap = (unsigned char *) SvPV (distMap, len);
 	if ((int) len != width * height)
 		XSRETURN_UNDEF;
 
-	/* Simplify the raw map data. Each byte in the raw map data
-	   represents a block on the field, but only some bytes are
-	   interesting to pathfinding. */
 	New (0, data, len, char);
-	Copy (c_weightMap, data, len, char);
-	
-	int distance_to_weight[6] = { -1, 60, 50, 20, 10, 0 };
-	int max_distance = 5;
-
-	for (y = 0; y < height; y++) {
-		for (x = 0; x < width; x++) {
-			i = y * width + x; // i: cell to examine
-			dist = data[i]; // dist: dist of i from wall
-			
-			if (dist > max_distance) {
-				dist = max_distance;
-			}
-			data[i] = distance_to_weight[dist];
-		}
+	makeWeightMap_inner (c_distMap, width, height, data);
+	RETVAL = newSVpv ((const char *) data, len);
+	Safefree (data);
+OUTPUT:
+	RETVAL
+
+
+SV *
+makeWeightProfile(distMap, width, height, profile, walls = NULL)
+	SV *distMap
+	int width
+	int height
+	SV *profile
+	SV *walls
+INIT:
+	STRLEN len, walls_len;
+	unsigned char *c_distMap;
+	const char *c_walls = NULL;
+	char weights[255];
+	int count;
+CODE:
+	count = profileWeights (profile, weights, (int) sizeof (weights));
+
+	if (!SvOK (distMap))
+		XSRETURN_UNDEF;
+	c_distMap = (unsigned char *) SvPV (distMap, len);
+	if (width <= 0 || height <= 0 || (int) len != width * height)
+		XSRETURN_UNDEF;
+	if (walls && SvOK (walls)) {
+		c_walls = SvPV (SvROK (walls) ? SvRV (walls) : walls, walls_len);
+		if (walls_len != len)
+			XSRETURN_UNDEF;
 	}
 
-	RETVAL = newSVpv ((const char *) data, len);
+	RETVAL = newSV (len);
+	SvPOK_only (RETVAL);
+	makeWeightProfile_inner (c_distMap, c_walls, width, height, weights, count, SvPVX (RETVAL));
+	SvCUR_set (RETVAL, len);
+OUTPUT:
+	RETVAL
+
+
+void
+repairDistMap(distMap, rawMap, width, height, cells)
+	SV *distMap
+	SV *rawMap
+	int width
+	int height
+	SV *cells
+INIT:
+	STRLEN len;
+	const unsigned char *c_rawMap;
+	unsigned char *c_distMap;
+	int *c_cells, count;
+CODE:
+	/* rawMap already has the new cells, the distance map is the one of the old ones */
+	c_distMap = repairedMap (distMap, "distMap", width, height);
+	c_rawMap = (const unsigned char *) SvPV (SvROK (rawMap) ? SvRV (rawMap) : rawMap, len);
+	if (len != (STRLEN) width * height)
+		croak ("rawMap is not a %d x %d map", width, height);
+	c_cells = changedCells (cells, &count);
+	repairDistMap_inner (c_rawMap, width, height, c_cells, count, c_distMap);
+	Safefree (c_cells);
+
+
+void
+repairWeightProfile(weightMap, rawMap, width, height, cells, profile = NULL, walls = NULL)
+	SV *weightMap
+	SV *rawMap
+	int width
+	int height
+	SV *cells
+	SV *profile
+	SV *walls
+INIT:
+	STRLEN len;
+	const unsigned char *c_rawMap;
+	unsigned char *c_weightMap;
+	const char *c_walls = NULL;
+	char weights[255];
+	int *c_cells, count = 0, cellCount;
+CODE:
+	/* Without a profile, the weight map is one of Utils::makeWeightMap() */
+	if (profile && SvOK (profile))
+		count = profileWeights (profile, weights, (int) sizeof (weights));
+	c_weightMap = repairedMap (weightMap, "weightMap", width, height);
+	c_rawMap = (const unsigned char *) SvPV (SvROK (rawMap) ? SvRV (rawMap) : rawMap, len);
+	if (len != (STRLEN) width * height)
+		croak ("rawMap is not a %d x %d map", width, height);
+	if (walls && SvOK (walls)) {
+		c_walls = SvPV (SvROK (walls) ? SvRV (walls) : walls, len);
+		if (len != (STRLEN) width * height)
+			croak ("walls is not a %d x %d map", width, height);
+	}
+	c_cells = changedCells (cells, &cellCount);
+	repairWeightProfile_inner (c_rawMap, c_walls, width, height, c_cells, cellCount, count ? weights : NULL, count, (char *) c_weightMap);
+	Safefree (c_cells);
+
+
+int
+prefetchField(filename, buildMaps)
+	char *filename
+	int buildMaps
+CODE:
+	RETVAL = FieldPrefetch_queue (filename, buildMaps);
+OUTPUT:
+	RETVAL
+
+
+void
+takePrefetchedField(filename)
+	char *filename
+INIT:
+	FieldPrefetch_job *job;
+	STRLEN size;
+PPCODE:
+	/* Returns what inflateField and makeFieldMaps would, followed by the connected areas;
+	   only the first three if the maps were not built */
+	job = FieldPrefetch_take (filename);
+	if (!job)
+		XSRETURN_EMPTY;
+
+	EXTEND (SP, 7);
+	PUSHs (sv_2mortal (newSVpvn ((const char *) job->rawMap, job->rawSize)));
+	PUSHs (sv_2mortal (newSViv (job->width)));
+	PUSHs (sv_2mortal (newSViv (job->height)));
+	if (job->distMap) {
+		size = (STRLEN) job->width * job->height;
+		PUSHs (sv_2mortal (newSVpvn ((const char *) job->distMap, size)));
+		PUSHs (sv_2mortal (newSVpvn (job->weightMap, size)));
+		PUSHs (sv_2mortal (newSVpvn ((const char *) job->neighborMask, size)));
+		PUSHs (sv_2mortal (newSVpvn ((const char *) job->components, size * 2)));
+	}
+	FieldPrefetch_free (job);
+
+
+int
+pendingPrefetchedFields()
+CODE:
+	RETVAL = FieldPrefetch_pending ();
 OUTPUT:
 	RETVAL
+
+
+void
+clearPrefetchedFields()
+CODE:
+	FieldPrefetch_clear ();
+
+
+SV *
+simdLevel()
+CODE:
+	RETVAL = newSVpv (CPU_simdLevelName (CPU_simdLevel ()), 0);
+OUTPUT:
+	RETVAL
+
+
+unsigned int
+nativeThreads()
+CODE:
+	RETVAL = o_executor_thread_count ();
+OUTPUT:
+	RETVAL
+
+
+unsigned int
+setNativeThreads(count)
+	unsigned int count
+CODE:
+	RETVAL = o_executor_resize (count);
+OUTPUT:
+	RETVAL
+
+void
+shiftPack(data, value, bits)
+	SV *data
+	UV value
+	unsigned int bits
+INIT:
+	const unsigned char *in;
+	unsigned char *out;
+	STRLEN len, outLen, i;
+	unsigned int shift;
+CODE:
+	/* $$data = ($$data << bits) | (value & (2 ** bits - 1)), as a bit string */
+	if (!SvROK (data))
+		croak ("shiftPack() takes a reference to the data");
+	if (bits > 32)
+		croak ("shiftPack() packs at most 32 bits");
+	data = SvRV (data);
+	in = (const unsigned char *) (SvOK (data) ? SvPV (data, len) : (len = 0, ""));
+	shift = bits % 8;
+	outLen = len + bits / 8 + 1;
+	Newxz (out, outLen, unsigned char);
+	/* One spare byte in front, for the bits shifted out of the first one */
+	for (i = 0; i < len; i++) {
+		out[i] |= in[i] >> (8 - shift);
+		out[i + 1] |= (unsigned char) (in[i] << shift);
+	}
+	value &= (bits == 32) ? 0xFFFFFFFFUL : ((UV) 1 << bits) - 1;
+	for (i = outLen; value && i > 0; i--, value >>= 8)
+		out[i - 1] |= (unsigned char) (value & 0xFF);
+	setPacked (data, out, outLen);
+	Safefree (out);
+
+
+void
+unShiftPack(data, reference, bits)
+	SV *data
+	SV *reference
+	unsigned int bits
+INIT:
+	const unsigned char *in;
+	STRLEN len;
+CODE:
+	/* Takes the lowest bits of the bit string $$data, storing them in $$reference */
+	if (!SvROK (data))
+		croak ("unShiftPack() takes a reference to the data");
+	if (bits > 32)
+		croak ("unShiftPack() unpacks at most 32 bits");
+	data = SvRV (data);
+	in = (const unsigned char *) (SvOK (data) ? SvPV (data, len) : (len = 0, ""));
+	if (SvOK (reference)) {
+		if (!SvROK (reference))
+			croak ("unShiftPack() stores the value in a reference");
+		sv_setuv_mg (SvRV (reference), (UV) (packedTail (in, len) & (((unsigned long long) 1 << bits) - 1)));
+	}
+
+	setShiftedRight (data, in, len, bits);
+
+
+void
+makeCoordsXY(r_hash, rawCoords)
+	SV *r_hash
+	SV *rawCoords
+INIT:
+	const unsigned char *in;
+	STRLEN len;
+CODE:
+	/* Like unShiftPack() of y then x, 10 bits each */
+	if (!SvROK (rawCoords))
+		croak ("makeCoordsXY() takes a reference to the coordinates");
+	in = (const unsigned char *) (SvOK (SvRV (rawCoords)) ? SvPV (SvRV (rawCoords), len) : (len = 0, ""));
+	storeCoords (r_hash, packedTail (in, len));
+	setShiftedRight (SvRV (rawCoords), in, len, 20);
+
+
+void
+makeCoordsDir(r_hash, rawCoords, bodyDir = &PL_sv_undef)
+	SV *r_hash
+	SV *rawCoords
+	SV *bodyDir
+INIT:
+	const unsigned char *in;
+	STRLEN len;
+	unsigned long long value;
+CODE:
+	/* x, y and the body direction, packed in 24 bits */
+	in = (const unsigned char *) (SvOK (rawCoords) ? SvPV (rawCoords, len) : (len = 0, ""));
+	value = packedTail (in, len);
+	if (SvOK (bodyDir)) {
+		if (!SvROK (bodyDir))
+			croak ("makeCoordsDir() stores the body direction in a reference");
+		sv_setuv_mg (SvRV (bodyDir), (UV) (value & 0xF));
+	}
+	storeCoords (r_hash, value >> 4);
+
+
+void
+makeCoordsFromTo(r_hashFrom, r_hashTo, rawCoords)
+	SV *r_hashFrom
+	SV *r_hashTo
+	SV *rawCoords
+INIT:
+	const unsigned char *in;
+	STRLEN len;
+	unsigned long long value;
+CODE:
+	/* The coordinates of both ends of a move, packed in 48 bits */
+	in = (const unsigned char *) (SvOK (rawCoords) ? SvPV (rawCoords, len) : (len = 0, ""));
+	value = packedTail (in, len);
+	storeCoords (r_hashTo, value >> 8);
+	storeCoords (r_hashFrom, value >> 28);
+
+
+MODULE = FastUtils	PACKAGE = Utils::FieldCache
+PROTOTYPES: ENABLE
+
+
+SV *
+open(klass, filename)
+	SV *klass
+	char *filename
+INIT:
+	FieldCache *cache;
+CODE:
+	cache = FieldCache_open (filename);
+	if (!cache)
+		XSRETURN_UNDEF;
+	RETVAL = newSV (0);
+	sv_setref_pv (RETVAL, SvPV_nolen (klass), (void *) cache);
+OUTPUT:
+	RETVAL
+
+
+int
+width(self)
+	SV *self
+CODE:
+	RETVAL = fieldCacheOf (self)->width;
+OUTPUT:
+	RETVAL
+
+
+int
+height(self)
+	SV *self
+CODE:
+	RETVAL = fieldCacheOf (self)->height;
+OUTPUT:
+	RETVAL
+
+
+UV
+sourceSize(self)
+	SV *self
+CODE:
+	RETVAL = fieldCacheOf (self)->sourceSize;
+OUTPUT:
+	RETVAL
+
+
+UV
+sourceTime(self)
+	SV *self
+CODE:
+	RETVAL = fieldCacheOf (self)->sourceTime;
+OUTPUT:
+	RETVAL
+
+
+bool
+hasLayer(self, id)
+	SV *self
+	UV id
+CODE:
+	RETVAL = FieldCache_findLayer (fieldCacheOf (self), id) != NULL;
+OUTPUT:
+	RETVAL
+
+
+bool
+attach(self, id, hash, key)
+	SV *self
+	UV id
+	SV *hash
+	SV *key
+INIT:
+	const FieldCache_layer *layer;
+	SV *value;
+	STRLEN key_len;
+	const char *key_data;
+CODE:
+	/* Stores a string whose buffer is the layer in the mapped file into $hash->{$key}, without copying it.
+	   Assigning the scalar to another variable copies it as usual. The string keeps the mapping alive. */
+	if (!SvROK (hash) || SvTYPE (SvRV (hash)) != SVt_PVHV)
+		croak ("hash must be a reference to a hash");
+	layer = FieldCache_findLayer (fieldCacheOf (self), id);
+	if (!layer)
+		XSRETURN_NO;
+
+	value = newSV (0);
+	SvUPGRADE (value, SVt_PVMG);
+	SvPV_set (value, (char *) fieldCacheOf (self)->base + layer->offset);
+	SvCUR_set (value, layer->length);
+	SvLEN_set (value, 0);
+	SvPOK_only (value);
+	sv_magicext (value, SvRV (self), PERL_MAGIC_ext, NULL, NULL, 0);
+
+	key_data = SvPV (key, key_len);
+	if (!hv_store ((HV *) SvRV (hash), key_data, key_len, value, 0))
+		SvREFCNT_dec (value);
+	RETVAL = 1;
+OUTPUT:
+	RETVAL
+
+
+void
+layers(self)
+	SV *self
+INIT:
+	FieldCache *cache;
+	unsigned int i;
+PPCODE:
+	cache = fieldCacheOf (self);
+	EXTEND (SP, cache->layerCount);
+	for (i = 0; i < cache->layerCount; i++)
+		PUSHs (sv_2mortal (newSVuv (cache->layers[i].id)));
+
+
+void
+DESTROY(self)
+	SV *self
+CODE:
+	FieldCache *cache = INT2PTR (FieldCache *, SvIV (SvRV (self)));
+	if (cache) {
+		FieldCache_close (cache);
+		sv_setiv (SvRV (self), 0);
+	}
+
+
+MODULE = FastUtils	PACKAGE = Utils::FieldChunks
+PROTOTYPES: ENABLE
+
+
+SV *
+new(klass, data, width, height, hot = 16)
+	SV *klass
+	SV *data
+	int width
+	int height
+	int hot
+INIT:
+	FieldChunks *chunks;
+	STRLEN len;
+	const char *cells;
+CODE:
+	if (!SvROK (data) || SvTYPE (SvRV (data)) >= SVt_PVAV)
+		croak ("data must be a reference to a scalar");
+	if (width <= 0 || height <= 0)
+		croak ("bad map size %d x %d", width, height);
+	cells = SvPV (SvRV (data), len);
+	if (len < (STRLEN) width * height)
+		croak ("the map holds %lu cells instead of %d x %d", (unsigned long) len, width, height);
+	chunks = FieldChunks_new ((const unsigned char *) cells, width, height, hot);
+	if (!chunks)
+		XSRETURN_UNDEF;
+	RETVAL = newSV (0);
+	sv_setref_pv (RETVAL, SvPV_nolen (klass), (void *) chunks);
+OUTPUT:
+	RETVAL
+
+
+int
+width(self)
+	SV *self
+ALIAS:
+	height = 1
+	hotCapacity = 2
+CODE:
+	FieldChunks *chunks = fieldChunksOf (self);
+	RETVAL = (ix == 0) ? chunks->width : (ix == 1) ? chunks->height : chunks->hotCapacity;
+OUTPUT:
+	RETVAL
+
+
+UV
+packedSize(self)
+	SV *self
+ALIAS:
+	decodes = 1
+CODE:
+	FieldChunks *chunks = fieldChunksOf (self);
+	RETVAL = (ix == 0) ? chunks->packedSize : chunks->decodes;
+OUTPUT:
+	RETVAL
+
+
+int
+cell(self, x, y)
+	SV *self
+	IV x
+	IV y
+CODE:
+	FieldChunks *chunks = fieldChunksOf (self);
+	if (x < 0 || x >= chunks->width || y < 0 || y >= chunks->height)
+		RETVAL = 0;
+	else
+		RETVAL = FieldChunks_cell (chunks, (int) x, (int) y);
+OUTPUT:
+	RETVAL
+
+
+SV *
+region(self, x, y, width, height)
+	SV *self
+	int x
+	int y
+	int width
+	int height
+CODE:
+	/* The cells of the region row by row, like a raw map of width x height cells */
+	if (width < 0 || height < 0)
+		croak ("bad region size %d x %d", width, height);
+	RETVAL = newSV ((STRLEN) width * height + 1);
+	SvPOK_only (RETVAL);
+	SvCUR_set (RETVAL, (STRLEN) width * height);
+	FieldChunks_region (fieldChunksOf (self), x, y, width, height, (unsigned char *) SvPVX (RETVAL));
+	SvPVX (RETVAL)[(STRLEN) width * height] = 0;
+OUTPUT:
+	RETVAL
+
+
+void
+DESTROY(self)
+	SV *self
+CODE:
+	FieldChunks *chunks = INT2PTR (FieldChunks *, SvIV (SvRV (self)));
+	if (chunks) {
+		FieldChunks_destroy (chunks);
+		sv_setiv (SvRV (self), 0);
+	}
+
+
+MODULE = FastUtils	PACKAGE = Utils::IDIndex
+PROTOTYPES: ENABLE
+
+
+SV *
+new(klass)
+	SV *klass
+CODE:
+	RETVAL = newSV (0);
+	sv_setref_pv (RETVAL, SvPV_nolen (klass), (void *) new IDIndex ());
+OUTPUT:
+	RETVAL
+
+
+int
+add(self, ID)
+	SV *self
+	SV *ID
+INIT:
+	STRLEN len;
+	const char *data;
+CODE:
+	data = SvPV (ID, len);
+	RETVAL = idIndexOf (self)->add (data, len);
+OUTPUT:
+	RETVAL
+
+
+SV *
+remove(self, ID)
+	SV *self
+	SV *ID
+INIT:
+	STRLEN len;
+	const char *data;
+	int slot;
+CODE:
+	data = SvPV (ID, len);
+	slot = idIndexOf (self)->remove (data, len);
+	if (slot < 0)
+		XSRETURN_UNDEF;
+	RETVAL = newSViv (slot);
+OUTPUT:
+	RETVAL
+
+
+SV *
+find(self, ID)
+	SV *self
+	SV *ID
+INIT:
+	STRLEN len;
+	const char *data;
+	int slot;
+CODE:
+	data = SvPV (ID, len);
+	slot = idIndexOf (self)->find (data, len);
+	if (slot < 0)
+		XSRETURN_UNDEF;
+	RETVAL = newSViv (slot);
+OUTPUT:
+	RETVAL
+
+
+int
+size(self)
+	SV *self
+CODE:
+	RETVAL = idIndexOf (self)->size ();
+OUTPUT:
+	RETVAL
+
+
+void
+clear(self)
+	SV *self
+CODE:
+	idIndexOf (self)->clear ();
+
+
+void
+DESTROY(self)
+	SV *self
+CODE:
+	delete INT2PTR (IDIndex *, SvIV (SvRV (self)));
+
+
+MODULE = FastUtils	PACKAGE = Network::MessageTokenizer::Native
+PROTOTYPES: ENABLE
+
+
+SV *
+new(klass)
+	SV *klass
+INIT:
+	Tokenizer *tokenizer;
+CODE:
+	tokenizer = Tokenizer_new ();
+	if (!tokenizer)
+		croak ("out of memory");
+	RETVAL = newSV (0);
+	sv_setref_pv (RETVAL, SvPV_nolen (klass), (void *) tokenizer);
+OUTPUT:
+	RETVAL
+
+
+void
+setLengths(self, rpackets)
+	SV *self
+	HV *rpackets
+CODE:
+	setTokenizerLengths (tokenizerOf (self), rpackets);
+
+
+void
+add(self, data)
+	SV *self
+	SV *data
+INIT:
+	STRLEN len;
+	const char *buffer;
+CODE:
+	buffer = SvPV (data, len);
+	if (!Tokenizer_add (tokenizerOf (self), buffer, len))
+		croak ("out of memory");
+
+
+void
+prepend(self, data)
+	SV *self
+	SV *data
+INIT:
+	STRLEN len;
+	const char *buffer;
+CODE:
+	buffer = SvPV (data, len);
+	if (!Tokenizer_prepend (tokenizerOf (self), buffer, len))
+		croak ("out of memory");
+
+
+void
+remove(self, len)
+	SV *self
+	unsigned int len
+CODE:
+	Tokenizer_remove (tokenizerOf (self), len);
+
+
+unsigned int
+size(self)
+	SV *self
+CODE:
+	RETVAL = tokenizerOf (self)->size;
+OUTPUT:
+	RETVAL
+
+
+SV *
+peek(self, len)
+	SV *self
+	unsigned int len
+INIT:
+	Tokenizer *tokenizer;
+CODE:
+	tokenizer = tokenizerOf (self);
+	if (len > tokenizer->size)
+		len = tokenizer->size;
+	RETVAL = tokenizerData (tokenizer, 0, len);
+OUTPUT:
+	RETVAL
+
+
+SV *
+getBuffer(self)
+	SV *self
+INIT:
+	Tokenizer *tokenizer;
+CODE:
+	tokenizer = tokenizerOf (self);
+	RETVAL = tokenizerData (tokenizer, 0, tokenizer->size);
+OUTPUT:
+	RETVAL
+
+
+int
+readBatch(self, messages)
+	SV *self
+	AV *messages
+INIT:
+	Tokenizer *tokenizer;
+	int len;
+CODE:
+	/* Pushes every complete message, followed by the rest of the data if it isn't a known message;
+	   returns the number of known messages */
+	tokenizer = tokenizerOf (self);
+	RETVAL = 0;
+	while ((len = Tokenizer_next (tokenizer)) != 0) {
+		if (len == TOKENIZER_UNKNOWN_MESSAGE) {
+			av_push (messages, tokenizerData (tokenizer, 0, tokenizer->size));
+			Tokenizer_remove (tokenizer, tokenizer->size);
+			break;
+		}
+		av_push (messages, tokenizerData (tokenizer, 0, len));
+		Tokenizer_remove (tokenizer, len);
+		RETVAL++;
+	}
+OUTPUT:
+	RETVAL
+
+
+void
+DESTROY(self)
+	SV *self
+CODE:
+	Tokenizer_free (INT2PTR (Tokenizer *, SvIV (SvRV (self))));
+
+
+MODULE = FastUtils	PACKAGE = Network::XKoreProxy::Relay
+PROTOTYPES: ENABLE
+
+
+SV *
+new(klass, server, client, rpackets)
+	SV *klass
+	SV *server
+	SV *client
+	HV *rpackets
+INIT:
+	ProxyRelay *relay;
+CODE:
+	relay = ProxyRelay_new (socketHandle (aTHX_ server), socketHandle (aTHX_ client));
+	setTokenizerLengths (ProxyRelay_tokenizer (relay), rpackets);
+	RETVAL = newSV (0);
+	sv_setref_pv (RETVAL, SvPV_nolen (klass), (void *) relay);
+OUTPUT:
+	RETVAL
+
+
+void
+setMode(self, id, mode)
+	SV *self
+	UV id
+	int mode
+CODE:
+	if (mode < PROXY_RELAY_MIRROR || mode > PROXY_RELAY_HOLD)
+		croak ("unknown relay mode %d", mode);
+	ProxyRelay_setMode (proxyRelayOf (self), (unsigned int) id, mode);
+
+
+bool
+start(self)
+	SV *self
+CODE:
+	RETVAL = ProxyRelay_start (proxyRelayOf (self));
+OUTPUT:
+	RETVAL
+
+
+void
+take(self)
+	SV *self
+INIT:
+	RelayTaken taken;
+	I32 i;
+PPCODE:
+	/* Returns the messages taken as one string, followed by the ones which were forwarded */
+	taken.data = sv_2mortal (newSVpvn ("", 0));
+	taken.forwarded = (AV *) sv_2mortal ((SV *) newAV ());
+	ProxyRelay_take (proxyRelayOf (self), takeRelayed, &taken);
+	EXTEND (SP, av_len (taken.forwarded) + 2);
+	PUSHs (taken.data);
+	for (i = 0; i <= av_len (taken.forwarded); i++)
+		PUSHs (*av_fetch (taken.forwarded, i, 0));
+
+
+void
+release(self)
+	SV *self
+CODE:
+	ProxyRelay_release (proxyRelayOf (self));
+
+
+bool
+send(self, data)
+	SV *self
+	SV *data
+INIT:
+	STRLEN len;
+	const char *buffer;
+CODE:
+	buffer = SvPV (data, len);
+	RETVAL = ProxyRelay_send (proxyRelayOf (self), buffer, (unsigned int) len);
+OUTPUT:
+	RETVAL
+
+
+bool
+serverClosed(self)
+	SV *self
+CODE:
+	RETVAL = ProxyRelay_serverClosed (proxyRelayOf (self));
+OUTPUT:
+	RETVAL
+
+
+UV
+forwarded(self)
+	SV *self
+ALIAS:
+	held = 1
+CODE:
+	RETVAL = ix ? ProxyRelay_held (proxyRelayOf (self)) : ProxyRelay_forwarded (proxyRelayOf (self));
+OUTPUT:
+	RETVAL
+
+
+void
+stop(self)
+	SV *self
+CODE:
+	ProxyRelay_stop (proxyRelayOf (self));
+
+
+void
+DESTROY(self)
+	SV *self
+CODE:
+	ProxyRelay_free (proxyRelayOf (self));
+
+
+MODULE = FastUtils	PACKAGE = Network::Multiplexer::Native
+PROTOTYPES: ENABLE
+
+
+SV *
+new(klass)
+	SV *klass
+INIT:
+	NetMux *mux;
+CODE:
+	mux = NetMux_new ();
+	if (!mux)
+		croak ("cannot create a multiplexer");
+	RETVAL = newSV (0);
+	sv_setref_pv (RETVAL, SvPV_nolen (klass), (void *) mux);
+OUTPUT:
+	RETVAL
+
+
+int
+add(self, socket)
+	SV *self
+	SV *socket
+CODE:
+	RETVAL = NetMux_add (netMuxOf (self), (NetMux_socket) socketHandle (aTHX_ socket));
+OUTPUT:
+	RETVAL
+
+
+void
+setLengths(self, id, rpackets)
+	SV *self
+	int id
+	HV *rpackets
+INIT:
+	Tokenizer *tokenizer;
+CODE:
+	tokenizer = NetMux_tokenizer (netMuxOf (self), id);
+	if (!tokenizer)
+		croak ("no connection %d", id);
+	setTokenizerLengths (tokenizer, rpackets);
+
+
+void
+remove(self, id)
+	SV *self
+	int id
+CODE:
+	NetMux_remove (netMuxOf (self), id);
+
+
+unsigned int
+count(self)
+	SV *self
+CODE:
+	RETVAL = NetMux_count (netMuxOf (self));
+OUTPUT:
+	RETVAL
+
+
+int
+wait(self, timeout)
+	SV *self
+	int timeout
+CODE:
+	RETVAL = NetMux_wait (netMuxOf (self), timeout);
+OUTPUT:
+	RETVAL
+
+
+void
+take(self)
+	SV *self
+INIT:
+	AV *events;
+	I32 i;
+PPCODE:
+	events = (AV *) sv_2mortal ((SV *) newAV ());
+	NetMux_take (netMuxOf (self), takeMuxEvent, events);
+	EXTEND (SP, av_len (events) + 1);
+	for (i = 0; i <= av_len (events); i++)
+		PUSHs (*av_fetch (events, i, 0));
+
+
+void
+DESTROY(self)
+	SV *self
+CODE:
+	NetMux_free (netMuxOf (self));
+
+
+MODULE = FastUtils	PACKAGE = Network::PacketParser::Unpacker
+PROTOTYPES: ENABLE
+
+
+SV *
+new(klass, pattern, names)
+	SV *klass
+	SV *pattern
+	AV *names
+INIT:
+	STRLEN len;
+	const char *buffer;
+	Unpacker *unpacker;
+	PacketUnpacker *self;
+	unsigned int i;
+CODE:
+	/* Returns undef if the template needs unpack() */
+	buffer = SvPV (pattern, len);
+	unpacker = Unpacker_compile (buffer, len);
+	if (!unpacker)
+		XSRETURN_UNDEF;
+
+	Newxz (self, 1, PacketUnpacker);
+	self->unpacker = unpacker;
+	self->keyCount = av_len (names) + 1;
+	Newxz (self->keys, self->keyCount + 1, SV *);
+	for (i = 0; i < self->keyCount; i++) {
+		SV **name = av_fetch (names, i, 0);
+		STRLEN nameLen;
+		const char *key = (name && SvOK (*name)) ? SvPV (*name, nameLen) : (nameLen = 0, "");
+		/* Shared keys carry their hash, so storing doesn't compute it again */
+		self->keys[i] = newSVpvn_share (key, nameLen, 0);
+	}
+	RETVAL = newSV (0);
+	sv_setref_pv (RETVAL, SvPV_nolen (klass), (void *) self);
+OUTPUT:
+	RETVAL
+
+
+int
+unpack(self, message, args)
+	SV *self
+	SV *message
+	HV *args
+INIT:
+	PacketUnpacker *packet;
+	Unpacker *unpacker;
+	STRLEN len;
+	const unsigned char *data;
+	unsigned int offset = 0, key = 0, i;
+CODE:
+	/* Stores the values in args like a hash slice assignment of unpack()'s result; returns
+	   false, leaving args alone, if this message must go through unpack() instead */
+	packet = packetUnpackerOf (self);
+	unpacker = packet->unpacker;
+	if (SvUTF8 (message))
+		XSRETURN_NO;
+	data = (const unsigned char *) SvPV (message, len);
+	if (len < unpacker->fixedSize)
+		XSRETURN_NO;
+
+	for (i = 0; i < unpacker->fieldCount; i++) {
+		const Unpacker_field *field = &unpacker->fields[i];
+		const unsigned char *p = data + offset;
+		unsigned int size = field->size, valueLen;
+		SV *value;
+
+		switch (field->type) {
+		case UNPACKER_SKIP:
+			offset += size;
+			continue;
+		case UNPACKER_U8:
+			value = newSVuv (p[0]);
+			break;
+		case UNPACKER_S8:
+			value = newSViv ((signed char) p[0]);
+			break;
+		case UNPACKER_U16:
+			value = newSVuv (p[0] | (p[1] << 8));
+			break;
+		case UNPACKER_S16:
+			value = newSViv ((short) (p[0] | (p[1] << 8)));
+			break;
+		case UNPACKER_U32:
+			value = newSVuv (p[0] | (p[1] << 8) | (p[2] << 16) | ((U32) p[3] << 24));
+			break;
+		case UNPACKER_S32:
+			value = newSViv ((I32) (p[0] | (p[1] << 8) | (p[2] << 16) | ((U32) p[3] << 24)));
+			break;
+		default:
+			size = Unpacker_stringField (field, data, offset, len, &valueLen);
+			value = newSVpvn ((const char *) p, valueLen);
+			break;
+		}
+		offset += size;
+
+		/* Values without a name are dropped */
+		if (key < packet->keyCount) {
+			SV *name = packet->keys[key++];
+			(void) hv_store (args, SvPVX (name), SvCUR (name), value, SvSHARED_HASH (name));
+		} else {
+			SvREFCNT_dec (value);
+		}
+	}
+	/* Names without a value are set to undef, like unpack() leaves them */
+	for (; key < packet->keyCount; key++) {
+		SV *name = packet->keys[key];
+		(void) hv_store (args, SvPVX (name), SvCUR (name), newSV (0), SvSHARED_HASH (name));
+	}
+	RETVAL = 1;
+OUTPUT:
+	RETVAL
+
+
+void
+DESTROY(self)
+	SV *self
+INIT:
+	PacketUnpacker *packet;
+	unsigned int i;
+CODE:
+	packet = INT2PTR (PacketUnpacker *, SvIV (SvRV (self)));
+	for (i = 0; i < packet->keyCount; i++)
+		SvREFCNT_dec (packet->keys[i]);
+	Safefree (packet->keys);
+	Unpacker_free (packet->unpacker);
+	Safefree (packet);
+
+
+MODULE = FastUtils	PACKAGE = Utils::TickTimer
+PROTOTYPES: ENABLE
+
+
+int
+phase(name)
+	char *name
+CODE:
+	RETVAL = TickTimer_phase (name);
+	if (RETVAL < 0)
+		croak ("Too many tick phases");
+OUTPUT:
+	RETVAL
+
+
+void
+phases()
+INIT:
+	int i;
+PPCODE:
+	/* The phase names, by ID */
+	EXTEND (SP, TickTimer_phaseCount ());
+	for (i = 0; i < TickTimer_phaseCount (); i++)
+		PUSHs (sv_2mortal (newSVpv (TickTimer_phaseName (i), 0)));
+
+
+void
+beginTick()
+CODE:
+	TickTimer_beginTick ();
+
+
+UV
+endTick()
+CODE:
+	RETVAL = (UV) TickTimer_endTick ();
+OUTPUT:
+	RETVAL
+
+
+void
+begin(phase)
+	int phase
+CODE:
+	TickTimer_begin (phase);
+
+
+void
+end(phase)
+	int phase
+CODE:
+	TickTimer_end (phase);
+
+
+UV
+lastTickTime()
+CODE:
+	/* The microseconds the last tick took */
+	RETVAL = (UV) TickTimer_lastTick (TICKTIMER_TICK);
+OUTPUT:
+	RETVAL
+
+
+SV *
+lastTick()
+INIT:
+	HV *result;
+	int i;
+CODE:
+	/* The microseconds and calls of the phases which ran during the last tick */
+	result = newHV ();
+	for (i = 0; i < TickTimer_phaseCount (); i++) {
+		const char *name = TickTimer_phaseName (i);
+		HV *phase;
+
+		if (TickTimer_lastCalls (i) == 0)
+			continue;
+		phase = newHV ();
+		(void) hv_stores (phase, "time", newSVuv ((UV) TickTimer_lastTick (i)));
+		(void) hv_stores (phase, "calls", newSVuv (TickTimer_lastCalls (i)));
+		(void) hv_store (result, name, strlen (name), newRV_noinc ((SV *) phase), 0);
+	}
+	RETVAL = newRV_noinc ((SV *) result);
+OUTPUT:
+	RETVAL
+
+
+SV *
+histogram(phase = &PL_sv_undef)
+	SV *phase
+INIT:
+	const TickTimer_histogram *histogram;
+	HV *result;
+	int id;
+CODE:
+	/* The recorded times of a phase, or of the ticks, in microseconds */
+	id = tickPhaseOf (phase);
+	histogram = TickTimer_histogramOf (id);
+	result = newHV ();
+	(void) hv_stores (result, "count", newSVuv (histogram->count));
+	(void) hv_stores (result, "max", newSVuv ((UV) histogram->max));
+	(void) hv_stores (result, "p50", newSVuv ((UV) TickTimer_percentile (id, 0.5)));
+	(void) hv_stores (result, "p90", newSVuv ((UV) TickTimer_percentile (id, 0.9)));
+	(void) hv_stores (result, "p99", newSVuv ((UV) TickTimer_percentile (id, 0.99)));
+	RETVAL = newRV_noinc ((SV *) result);
+OUTPUT:
+	RETVAL
+
+
+UV
+percentile(phase, fraction)
+	SV *phase
+	double fraction
+CODE:
+	RETVAL = (UV) TickTimer_percentile (tickPhaseOf (phase), fraction);
+OUTPUT:
+	RETVAL
+
+
+void
+reset()
+CODE:
+	TickTimer_reset ();
+
+
+MODULE = FastUtils	PACKAGE = Utils::TimerWheel
+PROTOTYPES: ENABLE
+
+
+SV *
+new(klass, resolution = 0.01)
+	SV *klass
+	double resolution
+INIT:
+	NamedTimerWheel *self;
+CODE:
+	if (!(resolution > 0))
+		croak ("The resolution of a timer wheel must be positive");
+	Newx (self, 1, NamedTimerWheel);
+	self->wheel = TimerWheel_new (resolution, currentTime ());
+	self->ids = newHV ();
+	self->names = newAV ();
+	RETVAL = newSV (0);
+	sv_setref_pv (RETVAL, SvPV_nolen (klass), (void *) self);
+OUTPUT:
+	RETVAL
+
+
+void
+set(self, name, seconds, since = &PL_sv_undef)
+	SV *self
+	SV *name
+	NV seconds
+	SV *since
+INIT:
+	NamedTimerWheel *wheel;
+CODE:
+	/* Due seconds after since, or after the time of the last expired() call */
+	wheel = timerWheelOf (self);
+	TimerWheel_set (wheel->wheel, timerOf (wheel, name, 1),
+		(SvOK (since) ? SvNV (since) : wheel->wheel->now) + seconds);
+
+
+void
+cancel(self, name)
+	SV *self
+	SV *name
+INIT:
+	NamedTimerWheel *wheel;
+	long timer;
+CODE:
+	wheel = timerWheelOf (self);
+	timer = timerOf (wheel, name, 0);
+	if (timer >= 0)
+		TimerWheel_cancel (wheel->wheel, timer);
+
+
+SV *
+remaining(self, name)
+	SV *self
+	SV *name
+INIT:
+	NamedTimerWheel *wheel;
+	long timer;
+CODE:
+	/* Seconds from the last expired() call to the deadline, undef if the timer isn't pending */
+	wheel = timerWheelOf (self);
+	timer = timerOf (wheel, name, 0);
+	if (timer < 0 || !TimerWheel_isPending (wheel->wheel, timer))
+		XSRETURN_UNDEF;
+	RETVAL = newSVnv (wheel->wheel->timers[timer].deadline - wheel->wheel->now);
+OUTPUT:
+	RETVAL
+
+
+void
+expired(self, now = &PL_sv_undef)
+	SV *self
+	SV *now
+INIT:
+	NamedTimerWheel *wheel;
+	long count, i;
+PPCODE:
+	/* The names of the timers which became due since the last call, which reads the clock once */
+	wheel = timerWheelOf (self);
+	count = TimerWheel_advance (wheel->wheel, SvOK (now) ? SvNV (now) : currentTime ());
+	EXTEND (SP, count);
+	for (i = 0; i < count; i++) {
+		SV **name = av_fetch (wheel->names, wheel->wheel->expired[i], 0);
+		PUSHs (name ? *name : &PL_sv_undef);
+	}
+
+
+NV
+now(self)
+	SV *self
+CODE:
+	RETVAL = timerWheelOf (self)->wheel->now;
+OUTPUT:
+	RETVAL
+
+
+int
+count(self)
+	SV *self
+CODE:
+	/* The number of pending timers */
+	RETVAL = timerWheelOf (self)->wheel->pending;
+OUTPUT:
+	RETVAL
+
+
+void
+DESTROY(self)
+	SV *self
+INIT:
+	NamedTimerWheel *wheel;
+CODE:
+	wheel = INT2PTR (NamedTimerWheel *, SvIV (SvRV (self)));
+	TimerWheel_destroy (wheel->wheel);
+	SvREFCNT_dec ((SV *) wheel->ids);
+	SvREFCNT_dec ((SV *) wheel->names);
+	Safefree (wheel);
+
+
+MODULE = FastUtils	PACKAGE = Misc
+PROTOTYPES: DISABLE
+
+
+void
+items_control(name, nameID = &PL_sv_undef)
+	SV *name
+	SV *nameID
+ALIAS:
+	mon_control = CONTROL_MONSTERS
+	pickupitems = CONTROL_PICKUP
+INIT:
+	HV *hv;
+	SV *entry = NULL;
+PPCODE:
+	/* The entry of the name, else of the ID, else of "all", else the default */
+	hv = controlTable (ix);
+	if (SvOK (name))
+		entry = controlNameEntry (hv, ix, name);
+	if (!entry && SvOK (nameID)) {
+		STRLEN len;
+		const char *key = SvPV (nameID, len);
+		entry = controlEntry (hv, ix, key, SvUTF8 (nameID) ? -(I32) len : (I32) len);
+	}
+	if (!entry)
+		entry = controlEntry (hv, ix, "all", 3);
+
+	if (entry) {
+		/* The entry itself, which callers copy */
+		ST (0) = entry;
+	} else if (ix == CONTROL_ITEMS) {
+		/* Do nothing */
+		ST (0) = sv_2mortal (newRV_noinc ((SV *) newHV ()));
+	} else if (ix == CONTROL_MONSTERS) {
+		/* Attack */
+		HV *control = newHV ();
+		(void) hv_stores (control, "attack_auto", newSViv (1));
+		ST (0) = sv_2mortal (newRV_noinc ((SV *) control));
+	} else {
+		/* Pick up */
+		ST (0) = sv_2mortal (newSViv (1));
+	}
+	XSRETURN (1);
+
+
+MODULE = FastUtils	PACKAGE = Plugins
+PROTOTYPES: DISABLE
+
+
+void
+callHook(hookName, argument = &PL_sv_undef)
+	SV *hookName
+	SV *argument
+INIT:
+	AV *entries;
+	SSize_t i, count;
+CODE:
+	entries = hookSubscribers (hookName);
+	if (!entries)
+		XSRETURN_EMPTY;
+
+	/* The list is replaced, not changed, when hooks are added or removed during
+	   the call; it's kept until the caller's temporaries are freed, even if a
+	   callback dies. Callbacks get copies, like they did from Perl. */
+	sv_2mortal (SvREFCNT_inc_simple_NN ((SV *) entries));
+	hookName = sv_2mortal (newSVsv (hookName));
+	argument = sv_2mortal (newSVsv (argument));
+	count = av_len (entries) + 1;
+	for (i = 0; i < count; i++) {
+		SV **entry = av_fetch (entries, i, 0);
+		SV **callback, **userData;
+		AV *fields;
+
+		if (!entry || !SvROK (*entry) || SvTYPE (SvRV (*entry)) != SVt_PVAV)
+			continue;
+		fields = (AV *) SvRV (*entry);
+		callback = av_fetch (fields, 0, 0);
+		if (!callback)
+			continue;
+		userData = av_fetch (fields, 1, 0);
+
+		ENTER;
+		SAVETMPS;
+		PUSHMARK (SP);
+		EXTEND (SP, 3);
+		PUSHs (hookName);
+		PUSHs (argument);
+		PUSHs (userData ? *userData : &PL_sv_undef);
+		PUTBACK;
+		call_sv (*callback, G_VOID | G_DISCARD);
+		SPAGAIN;
+		FREETMPS;
+		LEAVE;
+	}
+	XSRETURN_EMPTY;
+
+bool
+hasHook(hookName)
+	SV *hookName
+CODE:
+	RETVAL = hookSubscribers (hookName) != NULL;
+OUTPUT:
+	RETVAL
+
+
+MODULE = FastUtils	PACKAGE = Log
+PROTOTYPES: DISABLE
+
+
+bool
+isWanted(type, domain = &PL_sv_undef, level = &PL_sv_undef)
+	SV *type
+	SV *domain
+	SV *level
+CODE:
+	RETVAL = logWanted (logTypeOf (type), domain, level);
+OUTPUT:
+	RETVAL
+
+void
+messagef(domain, level, format, ...)
+	SV *domain
+	SV *level
+	SV *format
+ALIAS:
+	warningf = 1
+	errorf = 2
+	debugf = 3
+INIT:
+	static const char *const functions[] = { "Log::message", "Log::warning", "Log::error", "Log::debug" };
+	SV *message;
+	STRLEN len;
+	const char *pattern;
+CODE:
+	/* The arguments are only formatted, like sprintf() does, for a message someone gets */
+	if (!logWanted (ix, domain, level))
+		XSRETURN_EMPTY;
+	pattern = SvPV (format, len);
+	message = sv_2mortal (newSVpvs (""));
+	if (DO_UTF8 (format))
+		SvUTF8_on (message);
+	sv_vsetpvfn (message, pattern, len, NULL, &ST (3), items - 3, NULL);
+
+	PUSHMARK (SP);
+	EXTEND (SP, 3);
+	PUSHs (message);
+	PUSHs (domain);
+	PUSHs (level);
+	PUTBACK;
+	call_pv (functions[ix], G_VOID | G_DISCARD);
+	XSRETURN_EMPTY;
+
+
+MODULE = FastUtils	PACKAGE = Bus::Server::Relay
+PROTOTYPES: ENABLE
+
+
+SV *
+new(klass, port = 0, bind = &PL_sv_undef)
+	SV *klass
+	unsigned short port
+	SV *bind
+INIT:
+	BusRelay *relay;
+	char error[256];
+CODE:
+	relay = BusRelay_new (SvOK (bind) ? SvPV_nolen (bind) : NULL, port, error, sizeof (error));
+	if (!relay)
+		croak ("%s", error);
+	RETVAL = newSV (0);
+	sv_setref_pv (RETVAL, SvPV_nolen (klass), (void *) relay);
+OUTPUT:
+	RETVAL
+
+
+unsigned short
+getPort(self)
+	SV *self
+CODE:
+	RETVAL = BusRelay_port (busRelayOf (self));
+OUTPUT:
+	RETVAL
+
+
+void
+handle(self, ID)
+	SV *self
+	SV *ID
+INIT:
+	STRLEN len;
+	const char *bytes;
+CODE:
+	bytes = SvPVutf8 (ID, len);
+	BusRelay_handle (busRelayOf (self), bytes, (unsigned int) len);
+
+
+void
+setBroadcasts(self, id, enabled)
+	SV *self
+	UV id
+	bool enabled
+CODE:
+	BusRelay_setBroadcasts (busRelayOf (self), (unsigned int) id, enabled);
+
+
+bool
+send(self, id, data)
+	SV *self
+	UV id
+	SV *data
+INIT:
+	STRLEN len;
+	const char *buffer;
+CODE:
+	buffer = SvPV (data, len);
+	RETVAL = BusRelay_send (busRelayOf (self), (unsigned int) id, buffer, (unsigned int) len);
+OUTPUT:
+	RETVAL
+
+
+void
+close(self, id)
+	SV *self
+	UV id
+CODE:
+	BusRelay_close (busRelayOf (self), (unsigned int) id);
+
+
+int
+run(self, timeout = -1)
+	SV *self
+	int timeout
+CODE:
+	RETVAL = BusRelay_run (busRelayOf (self), timeout);
+OUTPUT:
+	RETVAL
+
+
+void
+take(self)
+	SV *self
+INIT:
+	AV *events;
+	I32 i;
+PPCODE:
+	events = (AV *) sv_2mortal ((SV *) newAV ());
+	BusRelay_take (busRelayOf (self), takeBusEvent, events);
+	EXTEND (SP, av_len (events) + 1);
+	for (i = 0; i <= av_len (events); i++)
+		PUSHs (*av_fetch (events, i, 0));
+
+
+unsigned int
+count(self)
+	SV *self
+CODE:
+	RETVAL = BusRelay_count (busRelayOf (self));
+OUTPUT:
+	RETVAL
+
+
+void
+queue(self, id)
+	SV *self
+	UV id
+INIT:
+	unsigned int frames;
+	unsigned long bytes;
+PPCODE:
+	/* The frames and bytes queued for the client, nothing if it isn't connected */
+	if (!BusRelay_queue (busRelayOf (self), (unsigned int) id, &frames, &bytes))
+		XSRETURN_EMPTY;
+	EXTEND (SP, 2);
+	mPUSHu (frames);
+	mPUSHu (bytes);
+
+
+UV
+relayed(self)
+	SV *self
+ALIAS:
+	delivered = 1
+CODE:
+	RETVAL = ix ? BusRelay_delivered (busRelayOf (self)) : BusRelay_relayed (busRelayOf (self));
+OUTPUT:
+	RETVAL
+
+
+void
+DESTROY(self)
+	SV *self
+CODE:
+	BusRelay_free (busRelayOf (self));
+
+
+MODULE = FastUtils	PACKAGE = Bus::Messages::Native
+PROTOTYPES: ENABLE
+
+
+SV *
+serialize(ID, arguments = &PL_sv_undef)
+	SV *ID
+	SV *arguments
+INIT:
+	STRLEN len;
+	const char *bytes;
+	unsigned char *out;
+	char header[2];
+	int options;
+CODE:
+	/* No arguments or a hash are sent as a map, anything else must be an array */
+	options = 0;
+	if (SvTRUE (arguments)) {
+		if (!SvROK (arguments))
+			croak ("Not an ARRAY reference");
+		if (SvTYPE (SvRV (arguments)) != SVt_PVHV || SvOBJECT (SvRV (arguments))) {
+			if (SvTYPE (SvRV (arguments)) != SVt_PVAV)
+				croak ("Not an ARRAY reference");
+			options = 1;
+		}
+	}
+
+	RETVAL = newSV (256);
+	sv_setpvn (RETVAL, "\0\0\0\0", 4);
+	bytes = SvPV (ID, len);
+	header[0] = (char) options;
+	header[1] = (char) (len & 0xFF);
+	sv_catpvn (RETVAL, header, 2);
+	sv_catpvn (RETVAL, bytes, len);
+
+	if (options == 0 && SvTRUE (arguments)) {
+		HV *hash = (HV *) SvRV (arguments);
+		HE *entry;
+
+		hv_iterinit (hash);
+		while ((entry = hv_iternext (hash))) {
+			SV *key = hv_iterkeysv (entry);
+			bytes = SvPV (key, len);
+			header[0] = (char) (len & 0xFF);
+			sv_catpvn (RETVAL, header, 1);
+			sv_catpvn (RETVAL, bytes, len);
+			busAppendValue (RETVAL, hv_iterval (hash, entry));
+		}
+
+	} else if (options == 1) {
+		AV *array = (AV *) SvRV (arguments);
+		SSize_t i, last = av_len (array);
+
+		for (i = 0; i <= last; i++) {
+			SV **entry = av_fetch (array, i, 0);
+			busAppendValue (RETVAL, entry ? *entry : NULL);
+		}
+	}
+
+	out = (unsigned char *) SvPV (RETVAL, len);
+	out[0] = (unsigned char) ((len >> 24) & 0xFF);
+	out[1] = (unsigned char) ((len >> 16) & 0xFF);
+	out[2] = (unsigned char) ((len >> 8) & 0xFF);
+	out[3] = (unsigned char) (len & 0xFF);
+OUTPUT:
+	RETVAL
+
+
+void
+unserialize(data, offset = 0)
+	SV *data
+	UV offset
+INIT:
+	STRLEN len, messageLen, IDLen, count, start;
+	const unsigned char *bytes;
+	const char *ID, *field;
+	BusReader reader;
+	unsigned int options, type;
+	SV *args, *value;
+	int invalid;
+PPCODE:
+	/* Nothing is returned until the message starting at the offset is complete */
+	bytes = (const unsigned char *) SvPV (data, len);
+	if (offset > len || len - offset < 4)
+		XSRETURN_EMPTY;
+	reader.data = bytes + offset;
+	reader.size = len - offset;
+	messageLen = ((STRLEN) reader.data[0] << 24) | ((STRLEN) reader.data[1] << 16)
+		| ((STRLEN) reader.data[2] << 8) | reader.data[3];
+	if (reader.size < messageLen)
+		XSRETURN_EMPTY;
+
+	reader.offset = 4;
+	options = busReadByte (&reader);
+	IDLen = busReadBytes (&reader, busReadByte (&reader), &ID);
+	if (!is_utf8_string ((const U8 *) ID, IDLen)) {
+		EXTEND (SP, 3);
+		PUSHs (&PL_sv_undef);
+		mPUSHs (newSVpvs ("UTF8MalformedException"));
+		mPUSHs (newSVpvs ("Malformed UTF-8 data in message ID."));
+		XSRETURN (3);
+	}
+
+	invalid = 0;
+	if (options == 0) {
+		HV *hash = newHV ();
+
+		args = sv_2mortal (newRV_noinc ((SV *) hash));
+		while (reader.offset < messageLen) {
+			const char *key;
+			STRLEN keyLen;
+
+			keyLen = busReadBytes (&reader, busReadByte (&reader), &key);
+			type = busReadByte (&reader);
+			count = busReadInt24 (&reader);
+			start = reader.offset;
+			len = busReadBytes (&reader, count, &field);
+			reader.offset = start + count;
+			value = busValue (type, field, &len);
+			if (!value) {
+				invalid = 1;
+				break;
+			}
+			/* A negative length stores the key as UTF-8, as assigning with a key which has the flag on does */
+			hv_store (hash, key, -(I32) keyLen, value, 0);
+		}
+
+	} else {
+		AV *array = newAV ();
+
+		args = sv_2mortal (newRV_noinc ((SV *) array));
+		while (reader.offset < messageLen) {
+			type = busReadByte (&reader);
+			count = busReadInt24 (&reader);
+			start = reader.offset;
+			len = busReadBytes (&reader, count, &field);
+			reader.offset = start + count;
+			value = busValue (type, field, &len);
+			if (!value) {
+				invalid = 1;
+				break;
+			}
+			av_push (array, value);
+		}
+	}
+
+	if (invalid) {
+		/* Stopped at an integer with a wrong length */
+		EXTEND (SP, 3);
+		PUSHs (&PL_sv_undef);
+		mPUSHs (newSVpvs ("DataFormatException"));
+		mPUSHs (newSVpvf ("Integer value with invalid length (%" UVuf ") found.", (UV) len));
+		XSRETURN (3);
+	}
+
+	value = newSVpvn (ID, IDLen);
+	SvUTF8_on (value);
+	EXTEND (SP, 3);
+	PUSHs (args);
+	mPUSHs (value);
+	mPUSHu ((UV) messageLen);
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+#include "fieldcache.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+static inline unsigned int
+readLong (const unsigned char *data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int) data[3] << 24);
+}
+
+static inline unsigned int
+readShort (const unsigned char *data)
+{
+	return data[0] | (data[1] << 8);
+}
+
+static void
+unmapFile (FieldCache *cache)
+{
+#ifdef WIN32
+	UnmapViewOfFile (cache->base);
+	CloseHandle ((HANDLE) cache->mapping);
+#else
+	munmap (cache->base, cache->size);
+#endif /* WIN32 */
+}
+
+// Maps the file copy-on-write, returns 0 if it cannot be opened or is empty
+static int
+mapFile (FieldCache *cache, const char *filename)
+{
+#ifdef WIN32
+	HANDLE file = CreateFileA (filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	LARGE_INTEGER size;
+	if (file == INVALID_HANDLE_VALUE) {
+		return 0;
+	}
+	if (!GetFileSizeEx (file, &size) || size.QuadPart == 0 || size.HighPart != 0) {
+		CloseHandle (file);
+		return 0;
+	}
+	cache->mapping = CreateFileMappingA (file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle (file);
+	if (!cache->mapping) {
+		return 0;
+	}
+	cache->base = (unsigned char *) MapViewOfFile ((HANDLE) cache->mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (!cache->base) {
+		CloseHandle ((HANDLE) cache->mapping);
+		return 0;
+	}
+	cache->size = size.LowPart;
+#else
+	struct stat st;
+	int fd = open (filename, O_RDONLY);
+	if (fd < 0) {
+		return 0;
+	}
+	if (fstat (fd, &st) != 0 || st.st_size == 0) {
+		close (fd);
+		return 0;
+	}
+	// Private and writable, so the layers can be the buffers of modifiable Perl strings without ever changing the file
+	void *base = mmap (NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close (fd);
+	if (base == MAP_FAILED) {
+		return 0;
+	}
+	cache->base = (unsigned char *) base;
+	cache->size = st.st_size;
+#endif /* WIN32 */
+	return 1;
+}
+
+// Maps a field cache file and checks its header and layer table.
+// Returns NULL if the file cannot be read, has another version or is truncated.
+FieldCache *
+FieldCache_open (const char *filename)
+{
+	FieldCache *cache = (FieldCache *) malloc (sizeof (FieldCache));
+	unsigned int i;
+
+	if (!mapFile (cache, filename)) {
+		free (cache);
+		return NULL;
+	}
+
+	if (cache->size < FIELD_CACHE_HEADER_SIZE || memcmp (cache->base, "FLDC", 4) != 0 || readLong (cache->base + 4) != FIELD_CACHE_VERSION) {
+		FieldCache_close (cache);
+		return NULL;
+	}
+	cache->width = readShort (cache->base + 8);
+	cache->height = readShort (cache->base + 10);
+	cache->layerCount = readLong (cache->base + 12);
+	cache->sourceSize = readLong (cache->base + 16);
+	cache->sourceTime = readLong (cache->base + 20);
+
+	if (cache->layerCount > FIELD_CACHE_MAX_LAYERS || cache->size < FIELD_CACHE_HEADER_SIZE + (unsigned long) cache->layerCount * FIELD_CACHE_LAYER_SIZE) {
+		FieldCache_close (cache);
+		return NULL;
+	}
+	for (i = 0; i < cache->layerCount; i++) {
+		const unsigned char *entry = cache->base + FIELD_CACHE_HEADER_SIZE + i * FIELD_CACHE_LAYER_SIZE;
+		cache->layers[i].id = readLong (entry);
+		cache->layers[i].offset = readLong (entry + 4);
+		cache->layers[i].length = readLong (entry + 8);
+		// The zero byte after the layer must be in the file too
+		if ((unsigned long) cache->layers[i].offset + cache->layers[i].length >= cache->size || cache->base[cache->layers[i].offset + cache->layers[i].length] != 0) {
+			FieldCache_close (cache);
+			return NULL;
+		}
+	}
+	return cache;
+}
+
+// Returns the layer with the given id, or NULL if the file has none
+const FieldCache_layer *
+FieldCache_findLayer (const FieldCache *cache, unsigned int id)
+{
+	unsigned int i;
+	for (i = 0; i < cache->layerCount; i++) {
+		if (cache->layers[i].id == id) {
+			return &cache->layers[i];
+		}
+	}
+	return NULL;
+}
+
+// Unmaps the file, the layers must not be used anymore
+void
+FieldCache_close (FieldCache *cache)
+{
+	unmapFile (cache);
+	free (cache);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,56 @@
+#ifndef _FIELDCACHE_H_
+#define _FIELDCACHE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Reader of .fldc field cache files, which hold a field and the maps derived from it in one uncompressed file.
+// The file is mapped copy-on-write, so the pages of a field loaded by several bot processes are shared between them
+// until one of them writes to its copy.
+//
+// Layout, all numbers little endian unsigned 32 bit:
+//   "FLDC", version, width and height (16 bit each), layer count, source file size, source file time
+//   then for each layer: id, offset, length
+// Layers start on FIELD_CACHE_ALIGNMENT boundaries and are followed by at least one zero byte,
+// so they can be used as the buffers of Perl strings.
+
+#define FIELD_CACHE_VERSION 1
+#define FIELD_CACHE_ALIGNMENT 4096
+#define FIELD_CACHE_HEADER_SIZE 24
+#define FIELD_CACHE_LAYER_SIZE 12
+#define FIELD_CACHE_MAX_LAYERS 64
+
+typedef struct {
+	unsigned int id;
+	unsigned int offset;
+	unsigned int length;
+} FieldCache_layer;
+
+typedef struct {
+	unsigned char *base;
+	unsigned long size;
+#ifdef WIN32
+	void *mapping;
+#endif
+
+	int width;
+	int height;
+	unsigned int sourceSize;
+	unsigned int sourceTime;
+
+	unsigned int layerCount;
+	FieldCache_layer layers[FIELD_CACHE_MAX_LAYERS];
+} FieldCache;
+
+FieldCache *FieldCache_open (const char *filename);
+
+const FieldCache_layer *FieldCache_findLayer (const FieldCache *cache, unsigned int id);
+
+void FieldCache_close (FieldCache *cache);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _FIELDCACHE_H_ */
@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "fieldchunks.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+FieldChunks *
+FieldChunks_new (const unsigned char *data, int width, int height, int hotCapacity)
+{
+	FieldChunks *chunks = (FieldChunks *) calloc (1, sizeof(FieldChunks));
+	unsigned char cells[FIELD_CHUNK_CELLS];
+	unsigned char *buffer;
+	uLongf bufferLength = compressBound (FIELD_CHUNK_CELLS);
+	long count, chunk;
+	int i;
+
+	if (hotCapacity < 1) {
+		hotCapacity = 1;
+	}
+	chunks->width = width;
+	chunks->height = height;
+	chunks->columns = (width + FIELD_CHUNK_SIZE - 1) >> FIELD_CHUNK_BITS;
+	chunks->rows = (height + FIELD_CHUNK_SIZE - 1) >> FIELD_CHUNK_BITS;
+	count = (long) chunks->columns * chunks->rows;
+	chunks->chunks = (FieldChunk *) calloc (count > 0 ? count : 1, sizeof(FieldChunk));
+	chunks->hotCapacity = hotCapacity;
+	chunks->hot = (unsigned char *) malloc ((size_t) hotCapacity * FIELD_CHUNK_CELLS);
+	chunks->hotChunk = (long *) malloc (hotCapacity * sizeof(long));
+	chunks->hotUsed = (unsigned long *) calloc (hotCapacity, sizeof(unsigned long));
+	for (i = 0; i < hotCapacity; i++) {
+		chunks->hotChunk[i] = FIELD_CHUNKS_NONE;
+	}
+
+	buffer = (unsigned char *) malloc (bufferLength);
+	for (chunk = 0; chunk < count; chunk++) {
+		int left = (int) (chunk % chunks->columns) << FIELD_CHUNK_BITS;
+		int top = (int) (chunk / chunks->columns) << FIELD_CHUNK_BITS;
+		int cellsWide = (width - left < FIELD_CHUNK_SIZE) ? width - left : FIELD_CHUNK_SIZE;
+		uLongf packedLength = bufferLength;
+		int row;
+
+		memset (cells, 0, sizeof(cells));
+		for (row = 0; row < FIELD_CHUNK_SIZE && top + row < height; row++) {
+			memcpy (cells + (row << FIELD_CHUNK_BITS), data + (long) (top + row) * width + left, cellsWide);
+		}
+		if (compress (buffer, &packedLength, cells, FIELD_CHUNK_CELLS) != Z_OK) {
+			free (buffer);
+			FieldChunks_destroy (chunks);
+			return NULL;
+		}
+		chunks->chunks[chunk].packed = (unsigned char *) malloc (packedLength);
+		memcpy (chunks->chunks[chunk].packed, buffer, packedLength);
+		chunks->chunks[chunk].packedLength = packedLength;
+		chunks->chunks[chunk].slot = FIELD_CHUNKS_NONE;
+		chunks->packedSize += packedLength;
+	}
+	free (buffer);
+	return chunks;
+}
+
+const unsigned char *
+FieldChunks_chunk (FieldChunks *chunks, long chunk)
+{
+	FieldChunk *entry = &chunks->chunks[chunk];
+	uLongf length = FIELD_CHUNK_CELLS;
+	int slot, i;
+
+	if (entry->slot != FIELD_CHUNKS_NONE) {
+		chunks->hotUsed[entry->slot] = ++chunks->clock;
+		return chunks->hot + (size_t) entry->slot * FIELD_CHUNK_CELLS;
+	}
+
+	// Take the slot read the longest ago, free ones were never read
+	slot = 0;
+	for (i = 1; i < chunks->hotCapacity; i++) {
+		if (chunks->hotUsed[i] < chunks->hotUsed[slot]) {
+			slot = i;
+		}
+	}
+	if (chunks->hotChunk[slot] != FIELD_CHUNKS_NONE) {
+		chunks->chunks[chunks->hotChunk[slot]].slot = FIELD_CHUNKS_NONE;
+	}
+	if (uncompress (chunks->hot + (size_t) slot * FIELD_CHUNK_CELLS, &length, entry->packed, entry->packedLength) != Z_OK
+	 || length != FIELD_CHUNK_CELLS) {
+		// Can't happen with the chunks compressed above, read the chunk as unwalkable rather than garbage
+		memset (chunks->hot + (size_t) slot * FIELD_CHUNK_CELLS, 0, FIELD_CHUNK_CELLS);
+	}
+	chunks->hotChunk[slot] = chunk;
+	chunks->hotUsed[slot] = ++chunks->clock;
+	entry->slot = slot;
+	chunks->decodes++;
+	return chunks->hot + (size_t) slot * FIELD_CHUNK_CELLS;
+}
+
+void
+FieldChunks_region (FieldChunks *chunks, int x, int y, int width, int height, unsigned char *out)
+{
+	int row;
+
+	memset (out, 0, (size_t) width * height);
+	for (row = (y < 0) ? -y : 0; row < height && y + row < chunks->height; row++) {
+		int cellY = y + row;
+		int column = (x < 0) ? -x : 0;
+
+		while (column < width && x + column < chunks->width) {
+			int cellX = x + column;
+			int inChunk = cellX & (FIELD_CHUNK_SIZE - 1);
+			int length = FIELD_CHUNK_SIZE - inChunk;
+			long chunk = (long) (cellY >> FIELD_CHUNK_BITS) * chunks->columns + (cellX >> FIELD_CHUNK_BITS);
+			const unsigned char *cells = FieldChunks_chunk (chunks, chunk);
+
+			if (length > width - column) {
+				length = width - column;
+			}
+			if (length > chunks->width - cellX) {
+				length = chunks->width - cellX;
+			}
+			memcpy (out + (long) row * width + column, cells + ((cellY & (FIELD_CHUNK_SIZE - 1)) << FIELD_CHUNK_BITS) + inChunk, length);
+			column += length;
+		}
+	}
+}
+
+void
+FieldChunks_destroy (FieldChunks *chunks)
+{
+	long count = (long) chunks->columns * chunks->rows;
+	long chunk;
+
+	for (chunk = 0; chunk < count; chunk++) {
+		free (chunks->chunks[chunk].packed);
+	}
+	free (chunks->chunks);
+	free (chunks->hot);
+	free (chunks->hotChunk);
+	free (chunks->hotUsed);
+	free (chunks);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,71 @@
+#ifndef _FIELDCHUNKS_H_
+#define _FIELDCHUNKS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// The raw map of a field cut in FIELD_CHUNK_SIZE x FIELD_CHUNK_SIZE chunks, each one compressed with zlib. A chunk is
+// decompressed the first time one of its cells is read, into one of 'hotCapacity' slots; when they're all taken, the
+// chunk read the longest ago is dropped. A bot only walks a few chunks of a field at a time, so the map takes the
+// size of its compressed chunks and of the hot ones instead of one byte per cell.
+//
+// The chunks at the right and bottom edges are padded with zero (unwalkable) cells.
+
+#define FIELD_CHUNK_BITS 6
+#define FIELD_CHUNK_SIZE (1 << FIELD_CHUNK_BITS)
+#define FIELD_CHUNK_CELLS (FIELD_CHUNK_SIZE * FIELD_CHUNK_SIZE)
+#define FIELD_CHUNKS_NONE -1
+
+typedef struct {
+	unsigned char *packed;
+	unsigned long packedLength;
+	// Hot slot holding the decompressed chunk, FIELD_CHUNKS_NONE if it isn't decompressed
+	int slot;
+} FieldChunk;
+
+typedef struct {
+	int width;
+	int height;
+	// Chunks per row and per column
+	int columns;
+	int rows;
+	FieldChunk *chunks;
+
+	int hotCapacity;
+	// Decompressed cells of each hot slot, the chunk it holds (FIELD_CHUNKS_NONE for none) and when it was last read
+	unsigned char *hot;
+	long *hotChunk;
+	unsigned long *hotUsed;
+	unsigned long clock;
+
+	// Total size of the compressed chunks and number of chunks decompressed so far
+	unsigned long packedSize;
+	unsigned long decodes;
+} FieldChunks;
+
+// Cuts and compresses 'data', which holds width * height cells. Returns NULL if a chunk can't be compressed.
+FieldChunks *FieldChunks_new (const unsigned char *data, int width, int height, int hotCapacity);
+
+// Returns the decompressed cells of a chunk, which stay valid until another chunk is read
+const unsigned char *FieldChunks_chunk (FieldChunks *chunks, long chunk);
+
+// Returns the cell (x, y), which must be on the map
+static inline unsigned char
+FieldChunks_cell (FieldChunks *chunks, int x, int y)
+{
+	long chunk = (long) (y >> FIELD_CHUNK_BITS) * chunks->columns + (x >> FIELD_CHUNK_BITS);
+	return FieldChunks_chunk (chunks, chunk)[((y & (FIELD_CHUNK_SIZE - 1)) << FIELD_CHUNK_BITS) | (x & (FIELD_CHUNK_SIZE - 1))];
+}
+
+// Copies the cells of the width x height region whose top left cell is (x, y) to 'out', row by row.
+// Cells of the region which are out of the map are zero.
+void FieldChunks_region (FieldChunks *chunks, int x, int y, int width, int height, unsigned char *out);
+
+void FieldChunks_destroy (FieldChunks *chunks);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _FIELDCHUNKS_H_ */
@@ -0,0 +1,106 @@
+#include <stdio.h>
+#include <string.h>
+#include "fieldimage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define COLOR_COUNT 8
+
+// Colors of the tile types, the characters are the XPM color names
+static const char color_names[COLOR_COUNT] = { 'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H' };
+static const unsigned char color_values[COLOR_COUNT][3] = {
+	{ 0x31, 0x31, 0x31 },	// A: no walk
+	{ 0xFA, 0xFA, 0xFA },	// B: walk
+	{ 0xCC, 0xA8, 0x6C },	// C: snipe
+	{ 0x00, 0x88, 0xCC },	// D: water
+	{ 0x39, 0x9B, 0xCC },	// E: walk and water
+	{ 0x69, 0x62, 0x62 },	// F: cliff
+	{ 0xCC, 0xA8, 0x6C },	// G: snipe and cliff
+	{ 0x31, 0x31, 0x31 }	// H: anything else
+};
+
+static const char xpm_start[] = "/* XPM */\nstatic char * my_xpm[] = {\n\"";
+
+// Color index of every combination of the tile flags: walkable water, then walk, water, snipe and cliff, in that order
+static const unsigned char tile_colors[16] = {
+	7, 1, 2, 1,	// none, walk, snipe, walk and snipe
+	3, 4, 3, 4,	// with water
+	5, 1, 6, 1,	// with cliff
+	3, 4, 3, 4	// with water and cliff
+};
+
+void
+FieldImage_renderRGB (const unsigned char *rawMap, int width, int height, unsigned char *rgb)
+{
+	int x;
+	int y;
+
+	for (y = height - 1; y >= 0; y--) {
+		const unsigned char *row = rawMap + ((long) y * width);
+		for (x = 0; x < width; x++) {
+			const unsigned char *color = color_values[tile_colors[row[x] & 15]];
+			rgb[0] = color[0];
+			rgb[1] = color[1];
+			rgb[2] = color[2];
+			rgb += 3;
+		}
+	}
+}
+
+// The size line and the color lines
+static unsigned long
+xpmHeader (int width, int height, char *xpm)
+{
+	char size[32];
+	unsigned long length = 0;
+	int i;
+
+	snprintf(size, sizeof(size), "%d %d 8 1\",\n", width, height);
+	if (xpm) {
+		memcpy(xpm, xpm_start, sizeof(xpm_start) - 1);
+		memcpy(xpm + sizeof(xpm_start) - 1, size, strlen(size));
+	}
+	length = sizeof(xpm_start) - 1 + strlen(size);
+
+	for (i = 0; i < COLOR_COUNT; i++) {
+		if (xpm) {
+			snprintf(xpm + length, 16, "\"%c\tc #%02X%02X%02X\",\n", color_names[i],
+				color_values[i][0], color_values[i][1], color_values[i][2]);
+		}
+		length += 15;
+	}
+	return length;
+}
+
+unsigned long
+FieldImage_xpmSize (int width, int height)
+{
+	// Every row is quoted and followed by a comma and a line break, then the closing "};\n"
+	return xpmHeader(width, height, NULL) + (unsigned long) height * (width + 4) + 3;
+}
+
+void
+FieldImage_renderXPM (const unsigned char *rawMap, int width, int height, char *xpm)
+{
+	int x;
+	int y;
+
+	xpm += xpmHeader(width, height, xpm);
+	for (y = height - 1; y >= 0; y--) {
+		const unsigned char *row = rawMap + ((long) y * width);
+		*xpm++ = '"';
+		for (x = 0; x < width; x++) {
+			*xpm++ = color_names[tile_colors[row[x] & 15]];
+		}
+		*xpm++ = '"';
+		*xpm++ = ',';
+		*xpm++ = '\n';
+	}
+	memcpy(xpm, "};\n", 3);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
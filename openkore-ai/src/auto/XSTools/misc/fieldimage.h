@@ -0,0 +1,25 @@
+#ifndef _FIELDIMAGE_H_
+#define _FIELDIMAGE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Map images of raw field data, shared by Utils::xpmmake and Utils::fieldImage.
+// Images start with the top row of the map (the highest y), like the client shows it.
+// Both renderers write into buffers preallocated by the caller, so no intermediate strings are built.
+
+// Fills 'rgb', width * height * 3 bytes, with the RGB map image
+void FieldImage_renderRGB (const unsigned char *rawMap, int width, int height, unsigned char *rgb);
+
+// Size in bytes of the XPM image text of a map
+unsigned long FieldImage_xpmSize (int width, int height);
+
+// Writes the XPM image text of a map into 'xpm', which must have room for FieldImage_xpmSize bytes
+void FieldImage_renderXPM (const unsigned char *rawMap, int width, int height, char *xpm);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _FIELDIMAGE_H_ */
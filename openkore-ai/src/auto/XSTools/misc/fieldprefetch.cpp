@@ -0,0 +1,369 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef WIN32
+	// Condition variables need Windows Vista
+	#if !defined(_WIN32_WINNT) || _WIN32_WINNT < 0x0600
+		#undef _WIN32_WINNT
+		#define _WIN32_WINNT 0x0600
+	#endif
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+#include <zlib.h>
+#include <vector>
+#include "distmap.h"
+#include "../PathFinding/algorithm.h"
+#include "../OSL/Threading/Executor.h"
+#include "../utils/c-bindings/executor.h"
+#include "fieldprefetch.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#ifdef WIN32
+	typedef CRITICAL_SECTION PrefetchMutex;
+	typedef CONDITION_VARIABLE PrefetchCondition;
+	#define prefetchLock(mutex) EnterCriticalSection(mutex)
+	#define prefetchUnlock(mutex) LeaveCriticalSection(mutex)
+	#define prefetchWait(condition, mutex) SleepConditionVariableCS(condition, mutex, INFINITE)
+	#define prefetchBroadcast(condition) WakeAllConditionVariable(condition)
+#else
+	typedef pthread_mutex_t PrefetchMutex;
+	typedef pthread_cond_t PrefetchCondition;
+	#define prefetchLock(mutex) pthread_mutex_lock(mutex)
+	#define prefetchUnlock(mutex) pthread_mutex_unlock(mutex)
+	#define prefetchWait(condition, mutex) pthread_cond_wait(condition, mutex)
+	#define prefetchBroadcast(condition) pthread_cond_broadcast(condition)
+#endif /* WIN32 */
+
+// Runs the oldest queued job, if there is one left, on a thread of the shared pool
+class PrefetchTask: public OSL::Task {
+public:
+	virtual void run();
+};
+
+// The jobs of the process, all of this state is protected by 'mutex'.
+// Each queued job submits a task, which runs whichever job is the oldest then,
+// so there are always at least as many tasks to come as queued jobs.
+static struct {
+	int initialized;
+	PrefetchMutex mutex;
+	// Signaled when a job is done
+	PrefetchCondition jobDone;
+
+	// Jobs in the order they were queued, linked through FieldPrefetch_job->next
+	FieldPrefetch_job *jobs;
+	int jobCount;
+
+	// Submitted tasks, freed once the pool is done with them
+	std::vector<PrefetchTask *> *tasks;
+} prefetch;
+
+static void
+prefetchInit ()
+{
+	if (prefetch.initialized) {
+		return;
+	}
+#ifdef WIN32
+	InitializeCriticalSection(&prefetch.mutex);
+	InitializeConditionVariable(&prefetch.jobDone);
+#else
+	pthread_mutex_init(&prefetch.mutex, NULL);
+	pthread_cond_init(&prefetch.jobDone, NULL);
+#endif /* WIN32 */
+	prefetch.jobs = NULL;
+	prefetch.jobCount = 0;
+	prefetch.tasks = new std::vector<PrefetchTask *>();
+	prefetch.initialized = 1;
+}
+
+// Returns 0 if the file does not exist
+static int
+fileStat (const char *filename, long long *size, long long *time)
+{
+#ifdef WIN32
+	struct __stat64 info;
+	if (_stat64 (filename, &info) != 0) {
+		return 0;
+	}
+#else
+	struct stat info;
+	if (stat (filename, &info) != 0) {
+		return 0;
+	}
+#endif /* WIN32 */
+	*size = (long long) info.st_size;
+	*time = (long long) info.st_mtime;
+	return 1;
+}
+
+// Reads the field file of the job, like Utils::inflateField, and builds its maps if asked to.
+// Runs without the lock, the job belongs to the thread while it is running.
+static int
+loadJob (FieldPrefetch_job *job)
+{
+	unsigned char header[4];
+	unsigned long size;
+	unsigned long done;
+	int read = 0;
+	gzFile gz;
+
+	if (!fileStat (job->filename, &job->fileSize, &job->fileTime)) {
+		return 0;
+	}
+	gz = gzopen (job->filename, "rb");
+	if (!gz) {
+		return 0;
+	}
+	if (gzread (gz, header, 4) != 4) {
+		gzclose (gz);
+		return 0;
+	}
+	job->width = header[0] | (header[1] << 8);
+	job->height = header[2] | (header[3] << 8);
+	size = (unsigned long) job->width * job->height;
+
+	job->rawMap = (unsigned char *) malloc (size + 1);
+	if (!job->rawMap) {
+		gzclose (gz);
+		return 0;
+	}
+	done = 0;
+	while (done < size) {
+		read = gzread (gz, job->rawMap + done, (unsigned int) (size - done));
+		if (read <= 0) {
+			break;
+		}
+		done += read;
+	}
+	gzclose (gz);
+	if (read < 0) {
+		return 0;
+	}
+	job->rawSize = done;
+
+	if (!job->buildMaps || done != size || size == 0) {
+		return 1;
+	}
+	job->distMap = (unsigned char *) malloc (size);
+	job->weightMap = (char *) malloc (size);
+	job->neighborMask = (unsigned char *) malloc (size);
+	job->components = (unsigned char *) malloc (size * 2);
+	if (!job->distMap || !job->weightMap || !job->neighborMask || !job->components) {
+		return 0;
+	}
+	makeFieldMaps_inner (job->rawMap, job->width, job->height, job->distMap, job->weightMap);
+	CalcPath_buildNeighborMask (job->weightMap, job->width, job->height, job->neighborMask);
+	CalcPath_buildComponents (job->weightMap, job->width, job->height, job->components);
+	return 1;
+}
+
+// Removes the job from the list, the caller owns it afterwards
+static void
+unlinkJob (FieldPrefetch_job *job)
+{
+	FieldPrefetch_job **link = &prefetch.jobs;
+	while (*link && *link != job) {
+		link = &(*link)->next;
+	}
+	if (*link) {
+		*link = job->next;
+		job->next = NULL;
+		prefetch.jobCount--;
+	}
+}
+
+static FieldPrefetch_job *
+findJob (const char *filename)
+{
+	FieldPrefetch_job *job;
+	for (job = prefetch.jobs; job; job = job->next) {
+		if (strcmp (job->filename, filename) == 0) {
+			return job;
+		}
+	}
+	return NULL;
+}
+
+void
+PrefetchTask::run ()
+{
+	FieldPrefetch_job *job;
+	int ok;
+
+	prefetchLock(&prefetch.mutex);
+	for (job = prefetch.jobs; job && job->status != FIELD_PREFETCH_QUEUED; job = job->next);
+	if (!job) {
+		// Taken, dropped or run by another task
+		prefetchUnlock(&prefetch.mutex);
+		return;
+	}
+	job->status = FIELD_PREFETCH_RUNNING;
+	prefetchUnlock(&prefetch.mutex);
+
+	ok = loadJob (job);
+
+	prefetchLock(&prefetch.mutex);
+	job->status = ok ? FIELD_PREFETCH_DONE : FIELD_PREFETCH_FAILED;
+	// Cancelled jobs were already unlinked by FieldPrefetch_clear
+	if (job->cancelled) {
+		FieldPrefetch_free (job);
+	}
+	prefetchBroadcast(&prefetch.jobDone);
+	prefetchUnlock(&prefetch.mutex);
+}
+
+// Submits a task for a new job, with the lock held, and frees the tasks which are done
+static void
+submitTask ()
+{
+	std::vector<PrefetchTask *> &tasks = *prefetch.tasks;
+	PrefetchTask *task;
+	size_t i = 0;
+
+	while (i < tasks.size ()) {
+		if (tasks[i]->isDone ()) {
+			delete tasks[i];
+			tasks[i] = tasks.back ();
+			tasks.pop_back ();
+		} else {
+			i++;
+		}
+	}
+	task = new PrefetchTask ();
+	tasks.push_back (task);
+	OSL::Executor::getInstance ()->submit (task);
+}
+
+// Queues the loading of a field file, 'buildMaps' also builds its distance map, weight map, neighbor mask and connected areas.
+// Returns 0 if the file is already queued or loaded, or the shared pool has no threads.
+int
+FieldPrefetch_queue (const char *filename, int buildMaps)
+{
+	FieldPrefetch_job *job;
+	FieldPrefetch_job *oldest;
+
+	prefetchInit ();
+	prefetchLock(&prefetch.mutex);
+	if (findJob (filename) || o_executor_start (0) == 0) {
+		prefetchUnlock(&prefetch.mutex);
+		return 0;
+	}
+
+	while (prefetch.jobCount >= FIELD_PREFETCH_MAX_JOBS) {
+		for (oldest = prefetch.jobs; oldest && oldest->status == FIELD_PREFETCH_RUNNING; oldest = oldest->next);
+		if (!oldest) {
+			break;
+		}
+		unlinkJob (oldest);
+		FieldPrefetch_free (oldest);
+	}
+
+	job = (FieldPrefetch_job *) calloc (1, sizeof(FieldPrefetch_job));
+	job->filename = strdup (filename);
+	job->buildMaps = buildMaps;
+	job->status = FIELD_PREFETCH_QUEUED;
+	if (prefetch.jobs) {
+		for (oldest = prefetch.jobs; oldest->next; oldest = oldest->next);
+		oldest->next = job;
+	} else {
+		prefetch.jobs = job;
+	}
+	prefetch.jobCount++;
+	submitTask ();
+	prefetchUnlock(&prefetch.mutex);
+	return 1;
+}
+
+// Returns the loaded job of a field file and removes it, NULL if there is none or the file changed since it was read.
+// Waits for a job which is running, a job which did not start yet is dropped: the caller is as fast at loading it.
+FieldPrefetch_job *
+FieldPrefetch_take (const char *filename)
+{
+	FieldPrefetch_job *job;
+	long long size, time;
+
+	if (!prefetch.initialized) {
+		return NULL;
+	}
+	prefetchLock(&prefetch.mutex);
+	job = findJob (filename);
+	while (job && job->status == FIELD_PREFETCH_RUNNING) {
+		prefetchWait(&prefetch.jobDone, &prefetch.mutex);
+		job = findJob (filename);
+	}
+	if (job) {
+		unlinkJob (job);
+	}
+	prefetchUnlock(&prefetch.mutex);
+
+	if (job && (job->status != FIELD_PREFETCH_DONE || !fileStat (filename, &size, &time)
+	 || size != job->fileSize || time != job->fileTime)) {
+		FieldPrefetch_free (job);
+		job = NULL;
+	}
+	return job;
+}
+
+// Returns the number of jobs which are queued or running
+int
+FieldPrefetch_pending ()
+{
+	FieldPrefetch_job *job;
+	int count = 0;
+
+	if (!prefetch.initialized) {
+		return 0;
+	}
+	prefetchLock(&prefetch.mutex);
+	for (job = prefetch.jobs; job; job = job->next) {
+		if (job->status == FIELD_PREFETCH_QUEUED || job->status == FIELD_PREFETCH_RUNNING) {
+			count++;
+		}
+	}
+	prefetchUnlock(&prefetch.mutex);
+	return count;
+}
+
+// Drops every job, a running job is freed by the thread when it is done
+void
+FieldPrefetch_clear ()
+{
+	FieldPrefetch_job *job;
+
+	if (!prefetch.initialized) {
+		return;
+	}
+	prefetchLock(&prefetch.mutex);
+	while ((job = prefetch.jobs)) {
+		unlinkJob (job);
+		if (job->status == FIELD_PREFETCH_RUNNING) {
+			job->cancelled = 1;
+		} else {
+			FieldPrefetch_free (job);
+		}
+	}
+	prefetchUnlock(&prefetch.mutex);
+}
+
+void
+FieldPrefetch_free (FieldPrefetch_job *job)
+{
+	free (job->filename);
+	free (job->rawMap);
+	free (job->distMap);
+	free (job->weightMap);
+	free (job->neighborMask);
+	free (job->components);
+	free (job);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,60 @@
+#ifndef _FIELDPREFETCH_H_
+#define _FIELDPREFETCH_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Background loading of the fields a bot is about to enter.
+// Field files are read, and their maps optionally built, by the shared native thread pool, so a map change only has to copy
+// the results instead of decompressing and preprocessing the field while packets are waiting.
+
+// Status of a prefetch job
+#define FIELD_PREFETCH_QUEUED 0
+#define FIELD_PREFETCH_RUNNING 1
+#define FIELD_PREFETCH_DONE 2
+#define FIELD_PREFETCH_FAILED 3
+
+// Oldest jobs which are not running are dropped when more are queued
+#define FIELD_PREFETCH_MAX_JOBS 8
+
+typedef struct FieldPrefetch_job {
+	char *filename;
+	int buildMaps;
+	int status;
+	int cancelled;
+
+	// Size and modification time of the file when it was read, the result is dropped if they changed since
+	long long fileSize;
+	long long fileTime;
+
+	int width;
+	int height;
+	// Raw field data, may be shorter than width * height if the file is truncated
+	unsigned char *rawMap;
+	unsigned long rawSize;
+
+	// Only built if buildMaps is set and the field is complete, the same as Utils::makeFieldMaps and PathFinding::makeComponents
+	unsigned char *distMap;
+	char *weightMap;
+	unsigned char *neighborMask;
+	unsigned char *components;
+
+	struct FieldPrefetch_job *next;
+} FieldPrefetch_job;
+
+int FieldPrefetch_queue (const char *filename, int buildMaps);
+
+FieldPrefetch_job *FieldPrefetch_take (const char *filename);
+
+int FieldPrefetch_pending ();
+
+void FieldPrefetch_clear ();
+
+void FieldPrefetch_free (FieldPrefetch_job *job);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _FIELDPREFETCH_H_ */
@@ -0,0 +1,354 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef WIN32
+	#ifndef _WIN32_WINNT
+		#define _WIN32_WINNT 0x0600
+	#endif
+	#define WIN32_LEAN_AND_MEAN
+	#include <winsock2.h>
+	#include <windows.h>
+	#define muxPoll WSAPoll
+#else
+	#include <sys/types.h>
+	#include <sys/socket.h>
+	#include <unistd.h>
+	#include <fcntl.h>
+	#if defined(__linux__)
+		#include <sys/epoll.h>
+		#define NETMUX_EPOLL
+	#else
+		#include <poll.h>
+		#define muxPoll poll
+	#endif
+#endif
+#include <string>
+#include <vector>
+#include "netmux.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Bytes read from a connection at once
+#define NETMUX_READ_SIZE (1024 * 64)
+// Sockets epoll reports at once
+#define NETMUX_EPOLL_EVENTS 64
+
+struct MuxConnection {
+	NetMux_socket socket;
+	Tokenizer *tokenizer;
+	// Tells the events of a connection apart from those of the one which had its ID before
+	unsigned int serial;
+	int used;
+	// Cleared once the connection was closed
+	int reading;
+};
+
+struct MuxEvent {
+	int id;
+	unsigned int serial;
+	int type;
+	std::string data;
+};
+
+struct NetMux {
+	std::vector<MuxConnection> *connections;
+	std::vector<MuxEvent> *events;
+	unsigned int count;
+	unsigned int serial;
+	char *buffer;
+#ifdef NETMUX_EPOLL
+	int epoll;
+#else
+	std::vector<struct pollfd> *polled;
+	std::vector<int> *polledIDs;
+#endif
+};
+
+static void
+pushEvent (NetMux *mux, int id, int type, const char *data, unsigned int len)
+{
+	MuxEvent event = MuxEvent ();
+
+	mux->events->push_back (event);
+	MuxEvent &pushed = mux->events->back ();
+	pushed.id = id;
+	pushed.serial = (*mux->connections)[id].serial;
+	pushed.type = type;
+	pushed.data.assign (data, len);
+}
+
+// Pushes the messages of a connection's tokenizer, and then what's left with NETMUX_CLOSED if it was closed
+static void
+pushMessages (NetMux *mux, int id, int closed)
+{
+	Tokenizer *tokenizer = (*mux->connections)[id].tokenizer;
+	std::string data;
+	int length;
+
+	while ((length = Tokenizer_next (tokenizer)) != 0) {
+		int type = NETMUX_MESSAGE;
+
+		if (length == TOKENIZER_UNKNOWN_MESSAGE) {
+			type = NETMUX_UNKNOWN;
+			length = tokenizer->size;
+		}
+		data.resize (length);
+		Tokenizer_copy (tokenizer, 0, length, &data[0]);
+		Tokenizer_remove (tokenizer, length);
+		pushEvent (mux, id, type, data.data (), length);
+	}
+	if (closed) {
+		data.resize (tokenizer->size);
+		if (tokenizer->size > 0) {
+			Tokenizer_copy (tokenizer, 0, tokenizer->size, &data[0]);
+		}
+		Tokenizer_remove (tokenizer, tokenizer->size);
+		pushEvent (mux, id, NETMUX_CLOSED, data.data (), (unsigned int) data.size ());
+	}
+}
+
+static void
+stopReading (NetMux *mux, int id)
+{
+	MuxConnection &connection = (*mux->connections)[id];
+
+	if (!connection.reading) {
+		return;
+	}
+	connection.reading = 0;
+#ifdef NETMUX_EPOLL
+	epoll_ctl (mux->epoll, EPOLL_CTL_DEL, connection.socket, NULL);
+#endif
+}
+
+// Reads what a ready connection received; returns whether anything happened
+static int
+readConnection (NetMux *mux, int id)
+{
+	MuxConnection &connection = (*mux->connections)[id];
+	int len;
+
+	if (!connection.used || !connection.reading) {
+		return 0;
+	}
+	len = recv (connection.socket, mux->buffer, NETMUX_READ_SIZE, 0);
+	if (len < 0) {
+#ifdef WIN32
+		int error = WSAGetLastError ();
+		if (error == WSAEWOULDBLOCK || error == WSAEINTR) {
+			return 0;
+		}
+#else
+		if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
+			return 0;
+		}
+#endif
+	}
+	if (len <= 0) {
+		stopReading (mux, id);
+		pushMessages (mux, id, 1);
+		return 1;
+	}
+	if (!Tokenizer_add (connection.tokenizer, mux->buffer, (unsigned int) len)) {
+		// Out of memory: the connection can't be followed anymore
+		stopReading (mux, id);
+		pushMessages (mux, id, 1);
+		return 1;
+	}
+	pushMessages (mux, id, 0);
+	return 1;
+}
+
+NetMux *
+NetMux_new (void)
+{
+	NetMux *mux = (NetMux *) calloc (1, sizeof(NetMux));
+
+#ifdef NETMUX_EPOLL
+	mux->epoll = epoll_create (NETMUX_EPOLL_EVENTS);
+	if (mux->epoll == -1) {
+		free (mux);
+		return NULL;
+	}
+	fcntl (mux->epoll, F_SETFD, fcntl (mux->epoll, F_GETFD, 0) | FD_CLOEXEC);
+#else
+	mux->polled = new std::vector<struct pollfd>;
+	mux->polledIDs = new std::vector<int>;
+#endif
+	mux->connections = new std::vector<MuxConnection>;
+	mux->events = new std::vector<MuxEvent>;
+	mux->buffer = (char *) malloc (NETMUX_READ_SIZE);
+	return mux;
+}
+
+int
+NetMux_add (NetMux *mux, NetMux_socket socket)
+{
+	std::vector<MuxConnection> &connections = *mux->connections;
+	Tokenizer *tokenizer;
+	unsigned int id;
+
+	for (id = 0; id < connections.size () && connections[id].used; id++);
+	tokenizer = Tokenizer_new ();
+	if (!tokenizer) {
+		return -1;
+	}
+#ifdef NETMUX_EPOLL
+	struct epoll_event event;
+	memset (&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.u32 = id;
+	if (epoll_ctl (mux->epoll, EPOLL_CTL_ADD, socket, &event) == -1) {
+		Tokenizer_free (tokenizer);
+		return -1;
+	}
+#endif
+	if (id == connections.size ()) {
+		connections.push_back (MuxConnection ());
+	}
+	connections[id].socket = socket;
+	connections[id].tokenizer = tokenizer;
+	connections[id].serial = ++mux->serial;
+	connections[id].used = 1;
+	connections[id].reading = 1;
+	mux->count++;
+	return (int) id;
+}
+
+Tokenizer *
+NetMux_tokenizer (NetMux *mux, int id)
+{
+	if (id < 0 || (unsigned int) id >= mux->connections->size () || !(*mux->connections)[id].used) {
+		return NULL;
+	}
+	return (*mux->connections)[id].tokenizer;
+}
+
+void
+NetMux_remove (NetMux *mux, int id)
+{
+	if (!NetMux_tokenizer (mux, id)) {
+		return;
+	}
+	stopReading (mux, id);
+	MuxConnection &connection = (*mux->connections)[id];
+	Tokenizer_free (connection.tokenizer);
+	connection.tokenizer = NULL;
+	connection.used = 0;
+	mux->count--;
+}
+
+unsigned int
+NetMux_count (NetMux *mux)
+{
+	return mux->count;
+}
+
+int
+NetMux_wait (NetMux *mux, int timeout)
+{
+	int ready, i, read = 0;
+
+#ifdef NETMUX_EPOLL
+	struct epoll_event events[NETMUX_EPOLL_EVENTS];
+
+	ready = epoll_wait (mux->epoll, events, NETMUX_EPOLL_EVENTS, timeout);
+	if (ready == -1) {
+		return (errno == EINTR) ? 0 : -1;
+	}
+	for (i = 0; i < ready; i++) {
+		read += readConnection (mux, (int) events[i].data.u32);
+	}
+#else
+	std::vector<MuxConnection> &connections = *mux->connections;
+	std::vector<struct pollfd> &polled = *mux->polled;
+	std::vector<int> &polledIDs = *mux->polledIDs;
+	unsigned int id;
+
+	polled.clear ();
+	polledIDs.clear ();
+	for (id = 0; id < connections.size (); id++) {
+		if (connections[id].used && connections[id].reading) {
+			struct pollfd entry;
+			entry.fd = connections[id].socket;
+			entry.events = POLLIN;
+			entry.revents = 0;
+			polled.push_back (entry);
+			polledIDs.push_back ((int) id);
+		}
+	}
+	if (polled.empty ()) {
+		// Nothing to wait for, poll() would only sleep
+		#ifdef WIN32
+			Sleep (timeout < 0 ? 0 : timeout);
+		#else
+			if (timeout > 0) {
+				usleep (timeout * 1000);
+			}
+		#endif
+		return 0;
+	}
+	ready = muxPoll (&polled[0], polled.size (), timeout);
+	if (ready < 0) {
+		#ifndef WIN32
+			if (errno == EINTR) {
+				return 0;
+			}
+		#endif
+		return -1;
+	}
+	for (i = 0; i < (int) polled.size () && ready > 0; i++) {
+		if (polled[i].revents != 0) {
+			ready--;
+			read += readConnection (mux, polledIDs[i]);
+		}
+	}
+#endif
+	return read;
+}
+
+unsigned int
+NetMux_take (NetMux *mux, NetMux_takeFunc take, void *arg)
+{
+	std::vector<MuxEvent> events;
+	unsigned int i, taken = 0;
+
+	events.swap (*mux->events);
+	for (i = 0; i < events.size (); i++) {
+		MuxEvent &event = events[i];
+		MuxConnection &connection = (*mux->connections)[event.id];
+
+		if (!connection.used || connection.serial != event.serial) {
+			continue;
+		}
+		take (arg, event.id, event.type, event.data.data (), (unsigned int) event.data.size ());
+		taken++;
+	}
+	return taken;
+}
+
+void
+NetMux_free (NetMux *mux)
+{
+	unsigned int id;
+
+	for (id = 0; id < mux->connections->size (); id++) {
+		NetMux_remove (mux, (int) id);
+	}
+#ifdef NETMUX_EPOLL
+	close (mux->epoll);
+#else
+	delete mux->polled;
+	delete mux->polledIDs;
+#endif
+	delete mux->connections;
+	delete mux->events;
+	free (mux->buffer);
+	free (mux);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
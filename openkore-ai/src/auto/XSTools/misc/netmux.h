@@ -0,0 +1,63 @@
+#ifndef _NETMUX_H_
+#define _NETMUX_H_
+
+#include "tokenizer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Reader of many Ragnarok Online connections at once, the native part of Network::Multiplexer. One wait reads
+// whatever arrived on every connection and splits it in messages with the connection's tokenizer; the messages
+// are then handed out at once, tagged with the connection they came from.
+//
+// The sockets are waited for with epoll on Linux, WSAPoll on Windows and poll() elsewhere, like OSL::Reactor.
+// They stay owned by the caller, which must remove them before closing them, and which writes to them itself.
+
+#ifdef WIN32
+	typedef unsigned long long NetMux_socket;
+#else
+	typedef int NetMux_socket;
+#endif
+
+// Types of the events NetMux_take hands out
+// A complete known message
+#define NETMUX_MESSAGE 0
+// The data read which doesn't start with a known message, up to what was read
+#define NETMUX_UNKNOWN 1
+// The connection was closed, with the start of a message which wasn't complete if any; it isn't read anymore
+#define NETMUX_CLOSED 2
+
+typedef struct NetMux NetMux;
+
+// Returns NULL if the backend can't be created
+NetMux *NetMux_new (void);
+
+// Start reading a socket. Returns the ID of the connection, which is reused once it was removed, or -1 on failure.
+int NetMux_add (NetMux *mux, NetMux_socket socket);
+
+// The tokenizer of a connection, NULL if the ID isn't one. Its message lengths are all unknown at first.
+Tokenizer *NetMux_tokenizer (NetMux *mux, int id);
+
+// Stop reading a connection; its events which weren't taken are dropped
+void NetMux_remove (NetMux *mux, int id);
+
+// Number of connections
+unsigned int NetMux_count (NetMux *mux);
+
+// Waits up to 'timeout' milliseconds (-1 for no limit) until a connection can be read, then reads every one which
+// can. Returns the number of connections read from, or -1 if waiting failed.
+int NetMux_wait (NetMux *mux, int timeout);
+
+// Calls 'take' with each event read so far, in the order they were read on each connection; returns their number.
+// 'take' may remove any connection, its events which weren't taken yet are then skipped.
+typedef void (*NetMux_takeFunc) (void *arg, int id, int type, const char *data, unsigned int len);
+unsigned int NetMux_take (NetMux *mux, NetMux_takeFunc take, void *arg);
+
+void NetMux_free (NetMux *mux);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _NETMUX_H_ */
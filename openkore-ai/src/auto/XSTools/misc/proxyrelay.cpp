@@ -0,0 +1,374 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <winsock2.h>
+	#include <windows.h>
+#else
+	#include <sys/types.h>
+	#include <sys/socket.h>
+	#include <sys/select.h>
+	#include <sys/time.h>
+	#include <pthread.h>
+#endif
+#include <string>
+#include <vector>
+#include "proxyrelay.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#ifdef WIN32
+	typedef CRITICAL_SECTION RelayMutex;
+	#define relayLock(mutex) EnterCriticalSection(mutex)
+	#define relayUnlock(mutex) LeaveCriticalSection(mutex)
+	#define relayMutexInit(mutex) InitializeCriticalSection(mutex)
+	#define relayMutexDestroy(mutex) DeleteCriticalSection(mutex)
+	#define RELAY_NOSIGNAL 0
+#else
+	typedef pthread_mutex_t RelayMutex;
+	#define relayLock(mutex) pthread_mutex_lock(mutex)
+	#define relayUnlock(mutex) pthread_mutex_unlock(mutex)
+	#define relayMutexInit(mutex) pthread_mutex_init(mutex, NULL)
+	#define relayMutexDestroy(mutex) pthread_mutex_destroy(mutex)
+	// A client which went away must not kill the process with SIGPIPE
+	#ifdef MSG_NOSIGNAL
+		#define RELAY_NOSIGNAL MSG_NOSIGNAL
+	#else
+		#define RELAY_NOSIGNAL 0
+	#endif
+#endif /* WIN32 */
+
+// Milliseconds the thread waits for the server before checking whether it must stop
+#define RELAY_POLL_TIME 50
+
+struct RelayMessage {
+	std::string data;
+	int forwarded;
+};
+
+struct ProxyRelay {
+	ProxyRelay_socket server;
+	ProxyRelay_socket client;
+	// Only used by the thread once it runs
+	Tokenizer *tokenizer;
+	unsigned char modes[65536];
+
+	// Protects the state below, taken before sendMutex when both are
+	RelayMutex mutex;
+	// Messages for the main loop, in the order they were read
+	std::vector<RelayMessage> *queue;
+	// Set by a held message, until the main loop released it
+	int blocked;
+	// Set by data which isn't a known message, nothing is forwarded anymore
+	int broken;
+	int serverClosed;
+	unsigned long forwarded;
+	unsigned long held;
+
+	// Serializes the writes to the client, of the thread and of the main loop
+	RelayMutex sendMutex;
+	int clientFailed;
+
+	volatile int stopping;
+	int running;
+#ifdef WIN32
+	HANDLE thread;
+#else
+	pthread_t thread;
+#endif
+};
+
+// Writes all of the data to the client, sendMutex must be held
+static int
+sendAll (ProxyRelay *relay, const char *data, unsigned int len)
+{
+	while (len > 0 && !relay->clientFailed) {
+		int sent = send (relay->client, data, len, RELAY_NOSIGNAL);
+		if (sent <= 0) {
+#ifndef WIN32
+			if (sent < 0 && errno == EINTR) {
+				continue;
+			}
+#endif
+			relay->clientFailed = 1;
+			break;
+		}
+		data += sent;
+		len -= sent;
+	}
+	return !relay->clientFailed;
+}
+
+// Splits what was read from the server in messages, and forwards them or queues them for the main loop
+static void
+relayData (ProxyRelay *relay, const char *data, unsigned int len)
+{
+	Tokenizer *tokenizer = relay->tokenizer;
+	int length;
+
+	if (relay->broken) {
+		RelayMessage message = { std::string (data, len), 0 };
+		relayLock (&relay->mutex);
+		relay->queue->push_back (message);
+		relayUnlock (&relay->mutex);
+		return;
+	}
+
+	Tokenizer_add (tokenizer, data, len);
+	while ((length = Tokenizer_next (tokenizer)) != 0) {
+		RelayMessage message;
+		unsigned int id;
+		int mode, forward;
+
+		if (length == TOKENIZER_UNKNOWN_MESSAGE) {
+			message.data.resize (tokenizer->size);
+			Tokenizer_copy (tokenizer, 0, tokenizer->size, &message.data[0]);
+			Tokenizer_remove (tokenizer, tokenizer->size);
+			message.forwarded = 0;
+			relayLock (&relay->mutex);
+			relay->broken = 1;
+			relay->queue->push_back (message);
+			relayUnlock (&relay->mutex);
+			break;
+		}
+
+		message.data.resize (length);
+		Tokenizer_copy (tokenizer, 0, length, &message.data[0]);
+		Tokenizer_remove (tokenizer, length);
+		id = (unsigned char) message.data[0] | ((unsigned char) message.data[1] << 8);
+		mode = relay->modes[id];
+
+		relayLock (&relay->mutex);
+		if (mode == PROXY_RELAY_HOLD) {
+			relay->blocked = 1;
+			relay->held++;
+		}
+		forward = !relay->blocked;
+		message.forwarded = forward;
+		if (!forward || mode == PROXY_RELAY_MIRROR) {
+			relay->queue->push_back (message);
+		}
+		if (!forward) {
+			relayUnlock (&relay->mutex);
+			continue;
+		}
+		relay->forwarded++;
+		// The message goes out before anything the main loop sends after seeing it
+		relayLock (&relay->sendMutex);
+		relayUnlock (&relay->mutex);
+		sendAll (relay, message.data.data (), (unsigned int) message.data.size ());
+		relayUnlock (&relay->sendMutex);
+	}
+}
+
+static void
+relayRun (ProxyRelay *relay)
+{
+	char buffer[1024 * 32];
+
+	while (!relay->stopping) {
+		fd_set readable;
+		struct timeval timeout;
+		int ready, len;
+
+		FD_ZERO (&readable);
+		FD_SET (relay->server, &readable);
+		timeout.tv_sec = 0;
+		timeout.tv_usec = RELAY_POLL_TIME * 1000;
+		ready = select ((int) relay->server + 1, &readable, NULL, NULL, &timeout);
+		if (ready == 0) {
+			continue;
+		}
+#ifndef WIN32
+		if (ready < 0 && errno == EINTR) {
+			continue;
+		}
+#endif
+		len = (ready < 0) ? -1 : recv (relay->server, buffer, sizeof(buffer), 0);
+#ifndef WIN32
+		if (len < 0 && errno == EINTR) {
+			continue;
+		}
+#endif
+		if (len <= 0) {
+			relayLock (&relay->mutex);
+			relay->serverClosed = 1;
+			relayUnlock (&relay->mutex);
+			break;
+		}
+		relayData (relay, buffer, (unsigned int) len);
+	}
+}
+
+#ifdef WIN32
+static DWORD WINAPI
+relayThread (LPVOID arg)
+{
+	relayRun ((ProxyRelay *) arg);
+	return 0;
+}
+#else
+static void *
+relayThread (void *arg)
+{
+	relayRun ((ProxyRelay *) arg);
+	return NULL;
+}
+#endif /* WIN32 */
+
+ProxyRelay *
+ProxyRelay_new (ProxyRelay_socket server, ProxyRelay_socket client)
+{
+	ProxyRelay *relay = (ProxyRelay *) calloc (1, sizeof(ProxyRelay));
+
+	relay->server = server;
+	relay->client = client;
+	relay->tokenizer = Tokenizer_new ();
+	relay->queue = new std::vector<RelayMessage>;
+	relayMutexInit (&relay->mutex);
+	relayMutexInit (&relay->sendMutex);
+	return relay;
+}
+
+Tokenizer *
+ProxyRelay_tokenizer (ProxyRelay *relay)
+{
+	return relay->tokenizer;
+}
+
+void
+ProxyRelay_setMode (ProxyRelay *relay, unsigned int id, int mode)
+{
+	relay->modes[id & 0xFFFF] = (unsigned char) mode;
+}
+
+int
+ProxyRelay_start (ProxyRelay *relay)
+{
+	if (relay->running) {
+		return 1;
+	}
+	relay->stopping = 0;
+#ifdef WIN32
+	relay->thread = CreateThread (NULL, 0, relayThread, relay, 0, NULL);
+	relay->running = (relay->thread != NULL);
+#else
+	relay->running = (pthread_create (&relay->thread, NULL, relayThread, relay) == 0);
+#endif /* WIN32 */
+	return relay->running;
+}
+
+unsigned int
+ProxyRelay_take (ProxyRelay *relay, ProxyRelay_takeFunc take, void *arg)
+{
+	std::vector<RelayMessage> messages;
+	unsigned int i;
+
+	relayLock (&relay->mutex);
+	messages.swap (*relay->queue);
+	relayUnlock (&relay->mutex);
+	for (i = 0; i < messages.size (); i++) {
+		take (arg, messages[i].data.data (), (unsigned int) messages[i].data.size (), messages[i].forwarded);
+	}
+	return (unsigned int) messages.size ();
+}
+
+void
+ProxyRelay_release (ProxyRelay *relay)
+{
+	relayLock (&relay->mutex);
+	if (relay->blocked && relay->queue->empty ()) {
+		relay->blocked = 0;
+	}
+	relayUnlock (&relay->mutex);
+}
+
+int
+ProxyRelay_send (ProxyRelay *relay, const char *data, unsigned int len)
+{
+	int result;
+
+	relayLock (&relay->sendMutex);
+	result = sendAll (relay, data, len);
+	relayUnlock (&relay->sendMutex);
+	return result;
+}
+
+int
+ProxyRelay_serverClosed (ProxyRelay *relay)
+{
+	int closed;
+
+	relayLock (&relay->mutex);
+	closed = relay->serverClosed;
+	relayUnlock (&relay->mutex);
+	return closed;
+}
+
+unsigned long
+ProxyRelay_forwarded (ProxyRelay *relay)
+{
+	unsigned long forwarded;
+
+	relayLock (&relay->mutex);
+	forwarded = relay->forwarded;
+	relayUnlock (&relay->mutex);
+	return forwarded;
+}
+
+unsigned long
+ProxyRelay_held (ProxyRelay *relay)
+{
+	unsigned long held;
+
+	relayLock (&relay->mutex);
+	held = relay->held;
+	relayUnlock (&relay->mutex);
+	return held;
+}
+
+void
+ProxyRelay_stop (ProxyRelay *relay)
+{
+	if (!relay->running) {
+		return;
+	}
+	relay->stopping = 1;
+#ifdef WIN32
+	WaitForSingleObject (relay->thread, INFINITE);
+	CloseHandle (relay->thread);
+#else
+	pthread_join (relay->thread, NULL);
+#endif /* WIN32 */
+	relay->running = 0;
+
+	// The start of a message which was not complete yet is left to the main loop too
+	if (relay->tokenizer->size > 0) {
+		RelayMessage message;
+		message.data.resize (relay->tokenizer->size);
+		Tokenizer_copy (relay->tokenizer, 0, relay->tokenizer->size, &message.data[0]);
+		Tokenizer_remove (relay->tokenizer, relay->tokenizer->size);
+		message.forwarded = 0;
+		relayLock (&relay->mutex);
+		relay->queue->push_back (message);
+		relayUnlock (&relay->mutex);
+	}
+}
+
+void
+ProxyRelay_free (ProxyRelay *relay)
+{
+	ProxyRelay_stop (relay);
+	Tokenizer_free (relay->tokenizer);
+	delete relay->queue;
+	relayMutexDestroy (&relay->mutex);
+	relayMutexDestroy (&relay->sendMutex);
+	free (relay);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
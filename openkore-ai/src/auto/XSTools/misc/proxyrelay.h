@@ -0,0 +1,77 @@
+#ifndef _PROXYRELAY_H_
+#define _PROXYRELAY_H_
+
+#include "tokenizer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Server to client relay of the X-Kore proxy. A thread reads the messages of the server and sends them to the client
+// as soon as they are complete, instead of waiting for the next iteration of the main loop to read, parse and send
+// them again. The main loop takes a copy of the relayed messages, which it only parses, and gets the messages it may
+// change itself: from such a "held" message on, the relay forwards nothing until the main loop released it, after it
+// sent its version of the held message and of the ones which followed.
+//
+// The sockets stay owned by the caller, which must stop the relay before closing them. While the relay runs, only
+// the relay reads from the server and writes to the client; the caller sends to the client with ProxyRelay_send.
+//
+// Data which can't be split in known messages stops the relaying for good, it's then all left to the main loop.
+
+#ifdef WIN32
+	typedef unsigned long long ProxyRelay_socket;
+#else
+	typedef int ProxyRelay_socket;
+#endif
+
+// What the relay does with a message ID
+// Forwarded, and copied for the main loop
+#define PROXY_RELAY_MIRROR 0
+// Forwarded only
+#define PROXY_RELAY_FORWARD 1
+// Left to the main loop, which sends it to the client itself
+#define PROXY_RELAY_HOLD 2
+
+typedef struct ProxyRelay ProxyRelay;
+
+// A relay of the messages read from 'server' to 'client', the message lengths are set on its tokenizer
+ProxyRelay *ProxyRelay_new (ProxyRelay_socket server, ProxyRelay_socket client);
+
+Tokenizer *ProxyRelay_tokenizer (ProxyRelay *relay);
+
+// Set the mode of a message ID, PROXY_RELAY_MIRROR by default
+void ProxyRelay_setMode (ProxyRelay *relay, unsigned int id, int mode);
+
+// Start the thread, returns 0 if it can't be started
+int ProxyRelay_start (ProxyRelay *relay);
+
+// Calls 'take' with each message read for the main loop, in order, with whether the relay forwarded it;
+// returns the number of messages taken
+typedef void (*ProxyRelay_takeFunc) (void *arg, const char *data, unsigned int len, int forwarded);
+unsigned int ProxyRelay_take (ProxyRelay *relay, ProxyRelay_takeFunc take, void *arg);
+
+// Tells that the main loop sent whatever it had to for the messages it took: forwarding starts again after a held
+// message if every message read since was taken
+void ProxyRelay_release (ProxyRelay *relay);
+
+// Send data to the client after what the relay forwarded so far, returns 0 if the client can't be sent to
+int ProxyRelay_send (ProxyRelay *relay, const char *data, unsigned int len);
+
+// Whether the server closed the connection, messages left to take included
+int ProxyRelay_serverClosed (ProxyRelay *relay);
+
+// Numbers of messages forwarded and held so far
+unsigned long ProxyRelay_forwarded (ProxyRelay *relay);
+unsigned long ProxyRelay_held (ProxyRelay *relay);
+
+// Stops the thread. The messages which were not taken, and the start of a message which was not complete, can still be taken
+void ProxyRelay_stop (ProxyRelay *relay);
+
+// Stops the relay and frees it, the sockets are not closed
+void ProxyRelay_free (ProxyRelay *relay);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _PROXYRELAY_H_ */
@@ -0,0 +1,267 @@
+#include <string.h>
+#include <stdlib.h>
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+#include "ticktimer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+typedef struct {
+	char *name;
+	// Of the running tick
+	TickTimer_time time;
+	unsigned int calls;
+	// Of the last finished tick
+	TickTimer_time lastTime;
+	unsigned int lastCalls;
+	TickTimer_histogram histogram;
+} Phase;
+
+static Phase phases[TICKTIMER_MAX_PHASES];
+static int phaseCount = 0;
+static TickTimer_histogram ticks;
+static TickTimer_time tickStart = 0, lastTick = 0;
+static int inTick = 0;
+
+// The running phases, innermost last; only the innermost one is being timed
+static int stack[TICKTIMER_MAX_DEPTH];
+static int depth = 0;
+static TickTimer_time resumed;
+
+static TickTimer_time
+now ()
+{
+#ifdef WIN32
+	static double usPerTick = 0;
+	LARGE_INTEGER counter;
+	if (usPerTick == 0) {
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency (&frequency);
+		usPerTick = 1e6 / (double) frequency.QuadPart;
+	}
+	QueryPerformanceCounter (&counter);
+	return (TickTimer_time) (counter.QuadPart * usPerTick);
+#else
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (TickTimer_time) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+static unsigned int
+bucketOf (TickTimer_time us)
+{
+	unsigned int exponent = 0;
+	TickTimer_time v = us;
+
+	if (us < 16)
+		return (unsigned int) us;
+	while (v >>= 1)
+		exponent++;
+	if (exponent > 31)
+		return TICKTIMER_BUCKETS - 1;
+	return 16 + (exponent - 4) * 8 + (unsigned int) ((us >> (exponent - 3)) & 7);
+}
+
+// The largest time which falls in a bucket
+static TickTimer_time
+bucketLimit (unsigned int bucket)
+{
+	unsigned int exponent, sub;
+
+	if (bucket < 16)
+		return bucket;
+	exponent = (bucket - 16) / 8 + 4;
+	sub = (bucket - 16) % 8;
+	return (((TickTimer_time) (8 + sub + 1)) << (exponent - 3)) - 1;
+}
+
+static void
+record (TickTimer_histogram *histogram, TickTimer_time us)
+{
+	histogram->count++;
+	histogram->buckets[bucketOf (us)]++;
+	if (us > histogram->max)
+		histogram->max = us;
+}
+
+static Phase *
+phaseOf (int phase)
+{
+	return (phase >= 0 && phase < phaseCount) ? &phases[phase] : NULL;
+}
+
+int
+TickTimer_phase (const char *name)
+{
+	int i;
+
+	for (i = 0; i < phaseCount; i++) {
+		if (strcmp (phases[i].name, name) == 0)
+			return i;
+	}
+	if (phaseCount == TICKTIMER_MAX_PHASES)
+		return -1;
+	phases[phaseCount].name = strdup (name);
+	return phaseCount++;
+}
+
+const char *
+TickTimer_phaseName (int phase)
+{
+	Phase *p = phaseOf (phase);
+	return p ? p->name : NULL;
+}
+
+int
+TickTimer_phaseCount ()
+{
+	return phaseCount;
+}
+
+void
+TickTimer_beginTick ()
+{
+	int i;
+
+	for (i = 0; i < phaseCount; i++) {
+		phases[i].time = 0;
+		phases[i].calls = 0;
+	}
+	depth = 0;
+	inTick = 1;
+	tickStart = now ();
+}
+
+TickTimer_time
+TickTimer_endTick ()
+{
+	TickTimer_time end = now ();
+	int i;
+
+	if (!inTick)
+		return 0;
+	// Phases which didn't end count until the end of the tick
+	if (depth > 0)
+		phases[stack[depth - 1]].time += end - resumed;
+	depth = 0;
+	inTick = 0;
+
+	lastTick = end - tickStart;
+	record (&ticks, lastTick);
+	for (i = 0; i < phaseCount; i++) {
+		phases[i].lastTime = phases[i].time;
+		phases[i].lastCalls = phases[i].calls;
+		if (phases[i].calls > 0)
+			record (&phases[i].histogram, phases[i].time);
+	}
+	return lastTick;
+}
+
+void
+TickTimer_begin (int phase)
+{
+	TickTimer_time t;
+	Phase *p = phaseOf (phase);
+
+	if (!p || !inTick)
+		return;
+	t = now ();
+	if (depth > 0)
+		phases[stack[depth - 1]].time += t - resumed;
+	p->calls++;
+	// Phases nested too deep aren't timed separately, their time goes to the deepest one
+	if (depth < TICKTIMER_MAX_DEPTH)
+		stack[depth++] = phase;
+	resumed = t;
+}
+
+void
+TickTimer_end (int phase)
+{
+	TickTimer_time t;
+	int i;
+
+	if (!phaseOf (phase) || !inTick || depth == 0)
+		return;
+	for (i = depth - 1; i >= 0 && stack[i] != phase; i--);
+	// Not running, or only too deep to be on the stack
+	if (i < 0)
+		return;
+
+	t = now ();
+	phases[stack[depth - 1]].time += t - resumed;
+	// Phases which began inside this one and didn't end, end with it
+	depth = i;
+	resumed = t;
+}
+
+TickTimer_time
+TickTimer_lastTick (int phase)
+{
+	Phase *p;
+
+	if (phase == TICKTIMER_TICK)
+		return lastTick;
+	p = phaseOf (phase);
+	return p ? p->lastTime : 0;
+}
+
+unsigned int
+TickTimer_lastCalls (int phase)
+{
+	Phase *p = phaseOf (phase);
+	return p ? p->lastCalls : 0;
+}
+
+const TickTimer_histogram *
+TickTimer_histogramOf (int phase)
+{
+	Phase *p;
+
+	if (phase == TICKTIMER_TICK)
+		return &ticks;
+	p = phaseOf (phase);
+	return p ? &p->histogram : NULL;
+}
+
+TickTimer_time
+TickTimer_percentile (int phase, double fraction)
+{
+	const TickTimer_histogram *histogram = TickTimer_histogramOf (phase);
+	unsigned long long seen = 0, wanted;
+	unsigned int i;
+
+	if (!histogram || histogram->count == 0)
+		return 0;
+	wanted = (unsigned long long) (fraction * histogram->count + 0.5);
+	if (wanted < 1)
+		wanted = 1;
+	for (i = 0; i < TICKTIMER_BUCKETS; i++) {
+		seen += histogram->buckets[i];
+		if (seen >= wanted) {
+			TickTimer_time limit = bucketLimit (i);
+			return limit < histogram->max ? limit : histogram->max;
+		}
+	}
+	return histogram->max;
+}
+
+void
+TickTimer_reset ()
+{
+	int i;
+
+	memset (&ticks, 0, sizeof (ticks));
+	for (i = 0; i < phaseCount; i++)
+		memset (&phases[i].histogram, 0, sizeof (TickTimer_histogram));
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,62 @@
+#ifndef _TICKTIMER_H_
+#define _TICKTIMER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Timing of the main loop iterations ("ticks") and of the phases they spend their time in.
+// Phases nest: while a phase runs inside another one, the outer one is paused, so the times of
+// the phases of a tick add up to at most the tick's time. The times of every finished tick go
+// into histograms, from which percentiles are read. Only the main thread should use this.
+
+#define TICKTIMER_MAX_PHASES 16
+#define TICKTIMER_MAX_DEPTH 8
+// Log-linear buckets of microseconds: exact below 16, then 8 buckets per power of two up to 2^32
+#define TICKTIMER_BUCKETS (16 + 28 * 8)
+// The phase ID of the whole tick
+#define TICKTIMER_TICK -1
+
+typedef unsigned long long TickTimer_time;
+
+typedef struct {
+	unsigned int count;
+	TickTimer_time max;
+	unsigned int buckets[TICKTIMER_BUCKETS];
+} TickTimer_histogram;
+
+// Returns the ID of the phase with this name, registering it if needed, or -1 if there are too many phases
+int TickTimer_phase (const char *name);
+
+// Returns the name of a phase, or NULL
+const char *TickTimer_phaseName (int phase);
+
+int TickTimer_phaseCount (void);
+
+void TickTimer_beginTick (void);
+
+// Returns the length of the tick in microseconds, and records it; 0 if no tick began
+TickTimer_time TickTimer_endTick (void);
+
+void TickTimer_begin (int phase);
+
+void TickTimer_end (int phase);
+
+// The microseconds spent in a phase during the last finished tick, or the length of the tick
+TickTimer_time TickTimer_lastTick (int phase);
+
+// The number of times a phase began during the last finished tick
+unsigned int TickTimer_lastCalls (int phase);
+
+const TickTimer_histogram *TickTimer_histogramOf (int phase);
+
+// The microseconds below which the given fraction (0 to 1) of the recorded times are; 0 if none
+TickTimer_time TickTimer_percentile (int phase, double fraction);
+
+void TickTimer_reset (void);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _TICKTIMER_H_ */
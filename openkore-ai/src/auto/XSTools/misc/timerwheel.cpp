@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <math.h>
+#include "timerwheel.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define SLOT_MASK (TIMERWHEEL_SLOTS - 1)
+// Ticks between the current one and the last one the top level holds
+#define MAX_DISTANCE (((TimerWheel_tick) 1 << (TIMERWHEEL_SLOT_BITS * TIMERWHEEL_LEVELS)) - 1)
+
+static TimerWheel_tick
+tickOf (const TimerWheel *wheel, double time)
+{
+	double tick = ceil (time / wheel->resolution);
+	if (!(tick < (double) (wheel->current + MAX_DISTANCE))) {
+		return wheel->current + MAX_DISTANCE;
+	}
+	return (tick > 0) ? (TimerWheel_tick) tick : 0;
+}
+
+static void
+detach (TimerWheel *wheel, TimerWheel_timer *timer)
+{
+	if (timer->prev != TIMERWHEEL_NONE) {
+		wheel->timers[timer->prev].next = timer->next;
+	} else {
+		wheel->slots[timer->level][timer->slot] = timer->next;
+	}
+	if (timer->next != TIMERWHEEL_NONE) {
+		wheel->timers[timer->next].prev = timer->prev;
+	}
+	timer->level = TIMERWHEEL_NONE;
+	wheel->pending--;
+}
+
+// Puts a timer in the slot of the lowest level which reaches its tick, timers which are overdue go in the current slot
+static void
+insert (TimerWheel *wheel, long id)
+{
+	TimerWheel_timer *timer = &wheel->timers[id];
+	TimerWheel_tick tick = (timer->tick > wheel->current) ? timer->tick : wheel->current;
+	TimerWheel_tick distance = tick - wheel->current;
+	int level = 0;
+
+	while (level < TIMERWHEEL_LEVELS - 1 && (distance >> (TIMERWHEEL_SLOT_BITS * (level + 1))) != 0) {
+		level++;
+	}
+	timer->level = level;
+	timer->slot = (int) ((tick >> (TIMERWHEEL_SLOT_BITS * level)) & SLOT_MASK);
+	timer->prev = TIMERWHEEL_NONE;
+	timer->next = wheel->slots[level][timer->slot];
+	if (timer->next != TIMERWHEEL_NONE) {
+		wheel->timers[timer->next].prev = id;
+	}
+	wheel->slots[level][timer->slot] = id;
+	wheel->pending++;
+}
+
+// Moves the timers of a slot of an upper level down to the levels which reach them now
+static void
+cascade (TimerWheel *wheel, int level, int slot)
+{
+	long id = wheel->slots[level][slot];
+
+	wheel->slots[level][slot] = TIMERWHEEL_NONE;
+	while (id != TIMERWHEEL_NONE) {
+		long next = wheel->timers[id].next;
+		wheel->pending--;
+		insert (wheel, id);
+		id = next;
+	}
+}
+
+TimerWheel *
+TimerWheel_new (double resolution, double now)
+{
+	TimerWheel *wheel = (TimerWheel *) calloc (1, sizeof(TimerWheel));
+	int level, slot;
+
+	wheel->resolution = resolution;
+	wheel->now = now;
+	wheel->current = (TimerWheel_tick) floor (now / resolution);
+	for (level = 0; level < TIMERWHEEL_LEVELS; level++) {
+		for (slot = 0; slot < TIMERWHEEL_SLOTS; slot++) {
+			wheel->slots[level][slot] = TIMERWHEEL_NONE;
+		}
+	}
+	return wheel;
+}
+
+long
+TimerWheel_add (TimerWheel *wheel)
+{
+	if (wheel->timerCount == wheel->timerCapacity) {
+		wheel->timerCapacity = (wheel->timerCapacity > 0) ? wheel->timerCapacity * 2 : 16;
+		wheel->timers = (TimerWheel_timer *) realloc (wheel->timers, wheel->timerCapacity * sizeof(TimerWheel_timer));
+		wheel->expired = (long *) realloc (wheel->expired, wheel->timerCapacity * sizeof(long));
+		wheel->expiredCapacity = wheel->timerCapacity;
+	}
+	wheel->timers[wheel->timerCount].level = TIMERWHEEL_NONE;
+	wheel->timers[wheel->timerCount].deadline = 0;
+	return wheel->timerCount++;
+}
+
+void
+TimerWheel_set (TimerWheel *wheel, long id, double deadline)
+{
+	TimerWheel_timer *timer = &wheel->timers[id];
+
+	if (timer->level != TIMERWHEEL_NONE) {
+		detach (wheel, timer);
+	}
+	timer->deadline = deadline;
+	timer->tick = tickOf (wheel, deadline);
+	insert (wheel, id);
+}
+
+void
+TimerWheel_cancel (TimerWheel *wheel, long id)
+{
+	if (wheel->timers[id].level != TIMERWHEEL_NONE) {
+		detach (wheel, &wheel->timers[id]);
+	}
+}
+
+int
+TimerWheel_isPending (const TimerWheel *wheel, long id)
+{
+	return wheel->timers[id].level != TIMERWHEEL_NONE;
+}
+
+long
+TimerWheel_advance (TimerWheel *wheel, double now)
+{
+	TimerWheel_tick target = (TimerWheel_tick) floor (now / wheel->resolution);
+
+	wheel->now = now;
+	wheel->expiredCount = 0;
+	while (wheel->current <= target) {
+		int slot = (int) (wheel->current & SLOT_MASK);
+		long id;
+
+		if (wheel->pending == 0) {
+			wheel->current = target + 1;
+			break;
+		}
+		// The first slot of a level comes around: the next slot of the level above moves down
+		if (slot == 0) {
+			int level;
+			for (level = 1; level < TIMERWHEEL_LEVELS; level++) {
+				int upper = (int) ((wheel->current >> (TIMERWHEEL_SLOT_BITS * level)) & SLOT_MASK);
+				cascade (wheel, level, upper);
+				if (upper != 0) {
+					break;
+				}
+			}
+		}
+
+		while ((id = wheel->slots[0][slot]) != TIMERWHEEL_NONE) {
+			detach (wheel, &wheel->timers[id]);
+			wheel->expired[wheel->expiredCount++] = id;
+		}
+		wheel->current++;
+	}
+	return wheel->expiredCount;
+}
+
+void
+TimerWheel_destroy (TimerWheel *wheel)
+{
+	free (wheel->timers);
+	free (wheel->expired);
+	free (wheel);
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
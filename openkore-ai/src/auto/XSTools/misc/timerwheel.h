@@ -0,0 +1,76 @@
+#ifndef _TIMERWHEEL_H_
+#define _TIMERWHEEL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// A hierarchical timer wheel: timers are put in the slot of the tick they're due at, so finding the ones which are
+// due is a matter of walking the slots of the ticks which passed, however many timers are pending. A tick lasts
+// 'resolution' seconds. Each level has TIMERWHEEL_SLOTS slots of ticks which are TIMERWHEEL_SLOTS times longer than
+// the ones of the level below; timers due beyond the first level wait in the upper ones, and move down a level
+// (they're "cascaded") once their slot comes. A timer is never reported before its deadline, and at most one tick
+// after it.
+
+#define TIMERWHEEL_LEVELS 4
+#define TIMERWHEEL_SLOT_BITS 8
+#define TIMERWHEEL_SLOTS (1 << TIMERWHEEL_SLOT_BITS)
+#define TIMERWHEEL_NONE -1
+
+typedef unsigned long long TimerWheel_tick;
+
+typedef struct {
+	double deadline;
+	// The tick the deadline falls in, rounded up
+	TimerWheel_tick tick;
+	// Slot the timer is in, level is TIMERWHEEL_NONE if it isn't pending
+	int level;
+	int slot;
+	// Neighbours in the slot's list, TIMERWHEEL_NONE at its ends
+	long prev;
+	long next;
+} TimerWheel_timer;
+
+typedef struct {
+	double resolution;
+	// Time of the last advance
+	double now;
+	// The next tick to walk
+	TimerWheel_tick current;
+	// First timer of every slot's list, TIMERWHEEL_NONE for none
+	long slots[TIMERWHEEL_LEVELS][TIMERWHEEL_SLOTS];
+	long pending;
+
+	TimerWheel_timer *timers;
+	long timerCount;
+	long timerCapacity;
+
+	// Timers found due by the last advance
+	long *expired;
+	long expiredCount;
+	long expiredCapacity;
+} TimerWheel;
+
+TimerWheel *TimerWheel_new (double resolution, double now);
+
+// Returns the ID of a new timer, which isn't pending
+long TimerWheel_add (TimerWheel *wheel);
+
+// Makes a timer due at deadline, in place of the deadline it had if it was pending
+void TimerWheel_set (TimerWheel *wheel, long timer, double deadline);
+
+void TimerWheel_cancel (TimerWheel *wheel, long timer);
+
+int TimerWheel_isPending (const TimerWheel *wheel, long timer);
+
+// Walks the ticks up to now, and returns the number of timers which became due; their IDs are in wheel->expired,
+// and they're no longer pending
+long TimerWheel_advance (TimerWheel *wheel, double now);
+
+void TimerWheel_destroy (TimerWheel *wheel);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _TIMERWHEEL_H_ */
@@ -0,0 +1,169 @@
+#include <stdlib.h>
+#include <string.h>
+#include "tokenizer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#define MIN_CAPACITY (16 * 1024)
+
+static inline unsigned int
+byteAt (const Tokenizer *tokenizer, unsigned int offset)
+{
+	return tokenizer->data[(tokenizer->start + offset) & (tokenizer->capacity - 1)];
+}
+
+// Make room for len more bytes; the data is moved to the start of a bigger buffer
+static int
+reserve (Tokenizer *tokenizer, unsigned int len)
+{
+	unsigned int capacity = tokenizer->capacity ? tokenizer->capacity : MIN_CAPACITY;
+	unsigned char *data;
+
+	if (tokenizer->size + len <= tokenizer->capacity)
+		return 1;
+	if (tokenizer->size + len < tokenizer->size)
+		return 0;
+	while (capacity < tokenizer->size + len) {
+		if (capacity * 2 == 0)
+			return 0;
+		capacity *= 2;
+	}
+
+	data = (unsigned char *) malloc (capacity);
+	if (!data)
+		return 0;
+	Tokenizer_copy (tokenizer, 0, tokenizer->size, (char *) data);
+	free (tokenizer->data);
+	tokenizer->data = data;
+	tokenizer->capacity = capacity;
+	tokenizer->start = 0;
+	return 1;
+}
+
+Tokenizer *
+Tokenizer_new (void)
+{
+	Tokenizer *tokenizer = (Tokenizer *) calloc (1, sizeof (Tokenizer));
+	return tokenizer;
+}
+
+void
+Tokenizer_free (Tokenizer *tokenizer)
+{
+	free (tokenizer->data);
+	free (tokenizer);
+}
+
+void
+Tokenizer_setLength (Tokenizer *tokenizer, unsigned int id, int length)
+{
+	unsigned short value;
+
+	if (length > 1)
+		value = length > 65535 ? 65535 : length;
+	else if (length == 0 || length == -1)
+		value = TOKENIZER_VARIABLE;
+	else
+		value = TOKENIZER_UNKNOWN;
+	tokenizer->lengths[id & 0xFFFF] = value;
+}
+
+void
+Tokenizer_clearLengths (Tokenizer *tokenizer)
+{
+	memset (tokenizer->lengths, 0, sizeof (tokenizer->lengths));
+}
+
+int
+Tokenizer_add (Tokenizer *tokenizer, const char *data, unsigned int len)
+{
+	unsigned int end, first;
+
+	if (!reserve (tokenizer, len))
+		return 0;
+	if (len == 0)
+		return 1;
+	end = (tokenizer->start + tokenizer->size) & (tokenizer->capacity - 1);
+	first = tokenizer->capacity - end;
+	if (first > len)
+		first = len;
+	memcpy (tokenizer->data + end, data, first);
+	memcpy (tokenizer->data, data + first, len - first);
+	tokenizer->size += len;
+	return 1;
+}
+
+int
+Tokenizer_prepend (Tokenizer *tokenizer, const char *data, unsigned int len)
+{
+	unsigned int start, first;
+
+	if (!reserve (tokenizer, len))
+		return 0;
+	if (len == 0)
+		return 1;
+	start = (tokenizer->start - len) & (tokenizer->capacity - 1);
+	first = tokenizer->capacity - start;
+	if (first > len)
+		first = len;
+	memcpy (tokenizer->data + start, data, first);
+	memcpy (tokenizer->data, data + first, len - first);
+	tokenizer->start = start;
+	tokenizer->size += len;
+	return 1;
+}
+
+void
+Tokenizer_remove (Tokenizer *tokenizer, unsigned int len)
+{
+	if (len >= tokenizer->size) {
+		tokenizer->start = 0;
+		tokenizer->size = 0;
+	} else {
+		tokenizer->start = (tokenizer->start + len) & (tokenizer->capacity - 1);
+		tokenizer->size -= len;
+	}
+}
+
+void
+Tokenizer_copy (const Tokenizer *tokenizer, unsigned int offset, unsigned int len, char *out)
+{
+	unsigned int start, first;
+
+	if (len == 0)
+		return;
+	start = (tokenizer->start + offset) & (tokenizer->capacity - 1);
+	first = tokenizer->capacity - start;
+	if (first > len)
+		first = len;
+	memcpy (out, tokenizer->data + start, first);
+	memcpy (out + first, tokenizer->data, len - first);
+}
+
+int
+Tokenizer_next (const Tokenizer *tokenizer)
+{
+	unsigned int length;
+
+	if (tokenizer->size < 2)
+		return 0;
+	length = tokenizer->lengths[byteAt (tokenizer, 0) | (byteAt (tokenizer, 1) << 8)];
+
+	if (length == TOKENIZER_UNKNOWN)
+		return TOKENIZER_UNKNOWN_MESSAGE;
+	if (length == TOKENIZER_VARIABLE) {
+		if (tokenizer->size < 4)
+			return 0;
+		length = byteAt (tokenizer, 2) | (byteAt (tokenizer, 3) << 8);
+		// Shorter than its header: the stream is out of sync
+		if (length < 4)
+			return TOKENIZER_UNKNOWN_MESSAGE;
+	}
+	return tokenizer->size >= length ? (int) length : 0;
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
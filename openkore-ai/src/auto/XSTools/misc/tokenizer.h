@@ -0,0 +1,60 @@
+#ifndef _TOKENIZER_H_
+#define _TOKENIZER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Splitter of the Ragnarok Online byte stream into messages, the native part of Network::MessageTokenizer.
+// Data is kept in a ring buffer, so taking a message off the front doesn't move the data behind it, and
+// message lengths are looked up in a table indexed by message ID instead of the recvpackets hash.
+// The ring buffer grows to hold whatever was added and wasn't read yet.
+
+// Length table entries which aren't a message length
+#define TOKENIZER_UNKNOWN 0
+#define TOKENIZER_VARIABLE 1
+
+// Result of Tokenizer_next for data which doesn't start with a known message
+#define TOKENIZER_UNKNOWN_MESSAGE -1
+
+typedef struct {
+	unsigned char *data;
+	// A power of two, or 0 before anything was added
+	unsigned int capacity;
+	unsigned int start;
+	unsigned int size;
+
+	// Indexed by message ID: TOKENIZER_UNKNOWN, TOKENIZER_VARIABLE or the length of the message
+	unsigned short lengths[65536];
+} Tokenizer;
+
+Tokenizer *Tokenizer_new (void);
+
+void Tokenizer_free (Tokenizer *tokenizer);
+
+// Set the length of a message ID the way recvpackets does: more than 1 for a message of that length,
+// 0 or -1 for a message which has its length after its ID, anything else for an unknown message
+void Tokenizer_setLength (Tokenizer *tokenizer, unsigned int id, int length);
+
+void Tokenizer_clearLengths (Tokenizer *tokenizer);
+
+// Add data at the end, or at the front for data which was taken but must be read again; returns 0 if out of memory
+int Tokenizer_add (Tokenizer *tokenizer, const char *data, unsigned int len);
+int Tokenizer_prepend (Tokenizer *tokenizer, const char *data, unsigned int len);
+
+// Remove len bytes from the front, or everything if there are less
+void Tokenizer_remove (Tokenizer *tokenizer, unsigned int len);
+
+// Copy len bytes, starting offset bytes from the front, to out
+// Requires: offset + len <= tokenizer->size
+void Tokenizer_copy (const Tokenizer *tokenizer, unsigned int offset, unsigned int len, char *out);
+
+// Returns the length of the message at the front, 0 if it isn't complete yet,
+// or TOKENIZER_UNKNOWN_MESSAGE if it isn't a known message
+int Tokenizer_next (const Tokenizer *tokenizer);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _TOKENIZER_H_ */
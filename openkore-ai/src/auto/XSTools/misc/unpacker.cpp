@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <string.h>
+#include "unpacker.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+static unsigned int
+typeSize (Unpacker_type type)
+{
+	switch (type) {
+	case UNPACKER_U8: case UNPACKER_S8:
+		return 1;
+	case UNPACKER_U16: case UNPACKER_S16:
+		return 2;
+	case UNPACKER_U32: case UNPACKER_S32:
+		return 4;
+	default:
+		return 0;
+	}
+}
+
+static int
+isSpace (char c)
+{
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+Unpacker *
+Unpacker_compile (const char *pattern, unsigned int len)
+{
+	Unpacker *unpacker = (Unpacker *) calloc (1, sizeof (Unpacker));
+	unsigned int capacity = 0, i = 0;
+
+	if (!unpacker)
+		return NULL;
+
+	while (i < len) {
+		Unpacker_type type;
+		unsigned int count = 1, j;
+		int rest = 0;
+
+		if (isSpace (pattern[i])) {
+			i++;
+			continue;
+		}
+
+		switch (pattern[i]) {
+		case 'x': type = UNPACKER_SKIP; break;
+		case 'a': type = UNPACKER_BYTES; break;
+		case 'A': type = UNPACKER_SPACE_PADDED; break;
+		case 'Z': type = UNPACKER_NULL_PADDED; break;
+		case 'C': type = UNPACKER_U8; break;
+		case 'c': type = UNPACKER_S8; break;
+		case 'v': type = UNPACKER_U16; break;
+		case 's': type = UNPACKER_S16; break;
+		case 'V': type = UNPACKER_U32; break;
+		case 'l': type = UNPACKER_S32; break;
+		default:
+			Unpacker_free (unpacker);
+			return NULL;
+		}
+		i++;
+
+		if (i < len && pattern[i] == '*') {
+			rest = 1;
+			i++;
+		} else if (i < len && pattern[i] >= '0' && pattern[i] <= '9') {
+			count = 0;
+			while (i < len && pattern[i] >= '0' && pattern[i] <= '9') {
+				count = count * 10 + pattern[i] - '0';
+				if (count > 65535) {
+					Unpacker_free (unpacker);
+					return NULL;
+				}
+				i++;
+			}
+		}
+		// Modifiers, groups and the like
+		if (i < len && !isSpace (pattern[i]) && !strchr ("xaAZCcvsVl", pattern[i])) {
+			Unpacker_free (unpacker);
+			return NULL;
+		}
+		// * only makes sense for strings here; numbers and skips would repeat
+		if (rest && (type == UNPACKER_SKIP || typeSize (type) != 0)) {
+			Unpacker_free (unpacker);
+			return NULL;
+		}
+
+		// Strings and skips are one field, numbers one field per value
+		j = (typeSize (type) != 0) ? count : 1;
+		if (unpacker->fieldCount + j > capacity) {
+			Unpacker_field *fields;
+			capacity = (unpacker->fieldCount + j) * 2;
+			fields = (Unpacker_field *) realloc (unpacker->fields, capacity * sizeof (Unpacker_field));
+			if (!fields) {
+				Unpacker_free (unpacker);
+				return NULL;
+			}
+			unpacker->fields = fields;
+		}
+		while (j-- > 0) {
+			Unpacker_field *field = &unpacker->fields[unpacker->fieldCount++];
+			field->type = type;
+			if (typeSize (type) != 0) {
+				field->size = typeSize (type);
+				unpacker->fixedSize += field->size;
+				unpacker->valueCount++;
+			} else {
+				field->size = rest ? UNPACKER_REST : count;
+				if (!rest)
+					unpacker->fixedSize += count;
+				if (type != UNPACKER_SKIP)
+					unpacker->valueCount++;
+			}
+		}
+	}
+	return unpacker;
+}
+
+void
+Unpacker_free (Unpacker *unpacker)
+{
+	free (unpacker->fields);
+	free (unpacker);
+}
+
+unsigned int
+Unpacker_stringField (const Unpacker_field *field, const unsigned char *data,
+	unsigned int offset, unsigned int len, unsigned int *valueLen)
+{
+	unsigned int available = len - offset;
+	unsigned int size = field->size;
+	const unsigned char *start = data + offset;
+	const unsigned char *nul;
+
+	if (size == UNPACKER_REST || size > available)
+		size = available;
+	*valueLen = size;
+
+	switch (field->type) {
+	case UNPACKER_SPACE_PADDED:
+		while (*valueLen > 0 && (start[*valueLen - 1] == '\0' || isSpace (start[*valueLen - 1])))
+			(*valueLen)--;
+		break;
+	case UNPACKER_NULL_PADDED:
+		nul = (const unsigned char *) memchr (start, '\0', size);
+		if (nul) {
+			*valueLen = nul - start;
+			// Z* takes the null byte too
+			if (field->size == UNPACKER_REST)
+				size = *valueLen + 1;
+		}
+		break;
+	default:
+		break;
+	}
+	return size;
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
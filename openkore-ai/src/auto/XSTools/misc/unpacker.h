@@ -0,0 +1,57 @@
+#ifndef _UNPACKER_H_
+#define _UNPACKER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Compiled pack templates, for decoding network messages without parsing their template every time.
+// Only the fixed layout subset of unpack() which packet_list uses is supported:
+//   a A Z with a count or *, x with a count, and C c v V s l with a count.
+// Whitespace separates fields; anything else makes Unpacker_compile fail, and the caller use unpack().
+
+typedef enum {
+	UNPACKER_SKIP,
+	UNPACKER_BYTES,        // a
+	UNPACKER_SPACE_PADDED, // A
+	UNPACKER_NULL_PADDED,  // Z
+	UNPACKER_U8,           // C
+	UNPACKER_S8,           // c
+	UNPACKER_U16,          // v
+	UNPACKER_S16,          // s
+	UNPACKER_U32,          // V
+	UNPACKER_S32           // l
+} Unpacker_type;
+
+// The count of a string field which takes the rest of the data
+#define UNPACKER_REST 0xFFFFFFFF
+
+typedef struct {
+	Unpacker_type type;
+	// The size in bytes of a string or skip field
+	unsigned int size;
+} Unpacker_field;
+
+typedef struct {
+	unsigned int fieldCount;
+	// The number of fields which produce a value
+	unsigned int valueCount;
+	// The size of the fields which don't take the rest of the data; shorter data can't be unpacked
+	unsigned int fixedSize;
+	Unpacker_field *fields;
+} Unpacker;
+
+Unpacker *Unpacker_compile (const char *pattern, unsigned int len);
+
+void Unpacker_free (Unpacker *unpacker);
+
+// Returns the size of a field at offset, and the length of the value it holds in valueLen for strings
+// Requires: the data is at least unpacker->fixedSize bytes long
+unsigned int Unpacker_stringField (const Unpacker_field *field, const unsigned char *data,
+	unsigned int offset, unsigned int len, unsigned int *valueLen);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _UNPACKER_H_ */
@@ -16,9 +16,19 @@
 	#include <sys/poll.h>
 #endif
 #include <unistd.h>
+#include <fcntl.h>
 #include <string.h>
 #include <assert.h>
 #include "consoleui.h"
+#include "../OSL/Memory/Allocator.h"
+
+#define INPUT_QUEUE_SIZE 256
+// Past this many unprinted bytes, repeats of the last line are counted instead of queued
+#define COALESCE_SIZE (256 * 1024)
+// Past this many, messages are dropped
+#define MAX_ARENA_SIZE (4 * 1024 * 1024)
+// The console thread wakes up at least this often to read input
+#define POLL_INTERVAL_MS 10
 
 
 // Hack: work around some memory corruption issues in readline
@@ -46,39 +56,58 @@ public:
 
 ConsoleUI *ConsoleUI::instance = NULL;
 
-ConsoleUI::ConsoleUI() {
+ConsoleUI::ConsoleUI()
+	: input(INPUT_QUEUE_SIZE)
+{
 	thread = 0;
-	pthread_mutex_init(&inputLock, NULL);
 	pthread_mutex_init(&outputLock, NULL);
 	pthread_cond_init(&outputCond, NULL);
+	arenaMessages = 0;
+	repeats = 0;
+	dropped = 0;
+	queued = 0;
+	printed = 0;
+	finished = false;
+	if (pipe(wakePipe) == 0) {
+		// Neither side may block: a full pipe already wakes the console thread up
+		fcntl(wakePipe[0], F_SETFL, fcntl(wakePipe[0], F_GETFL) | O_NONBLOCK);
+		fcntl(wakePipe[1], F_SETFL, fcntl(wakePipe[1], F_GETFL) | O_NONBLOCK);
+	} else {
+		wakePipe[0] = wakePipe[1] = -1;
+	}
 }
 
 ConsoleUI::~ConsoleUI() {
+	char *msg;
+
 	stop();
-	while (!input.empty()) {
-		free(input.front());
-		input.pop();
+	while (input.pop(msg)) {
+		free(msg);
 	}
-	while (!output.empty()) {
-		free(output.front());
-		output.pop();
+	if (wakePipe[0] != -1) {
+		close(wakePipe[0]);
+		close(wakePipe[1]);
 	}
-	pthread_mutex_destroy(&inputLock);
 	pthread_mutex_destroy(&outputLock);
 	pthread_cond_destroy(&outputCond);
 }
 
+void
+ConsoleUI::pushInput(char *line) {
+	// Only full if the main thread stopped reading for a long time;
+	// wait for it rather than losing what the user typed.
+	while (!input.push(line)) {
+		usleep(1000);
+	}
+}
+
 void
 ConsoleUI::lineRead(char *line) {
 	if (line == NULL) {
-		pthread_mutex_lock(&inputLock);
-		input.push(strdup(""));
-		pthread_mutex_unlock(&inputLock);
+		pushInput(strdup(""));
 		quit = true;
 	} else if (*line != '\0') {
-		pthread_mutex_lock(&inputLock);
-		input.push(line);
-		pthread_mutex_unlock(&inputLock);
+		pushInput(line);
 		add_history(line);
 	}
 	lineProcessed = true;
@@ -102,11 +131,44 @@ ConsoleUI::canRead() {
 #endif
 }
 
+void
+ConsoleUI::waitForEvents() {
+	char buf[256];
+#ifdef USE_SELECT
+	fd_set f;
+	struct timeval t;
+	int maxfd = STDIN_FILENO;
+	t.tv_sec = 0;
+	t.tv_usec = POLL_INTERVAL_MS * 1000;
+	FD_ZERO(&f);
+	FD_SET(STDIN_FILENO, &f);
+	if (wakePipe[0] != -1) {
+		FD_SET(wakePipe[0], &f);
+		if (wakePipe[0] > maxfd) {
+			maxfd = wakePipe[0];
+		}
+	}
+	select(maxfd + 1, &f, NULL, NULL, &t);
+#else
+	struct pollfd ufds[2];
+	ufds[0].fd = STDIN_FILENO;
+	ufds[0].events = POLLIN;
+	ufds[1].fd = wakePipe[0];
+	ufds[1].events = POLLIN;
+	poll(ufds, (wakePipe[0] != -1) ? 2 : 1, POLL_INTERVAL_MS);
+#endif
+	if (wakePipe[0] != -1) {
+		while (read(wakePipe[0], buf, sizeof(buf)) > 0);
+	}
+}
+
 void *
 ConsoleUI::threadMain(void *arg) {
 	rl_callback_handler_install("", ConsoleUICallbacks::lineRead);
 	while (!quit) {
-		while (canRead()) {
+		waitForEvents();
+		// At the end of the input, stdin stays readable
+		while (!quit && canRead()) {
 			lineProcessed = false;
 			rl_callback_read_char();
 			if (lineProcessed && rl_prompt != NULL && rl_prompt[0] != '\0') {
@@ -118,34 +180,69 @@ ConsoleUI::threadMain(void *arg) {
 			}
 		}
 
-		pthread_mutex_lock(&outputLock);
-		if (!output.empty()) {
-			processOutput();
-			pthread_cond_broadcast(&outputCond);
-		}
-		pthread_mutex_unlock(&outputLock);
-
-		usleep(10000);
+		processOutput();
 	}
+
+	// Print what's left; nothing queued afterwards will be
+	processOutput();
+	pthread_mutex_lock(&outputLock);
+	finished = true;
+	pthread_cond_broadcast(&outputCond);
+	pthread_mutex_unlock(&outputLock);
 	rl_callback_handler_remove();
 	return NULL;
 }
 
+// Report the repeats and drops so far at the end of the arena; requires outputLock
 void
+ConsoleUI::appendNotes() {
+	char note[128];
+
+	if (repeats > 0) {
+		snprintf(note, sizeof(note), "\e[0m(last message repeated %u more times)\n", repeats);
+		arena += note;
+		repeats = 0;
+	}
+	if (dropped > 0) {
+		snprintf(note, sizeof(note), "\e[0m(%u messages dropped: the console can't keep up)\n", dropped);
+		arena += note;
+		dropped = 0;
+	}
+	lastMessage.clear();
+}
+
+// Write the messages printed so far, and returns their number
+unsigned int
 ConsoleUI::processOutput() {
 	FILE *stream = (rl_outstream == NULL) ? stdout : rl_outstream;
 	int point, mark;
 	char *buffer = NULL;
 	char *prompt = NULL;
+	unsigned int count;
+	size_t end;
+
+	// Take everything queued so far, so that we know where the last line is.
+	batch.clear();
+	pthread_mutex_lock(&outputLock);
+	count = arenaMessages;
+	if (count > 0) {
+		appendNotes();
+		arena.swap(batch);
+		arenaMessages = 0;
+	}
+	pthread_mutex_unlock(&outputLock);
+	if (count == 0) {
+		return 0;
+	}
 
 	// Save readline's state.
 	point = rl_point;
 	mark = rl_mark;
 	if (rl_line_buffer != NULL) {
-		buffer = strdup(rl_line_buffer);
+		buffer = OSL::Memory::duplicate(rl_line_buffer);
 	}
 	if (rl_prompt != NULL) {
-		prompt = strdup(rl_prompt);
+		prompt = OSL::Memory::duplicate(rl_prompt);
 	}
 	rl_replace_line("", 0);
 	rl_point = rl_mark = 0;
@@ -160,46 +257,28 @@ ConsoleUI::processOutput() {
 		if (prompt[0] != '\0') {
 			fputs(prompt, stream);
 		}
-		free(prompt);
+		OSL::Memory::release(prompt);
 		prompt = NULL;
 	}
-	// Make sure the prompt color will be set to default.
-	prompt = strdup("\e[0m");
-
-	while (!output.empty()) {
-		char *msg = output.front();
-		size_t len;
-
-		len = strlen(msg);
-		if (output.size() == 1 && len > 0 && msg[len - 1] != '\n') {
-			// This is the last message and it doesn't end with a newline.
-			// Use this message as prompt.
-			char buf[1024 * 32];
-			// Reset the prompt color.
-			snprintf(buf, sizeof(buf) - 1, "%s\e[0m", msg);
-			rl_set_prompt(buf);
-
-			// Prevent prompt from being set to an empty string.
-			if (prompt != NULL) {
-				free(prompt);
-				prompt = NULL;
-			}
-		} else {
-			fputs(msg, stream);
-		}
-
-		free(msg);
-		output.pop();
+	// Everything up to the last newline is written at once. If the
+	// output doesn't end with a newline, the rest is used as prompt,
+	// with its color reset; otherwise just make sure the prompt color
+	// will be set to default.
+	end = batch.rfind('\n');
+	end = (end == std::string::npos) ? 0 : end + 1;
+	fwrite(batch.data(), 1, end, stream);
+	if (end < batch.size()) {
+		batch.erase(0, end);
+		batch += "\e[0m";
+		rl_set_prompt(batch.c_str());
+	} else {
+		rl_set_prompt("\e[0m");
 	}
 
 	// Restore readline's state.
-	if (prompt != NULL) {
-		rl_set_prompt(prompt);
-		free(prompt);
-	}
 	if (buffer != NULL) {
 		rl_insert_text(buffer);
-		free(buffer);
+		OSL::Memory::release(buffer);
 	}
 	rl_point = point;
 	rl_mark = mark;
@@ -208,6 +287,17 @@ ConsoleUI::processOutput() {
 	rl_display_prompt = NULL;
 	rl_redisplay();
 	fflush(stream);
+
+	// Don't keep the memory of a burst around
+	if (batch.capacity() > COALESCE_SIZE) {
+		std::string().swap(batch);
+	}
+
+	pthread_mutex_lock(&outputLock);
+	printed += count;
+	pthread_cond_broadcast(&outputCond);
+	pthread_mutex_unlock(&outputLock);
+	return count;
 }
 
 ConsoleUI *
@@ -233,6 +323,9 @@ ConsoleUI::stop() {
 	if (thread != 0) {
 		waitUntilPrinted();
 		quit = true;
+		if (wakePipe[1] != -1) {
+			write(wakePipe[1], "", 1);
+		}
 		pthread_join(thread, NULL);
 		thread = 0;
 	}
@@ -240,17 +333,41 @@ ConsoleUI::stop() {
 
 void
 ConsoleUI::print(const char *msg) {
+	size_t len;
+	bool wake;
+
 	assert(msg != NULL);
+	len = strlen(msg);
 	pthread_mutex_lock(&outputLock);
-	output.push(strdup(msg));
-	pthread_cond_broadcast(&outputCond);
+	queued++;
+	// Only the first message of a batch needs to wake the console thread up
+	wake = arenaMessages++ == 0;
+	if (arena.size() >= COALESCE_SIZE && len > 0 && msg[len - 1] == '\n'
+	 && lastMessage.size() == len && memcmp(lastMessage.data(), msg, len) == 0) {
+		repeats++;
+	} else if (arena.size() + len > MAX_ARENA_SIZE) {
+		dropped++;
+	} else {
+		if (repeats > 0 || dropped > 0) {
+			appendNotes();
+		}
+		arena.append(msg, len);
+		if (arena.size() >= COALESCE_SIZE) {
+			lastMessage.assign(msg, len);
+		}
+	}
 	pthread_mutex_unlock(&outputLock);
+
+	if (wake && wakePipe[1] != -1) {
+		write(wakePipe[1], "", 1);
+	}
 }
 
 void
 ConsoleUI::waitUntilPrinted() {
 	pthread_mutex_lock(&outputLock);
-	while (!output.empty()) {
+	unsigned int target = queued;
+	while (!finished && (int) (target - printed) > 0) {
 		pthread_cond_wait(&outputCond, &outputLock);
 	}
 	pthread_mutex_unlock(&outputLock);
@@ -258,15 +375,13 @@ ConsoleUI::waitUntilPrinted() {
 
 char *
 ConsoleUI::getInput() {
-	char *result = NULL;
+	char *result;
 
-	pthread_mutex_lock(&inputLock);
-	if (!input.empty()) {
-		result = input.front();
-		input.pop();
+	if (input.pop(result)) {
+		return result;
+	} else {
+		return NULL;
 	}
-	pthread_mutex_unlock(&inputLock);
-	return result;
 }
 
 void
@@ -2,7 +2,8 @@
 #define _CONSOLEUI_H_
 
 #include <pthread.h>
-#include <queue>
+#include <string>
+#include "../OSL/Threading/SpscQueue.h"
 
 class ConsoleUICallbacks;
 
@@ -17,11 +18,33 @@ private:
 	static ConsoleUI *instance;
 	pthread_t thread;
 
-	pthread_mutex_t inputLock;
+	// Lines go from the console thread to getInput() without locking.
+	OSL::SpscQueue<char *> input;
+
+	// Messages are appended to the arena by print(). The console thread
+	// swaps it with its own batch, and writes the batch at once; the lock
+	// is only held to copy a message or to swap the buffers.
 	pthread_mutex_t outputLock;
+	std::string arena;
+	std::string batch;
+	// The number of messages in the arena, including the coalesced and
+	// dropped ones
+	unsigned int arenaMessages;
+	// When the console can't keep up, the last message when it repeats,
+	// how many times it did, and how many messages were dropped.
+	std::string lastMessage;
+	unsigned int repeats;
+	unsigned int dropped;
+	// Written to by print() to wake the console thread up.
+	int wakePipe[2];
+
+	// Used by waitUntilPrinted(), which waits for the number of printed
+	// messages to catch up with the number of queued ones.
 	pthread_cond_t outputCond;
-	std::queue<char *> input;
-	std::queue<char *> output;
+	unsigned int queued;
+	unsigned int printed;
+	// Set once the console thread won't print anything anymore.
+	bool finished;
 
 	bool quit;
 	bool lineProcessed;
@@ -30,7 +53,10 @@ private:
 	~ConsoleUI();
 
 	void *threadMain(void *arg);
-	void processOutput();
+	void waitForEvents();
+	void appendNotes();
+	unsigned int processOutput();
+	void pushInput(char *line);
 	void lineRead(char *line);
 	bool canRead();
 	static void cleanup();
@@ -63,6 +89,11 @@ public:
 	 * message is put into a queue, which will be processed
 	 * later.
 	 *
+	 * This method never blocks for long: when the console
+	 * falls behind, repeats of the same line are counted
+	 * instead of queued, and when it's far behind, messages
+	 * are dropped. Both are reported on the console.
+	 *
 	 * @require
 	 *    msg != NULL &&
 	 *    The interface must have already been started.
@@ -0,0 +1,65 @@
+MODULE = Utils::Unix   PACKAGE = Utils::Unix::LogSink
+
+void
+open(target, format = "json")
+	const char *target
+	const char *format
+INIT:
+	LogSink::Format f;
+	std::string error;
+CODE:
+	if (strcmp(format, "json") == 0) {
+		f = LogSink::JSON;
+	} else if (strcmp(format, "binary") == 0) {
+		f = LogSink::BINARY;
+	} else {
+		croak("Unknown log sink format '%s'; it must be json or binary", format);
+	}
+	if (!LogSink::open(target, f, error)) {
+		croak("Unable to open log sink %s: %s", target, error.c_str());
+	}
+
+void
+close()
+CODE:
+	LogSink::close();
+
+bool
+isOpen()
+CODE:
+	RETVAL = LogSink::getInstance() != NULL;
+OUTPUT:
+	RETVAL
+
+void
+write(type, domain, message)
+	char *type
+	char *domain
+	SV *message
+INIT:
+	LogSink *sink = LogSink::getInstance();
+	STRLEN len;
+	const char *msg;
+CODE:
+	if (sink != NULL) {
+		msg = SvPVutf8(message, len);
+		sink->write(type, domain, msg, len);
+	}
+
+void
+flush()
+INIT:
+	LogSink *sink = LogSink::getInstance();
+CODE:
+	if (sink != NULL) {
+		sink->flush();
+	}
+
+unsigned int
+dropped()
+INIT:
+	LogSink *sink = LogSink::getInstance();
+CODE:
+	RETVAL = (sink != NULL) ? sink->getDropped() : 0;
+OUTPUT:
+	RETVAL
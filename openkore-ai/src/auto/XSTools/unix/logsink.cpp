@@ -0,0 +1,430 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/time.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "logsink.h"
+
+// The size of a ring file when the target doesn't say
+#define DEFAULT_RING_SIZE (4 * 1024 * 1024)
+#define MIN_RING_SIZE (64 * 1024)
+// Past this many unwritten bytes, messages are dropped
+#define MAX_PENDING_SIZE (4 * 1024 * 1024)
+#define RING_VERSION 1
+
+static pthread_mutex_t singletonLock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned long long
+now() {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (unsigned long long) tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void
+appendJSONString(std::string &out, const char *str, size_t len) {
+	static const char hex[] = "0123456789abcdef";
+
+	out += '"';
+	for (size_t i = 0; i < len; i++) {
+		unsigned char c = str[i];
+		switch (c) {
+		case '"':
+			out += "\\\"";
+			break;
+		case '\\':
+			out += "\\\\";
+			break;
+		case '\n':
+			out += "\\n";
+			break;
+		case '\r':
+			out += "\\r";
+			break;
+		case '\t':
+			out += "\\t";
+			break;
+		default:
+			if (c < 0x20 || c == 0x7f) {
+				out += "\\u00";
+				out += hex[c >> 4];
+				out += hex[c & 0xf];
+			} else {
+				out += (char) c;
+			}
+		}
+	}
+	out += '"';
+}
+
+
+/**
+ * This class delegates callback functions back to the LogSink instance.
+ */
+class LogSinkCallbacks {
+public:
+	static void *threadMain(void *arg) {
+		return ((LogSink *) arg)->threadMain();
+	}
+};
+
+
+LogSink *LogSink::instance = NULL;
+
+LogSink::LogSink(Format format) {
+	this->format = format;
+	thread = 0;
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&cond, NULL);
+	queued = 0;
+	written = 0;
+	dropped = 0;
+	quit = false;
+	ring = NULL;
+	ringSize = 0;
+	sock = -1;
+	lastConnect = 0;
+}
+
+LogSink::~LogSink() {
+	if (thread != 0) {
+		pthread_mutex_lock(&lock);
+		quit = true;
+		pthread_cond_broadcast(&cond);
+		pthread_mutex_unlock(&lock);
+		pthread_join(thread, NULL);
+	}
+	if (ring != NULL) {
+		munmap(ring, ringSize);
+	}
+	if (sock != -1) {
+		::close(sock);
+	}
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&cond);
+}
+
+bool
+LogSink::openRing(const char *path, size_t size, std::string &error) {
+	LogSinkRingHeader header;
+	int fd;
+
+	if (size < MIN_RING_SIZE) {
+		size = MIN_RING_SIZE;
+	}
+	fd = ::open(path, O_RDWR | O_CREAT, 0644);
+	if (fd == -1) {
+		error = strerror(errno);
+		return false;
+	}
+	if (ftruncate(fd, size) == -1) {
+		error = strerror(errno);
+		::close(fd);
+		return false;
+	}
+	ring = (char *) mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (ring == MAP_FAILED) {
+		ring = NULL;
+		error = strerror(errno);
+		return false;
+	}
+	ringSize = size;
+
+	// Readers check the magic last
+	memset(&header, 0, sizeof(header));
+	header.version = RING_VERSION;
+	header.format = format;
+	header.headerSize = sizeof(header);
+	header.capacity = size - sizeof(header);
+	header.writeOffset = 0;
+	header.lastRecord = 0;
+	memcpy(ring, &header, sizeof(header));
+	__sync_synchronize();
+	memcpy(ring, "OKLOGRNG", 8);
+	return true;
+}
+
+bool
+LogSink::openSocket(const char *path, std::string &error) {
+	if (strlen(path) >= sizeof(((struct sockaddr_un *) 0)->sun_path)) {
+		error = "socket path too long";
+		return false;
+	}
+	sockPath = path;
+	// The collector may not be there yet; connecting is retried later
+	connectSocket();
+	return true;
+}
+
+bool
+LogSink::connectSocket() {
+	struct sockaddr_un addr;
+	double time = now() / 1e6;
+
+	if (sock != -1) {
+		return true;
+	}
+	// At most once per second
+	if (time - lastConnect < 1) {
+		return false;
+	}
+	lastConnect = time;
+
+	sock = socket(AF_UNIX, SOCK_DGRAM, 0);
+	if (sock == -1) {
+		return false;
+	}
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, sockPath.c_str());
+	if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+		::close(sock);
+		sock = -1;
+		return false;
+	}
+	return true;
+}
+
+// Format a record of pending into out
+void
+LogSink::formatRecord(const char *record) {
+	LogSinkRecord header;
+	const char *strings = record + sizeof(LogSinkRecord);
+	char time[32];
+
+	if (format == BINARY) {
+		memcpy(&header, record, sizeof(header));
+		out.assign(record, header.size);
+		return;
+	}
+
+	memcpy(&header, record, sizeof(header));
+	snprintf(time, sizeof(time), "%llu.%06llu", header.time / 1000000, header.time % 1000000);
+	out = "{\"time\":";
+	out += time;
+	out += ",\"type\":";
+	appendJSONString(out, strings, header.typeLen);
+	out += ",\"domain\":";
+	appendJSONString(out, strings + header.typeLen, header.domainLen);
+	out += ",\"message\":";
+	appendJSONString(out, strings + header.typeLen + header.domainLen, header.messageLen);
+	out += "}\n";
+}
+
+// Write a formatted record to the target
+void
+LogSink::emit(const char *data, size_t len) {
+	if (ring != NULL) {
+		LogSinkRingHeader *header = (LogSinkRingHeader *) ring;
+		char *records = ring + sizeof(LogSinkRingHeader);
+		size_t capacity = header->capacity;
+		unsigned long long offset = header->writeOffset;
+
+		if (len > capacity) {
+			// Only the end would be left anyway
+			data += len - capacity;
+			offset += len - capacity;
+			len = capacity;
+		}
+		size_t start = offset % capacity;
+		size_t first = (len < capacity - start) ? len : capacity - start;
+		memcpy(records + start, data, first);
+		memcpy(records, data + first, len - first);
+		__sync_synchronize();
+		header->writeOffset = offset + len;
+		header->lastRecord = offset;
+
+	} else if (connectSocket()) {
+		if (send(sock, data, len, MSG_DONTWAIT | MSG_NOSIGNAL) == -1
+		 && errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS) {
+			// The collector went away
+			::close(sock);
+			sock = -1;
+		}
+	}
+}
+
+void *
+LogSink::threadMain() {
+	unsigned int reported = 0;
+
+	pthread_mutex_lock(&lock);
+	while (true) {
+		while (pending.empty() && !quit && dropped == reported) {
+			pthread_cond_wait(&cond, &lock);
+		}
+		if (pending.empty() && dropped == reported) {
+			break;
+		}
+
+		unsigned int count = queued - written;
+		unsigned int newlyDropped = dropped - reported;
+		reported = dropped;
+		batch.clear();
+		pending.swap(batch);
+		pthread_mutex_unlock(&lock);
+
+		if (newlyDropped > 0) {
+			char note[128];
+			snprintf(note, sizeof(note), "%u log messages dropped: the log sink can't keep up\n",
+				newlyDropped);
+			std::string record;
+			LogSinkRecord header;
+			memset(&header, 0, sizeof(header));
+			header.typeLen = 7;
+			header.domainLen = 7;
+			header.messageLen = strlen(note);
+			header.size = sizeof(header) + 14 + header.messageLen;
+			header.time = now();
+			record.append((const char *) &header, sizeof(header));
+			record += "warninglogSink";
+			record += note;
+			formatRecord(record.data());
+			emit(out.data(), out.size());
+		}
+
+		for (size_t i = 0; i < batch.size(); ) {
+			LogSinkRecord header;
+			memcpy(&header, batch.data() + i, sizeof(header));
+			formatRecord(batch.data() + i);
+			emit(out.data(), out.size());
+			i += header.size;
+		}
+		// Don't keep the memory of a burst around
+		if (batch.capacity() > MAX_PENDING_SIZE / 16) {
+			std::string().swap(batch);
+		}
+
+		pthread_mutex_lock(&lock);
+		written += count;
+		pthread_cond_broadcast(&cond);
+	}
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+LogSink *
+LogSink::getInstance() {
+	return instance;
+}
+
+bool
+LogSink::open(const char *target, Format format, std::string &error) {
+	LogSink *sink = new LogSink(format);
+	bool ok;
+
+	if (strncmp(target, "ring:", 5) == 0) {
+		std::string path = target + 5;
+		size_t size = DEFAULT_RING_SIZE;
+		size_t colon = path.rfind(':');
+
+		if (colon != std::string::npos && colon + 1 < path.size()
+		 && strspn(path.c_str() + colon + 1, "0123456789kKmM") == path.size() - colon - 1) {
+			char *suffix;
+			size = strtoul(path.c_str() + colon + 1, &suffix, 10);
+			if (*suffix == 'k' || *suffix == 'K') {
+				size *= 1024;
+			} else if (*suffix == 'm' || *suffix == 'M') {
+				size *= 1024 * 1024;
+			}
+			path.erase(colon);
+		}
+		ok = sink->openRing(path.c_str(), size, error);
+	} else if (strncmp(target, "unix:", 5) == 0) {
+		ok = sink->openSocket(target + 5, error);
+	} else {
+		error = "the target must start with ring: or unix:";
+		ok = false;
+	}
+
+	if (ok && pthread_create(&sink->thread, NULL, LogSinkCallbacks::threadMain, sink) != 0) {
+		sink->thread = 0;
+		error = "unable to start the writer thread";
+		ok = false;
+	}
+	if (!ok) {
+		delete sink;
+		return false;
+	}
+
+	close();
+	pthread_mutex_lock(&singletonLock);
+	instance = sink;
+	pthread_mutex_unlock(&singletonLock);
+	return true;
+}
+
+void
+LogSink::close() {
+	LogSink *sink;
+
+	pthread_mutex_lock(&singletonLock);
+	sink = instance;
+	instance = NULL;
+	pthread_mutex_unlock(&singletonLock);
+	if (sink != NULL) {
+		// The writer thread writes everything before quitting
+		delete sink;
+	}
+}
+
+void
+LogSink::write(const char *type, const char *domain, const char *msg, size_t len) {
+	LogSinkRecord header;
+	size_t typeLen = strlen(type);
+	size_t domainLen = strlen(domain);
+
+	if (typeLen > 0xFFFF) {
+		typeLen = 0xFFFF;
+	}
+	if (domainLen > 0xFFFF) {
+		domainLen = 0xFFFF;
+	}
+	memset(&header, 0, sizeof(header));
+	header.typeLen = typeLen;
+	header.domainLen = domainLen;
+	header.messageLen = len;
+	header.size = sizeof(header) + typeLen + domainLen + len;
+	header.time = now();
+
+	pthread_mutex_lock(&lock);
+	if (pending.size() + header.size > MAX_PENDING_SIZE) {
+		dropped++;
+	} else {
+		bool wake = pending.empty();
+		pending.append((const char *) &header, sizeof(header));
+		pending.append(type, typeLen);
+		pending.append(domain, domainLen);
+		pending.append(msg, len);
+		queued++;
+		if (wake) {
+			pthread_cond_broadcast(&cond);
+		}
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+void
+LogSink::flush() {
+	pthread_mutex_lock(&lock);
+	unsigned int target = queued;
+	while ((int) (target - written) > 0) {
+		pthread_cond_wait(&cond, &lock);
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+unsigned int
+LogSink::getDropped() {
+	unsigned int result;
+	pthread_mutex_lock(&lock);
+	result = dropped;
+	pthread_mutex_unlock(&lock);
+	return result;
+}
@@ -0,0 +1,154 @@
+#ifndef _LOGSINK_H_
+#define _LOGSINK_H_
+
+#include <pthread.h>
+#include <string>
+
+class LogSinkCallbacks;
+
+/**
+ * Writes log messages as records to a memory-mapped ring file or to a
+ * Unix datagram socket, for bots which nobody watches on a terminal.
+ * Messages are only copied by write(); a thread formats and writes them.
+ * This class is thread-safe.
+ *
+ * A target is either:
+ * - "ring:PATH[:SIZE]" - A file of SIZE bytes (4 MB by default) which
+ *   starts with a LogSinkRingHeader. Records are written one after the
+ *   other into the rest of the file, wrapping around at its end, and
+ *   writeOffset counts the bytes ever written.
+ * - "unix:PATH" - A datagram socket bound by the collector, which gets
+ *   one record per datagram.
+ *
+ * In the JSON format, a record is a line like:
+ * <pre>
+ * {"time":1234567890.123456,"type":"message","domain":"info","message":"..."}
+ * </pre>
+ * In the binary format, a record is a LogSinkRecord, followed by the
+ * type, the domain and the message. Numbers are in the host's byte order.
+ */
+class LogSink {
+public:
+	enum Format {
+		JSON,
+		BINARY
+	};
+
+private:
+	friend class LogSinkCallbacks;
+
+	static LogSink *instance;
+	pthread_t thread;
+	Format format;
+
+	// Messages are appended to pending by write(), as a LogSinkRecord
+	// followed by their strings. The writer thread swaps it with batch
+	// and formats the batch into out.
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	std::string pending;
+	std::string batch;
+	std::string out;
+	unsigned int queued;
+	unsigned int written;
+	unsigned int dropped;
+	bool quit;
+
+	// The ring file, when the target is one
+	char *ring;
+	size_t ringSize;
+	// The socket, when the target is one
+	int sock;
+	std::string sockPath;
+	double lastConnect;
+
+	LogSink(Format format);
+	~LogSink();
+
+	bool openRing(const char *path, size_t size, std::string &error);
+	bool openSocket(const char *path, std::string &error);
+	bool connectSocket();
+	void *threadMain();
+	void formatRecord(const char *record);
+	void emit(const char *data, size_t len);
+
+public:
+	/**
+	 * Returns the current LogSink, or NULL if none is open.
+	 */
+	static LogSink *getInstance();
+
+	/**
+	 * Open the sink for the given target, and start its writer thread.
+	 * Any sink which is already open is closed first.
+	 *
+	 * @param error  The reason, when the sink cannot be opened.
+	 * @return Whether the sink has been opened.
+	 * @require target != NULL
+	 */
+	static bool open(const char *target, Format format, std::string &error);
+
+	/**
+	 * Write what has been queued so far, and close the current sink.
+	 */
+	static void close();
+
+	/**
+	 * Queue a message. This method never blocks for long: when the
+	 * writer thread is too far behind, the message is dropped and
+	 * counted instead.
+	 *
+	 * @require type != NULL && domain != NULL && msg != NULL
+	 */
+	void write(const char *type, const char *domain, const char *msg, size_t len);
+
+	/**
+	 * Wait until all queued messages have been written.
+	 */
+	void flush();
+
+	/**
+	 * Returns the number of messages which have been dropped.
+	 */
+	unsigned int getDropped();
+};
+
+/**
+ * The start of a ring file.
+ */
+struct LogSinkRingHeader {
+	// "OKLOGRNG"
+	char magic[8];
+	unsigned int version;
+	// LogSink::JSON or LogSink::BINARY
+	unsigned int format;
+	// The size of the header, after which the records start
+	unsigned int headerSize;
+	unsigned int reserved;
+	// The number of bytes after the header
+	unsigned long long capacity;
+	// The number of bytes ever written; a record at offset N starts at
+	// byte headerSize + N % capacity. Only updated once the records
+	// before it are complete.
+	volatile unsigned long long writeOffset;
+	// Where the last complete record starts. A reader which attaches,
+	// or which fell more than capacity bytes behind, starts from there.
+	volatile unsigned long long lastRecord;
+};
+
+/**
+ * The start of a record in the binary format.
+ */
+struct LogSinkRecord {
+	// The size of the record, including this header and its strings
+	unsigned int size;
+	// The string lengths; the strings aren't NUL-terminated
+	unsigned short typeLen;
+	unsigned short domainLen;
+	unsigned int messageLen;
+	unsigned int reserved;
+	// Microseconds since the epoch
+	unsigned long long time;
+};
+
+#endif /* _LOGSINK_H_ */
@@ -3,6 +3,7 @@
 #include <sys/ioctl.h>
 #include <string.h>
 #include "consoleui.h"
+#include "logsink.h"
 
 #include "EXTERN.h"
 #include "perl.h"
@@ -33,3 +34,5 @@ getTerminalSize()
 		XPUSHs (sv_2mortal (newSVnv (size.ws_row)));
 
 INCLUDE: consoleui-perl.xs
+
+INCLUDE: logsink-perl.xs
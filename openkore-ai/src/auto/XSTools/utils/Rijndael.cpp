@@ -4,6 +4,7 @@
 #include <cstring>
 #include <stdexcept>
 #include "Rijndael.h"
+#include "aes-hw.h"
 
 using namespace std;
 
@@ -927,7 +928,7 @@ char const* CRijndael::sm_szErrorMsg2 = "Data not multiple of Block Size";
 char const* CRijndael::sm_chain0 = "\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0\0";
 
 //CONSTRUCTOR
-CRijndael::CRijndael() : m_bKeyInit(false)
+CRijndael::CRijndael() : m_bKeyInit(false), m_bStateless(false), m_bHardware(false), m_bHardwareAllowed(true)
 {
 }
 
@@ -1041,7 +1042,24 @@ void CRijndael::MakeKey(char const* key, char const* chain, int keylength, int b
 				sm_U3[(tt >>  8) & 0xFF] ^
 				sm_U4[tt & 0xFF];
 		}
+	//Bytes of the round keys, the first column of a block being its first word
+	if(DEFAULT_BLOCK_SIZE == m_blockSize)
+		for(int r=0; r<=m_iROUNDS; r++)
+			for(j=0; j<BC; j++)
+				for(i=0; i<4; i++)
+				{
+					m_hwKe[r*16 + j*4 + i] = (unsigned char)(m_Ke[r][j] >> (24 - 8*i));
+					m_hwKd[r*16 + j*4 + i] = (unsigned char)(m_Kd[r][j] >> (24 - 8*i));
+				}
 	m_bKeyInit = true;
+	UseHardware(m_bHardwareAllowed);
+}
+
+bool CRijndael::UseHardware(bool enable)
+{
+	m_bHardwareAllowed = enable;
+	m_bHardware = enable && m_bKeyInit && DEFAULT_BLOCK_SIZE == m_blockSize && AESHW_available();
+	return m_bHardware;
 }
 
 //Convenience method to encrypt exactly one block of plaintext, assuming
@@ -1052,6 +1070,11 @@ void CRijndael::DefEncryptBlock(char const* in, char* result)
 {
 	if(false==m_bKeyInit)
 		throw runtime_error(sm_szErrorMsg1);
+	if(m_bHardware)
+	{
+		AESHW_encryptBlocks(m_hwKe, m_iROUNDS, (unsigned char const*)in, (unsigned char*)result, 1);
+		return;
+	}
 	int* Ker = m_Ke[0];
 	int t0 = ((unsigned char)*(in++) << 24);
 	t0 |= ((unsigned char)*(in++) << 16);
@@ -1127,6 +1150,11 @@ void CRijndael::DefDecryptBlock(char const* in, char* result)
 {
 	if(false==m_bKeyInit)
 		throw runtime_error(sm_szErrorMsg1);
+	if(m_bHardware)
+	{
+		AESHW_decryptBlocks(m_hwKd, m_iROUNDS, (unsigned char const*)in, (unsigned char*)result, 1);
+		return;
+	}
 	int* Kdr = m_Kd[0];
 	int t0 = ((unsigned char)*(in++) << 24);
 	t0 = t0 | ((unsigned char)*(in++) << 16);
@@ -1300,6 +1328,8 @@ void CRijndael::Encrypt(char const* in, char* result, size_t n, int iMode)
 	//n should be > 0 and multiple of m_blockSize
 	if(0==n || n%m_blockSize!=0)
 		throw runtime_error(sm_szErrorMsg2);
+	if(m_bStateless)
+		ResetChain();
 	unsigned int i;
 	char const* pin;
 	char* presult;
@@ -1318,13 +1348,15 @@ void CRijndael::Encrypt(char const* in, char* result, size_t n, int iMode)
 	{
 		for(i=0,pin=in,presult=result; i<n/m_blockSize; i++)
 		{
-			EncryptBlock(m_chain, presult);
-			Xor(presult, pin);
-			memcpy(m_chain, presult, m_blockSize);
+			EncryptBlock(m_chain, m_chain);
+			Xor(m_chain, pin);
+			memcpy(presult, m_chain, m_blockSize);
 			pin += m_blockSize;
 			presult += m_blockSize;
 		}
 	}
+	else if(m_bHardware) //ECB mode, all blocks at once
+		AESHW_encryptBlocks(m_hwKe, m_iROUNDS, (unsigned char const*)in, (unsigned char*)result, n/m_blockSize);
 	else //ECB mode, not using the Chain
 	{
 		for(i=0,pin=in,presult=result; i<n/m_blockSize; i++)
@@ -1343,16 +1375,20 @@ void CRijndael::Decrypt(char const* in, char* result, size_t n, int iMode)
 	//n should be > 0 and multiple of m_blockSize
 	if(0==n || n%m_blockSize!=0)
 		throw runtime_error(sm_szErrorMsg2);
+	if(m_bStateless)
+		ResetChain();
 	unsigned int i;
 	char const* pin;
 	char* presult;
+	char block[MAX_BLOCK_SIZE]; //the ciphertext block, which result may overwrite
 	if(CBC == iMode) //CBC mode, using the Chain
 	{
 		for(i=0,pin=in,presult=result; i<n/m_blockSize; i++)
 		{
-			DecryptBlock(pin, presult);
+			memcpy(block, pin, m_blockSize);
+			DecryptBlock(block, presult);
 			Xor(presult, m_chain);
-			memcpy(m_chain, pin, m_blockSize);				
+			memcpy(m_chain, block, m_blockSize);
 			pin += m_blockSize;
 			presult += m_blockSize;
 		}
@@ -1361,14 +1397,16 @@ void CRijndael::Decrypt(char const* in, char* result, size_t n, int iMode)
 	{
 		for(i=0,pin=in,presult=result; i<n/m_blockSize; i++)
 		{
+			memcpy(block, pin, m_blockSize);
 			EncryptBlock(m_chain, presult);
-			//memcpy(presult, pin, m_blockSize);
-			Xor(presult, pin);
-			memcpy(m_chain, pin, m_blockSize);
+			Xor(presult, block);
+			memcpy(m_chain, block, m_blockSize);
 			pin += m_blockSize;
 			presult += m_blockSize;
 		}
 	}
+	else if(m_bHardware) //ECB mode, all blocks at once
+		AESHW_decryptBlocks(m_hwKd, m_iROUNDS, (unsigned char const*)in, (unsigned char*)result, n/m_blockSize);
 	else //ECB mode, not using the Chain
 	{
 		for(i=0,pin=in,presult=result; i<n/m_blockSize; i++)
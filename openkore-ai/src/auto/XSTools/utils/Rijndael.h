@@ -105,6 +105,7 @@ public:
 	// result     - The plaintext generated from a ciphertext using the session key.
 	void DecryptBlock(char const* in, char* result);
 
+	//Encrypt or decrypt n bytes, a multiple of the block size. result may be in, to work in place.
 	void Encrypt(char const* in, char* result, size_t n, int iMode=ECB);
 	
 	void Decrypt(char const* in, char* result, size_t n, int iMode=ECB);
@@ -138,6 +139,17 @@ public:
 		memcpy(m_chain, m_chain0, m_blockSize);
 	}
 
+	//Whether Encrypt() and Decrypt() start from the initial chain on every call, rather than going on
+	//from the chain of the previous call, so that the object doesn't change when it is used
+	void SetStateless(bool stateless)
+	{
+		m_bStateless = stateless;
+	}
+
+	//Whether to use the AES instructions of the CPU for 16 byte blocks, the default when it has them,
+	//or the tables. Returns whether they are used, never with other block sizes.
+	bool UseHardware(bool enable);
+
 public:
 	//Null chain
 	static char const* sm_chain0;
@@ -183,6 +195,13 @@ private:
 	int tk[MAX_KC];
 	int a[MAX_BC];
 	int t[MAX_BC];
+	//See SetStateless()
+	bool m_bStateless;
+	//The round keys of m_Ke and m_Kd as bytes, for the AES instructions
+	bool m_bHardware;
+	bool m_bHardwareAllowed;
+	unsigned char m_hwKe[(MAX_ROUNDS+1)*DEFAULT_BLOCK_SIZE];
+	unsigned char m_hwKd[(MAX_ROUNDS+1)*DEFAULT_BLOCK_SIZE];
 };
 
 #endif // __RIJNDAEL_H__
@@ -0,0 +1,185 @@
+#include "aes-hw.h"
+#include "cpu-features.h"
+
+#if defined(SIMD_X86)
+	#define AESHW_X86 1
+	#include <wmmintrin.h>
+	#include <emmintrin.h>
+	#ifdef _MSC_VER
+		#define AESHW_TARGET
+	#else
+		#define AESHW_TARGET __attribute__((target("aes,sse2")))
+	#endif
+#elif defined(__aarch64__) && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES))
+	// Only when the compiler targets the extension, as it does by default for Apple's CPUs
+	#define AESHW_ARM 1
+	#include <arm_neon.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#if defined(AESHW_X86)
+
+// Blocks encrypted at once, so the instructions of several blocks are in flight together
+#define AESHW_LANES 4
+
+AESHW_TARGET void
+AESHW_encryptBlocks (const unsigned char *roundKeys, int rounds, const unsigned char *in, unsigned char *out,
+	size_t blocks)
+{
+	__m128i keys[15];
+	size_t i;
+	int r, lane;
+
+	for (r = 0; r <= rounds; r++) {
+		keys[r] = _mm_loadu_si128 ((const __m128i *) (roundKeys + r * 16));
+	}
+	for (i = 0; i + AESHW_LANES <= blocks; i += AESHW_LANES) {
+		__m128i state[AESHW_LANES];
+		for (lane = 0; lane < AESHW_LANES; lane++) {
+			state[lane] = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (in + (i + lane) * 16)), keys[0]);
+		}
+		for (r = 1; r < rounds; r++) {
+			for (lane = 0; lane < AESHW_LANES; lane++) {
+				state[lane] = _mm_aesenc_si128 (state[lane], keys[r]);
+			}
+		}
+		for (lane = 0; lane < AESHW_LANES; lane++) {
+			_mm_storeu_si128 ((__m128i *) (out + (i + lane) * 16), _mm_aesenclast_si128 (state[lane], keys[rounds]));
+		}
+	}
+	for (; i < blocks; i++) {
+		__m128i state = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (in + i * 16)), keys[0]);
+		for (r = 1; r < rounds; r++) {
+			state = _mm_aesenc_si128 (state, keys[r]);
+		}
+		_mm_storeu_si128 ((__m128i *) (out + i * 16), _mm_aesenclast_si128 (state, keys[rounds]));
+	}
+}
+
+AESHW_TARGET void
+AESHW_decryptBlocks (const unsigned char *roundKeys, int rounds, const unsigned char *in, unsigned char *out,
+	size_t blocks)
+{
+	__m128i keys[15];
+	size_t i;
+	int r, lane;
+
+	for (r = 0; r <= rounds; r++) {
+		keys[r] = _mm_loadu_si128 ((const __m128i *) (roundKeys + r * 16));
+	}
+	for (i = 0; i + AESHW_LANES <= blocks; i += AESHW_LANES) {
+		__m128i state[AESHW_LANES];
+		for (lane = 0; lane < AESHW_LANES; lane++) {
+			state[lane] = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (in + (i + lane) * 16)), keys[0]);
+		}
+		for (r = 1; r < rounds; r++) {
+			for (lane = 0; lane < AESHW_LANES; lane++) {
+				state[lane] = _mm_aesdec_si128 (state[lane], keys[r]);
+			}
+		}
+		for (lane = 0; lane < AESHW_LANES; lane++) {
+			_mm_storeu_si128 ((__m128i *) (out + (i + lane) * 16), _mm_aesdeclast_si128 (state[lane], keys[rounds]));
+		}
+	}
+	for (; i < blocks; i++) {
+		__m128i state = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *) (in + i * 16)), keys[0]);
+		for (r = 1; r < rounds; r++) {
+			state = _mm_aesdec_si128 (state, keys[r]);
+		}
+		_mm_storeu_si128 ((__m128i *) (out + i * 16), _mm_aesdeclast_si128 (state, keys[rounds]));
+	}
+}
+
+const char *
+AESHW_name ()
+{
+	return AESHW_available () ? "aes-ni" : "none";
+}
+
+#elif defined(AESHW_ARM)
+
+// AESE adds the round key before SubBytes and ShiftRows, so the last round key is added on its own
+void
+AESHW_encryptBlocks (const unsigned char *roundKeys, int rounds, const unsigned char *in, unsigned char *out,
+	size_t blocks)
+{
+	uint8x16_t keys[15];
+	size_t i;
+	int r;
+
+	for (r = 0; r <= rounds; r++) {
+		keys[r] = vld1q_u8 (roundKeys + r * 16);
+	}
+	for (i = 0; i < blocks; i++) {
+		uint8x16_t state = vld1q_u8 (in + i * 16);
+		for (r = 0; r < rounds - 1; r++) {
+			state = vaesmcq_u8 (vaeseq_u8 (state, keys[r]));
+		}
+		state = vaeseq_u8 (state, keys[rounds - 1]);
+		vst1q_u8 (out + i * 16, veorq_u8 (state, keys[rounds]));
+	}
+}
+
+void
+AESHW_decryptBlocks (const unsigned char *roundKeys, int rounds, const unsigned char *in, unsigned char *out,
+	size_t blocks)
+{
+	uint8x16_t keys[15];
+	size_t i;
+	int r;
+
+	for (r = 0; r <= rounds; r++) {
+		keys[r] = vld1q_u8 (roundKeys + r * 16);
+	}
+	for (i = 0; i < blocks; i++) {
+		uint8x16_t state = vld1q_u8 (in + i * 16);
+		for (r = 0; r < rounds - 1; r++) {
+			state = vaesimcq_u8 (vaesdq_u8 (state, keys[r]));
+		}
+		state = vaesdq_u8 (state, keys[rounds - 1]);
+		vst1q_u8 (out + i * 16, veorq_u8 (state, keys[rounds]));
+	}
+}
+
+const char *
+AESHW_name ()
+{
+	return AESHW_available () ? "armv8-crypto" : "none";
+}
+
+#else
+
+void
+AESHW_encryptBlocks (const unsigned char *, int, const unsigned char *, unsigned char *, size_t)
+{
+}
+
+void
+AESHW_decryptBlocks (const unsigned char *, int, const unsigned char *, unsigned char *, size_t)
+{
+}
+
+const char *
+AESHW_name ()
+{
+	return "none";
+}
+
+#endif
+
+int
+AESHW_available ()
+{
+#if defined(AESHW_X86) || defined(AESHW_ARM)
+	return CPU_hasAES ();
+#else
+	return 0;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,33 @@
+#ifndef _AES_HW_H_
+#define _AES_HW_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// AES with the instructions of the CPU: AES-NI on x86, the ARMv8 cryptography extension on ARM. These only
+// do 16 byte blocks, other Rijndael block sizes need the tables of Rijndael.cpp.
+//
+// The round keys are those of a key schedule, (rounds + 1) * 16 bytes with the bytes of each round key in
+// the order of the block. Decryption takes the schedule of the equivalent inverse cipher: the encryption
+// round keys in reverse order, InvMixColumns applied to all but the first and the last.
+
+// Whether the functions below can be used, see CPU_hasAES()
+int AESHW_available ();
+
+// "aes-ni", "armv8-crypto" or "none"
+const char *AESHW_name ();
+
+// Encrypt or decrypt 'blocks' blocks independently, as in ECB mode. 'in' and 'out' may be the same.
+void AESHW_encryptBlocks (const unsigned char *roundKeys, int rounds, const unsigned char *in, unsigned char *out,
+	size_t blocks);
+void AESHW_decryptBlocks (const unsigned char *roundKeys, int rounds, const unsigned char *in, unsigned char *out,
+	size_t blocks);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _AES_HW_H_ */
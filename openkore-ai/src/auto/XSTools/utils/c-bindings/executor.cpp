@@ -0,0 +1,97 @@
+/*  Shared native thread pool - C bindings
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "executor.h"
+#include "../../OSL/Threading/Executor.h"
+
+using namespace OSL;
+
+
+// The thread count o_executor_start(0) uses, 0 for one per processor
+static Atomic::Integer defaultThreads;
+
+class CallTask: public Task {
+public:
+	OExecutorFunc func;
+	void *arg;
+
+	virtual void run() {
+		func(arg);
+	}
+};
+
+O_DECL(unsigned int)
+o_executor_start(unsigned int threads) {
+	if (threads == 0) {
+		threads = (unsigned int) Atomic::load(defaultThreads);
+	}
+	return Executor::getInstance()->start(threads);
+}
+
+O_DECL(unsigned int)
+o_executor_resize(unsigned int threads) {
+	Executor *executor = Executor::getInstance();
+
+	Atomic::store(defaultThreads, (int) threads);
+	if (threads == 0) {
+		threads = Executor::getProcessorCount();
+	}
+	if (executor->getThreadCount() != threads) {
+		executor->stop();
+	}
+	return executor->start(threads);
+}
+
+O_DECL(void)
+o_executor_stop() {
+	Executor::getInstance()->stop();
+}
+
+O_DECL(unsigned int)
+o_executor_thread_count() {
+	return Executor::getInstance()->getThreadCount();
+}
+
+O_DECL(void)
+o_executor_parallel(OExecutorFunc func, void *arg, unsigned int count) {
+	Executor *executor = Executor::getInstance();
+	unsigned int threads = executor->getThreadCount();
+	CallTask *tasks;
+	unsigned int i;
+
+	// The pool's threads beside this one
+	if (count > threads + 1) {
+		count = threads + 1;
+	}
+	if (count <= 1) {
+		func(arg);
+		return;
+	}
+
+	tasks = new CallTask[count - 1];
+	for (i = 0; i < count - 1; i++) {
+		tasks[i].func = func;
+		tasks[i].arg = arg;
+		executor->submit(&tasks[i]);
+	}
+	func(arg);
+	for (i = 0; i < count - 1; i++) {
+		tasks[i].cancel();
+		tasks[i].wait();
+	}
+	delete[] tasks;
+}
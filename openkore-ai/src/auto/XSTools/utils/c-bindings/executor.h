@@ -0,0 +1,48 @@
+/*  Shared native thread pool - C bindings
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _O_EXECUTOR_H_
+#define _O_EXECUTOR_H_
+
+#include "common.h"
+
+/*
+ * The process wide OSL::Executor, which every part of XSTools that works
+ * in the background shares.
+ */
+
+typedef void (*OExecutorFunc)(void *arg);
+
+/* Starts the threads if they are not running, 0 for the count given to
+ * o_executor_resize() or else one per processor. Returns the number of threads. */
+O_DECL(unsigned int) o_executor_start       (unsigned int threads);
+
+/* Restarts the threads with another count, 0 for one per processor, after
+ * running the queued work. Returns the number of threads. */
+O_DECL(unsigned int) o_executor_resize      (unsigned int threads);
+
+O_DECL(void)         o_executor_stop        ();
+O_DECL(unsigned int) o_executor_thread_count();
+
+/* Calls func(arg) up to 'count' times at once, one of them in the calling
+ * thread; the calls which no thread took by the time that one returns are
+ * cancelled. For work which the calls share, each taking the next part. */
+O_DECL(void)         o_executor_parallel    (OExecutorFunc func,
+					     void *arg,
+					     unsigned int count);
+
+#endif /* _O_EXECUTOR_H_ */
@@ -92,6 +92,16 @@ o_http_reader_pull_data(OHttpReader *http, void *buf, unsigned int size) {
 	return http->obj->pullData(buf, size);
 }
 
+O_DECL(void)
+o_http_reader_set_streaming(OHttpReader *http) {
+	http->obj->setStreaming();
+}
+
+O_DECL(int)
+o_http_reader_pull_chunk(OHttpReader *http, char **chunk) {
+	return http->obj->pullChunk(*chunk);
+}
+
 O_DECL(const char *)
 o_http_reader_get_data(OHttpReader *http, unsigned int *len) {
 	unsigned int len2;
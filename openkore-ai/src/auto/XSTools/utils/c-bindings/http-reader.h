@@ -40,6 +40,9 @@ O_DECL(const char *)      o_http_reader_get_error (OHttpReader *http);
 O_DECL(int)               o_http_reader_pull_data (OHttpReader *http,
 						   void *buf,
 						   unsigned int size);
+O_DECL(void)              o_http_reader_set_streaming (OHttpReader *http);
+O_DECL(int)               o_http_reader_pull_chunk (OHttpReader *http,
+						    char **chunk);
 O_DECL(const char *)      o_http_reader_get_data  (OHttpReader *http,
 						   unsigned int *len);
 O_DECL(int)               o_http_reader_get_size  (OHttpReader *http);
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include "cpu-features.h"
+#if defined(SIMD_X86) && defined(_MSC_VER)
+	#include <intrin.h>
+#elif defined(SIMD_X86)
+	#include <cpuid.h>
+#elif defined(__aarch64__) && defined(__linux__)
+	#include <sys/auxv.h>
+	#include <asm/hwcap.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+static const char *const levelNames[] = { "scalar", "sse2", "avx2", "avx512" };
+
+#ifdef SIMD_X86
+static void
+cpuid (unsigned int leaf, unsigned int subleaf, unsigned int registers[4])
+{
+#ifdef _MSC_VER
+	int values[4];
+	__cpuidex (values, (int) leaf, (int) subleaf);
+	for (int i = 0; i < 4; i++) {
+		registers[i] = (unsigned int) values[i];
+	}
+#else
+	if (!__get_cpuid_count (leaf, subleaf, &registers[0], &registers[1], &registers[2], &registers[3])) {
+		registers[0] = registers[1] = registers[2] = registers[3] = 0;
+	}
+#endif
+}
+
+// The register states the OS saves on context switches, only valid if the CPU has OSXSAVE
+static unsigned long long
+enabledStates ()
+{
+#ifdef _MSC_VER
+	return _xgetbv (0);
+#else
+	unsigned int low, high;
+	__asm__ volatile ("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+	return ((unsigned long long) high << 32) | low;
+#endif
+}
+
+static int
+detectLevel ()
+{
+	unsigned int features[4];
+	unsigned int extended[4];
+	unsigned int maxLeaf;
+	unsigned long long states = 0;
+
+	cpuid (0, 0, features);
+	maxLeaf = features[0];
+	cpuid (1, 0, features);
+	if (!(features[3] & (1u << 26))) {
+		return SIMD_SCALAR;
+	}
+	// AVX2 and AVX-512 also need the OS to save the YMM and ZMM registers
+	if ((features[2] & (1u << 27)) && (features[2] & (1u << 28))) {
+		states = enabledStates ();
+	}
+	if (maxLeaf < 7 || (states & 0x6) != 0x6) {
+		return SIMD_SSE2;
+	}
+	cpuid (7, 0, extended);
+	if (!(extended[1] & (1u << 5))) {
+		return SIMD_SSE2;
+	}
+	if ((states & 0xE6) == 0xE6 && (extended[1] & (1u << 16)) && (extended[1] & (1u << 30))) {
+		return SIMD_AVX512;
+	}
+	return SIMD_AVX2;
+}
+
+static int
+detectAES ()
+{
+	unsigned int features[4];
+
+	cpuid (1, 0, features);
+	return (features[2] & (1u << 25)) != 0;
+}
+#else
+static int
+detectLevel ()
+{
+	return SIMD_SCALAR;
+}
+
+static int
+detectAES ()
+{
+#if defined(__aarch64__) && defined(__linux__)
+	return (getauxval (AT_HWCAP) & HWCAP_AES) != 0;
+#elif defined(__aarch64__) && defined(__APPLE__)
+	return 1;
+#else
+	return 0;
+#endif
+}
+#endif
+
+static int
+selectLevel ()
+{
+	int level = detectLevel ();
+	const char *forced = getenv ("OPENKORE_SIMD");
+
+	if (forced) {
+		for (int i = SIMD_SCALAR; i <= SIMD_AVX512; i++) {
+			if (strcmp (forced, levelNames[i]) == 0 && i < level) {
+				level = i;
+			}
+		}
+	}
+	return level;
+}
+
+int
+CPU_simdLevel ()
+{
+	static const int level = selectLevel ();
+	return level;
+}
+
+static int
+selectAES ()
+{
+	const char *forced = getenv ("OPENKORE_SIMD");
+	return detectAES () && !(forced && strcmp (forced, "scalar") == 0);
+}
+
+int
+CPU_hasAES ()
+{
+	static const int hasAES = selectAES ();
+	return hasAES;
+}
+
+const char *
+CPU_simdLevelName (int level)
+{
+	return (level >= SIMD_SCALAR && level <= SIMD_AVX512) ? levelNames[level] : "unknown";
+}
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
@@ -0,0 +1,49 @@
+#ifndef _CPU_FEATURES_H_
+#define _CPU_FEATURES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+// Run-time selection of the SIMD kernels of XSTools.
+// XSTools is built for the baseline of its platform, since the same library runs on any CPU, so the kernels
+// for newer instruction sets are compiled with one of the SIMD_TARGET attributes below, and each module picks
+// the implementations of its kernels by CPU_simdLevel() once, into function pointers, when XSTools is loaded.
+
+// Instruction sets the kernels are written for, each level includes the ones below
+#define SIMD_SCALAR 0
+#define SIMD_SSE2 1
+#define SIMD_AVX2 2
+#define SIMD_AVX512 3	// AVX-512 F and BW
+
+// Whether kernels for the levels above SIMD_SCALAR can be compiled at all
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	#define SIMD_X86 1
+	#define SIMD_TARGET_SSE2 __attribute__((target("sse2")))
+	#define SIMD_TARGET_AVX2 __attribute__((target("avx2")))
+	#define SIMD_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+	// MSVC compiles the intrinsics of any instruction set without options
+	#define SIMD_X86 1
+	#define SIMD_TARGET_SSE2
+	#define SIMD_TARGET_AVX2
+	#define SIMD_TARGET_AVX512
+#endif
+
+// The highest level the CPU and the OS support, lowered to the level named by the OPENKORE_SIMD environment
+// variable (scalar, sse2, avx2 or avx512) if it is set, to debug or compare the kernels. Determined on the
+// first call, which is thread safe.
+int CPU_simdLevel ();
+
+// "scalar", "sse2", "avx2" or "avx512"
+const char *CPU_simdLevelName (int level);
+
+// Whether the CPU has the AES instructions: AES-NI on x86, the ARMv8 cryptography extension on ARM. False if
+// OPENKORE_SIMD is "scalar".
+int CPU_hasAES ();
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* _CPU_FEATURES_H_ */
@@ -0,0 +1,557 @@
+/*  Asynchronous client for the AI engine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "engine-client.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifdef WIN32
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+	#include <windows.h>
+#else
+	#include <sys/types.h>
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+	#include <netinet/tcp.h>
+	#include <netdb.h>
+	#include <poll.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <errno.h>
+	#include <time.h>
+#endif
+
+#define RECEIVE_SIZE (16 * 1024)
+
+#ifdef WIN32
+	#define SOCKET_OF(fd) ((SOCKET) (fd))
+	#define closesocket_(fd) closesocket(SOCKET_OF(fd))
+	#define WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
+	#define INTERRUPTED() (WSAGetLastError() == WSAEINTR)
+#else
+	#define SOCKET_OF(fd) ((int) (fd))
+	#define closesocket_(fd) close(SOCKET_OF(fd))
+	#define WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINPROGRESS)
+	#define INTERRUPTED() (errno == EINTR)
+	#ifndef MSG_NOSIGNAL
+		#define MSG_NOSIGNAL 0
+	#endif
+#endif
+
+
+namespace OpenKore {
+
+	namespace {
+		unsigned long
+		now() {
+		#ifdef WIN32
+			return GetTickCount();
+		#else
+			struct timespec ts;
+			clock_gettime(CLOCK_MONOTONIC, &ts);
+			return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+		#endif
+		}
+
+		std::string
+		socketError(const char *what) {
+			char message[256];
+		#ifdef WIN32
+			snprintf(message, sizeof(message), "%s: error %d", what, WSAGetLastError());
+		#else
+			snprintf(message, sizeof(message), "%s: %s", what, strerror(errno));
+		#endif
+			return message;
+		}
+
+		std::string
+		lowercase(const std::string &str) {
+			std::string result(str);
+			for (size_t i = 0; i < result.size(); i++) {
+				result[i] = tolower((unsigned char) result[i]);
+			}
+			return result;
+		}
+	}
+
+
+	EngineClient::EngineClient(const char *host, unsigned short port, unsigned int timeout)
+		: host(host), port(port), timeout(timeout)
+	{
+	#ifdef WIN32
+		WSADATA data;
+		WSAStartup(MAKEWORD(2, 2), &data);
+	#endif
+		fd = 0;
+		state = DISCONNECTED;
+		reused = false;
+		status = ENGINE_CLIENT_IDLE;
+		startTime = 0;
+		retried = false;
+		requestPos = 0;
+		bodyStart = 0;
+		contentLength = -1;
+		chunked = false;
+		chunkPos = 0;
+		closeAfter = false;
+		responseCode = 0;
+	}
+
+	EngineClient::~EngineClient() {
+		disconnect();
+	#ifdef WIN32
+		WSACleanup();
+	#endif
+	}
+
+	bool
+	EngineClient::post(const char *path, const char *data, unsigned int len, const char *contentType) {
+		char header[64];
+
+		if (status == ENGINE_CLIENT_PENDING) {
+			return false;
+		}
+		reset();
+
+		request.clear();
+		request.reserve(len + 256);
+		request += "POST ";
+		request += path;
+		request += " HTTP/1.1\r\nHost: ";
+		request += host;
+		snprintf(header, sizeof(header), ":%u\r\nContent-Length: %u\r\n", (unsigned int) port, len);
+		request += header;
+		request += "Content-Type: ";
+		request += contentType;
+		request += "\r\nUser-Agent: OpenKore\r\nConnection: keep-alive\r\n\r\n";
+		request.append(data, len);
+		requestPos = 0;
+
+		status = ENGINE_CLIENT_PENDING;
+		startTime = now();
+		retried = false;
+		if (state == DISCONNECTED && connect() < 0) {
+			fail();
+			return true;
+		}
+		poll();
+		return true;
+	}
+
+	EngineClientStatus
+	EngineClient::poll() {
+		bool eof = false;
+		int result;
+
+		if (status != ENGINE_CLIENT_PENDING) {
+			return status;
+		}
+		if (now() - startTime > timeout) {
+			error = "Timed out";
+			return fail();
+		}
+
+		while (true) {
+			if (state == CONNECTING) {
+				result = finishConnect();
+				if (result < 0) {
+					return fail();
+				} else if (result == 0) {
+					return status;
+				}
+			}
+
+			if (requestPos < request.size()) {
+				result = sendRequest();
+				if (result < 0) {
+					if (retry()) {
+						continue;
+					}
+					return fail();
+				} else if (result == 0) {
+					return status;
+				}
+			}
+
+			if (receive(eof) < 0) {
+				if (retry()) {
+					continue;
+				}
+				return fail();
+			}
+			if (eof && input.empty() && retry()) {
+				// A kept-alive connection which the server had closed
+				continue;
+			}
+			break;
+		}
+
+		if (bodyStart == 0) {
+			result = parseHeaders();
+			if (result < 0) {
+				return fail();
+			} else if (result == 0) {
+				if (eof) {
+					error = "Connection closed before the response was received";
+					return fail();
+				}
+				return status;
+			}
+		}
+
+		if (chunked) {
+			result = parseChunks();
+			if (result < 0) {
+				return fail();
+			} else if (result > 0) {
+				return finish();
+			}
+		} else if (contentLength >= 0) {
+			if (input.size() - bodyStart >= (size_t) contentLength) {
+				body.assign(input, bodyStart, contentLength);
+				return finish();
+			}
+		} else if (eof) {
+			body.assign(input, bodyStart, std::string::npos);
+			return finish();
+		}
+
+		if (eof) {
+			error = "Connection closed before the response was received";
+			return fail();
+		}
+		return status;
+	}
+
+	EngineClientStatus
+	EngineClient::getStatus() const {
+		return status;
+	}
+
+	int
+	EngineClient::getResponseCode() const {
+		return responseCode;
+	}
+
+	const std::string &
+	EngineClient::getResponseBody() const {
+		return body;
+	}
+
+	const char *
+	EngineClient::getError() const {
+		return error.c_str();
+	}
+
+	void
+	EngineClient::reset() {
+		status = ENGINE_CLIENT_IDLE;
+		error.clear();
+		input.clear();
+		bodyStart = 0;
+		contentLength = -1;
+		chunked = false;
+		chunkPos = 0;
+		closeAfter = false;
+		responseCode = 0;
+		body.clear();
+	}
+
+	bool
+	EngineClient::isConnected() const {
+		return state == CONNECTED;
+	}
+
+	int
+	EngineClient::connect() {
+		struct addrinfo hints, *addresses;
+		char service[8];
+		int result;
+
+		memset(&hints, 0, sizeof(hints));
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		snprintf(service, sizeof(service), "%u", (unsigned int) port);
+		if (getaddrinfo(host.c_str(), service, &hints, &addresses) != 0 || addresses == NULL) {
+			error = "Cannot resolve " + host;
+			return -1;
+		}
+
+	#ifdef WIN32
+		SOCKET sock = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+		if (sock == INVALID_SOCKET) {
+			error = socketError("Cannot create socket");
+			freeaddrinfo(addresses);
+			return -1;
+		}
+		u_long nonblocking = 1;
+		ioctlsocket(sock, FIONBIO, &nonblocking);
+	#else
+		int sock = socket(addresses->ai_family, addresses->ai_socktype, addresses->ai_protocol);
+		if (sock == -1) {
+			error = socketError("Cannot create socket");
+			freeaddrinfo(addresses);
+			return -1;
+		}
+		fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+		fcntl(sock, F_SETFD, FD_CLOEXEC);
+	#endif
+
+		// Requests are small and answered one at a time
+		int nodelay = 1;
+		setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *) &nodelay, sizeof(nodelay));
+
+		fd = (size_t) sock;
+		reused = false;
+		result = ::connect(sock, addresses->ai_addr, addresses->ai_addrlen);
+		freeaddrinfo(addresses);
+		if (result == 0) {
+			state = CONNECTED;
+			return 1;
+		} else if (WOULD_BLOCK()) {
+			state = CONNECTING;
+			return 0;
+		} else {
+			error = socketError("Cannot connect");
+			closesocket_(fd);
+			state = DISCONNECTED;
+			return -1;
+		}
+	}
+
+	int
+	EngineClient::finishConnect() {
+		int err = 0;
+		socklen_t len = sizeof(err);
+
+	#ifdef WIN32
+		fd_set writefds, exceptfds;
+		struct timeval tv = { 0, 0 };
+
+		FD_ZERO(&writefds);
+		FD_ZERO(&exceptfds);
+		FD_SET(SOCKET_OF(fd), &writefds);
+		FD_SET(SOCKET_OF(fd), &exceptfds);
+		if (select(0, NULL, &writefds, &exceptfds, &tv) <= 0) {
+			return 0;
+		}
+	#else
+		struct pollfd pfd;
+
+		pfd.fd = SOCKET_OF(fd);
+		pfd.events = POLLOUT;
+		pfd.revents = 0;
+		if (::poll(&pfd, 1, 0) <= 0) {
+			return 0;
+		}
+	#endif
+
+		if (getsockopt(SOCKET_OF(fd), SOL_SOCKET, SO_ERROR, (char *) &err, &len) != 0 || err != 0) {
+			char message[256];
+		#ifdef WIN32
+			snprintf(message, sizeof(message), "Cannot connect: error %d", err);
+		#else
+			snprintf(message, sizeof(message), "Cannot connect: %s", strerror(err));
+		#endif
+			error = message;
+			disconnect();
+			return -1;
+		}
+		state = CONNECTED;
+		return 1;
+	}
+
+	int
+	EngineClient::sendRequest() {
+		while (requestPos < request.size()) {
+		#ifdef WIN32
+			int sent = send(SOCKET_OF(fd), request.data() + requestPos, request.size() - requestPos, 0);
+		#else
+			ssize_t sent = send(SOCKET_OF(fd), request.data() + requestPos, request.size() - requestPos, MSG_NOSIGNAL);
+		#endif
+			if (sent > 0) {
+				requestPos += sent;
+			} else if (INTERRUPTED()) {
+				continue;
+			} else if (WOULD_BLOCK()) {
+				return 0;
+			} else {
+				error = socketError("Cannot send request");
+				return -1;
+			}
+		}
+		return 1;
+	}
+
+	int
+	EngineClient::receive(bool &eof) {
+		char buf[RECEIVE_SIZE];
+
+		eof = false;
+		while (true) {
+		#ifdef WIN32
+			int received = recv(SOCKET_OF(fd), buf, sizeof(buf), 0);
+		#else
+			ssize_t received = recv(SOCKET_OF(fd), buf, sizeof(buf), 0);
+		#endif
+			if (received > 0) {
+				input.append(buf, received);
+			} else if (received == 0) {
+				eof = true;
+				return 1;
+			} else if (INTERRUPTED()) {
+				continue;
+			} else if (WOULD_BLOCK()) {
+				return 1;
+			} else {
+				error = socketError("Cannot receive response");
+				return -1;
+			}
+		}
+	}
+
+	int
+	EngineClient::parseHeaders() {
+		size_t end, pos;
+		int major, minor;
+
+		end = input.find("\r\n\r\n");
+		if (end == std::string::npos) {
+			return 0;
+		}
+
+		if (sscanf(input.c_str(), "HTTP/%d.%d %d", &major, &minor, &responseCode) != 3) {
+			error = "Invalid response from server";
+			return -1;
+		}
+		closeAfter = (major == 1 && minor == 0);
+
+		pos = input.find("\r\n") + 2;
+		while (pos < end) {
+			size_t lineEnd = input.find("\r\n", pos);
+			size_t colon = input.find(':', pos);
+
+			if (colon != std::string::npos && colon < lineEnd) {
+				std::string name = lowercase(input.substr(pos, colon - pos));
+				size_t valueStart = input.find_first_not_of(" \t", colon + 1);
+				std::string value = (valueStart < lineEnd)
+					? lowercase(input.substr(valueStart, lineEnd - valueStart))
+					: std::string();
+
+				if (name == "content-length") {
+					contentLength = strtol(value.c_str(), NULL, 10);
+				} else if (name == "transfer-encoding") {
+					chunked = value.find("chunked") != std::string::npos;
+				} else if (name == "connection") {
+					if (value.find("close") != std::string::npos) {
+						closeAfter = true;
+					} else if (value.find("keep-alive") != std::string::npos) {
+						closeAfter = false;
+					}
+				}
+			}
+			pos = lineEnd + 2;
+		}
+
+		bodyStart = end + 4;
+		chunkPos = bodyStart;
+		if (responseCode == 204 || responseCode == 304 || (responseCode >= 100 && responseCode < 200)) {
+			contentLength = 0;
+			chunked = false;
+		}
+		return 1;
+	}
+
+	int
+	EngineClient::parseChunks() {
+		while (true) {
+			size_t lineEnd = input.find("\r\n", chunkPos);
+			unsigned long size;
+			char *end;
+
+			if (lineEnd == std::string::npos) {
+				return 0;
+			}
+			size = strtoul(input.c_str() + chunkPos, &end, 16);
+			if (end == input.c_str() + chunkPos) {
+				error = "Invalid chunk in response";
+				return -1;
+			}
+
+			if (size == 0) {
+				// The last chunk, followed by optional trailers and an empty line
+				if (input.compare(lineEnd, 4, "\r\n\r\n") == 0
+				 || input.find("\r\n\r\n", lineEnd) != std::string::npos) {
+					return 1;
+				}
+				return 0;
+			}
+			if (input.size() < lineEnd + 2 + size + 2) {
+				return 0;
+			}
+			body.append(input, lineEnd + 2, size);
+			chunkPos = lineEnd + 2 + size + 2;
+		}
+	}
+
+	void
+	EngineClient::disconnect() {
+		if (state != DISCONNECTED) {
+			closesocket_(fd);
+			state = DISCONNECTED;
+		}
+	}
+
+	/*
+	 * A kept-alive connection may have been closed by the server while
+	 * it was idle. In that case, send the request again on a new one,
+	 * but only once, and only if nothing was received yet.
+	 */
+	bool
+	EngineClient::retry() {
+		if (!reused || retried || !input.empty()) {
+			return false;
+		}
+		disconnect();
+		retried = true;
+		requestPos = 0;
+		error.clear();
+		return connect() >= 0;
+	}
+
+	EngineClientStatus
+	EngineClient::fail() {
+		disconnect();
+		status = ENGINE_CLIENT_ERROR;
+		return status;
+	}
+
+	EngineClientStatus
+	EngineClient::finish() {
+		if (closeAfter || (!chunked && contentLength < 0)) {
+			disconnect();
+		} else {
+			reused = true;
+		}
+		input.clear();
+		status = ENGINE_CLIENT_DONE;
+		return status;
+	}
+
+}
@@ -0,0 +1,189 @@
+/* -*-c++-*- */
+/*  Asynchronous client for the AI engine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+#ifndef _ENGINE_CLIENT_H_
+#define _ENGINE_CLIENT_H_
+
+#include <stddef.h>
+#include <string>
+
+namespace OpenKore {
+
+	/**
+	 * Status codes for EngineClient.
+	 */
+	enum EngineClientStatus {
+		/** No request is in flight. post() may be called. */
+		ENGINE_CLIENT_IDLE,
+
+		/**
+		 * A request is being sent, or its response received. The
+		 * status can become: ENGINE_CLIENT_DONE or ENGINE_CLIENT_ERROR.
+		 */
+		ENGINE_CLIENT_PENDING,
+
+		/** The response has been received. */
+		ENGINE_CLIENT_DONE,
+
+		/** The request failed. */
+		ENGINE_CLIENT_ERROR
+	};
+
+	/**
+	 * A non-blocking HTTP/1.1 client which keeps one connection to
+	 * the AI engine (or the AI service) open across requests.
+	 *
+	 * Unlike HttpReader, EngineClient has no background thread: its
+	 * socket is non-blocking, and every call to poll() sends and
+	 * receives whatever the socket takes without waiting. So a bot can
+	 * post a request during one AI iteration, and pick the response up
+	 * during a later one, without ever blocking its main loop.
+	 *
+	 * One request can be in flight at a time. When the response is
+	 * done, or the request failed, the status stays DONE or ERROR until
+	 * reset() is called, or the next request is posted.
+	 *
+	 * EngineClient is not thread-safe.
+	 */
+	class EngineClient {
+	public:
+		/**
+		 * Create a new EngineClient. It connects when the first
+		 * request is posted.
+		 *
+		 * @param host     The host name or address of the server.
+		 * @param port     The port of the server.
+		 * @param timeout  How long a request may take, in milliseconds.
+		 * @require host != NULL
+		 */
+		EngineClient(const char *host, unsigned short port, unsigned int timeout = 10000);
+		~EngineClient();
+
+		/**
+		 * Start posting a request. It is sent as far as the socket
+		 * takes it right away; call poll() for the rest.
+		 *
+		 * @param path         The request path, like "/api/v1/decide".
+		 * @param body         The body of the request.
+		 * @param len          The size of body, in bytes.
+		 * @param contentType  The Content-Type of the body.
+		 * @return Whether the request was started; false if another
+		 *         request is still pending.
+		 * @require path != NULL && body != NULL
+		 */
+		bool post(const char *path, const char *body, unsigned int len,
+			  const char *contentType = "application/json");
+
+		/**
+		 * Send and receive whatever can be sent and received without
+		 * blocking, and return the resulting status.
+		 */
+		EngineClientStatus poll();
+
+		/** Retrieve the status, without doing any I/O. */
+		EngineClientStatus getStatus() const;
+
+		/**
+		 * Retrieve the HTTP status code of the response.
+		 *
+		 * @require getStatus() == ENGINE_CLIENT_DONE
+		 */
+		int getResponseCode() const;
+
+		/**
+		 * Retrieve the body of the response.
+		 *
+		 * @require getStatus() == ENGINE_CLIENT_DONE
+		 */
+		const std::string &getResponseBody() const;
+
+		/**
+		 * Retrieve the error message.
+		 *
+		 * @require getStatus() == ENGINE_CLIENT_ERROR
+		 * @ensure result != NULL
+		 */
+		const char *getError() const;
+
+		/**
+		 * Forget the last response or error, so that getStatus()
+		 * returns ENGINE_CLIENT_IDLE. The connection is kept.
+		 *
+		 * @require getStatus() != ENGINE_CLIENT_PENDING
+		 */
+		void reset();
+
+		/** Whether a connection to the server is open. */
+		bool isConnected() const;
+
+	private:
+		enum ConnectionState {
+			DISCONNECTED,
+			CONNECTING,
+			CONNECTED
+		};
+
+		std::string host;
+		unsigned short port;
+		unsigned int timeout;
+
+		/** The socket; only valid while state != DISCONNECTED. */
+		size_t fd;
+		ConnectionState state;
+		/** Whether a response was received on this connection already. */
+		bool reused;
+
+		EngineClientStatus status;
+		std::string error;
+		unsigned long startTime;
+		/** Whether the request was sent again on a new connection. */
+		bool retried;
+
+		std::string request;
+		size_t requestPos;
+
+		std::string input;
+		/** The offset of the body in input, or 0 while the headers are incomplete. */
+		size_t bodyStart;
+		/** The body size, or -1 if the body ends with the connection. */
+		long contentLength;
+		bool chunked;
+		/** With chunked, the offset in input of the next chunk which isn't in body yet. */
+		size_t chunkPos;
+		bool closeAfter;
+
+		int responseCode;
+		std::string body;
+
+		// These return 1 when done, 0 if they have to be called
+		// again later, or -1 on error, after setting error.
+		int connect();
+		int finishConnect();
+		int sendRequest();
+		int receive(bool &eof);
+		int parseHeaders();
+		int parseChunks();
+
+		void disconnect();
+		bool retry();
+		EngineClientStatus fail();
+		EngineClientStatus finish();
+	};
+
+}
+
+#endif /* _ENGINE_CLIENT_H_ */
@@ -21,6 +21,8 @@
 namespace OpenKore {
 
 	const char *const HttpReader::DEFAULT_USER_AGENT = "OpenKore HttpReader";
+	const unsigned int HttpReader::CHUNK_SIZE;
+	const unsigned int HttpReader::STREAM_CHUNKS;
 
 	HttpReader::~HttpReader() {
 	}
@@ -59,6 +59,10 @@ namespace OpenKore {
 	 * Once getStatus() returns HTTP_READER_DOWNLOADING, users can
 	 * use pullData() to retrieve data from the download buffer.
 	 *
+	 * By default the download buffer holds the whole file. Large
+	 * downloads should call setStreaming() instead, and then pull the
+	 * data in chunks with pullChunk().
+	 *
 	 * A HttpReader can only be used once. You must construct a new
 	 * HttpReader if you want to download more than once.
 	 */
@@ -69,6 +73,18 @@ namespace OpenKore {
 		 */
 		static const char *const DEFAULT_USER_AGENT;
 
+		/**
+		 * The size of the chunks which pullChunk() returns, except the
+		 * last one, which may be smaller.
+		 */
+		static const unsigned int CHUNK_SIZE = 16 * 1024;
+
+		/**
+		 * The number of chunks which are kept in streaming mode before
+		 * downloading pauses until some are pulled.
+		 */
+		static const unsigned int STREAM_CHUNKS = 16;
+
 		virtual ~HttpReader() = 0;
 
 		/**
@@ -113,6 +129,43 @@ namespace OpenKore {
 		 */
 		virtual int pullData(void *buf, unsigned int size) = 0;
 
+		/**
+		 * Switch to streaming mode. Instead of growing with the file,
+		 * the download buffer becomes a queue of at most STREAM_CHUNKS
+		 * chunks, which the background thread fills without locking,
+		 * and downloading pauses while the queue is full. Use
+		 * pullChunk() to take the chunks without copying them;
+		 * pullData() still works too.
+		 *
+		 * Data which was downloaded before this call is not lost.
+		 * Calling it more than once has no effect.
+		 *
+		 * @require getData() is not used.
+		 */
+		virtual void setStreaming() = 0;
+
+		/**
+		 * Take the next chunk of downloaded data in streaming mode.
+		 * This is what pullData() does, without copying the data.
+		 *
+		 * Only one thread at a time may pull data.
+		 *
+		 * @param chunk  [out] Set to the chunk if result > 0. It was
+		 *               allocated with malloc() and it is followed by
+		 *               a NULL byte; the caller owns it and must free()
+		 *               it.
+		 * @return The size of the chunk, 0 on end-of-file, -1 if no
+		 *         chunk is available yet (you should call this method
+		 *         again later), or -2 if an error occured.
+		 * @require
+		 *     setStreaming() was called.
+		 *     getStatus() != HTTP_READER_CONNECTING
+		 * @ensure
+		 *     if result > 0: result <= CHUNK_SIZE
+		 *     if result == -2: getStatus() == HTTP_READER_ERROR
+		 */
+		virtual int pullChunk(char *&chunk) = 0;
+
 		/**
 		 * Returns the full content of the internal download buffer.
 		 * In other words: return the contents of the downloaded file.
@@ -120,7 +173,8 @@ namespace OpenKore {
 		 * This function may only be called if the download is finished.
 		 * If you want to do incremental downloading, use pullData()
 		 * instead. However, you must not mix this function with
-		 * pullData(), or bad things will happen.
+		 * pullData(), or use it in streaming mode, or bad things will
+		 * happen.
 		 *
 		 * @param len  The length of the downloaded file, in bytes, will
 		 *             be put in this variable.
@@ -18,9 +18,15 @@
 
 #include "mirror-http-reader.h"
 #include "std-http-reader.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
 
 // Platform abstraction layer.
 #ifdef WIN32
@@ -34,6 +40,178 @@ using namespace std;
 
 namespace OpenKore {
 
+	/**
+	 * How long the servers took to answer, shared by all
+	 * MirrorHttpReaders. Servers are told apart by the scheme,
+	 * host and port of their URLs.
+	 */
+	class _MirrorLatencies {
+	private:
+		struct Entry {
+			/** Smoothed time to answer, in miliseconds. 0 if it never answered. */
+			unsigned int latency;
+			/** Failures since it last answered. */
+			unsigned int failures;
+		};
+
+		/** Servers not tried yet come after those known to answer this fast. */
+		static const unsigned int UNKNOWN_LATENCY = 1000;
+		/** Servers which failed the last time come after all others. */
+		static const unsigned int FAILED_LATENCY = 60000;
+
+		Mutex mutex;
+		map<string, Entry> entries;
+		/** Empty unless setLatencyFile() was called. */
+		string file;
+
+		static string
+		serverOf(const char *url) {
+			const char *start = strstr(url, "://");
+			start = (start == NULL) ? url : start + 3;
+			const char *end = start + strcspn(start, "/?#");
+			return string(url, end - url);
+		}
+
+		/** @require mutex is locked. */
+		void
+		save() {
+			if (file.empty()) {
+				return;
+			}
+			FILE *f = fopen(file.c_str(), "w");
+			if (f == NULL) {
+				return;
+			}
+			map<string, Entry>::const_iterator it;
+			for (it = entries.begin(); it != entries.end(); it++) {
+				fprintf(f, "%s %u %u\n", it->first.c_str(), it->second.latency, it->second.failures);
+			}
+			fclose(f);
+		}
+
+	public:
+		_MirrorLatencies() {
+			NewMutex(mutex);
+		}
+
+		bool
+		setFile(const char *filename) {
+			bool ok = true;
+
+			LockMutex(mutex);
+			file = (filename == NULL) ? "" : filename;
+			FILE *f = file.empty() ? NULL : fopen(file.c_str(), "r");
+			if (f != NULL) {
+				char server[1024];
+				unsigned int latency, failures;
+				int fields;
+
+				while ((fields = fscanf(f, "%1023s %u %u", server, &latency, &failures)) == 3) {
+					Entry &entry = entries[server];
+					entry.latency = latency;
+					entry.failures = failures;
+				}
+				ok = fields == EOF;
+				fclose(f);
+			}
+			UnlockMutex(mutex);
+			return ok;
+		}
+
+		int
+		latencyOf(const char *url) {
+			int result = -1;
+
+			LockMutex(mutex);
+			map<string, Entry>::const_iterator it = entries.find(serverOf(url));
+			if (it != entries.end() && it->second.failures == 0 && it->second.latency > 0) {
+				result = it->second.latency;
+			}
+			UnlockMutex(mutex);
+			return result;
+		}
+
+		/**
+		 * Order URLs by the latency of their servers, fastest first.
+		 * URLs of servers with the same latency keep their order.
+		 */
+		void
+		sort(list<char *> &urls) {
+			vector< pair<unsigned int, char *> > ranked;
+			list<char *>::iterator it;
+
+			LockMutex(mutex);
+			for (it = urls.begin(); it != urls.end(); it++) {
+				map<string, Entry>::const_iterator entry = entries.find(serverOf(*it));
+				unsigned int rank;
+
+				if (entry == entries.end()) {
+					rank = UNKNOWN_LATENCY;
+				} else if (entry->second.failures > 0) {
+					rank = FAILED_LATENCY + entry->second.latency;
+				} else {
+					rank = entry->second.latency;
+				}
+				ranked.push_back(make_pair(rank, *it));
+			}
+			UnlockMutex(mutex);
+
+			stable_sort(ranked.begin(), ranked.end(), compareRanks);
+			urls.clear();
+			for (unsigned int i = 0; i < ranked.size(); i++) {
+				urls.push_back(ranked[i].second);
+			}
+		}
+
+		static bool
+		compareRanks(const pair<unsigned int, char *> &a, const pair<unsigned int, char *> &b) {
+			return a.first < b.first;
+		}
+
+		/**
+		 * Remember that the server of a URL answered after 'latency'
+		 * miliseconds. With 'atLeast', it hadn't answered yet when
+		 * it was cancelled, so its latency is at least that much.
+		 */
+		void
+		answered(const char *url, unsigned int latency, bool atLeast) {
+			LockMutex(mutex);
+			Entry &entry = entries[serverOf(url)];
+			if (latency == 0) {
+				latency = 1;
+			}
+			if (atLeast && entry.latency >= latency) {
+				// Nothing new
+			} else if (entry.latency == 0 || entry.failures > 0) {
+				entry.latency = latency;
+			} else {
+				entry.latency = (entry.latency * 3 + latency) / 4;
+			}
+			if (!atLeast) {
+				entry.failures = 0;
+			}
+			UnlockMutex(mutex);
+		}
+
+		void
+		failed(const char *url) {
+			LockMutex(mutex);
+			entries[serverOf(url)].failures++;
+			UnlockMutex(mutex);
+		}
+
+		/** Write the latencies to the file, if there is one. */
+		void
+		flush() {
+			LockMutex(mutex);
+			save();
+			UnlockMutex(mutex);
+		}
+	};
+
+	static _MirrorLatencies latencies;
+
+
 	/**
 	 * A private class which implements the threading details.
 	 * This class is used to hide the dependency on
@@ -47,51 +225,108 @@ namespace OpenKore {
 		Mutex mutex;
 		bool stop;
 
+		/** A mirror being tried. */
+		struct Attempt {
+			HttpReader *http;
+			char *url;
+			DWORD beginTime;
+		};
+
+		static void
+		cancel(list<Attempt> &attempts, DWORD now, bool remember) {
+			list<Attempt>::iterator it;
+			for (it = attempts.begin(); it != attempts.end(); it++) {
+				if (remember) {
+					latencies.answered(it->url, now - it->beginTime, true);
+				}
+				delete it->http;
+				free(it->url);
+			}
+			attempts.clear();
+		}
+
 		static ThreadValue ThreadCallConvention threadEntry(void *arg) {
 			_MirrorHttpReaderPrivate *priv = (_MirrorHttpReaderPrivate *) arg;
 			MirrorHttpReader *self = priv->parent;
 
-			HttpReader *http;
-			bool found = false;
 			list<char *> &urls = self->urls;
+			list<Attempt> attempts;
+			Attempt winner = { NULL, NULL, 0 };
+			bool found = false;
+			DWORD lastStart = 0;
+			bool startNow = true;
+
+			// Race the mirrors until one answers.
+			while (!found && !priv->stop && (!urls.empty() || !attempts.empty())) {
+				DWORD now = GetTickCount();
+
+				if (!urls.empty() && attempts.size() < self->raceWidth
+				 && (startNow || now - lastStart >= MirrorHttpReader::RACE_DELAY)) {
+					Attempt attempt;
+					attempt.url = urls.front();
+					attempt.http = StdHttpReader::create(attempt.url, self->userAgent);
+					attempt.beginTime = now;
+					urls.pop_front();
+					attempts.push_back(attempt);
+					lastStart = now;
+					startNow = false;
+				}
 
-			// Find a mirror to use.
-			while (!urls.empty() && !found) {
-				DWORD beginTime;
-				bool timeout = false;
+				list<Attempt>::iterator it = attempts.begin();
+				while (it != attempts.end() && !found) {
+					HttpReaderStatus status = it->http->getStatus();
+					bool timeout = self->timeout != 0 && now - it->beginTime >= self->timeout;
+
+					if (status == HTTP_READER_ERROR || (status == HTTP_READER_CONNECTING && timeout)) {
+						// Failed; the next mirror takes its place.
+						latencies.failed(it->url);
+						delete it->http;
+						free(it->url);
+						it = attempts.erase(it);
+						startNow = true;
+					} else if (status != HTTP_READER_CONNECTING) {
+						winner = *it;
+						attempts.erase(it);
+						found = true;
+					} else {
+						it++;
+					}
+				}
 
-				http = StdHttpReader::create(urls.front(),
-							     self->userAgent);
-				beginTime = GetTickCount();
-				while (http->getStatus() == HTTP_READER_CONNECTING
-				    && !priv->stop && !timeout) {
+				if (!found && !priv->stop) {
 					Sleep(10);
-					timeout = self->timeout != 0 && GetTickCount() >= beginTime + self->timeout;
 				}
+			}
 
-				if (priv->stop) {
-					delete http;
-					return 0;
-				} else if (http->getStatus() == HTTP_READER_ERROR || timeout) {
-					// Failed; try next mirror.
-					delete http;
-					free(urls.front());
-					urls.pop_front();
-				} else {
-					// Connected; use this mirror for downloading.
-					found = true;
-					priv->lock();
-					self->http = http;
-					priv->unlock();
+			if (priv->stop) {
+				cancel(attempts, GetTickCount(), false);
+				if (found) {
+					delete winner.http;
+					free(winner.url);
 				}
+				return THREAD_DEFAULT_RETURN_VALUE;
 			}
 
-			if (!found) {
+			if (found) {
+				// The others lost the race.
+				DWORD now = GetTickCount();
+				latencies.answered(winner.url, now - winner.beginTime, false);
+				cancel(attempts, now, true);
+				free(winner.url);
+
+				priv->lock();
+				if (self->streaming) {
+					winner.http->setStreaming();
+				}
+				self->http = winner.http;
+				priv->unlock();
+			} else {
 				priv->lock();
 				self->status = HTTP_READER_ERROR;
 				self->error = "Unable to connect to any mirror.";
 				priv->unlock();
 			}
+			latencies.flush();
 
 			return THREAD_DEFAULT_RETURN_VALUE;
 		}
@@ -125,20 +360,24 @@ namespace OpenKore {
 	 *****************************/
 
 	MirrorHttpReader::MirrorHttpReader(const list<const char *> &urls,
-			unsigned int timeout, const char *userAgent) {
+			unsigned int timeout, const char *userAgent, unsigned int raceWidth) {
 		assert(!urls.empty());
+		assert(raceWidth >= 1);
 
-		// Create a private copy of the URLs.
+		// Create a private copy of the URLs, fastest mirrors first.
 		list<const char *>::const_iterator it;
 		for (it = urls.begin(); it != urls.end(); it++) {
 			this->urls.push_back(strdup(*it));
 		}
+		latencies.sort(this->urls);
 
 		this->timeout = timeout;
+		this->raceWidth = raceWidth;
 		this->userAgent = strdup(userAgent);
 		status = HTTP_READER_CONNECTING;
 		error = NULL;
 		http = NULL;
+		streaming = false;
 		priv = new _MirrorHttpReaderPrivate(this);
 	}
 
@@ -156,6 +395,16 @@ namespace OpenKore {
 		}
 	}
 
+	bool
+	MirrorHttpReader::setLatencyFile(const char *file) {
+		return latencies.setFile(file);
+	}
+
+	int
+	MirrorHttpReader::getLatency(const char *url) {
+		return latencies.latencyOf(url);
+	}
+
 	HttpReaderStatus
 	MirrorHttpReader::getStatus() const {
 		HttpReaderStatus result;
@@ -204,6 +453,32 @@ namespace OpenKore {
 		return result;
 	}
 
+	void
+	MirrorHttpReader::setStreaming() {
+		priv->lock();
+		streaming = true;
+		if (http != NULL) {
+			http->setStreaming();
+		}
+		priv->unlock();
+	}
+
+	int
+	MirrorHttpReader::pullChunk(char *&chunk) {
+		assert(getStatus() != HTTP_READER_CONNECTING);
+		int result;
+
+		priv->lock();
+		if (http != NULL) {
+			result = http->pullChunk(chunk);
+		} else {
+			assert(status == HTTP_READER_ERROR);
+			result = -2;
+		}
+		priv->unlock();
+		return result;
+	}
+
 	const char *
 	MirrorHttpReader::getData(unsigned int &len) const {
 		assert(getStatus() == HTTP_READER_DONE);
@@ -27,16 +27,35 @@ namespace OpenKore {
 	class _MirrorHttpReaderPrivate;
 
 	/**
-	 * A HttpReader which accepts a list of mirrors. If
-	 * it fails to download from the first server, it will
-	 * try the next one, until there are no more mirrors to
-	 * try.
+	 * A HttpReader which accepts a list of mirrors, and downloads
+	 * from the first one which answers.
+	 *
+	 * Mirrors are raced like happy eyeballs do with addresses: the
+	 * first one is tried at once, and while none has answered, one
+	 * more is started every RACE_DELAY miliseconds, up to raceWidth
+	 * at a time. A mirror which fails or times out makes room for the
+	 * next one at once. The first to answer is kept for the download,
+	 * the others are cancelled.
+	 *
+	 * How long each server took to answer is remembered by all
+	 * MirrorHttpReaders of the process, and across runs with
+	 * setLatencyFile(). The mirrors are tried fastest first, so a slow
+	 * or dead mirror which is first in the list doesn't delay every
+	 * download.
 	 */
 	class MirrorHttpReader: public HttpReader {
+	public:
+		/** By default, at most this many mirrors are tried at the same time. */
+		static const unsigned int DEFAULT_RACE_WIDTH = 3;
+		/** Miliseconds to wait for an answer before starting the next mirror. */
+		static const unsigned int RACE_DELAY = 250;
+
 	private:
 		_MirrorHttpReaderPrivate *priv;
+		/** Mirrors not tried yet, fastest first. */
 		std::list<char *> urls;
 		unsigned int timeout;
+		unsigned int raceWidth;
 		/** @invariant userAgent != NULL */
 		char *userAgent;
 
@@ -65,6 +84,9 @@ namespace OpenKore {
 		 */
 		HttpReader *http;
 
+		/** Whether setStreaming() was called, for when http is created. */
+		bool streaming;
+
 	public:
 		/**
 		 * Create a new MirrorHttpReader object. It will immediately
@@ -80,18 +102,43 @@ namespace OpenKore {
 		 *                 undefined; it may be 30 seconds or forever, for example).
 		 *                 This parameter does not affect the download time.
 		 * @param userAgent  The useragent string to use.
+		 * @param raceWidth  The maximum number of mirrors to try at the same time.
+		 *                   1 tries them one after the other.
 		 * @require
 		 *     !urls.empty()
+		 *     raceWidth >= 1
 		 *     StdHttpReader::init() must have been called.
 		 */
 		MirrorHttpReader(const std::list<const char *> &urls,
 				 unsigned int timeout = 0,
-				 const char *userAgent = HttpReader::DEFAULT_USER_AGENT);
+				 const char *userAgent = HttpReader::DEFAULT_USER_AGENT,
+				 unsigned int raceWidth = DEFAULT_RACE_WIDTH);
 		~MirrorHttpReader();
 
+		/**
+		 * Remember the latencies of the servers in a file: the latencies
+		 * it holds are used from now on, and it is rewritten each time
+		 * a MirrorHttpReader has tried its mirrors. A missing file is
+		 * created.
+		 *
+		 * @param file  The filename, or NULL to stop writing the latencies.
+		 * @return Whether the file could be read, or doesn't exist yet.
+		 */
+		static bool setLatencyFile(const char *file);
+
+		/**
+		 * The time the server of a URL took to answer, as it is remembered.
+		 *
+		 * @return The latency in miliseconds, or -1 if the server wasn't tried yet
+		 *         or failed the last time.
+		 */
+		static int getLatency(const char *url);
+
 		virtual HttpReaderStatus getStatus() const;
 		virtual const char *getError() const;
 		virtual int pullData(void *buf, unsigned int size);
+		virtual void setStreaming();
+		virtual int pullChunk(char *&chunk);
 		virtual const char *getData(unsigned int &len) const;
 		virtual int getSize() const;
 
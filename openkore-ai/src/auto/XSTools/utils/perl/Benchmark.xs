@@ -1,4 +1,7 @@
 #include "../dense_hash_map.h"
+#ifdef WIN32
+	#include <windows.h>
+#endif
 #include "EXTERN.h"
 #include "perl.h"
 #include "XSUB.h"
@@ -6,26 +9,67 @@
 #include <stdlib.h>
 #include <time.h>
 #include <string.h>
+#include <string>
 #include <vector>
-#include <list>
+#include "../../OSL/Threading/Atomic.h"
 
-
-typedef double (*HR_Time_t) ();
-static void *HR_Time_p = 0;
-#define HR_Time ((HR_Time_t) HR_Time_p)
+#ifdef _MSC_VER
+	#define THREAD_LOCAL __declspec(thread)
+#else
+	#define THREAD_LOCAL __thread
+#endif
 
 using namespace std;
 using namespace google;
+using namespace OSL;
 
-struct Item {
-	clock_t clock;
-	double realTime;
+typedef unsigned long long Nanoseconds;
 
-	Item() {
-		clock = 0;
-		realTime = 0;
+#ifdef WIN32
+	static Nanoseconds
+	realTime() {
+		static double nsPerTick = 0;
+		LARGE_INTEGER counter;
+		if (nsPerTick == 0) {
+			LARGE_INTEGER frequency;
+			QueryPerformanceFrequency(&frequency);
+			nsPerTick = 1e9 / (double) frequency.QuadPart;
+		}
+		QueryPerformanceCounter(&counter);
+		return (Nanoseconds) (counter.QuadPart * nsPerTick);
 	}
-};
+
+	static Nanoseconds
+	cpuTime() {
+		FILETIME creation, exit, kernel, user;
+		ULARGE_INTEGER k, u;
+		GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+		k.LowPart = kernel.dwLowDateTime;
+		k.HighPart = kernel.dwHighDateTime;
+		u.LowPart = user.dwLowDateTime;
+		u.HighPart = user.dwHighDateTime;
+		// In units of 100 nanoseconds
+		return (k.QuadPart + u.QuadPart) * 100;
+	}
+#else
+	static Nanoseconds
+	readClock(clockid_t id) {
+		struct timespec ts;
+		clock_gettime(id, &ts);
+		return (Nanoseconds) ts.tv_sec * 1000000000 + ts.tv_nsec;
+	}
+
+	static Nanoseconds
+	realTime() {
+		return readClock(CLOCK_MONOTONIC);
+	}
+
+	static Nanoseconds
+	cpuTime() {
+		return readClock(CLOCK_THREAD_CPUTIME_ID);
+	}
+#endif
+
 
 struct eqstr {
 	bool operator()(const char* s1, const char* s2) const {
@@ -34,70 +78,267 @@ struct eqstr {
 };
 typedef dense_hash_map<const char *, int, HASH_NAMESPACE::hash<const char *>, eqstr> StrIntMap;
 
-class Benchmark {
+/**
+ * The domain names, shared by every thread. A domain is interned once and
+ * measured by its ID afterwards, so begin() and end() don't look up strings.
+ */
+class Domains {
 private:
-	StrIntMap domainToId;
-	vector<Item *> measurements;
-	vector<Item *> results;
-	list<char *> domains;
+	Atomic::Integer lock;
+	// The number of names, readable without the lock
+	Atomic::Integer count;
+	StrIntMap ids;
+	vector<char *> names;
+
+	void acquire() {
+		int expected = 0;
+		while (!Atomic::compareAndSwap(lock, expected, 1)) {
+			expected = 0;
+		}
+	}
+
+	void release() {
+		Atomic::store(lock, 0);
+	}
+
 public:
-	Benchmark() {
-		domainToId.set_empty_key(NULL);
+	Domains() {
+		Atomic::store(lock, 0);
+		Atomic::store(count, 0);
+		ids.set_empty_key(NULL);
 	}
 
-	~Benchmark() {
-		vector<Item *>::iterator it;
-		list<char *>::iterator it2;
-		for (it = measurements.begin(); it != measurements.end(); it++) {
-			delete *it;
+	int intern(const char *name) {
+		int id;
+		acquire();
+		StrIntMap::iterator result = ids.find(name);
+		if (result == ids.end()) {
+			char *copy = strdup(name);
+			id = names.size();
+			names.push_back(copy);
+			ids[copy] = id;
+			Atomic::store(count, id + 1);
+		} else {
+			id = result->second;
 		}
-		for (it = results.begin(); it != results.end(); it++) {
-			delete *it;
+		release();
+		return id;
+	}
+
+	string name(int id) {
+		string result;
+		acquire();
+		result = names[id];
+		release();
+		return result;
+	}
+
+	bool valid(int id) {
+		return id >= 0 && id < Atomic::load(count);
+	}
+};
+
+static Domains domains;
+
+
+// A place in the call tree: a domain, measured while its parent's domain was being measured
+struct Node {
+	int domain;
+	int parent;
+	int firstChild;
+	int nextSibling;
+	unsigned int calls;
+	Nanoseconds real, cpu;
+	// The part of real and cpu spent in the children
+	Nanoseconds childReal, childCpu;
+};
+
+// The totals of a domain, wherever it was measured
+struct Total {
+	unsigned int calls;
+	// How many times the domain is being measured right now; only the outermost one is counted
+	unsigned int active;
+	Nanoseconds real, cpu;
+};
+
+struct Frame {
+	int node;
+	Nanoseconds startReal, startCpu;
+};
+
+/**
+ * The measurements of one thread. Nodes and totals are only allocated the
+ * first time a domain is seen at a place in the tree, so measuring code
+ * which already ran once doesn't allocate.
+ */
+class Profile {
+private:
+	vector<Node> nodes;
+	vector<Total> totals;
+	vector<Frame> stack;
+
+	int child(int parent, int domain) {
+		int i;
+		for (i = nodes[parent].firstChild; i != -1; i = nodes[i].nextSibling) {
+			if (nodes[i].domain == domain) {
+				return i;
+			}
 		}
-		for (it2 = domains.begin(); it2 != domains.end(); it2++) {
-			delete *it2;
+
+		Node node;
+		memset(&node, 0, sizeof(Node));
+		node.domain = domain;
+		node.parent = parent;
+		node.firstChild = -1;
+		node.nextSibling = nodes[parent].firstChild;
+		i = nodes.size();
+		nodes.push_back(node);
+		nodes[parent].firstChild = i;
+		return i;
+	}
+
+	// Close the innermost measurement
+	void pop(Nanoseconds real, Nanoseconds cpu) {
+		Frame frame = stack.back();
+		Node &node = nodes[frame.node];
+		Total &total = totals[node.domain];
+		Nanoseconds elapsedReal = real - frame.startReal;
+		Nanoseconds elapsedCpu = cpu - frame.startCpu;
+
+		stack.pop_back();
+		node.real += elapsedReal;
+		node.cpu += elapsedCpu;
+		if (node.parent != 0) {
+			nodes[node.parent].childReal += elapsedReal;
+			nodes[node.parent].childCpu += elapsedCpu;
+		}
+		if (--total.active == 0) {
+			total.real += elapsedReal;
+			total.cpu += elapsedCpu;
 		}
 	}
 
-	void begin(const char *domain) {
-		Item *item;
-		StrIntMap::iterator result = domainToId.find(domain);
-		if (result == domainToId.end()) {
-			char *domainCopy = strdup(domain);
-			domains.push_front(domainCopy);
-			domainToId[domainCopy] = measurements.size();
-			item = new Item();
-			measurements.push_back(item);
-			results.push_back(new Item());
-		} else {
-			pair<const char *, int> p = *result;
-			item = measurements[p.second];
+	void appendPath(string &out, int node) {
+		if (nodes[node].parent != 0) {
+			appendPath(out, nodes[node].parent);
+			out += ';';
 		}
+		string name = domains.name(nodes[node].domain);
+		for (string::size_type i = 0; i < name.size(); i++) {
+			out += (name[i] == ';' || name[i] == '\n') ? '_' : name[i];
+		}
+	}
 
-		item->clock = clock();
-		item->realTime = HR_Time();
+public:
+	Profile() {
+		reset();
+	}
+
+	void reset() {
+		Node root;
+		memset(&root, 0, sizeof(Node));
+		root.domain = -1;
+		root.parent = -1;
+		root.firstChild = -1;
+		root.nextSibling = -1;
+		nodes.clear();
+		nodes.reserve(256);
+		nodes.push_back(root);
+		totals.clear();
+		stack.clear();
+		stack.reserve(64);
 	}
 
-	void end(const char *domain) {
-		int id = domainToId[domain];
-		Item *measurement = measurements[id];
-		Item *result = results[id];
+	void begin(int domain) {
+		int parent = stack.empty() ? 0 : stack.back().node;
+		Frame frame;
 
-		result->clock += clock() - measurement->clock;
-		result->realTime += HR_Time() - measurement->realTime;
+		if (domain >= (int) totals.size()) {
+			Total total;
+			memset(&total, 0, sizeof(Total));
+			totals.resize(domain + 1, total);
+		}
+		frame.node = child(parent, domain);
+		nodes[frame.node].calls++;
+		totals[domain].calls++;
+		totals[domain].active++;
+		frame.startCpu = cpuTime();
+		frame.startReal = realTime();
+		stack.push_back(frame);
 	}
 
-	const list<char *> getDomains() {
-		return domains;
+	/**
+	 * End the innermost measurement of domain. Measurements which began
+	 * after it and weren't ended are ended too; a domain which isn't
+	 * being measured is ignored.
+	 */
+	void end(int domain) {
+		Nanoseconds real = realTime();
+		Nanoseconds cpu = cpuTime();
+		int i;
+
+		for (i = (int) stack.size() - 1; i >= 0; i--) {
+			if (nodes[stack[i].node].domain == domain) {
+				break;
+			}
+		}
+		if (i < 0) {
+			return;
+		}
+		while ((int) stack.size() > i) {
+			pop(real, cpu);
+		}
 	}
 
-	const Item * getResult(const char *domain) {
-		int id = domainToId[domain];
-		return results[id];
+	const vector<Total> &getTotals() {
+		return totals;
+	}
+
+	/**
+	 * Returns the call tree in the folded stack format of flamegraph.pl:
+	 * one line per place in the tree, with the microseconds spent there
+	 * but not in its children.
+	 */
+	string folded(bool useCpu) {
+		string result;
+		char count[32];
+		for (unsigned int i = 1; i < nodes.size(); i++) {
+			const Node &node = nodes[i];
+			Nanoseconds self = useCpu ? node.cpu - node.childCpu : node.real - node.childReal;
+			if (node.calls == 0) {
+				continue;
+			}
+			appendPath(result, i);
+			sprintf(count, " %.0f\n", (double) (self / 1000));
+			result += count;
+		}
+		return result;
 	}
 };
 
-static Benchmark benchmark;
+static THREAD_LOCAL Profile *threadProfile = NULL;
+
+// The profile of the calling thread, which lives as long as the process
+static Profile *
+profile() {
+	if (threadProfile == NULL) {
+		threadProfile = new Profile();
+	}
+	return threadProfile;
+}
+
+// A domain is passed as the ID returned by Benchmark::domain(), or as its name
+static int
+domainOf(SV *domain) {
+	if (SvIOK(domain) && !SvPOK(domain)) {
+		int id = SvIV(domain);
+		if (!domains.valid(id)) {
+			croak("Invalid benchmark domain ID %d", id);
+		}
+		return id;
+	}
+	return domains.intern(SvPV_nolen(domain));
+}
 
 
 MODULE = Utils::Benchmark	PACKAGE = Benchmark
@@ -106,48 +347,69 @@ PROTOTYPES: ENABLE
 void
 init()
 CODE:
-	SV **svp = hv_fetch(PL_modglobal, "Time::NVtime", 12, 0);
-	if (!svp) {
-		croak("Time::HiRes is required");
-	}
-	if (!SvIOK(*svp)) {
-		croak("Time::NVtime isn't a function pointer");
-	}
-	HR_Time_p = INT2PTR(void *, SvIV (*svp));
+	profile();
+
+int
+domain(name)
+	char *name
+CODE:
+	RETVAL = domains.intern(name);
+OUTPUT:
+	RETVAL
 
 void
 begin(domain)
-	char *domain
+	SV *domain
 CODE:
-	benchmark.begin(domain);
+	profile()->begin(domainOf(domain));
 
 void
 end(domain)
-	char *domain
+	SV *domain
+CODE:
+	profile()->end(domainOf(domain));
+
+void
+reset()
 CODE:
-	benchmark.end(domain);
+	profile()->reset();
 
 SV *
 getResults()
 CODE:
-	list<char *>::iterator it;
-	list<char *> domains;
-	HV *results;
+	HV *results = (HV *) sv_2mortal((SV *) newHV());
+	const vector<Total> &totals = profile()->getTotals();
 
-	domains = benchmark.getDomains();
-	results = (HV *) sv_2mortal((SV *) newHV());
-	for (it = domains.begin(); it != domains.end(); it++) {
-		const Item *item = benchmark.getResult(*it);
-		HV *perl_item = (HV *) sv_2mortal((SV *) newHV());
+	for (unsigned int i = 0; i < totals.size(); i++) {
+		const Total &total = totals[i];
+		HV *perl_item;
+		string name;
 
-		hv_store(perl_item, "clock", 5, newSViv(item->clock), 0);
-		hv_store(perl_item, "realTime", 8, newSVnv(item->realTime), 0);
-		hv_store(results, *it, strlen(*it), newRV((SV *) perl_item), 0);
+		if (total.calls == 0) {
+			continue;
+		}
+		perl_item = (HV *) sv_2mortal((SV *) newHV());
+		name = domains.name(i);
+		hv_store(perl_item, "calls", 5, newSVuv(total.calls), 0);
+		hv_store(perl_item, "cpuTime", 7, newSVnv(total.cpu / 1e9), 0);
+		// In clock() ticks, for clock2msec()
+		hv_store(perl_item, "clock", 5, newSVnv(total.cpu / 1e9 * CLOCKS_PER_SEC), 0);
+		hv_store(perl_item, "realTime", 8, newSVnv(total.real / 1e9), 0);
+		hv_store(results, name.c_str(), name.size(), newRV((SV *) perl_item), 0);
 	}
 	RETVAL = newRV((SV *) results);
 OUTPUT:
 	RETVAL
 
+SV *
+folded(useCpu = false)
+	bool useCpu
+CODE:
+	string result = profile()->folded(useCpu);
+	RETVAL = newSVpvn(result.data(), result.size());
+OUTPUT:
+	RETVAL
+
 double
 clock2msec(clocktime)
 	double clocktime
@@ -155,4 +417,3 @@ CODE:
 	RETVAL = clocktime / (double) CLOCKS_PER_SEC;
 OUTPUT:
 	RETVAL
-
@@ -0,0 +1,245 @@
+#include "../engine-client.h"
+
+#include "EXTERN.h"
+#include "perl.h"
+#include "XSUB.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace OpenKore;
+
+/*
+ * A JSON encoder for plain Perl data, which builds the request body of an
+ * EngineClient without going through the JSON module.
+ *
+ * Values are encoded like JSON::XS does: hashes (blessed or not) become
+ * objects, arrays become arrays, undef becomes null, and scalars which
+ * were used as strings become strings, or numbers otherwise. References to
+ * scalars, like \1 and \0, and JSON::PP::Boolean objects become booleans.
+ * Anything else, and data nested deeper than MAX_DEPTH (which is what
+ * references which loop back end up as), becomes null.
+ */
+
+#define MAX_DEPTH 64
+
+static void
+encodeString(string &out, const char *str, STRLEN len, bool utf8) {
+	static const char hex[] = "0123456789abcdef";
+
+	out += '"';
+	for (STRLEN i = 0; i < len; i++) {
+		unsigned char c = str[i];
+		switch (c) {
+		case '"':  out += "\\\""; break;
+		case '\\': out += "\\\\"; break;
+		case '\n': out += "\\n"; break;
+		case '\r': out += "\\r"; break;
+		case '\t': out += "\\t"; break;
+		case '\b': out += "\\b"; break;
+		case '\f': out += "\\f"; break;
+		default:
+			if (c < 0x20) {
+				out += "\\u00";
+				out += hex[c >> 4];
+				out += hex[c & 0xF];
+			} else if (c >= 0x80 && !utf8) {
+				// Byte strings are Latin-1, like encode_json() assumes
+				out += (char) (0xC0 | (c >> 6));
+				out += (char) (0x80 | (c & 0x3F));
+			} else {
+				out += c;
+			}
+		}
+	}
+	out += '"';
+}
+
+static void
+encodeValue(pTHX_ string &out, SV *sv, int depth) {
+	char number[64];
+
+	SvGETMAGIC(sv);
+	if (depth > MAX_DEPTH) {
+		out += "null";
+
+	} else if (SvROK(sv)) {
+		SV *rv = SvRV(sv);
+
+		if (SvTYPE(rv) == SVt_PVHV) {
+			HV *hv = (HV *) rv;
+			HE *he;
+			vector<pair<SV *, SV *> > entries;
+
+			// Take the entries first: a value may hold this hash again,
+			// and encoding it would reset the iterator. The keys and
+			// values of tied hashes are mortal copies.
+			ENTER;
+			SAVETMPS;
+			hv_iterinit(hv);
+			while ((he = hv_iternext(hv)) != NULL) {
+				entries.push_back(make_pair(hv_iterkeysv(he), hv_iterval(hv, he)));
+			}
+
+			out += '{';
+			for (size_t i = 0; i < entries.size(); i++) {
+				STRLEN len;
+				const char *key = SvPV(entries[i].first, len);
+
+				if (i > 0) {
+					out += ',';
+				}
+				encodeString(out, key, len, SvUTF8(entries[i].first));
+				out += ':';
+				encodeValue(aTHX_ out, entries[i].second, depth + 1);
+			}
+			out += '}';
+			FREETMPS;
+			LEAVE;
+
+		} else if (SvTYPE(rv) == SVt_PVAV) {
+			AV *av = (AV *) rv;
+			I32 last = av_len(av);
+
+			out += '[';
+			for (I32 i = 0; i <= last; i++) {
+				SV **item = av_fetch(av, i, 0);
+				if (i > 0) {
+					out += ',';
+				}
+				if (item != NULL) {
+					encodeValue(aTHX_ out, *item, depth + 1);
+				} else {
+					out += "null";
+				}
+			}
+			out += ']';
+
+		} else if (SvTYPE(rv) < SVt_PVAV && !SvROK(rv)
+			&& (!SvOBJECT(rv) || sv_derived_from(sv, "JSON::PP::Boolean"))) {
+			out += SvTRUE(rv) ? "true" : "false";
+
+		} else {
+			out += "null";
+		}
+
+	} else if (!SvOK(sv)) {
+		out += "null";
+
+	} else if (SvPOKp(sv)) {
+		STRLEN len;
+		const char *str = SvPV_nomg(sv, len);
+		encodeString(out, str, len, SvUTF8(sv));
+
+	} else if (SvNOKp(sv)) {
+		NV value = SvNVX(sv);
+		if (Perl_isnan(value) || Perl_isinf(value)) {
+			out += "null";
+		} else {
+			snprintf(number, sizeof(number), "%.15" NVgf, value);
+			out += number;
+		}
+
+	} else if (SvIOKp(sv)) {
+		if (SvIsUV(sv)) {
+			snprintf(number, sizeof(number), "%" UVuf, SvUVX(sv));
+		} else {
+			snprintf(number, sizeof(number), "%" IVdf, SvIVX(sv));
+		}
+		out += number;
+
+	} else {
+		STRLEN len;
+		const char *str = SvPV_nomg(sv, len);
+		encodeString(out, str, len, SvUTF8(sv));
+	}
+}
+
+static SV *
+newJSON(pTHX_ SV *data) {
+	string out;
+	encodeValue(aTHX_ out, data, 0);
+	return newSVpvn(out.data(), out.size());
+}
+
+
+MODULE = Utils::EngineClient	PACKAGE = Utils::EngineClient
+PROTOTYPES: ENABLED
+
+EngineClient *
+EngineClient::new(host, port, timeout = 10000)
+	const char *host
+	unsigned short port
+	unsigned int timeout
+CODE:
+	RETVAL = new EngineClient(host, port, timeout);
+OUTPUT:
+	RETVAL
+
+bool
+EngineClient::post(path, data)
+	const char *path
+	SV *data
+INIT:
+	string json;
+	const char *body;
+	STRLEN len;
+CODE:
+	if (SvROK(data)) {
+		encodeValue(aTHX_ json, data, 0);
+		body = json.data();
+		len = json.size();
+	} else {
+		body = SvPV(data, len);
+	}
+	RETVAL = THIS->post(path, body, len);
+OUTPUT:
+	RETVAL
+
+int
+EngineClient::poll()
+CODE:
+	RETVAL = THIS->poll();
+OUTPUT:
+	RETVAL
+
+int
+EngineClient::getStatus()
+CODE:
+	RETVAL = THIS->getStatus();
+OUTPUT:
+	RETVAL
+
+int
+EngineClient::getResponseCode()
+
+SV *
+EngineClient::getResponseBody()
+CODE:
+	const string &body = THIS->getResponseBody();
+	RETVAL = newSVpvn(body.data(), body.size());
+OUTPUT:
+	RETVAL
+
+const char *
+EngineClient::getError()
+
+void
+EngineClient::reset()
+
+bool
+EngineClient::isConnected()
+
+void
+EngineClient::DESTROY()
+
+SV *
+encodeJSON(data)
+	SV *data
+CODE:
+	RETVAL = newJSON(aTHX_ data);
+OUTPUT:
+	RETVAL
@@ -44,6 +44,32 @@ CODE:
 OUTPUT:
 	RETVAL
 
+void
+HttpReader::setStreaming()
+
+int
+HttpReader::pullChunk(buf)
+	SV *buf
+INIT:
+	char *chunk;
+CODE:
+	RETVAL = THIS->pullChunk(chunk);
+	if (RETVAL > 0) {
+#if defined(MYMALLOC) || defined(PERL_TRACK_MEMPOOL) || defined(PERL_IMPLICIT_SYS)
+		// Perl doesn't free strings with free() here, so it can't take the chunk over
+		sv_setpvn(buf, chunk, RETVAL);
+		free(chunk);
+#else
+		sv_usepvn_flags(buf, chunk, RETVAL, SV_HAS_TRAILING_NUL);
+#endif
+	} else {
+		sv_setpvn(buf, "", 0);
+	}
+	SvUTF8_off(buf);
+	SvSETMAGIC(buf);
+OUTPUT:
+	RETVAL
+
 char *
 HttpReader::getData(len)
 	unsigned int &len
@@ -90,9 +116,10 @@ OUTPUT:
 MODULE = Utils::HttpReader	PACKAGE = MirrorHttpReader
 
 MirrorHttpReader *
-MirrorHttpReader::new(urls, timeout = 0)
+MirrorHttpReader::new(urls, timeout = 0, raceWidth = MirrorHttpReader::DEFAULT_RACE_WIDTH)
 	AV *urls
 	unsigned int timeout
+	unsigned int raceWidth
 INIT:
 	list<const char *> urls_list;
 	I32 i, len;
@@ -107,6 +134,25 @@ CODE:
 			urls_list.push_back(url);
 		}
 	}
-	RETVAL = new MirrorHttpReader(urls_list, timeout);
+	if (raceWidth < 1) {
+		raceWidth = 1;
+	}
+	RETVAL = new MirrorHttpReader(urls_list, timeout, HttpReader::DEFAULT_USER_AGENT, raceWidth);
+OUTPUT:
+	RETVAL
+
+bool
+setLatencyFile(file)
+	SV *file
+CODE:
+	RETVAL = MirrorHttpReader::setLatencyFile(SvOK(file) ? SvPV_nolen(file) : NULL);
+OUTPUT:
+	RETVAL
+
+int
+getLatency(url)
+	char *url
+CODE:
+	RETVAL = MirrorHttpReader::getLatency(url);
 OUTPUT:
 	RETVAL
@@ -0,0 +1,286 @@
+#include "../dense_hash_map.h"
+#ifdef WIN32
+	#include <windows.h>
+#else
+	#include <pthread.h>
+	#include <time.h>
+#endif
+#include "EXTERN.h"
+#include "perl.h"
+#include "XSUB.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../../OSL/Threading/Atomic.h"
+
+using namespace std;
+using namespace google;
+using namespace OSL;
+
+/*
+ * A sampling profiler for the Perl interpreter which started it.
+ *
+ * A timer thread regularly asks for a sample by raising the interpreter's
+ * pending signal flag; the interpreter then calls PL_signalhook at the next
+ * safe point, like it does for %SIG handlers, and the hook records which subs
+ * are being run. So the context stack is only ever read by the thread which
+ * owns it, and code which isn't sampled runs as fast as without the profiler.
+ */
+
+// Samples deeper than this are cut at their outermost frames
+#define MAX_DEPTH 48
+// Stacks seen after this many different ones are counted as one
+#define MAX_STACKS 20000
+#define TRUNCATED_STACK "[more stacks]"
+
+struct eqstr {
+	bool operator()(const char* s1, const char* s2) const {
+		return (s1 == s2) || (s1 && s2 && strcmp(s1, s2) == 0);
+	}
+};
+typedef dense_hash_map<const char *, int, HASH_NAMESPACE::hash<const char *>, eqstr> StrIntMap;
+
+static Atomic::Integer running;
+static Atomic::Integer sampleDue;
+static unsigned int interval;
+static volatile int *pendingFlag;
+static despatch_signals_proc_t previousHook;
+
+static StrIntMap stackIds;
+static vector<char *> stacks;
+static vector<unsigned int> counts;
+static unsigned int totalSamples;
+// Reused by every sample, so sampling a known stack doesn't allocate
+static string buffer;
+
+#ifdef WIN32
+	static HANDLE thread;
+
+	static DWORD WINAPI
+	timerEntry(LPVOID arg) {
+		// Sleep() rounds up to the system timer resolution, which may be coarser than interval
+		DWORD ms = interval / 1000;
+		while (Atomic::load(running)) {
+			Sleep(ms > 0 ? ms : 1);
+			Atomic::store(sampleDue, 1);
+			*pendingFlag = 1;
+		}
+		return 0;
+	}
+#else
+	static pthread_t thread;
+
+	static void *
+	timerEntry(void *arg) {
+		struct timespec delay;
+		delay.tv_sec = interval / 1000000;
+		delay.tv_nsec = (interval % 1000000) * 1000;
+		while (Atomic::load(running)) {
+			nanosleep(&delay, NULL);
+			Atomic::store(sampleDue, 1);
+			*pendingFlag = 1;
+		}
+		return NULL;
+	}
+#endif
+
+static void
+appendSub(pTHX_ string &out, CV *cv) {
+	GV *gv;
+	HV *stash;
+
+#ifdef CvNAMED
+	// Lexical subs have no glob, and CvGV() would make one
+	if (CvNAMED(cv)) {
+		out.append(HEK_KEY(CvNAME_HEK(cv)), HEK_LEN(CvNAME_HEK(cv)));
+		return;
+	}
+#endif
+	gv = CvGV(cv);
+	if (gv == NULL || !isGV_with_GP(gv)) {
+		out += "__ANON__";
+		return;
+	}
+	stash = GvSTASH(gv);
+	if (stash != NULL && HvNAME(stash) != NULL) {
+		out += HvNAME(stash);
+		out += "::";
+	}
+	out.append(GvNAME(gv), GvNAMELEN(gv));
+}
+
+static int
+stackId(const char *stack) {
+	StrIntMap::iterator result = stackIds.find(stack);
+	if (result != stackIds.end()) {
+		return result->second;
+	}
+
+	char *copy = strdup(stack);
+	int id = stacks.size();
+	stacks.push_back(copy);
+	counts.push_back(0);
+	stackIds[copy] = id;
+	return id;
+}
+
+// Records the subs being run, outermost first, and the line being run, in buffer
+static void
+takeSample(pTHX) {
+	CV *frames[MAX_DEPTH];
+	int depth = 0;
+	PERL_SI *si;
+	const char *file;
+	const char *slash;
+	char line[32];
+
+	for (si = PL_curstackinfo; si != NULL && depth < MAX_DEPTH; si = si->si_prev) {
+		for (I32 i = si->si_cxix; i >= 0 && depth < MAX_DEPTH; i--) {
+			const PERL_CONTEXT *cx = &si->si_cxstack[i];
+			if (CxTYPE(cx) == CXt_SUB && cx->blk_sub.cv != NULL) {
+				frames[depth++] = cx->blk_sub.cv;
+			}
+		}
+	}
+
+	buffer.clear();
+	while (depth > 0) {
+		if (!buffer.empty()) {
+			buffer += ';';
+		}
+		appendSub(aTHX_ buffer, frames[--depth]);
+	}
+	if (PL_curcop != NULL && (file = CopFILE(PL_curcop)) != NULL) {
+		slash = strrchr(file, '/');
+		if (slash == NULL) {
+			slash = strrchr(file, '\\');
+		}
+		sprintf(line, ":%u", (unsigned int) CopLINE(PL_curcop));
+		if (!buffer.empty()) {
+			buffer += ';';
+		}
+		buffer += slash ? slash + 1 : file;
+		buffer += line;
+	}
+	for (string::size_type i = 0; i < buffer.size(); i++) {
+		// Lines separate the stacks in the folded format
+		if (buffer[i] == '\n') {
+			buffer[i] = ' ';
+		}
+	}
+
+	if (stacks.size() >= MAX_STACKS && stackIds.find(buffer.c_str()) == stackIds.end()) {
+		buffer = TRUNCATED_STACK;
+	}
+	counts[stackId(buffer.c_str())]++;
+	totalSamples++;
+}
+
+static void
+signalHook(pTHX) {
+	// Real signals first; this also clears the pending flag
+	previousHook(aTHX);
+	if (Atomic::load(sampleDue)) {
+		Atomic::store(sampleDue, 0);
+		takeSample(aTHX);
+	}
+}
+
+static void
+resetSamples() {
+	for (unsigned int i = 0; i < stacks.size(); i++) {
+		free(stacks[i]);
+	}
+	stackIds.clear();
+	stacks.clear();
+	counts.clear();
+	totalSamples = 0;
+}
+
+
+MODULE = Utils::Profiler	PACKAGE = Utils::Profiler
+PROTOTYPES: ENABLE
+
+BOOT:
+	stackIds.set_empty_key(NULL);
+
+bool
+start(rate = 1000)
+	unsigned int rate
+CODE:
+	/* Returns whether the profiler runs afterwards */
+	if (Atomic::load(running)) {
+		RETVAL = true;
+	} else {
+		if (rate == 0 || rate > 100000) {
+			croak("Invalid sampling rate %u", rate);
+		}
+		interval = 1000000 / rate;
+		pendingFlag = (volatile int *) &PL_sig_pending;
+		previousHook = PL_signalhook;
+		PL_signalhook = signalHook;
+		Atomic::store(running, 1);
+#ifdef WIN32
+		thread = CreateThread(NULL, 0, timerEntry, NULL, 0, NULL);
+		RETVAL = thread != NULL;
+#else
+		RETVAL = pthread_create(&thread, NULL, timerEntry, NULL) == 0;
+#endif
+		if (!RETVAL) {
+			Atomic::store(running, 0);
+			PL_signalhook = previousHook;
+		}
+	}
+OUTPUT:
+	RETVAL
+
+void
+stop()
+CODE:
+	if (Atomic::load(running)) {
+		Atomic::store(running, 0);
+#ifdef WIN32
+		WaitForSingleObject(thread, INFINITE);
+		CloseHandle(thread);
+#else
+		pthread_join(thread, NULL);
+#endif
+		PL_signalhook = previousHook;
+		Atomic::store(sampleDue, 0);
+	}
+
+bool
+isRunning()
+CODE:
+	RETVAL = Atomic::load(running) != 0;
+OUTPUT:
+	RETVAL
+
+unsigned int
+samples()
+CODE:
+	RETVAL = totalSamples;
+OUTPUT:
+	RETVAL
+
+void
+reset()
+CODE:
+	resetSamples();
+
+SV *
+folded()
+CODE:
+	/* One "outer;inner;file:line count" line per stack which was seen, for flamegraph.pl */
+	string result;
+	char count[32];
+	for (unsigned int i = 0; i < stacks.size(); i++) {
+		result += stacks[i];
+		sprintf(count, " %u\n", counts[i]);
+		result += count;
+	}
+	RETVAL = newSVpvn(result.data(), result.size());
+OUTPUT:
+	RETVAL
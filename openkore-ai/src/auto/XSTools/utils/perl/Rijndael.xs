@@ -10,6 +10,52 @@ extern "C" {
 }
 #endif
 
+/* Encrypts or decrypts n bytes from in to out, which may be in. Returns false if the key isn't
+   set or n isn't a multiple of the block size. */
+static bool
+Rijndael_crypt(CRijndael *rijndael, bool encrypt, const char *in, char *out, size_t n, int iMode)
+{
+	try {
+		if (encrypt)
+			rijndael->Encrypt(in, out, n, iMode);
+		else
+			rijndael->Decrypt(in, out, n, iMode);
+	} catch (std::exception &) {
+		return false;
+	}
+	return true;
+}
+
+/* A new string of the first n bytes of in, encrypted or decrypted */
+static SV *
+Rijndael_cryptToSV(CRijndael *rijndael, bool encrypt, const char *in, size_t n, int iMode)
+{
+	SV *result = newSV(n);
+
+	SvPOK_only(result);
+	if (!Rijndael_crypt(rijndael, encrypt, in, SvPVX(result), n, iMode)) {
+		SvREFCNT_dec(result);
+		croak("Utils::Rijndael: the key isn't set or the length isn't a multiple of the block size");
+	}
+	SvCUR_set(result, n);
+	*SvEND(result) = '\0';
+	return result;
+}
+
+/* Encrypts or decrypts the whole of a scalar in its own buffer */
+static void
+Rijndael_cryptInPlace(CRijndael *rijndael, bool encrypt, SV *data, int iMode)
+{
+	STRLEN len;
+	char *buffer = SvPVbyte_force(data, len);
+
+	if (len == 0)
+		return;
+	if (!Rijndael_crypt(rijndael, encrypt, buffer, buffer, len, iMode))
+		croak("Utils::Rijndael: the key isn't set or the length isn't a multiple of the block size");
+	SvSETMAGIC(data);
+}
+
 MODULE = Utils::Rijndael	PACKAGE = Utils::Rijndael
 PROTOTYPES: ENABLED
 
@@ -21,6 +67,10 @@ void
 CRijndael::DESTROY();
 
 
+bool
+CRijndael::UseHardware(bool enable)
+
+
 void
 CRijndael::MakeKey(char* key, char* chain, int keylength, int blockSize)
 CODE:
@@ -29,23 +79,59 @@ CODE:
 
 SV *
 CRijndael::Encrypt(char* in, char* not_used, size_t n, int iMode)
-INIT:
-	char *result = new char [n];
 CODE:
-	THIS->Encrypt(in, result, n, iMode);
-	RETVAL = newSVpv(result, n);
-	delete[] result;
+	RETVAL = Rijndael_cryptToSV(THIS, true, in, n, iMode);
 OUTPUT:
 	RETVAL
 
 
 SV *
 CRijndael::Decrypt(char* in, char* not_used, size_t n, int iMode)
-INIT:
-	char *result = new char [n];
 CODE:
-	THIS->Decrypt(in, result, n, iMode);
-	RETVAL = newSVpv(result, n);
-	delete[] result;
+	RETVAL = Rijndael_cryptToSV(THIS, false, in, n, iMode);
+OUTPUT:
+	RETVAL
+
+
+void
+CRijndael::EncryptInPlace(SV *data, int iMode)
+CODE:
+	Rijndael_cryptInPlace(THIS, true, data, iMode);
+
+
+void
+CRijndael::DecryptInPlace(SV *data, int iMode)
+CODE:
+	Rijndael_cryptInPlace(THIS, false, data, iMode);
+
+MODULE = Utils::Rijndael	PACKAGE = Utils::Rijndael::Keyed
+PROTOTYPES: ENABLED
+
+CRijndael *
+new(CLASS, key, chain, keylength, blockSize)
+	char *CLASS
+	SV *key
+	SV *chain
+	int keylength
+	int blockSize
+PREINIT:
+	STRLEN keyLen, chainLen;
+	const char *keyData, *chainData;
+	char block[32];
+CODE:
+	keyData = SvPVbyte(key, keyLen);
+	chainData = SvPVbyte(chain, chainLen);
+	if (!(keylength == 16 || keylength == 24 || keylength == 32) || keyLen < (STRLEN) keylength) {
+		croak("Utils::Rijndael::Keyed: the key must be 16, 24 or 32 bytes");
+	}
+	if (!(blockSize == 16 || blockSize == 24 || blockSize == 32)) {
+		croak("Utils::Rijndael::Keyed: the block size must be 16, 24 or 32 bytes");
+	}
+	/* A short chain is padded with zeros */
+	memset(block, 0, sizeof(block));
+	memcpy(block, chainData, chainLen < (STRLEN) blockSize ? chainLen : (STRLEN) blockSize);
+	RETVAL = new CRijndael();
+	RETVAL->MakeKey(keyData, block, keylength, blockSize);
+	RETVAL->SetStateless(true);
 OUTPUT:
-	RETVAL
\ No newline at end of file
+	RETVAL
@@ -1,4 +1,5 @@
 #include "../whirlpool-algorithm.h"
+#include "../whirlpool-files.h"
 
 #define CLASS klass
 
@@ -29,14 +30,25 @@ add(wp, data)
 	WP_Struct *wp
 	SV *data
 CODE:
+	if (data != NULL)
+		SvGETMAGIC(data);
 	if (data != NULL && SvOK(data)) {
 		STRLEN len;
 		char *bytes;
 
-		bytes = SvPV(data, len);
-		WP_Add((const unsigned char * const) bytes, len * 8, wp);
+		bytes = SvPV_nomg(data, len);
+		WP_AddBytes((const unsigned char *) bytes, len, wp);
 	}
 
+bool
+addFile(wp, filename)
+	WP_Struct *wp
+	char *filename
+CODE:
+	RETVAL = WP_AddFile(filename, wp);
+OUTPUT:
+	RETVAL
+
 SV *
 finalize(wp)
 	WP_Struct *wp
@@ -53,3 +65,40 @@ DESTROY(wp)
 	WP_Struct *wp
 CODE:
 	WP_Free(wp);
+
+void
+hashFiles(files, threads = 0)
+	SV *files
+	int threads
+PREINIT:
+	AV *list;
+	I32 count, i;
+	const char **filenames;
+	unsigned char *hashes;
+	int *ok;
+PPCODE:
+	/* The names stay in the strings of the array while the threads read the files */
+	if (!SvROK(files) || SvTYPE(SvRV(files)) != SVt_PVAV)
+		croak("Utils::Whirlpool::hashFiles: files must be an array reference");
+	list = (AV *) SvRV(files);
+	count = av_len(list) + 1;
+	if (count <= 0)
+		XSRETURN_EMPTY;
+	Newx(filenames, count, const char *);
+	Newx(hashes, count * WP_DIGEST_SIZE, unsigned char);
+	Newx(ok, count, int);
+	for (i = 0; i < count; i++) {
+		SV **name = av_fetch(list, i, 0);
+		filenames[i] = (name && SvOK(*name)) ? SvPV_nolen(*name) : "";
+	}
+	WP_HashFiles(filenames, (unsigned int) count, hashes, ok, threads);
+	EXTEND(SP, count);
+	for (i = 0; i < count; i++) {
+		if (ok[i])
+			PUSHs(sv_2mortal(newSVpvn((const char *) hashes + i * WP_DIGEST_SIZE, WP_DIGEST_SIZE)));
+		else
+			PUSHs(&PL_sv_undef);
+	}
+	Safefree(filenames);
+	Safefree(hashes);
+	Safefree(ok);
@@ -22,12 +22,15 @@
 #include <string.h>
 #include <assert.h>
 #include <string>
+#include <list>
+#include "../OSL/Threading/SpscQueue.h"
 #ifdef WIN32
 	#define WIN32_MEAN_AND_LEAN
 	#include <windows.h>
 	#include <wininet.h>
 #else
 	#include <unistd.h>
+	#include <fcntl.h>
 	#include <curl/curl.h>
 	#include <pthread.h>
 #endif
@@ -36,6 +39,284 @@
 namespace OpenKore {
 
 	namespace {
+		/**
+		 * The download buffer of a HttpReader in streaming mode: chunks of
+		 * at most HttpReader::CHUNK_SIZE bytes, which the thread that
+		 * downloads hands over to the thread that pulls data through an
+		 * OSL::SpscQueue, so that neither ever waits for the other.
+		 *
+		 * Each chunk is allocated with one extra byte for a NULL terminator,
+		 * so that whoever takes it can use it as a C string.
+		 */
+		class ChunkQueue {
+		private:
+			struct Chunk {
+				char *data;
+				unsigned int size;
+			};
+
+			OSL::SpscQueue<Chunk> queue;
+			/** Set by the producer while it waits for room in the queue. */
+			OSL::Atomic::Integer waiting;
+			/** Set by the producer once it added its last chunk to rest. */
+			OSL::Atomic::Integer finished;
+			/** The chunks which were left after the queue, once finished. */
+			std::list<Chunk> rest;
+
+			// Only used by the producer.
+			Chunk current;
+			std::list<Chunk> pending;
+
+			// Only used by the consumer.
+			Chunk head;
+			unsigned int headOffset;
+
+			/**
+			 * @return 1 if chunk was set, 0 if the producer finished and
+			 *         there are no chunks left, -1 if the queue is empty.
+			 */
+			int
+			takeChunk(Chunk &chunk) {
+				// Once finished is seen, so is every chunk pushed before it
+				bool done = OSL::Atomic::load(finished);
+
+				if (queue.pop(chunk)) {
+					return 1;
+				} else if (!done) {
+					return -1;
+				} else if (!rest.empty()) {
+					chunk = rest.front();
+					rest.pop_front();
+					return 1;
+				} else {
+					return 0;
+				}
+			}
+
+			static void
+			freeChunks(std::list<Chunk> &chunks) {
+				std::list<Chunk>::iterator it;
+				for (it = chunks.begin(); it != chunks.end(); it++) {
+					free(it->data);
+				}
+				chunks.clear();
+			}
+
+		public:
+			ChunkQueue(): queue(HttpReader::STREAM_CHUNKS) {
+				OSL::Atomic::store(waiting, 0);
+				OSL::Atomic::store(finished, 0);
+				current.data = NULL;
+				current.size = 0;
+				head.data = NULL;
+				head.size = 0;
+				headOffset = 0;
+			}
+
+			~ChunkQueue() {
+				Chunk chunk;
+				while (queue.pop(chunk)) {
+					free(chunk.data);
+				}
+				freeChunks(rest);
+				freeChunks(pending);
+				free(current.data);
+				free(head.data);
+			}
+
+			/**
+			 * Returns the free space at the end of the last chunk, for
+			 * the producer to put data in before calling commit().
+			 *
+			 * @return A buffer of size bytes, or NULL if out of memory.
+			 * @ensure if result != NULL: size > 0
+			 */
+			char *
+			reserve(unsigned int &size) {
+				if (current.data == NULL) {
+					current.data = (char *) malloc(HttpReader::CHUNK_SIZE + 1);
+					if (current.data == NULL) {
+						return NULL;
+					}
+				}
+				size = HttpReader::CHUNK_SIZE - current.size;
+				return current.data + current.size;
+			}
+
+			/**
+			 * Add size bytes, which the producer put in the buffer
+			 * returned by reserve(). Full chunks are queued by flush().
+			 */
+			void
+			commit(unsigned int size) {
+				current.size += size;
+				if (current.size == HttpReader::CHUNK_SIZE) {
+					current.data[current.size] = '\0';
+					pending.push_back(current);
+					current.data = NULL;
+					current.size = 0;
+				}
+			}
+
+			/**
+			 * Copy data to the queue. Only the producer may call this.
+			 *
+			 * @return Whether the data was added, or false if the queue
+			 *         is full (or if out of memory), in which case none
+			 *         of it was added.
+			 */
+			bool
+			append(const char *data, unsigned int size) {
+				if (!flush()) {
+					return false;
+				}
+				while (size > 0) {
+					unsigned int space;
+					char *buffer = reserve(space);
+					if (buffer == NULL) {
+						return false;
+					}
+					if (space > size) {
+						space = size;
+					}
+					memcpy(buffer, data, space);
+					commit(space);
+					data += space;
+					size -= space;
+				}
+				flush();
+				return true;
+			}
+
+			/**
+			 * Move full chunks to the queue. Only the producer may call
+			 * this. When the queue is full, the next pull() asks the
+			 * caller to resume the producer.
+			 *
+			 * @return Whether every full chunk is in the queue.
+			 */
+			bool
+			flush() {
+				while (!pending.empty() && queue.push(pending.front())) {
+					pending.pop_front();
+				}
+				if (pending.empty()) {
+					return true;
+				}
+
+				OSL::Atomic::store(waiting, 1);
+				// The consumer may have made room before it saw that
+				while (!pending.empty() && queue.push(pending.front())) {
+					pending.pop_front();
+				}
+				return pending.empty();
+			}
+
+			/**
+			 * Hand the remaining data over once the download is done.
+			 * The producer may not use the queue anymore afterwards.
+			 */
+			void
+			finish() {
+				if (current.size > 0) {
+					current.data[current.size] = '\0';
+					pending.push_back(current);
+				} else {
+					free(current.data);
+				}
+				current.data = NULL;
+				current.size = 0;
+				rest.splice(rest.end(), pending);
+				OSL::Atomic::store(finished, 1);
+			}
+
+			/**
+			 * Put data in front of the queue, which will be pulled
+			 * first. Only the consumer may call this.
+			 */
+			void
+			prepend(const char *data, unsigned int size) {
+				assert(head.data == NULL);
+				head.data = (char *) malloc(size + 1);
+				if (head.data != NULL) {
+					memcpy(head.data, data, size);
+					head.data[size] = '\0';
+					head.size = size;
+					headOffset = 0;
+				}
+			}
+
+			/**
+			 * Take the next chunk. Only the consumer may call this.
+			 *
+			 * @param chunk   [out] The chunk, which the caller must free().
+			 * @param resume  [out] Whether the producer waits for room,
+			 *                which it has now.
+			 * @return The size of the chunk, 0 if the producer finished
+			 *         and everything was pulled, or -1 if the queue is
+			 *         empty.
+			 */
+			int
+			pull(char *&chunk, bool &resume) {
+				Chunk next;
+				int result;
+
+				if (head.data != NULL) {
+					result = head.size - headOffset;
+					memmove(head.data, head.data + headOffset, result + 1);
+					chunk = head.data;
+					head.data = NULL;
+				} else {
+					result = takeChunk(next);
+					if (result > 0) {
+						chunk = next.data;
+						result = next.size;
+					}
+				}
+				resume = checkWaiting();
+				return result;
+			}
+
+			/**
+			 * Copy data from the queue. Only the consumer may call this.
+			 *
+			 * @return The number of bytes put into buf, like pull().
+			 */
+			int
+			pull(void *buf, unsigned int size, bool &resume) {
+				if (head.data == NULL) {
+					int found = takeChunk(head);
+					headOffset = 0;
+					if (found <= 0) {
+						head.data = NULL;
+						resume = checkWaiting();
+						return found;
+					}
+				}
+
+				unsigned int result = head.size - headOffset;
+				if (result > size) {
+					result = size;
+				}
+				memcpy(buf, head.data + headOffset, result);
+				headOffset += result;
+				if (headOffset == head.size) {
+					free(head.data);
+					head.data = NULL;
+				}
+				resume = checkWaiting();
+				return result;
+			}
+
+		private:
+			bool
+			checkWaiting() {
+				int expected = 1;
+				return OSL::Atomic::load(waiting)
+					&& OSL::Atomic::compareAndSwap(waiting, expected, 0);
+			}
+		};
+
 		#ifdef WIN32
 			#include "win32/http-reader.cpp"
 			#define NativeHttpReader WinHttpReader
@@ -18,6 +18,57 @@
 
 using namespace std;
 
+class Private;
+
+/**
+ * The thread which runs the transfers of every UnixHttpReader, through a
+ * single curl multi handle. Transfers to the same server reuse its open
+ * connections, and are multiplexed over one connection when the server
+ * speaks HTTP/2, instead of each costing a thread and a TLS handshake.
+ *
+ * Other threads hand transfers over with submit() and cancel(), and wake
+ * the thread up through a pipe which it waits for along with the sockets.
+ */
+class CurlWorker {
+private:
+	static pthread_mutex_t mutex;
+	static bool started;
+	static CURLM *multi;
+	static int wakeupPipe[2];
+	/**
+	 * Transfers which the thread hasn't added to the multi handle yet, and
+	 * transfers which the thread must stop. They're never freed, since the
+	 * thread may still use them while the process exits.
+	 */
+	static list<Private *> *submitted;
+	static list<Private *> *cancelled;
+	static list<Private *> *resumed;
+
+	static bool start();
+	static void wakeup();
+	static void takeRequests();
+	static void *threadEntry(void *user_data);
+
+public:
+	/**
+	 * Start a transfer. The worker keeps a reference to it until it is
+	 * done or cancelled.
+	 *
+	 * @return Whether the worker thread is running.
+	 */
+	static bool submit(Private *priv);
+
+	/**
+	 * Stop a transfer, if it isn't done yet.
+	 */
+	static void cancel(Private *priv);
+
+	/**
+	 * Continue a transfer which paused because its chunk queue was full.
+	 */
+	static void resume(Private *priv);
+};
+
 /**
  * A private class used by UnixHttpReader. Most of the logic are
  * contained in this class.
@@ -32,7 +83,7 @@ class Private: public HttpReader {
 private:
 	unsigned int refCount;
 	HttpReaderStatus status;
-	char *error;
+	const char *error;
 	char errorBuffer[CURL_ERROR_SIZE];
 	int size;
 
@@ -44,10 +95,11 @@ private:
 	char *userAgent;
 	bool mutexInitialized;
 	pthread_mutex_t mutex;
-	pthread_t thread;
 
 	CURL *handle;
 	string downloadBuffer;
+	/** The download buffer in streaming mode, NULL otherwise. */
+	ChunkQueue *chunks;
 
 	static size_t
 	writeCallback(void *ptr, size_t size, size_t nmemb, void *user_data) {
@@ -56,7 +108,13 @@ private:
 		self->lock();
 
 		self->status = HTTP_READER_DOWNLOADING;
-		self->downloadBuffer.append(static_cast<const char *>(ptr), size * nmemb);
+		if (self->chunks == NULL) {
+			self->downloadBuffer.append(static_cast<const char *>(ptr), size * nmemb);
+		} else if (!self->chunks->append(static_cast<const char *>(ptr), size * nmemb)) {
+			// Curl keeps the data and delivers it again once resumed
+			self->unlock();
+			return CURL_WRITEFUNC_PAUSE;
+		}
 
 		if (self->size == -1) {
 			double length;
@@ -71,49 +129,13 @@ private:
 		return size * nmemb;
 	}
 
-	/**
-	 * @require this->size == -1 && this->status == HTTP_READER_CONNECTING
-	 */
-	static void *
-	threadEntry(void *user_data) {
-		Private *self = (Private *) user_data;
-
-		self->handle = curl_easy_init();
-		if (self->handle != NULL) {
-			curl_easy_setopt(self->handle, CURLOPT_URL, self->url);
-			curl_easy_setopt(self->handle, CURLOPT_FOLLOWLOCATION, 1);
-			curl_easy_setopt(self->handle, CURLOPT_USERAGENT, self->userAgent);
-			curl_easy_setopt(self->handle, CURLOPT_WRITEFUNCTION, writeCallback);
-			curl_easy_setopt(self->handle, CURLOPT_WRITEDATA, self);
-			curl_easy_setopt(self->handle, CURLOPT_FAILONERROR, 1);
-			curl_easy_setopt(self->handle, CURLOPT_ERRORBUFFER, self->errorBuffer);
-			if (self->postData != NULL) {
-				curl_easy_setopt(self->handle, CURLOPT_POST, 1);
-				curl_easy_setopt(self->handle, CURLOPT_POSTFIELDS, self->postData);
-				curl_easy_setopt(self->handle, CURLOPT_POSTFIELDSIZE, self->postDataSize);
-			}
-
-			if (curl_easy_perform(self->handle) == 0) {
-				self->lock();
-				self->status = HTTP_READER_DONE;
-				self->unlock();
-			} else {
-				self->lock();
-				self->status = HTTP_READER_ERROR;
-				self->error = self->errorBuffer;
-				self->size = -2;
-				self->unlock();
-			}
-		} else {
-			self->lock();
-			self->status = HTTP_READER_ERROR;
-			self->error = "Cannot initialize libcurl.";
-			self->size = -2;
-			self->unlock();
-		}
-
-		self->unref();
-		return NULL;
+	void
+	fail(const char *message) {
+		lock();
+		status = HTTP_READER_ERROR;
+		error = message;
+		size = -2;
+		unlock();
 	}
 
 	void
@@ -131,12 +153,17 @@ private:
 	}
 
 public:
+	/** Whether the transfer is in the multi handle. Only used by CurlWorker's thread. */
+	bool inMulti;
+
 	Private(const char *url, const char *postData, int postDataSize, const char *userAgent) {
 		refCount = 1;
 		this->url = NULL;
 		this->postData = NULL;
 		this->userAgent = NULL;
 		handle = NULL;
+		chunks = NULL;
+		inMulti = false;
 		status = HTTP_READER_ERROR;
 		size = -2;
 
@@ -148,17 +175,6 @@ public:
 			mutexInitialized = true;
 		}
 
-		pthread_attr_t attr;
-		if (pthread_attr_init(&attr) != 0) {
-			error = "Cannot create thread attribute object.";
-			return;
-		}
-		if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) != 0) {
-			pthread_attr_destroy(&attr);
-			error = "Cannot set thread attribute to detached.";
-			return;
-		}
-
 		this->url = strdup(url);
 		if (postData != NULL) {
 			if (postDataSize == -1) {
@@ -175,13 +191,39 @@ public:
 		}
 		this->userAgent = strdup(userAgent);
 
+		handle = curl_easy_init();
+		if (handle == NULL) {
+			error = "Cannot initialize libcurl.";
+			return;
+		}
+		curl_easy_setopt(handle, CURLOPT_URL, this->url);
+		curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1);
+		curl_easy_setopt(handle, CURLOPT_USERAGENT, this->userAgent);
+		curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, writeCallback);
+		curl_easy_setopt(handle, CURLOPT_WRITEDATA, this);
+		curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1);
+		curl_easy_setopt(handle, CURLOPT_ERRORBUFFER, errorBuffer);
+		curl_easy_setopt(handle, CURLOPT_PRIVATE, this);
+		// Signals don't mix with threads; DNS lookups can't time out without them
+		curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+		#if LIBCURL_VERSION_NUM >= 0x072f00
+			// HTTP/2 for HTTPS servers which support it, HTTP/1.1 otherwise
+			curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, (long) CURL_HTTP_VERSION_2TLS);
+		#endif
+		#if LIBCURL_VERSION_NUM >= 0x072b00
+			// Rather wait for a connection which can be multiplexed than open another one
+			curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+		#endif
+		if (this->postData != NULL) {
+			curl_easy_setopt(handle, CURLOPT_POST, 1);
+			curl_easy_setopt(handle, CURLOPT_POSTFIELDS, this->postData);
+			curl_easy_setopt(handle, CURLOPT_POSTFIELDSIZE, this->postDataSize);
+		}
+
 		status = HTTP_READER_CONNECTING;
 		error = NULL;
 		size = -1;
-		ref();
-		if (pthread_create(&thread, &attr, threadEntry, this) != 0) {
-			unref();
-			pthread_attr_destroy(&attr);
+		if (!CurlWorker::submit(this)) {
 			status = HTTP_READER_ERROR;
 			error = "Cannot create a thread.";
 			size = -2;
@@ -197,10 +239,33 @@ public:
 			free(userAgent);
 		if (handle != NULL)
 			curl_easy_cleanup(handle);
+		if (chunks != NULL)
+			delete chunks;
 		if (mutexInitialized)
 			pthread_mutex_destroy(&mutex);
 	}
 
+	CURL *
+	getHandle() const {
+		return handle;
+	}
+
+	/**
+	 * Called by CurlWorker's thread when the transfer is done.
+	 */
+	void
+	finish(CURLcode result) {
+		if (result == CURLE_OK) {
+			lock();
+			if (chunks != NULL)
+				chunks->finish();
+			status = HTTP_READER_DONE;
+			unlock();
+		} else {
+			fail(errorBuffer[0] != '\0' ? errorBuffer : curl_easy_strerror(result));
+		}
+	}
+
 	/**
 	 * Increase the reference count by 1.
 	 */
@@ -252,6 +317,12 @@ public:
 	pullData(void *buf, unsigned int size) {
 		int result;
 
+		if (chunks != NULL) {
+			bool resume;
+			result = chunks->pull(buf, size, resume);
+			return finishPull(result, resume);
+		}
+
 		lock();
 
 		switch (status) {
@@ -292,6 +363,46 @@ public:
 		return result;
 	}
 
+	virtual void
+	setStreaming() {
+		lock();
+		if (chunks == NULL) {
+			chunks = new ChunkQueue();
+			if (!downloadBuffer.empty()) {
+				chunks->prepend(downloadBuffer.data(), downloadBuffer.size());
+				string().swap(downloadBuffer);
+			}
+		}
+		unlock();
+	}
+
+	virtual int
+	pullChunk(char *&chunk) {
+		assert(chunks != NULL);
+		bool resume;
+		int result = chunks->pull(chunk, resume);
+		return finishPull(result, resume);
+	}
+
+	/**
+	 * The part of pulling from the chunk queue which needs the lock:
+	 * resuming the transfer, and telling an error from an empty queue.
+	 */
+	int
+	finishPull(int result, bool resume) {
+		if (resume) {
+			CurlWorker::resume(this);
+		}
+		if (result == -1) {
+			lock();
+			if (status == HTTP_READER_ERROR) {
+				result = -2;
+			}
+			unlock();
+		}
+		return result;
+	}
+
 	virtual const char *
 	getData(unsigned int &len) const {
 		len = downloadBuffer.size();
@@ -310,6 +421,199 @@ public:
 };
 
 
+
+pthread_mutex_t CurlWorker::mutex = PTHREAD_MUTEX_INITIALIZER;
+bool CurlWorker::started = false;
+CURLM *CurlWorker::multi = NULL;
+int CurlWorker::wakeupPipe[2];
+list<Private *> *CurlWorker::submitted = NULL;
+list<Private *> *CurlWorker::cancelled = NULL;
+list<Private *> *CurlWorker::resumed = NULL;
+
+/**
+ * @require mutex is locked.
+ */
+bool
+CurlWorker::start() {
+	pthread_attr_t attr;
+	pthread_t thread;
+
+	multi = curl_multi_init();
+	if (multi == NULL) {
+		return false;
+	}
+	#ifdef CURLPIPE_MULTIPLEX
+		curl_multi_setopt(multi, CURLMOPT_PIPELINING, (long) CURLPIPE_MULTIPLEX);
+	#endif
+
+	if (pipe(wakeupPipe) == -1) {
+		curl_multi_cleanup(multi);
+		return false;
+	}
+	fcntl(wakeupPipe[0], F_SETFL, fcntl(wakeupPipe[0], F_GETFL) | O_NONBLOCK);
+	fcntl(wakeupPipe[1], F_SETFL, fcntl(wakeupPipe[1], F_GETFL) | O_NONBLOCK);
+	submitted = new list<Private *>();
+	cancelled = new list<Private *>();
+	resumed = new list<Private *>();
+
+	if (pthread_attr_init(&attr) == 0) {
+		if (pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED) == 0
+		 && pthread_create(&thread, &attr, threadEntry, NULL) == 0) {
+			started = true;
+		}
+		pthread_attr_destroy(&attr);
+	}
+	if (!started) {
+		close(wakeupPipe[0]);
+		close(wakeupPipe[1]);
+		curl_multi_cleanup(multi);
+		multi = NULL;
+		delete submitted;
+		delete cancelled;
+		delete resumed;
+	}
+	return started;
+}
+
+void
+CurlWorker::wakeup() {
+	char c = 0;
+	// When the pipe is full, the thread wakes up anyway
+	ssize_t result = write(wakeupPipe[1], &c, 1);
+	(void) result;
+}
+
+bool
+CurlWorker::submit(Private *priv) {
+	pthread_mutex_lock(&mutex);
+	if (!started && !start()) {
+		pthread_mutex_unlock(&mutex);
+		return false;
+	}
+	priv->ref();
+	submitted->push_back(priv);
+	pthread_mutex_unlock(&mutex);
+	wakeup();
+	return true;
+}
+
+void
+CurlWorker::cancel(Private *priv) {
+	bool wasSubmitted = false;
+
+	pthread_mutex_lock(&mutex);
+	if (!started) {
+		pthread_mutex_unlock(&mutex);
+		return;
+	}
+	for (list<Private *>::iterator it = submitted->begin(); it != submitted->end(); it++) {
+		if (*it == priv) {
+			submitted->erase(it);
+			wasSubmitted = true;
+			break;
+		}
+	}
+	if (!wasSubmitted) {
+		// The thread may still be working on it
+		priv->ref();
+		cancelled->push_back(priv);
+	}
+	pthread_mutex_unlock(&mutex);
+
+	if (wasSubmitted) {
+		priv->unref();
+	} else {
+		wakeup();
+	}
+}
+
+void
+CurlWorker::resume(Private *priv) {
+	pthread_mutex_lock(&mutex);
+	priv->ref();
+	resumed->push_back(priv);
+	pthread_mutex_unlock(&mutex);
+	wakeup();
+}
+
+void
+CurlWorker::takeRequests() {
+	list<Private *> newTransfers, stoppedTransfers, resumedTransfers;
+	char buffer[64];
+
+	while (read(wakeupPipe[0], buffer, sizeof(buffer)) > 0);
+
+	pthread_mutex_lock(&mutex);
+	newTransfers.swap(*submitted);
+	stoppedTransfers.swap(*cancelled);
+	resumedTransfers.swap(*resumed);
+	pthread_mutex_unlock(&mutex);
+
+	for (list<Private *>::iterator it = newTransfers.begin(); it != newTransfers.end(); it++) {
+		Private *priv = *it;
+		CURLMcode result = curl_multi_add_handle(multi, priv->getHandle());
+		if (result == CURLM_OK) {
+			priv->inMulti = true;
+		} else {
+			priv->finish(CURLE_FAILED_INIT);
+			priv->unref();
+		}
+	}
+
+	for (list<Private *>::iterator it = stoppedTransfers.begin(); it != stoppedTransfers.end(); it++) {
+		Private *priv = *it;
+		if (priv->inMulti) {
+			curl_multi_remove_handle(multi, priv->getHandle());
+			priv->inMulti = false;
+			priv->unref();
+		}
+		priv->unref();
+	}
+
+	for (list<Private *>::iterator it = resumedTransfers.begin(); it != resumedTransfers.end(); it++) {
+		Private *priv = *it;
+		if (priv->inMulti) {
+			// This may call the write callback, which may pause it again
+			curl_easy_pause(priv->getHandle(), CURLPAUSE_CONT);
+		}
+		priv->unref();
+	}
+}
+
+void *
+CurlWorker::threadEntry(void *user_data) {
+	while (true) {
+		struct curl_waitfd wakeupFd;
+		CURLMsg *message;
+		int running, left;
+
+		takeRequests();
+		curl_multi_perform(multi, &running);
+
+		while ((message = curl_multi_info_read(multi, &left)) != NULL) {
+			if (message->msg == CURLMSG_DONE) {
+				CURL *handle = message->easy_handle;
+				CURLcode result = message->data.result;
+				char *pointer;
+				Private *priv;
+
+				curl_easy_getinfo(handle, CURLINFO_PRIVATE, &pointer);
+				priv = (Private *) pointer;
+				curl_multi_remove_handle(multi, handle);
+				priv->inMulti = false;
+				priv->finish(result);
+				priv->unref();
+			}
+		}
+
+		wakeupFd.fd = wakeupPipe[0];
+		wakeupFd.events = CURL_WAIT_POLLIN;
+		wakeupFd.revents = 0;
+		curl_multi_wait(multi, &wakeupFd, 1, 1000, NULL);
+	}
+	return NULL;
+}
+
 class UnixHttpReader: public StdHttpReader {
 private:
 	Private *priv;
@@ -322,6 +626,7 @@ public:
 	}
 
 	~UnixHttpReader() {
+		CurlWorker::cancel(priv);
 		priv->unref();
 	}
 
@@ -344,6 +649,17 @@ public:
 		return priv->pullData(buf, size);
 	}
 
+	virtual void
+	setStreaming() {
+		priv->setStreaming();
+	}
+
+	virtual int
+	pullChunk(char *&chunk) {
+		assert(getStatus() != HTTP_READER_CONNECTING);
+		return priv->pullChunk(chunk);
+	}
+
 	virtual const char *
 	getData(unsigned int &len) const {
 		assert(getStatus() == HTTP_READER_DONE);
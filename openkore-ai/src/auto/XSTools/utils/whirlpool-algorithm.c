@@ -14,9 +14,20 @@
  *
  * Modified for use in this software package.
  */
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
 #include "whirlpool-algorithm.h"
 #include "whirlpool-portability.h"
 #include "whirlpool-constants.h"
@@ -27,16 +38,15 @@ extern "C" {
 
 
 /**
- * The core Whirlpool transform.
+ * The core Whirlpool transform, of a block of WBLOCKBYTES bytes.
  */
 static void
-processBuffer(WP_Struct * const structpointer) {
+processBlock(WP_Struct * const structpointer, const u8 *buffer) {
     int i, r;
     u64 K[8];        /* the round key */
     u64 block[8];    /* mu(buffer) */
     u64 state[8];    /* the cipher state */
     u64 L[8];
-    u8 *buffer = structpointer->buffer;
 
     /*
      * map the buffer to a block:
@@ -258,6 +268,11 @@ processBuffer(WP_Struct * const structpointer) {
     structpointer->hash[7] ^= state[7] ^ block[7];
 }
 
+static void
+processBuffer(WP_Struct * const structpointer) {
+    processBlock(structpointer, structpointer->buffer);
+}
+
 WP_Struct *
 WP_Create() {
 	WP_Struct *wp;
@@ -398,6 +413,137 @@ void WP_Add(const unsigned char * const source,
     structpointer->bufferPos    = bufferPos;
 }
 
+void WP_AddBytes(const unsigned char *source,
+                 unsigned long sourceBytes,
+                 WP_Struct * const structpointer) {
+    u8 *buffer       = structpointer->buffer;
+    u8 *bitLength    = structpointer->bitLength;
+    int bufferPos    = structpointer->bufferPos;
+    unsigned long count;
+    u64 value;
+    u32 carry;
+    int i;
+
+    if (structpointer->bufferBits & 7) {
+        /* not on a byte boundary, after WP_Add() of a partial byte */
+        while (sourceBytes > 0) {
+            count = sourceBytes < ULONG_MAX / 8 ? sourceBytes : ULONG_MAX / 8;
+            WP_Add(source, count * 8, structpointer);
+            source += count;
+            sourceBytes -= count;
+        }
+        return;
+    }
+
+    /*
+     * tally the length of the added data, in bits:
+     */
+    value = (u64)sourceBytes << 3;
+    for (i = 31, carry = 0; i >= 0 && (carry != 0 || value != LL(0)); i--) {
+        carry += bitLength[i] + ((u32)value & 0xff);
+        bitLength[i] = (u8)carry;
+        carry >>= 8;
+        value >>= 8;
+    }
+    /*
+     * complete the buffer, then hash the whole blocks where they are:
+     */
+    if (bufferPos > 0) {
+        count = WBLOCKBYTES - bufferPos;
+        if (count > sourceBytes) {
+            count = sourceBytes;
+        }
+        memcpy(&buffer[bufferPos], source, count);
+        bufferPos += (int)count;
+        source += count;
+        sourceBytes -= count;
+        if (bufferPos == WBLOCKBYTES) {
+            processBuffer(structpointer);
+            bufferPos = 0;
+        }
+    }
+    while (sourceBytes >= WBLOCKBYTES) {
+        processBlock(structpointer, source);
+        source += WBLOCKBYTES;
+        sourceBytes -= WBLOCKBYTES;
+    }
+    if (sourceBytes > 0) {
+        memcpy(&buffer[bufferPos], source, sourceBytes);
+        bufferPos += (int)sourceBytes;
+    }
+    buffer[bufferPos] = 0; /* WP_Add() and WP_Finalize() OR bits into it */
+    structpointer->bufferBits   = bufferPos * 8;
+    structpointer->bufferPos    = bufferPos;
+}
+
+int WP_AddFile(const char *filename, WP_Struct * const structpointer) {
+    unsigned char chunk[64 * 1024];
+    size_t count;
+    FILE *file;
+
+#ifdef WIN32
+    HANDLE handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (handle == INVALID_HANDLE_VALUE) {
+        return 0;
+    }
+    if (GetFileSizeEx(handle, &size) && size.QuadPart == 0) {
+        CloseHandle(handle);
+        return 1;
+    }
+    if (GetFileSizeEx(handle, &size) && size.QuadPart <= (LONGLONG)ULONG_MAX) {
+        HANDLE mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping) {
+            const unsigned char *base = (const unsigned char *) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            if (base) {
+                WP_AddBytes(base, (unsigned long)size.QuadPart, structpointer);
+                UnmapViewOfFile(base);
+                CloseHandle(mapping);
+                CloseHandle(handle);
+                return 1;
+            }
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(handle);
+#else
+    struct stat st;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        if (st.st_size == 0) {
+            close(fd);
+            return 1;
+        }
+        if ((unsigned long long)st.st_size <= ULONG_MAX) {
+            void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (base != MAP_FAILED) {
+                WP_AddBytes((const unsigned char *) base, (unsigned long)st.st_size, structpointer);
+                munmap(base, st.st_size);
+                close(fd);
+                return 1;
+            }
+        }
+    }
+    close(fd);
+#endif /* WIN32 */
+
+    /* files that can't be mapped are read */
+    file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        WP_AddBytes(chunk, (unsigned long)count, structpointer);
+    }
+    count = ferror(file);
+    fclose(file);
+    return !count;
+}
+
 void WP_Finalize(WP_Struct * const structpointer,
                     unsigned char * const result) {
     int i;
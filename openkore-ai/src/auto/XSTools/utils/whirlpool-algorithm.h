@@ -57,6 +57,29 @@ void       WP_Add(const unsigned char * const source,
                   unsigned long sourceBits,
                   WP_Struct * const wp);
 
+/**
+ * Delivers whole bytes to the hashing algorithm, as WP_Add(source, sourceBytes * 8, wp) but
+ * hashing the full blocks straight from source, when the data added before is whole bytes too.
+ *
+ * @param source       Plaintext data to hash.
+ * @param sourceBytes  How many bytes of plaintext to process.
+ * @param wp           A WP_Struct handle, as created by WP_Create()
+ * @require source != NULL || sourceBytes == 0, wp != NULL
+ */
+void       WP_AddBytes(const unsigned char *source,
+                       unsigned long sourceBytes,
+                       WP_Struct * const wp);
+
+/**
+ * Delivers the contents of a file to the hashing algorithm, mapped in memory when possible.
+ *
+ * @param filename  The name of the file.
+ * @param wp        A WP_Struct handle, as created by WP_Create()
+ * @return 1 on success, 0 if the file can't be read, after adding whatever was read.
+ * @require filename != NULL && wp != NULL
+ */
+int        WP_AddFile(const char *filename, WP_Struct * const wp);
+
 /**
  * Get the hash value from the hashing state.
  *
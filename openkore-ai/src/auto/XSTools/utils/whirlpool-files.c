@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+#include "whirlpool-files.h"
+#include "c-bindings/executor.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define WP_MAX_THREADS 16
+
+#ifdef WIN32
+	typedef CRITICAL_SECTION JobMutex;
+	#define jobLock(mutex) EnterCriticalSection(mutex)
+	#define jobUnlock(mutex) LeaveCriticalSection(mutex)
+#else
+	typedef pthread_mutex_t JobMutex;
+	#define jobLock(mutex) pthread_mutex_lock(mutex)
+	#define jobUnlock(mutex) pthread_mutex_unlock(mutex)
+#endif /* WIN32 */
+
+/* The files of a WP_HashFiles() call, which its threads take one by one */
+typedef struct {
+	JobMutex mutex;
+	const char * const *filenames;
+	unsigned int count;
+	unsigned int next;
+	unsigned char *hashes;
+	int *ok;
+} HashJob;
+
+static void
+hashFiles(HashJob *job)
+{
+	WP_Struct *wp = WP_Create();
+	unsigned int i;
+
+	while (1) {
+		jobLock(&job->mutex);
+		i = job->next++;
+		jobUnlock(&job->mutex);
+		if (i >= job->count) {
+			break;
+		}
+		if (wp == NULL) {
+			job->ok[i] = 0;
+			continue;
+		}
+		WP_Init(wp);
+		job->ok[i] = WP_AddFile(job->filenames[i], wp);
+		WP_Finalize(wp, job->hashes + i * WP_DIGEST_SIZE);
+	}
+	if (wp != NULL) {
+		WP_Free(wp);
+	}
+}
+
+static void
+hashFilesEntry(void *job)
+{
+	hashFiles((HashJob *) job);
+}
+
+void
+WP_HashFiles(const char * const *filenames, unsigned int count,
+             unsigned char *hashes, int *ok, int threads)
+{
+	HashJob job;
+
+	if (threads <= 0) {
+		threads = WP_MAX_THREADS;
+	}
+	if ((unsigned int) threads > count) {
+		threads = (int) count;
+	}
+	if (threads > 1) {
+		o_executor_start(0);
+	}
+
+	job.filenames = filenames;
+	job.count = count;
+	job.next = 0;
+	job.hashes = hashes;
+	job.ok = ok;
+#ifdef WIN32
+	InitializeCriticalSection(&job.mutex);
+#else
+	pthread_mutex_init(&job.mutex, NULL);
+#endif
+
+	/* The calling thread is one of the threads; if the pool is busy it hashes more files */
+	o_executor_parallel(hashFilesEntry, &job, threads > 0 ? (unsigned int) threads : 1);
+
+#ifdef WIN32
+	DeleteCriticalSection(&job.mutex);
+#else
+	pthread_mutex_destroy(&job.mutex);
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,28 @@
+#ifndef _WHIRLPOOL_FILES_H_
+#define _WHIRLPOOL_FILES_H_
+
+#include "whirlpool-algorithm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Calculate the Whirlpool hashes of many files at once, on the calling thread and
+ * the threads of the shared pool (see c-bindings/executor.h).
+ *
+ * @param filenames  The names of the files.
+ * @param count      The number of files.
+ * @param hashes     Receives the hash of file i at hashes + i * WP_DIGEST_SIZE.
+ * @param ok         Receives, for each file, 1 if it could be read, 0 if not.
+ * @param threads    The number of threads to use at most, 0 for as many as the pool has.
+ * @require filenames, hashes and ok hold count items.
+ */
+void WP_HashFiles(const char * const *filenames, unsigned int count,
+                  unsigned char *hashes, int *ok, int threads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _WHIRLPOOL_FILES_H_ */
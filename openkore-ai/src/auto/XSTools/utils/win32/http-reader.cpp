@@ -30,6 +30,11 @@ private:
 	int postDataSize;
 	CRITICAL_SECTION lock;
 	std::string downloadBuffer;
+	/** The download buffer in streaming mode, NULL otherwise. */
+	ChunkQueue *chunks;
+	/** Signalled when the thread may continue filling the chunk queue. */
+	HANDLE resumeEvent;
+	bool stopping;
 	HttpReaderStatus status;
 	char *error;
 	bool errorMustBeFreed;
@@ -181,17 +186,57 @@ private:
 		DWORD bytesRead;
 
 		do {
-			success = InternetReadFile(self->openHandle, buf,
-						   sizeof(buf), &bytesRead);
-			if (bytesRead > 0) {
-				EnterCriticalSection(&self->lock);
-				self->downloadBuffer.append(buf, bytesRead);
-				LeaveCriticalSection(&self->lock);
+			ChunkQueue *chunks;
+
+			EnterCriticalSection(&self->lock);
+			chunks = self->chunks;
+			LeaveCriticalSection(&self->lock);
+
+			if (chunks == NULL) {
+				success = InternetReadFile(self->openHandle, buf,
+							   sizeof(buf), &bytesRead);
+				if (bytesRead > 0) {
+					EnterCriticalSection(&self->lock);
+					chunks = self->chunks;
+					if (chunks == NULL) {
+						self->downloadBuffer.append(buf, bytesRead);
+					}
+					LeaveCriticalSection(&self->lock);
+
+					// setStreaming() was called during the read
+					while (chunks != NULL && !chunks->append(buf, bytesRead)) {
+						if (!self->waitForRoom())
+							return 0;
+					}
+				}
+			} else {
+				// Read straight into the last chunk
+				char *space;
+				unsigned int spaceSize;
+
+				while (!chunks->flush()) {
+					if (!self->waitForRoom())
+						return 0;
+				}
+				space = chunks->reserve(spaceSize);
+				if (space == NULL) {
+					success = FALSE;
+					break;
+				}
+				success = InternetReadFile(self->openHandle, space,
+							   spaceSize, &bytesRead);
+				if (bytesRead > 0) {
+					chunks->commit(bytesRead);
+				}
 			}
 		} while (success && bytesRead != 0);
 
 		if (success) {
+			EnterCriticalSection(&self->lock);
+			if (self->chunks != NULL)
+				self->chunks->finish();
 			self->status = HTTP_READER_DONE;
+			LeaveCriticalSection(&self->lock);
 		} else {
 			EnterCriticalSection(&self->lock);
 			self->status = HTTP_READER_ERROR;
@@ -202,6 +247,37 @@ private:
 		return 0;
 	}
 
+	/**
+	 * Wait until the consumer pulled data from the full chunk queue.
+	 *
+	 * @return false if the thread must stop.
+	 */
+	bool
+	waitForRoom() {
+		// The timeout covers a consumer which pulled before we started waiting
+		WaitForSingleObject(resumeEvent, 100);
+		return !stopping;
+	}
+
+	/**
+	 * The part of pulling from the chunk queue which needs the lock:
+	 * resuming the thread, and telling an error from an empty queue.
+	 */
+	int
+	finishPull(int result, bool resume) {
+		if (resume) {
+			SetEvent(resumeEvent);
+		}
+		if (result == -1) {
+			EnterCriticalSection(&lock);
+			if (status == HTTP_READER_ERROR) {
+				result = -2;
+			}
+			LeaveCriticalSection(&lock);
+		}
+		return result;
+	}
+
 public:
 	WinHttpReader(const char *url,
 		      const char *postData,
@@ -216,8 +292,11 @@ public:
 		size = -2;
 		this->postData = NULL;
 		this->postDataSize = 0;
+		chunks = NULL;
+		stopping = false;
 
 		InitializeCriticalSection(&lock);
+		resumeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
 
 		inetHandle = InternetOpen(userAgent, INTERNET_OPEN_TYPE_PRECONFIG,
 				      NULL, NULL, 0);
@@ -308,6 +387,9 @@ public:
 	}
 
 	~WinHttpReader() {
+		stopping = true;
+		if (resumeEvent != NULL)
+			SetEvent(resumeEvent);
 		if (inetHandle != NULL)
 			InternetCloseHandle(inetHandle);
 		if (connectHandle != NULL)
@@ -320,6 +402,10 @@ public:
 		}
 		if (this->postData != NULL)
 			free(this->postData);
+		if (resumeEvent != NULL)
+			CloseHandle(resumeEvent);
+		if (chunks != NULL)
+			delete chunks;
 	}
 
 	virtual HttpReaderStatus
@@ -350,6 +436,12 @@ public:
 		assert(size > 0);
 		int result;
 
+		if (chunks != NULL) {
+			bool resume;
+			result = chunks->pull(buf, size, resume);
+			return finishPull(result, resume);
+		}
+
 		EnterCriticalSection(&lock);
 
 		switch (status) {
@@ -389,6 +481,28 @@ public:
 		return result;
 	}
 
+	virtual void
+	setStreaming() {
+		EnterCriticalSection(&lock);
+		if (chunks == NULL) {
+			chunks = new ChunkQueue();
+			if (!downloadBuffer.empty()) {
+				chunks->prepend(downloadBuffer.data(), downloadBuffer.size());
+				std::string().swap(downloadBuffer);
+			}
+		}
+		LeaveCriticalSection(&lock);
+	}
+
+	virtual int
+	pullChunk(char *&chunk) {
+		assert(status != HTTP_READER_CONNECTING);
+		assert(chunks != NULL);
+		bool resume;
+		int result = chunks->pull(chunk, resume);
+		return finishPull(result, resume);
+	}
+
 	virtual const char *
 	getData(unsigned int &len) const {
 		assert(status == HTTP_READER_DONE);
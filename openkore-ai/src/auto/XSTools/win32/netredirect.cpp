@@ -6,6 +6,8 @@
 
 #include <stdio.h>
 #include "common.h"
+#include "ringbuffer.h"
+#include "xkore-shm.h"
 #include <string>
 #include <string.h>
 
@@ -27,8 +29,9 @@ MyGetProcAddressProc	OriginalGetProcAddressProc = (MyGetProcAddressProc) GetProc
 bool enableDebug = false;
 
 
-// Connection to the X-Kore server that Kore created
+// Connection to the X-Kore server that Kore created, or the shared memory Kore offers instead
 static SOCKET koreClient = INVALID_SOCKET;
+static XKoreShm *koreShm = NULL;
 static bool koreClientIsAlive = false;
 static CRITICAL_SECTION CS_koreClientIsAlive;
 
@@ -39,43 +42,252 @@ static CRITICAL_SECTION CS_dataAvailableFromKore;
 static SOCKET roServer = INVALID_SOCKET;
 static CRITICAL_SECTION CS_ro;
 
-static CRITICAL_SECTION CS_rosend;
+// The X-Kore thread writes the data to send to the RO client, the RO client's recv() reads it.
+// The RO client's send() and recv() write the data to send to the X-Kore server, the X-Kore thread sends it;
+// CS_send only keeps these two writers apart, the X-Kore thread never waits for them.
+#define SEND_BUF_SIZE (1024 * 1024)
+static RingBuffer roSendBuf (SEND_BUF_SIZE);
+static RingBuffer xkoreSendBuf (SEND_BUF_SIZE);
 static CRITICAL_SECTION CS_send;
-static string roSendBuf("");	// Data to send to the RO client
-static string xkoreSendBuf("");	// Data to send to the X-Kore server
 
-#define SLEEP_TIME 10
+// Wake the X-Kore thread: data from the X-Kore server or the connection closing, data queued in xkoreSendBuf
+static WSAEVENT koreClientEvent = WSA_INVALID_EVENT;
+static HANDLE sendQueuedEvent = NULL;
 
+// How long to wait for the reader of a full buffer before dropping data
+#define SEND_BUF_TIMEOUT 1000
 
-// Process a packet that the X-Kore server sent us
+
+// Waits for the reader while the buffer doesn't have room for len bytes. Returns false if it stays full.
+static bool
+waitForRoom (RingBuffer &ring, unsigned int len)
+{
+	DWORD start = GetTickCount ();
+
+	while (ring.room () < len) {
+		if (GetTickCount () - start > SEND_BUF_TIMEOUT) {
+			debug ("Send buffer full, dropping %u bytes\n", len);
+			return false;
+		}
+		Sleep (1);
+	}
+	return true;
+}
+
+static unsigned int
+totalLength (const WSABUF *buffers, DWORD count)
+{
+	unsigned int len = 0;
+
+	for (DWORD i = 0; i < count; i++)
+		len += buffers[i].len;
+	return len;
+}
+
+// Queues a packet for the X-Kore server, of the first len bytes of the buffers,
+// copied straight from them
 static void
-processPacket (Packet *packet)
-{	
-	switch (packet->ID) {
-	case 'S': // Send a packet to the RO server
-		EnterCriticalSection (&CS_ro);
-		if (roServer != INVALID_SOCKET && isConnected (roServer))
-			OriginalSendProc (roServer, packet->data, packet->len, 0);
-		LeaveCriticalSection (&CS_ro);
-		break;
+queuePacketForKore (char ID, const WSABUF *buffers, DWORD count, unsigned int len)
+{
+	char header[3];
+	unsigned short sLen = (unsigned short) len;
+
+	header[0] = ID;
+	memcpy (header + 1, &sLen, 2);
+	EnterCriticalSection (&CS_send);
+	if (waitForRoom (xkoreSendBuf, len + 3)) {
+		xkoreSendBuf.append (header, 3);
+		for (DWORD i = 0; i < count && len > 0; i++) {
+			unsigned int part = buffers[i].len < len ? buffers[i].len : len;
+
+			xkoreSendBuf.append (buffers[i].buf, part);
+			len -= part;
+		}
+		xkoreSendBuf.commit ();
+	}
+	LeaveCriticalSection (&CS_send);
+	SetEvent (sendQueuedEvent);
+}
 
-	case 'R': // Fool the RO client into thinking that we got a packet from the RO server
-		// We copy the data in this packet into a string
-		// Next time the RO client calls recv(), this packet will be returned, along with
-		// whatever data the RO server sent
-		EnterCriticalSection (&CS_rosend);
-		roSendBuf.append (packet->data, packet->len);
-		LeaveCriticalSection (&CS_rosend);
-		dataAvailableFromKore2 = true;
-		break;
+// Moves data from Kore to the buffers, filling them in order
+static unsigned int
+readFromKore (WSABUF *buffers, DWORD count)
+{
+	unsigned int len = 0;
 
-	case 'K': default: // Keep-alive
-		break;
+	for (DWORD i = 0; i < count; i++) {
+		unsigned int part = roSendBuf.read (buffers[i].buf, buffers[i].len);
+
+		len += part;
+		if (part < buffers[i].len)
+			break;
+	}
+	return len;
+}
+
+
+/*********** Connection to Kore ************/
+
+// Connects to Kore, through shared memory if Kore created it for this process
+static bool
+koreConnect ()
+{
+	koreShm = XKoreShm_open ();
+	if (koreShm != NULL) {
+		debug ("Using shared memory\n");
+		return true;
+	}
+
+	WSAResetEvent (koreClientEvent);
+	koreClient = createSocket (XKORE_SERVER_PORT);
+	if (koreClient != INVALID_SOCKET
+	 && WSAEventSelect (koreClient, koreClientEvent, FD_READ | FD_CLOSE) == SOCKET_ERROR) {
+		closesocket (koreClient);
+		koreClient = INVALID_SOCKET;
+	}
+	return koreClient != INVALID_SOCKET;
+}
+
+static void
+koreDisconnect ()
+{
+	if (koreShm != NULL) {
+		XKoreShm_close (koreShm);
+		koreShm = NULL;
+	}
+	if (koreClient != INVALID_SOCKET) {
+		closesocket (koreClient);
+		koreClient = INVALID_SOCKET;
+	}
+}
+
+static bool
+koreConnected ()
+{
+	if (koreShm != NULL)
+		return XKoreShm_peerAlive (koreShm);
+	return koreClient != INVALID_SOCKET && isConnected (koreClient);
+}
+
+// Reads what Kore sent, with the same results as readSocket()
+static int
+koreRead (char *buf, int len)
+{
+	if (koreShm != NULL) {
+		if (XKoreShm_available (koreShm) > 0)
+			return XKoreShm_read (koreShm, buf, len);
+		return XKoreShm_peerAlive (koreShm) ? SF_NODATA : SF_CLOSED;
+	}
+
+	WSANETWORKEVENTS networkEvents;
+
+	// Resets koreClientEvent; Winsock signals it again while data is left after this read
+	WSAEnumNetworkEvents (koreClient, koreClientEvent, &networkEvents);
+	return readSocket (koreClient, buf, len);
+}
+
+static void
+koreSend (const char *data, unsigned int len)
+{
+	if (koreShm == NULL) {
+		OriginalSendProc (koreClient, (char *) data, len, 0);
+		return;
+	}
+
+	// Wait for Kore to make room, like a blocking send() would
+	DWORD start = GetTickCount ();
+	while (!XKoreShm_write (koreShm, data, len)) {
+		if (!XKoreShm_peerAlive (koreShm) || GetTickCount () - start > SEND_BUF_TIMEOUT) {
+			debug ("Shared memory full, dropping %u bytes\n", len);
+			return;
+		}
+		Sleep (1);
+	}
+}
+
+// Set when Kore sent something or the connection closed
+static HANDLE
+koreEvent ()
+{
+	return koreShm != NULL ? XKoreShm_event (koreShm) : koreClientEvent;
+}
+
+
+// The most packets sent to the RO server with one call
+#define MAX_BATCH 64
+
+// Send packets to the RO server with one call
+static void
+sendToServer (WSABUF *buffers, DWORD count)
+{
+	DWORD sent;
+
+	if (count == 0)
+		return;
+	EnterCriticalSection (&CS_ro);
+	if (roServer != INVALID_SOCKET && isConnected (roServer))
+		OriginalWSASendProc (roServer, buffers, count, &sent, 0, NULL, NULL);
+	LeaveCriticalSection (&CS_ro);
+}
+
+// Process the packets that the X-Kore server sent us, in one pass. Returns the number of
+// bytes used, which leaves out an incomplete packet at the end.
+// The packets for the RO server are sent together, those for the RO client are queued together.
+static int
+processPackets (const char *data, int len)
+{
+	WSABUF toServer[MAX_BATCH];
+	DWORD serverCount = 0;
+	bool toClient = false;
+	Packet *packet;
+	int next;
+	int offset = 0;
+
+	while ((packet = unpackPacket (data + offset, len - offset, next))) {
+		switch (packet->ID) {
+		case 'S': // Send a packet to the RO server
+			if (packet->len == 0)
+				break;
+			if (serverCount == MAX_BATCH) {
+				sendToServer (toServer, serverCount);
+				serverCount = 0;
+			}
+			toServer[serverCount].buf = packet->data;
+			toServer[serverCount].len = packet->len;
+			serverCount++;
+			break;
+
+		case 'R': // Fool the RO client into thinking that we got a packet from the RO server
+			// We copy the data in this packet into a buffer
+			// Next time the RO client calls recv(), this packet will be returned, along with
+			// whatever data the RO server sent
+			// The RO client can only make room for what was committed
+			if (roSendBuf.room () < packet->len)
+				roSendBuf.commit ();
+			if (waitForRoom (roSendBuf, packet->len)) {
+				roSendBuf.append (packet->data, packet->len);
+				toClient = true;
+			}
+			break;
+
+		case 'K': default: // Keep-alive
+			break;
+		}
+		free (packet);
+		offset += next;
 	}
+
+	sendToServer (toServer, serverCount);
+	if (toClient) {
+		roSendBuf.commit ();
+		dataAvailableFromKore2 = true;
+	}
+	return offset;
 }
 
 // Handles the connection between the RO client (this process) and the X-Kore server
-// Note that this function is run in a thread and never exits
+// Note that this function is run in a thread and never exits. It sleeps until the X-Kore server sends
+// something, the RO client queues something to send, or it is time to ping or reconnect.
 static void
 koreConnectionMain ()
 {
@@ -105,19 +317,16 @@ koreConnectionMain ()
 
 		// Attempt to connect to the X-Kore server if necessary
 		EnterCriticalSection (&CS_koreClientIsAlive);
-		koreClientIsAlive = koreClient != INVALID_SOCKET;
+		koreClientIsAlive = koreClient != INVALID_SOCKET || koreShm != NULL;
 		isAlive = koreClientIsAlive; // keep a local copy of that variable so we don't have to enter critical sections over and over
 		LeaveCriticalSection (&CS_koreClientIsAlive);
 
-		if ((!isAlive || !isConnected (koreClient) || GetTickCount () - koreClientTimeout > TIMEOUT)
+		if ((!isAlive || !koreConnected () || GetTickCount () - koreClientTimeout > TIMEOUT)
 		  && GetTickCount () - reconnectTimeout > RECONNECT_INTERVAL) {
 			debug ("Connecting to X-Kore server...\n");
 
-			if (koreClient != INVALID_SOCKET)
-				closesocket (koreClient);
-			koreClient = createSocket (XKORE_SERVER_PORT);
-
-			isAlive = koreClient != INVALID_SOCKET;
+			koreDisconnect ();
+			isAlive = koreConnect ();
 			isAliveChanged = true;
 			if (!isAlive)
 				debug ("Failed\n");
@@ -129,29 +338,18 @@ koreConnectionMain ()
 
 		// Receive data from the X-Kore server
 		if (isAlive) {
-			int ret;
-
-			ret = readSocket (koreClient, buf, BUF_SIZE);
+			int ret = koreRead (buf, BUF_SIZE);
 			if (ret == SF_CLOSED) {
 				// Connection closed
 				debug ("X-Kore server exited\n");
-				closesocket (koreClient);
-				koreClient = INVALID_SOCKET;
+				koreDisconnect ();
 				isAlive = false;
 				isAliveChanged = true;
 
 			} else if (ret > 0) {
-				// Data available
-				Packet *packet;
-				int next = 0;
-
+				// Data available; Kore may send many packets at once
 				koreClientRecvBuf.append (buf, ret);
-				while ((packet = unpackPacket (koreClientRecvBuf.c_str (), koreClientRecvBuf.size (), next))) {
-					// Packet is complete
-					processPacket (packet);
-					free (packet);
-					koreClientRecvBuf.erase (0, next);
-				}
+				koreClientRecvBuf.erase (0, processPackets (koreClientRecvBuf.data (), koreClientRecvBuf.size ()));
 
 				if (dataAvailableFromKore2) {
 					EnterCriticalSection (&CS_dataAvailableFromKore);
@@ -167,35 +365,57 @@ koreConnectionMain ()
 
 		// Check whether we have data to send to the X-Kore server
 		// This data originates from the RO client and is supposed to go to the real RO server
-		EnterCriticalSection (&CS_send);
-		if (xkoreSendBuf.size ()) {
+		// Only whole packets are ever queued
+		unsigned int pending = xkoreSendBuf.size ();
+		if (pending) {
 			if (isAlive) {
-				OriginalSendProc (koreClient, (char *) xkoreSendBuf.c_str (), xkoreSendBuf.size (), 0);
+				// At most two parts, before and after the end of the buffer
+				while (pending > 0) {
+					unsigned int len;
+					const char *data = xkoreSendBuf.peek (len);
+
+					if (len > pending)
+						len = pending;
+					koreSend (data, len);
+					xkoreSendBuf.consume (len);
+					pending -= len;
+				}
 
 			} else {
 				Packet *packet;
 				int next;
+				int offset = 0;
+				WSABUF toServer[MAX_BATCH];
+				DWORD serverCount = 0;
+				char *data = (char *) malloc (pending);
+
+				xkoreSendBuf.read (data, pending);
 
 				// Kore is not running; send it to the RO server instead,
 				// if this packet is supposed to go to the RO server ('S')
 				// Ignore packets that are meant for Kore ('R')
-				EnterCriticalSection (&CS_ro);
-				while ((packet = unpackPacket (xkoreSendBuf.c_str (), xkoreSendBuf.size (), next))) {
-					if (packet->ID == 'S')
-						OriginalSendProc (roServer, (char *) packet->data, packet->len, 0);
+				while ((packet = unpackPacket (data + offset, pending - offset, next))) {
+					if (packet->ID == 'S' && packet->len > 0) {
+						if (serverCount == MAX_BATCH) {
+							sendToServer (toServer, serverCount);
+							serverCount = 0;
+						}
+						toServer[serverCount].buf = packet->data;
+						toServer[serverCount].len = packet->len;
+						serverCount++;
+					}
 					free (packet);
-					xkoreSendBuf.erase (0, next);
+					offset += next;
 				}
-				LeaveCriticalSection (&CS_ro);
+				sendToServer (toServer, serverCount);
+				free (data);
 			}
-			xkoreSendBuf.erase ();
 		}
-		LeaveCriticalSection (&CS_send);
 
 
 		// Ping the X-Kore server to keep the connection alive
 		if (koreClientIsAlive && GetTickCount () - koreClientPingTimeout > PING_INTERVAL) {
-			OriginalSendProc (koreClient, pingPacket, 3, 0);
+			koreSend (pingPacket, 3);
 			koreClientPingTimeout = GetTickCount ();
 		}
 
@@ -204,17 +424,48 @@ koreConnectionMain ()
 			koreClientIsAlive = isAlive;
 			LeaveCriticalSection (&CS_koreClientIsAlive);
 		}
-		Sleep (SLEEP_TIME);
+
+		// Sleep until there is something to do
+		HANDLE events[2] = { koreEvent (), sendQueuedEvent };
+		DWORD now = GetTickCount ();
+		DWORD wait;
+		if (isAlive) {
+			wait = now - koreClientPingTimeout > PING_INTERVAL ? 0 : PING_INTERVAL - (now - koreClientPingTimeout);
+			if (now - koreClientTimeout > TIMEOUT)
+				wait = 0;
+			else if (wait > TIMEOUT - (now - koreClientTimeout))
+				wait = TIMEOUT - (now - koreClientTimeout);
+		} else {
+			// Nothing to receive, don't wake for what the closed connection left signaled
+			WSAResetEvent (koreClientEvent);
+			wait = now - reconnectTimeout > RECONNECT_INTERVAL ? 0 : RECONNECT_INTERVAL - (now - reconnectTimeout);
+		}
+		// The intervals are checked with '>', so wake just after them
+		WaitForMultipleObjects (2, events, FALSE, wait + 1);
 	}
 }
 
 
 /*********** Faked functions ************/
 
+static int sendRedirected (SOCKET s, WSABUF *buffers, DWORD count, int flags, bool wsa);
+static int recvRedirected (SOCKET s, WSABUF *buffers, DWORD count, DWORD *flags, bool wsa);
+
+// Overlapped WSASend() and WSARecv() calls go to the RO server as they are, so that they complete
+// as the client expects; the others are redirected as send() and recv() are, buffer by buffer.
 int WINAPI
 MyWSASend (SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount, LPDWORD lpNumberOfBytesSent, DWORD dwFlags, LPWSAOVERLAPPED lpOverlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine)
 {
-	return OriginalWSASendProc(s,lpBuffers,dwBufferCount,lpNumberOfBytesSent,dwFlags,lpOverlapped,lpCompletionRoutine);
+	int ret;
+
+	if (lpOverlapped != NULL || lpCompletionRoutine != NULL)
+		return OriginalWSASendProc(s,lpBuffers,dwBufferCount,lpNumberOfBytesSent,dwFlags,lpOverlapped,lpCompletionRoutine);
+	ret = sendRedirected (s, lpBuffers, dwBufferCount, dwFlags, true);
+	if (ret == SOCKET_ERROR)
+		return SOCKET_ERROR;
+	if (lpNumberOfBytesSent != NULL)
+		*lpNumberOfBytesSent = ret;
+	return 0;
 }
 
 int WINAPI
@@ -225,7 +476,17 @@ MyWSASendTo (SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount, LPDWORD lpNumber
 int WINAPI
 MyWSARecv (SOCKET s, LPWSABUF lpBuffers, DWORD dwBufferCount, LPDWORD lpNumberOfBytesRecvd, LPDWORD lpFlags, LPWSAOVERLAPPED lpOverlapped, LPWSAOVERLAPPED_COMPLETION_ROUTINE lpCompletionRoutine)
 {
-	return OriginalWSARecvProc(s,lpBuffers,dwBufferCount,lpNumberOfBytesRecvd,lpFlags,lpOverlapped,lpCompletionRoutine);
+	DWORD flags = 0;
+	int ret;
+
+	if (lpOverlapped != NULL || lpCompletionRoutine != NULL)
+		return OriginalWSARecvProc(s,lpBuffers,dwBufferCount,lpNumberOfBytesRecvd,lpFlags,lpOverlapped,lpCompletionRoutine);
+	ret = recvRedirected (s, lpBuffers, dwBufferCount, lpFlags != NULL ? lpFlags : &flags, true);
+	if (ret == SOCKET_ERROR)
+		return SOCKET_ERROR;
+	if (lpNumberOfBytesRecvd != NULL)
+		*lpNumberOfBytesRecvd = ret;
+	return 0;
 }
 
 int WINAPI
@@ -247,17 +508,19 @@ MySelect (int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds, const
 	return OriginalSelectProc(nfds, readfds, writefds, exceptfds, timeout);
 }
 
-int WINAPI
-MySend (SOCKET s, char* buf, int len, int flags)
+// send() and the non-overlapped WSASend(): the data goes to Kore when it is running, instead of the RO server
+static int
+sendRedirected (SOCKET s, WSABUF *buffers, DWORD count, int flags, bool wsa)
 {
 	int ret;
+	unsigned int len = totalLength (buffers, count);
 
 	// See if the socket to the RO server is still alive, and make
 	// sure WSAGetLastError() returns the right error if something's wrong
 	EnterCriticalSection (&CS_ro);
 	roServer = s;
 	LeaveCriticalSection (&CS_ro);
-	ret = OriginalSendProc (s, buf, 0, flags);
+	ret = OriginalSendProc (s, count ? buffers[0].buf : NULL, 0, flags);
 
 	if (ret != SOCKET_ERROR && len > 0) {
 		bool isAlive;
@@ -269,40 +532,63 @@ MySend (SOCKET s, char* buf, int len, int flags)
 
 		if (isAlive) {
 			// Don't send this packet to the RO server; send it to the X-Kore server instead
-			char *newbuf = (char *) malloc (len + 3);
-
-			unsigned short sLen = (unsigned short) len;
-			memcpy (newbuf, "S", 1);
-			memcpy (newbuf + 1, &sLen, 2);
-			memcpy (newbuf + 3, buf, len);
-
-			// We put this packet in a string, and let the X-Kore client thread send it
-			EnterCriticalSection (&CS_send);
-			xkoreSendBuf.append (newbuf, len + 3);
-			LeaveCriticalSection (&CS_send);
-			free (newbuf);
+			// We put this packet in a buffer, and let the X-Kore client thread send it
+			queuePacketForKore ('S', buffers, count, len);
 			return len;
 
-		} else {
+		} else if (!wsa) {
 			// Send packet directly to the RO server
-			ret = OriginalSendProc (s, buf, len, flags);
+			ret = OriginalSendProc (s, buffers[0].buf, buffers[0].len, flags);
 			return ret;
+
+		} else {
+			DWORD sent;
+
+			if (OriginalWSASendProc (s, buffers, count, &sent, flags, NULL, NULL) == SOCKET_ERROR)
+				return SOCKET_ERROR;
+			return (int) sent;
 		}
 	} else
 		return ret;
 }
 
+int WINAPI
+MySend (SOCKET s, char* buf, int len, int flags)
+{
+	WSABUF buffer;
+
+	buffer.buf = buf;
+	buffer.len = len > 0 ? len : 0;
+	return sendRedirected (s, &buffer, 1, flags, false);
+}
+
 int WINAPI
 MySendTo (SOCKET s, char* buf, int len, int flags, struct sockaddr* to, int tolen)
 {
 	return OriginalSendToProc(s,buf,len,flags, to, tolen);
 }
 
-int WINAPI
-MyRecv (SOCKET s, char* buf, int len, int flags)
+// Receives from the RO server into the buffers, with recv() or WSARecv()
+static int
+originalRecv (SOCKET s, WSABUF *buffers, DWORD count, DWORD *flags, bool wsa)
+{
+	DWORD received;
+
+	if (!wsa)
+		return OriginalRecvProc (s, buffers[0].buf, buffers[0].len, *flags);
+	if (OriginalWSARecvProc (s, buffers, count, &received, flags, NULL, NULL) == SOCKET_ERROR)
+		return SOCKET_ERROR;
+	return (int) received;
+}
+
+// recv() and the non-overlapped WSARecv(): the data of the RO server goes to Kore when it is running,
+// and the RO client receives what Kore sends it instead
+static int
+recvRedirected (SOCKET s, WSABUF *buffers, DWORD count, DWORD *flags, bool wsa)
 {
 	int ret = 0;
 	int ret2 = 0;
+	unsigned int len = totalLength (buffers, count);
 
 	EnterCriticalSection (&CS_ro);
 	roServer = s;
@@ -317,20 +603,10 @@ MyRecv (SOCKET s, char* buf, int len, int flags)
 		// Data that the RO server sent
 		if (dataWaiting(s)) {
 			// Grab data
-			ret2 = OriginalRecvProc(s, buf, len, flags);
+			ret2 = originalRecv (s, buffers, count, flags, wsa);
 			if (ret2 != SOCKET_ERROR && ret2 > 0) {
 				// Redirect it to Kore
-				char *newbuf = (char *) malloc (ret2 + 3);
-				unsigned short sLen = (unsigned short) ret2;
-				memcpy (newbuf, "R", 1);
-				memcpy (newbuf + 1, &sLen, 2);
-				memcpy (newbuf + 3, buf, ret2);
-
-				EnterCriticalSection(&CS_send);
-				xkoreSendBuf.append (newbuf, ret2 + 3);
-				LeaveCriticalSection(&CS_send);
-
-				free (newbuf);
+				queuePacketForKore ('R', buffers, count, ret2);
 
 			} else if (ret2 == 0 || (ret2 == SOCKET_ERROR && WSAGetLastError () != WSAEWOULDBLOCK)) {
 				// Connection with RO server closed
@@ -341,30 +617,18 @@ MyRecv (SOCKET s, char* buf, int len, int flags)
 		}
 
 		// Pass data from Kore to RO Client
-		EnterCriticalSection (&CS_rosend);
-		int roSendBufsize = roSendBuf.size();
-		if (roSendBufsize) {
-			ret = roSendBufsize < len? roSendBufsize : len;
-			memcpy (buf, (char *) roSendBuf.c_str (), ret);
-			roSendBuf.erase (0, ret);
+		if (roSendBuf.size () && len > 0) {
+			ret = readFromKore (buffers, count);
 		} else {
 			WSASetLastError (WSAEWOULDBLOCK);
 			ret = SOCKET_ERROR;
 		}
-		LeaveCriticalSection (&CS_rosend);
 	} else {
-		EnterCriticalSection (&CS_rosend);
-		int roSendBufsize = roSendBuf.size();
-		LeaveCriticalSection (&CS_rosend);
-		if (roSendBufsize) {
+		if (roSendBuf.size () && len > 0) {
 			// Flush out anything left thats kore->ROclient
-			ret = roSendBufsize < len? roSendBufsize : len;
-			EnterCriticalSection (&CS_rosend);
-			memcpy (buf, (char *) roSendBuf.c_str(), ret);
-			roSendBuf.erase(0, ret);
-			LeaveCriticalSection (&CS_rosend);
+			ret = readFromKore (buffers, count);
 		} else {
-			ret2 = OriginalRecvProc(s, buf, len, flags);
+			ret2 = originalRecv (s, buffers, count, flags, wsa);
 			if (ret2 == 0 || (ret2 == SOCKET_ERROR && WSAGetLastError () != WSAEWOULDBLOCK)) {
 				EnterCriticalSection(&CS_ro);
 				roServer = INVALID_SOCKET;
@@ -377,6 +641,17 @@ MyRecv (SOCKET s, char* buf, int len, int flags)
 	return ret;
 }
 
+int WINAPI
+MyRecv (SOCKET s, char* buf, int len, int flags)
+{
+	WSABUF buffer;
+	DWORD recvFlags = flags;
+
+	buffer.buf = buf;
+	buffer.len = len > 0 ? len : 0;
+	return recvRedirected (s, &buffer, 1, &recvFlags, false);
+}
+
 int WINAPI
 MyRecvFrom (SOCKET s, char* buf, int len, int flags, struct sockaddr* from, int *fromlen)
 {
@@ -509,7 +784,8 @@ init ()
 	InitializeCriticalSection (&CS_dataAvailableFromKore);
 	InitializeCriticalSection (&CS_ro);
 	InitializeCriticalSection (&CS_send);
-	InitializeCriticalSection (&CS_rosend);
+	koreClientEvent = WSACreateEvent ();
+	sendQueuedEvent = CreateEvent (NULL, FALSE, FALSE, NULL);
 	debugInit ();
 
 	debug ("Hooking functions...\n");
@@ -0,0 +1,181 @@
+#ifndef _RINGBUFFER_H_
+#define _RINGBUFFER_H_
+
+#include <windows.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * A fixed capacity byte queue between one producer thread and one consumer thread,
+ * which never lock each other out: each side only moves its own index, and publishes
+ * it once the bytes it wrote or read are done with.
+ *
+ * The indices keep counting past the capacity and wrap around at 2^32, the capacity
+ * being a power of two, so that size() is always writeIndex - readIndex.
+ *
+ * The buffer and the indices can also belong to someone else, such as memory shared
+ * with another process, which then runs the other side.
+ */
+class RingBuffer {
+public:
+	// capacity is rounded up to a power of two
+	RingBuffer (unsigned int capacity)
+	{
+		this->capacity = 1;
+		while (this->capacity < capacity)
+			this->capacity <<= 1;
+		buffer = (char *) malloc (this->capacity);
+		writeIndex = &indices[0];
+		readIndex = &indices[1];
+		*writeIndex = 0;
+		*readIndex = 0;
+		pending = 0;
+		owned = true;
+	}
+
+	// Uses the given buffer and indices, which are left as they are; capacity must be a power of two
+	RingBuffer (char *buffer, unsigned int capacity, volatile LONG *writeIndex, volatile LONG *readIndex)
+	{
+		this->buffer = buffer;
+		this->capacity = capacity;
+		this->writeIndex = writeIndex;
+		this->readIndex = readIndex;
+		pending = load (writeIndex);
+		owned = false;
+	}
+
+	~RingBuffer ()
+	{
+		if (owned)
+			free (buffer);
+	}
+
+	// The number of bytes which can be read, from both threads
+	unsigned int
+	size () const
+	{
+		return load (writeIndex) - load (readIndex);
+	}
+
+
+	/* Producer */
+
+	// The number of bytes which can be appended
+	unsigned int
+	room () const
+	{
+		return capacity - (pending - load (readIndex));
+	}
+
+	// Copies bytes after the ones appended before, at most room(); the consumer only sees
+	// them after commit(), so a message can be gathered from several parts
+	void
+	append (const char *data, unsigned int len)
+	{
+		copyIn (pending, data, len);
+		pending += len;
+	}
+
+	void
+	commit ()
+	{
+		store (writeIndex, pending);
+	}
+
+	// Queues the bytes of both parts, which the consumer sees at once. Returns false,
+	// queueing nothing, if they don't fit.
+	bool
+	write (const char *data, unsigned int len, const char *data2 = NULL, unsigned int len2 = 0)
+	{
+		if (len + len2 > room ())
+			return false;
+		append (data, len);
+		append (data2, len2);
+		commit ();
+		return true;
+	}
+
+
+	/* Consumer */
+
+	// The bytes which can be read from the start without wrapping around, len receives
+	// their number
+	const char *
+	peek (unsigned int &len) const
+	{
+		unsigned int start = (unsigned int) *readIndex;
+		unsigned int offset = start & (capacity - 1);
+
+		len = load (writeIndex) - start;
+		if (len > capacity - offset)
+			len = capacity - offset;
+		return buffer + offset;
+	}
+
+	// Drops the first len bytes, at most size()
+	void
+	consume (unsigned int len)
+	{
+		store (readIndex, (unsigned int) *readIndex + len);
+	}
+
+	// Moves up to len bytes to buf, returns their number
+	unsigned int
+	read (char *buf, unsigned int len)
+	{
+		unsigned int start = (unsigned int) *readIndex;
+		unsigned int available = load (writeIndex) - start;
+		unsigned int offset = start & (capacity - 1);
+		unsigned int first;
+
+		if (len > available)
+			len = available;
+		first = len < capacity - offset ? len : capacity - offset;
+		memcpy (buf, buffer + offset, first);
+		memcpy (buf + first, buffer, len - first);
+		store (readIndex, start + len);
+		return len;
+	}
+
+private:
+	char *buffer;
+	unsigned int capacity;
+	bool owned;
+	volatile LONG indices[2];
+	// Only written by the producer, pending includes the bytes appended but not committed
+	volatile LONG *writeIndex;
+	unsigned int pending;
+	// Only written by the consumer
+	volatile LONG *readIndex;
+
+	// The index written by the other thread, seeing everything it did before storing it
+	static unsigned int
+	load (volatile LONG const *index)
+	{
+		return (unsigned int) InterlockedCompareExchange ((volatile LONG *) index, 0, 0);
+	}
+
+	// Publishes an index after everything done before
+	static void
+	store (volatile LONG *index, unsigned int value)
+	{
+		InterlockedExchange (index, (LONG) value);
+	}
+
+	void
+	copyIn (unsigned int index, const char *data, unsigned int len)
+	{
+		unsigned int offset = index & (capacity - 1);
+		unsigned int first = len < capacity - offset ? len : capacity - offset;
+
+		if (len == 0)
+			return;
+		memcpy (buffer + offset, data, first);
+		memcpy (buffer, data + first, len - first);
+	}
+
+	RingBuffer (const RingBuffer &);
+	RingBuffer &operator= (const RingBuffer &);
+};
+
+#endif /* _RINGBUFFER_H_ */
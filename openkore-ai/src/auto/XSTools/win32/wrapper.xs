@@ -7,6 +7,15 @@
 #include "XSUB.h"
 #include "locale.c"
 #include "utils.h"
+#include "xkore-shm.h"
+
+static XKoreShm *
+XKoreShm_fromSV(SV *self)
+{
+	if (!sv_isobject(self) || !sv_derived_from(self, "Utils::Win32::XKoreShm"))
+		croak("Utils::Win32::XKoreShm: not an object");
+	return INT2PTR(XKoreShm *, SvIV(SvRV(self)));
+}
 
 MODULE = Utils::Win32		PACKAGE = Utils::Win32
 PROTOTYPES: ENABLE
@@ -280,3 +289,75 @@ CODE:
 	}
 OUTPUT:
 	RETVAL
+
+
+MODULE = Utils::Win32		PACKAGE = Utils::Win32::XKoreShm
+PROTOTYPES: ENABLE
+
+SV *
+new(CLASS, clientPID)
+	char *CLASS
+	unsigned long clientPID
+INIT:
+	XKoreShm *shm;
+CODE:
+	shm = XKoreShm_create((DWORD) clientPID);
+	if (shm == NULL) {
+		XSRETURN_UNDEF;
+	}
+	RETVAL = newSV(0);
+	sv_setref_pv(RETVAL, CLASS, (void *) shm);
+OUTPUT:
+	RETVAL
+
+bool
+send(self, data)
+	SV *self
+	SV *data
+INIT:
+	const char *buf;
+	STRLEN len;
+CODE:
+	buf = SvPVbyte(data, len);
+	RETVAL = XKoreShm_write(XKoreShm_fromSV(self), buf, len);
+OUTPUT:
+	RETVAL
+
+SV *
+recv(self)
+	SV *self
+INIT:
+	XKoreShm *shm;
+	unsigned int len;
+CODE:
+	shm = XKoreShm_fromSV(self);
+	len = XKoreShm_available(shm);
+	RETVAL = newSV(len + 1);
+	SvPOK_only(RETVAL);
+	SvCUR_set(RETVAL, XKoreShm_read(shm, SvPVX(RETVAL), len));
+	*SvEND(RETVAL) = '\0';
+OUTPUT:
+	RETVAL
+
+bool
+peerAlive(self)
+	SV *self
+CODE:
+	RETVAL = XKoreShm_peerAlive(XKoreShm_fromSV(self));
+OUTPUT:
+	RETVAL
+
+bool
+wait(self, timeout)
+	SV *self
+	unsigned long timeout
+CODE:
+	RETVAL = WaitForSingleObject(XKoreShm_event(XKoreShm_fromSV(self)), timeout) == WAIT_OBJECT_0;
+OUTPUT:
+	RETVAL
+
+void
+DESTROY(self)
+	SV *self
+CODE:
+	XKoreShm_close(XKoreShm_fromSV(self));
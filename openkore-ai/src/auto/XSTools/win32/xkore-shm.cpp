@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include "xkore-shm.h"
+#include "ringbuffer.h"
+
+#define SHM_MAGIC 0x4D534B58 // "XKSM"
+
+// The start of the shared memory, followed by the ring buffer to Kore and the one to the RO client
+struct SharedHeader {
+	LONG magic;
+	LONG ringSize;
+	DWORD korePID;
+	// Counts the Kores which created the transport; whoever sees another one than
+	// when it started knows that the other side restarted
+	volatile LONG generation;
+	// The generation of the Kore and of the RO client which are there, 0 when they left
+	volatile LONG koreGeneration;
+	volatile LONG clientGeneration;
+	volatile LONG toKoreWrite, toKoreRead;
+	volatile LONG toClientWrite, toClientRead;
+};
+
+struct XKoreShm {
+	bool isKore;
+	LONG generation;
+	HANDLE mapping;
+	SharedHeader *header;
+	// The other side's process, which is gone if it crashed without closing
+	HANDLE peer;
+	RingBuffer *in, *out;
+	HANDLE inEvent, outEvent;
+};
+
+#define SHM_SIZE (sizeof (SharedHeader) + 2 * XKORE_SHM_RING_SIZE)
+
+
+static void
+makeName (char *buf, size_t size, DWORD clientPID, const char *suffix)
+{
+	_snprintf (buf, size, "Local\\OpenKore-XKore-%lu%s", (unsigned long) clientPID, suffix);
+	buf[size - 1] = '\0';
+}
+
+static bool
+processRunning (HANDLE process)
+{
+	return process != NULL && WaitForSingleObject (process, 0) == WAIT_TIMEOUT;
+}
+
+// Open the events and the ring buffers of a mapped transport; returns false on failure
+static bool
+attach (XKoreShm *shm, DWORD clientPID)
+{
+	char name[64];
+	char *rings = (char *) (shm->header + 1);
+	HANDLE koreEvent, clientEvent;
+	RingBuffer *toKore, *toClient;
+
+	makeName (name, sizeof (name), clientPID, "-kore");
+	koreEvent = CreateEvent (NULL, FALSE, FALSE, name);
+	makeName (name, sizeof (name), clientPID, "-client");
+	clientEvent = CreateEvent (NULL, FALSE, FALSE, name);
+	if (koreEvent == NULL || clientEvent == NULL) {
+		if (koreEvent != NULL)
+			CloseHandle (koreEvent);
+		if (clientEvent != NULL)
+			CloseHandle (clientEvent);
+		return false;
+	}
+
+	toKore = new RingBuffer (rings, XKORE_SHM_RING_SIZE,
+		&shm->header->toKoreWrite, &shm->header->toKoreRead);
+	toClient = new RingBuffer (rings + XKORE_SHM_RING_SIZE, XKORE_SHM_RING_SIZE,
+		&shm->header->toClientWrite, &shm->header->toClientRead);
+	if (shm->isKore) {
+		shm->in = toKore;
+		shm->out = toClient;
+		shm->inEvent = koreEvent;
+		shm->outEvent = clientEvent;
+	} else {
+		shm->in = toClient;
+		shm->out = toKore;
+		shm->inEvent = clientEvent;
+		shm->outEvent = koreEvent;
+	}
+	return true;
+}
+
+static void
+release (XKoreShm *shm)
+{
+	delete shm->in;
+	delete shm->out;
+	if (shm->inEvent != NULL)
+		CloseHandle (shm->inEvent);
+	if (shm->outEvent != NULL)
+		CloseHandle (shm->outEvent);
+	if (shm->peer != NULL)
+		CloseHandle (shm->peer);
+	if (shm->header != NULL)
+		UnmapViewOfFile (shm->header);
+	if (shm->mapping != NULL)
+		CloseHandle (shm->mapping);
+	delete shm;
+}
+
+static XKoreShm *
+newShm (bool isKore)
+{
+	XKoreShm *shm = new XKoreShm;
+
+	memset (shm, 0, sizeof (XKoreShm));
+	shm->isKore = isKore;
+	return shm;
+}
+
+
+XKoreShm *
+XKoreShm_create (DWORD clientPID)
+{
+	char name[64];
+	XKoreShm *shm = newShm (true);
+	SharedHeader *header;
+	bool existed;
+
+	makeName (name, sizeof (name), clientPID, "");
+	shm->mapping = CreateFileMapping (INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, SHM_SIZE, name);
+	existed = GetLastError () == ERROR_ALREADY_EXISTS;
+	if (shm->mapping == NULL
+	 || (shm->header = (SharedHeader *) MapViewOfFile (shm->mapping, FILE_MAP_ALL_ACCESS, 0, 0, SHM_SIZE)) == NULL) {
+		release (shm);
+		return NULL;
+	}
+	header = shm->header;
+
+	// It stays around while the DLL has it open; don't take it from a Kore which is still running
+	if (existed && header->magic == SHM_MAGIC && header->koreGeneration != 0) {
+		HANDLE other = OpenProcess (SYNCHRONIZE, FALSE, header->korePID);
+		bool running = processRunning (other);
+
+		if (other != NULL)
+			CloseHandle (other);
+		if (running) {
+			release (shm);
+			return NULL;
+		}
+	}
+
+	shm->peer = OpenProcess (SYNCHRONIZE, FALSE, clientPID);
+	if (shm->peer == NULL) {
+		release (shm);
+		return NULL;
+	}
+
+	// A DLL which opened an earlier generation stops using it before anything is reset
+	InterlockedExchange (&header->koreGeneration, 0);
+	InterlockedExchange (&header->clientGeneration, 0);
+	header->magic = SHM_MAGIC;
+	header->ringSize = XKORE_SHM_RING_SIZE;
+	header->korePID = GetCurrentProcessId ();
+	header->toKoreWrite = header->toKoreRead = 0;
+	header->toClientWrite = header->toClientRead = 0;
+	if (!attach (shm, clientPID)) {
+		release (shm);
+		return NULL;
+	}
+	shm->generation = InterlockedIncrement (&header->generation);
+	if (shm->generation == 0)
+		shm->generation = InterlockedIncrement (&header->generation);
+	InterlockedExchange (&header->koreGeneration, shm->generation);
+	return shm;
+}
+
+XKoreShm *
+XKoreShm_open ()
+{
+	char name[64];
+	DWORD pid = GetCurrentProcessId ();
+	XKoreShm *shm = newShm (false);
+	SharedHeader *header;
+
+	makeName (name, sizeof (name), pid, "");
+	shm->mapping = OpenFileMapping (FILE_MAP_ALL_ACCESS, FALSE, name);
+	if (shm->mapping == NULL
+	 || (shm->header = (SharedHeader *) MapViewOfFile (shm->mapping, FILE_MAP_ALL_ACCESS, 0, 0, SHM_SIZE)) == NULL) {
+		release (shm);
+		return NULL;
+	}
+	header = shm->header;
+
+	shm->generation = InterlockedCompareExchange (&header->koreGeneration, 0, 0);
+	if (header->magic != SHM_MAGIC || header->ringSize != XKORE_SHM_RING_SIZE || shm->generation == 0
+	 || (shm->peer = OpenProcess (SYNCHRONIZE, FALSE, header->korePID)) == NULL
+	 || !attach (shm, pid)) {
+		release (shm);
+		return NULL;
+	}
+
+	InterlockedExchange (&header->clientGeneration, shm->generation);
+	SetEvent (shm->outEvent);
+	return shm;
+}
+
+void
+XKoreShm_close (XKoreShm *shm)
+{
+	volatile LONG *own = shm->isKore ? &shm->header->koreGeneration : &shm->header->clientGeneration;
+
+	InterlockedCompareExchange (own, 0, shm->generation);
+	SetEvent (shm->outEvent);
+	release (shm);
+}
+
+bool
+XKoreShm_peerAlive (XKoreShm *shm)
+{
+	volatile LONG *other = shm->isKore ? &shm->header->clientGeneration : &shm->header->koreGeneration;
+
+	return InterlockedCompareExchange (other, 0, 0) == shm->generation
+		&& processRunning (shm->peer);
+}
+
+bool
+XKoreShm_write (XKoreShm *shm, const char *data, unsigned int len)
+{
+	if (!shm->out->write (data, len))
+		return false;
+	SetEvent (shm->outEvent);
+	return true;
+}
+
+unsigned int
+XKoreShm_available (XKoreShm *shm)
+{
+	return shm->in->size ();
+}
+
+unsigned int
+XKoreShm_read (XKoreShm *shm, char *buf, unsigned int len)
+{
+	return shm->in->read (buf, len);
+}
+
+HANDLE
+XKoreShm_event (XKoreShm *shm)
+{
+	return shm->inEvent;
+}
@@ -0,0 +1,70 @@
+#ifndef _XKORE_SHM_H_
+#define _XKORE_SHM_H_
+
+#include <windows.h>
+
+/*
+ * A shared memory transport between Kore and NetRedirect.dll, used instead of the
+ * X-Kore server socket when Kore offers one for the RO client's process.
+ *
+ * Kore creates it before injecting the DLL, the DLL opens it by the RO client's process
+ * ID. It holds a ring buffer in each direction, carrying the same 'S'/'R'/'K' packets
+ * as the socket, and an event for each side which the other sets after writing.
+ */
+
+/** The size of each ring buffer, in bytes. */
+#define XKORE_SHM_RING_SIZE (1024 * 1024)
+
+typedef struct XKoreShm XKoreShm;
+
+/**
+ * Create the transport for an RO client's process (Kore's side).
+ *
+ * @param clientPID The process ID of the RO client.
+ * @return A transport, or NULL if it can't be created or another Kore uses it.
+ */
+XKoreShm *XKoreShm_create (DWORD clientPID);
+
+/**
+ * Open the transport which Kore created for this process (the RO client's side).
+ *
+ * @return A transport, or NULL if Kore offers none.
+ */
+XKoreShm *XKoreShm_open ();
+
+/**
+ * Leave the transport, which the other side sees as the connection closing.
+ */
+void XKoreShm_close (XKoreShm *shm);
+
+/**
+ * Check whether the other side is still there. For Kore, whether the RO client
+ * has opened the transport since it was created.
+ */
+bool XKoreShm_peerAlive (XKoreShm *shm);
+
+/**
+ * Send data to the other side.
+ *
+ * @return Whether it was sent; nothing is sent if the ring buffer doesn't have room for all of it.
+ */
+bool XKoreShm_write (XKoreShm *shm, const char *data, unsigned int len);
+
+/**
+ * The number of bytes the other side sent which weren't read yet.
+ */
+unsigned int XKoreShm_available (XKoreShm *shm);
+
+/**
+ * Receive up to len bytes of what the other side sent.
+ *
+ * @return The number of bytes received.
+ */
+unsigned int XKoreShm_read (XKoreShm *shm, char *buf, unsigned int len);
+
+/**
+ * An event which is set when the other side sent something or left.
+ */
+HANDLE XKoreShm_event (XKoreShm *shm);
+
+#endif /* _XKORE_SHM_H_ */
@@ -33,6 +33,8 @@ use Utils;
 use ChatQueue;
 use I18N;
 use Utils::Benchmark;
+use Utils::Profiler;
+use Utils::TickTimer;
 use Utils::HttpReader;
 
 
@@ -148,6 +150,7 @@ sub loadDataFiles {
 	Settings::addControlFile(Settings::getConfigFilename(),
 		loader => [\&parseConfigFile, \%config],
 		internalName => 'config.txt',
+		onLoaded => \&Log::resetFilter,
 		autoSearch => 0);
 	Settings::addControlFile(Settings::getControlFilename("consolecolors.txt"),
 		internalName => 'consolecolors.txt',
@@ -211,11 +214,12 @@ sub loadDataFiles {
 	Settings::addTableFile('servers.txt',
 		internalName => 'servers.txt',
 		loader => [\&parseSectionedFile, \%masterServers],
-		onLoaded => \&processServerSettings );
+		onLoaded => \&processServerSettings, cache => 1);
 	# Load RecvPackets.txt second
  	Settings::addTableFile(Settings::getRecvPacketsFilename(),
 		internalName => 'recvpackets.txt',
- 		loader => [\&parseRecvpackets, \%rpackets]);
+ 		loader => [\&parseRecvpackets, \%rpackets],
+		onLoaded => \&Network::MessageTokenizer::packetLengthsChanged, cache => 1);
 
 	# Add 'Old' table pack, if user set
 	if ( $sys{locale_compat} == 1) {
@@ -236,46 +240,46 @@ sub loadDataFiles {
 	# Load all other tables
 	Settings::addTableFile('cities.txt',
 		internalName => 'cities.txt',
-		loader => [\&parseROLUT, \%cities_lut]);
+		loader => [\&parseROLUT, \%cities_lut], cache => 'FileParsers::ROLUT');
 	Settings::addTableFile('directions.txt',
 		internalName => 'directions.txt',
-		loader => [\&parseDataFile2, \%directions_lut]);
+		loader => [\&parseDataFile2, \%directions_lut], cache => 1);
 	Settings::addTableFile('elements.txt',
 		internalName => 'elements.txt',
-		loader => [\&parseROLUT, \%elements_lut]);
+		loader => [\&parseROLUT, \%elements_lut], cache => 'FileParsers::ROLUT');
 	Settings::addTableFile('emotions.txt',
 		internalName => 'emotions.txt',
-		loader => [\&parseEmotionsFile, \%emotions_lut]);
+		loader => [\&parseEmotionsFile, \%emotions_lut], cache => 1);
 	Settings::addTableFile('equiptypes.txt',
 		internalName => 'equiptypes.txt',
-		loader => [\&parseDataFile2, \%equipTypes_lut]);
+		loader => [\&parseDataFile2, \%equipTypes_lut], cache => 1);
 	Settings::addTableFile('haircolors.txt',
 		internalName => 'haircolors.txt',
-		loader => [\&parseDataFile2, \%haircolors]);
+		loader => [\&parseDataFile2, \%haircolors], cache => 1);
 	Settings::addTableFile('headgears.txt',
 		internalName => 'headgears.txt',
 		loader => [\&parseArrayFile, \@headgears_lut, { hide_comments => 0 }]);
 	Settings::addTableFile('items.txt',
 		internalName => 'items.txt',
-		loader => [\&parseROLUT, \%items_lut]);
+		loader => [\&parseROLUT, \%items_lut], cache => 'FileParsers::ROLUT');
 	Settings::addTableFile('itemsdescriptions.txt',
 		internalName => 'itemsdescriptions.txt',
-		loader => [\&parseRODescLUT, \%itemsDesc_lut], mustExist => 0);
+		loader => [\&parseRODescLUT, \%itemsDesc_lut], mustExist => 0, cache => 'FileParsers::RODescLUT');
 	Settings::addTableFile('itemslots.txt',
 		internalName => 'itemslots.txt',
-		loader => [\&parseROSlotsLUT, \%itemSlots_lut]);
+		loader => [\&parseROSlotsLUT, \%itemSlots_lut], cache => 1);
 	Settings::addTableFile('itemslotcounttable.txt',
 		internalName => 'itemslotcounttable.txt',
-		loader => [\&parseROLUT, \%itemSlotCount_lut]);
+		loader => [\&parseROLUT, \%itemSlotCount_lut], cache => 'FileParsers::ROLUT');
 	Settings::addTableFile('itemtypes.txt',
 		internalName => 'itemtypes.txt',
-		loader => [\&parseDataFile2, \%itemTypes_lut]);
+		loader => [\&parseDataFile2, \%itemTypes_lut], cache => 1);
 	Settings::addTableFile('resnametable.txt',
 		internalName => 'resnametable.txt',
-		loader => [\&parseROLUT, \%mapAlias_lut, 1, ".gat"]);
+		loader => [\&parseROLUT, \%mapAlias_lut, 1, ".gat"], cache => 'FileParsers::ROLUT');
 	Settings::addTableFile('maps.txt',
 		internalName => 'maps.txt',
-		loader => [\&parseROLUT, \%maps_lut]);
+		loader => [\&parseROLUT, \%maps_lut], cache => 'FileParsers::ROLUT');
 	Settings::addTableFile('monsters.txt',
 		internalName => 'monsters.txt',
 		loader => [\&parseDataFile2, \%monsters_lut], createIfMissing => 1);
@@ -284,25 +288,25 @@ sub loadDataFiles {
 		loader => [\&parseNPCs, \%npcs_lut], createIfMissing => 1);
 	Settings::addTableFile('packetdescriptions.txt',
 		internalName => 'packetdescriptions.txt',
-		loader => [\&parseSectionedFile, \%packetDescriptions], mustExist => 0);
+		loader => [\&parseSectionedFile, \%packetDescriptions], mustExist => 0, cache => 1);
 	Settings::addTableFile('portals.txt',
 		internalName => 'portals.txt',
-		loader => [\&parsePortals, \%portals_lut, \@portals_lut_missed]);
+		loader => [\&parsePortals, \%portals_lut, \@portals_lut_missed], cache => 1);
 	Settings::addTableFile('portals_commands.txt',
 		internalName => 'portals_commands.txt',
-		loader => [\&parsePortalsCommands, \%portals_commands], mustExist => 0);
+		loader => [\&parsePortalsCommands, \%portals_commands], mustExist => 0, cache => 1);
 	Settings::addTableFile('portals_spawns.txt',
 		internalName => 'portals_spawns.txt',
-		loader => [\&parsePortalsSpawns, \%portals_spawns], mustExist => 0);
+		loader => [\&parsePortalsSpawns, \%portals_spawns], mustExist => 0, cache => 1);
 	Settings::addTableFile('portals_airship.txt',
 		internalName => 'portals_airship.txt',
-		loader => [\&parsePortalsAirship, \%portals_airships], mustExist => 0);
+		loader => [\&parsePortalsAirship, \%portals_airships], mustExist => 0, cache => 1);
 	Settings::addTableFile('portalsLOS.txt',
 		internalName => 'portalsLOS.txt',
 		loader => [\&parsePortalsLOS, \%portals_los], createIfMissing => 1);
 	Settings::addTableFile('sex.txt',
 		internalName => 'sex.txt',
-		loader => [\&parseDataFile2, \%sex_lut]);
+		loader => [\&parseDataFile2, \%sex_lut], cache => 1);
 	Settings::addTableFile('SKILL_id_handle.txt',
 		internalName => 'SKILL_id_handle.txt',
 		loader => \&Skill::StaticInfo::parseSkillsDatabase_id2handle);
@@ -311,76 +315,76 @@ sub loadDataFiles {
 		loader => \&Skill::StaticInfo::parseSkillsDatabase_handle2name, mustExist => 0);
 	Settings::addTableFile('spells.txt',
 		internalName => 'spells.txt',
-		loader => [\&parseDataFile2, \%spells_lut]);
+		loader => [\&parseDataFile2, \%spells_lut], cache => 1);
 	Settings::addTableFile('skillsdescriptions.txt',
 		internalName => 'skillsdescriptions.txt',
-		loader => [\&parseRODescLUT, \%skillsDesc_lut], mustExist => 0);
+		loader => [\&parseRODescLUT, \%skillsDesc_lut], mustExist => 0, cache => 'FileParsers::RODescLUT');
 	Settings::addTableFile('skillssp.txt',
 		internalName => 'skillssp.txt',
 		loader => \&Skill::StaticInfo::parseSPDatabase);
 	Settings::addTableFile('STATUS_id_handle.txt',
 		internalName => 'STATUS_id_handle.txt',
-		loader => [\&parseDataFile2, \%statusHandle]);
+		loader => [\&parseDataFile2, \%statusHandle], cache => 1);
 	Settings::addTableFile('STATE_id_handle.txt',
 		internalName => 'STATE_id_handle.txt',
-		loader => [\&parseDataFile2, \%stateHandle]);
+		loader => [\&parseDataFile2, \%stateHandle], cache => 1);
 	Settings::addTableFile('LOOK_id_handle.txt',
 		internalName => 'LOOK_id_handle.txt',
-		loader => [\&parseDataFile2, \%lookHandle]);
+		loader => [\&parseDataFile2, \%lookHandle], cache => 1);
 	Settings::addTableFile('AILMENT_id_handle.txt',
 		internalName => 'AILMENT_id_handle.txt',
-		loader => [\&parseDataFile2, \%ailmentHandle]);
+		loader => [\&parseDataFile2, \%ailmentHandle], cache => 1);
 	Settings::addTableFile('MAPTYPE_id_handle.txt',
 		internalName => 'MAPTYPE_id_handle.txt',
-		loader => [\&parseDataFile2, \%mapTypeHandle]);
+		loader => [\&parseDataFile2, \%mapTypeHandle], cache => 1);
 	Settings::addTableFile('MAPPROPERTY_TYPE_id_handle.txt',
 		internalName => 'MAPPROPERTY_TYPE_id_handle.txt',
-		loader => [\&parseDataFile2, \%mapPropertyTypeHandle]);
+		loader => [\&parseDataFile2, \%mapPropertyTypeHandle], cache => 1);
 	Settings::addTableFile('MAPPROPERTY_INFO_id_handle.txt',
 		internalName => 'MAPPROPERTY_INFO_id_handle.txt',
-		loader => [\&parseDataFile2, \%mapPropertyInfoHandle]);
+		loader => [\&parseDataFile2, \%mapPropertyInfoHandle], cache => 1);
 	Settings::addTableFile('statusnametable.txt',
 		internalName => 'statusnametable.txt',
-		loader => [\&parseDataFile2, \%statusName], mustExist => 0);
+		loader => [\&parseDataFile2, \%statusName], mustExist => 0, cache => 1);
 	Settings::addTableFile('skillsarea.txt',
 		internalName => 'skillsarea.txt',
-		loader => [\&parseDataFile2, \%skillsArea]);
+		loader => [\&parseDataFile2, \%skillsArea], cache => 1);
 	Settings::addTableFile('skillsencore.txt',
 		internalName => 'skillsencore.txt',
-		loader => [\&parseList, \%skillsEncore]);
+		loader => [\&parseList, \%skillsEncore], cache => 1);
 	Settings::addTableFile('quests.txt',
 		internalName => 'quests.txt',
-		loader => [\&parseROQuestsLUT, \%quests_lut], mustExist => 0);
+		loader => [\&parseROQuestsLUT, \%quests_lut], mustExist => 0, cache => 'FileParsers::ROQuestsLUT');
 	Settings::addTableFile('effects.txt',
 		internalName => 'effects.txt',
-		loader => [\&parseDataFile2, \%effectName], mustExist => 0);
+		loader => [\&parseDataFile2, \%effectName], mustExist => 0, cache => 1);
 	Settings::addTableFile('msgstringtable.txt',
 		internalName => 'msgstringtable.txt',
 		loader => [\&parseArrayFile, \@msgTable, { hide_comments => 0 }], mustExist => 0);
 	Settings::addTableFile('hateffect_id_handle.txt',
 		internalName => 'hateffect_id_handle.txt',
-		loader => [\&parseDataFile2, \%hatEffectHandle]);
+		loader => [\&parseDataFile2, \%hatEffectHandle], cache => 1);
 	Settings::addTableFile('hateffect_name.txt',
 		internalName => 'hateffect_name.txt',
-		loader => [\&parseDataFile2, \%hatEffectName], mustExist => 0);
+		loader => [\&parseDataFile2, \%hatEffectName], mustExist => 0, cache => 1);
 	Settings::addTableFile('item_stack_limit.txt',
 		internalName => 'item_stack_limit.txt',
-		loader => [\&parseItemStackLimit, \%itemStackLimit]);
+		loader => [\&parseItemStackLimit, \%itemStackLimit], cache => 1);
 	Settings::addTableFile('ITEMOPTION_id_handle.txt',
 		internalName => 'ITEMOPTION_id_handle.txt',
-		loader => [\&parseDataFile2, \%itemOptionHandle], mustExist => 0);
+		loader => [\&parseDataFile2, \%itemOptionHandle], mustExist => 0, cache => 1);
 	Settings::addTableFile('item_options.txt',
 		internalName => 'item_options.txt',
-		loader => [\&parseROLUT, \%itemOption_lut], mustExist => 0);
+		loader => [\&parseROLUT, \%itemOption_lut], mustExist => 0, cache => 'FileParsers::ROLUT');
 	Settings::addTableFile('title_name.txt',
 		internalName => 'title_name.txt',
-		loader => [\&parseDataFile2, \%title_lut], mustExist => 0);
+		loader => [\&parseDataFile2, \%title_lut], mustExist => 0, cache => 1);
 	Settings::addTableFile('attendance_rewards.txt',
 		internalName => 'attendance_rewards.txt',
-		loader => [\&parseAttendanceRewards, \%attendance_rewards], mustExist => 0);
+		loader => [\&parseAttendanceRewards, \%attendance_rewards], mustExist => 0, cache => 1);
 	Settings::addTableFile('achievement_list.txt',
 		internalName => 'achievement_list.txt',
-		loader => [\&parseAchievementFile, \%achievements], mustExist => 0);
+		loader => [\&parseAchievementFile, \%achievements], mustExist => 0, cache => 1);
 
 	use utf8;
 
@@ -468,6 +472,7 @@ sub initNetworking {
 	}
 
 	Network::PaddedPackets::init();
+	Utils::Profiler::init();
 }
 
 sub initPortalsDatabase {
@@ -628,6 +633,12 @@ sub finalInitialization {
 	}
 
 	StdHttpReader::init();
+	# Mirrors which answered fastest in earlier runs are tried first
+	MirrorHttpReader::setLatencyFile("$Settings::logs_folder/mirror_latencies.txt");
+	if ($config{fieldCache}) {
+		my ($refreshed) = Field->refreshFieldCaches;
+		debug "Field caches of $refreshed field files with only a new modification time are up to date again\n", "field" if ($refreshed);
+	}
 	initStatVars();
 	initRandomRestart();
 #	initUserSeed();
@@ -826,6 +837,7 @@ sub initStatVars {
 # fully initialized.
 sub mainLoop_initialized {
 	Benchmark::begin("mainLoop_part1") if DEBUG;
+	Utils::TickTimer::beginTick();
 
 	# Handle connection states
 	$net->checkConnection();
@@ -836,27 +848,35 @@ sub mainLoop_initialized {
 	}
 
 	# Receive and handle data from the RO server
+	Utils::TickTimer::begin(Utils::TickTimer::NETWORK);
 	my $data = $net->serverRecv;
+	Utils::TickTimer::end(Utils::TickTimer::NETWORK);
 	if (defined($data) && length($data) > 0) {
 		Benchmark::begin("parseMsg") if DEBUG;
+		Utils::TickTimer::begin(Utils::TickTimer::PARSE);
 
 		$incomingMessages->add($data);
 		$net->clientSend($_) for $packetParser->process(
 			$incomingMessages, $packetParser
 		);
 		$net->clientFlush() if (UNIVERSAL::isa($net, 'Network::XKoreProxy'));
+		Utils::TickTimer::end(Utils::TickTimer::PARSE);
 		Benchmark::end("parseMsg") if DEBUG;
 	}
 
 	# Receive and handle data from the RO client
+	Utils::TickTimer::begin(Utils::TickTimer::NETWORK);
 	$data = $net->clientRecv;
+	Utils::TickTimer::end(Utils::TickTimer::NETWORK);
 	if (defined($data) && length($data) > 0) {
 		my $type;
 		#$messageSender->encryptMessageID(\$data);
+		Utils::TickTimer::begin(Utils::TickTimer::PARSE);
 		$outgoingClientMessages->add($data);
 		$messageSender->sendToServer($_) for $messageSender->process(
 			$outgoingClientMessages, $clientPacketHandler
 		);
+		Utils::TickTimer::end(Utils::TickTimer::PARSE);
 	}
 
 	# GameGuard support
@@ -876,16 +896,20 @@ sub mainLoop_initialized {
 	if ($net->getState() == Network::IN_GAME && timeOut($timeout{ai}) && $net->serverAlive()) {
 		Misc::checkValidity("AI (pre)");
 		Benchmark::begin("ai") if DEBUG;
+		Utils::TickTimer::begin(Utils::TickTimer::AI);
 		AI::CoreLogic::iterate();
 		Benchmark::end("ai") if DEBUG;
 		Benchmark::begin("ai_homunculus") if DEBUG;
 		AI::SlaveManager::iterate();
+		Utils::TickTimer::end(Utils::TickTimer::AI);
 		Benchmark::end("ai_homunculus") if DEBUG;
 		Misc::checkValidity("AI");
 		return if $quit;
 	}
 	Misc::checkValidity("mainLoop_part2.1");
+	Utils::TickTimer::begin(Utils::TickTimer::TASKS);
 	$taskManager->iterate();
+	Utils::TickTimer::end(Utils::TickTimer::TASKS);
 
 	Benchmark::end("mainLoop_part2") if DEBUG;
 	Benchmark::begin("mainLoop_part3") if DEBUG;
@@ -1013,6 +1037,7 @@ sub mainLoop_initialized {
 	$interface->title($args{return});
 
 	Misc::checkValidity("mainLoop_part3");
+	Utils::TickTimer::finishTick();
 	Benchmark::end("mainLoop_part3") if DEBUG;
 }
 
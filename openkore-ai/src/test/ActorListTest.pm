@@ -6,6 +6,7 @@ use strict;
 use Test::More;
 use ActorList;
 use Actor::Player;
+use Utils qw(binAdd binFind binRemove blockDistance);
 use ObjectListTest;
 use base qw(ObjectListTest);
 
@@ -22,6 +23,8 @@ sub run {
 	my ($self) = @_;
 	$self->SUPER::run();
 	$self->testGetAndRemoveByID();
+	$self->testIDIndex();
+	$self->testInRange();
 }
 
 # overloaded
@@ -99,4 +102,55 @@ sub testGetAndRemoveByID {
 	$list->checkValidity();
 }
 
+# The ID index gives the same slots as binAdd and binFind on an ID array
+sub testIDIndex {
+	my $index = new Utils::IDIndex();
+	my (@array, @IDs);
+	my ($same, $adds) = (0, 0);
+	srand(42);
+	for my $i (1 .. 500) {
+		if (@IDs && rand() < 0.45) {
+			my $ID = splice(@IDs, int(rand(@IDs)), 1);
+			binRemove(\@array, $ID);
+			$index->remove($ID);
+		} else {
+			my $ID = pack("V", $i);
+			push @IDs, $ID;
+			$adds++;
+			$same++ if (binAdd(\@array, $ID) == $index->add($ID));
+		}
+	}
+	is($same, $adds, 'IDIndex add gives the slot of binAdd');
+	is_deeply([map { $index->find($_) } @IDs], [map { binFind(\@array, $_) } @IDs], 'IDIndex find gives the slot of binFind');
+	is($index->size(), scalar @IDs, 'IDIndex size');
+	ok(!defined $index->find(pack("V", 501)), 'IDIndex find of a missing ID');
+	ok(!defined $index->remove(pack("V", 501)), 'IDIndex remove of a missing ID');
+	$index->clear();
+	is($index->add("new"), 0, 'IDIndex is empty after clear');
+}
+
+# inRange gives the actors blockDistance() finds, nearest first
+sub testInRange {
+	my ($self) = @_;
+	$self->init();
+	my $list = $self->{list};
+	srand(7);
+	for (1 .. 200) {
+		my $actor = $self->createTestObject();
+		$actor->{pos_to} = { x => int(rand(60)), y => int(rand(60)) };
+		$list->add($actor);
+	}
+	my $unknown = $self->createTestObject();
+	$list->add($unknown);
+	my $pos = { x => 30, y => 25 };
+
+	my @expected = grep { defined $_->{pos_to} && blockDistance($pos, $_->{pos_to}) <= 10 } @{$list->getItems()};
+	@expected = sort { blockDistance($pos, $a->{pos_to}) <=> blockDistance($pos, $b->{pos_to}) } @expected;
+	is_deeply([map { $_->{ID} } $list->inRange($pos, 10)], [map { $_->{ID} } @expected], 'inRange gives the actors within the distance, nearest first');
+	my @all = $list->inRange($pos);
+	is(scalar @all, $list->size(), 'inRange without a distance gives every actor');
+	ok($all[-1] == $unknown, 'actors without a position are the farthest');
+	is_deeply([$list->inRange({ x => 500, y => 500 }, 3)], [], 'inRange far from every actor');
+}
+
 1;
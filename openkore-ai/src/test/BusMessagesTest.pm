@@ -0,0 +1,131 @@
+# A unit test for Bus::Messages and Bus::MessageParser.
+package BusMessagesTest;
+
+use strict;
+use Test::More;
+use Encode;
+use Utils::Exceptions;
+use Bus::Messages qw(serialize unserialize);
+use Bus::MessageParser;
+
+sub start {
+	print "### Starting BusMessagesTest\n";
+	ok($Bus::Messages::native, "The native codec is loaded");
+	testSameMessages();
+	testRoundTrip();
+	testMalformed();
+	testParser();
+}
+
+# Calls the function with the Perl codec
+sub withPerl {
+	my ($function) = @_;
+	local $Bus::Messages::native = 0;
+	return $function->();
+}
+
+sub testSameMessages {
+	my $binary = join('', map { chr } 0..255);
+	my %hash = (
+		name => "Poring",
+		count => 1234567,
+		zero => "0",
+		newline => "42\n",
+		negative => -5,
+		float => 1.5,
+		big => 4294967296 + 7,
+		undefined => undef,
+		binary => $binary,
+		"\x{30DD}\x{30EA}\x{30F3}" => "\x{30DD}\x{30EA}",
+		latin => "caf\x{e9}",
+	);
+	my @array = ("a", 2, undef, "\x{263A}", $binary, "", "007");
+
+	is(serialize("hello", \%hash), withPerl(sub { serialize("hello", \%hash) }), "Hashes are serialized the same way");
+	is(serialize("hello", \@array), withPerl(sub { serialize("hello", \@array) }), "Arrays are serialized the same way");
+	is(serialize("\x{263A}"), withPerl(sub { serialize("\x{263A}") }), "UTF-8 IDs are serialized the same way");
+	is(serialize("empty", {}), withPerl(sub { serialize("empty", {}) }), "Empty hashes are serialized the same way");
+	is(serialize("empty", []), withPerl(sub { serialize("empty", []) }), "Empty arrays are serialized the same way");
+
+	my $data = serialize("hello", \%hash) . serialize("hello", \@array);
+	my (%native, %perl);
+	$native{args} = unserialize($data, \$native{ID}, \$native{processed});
+	withPerl(sub { $perl{args} = unserialize($data, \$perl{ID}, \$perl{processed}) });
+	is_deeply(\%native, \%perl, "Hash messages are read the same way");
+	ok(Encode::is_utf8($native{ID}), "The message ID is a UTF-8 string");
+	ok(Encode::is_utf8((grep { /\x{30DD}/ } keys %{$native{args}})[0]), "Keys are UTF-8 strings");
+
+	my $offset = $native{processed};
+	%native = %perl = ();
+	$native{args} = unserialize($data, \$native{ID}, \$native{processed}, $offset);
+	withPerl(sub { $perl{args} = unserialize($data, \$perl{ID}, \$perl{processed}, $offset) });
+	is_deeply(\%native, \%perl, "Array messages are read the same way at an offset");
+	is($native{args}[3], "\x{263A}", "UTF-8 values are read back");
+	is($native{args}[4], $binary, "Binary values are read back");
+}
+
+sub testRoundTrip {
+	my $ID;
+	my $args = unserialize(serialize("ID"), \$ID);
+	is_deeply($args, {}, "A message without arguments has an empty hash");
+	is($ID, "ID", "Its ID is read");
+
+	my $data = serialize("stats", { exp => 100, zeny => 2 ** 32 - 1 });
+	is(unserialize(substr($data, 0, 3), \$ID), undef, "Less than a length is incomplete");
+	is(unserialize(substr($data, 0, -1), \$ID), undef, "A message without its last byte is incomplete");
+	is(unserialize($data, \$ID, undef, length($data)), undef, "Nothing is read at the end of the data");
+	is_deeply(unserialize($data, \$ID), { exp => 100, zeny => 4294967295 }, "Integers are read back");
+}
+
+# Returns the class of the exception unserialize() throws for the data, with both codecs
+sub exceptions {
+	my ($data) = @_;
+	my @classes;
+	foreach my $perl (0, 1) {
+		local $Bus::Messages::native = $perl ? 0 : $Bus::Messages::native;
+		my $ID;
+		eval { unserialize($data, \$ID) };
+		push @classes, ref($@) || $@;
+	}
+	return \@classes;
+}
+
+sub testMalformed {
+	my $badID = pack("N C C a2", 8, 0, 2, "\xC3\x28");
+	is_deeply(exceptions($badID), ['UTF8MalformedException', 'UTF8MalformedException'],
+		"A message ID which isn't UTF-8 is refused");
+
+	my $badInteger = pack("N C C a1 C a1 C a3 a2", 15, 0, 1, "x", 1, "k", 2, "\0\0\2", "ab");
+	is_deeply(exceptions($badInteger), ['DataFormatException', 'DataFormatException'],
+		"An integer which isn't 4 bytes is refused");
+	eval { unserialize($badInteger, \my $ID) };
+	is($@ && $@->message, "Integer value with invalid length (2) found.", "The length is in the message");
+}
+
+sub testParser {
+	my @messages = map { serialize("message $_", { index => $_, text => "x" x $_ }) } 0..99;
+	my $stream = join('', @messages);
+	my $parser = new Bus::MessageParser();
+	my (@read, $ID);
+
+	# Parts of 1 to 37 bytes, which cut messages at every place
+	my $position = 0;
+	my $size = 1;
+	while ($position < length($stream)) {
+		$parser->add(substr($stream, $position, $size));
+		$position += $size;
+		$size = $size % 37 + 1;
+		while (my $args = $parser->readNext(\$ID)) {
+			push @read, [$ID, $args->{index}, $args->{text}];
+		}
+	}
+	is_deeply(\@read, [map { ["message $_", $_, "x" x $_] } 0..99], "Messages added in parts are all read in order");
+	is($parser->{buffer}, '', "Nothing is left of them");
+
+	$parser->add($stream);
+	my $count = 0;
+	$count++ while ($parser->readNext(\$ID));
+	is($count, 100, "Messages added at once are all read");
+}
+
+1;
@@ -0,0 +1,161 @@
+# A unit test for Bus::Server::NativeServer.
+package BusServerTest;
+
+use strict;
+use Test::More;
+use IO::Socket::INET;
+use Time::HiRes qw(time);
+use Bus::Messages qw(serialize);
+use Bus::MessageParser;
+use Bus::Server::NativeServer;
+
+sub start {
+	print "### Starting BusServerTest\n";
+	testHandshake();
+	testRouting();
+	testDisconnect();
+}
+
+# A bus client of the server: its socket, parser and the messages it received as [ID, args]
+sub connectClient {
+	my ($server) = @_;
+	my $socket = new IO::Socket::INET(PeerAddr => $server->getHost(), PeerPort => $server->getPort(),
+		Proto => 'tcp') or die "Cannot connect to the bus server: $!";
+	$socket->blocking(0);
+	return { socket => $socket, parser => new Bus::MessageParser(), received => [] };
+}
+
+sub sendMessage {
+	my ($client, $ID, $args) = @_;
+	$client->{socket}->syswrite(serialize($ID, $args));
+}
+
+# Serves the clients until they have received $count messages between them, or for 3 seconds
+sub pump {
+	my ($server, $clients, $count) = @_;
+	my $end = time + 3;
+	while (time < $end) {
+		$server->iterate(0.01);
+		my $received = 0;
+		foreach my $client (@{$clients}) {
+			my $data;
+			while (($client->{socket}->sysread($data, 65536) || 0) > 0) {
+				$client->{parser}->add($data);
+			}
+			my $ID;
+			while (my $args = $client->{parser}->readNext(\$ID)) {
+				push @{$client->{received}}, [$ID, $args];
+			}
+			$received += @{$client->{received}};
+		}
+		last if ($received >= $count);
+	}
+}
+
+# Takes the messages a client received
+sub received {
+	my ($client) = @_;
+	my @received = @{$client->{received}};
+	$client->{received} = [];
+	return \@received;
+}
+
+# A server on a free port with identified clients, the last of them private only
+sub newBus {
+	my ($count, $privateOnly) = @_;
+	my $server = new Bus::Server::NativeServer(0, '127.0.0.1', quiet => 1);
+	my @clients;
+	for (1..$count) {
+		push @clients, connectClient($server);
+		pump($server, \@clients, scalar @clients);
+	}
+	foreach my $client (@clients) {
+		$client->{ID} = received($client)->[0][1]{yourID};
+	}
+	for my $i (0..$#clients) {
+		sendMessage($clients[$i], 'HELLO', { userAgent => "test$i",
+			privateOnly => ($privateOnly && $i == $#clients) ? 1 : 0 });
+		my $end = time + 3;
+		$server->iterate(0.01) while ($server->getBusClient($clients[$i]{ID})->{state}
+			!= Bus::Server::MainServer::IDENTIFIED && time < $end);
+	}
+	pump($server, \@clients, $count * ($count - 1) / 2);
+	received($_) foreach (@clients);
+	return ($server, @clients);
+}
+
+sub testHandshake {
+	my $server = new Bus::Server::NativeServer(0, '127.0.0.1', quiet => 1);
+	ok($server->getPort() > 0, "The server listens on a free port");
+
+	my $first = connectClient($server);
+	pump($server, [$first], 1);
+	is_deeply(received($first), [['HELLO', { yourID => 0 }]], "A client gets its ID");
+
+	my $second = connectClient($server);
+	pump($server, [$first, $second], 1);
+	sendMessage($first, 'HELLO', { userAgent => 'first' });
+	sendMessage($second, 'HELLO', { userAgent => 'second' });
+	pump($server, [$first, $second], 2);
+	is_deeply(received($second), [['HELLO', { yourID => 1 }]], "Clients which didn't say HELLO aren't told of others");
+	is_deeply(received($first), [['JOIN', { clientID => 1, name => 'second:1', userAgent => 'second',
+		host => '127.0.0.1' }]], "Identified clients are announced to the others");
+
+	sendMessage($first, 'LIST_CLIENTS', { SEQ => 5 });
+	pump($server, [$first], 1);
+	is_deeply(received($first), [['LIST_CLIENTS', { count => 2, client0 => 0, clientUserAgent0 => 'first',
+		client1 => 1, clientUserAgent1 => 'second', SEQ => 5, IRY => 1 }]], "Clients can be listed");
+}
+
+sub testRouting {
+	my ($server, $a, $b, $private) = newBus(3, 1);
+
+	sendMessage($a, 'chat', { text => "hello", TO => undef });
+	pump($server, [$a, $b, $private], 1);
+	is_deeply(received($a), [['CLIENT_NOT_FOUND', { clientID => '', IRY => 1 }]],
+		"A message for nobody is answered by the server");
+
+	sendMessage($a, 'chat', { text => "\x{263A}", count => 3 });
+	pump($server, [$a, $b, $private], 1);
+	is_deeply(received($b), [['chat', { text => "\x{263A}", count => 3, FROM => $a->{ID} }]],
+		"Broadcasts are relayed with their sender");
+	is_deeply(received($a), [], "Not to the sender");
+	is_deeply(received($private), [], "Nor to clients which only get private messages");
+
+	sendMessage($b, 'whisper', { TO => $private->{ID}, SEQ => 1, FROM => 'spoofed' });
+	sendMessage($b, 'whisper', { TO => "$a->{ID}", SEQ => 2 });
+	pump($server, [$a, $b, $private], 2);
+	is_deeply(received($private), [['whisper', { TO => $private->{ID}, SEQ => 1, FROM => $b->{ID} }]],
+		"Private messages go to their recipient, from their sender");
+	is_deeply(received($a), [['whisper', { TO => $a->{ID}, SEQ => 2, FROM => $b->{ID} }]],
+		"Recipients may be given as strings");
+	is_deeply(received($b), [], "Only to them");
+
+	sendMessage($b, 'whisper', { TO => 99, SEQ => 7 });
+	pump($server, [$b], 1);
+	is_deeply(received($b), [['CLIENT_NOT_FOUND', { clientID => 99, SEQ => 7, IRY => 1 }]],
+		"The sender is told when the recipient doesn't exist");
+
+	my ($relayed, $delivered) = $server->relayed();
+	is($relayed, 3, "Relayed messages are counted");
+	is($delivered, 3, "Their deliveries too");
+	is_deeply([$server->queueDepth($a->{ID})], [0, 0], "Nothing is left in the queues");
+	is_deeply([$server->queueDepth(99)], [], "There is no queue for a client which doesn't exist");
+}
+
+sub testDisconnect {
+	my ($server, $a, $b, $c) = newBus(3);
+
+	$c->{socket}->close();
+	pump($server, [$a, $b], 2);
+	is_deeply(received($a), [['LEAVE', { clientID => $c->{ID} }]], "Clients are told when one leaves");
+	is_deeply(received($b), [['LEAVE', { clientID => $c->{ID} }]], "All of them");
+	is(scalar @{$server->clients()}, 2, "It is forgotten");
+
+	sendMessage($a, 'HELLO', {});
+	pump($server, [$a, $b], 1);
+	is_deeply(received($b), [['LEAVE', { clientID => $a->{ID} }]], "A client which says HELLO twice is closed");
+	is_deeply([$server->queueDepth($a->{ID})], [], "Its queue is gone");
+}
+
+1;
@@ -0,0 +1,144 @@
+# A unit test for the coordinate packing functions of Utils.
+package CoordsTest;
+
+use strict;
+use Test::More;
+use Globals qw($masterServer);
+use Utils qw(getCoordString getCoordString2 makeCoordsDir makeCoordsFromTo makeCoordsXY shiftPack unShiftPack);
+
+sub start {
+	print "### Starting CoordsTest\n";
+	testShiftPack();
+	testCoords();
+}
+
+# The Perl implementations they replaced, which they must match
+sub perlShiftPack {
+	my ($data, $value, $bits) = @_;
+	my ($newdata, $dw1, $dw2, $i, $mask);
+
+	$mask = 2 ** (32 - $bits) - 1;
+	$i = length($$data);
+	$newdata = "";
+	$dw1 = $value & (2 ** $bits - 1);
+	do {
+		$i -= 4;
+		$dw2 = ($i > 0) ?
+			unpack('N', substr($$data, $i, 4)) :
+			unpack('N', pack('x' . abs($i)) . substr($$data, 0, 4 + $i));
+		$dw1 = $dw1 | (($dw2 & $mask) << $bits);
+		$newdata = pack('N', $dw1) . $newdata;
+		$dw1 = $dw2 >> (32 - $bits);
+	} while ($i + 4 > 0);
+
+	$newdata = substr($newdata, 1) while (substr($newdata, 0, 1) eq pack('C', 0) && length($newdata));
+	$$data = $newdata;
+}
+
+sub perlUnShiftPack {
+	my ($data, $reference, $bits) = @_;
+	my ($newdata, $dw1, $dw2, $i, $mask, $done);
+
+	$mask = 2 ** $bits - 1;
+	$i = length($$data);
+	$newdata = "";
+	$done = 0;
+	do {
+		$i -= 4;
+		$dw2 = ($i > 0) ?
+			unpack('N', substr($$data, $i, 4)) :
+			unpack('N', pack('x' . abs($i)) . substr($$data, 0, 4 + $i));
+		unless ($done) {
+			$$reference = $dw2 & (2 ** $bits - 1) if (defined $reference);
+			$done = 1;
+		} else {
+			$dw1 = $dw1 | (($dw2 & $mask) << (32 - $bits));
+			$newdata = pack('N', $dw1) . $newdata;
+		}
+		$dw1 = $dw2 >> $bits;
+	} while ($i + 4 > 0);
+
+	$newdata = substr($newdata, 1) while (substr($newdata, 0, 1) eq pack('C', 0) && length($newdata));
+	$$data = $newdata;
+}
+
+sub randomBytes {
+	my ($len) = @_;
+	return join '', map { chr(rand() < 0.2 ? 0 : int rand 256) } 1 .. $len;
+}
+
+sub testShiftPack {
+	my @wrong;
+	srand(7);
+	for (1 .. 2000) {
+		my $data = randomBytes(int rand 10);
+		my $bits = 1 + int rand 32;
+		my $value = int rand 2 ** 32;
+
+		my ($native, $perl) = ($data, $data);
+		shiftPack(\$native, $value, $bits);
+		perlShiftPack(\$perl, $value, $bits);
+		push @wrong, "shiftPack " . unpack('H*', $data) . " $value $bits" if ($native ne $perl);
+
+		my ($nativeValue, $perlValue);
+		($native, $perl) = ($data, $data);
+		unShiftPack(\$native, \$nativeValue, $bits);
+		perlUnShiftPack(\$perl, \$perlValue, $bits);
+		push @wrong, "unShiftPack " . unpack('H*', $data) . " $bits" if ($native ne $perl || $nativeValue != $perlValue);
+	}
+	ok(!@wrong, "shiftPack() and unShiftPack() work like they did in Perl") or diag(join "\n", @wrong[0 .. ($#wrong > 4 ? 4 : $#wrong)]);
+
+	my $data = '';
+	shiftPack(\$data, 0, 8);
+	is($data, '', "leading zero bytes are dropped");
+	unShiftPack(\$data, undef, 4);
+	is($data, '', "unpacking from nothing leaves nothing");
+}
+
+sub testCoords {
+	my @wrong;
+	my $server = $masterServer;
+	$masterServer = { serverType => 1 };
+	for (1 .. 1000) {
+		my ($x0, $y0, $x1, $y1, $dir) = ((map { int rand 1024 } 1 .. 4), int rand 16);
+		my $stand = substr(pack('N', ($x0 << 14) | ($y0 << 4) | $dir), 1);
+		my $walk = substr(pack('N n', ($x0 << 22) | ($y0 << 12) | ($x1 << 2) | ($y1 >> 8), (($y1 & 0xFF) << 8) | 0x88), 0, 6);
+
+		my (%pos, $body);
+		makeCoordsDir(\%pos, $stand, \$body);
+		push @wrong, "makeCoordsDir $x0 $y0 $dir" if ($pos{x} != $x0 || $pos{y} != $y0 || $body != $dir);
+
+		my (%from, %to);
+		makeCoordsFromTo(\%from, \%to, $walk);
+		push @wrong, "makeCoordsFromTo $x0 $y0 $x1 $y1"
+			if ($from{x} != $x0 || $from{y} != $y0 || $to{x} != $x1 || $to{y} != $y1);
+
+		my %xy;
+		my $raw = $stand;
+		makeCoordsXY(\%xy, \$raw);
+		my ($perlX, $perlY);
+		my $perlRaw = $stand;
+		perlUnShiftPack(\$perlRaw, \$perlY, 10);
+		perlUnShiftPack(\$perlRaw, \$perlX, 10);
+		push @wrong, "makeCoordsXY $x0 $y0" if ($xy{x} != $perlX || $xy{y} != $perlY || $raw ne $perlRaw);
+
+		my $perl = '';
+		perlShiftPack(\$perl, $_->[0], $_->[1]) for ([0x44, 8], [$x0, 10], [$y0, 10], [0, 28]);
+		push @wrong, "getCoordString2 $x0 $y0" if (getCoordString2($x0, $y0) ne $perl);
+		$perl = '';
+		perlShiftPack(\$perl, $_->[0], $_->[1]) for ([0x44, 8], [$x0, 10], [$y0, 10], [0, 4]);
+		push @wrong, "getCoordString $x0 $y0" if (getCoordString($x0, $y0) ne $perl);
+	}
+	ok(!@wrong, "coordinates are packed and unpacked") or diag(join "\n", @wrong[0 .. ($#wrong > 4 ? 4 : $#wrong)]);
+
+	my %pos = (x => 1, y => 2);
+	my $x = \$pos{x};
+	makeCoordsDir(\%pos, "\x01\x40\x53");
+	is_deeply([@pos{qw(x y)}, $$x], [5, 5, 5], "coordinates are assigned to the existing hash entries");
+	is(getCoordString(5, 5, 1), "\x01\x40\x50", "coordinates without padding");
+	$masterServer = { serverType => 0 };
+	is(getCoordString(5, 5), "\x01\x40\x50", "coordinates without padding on serverType 0");
+	$masterServer = $server;
+}
+
+1;
@@ -0,0 +1,172 @@
+# A unit test for Utils::EngineClient.
+package EngineClientTest;
+
+use strict;
+use Test::More;
+use IO::Socket::INET;
+use IO::Select;
+use JSON::PP qw(decode_json);
+use Time::HiRes qw(time);
+use Utils::EngineClient;
+
+use constant TIMEOUT => 5;
+
+sub start {
+	print "### Starting EngineClientTest\n";
+	testEncode();
+	testKeepAlive();
+	testConnectionError();
+}
+
+sub testEncode {
+	my $blessed = bless { name => 'Poring', hp => 50 }, 'Actor::Monster';
+	my %data = (
+		int => 42,
+		negative => -7,
+		float => 1.5,
+		string => "line\nbreak \"quoted\" back\\slash \t\x01",
+		numeric_string => "0012",
+		latin1 => "caf\xe9",
+		unicode => "\x{30dd}\x{30ea}\x{30f3}",
+		undef => undef,
+		true => \1,
+		false => \0,
+		empty_hash => {},
+		empty_array => [],
+		nested => [1, [2, [3]], { a => [{}] }],
+		actor => $blessed,
+	);
+	my $json = Utils::EngineClient::encodeJSON(\%data);
+	ok(!utf8::is_utf8($json), "encodeJSON returns bytes");
+	my $decoded = decode_json($json);
+
+	my %expected = %data;
+	$expected{true} = JSON::PP::true;
+	$expected{false} = JSON::PP::false;
+	$expected{actor} = { %{$blessed} };
+	is_deeply($decoded, \%expected, "encodeJSON encodes like encode_json");
+	is($decoded->{numeric_string}, "0012", "strings stay strings");
+	is(Utils::EngineClient::encodeJSON([1, "1", 2.25]), '[1,"1",2.25]', "numbers stay numbers");
+	is(Utils::EngineClient::encodeJSON([9**9**9]), '[null]', "infinity becomes null");
+	is(Utils::EngineClient::encodeJSON(sub {}), 'null', "code references become null");
+
+	my %loop;
+	$loop{self} = \%loop;
+	my $looped = decode_json(Utils::EngineClient::encodeJSON(\%loop));
+	my $depth = 0;
+	while (ref $looped eq 'HASH') {
+		$looped = $looped->{self};
+		$depth++;
+	}
+	ok($depth > 1 && !defined($looped), "references which loop back end with null");
+	delete $loop{self};
+}
+
+# Wait until the client is done, while the server does nothing
+sub waitFor {
+	my ($client) = @_;
+	my $deadline = time + TIMEOUT;
+	my $status;
+	do {
+		$status = $client->poll();
+	} while ($status == Utils::EngineClient::PENDING && time < $deadline && select(undef, undef, undef, 0.005) >= 0);
+	return $status;
+}
+
+# Accept a connection, polling the client meanwhile
+sub acceptFrom {
+	my ($server, $client) = @_;
+	my $select = IO::Select->new($server);
+	my $deadline = time + TIMEOUT;
+	while (time < $deadline) {
+		$client->poll();
+		return $server->accept() if ($select->can_read(0.005));
+	}
+	return undef;
+}
+
+# Read one request, polling the client meanwhile
+sub readRequest {
+	my ($conn, $client) = @_;
+	my $select = IO::Select->new($conn);
+	my $deadline = time + TIMEOUT;
+	my $buf = '';
+	while (time < $deadline) {
+		$client->poll();
+		if ($buf =~ /^(.*?)\r\n\r\n/s) {
+			my $headers = $1;
+			my ($length) = $headers =~ /^Content-Length: (\d+)/mi;
+			my $total = length($headers) + 4 + $length;
+			if (length($buf) >= $total) {
+				return { headers => $headers, body => substr($buf, length($headers) + 4, $length) };
+			}
+		}
+		if ($select->can_read(0.005)) {
+			my $tmp;
+			return undef if (!sysread($conn, $tmp, 4096));
+			$buf .= $tmp;
+		}
+	}
+	return undef;
+}
+
+sub testKeepAlive {
+	my $server = IO::Socket::INET->new(Listen => 5, LocalAddr => '127.0.0.1', LocalPort => 0, ReuseAddr => 1);
+	my $client = new Utils::EngineClient('127.0.0.1', $server->sockport, TIMEOUT * 1000);
+	is($client->getStatus(), Utils::EngineClient::IDLE, "client starts idle");
+
+	# A plain response with Content-Length
+	ok($client->post("/api/v1/decide", { tick => 1 }), "request is posted");
+	ok(!$client->post("/api/v1/decide", { tick => 2 }), "only one request can be pending");
+	my $conn = acceptFrom($server, $client);
+	ok($conn, "client connects");
+	my $request = readRequest($conn, $client);
+	like($request->{headers}, qr{^POST /api/v1/decide HTTP/1\.1\r\n}, "request line");
+	like($request->{headers}, qr{^Content-Type: application/json\r?$}mi, "request is JSON");
+	is_deeply(decode_json($request->{body}), { tick => 1 }, "request body is the encoded data");
+	syswrite($conn, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: 17\r\n\r\n{\"action\":\"sit\"}\n");
+	is(waitFor($client), Utils::EngineClient::DONE, "response is received");
+	is($client->getResponseCode(), 200, "response code");
+	is($client->getResponseBody(), "{\"action\":\"sit\"}\n", "response body");
+	ok($client->isConnected(), "connection is kept alive");
+	$client->reset();
+	is($client->getStatus(), Utils::EngineClient::IDLE, "reset makes the client idle");
+
+	# A chunked response on the same connection
+	ok($client->post("/api/v1/decide", "raw body"), "string is posted as is");
+	$request = readRequest($conn, $client);
+	is($request->{body}, "raw body", "second request on the same connection");
+	syswrite($conn, "HTTP/1.1 500 Internal Server Error\r\nTransfer-Encoding: chunked\r\n\r\n"
+		. "5\r\nhello\r\n7\r\n, world\r\n0\r\n\r\n");
+	is(waitFor($client), Utils::EngineClient::DONE, "chunked response is received");
+	is($client->getResponseCode(), 500, "error responses are responses too");
+	is($client->getResponseBody(), "hello, world", "chunks are joined");
+
+	# The server closes the idle connection; the request is sent again on a new one
+	close $conn;
+	ok($client->post("/api/v1/decide", { tick => 3 }), "request after the server closed the connection");
+	$conn = acceptFrom($server, $client);
+	ok($conn, "client reconnects");
+	$request = readRequest($conn, $client);
+	is_deeply(decode_json($request->{body} || 'null'), { tick => 3 }, "request is sent again");
+	syswrite($conn, "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\n{}");
+	is(waitFor($client), Utils::EngineClient::DONE, "response after reconnecting");
+	is($client->getResponseBody(), "{}", "response body after reconnecting");
+	ok(!$client->isConnected(), "Connection: close is honored");
+	close $conn;
+	close $server;
+}
+
+sub testConnectionError {
+	# Find a port which nothing listens on
+	my $server = IO::Socket::INET->new(Listen => 1, LocalAddr => '127.0.0.1', LocalPort => 0);
+	my $port = $server->sockport;
+	close $server;
+
+	my $client = new Utils::EngineClient('127.0.0.1', $port, TIMEOUT * 1000);
+	$client->post("/api/v1/decide", {});
+	is(waitFor($client), Utils::EngineClient::ERROR, "connection errors are reported");
+	like($client->getError(), qr/connect/i, "error message");
+}
+
+1;
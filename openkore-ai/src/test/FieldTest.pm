@@ -5,10 +5,14 @@ use strict;
 use Test::More;
 use List::MoreUtils qw(mesh);
 use Field;
+use Utils::PathFinding;
 use FileParsers;
 use Globals;
 use Misc qw(compilePortals);
 use Task::CalcMapRoute;
+use Compress::Zlib;
+use File::Copy;
+use File::Temp;
 
 sub start {
 	print "### Starting FieldTest\n";
@@ -27,6 +31,383 @@ sub start {
 		ok($_->isCity, 'isCity of normal map');
 	}
 	
+	# Both map images have the same colors, rows start at the top of the map
+	for (new Field(name => 'prontera')) {
+		my ($width, $height) = ($_->width, $_->height);
+		my $rgb = $_->imageRGB;
+		is(length $rgb, $width * $height * 3, 'RGB map image size');
+		is($_->imageRGB, $rgb, 'RGB map image is kept with the field');
+		my $xpm = $_->imageXPM;
+		my %colors = $xpm =~ /^"(\w)\tc #(\w{6})",$/mg;
+		my @rows = $xpm =~ /^"(\w{$width})",$/mg;
+		is(scalar @rows, $height, 'XPM map image rows');
+		my @cells = ([0, 0], [156, 190], [$width - 1, $height - 1], [int($width / 2), int($height / 3)]);
+		is_deeply(
+			[map { uc unpack('H6', substr($rgb, (($height - 1 - $_->[1]) * $width + $_->[0]) * 3, 3)) } @cells],
+			[map { $colors{substr($rows[$height - 1 - $_->[1]], $_->[0], 1)} } @cells],
+			'RGB and XPM map images match'
+		);
+	}
+
+	# The tile queries of the native handle match the ones on the raw map, the bit layers match them too
+	for my $field (new Field(name => 'prontera')) {
+		my ($width, $height) = ($field->width, $field->height);
+		my @cells = ((map { [$_ * 7 % $width, $_ * 13 % $height] } 0 .. 499), [-1, 5], [5, -1], [$width, 5], [5, $height]);
+		for my $query ([isWalkable => Field::TILE_WALK], [isSnipable => Field::TILE_SNIPE], [isWater => Field::TILE_WATER], [isCliff => Field::TILE_CLIFF]) {
+			my ($method, $tile) = @$query;
+			my @expected = map { PathFinding::checkTile($_->[0], $_->[1], $tile, $width, $height, \$field->{rawMap}) ? 1 : 0 } @cells;
+			is_deeply([map { $field->$method(@$_) ? 1 : 0 } @cells], \@expected, "$method matches checkTile");
+			my $bits = $field->tileBits($tile);
+			is_deeply([map { vec($bits, $_->[1] * $width + $_->[0], 1) } @cells[0 .. 499]], [@expected[0 .. 499]], "tile bits of $method");
+		}
+		is($field->tileMap, $field->tileMap, 'tile map handle is kept with the field');
+	}
+
+	for (new Field(name => 'prontera')) {
+		my ($x, $y, $radius) = (156, 190, 12);
+		my $distances = $_->distanceField($x, $y, $radius);
+		is(length $$distances, (2 * $radius + 1) ** 2 * 2, 'distance field size');
+		is(PathFinding::distanceFieldAt($distances, $x, $y, $radius, $x, $y), 0, 'distance field source');
+		is(PathFinding::distanceFieldAt($distances, $x, $y, $radius, $x + $radius + 1, $y), -1, 'distance field is limited to its radius');
+		is($_->distanceField($x, $y, $radius), $distances, 'distance fields are cached');
+
+		# Compare against the cost of the paths found by a normal search limited to the same area
+		my $pathfinding = new PathFinding;
+		my @wrong;
+		foreach my $dy (-$radius .. $radius) {
+			foreach my $dx (-$radius .. $radius) {
+				next unless ($_->isWalkable($x + $dx, $y + $dy));
+				my @solution;
+				$pathfinding->reset(field => $_, start => { x => $x, y => $y }, dest => { x => $x + $dx, y => $y + $dy }, avoidWalls => 0,
+					min_x => $x - $radius, max_x => $x + $radius, min_y => $y - $radius, max_y => $y + $radius);
+				my $cost = ($pathfinding->run(\@solution) > 0) ? 0 : -1;
+				$cost += ($solution[$_]{x} != $solution[$_ - 1]{x} && $solution[$_]{y} != $solution[$_ - 1]{y}) ? 14 : 10 for (1 .. $#solution);
+				push @wrong, "$dx $dy" if ($cost != PathFinding::distanceFieldAt($distances, $x, $y, $radius, $x + $dx, $y + $dy));
+			}
+		}
+		ok(!@wrong, 'distance field matches the cost of searched paths') or diag "@wrong";
+	}
+
+	for my $field (new Field(name => 'prontera')) {
+		# The bulk checks give the same results as one call per target
+		my $from = { x => 156, y => 190 };
+		my @targets = map { my $dx = $_; map { { x => 156 + $dx, y => 190 + $_ } } (-16 .. 16) } (-16 .. 16);
+		foreach my $can_snipe (0, 1) {
+			is_deeply([$field->checkLOSMany($from, \@targets, $can_snipe)], [map { $field->checkLOS($from, $_, $can_snipe) } @targets],
+				"checkLOSMany with can_snipe $can_snipe");
+			is_deeply([$field->canAttackMany($from, \@targets, $can_snipe, 9, 15)], [map { $field->canAttack($from, $_, $can_snipe, 9, 15) } @targets],
+				"canAttackMany with can_snipe $can_snipe");
+		}
+		is_deeply([$field->checkLOSMany($from, [])], [], 'checkLOSMany without targets');
+	}
+
+	for my $field (new Field(name => 'prontera')) {
+		# The visibility cache gives the same results as the direct checks, also once it has to replace origins
+		my @origins = map { { x => 150 + $_ * 3, y => 186 + $_ % 3 } } (0 .. 5);
+		my @targets = map { my $dx = $_; map { { x => 156 + $dx, y => 190 + $_ } } (-20 .. 20) } (-20 .. 20);
+		my @direct = map { my $from = $_; [map { $field->canAttack($from, $_, 0, 9, 15) } @targets] } @origins;
+		local $config{attackVisibilityCache} = 4;
+		local $config{clientSight} = 15;
+		ok($field->visibilityCache, 'visibility cache is enabled');
+		is_deeply([map { my $from = $_; [map { $field->canAttack($from, $_, 0, 9, 15) } @targets] } @origins, @origins], [@direct, @direct],
+			'canAttack with the visibility cache');
+		is($field->visibilityCache->count, 4, 'visibility cache keeps at most its capacity');
+		is_deeply([$field->checkLOSMany($origins[0], \@targets, 1)], [map { PathFinding::checkLOS($origins[0]{x}, $origins[0]{y}, $_->{x}, $_->{y}, Field::TILE_WALK | Field::TILE_SNIPE, $field->width, $field->height, \$field->{rawMap}) } @targets],
+			'checkLOSMany with the visibility cache');
+	}
+
+	{
+		# A field whose raw map is kept in chunks answers like the plain one, with only a few chunks decompressed at a time
+		my $plain = new Field(name => 'prontera');
+		my $chunked = do { local $config{fieldChunks} = 2; new Field(name => 'prontera') };
+		my ($width, $height) = ($plain->width, $plain->height);
+		ok($chunked->{rawChunks} && !defined $chunked->{rawMap}, 'raw map is kept in chunks');
+		is($chunked->{rawChunks}->hotCapacity, 2, 'hot chunks');
+		ok($chunked->{rawChunks}->packedSize < length($plain->{rawMap}) / 4, 'chunks are compressed');
+		is(${$chunked->rawMap}, $plain->{rawMap}, 'whole raw map from the chunks');
+		is($chunked->{rawChunks}->region(-2, -1, 3, 2), "\0" x 5 . substr($plain->{rawMap}, 0, 1), 'regions are padded out of the field');
+
+		my @cells = ((map { [$_ * 7 % $width, $_ * 13 % $height] } 0 .. 499), [-1, 5], [5, -1], [$width, 5], [5, $height]);
+		for my $method (qw(isWalkable isSnipable isWater isCliff)) {
+			is_deeply([map { $chunked->$method(@$_) ? 1 : 0 } @cells], [map { $plain->$method(@$_) ? 1 : 0 } @cells], "$method on chunks");
+		}
+		is($chunked->tileBits(Field::TILE_WALK), $plain->tileBits(Field::TILE_WALK), 'tile bits from the chunks');
+		is_deeply([map { $chunked->getBlock($_ * 97) } 0 .. 300], [map { $plain->getBlock($_ * 97) } 0 .. 300], 'getBlock on chunks');
+
+		# The first chunks are read again, after the whole field
+		my $decodes = $chunked->{rawChunks}->decodes;
+		$chunked->isWalkable(1, 1);
+		$chunked->isWalkable(70, 1);
+		$chunked->isWalkable(2, 2);
+		is($chunked->{rawChunks}->decodes, $decodes + 2, 'hot chunks are not decompressed again');
+
+		my $from = { x => 156, y => 190 };
+		my @targets = map { my $dx = $_; map { { x => 156 + $dx, y => 190 + $_ } } (-16 .. 16) } (-16 .. 16);
+		foreach my $can_snipe (0, 1) {
+			is_deeply([map { $chunked->checkLOS($from, $_, $can_snipe) } @targets], [map { $plain->checkLOS($from, $_, $can_snipe) } @targets], "checkLOS on chunks with can_snipe $can_snipe");
+			is_deeply([map { $chunked->canAttack($from, $_, $can_snipe, 9, 15) } @targets], [map { $plain->canAttack($from, $_, $can_snipe, 9, 15) } @targets], "canAttack on chunks with can_snipe $can_snipe");
+			is_deeply([$chunked->checkLOSMany($from, \@targets, $can_snipe)], [$plain->checkLOSMany($from, \@targets, $can_snipe)], "checkLOSMany on chunks with can_snipe $can_snipe");
+			is_deeply([$chunked->canAttackMany($from, \@targets, $can_snipe, 9, 15)], [$plain->canAttackMany($from, \@targets, $can_snipe, 9, 15)], "canAttackMany on chunks with can_snipe $can_snipe");
+		}
+		is_deeply([map { $chunked->checkPathFree($from, $_) } @targets], [map { $plain->checkPathFree($from, $_) } @targets], 'checkPathFree on chunks');
+		is_deeply([$chunked->calcRectArea(156, 190, 8)], [$plain->calcRectArea(156, 190, 8)], 'calcRectArea on chunks');
+		is_deeply([$chunked->calcRectArea(2, 3, 8)], [$plain->calcRectArea(2, 3, 8)], 'calcRectArea on chunks at the edge of the field');
+		is($chunked->calcRectArea_packed(156, 190, 8), $plain->calcRectArea_packed(156, 190, 8), 'calcRectArea_packed on chunks');
+		is(${$chunked->walkablePrefix}, ${$plain->walkablePrefix}, 'walkable prefix from the chunks');
+
+		my $pathfinding = new PathFinding;
+		my @solution;
+		$pathfinding->reset(field => $plain, start => $from, dest => { x => 200, y => 100 });
+		$pathfinding->run(\@solution);
+		ok(@solution > 1, 'path for smoothSolution');
+		is_deeply([$chunked->smoothSolution(\@solution, 10)], [$plain->smoothSolution(\@solution, 10)], 'smoothSolution on chunks');
+		$pathfinding->reset(field => $chunked, start => $from, dest => { x => 200, y => 100 });
+		my @chunkedSolution;
+		$pathfinding->run(\@chunkedSolution);
+		is_deeply(\@chunkedSolution, \@solution, 'pathfinding on a chunked field');
+	}
+
+	for my $field (new Field(name => 'prontera')) {
+		# Sampled cells are different walkable cells of the area, all of them are drawn when few are available
+		my $pos = { x => 156, y => 190 };
+		my @cells = $field->sampleWalkable($pos, 10, 20);
+		is(scalar @cells, 20, 'sampleWalkable count');
+		ok(!grep({ !$field->isWalkable($_->{x}, $_->{y}) || abs($_->{x} - $pos->{x}) > 10 || abs($_->{y} - $pos->{y}) > 10 } @cells), 'sampled cells are walkable cells of the area');
+		is(scalar keys %{{ map { ("$_->{x} $_->{y}" => 1) } @cells }}, 20, 'sampled cells are different');
+
+		my @walkable = grep { $field->isWalkable(@{$_}{qw(x y)}) } map { my $x = $_; map { { x => $x, y => $_ } } (185 .. 195) } (150 .. 160);
+		my @all = $field->sampleWalkableArea(150, 160, 185, 195, 1000);
+		is_deeply([sort map { "$_->{x} $_->{y}" } @all], [sort map { "$_->{x} $_->{y}" } @walkable], 'sampleWalkableArea draws every walkable cell');
+
+		# Cells which can only be reached by leaving the radius are not drawn
+		my $radius = 12;
+		my $distances = $field->distanceField($pos->{x}, $pos->{y}, $radius);
+		my @reachable = $field->sampleWalkable($pos, $radius, 2000, 1);
+		ok(@reachable && !grep({ PathFinding::distanceFieldAt($distances, $pos->{x}, $pos->{y}, $radius, $_->{x}, $_->{y}) < 0 } @reachable), 'sampled cells are reachable');
+		is(scalar(@reachable), scalar(grep { PathFinding::distanceFieldAt($distances, $pos->{x}, $pos->{y}, $radius, $_->{x}, $_->{y}) >= 0 } $field->sampleWalkable($pos, $radius, 2000)),
+			'every reachable cell is drawn');
+	}
+
+	for my $field (new Field(name => 'prontera')) {
+		# Connected area labels are the same when built from the weight map and when loaded from the .comp file
+		my $built = PathFinding::makeComponents(\$field->{weightMap}, $field->width, $field->height);
+		is(${$field->components}, $built, 'components of the weight map');
+		ok(-f $field->{componentsFile}, 'components are saved');
+		is(${(new Field(name => 'prontera'))->components}, $built, 'components loaded from the file');
+	}
+
+	{
+		# The distance map is the city block distance to the nearest wall, cells out of the map count as walls
+		srand(2);
+		my ($width, $height) = (41, 29);
+		my $raw = join '', map { rand() < 0.9 ? "\1" : "\0" } 1 .. $width * $height;
+		my @expected = map { my $i = $_; ord(substr($raw, $i, 1)) & 1 ? 255 : 0 } 0 .. $width * $height - 1;
+		for my $i (0 .. $#expected) {
+			next unless $expected[$i];
+			my ($x, $y) = ($i % $width, int($i / $width));
+			my $best = List::Util::min($x + 1, $y + 1, $width - $x, $height - $y);
+			for my $j (grep { !$expected[$_] } 0 .. $#expected) {
+				my $dist = abs($j % $width - $x) + abs(int($j / $width) - $y);
+				$best = $dist if ($dist < $best);
+			}
+			$expected[$i] = $best;
+		}
+		is_deeply([unpack('C*', Utils::makeDistMap($raw, $width, $height))], \@expected, 'makeDistMap gives the distance to the nearest wall');
+
+		my $dist = Utils::makeDistMap($raw, $width, $height);
+		my $weight = Utils::makeWeightMap($dist, $width, $height);
+		is_deeply([Utils::makeFieldMaps($raw, $width, $height)], [$dist, $weight, PathFinding::makeNeighborMask(\$weight, $width, $height)],
+			'makeFieldMaps builds the same maps as the separate calls');
+		is(Utils::makeWeightProfile($dist, $width, $height, [60, 50, 20, 10, 0]), $weight, 'makeWeightProfile with the default weights');
+		my @profile = (90, 45, 5);
+		is_deeply([unpack('c*', Utils::makeWeightProfile($dist, $width, $height, \@profile))],
+			[map { $_ ? $profile[($_ > 3 ? 3 : $_) - 1] : -1 } unpack('C*', $dist)], 'makeWeightProfile weights by distance to the walls');
+		my $walls = "\0" x ($width * $height);
+		substr($walls, 0, 1) = chr(255);
+		is_deeply([unpack('c*', Utils::makeWeightProfile($dist, $width, $height, [7], \$walls))],
+			[-1, (7) x ($width * $height - 1)], 'makeWeightProfile keeps the walls of the given weight map');
+		ok(!eval { Utils::makeWeightProfile($dist, $width, $height, [200]); 1 }, 'makeWeightProfile refuses weights out of range');
+		is_deeply([Utils::makeFieldMaps($raw, $width, $height + 1)], [], 'makeFieldMaps with a wrong map size');
+
+		my $file = File::Spec->catfile($Settings::fields_folder, 'prontera.fld2.gz');
+		my $gz = gzopen($file, 'rb');
+		my ($plain, $buf) = ('');
+		$plain .= $buf while ($gz->gzread($buf) > 0);
+		$gz->gzclose;
+		is_deeply([Utils::inflateField($file)], [substr($plain, 4), unpack('v v', $plain)], 'inflateField reads the field data and size');
+		is_deeply([Utils::inflateField("$file.missing")], [], 'inflateField of a missing file');
+	}
+
+	{
+		# Repaired maps are the ones built again from the changed raw map, the areas are numbered in another order
+		srand(3);
+		my ($width, $height) = (47, 31);
+		my $raw = join '', map { rand() < 0.8 ? "\1" : "\0" } 1 .. $width * $height;
+		my ($dist, $weight, $mask) = Utils::makeFieldMaps($raw, $width, $height);
+		my $components = PathFinding::makeComponents(\$weight, $width, $height);
+		my @profile = (90, 80, 70, 60, 50, 40, 30, 20, 10);
+		my $profiled = Utils::makeWeightProfile($dist, $width, $height, \@profile, \$weight);
+		foreach my $round (1 .. 20) {
+			my @cells = map { (int(rand($width)), int(rand($height))) } 1 .. 1 + $round % 4;
+			push @cells, $cells[0] + 1, $cells[1] if ($cells[0] + 1 < $width);
+			vec($raw, $cells[$_ * 2 + 1] * $width + $cells[$_ * 2], 8) ^= 1 for (0 .. @cells / 2 - 1);
+			my $packed = pack('v*', @cells);
+			Utils::repairDistMap(\$dist, \$raw, $width, $height, $packed);
+			Utils::repairWeightProfile(\$weight, \$raw, $width, $height, $packed);
+			Utils::repairWeightProfile(\$profiled, \$raw, $width, $height, $packed, \@profile, \$weight);
+			PathFinding::repairNeighborMask(\$mask, \$weight, $width, $height, $packed);
+			PathFinding::repairComponents(\$components, \$weight, $width, $height, $packed);
+		}
+		my @rebuilt = Utils::makeFieldMaps($raw, $width, $height);
+		is($dist, $rebuilt[0], 'repaired distance map');
+		is($weight, $rebuilt[1], 'repaired weight map');
+		is($mask, $rebuilt[2], 'repaired neighbor mask');
+		is($profiled, Utils::makeWeightProfile($rebuilt[0], $width, $height, \@profile, \$rebuilt[1]), 'repaired weight profile map');
+		is(renumbered($components), PathFinding::makeComponents(\$rebuilt[1], $width, $height), 'repaired components tell the same areas apart');
+		ok(!eval { Utils::repairDistMap(\$dist, \$raw, $width, $height + 1, ''); 1 }, 'repairDistMap refuses a map of another size');
+	}
+
+	{
+		# An Ice Wall changes the maps of a field from the field cache, without changing the cache
+		my $dir = File::Temp::tempdir(CLEANUP => 1);
+		File::Copy::copy(File::Spec->catfile($Settings::fields_folder, 'prontera.fld2.gz'), $dir) or die "Cannot copy prontera: $!";
+		local $Settings::fields_folder = $dir;
+		local $config{fieldCache} = 1;
+		new Field(name => 'prontera');
+		my $field = new Field(name => 'prontera');
+		my ($width, $height) = ($field->width, $field->height);
+		my %before = (weightMap => $field->{weightMap}, neighborMask => ${$field->neighborMask}, components => renumbered(${$field->components}));
+		my @wall = map { { x => 150 + $_, y => 180, type => 1 } } (0 .. 4);
+		ok($field->isWalkable(150, 180), 'cell is walkable before the Ice Wall');
+		is($field->changeCells(@wall), 5, 'Ice Wall changes its cells');
+		ok(!$field->isWalkable(150, 180), 'Ice Wall cell is not walkable');
+		ok(!$field->{fieldCache}, 'changed field leaves the field cache');
+		my @rebuilt = Utils::makeFieldMaps($field->{rawMap}, $width, $height);
+		is($field->{weightMap}, $rebuilt[1], 'weight map of the changed field');
+		is(${$field->neighborMask}, $rebuilt[2], 'neighbor mask of the changed field');
+		is(renumbered(${$field->components}), PathFinding::makeComponents(\$rebuilt[1], $width, $height), 'components of the changed field');
+		my @solution;
+		my $pathfinding = new PathFinding(field => $field, start => { x => 152, y => 178 }, dest => { x => 152, y => 182 });
+		$pathfinding->run(\@solution);
+		ok(!grep({ $_->{y} == 180 && $_->{x} >= 150 && $_->{x} <= 154 } @solution), 'search walks around the Ice Wall');
+		is($field->changeCells(@wall), 0, 'cells which are already changed');
+		is(${(new Field(name => 'prontera'))->neighborMask}, $before{neighborMask}, 'field cache keeps the field as it was');
+
+		is($field->changeCells(map { { %$_, type => 0 } } @wall), 5, 'Ice Wall goes away');
+		is_deeply({ weightMap => $field->{weightMap}, neighborMask => ${$field->neighborMask}, components => renumbered(${$field->components}) }, \%before,
+			'maps are back to the ones of the field');
+
+		local $config{fieldCache};
+		local $config{fieldChunks} = 2;
+		my $chunked = new Field(name => 'prontera');
+		$chunked->changeCells(@wall);
+		ok(!$chunked->isWalkable(150, 180), 'Ice Wall on a field kept in chunks');
+		is($chunked->{weightMap}, $rebuilt[1], 'weight map of the changed field kept in chunks');
+	}
+
+	{
+		# Fields loaded from the field cache have the same maps as the ones loaded from the field file
+		my $dir = File::Temp::tempdir(CLEANUP => 1);
+		File::Copy::copy(File::Spec->catfile($Settings::fields_folder, 'prontera.fld2.gz'), $dir) or die "Cannot copy prontera: $!";
+		local $Settings::fields_folder = $dir;
+		local $config{fieldCache} = 1;
+		my $plain = do { local $config{fieldCache}; new Field(name => 'prontera') };
+		my $first = new Field(name => 'prontera');
+		ok(-f File::Spec->catfile($dir, 'prontera.fldc'), 'field cache is written on the first load');
+		ok($first->{fieldCache}, 'first load switches to the field cache');
+		is($first->{weightMap}, $plain->{weightMap}, 'first load weight map');
+		my $cached = new Field(name => 'prontera');
+		ok($cached->{fieldCache}, 'field is loaded from the field cache');
+		is_deeply([map { $cached->{$_} } qw(width height rawMap weightMap)], [map { $plain->{$_} } qw(width height rawMap weightMap)], 'field cache maps');
+		is(${$cached->neighborMask}, ${$plain->neighborMask}, 'field cache neighbor mask');
+		is(${$cached->components}, ${$plain->components}, 'field cache components');
+		my @solution;
+		my $pathfinding = new PathFinding(field => $cached, start => { x => 156, y => 190 }, dest => { x => 150, y => 100 });
+		is($pathfinding->run(\@solution), scalar @solution, 'search on a field from the cache');
+
+		my $graph = $cached->abstractGraph->serialize;
+		my $withGraph = new Field(name => 'prontera');
+		ok($withGraph->{fieldCache}->hasLayer(Field::FIELD_CACHE_HPA), 'hierarchical graph is added to the field cache');
+		is($withGraph->abstractGraph->serialize, $graph, 'hierarchical graph from the field cache');
+
+		my $landmarks = ${$withGraph->landmarks};
+		my $withLandmarks = new Field(name => 'prontera');
+		ok($withLandmarks->{fieldCache}->hasLayer(Field::FIELD_CACHE_LANDMARKS), 'landmarks are added to the field cache');
+		is(${$withLandmarks->landmarks}, $landmarks, 'landmarks from the field cache');
+		ok($withLandmarks->{fieldCache}->hasLayer(Field::FIELD_CACHE_HPA), 'hierarchical graph is kept in the field cache');
+		my @guided;
+		$pathfinding->reset(field => $withLandmarks, start => { x => 156, y => 190 }, dest => { x => 150, y => 100 }, landmarks => $withLandmarks->landmarks);
+		is($pathfinding->run(\@guided), scalar @solution, 'search with the landmarks of a field');
+
+		{
+			local $config{weightProfile_kiter} = '120, 90, 60, 30, 10, 0';
+			my $kiter = $withLandmarks->weightProfileMap('kiter');
+			is($withLandmarks->weightProfileMap('default'), \$withLandmarks->{weightMap}, 'default weight profile is the weight map');
+			is($withLandmarks->weightProfileMap('unknown'), \$withLandmarks->{weightMap}, 'unknown weight profiles are the weight map');
+			is($withLandmarks->weightProfileMap([120, 90, 60, 30, 10, 0]), $kiter, 'weight profile maps are kept');
+			is(join('', map { $_ == -1 ? 1 : 0 } unpack('c*', $$kiter)), join('', map { $_ == -1 ? 1 : 0 } unpack('c*', $withLandmarks->{weightMap})),
+				'weight profile maps have the walls of the weight map');
+			my $profiled = new Field(name => 'prontera');
+			is(${$profiled->weightProfileMap('kiter')}, $$kiter, 'weight profile map from the field cache');
+			ok($profiled->{fieldCache}->hasLayer(Field::FIELD_CACHE_LANDMARKS), 'landmarks are kept in the field cache');
+			my @kiting;
+			$pathfinding->reset(field => $profiled, start => { x => 156, y => 190 }, dest => { x => 150, y => 100 }, weight_profile => 'kiter');
+			is($pathfinding->run(\@kiting), scalar @kiting, 'search with a weight profile');
+			$profiled->weightProfileMap([$_]) for (1 .. Field::WEIGHT_PROFILE_CACHE_SIZE + 2);
+			is(scalar keys %{$profiled->{weightProfiles}}, Field::WEIGHT_PROFILE_CACHE_SIZE, 'weight profile maps are bounded');
+		}
+
+		my $changedTime = time - 100;
+		utime($changedTime, $changedTime, File::Spec->catfile($dir, 'prontera.fld2.gz'));
+		my $changed = new Field(name => 'prontera');
+		is($changed->{fieldCache}->sourceTime, $changedTime, 'field cache of a changed field file is written again');
+		ok(!$changed->{fieldCache}->hasLayer(Field::FIELD_CACHE_HPA), 'field cache of a changed field file is not used');
+
+		my $touchedTime = time - 200;
+		utime($touchedTime, $touchedTime, File::Spec->catfile($dir, 'prontera.fld2.gz'));
+		undef $changed;
+		is_deeply([Field->refreshFieldCaches($dir)], [1, 0], 'field cache of a touched field file is refreshed');
+		my $touched = new Field(name => 'prontera');
+		is($touched->{fieldCache}->sourceTime, $touchedTime, 'refreshed field cache is used');
+		undef $touched;
+		is_deeply([Field->refreshFieldCaches($dir)], [0, 0], 'up to date field caches are left alone');
+
+		open(my $f, ">>", File::Spec->catfile($dir, 'prontera.fld2.gz')) or die "Cannot append to prontera: $!";
+		print $f "\0";
+		close($f);
+		is_deeply([Field->refreshFieldCaches($dir)], [0, 1], 'field cache of a modified field file is out of date');
+	}
+
+	{
+		# Fields read in the background have the same maps as the ones loaded right away
+		my $dir = File::Temp::tempdir(CLEANUP => 1);
+		File::Copy::copy(File::Spec->catfile($Settings::fields_folder, 'prontera.fld2.gz'), $dir) or die "Cannot copy prontera: $!";
+		local $Settings::fields_folder = $dir;
+		local $config{fieldCache};
+		my $file = File::Spec->catfile($dir, 'prontera.fld2.gz');
+		my ($raw, $width, $height) = Utils::inflateField($file);
+		my @maps = Utils::makeFieldMaps($raw, $width, $height);
+
+		is(Field->prefetch('prontera', 'prontera', 'notafield'), 1, 'prefetch queues each existing field once');
+		is_deeply([Utils::takePrefetchedField($file)], [$raw, $width, $height, @maps, PathFinding::makeComponents(\$maps[1], $width, $height)],
+			'prefetched field has the field data and the maps built by makeFieldMaps');
+		is_deeply([Utils::takePrefetchedField($file)], [], 'prefetched field is only taken once');
+
+		my $plain = new Field(name => 'prontera');
+		Field->prefetch('prontera');
+		my $prefetched = new Field(name => 'prontera');
+		is(Utils::pendingPrefetchedFields(), 0, 'loading a field takes its prefetched data');
+		is_deeply([map { $prefetched->{$_} } qw(width height rawMap weightMap)], [map { $plain->{$_} } qw(width height rawMap weightMap)], 'prefetched field maps');
+		is(${$prefetched->components}, ${$plain->components}, 'prefetched field components');
+
+		Field->prefetch('prontera');
+		is(scalar(() = Utils::takePrefetchedField($file)), 3, 'maps are not built for a field with a weight map file');
+
+		Field->prefetch('prontera');
+		Utils::clearPrefetchedFields();
+		is_deeply([Utils::takePrefetchedField($file)], [], 'cleared prefetched fields are dropped');
+	}
+
 	for (new Field(name => 'aretnorp')) {
 		is($_->name, 'aretnorp', 'name of aliased map');
 		is($_->baseName, 'aretnorp', 'baseName of aliased map');
@@ -56,6 +437,13 @@ sub start {
 	}
 }
 
+# Connected area labels numbered in the order of their first cell, as PathFinding::makeComponents() numbers them
+sub renumbered {
+	my ($labels) = @_;
+	my (%numbers, $next);
+	return pack('v*', map { $_ ? ($numbers{$_} //= ++$next) : 0 } unpack('v*', $labels));
+}
+
 sub is_route_reachable {
 	for (new Task::CalcMapRoute(@_)) {
 		$_->activate;
@@ -69,6 +69,46 @@ sub start {
 			done_testing();
 		};
 
+		subtest 'control tables' => sub {
+			use utf8;
+			my %table = (
+				'red potion' => { keep => 1 },
+				'коктейль' => { keep => 2 },
+				"caf\xc9" => { keep => 3 },
+				501 => { keep => 4 },
+				zero => 0,
+				all => { keep => 5 },
+			);
+			my %saved = (items_control => {%items_control}, pickupitems => {%pickupitems}, mon_control => {%mon_control});
+			%items_control = %table;
+			%pickupitems = %table;
+			my @names = ('Red Potion', 'RED POTION', 'Коктейль', 'КОКТЕЙЛЬ', "caf\xc9", "CAF\xc9", "caf\xe9", 'Zero', 'Red Potion ' x 20, undef);
+			push @names, @names[0, 1];
+			for my $i (0 .. $#names) {
+				my $name = $names[$i];
+				for my $nameID (501, '501', 502, undef) {
+					my $label = "name $i, ID " . (defined $nameID ? $nameID : 'undef');
+					no warnings 'uninitialized';
+					is(items_control($name, $nameID), $table{lc $name} || $table{$nameID} || $table{all}, "items_control $label");
+					my $expected = exists $table{lc $name} ? $table{lc $name} : exists $table{$nameID} ? $table{$nameID} : $table{all};
+					is(pickupitems($name, $nameID), $expected, "pickupitems $label");
+				}
+			}
+			delete $items_control{all};
+			$items_control{'new item'} = { keep => 6 };
+			is_deeply(items_control('unknown'), {}, 'no entry');
+			is(items_control('New Item')->{keep}, 6, 'changes to the table are seen');
+			%mon_control = ();
+			is_deeply(mon_control('Poring', 1002), { attack_auto => 1 }, 'monsters are attacked by default');
+			mon_control('Poring')->{attack_auto} = 0;
+			is(mon_control('Poring')->{attack_auto}, 1, 'defaults are new every time');
+
+			%items_control = %{$saved{items_control}};
+			%pickupitems = %{$saved{pickupitems}};
+			%mon_control = %{$saved{mon_control}};
+			done_testing();
+		};
+
 		subtest 'writeDataFileIntact' => sub {
 			my $config = {};
 			parseConfigFile('data/write_config.txt', $config);
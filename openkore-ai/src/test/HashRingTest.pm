@@ -0,0 +1,75 @@
+# A unit test for Utils::HashRing.
+package HashRingTest;
+
+use strict;
+use Test::More;
+use Utils::HashRing;
+
+sub start {
+	print "### Starting HashRingTest\n";
+	testRouting();
+	testChanges();
+	testFailover();
+}
+
+sub testRouting {
+	my $ring = new Utils::HashRing();
+	is($ring->node('bot'), undef, "an empty ring has no node");
+
+	my @nodes = map { "10.0.0.$_:9901" } (1 .. 4);
+	$ring = new Utils::HashRing(\@nodes);
+	$ring->add($nodes[0]);
+	is_deeply([$ring->nodes], \@nodes, "nodes are added once");
+	is($ring->node('bot1'), $ring->node('bot1'), "a key always goes to the same node");
+	is_deeply([sort($ring->nodes('bot1'))], [sort @nodes], "a key fails over to all the other nodes");
+	is(($ring->nodes('bot1'))[0], $ring->node('bot1'), "a key goes to its first node");
+	is(new Utils::HashRing([reverse @nodes])->node('bot1'), $ring->node('bot1'),
+		"the node of a key doesn't depend on the order nodes are added in");
+
+	my %count;
+	$count{$ring->node("bot$_")}++ for (1 .. 4000);
+	my @counts = map { $count{$_} || 0 } @nodes;
+	ok(!(grep { $_ < 500 || $_ > 1500 } @counts), "keys are spread over the nodes") or diag("@counts");
+}
+
+# Only the keys of a node added or removed move
+sub testChanges {
+	my @nodes = map { "engine$_" } (1 .. 4);
+	my $ring = new Utils::HashRing(\@nodes);
+	my %before = map { $_ => $ring->node("bot$_") } (1 .. 2000);
+
+	$ring->add('engine5');
+	my ($moved, $wrong) = (0, 0);
+	foreach my $key (keys %before) {
+		my $node = $ring->node("bot$key");
+		next if ($node eq $before{$key});
+		$moved++;
+		$wrong++ if ($node ne 'engine5');
+	}
+	ok($moved > 200 && $moved < 700, "adding a node moves about its share of the keys") or diag($moved);
+	is($wrong, 0, "keys only move to the new node");
+
+	$ring->remove('engine5');
+	is_deeply({map { $_ => $ring->node("bot$_") } (1 .. 2000)}, \%before, "removing it moves them back");
+}
+
+sub testFailover {
+	my @nodes = map { "engine$_" } (1 .. 3);
+	my $ring = new Utils::HashRing(\@nodes);
+	my @order = $ring->nodes('bot');
+
+	$ring->markDown($order[0], 30);
+	ok(!$ring->isUp($order[0]), "nodes can be marked down");
+	is($ring->node('bot'), $order[1], "keys of a node down go to the next node");
+	$ring->markDown($order[1], 30);
+	is($ring->node('bot'), $order[2], "and on to the one after");
+	$ring->markDown($order[2], 30);
+	is($ring->node('bot'), $order[0], "with all nodes down, keys go to their own node");
+
+	$ring->markUp($order[0]);
+	is($ring->node('bot'), $order[0], "keys go back to a node up again");
+	$ring->markDown($order[0], -1);
+	ok($ring->isUp($order[0]), "nodes are up again once their time runs out");
+}
+
+1;
@@ -0,0 +1,58 @@
+# Unit test for HierarchicalPathFinding
+package HierarchicalPathFindingTest;
+use strict;
+
+use File::Temp qw(tempdir);
+use Test::More;
+use Utils::HierarchicalPathFinding;
+
+sub start {
+	print "### Starting HierarchicalPathFindingTest\n";
+
+	# A 100x100 map with two walls, each of them with a single gap
+	my ($width, $height) = (100, 100);
+	my $map = "\0" x ($width * $height);
+	substr($map, $_ * $width + 30, 1) = chr(255) for grep { $_ != 90 } 0..$height-1;
+	substr($map, 60 * $width + $_, 1) = chr(255) for grep { $_ != 5 } 31..$width-1;
+
+	my $graph = HierarchicalPathFinding->build(weight_map => \$map, width => $width, height => $height, cluster_size => 16);
+	ok(scalar @{$graph->{nodeX}}, 'entrances were found');
+
+	my @solution = $graph->findPath(start => { x => 2, y => 2 }, dest => { x => 95, y => 95 }, avoidWalls => 0);
+	ok(@solution, 'path across the map');
+	ok(isValidPath(\$map, $width, [2, 2], [95, 95], @solution), 'path is made of single walkable steps');
+	ok(scalar(grep { $_->{x} == 30 && $_->{y} == 90 } @solution), 'path goes through the first gap');
+
+	@solution = $graph->findPath(start => { x => 3, y => 4 }, dest => { x => 10, y => 12 }, avoidWalls => 0);
+	is(scalar @solution, 9, 'short path inside a single cluster');
+
+	my $blocked = $map;
+	substr($blocked, 90 * $width + 30, 1) = chr(255);
+	my $blockedGraph = HierarchicalPathFinding->build(weight_map => \$blocked, width => $width, height => $height, cluster_size => 16);
+	@solution = $blockedGraph->findPath(start => { x => 2, y => 2 }, dest => { x => 95, y => 95 });
+	is(scalar @solution, 0, 'no path through a closed wall');
+
+	my $file = tempdir(CLEANUP => 1) . '/test.hpa';
+	ok($graph->save($file), 'save abstract graph');
+	my $loaded = HierarchicalPathFinding->load($file, weight_map => \$map, width => $width, height => $height);
+	ok($loaded, 'load abstract graph');
+	is_deeply([$loaded->findPath(start => { x => 2, y => 2 }, dest => { x => 95, y => 95 }, avoidWalls => 0)],
+		[$graph->findPath(start => { x => 2, y => 2 }, dest => { x => 95, y => 95 }, avoidWalls => 0)],
+		'loaded graph finds the same path');
+	ok(!HierarchicalPathFinding->load($file, weight_map => \$blocked, width => $width, height => $height), 'graph of another weight map is not loaded');
+}
+
+sub isValidPath {
+	my ($map, $width, $start, $dest, @solution) = @_;
+	my $walkable = sub { ord(substr($$map, $_[1] * $width + $_[0], 1)) != 255 };
+	return 0 unless ($solution[0]{x} == $start->[0] && $solution[0]{y} == $start->[1]
+		&& $solution[-1]{x} == $dest->[0] && $solution[-1]{y} == $dest->[1]);
+	for my $i (1 .. $#solution) {
+		my ($from, $to) = ($solution[$i - 1], $solution[$i]);
+		return 0 if (abs($to->{x} - $from->{x}) > 1 || abs($to->{y} - $from->{y}) > 1 || !$walkable->($to->{x}, $to->{y}));
+		return 0 if (!$walkable->($from->{x}, $to->{y}) || !$walkable->($to->{x}, $from->{y}));
+	}
+	return 1;
+}
+
+1;
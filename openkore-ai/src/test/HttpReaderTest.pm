@@ -41,7 +41,9 @@ sub calcChecksum {
 sub run {
 	my ($self) = @_;
 	$self->testMirrorSelection();
+	$self->testMirrorRace();
 	$self->testDownload();
+	$self->testStreamingDownload();
 	$self->testFailedDownload();
 }
 
@@ -69,6 +71,24 @@ sub testMirrorSelection {
 		"Downloaded data is correct");
 }
 
+sub testMirrorRace {
+	use constant RACE_TIMEOUT => 10000;
+
+	# INVALID_URL never answers: the next mirror is started while it's still connecting
+	my @urls = (INVALID_URL, SMALL_TEST_URL);
+	my $beginTime = time;
+	my $http = new MirrorHttpReader(\@urls, RACE_TIMEOUT);
+	while ($http->getStatus == HttpReader::CONNECTING) {
+		sleep 0.01;
+	}
+	ok(time - $beginTime < RACE_TIMEOUT / 1000,
+		"A mirror which doesn't answer doesn't hold up the next one");
+	isnt($http->getStatus, HttpReader::ERROR,
+		"Status is not HTTP_READER_ERROR");
+	ok(MirrorHttpReader::getLatency(SMALL_TEST_URL) > 0,
+		"The latency of the mirror which answered is remembered");
+}
+
 sub testDownload {
 	my @urls = (SMALL_TEST_URL);
 	my $http = new MirrorHttpReader(\@urls);
@@ -108,6 +128,40 @@ sub testDownload {
 	is($totalSize, SMALL_TEST_SIZE, "Size is OK");
 }
 
+sub testStreamingDownload {
+	my @urls = (SMALL_TEST_URL);
+	my $http = new MirrorHttpReader(\@urls);
+	$http->setStreaming();
+	while ($http->getStatus == HttpReader::CONNECTING) {
+		sleep 0.01;
+	}
+
+	my $done;
+	my $checksum = 0;
+	my $totalSize = 0;
+	my $chunks = 0;
+	while (!$done) {
+		my $buf;
+		my $ret = $http->pullChunk($buf);
+		isnt($ret, -2, "pullChunk() never fails for valid test URL");
+
+		if ($ret == -1) {
+			sleep 0.01;
+		} elsif ($ret > 0) {
+			is(length($buf), $ret, "Size of chunk equals pullChunk() return value");
+			$checksum = calcChecksum($buf, $checksum);
+			$totalSize += $ret;
+			$chunks++;
+		} else {
+			$done = 1;
+		}
+	}
+	is($http->getStatus, HttpReader::DONE, "Status is HTTP_READER_DONE");
+	is($checksum, SMALL_TEST_CHECKSUM, "Checksum of chunks is OK");
+	is($totalSize, SMALL_TEST_SIZE, "Size of chunks is OK");
+	ok($chunks >= SMALL_TEST_SIZE / 16384, "Data came in chunks of at most 16 KB");
+}
+
 sub testFailedDownload {
 	my @urls = (ERROR_URL2);
 	my $http = new MirrorHttpReader(\@urls, 3000);
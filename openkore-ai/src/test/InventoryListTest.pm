@@ -25,6 +25,7 @@ sub run {
 	$self->testGetAndRemoveByName();
 	$self->testNameChange();
 	$self->testNonstackableItems();
+	$self->testIndices();
 }
 
 # overloaded
@@ -164,4 +165,58 @@ sub testNonstackableItems {
 	$list->checkValidity();
 }
 
+sub testIndices {
+	my ($self) = @_;
+	$self->init();
+	my $list = $self->{list};
+	my @items = map { $self->createTestObject($_) } ('Red Potion', 'Arrow', 'Red Potion', 'Knife', 'Arrow');
+	my @nameIDs = (501, 1750, 501, 1201, 1750);
+	my @types = (0, 10, 0, 5, 10);
+	for my $i (0..$#items) {
+		$items[$i]{nameID} = $nameIDs[$i];
+		$items[$i]{type} = $types[$i];
+		$items[$i]{amount} = $i + 1;
+		$items[$i]{identified} = ($i != 0);
+		$list->add($items[$i]);
+	}
+	$list->checkValidity();
+
+	ok($list->getByNameID(501) == $items[0], "getByNameID finds the first item with the nameID");
+	ok($list->getByNameID("501", 1) == $items[2], "Or the first identified one");
+	ok(!$list->getByNameID(909), "Nothing without items of that nameID");
+	is($list->sumByNameID(1750), 7, "sumByNameID adds their amounts");
+	is($list->sumByNameID(501, 1), 3, "Of the identified ones only if asked");
+	is($list->sumByName('red potion'), 4, "sumByName too");
+	is($list->sumByName('Jellopy'), 0, "Nothing without items of that name");
+	is_deeply([$list->getByType(10)], [$items[1], $items[4]], "getByType gives the items of a type in order");
+	is_deeply([$list->getByType(3)], [], "None without items of that type");
+
+	$list->remove($items[0]);
+	$list->remove($items[1]);
+	my $potion = $self->createTestObject('Red Potion');
+	@{$potion}{qw(nameID type amount identified)} = (501, 0, 10, 1);
+	$list->add($potion);
+	is($potion->{binID}, 0, "A new item takes the first free index");
+	ok($list->getByNameID(501) == $potion, "And is the first of its nameID");
+	ok($list->getByName('Red Potion') == $potion, "And of its name");
+	is($list->getByNameList('Jellopy, red potion')->{binID}, 0, "getByNameList goes by the name index");
+	is_deeply([$list->getByType(10)], [$items[4]], "Removed items are gone from the indices");
+	$list->checkValidity();
+
+	$items[3]{nameID} = 1202;
+	$items[3]{type} = 4;
+	$list->reindex($items[3]);
+	ok($list->getByNameID(1202) == $items[3], "Changed items are indexed again");
+	ok(!$list->getByNameID(1201), "Not under their old nameID");
+	is_deeply([$list->getByType(5)], [], "Nor their old type");
+	$items[3]{nameID} = 1203;
+	$items[3]->setName('Cutter');
+	ok($list->getByNameID(1203) == $items[3], "Renaming an item indexes it again entirely");
+	$list->checkValidity();
+
+	$list->clear();
+	ok(!$list->getByNameID(1750), "Clearing the list empties the indices");
+	$list->checkValidity();
+}
+
 1;
@@ -0,0 +1,90 @@
+# A unit test for the filter of Log.pm, and Log::debugf() and the other *f() functions.
+package LogFilterTest;
+
+use strict;
+use Test::More;
+use Globals qw(%config);
+use Log;
+
+# A format argument which counts how many times it's formatted
+package LogFilterTest::Counted;
+use overload '""' => sub { $_[0]->{count}++; return "counted" };
+
+package LogFilterTest;
+
+sub start {
+	print "### Starting LogFilterTest\n";
+	# Log.pm has its own alias of %config, so its keys are localized rather than the hash
+	local @config{qw(verbose debug debugDomains squelchDomains verboseDomains beepDomains)} = (1, 0);
+	Log::resetFilter();
+	testLevels();
+	testDomains();
+	testFormatting();
+	Log::resetFilter();
+}
+
+sub testLevels {
+	ok(Log::isWanted('message', 'info'), "Messages of level 0 are wanted");
+	ok(Log::isWanted('message', 'info', 1), "Up to the verbosity");
+	ok(!Log::isWanted('message', 'info', 2), "Not above it");
+	ok(!Log::isWanted('debug', 'ai'), "Debug messages are of level 1 by default");
+	ok(Log::isWanted('debug', 'ai', 0), "Debug messages of level 0 are wanted");
+	ok(Log::isWanted('error', undef, 1), "Messages without a domain are in the console domain");
+	ok(Log::isWanted('warning', 'info', -1), "Negative levels are always wanted");
+	ok(!Log::isWanted('message', 'info', 12), "Levels above the last bit aren't wanted either");
+	eval { Log::isWanted('notice', 'info') };
+	ok($@, "Unknown message types are refused");
+
+	$config{debug} = 2;
+	ok(!Log::isWanted('debug', 'ai', 2), "The filter stays compiled");
+	Log::resetFilter();
+	ok(Log::isWanted('debug', 'ai', 2), "Until it's reset");
+}
+
+sub testDomains {
+	local $config{debugDomains} = 'route,npc';
+	local $config{squelchDomains} = 'npc,inventory';
+	local $config{verboseDomains} = 'inventory';
+	local $Log::messageConsole{drop} = 0;
+	local $Log::messageFiles{pm} = ['chat.txt'];
+	Log::resetFilter();
+
+	ok(Log::isWanted('debug', 'route', 7), "Debug domains are wanted at every level");
+	ok(!Log::isWanted('debug', 'npc', 0), "Squelched domains aren't, even if they're debug domains");
+	ok(Log::isWanted('message', 'inventory', 7), "Verbose domains are wanted, even if they're squelched");
+	ok(!Log::isWanted('message', 'drop'), "Domains not shown in the console aren't");
+	ok(Log::isWanted('message', 'pm', 7), "Domains written to a file are wanted at every level");
+	ok(!Log::isWanted('warning', 'pm', 7), "Only for their message type");
+
+	my @messages;
+	my $hook = Log::addHook(sub { push @messages, $_[4] });
+	ok(Log::isWanted('debug', 'npc', 7), "Everything is wanted while there are hooks");
+	Log::delHook($hook);
+	ok(!Log::isWanted('debug', 'npc', 7), "Not after they are removed");
+	Log::resetFilter();
+}
+
+sub testFormatting {
+	my @messages;
+	my $argument = bless { count => 0 }, 'LogFilterTest::Counted';
+	local $Log::messageConsole{console} = 0;
+	local $Log::warningConsole{info} = 0;
+	Log::resetFilter();
+
+	Log::debugf('ai', 3, "A %s message\n", $argument);
+	is($argument->{count}, 0, "Messages which aren't wanted aren't formatted");
+
+	my $hook = Log::addHook(sub { push @messages, [@_[0..4]] });
+	Log::debugf('ai', 3, "A %s message at (%d, %d)\n", $argument, 10, 20.5);
+	Log::messagef(undef, undef, "%s%%\n", "\x{263A}");
+	Log::warningf('info', 1, "No arguments\n");
+	Log::delHook($hook);
+	is($argument->{count}, 1, "Wanted messages are formatted once");
+	is_deeply(\@messages, [
+		['debug', 'ai', 3, 2, "A counted message at (10, 20)\n"],
+		['message', 'console', 0, 1, "\x{263A}%\n"],
+		['warning', 'info', 1, 1, "No arguments\n"],
+	], "Like sprintf() does, and given to the hooks with their domain and level");
+}
+
+1;
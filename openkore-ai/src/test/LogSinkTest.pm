@@ -0,0 +1,142 @@
+# A unit test for Utils::Unix::LogSink.
+package LogSinkTest;
+
+use strict;
+use Test::More;
+use File::Temp qw(tempdir);
+use IO::Socket::UNIX;
+use Socket qw(SOCK_DGRAM);
+use Utils::Unix;
+
+use constant HEADER_SIZE => 48;
+use constant RECORD_SIZE => 24;
+
+sub start {
+	print "### Starting LogSinkTest\n";
+	my $dir = tempdir(CLEANUP => 1);
+	testJSONRing("$dir/json.ring");
+	testBinaryRing("$dir/binary.ring");
+	testWrapAround("$dir/wrap.ring");
+	testSocket("$dir/log.sock");
+	testErrors($dir);
+}
+
+# Returns the header of a ring file, and the bytes after it
+sub readRing {
+	my ($file) = @_;
+	open(my $f, '<:raw', $file) or die "Cannot open $file: $!";
+	local $/;
+	my $data = <$f>;
+	close $f;
+
+	my %header;
+	@header{qw(magic version format headerSize reserved capacity writeOffset lastRecord)} =
+		unpack('a8 V4 Q3', $data);
+	return (\%header, substr($data, $header{headerSize}));
+}
+
+# Returns the hashes of the binary records in data
+sub parseRecords {
+	my ($data) = @_;
+	my @records;
+	while (length $data >= RECORD_SIZE) {
+		my ($size, $typeLen, $domainLen, $messageLen, undef, $time) = unpack('V v v V V Q', $data);
+		my %record = (time => $time);
+		@record{qw(type domain message)} = unpack("x" . RECORD_SIZE . " a$typeLen a$domainLen a$messageLen", $data);
+		push @records, \%record;
+		substr($data, 0, $size, '');
+	}
+	return @records;
+}
+
+sub testJSONRing {
+	my ($file) = @_;
+	Utils::Unix::LogSink::open("ring:$file");
+	ok(Utils::Unix::LogSink::isOpen(), "a ring file opens");
+	Utils::Unix::LogSink::write('message', 'info', "Hello \"world\"\n");
+	Utils::Unix::LogSink::write('warning', '', "tab\there\e[0m\n");
+	Utils::Unix::LogSink::flush();
+
+	my ($header, $data) = readRing($file);
+	is($header->{magic}, 'OKLOGRNG', "the ring file has a header");
+	is($header->{capacity}, 4 * 1024 * 1024 - HEADER_SIZE, "the ring file has the default size");
+	my @lines = split /\n/, substr($data, 0, $header->{writeOffset});
+	is(scalar @lines, 2, "one line per message");
+	like($lines[0], qr/^\{"time":\d+\.\d{6},"type":"message","domain":"info","message":"Hello \\"world\\"\\n"\}$/,
+		"messages are JSON objects");
+	is($lines[1] =~ /"message":"tab\\there\\u001b\[0m\\n"/, 1, "control characters are escaped");
+	is($header->{lastRecord}, length($lines[0]) + 1, "the last record is known");
+	Utils::Unix::LogSink::close();
+	ok(!Utils::Unix::LogSink::isOpen(), "the sink closes");
+}
+
+sub testBinaryRing {
+	my ($file) = @_;
+	Utils::Unix::LogSink::open("ring:$file:128k", 'binary');
+	Utils::Unix::LogSink::write('error', 'connection', "Disconnected\n") for (1 .. 3);
+	Utils::Unix::LogSink::write('message', 'list', "\x{263a}\n");
+	Utils::Unix::LogSink::close();
+
+	my ($header, $data) = readRing($file);
+	is($header->{format}, 1, "the ring file knows its format");
+	is($header->{capacity}, 128 * 1024 - HEADER_SIZE, "the ring file has the given size");
+	my @records = parseRecords(substr($data, 0, $header->{writeOffset}));
+	is(scalar @records, 4, "closing writes the queued messages");
+	is_deeply([@{$records[0]}{qw(type domain message)}], ['error', 'connection', "Disconnected\n"],
+		"binary records have the type, the domain and the message");
+	is($records[3]{message}, "\xe2\x98\xba\n", "messages are encoded as UTF-8");
+	ok(abs($records[0]{time} / 1e6 - time) < 60, "records have the time");
+}
+
+sub testWrapAround {
+	my ($file) = @_;
+	my $message = ('x' x 999) . "\n";
+	Utils::Unix::LogSink::open("ring:$file:64k", 'binary');
+	for my $i (1 .. 1000) {
+		Utils::Unix::LogSink::write('message', "domain$i", $message);
+	}
+	Utils::Unix::LogSink::close();
+
+	my ($header, $data) = readRing($file);
+	my $recordSize = RECORD_SIZE + length('message') + length('domain1000') + length($message);
+	is($header->{writeOffset} % $header->{capacity} > 0 && $header->{writeOffset} > $header->{capacity}, 1,
+		"the ring wraps around");
+	my $start = $header->{lastRecord} % $header->{capacity};
+	my ($last) = parseRecords(substr($data . $data, $start, $recordSize));
+	is($last->{domain}, 'domain1000', "the last record is where the header says");
+}
+
+sub testSocket {
+	my ($path) = @_;
+	my $server = IO::Socket::UNIX->new(Type => SOCK_DGRAM, Local => $path)
+		or die "Cannot create socket $path: $!";
+	Utils::Unix::LogSink::open("unix:$path");
+	Utils::Unix::LogSink::write('message', 'info', "first\n");
+	Utils::Unix::LogSink::write('message', 'info', "second\n");
+	Utils::Unix::LogSink::close();
+
+	my @datagrams;
+	my $bits = '';
+	vec($bits, fileno($server), 1) = 1;
+	while (select(my $ready = $bits, undef, undef, 1) > 0) {
+		my $datagram;
+		$server->recv($datagram, 65536);
+		push @datagrams, $datagram;
+		last if (@datagrams == 2);
+	}
+	is(scalar @datagrams, 2, "one datagram per message");
+	like($datagrams[1], qr/"message":"second\\n"\}\n$/, "datagrams are JSON records");
+}
+
+sub testErrors {
+	my ($dir) = @_;
+	ok(!eval { Utils::Unix::LogSink::open("file:$dir/x"); 1 }, "unknown targets are refused");
+	like($@, qr/ring: or unix:/, "the error tells the valid targets");
+	ok(!eval { Utils::Unix::LogSink::open("ring:$dir/x", 'xml'); 1 }, "unknown formats are refused");
+	ok(!eval { Utils::Unix::LogSink::open("ring:$dir/missing/x"); 1 }, "unwritable ring files are refused");
+	ok(!Utils::Unix::LogSink::isOpen(), "a sink which failed to open isn't open");
+	Utils::Unix::LogSink::write('message', 'info', "dropped\n");
+	pass("writing without a sink does nothing");
+}
+
+1;
@@ -0,0 +1,151 @@
+# A unit test for Network::MessageTokenizer.
+package MessageTokenizerTest;
+
+use strict;
+use Test::More;
+use Globals;
+use Network::MessageTokenizer;
+
+use constant KNOWN => Network::MessageTokenizer::KNOWN_MESSAGE;
+use constant UNKNOWN => Network::MessageTokenizer::UNKNOWN_MESSAGE;
+use constant ACCOUNT => Network::MessageTokenizer::ACCOUNT_ID;
+
+my %rpackets = (
+	'0078' => {length => 6},
+	'01D7' => {length => -1},
+	'0283' => {length => 0},
+	'0001' => {length => 1},
+);
+
+sub start {
+	print "### Starting MessageTokenizerTest\n";
+	testSplitting();
+	testPartialMessages();
+	testMessageBursts();
+	testBuffer();
+	testAccountID();
+	testLengthsChanged();
+}
+
+# Returns [type, message] for each message readNext() returns
+sub readAll {
+	my ($tokenizer) = @_;
+	my (@result, $type);
+	while (defined(my $message = $tokenizer->readNext(\$type))) {
+		push @result, [$type, $message];
+	}
+	return \@result;
+}
+
+sub testSplitting {
+	my $tokenizer = new Network::MessageTokenizer(\%rpackets);
+	my $fixed = pack('v a4', 0x0078, 'abcd');
+	my $variable = pack('v v a3', 0x01D7, 7, 'xyz');
+	my $unknown = pack('v a3', 0x1234, 'foo');
+
+	$tokenizer->add($fixed . $variable . $fixed . $unknown);
+	is_deeply(readAll($tokenizer),
+		[[KNOWN, $fixed], [KNOWN, $variable], [KNOWN, $fixed], [UNKNOWN, $unknown]],
+		"Known messages are split, the rest is one unknown message");
+	is($tokenizer->getBuffer(), '', "Everything was read");
+
+	$tokenizer->add(pack('v a4', 0x0001, 'abcd'));
+	is(readAll($tokenizer)->[0][0], UNKNOWN, "Length 1 means an unknown message");
+}
+
+sub testPartialMessages {
+	my $tokenizer = new Network::MessageTokenizer(\%rpackets);
+	my $variable = pack('v v a6', 0x0283, 10, 'abcdef');
+	my $type;
+
+	foreach my $byte (split //, substr($variable, 0, -1)) {
+		$tokenizer->add($byte);
+		ok(!defined $tokenizer->readNext(\$type), "Incomplete message isn't returned");
+	}
+	$tokenizer->add(substr($variable, -1));
+	is($tokenizer->readNext(\$type), $variable, "Message is returned once complete");
+	is($type, KNOWN, "Message is known");
+}
+
+sub testMessageBursts {
+	my $tokenizer = new Network::MessageTokenizer(\%rpackets);
+	my $data = '';
+	my $expected = '';
+
+	# Enough to make the ring buffer grow and wrap around
+	for my $i (1..20000) {
+		$data .= pack('v a4', 0x0078, pack('V', $i));
+		$data .= pack('v v', 0x01D7, 4 + $i % 50) . 'x' x ($i % 50);
+	}
+	my ($read, $count) = ('', 0);
+	for (my $offset = 0; $offset < length($data); $offset += 4093) {
+		$tokenizer->add(substr($data, $offset, 4093));
+		if ($offset % 3 == 0) {
+			foreach my $message (@{readAll($tokenizer)}) {
+				$read .= $message->[1];
+				$count++;
+			}
+		}
+	}
+	foreach my $message (@{readAll($tokenizer)}) {
+		$read .= $message->[1];
+		$count++;
+	}
+	is($count, 40000, "Every message is read");
+	ok($read eq $data, "Messages come out as they went in");
+}
+
+sub testBuffer {
+	my $tokenizer = new Network::MessageTokenizer(\%rpackets);
+	my $fixed = pack('v a4', 0x0078, 'abcd');
+	my $type;
+
+	$tokenizer->add($fixed . $fixed . 'xy');
+	is($tokenizer->readNext(\$type), $fixed, "First message is read");
+	is($tokenizer->getBuffer(), $fixed . 'xy', "Buffer has the messages which weren't returned");
+	$tokenizer->clear(2);
+	is($tokenizer->getBuffer(), substr($fixed, 2) . 'xy', "clear(size) removes the first bytes");
+	$tokenizer->clear();
+	is($tokenizer->getBuffer(), '', "clear() empties the buffer");
+}
+
+sub testAccountID {
+	local $Globals::accountID = pack('V', 150000);
+	my $accountID = $Globals::accountID;
+	my $tokenizer = new Network::MessageTokenizer(\%rpackets);
+	my $fixed = pack('v a4', 0x0078, 'abcd');
+	my $type;
+
+	$tokenizer->add($fixed . $fixed);
+	is($tokenizer->readNext(\$type), $fixed, "First message is read");
+	$tokenizer->nextMessageMightBeAccountID();
+	$tokenizer->add($accountID);
+	is($tokenizer->readNext(\$type), $fixed, "Message which isn't the account ID is read normally");
+	is($type, KNOWN, "Message is known");
+
+	$tokenizer->nextMessageMightBeAccountID();
+	$tokenizer->add($fixed);
+	is_deeply(readAll($tokenizer), [[ACCOUNT, $accountID], [KNOWN, $fixed]],
+		"Account ID is read before the messages after it");
+
+	$tokenizer->nextMessageMightBeAccountID();
+	$tokenizer->add(substr($accountID, 0, 3));
+	ok(!defined $tokenizer->readNext(\$type), "Incomplete account ID isn't returned");
+	$tokenizer->add(substr($accountID, 3));
+	is($tokenizer->readNext(\$type), $accountID, "Account ID is returned once complete");
+	is($type, ACCOUNT, "Type is ACCOUNT_ID");
+}
+
+sub testLengthsChanged {
+	my %lengths = ('0078' => {length => 6});
+	my $tokenizer = new Network::MessageTokenizer(\%lengths);
+	my $type;
+
+	$tokenizer->add(pack('v a4', 0x0078, 'abcd') x 2);
+	$tokenizer->readNext(\$type);
+	$lengths{'0078'}{length} = 3;
+	Network::MessageTokenizer::packetLengthsChanged();
+	is(length($tokenizer->readNext(\$type)), 3, "New packet lengths are used for data which wasn't returned yet");
+}
+
+1;
@@ -0,0 +1,136 @@
+# A unit test for Network::Multiplexer.
+package NetworkMultiplexerTest;
+
+use strict;
+use Test::More;
+use Socket;
+use IO::Handle;
+use Network::Multiplexer;
+
+use constant {
+	MESSAGE => Network::Multiplexer::MESSAGE,
+	UNKNOWN => Network::Multiplexer::UNKNOWN_MESSAGE,
+	CLOSED => Network::Multiplexer::CLOSED,
+};
+
+my %rpackets = (
+	'0078' => {length => 6},
+	'01D7' => {length => -1},
+);
+
+my $fixed = pack('v a4', 0x0078, 'abcd');
+my $variable = pack('v v a3', 0x01D7, 7, 'xyz');
+
+sub start {
+	print "### Starting NetworkMultiplexerTest\n";
+	testDispatch();
+	testUnknownAndClosed();
+	testRemove();
+	testLengthsChanged();
+}
+
+# Returns the socket the multiplexer reads and the one the test writes to
+sub newConnection {
+	my ($read, $write);
+	socketpair($read, $write, AF_UNIX, SOCK_STREAM, PF_UNSPEC) or die "socketpair: $!";
+	$write->autoflush(1);
+	return ($read, $write);
+}
+
+# Iterates until there were $count handler calls, or 20 times
+sub iterateFor {
+	my ($mux, $count) = @_;
+	my $calls = 0;
+	for (my $i = 0; $i < 20 && $calls < $count; $i++) {
+		$calls += $mux->iterate(0.05);
+	}
+	return $calls;
+}
+
+sub testDispatch {
+	my $mux = new Network::Multiplexer();
+	my (@sockets, %received);
+	foreach my $account (0..2) {
+		my ($read, $write) = newConnection();
+		my $id = $mux->add($read, \%rpackets, sub {
+			my ($id, $type, $message) = @_;
+			push @{$received{$account}}, [$id, $type, $message];
+		});
+		push @sockets, [$read, $write, $id];
+	}
+	is($mux->count, 3, "Three connections");
+
+	syswrite($sockets[0][1], $fixed . substr($variable, 0, 3));
+	syswrite($sockets[2][1], $variable . $fixed);
+	is(iterateFor($mux, 3), 3, "Three complete messages were read");
+	is_deeply($received{0}, [[$sockets[0][2], MESSAGE, $fixed]], "The first connection got its message");
+	is_deeply($received{1}, undef, "The second one got nothing");
+	is_deeply($received{2}, [[$sockets[2][2], MESSAGE, $variable], [$sockets[2][2], MESSAGE, $fixed]],
+		"The third one got its messages in order");
+
+	syswrite($sockets[0][1], substr($variable, 3));
+	is(iterateFor($mux, 1), 1, "The rest of a message completes it");
+	is($received{0}[1][2], $variable, "It is handed out whole");
+	$mux->remove($_->[2]) for (@sockets);
+	is($mux->count, 0, "No connections left");
+}
+
+sub testUnknownAndClosed {
+	my $mux = new Network::Multiplexer();
+	my ($read, $write) = newConnection();
+	my @received;
+	my $id = $mux->add($read, \%rpackets, sub { push @received, [$_[1], $_[2]] });
+	my $unknown = pack('v a3', 0x1234, 'foo');
+
+	syswrite($write, $fixed . $unknown);
+	iterateFor($mux, 2);
+	is_deeply(\@received, [[MESSAGE, $fixed], [UNKNOWN, $unknown]], "Data which isn't a known message is handed out as it is");
+
+	@received = ();
+	syswrite($write, $fixed . substr($fixed, 0, 2));
+	close($write);
+	iterateFor($mux, 2);
+	is_deeply(\@received, [[MESSAGE, $fixed], [CLOSED, substr($fixed, 0, 2)]], "The closing comes with the start of a message");
+	@received = ();
+	is($mux->iterate(0.05), 0, "A closed connection isn't read anymore");
+	is($mux->count, 1, "But it stays until it's removed");
+	$mux->remove($id);
+}
+
+sub testRemove {
+	my $mux = new Network::Multiplexer();
+	my ($read3, $write3) = newConnection();
+	my (@ids, @sockets, @got, @third);
+	foreach my $i (0..1) {
+		my ($read, $write) = newConnection();
+		$ids[$i] = $mux->add($read, \%rpackets, sub {
+			push @got, $i;
+			# Removing a connection drops what was read from it, even if its ID is reused
+			$mux->remove($ids[1 - $i]);
+			$mux->add($read3, \%rpackets, sub { push @third, $_[2] });
+		});
+		syswrite($write, $fixed);
+		push @sockets, $read, $write;
+	}
+
+	iterateFor($mux, 2);
+	is(scalar(@got), 1, "The handler of a removed connection isn't called");
+	is_deeply(\@third, [], "Nor is the handler of the connection which took its ID");
+	is($mux->count, 2, "Two connections");
+}
+
+sub testLengthsChanged {
+	my $mux = new Network::Multiplexer();
+	my ($read, $write) = newConnection();
+	my %lengths = ('0078' => {length => 6});
+	my @received;
+	$mux->add($read, \%lengths, sub { push @received, [$_[1], $_[2]] });
+
+	$lengths{'0078'}{length} = 4;
+	Network::MessageTokenizer::packetLengthsChanged();
+	syswrite($write, $fixed);
+	iterateFor($mux, 2);
+	is_deeply(\@received, [[MESSAGE, substr($fixed, 0, 4)], [UNKNOWN, substr($fixed, 4)]], "Changed packet lengths are used");
+}
+
+1;
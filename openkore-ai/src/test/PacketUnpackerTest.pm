@@ -0,0 +1,127 @@
+# A unit test for Network::PacketParser::Unpacker.
+package PacketUnpackerTest;
+
+use strict;
+use Test::More;
+use Misc;
+use Network::Receive;
+use Network::Send;
+
+sub start {
+	print "### Starting PacketUnpackerTest\n";
+	testTemplates();
+	testUnsupported();
+	testShortMessages();
+	testNames();
+	testPacketLists();
+}
+
+# Data which is mostly padding and whitespace, to exercise the string fields
+sub randomMessage {
+	my ($len) = @_;
+	my @bytes = ("\0", "\0", ' ', "\t", 'a', 'Z');
+	return join '', map { rand() < 0.5 ? $bytes[int rand @bytes] : chr(int rand 256) } 1 .. $len;
+}
+
+# Checks that the unpacker decodes messages of every length like unpack() does, or declines them
+sub compare {
+	my ($template, $names, $name) = @_;
+	my $unpacker = Network::PacketParser::Unpacker->new("x2 $template", $names);
+	my ($decoded, @failed) = (0);
+
+	ok($unpacker, "$name compiles") or return;
+	for my $len (0 .. 160, 1000) {
+		for (1 .. 3) {
+			my $msg = randomMessage($len);
+			my (%native, %perl);
+			if ($unpacker->unpack($msg, \%native)) {
+				@perl{@{$names}} = unpack("x2 $template", $msg);
+				$decoded++;
+				push @failed, $len unless Test::More::eq_hash(\%native, \%perl);
+			}
+		}
+	}
+	is_deeply(\@failed, [], "$name decodes like unpack()");
+	ok($decoded, "$name decodes long enough messages");
+}
+
+sub testTemplates {
+	my @templates = (
+		['a4 v V C', [qw(ID type hp lv)]],
+		['v3 V2 c s l', [qw(a b c d e f g h)]],
+		['a24 Z24 A24', [qw(raw name padded)]],
+		['x4 Z* a*', [qw(name rest)]],
+		['A*', [qw(message)]],
+		['Z8 x2 a0 C', [qw(name empty flag)]],
+		["V\tv\nC  a2", [qw(a b c d)]],
+	);
+	for my $entry (@templates) {
+		compare(@{$entry}, "template '$entry->[0]'");
+	}
+}
+
+sub testUnsupported {
+	for my $template ('v/a', 'C3/a', 'a2 (v)*', 'v<', 'V!', 'w', 'H*', 'v*', 'x*', 'a4 # comment', 'n') {
+		ok(!defined Network::PacketParser::Unpacker->new($template, ['a']), "'$template' is left to unpack()");
+	}
+}
+
+sub testShortMessages {
+	my $unpacker = Network::PacketParser::Unpacker->new('x2 a4 v', [qw(ID type)]);
+	my %args = (switch => '0078');
+
+	ok(!$unpacker->unpack("\x78\x00\x01\x02\x03\x04\x05", \%args), "a message shorter than the fields is declined");
+	is_deeply(\%args, {switch => '0078'}, "a declined message leaves the arguments alone");
+	ok($unpacker->unpack("\x78\x00\x01\x02\x03\x04\x05\x00", \%args), "a message as long as the fields is decoded");
+	is_deeply(\%args, {switch => '0078', ID => "\x01\x02\x03\x04", type => 5}, "the fields are added to the arguments");
+
+	my $utf8 = "\x78\x00\x{100}abcdefg";
+	ok(!$unpacker->unpack($utf8, {}), "character strings are left to unpack()");
+}
+
+sub testNames {
+	my %args;
+	my $unpacker = Network::PacketParser::Unpacker->new('x2 v v v', [qw(a b)]);
+	ok($unpacker->unpack(pack('v4', 0, 1, 2, 3), \%args), "more values than names");
+	is_deeply(\%args, {a => 1, b => 2}, "values without a name are dropped");
+
+	%args = ();
+	$unpacker = Network::PacketParser::Unpacker->new('x2 v', [qw(a b c)]);
+	ok($unpacker->unpack(pack('v2', 0, 1), \%args), "more names than values");
+	is_deeply(\%args, {a => 1, b => undef, c => undef}, "names without a value are undef");
+
+	%args = ();
+	$unpacker = Network::PacketParser::Unpacker->new('x2 v v', [qw(a a)]);
+	ok($unpacker->unpack(pack('v3', 0, 1, 2), \%args), "repeated names");
+	is_deeply(\%args, {a => 2}, "the last value of a repeated name is kept");
+}
+
+# Every template the parsers know, with their own names
+sub testPacketLists {
+	my ($templates, $compiled, @failed) = (0, 0);
+	for my $module (qw(Network::Receive Network::Send)) {
+		my $parser = $module->create(undef, 0);
+		for my $switch (sort keys %{$parser->{packet_list}}) {
+			my $handler = $parser->{packet_list}{$switch};
+			next unless $handler && $handler->[1];
+			$templates++;
+			my $unpacker = Network::PacketParser::Unpacker->new("x2 $handler->[1]", $handler->[2] || []);
+			next unless $unpacker;
+			$compiled++;
+			for my $len (0 .. 120, 600) {
+				my $msg = randomMessage($len);
+				my (%native, %perl);
+				next unless $unpacker->unpack($msg, \%native);
+				@perl{@{$handler->[2]}} = unpack("x2 $handler->[1]", $msg);
+				unless (Test::More::eq_hash(\%native, \%perl)) {
+					push @failed, "$module $switch $handler->[0]";
+					last;
+				}
+			}
+		}
+	}
+	is_deeply(\@failed, [], "the packet templates decode like unpack()");
+	ok($compiled > $templates / 2, "most packet templates compile ($compiled of $templates)");
+}
+
+1;
@@ -0,0 +1,96 @@
+# Unit test for Network::PaddedPackets
+package PaddedPacketsTest;
+use strict;
+
+use Test::More;
+use Network::PaddedPackets;
+
+# Hash data of two accounts
+use constant ACCOUNTS => ([0x1F2E3D, 0x10203, 0x55AA], [0x7A6B5C, 0x4040, 0x1234]);
+
+sub start {
+	print "### Starting PaddedPacketsTest\n";
+
+	my @accounts = ACCOUNTS;
+
+	# An engine object makes the packets of the global functions
+	Network::PaddedPackets::setPacketIDs(0x89, 0x113);
+	setGlobalHashData(@{$accounts[0]});
+	my @global = (globalAtk(0x1111), globalSkillUse(28, 10, 0x2222), globalSitStand(1));
+	my $engine = newEngine($accounts[0]);
+	my @own = ($engine->createAtk(0x1111), $engine->createSkillUse(28, 10, 0x2222), $engine->createSitStand(1));
+	is_deeply(\@own, \@global, 'engine objects make the packets of the global functions');
+	ok(length($own[0]) > 12, 'attack packets are padded');
+	is(unpack('v', $own[1]), 0x113, 'skill packets have the skill packet ID');
+
+	# Each engine keeps the state of its own account
+	my @alone = map { my $engine = newEngine($_); [$engine->createAtk(0x3333), $engine->createAtk(0x4444)] } @accounts;
+	my @engines = map { newEngine($_) } @accounts;
+	my @interleaved = map { [] } @accounts;
+	for my $target (0x3333, 0x4444) {
+		push @{$interleaved[$_]}, $engines[$_]->createAtk($target) for 0..$#accounts;
+	}
+	is_deeply(\@interleaved, \@alone, 'engines of different accounts are independent');
+
+	# A batch makes the packets of the same calls one at a time
+	my @single = do {
+		my @engines = map { newEngine($_) } @accounts;
+		($engines[0]->createAtk(0x5555), $engines[1]->createSkillUse(46, 5, 0x6666), $engines[0]->createSitStand(0),
+			$engines[1]->createSitStand(1))
+	};
+	@engines = map { newEngine($_) } @accounts;
+	my @batch = Network::PaddedPackets::createBatch([
+		[$engines[0], 'attack', 0x5555],
+		[$engines[1], 'skill', 46, 5, 0x6666],
+		[$engines[0], 'stand'],
+		[$engines[1], 'sit'],
+	]);
+	is_deeply(\@batch, \@single, 'batches make the packets of single calls');
+	is_deeply([Network::PaddedPackets::createBatch([])], [], 'empty batch');
+	ok(!eval { Network::PaddedPackets::createBatch([[$engines[0], 'jump']]); 1 }, 'unknown packet kinds are rejected');
+	ok(!eval { Network::PaddedPackets::createBatch([['engine', 'sit']]); 1 }, 'requests need an engine');
+
+	# Decoding gives back the keys, as far as the packet goes
+	$engine = newEngine($accounts[1]);
+	my $skill = $engine->createSkillUse(28, 10, 0x7777);
+	is_deeply([unpack('V*', $engine->decodeKeys($skill, 3))], [10, 28, 0x7777], 'decoded keys');
+	is_deeply([unpack('V*', $engine->decodeKeys(substr($skill, 0, -1), 3))], [10, 28], 'keys past the end of the packet are left out');
+	is($engine->decodeKeys(substr($skill, 0, 3), 3), '', 'no keys without a packet ID');
+	setGlobalHashData(@{$accounts[1]});
+	Network::PaddedPackets::decodePacket($skill, 3);
+	is_deeply([unpack('V*', Network::PaddedPackets::decodeKeys($skill, 3))], [map { Network::PaddedPackets::getKey($_) } 0..2],
+		'decodeKeys gives the keys of getKey');
+}
+
+sub newEngine {
+	my ($account) = @_;
+	my $engine = new Network::PaddedPackets::Engine;
+	$engine->setHashData(@$account);
+	$engine->setPacketIDs(0x89, 0x113);
+	return $engine;
+}
+
+sub setGlobalHashData {
+	my ($accountId, $mapSync, $sync) = @_;
+	Network::PaddedPackets::setAccountId($accountId);
+	Network::PaddedPackets::setMapSync($mapSync);
+	Network::PaddedPackets::setSync($sync);
+}
+
+sub globalAtk {
+	my $packet = " " x 256;
+	return substr($packet, 0, Network::PaddedPackets::createAtk($packet, $_[0], 0));
+}
+
+sub globalSkillUse {
+	my ($skillId, $skillLv, $targetId) = @_;
+	my $packet = " " x 256;
+	return substr($packet, 0, Network::PaddedPackets::createSkillUse($packet, $skillId, $skillLv, $targetId));
+}
+
+sub globalSitStand {
+	my $packet = " " x 256;
+	return substr($packet, 0, Network::PaddedPackets::createSitStand($packet, $_[0]));
+}
+
+1;
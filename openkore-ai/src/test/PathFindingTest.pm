@@ -0,0 +1,638 @@
+# Unit test for PathFinding
+package PathFindingTest;
+use strict;
+
+use Test::More;
+use List::Util qw(min sum);
+use Utils::PathFinding;
+use Utils qw(adjustedBlockDistance);
+
+sub start {
+	print "### Starting PathFindingTest\n";
+
+	my $open = makeWeightMap(20, 20);
+	my $walled = makeWeightMap(20, 20, map { [10, $_] } 0..18);
+
+	is(runSearch(new PathFinding, $open, 20, 20, [2, 2], [12, 2]), 11, 'straight path on an open map');
+	is(runSearch(new PathFinding, $open, 20, 20, [2, 2], [12, 12]), 11, 'diagonal path on an open map');
+	is(runSearch(new PathFinding, $walled, 20, 20, [2, 2], [18, 2]), 37, 'path around a wall');
+
+	my $blocked = makeWeightMap(20, 20, map { [10, $_] } 0..19);
+	is(runSearch(new PathFinding, $blocked, 20, 20, [2, 2], [18, 2]), -1, 'no path through a full wall');
+
+	# A reused session must give the same answers as fresh ones, even when the map size changes between resets
+	my $session = new PathFinding;
+	my $big = makeWeightMap(40, 30);
+	is(runSearch($session, $walled, 20, 20, [2, 2], [18, 2]), 37, 'reused session, first search');
+	is(runSearch($session, $open, 20, 20, [2, 2], [12, 2]), 11, 'reused session, stale nodes are ignored');
+	is(runSearch($session, $big, 40, 30, [1, 1], [38, 28]), 38, 'reused session grows to a bigger map');
+	is(runSearch($session, $walled, 20, 20, [2, 2], [18, 2]), 37, 'reused session shrinks back to a smaller map');
+	is(runSearch($session, $blocked, 20, 20, [2, 2], [18, 2]), -1, 'reused session, unreachable destination');
+	is(runSearch($session, $open, 20, 20, [5, 5], [5, 5]), 1, 'reused session, start equals destination');
+
+	# The neighbor mask builder has a vectorized path for the inside of the map, compare it against a plain implementation
+	srand(1);
+	my ($width, $height) = (53, 37);
+	my $random = makeWeightMap($width, $height, grep { rand() < 0.3 } map { my $y = $_; map { [$_, $y] } 0..$width-1 } 0..$height-1);
+	my $mask = PathFinding::makeNeighborMask(\$random, $width, $height);
+	is(length $mask, $width * $height, 'neighbor mask size');
+	my @wrong = grep { ord(substr($mask, $_, 1)) != neighborMask($random, $width, $height, $_ % $width, int($_ / $width)) } 0..$width*$height-1;
+	ok(!@wrong, 'neighbor mask matches the walkable neighbors of each cell');
+
+	substr($random, 0, 1) = "\0";
+	substr($random, $width * $height - 1, 1) = "\0";
+	is(runSearch($session, $random, $width, $height, [0, 0], [$width - 1, $height - 1], neighbor_mask => \$mask),
+		runSearch($session, $random, $width, $height, [0, 0], [$width - 1, $height - 1]),
+		'searching with a neighbor mask gives the same result');
+
+	# Jump Point Search must find paths as short as the A* ones
+	is(runSearch($session, $open, 20, 20, [2, 2], [12, 7], avoidWalls => 0, algorithm => 'jps'), 11, 'jps path on an open map');
+	is(runSearch($session, $walled, 20, 20, [2, 2], [18, 2], avoidWalls => 0, algorithm => 'jps'), 37, 'jps path around a wall');
+	is(runSearch($session, $blocked, 20, 20, [2, 2], [18, 2], avoidWalls => 0, algorithm => 'jps'), -1, 'jps, no path through a full wall');
+	is(runSearch($session, $open, 20, 20, [5, 5], [5, 5], avoidWalls => 0, algorithm => 'jps'), 1, 'jps, start equals destination');
+	my @jps = runSearch($session, $random, $width, $height, [0, 0], [$width - 1, $height - 1], avoidWalls => 0, algorithm => 'auto');
+	my @astar = runSearch($session, $random, $width, $height, [0, 0], [$width - 1, $height - 1], avoidWalls => 0);
+	is(pathCost(@jps), pathCost(@astar), 'jps path costs the same as the A* one');
+	is(scalar(grep { abs($jps[$_]{x} - $jps[$_ - 1]{x}) > 1 || abs($jps[$_]{y} - $jps[$_ - 1]{y}) > 1 } 1..$#jps), 0, 'jps solution is expanded to single steps');
+
+	# The bucket queue backend must find paths of the same cost as the binary heap
+	is(runSearch($session, $walled, 20, 20, [2, 2], [18, 2], open_list => 'bucket'), 37, 'bucket queue, path around a wall');
+	is(runSearch($session, $blocked, 20, 20, [2, 2], [18, 2], open_list => 'bucket'), -1, 'bucket queue, no path through a full wall');
+	is(runSearch($session, $big, 40, 30, [1, 1], [38, 28], open_list => 'bucket'), 38, 'bucket queue, reused session grows to a bigger map');
+	my @bucket = runSearch($session, $random, $width, $height, [0, 0], [$width - 1, $height - 1], avoidWalls => 0, open_list => 'bucket');
+	is(pathCost(@bucket), pathCost(@astar), 'bucket queue path costs the same as the heap one');
+	@bucket = runSearch($session, $random, $width, $height, [0, 0], [$width - 1, $height - 1], avoidWalls => 0, algorithm => 'jps', open_list => 'bucket');
+	is(pathCost(@bucket), pathCost(@astar), 'jps with the bucket queue');
+
+	# A single multi destination search must give the same step counts as one search per destination
+	my @dests = map { { x => $_->[0], y => $_->[1] } } ([18, 2], [12, 2], [2, 2], [10, 5], [19, 19], [0, 19]);
+	my @expected = map { $_ == 3 ? -1 : runSearch(new PathFinding, $walled, 20, 20, [2, 2], [$dests[$_]{x}, $dests[$_]{y}]) - 1 } 0..$#dests;
+	$session->reset(weight_map => \$walled, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 2, y => 2 });
+	my @solutions;
+	is_deeply([$session->runcounts(\@dests, \@solutions)], \@expected, 'runcounts gives the step count of each destination');
+	is(scalar @{$solutions[0]}, 37, 'runcounts stores the solution of each destination');
+	ok(!defined $solutions[3], 'runcounts has no solution for a wall');
+	is_deeply($solutions[0][-1], { x => 18, y => 2 }, 'runcounts solution ends at its destination');
+
+	# A search with a node budget is spread over several calls, resuming each time where it stopped
+	my ($calls, $status, @sliced) = (0);
+	$session->reset(weight_map => \$walled, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 18, y => 2 }, node_budget => 10);
+	do { $status = $session->run(\@sliced); $calls++ } while ($status == -4 && $calls < 1000);
+	is($status, 37, 'sliced search finds the path');
+	ok($calls > 1, 'sliced search needs several calls');
+	is_deeply(\@sliced, [runSearch(new PathFinding, $walled, 20, 20, [2, 2], [18, 2])], 'sliced search gives the same path');
+	$session->reset(weight_map => \$blocked, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 18, y => 2 }, node_budget => 10, algorithm => 'jps', avoidWalls => 0);
+	$calls = 0;
+	do { $status = $session->runcount; $calls++ } while ($status == -4 && $calls < 1000);
+	is($status, -1, 'sliced jps search, no path through a full wall');
+
+	# The replanner repairs its search when cell weights change, the paths must cost the same as fresh A* searches
+	my $replanner = PathFinding::Replanner->new(weight_map => \$walled, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 18, y => 2 });
+	my @replanned;
+	is($replanner->run(\@replanned), 37, 'replanner finds the path around a wall');
+	my $initialExpanded = $replanner->expanded;
+	my @weights = map { { x => $_->{x}, y => $_->{y}, weight => 100 } } @replanned[3, 4];
+	$replanner->updateCells(\@weights);
+	my $length = $replanner->run(\@replanned);
+	my @weighted = runSearch(new PathFinding, $walled, 20, 20, [2, 2], [18, 2], customWeights => 1, secondWeightMap => \@weights);
+	is($length, scalar @weighted, 'replanned path length');
+	is(pathCost(@replanned), pathCost(@weighted), 'replanned path costs the same as a search with the new weights');
+	ok(!grep({ my $step = $_; grep { $_->{x} == $step->{x} && $_->{y} == $step->{y} } @weights } @replanned), 'replanned path avoids the weighted cells');
+	ok($replanner->expanded < $initialExpanded, 'replanning expands less nodes than the first search');
+	$replanner->moveStart($replanned[5]{x}, $replanned[5]{y});
+	is($replanner->runcount, $#replanned - 5, 'replanner follows the start along the path');
+	ok(!PathFinding::Replanner->new(weight_map => \$walled, width => 20, height => 20, start => { x => 10, y => 2 }, dest => { x => 18, y => 2 }), 'replanner needs a walkable start');
+
+	# Searches run by the worker threads give the same results as the ones run in the main thread,
+	# the weight maps must stay alive until runAll returns
+	my @sessions = map { new PathFinding } 1..3;
+	my @searches = ([$walled, [2, 2], [18, 2]], [$blocked, [2, 2], [18, 2]], [$open, [5, 5], [15, 9]]);
+	my @counts = map { runSearch(new PathFinding, $_->[0], 20, 20, $_->[1], $_->[2]) - 1 } @searches;
+	$counts[1] = -1;
+	# The field prefetch tests may already have started the shared thread pool
+	PathFinding::stopWorkers();
+	foreach my $workers (0, 2) {
+		PathFinding::startWorkers($workers);
+		for my $i (0 .. $#searches) {
+			my (undef, $start, $dest) = @{$searches[$i]};
+			$sessions[$i]->reset(weight_map => \$searches[$i][0], width => 20, height => 20,
+				start => { x => $start->[0], y => $start->[1] }, dest => { x => $dest->[0], y => $dest->[1] });
+		}
+		is_deeply([PathFinding::runAll(@sessions)], \@counts, "runAll with $workers workers");
+		my @solution;
+		$sessions[0]->run(\@solution);
+		is_deeply(\@solution, [runSearch(new PathFinding, $walled, 20, 20, [2, 2], [18, 2])], "solution after runAll with $workers workers");
+	}
+	is(PathFinding::workers(), 2, 'worker threads are running');
+
+	# A submitted search can be polled until it is done, then collected like a search run in the main thread
+	my $async = PathFinding::submit(weight_map => \$walled, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 18, y => 2 });
+	ok($async, 'submit returns the searching session');
+	1 until $async->poll;
+	my @collected;
+	is($async->collect(\@collected), $counts[0] + 1, 'collected search result');
+	is_deeply(\@collected, [runSearch(new PathFinding, $walled, 20, 20, [2, 2], [18, 2])], 'collected solution');
+	ok($async->poll, 'a collected session can be polled');
+	ok(!PathFinding::submit(weight_map => \$walled, width => 20, height => 20, start => { x => 10, y => 2 }, dest => { x => 18, y => 2 }), 'submit needs a walkable start');
+	PathFinding::stopWorkers();
+	is(PathFinding::workers(), 0, 'worker threads are stopped');
+
+	# Searches repeated with the same cache key come from the route cache, until their custom weights change
+	PathFinding::clearRouteCache();
+	my @uncached = runSearch(new PathFinding, $walled, 20, 20, [2, 2], [18, 2]);
+	my $cachedSession = new PathFinding;
+	is_deeply([runSearch($cachedSession, $walled, 20, 20, [2, 2], [18, 2], cache_key => 'walled')], \@uncached, 'first search with a cache key');
+	ok(!$cachedSession->cached, 'first search is not cached');
+	is_deeply([runSearch($cachedSession, $walled, 20, 20, [2, 2], [18, 2], cache_key => 'walled')], \@uncached, 'cached search gives the same solution');
+	ok($cachedSession->cached, 'repeated search comes from the cache');
+	is($cachedSession->runcount, $#uncached, 'cached search step count');
+	is(runSearch($cachedSession, $blocked, 20, 20, [2, 2], [18, 2], cache_key => 'blocked'), -1, 'search without a path');
+	is(runSearch($cachedSession, $blocked, 20, 20, [2, 2], [18, 2], cache_key => 'blocked'), -1, 'cached search without a path');
+	ok($cachedSession->cached, 'searches without a path are cached');
+	my @overlay = ({ x => $uncached[3]{x}, y => $uncached[3]{y}, weight => 50 });
+	runSearch($cachedSession, $walled, 20, 20, [2, 2], [18, 2], cache_key => 'walled', customWeights => 1, secondWeightMap => \@overlay);
+	ok(!$cachedSession->cached, 'changed custom weights are not cached yet');
+	runSearch($cachedSession, $walled, 20, 20, [2, 2], [18, 2], cache_key => 'walled', customWeights => 1, secondWeightMap => [@overlay]);
+	ok($cachedSession->cached, 'same custom weights are cached');
+	is(PathFinding::routeCacheCount(), 3, 'route cache holds every distinct search');
+	PathFinding::setRouteCacheSize(2);
+	runSearch($cachedSession, $walled, 20, 20, [2, 2], [18, 2], cache_key => 'walled');
+	runSearch($cachedSession, $open, 20, 20, [5, 5], [15, 9], cache_key => 'open');
+	runSearch($cachedSession, $walled, 20, 20, [2, 2], [18, 2], cache_key => 'walled');
+	runSearch($cachedSession, $blocked, 20, 20, [2, 2], [18, 2], cache_key => 'blocked');
+	runSearch($cachedSession, $walled, 20, 20, [2, 2], [18, 2], cache_key => 'walled');
+	ok($cachedSession->cached, 'recently used search stays in the full cache');
+	runSearch($cachedSession, $open, 20, 20, [5, 5], [15, 9], cache_key => 'open');
+	ok(!$cachedSession->cached, 'least recently used search is evicted');
+	PathFinding::setRouteCacheSize(64);
+
+	# Searches between two connected areas are rejected without searching
+	my $blockedComponents = PathFinding::makeComponents(\$blocked, 20, 20);
+	is(length($blockedComponents), 20 * 20 * 2, 'one label for every cell');
+	is_deeply([map { unpack("v", substr($blockedComponents, ($_->[1] * 20 + $_->[0]) * 2, 2)) } [2, 2], [10, 5], [18, 2], [2, 19]], [1, 0, 2, 1], 'walls split the map in two areas');
+	$session->reset(weight_map => \$blocked, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 18, y => 2 }, components => \$blockedComponents);
+	ok($session->cached, 'destination in another area is known without searching');
+	is($session->runcount, -1, 'no path to another area');
+	is_deeply([runSearch($session, $walled, 20, 20, [2, 2], [18, 2], components => \PathFinding::makeComponents(\$walled, 20, 20))], [runSearch(new PathFinding, $walled, 20, 20, [2, 2], [18, 2])], 'same area is searched as usual');
+
+	# Packed solutions hold the same cells as the array of hashes ones
+	my ($packed, @unpacked);
+	$session->reset(weight_map => \$walled, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 18, y => 2 });
+	is($session->run_packed(\$packed), 37, 'run_packed result');
+	is(PathFinding::packedLength($packed), 37, 'packed solution length');
+	is_deeply([PathFinding::packedCell($packed, 36)], [18, 2], 'packed solution cell');
+	$session->reset(weight_map => \$walled, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 18, y => 2 });
+	$session->run(\@unpacked);
+	is_deeply([PathFinding::unpackSolution($packed)], \@unpacked, 'packed solution matches run');
+
+	# Bulk distances match the one position functions, also past the 8 positions handled at once
+	my @positions = map { [($_ * 37) % 61 - 20, ($_ * 23) % 47 - 10] } 0..20;
+	push @positions, [-32768, -32768];
+	my $packedPositions = pack('s*', map { @$_ } @positions);
+	is_deeply([PathFinding::blockDistanceMany($packedPositions, 7, -3)], [(map { PathFinding::blockDistance(7, -3, $_->[0], $_->[1]) } @positions[0..20]), 32767], 'blockDistanceMany');
+	is_deeply([PathFinding::clientDistMany($packedPositions, 7, -3)], [map { PathFinding::getClientDist(7, -3, $_->[0], $_->[1]) } @positions], 'clientDistMany');
+	my @clientDistances = map { my $dx = $_ % 40; my $dy = int($_ / 40); my $d = int(sqrt($dx * $dx + $dy * $dy) - 0.1); $d < 0 ? 0 : $d } 0 .. 40 * 40 - 1;
+	is_deeply([map { PathFinding::getClientDist(0, 0, $_ % 40, int($_ / 40)) } 0 .. 40 * 40 - 1], \@clientDistances, 'getClientDist rounds like the client');
+
+	my $rawMap = join '', map { $_ % 3 ? "\1" : "\0" } 0 .. 20 * 20 - 1;
+	my @area;
+	PathFinding::calcRectArea(5, 6, 3, 1, 20, 20, \$rawMap, \@area);
+	is_deeply([PathFinding::unpackSolution(PathFinding::calcRectArea_packed(5, 6, 3, 1, 20, 20, \$rawMap))], \@area, 'calcRectArea_packed matches calcRectArea');
+	PathFinding::calcRectArea(1, 18, 4, 1, 20, 20, \$rawMap, \@area);
+	is_deeply([PathFinding::unpackSolution(PathFinding::calcRectArea_packed(1, 18, 4, 1, 20, 20, \$rawMap))], \@area, 'calcRectArea_packed near the map border');
+
+	# Times of a path: 10 for an orthogonal step, 14 for a diagonal one
+	my $path = pack('v*', 5, 5, 6, 6, 7, 6, 7, 6, 8, 5);
+	is_deeply([unpack('L*', PathFinding::solutionTimes($path))], [0, 14, 24, 34, 48], 'solutionTimes');
+	my $times = PathFinding::solutionTimes($path);
+	is_deeply([map { PathFinding::stepAtTime($times, 0.1, $_) } 0, 0.14, 0.15, 0.3, 0.5, 9], [0, 0, 1, 2, 4, 4], 'stepAtTime');
+	ok(!defined PathFinding::stepAtTime(PathFinding::solutionTimes(''), 0.1, 1), 'stepAtTime of an empty path');
+	is_deeply([PathFinding::easyPosAtTime(10, 10, 14, 20, 0.1, 0.5)], [13, 13], 'easyPosAtTime walks diagonally first');
+	is_deeply([PathFinding::easyPosAtTime(10, 10, 14, 20, 0.1, 0.7)], [14, 15], 'easyPosAtTime then walks straight');
+	is_deeply([PathFinding::easyPosAtTime(10, 10, 4, 10, 0.1, 5)], [4, 10], 'easyPosAtTime stops at the destination');
+
+	testBestAreaCenter();
+
+	testPortalGraph();
+
+	testDangerMap();
+	testObstacleLayer();
+
+	testSmoothSolution();
+	testRouteCursor();
+
+	testBidirectional();
+
+	testSearchWindow();
+
+	testLandmarks();
+}
+
+# bestAreaCenter finds the same hits as counting the positions in the area of every candidate
+sub testBestAreaCenter {
+	my $rawMap = join '', map { ($_ % 20 == 12 && int($_ / 20) < 15) ? "\0" : "\1" } 0 .. 20 * 20 - 1;
+	my @positions = ([3, 3], [4, 4], [5, 3], [14, 14], [15, 15], [16, 14], [15, 13], [-32768, -32768]);
+	my $packed = pack('s*', map { @$_ } @positions);
+	my ($x, $y, $hits) = PathFinding::bestAreaCenter($packed, 10, 17, 9, 10, 10, 9, 1, 1, 20, 20, \$rawMap);
+	is($hits, 4, 'bestAreaCenter finds the most positions an area can hit');
+	ok(abs($x - 15) <= 1 && abs($y - 14) <= 1, 'bestAreaCenter is centered on them');
+	($x, $y, $hits) = PathFinding::bestAreaCenter($packed, 10, 10, 9, 4, 4, 0, 1, 1, 20, 20, \$rawMap);
+	is_deeply([$x, $y, $hits], [4, 4, 3], 'bestAreaCenter stays around the given position');
+	is_deeply([PathFinding::bestAreaCenter($packed, 10, 10, 3, 16, 16, 1, 1, 1, 20, 20, \$rawMap)], [], 'no cell in range');
+	($x, $y, $hits) = PathFinding::bestAreaCenter($packed, 10, 2, 19, 15, 2, 0, 2, 1, 20, 20, \$rawMap);
+	ok(!defined $hits, 'cells behind walls can not be targeted');
+
+	srand(1);
+	my $same = 1;
+	for (1 .. 50) {
+		my @random = map { [int(rand(20)), int(rand(20))] } 1 .. 15;
+		my ($cx, $cy, $range, $ax, $ay, $around, $radius) = (int(rand(20)), int(rand(20)), int(rand(10)), int(rand(20)), int(rand(20)), int(rand(6)), int(rand(3)));
+		my ($bx, $by, $bestHits) = PathFinding::bestAreaCenter(pack('s*', map { @$_ } @random), $cx, $cy, $range, $ax, $ay, $around, $radius, 1, 20, 20, \$rawMap);
+		my $expected = -1;
+		for my $ty (0 .. 19) {
+			for my $tx (0 .. 19) {
+				next if (PathFinding::blockDistance($tx, $ty, $ax, $ay) > $around || PathFinding::getClientDist($tx, $ty, $cx, $cy) > $range);
+				next unless (PathFinding::checkLOS($cx, $cy, $tx, $ty, 1, 20, 20, \$rawMap) && substr($rawMap, $ty * 20 + $tx, 1) eq "\1");
+				my $count = grep { PathFinding::blockDistance($tx, $ty, $_->[0], $_->[1]) <= $radius } @random;
+				$expected = $count if ($count > $expected);
+			}
+		}
+		$same = 0 if ((defined $bestHits ? $bestHits : -1) != $expected);
+	}
+	ok($same, 'bestAreaCenter matches counting every candidate');
+}
+
+# Portal graph searches close links in walk order, with the zeny and tickets of Task::CalcMapRoute
+sub testPortalGraph {
+	my %portals = (
+		'a 10 10' => { source => { map => 'a', x => 10, y => 10 }, dest => { 'b 5 5' => { map => 'b', x => 5, y => 5, enabled => 1, cost => 0, steps => '' } } },
+		'a 20 20' => { source => { map => 'a', x => 20, y => 20 }, dest => { 'c 5 5' => { map => 'c', x => 5, y => 5, enabled => 1, cost => 1000, allow_ticket => 1, steps => 'c r0' } } },
+		'b 10 10' => { source => { map => 'b', x => 10, y => 10 }, dest => {
+			'c 6 6' => { map => 'c', x => 6, y => 6, enabled => 1, cost => 300, allow_ticket => 1, steps => 'c r1' },
+			'c 7 7' => { map => 'c', x => 7, y => 7, enabled => 0, cost => 0, steps => '' },
+		} },
+	);
+	my %los = ('b 5 5' => { 'b 10 10' => 50, 'a 10 10' => 0 });
+	my %weights = (PORTAL => 0, NPC => 10, b => 7);
+	my %start = (
+		'a 10 10=b 5 5' => { walk => 5, zeny => 0, allow_ticket => 0, zeny_covered_by_tickets => 0, amount_of_tickets_used => 0 },
+		'a 20 20=c 5 5' => { walk => 40, zeny => 1000, allow_ticket => 1, zeny_covered_by_tickets => 0, amount_of_tickets_used => 0 },
+	);
+	my $search = sub {
+		my $graph = PathFinding::PortalGraph->new(portals => \%portals, los => \%los, weights => \%weights, @_);
+		$graph->open($_, $start{$_}) foreach (sort keys %start);
+		my @closed;
+		while (my ($key, $node) = $graph->next()) {
+			push @closed, [$key, $node];
+		}
+		return @closed;
+	};
+
+	my @closed = $search->();
+	is_deeply([map { $_->[0] } @closed], ['a 10 10=b 5 5', 'a 20 20=c 5 5', 'b 10 10=c 6 6'], 'portal graph closes links in walk order, without the disabled ones');
+	is_deeply($closed[2][1], { walk => 72, zeny => 300, allow_ticket => 1, zeny_covered_by_tickets => 0, amount_of_tickets_used => 0, is_airship => 0, parent => 'a 10 10=b 5 5' },
+		'walk adds map, NPC and walking weights');
+	ok(!defined $closed[0][1]{parent}, 'starting links have no parent');
+
+	@closed = $search->(budget => 500);
+	is_deeply([map { $_->[0] } @closed], ['a 10 10=b 5 5', 'b 10 10=c 6 6'], 'links over the budget are dropped');
+	@closed = $search->(budget => 200, tickets => 1);
+	is_deeply([map { $_->[0] } @closed], ['a 10 10=b 5 5', 'b 10 10=c 6 6'], 'tickets pay for links which allow them');
+	is_deeply([@{$closed[1][1]}{qw(zeny_covered_by_tickets amount_of_tickets_used)}], [300, 1], 'zeny covered by tickets');
+	@closed = $search->(budget => '');
+	is(scalar @closed, 3, 'an empty budget is no budget');
+}
+
+# Searches with a danger layer find the same paths as with its cells given as custom weights
+sub testDangerMap {
+	my $open = makeWeightMap(20, 20);
+	my $danger = PathFinding::DangerMap->new(20, 20);
+
+	$danger->stamp(10, 10, 3, 100);
+	is($danger->at(10, 10), 100, 'full weight on the stamped cell');
+	is_deeply([map { $danger->at($_, 10) } 6..14], [0, 43, 75, 93, 100, 93, 75, 43, 0], 'weight falls off with the distance');
+	is($danger->at(-1, 10), 0, 'no weight out of the map');
+	$danger->stamp(1, 1, 3, 100);
+	$danger->stamp(10, 12, 2, 40);
+	is($danger->stamps, 3, 'stamps are counted');
+	is($danger->at(10, 12), 75 + 40, 'kernels add up');
+
+	my @overlay = map { my $x = $_ % 20; my $y = int($_ / 20); $danger->at($x, $y) ? { x => $x, y => $y, weight => $danger->at($x, $y) } : () } 0 .. 20 * 20 - 1;
+	my @weighted = runSearch(new PathFinding, $open, 20, 20, [2, 10], [18, 10], customWeights => 1, secondWeightMap => \@overlay);
+	my @dangerous = runSearch(new PathFinding, $open, 20, 20, [2, 10], [18, 10], danger => $danger, algorithm => 'auto');
+	is_deeply(\@dangerous, \@weighted, 'danger layer gives the path of the same custom weights');
+	ok(!grep({ $_->{x} == 10 && $_->{y} == 10 } @dangerous), 'path goes around the danger');
+
+	my $session = new PathFinding;
+	PathFinding::clearRouteCache();
+	runSearch($session, $open, 20, 20, [2, 10], [18, 10], danger => $danger, cache_key => 'danger');
+	runSearch($session, $open, 20, 20, [2, 10], [18, 10], danger => $danger, cache_key => 'danger');
+	ok($session->cached, 'search with an unchanged danger layer is cached');
+	$danger->unstamp(10, 12, 2, 40);
+	runSearch($session, $open, 20, 20, [2, 10], [18, 10], danger => $danger, cache_key => 'danger');
+	ok(!$session->cached, 'search with a changed danger layer is not cached');
+
+	$danger->unstamp(10, 10, 3, 100);
+	$danger->unstamp(1, 1, 3, 100);
+	is($danger->stamps, 0, 'all stamps are taken out');
+	ok(!grep({ $danger->at($_ % 20, int($_ / 20)) } 0 .. 20 * 20 - 1), 'unstamping leaves no weight behind');
+	is(runSearch($session, $open, 20, 20, [2, 10], [18, 10], danger => $danger), 17, 'empty danger layer changes nothing');
+
+	ok(!$session->reset(weight_map => \$open, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 5, y => 5 }, danger => PathFinding::DangerMap->new(10, 10)),
+		'danger layer of another size is refused');
+}
+
+# A danger layer given as secondWeightMap is read in place, like the same weights given as cells
+sub testObstacleLayer {
+	my $open = makeWeightMap(20, 20);
+	my $obstacles = PathFinding::DangerMap->new(20, 20);
+
+	$obstacles->stampInverseSquare(10, 10, 4, 2000, 1500);
+	is_deeply([map { $obstacles->at($_, 10) } 5..15], [0, 125, 222, 500, 1500, 1500, 1500, 500, 222, 125, 0], 'weight falls off with the squared distance');
+	my @expected = map { my $x = $_ % 20; my $y = int($_ / 20); my $dist = adjustedBlockDistance({ x => $x, y => $y }, { x => 10, y => 10 }) || 1;
+		(abs($x - 10) <= 4 && abs($y - 10) <= 4) ? min(1500, int(2000 / ($dist * $dist))) : 0 } 0 .. 20 * 20 - 1;
+	is_deeply([map { $obstacles->at($_ % 20, int($_ / 20)) } 0 .. 20 * 20 - 1], \@expected, 'weights of the square around the obstacle by adjustedBlockDistance');
+
+	my @overlay = map { my $x = $_ % 20; my $y = int($_ / 20); $obstacles->at($x, $y) ? { x => $x, y => $y, weight => $obstacles->at($x, $y) } : () } 0 .. 20 * 20 - 1;
+	my @weighted = runSearch(new PathFinding, $open, 20, 20, [2, 10], [18, 10], customWeights => 1, secondWeightMap => \@overlay);
+	my @layered = runSearch(new PathFinding, $open, 20, 20, [2, 10], [18, 10], customWeights => 1, secondWeightMap => $obstacles);
+	is_deeply(\@layered, \@weighted, 'obstacle layer gives the path of its cells');
+
+	my $session = new PathFinding;
+	PathFinding::clearRouteCache();
+	runSearch($session, $open, 20, 20, [2, 10], [18, 10], customWeights => 1, secondWeightMap => $obstacles, cache_key => 'obstacles');
+	runSearch($session, $open, 20, 20, [2, 10], [18, 10], customWeights => 1, secondWeightMap => $obstacles, cache_key => 'obstacles');
+	ok($session->cached, 'search with an unchanged obstacle layer is cached');
+	$obstacles->unstampInverseSquare(10, 10, 4, 2000, 1500);
+	$obstacles->stampInverseSquare(10, 11, 4, 2000, 1500);
+	runSearch($session, $open, 20, 20, [2, 10], [18, 10], customWeights => 1, secondWeightMap => $obstacles, cache_key => 'obstacles');
+	ok(!$session->cached, 'search with a moved obstacle is not cached');
+
+	$obstacles->unstampInverseSquare(10, 11, 4, 2000, 1500);
+	ok(!grep({ $obstacles->at($_ % 20, int($_ / 20)) } 0 .. 20 * 20 - 1), 'unstamping leaves no weight behind');
+	is(runSearch($session, $open, 20, 20, [2, 10], [18, 10], customWeights => 1, secondWeightMap => $obstacles), 17, 'empty obstacle layer changes nothing');
+
+	ok(!$session->reset(weight_map => \$open, width => 20, height => 20, start => { x => 2, y => 2 }, dest => { x => 5, y => 5 }, customWeights => 1, secondWeightMap => PathFinding::DangerMap->new(10, 10)),
+		'obstacle layer of another size is refused');
+}
+
+# Smoothed solutions are made of walks which checkPathFree allows, and are never longer than the solution
+sub testSmoothSolution {
+	my @walls = ((map { [10, $_] } 0..18), (map { [$_, 8] } 3..7));
+	my $map = makeWeightMap(20, 20, @walls);
+	my $rawMap = join '', map { ord($_) == 255 ? "\0" : "\1" } split //, $map;
+	my $packed;
+	my $session = new PathFinding(weight_map => \$map, width => 20, height => 20, start => { x => 5, y => 2 }, dest => { x => 18, y => 2 });
+	$session->run_packed(\$packed);
+	my @solution = PathFinding::unpackSolution($packed);
+
+	for my $max_segment (1, 4, 10, 100) {
+		my ($path, $indexes) = PathFinding::smoothSolution($packed, $max_segment, 1, 20, 20, \$rawMap);
+		my @path = PathFinding::unpackSolution($path);
+		my @waypoints = unpack('V*', $indexes);
+		ok(@path <= @solution, "smoothed solution is not longer, max_segment $max_segment");
+		is_deeply([@path[0, -1]], [@solution[0, -1]], "smoothed solution has the same ends, max_segment $max_segment");
+		is($waypoints[-1], $#path, "last cell is a waypoint, max_segment $max_segment");
+		my @bad = grep { PathFinding::blockDistance($path[$_ - 1]{x}, $path[$_ - 1]{y}, $path[$_]{x}, $path[$_]{y}) != 1 || substr($rawMap, $path[$_]{y} * 20 + $path[$_]{x}, 1) ne "\1" } 1..$#path;
+		ok(!@bad, "smoothed solution walks one walkable cell at a time, max_segment $max_segment");
+		my $from = 0;
+		for my $to (@waypoints) {
+			push @bad, $to if ($to - $from > $max_segment
+				|| !PathFinding::checkPathFree($path[$from]{x}, $path[$from]{y}, $path[$to]{x}, $path[$to]{y}, 1, 20, 20, \$rawMap));
+			$from = $to;
+		}
+		ok(!@bad, "every segment is a free straight walk, max_segment $max_segment");
+	}
+	my (undef, $few) = PathFinding::smoothSolution($packed, 100, 1, 20, 20, \$rawMap);
+	ok(length($few) / 4 < 5, 'a route around two walls needs a few waypoints');
+	my ($none, $noWaypoints) = PathFinding::smoothSolution('', 10, 1, 20, 20, \$rawMap);
+	is($none . $noWaypoints, '', 'empty solution');
+}
+
+# The route cursor picks the same steps as Task::Route did going over the solution in Perl
+sub testRouteCursor {
+	srand(5);
+	my @solution = ({ x => 20, y => 20 });
+	push @solution, { x => $solution[-1]{x} + int(rand(3)) - 1, y => $solution[-1]{y} + int(rand(3)) - 1 } for (1 .. 60);
+	$solution[$_ * 7]{waypoint} = 1 for (1 .. 8);
+	$solution[$_]{closeToEnd} = ($_ > 50) ? 1 : 0 for (40 .. 60);
+	my $cursor = PathFinding::RouteCursor->new(\@solution);
+	is($cursor->size, 61, 'route cursor size');
+	is_deeply([$cursor->cell(3)], [@{$solution[3]}{qw(x y)}], 'route cursor cell');
+	is_deeply([$cursor->cell(61)], [], 'route cursor cell past the end');
+
+	my @wrong;
+	for my $round (0 .. 199) {
+		my %pos = (x => 10 + int(rand(25)), y => 10 + int(rand(25)));
+		my $lookahead = 1 + $round % 6;
+		my ($best, $bestDistance, $since);
+		for my $i (0 .. $#solution) {
+			if ($solution[$i]{x} == $pos{x} && $solution[$i]{y} == $pos{y}) {
+				$best = $i;
+				last;
+			}
+			my $distance = adjustedBlockDistance(\%pos, $solution[$i]);
+			if (!defined $bestDistance || $bestDistance > $distance) {
+				($best, $bestDistance, $since) = ($i, $distance, 0);
+			} else {
+				$since++;
+			}
+			last if ($since == $lookahead);
+		}
+		push @wrong, "locate $pos{x} $pos{y} $lookahead" if ($cursor->locate($pos{x}, $pos{y}, $lookahead) != $best);
+
+		my $index = $round % @solution;
+		if ($solution[$index]{closeToEnd}) {
+			$index-- while ($index > 0 && $solution[$index - 1]{closeToEnd});
+		}
+		my ($waypoint) = grep { $solution[$_]{waypoint} } 2 .. $index;
+		my $step = $solution[defined $waypoint ? $waypoint : $index];
+		push @wrong, "nextStep $round" unless (join(' ', $cursor->nextStep($round % @solution, 1)) eq "$index $step->{x} $step->{y}");
+	}
+	ok(!@wrong, 'route cursor locates and picks the steps like the Perl loops') or diag "@wrong";
+
+	$cursor->trim(10);
+	is($cursor->size, 51, 'trimmed route cursor size');
+	is_deeply([$cursor->cell(0)], [@{$solution[10]}{qw(x y)}], 'trimmed route cursor starts at the step after the walked ones');
+	is(($cursor->nextStep(0, 0))[0], 0, 'next step of a trimmed route cursor');
+	$cursor->trim(100);
+	ok(!defined $cursor->locate(20, 20, 3), 'locate on a walked route');
+	is_deeply([$cursor->nextStep(0, 0)], [], 'next step of a walked route');
+}
+
+# The bidirectional search finds paths of the lowest cost, also on weighted maps where A* stops at the first path it finds
+sub testBidirectional {
+	my $walled = makeWeightMap(20, 20, map { [10, $_] } 0..18);
+	my $blocked = makeWeightMap(20, 20, map { [10, $_] } 0..19);
+	my $session = new PathFinding;
+
+	is(runSearch($session, $walled, 20, 20, [2, 2], [18, 2], avoidWalls => 0, algorithm => 'bidirectional'), 37, 'bidirectional path around a wall');
+	ok($session->expanded > 0, 'expanded nodes are counted');
+	is(runSearch($session, $blocked, 20, 20, [2, 2], [18, 2], algorithm => 'bidirectional'), -1, 'bidirectional, no path through a full wall');
+	is(runSearch($session, $walled, 20, 20, [5, 5], [5, 5], algorithm => 'bidirectional'), 1, 'bidirectional, start equals destination');
+	is_deeply([runSearch($session, $walled, 20, 20, [2, 2], [18, 2], algorithm => 'bidirectional', useManhattan => 1)],
+		[runSearch(new PathFinding, $walled, 20, 20, [2, 2], [18, 2], useManhattan => 1)], 'bidirectional falls back to A* with useManhattan');
+
+	# Random walls and cell weights, compared against a plain Dijkstra search
+	srand(2);
+	my ($width, $height) = (30, 30);
+	my $map = join '', map { rand() < 0.25 ? chr(255) : chr(int(rand(30))) } 1 .. $width * $height;
+	substr($map, 0, 1) = " ";
+	substr($map, $width * $height - 1, 1) = " ";
+	my @overlay = map { { x => int(rand($width)), y => int(rand($height)), weight => 50 } } 1..40;
+	my %custom;
+	$custom{$_->{y} * $width + $_->{x}} += $_->{weight} for @overlay;
+	my $lowest = dijkstraCost($map, $width, $height, [0, 0], [$width - 1, $height - 1], sub { ord(substr($map, $_[0], 1)) + ($custom{$_[0]} || 0) });
+	ok(defined $lowest, 'random map has a path');
+	my $cost = sub { sum(0, map { pathCost(@_[$_ - 1, $_]) + ord(substr($map, $_[$_]{y} * $width + $_[$_]{x}, 1)) + ($custom{$_[$_]{y} * $width + $_[$_]{x}} || 0) } 1..$#_) };
+
+	my @args = ([0, 0], [$width - 1, $height - 1], customWeights => 1, secondWeightMap => \@overlay);
+	my @bidirectional = runSearch($session, $map, $width, $height, @args, algorithm => 'bidirectional');
+	my $bidirectionalExpanded = $session->expanded;
+	my @astar = runSearch($session, $map, $width, $height, @args);
+	is($cost->(@bidirectional), $lowest, 'bidirectional path has the lowest cost');
+	ok($cost->(@bidirectional) <= $cost->(@astar), 'bidirectional path costs no more than the A* one');
+	ok($bidirectionalExpanded > 0 && $session->expanded > 0, 'both searches count their expanded nodes');
+	is_deeply([@bidirectional[0, -1]], [{ x => 0, y => 0 }, { x => $width - 1, y => $height - 1 }], 'bidirectional path goes from the start to the destination');
+	is(scalar(grep { PathFinding::blockDistance($bidirectional[$_ - 1]{x}, $bidirectional[$_ - 1]{y}, $bidirectional[$_]{x}, $bidirectional[$_]{y}) != 1 } 1..$#bidirectional), 0, 'bidirectional solution is made of single steps');
+
+	# A sliced bidirectional search resumes both sides where they stopped
+	my ($calls, $status, @sliced) = (0);
+	$session->reset(weight_map => \$map, width => $width, height => $height, start => { x => 0, y => 0 }, dest => { x => $width - 1, y => $height - 1 },
+		customWeights => 1, secondWeightMap => \@overlay, algorithm => 'bidirectional', node_budget => 10);
+	do { $status = $session->run(\@sliced); $calls++ } while ($status == -4 && $calls < 1000);
+	ok($calls > 1, 'sliced bidirectional search needs several calls');
+	is_deeply(\@sliced, \@bidirectional, 'sliced bidirectional search gives the same path');
+}
+
+# A search with an adaptive window finds the paths of a search over the whole map, growing the window when it has to
+sub testSearchWindow {
+	my $open = makeWeightMap(60, 60);
+	my $walled = makeWeightMap(60, 60, map { [30, $_] } 0..58);
+	my $blocked = makeWeightMap(60, 60, map { [30, $_] } 0..59);
+	my $session = new PathFinding;
+
+	is_deeply([runSearch($session, $open, 60, 60, [5, 5], [20, 10], window => 3)], [runSearch(new PathFinding, $open, 60, 60, [5, 5], [20, 10])], 'window, path on an open map');
+	is($session->windowGrowths, 0, 'a path inside the window needs no growth');
+	my $whole = new PathFinding;
+	my @around = runSearch($whole, $walled, 60, 60, [25, 5], [35, 5], avoidWalls => 0);
+	is(pathCost(runSearch($session, $walled, 60, 60, [25, 5], [35, 5], avoidWalls => 0, window => 2)), pathCost(@around), 'window grows to go around a wall');
+	ok($session->windowGrowths > 1, 'window grew several times');
+	my $expanded = $session->expanded;
+	ok($expanded > 0, 'window growth keeps counting the expanded nodes');
+	is(runSearch($session, $blocked, 60, 60, [25, 5], [35, 5], window => 2), -1, 'window, no path through a full wall');
+	is(runSearch($session, $walled, 60, 60, [25, 5], [35, 5], window => 2, max_y => 40), -1, 'window stops growing at the bounds');
+
+	my ($calls, $status, @sliced) = (0);
+	$session->reset(weight_map => \$walled, width => 60, height => 60, start => { x => 25, y => 5 }, dest => { x => 35, y => 5 }, avoidWalls => 0, window => 2, node_budget => 20);
+	do { $status = $session->run(\@sliced); $calls++ } while ($status == -4 && $calls < 1000);
+	is($status, scalar @around, 'sliced search with a window finds the path');
+	is($session->expanded, $expanded, 'sliced search with a window expands the same nodes');
+
+	$session->reset(weight_map => \$walled, width => 60, height => 60, start => { x => 25, y => 5 }, dest => { x => 25, y => 5 }, window => 2);
+	my @dests = ({ x => 35, y => 5 }, { x => 27, y => 6 });
+	is_deeply([$session->runcounts(\@dests)], [$#around, 2], 'runcounts grows the window for goals behind a wall');
+
+	is(runSearch($session, $walled, 60, 60, [25, 5], [35, 5], avoidWalls => 0, window => 2, algorithm => 'jps'), scalar @around, 'jps with a window');
+	is($session->windowGrowths, 0, 'jps searches the whole bounds at once');
+}
+
+# The landmark heuristic finds paths of the same cost as the diagonal distance, expanding fewer nodes through a maze
+sub testLandmarks {
+	my ($width, $height) = (40, 40);
+	# Walls across the map with a gap alternately at the top and the bottom, and a walled in cell
+	my @walls = map { my $x = $_ * 8; map { [$x, $_] } ($_ % 2) ? (1..39) : (0..38) } 1..4;
+	push @walls, [36, 35], [37, 35], [38, 35], [36, 37], [37, 37], [38, 37], [36, 36], [38, 36];
+	my $maze = makeWeightMap($width, $height, @walls);
+	my $landmarks = PathFinding::makeLandmarks(\$maze, $width, $height, 8);
+	is(length($landmarks), $width * $height * 8 * 2, 'landmarks hold a table of every landmark');
+	my @costs = unpack('S*', $landmarks);
+	my @spots = grep { $costs[$_] == 0 } 0..$#costs;
+	is(scalar @spots, 8, 'every landmark has a cost of 0 on its cell');
+	my ($spot) = grep { $costs[$_ * 8 + 1] == 0 } 0 .. $width * $height - 1;
+	is($costs[(20 * $width + 4) * 8 + 1], dijkstraCost($maze, $width, $height, [$spot % $width, int($spot / $width)], [4, 20], sub { 0 }), 'landmark costs are walking costs');
+	is($costs[(36 * $width + 37) * 8], 0xFFFF, 'cells out of reach of the landmarks');
+
+	my $session = new PathFinding;
+	for my $args ([avoidWalls => 0], [avoidWalls => 1], [algorithm => 'jps', avoidWalls => 0]) {
+		my @plain = runSearch($session, $maze, $width, $height, [2, 2], [38, 38], @$args);
+		my $plainExpanded = $session->expanded;
+		my @guided = runSearch($session, $maze, $width, $height, [2, 2], [38, 38], @$args, landmarks => \$landmarks);
+		is(pathCost(@guided), pathCost(@plain), "landmark path has the same cost (@$args)");
+		# Jump Point Search only counts the jump points it expands
+		ok($session->expanded < $plainExpanded, "landmark search expands fewer nodes (@$args)") unless ($args->[0] eq 'algorithm');
+	}
+	is_deeply([runSearch($session, $maze, $width, $height, [2, 2], [38, 38], useManhattan => 1, landmarks => \$landmarks)],
+		[runSearch(new PathFinding, $maze, $width, $height, [2, 2], [38, 38], useManhattan => 1)], 'landmarks are ignored with useManhattan');
+	is(runSearch($session, $maze, $width, $height, [2, 2], [37, 36], landmarks => \$landmarks), -1, 'landmark search to a cell out of reach');
+	is(runSearch($session, $maze, $width, $height, [2, 2], [38, 38], landmarks => \substr($landmarks, 1)), -2, 'landmarks of the wrong size are refused');
+	my $few = PathFinding::makeLandmarks(\makeWeightMap(3, 1), 3, 1, 8);
+	is(length($few), 3 * 3 * 2, 'no more landmarks than walkable cells');
+}
+
+# Lowest cost between two cells, stepping like the PathFinding searches with 'weight' giving the extra weight of the entered cell
+sub dijkstraCost {
+	my ($map, $width, $height, $start, $dest, $weight) = @_;
+	my %cost = ($start->[1] * $width + $start->[0] => 0);
+	my %closed;
+	while (1) {
+		my ($current) = sort { $cost{$a} <=> $cost{$b} || $a <=> $b } grep { !$closed{$_} } keys %cost;
+		return undef unless (defined $current);
+		return $cost{$current} if ($current == $dest->[1] * $width + $dest->[0]);
+		$closed{$current} = 1;
+		my ($x, $y) = ($current % $width, int($current / $width));
+		my $mask = neighborMask($map, $width, $height, $x, $y);
+		my @steps = ([0, 1], [0, -1], [1, 0], [-1, 0], [1, 1], [1, -1], [-1, -1], [-1, 1]);
+		for my $i (grep { $mask & (1 << $_) } 0..7) {
+			my $neighbor = ($y + $steps[$i][1]) * $width + $x + $steps[$i][0];
+			my $g = $cost{$current} + ($i >= 4 ? 14 : 10) + $weight->($neighbor);
+			$cost{$neighbor} = $g if (!$closed{$neighbor} && (!defined $cost{$neighbor} || $g < $cost{$neighbor}));
+		}
+	}
+}
+
+# Cost of a solution, 10 for each ortogonal step and 14 for each diagonal one
+sub pathCost {
+	my @solution = @_;
+	return sum(map { ($solution[$_]{x} != $solution[$_ - 1]{x} && $solution[$_]{y} != $solution[$_ - 1]{y}) ? 14 : 10 } 1..$#solution) || 0;
+}
+
+# Plain implementation of the neighbor mask of a cell, see CalcPath_neighborMaskAt
+sub neighborMask {
+	my ($map, $width, $height, $x, $y) = @_;
+	my $walkable = sub {
+		my ($x, $y) = @_;
+		return $x >= 0 && $x < $width && $y >= 0 && $y < $height && ord(substr($map, $y * $width + $x, 1)) != 255;
+	};
+	my ($n, $s, $e, $w) = ($walkable->($x, $y + 1), $walkable->($x, $y - 1), $walkable->($x + 1, $y), $walkable->($x - 1, $y));
+	return ($n ? 1 : 0) | ($s ? 2 : 0) | ($e ? 4 : 0) | ($w ? 8 : 0)
+		| ($e && $n && $walkable->($x + 1, $y + 1) ? 16 : 0)
+		| ($e && $s && $walkable->($x + 1, $y - 1) ? 32 : 0)
+		| ($w && $s && $walkable->($x - 1, $y - 1) ? 64 : 0)
+		| ($w && $n && $walkable->($x - 1, $y + 1) ? 128 : 0);
+}
+
+# Builds a weight map string of the given size, all cells walkable except the given [x, y] walls
+sub makeWeightMap {
+	my ($width, $height, @walls) = @_;
+	my $map = "\0" x ($width * $height);
+	substr($map, $_->[1] * $width + $_->[0], 1) = chr(255) for @walls;
+	return $map;
+}
+
+sub runSearch {
+	my ($pathfinding, $map, $width, $height, $start, $dest, %args) = @_;
+	my @solution;
+	$pathfinding->reset(
+		weight_map => \$map,
+		width => $width,
+		height => $height,
+		start => { x => $start->[0], y => $start->[1] },
+		dest => { x => $dest->[0], y => $dest->[1] },
+		%args
+	);
+	my $result = $pathfinding->run(\@solution);
+	return wantarray ? @solution : $result;
+}
+
+1;
@@ -10,6 +10,7 @@ sub start {
 	testAddHooks();
 	testAddDuringCall();
 	testDelDuringCall();
+	testArguments();
 	testLegacyAPI();
 }
 
@@ -177,6 +178,35 @@ sub testDelDuringCall {
 	is( "@called", '4' );
 }
 
+sub testArguments {
+	my @called;
+	my $argument = { value => 1 };
+	my $handle = Plugins::addHooks(
+		['arguments', sub { push @called, [@_]; }, 'data'],
+		['arguments', sub { push @called, [@_]; }]
+	);
+
+	Plugins::callHook('arguments', $argument);
+	is_deeply(\@called, [['arguments', $argument, 'data'], ['arguments', $argument, undef]],
+		"callbacks get the hook name, the argument and their user data");
+
+	@called = ();
+	Plugins::callHook('arguments');
+	is_deeply(\@called, [['arguments', undef, 'data'], ['arguments', undef, undef]], "the argument is optional");
+
+	my $changing = Plugins::addHook('changes', sub { $_[1] = 'changed'; });
+	Plugins::callHook('changes', $argument);
+	is(ref $argument, 'HASH', "callbacks get copies of the arguments");
+	Plugins::delHook($changing);
+
+	my $dying = Plugins::addHook('dies', sub { die "hook died\n" });
+	ok(!eval { Plugins::callHook('dies'); 1 } && $@ eq "hook died\n", "callbacks which die make callHook() die");
+	ok(Plugins::hasHook('dies'), "callbacks which died are still registered");
+	Plugins::delHook($dying);
+	Plugins::delHook($handle);
+	ok(!Plugins::hasHook('arguments'));
+}
+
 sub testLegacyAPI {
 	my $handle = Plugins::addHook('hook1', sub {});
 	ok(Plugins::hasHook('hook1'));
@@ -20,6 +20,98 @@ sub new {
 sub run {
 	my ($self) = @_;
 	testHash("katon92", "0779633C7C7080C6B4F443E9130B06C8C66BC0BAB9700DAF");
+	testAES();
+	testKeyed();
+	testInPlace();
+}
+
+sub testInPlace {
+	my $key = pack('H*', '000102030405060708090a0b0c0d0e0f');
+	foreach my $mode (0, 1, 2) {
+		foreach my $blockSize (16, 32) {
+			my ($copying, $inPlace) = (Utils::Rijndael->new(), Utils::Rijndael->new());
+			$copying->MakeKey($key, "\0" x 32, 16, $blockSize);
+			$inPlace->MakeKey($key, "\0" x 32, 16, $blockSize);
+			my $ok = 1;
+			foreach my $packet (1..3) {
+				my $data = join('', map { chr(($_ * 7 + $packet) & 0xFF) } 1..($blockSize * $packet));
+				my $buffer = $data;
+				$inPlace->EncryptInPlace($buffer, $mode);
+				$ok &&= $buffer eq $copying->Encrypt($data, undef, length($data), $mode);
+			}
+			ok($ok, "in place encryption, mode $mode, $blockSize byte blocks");
+
+			($copying, $inPlace) = (Utils::Rijndael->new(), Utils::Rijndael->new());
+			$copying->MakeKey($key, "\0" x 32, 16, $blockSize);
+			$inPlace->MakeKey($key, "\0" x 32, 16, $blockSize);
+			$ok = 1;
+			foreach my $packet (1..3) {
+				my $data = $copying->Encrypt("x" x ($blockSize * $packet), undef, $blockSize * $packet, $mode);
+				my $buffer = $data;
+				$inPlace->DecryptInPlace($buffer, $mode);
+				$ok &&= $buffer eq ("x" x ($blockSize * $packet));
+			}
+			ok($ok, "in place decryption, mode $mode, $blockSize byte blocks");
+		}
+	}
+	my $rijndael = Utils::Rijndael->new();
+	$rijndael->MakeKey($key, "\0" x 16, 16, 16);
+	my $short = "x" x 15;
+	ok(!eval { $rijndael->EncryptInPlace($short, 0); 1 }, 'in place encryption of a partial block');
+	my $block = "x" x 16;
+	ok(!eval { Utils::Rijndael->new()->EncryptInPlace($block, 0); 1 }, 'in place encryption without a key');
+	like($@, qr/key/, 'in place encryption without a key dies with a message');
+}
+
+sub testKeyed {
+	my $key = pack('C24', (6, 169, 33, 64, 54, 184, 161, 91, 81, 46, 3, 213, 52, 18, 0, 6, 61, 175, 186, 66, 157, 158, 180, 48));
+	my $chain = pack('C24', (61, 175, 186, 66, 157, 158, 180, 48, 180, 34, 218, 128, 44, 159, 172, 65, 1, 2, 4, 8, 16, 32, 128));
+	my $keyed = Utils::Rijndael::keyed($key, $chain, 24, 24);
+	is(Utils::Rijndael::keyed($key, $chain, 24, 24), $keyed, 'keyed objects are shared');
+	isnt(Utils::Rijndael::keyed($key, $chain, 24, 16), $keyed, 'keyed objects of other sizes are distinct');
+	my $in = pack('a24', "katon92");
+	is(give_hex($keyed->Encrypt($in, undef, 24, 0)), "0779633C7C7080C6B4F443E9130B06C8C66BC0BAB9700DAF", 'keyed encryption');
+	is(unpack('Z24', $keyed->Decrypt($keyed->Encrypt($in, undef, 24, 0), undef, 24, 0)), "katon92", 'keyed decryption');
+
+	# Chained modes start from the chain on every call
+	my $plain = Utils::Rijndael->new();
+	$plain->MakeKey($key, $chain . "\0", 24, 24);
+	my $data = "x" x 48;
+	my $first = $plain->Encrypt($data, undef, 48, 1);
+	isnt($plain->Encrypt($data, undef, 48, 1), $first, 'plain objects go on with the chain');
+	is($keyed->Encrypt($data, undef, 48, 1), $first, 'keyed objects start from the chain');
+	is($keyed->Encrypt($data, undef, 48, 1), $first, 'keyed objects start from the chain again');
+	ok(!eval { $keyed->MakeKey($key, $chain, 24, 24); 1 }, 'keyed objects keep their key');
+	ok(!eval { Utils::Rijndael::Keyed->new("short", $chain, 24, 24); 1 }, 'keys must be long enough');
+}
+
+# AES (16 byte blocks) may use the AES instructions of the CPU, they must match the tables
+sub testAES {
+	my $rijndael = Utils::Rijndael->new();
+	$rijndael->MakeKey(pack('H*', '000102030405060708090a0b0c0d0e0f'), "\0" x 16, 16, 16);
+	is(unpack('H*', $rijndael->Encrypt(pack('H*', '00112233445566778899aabbccddeeff'), undef, 16, 0)),
+		'69c4e0d86a7b0430d8cdb78070b4c55a', 'AES-128 test vector of FIPS-197');
+
+	srand(1);
+	my $data = join('', map { chr(int(rand(256))) } 1..160);
+	foreach my $keyLength (16, 24, 32) {
+		my $key = join('', map { chr(int(rand(256))) } 1..$keyLength);
+		my $chain = join('', map { chr(int(rand(256))) } 1..16);
+		foreach my $mode (0, 1, 2) {
+			my ($tables, $hardware) = map {
+				my $rijndael = Utils::Rijndael->new();
+				$rijndael->MakeKey($key, $chain, $keyLength, 16);
+				$rijndael->UseHardware($_);
+				my $encrypted = $rijndael->Encrypt($data, undef, length($data), $mode);
+				my $decrypter = Utils::Rijndael->new();
+				$decrypter->MakeKey($key, $chain, $keyLength, 16);
+				$decrypter->UseHardware($_);
+				[$encrypted, $decrypter->Decrypt($encrypted, undef, length($encrypted), $mode)]
+			} (0, 1);
+			is(unpack('H*', $hardware->[0]), unpack('H*', $tables->[0]), "AES-" . ($keyLength * 8) . " mode $mode encryption");
+			ok($tables->[1] eq $data && $hardware->[1] eq $data, "AES-" . ($keyLength * 8) . " mode $mode decryption");
+		}
+	}
 }
 
 sub testHash {
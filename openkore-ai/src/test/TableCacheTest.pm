@@ -0,0 +1,94 @@
+# A unit test for Utils::TableCache and the cached table files of Settings.
+package TableCacheTest;
+
+use strict;
+use Test::More;
+use File::Temp qw(tempdir);
+use Globals qw(%config);
+use Plugins;
+use Settings;
+use Utils::TableCache;
+
+sub start {
+	print "### Starting TableCacheTest\n";
+	testImages();
+	testSettings();
+}
+
+sub writeFile {
+	my ($file, $content) = @_;
+	open(my $f, '>', $file) or die "Cannot write $file: $!";
+	print $f $content;
+	close($f);
+}
+
+sub testImages {
+	my $dir = tempdir(CLEANUP => 1);
+	my $source = "$dir/table.txt";
+	writeFile($source, "1 one\n2 two\n");
+
+	my (%hash, @array, $scalar);
+	ok(!Utils::TableCache::load($source, 'parser', \%hash), "a table without an image isn't loaded");
+	%hash = (1 => 'one', 2 => { nested => 'two' });
+	@array = ('a', 'b');
+	$scalar = 'c';
+	ok(Utils::TableCache::save($source, 'parser', \%hash, \@array, \$scalar), "images are written");
+	ok(-f Utils::TableCache::filename($source), "next to their table");
+
+	my (%hash2, @array2, $scalar2);
+	%hash2 = (stale => 1);
+	ok(Utils::TableCache::load($source, 'parser', \%hash2, \@array2, \$scalar2), "images are loaded");
+	is_deeply([\%hash2, \@array2, $scalar2], [\%hash, \@array, $scalar], "into the targets, replacing what they held");
+	ok(!Utils::TableCache::load($source, 'other parser', \%hash2, \@array2, \$scalar2), "images of another parser aren't loaded");
+	ok(!Utils::TableCache::load($source, 'parser', \@array2, \%hash2, \$scalar2), "nor those of other targets");
+
+	my $time = (stat($source))[9];
+	utime($time + 10, $time + 10, $source);
+	ok(!Utils::TableCache::load($source, 'parser', \%hash2, \@array2, \$scalar2), "images of a changed table aren't loaded");
+
+	writeFile(Utils::TableCache::filename($source), "garbage");
+	ok(!Utils::TableCache::load($source, 'parser', \%hash2), "broken images aren't loaded");
+}
+
+sub testSettings {
+	my $dir = tempdir(CLEANUP => 1);
+	my $source = "$dir/cached.txt";
+	writeFile($source, "1 one\n");
+	my %table;
+	my $parses = 0;
+	my $parse = sub {
+		my ($file, $r_hash, $suffix) = @_;
+		$parses++;
+		%{$r_hash} = (1 => "one$suffix");
+	};
+
+	local $config{tableCache} = 1;
+	my $handle = Settings::addTableFile($source, autoSearch => 0, loader => [$parse, \%table, '!'], cache => 1);
+	Settings::loadByHandle($handle);
+	Settings::loadByHandle($handle);
+	is($parses, 1, "cached tables are parsed once");
+	is_deeply(\%table, {1 => 'one!'}, "and loaded from their image then");
+
+	$config{tableCache} = 0;
+	Settings::loadByHandle($handle);
+	is($parses, 2, "tables are parsed without the tableCache option");
+	Settings::removeFile($handle);
+
+	$config{tableCache} = 1;
+	$handle = Settings::addTableFile($source, autoSearch => 0, loader => [$parse, \%table, '?'], cache => 1);
+	Settings::loadByHandle($handle);
+	is($table{1}, 'one?', "the image of a table parsed another way isn't used");
+	Settings::removeFile($handle);
+
+	my $hook = Plugins::addHook('TableCacheTest::parse', sub {});
+	$handle = Settings::addTableFile($source, autoSearch => 0, loader => [$parse, \%table, '?'], cache => 'TableCacheTest::parse');
+	$parses = 0;
+	Settings::loadByHandle($handle);
+	is($parses, 1, "the image isn't used while plugins parse the table");
+	Plugins::delHook($hook);
+	Settings::loadByHandle($handle);
+	is($parses, 1, "but is again afterwards");
+	Settings::removeFile($handle);
+}
+
+1;
@@ -0,0 +1,105 @@
+# A unit test for Utils::TimerWheel.
+package TimerWheelTest;
+
+use strict;
+use Test::More;
+use Utils::TimerWheel;
+
+sub start {
+	print "### Starting TimerWheelTest\n";
+	testTimers();
+	testLevels();
+	testRandom();
+}
+
+sub testTimers {
+	my $timers = new Utils::TimerWheel(0.01);
+	my $start = $timers->now;
+	ok(abs(time - $start) < 5, "the clock starts at the current time");
+
+	$timers = new Utils::TimerWheel(0.01);
+	my $START = $timers->now + 1;
+	$timers->expired($START);
+	is($timers->now, $START, "expired() sets the clock");
+	$timers->set('a', 1);
+	$timers->set('b', 2);
+	$timers->set('c', 0.5, $START - 1);
+	is($timers->count, 3, "timers are pending");
+	ok(abs($timers->remaining('a') - 1) < 1e-6, "remaining time");
+	ok(abs($timers->remaining('c') + 0.5) < 1e-6, "overdue timers have a negative remaining time");
+	is($timers->remaining('unknown'), undef, "unknown timers aren't pending");
+
+	is_deeply([$timers->expired($START + 0.011)], ['c'], "overdue timers are due on the next tick");
+	is_deeply([$timers->expired($START + 0.999)], [], "timers aren't due before their deadline");
+	is_deeply([$timers->expired($START + 1.02)], ['a'], "timers are due at their deadline");
+	is($timers->remaining('a'), undef, "due timers are no longer pending");
+	is_deeply([$timers->expired($START + 1.5)], [], "due timers are reported once");
+
+	$timers->set('b', 2, $START + 1.5);
+	is_deeply([$timers->expired($START + 2.5)], [], "setting a timer again replaces its deadline");
+	$timers->cancel('b');
+	$timers->cancel('unknown');
+	is($timers->count, 0, "cancelled timers aren't pending");
+	is_deeply([$timers->expired($START + 10)], [], "cancelled timers aren't due");
+	is_deeply([$timers->expired($START + 5)], [], "the clock going back makes nothing due");
+}
+
+# Timers beyond the first level are cascaded down to it when their time comes
+sub testLevels {
+	my $timers = new Utils::TimerWheel(0.01);
+	my $START = $timers->now + 1;
+	$timers->expired($START);
+	my %deadlines = (second => 1, minute => 60, hour => 3600, day => 86400, year => 86400 * 365);
+	$timers->set($_, $deadlines{$_}) for (keys %deadlines);
+
+	my %due;
+	my $late = 0;
+	for (my $now = $START; $now < $START + 86400 * 366; $now += ($now < $START + 100000) ? 7.3 : 3700) {
+		foreach my $name ($timers->expired($now)) {
+			$due{$name} = $now;
+			$late = 1 if ($now < $START + $deadlines{$name});
+		}
+	}
+	is_deeply([sort keys %due], [sort keys %deadlines], "timers of every level are due");
+	ok(!$late, "none is due before its deadline");
+	ok($due{minute} - ($START + 60) < 7.3 + 0.01, "timers are due on the first call after their deadline");
+}
+
+# The wheel reports the same timers as checking every deadline would
+sub testRandom {
+	my $timers = new Utils::TimerWheel(0.01);
+	my (%deadlines, $wrong);
+	my $now = $timers->now + 1;
+	srand(42);
+	$timers->expired($now);
+
+	for my $step (1 .. 3000) {
+		$now += rand(0.5);
+		my %expected;
+		foreach my $name (keys %deadlines) {
+			$expected{$name} = 1 if ($deadlines{$name} <= $now - 0.011);
+		}
+		my %due = map { $_ => 1 } $timers->expired($now);
+		foreach my $name (keys %due) {
+			$wrong = "$name at step $step" if (!exists $deadlines{$name} || $deadlines{$name} > $now);
+			delete $deadlines{$name};
+		}
+		foreach my $name (keys %expected) {
+			$wrong = "$name missed at step $step" if (!$due{$name});
+		}
+
+		my $name = 'timer' . int(rand(50));
+		if (rand() < 0.2) {
+			$timers->cancel($name);
+			delete $deadlines{$name};
+		} else {
+			my $seconds = (rand() < 0.9) ? rand(5) : rand(1000);
+			$timers->set($name, $seconds);
+			$deadlines{$name} = $now + $seconds;
+		}
+	}
+	ok(!$wrong, "timers are due like their deadlines say") or diag($wrong);
+	is($timers->count, scalar(keys %deadlines), "pending timers are counted");
+}
+
+1;
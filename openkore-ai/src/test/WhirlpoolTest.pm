@@ -2,7 +2,10 @@ package WhirlpoolTest;
 
 use strict;
 use Test::More;
-use Utils::Whirlpool qw(whirlpool whirlpool_hex);
+use File::Temp;
+use File::Spec;
+use Utils;
+use Utils::Whirlpool qw(whirlpool whirlpool_hex whirlpool_file_hex whirlpool_manifest);
 
 sub start {
 	print "### Starting WhirlpoolTest\n";
@@ -28,6 +31,72 @@ sub run {
 	testHash("The quick brown fox jumps over the lazy eog",
 			"C27BA124205F72E6847F3E19834F925CC666D0974167AF915BB462420ED40CC5" .
 			"0900D85A1F923219D832357750492D5C143011A76988344C2635E69D06F2D38C");
+	testChunks();
+	testFile();
+	testManifest();
+}
+
+sub testManifest {
+	my $dir = File::Temp::tempdir(CLEANUP => 1);
+	my %contents = map { ("file$_.txt" => "data" x ($_ * 100)) } 1..20;
+	$contents{"other.dat"} = "other";
+	foreach my $name (keys %contents) {
+		open(my $f, ">:raw", File::Spec->catfile($dir, $name)) or die "Cannot write $name";
+		print $f $contents{$name};
+		close($f);
+	}
+	mkdir(File::Spec->catfile($dir, "subfolder.txt"));
+
+	my @names = sort keys %contents;
+	is_deeply([map { unpack("H*", $_) } Utils::Whirlpool::hashFiles([map { File::Spec->catfile($dir, $_) } @names], 4)],
+		[map { whirlpool_hex($contents{$_}) } @names], "hashFiles");
+	is(Utils::setNativeThreads(3), 3, "native thread pool resized");
+	is(Utils::nativeThreads(), 3, "native thread pool size");
+	is_deeply([map { unpack("H*", $_) } Utils::Whirlpool::hashFiles([map { File::Spec->catfile($dir, $_) } @names])],
+		[map { whirlpool_hex($contents{$_}) } @names], "hashFiles on every thread of the pool");
+	is_deeply([Utils::Whirlpool::hashFiles([File::Spec->catfile($dir, "missing"), File::Spec->catfile($dir, "other.dat")])],
+		[undef, whirlpool($contents{"other.dat"})], "hashFiles of a missing file");
+	is_deeply([Utils::Whirlpool::hashFiles([])], [], "hashFiles of no files");
+	is_deeply(whirlpool_manifest($dir, qr/\.txt$/),
+		{ map { $_ => whirlpool_hex($contents{$_}) } grep { /\.txt$/ } @names }, "whirlpool_manifest");
+	ok(!defined(whirlpool_manifest(File::Spec->catfile($dir, "missing"))), "whirlpool_manifest of a missing folder");
+}
+
+# A million 'a', added in pieces that start and end everywhere in the 64 byte blocks
+sub testChunks {
+	my $expectedHash = "0C99005BEB57EFF50A7CF005560DDF5D29057FD86B20BFD62DECA0F1CCEA4AF5" .
+			"1FC15490EDDC47AF32BB2B66C34FF9AD8C6008AD677F77126953B226E4ED8B01";
+	my $data = "a" x 1000000;
+	is(uc whirlpool_hex($data), $expectedHash, "a million 'a'");
+
+	my $wp = new Utils::Whirlpool();
+	my ($pos, $size) = (0, 1);
+	while ($pos < length($data)) {
+		$wp->add(substr($data, $pos, $size));
+		$pos += $size;
+		$size = ($size * 7 + 3) % 200;
+	}
+	is(uc unpack("H*", $wp->finalize()), $expectedHash, "a million 'a' in pieces");
+}
+
+sub testFile {
+	my $filename = "whirlpool-test.tmp";
+	my $data = join('', map { chr($_ % 251) } 1..100000);
+	open(my $f, ">:raw", $filename) or die "Cannot write $filename";
+	print $f $data;
+	close($f);
+	is(whirlpool_file_hex($filename), whirlpool_hex($data), "file");
+
+	my $wp = new Utils::Whirlpool();
+	$wp->add("header");
+	ok($wp->addFile($filename), "addFile");
+	is(unpack("H*", $wp->finalize()), whirlpool_hex("header" . $data), "addFile after add");
+
+	open($f, ">", $filename) or die "Cannot write $filename";
+	close($f);
+	is(whirlpool_file_hex($filename), whirlpool_hex(""), "empty file");
+	unlink($filename);
+	ok(!defined(whirlpool_file_hex($filename)), "missing file");
 }
 
 sub testHash {
@@ -0,0 +1,172 @@
+# A unit test for Network::XKoreProxy::Relay.
+package XKoreProxyRelayTest;
+
+use strict;
+use Test::More;
+use Socket;
+use IO::Handle;
+use Time::HiRes qw(time sleep);
+use FastUtils;
+
+use constant {
+	MIRROR => 0,
+	FORWARD => 1,
+	HOLD => 2,
+};
+
+my %rpackets = (
+	'0078' => {length => 6},
+	'0080' => {length => 4},
+	'0081' => {length => 3},
+	'01D7' => {length => -1},
+);
+
+my $mirrored = pack('v a4', 0x0078, 'abcd');
+my $forwarded = pack('v a2', 0x0080, 'ef');
+my $held = pack('v C', 0x0081, 7);
+my $variable = pack('v v a3', 0x01D7, 7, 'xyz');
+
+sub start {
+	print "### Starting XKoreProxyRelayTest\n";
+	testMirror();
+	testHold();
+	testUnknownMessage();
+	testServerClosed();
+	testStop();
+}
+
+# Returns the relay, the socket the test writes the server messages to and the one it reads what the client got from
+sub newRelay {
+	my (%modes) = @_;
+	my ($server, $relayServer, $client, $relayClient);
+	socketpair($server, $relayServer, AF_UNIX, SOCK_STREAM, PF_UNSPEC) or die "socketpair: $!";
+	socketpair($client, $relayClient, AF_UNIX, SOCK_STREAM, PF_UNSPEC) or die "socketpair: $!";
+	$server->autoflush(1);
+	my $relay = Network::XKoreProxy::Relay->new($relayServer, $relayClient, \%rpackets);
+	$relay->setMode(hex($_), $modes{$_}) for (keys %modes);
+	ok($relay->start, "Relay started");
+	return {relay => $relay, server => $server, client => $client, sockets => [$relayServer, $relayClient]};
+}
+
+# Reads what the client got until there are $length bytes, or for a second
+sub clientRead {
+	my ($test, $length) = @_;
+	my $data = '';
+	my $end = time + 1;
+	while (length($data) < $length && time < $end) {
+		my $bits = '';
+		vec($bits, fileno($test->{client}), 1) = 1;
+		next unless (select($bits, undef, undef, 0.05) > 0);
+		my $buffer;
+		last unless (sysread($test->{client}, $buffer, 4096));
+		$data .= $buffer;
+	}
+	return $data;
+}
+
+# Takes from the relay until it returned $count messages for the main loop, or for a second
+sub takeAll {
+	my ($relay, $count, $closed) = @_;
+	my ($data, @forwarded) = ('');
+	my $end = time + 1;
+	while (time < $end) {
+		my ($taken, @messages) = $relay->take;
+		$data .= $taken;
+		push @forwarded, @messages;
+		last if (defined $count && length($data) >= $count && (!$closed || $relay->serverClosed));
+		sleep 0.02;
+	}
+	return ($data, @forwarded);
+}
+
+sub testMirror {
+	my $test = newRelay('0080' => FORWARD);
+	my $relay = $test->{relay};
+
+	syswrite($test->{server}, $mirrored . $forwarded . substr($variable, 0, 3));
+	is(clientRead($test, 10), $mirrored . $forwarded, "Complete messages are sent to the client");
+	syswrite($test->{server}, substr($variable, 3));
+	is(clientRead($test, 7), $variable, "The rest of a message is sent once it's read");
+
+	my ($data, @messages) = takeAll($relay, length($mirrored . $variable));
+	is($data, $mirrored . $variable, "Mirrored messages are left to the main loop, forwarded ones aren't");
+	is_deeply(\@messages, [$mirrored, $variable], "Mirrored messages were forwarded");
+	is($relay->forwarded, 3, "Forwarded count");
+	is($relay->held, 0, "Nothing held");
+
+	ok($relay->send("reply"), "The main loop can send to the client");
+	is(clientRead($test, 5), "reply", "The client got it");
+	$relay->stop;
+}
+
+sub testHold {
+	my $test = newRelay('0081' => HOLD);
+	my $relay = $test->{relay};
+
+	syswrite($test->{server}, $mirrored . $held . $mirrored);
+	is(clientRead($test, 6), $mirrored, "Messages before a held one are forwarded");
+	my ($data, @messages) = takeAll($relay, length($mirrored . $held . $mirrored));
+	is($data, $mirrored . $held . $mirrored, "Every message is left to the main loop");
+	is_deeply(\@messages, [$mirrored], "Only the messages before the held one were forwarded");
+	is($relay->held, 1, "Held count");
+
+	syswrite($test->{server}, $forwarded);
+	is(clientRead($test, 1), '', "Nothing is forwarded until the main loop released the relay");
+	$relay->send($held . $mirrored);
+	$relay->release;
+	($data, @messages) = takeAll($relay, length($forwarded));
+	is($data, $forwarded, "A message read before the release is left to the main loop");
+	is_deeply(\@messages, [], "It was not forwarded");
+	$relay->send($forwarded);
+	$relay->release;
+
+	syswrite($test->{server}, $mirrored);
+	is(clientRead($test, 19), $held . $mirrored . $forwarded . $mirrored, "Forwarding goes on once everything was taken and released");
+	$relay->stop;
+}
+
+sub testUnknownMessage {
+	my $test = newRelay();
+	my $relay = $test->{relay};
+	my $unknown = pack('v a3', 0x1234, 'foo');
+
+	syswrite($test->{server}, $mirrored . $unknown);
+	is(clientRead($test, 6), $mirrored, "Known messages are forwarded");
+	syswrite($test->{server}, $mirrored);
+	my ($data, @messages) = takeAll($relay, length($mirrored . $unknown . $mirrored));
+	is($data, $mirrored . $unknown . $mirrored, "Everything from an unknown message on is left to the main loop");
+	is_deeply(\@messages, [$mirrored], "Nothing was forwarded after the unknown message");
+	is(clientRead($test, 1), '', "The client got nothing more");
+	$relay->stop;
+}
+
+sub testServerClosed {
+	my $test = newRelay();
+	my $relay = $test->{relay};
+
+	syswrite($test->{server}, $mirrored);
+	close($test->{server});
+	my ($data) = takeAll($relay, length($mirrored), 1);
+	ok($relay->serverClosed, "The relay saw the server close the connection");
+	is($data, $mirrored, "What was read before is left to the main loop");
+	$relay->stop;
+}
+
+sub testStop {
+	my $test = newRelay();
+	my $relay = $test->{relay};
+
+	syswrite($test->{server}, $mirrored . substr($variable, 0, 4));
+	is(clientRead($test, 6), $mirrored, "The complete message is forwarded");
+	$relay->stop;
+	my ($data, @messages) = $relay->take;
+	is($data, $mirrored . substr($variable, 0, 4), "The start of a message is left to the main loop once the relay stopped");
+	is_deeply(\@messages, [$mirrored], "Only the complete message was forwarded");
+
+	syswrite($test->{server}, substr($variable, 4));
+	sleep 0.1;
+	($data) = $relay->take;
+	is($data, '', "A stopped relay reads nothing");
+}
+
+1;
@@ -358,10 +358,19 @@ public:
 		printf("Testing usage of multiple mirrors (3)...\n");
 		urls.clear();
 		urls.push_back(SECURE_URL);
-		urls.push_back(INVALID_URL); // Never used
+		urls.push_back(INVALID_URL); // Cancelled once SECURE_URL answers
 		urls.push_back(ERROR_URL);   // ditto
 		assert( testMirrors(urls, 0, 0) );
 
+		printf("Testing mirror racing...\n");
+		urls.clear();
+		urls.push_back(INVALID_URL); // Still connecting when LARGE_TEST_URL answers
+		urls.push_back(LARGE_TEST_URL);
+		time_t beginTime = time(NULL);
+		assert( testMirrors(urls, LARGE_TEST_SIZE, LARGE_TEST_CHECKSUM, 20000) );
+		assert( time(NULL) - beginTime < 20 );
+		assert( MirrorHttpReader::getLatency(LARGE_TEST_URL) > 0 );
+
 		printf("Testing getData (5)...\n");
 		assert( !testGetData(INVALID_URL, NULL, 0) );
 
@@ -372,8 +381,8 @@ public:
 private:
 	bool
 	testMirrors(const list<const char *> &urls, unsigned int expectedSize,
-		    unsigned int expectedChecksum) {
-		HttpReader *http = new MirrorHttpReader(urls, 3000);
+		    unsigned int expectedChecksum, unsigned int timeout = 3000) {
+		HttpReader *http = new MirrorHttpReader(urls, timeout);
 		HttpReaderStatus status;
 
 		status = http->getStatus();
@@ -0,0 +1,444 @@
+/*  Native pathfinding benchmark
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Runs the native pathfinding code on the shipped fields without Perl, so optimizations
+ * can be compared with repeatable numbers. For every field it builds the distance and
+ * weight maps, then runs a seeded set of random searches, line of sight checks and
+ * calcRectArea calls, and reports the latency percentiles of each of them.
+ *
+ * Usage: pathfinding-bench [--fields=DIR] [--queries=N] [--seed=N] [--algorithm=astar|jps]
+ *                          [--open-list=heap|bucket] [--plain] [map names...]
+ * Without map names, every .fld2.gz file of the fields folder is used.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <zlib.h>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <dirent.h>
+	#include <time.h>
+	#include <sys/time.h>
+	#include <sys/resource.h>
+#endif
+
+#include "algorithm.h"
+#include "distmap.h"
+#include "cpu-features.h"
+
+using namespace std;
+
+// Field tile flags, see the TILE_* constants in Field.pm
+#define TILE_WALK 1
+#define TILE_SNIPE 2
+
+// Nodes of the current search of a session, the same encoding as in algorithm.cpp
+#define CLOSED_STATE(session) (((session)->generation << 2) | CLOSED)
+
+struct Options {
+	string fields;
+	int queries;
+	unsigned int seed;
+	int algorithm;
+	int openListType;
+	bool avoidWalls;
+};
+
+struct Field {
+	string name;
+	int width;
+	int height;
+	vector<char> rawMap;
+	vector<unsigned char> distMap;
+	vector<char> weightMap;
+	vector<unsigned char> neighborMask;
+	vector<unsigned int> walkable;
+};
+
+// Latency samples of one benchmarked operation, in nanoseconds
+struct Samples {
+	const char *name;
+	vector<double> times;
+	// Work done by the samples (expanded nodes or cells), to report the time per unit
+	double work;
+	const char *unit;
+};
+
+static unsigned long long
+nanoTime ()
+{
+#ifdef WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency (&frequency);
+	QueryPerformanceCounter (&counter);
+	return (unsigned long long) (counter.QuadPart / frequency.QuadPart) * 1000000000ULL
+		+ (unsigned long long) (counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif /* WIN32 */
+}
+
+// Peak resident memory of the process, in kilobytes
+static unsigned long
+peakMemory ()
+{
+#ifdef WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo (GetCurrentProcess (), &counters, sizeof (counters))) {
+		return (unsigned long) (counters.PeakWorkingSetSize / 1024);
+	}
+	return 0;
+#else
+	struct rusage usage;
+	getrusage (RUSAGE_SELF, &usage);
+	#ifdef __APPLE__
+		return (unsigned long) (usage.ru_maxrss / 1024);
+	#else
+		return (unsigned long) usage.ru_maxrss;
+	#endif
+#endif /* WIN32 */
+}
+
+// xorshift32, so the queries only depend on the seed and not on the C library
+static inline unsigned int
+nextRandom (unsigned int *state)
+{
+	unsigned int x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static vector<string>
+listFields (const string &folder)
+{
+	vector<string> names;
+	const string suffix = ".fld2.gz";
+
+#ifdef WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE handle = FindFirstFileA ((folder + "\\*.fld2.gz").c_str (), &data);
+	if (handle != INVALID_HANDLE_VALUE) {
+		do {
+			string file = data.cFileName;
+			names.push_back (file.substr (0, file.size () - suffix.size ()));
+		} while (FindNextFileA (handle, &data));
+		FindClose (handle);
+	}
+#else
+	DIR *dir = opendir (folder.c_str ());
+	if (dir) {
+		struct dirent *entry;
+		while ((entry = readdir (dir)) != NULL) {
+			string file = entry->d_name;
+			if (file.size () > suffix.size () && file.compare (file.size () - suffix.size (), suffix.size (), suffix) == 0) {
+				names.push_back (file.substr (0, file.size () - suffix.size ()));
+			}
+		}
+		closedir (dir);
+	}
+#endif /* WIN32 */
+
+	sort (names.begin (), names.end ());
+	return names;
+}
+
+// Loads a .fld2.gz file: the width and height as little endian unsigned shorts followed by one byte per cell
+static bool
+loadField (const string &folder, const string &name, Field &field)
+{
+	string file = folder + "/" + name + ".fld2.gz";
+	gzFile gz = gzopen (file.c_str (), "rb");
+	if (!gz) {
+		return false;
+	}
+
+	vector<char> data;
+	char buffer[65536];
+	int read;
+	while ((read = gzread (gz, buffer, sizeof (buffer))) > 0) {
+		data.insert (data.end (), buffer, buffer + read);
+	}
+	gzclose (gz);
+	if (read < 0 || data.size () < 4) {
+		return false;
+	}
+
+	field.name = name;
+	field.width = (unsigned char) data[0] | ((unsigned char) data[1] << 8);
+	field.height = (unsigned char) data[2] | ((unsigned char) data[3] << 8);
+	if (field.width <= 0 || field.height <= 0 || data.size () - 4 < (size_t) field.width * field.height) {
+		return false;
+	}
+	field.rawMap.assign (data.begin () + 4, data.begin () + 4 + (size_t) field.width * field.height);
+	return true;
+}
+
+static void
+buildMaps (Field &field, Samples &distSamples, Samples &weightSamples, Samples &maskSamples)
+{
+	size_t size = (size_t) field.width * field.height;
+	unsigned long long start;
+
+	field.distMap.resize (size);
+	field.weightMap.resize (size);
+	field.neighborMask.resize (size);
+
+	start = nanoTime ();
+	makeDistMap_inner ((const unsigned char *) &field.rawMap[0], field.width, field.height, &field.distMap[0]);
+	distSamples.times.push_back ((double) (nanoTime () - start));
+	distSamples.work += size;
+
+	start = nanoTime ();
+	makeWeightMap_inner (&field.distMap[0], field.width, field.height, &field.weightMap[0]);
+	weightSamples.times.push_back ((double) (nanoTime () - start));
+	weightSamples.work += size;
+
+	start = nanoTime ();
+	CalcPath_buildNeighborMask (&field.weightMap[0], field.width, field.height, &field.neighborMask[0]);
+	maskSamples.times.push_back ((double) (nanoTime () - start));
+	maskSamples.work += size;
+
+	field.walkable.clear ();
+	for (size_t i = 0; i < size; i++) {
+		if (field.weightMap[i] != -1) {
+			field.walkable.push_back ((unsigned int) i);
+		}
+	}
+}
+
+// Runs one search the same way PathFinding::reset() and run() do, returns its CalcPath_pathStep result
+static int
+search (CalcPath_session *session, const Field &field, const Options &options, unsigned int from, unsigned int to, unsigned long *expanded)
+{
+	session->map_base_weight = &field.weightMap[0];
+	session->neighbor_mask = &field.neighborMask[0];
+	session->width = field.width;
+	session->height = field.height;
+	session->startX = from % field.width;
+	session->startY = from / field.width;
+	session->endX = to % field.width;
+	session->endY = to / field.width;
+	session->min_x = 0;
+	session->max_x = field.width - 1;
+	session->min_y = 0;
+	session->max_y = field.height - 1;
+	session->avoidWalls = options.avoidWalls;
+	session->customWeights = 0;
+	session->randomFactor = 0;
+	session->useManhattan = 0;
+	session->time_max = 60000;
+	session->algorithm = options.algorithm;
+	session->openListType = options.openListType;
+	session->node_budget = 0;
+	session->time_budget = 0;
+	session->routeCacheField = 0;
+	session->run = 0;
+	CalcPath_init (session);
+
+	int status = CalcPath_pathStep (session);
+
+	// Counted after the search so it does not change the timing
+	unsigned int closed = CLOSED_STATE(session);
+	unsigned long count = 0;
+	size_t size = (size_t) field.width * field.height;
+	for (size_t i = 0; i < size; i++) {
+		if (session->nodeState[i] == closed) {
+			count++;
+		}
+	}
+	*expanded = count;
+	return status;
+}
+
+static void
+benchField (Field &field, const Options &options, unsigned int *state, CalcPath_session *session, Samples *samples, unsigned long *results)
+{
+	int q;
+
+	for (q = 0; q < options.queries; q++) {
+		unsigned int from = field.walkable[nextRandom (state) % field.walkable.size ()];
+		unsigned int to = field.walkable[nextRandom (state) % field.walkable.size ()];
+		unsigned long expanded;
+		unsigned long long start = nanoTime ();
+		int status = search (session, field, options, from, to, &expanded);
+		samples[0].times.push_back ((double) (nanoTime () - start));
+		samples[0].work += expanded;
+		results[status == 1 ? 0 : 1]++;
+	}
+
+	// Line of sight checks between walkable cells in attack range of each other
+	for (q = 0; q < options.queries; q++) {
+		unsigned int from = field.walkable[nextRandom (state) % field.walkable.size ()];
+		int x = from % field.width + (int) (nextRandom (state) % 29) - 14;
+		int y = from / field.width + (int) (nextRandom (state) % 29) - 14;
+		unsigned long long start = nanoTime ();
+		volatile int visible = checkLOS_inner (from % field.width, from / field.width, x, y, TILE_WALK | TILE_SNIPE, field.width, field.height, &field.rawMap[0]);
+		samples[1].times.push_back ((double) (nanoTime () - start));
+		samples[1].work += 1;
+		(void) visible;
+	}
+
+	// calcRectArea with the radiuses used by route_randomWalk and runFromTarget
+	unsigned short coords[8 * 15 * 2];
+	for (q = 0; q < options.queries; q++) {
+		unsigned int center = field.walkable[nextRandom (state) % field.walkable.size ()];
+		int radius = 5 + (int) (nextRandom (state) % 11);
+		unsigned long long start = nanoTime ();
+		int count = calcRectArea_inner (center % field.width, center / field.width, radius, TILE_WALK, field.width, field.height, &field.rawMap[0], coords);
+		samples[2].times.push_back ((double) (nanoTime () - start));
+		samples[2].work += count;
+	}
+}
+
+static double
+percentile (vector<double> &times, double p)
+{
+	if (times.empty ()) {
+		return 0;
+	}
+	size_t index = (size_t) (p * (times.size () - 1) + 0.5);
+	nth_element (times.begin (), times.begin () + index, times.end ());
+	return times[index];
+}
+
+static void
+report (Samples &samples)
+{
+	double total = 0;
+	for (size_t i = 0; i < samples.times.size (); i++) {
+		total += samples.times[i];
+	}
+	double perUnit = samples.work > 0 ? total / samples.work : 0;
+	double p50 = percentile (samples.times, 0.5);
+	double p99 = percentile (samples.times, 0.99);
+	string units = string (samples.unit) + "s";
+	printf("%-14s %8lu calls  %14.0f %-6s  %10.1f ns/%-5s  p50 %10.1f us  p99 %10.1f us  total %9.1f ms\n",
+		samples.name, (unsigned long) samples.times.size (), samples.work, units.c_str (), perUnit, samples.unit,
+		p50 / 1000, p99 / 1000, total / 1000000);
+}
+
+static void
+usage (const char *program)
+{
+	fprintf(stderr, "Usage: %s [--fields=DIR] [--queries=N] [--seed=N] [--algorithm=astar|jps] [--open-list=heap|bucket] [--plain] [map names...]\n", program);
+	exit(1);
+}
+
+int
+main (int argc, char *argv[])
+{
+	Options options;
+	vector<string> names;
+	int i;
+
+	options.fields = "../../fields";
+	options.queries = 100;
+	options.seed = 1;
+	options.algorithm = CALCPATH_ASTAR;
+	options.openListType = OPENLIST_HEAP;
+	options.avoidWalls = true;
+
+	for (i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg.compare (0, 9, "--fields=") == 0) {
+			options.fields = arg.substr (9);
+		} else if (arg.compare (0, 10, "--queries=") == 0) {
+			options.queries = atoi (arg.c_str () + 10);
+		} else if (arg.compare (0, 7, "--seed=") == 0) {
+			options.seed = (unsigned int) strtoul (arg.c_str () + 7, NULL, 10);
+		} else if (arg == "--algorithm=astar") {
+			options.algorithm = CALCPATH_ASTAR;
+		} else if (arg == "--algorithm=jps") {
+			options.algorithm = CALCPATH_JPS;
+		} else if (arg == "--open-list=heap") {
+			options.openListType = OPENLIST_HEAP;
+		} else if (arg == "--open-list=bucket") {
+			options.openListType = OPENLIST_BUCKET;
+		} else if (arg == "--plain") {
+			// No wall avoidance, like the searches of route_avoidWalls 0
+			options.avoidWalls = false;
+		} else if (arg[0] == '-') {
+			usage (argv[0]);
+		} else {
+			names.push_back (arg);
+		}
+	}
+	if (options.queries <= 0) {
+		usage (argv[0]);
+	}
+	if (options.seed == 0) {
+		options.seed = 1;
+	}
+	if (names.empty ()) {
+		names = listFields (options.fields);
+	}
+	if (names.empty ()) {
+		fprintf(stderr, "No fields found in %s\n", options.fields.c_str ());
+		return 1;
+	}
+
+	Samples samples[6] = {
+		{ "pathStep", vector<double> (), 0, "node" },
+		{ "checkLOS", vector<double> (), 0, "check" },
+		{ "calcRectArea", vector<double> (), 0, "cell" },
+		{ "makeDistMap", vector<double> (), 0, "cell" },
+		{ "makeWeightMap", vector<double> (), 0, "cell" },
+		{ "neighborMask", vector<double> (), 0, "cell" }
+	};
+	unsigned long results[2] = { 0, 0 };
+	unsigned int state = options.seed;
+	int loaded = 0;
+	CalcPath_session *session = CalcPath_new ();
+
+	for (i = 0; i < (int) names.size (); i++) {
+		Field field;
+		if (!loadField (options.fields, names[i], field)) {
+			fprintf(stderr, "Skipping field %s, it cannot be read or is not a valid field file\n", names[i].c_str ());
+			continue;
+		}
+		buildMaps (field, samples[3], samples[4], samples[5]);
+		if (field.walkable.size () < 2) {
+			continue;
+		}
+		benchField (field, options, &state, session, samples, results);
+		loaded++;
+	}
+	CalcPath_destroy (session);
+
+	printf("%d fields, %d queries per field, seed %u, %s, %s open list%s\n", loaded, options.queries, options.seed,
+		options.algorithm == CALCPATH_JPS ? "jps" : "astar", options.openListType == OPENLIST_BUCKET ? "bucket" : "heap",
+		options.avoidWalls ? "" : ", no wall avoidance");
+	printf("%lu searches found a path, %lu did not, %s kernels\n", results[0], results[1], CPU_simdLevelName (CPU_simdLevel ()));
+	for (i = 0; i < 6; i++) {
+		report (samples[i]);
+	}
+	printf("peak memory %lu KB\n", peakMemory ());
+	return 0;
+}
@@ -0,0 +1,100 @@
+#!/usr/bin/env perl
+# Benchmarks the PathFinding open list backends, and the bidirectional search against A*, on the shipped fields.
+#
+# Usage: pathfinding-benchmark.pl [--searches=N] [--fields=DIR] [map names...]
+# Without map names, every field in the fields folder is used.
+use strict;
+use FindBin qw($RealBin);
+use lib "$RealBin/..";
+use lib "$RealBin/../deps";
+use lib "$RealBin/../auto/XSTools";
+use Getopt::Long;
+use Time::HiRes qw(time);
+
+use Settings;
+use Field;
+use Utils::PathFinding;
+
+my $searches = 50;
+my $fields = "$RealBin/../../fields";
+GetOptions('searches=i' => \$searches, 'fields=s' => \$fields) or die "Usage: $0 [--searches=N] [--fields=DIR] [map names...]\n";
+$Settings::fields_folder = $fields;
+
+my @maps = @ARGV;
+if (!@maps) {
+	opendir(my $dir, $fields) or die "Cannot open $fields: $!\n";
+	@maps = sort map { /^(.+)\.fld2\.gz$/ ? $1 : () } readdir($dir);
+	closedir($dir);
+}
+
+# Each search is run with both backends for the same options
+my @options = (
+	['avoidWalls', avoidWalls => 1],
+	['plain', avoidWalls => 0],
+	['manhattan', avoidWalls => 0, useManhattan => 1],
+);
+my @backends = qw(heap bucket);
+
+# The bidirectional search is compared to A* (with the heap) in the nodes they expand, manhattan searches can't use it
+my @bidirectional = grep { $_->[0] ne 'manhattan' } @options;
+
+my $pathfinding = new PathFinding;
+my (%time, %count, %different, %expanded, %bidiTime, %bidiCount);
+srand(1);
+
+foreach my $map (@maps) {
+	my $field = eval { new Field(name => $map) };
+	next unless $field;
+
+	my @walkable;
+	for my $y (0 .. $field->height - 1) {
+		for my $x (0 .. $field->width - 1) {
+			push @walkable, { x => $x, y => $y } if $field->isWalkable($x, $y);
+		}
+	}
+	next if @walkable < 2;
+
+	for (1 .. $searches) {
+		my $start = $walkable[int rand @walkable];
+		my $dest = $walkable[int rand @walkable];
+		foreach my $option (@options) {
+			my ($name, @args) = @$option;
+			my %result;
+			foreach my $backend (@backends) {
+				my $begin = time;
+				$pathfinding->reset(field => $field, start => $start, dest => $dest, timeout => 60000, open_list => $backend, @args);
+				$result{$backend} = $pathfinding->runcount;
+				$time{$name}{$backend} += time - $begin;
+				$expanded{$name}{astar} += $pathfinding->expanded if ($backend eq 'heap');
+			}
+			$count{$name}++;
+			$different{$name}++ if $result{heap} != $result{bucket};
+		}
+		foreach my $option (@bidirectional) {
+			my ($name, @args) = @$option;
+			my $begin = time;
+			$pathfinding->reset(field => $field, start => $start, dest => $dest, timeout => 60000, algorithm => 'bidirectional', @args);
+			$pathfinding->runcount;
+			$bidiTime{$name} += time - $begin;
+			$expanded{$name}{bidirectional} += $pathfinding->expanded;
+			$bidiCount{$name}++;
+		}
+	}
+}
+
+printf "%-10s %8s %10s %10s %8s %10s\n", 'search', 'count', 'heap (s)', 'bucket (s)', 'speedup', 'different';
+foreach my $option (@options) {
+	my $name = $option->[0];
+	next unless $count{$name};
+	printf "%-10s %8d %10.3f %10.3f %7.2fx %10d\n", $name, $count{$name}, $time{$name}{heap}, $time{$name}{bucket},
+		$time{$name}{bucket} ? $time{$name}{heap} / $time{$name}{bucket} : 0, $different{$name} || 0;
+}
+
+print "\n";
+printf "%-10s %8s %10s %10s %14s %14s\n", 'search', 'count', 'A* (s)', 'bidi (s)', 'A* expanded', 'bidi expanded';
+foreach my $option (@bidirectional) {
+	my $name = $option->[0];
+	next unless $bidiCount{$name};
+	printf "%-10s %8d %10.3f %10.3f %14d %14d\n", $name, $bidiCount{$name}, $time{$name}{heap}, $bidiTime{$name},
+		$expanded{$name}{astar}, $expanded{$name}{bidirectional};
+}
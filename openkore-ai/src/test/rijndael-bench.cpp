@@ -0,0 +1,155 @@
+/*  Rijndael throughput benchmark
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Measures the throughput of CRijndael (Utils::Rijndael) with the tables and with the AES instructions of
+ * the CPU, for each key length and mode, and for the 24 byte blocks of the login packets, which only the
+ * tables do. Each case encrypts and decrypts the same buffer over and over for about the given time.
+ *
+ * Usage: rijndael-bench [--size=BYTES] [--ms=MILLISECONDS]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <time.h>
+#endif
+
+#include "Rijndael.h"
+#include "aes-hw.h"
+
+using namespace std;
+
+static unsigned long long
+nanoTime ()
+{
+#ifdef WIN32
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency (&frequency);
+	QueryPerformanceCounter (&counter);
+	return (unsigned long long) (counter.QuadPart / frequency.QuadPart) * 1000000000ULL
+		+ (unsigned long long) (counter.QuadPart % frequency.QuadPart) * 1000000000ULL / frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif /* WIN32 */
+}
+
+// Megabytes per second of encrypting or decrypting 'data' in 'mode' for about 'ms' milliseconds
+static double
+throughput (CRijndael &rijndael, bool decrypt, int mode, vector<char> &data, vector<char> &result, int ms)
+{
+	unsigned long long start = nanoTime ();
+	unsigned long long end = start + (unsigned long long) ms * 1000000ULL;
+	unsigned long long now;
+	unsigned long long bytes = 0;
+
+	do {
+		for (int i = 0; i < 16; i++) {
+			if (decrypt) {
+				rijndael.Decrypt (&data[0], &result[0], data.size (), mode);
+			} else {
+				rijndael.Encrypt (&data[0], &result[0], data.size (), mode);
+			}
+			bytes += data.size ();
+		}
+		now = nanoTime ();
+	} while (now < end);
+	return bytes / ((now - start) / 1e9) / (1024.0 * 1024.0);
+}
+
+static void
+usage (const char *program)
+{
+	fprintf(stderr, "Usage: %s [--size=BYTES] [--ms=MILLISECONDS]\n", program);
+	exit(1);
+}
+
+int
+main (int argc, char *argv[])
+{
+	static const char *const modeNames[] = { "ECB", "CBC", "CFB" };
+	size_t size = 4096;
+	int ms = 200;
+	int i;
+
+	for (i = 1; i < argc; i++) {
+		string arg = argv[i];
+		if (arg.compare (0, 7, "--size=") == 0) {
+			size = (size_t) strtoul (arg.c_str () + 7, NULL, 10);
+		} else if (arg.compare (0, 5, "--ms=") == 0) {
+			ms = atoi (arg.c_str () + 5);
+		} else {
+			usage (argv[0]);
+		}
+	}
+	// A multiple of both block sizes
+	size -= size % 48;
+	if (size == 0 || ms <= 0) {
+		usage (argv[0]);
+	}
+
+	vector<char> data (size), result (size);
+	char key[32], chain[32];
+	srand (1);
+	for (i = 0; i < (int) size; i++) {
+		data[i] = (char) rand ();
+	}
+	for (i = 0; i < 32; i++) {
+		key[i] = (char) rand ();
+		chain[i] = (char) rand ();
+	}
+
+	printf("AES instructions: %s, %lu byte buffers\n\n", AESHW_name (), (unsigned long) size);
+	printf("%-8s %-6s %-6s %14s %14s %14s %14s\n", "block", "key", "mode",
+		"tables enc", "tables dec", "hardware enc", "hardware dec");
+	for (int blockSize = 16; blockSize <= 24; blockSize += 8) {
+		for (int keyLength = 16; keyLength <= 32; keyLength += 8) {
+			for (int mode = CRijndael::ECB; mode <= CRijndael::CFB; mode++) {
+				CRijndael rijndael;
+				double rates[4];
+				bool hardware;
+
+				rijndael.MakeKey (key, chain, keyLength, blockSize);
+				rijndael.UseHardware (false);
+				rates[0] = throughput (rijndael, false, mode, data, result, ms);
+				rates[1] = throughput (rijndael, true, mode, data, result, ms);
+				hardware = rijndael.UseHardware (true);
+				if (hardware) {
+					rates[2] = throughput (rijndael, false, mode, data, result, ms);
+					rates[3] = throughput (rijndael, true, mode, data, result, ms);
+				}
+
+				printf("%-8d %-6d %-6s %9.1f MB/s %9.1f MB/s", blockSize, keyLength * 8, modeNames[mode],
+					rates[0], rates[1]);
+				if (hardware) {
+					printf(" %9.1f MB/s %9.1f MB/s\n", rates[2], rates[3]);
+				} else {
+					printf(" %14s %14s\n", "-", "-");
+				}
+			}
+		}
+	}
+	return 0;
+}
@@ -20,12 +20,26 @@ my @tests = qw(
 	TaskManagerTest TaskWithSubtaskTest TaskChainedTest
 	TaskTalkNPCTest
 	PluginsHookTest
+	LogFilterTest
 	FileParsersTest
+	TableCacheTest
 	NetworkTest
+	MessageTokenizerTest
+	PacketUnpackerTest
+	TimerWheelTest
+	CoordsTest
+	HashRingTest
+	PaddedPacketsTest
 	FieldTest
+	PathFindingTest
+	HierarchicalPathFindingTest
+	EngineClientTest
+	BusMessagesTest
 );
 if ($^O eq 'MSWin32') {
 	push @tests, qw(HttpReaderTest);
+} else {
+	push @tests, qw(LogSinkTest XKoreProxyRelayTest NetworkMultiplexerTest BusServerTest);
 }
 
 @tests = @ARGV if (@ARGV);